@@ -7,6 +7,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "packer.h"
 
+#include "core/update_delta.h"
+
 bool BetaChannel = false;
 quint64 AlphaVersion = 0;
 bool OnlyAlphaKey = false;
@@ -154,6 +156,8 @@ int main(int argc, char *argv[])
 
 	QString remove;
 	int version = 0;
+	int deltaFrom = 0;
+	QString baseDir;
 	[[maybe_unused]] bool targetwin64 = false;
 	[[maybe_unused]] bool targetwinarm = false;
 	[[maybe_unused]] bool targetarmac = false;
@@ -175,6 +179,10 @@ int main(int argc, char *argv[])
 			}
 		} else if (string("-version") == argv[i] && i + 1 < argc) {
 			version = QString(argv[i + 1]).toInt();
+		} else if (string("-deltafrom") == argv[i] && i + 1 < argc) {
+			deltaFrom = QString(argv[i + 1]).toInt();
+		} else if (string("-base") == argv[i] && i + 1 < argc) {
+			baseDir = QDir(workDir + QString(argv[i + 1])).canonicalPath() + "/";
 		} else if (string("-beta") == argv[i]) {
 			BetaChannel = true;
 		} else if (string("-alphakey") == argv[i]) {
@@ -207,6 +215,15 @@ int main(int argc, char *argv[])
 #endif
 		return -1;
 	}
+	if (deltaFrom || !baseDir.isEmpty()) {
+		if (deltaFrom <= 1016 || deltaFrom >= version || baseDir.size() < 2) {
+			cout << "Usage: add -deltafrom {version} -base {dir} with the files of that version to make a delta update\n";
+			return -1;
+		} else if (AlphaVersion) {
+			cout << "Delta updates are not supported for alpha versions\n";
+			return -1;
+		}
+	}
 
 	bool hasDirs = true;
 	while (hasDirs) {
@@ -254,7 +271,11 @@ int main(int argc, char *argv[])
 			stream << quint32(version);
 		}
 
-		stream << quint32(files.size());
+		if (deltaFrom) {
+			stream << (quint32(files.size()) | Core::UpdateDelta::kPackageFlag) << quint32(deltaFrom);
+		} else {
+			stream << quint32(files.size());
+		}
 		cout << "Found " << files.size() << " file" << (files.size() == 1 ? "" : "s") << "..\n";
 		for (QFileInfoList::iterator i = files.begin(); i != files.end(); ++i) {
 			QFileInfo info(*i);
@@ -268,7 +289,43 @@ int main(int argc, char *argv[])
 				return -1;
 			}
 			QByteArray inner = f.readAll();
-			stream << name << quint32(inner.size()) << inner;
+			if (deltaFrom) {
+				using Kind = Core::UpdateDelta::FileKind;
+				const auto sha1 = [](const QByteArray &data) {
+					uchar buffer[20];
+					hashSha1(data.constData(), uint32(data.size()), buffer);
+					return QByteArray((const char*)buffer, 20);
+				};
+				stream << name << quint32(inner.size()) << sha1(inner);
+
+				QFile b(baseDir + name);
+				if (!b.open(QIODevice::ReadOnly)) {
+					cout << "No base file, writing full..\n";
+					stream << quint8(Kind::Full) << inner;
+				} else {
+					QByteArray base = b.readAll();
+					if (base == inner) {
+						cout << "Same as base..\n";
+						stream << quint8(Kind::Same) << sha1(base);
+					} else {
+						QByteArray patch = Core::UpdateDelta::Make(base, inner);
+						QByteArray check = Core::UpdateDelta::Apply(base, patch).value_or(QByteArray());
+						if (check != inner) {
+							cout << "Patch check failed for '" << name.toUtf8().constData() << "' :(\n";
+							return -1;
+						}
+						if (qint64(patch.size()) * 10 < qint64(inner.size()) * 9) {
+							cout << "Patch size: " << patch.size() << "\n";
+							stream << quint8(Kind::Patch) << sha1(base) << patch;
+						} else {
+							cout << "Patch is too big, writing full..\n";
+							stream << quint8(Kind::Full) << inner;
+						}
+					}
+				}
+			} else {
+				stream << name << quint32(inner.size()) << inner;
+			}
 #ifndef Q_OS_WIN
 			stream << (QFileInfo(fullName).isExecutable() ? true : false);
 #endif
@@ -503,6 +560,8 @@ int main(int argc, char *argv[])
 #endif
 	if (AlphaVersion) {
 		outName += "_" + AlphaSignature;
+	} else if (deltaFrom) {
+		outName += QString("_d%1").arg(deltaFrom);
 	}
 	QFile out(outName);
 	if (!out.open(QIODevice::WriteOnly)) {
@@ -766,6 +766,16 @@ void ChatParticipants::kick(
 
 		_kickRequests.remove(KickRequest(channel, participant));
 		channel->applyEditBanned(participant, currentRights, rights);
+		_channelUpdates.fire({
+			.channel = channel,
+			.participantId = participant->id,
+			.now = ChatParticipant(
+				ChatParticipant::Type::Banned,
+				participant->id,
+				peerToUser(channel->session().userPeerId()),
+				rights,
+				ChatAdminRightsInfo()),
+		});
 	}).fail([this, kick] {
 		_kickRequests.remove(kick);
 	}).send();
@@ -789,6 +799,10 @@ void ChatParticipants::unblock(
 		channel->session().api().applyUpdates(result);
 
 		_kickRequests.remove(KickRequest(channel, participant));
+		_channelUpdates.fire({
+			.channel = channel,
+			.participantId = participant->id,
+		});
 		if (channel->kickedCount() > 0) {
 			channel->setKickedCount(channel->kickedCount() - 1);
 		} else {
@@ -801,6 +815,29 @@ void ChatParticipants::unblock(
 	_kickRequests.emplace(kick, requestId);
 }
 
+void ChatParticipants::apply(const MTPDupdateChannelParticipant &update) {
+	const auto channel = _session->data().channelLoaded(
+		update.vchannel_id());
+	if (!channel) {
+		return;
+	}
+	const auto participantId = peerFromUser(update.vuser_id());
+	auto now = std::optional<ChatParticipant>();
+	if (const auto participant = update.vnew_participant()) {
+		now.emplace(*participant, channel);
+	}
+	_channelUpdates.fire({
+		.channel = channel,
+		.participantId = participantId,
+		.now = std::move(now),
+	});
+}
+
+auto ChatParticipants::channelUpdates() const
+-> rpl::producer<ChannelUpdate> {
+	return _channelUpdates.events();
+}
+
 void ChatParticipants::loadSimilarPeers(not_null<PeerData*> peer) {
 	if (const auto i = _similar.find(peer); i != end(_similar)) {
 		if (i->second.requestId
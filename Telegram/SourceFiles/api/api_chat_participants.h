@@ -92,6 +92,12 @@ public:
 		const std::vector<ChatParticipant> list;
 	};
 
+	struct ChannelUpdate {
+		not_null<ChannelData*> channel;
+		PeerId participantId;
+		std::optional<ChatParticipant> now; // std::nullopt if not a member.
+	};
+
 	using TLMembers = MTPDchannels_channelParticipants;
 	using Members = const std::vector<ChatParticipant> &;
 	explicit ChatParticipants(not_null<ApiWrap*> api);
@@ -138,6 +144,9 @@ public:
 		not_null<ChannelData*> channel,
 		not_null<PeerData*> participant);
 
+	void apply(const MTPDupdateChannelParticipant &update);
+	[[nodiscard]] rpl::producer<ChannelUpdate> channelUpdates() const;
+
 	void loadSimilarPeers(not_null<PeerData*> peer);
 
 	struct Peers {
@@ -185,6 +194,7 @@ private:
 		not_null<ChannelData*>,
 		not_null<PeerData*>>;
 	base::flat_map<KickRequest, mtpRequestId> _kickRequests;
+	rpl::event_stream<ChannelUpdate> _channelUpdates;
 
 	base::flat_map<not_null<PeerData*>, SimilarPeers> _similar;
 	rpl::event_stream<not_null<PeerData*>> _similarLoaded;
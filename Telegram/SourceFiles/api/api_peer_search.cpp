@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "api/api_single_message_search.h"
 #include "apiwrap.h"
+#include "data/data_peer.h"
 #include "data/data_session.h"
 #include "dialogs/ui/chat_search_in.h" // IsHashOrCashtagSearchQuery
 #include "main/main_session.h"
@@ -41,14 +42,25 @@ void PeerSearch::request(
 		finish(PeerSearchResult{});
 		return;
 	}
-	auto &cache = _cache[_query];
-	if (cache.peersReady && cache.sponsoredReady) {
-		finish(cache.result);
+	const auto i = _cache.find(_query);
+	if (i != end(_cache)
+		&& i->second.peersReady
+		&& i->second.sponsoredReady) {
+		finish(i->second.result);
 		return;
 	} else if (type == RequestType::CacheOnly) {
-		_callback = nullptr;
+		// While typing show the result of a shorter query narrowed down,
+		// until the request for this one is sent and answered.
+		if (auto result = narrowed()) {
+			finish(std::move(*result));
+		} else {
+			_callback = nullptr;
+		}
 		return;
-	} else if (cache.requested) {
+	}
+	cancelOtherRequests();
+	auto &cache = _cache[_query];
+	if (cache.requested) {
 		return;
 	}
 	cache.requested = true;
@@ -149,6 +161,61 @@ void PeerSearch::finishSponsored(
 	}
 }
 
+void PeerSearch::cancelOtherRequests() {
+	const auto cancel = [&](base::flat_map<mtpRequestId, QString> &requests) {
+		for (auto i = begin(requests); i != end(requests);) {
+			if (i->second == _query) {
+				++i;
+				continue;
+			}
+			_session->api().request(i->first).cancel();
+			_cache.remove(i->second);
+			i = requests.erase(i);
+		}
+	};
+	cancel(_peerRequests);
+	cancel(_sponsoredRequests);
+}
+
+std::optional<PeerSearchResult> PeerSearch::narrowed() const {
+	const CacheEntry *longest = nullptr;
+	auto length = 0;
+	for (const auto &[query, entry] : _cache) {
+		if (query.size() > length
+			&& query.size() < _query.size()
+			&& entry.peersReady
+			&& _query.startsWith(query)) {
+			longest = &entry;
+			length = query.size();
+		}
+	}
+	if (!longest) {
+		return std::nullopt;
+	}
+	const auto words = TextUtilities::PrepareSearchWords(_query);
+	const auto matches = [&](not_null<PeerData*> peer) {
+		const auto &nameWords = peer->nameWords();
+		return ranges::all_of(words, [&](const QString &word) {
+			return ranges::any_of(nameWords, [&](const QString &name) {
+				return name.startsWith(word);
+			});
+		});
+	};
+	auto result = PeerSearchResult{ .query = _query };
+	for (const auto &peer : longest->result.my) {
+		if (matches(peer)) {
+			result.my.push_back(peer);
+		}
+	}
+	for (const auto &peer : longest->result.peers) {
+		if (matches(peer)) {
+			result.peers.push_back(peer);
+		}
+	}
+	// Sponsored peers are chosen for the exact query, none until it loads.
+	return result;
+}
+
 void PeerSearch::finish(PeerSearchResult result) {
 	if (const auto onstack = base::take(_callback)) {
 		onstack(std::move(result));
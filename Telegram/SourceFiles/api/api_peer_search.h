@@ -56,6 +56,8 @@ private:
 
     void requestPeers();
     void requestSponsored();
+	void cancelOtherRequests();
+	[[nodiscard]] std::optional<PeerSearchResult> narrowed() const;
 
 	void finish(PeerSearchResult result);
 	void finishPeers(mtpRequestId requestId, PeerSearchResult result);
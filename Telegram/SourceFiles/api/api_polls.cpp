@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "api/api_common.h"
 #include "api/api_updates.h"
+#include "api/api_views.h"
 #include "apiwrap.h"
 #include "base/random.h"
 #include "data/business/data_shortcut_messages.h"
@@ -207,20 +208,7 @@ void Polls::close(not_null<HistoryItem*> item) {
 }
 
 void Polls::reloadResults(not_null<HistoryItem*> item) {
-	const auto itemId = item->fullId();
-	if (!item->isRegular() || _pollReloadRequestIds.contains(itemId)) {
-		return;
-	}
-	const auto requestId = _api.request(MTPmessages_GetPollResults(
-		item->history()->peer->input,
-		MTP_int(item->id)
-	)).done([=](const MTPUpdates &result) {
-		_pollReloadRequestIds.erase(itemId);
-		_session->updates().applyUpdates(result);
-	}).fail([=] {
-		_pollReloadRequestIds.erase(itemId);
-	}).send();
-	_pollReloadRequestIds.emplace(itemId, requestId);
+	_session->api().views().scheduleRefresh(item, RefreshKind::PollResults);
 }
 
 } // namespace Api
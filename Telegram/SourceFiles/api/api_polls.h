@@ -42,7 +42,6 @@ private:
 
 	base::flat_map<FullMsgId, mtpRequestId> _pollVotesRequestIds;
 	base::flat_map<FullMsgId, mtpRequestId> _pollCloseRequestIds;
-	base::flat_map<FullMsgId, mtpRequestId> _pollReloadRequestIds;
 
 };
 
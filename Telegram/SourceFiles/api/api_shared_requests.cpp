@@ -0,0 +1,47 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "api/api_shared_requests.h"
+
+#include "apiwrap.h"
+
+namespace Api {
+
+SharedRequests::SharedRequests(not_null<ApiWrap*> api)
+: _api(&api->instance()) {
+}
+
+SharedRequests::~SharedRequests() = default;
+
+void SharedRequests::finish(
+		const QByteArray &key,
+		const void *result,
+		const MTP::Error *error) {
+	const auto i = _entries.find(key);
+	if (i == end(_entries)) {
+		return;
+	}
+	// Callbacks may send the same request again.
+	const auto entry = std::move(i->second);
+	_entries.erase(i);
+
+	if (result) {
+		for (const auto &done : entry.done) {
+			if (done) {
+				done(result);
+			}
+		}
+	} else {
+		for (const auto &fail : entry.fail) {
+			if (fail) {
+				fail(*error);
+			}
+		}
+	}
+}
+
+} // namespace Api
@@ -0,0 +1,87 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "mtproto/sender.h"
+
+class ApiWrap;
+
+namespace Api {
+
+// Sends a request only if an identical one, by serialized bytes, is not
+// in flight already, otherwise waits for that one. All the waiters get
+// the same response. Only for requests without side effects.
+class SharedRequests final {
+public:
+	explicit SharedRequests(not_null<ApiWrap*> api);
+	~SharedRequests();
+
+	template <typename Request>
+	void send(
+			Request &&request,
+			Fn<void(const typename std::decay_t<Request>::ResponseType&)> done,
+			Fn<void(const MTP::Error&)> fail = nullptr) {
+		using Result = typename std::decay_t<Request>::ResponseType;
+
+		auto key = Serialize(request);
+		auto &entry = _entries[key];
+		if (done) {
+			entry.done.push_back([=](const void *result) {
+				done(*static_cast<const Result*>(result));
+			});
+		} else {
+			entry.done.push_back(nullptr);
+		}
+		entry.fail.push_back(std::move(fail));
+		if (entry.requestId) {
+			++_shared;
+			return;
+		}
+		entry.requestId = _api.request(
+			std::forward<Request>(request)
+		).done([=](const Result &result) {
+			finish(key, &result, nullptr);
+		}).fail([=](const MTP::Error &error) {
+			finish(key, nullptr, &error);
+		}).send();
+	}
+
+	// Requests that got an answer from an identical one in flight.
+	[[nodiscard]] int shared() const {
+		return _shared;
+	}
+
+private:
+	struct Entry {
+		mtpRequestId requestId = 0;
+		std::vector<Fn<void(const void*)>> done; // Same Result for all.
+		std::vector<Fn<void(const MTP::Error&)>> fail;
+	};
+
+	template <typename Request>
+	[[nodiscard]] static QByteArray Serialize(const Request &request) {
+		auto buffer = mtpBuffer();
+		buffer.reserve(tl::count_length(request) >> 2);
+		request.template write<mtpBuffer>(buffer);
+		return QByteArray(
+			reinterpret_cast<const char*>(buffer.constData()),
+			buffer.size() * sizeof(mtpPrime));
+	}
+
+	void finish(
+		const QByteArray &key,
+		const void *result,
+		const MTP::Error *error);
+
+	MTP::Sender _api;
+	base::flat_map<QByteArray, Entry> _entries;
+	int _shared = 0;
+
+};
+
+} // namespace Api
@@ -22,6 +22,10 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 namespace Api {
 namespace {
 
+// Statistics are recalculated by the server rarely, so opening them
+// again soon after doesn't need a new request.
+constexpr auto kStatisticsCacheTimeout = 5 * 60 * crl::time(1000);
+
 [[nodiscard]] Data::StatisticalValue StatisticalValueFromTL(
 		const MTPStatsAbsValueAndPrev &tl) {
 	const auto current = tl.data().vcurrent().v;
@@ -207,12 +211,15 @@ rpl::producer<rpl::no_value, QString> Statistics::request() {
 	return [=](auto consumer) {
 		auto lifetime = rpl::lifetime();
 
-		if (!channel()->isMegagroup()) {
+		if (applyCached()) {
+			consumer.put_done();
+		} else if (!channel()->isMegagroup()) {
 			makeRequest(MTPstats_GetBroadcastStats(
 				MTP_flags(MTPstats_GetBroadcastStats::Flags(0)),
 				channel()->inputChannel
 			)).done([=](const MTPstats_BroadcastStats &result) {
 				_channelStats = ChannelStatisticsFromTL(result.data());
+				remember();
 				consumer.put_done();
 			}).fail([=](const MTP::Error &error) {
 				consumer.put_error_copy(error.type());
@@ -225,6 +232,7 @@ rpl::producer<rpl::no_value, QString> Statistics::request() {
 				const auto &data = result.data();
 				_supergroupStats = SupergroupStatisticsFromTL(data);
 				channel()->owner().processUsers(data.vusers());
+				remember();
 				consumer.put_done();
 			}).fail([=](const MTP::Error &error) {
 				consumer.put_error_copy(error.type());
@@ -277,6 +285,57 @@ Data::SupergroupStatistics Statistics::supergroupStats() const {
 	return _supergroupStats;
 }
 
+std::optional<Data::AnyStatistics> Statistics::Cached(
+		not_null<ChannelData*> channel) {
+	return channel->session().api().statisticsCache().lookup(channel->id);
+}
+
+bool Statistics::applyCached() {
+	if (const auto cached = Cached(channel())) {
+		_channelStats = cached->channel;
+		_supergroupStats = cached->supergroup;
+		return true;
+	}
+	return false;
+}
+
+void Statistics::remember() {
+	channel()->session().api().statisticsCache().remember(
+		channel()->id,
+		Data::AnyStatistics{
+			.channel = _channelStats,
+			.supergroup = _supergroupStats,
+		});
+}
+
+std::optional<Data::AnyStatistics> StatisticsCache::lookup(PeerId channelId) {
+	const auto i = _entries.find(channelId);
+	if (i == end(_entries)) {
+		return std::nullopt;
+	} else if (crl::now() - i->second.received >= kStatisticsCacheTimeout) {
+		_entries.erase(i);
+		return std::nullopt;
+	}
+	return i->second.statistics;
+}
+
+void StatisticsCache::remember(
+		PeerId channelId,
+		Data::AnyStatistics statistics) {
+	const auto now = crl::now();
+	for (auto i = begin(_entries); i != end(_entries);) {
+		if (now - i->second.received >= kStatisticsCacheTimeout) {
+			i = _entries.erase(i);
+		} else {
+			++i;
+		}
+	}
+	_entries[channelId] = Entry{
+		.statistics = std::move(statistics),
+		.received = now,
+	};
+}
+
 PublicForwards::PublicForwards(
 	not_null<ChannelData*> channel,
 	Data::RecentPostId fullId)
@@ -30,7 +30,14 @@ public:
 	[[nodiscard]] Data::ChannelStatistics channelStats() const;
 	[[nodiscard]] Data::SupergroupStatistics supergroupStats() const;
 
+	// Statistics received recently by any request for this channel.
+	[[nodiscard]] static std::optional<Data::AnyStatistics> Cached(
+		not_null<ChannelData*> channel);
+
 private:
+	bool applyCached();
+	void remember();
+
 	Data::ChannelStatistics _channelStats;
 	Data::SupergroupStatistics _supergroupStats;
 
@@ -38,6 +45,22 @@ private:
 
 };
 
+// Channel and supergroup statistics received recently in a session.
+class StatisticsCache final {
+public:
+	[[nodiscard]] std::optional<Data::AnyStatistics> lookup(PeerId channelId);
+	void remember(PeerId channelId, Data::AnyStatistics statistics);
+
+private:
+	struct Entry {
+		Data::AnyStatistics statistics;
+		crl::time received = 0;
+	};
+
+	base::flat_map<PeerId, Entry> _entries;
+
+};
+
 class PublicForwards final : public StatisticsRequestSender {
 public:
 	PublicForwards(
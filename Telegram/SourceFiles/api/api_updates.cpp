@@ -77,6 +77,10 @@ constexpr auto kChannelGetDifferenceLimit = 100;
 // 1s wait after show channel history before sending getChannelDifference.
 constexpr auto kWaitForChannelGetDifference = crl::time(1000);
 
+// After a long offline getDifference reports many channels too long,
+// their catch-up runs this many at once, open and pinned chats first.
+constexpr auto kChannelCatchUpParallel = 8;
+
 // If nothing is received in 1 min we ping.
 constexpr auto kNoUpdatesTimeout = 60 * 1000;
 
@@ -329,6 +333,7 @@ void Updates::feedUpdateVector(
 	if (policy == SkipUpdatePolicy::SkipNone) {
 		applyConvertToScheduledOnSend(updates);
 	}
+	const auto batch = Data::Changes::Batch(&session().changes());
 	for (const auto &entry : std::as_const(list)) {
 		const auto type = entry.type();
 		if ((policy == SkipUpdatePolicy::SkipMessageIds
@@ -440,6 +445,7 @@ void Updates::channelDifferenceDone(
 			"{ good - after not final channelDifference was received }%1"
 			).arg(_session->mtp().isTestMode() ? " TESTMODE" : ""));
 		getChannelDifference(channel);
+		return;
 	} else if (inActiveChats(channel)) {
 		channel->ptsSetWaitingForShortPoll(timeout
 			? (timeout * crl::time(1000))
@@ -447,10 +453,53 @@ void Updates::channelDifferenceDone(
 	} else {
 		channel->ptsSetWaitingForShortPoll(-1);
 	}
+	finishChannelCatchUp(channel);
+}
+
+void Updates::queueChannelCatchUp(not_null<ChannelData*> channel) {
+	if (_channelCatchUpRunning.contains(channel)
+		|| ranges::contains(_channelCatchUp, channel)) {
+		return;
+	}
+	_channelCatchUp.push_back(channel);
+	sendChannelCatchUp();
+}
+
+void Updates::sendChannelCatchUp() {
+	const auto priority = [&](not_null<ChannelData*> channel) {
+		if (inActiveChats(channel)) {
+			return 2;
+		}
+		const auto history = session().data().historyLoaded(channel.get());
+		return (history && history->isPinnedDialog(FilterId())) ? 1 : 0;
+	};
+	while (!_channelCatchUp.empty()
+		&& int(_channelCatchUpRunning.size()) < kChannelCatchUpParallel) {
+		const auto i = ranges::max_element(
+			_channelCatchUp,
+			ranges::less(),
+			priority);
+		const auto channel = *i;
+		_channelCatchUp.erase(i);
+		if (!channel->ptsInited() || channel->ptsRequesting()) {
+			// The running request will bring the difference as well.
+			continue;
+		}
+		_channelCatchUpRunning.emplace(channel);
+		getChannelDifference(channel);
+	}
+}
+
+void Updates::finishChannelCatchUp(not_null<ChannelData*> channel) {
+	if (_channelCatchUpRunning.remove(channel)) {
+		sendChannelCatchUp();
+	}
 }
 
 void Updates::feedChannelDifference(
 		const MTPDupdates_channelDifference &data) {
+	const auto batch = Data::Changes::Batch(&session().changes());
+
 	session().data().processUsers(data.vusers());
 	session().data().processChats(data.vchats());
 
@@ -474,6 +523,9 @@ void Updates::channelDifferenceFail(
 		error.type(),
 		error.description()));
 	failDifferenceStartTimerFor(channel);
+
+	// The retry after fail goes outside of the catch-up budget.
+	finishChannelCatchUp(channel);
 }
 
 void Updates::stateDone(const MTPupdates_State &state) {
@@ -617,6 +669,8 @@ void Updates::feedDifference(
 		const MTPVector<MTPChat> &chats,
 		const MTPVector<MTPMessage> &msgs,
 		const MTPVector<MTPUpdate> &other) {
+	const auto batch = Data::Changes::Batch(&session().changes());
+
 	Core::App().checkAutoLock();
 	session().data().processUsers(users);
 	session().data().processChats(chats);
@@ -2019,6 +2073,11 @@ void Updates::feedUpdate(const MTPUpdate &update) {
 		session().data().applyUpdate(update.c_updateChatParticipantAdmin());
 	} break;
 
+	case mtpc_updateChannelParticipant: {
+		session().api().chatParticipants().apply(
+			update.c_updateChannelParticipant());
+	} break;
+
 	case mtpc_updateChatDefaultBannedRights: {
 		session().data().applyUpdate(update.c_updateChatDefaultBannedRights());
 	} break;
@@ -2425,7 +2484,7 @@ void Updates::feedUpdate(const MTPUpdate &update) {
 		if (const auto channel = session().data().channelLoaded(d.vchannel_id())) {
 			const auto pts = d.vpts();
 			if (!pts || channel->pts() < pts->v) {
-				getChannelDifference(channel);
+				queueChannelCatchUp(channel);
 			}
 		}
 	} break;
@@ -122,6 +122,9 @@ private:
 		const MTP::Error &error);
 	void failDifferenceStartTimerFor(ChannelData *channel);
 	void feedChannelDifference(const MTPDupdates_channelDifference &data);
+	void queueChannelCatchUp(not_null<ChannelData*> channel);
+	void sendChannelCatchUp();
+	void finishChannelCatchUp(not_null<ChannelData*> channel);
 
 	void mtpUpdateReceived(const MTPUpdates &updates);
 	void mtpNewSessionCreated();
@@ -199,6 +202,10 @@ private:
 		not_null<ChannelData*>,
 		mtpRequestId> _rangeDifferenceRequests;
 
+	// Channels waiting for getChannelDifference after updateChannelTooLong.
+	std::vector<not_null<ChannelData*>> _channelCatchUp;
+	base::flat_set<not_null<ChannelData*>> _channelCatchUpRunning;
+
 	crl::time _lastUpdateTime = 0;
 	bool _handlingChannelDifference = false;
 
@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "api/api_views.h"
 
 #include "apiwrap.h"
+#include "data/data_message_reactions.h"
 #include "data/data_peer.h"
 #include "data/data_peer_id.h"
 #include "data/data_session.h"
@@ -23,13 +24,31 @@ constexpr auto kSendViewsTimeout = crl::time(1000);
 constexpr auto kPollExtendedMediaPeriod = 30 * crl::time(1000);
 constexpr auto kMaxPollPerRequest = 100;
 
+// Collect what was painted in the same frames into the same requests,
+// so that they leave together in a single container.
+constexpr auto kRefreshGroupDelay = crl::time(100);
+constexpr auto kMaxRefreshRequests = 8;
+
+[[nodiscard]] crl::time RefreshDelay(RefreshKind kind, bool forced) {
+	return forced
+		? crl::time(1)
+		: (kind == RefreshKind::ExtendedMedia)
+		? kPollExtendedMediaPeriod
+		: kRefreshGroupDelay;
+}
+
+[[nodiscard]] int RefreshLimit(RefreshKind kind) {
+	// There is no batched method for poll results.
+	return (kind == RefreshKind::PollResults) ? 1 : kMaxPollPerRequest;
+}
+
 } // namespace
 
 ViewsManager::ViewsManager(not_null<ApiWrap*> api)
 : _session(&api->session())
 , _api(&api->instance())
 , _incrementTimer([=] { viewsIncrement(); })
-, _pollTimer([=] { sendPollRequests(); }) {
+, _refreshTimer([=] { sendRefreshRequests(); }) {
 }
 
 void ViewsManager::scheduleIncrement(not_null<HistoryItem*> item) {
@@ -55,33 +74,47 @@ void ViewsManager::removeIncremented(not_null<PeerData*> peer) {
 	_incremented.remove(peer);
 }
 
-void ViewsManager::pollExtendedMedia(
+void ViewsManager::scheduleRefresh(
 		not_null<HistoryItem*> item,
+		RefreshKind kind,
 		bool force) {
 	if (!item->isRegular()) {
 		return;
 	}
 	const auto id = item->id;
-	const auto peer = item->history()->peer;
-	auto &request = _pollRequests[peer];
-	if (request.ids.contains(id) || request.sent.contains(id)) {
-		if (!force || request.forced) {
-			return;
-		}
+	const auto now = crl::now();
+	auto &request = _refreshRequests[RefreshKey{
+		item->history()->peer,
+		kind,
+		(kind == RefreshKind::PollResults) ? id : MsgId(),
+	}];
+	const auto i = request.ids.find(id);
+	if (i != end(request.ids)) {
+		i->second = now;
+	}
+	const auto known = (i != end(request.ids)) || request.sent.contains(id);
+	if (known && (!force || request.forced)) {
+		return;
 	}
-	request.ids.emplace(id);
+	request.ids[id] = now;
 	if (force) {
 		request.forced = true;
 	}
-	const auto delay = force ? 1 : kPollExtendedMediaPeriod;
-	if (!request.id && (!request.when || force)) {
-		request.when = crl::now() + delay;
+	const auto when = now + RefreshDelay(kind, force);
+	if (!request.requestId && (!request.when || request.when > when)) {
+		request.when = when;
 	}
-	if (!_pollTimer.isActive() || force) {
-		_pollTimer.callOnce(delay);
+	if (!request.requestId) {
+		scheduleRefreshRequests(request.when);
 	}
 }
 
+void ViewsManager::pollExtendedMedia(
+		not_null<HistoryItem*> item,
+		bool force) {
+	scheduleRefresh(item, RefreshKind::ExtendedMedia, force);
+}
+
 void ViewsManager::viewsIncrement() {
 	for (auto i = _toIncrement.begin(); i != _toIncrement.cend();) {
 		if (_incrementRequests.contains(i->first)) {
@@ -111,88 +144,133 @@ void ViewsManager::viewsIncrement() {
 	}
 }
 
-void ViewsManager::sendPollRequests() {
+void ViewsManager::scheduleRefreshRequests(crl::time when) {
+	const auto left = std::max(when - crl::now(), crl::time(1));
+	if (!_refreshTimer.isActive() || _refreshTimer.remainingTime() > left) {
+		_refreshTimer.callOnce(left);
+	}
+}
+
+void ViewsManager::sendRefreshRequests() {
 	const auto now = crl::now();
-	auto toRequest = base::flat_map<not_null<PeerData*>, QVector<MTPint>>();
+	auto due = std::vector<std::pair<crl::time, RefreshKey>>();
+	auto sending = 0;
 	auto nearest = crl::time();
-	for (auto &[peer, request] : _pollRequests) {
-		if (request.id) {
+	for (const auto &[key, request] : _refreshRequests) {
+		if (request.requestId) {
+			++sending;
+		} else if (request.ids.empty()) {
 			continue;
 		} else if (request.when <= now) {
-			Assert(request.sent.empty());
-			auto &list = toRequest[peer];
-			const auto count = int(request.ids.size());
-			if (count < kMaxPollPerRequest) {
-				request.sent = base::take(request.ids);
-			} else {
-				const auto from = begin(request.ids);
-				const auto end = from + kMaxPollPerRequest;
-				request.sent = { from, end };
-				request.ids.erase(from, end);
-			}
-			list.reserve(request.sent.size());
-			for (const auto &id : request.sent) {
-				list.push_back(MTP_int(id.bare));
-			}
-			if (!request.ids.empty()) {
-				nearest = now;
+			auto seen = crl::time();
+			for (const auto &[id, time] : request.ids) {
+				seen = std::max(seen, time);
 			}
+			due.emplace_back(seen, key);
 		} else if (!nearest || nearest > request.when) {
 			nearest = request.when;
 		}
 	}
-	sendPollRequests(toRequest);
+
+	// Peers with the items seen most recently go first, the rest wait
+	// for refreshDone() when there are too many requests already.
+	ranges::sort(due, ranges::greater());
+	for (const auto &[seen, key] : due) {
+		if (sending >= kMaxRefreshRequests) {
+			break;
+		}
+		sendRefreshRequest(key, _refreshRequests[key]);
+		++sending;
+	}
 	if (nearest) {
-		_pollTimer.callOnce(std::max(nearest - now, crl::time(1)));
+		scheduleRefreshRequests(nearest);
 	}
 }
 
-void ViewsManager::sendPollRequests(
-	const base::flat_map<
-		not_null<PeerData*>,
-		QVector<MTPint>> &batched) {
-	for (auto &[peer, list] : batched) {
-		const auto finish = [=, list = list](mtpRequestId id) {
-			const auto now = crl::now();
-			const auto owner = &_session->data();
-			for (auto i = begin(_pollRequests); i != end(_pollRequests);) {
-				if (i->second.id == id) {
-					const auto peer = i->first->id;
-					for (const auto &itemId : i->second.sent) {
-						if (const auto item = owner->message(peer, itemId)) {
-							owner->requestItemRepaint(item);
-						}
-					}
-					i->second.sent.clear();
-					i->second.id = 0;
-					if (i->second.ids.empty()) {
-						i = _pollRequests.erase(i);
-					} else {
-						const auto delay = i->second.forced
-							? 1
-							: kPollExtendedMediaPeriod;
-						i->second.when = now + delay;
-						if (!_pollTimer.isActive() || i->second.forced) {
-							_pollTimer.callOnce(delay);
-						}
-						++i;
-					}
-				} else {
-					++i;
-				}
-			}
-		};
-		const auto requestId = _api.request(MTPmessages_GetExtendedMedia(
-			peer->input,
-			MTP_vector<MTPint>(list)
-		)).done([=](const MTPUpdates &result, mtpRequestId id) {
+void ViewsManager::sendRefreshRequest(
+		RefreshKey key,
+		RefreshRequest &request) {
+	Expects(request.sent.empty());
+
+	const auto limit = RefreshLimit(std::get<RefreshKind>(key));
+	if (int(request.ids.size()) <= limit) {
+		for (const auto &[id, seen] : base::take(request.ids)) {
+			request.sent.emplace(id);
+		}
+	} else {
+		auto ordered = std::vector<std::pair<crl::time, MsgId>>();
+		ordered.reserve(request.ids.size());
+		for (const auto &[id, seen] : request.ids) {
+			ordered.emplace_back(seen, id);
+		}
+		const auto middle = begin(ordered) + limit;
+		ranges::nth_element(ordered, middle, ranges::greater());
+		for (auto i = begin(ordered); i != middle; ++i) {
+			request.sent.emplace(i->second);
+			request.ids.remove(i->second);
+		}
+	}
+	request.forced = false;
+
+	auto ids = QVector<MTPint>();
+	ids.reserve(request.sent.size());
+	for (const auto &id : request.sent) {
+		ids.push_back(MTP_int(id.bare));
+	}
+	const auto send = [&](auto &&data) {
+		return _api.request(
+			std::move(data)
+		).done([=](const MTPUpdates &result, mtpRequestId id) {
 			_session->api().applyUpdates(result);
-			finish(id);
+			refreshDone(key, id);
 		}).fail([=](const MTP::Error &error, mtpRequestId id) {
-			finish(id);
+			refreshDone(key, id);
 		}).send();
+	};
+	const auto &[peer, kind, pollItemId] = key;
+	request.requestId = (kind == RefreshKind::Reactions)
+		? send(MTPmessages_GetMessagesReactions(
+			peer->input,
+			MTP_vector<MTPint>(ids)))
+		: (kind == RefreshKind::ExtendedMedia)
+		? send(MTPmessages_GetExtendedMedia(
+			peer->input,
+			MTP_vector<MTPint>(ids)))
+		: send(MTPmessages_GetPollResults(peer->input, ids.front()));
+}
+
+void ViewsManager::refreshDone(RefreshKey key, mtpRequestId requestId) {
+	const auto i = _refreshRequests.find(key);
+	if (i == end(_refreshRequests) || i->second.requestId != requestId) {
+		return;
+	}
+	auto &request = i->second;
+	const auto sent = base::take(request.sent);
+	request.requestId = 0;
+	if (request.ids.empty()) {
+		_refreshRequests.erase(i);
+	} else {
+		request.when = crl::now()
+			+ RefreshDelay(std::get<RefreshKind>(key), request.forced);
+	}
+	refreshed(key, sent);
+	sendRefreshRequests();
+}
 
-		_pollRequests[peer].id = requestId;
+void ViewsManager::refreshed(
+		RefreshKey key,
+		const base::flat_set<MsgId> &ids) {
+	const auto &[peer, kind, pollItemId] = key;
+	const auto owner = &_session->data();
+	for (const auto &id : ids) {
+		const auto item = owner->message(peer->id, id);
+		if (!item) {
+			continue;
+		} else if (kind == RefreshKind::Reactions) {
+			owner->reactions().polled(item);
+		} else if (kind == RefreshKind::ExtendedMedia) {
+			owner->requestItemRepaint(item);
+		}
 	}
 }
 
@@ -19,6 +19,12 @@ class Session;
 
 namespace Api {
 
+enum class RefreshKind : uchar {
+	Reactions,
+	ExtendedMedia,
+	PollResults,
+};
+
 class ViewsManager final {
 public:
 	explicit ViewsManager(not_null<ApiWrap*> api);
@@ -26,23 +32,33 @@ public:
 	void scheduleIncrement(not_null<HistoryItem*> item);
 	void removeIncremented(not_null<PeerData*> peer);
 
+	// Called for the items being painted, so each call marks the item as
+	// seen. Refreshes of all kinds are grouped by peer and sent together,
+	// the most recently seen items go first. Poll results can't be
+	// batched, so they are requested for each poll separately.
+	void scheduleRefresh(
+		not_null<HistoryItem*> item,
+		RefreshKind kind,
+		bool force = false);
 	void pollExtendedMedia(not_null<HistoryItem*> item, bool force = false);
 
 private:
-	struct PollExtendedMediaRequest {
-		crl::time when = 0;
-		mtpRequestId id = 0;
-		base::flat_set<MsgId> ids;
+	struct RefreshRequest {
+		base::flat_map<MsgId, crl::time> ids; // With the time last seen.
 		base::flat_set<MsgId> sent;
+		crl::time when = 0;
+		mtpRequestId requestId = 0;
 		bool forced = false;
 	};
+	// With the message id only for RefreshKind::PollResults.
+	using RefreshKey = std::tuple<not_null<PeerData*>, RefreshKind, MsgId>;
 
 	void viewsIncrement();
-	void sendPollRequests();
-	void sendPollRequests(
-		const base::flat_map<
-			not_null<PeerData*>,
-			QVector<MTPint>> &prepared);
+	void scheduleRefreshRequests(crl::time when);
+	void sendRefreshRequests();
+	void sendRefreshRequest(RefreshKey key, RefreshRequest &request);
+	void refreshDone(RefreshKey key, mtpRequestId requestId);
+	void refreshed(RefreshKey key, const base::flat_set<MsgId> &ids);
 
 	void done(
 		QVector<MTPint> ids,
@@ -59,10 +75,8 @@ private:
 	base::flat_map<mtpRequestId, not_null<PeerData*>> _incrementByRequest;
 	base::Timer _incrementTimer;
 
-	base::flat_map<
-		not_null<PeerData*>,
-		PollExtendedMediaRequest> _pollRequests;
-	base::Timer _pollTimer;
+	base::flat_map<RefreshKey, RefreshRequest> _refreshRequests;
+	base::Timer _refreshTimer;
 
 };
 
@@ -19,6 +19,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "api/api_peer_colors.h"
 #include "api/api_peer_photo.h"
 #include "api/api_polls.h"
+#include "api/api_shared_requests.h"
+#include "api/api_statistics.h"
 #include "api/api_sending.h"
 #include "api/api_text_entities.h"
 #include "api/api_todo_lists.h"
@@ -95,6 +97,7 @@ namespace {
 constexpr auto kSaveCloudDraftTimeout = 1000;
 
 constexpr auto kSmallDelayMs = 5;
+constexpr auto kMessageDataBatchDelay = crl::time(20);
 constexpr auto kReadFeaturedSetsTimeout = crl::time(1000);
 constexpr auto kFileLoaderQueueStopTimeout = crl::time(5000);
 constexpr auto kStickersByEmojiInvalidateTimeout = crl::time(6 * 1000);
@@ -149,6 +152,11 @@ void ShowChannelsLimitBox(not_null<PeerData*> peer) {
 		: QString::number(seconds);
 }
 
+[[nodiscard]] int FileLoaderThreads() {
+	// Album items are read, hashed and recompressed in parallel.
+	return std::clamp(QThread::idealThreadCount() / 2, 1, 4);
+}
+
 } // namespace
 
 namespace Api {
@@ -162,12 +170,14 @@ TimeId UnixtimeFromMsgId(mtpMsgId msgId) {
 ApiWrap::ApiWrap(not_null<Main::Session*> session)
 : MTP::Sender(&session->account().mtp())
 , _session(session)
-, _messageDataResolveDelayed([=] { resolveMessageDatas(); })
+, _messageDataResolveTimer([=] { resolveMessageDatas(); })
 , _webPagesTimer([=] { resolveWebPages(); })
 , _draftsSaveTimer([=] { saveDraftsToCloud(); })
 , _featuredSetsReadTimer([=] { readFeaturedSets(); })
 , _dialogsLoadState(std::make_unique<DialogsLoadState>())
-, _fileLoader(std::make_unique<TaskQueue>(kFileLoaderQueueStopTimeout))
+, _fileLoader(std::make_unique<TaskQueue>(
+	kFileLoaderQueueStopTimeout,
+	FileLoaderThreads()))
 , _updateNotifyTimer([=] { sendNotifySettingsUpdates(); })
 , _statsSessionKillTimer([=] { checkStatsSessions(); })
 , _authorizations(std::make_unique<Api::Authorizations>(this))
@@ -184,6 +194,8 @@ ApiWrap::ApiWrap(not_null<Main::Session*> session)
 , _confirmPhone(std::make_unique<Api::ConfirmPhone>(this))
 , _peerPhoto(std::make_unique<Api::PeerPhoto>(this))
 , _polls(std::make_unique<Api::Polls>(this))
+, _sharedRequests(std::make_unique<Api::SharedRequests>(this))
+, _statisticsCache(std::make_unique<Api::StatisticsCache>())
 , _todoLists(std::make_unique<Api::TodoLists>(this))
 , _chatParticipants(std::make_unique<Api::ChatParticipants>(this))
 , _unreadThings(std::make_unique<Api::UnreadThings>(this))
@@ -572,8 +584,9 @@ void ApiWrap::requestMessageData(
 	if (done) {
 		requests.callbacks.push_back(std::move(done));
 	}
-	if (!requests.requestId) {
-		_messageDataResolveDelayed.call();
+	if (!requests.requestId && !_messageDataResolveTimer.isActive()) {
+		// Collect the ids asked for in a short window in one request.
+		_messageDataResolveTimer.callOnce(kMessageDataBatchDelay);
 	}
 }
 
@@ -3817,7 +3830,7 @@ void ApiWrap::sendFiles(
 				&& type != SendMediaType::File)
 			? SendMediaType::Photo
 			: SendMediaType::File;
-		tasks.push_back(std::make_unique<FileLoadTask>(
+		auto task = std::make_unique<FileLoadTask>(
 			&session(),
 			file.path,
 			file.content,
@@ -3839,7 +3852,9 @@ void ApiWrap::sendFiles(
 			to,
 			caption,
 			file.spoiler,
-			album));
+			album);
+		task->startEarlyUpload();
+		tasks.push_back(std::move(task));
 		caption = TextWithTags();
 	}
 	if (album) {
@@ -4944,6 +4959,14 @@ Api::Polls &ApiWrap::polls() {
 	return *_polls;
 }
 
+Api::SharedRequests &ApiWrap::sharedRequests() {
+	return *_sharedRequests;
+}
+
+Api::StatisticsCache &ApiWrap::statisticsCache() {
+	return *_statisticsCache;
+}
+
 Api::TodoLists &ApiWrap::todoLists() {
 	return *_todoLists;
 }
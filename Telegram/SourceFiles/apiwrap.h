@@ -77,6 +77,8 @@ class ConfirmPhone;
 class PeerPhoto;
 class PeerColors;
 class Polls;
+class SharedRequests;
+class StatisticsCache;
 class TodoLists;
 class ChatParticipants;
 class UnreadThings;
@@ -418,6 +420,8 @@ public:
 	[[nodiscard]] Api::ConfirmPhone &confirmPhone();
 	[[nodiscard]] Api::PeerPhoto &peerPhoto();
 	[[nodiscard]] Api::Polls &polls();
+	[[nodiscard]] Api::SharedRequests &sharedRequests();
+	[[nodiscard]] Api::StatisticsCache &statisticsCache();
 	[[nodiscard]] Api::TodoLists &todoLists();
 	[[nodiscard]] Api::ChatParticipants &chatParticipants();
 	[[nodiscard]] Api::UnreadThings &unreadThings();
@@ -613,7 +617,7 @@ private:
 	base::flat_map<
 		not_null<ChannelData*>,
 		MessageDataRequests> _channelMessageDataRequests;
-	SingleQueuedInvokation _messageDataResolveDelayed;
+	base::Timer _messageDataResolveTimer;
 
 	using PeerRequests = base::flat_map<PeerData*, mtpRequestId>;
 	PeerRequests _fullPeerRequests;
@@ -776,6 +780,8 @@ private:
 	const std::unique_ptr<Api::ConfirmPhone> _confirmPhone;
 	const std::unique_ptr<Api::PeerPhoto> _peerPhoto;
 	const std::unique_ptr<Api::Polls> _polls;
+	const std::unique_ptr<Api::SharedRequests> _sharedRequests;
+	const std::unique_ptr<Api::StatisticsCache> _statisticsCache;
 	const std::unique_ptr<Api::TodoLists> _todoLists;
 	const std::unique_ptr<Api::ChatParticipants> _chatParticipants;
 	const std::unique_ptr<Api::UnreadThings> _unreadThings;
@@ -19,6 +19,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/storage_account.h"
 #include "storage/cache/storage_cache_database.h"
 #include "data/data_session.h"
+#include "core/application.h"
+#include "core/core_settings.h"
 #include "lang/lang_keys.h"
 #include "main/main_session.h"
 #include "window/window_session_controller.h"
@@ -34,6 +36,8 @@ constexpr auto kMinimalSizeLimit = 100 * kMegabyte;
 constexpr auto kTimeLimitsCount = 16;
 constexpr auto kMaxTimeLimitValue = std::numeric_limits<size_type>::max();
 constexpr auto kFakeMediaCacheTag = uint16(0xFFFF);
+constexpr auto kResidentLimitsCount = 7;
+constexpr auto kMaxResidentLimitValue = std::numeric_limits<int>::max();
 
 int64 TotalSizeLimitInMB(int index) {
 	if (index < 8) {
@@ -110,6 +114,27 @@ QString TimeLimitText(size_type limit) {
 		: tr::lng_local_storage_limit_never(tr::now);
 }
 
+int ResidentLimit(int index) {
+	constexpr auto kLimits = std::array{
+		10'000,
+		20'000,
+		50'000,
+		100'000,
+		200'000,
+		500'000,
+	};
+	static_assert(kLimits.size() + 1 == kResidentLimitsCount);
+	return (index < int(kLimits.size()))
+		? kLimits[index]
+		: kMaxResidentLimitValue;
+}
+
+QString ResidentLimitText(int limit) {
+	return limit
+		? QString::number(limit)
+		: tr::lng_local_storage_messages_no_limit(tr::now);
+}
+
 size_type LimitToValue(size_type timeLimit) {
 	return timeLimit ? timeLimit : kMaxTimeLimitValue;
 }
@@ -279,6 +304,7 @@ LocalStorageBox::LocalStorageBox(
 	_totalSizeLimit = settings.totalSizeLimit + settingsBig.totalSizeLimit;
 	_mediaSizeLimit = settingsBig.totalSizeLimit;
 	_timeLimit = settings.totalTimeLimit;
+	_residentLimit = Core::App().settings().residentMessagesLimit();
 }
 
 void LocalStorageBox::Show(not_null<Window::SessionController*> controller) {
@@ -560,6 +586,32 @@ void LocalStorageBox::setupLimits(not_null<Ui::VerticalLayout*> container) {
 			label->setText(tr::lng_local_storage_time_limit(tr::now, lt_limit, text));
 			limitsChanged();
 		});
+
+	createLimitsSlider(
+		container,
+		kResidentLimitsCount,
+		ResidentLimit,
+		_residentLimit ? _residentLimit : kMaxResidentLimitValue,
+		[=](not_null<Ui::LabelSimple*> label, int limit) {
+			_residentLimit = (limit != kMaxResidentLimitValue) ? limit : 0;
+			const auto text = ResidentLimitText(_residentLimit);
+			label->setText(tr::lng_local_storage_messages_limit(
+				tr::now,
+				lt_limit,
+				text));
+			limitsChanged();
+		});
+
+	const auto reused = _session->data().reusedDownloadsSize();
+	if (reused > 0) {
+		const auto text = Ui::FormatSizeText(reused);
+		container->add(
+			object_ptr<Ui::LabelSimple>(
+				container,
+				st::localStorageLimitLabel,
+				tr::lng_local_storage_reused(tr::now, lt_size, text)),
+			st::localStorageLimitLabelMargin);
+	}
 }
 
 void LocalStorageBox::limitsChanged() {
@@ -569,7 +621,9 @@ void LocalStorageBox::limitsChanged() {
 	const auto changed = (settings.totalSizeLimit != sizeLimit)
 		|| (settingsBig.totalSizeLimit != _mediaSizeLimit)
 		|| (settings.totalTimeLimit != _timeLimit)
-		|| (settingsBig.totalTimeLimit != _timeLimit);
+		|| (settingsBig.totalTimeLimit != _timeLimit)
+		|| (Core::App().settings().residentMessagesLimit()
+			!= _residentLimit);
 	if (_limitsChanged != changed) {
 		_limitsChanged = changed;
 		clearButtons();
@@ -595,5 +649,9 @@ void LocalStorageBox::save() {
 	updateBig.totalTimeLimit = _timeLimit;
 	_session->local().updateCacheSettings(update, updateBig);
 	_session->data().cache().updateSettings(update);
+	if (Core::App().settings().residentMessagesLimit() != _residentLimit) {
+		Core::App().settings().setResidentMessagesLimit(_residentLimit);
+		Core::App().saveSettingsDelayed();
+	}
 	closeBox();
 }
@@ -101,6 +101,7 @@ private:
 	int64 _totalSizeLimit = 0;
 	int64 _mediaSizeLimit = 0;
 	size_type _timeLimit = 0;
+	int _residentLimit = 0;
 	bool _limitsChanged = false;
 
 };
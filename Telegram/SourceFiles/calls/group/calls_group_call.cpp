@@ -3390,6 +3390,9 @@ void GroupCall::updateRequestedVideoChannels() {
 			});
 			continue;
 		}
+		if (video->quality == Group::VideoQuality::None) {
+			continue;
+		}
 		const auto participant = real->participantByEndpoint(endpointId);
 		const auto params = (participant && participant->ssrc)
 			? participant->videoParams.get()
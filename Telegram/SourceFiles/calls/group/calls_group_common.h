@@ -139,6 +139,7 @@ enum class VideoQuality {
 	Thumbnail,
 	Medium,
 	Full,
+	None, // Scrolled out of view, not received at all.
 };
 
 enum class Error {
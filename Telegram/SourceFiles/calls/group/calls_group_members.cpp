@@ -151,6 +151,8 @@ private:
 	void removeRowFromSoundingMap(not_null<Row*> row);
 	void updateRowLevel(not_null<Row*> row, float level);
 	void checkRowPosition(not_null<Row*> row);
+	void applyRowsReorder();
+	void reorderRows(const base::flat_set<not_null<const PeerListRow*>> &rows);
 	[[nodiscard]] bool needToReorder(not_null<Row*> row) const;
 	[[nodiscard]] bool allRowsAboveAreSpeaking(not_null<Row*> row) const;
 	[[nodiscard]] bool allRowsAboveMoreImportantThanHand(
@@ -194,6 +196,8 @@ private:
 	not_null<QWidget*> _menuParent;
 	base::unique_qptr<Ui::PopupMenu> _menu;
 	base::flat_set<not_null<PeerData*>> _menuCheckRowsAfterHidden;
+	base::flat_set<not_null<PeerData*>> _reorderRowsPeers;
+	base::Timer _reorderRowsTimer;
 
 	base::flat_map<PeerListRowId, crl::time> _raisedHandStatusRemoveAt;
 	base::Timer _raisedHandStatusRemoveTimer;
@@ -229,6 +233,7 @@ Members::Controller::Controller(
 : _call(call)
 , _peer(call->peer())
 , _menuParent(menuParent)
+, _reorderRowsTimer([=] { applyRowsReorder(); })
 , _raisedHandStatusRemoveTimer([=] { scheduleRaisedHandStatusRemove(); })
 , _mode(mode)
 , _inactiveCrossLine(st::groupCallMemberInactiveCrossLine)
@@ -770,6 +775,32 @@ void Members::Controller::checkRowPosition(not_null<Row*> row) {
 	} else if (!needToReorder(row)) {
 		return;
 	}
+	// Speaking updates come in bursts in large calls, sort all at once.
+	_reorderRowsPeers.emplace(row->peer());
+	if (!_reorderRowsTimer.isActive()) {
+		_reorderRowsTimer.callOnce(0);
+	}
+}
+
+void Members::Controller::applyRowsReorder() {
+	auto rows = base::flat_set<not_null<const PeerListRow*>>();
+	for (const auto &peer : base::take(_reorderRowsPeers)) {
+		if (const auto row = findRow(peer)) {
+			if (_menu) {
+				_menuCheckRowsAfterHidden.emplace(peer);
+			} else if (needToReorder(row)) {
+				rows.emplace(row);
+			}
+		}
+	}
+	reorderRows(rows);
+}
+
+void Members::Controller::reorderRows(
+		const base::flat_set<not_null<const PeerListRow*>> &rows) {
+	if (rows.empty()) {
+		return;
+	}
 
 	// Someone started speaking and has a non-speaking row above him.
 	// Or someone raised hand and has force muted above him.
@@ -777,23 +808,24 @@ void Members::Controller::checkRowPosition(not_null<Row*> row) {
 	static constexpr auto kTop = std::numeric_limits<uint64>::max();
 	const auto projForAdmin = [&](const PeerListRow &other) {
 		const auto &real = static_cast<const Row&>(other);
+		const auto checked = rows.contains(&other);
 		return real.speaking()
-			// Speaking 'row' to the top, all other speaking below it.
-			? (&real == row.get() ? kTop : (kTop - 1))
+			// Speaking 'rows' to the top, all other speaking below them.
+			? (checked ? kTop : (kTop - 1))
 			: (real.raisedHandRating() > 0)
 			// Then all raised hands sorted by rating.
 			? real.raisedHandRating()
 			: (real.state() == Row::State::Muted)
-			// All force muted at the bottom, but 'row' still above others.
-			? (&real == row.get() ? 1ULL : 0ULL)
+			// All force muted at the bottom, but 'rows' still above others.
+			? (checked ? 1ULL : 0ULL)
 			// All not force-muted lie between raised hands and speaking.
 			: (kTop - 2);
 	};
 	const auto projForOther = [&](const PeerListRow &other) {
 		const auto &real = static_cast<const Row&>(other);
 		return real.speaking()
-			// Speaking 'row' to the top, all other speaking below it.
-			? (&real == row.get() ? kTop : (kTop - 1))
+			// Speaking 'rows' to the top, all other speaking below them.
+			? (rows.contains(&other) ? kTop : (kTop - 1))
 			: 0ULL;
 	};
 
@@ -1291,10 +1323,9 @@ void Members::Controller::showRowMenu(
 		}
 		auto saved = base::take(_menu);
 		for (const auto &peer : base::take(_menuCheckRowsAfterHidden)) {
-			if (const auto row = findRow(peer)) {
-				checkRowPosition(row);
-			}
+			_reorderRowsPeers.emplace(peer);
 		}
+		applyRowsReorder();
 		_menu = std::move(saved);
 	};
 	delegate()->peerListShowRowMenu(row, highlightRow, cleanup);
@@ -102,6 +102,17 @@ void Viewport::setup() {
 		updateTilesGeometry();
 	}, lifetime());
 
+	// Narrow tiles are laid out by width, the height only decides which
+	// of them are shown.
+	_content->heightValue(
+	) | rpl::filter([=] {
+		return !wide() && !videoStream();
+	}) | rpl::start_with_next([=] {
+		for (const auto &tile : _tiles) {
+			updateTileQuality(tile.get());
+		}
+	}, lifetime());
+
 	_content->events(
 	) | rpl::start_with_next([=](not_null<QEvent*> e) {
 		const auto type = e->type();
@@ -824,7 +835,11 @@ void Viewport::updateTilesGeometryColumn(int outerWidth) {
 
 void Viewport::setTileGeometry(not_null<VideoTile*> tile, QRect geometry) {
 	tile->setGeometry(geometry);
+	updateTileQuality(tile);
+}
 
+void Viewport::updateTileQuality(not_null<VideoTile*> tile) {
+	const auto geometry = tile->geometry();
 	const auto min = std::min(geometry.width(), geometry.height());
 	const auto kMedium = style::ConvertScale(540);
 	const auto kSmall = style::ConvertScale(240);
@@ -834,7 +849,12 @@ void Viewport::setTileGeometry(not_null<VideoTile*> tile, QRect geometry) {
 		&& (ranges::count(_tiles, false, &VideoTile::hidden) > 1);
 	const auto forceFullQuality = videoStream()
 		|| (wide() && (tile.get() == _large));
-	const auto quality = forceThumbnailQuality
+	const auto offscreen = !wide()
+		&& !videoStream()
+		&& !geometry.intersects(widget()->rect());
+	const auto quality = offscreen
+		? VideoQuality::None
+		: forceThumbnailQuality
 		? VideoQuality::Thumbnail
 		: (forceFullQuality || min >= kMedium)
 		? VideoQuality::Full
@@ -162,6 +162,7 @@ private:
 	void updateTilesGeometryNarrow(int outerWidth);
 	void updateTilesGeometryColumn(int outerWidth);
 	void setTileGeometry(not_null<VideoTile*> tile, QRect geometry);
+	void updateTileQuality(not_null<VideoTile*> tile);
 	void refreshHasTwoOrMore();
 	void updateTopControlsVisibility();
 
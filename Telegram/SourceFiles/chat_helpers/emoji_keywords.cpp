@@ -177,24 +177,35 @@ void AppendFoundEmoji(
 		std::vector<Result> &result,
 		const QString &label,
 		const std::vector<LangPackEmoji> &list) {
-	// It is important that the 'result' won't relocate while inserting.
 	result.reserve(result.size() + list.size());
-	const auto alreadyBegin = begin(result);
-	const auto alreadyEnd = alreadyBegin + result.size();
+	for (const auto &entry : list) {
+		result.push_back({ entry.emoji, label, entry.text });
+	}
+}
 
-	auto &&add = ranges::views::all(
-		list
-	) | ranges::views::filter([&](const LangPackEmoji &entry) {
-		const auto i = ranges::find(
-			alreadyBegin,
-			alreadyEnd,
-			entry.emoji,
-			&Result::emoji);
-		return (i == alreadyEnd);
-	}) | ranges::views::transform([&](const LangPackEmoji &entry) {
-		return Result{ entry.emoji, label, entry.text };
-	});
-	result.insert(end(result), add.begin(), add.end());
+// Short prefixes match thousands of keywords, so the duplicates are
+// removed with one sort afterwards, keeping the first found of each.
+void RemoveDuplicateEmoji(std::vector<Result> &result) {
+	using Found = std::pair<EmojiPtr, int>;
+	auto found = std::vector<Found>();
+	found.reserve(result.size());
+	for (auto i = 0, count = int(result.size()); i != count; ++i) {
+		found.emplace_back(result[i].emoji, i);
+	}
+	ranges::sort(found);
+	found.erase(
+		ranges::unique(found, ranges::equal_to(), &Found::first),
+		end(found));
+	if (found.size() == result.size()) {
+		return;
+	}
+	ranges::sort(found, ranges::less(), &Found::second);
+	auto unique = std::vector<Result>();
+	unique.reserve(found.size());
+	for (const auto &[emoji, index] : found) {
+		unique.push_back(std::move(result[index]));
+	}
+	result = std::move(unique);
 }
 
 void AppendLegacySuggestions(
@@ -213,32 +224,16 @@ void AppendLegacySuggestions(
 	}
 
 	const auto suggestions = GetSuggestions(QStringToUTF16(query));
-
-	// It is important that the 'result' won't relocate while inserting.
-	result.reserve(result.size() + suggestions.size());
-	const auto alreadyBegin = begin(result);
-	const auto alreadyEnd = alreadyBegin + result.size();
-
-	auto &&add = ranges::views::all(
-		suggestions
-	) | ranges::views::transform([](const Suggestion &suggestion) {
-		return Result{
-			Find(QStringFromUTF16(suggestion.emoji())),
-			QStringFromUTF16(suggestion.label()),
-			QStringFromUTF16(suggestion.replacement())
-		};
-	}) | ranges::views::filter([&](const Result &entry) {
-		const auto i = entry.emoji
-			? ranges::find(
-				alreadyBegin,
-				alreadyEnd,
-				entry.emoji,
-				&Result::emoji)
-			: alreadyEnd;
-		return (entry.emoji != nullptr)
-			&& (i == alreadyEnd);
-	});
-	result.insert(end(result), add.begin(), add.end());
+	for (const auto &suggestion : suggestions) {
+		const auto emoji = Find(QStringFromUTF16(suggestion.emoji()));
+		if (emoji) {
+			result.push_back({
+				emoji,
+				QStringFromUTF16(suggestion.label()),
+				QStringFromUTF16(suggestion.replacement())
+			});
+		}
+	}
 }
 
 void ApplyDifference(
@@ -492,6 +487,7 @@ std::vector<Result> EmojiKeywords::LangPack::query(
 	for (const auto &[key, list] : chosen) {
 		AppendFoundEmoji(result, key, list);
 	}
+	RemoveDuplicateEmoji(result);
 	return result;
 }
 
@@ -614,30 +610,16 @@ std::vector<Result> EmojiKeywords::query(
 	}
 	auto result = std::vector<Result>();
 	for (const auto &[language, item] : _data) {
-		const auto list = item->query(normalized, exact);
-
-		// It is important that the 'result' won't relocate while inserting.
-		result.reserve(result.size() + list.size());
-		const auto alreadyBegin = begin(result);
-		const auto alreadyEnd = alreadyBegin + result.size();
-
-		auto &&add = ranges::views::all(
-			list
-		) | ranges::views::filter([&](Result entry) {
-			// In each item->query() result the list has no duplicates.
-			// So we need to check only for duplicates between queries.
-			const auto i = ranges::find(
-				alreadyBegin,
-				alreadyEnd,
-				entry.emoji,
-				&Result::emoji);
-			return (i == alreadyEnd);
-		});
-		result.insert(end(result), add.begin(), add.end());
+		auto list = item->query(normalized, exact);
+		result.insert(
+			end(result),
+			std::make_move_iterator(begin(list)),
+			std::make_move_iterator(end(list)));
 	}
 	if (!exact) {
 		AppendLegacySuggestions(result, query);
 	}
+	RemoveDuplicateEmoji(result);
 	return result;
 }
 
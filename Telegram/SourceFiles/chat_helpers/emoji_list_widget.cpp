@@ -761,12 +761,12 @@ void EmojiListWidget::appendPremiumSearchResults() {
 			_searchResults.push_back(recent);
 		}
 	}
-	for (const auto &set : _custom) {
-		for (const auto &one : set.list) {
+	for (auto &set : _custom) {
+		for (auto &one : set.list) {
 			const auto id = one.document->id;
 			if (checkCustom(one.emoji, id)) {
 				_searchResults.push_back({
-					.custom = one.custom,
+					.custom = resolveCustom(set, one),
 					.id = { RecentEmojiDocument{ .id = id, .test = test } },
 				});
 			}
@@ -913,7 +913,9 @@ void EmojiListWidget::unloadCustomIn(const SectionInfo &info) {
 	}
 	custom.painted = false;
 	for (const auto &single : custom.list) {
-		single.custom->unload();
+		if (const auto emoji = single.custom) {
+			emoji->unload();
+		}
 	}
 }
 
@@ -1639,7 +1641,7 @@ void EmojiListWidget::drawCustom(
 	_emojiPaintContext->position = position
 		+ _innerPosition
 		+ _customPosition;
-	entry.custom->paint(p, *_emojiPaintContext);
+	resolveCustom(custom, entry)->paint(p, *_emojiPaintContext);
 }
 
 bool EmojiListWidget::checkPickerHide() {
@@ -2386,7 +2388,6 @@ void EmojiListWidget::refreshCustom() {
 				continue;
 			} else if (const auto sticker = document->sticker()) {
 				set.push_back({
-					.custom = resolveCustomEmoji(id, document, lookupId),
 					.document = document,
 					.emoji = Ui::Emoji::Find(sticker->alt),
 				});
@@ -2470,6 +2471,20 @@ not_null<Ui::Text::CustomEmoji*> EmojiListWidget::resolveCustomEmoji(
 	).first->second.emoji.get();
 }
 
+not_null<Ui::Text::CustomEmoji*> EmojiListWidget::resolveCustom(
+		const CustomSet &set,
+		CustomOne &one) {
+	// Installed sets may hold thousands of emoji, only the painted ones
+	// get their instances, so the panel opens without creating them all.
+	if (!one.custom) {
+		one.custom = resolveCustomEmoji(
+			EmojiStatusId{ one.document->id },
+			one.document,
+			set.set->id);
+	}
+	return one.custom;
+}
+
 Ui::Text::CustomEmoji *EmojiListWidget::resolveCustomRecent(
 		RecentEmojiId customId) {
 	const auto &data = customId.data;
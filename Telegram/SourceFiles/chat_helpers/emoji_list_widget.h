@@ -193,7 +193,7 @@ private:
 	};
 	struct CustomOne {
 		std::shared_ptr<Data::EmojiStatusCollectible> collectible;
-		not_null<Ui::Text::CustomEmoji*> custom;
+		Ui::Text::CustomEmoji *custom = nullptr; // Resolved when painted.
 		not_null<DocumentData*> document;
 		EmojiPtr emoji = nullptr;
 	};
@@ -391,6 +391,9 @@ private:
 		EmojiStatusId id,
 		not_null<DocumentData*> document,
 		uint64 setId);
+	[[nodiscard]] not_null<Ui::Text::CustomEmoji*> resolveCustom(
+		const CustomSet &set,
+		CustomOne &one);
 	[[nodiscard]] Ui::Text::CustomEmoji *resolveCustomRecent(
 		Core::RecentEmojiId customId);
 	[[nodiscard]] not_null<Ui::Text::CustomEmoji*> resolveCustomRecent(
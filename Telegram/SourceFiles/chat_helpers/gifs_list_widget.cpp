@@ -34,6 +34,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "boxes/send_gif_with_caption_box.h"
 #include "boxes/stickers_box.h"
 #include "inline_bots/inline_bot_result.h"
+#include "inline_bots/inline_results_cache.h"
 #include "storage/localstorage.h"
 #include "lang/lang_keys.h"
 #include "layout/layout_position.h"
@@ -894,6 +895,7 @@ void GifsListWidget::searchForGifs(const QString &query) {
 		} else {
 			_inlineNextQuery = query;
 			_inlineRequestTimer.start(kSearchRequestDelay);
+			loadLocalResults(query);
 		}
 	}
 
@@ -916,6 +918,31 @@ void GifsListWidget::searchForGifs(const QString &query) {
 	}
 }
 
+void GifsListWidget::loadLocalResults(const QString &query) {
+	const auto bot = _searchBot;
+	const auto peer = _inlineQueryPeer;
+	if (!bot || !peer) {
+		return;
+	}
+	const auto done = [=](const MTPmessages_BotResults &result) {
+		if (_searchBot != bot
+			|| _inlineQueryPeer != peer
+			|| _inlineNextQuery != query
+			|| _inlineRequestId
+			|| _inlineCache.contains(query)) {
+			return;
+		}
+		_inlineRequestTimer.stop();
+		_inlineQuery = query;
+		inlineResultsDone(result);
+	};
+	session().inlineResultsCache().load(
+		bot,
+		peer,
+		query,
+		crl::guard(this, done));
+}
+
 void GifsListWidget::cancelled() {
 	_cancelled.fire({});
 }
@@ -948,6 +975,9 @@ void GifsListWidget::sendInlineRequest() {
 		}
 	}
 
+	const auto bot = not_null(_searchBot);
+	const auto peer = not_null(_inlineQueryPeer);
+	const auto query = _inlineQuery;
 	_search->setLoading(true);
 	_inlineRequestId = _api.request(MTPmessages_GetInlineBotResults(
 		MTP_flags(0),
@@ -956,7 +986,10 @@ void GifsListWidget::sendInlineRequest() {
 		MTPInputGeoPoint(),
 		MTP_string(_inlineQuery),
 		MTP_string(nextOffset)
-	)).done([this](const MTPmessages_BotResults &result) {
+	)).done([=](const MTPmessages_BotResults &result) {
+		if (nextOffset.isEmpty()) {
+			session().inlineResultsCache().store(bot, peer, query, result);
+		}
 		inlineResultsDone(result);
 	}).fail([this] {
 		// show error?
@@ -10,6 +10,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #ifndef TDESKTOP_DISABLE_SPELLCHECK
 
 #include "base/platform/base_platform_info.h"
+#include "base/timer.h"
 #include "base/zlib_help.h"
 #include "data/data_session.h"
 #include "lang/lang_instance.h"
@@ -40,6 +41,10 @@ constexpr auto kExceptions = {
 	"\xd0\xa2\xd0\xb5\xd0\xbb\xd0\xb5\xd0\xb3\xd1\x80\xd0\xb0\xd0\xbc"_cs,
 };
 
+// Dictionaries are toggled one by one in the manage box, reload them
+// once when the choice settles instead of after every toggle.
+constexpr auto kUpdateLanguagesDelay = crl::time(500);
+
 constexpr auto kLangsForLWC = { QLocale::English, QLocale::Portuguese };
 constexpr auto kDefaultCountries = { QLocale::UnitedStates, QLocale::Brazil };
 
@@ -375,7 +380,14 @@ void Start(not_null<Main::Session*> session) {
 	const auto settings = &Core::App().settings();
 	auto &lifetime = session->lifetime();
 
+	const auto updateTimer = lifetime.make_state<base::Timer>([=] {
+		if (settings->spellcheckerEnabled()) {
+			Platform::Spellchecker::UpdateLanguages(
+				settings->dictionariesEnabled());
+		}
+	});
 	const auto onEnabled = [=](auto enabled) {
+		updateTimer->cancel();
 		Platform::Spellchecker::UpdateLanguages(
 			enabled
 				? settings->dictionariesEnabled()
@@ -400,8 +412,8 @@ void Start(not_null<Main::Session*> session) {
 	Spellchecker::SetWorkingDirPath(DictionariesPath());
 
 	settings->dictionariesEnabledChanges(
-	) | rpl::start_with_next([](auto dictionaries) {
-		Platform::Spellchecker::UpdateLanguages(dictionaries);
+	) | rpl::start_with_next([=] {
+		updateTimer->callOnce(kUpdateLanguagesDelay);
 	}, lifetime);
 
 	settings->spellcheckerEnabledChanges(
@@ -186,6 +186,11 @@ std::shared_ptr<LargeEmojiImage> EmojiPack::image(EmojiPtr emoji) {
 		return result;
 	}
 	auto result = std::make_shared<LargeEmojiImage>();
+	i->second = result;
+	if (cHeadless()) {
+		// The emoji image loader is not started, nothing is painted.
+		return result;
+	}
 	const auto raw = result.get();
 	const auto weak = base::make_weak(_session);
 	raw->load = [=] {
@@ -209,7 +214,6 @@ std::shared_ptr<LargeEmojiImage> EmojiPack::image(EmojiPtr emoji) {
 		});
 		raw->load = nullptr;
 	};
-	i->second = result;
 	return result;
 }
 
@@ -66,6 +66,11 @@ constexpr auto kOfficialLoadLimit = 40;
 constexpr auto kMinRepaintDelay = crl::time(33);
 constexpr auto kMinAfterScrollDelay = crl::time(33);
 
+// Up to this many playing animated stickers are repainted at full rate,
+// with more of them each set gets proportionally fewer frames.
+constexpr auto kFullRateAnimations = 20;
+constexpr auto kMaxRepaintDelay = crl::time(100);
+
 using Data::StickersSet;
 using Data::StickersPack;
 using Data::StickersSetThumbnailView;
@@ -932,6 +937,12 @@ void StickersListWidget::paintStickers(Painter &p, QRect clip) {
 	const auto now = crl::now();
 	const auto paused = On(PowerSaving::kStickersPanel)
 		|| this->paused();
+	const auto countAnimations = clip.contains(QRect(
+		0,
+		getVisibleTop(),
+		width(),
+		getVisibleBottom() - getVisibleTop()));
+	auto animations = 0;
 	if (sets.empty() && _section == Section::Search) {
 		paintEmptySearchResults(p);
 	}
@@ -1120,6 +1131,9 @@ void StickersListWidget::paintStickers(Painter &p, QRect clip) {
 				auto selected = selectedSticker ? (selectedSticker->section == info.section && selectedSticker->index == index) : false;
 				auto deleteSelected = selected && selectedSticker->overDelete;
 				paintSticker(p, set, info.rowsTop, info.section, index, now, paused, selected, deleteSelected);
+				if (set.stickers[index].lottie) {
+					++animations;
+				}
 			}
 		}
 		if (!paused) {
@@ -1127,6 +1141,9 @@ void StickersListWidget::paintStickers(Painter &p, QRect clip) {
 		}
 		return true;
 	});
+	if (countAnimations) {
+		_shownAnimationsCount = animations;
+	}
 }
 
 void StickersListWidget::markLottieFrameShown(Set &set) {
@@ -1372,7 +1389,7 @@ void StickersListWidget::updateSet(const SectionInfo &info) {
 	const auto now = crl::now();
 	const auto delay = std::max(
 		_lastScrolledAt + kMinAfterScrollDelay - now,
-		set.lastUpdateTime + kMinRepaintDelay - now);
+		set.lastUpdateTime + setRepaintDelay() - now);
 	if (delay <= 0) {
 		repaintItems(info, now);
 	} else {
@@ -1384,6 +1401,15 @@ void StickersListWidget::updateSet(const SectionInfo &info) {
 	}
 }
 
+crl::time StickersListWidget::setRepaintDelay() const {
+	// Frames are requested only after the shown ones are painted, so
+	// the rarer repaints throttle the rendering of all sets together.
+	return std::clamp(
+		kMinRepaintDelay * _shownAnimationsCount / kFullRateAnimations,
+		kMinRepaintDelay,
+		kMaxRepaintDelay);
+}
+
 void StickersListWidget::repaintItems(
 		const SectionInfo &info,
 		crl::time now) {
@@ -309,6 +309,7 @@ private:
 	void updateSets();
 	void repaintItems(crl::time now = 0);
 	void updateSet(const SectionInfo &info);
+	[[nodiscard]] crl::time setRepaintDelay() const;
 	void repaintItems(
 		const SectionInfo &info,
 		crl::time now);
@@ -395,6 +396,7 @@ private:
 	bool _showingSetById = false;
 	crl::time _lastScrolledAt = 0;
 	crl::time _lastFullUpdatedAt = 0;
+	int _shownAnimationsCount = 0;
 
 	mtpRequestId _officialRequestId = 0;
 	int _officialOffset = 0;
@@ -304,7 +304,9 @@ void Application::run() {
 	Ui::Emoji::Init();
 	Ui::PreloadTextSpoilerMask();
 	startShortcuts();
-	startEmojiImageLoader();
+	if (!cHeadless()) {
+		startEmojiImageLoader();
+	}
 	startSystemDarkModeViewer();
 	Media::Player::start(_audio.get());
 
@@ -388,20 +390,26 @@ void Application::run() {
 	DEBUG_LOG(("Application Info: window created..."));
 
 	startDomain();
-	startTray();
+	if (cHeadless()) {
+		// Only the MCP server is used, the window is created for the
+		// sessions to live in but is never shown.
+		DEBUG_LOG(("Application Info: headless, not showing."));
+	} else {
+		startTray();
 
-	_lastActivePrimaryWindow->firstShow();
+		_lastActivePrimaryWindow->firstShow();
 
-	startMediaView();
+		startMediaView();
 
-	DEBUG_LOG(("Application Info: showing."));
-	_lastActivePrimaryWindow->finishFirstShow();
+		DEBUG_LOG(("Application Info: showing."));
+		_lastActivePrimaryWindow->finishFirstShow();
 
-	if (!_lastActivePrimaryWindow->locked() && cStartToSettings()) {
-		_lastActivePrimaryWindow->showSettings();
-	}
+		if (!_lastActivePrimaryWindow->locked() && cStartToSettings()) {
+			_lastActivePrimaryWindow->showSettings();
+		}
 
-	_lastActivePrimaryWindow->updateIsActiveFocus();
+		_lastActivePrimaryWindow->updateIsActiveFocus();
+	}
 
 	for (const auto &error : Shortcuts::Errors()) {
 		LOG(("Shortcuts Error: %1").arg(error));
@@ -436,13 +444,26 @@ void Application::run() {
 	}
 	fflush(stderr);
 
-	bool hasMcpFlag = args.contains(u"--mcp"_q);
+	bool hasMcpFlag = args.contains(u"--mcp"_q) || cHeadless();
 	fprintf(stderr, "[MCP] --mcp flag detected: %s\n", hasMcpFlag ? "YES" : "NO");
 	fflush(stderr);
 
 	if (hasMcpFlag) {
+		// --mcp-http[=port] serves streamable HTTP + SSE instead of stdio.
+		auto transport = MCP::TransportType::Stdio;
 		_mcpServer = std::make_unique<MCP::Server>();
-		if (_mcpServer->start(MCP::TransportType::Stdio)) {
+		for (const auto &arg : args) {
+			if (arg == u"--mcp-http"_q) {
+				transport = MCP::TransportType::HTTP;
+			} else if (arg.startsWith(u"--mcp-http="_q)) {
+				transport = MCP::TransportType::HTTP;
+				const auto port = arg.mid(11).toInt();
+				if (port > 0) {
+					_mcpServer->setHttpPort(port);
+				}
+			}
+		}
+		if (_mcpServer->start(transport)) {
 			DEBUG_LOG(("MCP: Server started successfully"));
 
 			// Subscribe to domain's active session changes
@@ -242,7 +242,8 @@ QByteArray Settings::serialize() const {
 		+ Serialize::bytearraySize(_tonsiteStorageToken)
 		+ sizeof(qint32) * 8
 		+ sizeof(ushort)
-		+ sizeof(qint32); // _notificationsDisplayChecksum
+		+ sizeof(qint32) // _notificationsDisplayChecksum
+		+ sizeof(qint32); // _residentMessagesLimit
 
 	auto result = QByteArray();
 	result.reserve(size);
@@ -406,7 +407,8 @@ QByteArray Settings::serialize() const {
 			<< qint32(_systemDarkModeEnabled.current() ? 1 : 0)
 			<< qint32(_quickDialogAction)
 			<< _notificationsVolume
-			<< _notificationsDisplayChecksum;
+			<< _notificationsDisplayChecksum
+			<< qint32(_residentMessagesLimit);
 	}
 
 	Ensures(result.size() == size);
@@ -538,6 +540,7 @@ void Settings::addFromSerialized(const QByteArray &serialized) {
 	quint32 chatFiltersHorizontal = _chatFiltersHorizontal.current() ? 1 : 0;
 	quint32 quickDialogAction = quint32(_quickDialogAction);
 	ushort notificationsVolume = _notificationsVolume;
+	qint32 residentMessagesLimit = _residentMessagesLimit;
 
 	stream >> themesAccentColors;
 	if (!stream.atEnd()) {
@@ -875,6 +878,9 @@ void Settings::addFromSerialized(const QByteArray &serialized) {
 	if (!stream.atEnd()) {
 		stream >> notificationsDisplayChecksum;
 	}
+	if (!stream.atEnd()) {
+		stream >> residentMessagesLimit;
+	}
 	if (stream.status() != QDataStream::Ok) {
 		LOG(("App Error: "
 			"Bad data for Core::Settings::constructFromSerialized()"));
@@ -1099,6 +1105,7 @@ void Settings::addFromSerialized(const QByteArray &serialized) {
 	_chatFiltersHorizontal = (chatFiltersHorizontal == 1);
 	_quickDialogAction = Dialogs::Ui::QuickDialogAction(quickDialogAction);
 	_notificationsVolume = notificationsVolume;
+	_residentMessagesLimit = std::max(residentMessagesLimit, 0);
 }
 
 QString Settings::getSoundPath(const QString &key) const {
@@ -1492,6 +1499,7 @@ void Settings::resetOnLastLogout() {
 	_chatFiltersHorizontal = false;
 	_quickDialogAction = Dialogs::Ui::QuickDialogAction::Disabled;
 	_notificationsVolume = 100;
+	_residentMessagesLimit = kDefaultResidentMessagesLimit;
 
 	_recentEmojiPreload.clear();
 	_recentEmoji.clear();
@@ -117,6 +117,7 @@ public:
 	};
 
 	static constexpr auto kDefaultVolume = 0.9;
+	static constexpr auto kDefaultResidentMessagesLimit = 100'000;
 
 	Settings();
 	~Settings();
@@ -963,6 +964,14 @@ public:
 		_notificationsVolume = value;
 	}
 
+	// Loaded messages kept in all histories together, zero for no limit.
+	[[nodiscard]] int residentMessagesLimit() const {
+		return _residentMessagesLimit;
+	}
+	void setResidentMessagesLimit(int value) {
+		_residentMessagesLimit = value;
+	}
+
 	void resetOnLastLogout();
 
 private:
@@ -1108,6 +1117,7 @@ private:
 		= Dialogs::Ui::QuickDialogAction::Disabled;
 
 	ushort _notificationsVolume = 100;
+	int _residentMessagesLimit = kDefaultResidentMessagesLimit;
 
 	QByteArray _photoEditorBrush;
 
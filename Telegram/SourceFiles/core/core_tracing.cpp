@@ -0,0 +1,340 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "core/core_tracing.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+
+#include <chrono>
+#include <optional>
+
+namespace Core::Tracing {
+namespace details {
+
+std::atomic<bool> Capturing = false;
+std::atomic<bool> Attributing = false;
+
+} // namespace details
+namespace {
+
+struct Event {
+	const char *category = nullptr;
+	const char *name = nullptr;
+	int64 start = 0;
+	int64 duration = 0;
+	qint64 id = 0;
+	QString detail;
+};
+
+// Each thread appends to its own buffer, its mutex is only contended
+// while Stop() collects the events.
+struct ThreadBuffer {
+	QMutex mutex;
+	std::vector<Event> events;
+	int generation = 0;
+	int tid = 0;
+	QString name;
+};
+
+struct State {
+	QMutex mutex;
+	std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+	std::atomic<int> generation = 0;
+	std::atomic<int> recorded = 0;
+	std::atomic<int> dropped = 0;
+	int limit = 0;
+	int64 started = 0;
+	QString path;
+};
+
+struct Label {
+	const char *category = nullptr;
+	const char *name = nullptr;
+	qint64 id = 0;
+	QString detail;
+};
+
+// Written by the main thread only, read by the watchdog while it stalls.
+struct MainStack {
+	QMutex mutex;
+	std::vector<Label> labels;
+};
+
+[[nodiscard]] MainStack &Main() {
+	static auto result = MainStack();
+	return result;
+}
+
+[[nodiscard]] bool OnMain() {
+	// Unknown until the application is created.
+	thread_local auto result = std::optional<bool>();
+	if (!result) {
+		if (const auto app = QCoreApplication::instance()) {
+			result = (QThread::currentThread() == app->thread());
+		} else {
+			return false;
+		}
+	}
+	return *result;
+}
+
+[[nodiscard]] QString Component(const Label &label) {
+	auto result = QString::fromLatin1(label.category)
+		+ '/'
+		+ QString::fromLatin1(label.name);
+	if (!label.detail.isEmpty()) {
+		result += ' ' + label.detail;
+	}
+	return result;
+}
+
+[[nodiscard]] State &Instance() {
+	static auto result = State();
+	return result;
+}
+
+[[nodiscard]] ThreadBuffer &CurrentBuffer() {
+	thread_local auto buffer = [] {
+		auto result = std::make_shared<ThreadBuffer>();
+		const auto thread = QThread::currentThread();
+		const auto app = QCoreApplication::instance();
+		result->name = (app && thread == app->thread())
+			? u"main"_q
+			: thread->objectName();
+
+		auto &state = Instance();
+		QMutexLocker lock(&state.mutex);
+		result->tid = int(state.buffers.size()) + 1;
+		if (result->name.isEmpty()) {
+			result->name = u"thread %1"_q.arg(result->tid);
+		}
+		state.buffers.push_back(result);
+		return result;
+	}();
+	return *buffer;
+}
+
+[[nodiscard]] QByteArray Serialize(
+		const Event &event,
+		int64 origin,
+		qint64 pid,
+		int tid) {
+	auto result = QJsonObject{
+		{ "name", QString::fromLatin1(event.name) },
+		{ "cat", QString::fromLatin1(event.category) },
+		{ "ph", u"X"_q },
+		{ "ts", double(event.start - origin) },
+		{ "dur", double(event.duration) },
+		{ "pid", pid },
+		{ "tid", tid },
+	};
+	if (event.id || !event.detail.isEmpty()) {
+		auto args = QJsonObject();
+		if (event.id) {
+			args.insert(u"id"_q, QString::number(event.id));
+		}
+		if (!event.detail.isEmpty()) {
+			args.insert(u"detail"_q, event.detail);
+		}
+		result.insert(u"args"_q, args);
+	}
+	return QJsonDocument(result).toJson(QJsonDocument::Compact);
+}
+
+} // namespace
+
+namespace details {
+
+int64 Now() {
+	using namespace std::chrono;
+	const auto now = steady_clock::now().time_since_epoch();
+	const auto result = int64(duration_cast<microseconds>(now).count());
+	return std::max(result, int64(1));
+}
+
+void Record(
+		const char *category,
+		const char *name,
+		int64 start,
+		int64 finish,
+		qint64 id,
+		const QString &detail) {
+	if (!Capturing.load(std::memory_order_relaxed)) {
+		return;
+	}
+	auto &state = Instance();
+	if (state.recorded.fetch_add(1, std::memory_order_relaxed)
+			>= state.limit) {
+		state.recorded.fetch_sub(1, std::memory_order_relaxed);
+		state.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	auto &buffer = CurrentBuffer();
+	const auto generation = state.generation.load(std::memory_order_acquire);
+	QMutexLocker lock(&buffer.mutex);
+	if (buffer.generation != generation) {
+		buffer.generation = generation;
+		buffer.events.clear();
+	}
+	buffer.events.push_back({
+		.category = category,
+		.name = name,
+		.start = start,
+		.duration = finish - start,
+		.id = id,
+		.detail = detail,
+	});
+}
+
+bool Push(
+		const char *category,
+		const char *name,
+		qint64 id,
+		const QString &detail) {
+	if (!OnMain()) {
+		return false;
+	}
+	auto &stack = Main();
+	QMutexLocker lock(&stack.mutex);
+	stack.labels.push_back({
+		.category = category,
+		.name = name,
+		.id = id,
+		.detail = detail,
+	});
+	return true;
+}
+
+void Pop() {
+	auto &stack = Main();
+	QMutexLocker lock(&stack.mutex);
+	if (!stack.labels.empty()) {
+		stack.labels.pop_back();
+	}
+}
+
+} // namespace details
+
+bool Start(const QString &path, int limit) {
+	auto &state = Instance();
+	QMutexLocker lock(&state.mutex);
+	if (Capturing()) {
+		return false;
+	}
+	state.path = path.isEmpty() ? DefaultPath() : path;
+	state.limit = std::max(limit, 1);
+	state.recorded = 0;
+	state.dropped = 0;
+	state.started = details::Now();
+	state.generation.fetch_add(1, std::memory_order_release);
+	details::Capturing = true;
+	return true;
+}
+
+CaptureResult Stop() {
+	auto &state = Instance();
+	QMutexLocker lock(&state.mutex);
+	if (!Capturing()) {
+		return {};
+	}
+	details::Capturing = false;
+
+	auto result = CaptureResult{
+		.path = state.path,
+		.dropped = state.dropped.load(),
+		.duration = (details::Now() - state.started) / 1000,
+	};
+	auto file = QFile(state.path);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		LOG(("Tracing Error: could not open '%1' for writing."
+			).arg(state.path));
+		return result;
+	}
+	const auto pid = QCoreApplication::applicationPid();
+	const auto generation = state.generation.load();
+	auto separator = QByteArray("\n");
+	file.write("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	for (const auto &buffer : state.buffers) {
+		auto events = std::vector<Event>();
+		{
+			QMutexLocker lock(&buffer->mutex);
+			if (buffer->generation != generation) {
+				continue;
+			}
+			events = base::take(buffer->events);
+		}
+		if (events.empty()) {
+			continue;
+		}
+		const auto name = QJsonObject{
+			{ "name", u"thread_name"_q },
+			{ "ph", u"M"_q },
+			{ "pid", pid },
+			{ "tid", buffer->tid },
+			{ "args", QJsonObject{ { "name", buffer->name } } },
+		};
+		file.write(separator);
+		file.write(QJsonDocument(name).toJson(QJsonDocument::Compact));
+		separator = ",\n";
+		for (const auto &event : events) {
+			file.write(separator);
+			file.write(Serialize(event, state.started, pid, buffer->tid));
+		}
+		result.events += int(events.size());
+	}
+	file.write("\n]}\n");
+	result.written = file.error() == QFileDevice::NoError;
+	return result;
+}
+
+QString DefaultPath() {
+	return QDir::temp().filePath(u"tdesktop_trace_%1.json"_q.arg(
+		QDateTime::currentDateTime().toString(u"yyyyMMdd_hhmmss"_q)));
+}
+
+int RecordedCount() {
+	return Instance().recorded.load(std::memory_order_relaxed);
+}
+
+void SetAttributing(bool enabled) {
+	details::Attributing = enabled;
+	if (!enabled) {
+		auto &stack = Main();
+		QMutexLocker lock(&stack.mutex);
+		stack.labels.clear();
+	}
+}
+
+MainThreadScopes CurrentMainThreadScopes() {
+	auto &stack = Main();
+	QMutexLocker lock(&stack.mutex);
+	if (stack.labels.empty()) {
+		return {};
+	}
+	auto result = MainThreadScopes{
+		.component = Component(stack.labels.front()),
+	};
+	for (const auto &label : stack.labels) {
+		if (!result.stack.isEmpty()) {
+			result.stack += u" > "_q;
+		}
+		result.stack += Component(label);
+		if (label.id) {
+			result.stack += u" #%1"_q.arg(label.id);
+		}
+	}
+	return result;
+}
+
+} // namespace Core::Tracing
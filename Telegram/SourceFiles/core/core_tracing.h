@@ -0,0 +1,125 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <atomic>
+
+namespace Core::Tracing {
+
+namespace details {
+
+extern std::atomic<bool> Capturing;
+extern std::atomic<bool> Attributing;
+
+[[nodiscard]] int64 Now(); // Monotonic microseconds, never zero.
+void Record(
+	const char *category,
+	const char *name,
+	int64 start,
+	int64 finish,
+	qint64 id,
+	const QString &detail);
+
+// Only scopes of the main thread are pushed, Push() returns false for
+// the others.
+[[nodiscard]] bool Push(
+	const char *category,
+	const char *name,
+	qint64 id,
+	const QString &detail);
+void Pop();
+
+} // namespace details
+
+[[nodiscard]] inline bool Capturing() {
+	return details::Capturing.load(std::memory_order_relaxed);
+}
+
+// A complete event for the lifetime of the object while a capture runs,
+// one relaxed atomic load otherwise. Category and name must be literals.
+class Scope final {
+public:
+	Scope(const char *category, const char *name)
+	: Scope(category, name, 0, QString()) {
+	}
+	Scope(const char *category, const char *name, qint64 id)
+	: Scope(category, name, id, QString()) {
+	}
+	Scope(const char *category, const char *name, const QString &detail)
+	: Scope(category, name, 0, detail) {
+	}
+	Scope(const Scope &other) = delete;
+	Scope &operator=(const Scope &other) = delete;
+	~Scope() {
+		if (_pushed) {
+			details::Pop();
+		}
+		if (_start) {
+			details::Record(
+				_category,
+				_name,
+				_start,
+				details::Now(),
+				_id,
+				_detail);
+		}
+	}
+
+private:
+	Scope(
+		const char *category,
+		const char *name,
+		qint64 id,
+		const QString &detail)
+	: _category(category)
+	, _name(name)
+	, _start(Capturing() ? details::Now() : 0)
+	, _id(id)
+	, _pushed(details::Attributing.load(std::memory_order_relaxed)
+		&& details::Push(category, name, id, detail)) {
+		if (_start) {
+			_detail = detail;
+		}
+	}
+
+	const char *_category = nullptr;
+	const char *_name = nullptr;
+	int64 _start = 0;
+	qint64 _id = 0;
+	QString _detail;
+	bool _pushed = false;
+
+};
+
+struct CaptureResult {
+	QString path;
+	int events = 0;
+	int dropped = 0; // Past the limit given to Start().
+	crl::time duration = 0;
+	bool written = false;
+};
+
+// Events of all threads are kept in memory until Stop() writes them in
+// the Chrome trace event format, which ui.perfetto.dev opens as well.
+bool Start(const QString &path, int limit);
+CaptureResult Stop();
+
+[[nodiscard]] QString DefaultPath();
+[[nodiscard]] int RecordedCount();
+
+// While enabled the scopes open on the main thread are kept, so that
+// a watchdog can tell what the main thread is busy with.
+void SetAttributing(bool enabled);
+
+struct MainThreadScopes {
+	QString component; // "category/name detail" of the outermost scope.
+	QString stack; // All of them, the outermost first.
+};
+[[nodiscard]] MainThreadScopes CurrentMainThreadScopes();
+
+} // namespace Core::Tracing
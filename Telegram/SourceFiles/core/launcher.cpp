@@ -61,13 +61,12 @@ FilteredCommandLineArguments::FilteredCommandLineArguments(
 		pushArgument(argv[i]);
 	}
 
-	// Preserve --mcp flag if present (for MCP server integration)
+	// Preserve --mcp flags if present (for MCP server integration)
 	for (auto i = 1; i < argc; ++i) {
-		if (std::strcmp(argv[i], "--mcp") == 0) {
-			pushArgument("--mcp");
-			fprintf(stderr, "[MCP] FilteredCommandLineArguments: Preserved --mcp flag\n");
+		if (std::strncmp(argv[i], "--mcp", 5) == 0) {
+			pushArgument(argv[i]);
+			fprintf(stderr, "[MCP] FilteredCommandLineArguments: Preserved %s flag\n", argv[i]);
 			fflush(stderr);
-			break;
 		}
 	}
 
@@ -550,6 +549,7 @@ void Launcher::processArguments() {
 		{ "-noupdate"       , KeyFormat::NoValues },
 		{ "-tosettings"     , KeyFormat::NoValues },
 		{ "-startintray"    , KeyFormat::NoValues },
+		{ "-headless"       , KeyFormat::NoValues },
 		{ "-quit"           , KeyFormat::NoValues },
 		{ "-workdir"        , KeyFormat::OneValue },
 		{ "--"              , KeyFormat::AllLeftValues },
@@ -598,6 +598,7 @@ void Launcher::processArguments() {
 	gNoStartUpdate = parseResult.contains("-noupdate");
 	gStartToSettings = parseResult.contains("-tosettings");
 	gStartInTray = parseResult.contains("-startintray");
+	gHeadless = parseResult.contains("-headless");
 	gQuit = parseResult.contains("-quit");
 	_customWorkingDir = parseResult.value("-workdir", {}).join(QString());
 	if (!_customWorkingDir.isEmpty()) {
@@ -634,6 +635,10 @@ void Launcher::processArguments() {
 
 int Launcher::executeApplication() {
 	FilteredCommandLineArguments arguments(_argc, _argv);
+	if (cHeadless() && qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+		// Servers running only the MCP server usually have no display.
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+	}
 	Sandbox sandbox(arguments.count(), arguments.values());
 	Ui::MainQueueProcessor processor;
 	base::ConcurrentTimerEnvironment environment;
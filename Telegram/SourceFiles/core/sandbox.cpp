@@ -21,6 +21,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/local_url_handlers.h"
 #include "core/update_checker.h"
 #include "core/deadlock_detector.h"
+#include "core/stall_detector.h"
 #include "base/timer.h"
 #include "base/concurrent_timer.h"
 #include "base/invoke_queued.h"
@@ -35,6 +36,12 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <QtGui/qpa/qplatformscreen.h>
 
 namespace Core {
+namespace {
+
+// Main thread event loop delays above it are logged as stalls.
+constexpr auto kStallThreshold = crl::time(50);
+
+} // namespace
 
 bool Sandbox::QuitOnStartRequested = false;
 
@@ -174,6 +181,8 @@ void Sandbox::launchApplication() {
 			_deadlockDetector = std::make_unique<PingThread>(this);
 		}
 #endif // !_DEBUG
+		_stallDetector = std::make_unique<StallDetector::WatchThread>(
+			kStallThreshold);
 
 		_application = std::make_unique<Application>();
 
@@ -0,0 +1,182 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "core/stall_detector.h"
+
+#include "core/core_tracing.h"
+
+#include <condition_variable>
+#include <mutex>
+
+namespace Core::StallDetector {
+namespace {
+
+// A ping is posted this long after the previous one was answered.
+constexpr auto kPingInterval = crl::time(100);
+constexpr auto kRecentStalls = 16;
+
+struct State {
+	std::mutex mutex;
+	std::condition_variable changed;
+	int64 posted = 0;
+	int64 answered = 0;
+	bool stopping = false;
+	bool running = false;
+	crl::time threshold = 0;
+
+	int stalls = 0;
+	crl::time total = 0;
+	crl::time longest = 0;
+	base::flat_map<QString, Component> components;
+	std::deque<Stall> recent;
+};
+
+[[nodiscard]] State &Instance() {
+	static auto result = State();
+	return result;
+}
+
+void Ping(int64 posted) {
+	crl::on_main([=] {
+		auto &state = Instance();
+		{
+			std::lock_guard lock(state.mutex);
+			if (state.posted != posted) {
+				return;
+			}
+			state.answered = Tracing::details::Now();
+		}
+		state.changed.notify_all();
+	});
+}
+
+void Register(
+		int64 started,
+		int64 finished,
+		const Tracing::MainThreadScopes &scopes) {
+	const auto duration = (finished - started) / 1000;
+	LOG(("Stall: main thread event loop was blocked for %1 ms in %2."
+		).arg(duration
+		).arg(scopes.stack.isEmpty() ? u"(unattributed)"_q : scopes.stack));
+	Tracing::details::Record(
+		"stall",
+		"main thread",
+		started,
+		finished,
+		0,
+		scopes.stack);
+
+	auto &state = Instance();
+	std::lock_guard lock(state.mutex);
+	++state.stalls;
+	state.total += duration;
+	state.longest = std::max(state.longest, duration);
+
+	auto &component = state.components[scopes.component];
+	component.name = scopes.component;
+	++component.count;
+	component.total += duration;
+	component.longest = std::max(component.longest, duration);
+
+	state.recent.push_back({
+		.when = QDateTime::currentDateTime(),
+		.duration = duration,
+		.stack = scopes.stack,
+	});
+	if (int(state.recent.size()) > kRecentStalls) {
+		state.recent.pop_front();
+	}
+}
+
+} // namespace
+
+WatchThread::WatchThread(crl::time threshold) {
+	Expects(threshold > 0);
+
+	auto &state = Instance();
+	{
+		std::lock_guard lock(state.mutex);
+		Assert(!state.running);
+
+		state.running = true;
+		state.stopping = false;
+		state.threshold = threshold;
+	}
+	Tracing::SetAttributing(true);
+	start();
+}
+
+WatchThread::~WatchThread() {
+	auto &state = Instance();
+	{
+		std::lock_guard lock(state.mutex);
+		state.stopping = true;
+	}
+	state.changed.notify_all();
+	wait();
+
+	Tracing::SetAttributing(false);
+	std::lock_guard lock(state.mutex);
+	state.running = false;
+}
+
+void WatchThread::run() {
+	using namespace std::chrono;
+
+	auto &state = Instance();
+	auto lock = std::unique_lock(state.mutex);
+	const auto threshold = milliseconds(state.threshold);
+	const auto answered = [&] {
+		return state.stopping || state.answered;
+	};
+	while (!state.stopping) {
+		const auto posted = Tracing::details::Now();
+		state.posted = posted;
+		state.answered = 0;
+		Ping(posted);
+
+		if (!state.changed.wait_for(lock, threshold, answered)) {
+			// Take the scopes while the main thread is still inside them.
+			lock.unlock();
+			const auto scopes = Tracing::CurrentMainThreadScopes();
+			lock.lock();
+
+			state.changed.wait(lock, answered);
+			if (state.stopping) {
+				break;
+			}
+			const auto finished = state.answered;
+			lock.unlock();
+			Register(posted, finished, scopes);
+			lock.lock();
+		}
+		state.changed.wait_for(lock, milliseconds(kPingInterval), [&] {
+			return state.stopping;
+		});
+	}
+}
+
+Stats Collect() {
+	auto &state = Instance();
+	std::lock_guard lock(state.mutex);
+	auto result = Stats{
+		.running = state.running,
+		.threshold = state.threshold,
+		.stalls = state.stalls,
+		.total = state.total,
+		.longest = state.longest,
+		.recent = { begin(state.recent), end(state.recent) },
+	};
+	result.components.reserve(state.components.size());
+	for (const auto &[name, component] : state.components) {
+		result.components.push_back(component);
+	}
+	ranges::sort(result.components, std::greater<>(), &Component::total);
+	return result;
+}
+
+} // namespace Core::StallDetector
@@ -0,0 +1,53 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <QtCore/QDateTime>
+#include <QtCore/QThread>
+
+namespace Core::StallDetector {
+
+struct Stall {
+	QDateTime when;
+	crl::time duration = 0;
+	QString stack; // Main thread trace scopes, empty if none was open.
+};
+
+struct Component {
+	QString name; // Outermost trace scope, empty for unattributed stalls.
+	int count = 0;
+	crl::time total = 0;
+	crl::time longest = 0;
+};
+
+struct Stats {
+	bool running = false;
+	crl::time threshold = 0;
+	int stalls = 0;
+	crl::time total = 0;
+	crl::time longest = 0;
+	std::vector<Component> components; // By total duration, longest first.
+	std::vector<Stall> recent; // Newest last.
+};
+
+// Pings the main thread event loop and measures how long each ping
+// waits. Pings waiting longer than the threshold are logged as stalls,
+// attributed to the Core::Tracing scopes open on the main thread.
+class WatchThread final : public QThread {
+public:
+	explicit WatchThread(crl::time threshold);
+	~WatchThread();
+
+protected:
+	void run() override;
+
+};
+
+[[nodiscard]] Stats Collect();
+
+} // namespace Core::StallDetector
@@ -17,6 +17,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/application.h"
 #include "core/changelogs.h"
 #include "core/click_handler_types.h"
+#include "core/update_delta.h"
 #include "mainwindow.h"
 #include "main/main_account.h"
 #include "main/main_session.h"
@@ -101,17 +102,22 @@ public:
 	rpl::producer<std::shared_ptr<Loader>> ready() const;
 	rpl::producer<> failed() const;
 
+	// Full package to load if the delta one from ready() can't be used.
+	QString fallbackUrl() const;
+
 	rpl::lifetime &lifetime();
 
 	virtual ~Checker() = default;
 
 protected:
 	bool testing() const;
+	void setFallbackUrl(const QString &url);
 	void done(std::shared_ptr<Loader> result);
 	void fail();
 
 private:
 	bool _testing = false;
+	QString _fallbackUrl;
 	rpl::event_stream<std::shared_ptr<Loader>> _ready;
 	rpl::event_stream<> _failed;
 
@@ -122,6 +128,7 @@ private:
 struct Implementation {
 	std::unique_ptr<Checker> checker;
 	std::shared_ptr<Loader> loader;
+	QString fallbackUrl;
 	bool failed = false;
 
 };
@@ -138,10 +145,14 @@ private:
 	void gotResponse();
 	void gotFailure(QNetworkReply::NetworkError e);
 	void clearSentRequest();
+	struct Links {
+		QString full;
+		QString delta;
+	};
+
 	bool handleResponse(const QByteArray &response);
-	std::optional<QString> parseOldResponse(
-		const QByteArray &response) const;
-	std::optional<QString> parseResponse(const QByteArray &response) const;
+	std::optional<Links> parseOldResponse(const QByteArray &response) const;
+	std::optional<Links> parseResponse(const QByteArray &response) const;
 	QString validateLatestUrl(
 		uint64 availableVersion,
 		bool isAvailableAlpha,
@@ -269,6 +280,47 @@ QString ExtractFilename(const QString &url) {
 	return QString();
 }
 
+#ifndef TDESKTOP_DISABLE_AUTOUPDATE
+// Where the file with the name from the update package is installed.
+QString InstalledFilePath(const QString &relativeName) {
+#ifdef Q_OS_MAC
+	const auto slash = relativeName.indexOf('/');
+	return (slash > 0)
+		? (cExeDir() + cExeName() + relativeName.mid(slash))
+		: QString();
+#elif defined Q_OS_UNIX // Q_OS_MAC
+	return cExeDir() + ((relativeName == u"Telegram"_q)
+		? cExeName()
+		: relativeName);
+#else // Q_OS_MAC || Q_OS_UNIX
+	return cExeDir() + relativeName;
+#endif // Q_OS_MAC || Q_OS_UNIX
+}
+
+QByteArray CountSha1(const QByteArray &data) {
+	const auto result = hashSha1(data.constData(), data.size());
+	return QByteArray(result.data(), result.size());
+}
+
+// The installed file, if it is the one the delta package was made for.
+std::optional<QByteArray> ReadDeltaBase(
+		const QString &relativeName,
+		const QByteArray &baseSha1) {
+	const auto basePath = InstalledFilePath(relativeName);
+	QFile baseFile(basePath);
+	if (basePath.isEmpty() || !baseFile.open(QIODevice::ReadOnly)) {
+		LOG(("Update Error: cant read delta base file '%1'").arg(basePath));
+		return std::nullopt;
+	}
+	auto result = baseFile.readAll();
+	if (CountSha1(result) != baseSha1) {
+		LOG(("Update Error: bad SHA1 hash of delta base file '%1'").arg(basePath));
+		return std::nullopt;
+	}
+	return result;
+}
+#endif // !TDESKTOP_DISABLE_AUTOUPDATE
+
 bool UnpackUpdate(const QString &filepath) {
 #ifndef TDESKTOP_DISABLE_AUTOUPDATE
 	QFile input(filepath);
@@ -439,6 +491,23 @@ bool UnpackUpdate(const QString &filepath) {
 			LOG(("Update Error: cant read files count from downloaded stream, status: %1").arg(stream.status()));
 			return false;
 		}
+		const auto delta = (filesCount & UpdateDelta::kPackageFlag) != 0;
+		if (delta) {
+			filesCount &= ~UpdateDelta::kPackageFlag;
+
+			quint32 baseVersion = 0;
+			stream >> baseVersion;
+			if (stream.status() != QDataStream::Ok) {
+				LOG(("Update Error: cant read delta base version from downloaded stream, status: %1").arg(stream.status()));
+				return false;
+			}
+			if (version == 0x7FFFFFFF
+				|| cAlphaVersion()
+				|| int32(baseVersion) != AppVersion) {
+				LOG(("Update Error: delta update from version %1 can't be applied to %2").arg(baseVersion).arg(AppVersion));
+				return false;
+			}
+		}
 		if (!filesCount) {
 			LOG(("Update Error: update is empty!"));
 			return false;
@@ -449,10 +518,55 @@ bool UnpackUpdate(const QString &filepath) {
 			QByteArray fileInnerData;
 			bool executable = false;
 
-			stream >> relativeName >> fileSize >> fileInnerData;
+			stream >> relativeName >> fileSize;
+			if (delta) {
+				QByteArray resultSha1, baseSha1;
+				quint8 kind = 0;
+				stream >> resultSha1 >> kind;
+				if (kind != quint8(UpdateDelta::FileKind::Full)) {
+					stream >> baseSha1;
+				}
+				if (kind != quint8(UpdateDelta::FileKind::Same)) {
+					stream >> fileInnerData;
+				}
 #ifndef Q_OS_WIN
-			stream >> executable;
+				stream >> executable;
 #endif // !Q_OS_WIN
+				if (stream.status() != QDataStream::Ok) {
+					LOG(("Update Error: cant read delta file from downloaded stream, status: %1").arg(stream.status()));
+					return false;
+				}
+				if (kind == quint8(UpdateDelta::FileKind::Same)) {
+					// Keep the installed file as is, if it wasn't changed.
+					if (!ReadDeltaBase(relativeName, baseSha1)) {
+						return false;
+					}
+					continue;
+				} else if (kind == quint8(UpdateDelta::FileKind::Patch)) {
+					const auto base = ReadDeltaBase(relativeName, baseSha1);
+					if (!base) {
+						return false;
+					}
+					auto patched = UpdateDelta::Apply(*base, fileInnerData);
+					if (!patched) {
+						LOG(("Update Error: cant apply delta to file '%1'").arg(relativeName));
+						return false;
+					}
+					fileInnerData = std::move(*patched);
+				} else if (kind != quint8(UpdateDelta::FileKind::Full)) {
+					LOG(("Update Error: bad delta file kind %1").arg(int(kind)));
+					return false;
+				}
+				if (CountSha1(fileInnerData) != resultSha1) {
+					LOG(("Update Error: bad SHA1 hash of delta result file '%1'").arg(relativeName));
+					return false;
+				}
+			} else {
+				stream >> fileInnerData;
+#ifndef Q_OS_WIN
+				stream >> executable;
+#endif // !Q_OS_WIN
+			}
 			if (stream.status() != QDataStream::Ok) {
 				LOG(("Update Error: cant read file from downloaded stream, status: %1").arg(stream.status()));
 				return false;
@@ -637,6 +751,14 @@ bool Checker::testing() const {
 	return _testing;
 }
 
+QString Checker::fallbackUrl() const {
+	return _fallbackUrl;
+}
+
+void Checker::setFallbackUrl(const QString &url) {
+	_fallbackUrl = url;
+}
+
 void Checker::done(std::shared_ptr<Loader> result) {
 	_ready.fire(std::move(result));
 }
@@ -686,14 +808,21 @@ void HttpChecker::gotResponse() {
 }
 
 bool HttpChecker::handleResponse(const QByteArray &response) {
-	const auto handle = [&](const QString &url) {
-		done(url.isEmpty() ? nullptr : std::make_shared<HttpLoader>(url));
+	const auto handle = [&](const Links &links) {
+		if (links.full.isEmpty()) {
+			done(nullptr);
+		} else if (links.delta.isEmpty()) {
+			done(std::make_shared<HttpLoader>(links.full));
+		} else {
+			setFallbackUrl(links.full);
+			done(std::make_shared<HttpLoader>(links.delta));
+		}
 		return true;
 	};
-	if (const auto url = parseOldResponse(response)) {
-		return handle(*url);
-	} else if (const auto url = parseResponse(response)) {
-		return handle(*url);
+	if (const auto links = parseOldResponse(response)) {
+		return handle(*links);
+	} else if (const auto links = parseResponse(response)) {
+		return handle(*links);
 	}
 	return false;
 }
@@ -720,8 +849,8 @@ void HttpChecker::gotFailure(QNetworkReply::NetworkError e) {
 	fail();
 }
 
-std::optional<QString> HttpChecker::parseOldResponse(
-		const QByteArray &response) const {
+auto HttpChecker::parseOldResponse(
+		const QByteArray &response) const -> std::optional<Links> {
 	const auto string = QString::fromLatin1(response);
 	const auto old = QRegularExpression(
 		u"^\\s*(\\d+)\\s*:\\s*([\\x21-\\x7f]+)\\s*$"_q
@@ -732,17 +861,18 @@ std::optional<QString> HttpChecker::parseOldResponse(
 	const auto availableVersion = old.captured(1).toULongLong();
 	const auto url = old.captured(2);
 	const auto isAvailableAlpha = url.startsWith(qstr("beta_"));
-	return validateLatestUrl(
+	return Links{ .full = validateLatestUrl(
 		availableVersion,
 		isAvailableAlpha,
-		isAvailableAlpha ? url.mid(5) + "_{signature}" : url);
+		isAvailableAlpha ? url.mid(5) + "_{signature}" : url) };
 }
 
-std::optional<QString> HttpChecker::parseResponse(
-		const QByteArray &response) const {
+auto HttpChecker::parseResponse(
+		const QByteArray &response) const -> std::optional<Links> {
 	auto bestAvailableVersion = 0ULL;
 	auto bestIsAvailableAlpha = false;
 	auto bestLink = QString();
+	auto bestDeltaLink = QString();
 	const auto accumulate = [&](
 			uint64 version,
 			bool isAlpha,
@@ -760,16 +890,39 @@ std::optional<QString> HttpChecker::parseResponse(
 			return false;
 		}
 		bestLink = (*link).toString();
+
+		// Optional { "<installed version>": "<link>" } map of deltas.
+		bestDeltaLink = QString();
+		const auto delta = map.constFind("delta");
+		if (!isAlpha
+			&& !cAlphaVersion()
+			&& delta != map.constEnd()
+			&& (*delta).isObject()) {
+			const auto from = (*delta).toObject().value(
+				QString::number(AppVersion));
+			if (from.isString()) {
+				bestDeltaLink = from.toString();
+			}
+		}
 		return true;
 	};
 	const auto result = ParseCommonMap(response, testing(), accumulate);
 	if (!result) {
 		return std::nullopt;
 	}
-	return validateLatestUrl(
+	const auto full = validateLatestUrl(
 		bestAvailableVersion,
 		bestIsAvailableAlpha,
 		Local::readAutoupdatePrefix() + bestLink);
+	return Links{
+		.full = full,
+		.delta = ((full.isEmpty() || bestDeltaLink.isEmpty())
+			? QString()
+			: validateLatestUrl(
+				bestAvailableVersion,
+				bestIsAvailableAlpha,
+				Local::readAutoupdatePrefix() + bestDeltaLink)),
+	};
 }
 
 QString HttpChecker::validateLatestUrl(
@@ -1102,6 +1255,8 @@ private:
 		not_null<Implementation*> which,
 		std::shared_ptr<Loader> loader);
 	void checkerFail(not_null<Implementation*> which);
+	void startLoader(std::shared_ptr<Loader> loader);
+	bool tryFallback();
 
 	void finalize(QString filepath);
 	void unpackDone(bool ready);
@@ -1124,6 +1279,7 @@ private:
 	Implementation _httpImplementation;
 	Implementation _mtpImplementation;
 	std::shared_ptr<Loader> _activeLoader;
+	QString _fallbackUrl;
 	bool _usingMtprotoLoader = (cAlphaVersion() != 0);
 	base::weak_ptr<Main::Session> _session;
 
@@ -1235,6 +1391,7 @@ void Updater::stop() {
 	_httpImplementation = Implementation();
 	_mtpImplementation = Implementation();
 	_activeLoader = nullptr;
+	_fallbackUrl = QString();
 	_action = Action::Waiting;
 }
 
@@ -1317,6 +1474,7 @@ void Updater::startImplementation(
 void Updater::checkerDone(
 		not_null<Implementation*> which,
 		std::shared_ptr<Loader> loader) {
+	which->fallbackUrl = which->checker->fallbackUrl();
 	which->checker = nullptr;
 	which->loader = std::move(loader);
 
@@ -1366,24 +1524,9 @@ bool Updater::tryLoaders() {
 	_retryTimer.cancel();
 
 	const auto tryOne = [&](Implementation &which) {
-		_activeLoader = std::move(which.loader);
-		if (const auto loader = _activeLoader.get()) {
-			_action = Action::Loading;
-
-			loader->progress(
-			) | rpl::start_to_stream(_progress, loader->lifetime());
-			loader->ready(
-			) | rpl::start_with_next([=](QString &&filepath) {
-				finalize(std::move(filepath));
-			}, loader->lifetime());
-			loader->failed(
-			) | rpl::start_with_next([=] {
-				_failed.fire({});
-			}, loader->lifetime());
-
-			_retryTimer.callOnce(kUpdaterTimeout);
-			loader->wipeFolder();
-			loader->start();
+		if (which.loader) {
+			_fallbackUrl = std::move(which.fallbackUrl);
+			startLoader(std::move(which.loader));
 		} else {
 			_isLatest.fire({});
 		}
@@ -1404,6 +1547,45 @@ bool Updater::tryLoaders() {
 	return true;
 }
 
+void Updater::startLoader(std::shared_ptr<Loader> loader) {
+	_activeLoader = std::move(loader);
+	_action = Action::Loading;
+
+	const auto raw = _activeLoader.get();
+	raw->progress(
+	) | rpl::start_to_stream(_progress, raw->lifetime());
+	raw->ready(
+	) | rpl::start_with_next([=](QString &&filepath) {
+		finalize(std::move(filepath));
+	}, raw->lifetime());
+	raw->failed(
+	) | rpl::start_with_next([=] {
+		if (!tryFallback()) {
+			_failed.fire({});
+		}
+	}, raw->lifetime());
+
+	_retryTimer.callOnce(kUpdaterTimeout);
+	raw->wipeFolder();
+	raw->start();
+}
+
+bool Updater::tryFallback() {
+	if (_fallbackUrl.isEmpty()) {
+		return false;
+	}
+	LOG(("Update Info: delta update failed, loading the full one."));
+
+	// Not from inside the failed loader callbacks.
+	crl::on_main(this, [=, url = base::take(_fallbackUrl)] {
+		if (_action == Action::Loading || _action == Action::Unpacking) {
+			ClearAll();
+			startLoader(std::make_shared<HttpLoader>(url));
+		}
+	});
+	return true;
+}
+
 void Updater::finalize(QString filepath) {
 	if (_action != Action::Loading) {
 		return;
@@ -1424,7 +1606,9 @@ void Updater::unpackDone(bool ready) {
 		_ready.fire({});
 	} else {
 		ClearAll();
-		_failed.fire({});
+		if (!tryFallback()) {
+			_failed.fire({});
+		}
 	}
 }
 
@@ -0,0 +1,200 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "core/update_delta.h"
+
+#include <QtCore/QDataStream>
+
+#include <cstring>
+#include <vector>
+
+namespace Core::UpdateDelta {
+namespace {
+
+constexpr auto kMagic = quint32(0x544C4444U); // 'DDLT'
+constexpr auto kBlock = 16;
+constexpr auto kMinCopy = 32;
+constexpr auto kMultiplier = quint64(0x100000001B3ULL);
+
+enum class Op : quint8 {
+	End = 0,
+	Copy = 1,
+	Insert = 2,
+};
+
+[[nodiscard]] quint64 HashBlock(const char *data) {
+	auto result = quint64(0);
+	for (auto i = 0; i != kBlock; ++i) {
+		result = result * kMultiplier + quint8(data[i]);
+	}
+	return result;
+}
+
+[[nodiscard]] quint64 HighestPower() {
+	auto result = quint64(1);
+	for (auto i = 1; i != kBlock; ++i) {
+		result *= kMultiplier;
+	}
+	return result;
+}
+
+// Offsets of the kBlock-aligned base blocks by their hashes, the first
+// block wins a collision. Verified by comparing the bytes on lookup.
+class BlockIndex final {
+public:
+	explicit BlockIndex(const QByteArray &base) {
+		const auto blocks = base.size() / kBlock;
+		auto size = quint64(1);
+		while (size < quint64(blocks) * 2) {
+			size <<= 1;
+		}
+		_mask = size - 1;
+		_offsets.resize(size, 0);
+		for (auto i = 0; i != blocks; ++i) {
+			const auto offset = i * kBlock;
+			auto &slot = _offsets[HashBlock(base.constData() + offset) & _mask];
+			if (!slot) {
+				slot = quint32(offset) + 1;
+			}
+		}
+	}
+
+	[[nodiscard]] int find(quint64 hash) const {
+		return int(_offsets[hash & _mask]) - 1;
+	}
+
+private:
+	std::vector<quint32> _offsets;
+	quint64 _mask = 0;
+
+};
+
+} // namespace
+
+QByteArray Make(const QByteArray &base, const QByteArray &target) {
+	auto result = QByteArray();
+	QDataStream stream(&result, QIODevice::WriteOnly);
+	stream.setVersion(QDataStream::Qt_5_1);
+	stream << kMagic << quint32(target.size());
+
+	const auto insert = [&](int from, int till) {
+		if (till > from) {
+			stream
+				<< quint8(Op::Insert)
+				<< QByteArray::fromRawData(
+					target.constData() + from,
+					till - from);
+		}
+	};
+	const auto size = int(target.size());
+	auto pending = 0;
+	if (base.size() >= kBlock && size >= kBlock) {
+		const auto index = BlockIndex(base);
+		const auto power = HighestPower();
+		const auto data = target.constData();
+		auto position = 0;
+		auto hash = HashBlock(data);
+		while (true) {
+			auto copied = 0;
+			const auto offset = index.find(hash);
+			if (offset >= 0
+				&& !memcmp(base.constData() + offset, data + position, kBlock)) {
+				// Extend the match both ways.
+				auto from = offset;
+				auto start = position;
+				while (from > 0
+					&& start > pending
+					&& base[from - 1] == target[start - 1]) {
+					--from;
+					--start;
+				}
+				auto length = (position - start) + kBlock;
+				while (from + length < base.size()
+					&& start + length < size
+					&& base[from + length] == target[start + length]) {
+					++length;
+				}
+				if (length >= kMinCopy) {
+					insert(pending, start);
+					stream
+						<< quint8(Op::Copy)
+						<< quint32(from)
+						<< quint32(length);
+					pending = start + length;
+					copied = pending - position;
+				}
+			}
+			if (copied) {
+				position += copied;
+				if (position + kBlock > size) {
+					break;
+				}
+				hash = HashBlock(data + position);
+			} else {
+				if (position + kBlock >= size) {
+					break;
+				}
+				hash = (hash - quint8(data[position]) * power) * kMultiplier
+					+ quint8(data[position + kBlock]);
+				++position;
+			}
+		}
+	}
+	insert(pending, size);
+	stream << quint8(Op::End);
+	return result;
+}
+
+std::optional<QByteArray> Apply(
+		const QByteArray &base,
+		const QByteArray &patch) {
+	QDataStream stream(patch);
+	stream.setVersion(QDataStream::Qt_5_1);
+	auto magic = quint32();
+	auto size = quint32();
+	stream >> magic >> size;
+	if (stream.status() != QDataStream::Ok || magic != kMagic) {
+		return std::nullopt;
+	}
+	auto result = QByteArray();
+	result.reserve(int(size));
+	while (true) {
+		auto op = quint8();
+		stream >> op;
+		if (stream.status() != QDataStream::Ok) {
+			return std::nullopt;
+		} else if (op == quint8(Op::End)) {
+			break;
+		} else if (op == quint8(Op::Copy)) {
+			auto from = quint32();
+			auto length = quint32();
+			stream >> from >> length;
+			if (stream.status() != QDataStream::Ok
+				|| quint64(from) + length > quint64(base.size())
+				|| quint64(result.size()) + length > size) {
+				return std::nullopt;
+			}
+			result.append(base.constData() + from, int(length));
+		} else if (op == quint8(Op::Insert)) {
+			auto bytes = QByteArray();
+			stream >> bytes;
+			if (stream.status() != QDataStream::Ok
+				|| quint64(result.size()) + bytes.size() > size) {
+				return std::nullopt;
+			}
+			result.append(bytes);
+		} else {
+			return std::nullopt;
+		}
+	}
+	if (quint32(result.size()) != size) {
+		return std::nullopt;
+	}
+	return result;
+}
+
+} // namespace Core::UpdateDelta
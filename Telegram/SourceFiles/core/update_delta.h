@@ -0,0 +1,37 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <QtCore/QByteArray>
+
+#include <optional>
+
+// Used by the Packer as well, so only Qt Core and the standard library.
+namespace Core::UpdateDelta {
+
+// Kinds of the files in a delta update package.
+enum class FileKind : quint8 {
+	Full = 0,
+	Patch = 1,
+	Same = 2,
+};
+
+// Set in the files count of a delta update package.
+inline constexpr auto kPackageFlag = quint32(0x80000000U);
+
+// A list of copies from the base file and inserts of new bytes, which
+// turns the base file into the target one. The update package is lzma
+// compressed as a whole, so the inserted bytes are not compressed here.
+[[nodiscard]] QByteArray Make(const QByteArray &base, const QByteArray &target);
+
+// std::nullopt if the patch is malformed or doesn't fit the base file.
+[[nodiscard]] std::optional<QByteArray> Apply(
+	const QByteArray &base,
+	const QByteArray &patch);
+
+} // namespace Core::UpdateDelta
@@ -369,6 +369,9 @@ void Changes::scheduleNotifications() {
 void Changes::sendNotifications() {
 	if (!_notify) {
 		return;
+	} else if (_batchDepth > 0) {
+		_notifyAfterBatch = true;
+		return;
 	}
 	_notify = false;
 	_peerChanges.sendNotifications();
@@ -380,4 +383,28 @@ void Changes::sendNotifications() {
 	_storyChanges.sendNotifications();
 }
 
+Changes::Batch::Batch(not_null<Changes*> changes) : _changes(changes) {
+	++_changes->_batchDepth;
+}
+
+Changes::Batch::~Batch() {
+	Expects(_changes->_batchDepth > 0);
+
+	if (--_changes->_batchDepth > 0) {
+		return;
+	}
+	if (base::take(_changes->_notifyAfterBatch)) {
+		_changes->sendNotifications();
+	}
+	_changes->_batchFinished.fire({});
+}
+
+bool Changes::batching() const {
+	return (_batchDepth > 0);
+}
+
+rpl::producer<> Changes::batchFinished() const {
+	return _batchFinished.events();
+}
+
 } // namespace Data
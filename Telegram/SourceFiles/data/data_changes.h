@@ -403,6 +403,24 @@ public:
 
 	void sendNotifications();
 
+	// While a batch is alive the notifications asked to be sent right away
+	// are held and sent once, when the outermost batch ends. Realtime
+	// notifications are not delayed: their handlers rely on running
+	// before the change they watch is followed by the next one.
+	class Batch final {
+	public:
+		explicit Batch(not_null<Changes*> changes);
+		Batch(const Batch &other) = delete;
+		Batch &operator=(const Batch &other) = delete;
+		~Batch();
+
+	private:
+		const not_null<Changes*> _changes;
+
+	};
+	[[nodiscard]] bool batching() const;
+	[[nodiscard]] rpl::producer<> batchFinished() const;
+
 private:
 	template <typename DataType, typename UpdateType>
 	class Manager final {
@@ -455,7 +473,10 @@ private:
 	Manager<Story, StoryUpdate> _storyChanges;
 	rpl::event_stream<ChatAdminChange> _chatAdminChanges;
 
+	rpl::event_stream<> _batchFinished;
+	int _batchDepth = 0;
 	bool _notify = false;
+	bool _notifyAfterBatch = false;
 
 };
 
@@ -339,8 +339,17 @@ const base::flat_set<not_null<History*>> &ChatFilter::never() const {
 bool ChatFilter::contains(
 		not_null<History*> history,
 		bool ignoreFakeUnread) const {
-	const auto flag = [&] {
-		const auto peer = history->peer;
+	return contains(
+		history,
+		HistoryFlags(history, _flags, ignoreFakeUnread));
+}
+
+ChatFilter::Flags ChatFilter::HistoryFlags(
+		not_null<History*> history,
+		Flags rules,
+		bool ignoreFakeUnread) {
+	const auto peer = history->peer;
+	auto result = Flags([&] {
 		if (const auto user = peer->asUser()) {
 			return user->isBot()
 				? Flag::Bots
@@ -356,28 +365,46 @@ bool ChatFilter::contains(
 				return Flag::Groups;
 			}
 		} else {
-			Unexpected("Peer type in ChatFilter::contains.");
+			Unexpected("Peer type in ChatFilter::HistoryFlags.");
 		}
-	}();
+	}());
+	const auto state = (rules & (Flag::NoMuted | Flag::NoRead))
+		? history->chatListBadgesState()
+		: Dialogs::BadgesState();
+	const auto unarchived = history->folderKnown() && !history->folder();
+	if ((rules & Flag::NoMuted)
+		&& (!history->muted() || (state.mention && unarchived))) {
+		result |= Flag::NoMuted;
+	}
+	if ((rules & Flag::NoRead)
+		&& (state.unread
+			|| state.mention
+			|| (!ignoreFakeUnread && history->fakeUnreadWhileOpened()))) {
+		result |= Flag::NoRead;
+	}
+	if ((rules & Flag::NoArchived) && unarchived) {
+		result |= Flag::NoArchived;
+	}
+	return result;
+}
+
+bool ChatFilter::contains(
+		not_null<History*> history,
+		Flags historyFlags) const {
+	constexpr auto kTypes = Flag::Contacts
+		| Flag::NonContacts
+		| Flag::Groups
+		| Flag::Channels
+		| Flag::Bots;
+	constexpr auto kExcluding = Flag::NoMuted
+		| Flag::NoRead
+		| Flag::NoArchived;
 	if (_never.contains(history)) {
 		return false;
 	}
-	const auto state = (_flags & (Flag::NoMuted | Flag::NoRead))
-		? history->chatListBadgesState()
-		: Dialogs::BadgesState();
-	return false
-		|| ((_flags & flag)
-			&& (!(_flags & Flag::NoMuted)
-				|| !history->muted()
-				|| (state.mention
-					&& history->folderKnown()
-					&& !history->folder()))
-			&& (!(_flags & Flag::NoRead)
-				|| state.unread
-				|| state.mention
-				|| (!ignoreFakeUnread && history->fakeUnreadWhileOpened()))
-			&& (!(_flags & Flag::NoArchived)
-				|| (history->folderKnown() && !history->folder())))
+	const auto excluding = (_flags & kExcluding);
+	return ((_flags & historyFlags & kTypes)
+			&& ((historyFlags & excluding) == excluding))
 		|| _always.contains(history);
 }
 
@@ -731,9 +758,11 @@ bool ChatFilters::applyChange(ChatFilter &filter, ChatFilter &&updated) {
 				? false
 				: row->entry()->hasChatsFilterTags(0);
 		};
+		const auto rules = (filter.flags() | wasFilter.flags());
 		const auto feedHistory = [&](not_null<History*> history) {
-			const auto now = filter.contains(history);
-			const auto was = wasFilter.contains(history);
+			const auto flags = ChatFilter::HistoryFlags(history, rules);
+			const auto now = filter.contains(history, flags);
+			const auto was = wasFilter.contains(history, flags);
 			if (now != was) {
 				if (now) {
 					history->addToChatList(id, filterList);
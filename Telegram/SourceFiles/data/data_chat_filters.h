@@ -100,6 +100,18 @@ public:
 		not_null<History*> history,
 		bool ignoreFakeUnread = false) const;
 
+	// What the rules check about a history, packed in the same flags:
+	// the peer type and the NoMuted / NoRead / NoArchived rules that it
+	// passes. Only the rules from 'rules' are evaluated, so that checks
+	// of many filters compute the history state only once.
+	[[nodiscard]] static Flags HistoryFlags(
+		not_null<History*> history,
+		Flags rules = Flag::RulesMask,
+		bool ignoreFakeUnread = false);
+	[[nodiscard]] bool contains(
+		not_null<History*> history,
+		Flags historyFlags) const;
+
 private:
 	FilterId _id = 0;
 	TextWithEntities _title;
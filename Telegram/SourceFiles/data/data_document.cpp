@@ -18,6 +18,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "main/main_session.h"
 #include "mainwidget.h"
 #include "core/file_utilities.h"
+#include "platform/platform_file_utilities.h"
 #include "core/mime_type.h"
 #include "data/stickers/data_stickers.h"
 #include "media/audio/media_audio.h"
@@ -88,6 +89,31 @@ void UpdateStickerSetIdentifier(
 	});
 }
 
+// Saves a file we already have without writing the content again,
+// if the file system allows that. The copy runs off the main thread,
+// done is called on main after it succeeded.
+bool CopyDownloaded(
+		const Core::FileLocation &from,
+		const QString &to,
+		Fn<void()> done) {
+	if (!from.accessEnable()) {
+		return false;
+	}
+	crl::async([=] {
+		const auto &name = from.name();
+		QFile(to).remove();
+		const auto copied = Platform::File::CloneFile(name, to)
+			|| QFile(name).copy(to);
+		crl::on_main([=] {
+			from.accessDisable();
+			if (copied) {
+				done();
+			}
+		});
+	});
+	return true;
+}
+
 } // namespace
 
 QString FileNameUnsafe(
@@ -219,6 +245,14 @@ QString DocumentFileNameForSave(
 	if (!alreadySavingFilename.isEmpty()) {
 		return alreadySavingFilename;
 	}
+	if (!forceSavingAs && already.isEmpty()) {
+		// Continue the download interrupted by a quit in the same file.
+		const auto partial = data->session().local().partialDownload(
+			data->id);
+		if (!partial.path.isEmpty() && QFile::exists(partial.path)) {
+			return partial.path;
+		}
+	}
 
 	QString name, filter, caption, prefix;
 	const auto mimeType = Core::MimeTypeForName(data->mimeString());
@@ -1126,16 +1160,19 @@ void DocumentData::save(
 				session().local().writeFileLocation(
 					mediaKey(),
 					Core::FileLocation(toFile));
-			} else if (l.accessEnable()) {
-				const auto &alreadyName = l.name();
-				if (alreadyName != toFile) {
-					QFile(toFile).remove();
-					QFile(alreadyName).copy(toFile);
-				}
-				l.accessDisable();
+			} else if (l.name() != toFile) {
+				CopyDownloaded(l, toFile, reusedDownload());
 			}
 		}
 		return;
+	} else if (!toFile.isEmpty() && !_loader) {
+		// Saved before, but not loaded right now, don't download again.
+		const auto &l = location(true);
+		if (!l.isEmpty()
+			&& (l.name() == toFile
+				|| CopyDownloaded(l, toFile, reusedDownload()))) {
+			return;
+		}
 	}
 
 	if (_loader) {
@@ -1153,6 +1190,8 @@ void DocumentData::save(
 		status = FileReady;
 		auto reader = owner().streaming().sharedReader(this, origin, true);
 		if (reader) {
+			// The streamed downloader writes the file from scratch.
+			session().local().setPartialDownload(id, {});
 			_loader = std::make_unique<Storage::StreamedFileDownloader>(
 				&session(),
 				id,
@@ -1215,6 +1254,12 @@ void DocumentData::save(
 	// _owner->notifyDocumentLayoutChanged(this);
 }
 
+Fn<void()> DocumentData::reusedDownload() {
+	return crl::guard(&session(), [=, size = size] {
+		owner().registerReusedDownload(size);
+	});
+}
+
 void DocumentData::handleLoaderUpdates() {
 	_loader->updates(
 	) | rpl::start_with_next_error_done([=] {
@@ -1268,6 +1313,12 @@ bool DocumentData::cancelled() const {
 	return (_flags & Flag::DownloadCancelled);
 }
 
+void DocumentData::setLoadPriority(int priority) {
+	if (_loader) {
+		_loader->setPriority(priority);
+	}
+}
+
 void DocumentData::resetCancelled() {
 	_flags &= ~Flag::DownloadCancelled;
 }
@@ -139,6 +139,7 @@ public:
 	void cancel();
 	[[nodiscard]] bool cancelled() const;
 	void resetCancelled();
+	void setLoadPriority(int priority);
 	[[nodiscard]] float64 progress() const;
 	[[nodiscard]] int64 loadOffset() const;
 	[[nodiscard]] bool uploading() const;
@@ -369,6 +370,7 @@ private:
 	void destroyLoader();
 
 	bool saveFromDataChecked();
+	[[nodiscard]] Fn<void()> reusedDownload();
 
 	void refreshPossibleCoverThumbnail();
 
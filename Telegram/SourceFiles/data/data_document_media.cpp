@@ -24,6 +24,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/application.h"
 #include "core/mime_type.h"
 #include "storage/file_download.h"
+#include "storage/storage_decode_queue.h"
 #include "ui/chat/attach/attach_prepare.h"
 
 #include <QtCore/QBuffer>
@@ -432,7 +433,10 @@ void DocumentMedia::GenerateGoodThumbnail(
 		return;
 	}
 	const auto guard = base::make_weak(&document->owner().session());
-	crl::async([=, location = std::move(location)] {
+	Storage::DecodeAsync(Storage::DecodePriority::Near, [
+		=,
+		location = std::move(location)
+	] {
 		const auto filepath = (location && location->accessEnable())
 			? location->name()
 			: QString();
@@ -491,7 +495,7 @@ void DocumentMedia::ReadOrGenerateThumbnail(
 				GenerateGoodThumbnail(document, bytes);
 			});
 		} else if (active) {
-			crl::async([=] {
+			Storage::DecodeAsync(Storage::DecodePriority::Near, [=] {
 				auto image = Images::Read({ .content = value }).image;
 				crl::on_main(guard, [=, image = std::move(image)]() mutable {
 					document->setGoodThumbnailChecked(true);
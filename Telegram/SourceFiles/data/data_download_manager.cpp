@@ -35,6 +35,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "window/window_controller.h"
 #include "window/window_session_controller.h"
 #include "apiwrap.h"
+#include "api/api_shared_requests.h"
 #include "styles/style_layers.h"
 
 namespace Data {
@@ -682,26 +683,30 @@ void DownloadManager::resolve(
 		--sessionData(session).resolveSentRequests;
 		check();
 	};
+	const auto requestFailed = [=](const MTP::Error &) {
+		requestFinished();
+	};
+	auto &shared = session->api().sharedRequests();
 	for (auto &[peer, perPeer] : prepared) {
 		if (const auto channelId = peerToChannel(peer)) {
-			session->api().request(MTPchannels_GetMessages(
+			shared.send(MTPchannels_GetMessages(
 				MTP_inputChannel(
 					MTP_long(channelId.bare),
 					MTP_long(perPeer.peerAccessHash)),
 				MTP_vector<MTPInputMessage>(perPeer.ids)
-			)).done([=](const MTPmessages_Messages &result) {
+			), [=](const MTPmessages_Messages &result) {
 				session->data().processExistingMessages(
 					session->data().channelLoaded(channelId),
 					result);
 				requestFinished();
-			}).fail(requestFinished).send();
+			}, requestFailed);
 		} else {
-			session->api().request(MTPmessages_GetMessages(
+			shared.send(MTPmessages_GetMessages(
 				MTP_vector<MTPInputMessage>(perPeer.ids)
-			)).done([=](const MTPmessages_Messages &result) {
+			), [=](const MTPmessages_Messages &result) {
 				session->data().processExistingMessages(nullptr, result);
 				requestFinished();
-			}).fail(requestFinished).send();
+			}, requestFailed);
 		}
 	}
 	data.resolveSentRequests += prepared.size();
@@ -42,13 +42,17 @@ constexpr auto kLoadedTopicsMinCount = 20;
 constexpr auto kTopicsPerPage = 500;
 constexpr auto kStalePerRequest = 100;
 constexpr auto kShowTopicNamesCount = 8;
+constexpr auto kResidentTopicsLimit = 1000;
+constexpr auto kCheckResidentEach = 60 * crl::time(1000);
+constexpr auto kMinUnusedToUnload = 5 * 60 * crl::time(1000);
 // constexpr auto kGeneralColorId = 0xA9A9A9;
 
 } // namespace
 
 Forum::Forum(not_null<History*> history)
 : _history(history)
-, _topicsList(&session(), {}, owner().maxPinnedChatsLimitValue(this)) {
+, _topicsList(&session(), {}, owner().maxPinnedChatsLimitValue(this))
+, _residentTimer([=] { checkResident(); }) {
 	Expects(_history->peer->isChannel()
 		|| _history->peer->isBot());
 
@@ -184,6 +188,10 @@ void Forum::requestTopics() {
 		}
 		reorderLastTopics();
 		requestSomeStale();
+		if (int(_topics.size()) > kResidentTopicsLimit
+			&& !_residentTimer.isActive()) {
+			_residentTimer.callEach(kCheckResidentEach);
+		}
 	}).fail([=](const MTP::Error &error) {
 		_requestId = 0;
 		_topicsList.setLoaded();
@@ -212,6 +220,7 @@ void Forum::applyTopicDeleted(MsgId rootId) {
 	if (_activeSubsectionTopic == raw) {
 		_activeSubsectionTopic = nullptr;
 	}
+	_usedAt.remove(rootId);
 	_topicDestroyed.fire(raw);
 	_history->session().recentPeers().chatOpenRemove(raw);
 	session().changes().topicUpdated(
@@ -287,6 +296,7 @@ void Forum::saveActiveSubsectionThread(not_null<Thread*> thread) {
 	if (const auto topic = thread->asTopic()) {
 		Assert(topic->forum() == this);
 		_activeSubsectionTopic = topic->creating() ? nullptr : topic;
+		markUsed(topic);
 	} else {
 		Assert(thread == history());
 		_activeSubsectionTopic = nullptr;
@@ -297,6 +307,109 @@ Thread *Forum::activeSubsectionThread() const {
 	return _activeSubsectionTopic;
 }
 
+void Forum::markUsed(not_null<ForumTopic*> topic) {
+	_usedAt[topic->rootId()] = crl::now();
+}
+
+bool Forum::shown() const {
+	for (const auto &window : session().windows()) {
+		if (window->shownForum().current() == this) {
+			return true;
+		}
+		const auto history = window->activeChatCurrent().owningHistory();
+		if (history == _history) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Forum::canUnload(not_null<ForumTopic*> topic, crl::time now) const {
+	const auto rootId = topic->rootId();
+	const auto i = _usedAt.find(rootId);
+	if (i != end(_usedAt) && now - i->second < kMinUnusedToUnload) {
+		return false;
+	} else if (topic->creating()
+		|| topic == _activeSubsectionTopic
+		|| topic->isPinnedDialog(FilterId())
+		|| ranges::contains(_lastTopics, topic)
+		|| _topicRequests.contains(rootId)
+		|| !topic->chatListBadgesState().empty()
+		|| _history->localDraft(rootId, PeerId())
+		|| _history->cloudDraft(rootId, PeerId())) {
+		return false;
+	}
+	const auto last = topic->lastMessage();
+	return !last || last->isRegular();
+}
+
+void Forum::checkResident() {
+	if (int(_topics.size()) <= kResidentTopicsLimit) {
+		_residentTimer.cancel();
+		return;
+	} else if (_requestId || shown()) {
+		return;
+	}
+	const auto now = crl::now();
+	auto offset = std::optional<ForumOffsets>();
+	auto unload = std::vector<not_null<ForumTopic*>>();
+	auto kept = 0;
+	for (const auto &row : *_topicsList.indexed()) {
+		const auto topic = row->topic();
+		if (kept < kResidentTopicsLimit) {
+			++kept;
+			if (topic->isPinnedDialog(FilterId())) {
+				continue;
+			} else if (const auto last = topic->lastServerMessage()) {
+				offset = ForumOffsets{
+					.date = last->date(),
+					.id = last->id,
+					.topicId = topic->rootId(),
+				};
+			}
+		} else if (canUnload(topic, now)) {
+			unload.push_back(topic);
+		}
+	}
+	if (unload.empty() || !offset) {
+		return;
+	}
+	for (const auto &topic : unload) {
+		unloadTopic(topic);
+	}
+	_offset = *offset;
+	_topicsList.setLoaded(false);
+	_chatsListChanges.fire({});
+	DEBUG_LOG(("Forum: Unloaded %1 cold topics, %2 left."
+		).arg(unload.size()
+		).arg(_topics.size()));
+}
+
+void Forum::unloadTopic(not_null<ForumTopic*> topic) {
+	const auto rootId = topic->rootId();
+	const auto i = _topics.find(rootId);
+	Assert(i != end(_topics));
+
+	// Same as deletion, except the messages and the drafts are kept.
+	owner().removeChatListEntry(topic);
+	_topicDestroyed.fire_copy(topic);
+	session().recentPeers().chatOpenRemove(topic);
+	session().changes().topicUpdated(
+		topic,
+		Data::TopicUpdate::Flag::Destroyed);
+	session().changes().entryUpdated(
+		topic,
+		Data::EntryUpdate::Flag::Destroyed);
+	_usedAt.remove(rootId);
+	_staleRootIds.remove(rootId);
+	_topics.erase(i);
+
+	session().storage().unload(Storage::SharedMediaUnloadThread(
+		_history->peer->id,
+		rootId,
+		PeerId()));
+}
+
 void Forum::markUnreadCountsUnknown(MsgId readTillId) {
 	if (!peer()->useSubsectionTabs()) {
 		return;
@@ -380,6 +493,7 @@ void Forum::applyReceivedTopics(
 				).first->second.get()
 				: i->second.get();
 			raw->applyTopic(data);
+			markUsed(raw);
 			if (creating) {
 				if (const auto last = _history->chatListMessage()
 					; last && last->topicRootId() == rootId) {
@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "dialogs/dialogs_main_list.h"
+#include "base/timer.h"
 
 class History;
 class ChannelData;
@@ -120,6 +121,18 @@ private:
 	void requestSomeStale();
 	void finishTopicRequest(MsgId rootId);
 
+	// Past kResidentTopicsLimit loaded topics the cold ones at the end of
+	// the list are unloaded while the forum is not shown. The list is
+	// marked as not loaded from the last kept topic, so they're loaded
+	// back page by page on scroll, or one by one by enforceTopicFor().
+	void markUsed(not_null<ForumTopic*> topic);
+	void checkResident();
+	[[nodiscard]] bool shown() const;
+	[[nodiscard]] bool canUnload(
+		not_null<ForumTopic*> topic,
+		crl::time now) const;
+	void unloadTopic(not_null<ForumTopic*> topic);
+
 	const not_null<History*> _history;
 
 	base::flat_map<MsgId, std::unique_ptr<ForumTopic>> _topics;
@@ -141,6 +154,9 @@ private:
 
 	ForumTopic *_activeSubsectionTopic = nullptr;
 
+	base::flat_map<MsgId, crl::time> _usedAt;
+	base::Timer _residentTimer;
+
 	rpl::event_stream<> _chatsListChanges;
 	rpl::event_stream<> _chatsListLoadedEvents;
 
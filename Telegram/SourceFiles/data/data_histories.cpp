@@ -10,6 +10,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "api/api_text_entities.h"
 #include "data/business/data_shortcut_messages.h"
 #include "data/components/scheduled_messages.h"
+#include "data/data_changes.h"
 #include "data/data_channel.h"
 #include "data/data_chat.h"
 #include "data/data_document.h"
@@ -29,13 +30,26 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "history/history_item_helpers.h"
 #include "history/view/history_view_element.h"
 #include "core/application.h"
+#include "core/core_settings.h"
+#include "window/window_session_controller.h"
 #include "apiwrap.h"
 
 namespace Data {
 namespace {
 
 constexpr auto kReadRequestTimeout = 3 * crl::time(1000);
+constexpr auto kReadRequestsWindow = 32;
 constexpr auto kReportDeliveriesPerRequest = 50;
+constexpr auto kCheckResidentEach = 60 * crl::time(1000);
+constexpr auto kMinUnusedToUnload = 5 * 60 * crl::time(1000);
+
+[[nodiscard]] int ResidentMessages(not_null<History*> history) {
+	auto result = 0;
+	for (const auto &block : history->blocks) {
+		result += int(block->messages.size());
+	}
+	return result;
+}
 
 } // namespace
 
@@ -127,7 +141,9 @@ MTPInputMedia WebPageForMTP(
 
 Histories::Histories(not_null<Session*> owner)
 : _owner(owner)
-, _readRequestsTimer([=] { sendReadRequests(); }) {
+, _readRequestsTimer([=] { sendReadRequests(); })
+, _residentTimer([=] { checkResident(); }) {
+	_residentTimer.callEach(kCheckResidentEach);
 }
 
 Session &Histories::owner() const {
@@ -162,9 +178,96 @@ void Histories::unloadAll() {
 }
 
 void Histories::clearAll() {
+	_usedAt.clear();
 	_map.clear();
 }
 
+void Histories::markUsed(not_null<History*> history) {
+	_usedAt[history] = crl::now();
+}
+
+Histories::ResidentStats Histories::residentStats() const {
+	auto result = ResidentStats{
+		.limit = Core::App().settings().residentMessagesLimit(),
+		.unloadedHistories = _unloadedHistories,
+		.unloadedMessages = _unloadedMessages,
+	};
+	for (const auto &[peerId, history] : _map) {
+		if (const auto count = ResidentMessages(history.get())) {
+			++result.histories;
+			result.messages += count;
+		}
+	}
+	return result;
+}
+
+base::flat_set<not_null<History*>> Histories::shownHistories() const {
+	auto result = base::flat_set<not_null<History*>>();
+	for (const auto &window : session().windows()) {
+		if (const auto history = window->activeChatCurrent().owningHistory()) {
+			result.emplace(history);
+			if (const auto from = history->migrateFrom()) {
+				result.emplace(from);
+			}
+			result.emplace(history->migrateToOrMe());
+		}
+	}
+	return result;
+}
+
+void Histories::checkResident() {
+	const auto limit = Core::App().settings().residentMessagesLimit();
+	if (!limit) {
+		return;
+	}
+	struct Candidate {
+		not_null<History*> history;
+		crl::time usedAt = 0;
+		int messages = 0;
+	};
+	const auto now = crl::now();
+	const auto shown = shownHistories();
+	auto candidates = std::vector<Candidate>();
+	auto total = 0;
+	for (const auto &[peerId, owned] : _map) {
+		const auto history = owned.get();
+		const auto messages = ResidentMessages(history);
+		if (!messages) {
+			continue;
+		}
+		total += messages;
+		if (shown.contains(history)) {
+			_usedAt[history] = now;
+			continue;
+		}
+		const auto i = _usedAt.find(history);
+		const auto usedAt = (i != end(_usedAt)) ? i->second : 0;
+		if (!usedAt || now - usedAt >= kMinUnusedToUnload) {
+			candidates.push_back({ history, usedAt, messages });
+		}
+	}
+	if (total <= limit) {
+		return;
+	}
+	ranges::sort(candidates, ranges::less(), &Candidate::usedAt);
+	auto unloaded = 0;
+	for (const auto &candidate : candidates) {
+		// Loaded back from the server when opened or read again.
+		candidate.history->clear(History::ClearType::Unload);
+		_usedAt.remove(candidate.history);
+		++unloaded;
+		total -= candidate.messages;
+		_unloadedMessages += candidate.messages;
+		if (total <= limit) {
+			break;
+		}
+	}
+	_unloadedHistories += unloaded;
+	DEBUG_LOG(("Histories: Unloaded %1 cold histories, %2 messages left."
+		).arg(unloaded
+		).arg(total));
+}
+
 void Histories::readInbox(not_null<History*> history) {
 	DEBUG_LOG(("Reading: readInbox called."));
 	if (history->lastServerMessageKnown()) {
@@ -196,6 +299,15 @@ void Histories::readInbox(not_null<History*> history) {
 	});
 }
 
+void Histories::readInboxBatch(Fn<void()> read) {
+	const auto batch = Changes::Batch(&session().changes());
+	++_readInboxBatching;
+	read();
+	if (!--_readInboxBatching) {
+		sendReadRequests();
+	}
+}
+
 void Histories::readInboxTill(not_null<HistoryItem*> item) {
 	const auto history = item->history();
 	if (!item->isRegular()) {
@@ -666,19 +778,28 @@ void Histories::reportPendingDeliveries() {
 
 void Histories::sendReadRequests() {
 	DEBUG_LOG(("Reading: send requests with count %1.").arg(_states.size()));
-	if (_states.empty()) {
+	if (_states.empty() || _readInboxBatching) {
 		return;
 	}
 	const auto now = crl::now();
 	auto next = std::optional<crl::time>();
+	auto inFlight = int(ranges::count_if(_states, [](const auto &pair) {
+		return pair.second.sentReadTill && !pair.second.sentReadDone;
+	}));
 	for (auto &[history, state] : _states) {
 		if (!state.willReadTill) {
 			DEBUG_LOG(("Reading: skipping zero till."));
 			continue;
 		} else if (state.willReadWhen <= now) {
+			if (inFlight >= kReadRequestsWindow) {
+				// Sent when one of the requests in flight is finished.
+				DEBUG_LOG(("Reading: window is full."));
+				continue;
+			}
 			DEBUG_LOG(("Reading: sending with till %1."
 				).arg(state.willReadTill.bare));
 			sendReadRequest(history, state);
+			++inFlight;
 		} else if (!next || *next > state.willReadWhen) {
 			DEBUG_LOG(("Reading: scheduling for later send."));
 			next = state.willReadWhen;
@@ -988,6 +1109,10 @@ void Histories::deleteMessages(const MessageIdsList &ids, bool revoke) {
 		const auto history = item->history();
 		const auto wasLast = (history->lastMessage() == item);
 		const auto wasInChats = (history->chatListMessage() == item);
+		if (item->isRegular()) {
+			// No update with the ids comes back for our own deletion.
+			_owner->notifyMessageDeleted(item->fullId());
+		}
 		item->destroy();
 
 		if (wasLast || wasInChats) {
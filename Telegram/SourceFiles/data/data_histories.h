@@ -58,7 +58,23 @@ public:
 	void unloadAll();
 	void clearAll();
 
+	// Loaded blocks of the histories not used for a while are unloaded
+	// when all the loaded ones together have more messages than
+	// Core::Settings::residentMessagesLimit() allows.
+	void markUsed(not_null<History*> history);
+	struct ResidentStats {
+		int histories = 0;
+		int messages = 0;
+		int limit = 0;
+		int64 unloadedHistories = 0;
+		int64 unloadedMessages = 0;
+	};
+	[[nodiscard]] ResidentStats residentStats() const;
+
 	void readInbox(not_null<History*> history);
+	// The histories read inside the callback update the unread counters
+	// with one notification, their requests are sent together after it.
+	void readInboxBatch(Fn<void()> read);
 	void readInboxTill(not_null<HistoryItem*> item);
 	void readInboxTill(not_null<History*> history, MsgId tillId);
 	void readInboxOnNewMessage(not_null<HistoryItem*> item);
@@ -208,6 +224,9 @@ private:
 	void sendDialogRequests();
 	void reportPendingDeliveries();
 
+	void checkResident();
+	[[nodiscard]] base::flat_set<not_null<History*>> shownHistories() const;
+
 	[[nodiscard]] bool isCreatingTopic(
 		not_null<History*> history,
 		MsgId rootId) const;
@@ -221,6 +240,12 @@ private:
 	base::flat_map<int, not_null<History*>> _historyByRequest;
 	int _requestAutoincrement = 0;
 	base::Timer _readRequestsTimer;
+	int _readInboxBatching = 0;
+
+	base::flat_map<not_null<History*>, crl::time> _usedAt;
+	base::Timer _residentTimer;
+	int64 _unloadedHistories = 0;
+	int64 _unloadedMessages = 0;
 
 	base::flat_set<not_null<Data::Folder*>> _dialogFolderRequests;
 	base::flat_map<
@@ -161,8 +161,9 @@ bool VideoPreload::readyToRequest() const {
 	return !_failed && (_nextRequestOffset < _parts.size() * part);
 }
 
-int64 VideoPreload::takeNextRequestOffset() {
+int64 VideoPreload::takeNextRequestOffset(int limit) {
 	Expects(readyToRequest());
+	Expects(limit == Storage::kDownloadPartSize);
 
 	_requestedOffsets.emplace(_nextRequestOffset);
 	_nextRequestOffset += Storage::kDownloadPartSize;
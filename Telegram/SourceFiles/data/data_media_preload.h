@@ -65,7 +65,7 @@ private:
 	void done(QByteArray result);
 
 	bool readyToRequest() const override;
-	int64 takeNextRequestOffset() override;
+	int64 takeNextRequestOffset(int limit) override;
 	bool feedPart(int64 offset, const QByteArray &bytes) override;
 	void cancelOnFail() override;
 	bool setWebFileSizeHook(int64 size) override;
@@ -10,6 +10,18 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/stickers/data_custom_emoji.h"
 
 namespace Data {
+namespace {
+
+// Every message with a reaction keeps its own ReactionId, share the few
+// emoji strings the server sends instead of allocating one per message.
+[[nodiscard]] QString SharedEmoji(const MTPstring &emoticon) {
+	static auto Emoji = base::flat_set<QString>();
+	auto emoji = qs(emoticon);
+	const auto i = Emoji.find(emoji);
+	return (i != end(Emoji)) ? *i : *Emoji.emplace(std::move(emoji)).first;
+}
+
+} // namespace
 
 QString SearchTagToQuery(const ReactionId &tagId) {
 	if (const auto customId = tagId.custom()) {
@@ -72,7 +84,7 @@ ReactionId ReactionFromMTP(const MTPReaction &reaction) {
 	return reaction.match([](MTPDreactionEmpty) {
 		return ReactionId{ QString() };
 	}, [](const MTPDreactionEmoji &data) {
-		return ReactionId{ qs(data.vemoticon()) };
+		return ReactionId{ SharedEmoji(data.vemoticon()) };
 	}, [](const MTPDreactionCustomEmoji &data) {
 		return ReactionId{ DocumentId(data.vdocument_id().v) };
 	}, [](const MTPDreactionPaid &) {
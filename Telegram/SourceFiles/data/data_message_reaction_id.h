@@ -18,7 +18,8 @@ struct ReactionId {
 		return '*';
 	}
 	[[nodiscard]] static ReactionId Paid() {
-		return { QString(PaidTag()) };
+		static const auto kPaid = QString(PaidTag());
+		return { kPaid };
 	}
 
 	[[nodiscard]] bool empty() const {
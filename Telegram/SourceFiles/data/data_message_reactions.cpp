@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_message_reactions.h"
 
 #include "api/api_global_privacy.h"
+#include "api/api_views.h"
 #include "calls/group/calls_group_call.h"
 #include "calls/group/calls_group_messages.h"
 #include "chat_helpers/stickers_lottie.h"
@@ -376,8 +377,6 @@ Reactions::Reactions(not_null<Session*> owner)
 		MessageUpdate::Flag::Destroyed
 	) | rpl::start_with_next([=](const MessageUpdate &update) {
 		const auto item = update.item;
-		_pollingItems.remove(item);
-		_pollItems.remove(item);
 		_repaintItems.remove(item);
 		_sendPaidItems.remove(item);
 		if (const auto i = _sendingPaid.find(item)
@@ -1535,13 +1534,18 @@ void Reactions::poll(not_null<HistoryItem*> item, crl::time now) {
 				_repaintTimer.callOnce(left);
 			}
 		}
-	} else if (!_pollingItems.contains(item)) {
-		if (_pollItems.empty() && !_pollRequestId) {
-			crl::on_main(&_owner->session(), [=] {
-				pollCollected();
-			});
-		}
-		_pollItems.emplace(item);
+	} else {
+		_owner->session().api().views().scheduleRefresh(
+			item,
+			Api::RefreshKind::Reactions);
+	}
+}
+
+void Reactions::polled(not_null<HistoryItem*> item) {
+	// Messages without reactions don't come in the updates.
+	const auto last = item->lastReactionsRefreshTime();
+	if (last && last + kPollEach <= crl::now()) {
+		item->updateReactions(nullptr);
 	}
 }
 
@@ -1704,41 +1708,6 @@ void Reactions::repaintCollected() {
 	}
 }
 
-void Reactions::pollCollected() {
-	auto toRequest = base::flat_map<not_null<PeerData*>, QVector<MTPint>>();
-	_pollingItems = std::move(_pollItems);
-	for (const auto &item : _pollingItems) {
-		toRequest[item->history()->peer].push_back(MTP_int(item->id));
-	}
-	auto &api = _owner->session().api();
-	for (const auto &[peer, ids] : toRequest) {
-		const auto finalize = [=] {
-			const auto now = crl::now();
-			for (const auto &item : base::take(_pollingItems)) {
-				const auto last = item->lastReactionsRefreshTime();
-				if (last && last + kPollEach <= now) {
-					item->updateReactions(nullptr);
-				}
-			}
-			_pollRequestId = 0;
-			if (!_pollItems.empty()) {
-				crl::on_main(&_owner->session(), [=] {
-					pollCollected();
-				});
-			}
-		};
-		_pollRequestId = api.request(MTPmessages_GetMessagesReactions(
-			peer->input,
-			MTP_vector<MTPint>(ids)
-		)).done([=](const MTPUpdates &result) {
-			_owner->session().api().applyUpdates(result);
-			finalize();
-		}).fail([=] {
-			finalize();
-		}).send();
-	}
-}
-
 bool Reactions::sending(not_null<HistoryItem*> item) const {
 	return _sentRequests.contains(item->fullId())
 		|| _sendingPaid.contains(item);
@@ -1949,6 +1918,7 @@ void MessageReactions::add(const ReactionId &id, bool addToRecent) {
 		const auto sublist = _item->savedSublist();
 		history->owner().reactions().incrementMyTag(id, sublist);
 	}
+	auto &recent = recentRef();
 	_list.erase(ranges::remove_if(_list, [&](MessageReaction &one) {
 		if (one.id.paid()) {
 			return false;
@@ -1959,17 +1929,17 @@ void MessageReactions::add(const ReactionId &id, bool addToRecent) {
 		}
 		one.my = false;
 		const auto removed = !--one.count;
-		const auto j = _recent.find(one.id);
-		if (j != end(_recent)) {
+		const auto j = recent.find(one.id);
+		if (j != end(recent)) {
 			if (removed) {
 				j->second.clear();
-				_recent.erase(j);
+				recent.erase(j);
 			} else {
 				j->second.erase(
 					ranges::remove(j->second, true, &RecentReaction::my),
 					end(j->second));
 				if (j->second.empty()) {
-					_recent.erase(j);
+					recent.erase(j);
 				}
 			}
 		}
@@ -1981,7 +1951,7 @@ void MessageReactions::add(const ReactionId &id, bool addToRecent) {
 	}), end(_list));
 	const auto peer = history->peer;
 	if (_item->canViewReactions() || peer->isUser()) {
-		auto &list = _recent[id];
+		auto &list = recent[id];
 		const auto from = peer->session().sendAsPeers().resolveChosen(peer);
 		list.insert(begin(list), RecentReaction{
 			.peer = from,
@@ -1996,6 +1966,7 @@ void MessageReactions::add(const ReactionId &id, bool addToRecent) {
 	} else {
 		_list.push_back({ .id = id, .count = 1, .my = true });
 	}
+	compactRecent();
 	auto &owner = history->owner();
 	owner.reactions().send(_item, addToRecent);
 	owner.notifyItemDataChange(_item);
@@ -2007,13 +1978,16 @@ void MessageReactions::remove(const ReactionId &id) {
 	const auto history = _item->history();
 	const auto self = history->session().user();
 	const auto i = ranges::find(_list, id, &MessageReaction::id);
-	const auto j = _recent.find(id);
+	auto &recent = recentRef();
+	const auto j = recent.find(id);
 	if (i == end(_list)) {
-		Assert(j == end(_recent));
+		Assert(j == end(recent));
+		compactRecent();
 		return;
 	} else if (!i->my) {
-		Assert(j == end(_recent)
+		Assert(j == end(recent)
 			|| !ranges::contains(j->second, self, &RecentReaction::peer));
+		compactRecent();
 		return;
 	}
 	i->my = false;
@@ -2022,16 +1996,16 @@ void MessageReactions::remove(const ReactionId &id) {
 	if (removed) {
 		_list.erase(i);
 	}
-	if (j != end(_recent)) {
+	if (j != end(recent)) {
 		if (removed) {
 			j->second.clear();
-			_recent.erase(j);
+			recent.erase(j);
 		} else {
 			j->second.erase(
 				ranges::remove(j->second, true, &RecentReaction::my),
 				end(j->second));
 			if (j->second.empty()) {
-				_recent.erase(j);
+				recent.erase(j);
 			}
 		}
 	}
@@ -2039,6 +2013,7 @@ void MessageReactions::remove(const ReactionId &id) {
 		const auto sublist = _item->savedSublist();
 		history->owner().reactions().decrementMyTag(id, sublist);
 	}
+	compactRecent();
 	auto &owner = history->owner();
 	owner.reactions().send(_item, false);
 	owner.notifyItemDataChange(_item);
@@ -2049,6 +2024,7 @@ bool MessageReactions::checkIfChanged(
 		const QVector<MTPMessagePeerReaction> &recent,
 		bool min) const {
 	auto &owner = _item->history()->owner();
+	const auto &now = this->recent();
 	if (owner.reactions().sending(_item)) {
 		// We'll apply non-stale data from the request response.
 		return false;
@@ -2084,7 +2060,7 @@ bool MessageReactions::checkIfChanged(
 			}
 			const auto peerId = peerFromMTP(data.vpeer_id());
 			const auto peer = owner.peer(peerId);
-			const auto my = IsMyRecent(data, id, peer, _recent, min);
+			const auto my = IsMyRecent(data, id, peer, now, min);
 			parsed[id].push_back({
 				.peer = peer,
 				.unread = data.is_unread(),
@@ -2093,7 +2069,7 @@ bool MessageReactions::checkIfChanged(
 			});
 		});
 	}
-	return !ranges::equal(_recent, parsed, [](
+	return !ranges::equal(now, parsed, [](
 			const auto &a,
 			const auto &b) {
 		return ranges::equal(a.second, b.second, [](
@@ -2114,6 +2090,7 @@ bool MessageReactions::change(
 		// We'll apply non-stale data from the request response.
 		return false;
 	}
+	const auto &now = this->recent();
 	auto changed = false;
 	auto existing = base::flat_set<ReactionId>();
 	auto order = base::flat_map<ReactionId, int>();
@@ -2175,6 +2152,9 @@ bool MessageReactions::change(
 			}
 		}
 	}
+	if (_list.capacity() > _list.size() * 2) {
+		_list.shrink_to_fit();
+	}
 	auto parsed = base::flat_map<ReactionId, std::vector<RecentReaction>>();
 	for (const auto &reaction : recent) {
 		reaction.match([&](const MTPDmessagePeerReaction &data) {
@@ -2188,7 +2168,7 @@ bool MessageReactions::change(
 				return;
 			}
 			const auto peer = owner.peer(peerFromMTP(data.vpeer_id()));
-			const auto my = IsMyRecent(data, id, peer, _recent, min);
+			const auto my = IsMyRecent(data, id, peer, now, min);
 			list.push_back({
 				.peer = peer,
 				.unread = data.is_unread(),
@@ -2197,8 +2177,12 @@ bool MessageReactions::change(
 			});
 		});
 	}
-	if (_recent != parsed) {
-		_recent = std::move(parsed);
+	if (now != parsed) {
+		if (parsed.empty()) {
+			_recent = nullptr;
+		} else {
+			recentRef() = std::move(parsed);
+		}
 		changed = true;
 	}
 
@@ -2261,7 +2245,21 @@ const std::vector<MessageReaction> &MessageReactions::list() const {
 
 auto MessageReactions::recent() const
 -> const base::flat_map<ReactionId, std::vector<RecentReaction>> & {
-	return _recent;
+	static const auto kEmpty = Recent();
+	return _recent ? *_recent : kEmpty;
+}
+
+auto MessageReactions::recentRef() -> Recent & {
+	if (!_recent) {
+		_recent = std::make_unique<Recent>();
+	}
+	return *_recent;
+}
+
+void MessageReactions::compactRecent() {
+	if (_recent && _recent->empty()) {
+		_recent = nullptr;
+	}
 }
 
 auto MessageReactions::topPaid() const -> const std::vector<TopPaid> & {
@@ -2274,7 +2272,7 @@ bool MessageReactions::empty() const {
 }
 
 bool MessageReactions::hasUnread() const {
-	for (auto &[emoji, list] : _recent) {
+	for (auto &[emoji, list] : recent()) {
 		if (ranges::contains(list, true, &RecentReaction::unread)) {
 			return true;
 		}
@@ -2283,7 +2281,10 @@ bool MessageReactions::hasUnread() const {
 }
 
 void MessageReactions::markRead() {
-	for (auto &[emoji, list] : _recent) {
+	if (!_recent) {
+		return;
+	}
+	for (auto &[emoji, list] : *_recent) {
 		for (auto &reaction : list) {
 			reaction.unread = false;
 		}
@@ -2418,7 +2419,7 @@ PeerId MessageReactions::localPaidShownPeer() const {
 
 bool MessageReactions::clearCloudData() {
 	const auto result = !_list.empty();
-	_recent.clear();
+	_recent = nullptr;
 	_list.clear();
 	if (localPaidData()) {
 		_paid->top.clear();
@@ -146,6 +146,7 @@ public:
 	[[nodiscard]] bool sending(not_null<HistoryItem*> item) const;
 
 	void poll(not_null<HistoryItem*> item, crl::time now);
+	void polled(not_null<HistoryItem*> item);
 
 	void updateAllInHistory(not_null<PeerData*> peer, bool enabled);
 
@@ -266,7 +267,6 @@ private:
 		std::vector<not_null<DocumentData*>> list) const;
 
 	void repaintCollected();
-	void pollCollected();
 
 	void sendPaid();
 	bool sendPaid(not_null<HistoryItem*> item);
@@ -358,9 +358,6 @@ private:
 
 	base::flat_map<not_null<HistoryItem*>, crl::time> _repaintItems;
 	base::Timer _repaintTimer;
-	base::flat_set<not_null<HistoryItem*>> _pollItems;
-	base::flat_set<not_null<HistoryItem*>> _pollingItems;
-	mtpRequestId _pollRequestId = 0;
 
 	base::flat_map<not_null<HistoryItem*>, crl::time> _sendPaidItems;
 	base::flat_map<not_null<HistoryItem*>, mtpRequestId> _sendingPaid;
@@ -450,8 +447,14 @@ private:
 	};
 	const not_null<HistoryItem*> _item;
 
+	using Recent = base::flat_map<ReactionId, std::vector<RecentReaction>>;
+
+	// Allocates the recent reactors, compactRecent() drops them if empty.
+	[[nodiscard]] Recent &recentRef();
+	void compactRecent();
+
 	std::vector<MessageReaction> _list;
-	base::flat_map<ReactionId, std::vector<RecentReaction>> _recent;
+	std::unique_ptr<Recent> _recent; // Only the small chats have them.
 	std::unique_ptr<Paid> _paid;
 
 };
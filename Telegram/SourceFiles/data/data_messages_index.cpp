@@ -0,0 +1,112 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "data/data_messages_index.h"
+
+namespace Data {
+namespace {
+
+// An array of 64 pointers pays off for this many items.
+constexpr auto kMinItemsInPage = 8;
+
+} // namespace
+
+struct MessagesIndex::Page {
+	std::array<HistoryItem*, kPageSize> items = { { nullptr } };
+	int count = 0;
+};
+
+MessagesIndex::MessagesIndex() = default;
+
+MessagesIndex::MessagesIndex(MessagesIndex &&other) = default;
+
+MessagesIndex &MessagesIndex::operator=(MessagesIndex &&other) = default;
+
+MessagesIndex::~MessagesIndex() = default;
+
+int64 MessagesIndex::PageIndex(MsgId id) {
+	return (id.bare >> kPageShift);
+}
+
+int MessagesIndex::PageSlot(MsgId id) {
+	return int(id.bare & (kPageSize - 1));
+}
+
+HistoryItem *MessagesIndex::find(MsgId id) const {
+	if (!_pages.empty()) {
+		const auto i = _pages.find(PageIndex(id));
+		if (i != end(_pages)) {
+			return i->second->items[PageSlot(id)];
+		}
+	}
+	const auto i = _sparse.find(id);
+	return (i != end(_sparse)) ? i->second.get() : nullptr;
+}
+
+bool MessagesIndex::emplace(MsgId id, not_null<HistoryItem*> item) {
+	const auto index = PageIndex(id);
+	const auto i = _pages.find(index);
+	if (i != end(_pages)) {
+		auto &slot = i->second->items[PageSlot(id)];
+		if (slot) {
+			return false;
+		}
+		slot = item;
+		++i->second->count;
+	} else if (!_sparse.emplace(id, item).second) {
+		return false;
+	} else {
+		checkMakePage(index);
+	}
+	++_count;
+	return true;
+}
+
+HistoryItem *MessagesIndex::take(MsgId id) {
+	HistoryItem *result = nullptr;
+	const auto i = _pages.find(PageIndex(id));
+	if (i != end(_pages)) {
+		result = base::take(i->second->items[PageSlot(id)]);
+		if (result && !--i->second->count) {
+			_pages.erase(i);
+		}
+	} else if (const auto j = _sparse.find(id); j != end(_sparse)) {
+		result = j->second;
+		_sparse.erase(j);
+	}
+	if (result) {
+		--_count;
+	}
+	return result;
+}
+
+void MessagesIndex::checkMakePage(int64 index) {
+	// Ids of one page are neighbours in the sorted list.
+	const auto from = _sparse.lower_bound(MsgId(index << kPageShift));
+	const auto till = _sparse.lower_bound(MsgId((index + 1) << kPageShift));
+	const auto count = int(till - from);
+	if (count < kMinItemsInPage) {
+		return;
+	}
+	auto page = std::make_unique<Page>();
+	for (auto i = from; i != till; ++i) {
+		page->items[PageSlot(i->first)] = i->second;
+	}
+	page->count = count;
+	_sparse.erase(from, till);
+	_pages.emplace(index, std::move(page));
+}
+
+int64 MessagesIndex::memoryUsage() const {
+	using Sparse = std::pair<MsgId, not_null<HistoryItem*>>;
+	using Pages = std::pair<int64, std::unique_ptr<Page>>;
+	return int64(sizeof(MessagesIndex))
+		+ int64(_sparse.size()) * int64(sizeof(Sparse))
+		+ int64(_pages.size()) * int64(sizeof(Pages) + sizeof(Page));
+}
+
+} // namespace Data
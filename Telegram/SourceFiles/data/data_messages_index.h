@@ -0,0 +1,58 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/flat_map.h"
+
+class HistoryItem;
+
+namespace Data {
+
+// Items by their ids. Ids in a chat are mostly dense and growing, so as
+// soon as a few of them fall into one page of consecutive ids that page
+// is kept as a plain array. Scattered ids, like a single last message of
+// a chat in the chats list, stay in a small sorted list.
+class MessagesIndex final {
+public:
+	MessagesIndex();
+	MessagesIndex(MessagesIndex &&other);
+	MessagesIndex &operator=(MessagesIndex &&other);
+	~MessagesIndex();
+
+	[[nodiscard]] HistoryItem *find(MsgId id) const;
+
+	// Returns false if the id is already taken.
+	bool emplace(MsgId id, not_null<HistoryItem*> item);
+	HistoryItem *take(MsgId id);
+
+	[[nodiscard]] bool empty() const {
+		return !_count;
+	}
+	[[nodiscard]] int size() const {
+		return _count;
+	}
+	[[nodiscard]] int64 memoryUsage() const;
+
+private:
+	static constexpr auto kPageShift = 6;
+	static constexpr auto kPageSize = (1 << kPageShift);
+
+	struct Page;
+
+	[[nodiscard]] static int64 PageIndex(MsgId id);
+	[[nodiscard]] static int PageSlot(MsgId id);
+
+	void checkMakePage(int64 index);
+
+	base::flat_map<MsgId, not_null<HistoryItem*>> _sparse;
+	base::flat_map<int64, std::unique_ptr<Page>> _pages;
+	int _count = 0;
+
+};
+
+} // namespace Data
@@ -159,6 +159,12 @@ void PhotoData::clearFailed(PhotoSize size) {
 	_images[validSizeIndex(size)].flags &= ~Data::CloudFile::Flag::Failed;
 }
 
+void PhotoData::setLoadPriority(PhotoSize size, int priority) {
+	if (const auto &loader = _images[validSizeIndex(size)].loader) {
+		loader->setPriority(priority);
+	}
+}
+
 const ImageLocation &PhotoData::location(PhotoSize size) const {
 	return _images[validSizeIndex(size)].location;
 }
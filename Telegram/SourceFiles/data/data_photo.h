@@ -127,6 +127,7 @@ public:
 	[[nodiscard]] bool loading(Data::PhotoSize size) const;
 	[[nodiscard]] bool failed(Data::PhotoSize size) const;
 	void clearFailed(Data::PhotoSize size);
+	void setLoadPriority(Data::PhotoSize size, int priority);
 	void load(
 		Data::PhotoSize size,
 		Data::FileOrigin origin,
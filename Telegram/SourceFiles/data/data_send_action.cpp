@@ -10,11 +10,29 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_user.h"
 #include "history/history.h"
 #include "history/view/history_view_send_action.h"
+#include "base/event_filter.h"
+
+#include <QtGui/QGuiApplication>
+#include <QtGui/QWindow>
 
 namespace Data {
+namespace {
+
+// While no window is shown the actions are only expired in time.
+constexpr auto kHiddenCheckDelay = crl::time(1000);
+
+[[nodiscard]] bool AnyWindowExposed() {
+	// Minimized, hidden and, where supported, occluded windows aren't.
+	return ranges::any_of(
+		QGuiApplication::topLevelWindows(),
+		&QWindow::isExposed);
+}
+
+} // namespace
 
 SendActionManager::SendActionManager()
-: _animation([=](crl::time now) { return callback(now); }) {
+: _animation([=](crl::time now) { return callback(now); })
+, _hiddenTimer([=] { hiddenCallback(); }) {
 }
 
 HistoryView::SendActionPainter *SendActionManager::lookupPainter(
@@ -125,7 +143,38 @@ bool SendActionManager::callback(crl::time now) {
 			i = _sendActions.erase(i);
 		}
 	}
-	return !_sendActions.empty();
+	if (_sendActions.empty()) {
+		_exposeFilter = nullptr;
+		return false;
+	} else if (!AnyWindowExposed()) {
+		waitForExposed();
+		return false;
+	}
+	_exposeFilter = nullptr;
+	return true;
+}
+
+void SendActionManager::waitForExposed() {
+	_hiddenTimer.callOnce(kHiddenCheckDelay);
+	if (_exposeFilter) {
+		return;
+	}
+	// Resume the animation as soon as a window is shown again.
+	_exposeFilter = base::unique_qptr{ base::install_event_filter(
+		QCoreApplication::instance(),
+		[=](not_null<QEvent*> e) {
+			if (e->type() == QEvent::Expose) {
+				// Not from inside the event filter.
+				_hiddenTimer.callOnce(0);
+			}
+			return base::EventFilterResult::Continue;
+		}).get() };
+}
+
+void SendActionManager::hiddenCallback() {
+	if (callback(crl::now())) {
+		_animation.start();
+	}
 }
 
 auto SendActionManager::animationUpdated() const
@@ -7,6 +7,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #pragma once
 
+#include "base/timer.h"
+#include "base/unique_qptr.h"
 #include "ui/effects/animations.h"
 
 class History;
@@ -57,6 +59,8 @@ public:
 
 private:
 	bool callback(crl::time now);
+	void hiddenCallback();
+	void waitForExposed();
 	[[nodiscard]] SendActionPainter *lookupPainter(
 		not_null<History*> history,
 		MsgId rootId);
@@ -66,6 +70,8 @@ private:
 		std::pair<not_null<History*>, MsgId>,
 		crl::time> _sendActions;
 	Ui::Animations::Basic _animation;
+	base::Timer _hiddenTimer;
+	base::unique_qptr<QObject> _exposeFilter;
 
 	rpl::event_stream<AnimationUpdate> _animationUpdate;
 	rpl::event_stream<not_null<History*>> _speakingAnimationUpdate;
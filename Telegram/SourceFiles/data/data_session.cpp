@@ -34,6 +34,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "inline_bots/inline_bot_layout_item.h"
 #include "storage/storage_account.h"
 #include "storage/storage_encrypted_file.h"
+#include "storage/storage_decoded_images.h"
 #include "media/player/media_player_instance.h" // instance()->play()
 #include "media/audio/media_audio.h"
 #include "boxes/abstract_box.h"
@@ -57,6 +58,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_file_origin.h"
 #include "data/data_download_manager.h"
 #include "data/data_web_page.h"
+#include "data/data_web_page_previews.h"
 #include "data/data_game.h"
 #include "data/data_poll.h"
 #include "data/data_replies_list.h"
@@ -88,6 +90,10 @@ namespace Data {
 namespace {
 
 constexpr auto kNextForUpgradeGiftTimeout = 5 * crl::time(1000);
+constexpr auto kDecodedImagesLimit = int64(64 * 1024 * 1024);
+constexpr auto kDecodedImagesInactivePart = 0.25;
+constexpr auto kSharedTextMinLength = 64;
+constexpr auto kSharedTextsMinPrune = 1024;
 
 using ViewElement = HistoryView::Element;
 
@@ -224,6 +230,8 @@ Session::Session(not_null<Main::Session*> session)
 , _bigFileCache(Core::App().databases().get(
 	_session->local().cacheBigFilePath(),
 	_session->local().cacheBigFileSettings()))
+, _decodedImages(
+	std::make_unique<Storage::DecodedImages>(kDecodedImagesLimit))
 , _groupFreeTranscribeLevel(session->appConfig().value(
 ) | rpl::map([limits = Data::LevelLimits(session)] {
 	return limits.groupTranscribeLevelMin();
@@ -249,6 +257,7 @@ Session::Session(not_null<Main::Session*> session)
 , _reactions(std::make_unique<Reactions>(this))
 , _emojiStatuses(std::make_unique<EmojiStatuses>(this))
 , _forumIcons(std::make_unique<ForumIcons>(this))
+, _webPagePreviews(std::make_unique<WebPagePreviews>(this))
 , _notifySettings(std::make_unique<NotifySettings>(this))
 , _customEmojiManager(std::make_unique<CustomEmojiManager>(this))
 , _stories(std::make_unique<Stories>(this))
@@ -268,6 +277,19 @@ Session::Session(not_null<Main::Session*> session)
 		}
 	}
 
+	Core::App().appDeactivatedValue(
+	) | rpl::filter(rpl::mappers::_1) | rpl::start_with_next([=] {
+		const auto stats = _decodedImages->stats();
+		DEBUG_LOG(("Decoded Images: %1 hits, %2 misses, %3 evicted, "
+			"%4 images of %5 bytes, shrinking."
+			).arg(stats.hits
+			).arg(stats.misses
+			).arg(stats.evicted
+			).arg(stats.count
+			).arg(stats.size));
+		_decodedImages->shrink(kDecodedImagesInactivePart);
+	}, _lifetime);
+
 	setupMigrationViewer();
 	setupChannelLeavingViewer();
 	setupPeerNameViewer();
@@ -275,7 +297,21 @@ Session::Session(not_null<Main::Session*> session)
 
 	_chatsList.unreadStateChanges(
 	) | rpl::start_with_next([=] {
-		notifyUnreadBadgeChanged();
+		if (_session->changes().batching()) {
+			_unreadBadgeChangedAfterBatch = true;
+		} else {
+			notifyUnreadBadgeChanged();
+		}
+	}, _lifetime);
+
+	_session->changes().batchFinished(
+	) | rpl::start_with_next([=] {
+		if (base::take(_historiesChangedAfterBatch)) {
+			sendHistoryChangeNotifications();
+		}
+		if (base::take(_unreadBadgeChangedAfterBatch)) {
+			notifyUnreadBadgeChanged();
+		}
 	}, _lifetime);
 
 	_chatsFilters->changed(
@@ -1558,6 +1594,18 @@ Storage::Cache::Database &Session::cacheBigFile() {
 	return *_bigFileCache;
 }
 
+Storage::DecodedImages &Session::decodedImages() {
+	return *_decodedImages;
+}
+
+void Session::registerReusedDownload(int64 size) {
+	_reusedDownloadsSize += std::max(size, int64(0));
+}
+
+int64 Session::reusedDownloadsSize() const {
+	return _reusedDownloadsSize;
+}
+
 void Session::suggestStartExport(TimeId availableAt) {
 	_exportAvailableAt = availableAt;
 	suggestStartExport();
@@ -1888,19 +1936,16 @@ rpl::producer<GiftAuctionGot> Session::giftAuctionGots() const {
 
 HistoryItem *Session::changeMessageId(PeerId peerId, MsgId wasId, MsgId nowId) {
 	const auto list = messagesListForInsert(peerId);
-	const auto i = list->find(wasId);
-	if (i == list->end()) {
+	const auto item = list->take(wasId);
+	if (!item) {
 		return nullptr;
 	}
-	const auto item = i->second;
-	list->erase(i);
-	const auto &[j, ok] = list->emplace(nowId, item);
+	const auto ok = list->emplace(nowId, item);
 
 	if (!peerIsChannel(peerId)) {
 		if (IsServerMsgId(wasId)) {
-			const auto k = _nonChannelMessages.find(wasId);
-			Assert(k != end(_nonChannelMessages));
-			_nonChannelMessages.erase(k);
+			const auto taken = _nonChannelMessages.take(wasId);
+			Assert(taken == item);
 		}
 		if (IsServerMsgId(nowId)) {
 			_nonChannelMessages.emplace(nowId, item);
@@ -2106,6 +2151,42 @@ void Session::registerHighlightProcess(
 	Ensures(ok);
 }
 
+TextWithEntities Session::shareText(TextWithEntities &&text) {
+	if (text.text.size() < kSharedTextMinLength) {
+		return std::move(text);
+	}
+	auto &list = _sharedTexts[uint64(qHash(text.text))];
+	for (const auto &shared : list) {
+		if (shared == text) {
+			return shared;
+		}
+	}
+	list.push_back(std::move(text));
+	auto result = list.back();
+	if (_sharedTexts.size() >= std::max(
+			_sharedTextsPruneAt,
+			kSharedTextsMinPrune)) {
+		pruneSharedTexts();
+	}
+	return result;
+}
+
+void Session::pruneSharedTexts() {
+	// A string held only by the table belongs to no message any more.
+	for (auto i = begin(_sharedTexts); i != end(_sharedTexts);) {
+		auto &list = i->second;
+		list.erase(ranges::remove_if(list, [](const TextWithEntities &text) {
+			return text.text.isDetached();
+		}), end(list));
+		if (list.empty()) {
+			i = _sharedTexts.erase(i);
+		} else {
+			++i;
+		}
+	}
+	_sharedTextsPruneAt = int(_sharedTexts.size()) * 2;
+}
+
 void Session::highlightProcessDone(uint64 processId) {
 	if (const auto done = _highlightings.take(processId)) {
 		for (const auto &[id, item] : _highlightings) {
@@ -2135,6 +2216,14 @@ rpl::producer<not_null<const HistoryItem*>> Session::itemRemoved(
 	});
 }
 
+void Session::notifyMessageDeleted(FullMsgId itemId) {
+	_messageDeleted.fire_copy(itemId);
+}
+
+rpl::producer<FullMsgId> Session::messageDeleted() const {
+	return _messageDeleted.events();
+}
+
 void Session::notifyViewRemoved(not_null<const ViewElement*> view) {
 	_viewRemoved.fire_copy(view);
 }
@@ -2185,6 +2274,10 @@ rpl::producer<not_null<History*>> Session::historyChanged() const {
 }
 
 void Session::sendHistoryChangeNotifications() {
+	if (_session->changes().batching()) {
+		_historiesChangedAfterBatch = true;
+		return;
+	}
 	for (const auto &history : base::take(_historiesChanged)) {
 		_historyChanged.fire_copy(history);
 	}
@@ -2755,10 +2848,9 @@ void Session::registerMessage(not_null<HistoryItem*> item) {
 	const auto peerId = item->history()->peer->id;
 	const auto list = messagesListForInsert(peerId);
 	const auto itemId = item->id;
-	const auto i = list->find(itemId);
-	if (i != list->end()) {
+	if (const auto already = list->find(itemId)) {
 		LOG(("App Error: Trying to re-registerMessage()."));
-		i->second->destroy();
+		already->destroy();
 	}
 	list->emplace(itemId, item);
 
@@ -2829,10 +2921,10 @@ void Session::processMessagesDeleted(
 
 	auto historiesToCheck = base::flat_set<not_null<History*>>();
 	for (const auto &messageId : data) {
-		const auto i = list ? list->find(messageId.v) : Messages::iterator();
-		if (list && i != list->end()) {
-			const auto history = i->second->history();
-			i->second->destroy();
+		notifyMessageDeleted({ peerId, MsgId(messageId.v) });
+		if (const auto item = list ? list->find(messageId.v) : nullptr) {
+			const auto history = item->history();
+			item->destroy();
 			if (!history->chatListMessageKnown()) {
 				historiesToCheck.emplace(history);
 			}
@@ -2850,6 +2942,7 @@ void Session::processNonChannelMessagesDeleted(const QVector<MTPint> &data) {
 	for (const auto &messageId : data) {
 		if (const auto item = nonChannelMessage(messageId.v)) {
 			const auto history = item->history();
+			notifyMessageDeleted(item->fullId());
 			item->destroy();
 			if (!history->chatListMessageKnown()) {
 				historiesToCheck.emplace(history);
@@ -2899,10 +2992,10 @@ void Session::unregisterMessage(not_null<HistoryItem*> item) {
 			++i;
 		}
 	}
-	messagesListForInsert(peerId)->erase(itemId);
+	messagesListForInsert(peerId)->take(itemId);
 
 	if (!peerIsChannel(peerId) && IsServerMsgId(itemId)) {
-		_nonChannelMessages.erase(itemId);
+		_nonChannelMessages.take(itemId);
 	}
 }
 
@@ -2932,12 +3025,7 @@ HistoryItem *Session::message(PeerId peerId, MsgId itemId) const {
 	}
 
 	const auto data = messagesList(peerId);
-	if (!data) {
-		return nullptr;
-	}
-
-	const auto i = data->find(itemId);
-	return (i != data->end()) ? i->second.get() : nullptr;
+	return data ? data->find(itemId) : nullptr;
 }
 
 HistoryItem *Session::message(
@@ -2954,8 +3042,19 @@ HistoryItem *Session::nonChannelMessage(MsgId itemId) const {
 	if (!IsServerMsgId(itemId)) {
 		return nullptr;
 	}
-	const auto i = _nonChannelMessages.find(itemId);
-	return (i != end(_nonChannelMessages)) ? i->second.get() : nullptr;
+	return _nonChannelMessages.find(itemId);
+}
+
+auto Session::messagesIndexStats() const -> MessagesIndexStats {
+	// Items of _nonChannelMessages are in the lists of their peers.
+	auto result = MessagesIndexStats{
+		.bytes = _nonChannelMessages.memoryUsage(),
+	};
+	for (const auto &[peerId, list] : _messages) {
+		result.items += list.size();
+		result.bytes += list.memoryUsage();
+	}
+	return result;
 }
 
 void Session::updateDependentMessages(not_null<HistoryItem*> item) {
@@ -4972,14 +5071,20 @@ void Session::refreshChatListEntry(Dialogs::Key key) {
 	if (!history) {
 		return;
 	}
-	for (const auto &filter : _chatsFilters->list()) {
+	const auto &filters = _chatsFilters->list();
+	auto rules = Data::ChatFilter::Flags();
+	for (const auto &filter : filters) {
+		rules |= filter.flags();
+	}
+	const auto flags = Data::ChatFilter::HistoryFlags(history, rules);
+	for (const auto &filter : filters) {
 		const auto id = filter.id();
 		if (!id) {
 			continue;
 		}
 		const auto filterList = chatsFilters().chatsList(id);
 		auto event = ChatListEntryRefresh{ .key = key, .filterId = id };
-		if (filter.contains(history)) {
+		if (filter.contains(history, flags)) {
 			event.existenceChanged = !entry->inChatList(id);
 			if (event.existenceChanged) {
 				entry->addToChatList(id, filterList);
@@ -5366,6 +5471,7 @@ rpl::producer<RecentJoinChat> Session::recentJoinChat() const {
 }
 
 void Session::clearLocalStorage() {
+	_decodedImages->clear();
 	_cache->close();
 	_cache->clear();
 	_bigFileCache->close();
@@ -12,6 +12,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_groups.h"
 #include "data/data_cloud_file.h"
 #include "data/data_star_gift.h"
+#include "data/data_messages_index.h"
 #include "history/history_location_manager.h"
 #include "base/timer.h"
 
@@ -45,6 +46,10 @@ namespace Passport {
 struct SavedCredentials;
 } // namespace Passport
 
+namespace Storage {
+class DecodedImages;
+} // namespace Storage
+
 namespace Iv {
 class Data;
 } // namespace Iv
@@ -59,6 +64,7 @@ class SendActionManager;
 class Reactions;
 class EmojiStatuses;
 class ForumIcons;
+class WebPagePreviews;
 class ChatFilters;
 class CloudThemes;
 class Streaming;
@@ -195,6 +201,9 @@ public:
 	[[nodiscard]] ForumIcons &forumIcons() const {
 		return *_forumIcons;
 	}
+	[[nodiscard]] WebPagePreviews &webPagePreviews() const {
+		return *_webPagePreviews;
+	}
 	[[nodiscard]] NotifySettings &notifySettings() const {
 		return *_notifySettings;
 	}
@@ -239,6 +248,11 @@ public:
 
 	[[nodiscard]] Storage::Cache::Database &cache();
 	[[nodiscard]] Storage::Cache::Database &cacheBigFile();
+	[[nodiscard]] Storage::DecodedImages &decodedImages();
+
+	// Bytes not downloaded again, because the file was already saved.
+	void registerReusedDownload(int64 size);
+	[[nodiscard]] int64 reusedDownloadsSize() const;
 
 	[[nodiscard]] not_null<PeerData*> peer(PeerId id);
 	[[nodiscard]] not_null<PeerData*> peer(UserId id) = delete;
@@ -388,6 +402,10 @@ public:
 	[[nodiscard]] rpl::producer<not_null<const HistoryItem*>> itemRemoved() const;
 	[[nodiscard]] rpl::producer<not_null<const HistoryItem*>> itemRemoved(
 		FullMsgId itemId) const;
+	// Messages deleted on the server, loaded or not. Unlike itemRemoved()
+	// it doesn't fire for items destroyed when their history is unloaded.
+	void notifyMessageDeleted(FullMsgId itemId);
+	[[nodiscard]] rpl::producer<FullMsgId> messageDeleted() const;
 	void notifyViewRemoved(not_null<const ViewElement*> view);
 	[[nodiscard]] rpl::producer<not_null<const ViewElement*>> viewRemoved() const;
 	void notifyHistoryCleared(not_null<const History*> history);
@@ -424,6 +442,10 @@ public:
 		uint64 processId,
 		not_null<HistoryItem*> item);
 
+	// Equal message texts share their string and entities buffers, the
+	// Qt implicit sharing detaches the copy of a message that is edited.
+	[[nodiscard]] TextWithEntities shareText(TextWithEntities &&text);
+
 	void registerHeavyViewPart(not_null<ViewElement*> view);
 	void unregisterHeavyViewPart(not_null<ViewElement*> view);
 	void unloadHeavyViewParts(
@@ -547,6 +569,12 @@ public:
 
 	[[nodiscard]] HistoryItem *nonChannelMessage(MsgId itemId) const;
 
+	struct MessagesIndexStats {
+		int items = 0;
+		int64 bytes = 0;
+	};
+	[[nodiscard]] MessagesIndexStats messagesIndexStats() const;
+
 	void updateDependentMessages(not_null<HistoryItem*> item);
 	void registerDependentMessage(
 		not_null<HistoryItem*> dependent,
@@ -919,7 +947,7 @@ public:
 	void clearLocalStorage();
 
 private:
-	using Messages = std::unordered_map<MsgId, not_null<HistoryItem*>>;
+	using Messages = MessagesIndex;
 
 	struct NextToUpgradeGift {
 		std::optional<Data::SavedStarGift> gift;
@@ -937,6 +965,7 @@ private:
 
 	void checkSelfDestructItems();
 	void checkLocalUsersWentOffline();
+	void pruneSharedTexts();
 
 	void scheduleNextTTLs();
 	void checkTTLs();
@@ -1066,6 +1095,8 @@ private:
 
 	Storage::DatabasePointer _cache;
 	Storage::DatabasePointer _bigFileCache;
+	const std::unique_ptr<Storage::DecodedImages> _decodedImages;
+	int64 _reusedDownloadsSize = 0;
 
 	TimeId _exportAvailableAt = 0;
 	base::weak_qptr<Ui::BoxContent> _exportSuggestion;
@@ -1092,6 +1123,7 @@ private:
 	rpl::event_stream<not_null<HistoryItem*>> _itemTextRefreshRequest;
 	rpl::event_stream<not_null<HistoryItem*>> _itemDataChanges;
 	rpl::event_stream<not_null<const HistoryItem*>> _itemRemoved;
+	rpl::event_stream<FullMsgId> _messageDeleted;
 	rpl::event_stream<not_null<const ViewElement*>> _viewRemoved;
 	rpl::event_stream<not_null<const ViewElement*>> _viewPaidReactionSent;
 	rpl::event_stream<not_null<Calls::GroupCall*>> _callPaidReactionSent;
@@ -1099,11 +1131,13 @@ private:
 	rpl::event_stream<not_null<const History*>> _historyCleared;
 	base::flat_set<not_null<History*>> _historiesChanged;
 	rpl::event_stream<not_null<History*>> _historyChanged;
+	bool _historiesChangedAfterBatch = false;
 	rpl::event_stream<MegagroupParticipant> _megagroupParticipantRemoved;
 	rpl::event_stream<MegagroupParticipant> _megagroupParticipantAdded;
 	rpl::event_stream<DialogsRowReplacement> _dialogsRowReplacements;
 	rpl::event_stream<ChatListEntryRefresh> _chatListEntryRefreshes;
 	rpl::event_stream<> _unreadBadgeChanges;
+	bool _unreadBadgeChangedAfterBatch = false;
 	rpl::event_stream<RepliesReadTillUpdate> _repliesReadTillUpdates;
 	rpl::event_stream<SublistReadTillUpdate> _sublistReadTillUpdates;
 	rpl::event_stream<SentToScheduled> _sentToScheduled;
@@ -1121,7 +1155,7 @@ private:
 	std::map<TimeId, base::flat_set<not_null<HistoryItem*>>> _ttlMessages;
 	base::Timer _ttlCheckTimer;
 
-	std::unordered_map<MsgId, not_null<HistoryItem*>> _nonChannelMessages;
+	Messages _nonChannelMessages;
 
 	base::flat_map<uint64, FullMsgId> _messageByRandomId;
 	base::flat_map<uint64, SentData> _sentMessagesData;
@@ -1185,6 +1219,8 @@ private:
 		FullStoryId,
 		base::flat_set<not_null<HistoryItem*>>> _storyItems;
 	base::flat_map<uint64, not_null<HistoryItem*>> _highlightings;
+	std::unordered_map<uint64, std::vector<TextWithEntities>> _sharedTexts;
+	int _sharedTextsPruneAt = 0;
 	base::flat_map<QString, not_null<DocumentData*>> _venueIcons;
 
 	base::flat_set<not_null<WebPageData*>> _webpagesUpdated;
@@ -1270,6 +1306,7 @@ private:
 	const std::unique_ptr<Reactions> _reactions;
 	const std::unique_ptr<EmojiStatuses> _emojiStatuses;
 	const std::unique_ptr<ForumIcons> _forumIcons;
+	const std::unique_ptr<WebPagePreviews> _webPagePreviews;
 	const std::unique_ptr<NotifySettings> _notifySettings;
 	const std::unique_ptr<CustomEmojiManager> _customEmojiManager;
 	const std::unique_ptr<Stories> _stories;
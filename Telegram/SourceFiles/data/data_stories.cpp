@@ -2574,7 +2574,39 @@ void Stories::continuePreloading() {
 		return;
 	} else if (const auto maybeStory = lookup(id)) {
 		startPreloading(*maybeStory);
+	} else if (maybeStory.error() == NoStory::Unknown) {
+		resolvePreloadIds(id);
+	} else {
+		preloadFinished(id, true);
+	}
+}
+
+void Stories::resolvePreloadIds(FullStoryId next) {
+	if (_preloadResolving == next) {
+		return;
+	}
+	_preloadResolving = next;
+
+	// Ask for all the unknown stories in the preload queue together, so
+	// that they're sent in a few stories.getStoriesByID requests instead
+	// of one request for each source as the preloading reaches it.
+	const auto hidden = static_cast<int>(StorySourcesList::Hidden);
+	const auto main = static_cast<int>(StorySourcesList::NotHidden);
+	const auto all = ranges::views::concat(
+		_toPreloadViewer,
+		_toPreloadSources[hidden],
+		_toPreloadSources[main]);
+	for (const auto &id : all) {
+		if (id != next) {
+			resolve(id, nullptr);
+		}
 	}
+	resolve(next, [=] {
+		if (_preloadResolving == next) {
+			_preloadResolving = FullStoryId();
+			continuePreloading();
+		}
+	});
 }
 
 bool Stories::shouldContinuePreload(FullStoryId id) const {
@@ -377,6 +377,7 @@ private:
 	void continuePreloading();
 	[[nodiscard]] bool shouldContinuePreload(FullStoryId id) const;
 	[[nodiscard]] FullStoryId nextPreloadId() const;
+	void resolvePreloadIds(FullStoryId next);
 	void startPreloading(not_null<Story*> story);
 	void preloadFinished(FullStoryId id, bool markAsPreloaded = false);
 	void preloadListsMore();
@@ -470,6 +471,7 @@ private:
 	std::vector<FullStoryId> _toPreloadSources[kStorySourcesListCount];
 	std::vector<FullStoryId> _toPreloadViewer;
 	std::unique_ptr<StoryPreload> _preloading;
+	FullStoryId _preloadResolving;
 	int _preloadingHiddenSourcesCounter = 0;
 	int _preloadingMainSourcesCounter = 0;
 
@@ -22,6 +22,8 @@ constexpr auto kAudioAlbumThumbCacheTag = 0x0000000000000300ULL;
 constexpr auto kWebDocumentCacheTag = 0x0000020000000000ULL;
 constexpr auto kUrlCacheTag = 0x0000030000000000ULL;
 constexpr auto kGeoPointCacheTag = 0x0000040000000000ULL;
+constexpr auto kWebPagePreviewCacheTag = 0x0000050000000000ULL;
+constexpr auto kInlineResultsCacheTag = 0x0000060000000000ULL;
 
 } // namespace
 
@@ -74,6 +76,28 @@ Storage::Cache::Key UrlCacheKey(const QString &location) {
 	};
 }
 
+Storage::Cache::Key WebPagePreviewCacheKey(const QString &link) {
+	const auto key = UrlCacheKey(link);
+	return Storage::Cache::Key{
+		Data::kWebPagePreviewCacheTag | (key.high & 0xFFFFFFFFFFULL),
+		key.low
+	};
+}
+
+Storage::Cache::Key InlineResultsCacheKey(
+		PeerId botId,
+		PeerId peerId,
+		const QString &query) {
+	const auto key = UrlCacheKey(u"%1:%2:%3"_q
+		.arg(botId.value)
+		.arg(peerId.value)
+		.arg(query));
+	return Storage::Cache::Key{
+		Data::kInlineResultsCacheTag | (key.high & 0xFFFFFFFFFFULL),
+		key.low
+	};
+}
+
 Storage::Cache::Key GeoPointCacheKey(const GeoPointLocation &location) {
 	const auto zoomscale = ((uint32(location.zoom) & 0x0FU) << 8)
 		| (uint32(location.scale) & 0x0FU);
@@ -7,6 +7,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "data/data_unread_value.h"
 
+#include "base/timer.h"
 #include "core/application.h"
 #include "core/core_settings.h"
 #include "data/data_chat_filters.h"
@@ -20,11 +21,24 @@ namespace {
 
 rpl::producer<Dialogs::UnreadState> MainListUnreadState(
 		not_null<Dialogs::MainList*> list) {
-	return rpl::single(rpl::empty) | rpl::then(
-		list->unreadStateChanges() | rpl::to_empty
-	) | rpl::map([=] {
-		return list->unreadState();
-	});
+	return [=](auto consumer) {
+		auto result = rpl::lifetime();
+
+		// A burst of incoming messages changes the state once per chat,
+		// the value is sent once in the next event loop iteration.
+		const auto timer = result.make_state<base::Timer>([=] {
+			consumer.put_next(list->unreadState());
+		});
+		list->unreadStateChanges(
+		) | rpl::start_with_next([=] {
+			if (!timer->isActive()) {
+				timer->callOnce(0);
+			}
+		}, result);
+
+		consumer.put_next(list->unreadState());
+		return result;
+	};
 }
 
 } // namespace
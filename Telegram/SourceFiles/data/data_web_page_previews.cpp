@@ -0,0 +1,213 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "data/data_web_page_previews.h"
+
+#include "base/unixtime.h"
+#include "data/data_session.h"
+#include "data/data_web_page.h"
+#include "main/main_session.h"
+#include "storage/cache/storage_cache_database.h"
+
+#include <QtCore/QDataStream>
+
+namespace Data {
+namespace {
+
+constexpr auto kLocalLifetime = TimeId(24 * 60 * 60);
+constexpr auto kEmptyLifetime = TimeId(60 * 60);
+
+[[nodiscard]] QByteArray Serialize(const MTPWebPage &page) {
+	auto counter = ::tl::details::LengthCounter();
+	page.write(counter);
+	auto buffer = mtpBuffer();
+	buffer.reserve(counter.length);
+	page.write(buffer);
+	return QByteArray(
+		reinterpret_cast<const char*>(buffer.constData()),
+		buffer.size() * sizeof(buffer.front()));
+}
+
+[[nodiscard]] std::optional<MTPWebPage> Deserialize(const QByteArray &bytes) {
+	if (bytes.isEmpty() || (bytes.size() % sizeof(mtpPrime))) {
+		return std::nullopt;
+	}
+	auto from = reinterpret_cast<const mtpPrime*>(bytes.constData());
+	const auto till = from + (bytes.size() / sizeof(mtpPrime));
+	auto result = MTPWebPage();
+	return result.read(from, till)
+		? std::make_optional(result)
+		: std::nullopt;
+}
+
+} // namespace
+
+WebPagePreviews::WebPagePreviews(not_null<Session*> owner)
+: _owner(owner)
+, _api(&owner->session().mtp()) {
+}
+
+WebPagePreviews::~WebPagePreviews() = default;
+
+std::optional<WebPageData*> WebPagePreviews::lookup(
+		const QString &link) const {
+	const auto i = _cache.find(link);
+	if (i == end(_cache)) {
+		return std::nullopt;
+	}
+	const auto &entry = i->second;
+	if (entry.page) {
+		return entry.page->failed ? nullptr : entry.page;
+	} else if (entry.till <= base::unixtime::now()) {
+		return std::nullopt;
+	}
+	return nullptr;
+}
+
+void WebPagePreviews::request(const QString &link, bool force) {
+	if (!force && lookup(link)) {
+		crl::on_main(this, [=] {
+			_resolved.fire_copy(link);
+		});
+		return;
+	}
+	auto &request = _requests[link];
+	++request.waiting;
+	if (request.id || request.local) {
+		return;
+	} else if (force) {
+		send(link);
+	} else {
+		readLocal(link);
+	}
+}
+
+void WebPagePreviews::cancel(const QString &link) {
+	const auto i = _requests.find(link);
+	if (i == end(_requests) || --i->second.waiting > 0) {
+		return;
+	}
+	// A local read still fills the cache when it finishes.
+	_api.request(i->second.id).cancel();
+	_requests.erase(i);
+}
+
+void WebPagePreviews::readLocal(const QString &link) {
+	_requests[link].local = true;
+	const auto weak = base::make_weak(this);
+	_owner->cache().get(WebPagePreviewCacheKey(link), [=](
+			QByteArray &&value) {
+		crl::on_main(weak, [=, value = std::move(value)] {
+			applyLocal(link, value);
+		});
+	});
+}
+
+void WebPagePreviews::applyLocal(
+		const QString &link,
+		const QByteArray &serialized) {
+	const auto i = _requests.find(link);
+	if (i != end(_requests)) {
+		i->second.local = false;
+	}
+
+	QDataStream stream(serialized);
+	stream.setVersion(QDataStream::Qt_5_1);
+	auto layer = qint32();
+	auto saved = qint32();
+	auto bytes = QByteArray();
+	stream >> layer >> saved >> bytes;
+	const auto now = base::unixtime::now();
+	const auto good = (stream.status() == QDataStream::Ok)
+		&& (layer == MTP::details::kCurrentLayer);
+	if (good && bytes.isEmpty()) {
+		if (saved + kEmptyLifetime > now) {
+			finish(link, nullptr, saved + kEmptyLifetime);
+			return;
+		}
+	} else if (good && saved + kLocalLifetime > now) {
+		if (const auto data = Deserialize(bytes)) {
+			const auto page = _owner->processWebpage(*data);
+			if (!page->failed && !page->pendingTill) {
+				finish(link, page.get());
+				return;
+			}
+		}
+	}
+	if (i != end(_requests)) {
+		send(link);
+	}
+}
+
+void WebPagePreviews::send(const QString &link) {
+	_requests[link].id = _api.request(MTPmessages_GetWebPagePreview(
+		MTP_flags(0),
+		MTP_string(link),
+		MTPVector<MTPMessageEntity>()
+	)).done([=](const MTPmessages_WebPagePreview &result) {
+		const auto &data = result.data();
+		_owner->processUsers(data.vusers());
+		data.vmedia().match([&](const MTPDmessageMediaWebPage &data) {
+			const auto page = _owner->processWebpage(data.vwebpage());
+			if (page->pendingTill > 0
+				&& page->pendingTill < base::unixtime::now()) {
+				page->pendingTill = 0;
+				page->failed = true;
+			}
+			if (page->failed) {
+				writeLocal(link, nullptr);
+				finish(link, nullptr);
+			} else {
+				if (!page->pendingTill) {
+					writeLocal(link, &data.vwebpage());
+				}
+				finish(link, page.get());
+			}
+		}, [&](const auto &) {
+			writeLocal(link, nullptr);
+			finish(link, nullptr);
+		});
+	}).fail([=] {
+		// Not written to the disk, may be a temporary error.
+		finish(link, nullptr);
+	}).send();
+}
+
+void WebPagePreviews::finish(
+		const QString &link,
+		WebPageData *page,
+		TimeId emptyTill) {
+	_cache[link] = Entry{
+		.page = page,
+		.till = (page
+			? TimeId()
+			: emptyTill
+			? emptyTill
+			: (base::unixtime::now() + kEmptyLifetime)),
+	};
+	_requests.remove(link);
+	_resolved.fire_copy(link);
+}
+
+void WebPagePreviews::writeLocal(
+		const QString &link,
+		const MTPWebPage *page) {
+	auto result = QByteArray();
+	{
+		QDataStream stream(&result, QIODevice::WriteOnly);
+		stream.setVersion(QDataStream::Qt_5_1);
+		stream
+			<< qint32(MTP::details::kCurrentLayer)
+			<< qint32(base::unixtime::now())
+			<< (page ? Serialize(*page) : QByteArray());
+	}
+	_owner->cache().put(
+		WebPagePreviewCacheKey(link),
+		Storage::Cache::Database::TaggedValue(std::move(result), 0));
+}
+
+} // namespace Data
@@ -0,0 +1,68 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/weak_ptr.h"
+#include "mtproto/sender.h"
+
+class WebPageData;
+
+namespace Data {
+
+class Session;
+
+// Link previews shared by all the compose fields of the session.
+// A link is requested once even when several fields wait for it, the
+// results are kept in the cache database for a while, including the
+// links that have no preview.
+class WebPagePreviews final : public base::has_weak_ptr {
+public:
+	explicit WebPagePreviews(not_null<Session*> owner);
+	~WebPagePreviews();
+
+	// std::nullopt if not known yet, nullptr if there is no preview.
+	[[nodiscard]] std::optional<WebPageData*> lookup(
+		const QString &link) const;
+	[[nodiscard]] rpl::producer<QString> resolved() const {
+		return _resolved.events();
+	}
+
+	// With force the cached result is ignored, for pending pages.
+	void request(const QString &link, bool force = false);
+	void cancel(const QString &link);
+
+private:
+	struct Entry {
+		WebPageData *page = nullptr;
+		TimeId till = 0; // Only for the links without a preview.
+	};
+	struct Request {
+		mtpRequestId id = 0;
+		int waiting = 0;
+		bool local = false;
+	};
+
+	void readLocal(const QString &link);
+	void applyLocal(const QString &link, const QByteArray &serialized);
+	void send(const QString &link);
+	void finish(
+		const QString &link,
+		WebPageData *page,
+		TimeId emptyTill = 0);
+	void writeLocal(const QString &link, const MTPWebPage *page);
+
+	const not_null<Session*> _owner;
+	MTP::Sender _api;
+
+	base::flat_map<QString, Entry> _cache;
+	base::flat_map<QString, Request> _requests;
+	rpl::event_stream<QString> _resolved;
+
+};
+
+} // namespace Data
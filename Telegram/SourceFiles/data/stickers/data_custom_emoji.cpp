@@ -46,6 +46,10 @@ namespace Data {
 namespace {
 
 constexpr auto kMaxPerRequest = 100;
+
+// Frame durations of animated emoji differ by a few milliseconds, the
+// ones falling into the same tick are repainted together.
+constexpr auto kRepaintTick = crl::time(8);
 #if 0 // inject-to-on_main
 constexpr auto kUnsubscribeUpdatesDelay = 3 * crl::time(1000);
 #endif
@@ -878,7 +882,8 @@ void CustomEmojiManager::requestFinished() {
 void CustomEmojiManager::repaintLater(
 		not_null<Ui::CustomEmoji::Instance*> instance,
 		Ui::CustomEmoji::RepaintRequest request) {
-	auto &bunch = _repaints[request.duration];
+	const auto tick = (request.duration + kRepaintTick - 1) / kRepaintTick;
+	auto &bunch = _repaints[tick];
 	if (bunch.when > 0) {
 		for (const auto &already : bunch.instances) {
 			if (already.get() == instance) {
@@ -170,7 +170,7 @@ private:
 
 	uint64 _coloredSetId = 0;
 
-	base::flat_map<crl::time, RepaintBunch> _repaints;
+	base::flat_map<crl::time, RepaintBunch> _repaints; // By frame tick.
 	crl::time _repaintNext = 0;
 	base::Timer _repaintTimer;
 	bool _repaintTimerScheduled = false;
@@ -21,6 +21,8 @@ IndexedList::IndexedList(SortMode sortMode, FilterId filterId)
 }
 
 RowsByLetter IndexedList::addToEnd(Key key) {
+	forgetFiltered();
+
 	if (const auto row = _list.getRow(key)) {
 		return { row };
 	}
@@ -37,6 +39,8 @@ RowsByLetter IndexedList::addToEnd(Key key) {
 }
 
 Row *IndexedList::addByName(Key key) {
+	forgetFiltered();
+
 	if (const auto row = _list.getRow(key)) {
 		return row;
 	}
@@ -53,6 +57,7 @@ Row *IndexedList::addByName(Key key) {
 }
 
 void IndexedList::adjustByDate(const RowsByLetter &links) {
+	forgetFiltered();
 	_list.adjustByDate(links.main);
 	for (const auto &[ch, row] : links.letters) {
 		if (auto it = _index.find(ch); it != _index.cend()) {
@@ -70,6 +75,7 @@ bool IndexedList::updateHeight(Key key, float64 narrowRatio) {
 }
 
 void IndexedList::moveToTop(Key key) {
+	forgetFiltered();
 	if (_list.moveToTop(key)) {
 		for (const auto &ch : key.entry()->chatListFirstLetters()) {
 			if (auto it = _index.find(ch); it != _index.cend()) {
@@ -80,6 +86,7 @@ void IndexedList::moveToTop(Key key) {
 }
 
 void IndexedList::movePinned(Row *row, int deltaSign) {
+	forgetFiltered();
 	auto swapPinnedIndexWith = find(row);
 	Assert(swapPinnedIndexWith != cend());
 	if (deltaSign > 0) {
@@ -99,6 +106,8 @@ void IndexedList::peerNameChanged(
 		const base::flat_set<QChar> &oldLetters) {
 	Expects(_sortMode != SortMode::Date);
 
+	forgetFiltered();
+
 	if (const auto history = peer->owner().historyLoaded(peer)) {
 		if (_sortMode == SortMode::Name) {
 			adjustByName(history, oldLetters);
@@ -114,6 +123,8 @@ void IndexedList::peerNameChanged(
 		const base::flat_set<QChar> &oldLetters) {
 	Expects(_sortMode == SortMode::Date);
 
+	forgetFiltered();
+
 	if (const auto history = peer->owner().historyLoaded(peer)) {
 		adjustNames(filterId, history, oldLetters);
 	}
@@ -195,6 +206,7 @@ void IndexedList::adjustNames(
 }
 
 void IndexedList::remove(Key key, Row *replacedBy) {
+	forgetFiltered();
 	if (_list.remove(key, replacedBy)) {
 		for (const auto &ch : key.entry()->chatListFirstLetters()) {
 			if (const auto it = _index.find(ch); it != _index.cend()) {
@@ -205,36 +217,54 @@ void IndexedList::remove(Key key, Row *replacedBy) {
 }
 
 void IndexedList::clear() {
+	forgetFiltered();
 	_list.clear();
 	_index.clear();
 }
 
-std::vector<not_null<Row*>> IndexedList::filtered(
-		const QStringList &words) const {
-	const auto minimal = [&]() -> const Dialogs::List* {
-		if (empty()) {
+void IndexedList::forgetFiltered() {
+	_lastFiltered = std::nullopt;
+}
+
+const List *IndexedList::minimalFiltered(const QStringList &words) const {
+	if (empty()) {
+		return nullptr;
+	}
+	auto result = (const Dialogs::List*)nullptr;
+	for (const auto &word : words) {
+		if (word.isEmpty()) {
+			continue;
+		}
+		const auto found = filtered(word[0]);
+		if (!found || found->empty()) {
 			return nullptr;
+		} else if (!result || result->size() > found->size()) {
+			result = found;
 		}
-		auto result = (const Dialogs::List*)nullptr;
-		for (const auto &word : words) {
-			if (word.isEmpty()) {
-				continue;
-			}
-			const auto found = filtered(word[0]);
-			if (!found || found->empty()) {
-				return nullptr;
-			} else if (!result || result->size() > found->size()) {
-				result = found;
-			}
+	}
+	return result;
+}
+
+auto IndexedList::lastFiltered(const QStringList &words) const
+-> const std::vector<not_null<Row*>>* {
+	if (!_lastFiltered) {
+		return nullptr;
+	}
+	// Each of the previous words must be a prefix of one of the new ones.
+	for (const auto &was : _lastFiltered->words) {
+		const auto extended = ranges::any_of(words, [&](const QString &now) {
+			return now.startsWith(was);
+		});
+		if (!extended) {
+			return nullptr;
 		}
-		return result;
-	}();
-	auto result = std::vector<not_null<Row*>>();
-	if (!minimal || minimal->empty()) {
-		return result;
 	}
-	result.reserve(minimal->size());
-	for (const auto &row : *minimal) {
+	return &_lastFiltered->rows;
+}
+
+std::vector<not_null<Row*>> IndexedList::filtered(
+		const QStringList &words) const {
+	const auto matches = [&](not_null<Row*> row) {
 		const auto &nameWords = row->entry()->chatListNameWords();
 		const auto found = [&](const QString &word) {
 			for (const auto &name : nameWords) {
@@ -244,18 +274,29 @@ std::vector<not_null<Row*>> IndexedList::filtered(
 			}
 			return false;
 		};
-		const auto allFound = [&] {
-			for (const auto &word : words) {
-				if (!found(word)) {
-					return false;
-				}
+		for (const auto &word : words) {
+			if (!found(word)) {
+				return false;
+			}
+		}
+		return true;
+	};
+	auto result = std::vector<not_null<Row*>>();
+	if (const auto last = lastFiltered(words)) {
+		for (const auto &row : *last) {
+			if (matches(row)) {
+				result.push_back(row);
+			}
+		}
+	} else if (const auto minimal = minimalFiltered(words)) {
+		result.reserve(minimal->size());
+		for (const auto &row : *minimal) {
+			if (matches(row)) {
+				result.push_back(row);
 			}
-			return true;
-		}();
-		if (allFound) {
-			result.push_back(row);
 		}
 	}
+	_lastFiltered = LastFiltered{ words, result };
 	return result;
 }
 
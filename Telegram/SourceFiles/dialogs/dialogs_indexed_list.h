@@ -85,6 +85,17 @@ public:
 	[[nodiscard]] iterator findByY(int y) { return all().findByY(y); }
 
 private:
+	struct LastFiltered {
+		QStringList words;
+		std::vector<not_null<Row*>> rows;
+	};
+
+	[[nodiscard]] const List *minimalFiltered(
+		const QStringList &words) const;
+	[[nodiscard]] const std::vector<not_null<Row*>> *lastFiltered(
+		const QStringList &words) const;
+	void forgetFiltered();
+
 	void adjustByName(
 		Key key,
 		const base::flat_set<QChar> &oldChars);
@@ -98,6 +109,10 @@ private:
 	List _list, _empty;
 	base::flat_map<QChar, List> _index;
 
+	// Typing a query only adds letters, so the next result is found
+	// among the rows of the previous one. Forgotten on any change.
+	mutable std::optional<LastFiltered> _lastFiltered;
+
 };
 
 } // namespace Dialogs
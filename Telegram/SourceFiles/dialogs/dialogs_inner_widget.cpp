@@ -11,6 +11,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "dialogs/ui/chat_search_empty.h"
 #include "dialogs/ui/chat_search_in.h"
 #include "dialogs/ui/dialogs_layout.h"
+#include "dialogs/ui/dialogs_message_view.h"
 #include "dialogs/ui/dialogs_video_userpic.h"
 #include "dialogs/dialogs_indexed_list.h"
 #include "dialogs/dialogs_widget.h"
@@ -52,6 +53,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_message_reactions.h"
 #include "data/data_saved_messages.h"
 #include "data/data_saved_sublist.h"
+#include "data/data_thread.h"
 #include "data/data_stories.h"
 #include "data/stickers/data_stickers.h"
 #include "data/data_send_action.h"
@@ -303,8 +305,13 @@ InnerWidget::InnerWidget(
 		}
 	}, lifetime());
 
+	// Each finished file part fires this, only repaint if it may be
+	// a userpic or a preview thumbnail of a painted row, the next paint
+	// checks them again.
 	session().downloaderTaskFinished(
-	) | rpl::start_with_next([=] {
+	) | rpl::filter([=] {
+		return base::take(_imagesLoading);
+	}) | rpl::start_with_next([=] {
 		update();
 	}, lifetime());
 
@@ -970,6 +977,10 @@ void InnerWidget::paintEvent(QPaintEvent *e) {
 			&& _selectedTopicJump
 			&& (!_pressed || _pressedTopicJump);
 		Ui::RowPainter::Paint(p, row, validateVideoUserpic(row), context);
+		trackUserpicLoading(row);
+		if (const auto thread = row->thread()) {
+			trackPreviewLoading(thread->lastItemDialogsView());
+		}
 		if (context.quickActionContext) {
 			context.quickActionContext = nullptr;
 		}
@@ -1276,6 +1287,8 @@ void InnerWidget::paintEvent(QPaintEvent *e) {
 						.narrow = (fullWidth < st::columnMinimalWidthLeft / 2),
 						.displayUnreadInfo = showUnreadInSearchResults,
 					});
+					trackUserpicLoading(result.get());
+					trackPreviewLoading(result->itemView());
 					p.translate(0, _st->height);
 				}
 			}
@@ -1354,6 +1367,8 @@ void InnerWidget::paintEvent(QPaintEvent *e) {
 						.narrow = (fullWidth < st::columnMinimalWidthLeft / 2),
 						.displayUnreadInfo = showUnreadInSearchResults,
 					});
+					trackUserpicLoading(result.get());
+					trackPreviewLoading(result->itemView());
 					p.translate(0, _st->height);
 				}
 			}
@@ -1440,6 +1455,18 @@ Ui::VideoUserpic *InnerWidget::validateVideoUserpic(
 	)).first->second.get();
 }
 
+void InnerWidget::trackUserpicLoading(not_null<const BasicRow*> row) {
+	if (!_imagesLoading && ::Ui::PeerUserpicLoading(row->userpicView())) {
+		_imagesLoading = true;
+	}
+}
+
+void InnerWidget::trackPreviewLoading(const Ui::MessageView &view) {
+	if (!_imagesLoading && view.loadingPreview()) {
+		_imagesLoading = true;
+	}
+}
+
 void InnerWidget::paintCollapsedRows(Painter &p, QRect clip) const {
 	auto index = 0;
 	const auto rowHeight = st::dialogsImportantBarHeight;
@@ -1532,6 +1559,7 @@ void InnerWidget::paintPeerSearchResult(
 		context.st->padding.top(),
 		width(),
 		context.st->photoSize);
+	trackUserpicLoading(&result->row);
 
 	auto nameleft = context.st->nameLeft;
 	auto available = context.width - nameleft - context.st->padding.right();
@@ -67,6 +67,7 @@ struct ReactionId;
 namespace Dialogs::Ui {
 using namespace ::Ui;
 class VideoUserpic;
+class MessageView;
 struct PaintContext;
 struct TopicJumpCache;
 } // namespace Dialogs::Ui
@@ -471,6 +472,8 @@ private:
 
 	Ui::VideoUserpic *validateVideoUserpic(not_null<Row*> row);
 	Ui::VideoUserpic *validateVideoUserpic(not_null<History*> history);
+	void trackUserpicLoading(not_null<const BasicRow*> row);
+	void trackPreviewLoading(const Ui::MessageView &view);
 
 	Row *shownRowByKey(Key key);
 	void clearSearchResults(bool alsoPeerSearchResults = true);
@@ -538,6 +541,9 @@ private:
 	std::vector<std::unique_ptr<CollapsedRow>> _collapsedRows;
 	not_null<const style::DialogRow*> _st;
 	mutable std::unique_ptr<Ui::TopicJumpCache> _topicJumpCache;
+
+	// Some of the painted userpics or preview thumbnails wait for a download.
+	bool _imagesLoading = false;
 	bool _selectedChatTypeFilter = false;
 	bool _pressedChatTypeFilter = false;
 	bool _selectedMorePosts = false;
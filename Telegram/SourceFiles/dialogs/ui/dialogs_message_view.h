@@ -66,6 +66,11 @@ public:
 		Fn<void()> customEmojiRepaint,
 		ToPreviewOptions options);
 
+	// Preview thumbnails still wait for the downloader.
+	[[nodiscard]] bool loadingPreview() const {
+		return _loadingContext != nullptr;
+	}
+
 	void paint(
 		Painter &p,
 		const QRect &geometry,
@@ -35,7 +35,9 @@ Scene::Scene(const QRectF &rect)
 	_canvas->grabContentRequests(
 	) | rpl::start_with_next([=](ItemCanvas::Content &&content) {
 		const auto item = std::make_shared<ItemLine>(
-			std::move(content.pixmap));
+			std::move(content.pixmap),
+			content.size,
+			std::move(content.stroke));
 		item->setPos(content.position);
 		addItem(item);
 		_canvas->setZValue(++_lastLineZ);
@@ -125,6 +127,7 @@ std::shared_ptr<float64> Scene::lastZ() const {
 }
 
 void Scene::updateZoom(float64 zoom) {
+	_canvas->setZoom(zoom);
 	for (const auto &item : items()) {
 		if (item->type() >= ItemBase::Type) {
 			static_cast<ItemBase*>(item.get())->updateZoom(zoom);
@@ -81,14 +81,31 @@ ItemCanvas::ItemCanvas() {
 	setAcceptedMouseButtons({});
 }
 
+void ItemCanvas::setZoom(float64 zoom) {
+	const auto resolution = std::clamp(zoom, 0.01, 1.)
+		* style::DevicePixelRatio();
+	if (_resolution != resolution) {
+		_resolution = resolution;
+		if (!_drawing) {
+			clearPixmap();
+		}
+	}
+}
+
 void ItemCanvas::clearPixmap() {
 	_hq = nullptr;
 	_p = nullptr;
 
+	// Large photos are shown scaled down, a canvas of their full size
+	// would be allocated and composited for each stroke.
+	if (!_resolution) {
+		_resolution = style::DevicePixelRatio();
+	}
 	_pixmap = QPixmap(
-		(scene()->sceneRect().size() * style::DevicePixelRatio()).toSize());
-	_pixmap.setDevicePixelRatio(style::DevicePixelRatio());
+		(scene()->sceneRect().size() * _resolution).toSize());
+	_pixmap.setDevicePixelRatio(_resolution);
 	_pixmap.fill(Qt::transparent);
+	_points.clear();
 
 	_p = std::make_unique<Painter>(&_pixmap);
 	_hq = std::make_unique<PainterHighQualityEnabler>(*_p);
@@ -140,6 +157,7 @@ void ItemCanvas::drawLine(
 	for (const auto &point : points) {
 		_p->drawEllipse(point, halfBrushSize, halfBrushSize);
 	}
+	_points.insert(end(_points), begin(points), end(points));
 }
 
 void ItemCanvas::handleMousePressEvent(
@@ -169,15 +187,28 @@ void ItemCanvas::handleMouseReleaseEvent(
 	_drawing = false;
 
 	if (_contentRect.isValid()) {
+		// The zoom may change while drawing, the pixmap keeps its ratio.
+		const auto ratio = _pixmap.devicePixelRatio();
 		const auto scaledContentRect = QRectF(
-			_contentRect.x() * style::DevicePixelRatio(),
-			_contentRect.y() * style::DevicePixelRatio(),
-			_contentRect.width() * style::DevicePixelRatio(),
-			_contentRect.height() * style::DevicePixelRatio());
-
+			_contentRect.x() * ratio,
+			_contentRect.y() * ratio,
+			_contentRect.width() * ratio,
+			_contentRect.height() * ratio);
+
+		const auto origin = _contentRect.topLeft();
+		auto points = base::take(_points);
+		for (auto &point : points) {
+			point -= origin;
+		}
 		_grabContentRequests.fire({
 			.pixmap = _pixmap.copy(scaledContentRect.toRect()),
-			.position = _contentRect.topLeft(),
+			.position = origin,
+			.size = _contentRect.size(),
+			.stroke = {
+				.points = std::move(points),
+				.color = _brushData.color,
+				.size = _brushData.size,
+			},
 		});
 	}
 	clearPixmap();
@@ -7,6 +7,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #pragma once
 
+#include "editor/scene/scene_item_line.h"
 #include "ui/painter.h"
 
 #include <QGraphicsItem>
@@ -20,12 +21,16 @@ public:
 	struct Content {
 		QPixmap pixmap;
 		QPointF position;
+		QSizeF size;
+		ItemLine::Stroke stroke;
 	};
 
 	ItemCanvas();
 	~ItemCanvas();
 
 	void applyBrush(const QColor &color, float size);
+	// The stroke is drawn at the resolution the scene is shown with.
+	void setZoom(float64 zoom);
 	void clearPixmap();
 	void cancelDrawing();
 
@@ -63,8 +68,10 @@ private:
 	QMarginsF _brushMargins;
 
 	QPointF _lastPoint;
+	std::vector<QPointF> _points;
 
 	QPixmap _pixmap;
+	float64 _resolution = 0.;
 
 	struct {
 		float size = 1.;
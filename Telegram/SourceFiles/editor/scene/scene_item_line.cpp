@@ -7,13 +7,17 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "editor/scene/scene_item_line.h"
 
+#include "ui/painter.h"
+
 #include <QGraphicsScene>
+#include <QStyleOptionGraphicsItem>
 
 namespace Editor {
 
-ItemLine::ItemLine(QPixmap &&pixmap)
+ItemLine::ItemLine(QPixmap &&pixmap, QSizeF size, Stroke &&stroke)
 : _pixmap(std::move(pixmap))
-, _rect(QPointF(), _pixmap.size() / float64(style::DevicePixelRatio())) {
+, _rect(QPointF(), size)
+, _stroke(std::move(stroke)) {
 }
 
 QRectF ItemLine::boundingRect() const {
@@ -24,7 +28,27 @@ void ItemLine::paint(
 		QPainter *p,
 		const QStyleOptionGraphicsItem *,
 		QWidget *) {
-	p->drawPixmap(0, 0, _pixmap);
+	const auto detail = QStyleOptionGraphicsItem::levelOfDetailFromTransform(
+		p->worldTransform());
+	const auto resolution = _rect.isEmpty()
+		? 0.
+		: (_pixmap.width() / _rect.width());
+	if (detail > resolution * 1.01 && !_stroke.points.empty()) {
+		// Saving renders the scene at the full size of the photo.
+		paintStroke(p);
+	} else {
+		p->drawPixmap(_rect, _pixmap, QRectF(_pixmap.rect()));
+	}
+}
+
+void ItemLine::paintStroke(QPainter *p) const {
+	auto hq = PainterHighQualityEnabler(*p);
+	p->setPen(Qt::NoPen);
+	p->setBrush(_stroke.color);
+	const auto half = _stroke.size / 2.;
+	for (const auto &point : _stroke.points) {
+		p->drawEllipse(point, half, half);
+	}
 }
 
 bool ItemLine::collidesWithItem(
@@ -13,7 +13,16 @@ namespace Editor {
 
 class ItemLine : public NumberedItem {
 public:
-	ItemLine(QPixmap &&pixmap);
+	// Points of a brush stroke in the coordinates of the item.
+	struct Stroke {
+		std::vector<QPointF> points;
+		QColor color;
+		float size = 1.;
+	};
+
+	// The pixmap is a screen resolution proxy of the stroke, the stroke
+	// itself is drawn again when rendered at a higher resolution.
+	ItemLine(QPixmap &&pixmap, QSizeF size, Stroke &&stroke);
 	QRectF boundingRect() const override;
 	void paint(
 		QPainter *p,
@@ -31,8 +40,11 @@ protected:
 		const QPainterPath &,
 		Qt::ItemSelectionMode) const override;
 private:
+	void paintStroke(QPainter *p) const;
+
 	const QPixmap _pixmap;
 	const QRectF _rect;
+	const Stroke _stroke;
 
 	struct {
 		bool saved = false;
@@ -16,6 +16,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <QtCore/QDateTime>
 #include <QtCore/QTimeZone>
 #include <QtCore/QRegularExpression>
+#include <QtCore/QThread>
 #include <QtGui/QImageReader>
 #include <range/v3/algorithm/max_element.hpp>
 #include <range/v3/view/all.hpp>
@@ -28,6 +29,8 @@ namespace {
 
 constexpr auto kMaxImageSize = 10000;
 constexpr auto kMigratedMessagesIdShift = -1'000'000'000;
+constexpr auto kParallelMessagesMin = 16;
+constexpr auto kParallelThreadsMax = 4;
 
 QString PrepareFileNameDatePart(TimeId date) {
 	return date
@@ -165,6 +168,39 @@ std::vector<std::vector<HistoryMessageMarkupButton>> ButtonRowsFromTL(
 	return rows;
 }
 
+[[nodiscard]] bool HasMediaFileIndices(const ParseMediaContext &context) {
+	return context.photos
+		|| context.audios
+		|| context.videos
+		|| context.files
+		|| context.contacts;
+}
+
+// Calls method(from, till) for parts of [0, count) on the crl::async pool
+// and on the calling thread, returns when all of the parts are done.
+template <typename Method>
+void InParallel(int count, Method &&method) {
+	static const auto threads = std::clamp(
+		QThread::idealThreadCount(),
+		1,
+		kParallelThreadsMax);
+	const auto parts = std::clamp(count / kParallelMessagesMin, 1, threads);
+	const auto bound = [&](int part) {
+		return (count * part) / parts;
+	};
+	auto done = std::vector<crl::semaphore>(parts - 1);
+	for (auto part = 1; part != parts; ++part) {
+		crl::async([&, part] {
+			method(bound(part), bound(part + 1));
+			done[part - 1].release();
+		});
+	}
+	method(0, bound(1));
+	for (auto &semaphore : done) {
+		semaphore.acquire();
+	}
+}
+
 } // namespace
 
 QByteArray HistoryMessageMarkupButton::TypeToString(
@@ -1884,6 +1920,49 @@ const Image &Message::thumb() const {
 	return media.thumb();
 }
 
+void ParseMessageMedia(
+		ParseMediaContext &context,
+		const MTPMessage &data,
+		const QString &mediaFolder,
+		Message &result) {
+	data.match([&](const MTPDmessage &data) {
+		if (const auto media = data.vmedia()) {
+			context.botId = result.viaBotId
+				? result.viaBotId
+				: peerIsUser(result.forwardedFromId)
+				? peerToUser(result.forwardedFromId)
+				: peerToUser(result.fromId);
+			result.media = ParseMedia(
+				context,
+				*media,
+				mediaFolder,
+				result.date);
+
+			// Live locations have ttl as well. The accessors return shared
+			// placeholders for content without a file or a thumbnail, those
+			// are written only here and messages are parsed in parallel.
+			auto &content = result.media.content;
+			if (result.media.ttl && !data.is_out()) {
+				if (const auto photo = std::get_if<Photo>(&content)) {
+					photo->image.file = File();
+				} else if (const auto document = std::get_if<Document>(
+						&content)) {
+					document->file = File();
+					document->thumb.file = File();
+				}
+			}
+			context.botId = 0;
+		}
+	}, [&](const MTPDmessageService &data) {
+		result.action = ParseServiceAction(
+			context,
+			data.vaction(),
+			mediaFolder,
+			result.date);
+	}, [](const MTPDmessageEmpty &data) {
+	});
+}
+
 Message ParseMessage(
 		ParseMediaContext &context,
 		const MTPMessage &data,
@@ -1975,23 +2054,6 @@ Message ParseMessage(
 		if (const auto viaBotId = data.vvia_bot_id()) {
 			result.viaBotId = viaBotId->v;
 		}
-		if (const auto media = data.vmedia()) {
-			context.botId = result.viaBotId
-				? result.viaBotId
-				: peerIsUser(result.forwardedFromId)
-				? peerToUser(result.forwardedFromId)
-				: peerToUser(result.fromId);
-			result.media = ParseMedia(
-				context,
-				*media,
-				mediaFolder,
-				result.date);
-			if (result.media.ttl && !data.is_out()) {
-				result.media.file() = File();
-				result.media.thumb().file = File();
-			}
-			context.botId = 0;
-		}
 		if (const auto replyMarkup = data.vreply_markup()) {
 			replyMarkup->match([](const MTPDreplyKeyboardMarkup &) {
 			}, [&](const MTPDreplyInlineMarkup &data) {
@@ -2006,15 +2068,11 @@ Message ParseMessage(
 			if (data.vreactions().has_value()) {
 				result.reactions = ParseReactions(*data.vreactions());
 			}
-	}, [&](const MTPDmessageService &data) {
-		result.action = ParseServiceAction(
-			context,
-			data.vaction(),
-			mediaFolder,
-			result.date);
+	}, [](const MTPDmessageService &data) {
 	}, [&](const MTPDmessageEmpty &data) {
 		result.id = data.vid().v;
 	});
+	ParseMessageMedia(context, data, mediaFolder, result);
 	return result;
 }
 
@@ -2506,11 +2564,36 @@ MessagesSlice ParseMessagesSlice(
 		const MTPVector<MTPChat> &chats,
 		const QString &mediaFolder) {
 	const auto &list = data.v;
+	const auto count = int(list.size());
+	const auto message = [&](int index) -> const MTPMessage & {
+		return list[count - index - 1];
+	};
+
+	// Media file names are numbered in the order of messages, so each one
+	// is parsed with its own numbering first and renumbered after that.
 	auto result = MessagesSlice();
-	result.list.reserve(list.size());
-	for (auto i = list.size(); i != 0;) {
-		const auto &message = list[--i];
-		result.list.push_back(ParseMessage(context, message, mediaFolder));
+	result.list.resize(count);
+	auto indices = std::vector<ParseMediaContext>(
+		count,
+		ParseMediaContext{ .selfPeerId = context.selfPeerId });
+	InParallel(count, [&](int from, int till) {
+		for (auto i = from; i != till; ++i) {
+			result.list[i] = ParseMessage(indices[i], message(i), mediaFolder);
+		}
+	});
+	for (auto i = 0; i != count; ++i) {
+		const auto &used = indices[i];
+		if (!HasMediaFileIndices(used)) {
+			continue;
+		} else if (HasMediaFileIndices(context)) {
+			ParseMessageMedia(context, message(i), mediaFolder, result.list[i]);
+		} else {
+			context.photos = used.photos;
+			context.audios = used.audios;
+			context.videos = used.videos;
+			context.files = used.files;
+			context.contacts = used.contacts;
+		}
 	}
 	result.peers = ParsePeersLists(users, chats);
 	return result;
@@ -15,6 +15,10 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/bytes.h"
 #include "base/options.h"
 #include "base/random.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+
 #include <set>
 #include <deque>
 
@@ -23,8 +27,7 @@ namespace {
 
 constexpr auto kUserpicsSliceLimit = 100;
 constexpr auto kFileChunkSize = 128 * 1024;
-constexpr auto kFileRequestsCount = 2;
-//constexpr auto kFileNextRequestDelay = crl::time(20);
+constexpr auto kFileRequestsCount = 4;
 constexpr auto kChatsSliceLimit = 100;
 constexpr auto kMessagesSliceLimit = 100;
 constexpr auto kTopPeerSliceLimit = 100;
@@ -34,6 +37,9 @@ constexpr auto kMaxEmojiPerRequest = 100;
 constexpr auto kStoriesSliceLimit = 100;
 constexpr auto kProfileMusicSliceLimit = 100;
 
+// Files saved by an export, to copy them instead of loading next time.
+constexpr auto kFilesIndexName = ".export_files"_cs;
+
 struct LocationKey {
 	uint64 type;
 	uint64 id;
@@ -97,13 +103,32 @@ public:
 
 	LoadedFileCache(int limit);
 
-	void save(const Location &location, const QString &relativePath);
+	void save(
+		const Location &location,
+		const QString &relativePath,
+		int64 size);
 	std::optional<QString> find(const Location &location) const;
 
+	void loadPrevious(const QString &path);
+	std::optional<QString> findPrevious(
+		const Location &location,
+		int64 size) const;
+	[[nodiscard]] Output::Result writeIndex(const QString &path) const;
+
 private:
+	struct Saved {
+		LocationKey key;
+		int64 size = 0;
+		QString path;
+	};
+
+	void readIndex(const QString &folder);
+
 	int _limit = 0;
 	std::map<LocationKey, QString> _map;
 	std::deque<LocationKey> _list;
+	std::vector<Saved> _saved;
+	std::map<LocationKey, Saved> _previous;
 
 };
 
@@ -193,9 +218,10 @@ struct ApiWrap::FileProcess {
 	struct Request {
 		int64 offset = 0;
 		QByteArray bytes;
+		mtpRequestId requestId = 0;
 	};
 	std::deque<Request> requests;
-	mtpRequestId requestId = 0;
+	mtpRequestId requestId = 0; // File reference refresh.
 };
 
 struct ApiWrap::FileProgress {
@@ -236,6 +262,7 @@ struct ApiWrap::ChatProcess {
 	FnMut<void(MTPmessages_Messages&&)> requestDone;
 
 	int localSplitIndex = 0;
+	int32 lastExportedId = 0;
 	int32 largestIdPlusOne = 1;
 
 	Data::ParseMediaContext context;
@@ -327,11 +354,15 @@ ApiWrap::LoadedFileCache::LoadedFileCache(int limit) : _limit(limit) {
 
 void ApiWrap::LoadedFileCache::save(
 		const Location &location,
-		const QString &relativePath) {
+		const QString &relativePath,
+		int64 size) {
 	if (!location) {
 		return;
 	}
 	const auto key = ComputeLocationKey(location);
+	if (key.id) {
+		_saved.push_back({ key, size, relativePath });
+	}
 	_map[key] = relativePath;
 	_list.push_back(key);
 	if (_list.size() > _limit) {
@@ -353,6 +384,82 @@ std::optional<QString> ApiWrap::LoadedFileCache::find(
 	return std::nullopt;
 }
 
+void ApiWrap::LoadedFileCache::loadPrevious(const QString &path) {
+	// Exports to a non-empty folder are put to its subfolders, so look
+	// for the indices in the parent folder and in all of its subfolders.
+	const auto current = QDir(path).absolutePath();
+	auto parent = QDir(current);
+	if (!parent.cdUp()) {
+		return;
+	}
+	readIndex(parent.absolutePath());
+	const auto mode = QDir::Dirs | QDir::NoDotAndDotDot;
+	for (const auto &info : parent.entryInfoList(mode)) {
+		if (info.absoluteFilePath() != current) {
+			readIndex(info.absoluteFilePath());
+		}
+	}
+}
+
+void ApiWrap::LoadedFileCache::readIndex(const QString &folder) {
+	auto file = QFile(folder + '/' + kFilesIndexName.utf16());
+	if (!file.open(QIODevice::ReadOnly)) {
+		return;
+	}
+	const auto base = folder + '/';
+	while (!file.atEnd()) {
+		const auto line = file.readLine().trimmed();
+		const auto parts = line.split(' ');
+		if (parts.size() < 4) {
+			continue;
+		}
+		auto saved = Saved{
+			.key = { parts[0].toULongLong(), parts[1].toULongLong() },
+			.size = parts[2].toLongLong(),
+			.path = base + QString::fromUtf8(line.mid(
+				parts[0].size() + parts[1].size() + parts[2].size() + 3)),
+		};
+		if (saved.key.id) {
+			_previous.emplace(saved.key, std::move(saved));
+		}
+	}
+}
+
+std::optional<QString> ApiWrap::LoadedFileCache::findPrevious(
+		const Location &location,
+		int64 size) const {
+	if (!location) {
+		return std::nullopt;
+	}
+	const auto i = _previous.find(ComputeLocationKey(location));
+	if (i == end(_previous)) {
+		return std::nullopt;
+	}
+	const auto info = QFileInfo(i->second.path);
+	if (!info.isFile()
+		|| info.size() != i->second.size
+		|| (size > 0 && info.size() != size)) {
+		return std::nullopt;
+	}
+	return i->second.path;
+}
+
+Output::Result ApiWrap::LoadedFileCache::writeIndex(
+		const QString &path) const {
+	auto block = QByteArray();
+	for (const auto &saved : _saved) {
+		block.append(QByteArray::number(saved.key.type)).append(' ');
+		block.append(QByteArray::number(saved.key.id)).append(' ');
+		block.append(QByteArray::number(saved.size)).append(' ');
+		block.append(saved.path.toUtf8()).append('\n');
+	}
+	auto file = Output::File(path + kFilesIndexName.utf16(), nullptr);
+	if (const auto result = file.writeBlock(block); !result) {
+		return result;
+	}
+	return file.flush();
+}
+
 ApiWrap::FileProcess::FileProcess(const QString &path, Output::Stats *stats)
 : file(path, stats) {
 }
@@ -397,7 +504,7 @@ auto ApiWrap::fileRequest(const Data::FileLocation &location, int64 offset) {
 			MTP_long(offset),
 			MTP_int(kFileChunkSize))
 	)).fail([=](const MTP::Error &result) {
-		_fileProcess->requestId = 0;
+		filePartRequestFinished(offset);
 		if (result.type() == u"TAKEOUT_FILE_EMPTY"_q
 			&& _otherDataProcess != nullptr) {
 			filePartDone(
@@ -409,10 +516,11 @@ auto ApiWrap::fileRequest(const Data::FileLocation &location, int64 offset) {
 		} else if (result.type() == u"LOCATION_INVALID"_q
 			|| result.type() == u"VERSION_INVALID"_q
 			|| result.type() == u"LOCATION_NOT_AVAILABLE"_q) {
+			cancelFileParts();
 			filePartUnavailable();
 		} else if (result.code() == 400
 			&& result.type().startsWith(u"FILE_REFERENCE_"_q)) {
-			filePartRefreshReference(offset);
+			filePartRefreshReference();
 		} else {
 			error(std::move(result));
 		}
@@ -443,6 +551,7 @@ void ApiWrap::startExport(
 
 	_settings = std::make_unique<Settings>(settings);
 	_stats = stats;
+	_fileCache->loadPrevious(_settings->path);
 	_startProcess = std::make_unique<StartProcess>();
 	_startProcess->done = std::move(done);
 
@@ -1440,6 +1549,13 @@ void ApiWrap::requestMessages(
 	_chatProcess->fileProgress = std::move(progress);
 	_chatProcess->handleSlice = std::move(slice);
 	_chatProcess->done = std::move(done);
+	if (_settings->onlyNewMessages) {
+		const auto i = _settings->lastMessageIds.find(info.peerId);
+		if (i != end(_settings->lastMessageIds)) {
+			_chatProcess->lastExportedId = i->second;
+			_chatProcess->largestIdPlusOne = i->second + 1;
+		}
+	}
 
 	requestMessagesCount(0);
 }
@@ -1448,8 +1564,14 @@ void ApiWrap::requestMessagesCount(int localSplitIndex) {
 	Expects(_chatProcess != nullptr);
 	Expects(localSplitIndex < _chatProcess->info.splits.size());
 
+	const auto splitIndex = _chatProcess->info.splits[localSplitIndex];
+	if (splitIndex < 0 && _chatProcess->lastExportedId > 0) {
+		// The migrated chat can't get new messages.
+		messagesCountLoaded(localSplitIndex, 0);
+		return;
+	}
 	requestChatMessages(
-		_chatProcess->info.splits[localSplitIndex],
+		splitIndex,
 		0, // offset_id
 		0, // add_offset
 		1, // limit
@@ -1522,6 +1644,10 @@ void ApiWrap::messagesCountLoaded(int localSplitIndex, int count) {
 void ApiWrap::finishExport(FnMut<void()> done) {
 	const auto guard = gsl::finally([&] { _takeoutId = std::nullopt; });
 
+	if (!_fileCache->writeIndex(_settings->path)) {
+		LOG(("Export Error: Could not write the files index."));
+	}
+
 	mainRequest(MTPaccount_FinishTakeoutSession(
 		MTP_flags(MTPaccount_FinishTakeoutSession::Flag::f_success)
 	)).done(std::move(done)).send();
@@ -1533,8 +1659,10 @@ void ApiWrap::skipFile(uint64 randomId) {
 	}
 	LOG(("Export Info: File skipped."));
 	Assert(!_fileProcess->requests.empty());
-	Assert(_fileProcess->requestId != 0);
-	_mtp.request(base::take(_fileProcess->requestId)).cancel();
+	cancelFileParts();
+	if (_fileProcess->requestId) {
+		_mtp.request(base::take(_fileProcess->requestId)).cancel();
+	}
 	base::take(_fileProcess)->done(QString());
 }
 
@@ -2189,7 +2317,7 @@ void ApiWrap::finishMessagesSlice() {
 		&& (++_chatProcess->localSplitIndex
 			< _chatProcess->info.splits.size())) {
 		_chatProcess->lastSlice = false;
-		_chatProcess->largestIdPlusOne = 1;
+		_chatProcess->largestIdPlusOne = _chatProcess->lastExportedId + 1;
 	}
 	if (!_chatProcess->lastSlice) {
 		requestMessagesSlice();
@@ -2329,6 +2457,8 @@ bool ApiWrap::processFileLoad(
 		// Don't load thumbs for large files that we skip.
 		file.skipReason = SkipReason::FileSize;
 		return true;
+	} else if (copyPreviousFile(file)) {
+		return true;
 	}
 	loadFile(file, origin, std::move(progress), std::move(done));
 	return false;
@@ -2346,9 +2476,16 @@ bool ApiWrap::writePreloadedFile(
 		return true;
 	} else if (!file.content.isEmpty()) {
 		const auto process = prepareFileProcess(file, origin);
-		if (const auto result = process->file.writeBlock(file.content)) {
+		const auto result = [&] {
+			const auto result = process->file.writeBlock(file.content);
+			return result ? process->file.flush() : result;
+		}();
+		if (result) {
 			file.relativePath = process->relativePath;
-			_fileCache->save(file.location, file.relativePath);
+			_fileCache->save(
+				file.location,
+				file.relativePath,
+				file.content.size());
 		} else {
 			ioError(result);
 		}
@@ -2382,7 +2519,41 @@ void ApiWrap::loadFile(
 
 	loadFilePart();
 
-	Ensures(_fileProcess->requestId != 0);
+	Ensures(!_fileProcess->requests.empty());
+}
+
+bool ApiWrap::copyPreviousFile(Data::File &file) {
+	Expects(_settings != nullptr);
+
+	const auto source = _fileCache->findPrevious(file.location, file.size);
+	if (!source) {
+		return false;
+	}
+	const auto relativePath = Output::File::PrepareRelativePath(
+		_settings->path,
+		file.suggestedPath);
+	const auto path = _settings->path + relativePath;
+	QDir().mkpath(QFileInfo(path).absolutePath());
+	if (!QFile::copy(*source, path)) {
+		LOG(("Export Error: Could not copy '%1' to '%2'."
+			).arg(*source
+			).arg(path));
+		return false;
+	}
+	const auto size = QFileInfo(path).size();
+	if (_stats) {
+		_stats->incrementFiles();
+		for (auto left = size; left > 0;) {
+			const auto part = int(std::min(
+				left,
+				int64(std::numeric_limits<int>::max())));
+			_stats->incrementBytes(part);
+			left -= part;
+		}
+	}
+	file.relativePath = relativePath;
+	_fileCache->save(file.location, relativePath, size);
+	return true;
 }
 
 auto ApiWrap::prepareFileProcess(
@@ -2406,36 +2577,65 @@ auto ApiWrap::prepareFileProcess(
 }
 
 void ApiWrap::loadFilePart() {
-	if (!_fileProcess
-		|| _fileProcess->requestId
-		|| _fileProcess->requests.size() >= kFileRequestsCount
-		|| (_fileProcess->size > 0
-			&& _fileProcess->offset >= _fileProcess->size)) {
+	if (!_fileProcess || _fileProcess->requestId) {
 		return;
 	}
+	// Parts of a file with an unknown size are requested one by one,
+	// until an empty one is received.
+	const auto more = [&] {
+		return (_fileProcess->requests.size() < kFileRequestsCount)
+			&& (_fileProcess->size > 0
+				? (_fileProcess->offset < _fileProcess->size)
+				: _fileProcess->requests.empty());
+	};
+	while (more()) {
+		const auto offset = _fileProcess->offset;
+		_fileProcess->requests.push_back({ offset });
+		_fileProcess->offset += kFileChunkSize;
+		_fileProcess->requests.back().requestId = sendFilePart(offset);
+	}
+}
 
-	const auto offset = _fileProcess->offset;
-	_fileProcess->requests.push_back({ offset });
-	_fileProcess->requestId = fileRequest(
+mtpRequestId ApiWrap::sendFilePart(int64 offset) {
+	return fileRequest(
 		_fileProcess->location,
-		_fileProcess->offset
+		offset
 	).done([=](const MTPupload_File &result) {
-		_fileProcess->requestId = 0;
+		filePartRequestFinished(offset);
 		filePartDone(offset, result);
 	}).send();
-	_fileProcess->offset += kFileChunkSize;
+}
+
+void ApiWrap::resendFileParts() {
+	Expects(_fileProcess != nullptr);
+
+	for (auto &request : _fileProcess->requests) {
+		if (!request.requestId && request.bytes.isEmpty()) {
+			request.requestId = sendFilePart(request.offset);
+		}
+	}
+}
+
+void ApiWrap::cancelFileParts() {
+	Expects(_fileProcess != nullptr);
+
+	for (auto &request : _fileProcess->requests) {
+		if (request.requestId) {
+			_mtp.request(base::take(request.requestId)).cancel();
+		}
+	}
+}
+
+void ApiWrap::filePartRequestFinished(int64 offset) {
+	Expects(_fileProcess != nullptr);
 
-	if (_fileProcess->size > 0
-		&& _fileProcess->requests.size() < kFileRequestsCount) {
-		// Only one request at a time supported right now.
-		//const auto runner = _runner;
-		//crl::on_main([=] {
-		//	QTimer::singleShot(kFileNextRequestDelay, [=] {
-		//		runner([=] {
-		//			loadFilePart();
-		//		});
-		//	});
-		//});
+	using Request = FileProcess::Request;
+	const auto i = ranges::find(
+		_fileProcess->requests,
+		offset,
+		[](const Request &request) { return request.offset; });
+	if (i != end(_fileProcess->requests)) {
+		i->requestId = 0;
 	}
 }
 
@@ -2493,15 +2693,24 @@ void ApiWrap::filePartDone(int64 offset, const MTPupload_File &result) {
 		}
 	}
 
+	if (const auto result = _fileProcess->file.flush(); !result) {
+		ioError(result);
+		return;
+	}
 	auto process = base::take(_fileProcess);
 	const auto relativePath = process->relativePath;
-	_fileCache->save(process->location, relativePath);
+	_fileCache->save(process->location, relativePath, process->file.size());
 	process->done(process->relativePath);
 }
 
-void ApiWrap::filePartRefreshReference(int64 offset) {
+void ApiWrap::filePartRefreshReference() {
 	Expects(_fileProcess != nullptr);
-	Expects(_fileProcess->requestId == 0);
+
+	// All parts are requested again with the new reference.
+	cancelFileParts();
+	if (_fileProcess->requestId) {
+		return;
+	}
 
 	const auto &origin = _fileProcess->origin;
 	if (origin.storyId) {
@@ -2514,7 +2723,7 @@ void ApiWrap::filePartRefreshReference(int64 offset) {
 			return true;
 		}).done([=](const MTPstories_Stories &result) {
 			_fileProcess->requestId = 0;
-			filePartExtractReference(offset, result);
+			filePartExtractReference(result);
 		}).send();
 		return;
 	} else if (!origin.messageId) {
@@ -2542,7 +2751,7 @@ void ApiWrap::filePartRefreshReference(int64 offset) {
 			return true;
 		}).done([=](const MTPmessages_Messages &result) {
 			_fileProcess->requestId = 0;
-			filePartExtractReference(offset, result);
+			filePartExtractReference(result);
 		}).send();
 	} else {
 		_fileProcess->requestId = splitRequest(
@@ -2558,13 +2767,12 @@ void ApiWrap::filePartRefreshReference(int64 offset) {
 			return true;
 		}).done([=](const MTPmessages_Messages &result) {
 			_fileProcess->requestId = 0;
-			filePartExtractReference(offset, result);
+			filePartExtractReference(result);
 		}).send();
 	}
 }
 
 void ApiWrap::filePartExtractReference(
-		int64 offset,
 		const MTPmessages_Messages &result) {
 	Expects(_fileProcess != nullptr);
 	Expects(_fileProcess->requestId == 0);
@@ -2591,13 +2799,7 @@ void ApiWrap::filePartExtractReference(
 					_fileProcess->location,
 					message.thumb().file.location);
 				if (refresh1 || refresh2) {
-					_fileProcess->requestId = fileRequest(
-						_fileProcess->location,
-						offset
-					).done([=](const MTPupload_File &result) {
-						_fileProcess->requestId = 0;
-						filePartDone(offset, result);
-					}).send();
+					resendFileParts();
 					return;
 				}
 			}
@@ -2607,7 +2809,6 @@ void ApiWrap::filePartExtractReference(
 }
 
 void ApiWrap::filePartExtractReference(
-		int64 offset,
 		const MTPstories_Stories &result) {
 	Expects(_fileProcess != nullptr);
 	Expects(_fileProcess->requestId == 0);
@@ -2624,13 +2825,7 @@ void ApiWrap::filePartExtractReference(
 				_fileProcess->location,
 				story.thumb().file.location);
 			if (refresh1 || refresh2) {
-				_fileProcess->requestId = fileRequest(
-					_fileProcess->location,
-					offset
-				).done([=](const MTPupload_File &result) {
-					_fileProcess->requestId = 0;
-					filePartDone(offset, result);
-				}).send();
+				resendFileParts();
 				return;
 			}
 		}
@@ -62,6 +62,9 @@ private:
 	void setState(State &&state);
 	void ioError(const QString &path);
 	bool ioCatchError(Output::Result result);
+	void rememberLastMessageId(
+		PeerId peerId,
+		const Data::MessagesSlice &slice);
 	void setFinishedState();
 
 	//void requestPasswordState();
@@ -114,6 +117,7 @@ private:
 
 	int _messagesWritten = 0;
 	int _messagesCount = 0;
+	base::flat_map<PeerId, int32> _lastMessageIds;
 
 	int _userpicsWritten = 0;
 	int _userpicsCount = 0;
@@ -259,6 +263,7 @@ void ControllerObject::startExport(
 	_environment = environment;
 
 	_settings.path = Output::NormalizePath(_settings);
+	_lastMessageIds = _settings.lastMessageIds;
 	_writer = Output::CreateWriter(_settings.format);
 	fillExportSteps();
 	exportNext();
@@ -552,6 +557,7 @@ void ControllerObject::exportNextDialog() {
 			if (ioCatchError(_writer->writeDialogSlice(result))) {
 				return false;
 			}
+			rememberLastMessageId(info->peerId, result);
 			_messagesWritten += result.list.size();
 			setState(stateDialogs(DownloadProgress()));
 			return true;
@@ -708,11 +714,30 @@ int ControllerObject::substepsInStep(Step step) const {
 	return _substepsInStep[static_cast<int>(step)];
 }
 
+void ControllerObject::rememberLastMessageId(
+		PeerId peerId,
+		const Data::MessagesSlice &slice) {
+	if (_settings.singlePeerFrom > 0 || _settings.singlePeerTill > 0) {
+		// Messages after the date range were not saved.
+		return;
+	}
+	// Messages of the migrated chat have shifted negative ids.
+	const auto i = ranges::max_element(
+		slice.list,
+		ranges::less(),
+		&Data::Message::id);
+	if (i != end(slice.list) && i->id > 0) {
+		auto &last = _lastMessageIds[peerId];
+		last = std::max(last, i->id);
+	}
+}
+
 void ControllerObject::setFinishedState() {
 	setState(FinishedState{
 		_writer->mainFilePath(),
 		_stats.filesCount(),
-		_stats.bytesCount() });
+		_stats.bytesCount(),
+		_lastMessageIds });
 }
 
 Controller::Controller(
@@ -7,7 +7,9 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #pragma once
 
+#include "base/flat_map.h"
 #include "base/variant.h"
+#include "data/data_peer_id.h"
 #include "mtproto/mtproto_response.h"
 
 #include <QtCore/QPointer>
@@ -88,6 +90,7 @@ struct FinishedState {
 	QString path;
 	int filesCount = 0;
 	int64 bytesCount = 0;
+	base::flat_map<PeerId, int32> lastMessageIds;
 };
 
 using State = std::variant<
@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "base/flags.h"
 #include "base/flat_map.h"
+#include "data/data_peer_id.h"
 
 namespace Export {
 namespace Output {
@@ -90,6 +91,11 @@ struct Settings {
 
 	TimeId availableAt = 0;
 
+	// Start each chat right after the last message saved by a previous
+	// export, the ids are updated when an export finishes.
+	bool onlyNewMessages = false;
+	base::flat_map<PeerId, int32> lastMessageIds;
+
 	bool onlySinglePeer() const {
 		return singlePeer.type() != mtpc_inputPeerEmpty;
 	}
@@ -52,6 +52,8 @@ std::unique_ptr<AbstractWriter> CreateWriter(Format format) {
 	case Format::Html: return std::make_unique<HtmlWriter>();
 	case Format::Json: return std::make_unique<JsonWriter>();
 	case Format::HtmlAndJson: return std::make_unique<HtmlAndJsonWriter>();
+	case Format::JsonLines:
+		return std::make_unique<JsonWriter>(Format::JsonLines);
 	}
 	Unexpected("Format in Export::Output::CreateWriter.");
 }
@@ -40,6 +40,7 @@ enum class Format {
 	Html,
 	Json,
 	HtmlAndJson,
+	JsonLines,
 };
 
 class AbstractWriter {
@@ -18,19 +18,61 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 namespace Export {
 namespace Output {
+namespace {
+
+// Writers emit lots of small blocks, write them to disk in large chunks.
+constexpr auto kBufferSize = 256 * 1024;
+
+} // namespace
 
 File::File(const QString &path, Stats *stats) : _path(path), _stats(stats) {
 }
 
+File::~File() {
+	// Best effort, the errors are reported only by an explicit flush().
+	[[maybe_unused]] const auto result = flush();
+}
+
 int64 File::size() const {
-	return _offset;
+	return _offset + _buffer.size();
 }
 
 bool File::empty() const {
-	return !_offset;
+	return !size();
 }
 
 Result File::writeBlock(const QByteArray &block) {
+	if (_stats && !_inStats) {
+		_inStats = true;
+		_stats->incrementFiles();
+	}
+	if (_buffer.size() + block.size() > kBufferSize) {
+		if (const auto result = flush(); !result) {
+			return result;
+		}
+	}
+	if (block.isEmpty() || block.size() >= kBufferSize) {
+		// Empty block creates the file right away.
+		return write(block);
+	} else if (_buffer.isEmpty()) {
+		_buffer.reserve(kBufferSize);
+	}
+	_buffer.append(block);
+	return Result::Success();
+}
+
+Result File::flush() {
+	if (_buffer.isEmpty()) {
+		return Result::Success();
+	}
+	const auto result = write(_buffer);
+	if (result) {
+		_buffer.resize(0);
+	}
+	return result;
+}
+
+Result File::write(const QByteArray &block) {
 	const auto result = writeBlockAttempt(block);
 	if (!result) {
 		_file.reset();
@@ -39,10 +81,6 @@ Result File::writeBlock(const QByteArray &block) {
 }
 
 Result File::writeBlockAttempt(const QByteArray &block) {
-	if (_stats && !_inStats) {
-		_inStats = true;
-		_stats->incrementFiles();
-	}
 	if (const auto result = reopen(); !result) {
 		return result;
 	}
@@ -133,7 +171,11 @@ Result File::Copy(
 	if (bytes.size() != f.size()) {
 		return Result(Result::Type::FatalError, source);
 	}
-	return File(path, stats).writeBlock(bytes);
+	auto file = File(path, stats);
+	if (const auto result = file.writeBlock(bytes); !result) {
+		return result;
+	}
+	return file.flush();
 }
 
 } // namespace Output
@@ -22,11 +22,15 @@ class Stats;
 class File {
 public:
 	File(const QString &path, Stats *stats);
+	~File();
 
 	[[nodiscard]] int64 size() const;
 	[[nodiscard]] bool empty() const;
 
+	// Small blocks are collected in memory, flush() must be called
+	// when the file contents are required to be on disk.
 	[[nodiscard]] Result writeBlock(const QByteArray &block);
+	[[nodiscard]] Result flush();
 
 	[[nodiscard]] static QString PrepareRelativePath(
 		const QString &folder,
@@ -39,6 +43,7 @@ public:
 
 private:
 	[[nodiscard]] Result reopen();
+	[[nodiscard]] Result write(const QByteArray &block);
 	[[nodiscard]] Result writeBlockAttempt(const QByteArray &block);
 
 	[[nodiscard]] Result error() const;
@@ -47,6 +52,7 @@ private:
 	QString _path;
 	int64 _offset = 0;
 	std::optional<QFile> _file;
+	QByteArray _buffer;
 
 	Stats *_stats = nullptr;
 	bool _inStats = false;
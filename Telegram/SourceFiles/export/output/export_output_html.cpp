@@ -22,6 +22,10 @@ namespace Output {
 namespace {
 
 constexpr auto kMessagesInFile = 1000;
+
+// Reserved output per message in a slice, to build it in one buffer.
+constexpr auto kMessageSizeEstimate = 1024;
+
 constexpr auto kPersonalUserpicSize = 90;
 constexpr auto kEntryUserpicSize = 48;
 constexpr auto kServiceMessagePhotoSize = 60;
@@ -106,14 +110,39 @@ auto CalculateThumbSize(
 	};
 }
 
+[[nodiscard]] bool NeedsEscaping(const char *p, const char *end) {
+	const auto ch = *p;
+	return (ch == '\n')
+		|| (ch == '"')
+		|| (ch == '&')
+		|| (ch == '\'')
+		|| (ch == '<')
+		|| (ch == '>')
+		|| (ch >= 0 && ch < 32)
+		|| (ch == char(0xE2)
+			&& (p + 2 < end)
+			&& *(p + 1) == char(0x80)
+			&& (*(p + 2) == char(0xA8) || *(p + 2) == char(0xA9)));
+}
+
 QByteArray SerializeString(const QByteArray &value) {
 	const auto size = value.size();
 	const auto begin = value.data();
 	const auto end = begin + size;
 
+	// Most of the strings don't need escaping, share them as they are.
+	auto from = begin;
+	while (from != end && !NeedsEscaping(from, end)) {
+		++from;
+	}
+	if (from == end) {
+		return value;
+	}
+
 	auto result = QByteArray();
-	result.reserve(size * 6);
-	for (auto p = begin; p != end; ++p) {
+	result.reserve(size + (end - from) * 5);
+	result.append(begin, from - begin);
+	for (auto p = from; p != end; ++p) {
 		const auto ch = *p;
 		if (ch == '\n') {
 			result.append("<br>", 4);
@@ -462,9 +491,19 @@ QByteArray HtmlContext::pushTag(
 			inner.append("=\"").append(SerializeString(value)).append("\"");
 		}
 	}
-	auto result = (data.block ? ("\n" + indent()) : QByteArray())
-		+ "<" + data.name + inner + (empty ? "/" : "") + ">"
-		+ (data.block ? "\n" : "");
+	auto result = QByteArray();
+	result.reserve(_tags.size() + data.name.size() + inner.size() + 5);
+	if (data.block) {
+		result.append('\n').append(indent());
+	}
+	result.append('<').append(data.name).append(inner);
+	if (empty) {
+		result.append('/');
+	}
+	result.append('>');
+	if (data.block) {
+		result.append('\n');
+	}
 	if (!empty) {
 		_tags.push_back(data);
 	}
@@ -476,9 +515,16 @@ QByteArray HtmlContext::popTag() {
 
 	const auto data = _tags.back();
 	_tags.pop_back();
-	return (data.block ? ("\n" + indent()) : QByteArray())
-		+ "</" + data.name + ">"
-		+ (data.block ? "\n" : "");
+	auto result = QByteArray();
+	result.reserve(_tags.size() + data.name.size() + 5);
+	if (data.block) {
+		result.append('\n').append(indent());
+	}
+	result.append("</", 2).append(data.name).append('>');
+	if (data.block) {
+		result.append('\n');
+	}
+	return result;
 }
 
 QByteArray HtmlContext::indent() const {
@@ -2673,7 +2719,10 @@ Result HtmlWriter::Wrap::close() {
 		while (!_context.empty()) {
 			block.append(_context.popTag());
 		}
-		return _file.writeBlock(block);
+		if (const auto result = _file.writeBlock(block); !result) {
+			return result;
+		}
+		return _file.flush();
 	}
 	return Result::Success();
 }
@@ -3472,6 +3521,7 @@ Result HtmlWriter::writeDialogSlice(const Data::MessagesSlice &data) {
 	auto previous = _lastMessageInfo.get();
 	auto saved = std::optional<MessageInfo>();
 	auto block = QByteArray();
+	block.reserve(int(data.list.size()) * kMessageSizeEstimate);
 	for (const auto &message : data.list) {
 		if (Data::SkipMessageByDate(message, _settings)) {
 			continue;
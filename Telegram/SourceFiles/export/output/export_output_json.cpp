@@ -23,6 +23,8 @@ namespace {
 
 using Context = details::JsonContext;
 
+constexpr auto kMessagesFile = "messages.jsonl"_cs;
+
 QByteArray SerializeString(const QByteArray &value) {
 	const auto size = value.size();
 	const auto begin = value.data();
@@ -97,11 +99,15 @@ QByteArray Indentation(const Context &context) {
 QByteArray SerializeObject(
 		Context &context,
 		const std::vector<std::pair<QByteArray, QByteArray>> &values) {
-	const auto indent = Indentation(context);
+	const auto indent = context.compact
+		? QByteArray()
+		: Indentation(context);
 
 	context.nesting.push_back(Context::kObject);
 	const auto guard = gsl::finally([&] { context.nesting.pop_back(); });
-	const auto next = '\n' + Indentation(context);
+	const auto next = context.compact
+		? QByteArray()
+		: ('\n' + Indentation(context));
 
 	auto first = true;
 	auto result = QByteArray();
@@ -118,15 +124,22 @@ QByteArray SerializeObject(
 		result.append(next).append(SerializeString(key)).append(": ", 2);
 		result.append(value);
 	}
-	result.append('\n').append(indent).append("}");
+	if (!context.compact) {
+		result.append('\n').append(indent);
+	}
+	result.append("}");
 	return result;
 }
 
 QByteArray SerializeArray(
 		Context &context,
 		const std::vector<QByteArray> &values) {
-	const auto indent = Indentation(context.nesting.size());
-	const auto next = '\n' + Indentation(context.nesting.size() + 1);
+	const auto indent = context.compact
+		? QByteArray()
+		: Indentation(context.nesting.size());
+	const auto next = context.compact
+		? QByteArray()
+		: ('\n' + Indentation(context.nesting.size() + 1));
 
 	auto first = true;
 	auto result = QByteArray();
@@ -139,7 +152,10 @@ QByteArray SerializeArray(
 		}
 		result.append(next).append(value);
 	}
-	result.append('\n').append(indent).append("]");
+	if (!context.compact) {
+		result.append('\n').append(indent);
+	}
+	result.append("]");
 	return result;
 }
 
@@ -1108,6 +1124,10 @@ QByteArray SerializeMessage(
 
 } // namespace
 
+JsonWriter::JsonWriter(Format format) : _format(format) {
+	_linesContext.compact = true;
+}
+
 Result JsonWriter::start(
 		const Settings &settings,
 		const Environment &environment,
@@ -1637,6 +1657,18 @@ Result JsonWriter::writeDialogStart(const Data::DialogInfo &data) {
 		+ StringAllowNull(TypeString(data.type)));
 	block.append(prepareObjectItemStart("id")
 		+ Data::NumberToString(Data::PeerToBareId(data.peerId)));
+	if (linesFormat()) {
+		const auto path = data.relativePath + kMessagesFile.utf16();
+		block.append(prepareObjectItemStart("messages_file")
+			+ SerializeString(path.toUtf8()));
+		_messages = fileWithRelativePath(path);
+
+		// Create the file even if there are no messages at all.
+		if (const auto result = _messages->writeBlock({}); !result) {
+			return result;
+		}
+		return _output->writeBlock(block);
+	}
 	block.append(prepareObjectItemStart("messages"));
 	block.append(pushNesting(Context::kArray));
 	return _output->writeBlock(block);
@@ -1665,6 +1697,23 @@ Result JsonWriter::writeDialogSlice(const Data::MessagesSlice &data) {
 	Expects(_output != nullptr);
 
 	auto block = QByteArray();
+	if (linesFormat()) {
+		Assert(_messages != nullptr);
+
+		for (const auto &message : data.list) {
+			if (Data::SkipMessageByDate(message, _settings)) {
+				continue;
+			}
+			block.append(SerializeMessage(
+				_linesContext,
+				message,
+				data.peers,
+				_environment.internalLinksDomain)).append('\n');
+		}
+		return block.isEmpty()
+			? Result::Success()
+			: _messages->writeBlock(block);
+	}
 	for (const auto &message : data.list) {
 		if (Data::SkipMessageByDate(message, _settings)) {
 			continue;
@@ -1681,6 +1730,14 @@ Result JsonWriter::writeDialogSlice(const Data::MessagesSlice &data) {
 Result JsonWriter::writeDialogEnd() {
 	Expects(_output != nullptr);
 
+	if (linesFormat()) {
+		Assert(_messages != nullptr);
+
+		if (const auto result = base::take(_messages)->flush(); !result) {
+			return result;
+		}
+		return _output->writeBlock(popNesting());
+	}
 	auto block = popNesting();
 	return _output->writeBlock(block + popNesting());
 }
@@ -1717,17 +1774,24 @@ Result JsonWriter::finish() {
 
 	if (_settings.onlySinglePeer()) {
 		Assert(_context.nesting.empty());
-		return Result::Success();
+		return _output->flush();
 	}
 	auto block = popNesting();
 	Assert(_context.nesting.empty());
-	return _output->writeBlock(block);
+	if (const auto result = _output->writeBlock(block); !result) {
+		return result;
+	}
+	return _output->flush();
 }
 
 QString JsonWriter::mainFilePath() {
 	return pathWithRelativePath(mainFileRelativePath());
 }
 
+bool JsonWriter::linesFormat() const {
+	return (_format == Format::JsonLines);
+}
+
 QString JsonWriter::mainFileRelativePath() const {
 	return "result.json";
 }
@@ -23,14 +23,19 @@ struct JsonContext {
 
 	// Always fun to use std::vector<bool>.
 	std::vector<Type> nesting;
+
+	// Everything in one line, for the JSON Lines messages files.
+	bool compact = false;
 };
 
 } // namespace details
 
 class JsonWriter : public AbstractWriter {
 public:
+	explicit JsonWriter(Format format = Format::Json);
+
 	Format format() override {
-		return Format::Json;
+		return _format;
 	}
 
 	Result start(
@@ -81,6 +86,7 @@ private:
 	[[nodiscard]] QByteArray prepareArrayItemStart();
 	[[nodiscard]] QByteArray popNesting();
 
+	[[nodiscard]] bool linesFormat() const;
 	[[nodiscard]] QString mainFileRelativePath() const;
 	[[nodiscard]] QString pathWithRelativePath(const QString &path) const;
 	[[nodiscard]] std::unique_ptr<File> fileWithRelativePath(
@@ -98,15 +104,18 @@ private:
 		const QByteArray &about);
 	[[nodiscard]] Result writeChatsEnd();
 
+	Format _format = Format::Json;
 	Settings _settings;
 	Environment _environment;
 	Stats *_stats = nullptr;
 
 	Context _context;
+	Context _linesContext;
 	bool _currentNestingHadItem = false;
 	DialogsMode _dialogsMode = DialogsMode::None;
 
 	std::unique_ptr<File> _output;
+	std::unique_ptr<File> _messages;
 
 };
 
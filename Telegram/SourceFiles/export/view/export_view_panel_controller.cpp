@@ -402,7 +402,9 @@ void PanelController::updateState(State &&state) {
 		showError(*apiError);
 	} else if (const auto error = std::get_if<OutputErrorState>(&_state)) {
 		showError(*error);
-	} else if (v::is<FinishedState>(_state)) {
+	} else if (const auto finished = std::get_if<FinishedState>(&_state)) {
+		_settings->lastMessageIds = finished->lastMessageIds;
+		saveSettings();
 		_panel->setTitle(tr::lng_export_title());
 		_panel->setHideOnDeactivate(false);
 	} else if (v::is<CancelledState>(_state)) {
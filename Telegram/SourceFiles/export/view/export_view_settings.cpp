@@ -80,6 +80,9 @@ void ChooseFormatBox(
 	addFormatOption(
 		tr::lng_export_option_html_and_json(tr::now),
 		Format::HtmlAndJson);
+	addFormatOption(
+		tr::lng_export_option_json_lines(tr::now),
+		Format::JsonLines);
 	box->addButton(tr::lng_settings_save(), [=] { done(group->current()); });
 	box->addButton(tr::lng_cancel(), [=] { box->closeBox(); });
 }
@@ -164,6 +167,7 @@ void SettingsWidget::setupOptions(not_null<Ui::VerticalLayout*> container) {
 	if (!_singlePeerId) {
 		setupOtherOptions(container);
 	}
+	setupOnlyNewOption(container);
 }
 
 void SettingsWidget::setupFullExportOptions(
@@ -263,6 +267,29 @@ void SettingsWidget::setupOtherOptions(
 		tr::lng_export_option_other_about(tr::now));
 }
 
+void SettingsWidget::setupOnlyNewOption(
+		not_null<Ui::VerticalLayout*> container) {
+	const auto checkbox = container->add(
+		object_ptr<Ui::Checkbox>(
+			container,
+			tr::lng_export_option_only_new(tr::now),
+			readData().onlyNewMessages,
+			st::defaultBoxCheckbox),
+		st::exportSettingPadding);
+	container->add(
+		object_ptr<Ui::FlatLabel>(
+			container,
+			tr::lng_export_option_only_new_about(tr::now),
+			st::exportAboutOptionLabel),
+		st::exportAboutOptionPadding);
+	checkbox->checkedChanges(
+	) | rpl::start_with_next([=](bool checked) {
+		changeData([&](Settings &data) {
+			data.onlyNewMessages = checked;
+		});
+	}, checkbox->lifetime());
+}
+
 void SettingsWidget::setupPathAndFormat(
 		not_null<Ui::VerticalLayout*> container) {
 	if (_singlePeerId != 0) {
@@ -292,6 +319,7 @@ void SettingsWidget::setupPathAndFormat(
 	addFormatOption(tr::lng_export_option_html(tr::now), Format::Html);
 	addFormatOption(tr::lng_export_option_json(tr::now), Format::Json);
 	addFormatOption(tr::lng_export_option_html_and_json(tr::now), Format::HtmlAndJson);
+	addFormatOption(tr::lng_export_option_json_lines(tr::now), Format::JsonLines);
 }
 
 void SettingsWidget::addLocationLabel(
@@ -367,6 +395,8 @@ void SettingsWidget::addFormatAndLocationLabel(
 			? "HTML"
 			: (format == Format::Json)
 			? "JSON"
+			: (format == Format::JsonLines)
+			? "JSON Lines"
 			: tr::lng_export_option_html_and_json(tr::now);
 		return Ui::Text::Link(text, u"internal:edit_format"_q);
 	});
@@ -59,6 +59,7 @@ private:
 	void setupFullExportOptions(not_null<Ui::VerticalLayout*> container);
 	void setupMediaOptions(not_null<Ui::VerticalLayout*> container);
 	void setupOtherOptions(not_null<Ui::VerticalLayout*> container);
+	void setupOnlyNewOption(not_null<Ui::VerticalLayout*> container);
 	void setupPathAndFormat(not_null<Ui::VerticalLayout*> container);
 	void addHeader(
 		not_null<Ui::VerticalLayout*> container,
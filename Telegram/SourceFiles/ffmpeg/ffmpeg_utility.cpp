@@ -159,6 +159,33 @@ void PremultiplyLine(uchar *dst, const uchar *src, int intsCount) {
 	return true;
 }
 
+void ApplyDecodeSize(
+		not_null<AVCodecContext*> context,
+		not_null<const AVCodec*> codec,
+		QSize size,
+		bool hwAllowed) {
+	const auto enough = [&](int shift) {
+		return ((context->width >> shift) >= size.width())
+			&& ((context->height >> shift) >= size.height());
+	};
+	if (!enough(1)) {
+		return;
+	}
+
+	// Lost details and deblocking leftovers are hidden by the downscale.
+	context->skip_loop_filter = AVDISCARD_NONREF;
+	context->flags2 |= AV_CODEC_FLAG2_FAST;
+
+	// Hardware decoders don't support lowres.
+	if (!hwAllowed) {
+		auto lowres = 0;
+		while (lowres < codec->max_lowres && enough(lowres + 1)) {
+			++lowres;
+		}
+		context->lowres = lowres;
+	}
+}
+
 [[nodiscard]] enum AVPixelFormat GetHwFormat(
 		AVCodecContext *context,
 		const enum AVPixelFormat *formats) {
@@ -410,6 +437,13 @@ CodecPointer MakeCodecPointer(CodecDescriptor descriptor) {
 		DEBUG_LOG(("Video Info: Using software \"%2\" decoder."
 			).arg(codec->name));
 	}
+	if (!descriptor.decodeSize.isEmpty()) {
+		ApplyDecodeSize(
+			context,
+			codec,
+			descriptor.decodeSize,
+			descriptor.hwAllowed);
+	}
 
 	if ((error = avcodec_open2(context, codec, nullptr))) {
 		LogError(u"avcodec_open2"_q, error);
@@ -153,6 +153,10 @@ using CodecPointer = std::unique_ptr<AVCodecContext, CodecDeleter>;
 struct CodecDescriptor {
 	not_null<AVStream*> stream;
 	bool hwAllowed = false;
+
+	// Frames will be shown at most this large, so the decoder may cut
+	// corners when the stream is much larger than that.
+	QSize decodeSize;
 };
 [[nodiscard]] CodecPointer MakeCodecPointer(CodecDescriptor descriptor);
 
@@ -15,6 +15,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "history/history_item.h"
 #include "history/history_item_components.h"
 #include "history/history_item_helpers.h"
+#include "history/history_slab_allocator.h"
 #include "history/history_streamed_drafts.h"
 #include "history/history_translation.h"
 #include "history/history_unread_things.h"
@@ -1573,6 +1574,7 @@ void History::addEdgesToSharedMedia() {
 }
 
 void History::addOlderSlice(const QVector<MTPMessage> &slice) {
+	owner().histories().markUsed(this);
 	if (slice.isEmpty()) {
 		_loadedAtTop = true;
 		checkLocalMessages();
@@ -1612,6 +1614,7 @@ void History::addCreatedOlderSlice(
 }
 
 void History::addNewerSlice(const QVector<MTPMessage> &slice) {
+	owner().histories().markUsed(this);
 	bool wasLoadedAtBottom = loadedAtBottom();
 
 	if (slice.isEmpty()) {
@@ -3372,6 +3375,10 @@ HistoryItem *History::lastEditableMessage() const {
 }
 
 void History::resizeToWidth(int newWidth) {
+	resizeToWidth(newWidth, 0, std::numeric_limits<int>::max());
+}
+
+void History::resizeToWidth(int newWidth, int exactTop, int exactBottom) {
 	using Request = HistoryBlock::ResizeRequest;
 	const auto request = (_flags & Flag::PendingAllItemsResize)
 		? Request::ReinitAll
@@ -3382,16 +3389,50 @@ void History::resizeToWidth(int newWidth) {
 		return;
 	}
 	_flags &= ~(Flag::HasPendingResizedItems | Flag::PendingAllItemsResize);
+	if (request != Request::ResizePending) {
+		_flags &= ~Flag::HasEstimatedHeights;
+	}
 
 	_width = newWidth;
 	int y = 0;
 	for (const auto &block : blocks) {
+		const auto wasTop = block->y();
 		block->setY(y);
-		y += block->resizeGetHeight(newWidth, request);
+		y += block->resizeGetHeight(
+			newWidth,
+			request,
+			exactTop - wasTop,
+			exactBottom - wasTop);
 	}
 	_height = y;
 }
 
+bool History::layoutEstimated(int top, int bottom) {
+	if (!(_flags & Flag::HasEstimatedHeights)) {
+		return false;
+	}
+	auto found = false;
+	for (const auto &block : blocks) {
+		const auto blockTop = block->y();
+		if (blockTop >= bottom) {
+			break;
+		} else if (blockTop + block->height() <= top) {
+			continue;
+		}
+		for (const auto &message : block->messages) {
+			const auto messageTop = blockTop + message->y();
+			if (messageTop >= bottom) {
+				break;
+			} else if (messageTop + message->height() > top
+				&& message->heightEstimated()) {
+				message->setPendingResize();
+				found = true;
+			}
+		}
+	}
+	return found;
+}
+
 void History::forceFullResize() {
 	_width = 0;
 	_flags |= Flag::HasPendingResizedItems;
@@ -3987,6 +4028,9 @@ void History::clear(ClearType type, bool markEmpty) {
 		channel->mgInfo->markupSenders.clear();
 	}
 
+	// Free the slabs left empty by the destroyed items and views.
+	HistorySlabAllocator::Trim();
+
 	owner().notifyHistoryChangeDelayed(this);
 	owner().sendHistoryChangeNotifications();
 }
@@ -4125,23 +4169,47 @@ HistoryBlock::HistoryBlock(not_null<History*> history)
 : _history(history) {
 }
 
-int HistoryBlock::resizeGetHeight(int newWidth, ResizeRequest request) {
-	auto y = 0;
-	if (request == ResizeRequest::ReinitAll) {
-		for (const auto &message : messages) {
-			message->setY(y);
-			message->initDimensions();
-			y += message->resizeGetHeight(newWidth);
+int HistoryBlock::resizeGetHeight(
+		int newWidth,
+		ResizeRequest request,
+		int exactTop,
+		int exactBottom) {
+	// Laying out thousands of offscreen messages on each window resize
+	// is too slow, they keep the old heights until they are scrolled to.
+	//
+	// The layout itself stays on the main thread: views create media
+	// parts, custom emoji, and loaders while resizing, and they share
+	// the font and emoji caches with the painting.
+	const auto estimate = [&](not_null<Element*> message) {
+		const auto height = message->height();
+		if (!height
+			|| (message->pendingResize() && !message->heightEstimated())) {
+			return false;
 		}
-	} else if (request == ResizeRequest::ResizeAll) {
+		const auto top = message->y();
+		return (top + height <= exactTop) || (top >= exactBottom);
+	};
+	auto y = 0;
+	if (request == ResizeRequest::ReinitAll
+		|| request == ResizeRequest::ResizeAll) {
+		const auto reinit = (request == ResizeRequest::ReinitAll);
 		for (const auto &message : messages) {
+			if (estimate(message.get())) {
+				message->setHeightEstimated();
+				_history->_flags |= History::Flag::HasEstimatedHeights;
+			} else {
+				if (reinit) {
+					message->initDimensions();
+				}
+				message->resizeGetHeight(newWidth);
+			}
 			message->setY(y);
-			y += message->resizeGetHeight(newWidth);
+			y += message->height();
 		}
 	} else {
 		for (const auto &message : messages) {
 			message->setY(y);
-			y += message->pendingResize()
+			y += (message->pendingResize() && !message->heightEstimated())
 				? message->resizeGetHeight(newWidth)
 				: message->height();
 		}
@@ -274,7 +274,12 @@ public:
 	MsgId msgIdForRead() const;
 	HistoryItem *lastEditableMessage() const;
 
+	// On a full relayout only the views intersecting [exactTop, exactBottom)
+	// in the current geometry are laid out, others keep their heights as
+	// estimates until layoutEstimated() is called for their range.
 	void resizeToWidth(int newWidth);
+	void resizeToWidth(int newWidth, int exactTop, int exactBottom);
+	bool layoutEstimated(int top, int bottom);
 	void forceFullResize();
 	int height() const;
 
@@ -492,6 +497,7 @@ private:
 		HasPinnedMessages = (1 << 6),
 		ResolveChatListMessage = (1 << 7),
 		MonoAndForumUnreadInvalidatePending = (1 << 8),
+		HasEstimatedHeights = (1 << 9),
 	};
 	using Flags = base::flags<Flag>;
 	friend inline constexpr auto is_flag_type(Flag) {
@@ -699,7 +705,11 @@ public:
 	void remove(not_null<Element*> view);
 	void refreshView(not_null<Element*> view);
 
-	int resizeGetHeight(int newWidth, ResizeRequest request);
+	int resizeGetHeight(
+		int newWidth,
+		ResizeRequest request,
+		int exactTop,
+		int exactBottom);
 	int y() const {
 		return _y;
 	}
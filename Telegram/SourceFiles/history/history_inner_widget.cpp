@@ -65,6 +65,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "chat_helpers/emoji_interactions.h"
 #include "history/history_widget.h"
 #include "history/view/history_view_translate_tracker.h"
+#include "history/view/history_view_media_prefetch.h"
 #include "base/platform/base_platform_info.h"
 #include "base/qt/qt_common_adapters.h"
 #include "base/qt/qt_key_modifiers.h"
@@ -78,6 +79,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "menu/menu_item_rate_transcribe_session.h"
 #include "menu/menu_sponsored.h"
 #include "core/application.h"
+#include "core/core_tracing.h"
 #include "apiwrap.h"
 #include "api/api_attached_stickers.h"
 #include "api/api_suggest_post.h"
@@ -113,6 +115,7 @@ namespace {
 
 constexpr auto kScrollDateHideTimeout = 1000;
 constexpr auto kUnloadHeavyPartsPages = 2;
+constexpr auto kExactLayoutPages = 1;
 constexpr auto kClearUserpicsAfter = 50;
 
 // Helper binary search for an item in a list that is not completely
@@ -321,6 +324,8 @@ HistoryInner::HistoryInner(
 	[=](not_null<const Element*> view) { return itemTop(view); }))
 , _migrated(history->migrateFrom())
 , _translateTracker(std::make_unique<HistoryView::TranslateTracker>(history))
+, _mediaPrefetch(
+	std::make_unique<HistoryView::MediaPrefetch>(&history->session()))
 , _pathGradient(
 	HistoryView::MakePathShiftGradient(
 		controller->chatStyle(),
@@ -1075,6 +1080,7 @@ void HistoryInner::startEffectOnRead(not_null<HistoryItem*> item) {
 }
 
 void HistoryInner::paintEvent(QPaintEvent *e) {
+	const auto trace = Core::Tracing::Scope("ui", "HistoryInner::paintEvent");
 	if (_controller->contentOverlapped(this, e)
 		|| hasPendingResizedItems()) {
 		return;
@@ -3534,9 +3540,26 @@ void HistoryInner::recountHistoryGeometry(bool initial) {
 
 	updateBotInfo(false);
 
-	_history->resizeToWidth(_contentWidth);
+	// Before the first scroll we don't know what part will be visible.
+	const auto exact = !initial && (_visibleAreaBottom > _visibleAreaTop);
+	const auto exactTop = _visibleAreaTop - kExactLayoutPages * visibleHeight;
+	const auto exactBottom = _visibleAreaBottom
+		+ kExactLayoutPages * visibleHeight;
+	const auto resize = [&](not_null<History*> history, int top) {
+		if (exact && top >= 0) {
+			history->resizeToWidth(
+				_contentWidth,
+				exactTop - top,
+				exactBottom - top);
+		} else {
+			history->resizeToWidth(_contentWidth);
+		}
+	};
+	const auto historyWasTop = historyTop();
+	const auto migratedWasTop = migratedTop();
+	resize(_history, historyWasTop);
 	if (_migrated) {
-		_migrated->resizeToWidth(_contentWidth);
+		resize(_migrated, migratedWasTop);
 	}
 
 	// With migrated history we perhaps do not need to display
@@ -3639,6 +3662,9 @@ void HistoryInner::visibleAreaUpdated(int top, int bottom) {
 			}
 		}
 	}
+
+	// The scroll state is the anchor kept when estimates are replaced.
+	layoutEstimatedItems(top, bottom);
 	if (scrolledUp) {
 		_scrollDateCheck.call();
 	} else {
@@ -3662,12 +3688,58 @@ void HistoryInner::visibleAreaUpdated(int top, int bottom) {
 			till);
 	}
 	checkActivation();
+	prefetchMedia();
 
 	_emojiInteractions->visibleAreaUpdated(
 		_visibleAreaTop,
 		_visibleAreaBottom);
 }
 
+void HistoryInner::prefetchMedia() {
+	const auto area = _mediaPrefetch->visibleAreaUpdated(
+		_visibleAreaTop,
+		_visibleAreaBottom);
+	if (!area) {
+		return;
+	}
+	const auto addFrom = [&](History *history, int historytop) {
+		if (!history || historytop < 0 || history->isEmpty()) {
+			return;
+		} else if (area.till <= historytop
+			|| historytop + history->height() <= area.from) {
+			return;
+		}
+		const auto &blocks = history->blocks;
+		auto blockIndex = BinarySearchBlocksOrItems<true>(
+			blocks,
+			area.from - historytop);
+		for (; blockIndex != int(blocks.size()); ++blockIndex) {
+			const auto block = blocks[blockIndex].get();
+			const auto blocktop = historytop + block->y();
+			if (blocktop >= area.till) {
+				return;
+			}
+			const auto &messages = block->messages;
+			auto itemIndex = BinarySearchBlocksOrItems<true>(
+				messages,
+				area.from - blocktop);
+			for (; itemIndex != int(messages.size()); ++itemIndex) {
+				const auto view = messages[itemIndex].get();
+				const auto itemtop = blocktop + view->y();
+				if (itemtop >= area.till) {
+					return;
+				} else if (itemtop + view->height() > area.from) {
+					_mediaPrefetch->add(view);
+				}
+			}
+		}
+	};
+	_mediaPrefetch->startBunch();
+	addFrom(_migrated, migratedTop());
+	addFrom(_history, historyTop());
+	_mediaPrefetch->finishBunch();
+}
+
 bool HistoryInner::displayScrollDate() const {
 	return (_visibleAreaTop <= height() - 2 * (_visibleAreaBottom - _visibleAreaTop));
 }
@@ -4873,6 +4945,21 @@ bool HistoryInner::hasPendingResizedItems() const {
 		|| (_migrated && _migrated->hasPendingResizedItems());
 }
 
+void HistoryInner::layoutEstimatedItems(int top, int bottom) {
+	const auto skip = kExactLayoutPages * (bottom - top);
+	const auto check = [&](History *history, int historyTop) {
+		if (history
+			&& historyTop >= 0
+			&& history->layoutEstimated(
+				top - skip - historyTop,
+				bottom + skip - historyTop)) {
+			session().data().notifyHistoryChangeDelayed(history);
+		}
+	};
+	check(_history, historyTop());
+	check(_migrated, migratedTop());
+}
+
 void HistoryInner::deleteAsGroup(FullMsgId itemId) {
 	if (const auto item = session().data().message(itemId)) {
 		const auto group = session().data().groups().find(item);
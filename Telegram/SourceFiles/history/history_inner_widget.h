@@ -39,6 +39,7 @@ enum class ElementChatMode : char;
 class EmptyPainter;
 class Element;
 class TranslateTracker;
+class MediaPrefetch;
 struct PinnedId;
 struct SelectedQuote;
 class AboutView;
@@ -324,6 +325,7 @@ private:
 	void enumerateForumThreadBars(Method method);
 
 	void scrollDateCheck();
+	void prefetchMedia();
 	void scrollDateHideByTimer();
 	bool canHaveFromUserpics() const;
 	void mouseActionStart(const QPoint &screenPos, Qt::MouseButton button);
@@ -455,6 +457,7 @@ private:
 
 	// Does any of the shown histories has this flag set.
 	bool hasPendingResizedItems() const;
+	void layoutEstimatedItems(int top, int bottom);
 
 	const not_null<HistoryWidget*> _widget;
 	const not_null<Ui::ScrollArea*> _scroll;
@@ -485,6 +488,7 @@ private:
 	std::unique_ptr<HistoryView::AboutView> _aboutView;
 	std::unique_ptr<HistoryView::EmptyPainter> _emptyPainter;
 	std::unique_ptr<HistoryView::TranslateTracker> _translateTracker;
+	const std::unique_ptr<HistoryView::MediaPrefetch> _mediaPrefetch;
 	rpl::event_stream<not_null<DocumentData*>> _sendIntroSticker;
 
 	mutable History *_curHistory = nullptr;
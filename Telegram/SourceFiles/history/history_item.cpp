@@ -17,6 +17,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "history/view/media/history_view_media_grouped.h"
 #include "history/history_item_components.h"
 #include "history/history_item_helpers.h"
+#include "history/history_slab_allocator.h"
 #include "history/history_unread_things.h"
 #include "history/history.h"
 #include "iv/iv_data.h"
@@ -804,6 +805,14 @@ HistoryItem::~HistoryItem() {
 	applyTTL(0);
 }
 
+void *HistoryItem::operator new(std::size_t size) {
+	return HistorySlabFor<HistoryItem>().allocate(size);
+}
+
+void HistoryItem::operator delete(void *pointer) {
+	HistorySlabFor<HistoryItem>().deallocate(pointer);
+}
+
 TimeId HistoryItem::date() const {
 	return _date;
 }
@@ -3753,7 +3762,7 @@ void HistoryItem::setTextValue(TextWithEntities text, bool force) {
 		history()->owner().registerHighlightProcess(processId, this);
 	}
 	const auto had = !_text.empty();
-	_text = std::move(text);
+	_text = history()->owner().shareText(std::move(text));
 	RemoveComponents(HistoryMessageTranslation::Bit());
 	if (had || force) {
 		history()->owner().requestItemTextRefresh(this);
@@ -169,6 +169,10 @@ public:
 		not_null<GameData*> game);
 	~HistoryItem();
 
+	// Allocated from HistorySlabFor<HistoryItem>().
+	static void *operator new(std::size_t size);
+	static void operator delete(void *pointer);
+
 	struct Destroyer {
 		void operator()(HistoryItem *value);
 	};
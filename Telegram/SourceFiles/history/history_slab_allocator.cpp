@@ -0,0 +1,138 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "history/history_slab_allocator.h"
+
+#include <new>
+
+namespace {
+
+constexpr auto kSlabSize = std::size_t(64 * 1024);
+constexpr auto kAlignment = alignof(std::max_align_t);
+constexpr auto kKeepEmptySlabs = 1;
+
+[[nodiscard]] constexpr std::size_t AlignUp(std::size_t value) {
+	return (value + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+[[nodiscard]] std::vector<not_null<HistorySlabAllocator*>> &Allocators() {
+	static auto result = std::vector<not_null<HistorySlabAllocator*>>();
+	return result;
+}
+
+} // namespace
+
+struct HistorySlabAllocator::Slab {
+	void *free = nullptr;
+	int carved = 0;
+	int used = 0;
+	Slab *previous = nullptr;
+	Slab *next = nullptr;
+};
+
+HistorySlabAllocator::HistorySlabAllocator(std::size_t size)
+: _size(AlignUp(std::max(size, sizeof(void*))))
+, _offset(AlignUp(sizeof(Slab)))
+, _perSlab(int((kSlabSize - _offset) / _size)) {
+	Expects(_perSlab > 1);
+
+	Allocators().push_back(this);
+}
+
+void *HistorySlabAllocator::allocate(std::size_t size) {
+	Expects(size <= _size);
+
+	if (!_available) {
+		link(createSlab());
+	}
+	const auto slab = _available;
+	auto result = slab->free;
+	if (result) {
+		slab->free = *static_cast<void**>(result);
+	} else {
+		result = reinterpret_cast<char*>(slab)
+			+ _offset
+			+ (slab->carved++) * _size;
+	}
+	if (++slab->used == _perSlab) {
+		unlink(slab);
+	}
+	++_used;
+	return result;
+}
+
+void HistorySlabAllocator::deallocate(void *pointer) {
+	if (!pointer) {
+		return;
+	}
+	const auto slab = reinterpret_cast<Slab*>(
+		reinterpret_cast<std::uintptr_t>(pointer) & ~(kSlabSize - 1));
+	Assert(slab->used > 0);
+
+	*static_cast<void**>(pointer) = slab->free;
+	slab->free = pointer;
+	if (slab->used-- == _perSlab) {
+		link(slab);
+	}
+	--_used;
+}
+
+void HistorySlabAllocator::Trim() {
+	auto used = int64();
+	auto slabs = 0;
+	for (const auto allocator : Allocators()) {
+		allocator->trim();
+		used += allocator->_used;
+		slabs += allocator->_slabs;
+	}
+	DEBUG_LOG(("History Slabs: %1 objects in %2 slabs after trim."
+		).arg(used
+		).arg(slabs));
+}
+
+auto HistorySlabAllocator::createSlab() -> Slab* {
+	const auto memory = ::operator new(
+		kSlabSize,
+		std::align_val_t(kSlabSize));
+	++_slabs;
+	return new (memory) Slab();
+}
+
+void HistorySlabAllocator::link(not_null<Slab*> slab) {
+	slab->previous = nullptr;
+	slab->next = _available;
+	if (_available) {
+		_available->previous = slab;
+	}
+	_available = slab;
+}
+
+void HistorySlabAllocator::unlink(not_null<Slab*> slab) {
+	if (slab->previous) {
+		slab->previous->next = slab->next;
+	} else {
+		_available = slab->next;
+	}
+	if (slab->next) {
+		slab->next->previous = slab->previous;
+	}
+	slab->previous = slab->next = nullptr;
+}
+
+void HistorySlabAllocator::trim() {
+	auto kept = 0;
+	for (auto slab = _available; slab;) {
+		const auto next = slab->next;
+		if (!slab->used && ++kept > kKeepEmptySlabs) {
+			unlink(slab);
+			slab->~Slab();
+			::operator delete(slab, std::align_val_t(kSlabSize));
+			--_slabs;
+		}
+		slab = next;
+	}
+}
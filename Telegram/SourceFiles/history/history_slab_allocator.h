@@ -0,0 +1,49 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+// Fixed size blocks carved from large aligned slabs, for the objects
+// created with every loaded message: items and their views. Keeps them
+// close to each other in memory and spares the system allocator hundreds
+// of thousands of small requests when a big history is loaded. Slabs
+// left without used blocks are given back only in Trim(), so a history
+// unloaded and loaded back reuses them. Main thread only.
+class HistorySlabAllocator final {
+public:
+	explicit HistorySlabAllocator(std::size_t size);
+
+	[[nodiscard]] void *allocate(std::size_t size);
+	void deallocate(void *pointer);
+
+	// Frees the empty slabs of all the allocators.
+	static void Trim();
+
+private:
+	struct Slab;
+
+	[[nodiscard]] Slab *createSlab();
+	void link(not_null<Slab*> slab);
+	void unlink(not_null<Slab*> slab);
+	void trim();
+
+	const std::size_t _size = 0;
+	const std::size_t _offset = 0;
+	const int _perSlab = 0;
+
+	Slab *_available = nullptr; // Slabs with free blocks.
+	int64 _used = 0;
+	int _slabs = 0;
+
+};
+
+template <typename Type>
+[[nodiscard]] HistorySlabAllocator &HistorySlabFor() {
+	// Never destroyed, objects may outlive the static destructors.
+	static const auto result = new HistorySlabAllocator(sizeof(Type));
+	return *result;
+}
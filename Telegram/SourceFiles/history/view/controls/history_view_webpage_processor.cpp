@@ -12,6 +12,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_file_origin.h"
 #include "data/data_session.h"
 #include "data/data_web_page.h"
+#include "data/data_web_page_previews.h"
 #include "history/history.h"
 #include "lang/lang_keys.h"
 #include "main/main_session.h"
@@ -111,23 +112,40 @@ WebPageText ProcessWebPageData(WebPageData *page) {
 }
 
 WebpageResolver::WebpageResolver(not_null<Main::Session*> session)
-: _session(session)
-, _api(&session->mtp()) {
+: _session(session) {
+	previews().resolved() | rpl::start_with_next([=](const QString &link) {
+		_requested.remove(link);
+	}, _lifetime);
+}
+
+WebpageResolver::~WebpageResolver() {
+	for (const auto &link : base::take(_requested)) {
+		previews().cancel(link);
+	}
+}
+
+Data::WebPagePreviews &WebpageResolver::previews() const {
+	return _session->data().webPagePreviews();
 }
 
 std::optional<WebPageData*> WebpageResolver::lookup(
 		const QString &link) const {
-	const auto i = _cache.find(link);
-	return (i == end(_cache))
-		? std::optional<WebPageData*>()
-		: (i->second && !i->second->failed)
-		? i->second
-		: nullptr;
+	const auto result = previews().lookup(link);
+	if (result) {
+		_known.emplace(link);
+	}
+	return result;
+}
+
+rpl::producer<QString> WebpageResolver::resolved() const {
+	return previews().resolved() | rpl::filter([=](const QString &link) {
+		return _known.contains(link);
+	});
 }
 
 QString WebpageResolver::find(not_null<WebPageData*> page) const {
-	for (const auto &[link, cached] : _cache) {
-		if (cached == page) {
+	for (const auto &link : _known) {
+		if (previews().lookup(link).value_or(nullptr) == page) {
 			return link;
 		}
 	}
@@ -135,53 +153,17 @@ QString WebpageResolver::find(not_null<WebPageData*> page) const {
 }
 
 void WebpageResolver::request(const QString &link, bool force) {
-	if (_requestLink == link && !force) {
+	_known.emplace(link);
+	if (!_requested.emplace(link).second) {
+		// The shared request is already in flight.
 		return;
 	}
-	const auto done = [=](const MTPDmessageMediaWebPage &data) {
-		const auto page = _session->data().processWebpage(data.vwebpage());
-		if (page->pendingTill > 0
-			&& page->pendingTill < base::unixtime::now()) {
-			page->pendingTill = 0;
-			page->failed = true;
-		}
-		_cache.emplace(link, page->failed ? nullptr : page.get());
-		_resolved.fire_copy(link);
-	};
-	const auto fail = [=] {
-		_cache.emplace(link, nullptr);
-		_resolved.fire_copy(link);
-	};
-	_requestLink = link;
-	_requestId = _api.request(
-		MTPmessages_GetWebPagePreview(
-			MTP_flags(0),
-			MTP_string(link),
-			MTPVector<MTPMessageEntity>()
-	)).done([=](
-			const MTPmessages_WebPagePreview &result,
-			mtpRequestId requestId) {
-		if (_requestId == requestId) {
-			_requestId = 0;
-		}
-		const auto &data = result.data();
-		_session->data().processUsers(data.vusers());
-		data.vmedia().match([=](const MTPDmessageMediaWebPage &data) {
-			done(data);
-		}, [&](const auto &d) {
-			fail();
-		});
-	}).fail([=](const MTP::Error &error, mtpRequestId requestId) {
-		if (_requestId == requestId) {
-			_requestId = 0;
-		}
-		fail();
-	}).send();
+	previews().request(link, force);
 }
 
 void WebpageResolver::cancel(const QString &link) {
-	if (_requestLink == link) {
-		_api.request(base::take(_requestId)).cancel();
+	if (_requested.remove(link)) {
+		previews().cancel(link);
 	}
 }
 
@@ -9,10 +9,13 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "data/data_drafts.h"
 #include "chat_helpers/message_field.h"
-#include "mtproto/sender.h"
 
 class History;
 
+namespace Data {
+class WebPagePreviews;
+} // namespace Data
+
 namespace Main {
 class Session;
 } // namespace Main
@@ -50,15 +53,16 @@ struct WebpageParsed {
 	}
 };
 
+// Remembers the links of one compose field, the previews themselves are
+// shared by the whole session in Data::WebPagePreviews.
 class WebpageResolver final {
 public:
 	explicit WebpageResolver(not_null<Main::Session*> session);
+	~WebpageResolver();
 
 	[[nodiscard]] std::optional<WebPageData*> lookup(
 			const QString &link) const;
-	[[nodiscard]] rpl::producer<QString> resolved() const {
-		return _resolved.events();
-	}
+	[[nodiscard]] rpl::producer<QString> resolved() const;
 
 	[[nodiscard]] QString find(not_null<WebPageData*> page) const;
 
@@ -66,13 +70,12 @@ public:
 	void cancel(const QString &link);
 
 private:
-	const not_null<Main::Session*> _session;
-	MTP::Sender _api;
-	base::flat_map<QString, WebPageData*> _cache;
-	rpl::event_stream<QString> _resolved;
+	[[nodiscard]] Data::WebPagePreviews &previews() const;
 
-	QString _requestLink;
-	mtpRequestId _requestId = 0;
+	const not_null<Main::Session*> _session;
+	mutable base::flat_set<QString> _known;
+	base::flat_set<QString> _requested;
+	rpl::lifetime _lifetime;
 
 };
 
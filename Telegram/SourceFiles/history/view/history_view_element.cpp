@@ -992,6 +992,7 @@ void Element::addVerticalMargins(int top, int bottom) {
 
 void Element::setPendingResize() {
 	_flags |= Flag::NeedsResize;
+	_flags &= ~Flag::HeightEstimated;
 	if (_context == Context::History) {
 		data()->_history->setHasPendingResizedItems();
 	}
@@ -1001,6 +1002,14 @@ bool Element::pendingResize() const {
 	return _flags & Flag::NeedsResize;
 }
 
+void Element::setHeightEstimated() {
+	_flags |= Flag::NeedsResize | Flag::HeightEstimated;
+}
+
+bool Element::heightEstimated() const {
+	return _flags & Flag::HeightEstimated;
+}
+
 bool Element::isAttachedToPrevious() const {
 	return _flags & Flag::AttachedToPrevious;
 }
@@ -1710,6 +1719,7 @@ QSize Element::countOptimalSize() {
 }
 
 QSize Element::countCurrentSize(int newWidth) {
+	_flags &= ~Flag::HeightEstimated;
 	if (_flags & Flag::NeedsResize) {
 		initDimensions();
 	}
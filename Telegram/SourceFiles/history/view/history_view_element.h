@@ -394,6 +394,7 @@ public:
 		TopicRootReply           = 0x0400,
 		MediaOverriden           = 0x0800,
 		HeavyCustomEmoji         = 0x1000,
+		HeightEstimated          = 0x2000,
 	};
 	using Flags = base::flags<Flag>;
 	friend inline constexpr auto is_flag_type(Flag) { return true; }
@@ -434,6 +435,10 @@ public:
 
 	void setPendingResize();
 	[[nodiscard]] bool pendingResize() const;
+
+	// Keeps the current height until the view is laid out on demand.
+	void setHeightEstimated();
+	[[nodiscard]] bool heightEstimated() const;
 	[[nodiscard]] bool isUnderCursor() const;
 
 	[[nodiscard]] bool isLastAndSelfMessage() const;
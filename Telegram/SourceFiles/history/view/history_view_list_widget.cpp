@@ -26,6 +26,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "history/view/history_view_service_message.h"
 #include "history/view/history_view_cursor_state.h"
 #include "history/view/history_view_translate_tracker.h"
+#include "history/view/history_view_media_prefetch.h"
 #include "history/view/history_view_quick_action.h"
 #include "chat_helpers/message_field.h"
 #include "mainwindow.h"
@@ -33,6 +34,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/application.h"
 #include "core/click_handler_types.h"
 #include "core/core_settings.h"
+#include "core/core_tracing.h"
 #include "core/phone_click_handler.h"
 #include "apiwrap.h"
 #include "api/api_who_reacted.h"
@@ -90,6 +92,10 @@ constexpr auto kPreloadedScreensCountFull
 	= kPreloadedScreensCount + 1 + kPreloadedScreensCount;
 constexpr auto kClearUserpicsAfter = 50;
 
+// Parts of files finish loading many times a second in busy chats, the
+// whole visible area is repainted for them at most this often.
+constexpr auto kLoadedRepaintDelay = crl::time(50);
+
 [[nodiscard]] std::unique_ptr<TranslateTracker> MaybeTranslateTracker(
 		History *history) {
 	return history ? std::make_unique<TranslateTracker>(history) : nullptr;
@@ -403,6 +409,7 @@ ListWidget::ListWidget(
 	this,
 	[=](QRect updated) { update(updated); }))
 , _translateTracker(MaybeTranslateTracker(_delegate->listTranslateHistory()))
+, _mediaPrefetch(std::make_unique<MediaPrefetch>(session))
 , _scrollDateCheck([this] { scrollDateCheck(); })
 , _applyUpdatedScrollState([this] { applyUpdatedScrollState(); })
 , _selectEnabled(_delegate->listAllowsMultiSelect())
@@ -410,6 +417,7 @@ ListWidget::ListWidget(
 	&_session->data(),
 	[=](const HistoryItem *item) { return viewForItem(item); },
 	[=](const Element *view) { repaintItem(view); })
+, _loadedRepaintTimer([=] { update(); })
 , _touchSelectTimer([=] { onTouchSelect(); })
 , _touchScrollTimer([=] { onTouchScrollTimer(); }) {
 	setAttribute(Qt::WA_AcceptTouchEvents);
@@ -448,14 +456,13 @@ ListWidget::ListWidget(
 		}
 	}, lifetime());
 
-	_session->downloaderTaskFinished(
+	rpl::merge(
+		_session->downloaderTaskFinished(),
+		_session->data().peerDecorationsUpdated() | rpl::to_empty
 	) | rpl::start_with_next([=] {
-		update();
-	}, lifetime());
-
-	_session->data().peerDecorationsUpdated(
-	) | rpl::start_with_next([=] {
-		update();
+		if (!_loadedRepaintTimer.isActive()) {
+			_loadedRepaintTimer.callOnce(kLoadedRepaintDelay);
+		}
 	}, lifetime());
 
 	_session->data().itemRemoved(
@@ -1139,10 +1146,31 @@ void ListWidget::visibleTopBottomUpdated(
 	_delegate->listVisibleAreaUpdated();
 	session().data().itemVisibilitiesUpdated();
 	_applyUpdatedScrollState.call();
+	prefetchMedia();
 
 	_emojiInteractions->visibleAreaUpdated(_visibleTop, _visibleBottom);
 }
 
+void ListWidget::prefetchMedia() {
+	const auto area = _mediaPrefetch->visibleAreaUpdated(
+		_visibleTop,
+		_visibleBottom);
+	if (!area || _items.empty()) {
+		return;
+	}
+	_mediaPrefetch->startBunch();
+	for (auto i = findItemIndexByY(area.from); i != int(_items.size()); ++i) {
+		const auto view = _items[i];
+		const auto top = itemTop(view);
+		if (top >= area.till) {
+			break;
+		} else if (top + view->height() > area.from) {
+			_mediaPrefetch->add(view);
+		}
+	}
+	_mediaPrefetch->finishBunch();
+}
+
 void ListWidget::applyUpdatedScrollState() {
 	checkMoveToOtherViewer();
 }
@@ -2240,6 +2268,7 @@ void ListWidget::checkActivation() {
 }
 
 void ListWidget::paintEvent(QPaintEvent *e) {
+	const auto trace = Core::Tracing::Scope("ui", "ListWidget::paintEvent");
 	if (_delegate->listIgnorePaintEvent(this, e)) {
 		return;
 	} else if (_translateTracker) {
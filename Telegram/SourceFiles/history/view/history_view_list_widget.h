@@ -62,6 +62,7 @@ struct TextState;
 struct StateRequest;
 class EmojiInteractions;
 class TranslateTracker;
+class MediaPrefetch;
 enum class CursorState : char;
 enum class PointState : char;
 enum class Context : char;
@@ -590,6 +591,7 @@ private:
 
 	void checkMoveToOtherViewer();
 	void updateVisibleTopItem();
+	void prefetchMedia();
 	void updateItemsGeometry();
 	void updateSize();
 	void refreshAttachmentsFromTill(int from, int till);
@@ -778,6 +780,7 @@ private:
 	bool _useCornerReaction = false;
 
 	std::unique_ptr<TranslateTracker> _translateTracker;
+	const std::unique_ptr<MediaPrefetch> _mediaPrefetch;
 
 	int _minHeight = 0;
 	int _visibleTop = 0;
@@ -841,6 +844,7 @@ private:
 	crl::time _trippleClickStartTime = 0;
 
 	ElementHighlighter _highlighter;
+	base::Timer _loadedRepaintTimer;
 
 	mutable bool _lastInSelectionMode = false;
 	mutable Ui::Animations::Simple _inSelectionModeAnimation;
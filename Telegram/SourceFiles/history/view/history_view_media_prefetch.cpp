@@ -0,0 +1,143 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "history/view/history_view_media_prefetch.h"
+
+#include "data/data_auto_download.h"
+#include "data/data_document.h"
+#include "data/data_document_media.h"
+#include "data/data_media_preload.h"
+#include "data/data_media_types.h"
+#include "data/data_photo.h"
+#include "data/data_photo_media.h"
+#include "history/history.h"
+#include "history/history_item.h"
+#include "history/view/history_view_element.h"
+#include "main/main_session.h"
+#include "main/main_session_settings.h"
+
+namespace HistoryView {
+namespace {
+
+// How far ahead to look, in the time of scrolling at the current speed.
+constexpr auto kLookAhead = crl::time(700);
+constexpr auto kMinLookAheadScreens = 0.5;
+constexpr auto kMaxLookAheadScreens = 4.;
+constexpr auto kSpeedSmoothing = 0.4;
+constexpr auto kSpeedResetTimeout = crl::time(300);
+constexpr auto kMaxItemsInBunch = 24;
+constexpr auto kMaxVideosInBunch = 2;
+
+} // namespace
+
+MediaPrefetch::MediaPrefetch(not_null<Main::Session*> session)
+: _session(session) {
+}
+
+MediaPrefetch::~MediaPrefetch() = default;
+
+auto MediaPrefetch::visibleAreaUpdated(int top, int bottom) -> Area {
+	const auto now = crl::now();
+	const auto height = bottom - top;
+	const auto elapsed = now - _lastTime;
+	const auto shift = top - _lastTop;
+	_lastTime = now;
+	_lastTop = top;
+	if (height <= 0 || !shift) {
+		return {};
+	} else if (elapsed <= 0 || elapsed > kSpeedResetTimeout) {
+		// Resting or jumping, only the direction is known.
+		_speed = 0.;
+	} else {
+		const auto speed = shift / float64(elapsed);
+		_speed = (_speed == 0.)
+			? speed
+			: (_speed * (1. - kSpeedSmoothing) + speed * kSpeedSmoothing);
+	}
+	const auto direction = (shift > 0) ? 1 : -1;
+	if (_direction != direction) {
+		_direction = direction;
+		_tasks.clear();
+	}
+	const auto distance = std::clamp(
+		int(std::abs(_speed) * kLookAhead),
+		int(height * kMinLookAheadScreens),
+		int(height * kMaxLookAheadScreens));
+	return (direction > 0)
+		? Area{ bottom, bottom + distance }
+		: Area{ top - distance, top };
+}
+
+void MediaPrefetch::startBunch() {
+	_addedInBunch = 0;
+	_videosInBunch = 0;
+	++_generation;
+}
+
+void MediaPrefetch::add(not_null<Element*> view) {
+	Expects(_addedInBunch >= 0);
+
+	if (_addedInBunch >= kMaxItemsInBunch) {
+		return;
+	}
+	const auto item = view->data();
+	const auto media = item->media();
+	if (!media) {
+		return;
+	}
+	const auto photo = media->photo();
+	const auto document = media->document();
+	if (!photo && !document) {
+		return;
+	}
+	++_addedInBunch;
+
+	auto &task = _tasks[item->fullId()];
+	task.generation = _generation;
+	const auto origin = item->fullId();
+	const auto &settings = _session->settings().autoDownload();
+	const auto peer = item->history()->peer;
+	if (photo) {
+		if (!task.photo) {
+			task.photo = photo->createMediaView();
+			task.photo->wanted(Data::PhotoSize::Small, origin);
+			if (Data::PhotoPreload::Should(photo, peer)) {
+				photo->load(origin, LoadFromCloudOrLocal, true);
+			}
+		}
+	} else if (!task.document) {
+		task.document = document->createMediaView();
+		task.document->thumbnailWanted(origin);
+	}
+	if (document
+		&& !task.video
+		&& _videosInBunch < kMaxVideosInBunch
+		&& document->isVideoFile()
+		&& Data::VideoPreload::Can(document)
+		&& Data::AutoDownload::Should(settings, peer, document)) {
+		++_videosInBunch;
+		task.video = std::make_unique<Data::VideoPreload>(
+			document,
+			origin,
+			[] {});
+	}
+}
+
+void MediaPrefetch::finishBunch() {
+	Expects(_addedInBunch >= 0);
+
+	_addedInBunch = -1;
+	for (auto i = begin(_tasks); i != end(_tasks);) {
+		if (i->second.generation != _generation) {
+			i = _tasks.erase(i);
+		} else {
+			++i;
+		}
+	}
+}
+
+} // namespace HistoryView
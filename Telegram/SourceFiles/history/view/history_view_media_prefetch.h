@@ -0,0 +1,68 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Data {
+class PhotoMedia;
+class DocumentMedia;
+class VideoPreload;
+} // namespace Data
+
+namespace Main {
+class Session;
+} // namespace Main
+
+namespace HistoryView {
+
+class Element;
+
+// Starts loading thumbnails and the first parts of videos for the items
+// that are about to be scrolled into view, judging by the scroll speed.
+// Once the direction changes, the items left before are dropped.
+class MediaPrefetch final {
+public:
+	explicit MediaPrefetch(not_null<Main::Session*> session);
+	~MediaPrefetch();
+
+	struct Area {
+		int from = 0;
+		int till = 0;
+
+		explicit operator bool() const {
+			return (from < till);
+		}
+	};
+	// The elements in the returned area should be added in a bunch.
+	[[nodiscard]] Area visibleAreaUpdated(int top, int bottom);
+
+	void startBunch();
+	void add(not_null<Element*> view);
+	void finishBunch();
+
+private:
+	struct Task {
+		std::shared_ptr<Data::PhotoMedia> photo;
+		std::shared_ptr<Data::DocumentMedia> document;
+		std::unique_ptr<Data::VideoPreload> video;
+		uint64 generation = 0;
+	};
+
+	const not_null<Main::Session*> _session;
+	base::flat_map<FullMsgId, Task> _tasks;
+	uint64 _generation = 0;
+	int _addedInBunch = -1;
+	int _videosInBunch = 0;
+
+	crl::time _lastTime = 0;
+	int _lastTop = 0;
+	float64 _speed = 0.; // Pixels per millisecond, positive down.
+	int _direction = 0;
+
+};
+
+} // namespace HistoryView
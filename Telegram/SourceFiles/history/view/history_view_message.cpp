@@ -15,6 +15,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "history/view/history_view_cursor_state.h"
 #include "history/history_item_components.h"
 #include "history/history_item_helpers.h"
+#include "history/history_slab_allocator.h"
 #include "history/view/media/history_view_media_generic.h"
 #include "history/view/media/history_view_web_page.h"
 #include "history/view/media/history_view_suggest_decision.h"
@@ -458,6 +459,14 @@ Message::~Message() {
 	}
 }
 
+void *Message::operator new(std::size_t size) {
+	return HistorySlabFor<Message>().allocate(size);
+}
+
+void Message::operator delete(void *pointer) {
+	HistorySlabFor<Message>().deallocate(pointer);
+}
+
 void Message::refreshSuggestedInfo(
 		not_null<HistoryItem*> item,
 		not_null<const HistoryMessageSuggestedPost*> suggest,
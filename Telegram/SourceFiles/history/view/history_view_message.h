@@ -71,6 +71,10 @@ public:
 		Element *replacing);
 	~Message();
 
+	// Allocated from HistorySlabFor<Message>().
+	static void *operator new(std::size_t size);
+	static void operator delete(void *pointer);
+
 	void clickHandlerPressedChanged(
 		const ClickHandlerPtr &handler,
 		bool pressed) override;
@@ -14,6 +14,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "history/history_item.h"
 #include "history/history_item_components.h"
 #include "history/history_item_helpers.h"
+#include "history/history_slab_allocator.h"
 #include "data/data_abstract_structure.h"
 #include "data/data_chat.h"
 #include "data/data_channel.h"
@@ -411,6 +412,14 @@ Service::Service(
 	setupReactions(replacing);
 }
 
+void *Service::operator new(std::size_t size) {
+	return HistorySlabFor<Service>().allocate(size);
+}
+
+void Service::operator delete(void *pointer) {
+	HistorySlabFor<Service>().deallocate(pointer);
+}
+
 QRect Service::innerGeometry() const {
 	return countGeometry();
 }
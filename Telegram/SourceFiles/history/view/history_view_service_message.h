@@ -33,6 +33,10 @@ public:
 		not_null<HistoryItem*> data,
 		Element *replacing);
 
+	// Allocated from HistorySlabFor<Service>().
+	static void *operator new(std::size_t size);
+	static void operator delete(void *pointer);
+
 	int marginTop() const override;
 	int marginBottom() const override;
 	bool isHidden() const override;
@@ -69,6 +69,39 @@ constexpr auto kMaxGifForwardedBarLines = 4;
 constexpr auto kUseNonBlurredThreshold = 240;
 constexpr auto kMaxInlineArea = 1920 * 1080;
 
+// Small clips decode fast enough in software, while each accelerated
+// decoder takes a device context and a session limited by the driver.
+constexpr auto kMinHwAcceleratedArea = 1280 * 720;
+
+// Above this many decoding clips new autoplays wait with thumbnails.
+constexpr auto kMaxPlayingStreams = 16;
+
+struct PlayingStreams {
+	int count = 0;
+	std::deque<not_null<const Gif*>> waiting; // Oldest first.
+};
+
+[[nodiscard]] PlayingStreams &Playing() {
+	static auto result = PlayingStreams();
+	return result;
+}
+
+void RemoveWaiting(not_null<const Gif*> gif) {
+	auto &waiting = Playing().waiting;
+	waiting.erase(ranges::remove(waiting, gif), end(waiting));
+}
+
+[[nodiscard]] bool TakePlayingSlot(not_null<const Gif*> gif) {
+	auto &playing = Playing();
+	if (playing.count < kMaxPlayingStreams) {
+		RemoveWaiting(gif);
+		return true;
+	} else if (!ranges::contains(playing.waiting, gif)) {
+		playing.waiting.push_back(gif);
+	}
+	return false;
+}
+
 [[nodiscard]] int GifMaxStatusWidth(not_null<DocumentData*> document) {
 	auto result = st::normalFont->width(
 		Ui::FormatDownloadText(document->size, document->size));
@@ -221,6 +254,7 @@ Gif::Gif(
 }
 
 Gif::~Gif() {
+	RemoveWaiting(this);
 	if (_streamed || _dataMedia) {
 		if (_streamed) {
 			_data->owner().streaming().keepAlive(_data);
@@ -495,7 +529,7 @@ void Gif::draw(Painter &p, const PaintContext &context) const {
 	const auto shouldBePlaying = !autoplayUnderCursor() || underCursor();
 	if (!shouldBePlaying && _videoTimestamp != 0) {
 		const_cast<Gif*>(this)->stopAnimation();
-	} else if (canStartPlay) {
+	} else if (canStartPlay && TakePlayingSlot(this)) {
 		const_cast<Gif*>(this)->playAnimation(true);
 	} else {
 		checkStreamedIsStarted();
@@ -1424,7 +1458,7 @@ void Gif::drawGrouped(
 	const auto shouldBePlaying = !autoplayUnderCursor() || underCursor();
 	if (!shouldBePlaying && _videoTimestamp != 0) {
 		const_cast<Gif*>(this)->stopAnimation();
-	} else if (canStartPlay) {
+	} else if (canStartPlay && TakePlayingSlot(this)) {
 		const_cast<Gif*>(this)->playAnimation(true);
 	} else {
 		checkStreamedIsStarted();
@@ -2068,6 +2102,15 @@ void Gif::startStreamedPlayer() const {
 	//if (!_streamed->withSound) {
 	options.mode = ::Media::Streaming::Mode::Video;
 	options.loop = true;
+	const auto dimensions = _data->dimensions;
+	options.hwAllowed = Core::App().settings().hardwareAcceleratedVideo()
+		&& (dimensions.width() * dimensions.height()
+			>= kMinHwAcceleratedArea);
+	if (_parent->media() == this) {
+		// Albums and link previews lay out their parts on their own.
+		options.decodeSize = QSize(maxWidth(), maxHeight())
+			* style::DevicePixelRatio();
+	}
 	options.position = _videoTimestamp
 		? (_videoTimestamp * crl::time(1000))
 		: _parent->history()->session().local().mediaLastPlaybackPosition(
@@ -2093,12 +2136,24 @@ void Gif::setStreamed(std::unique_ptr<Streamed> value) {
 	const auto removed = (_streamed && !value);
 	const auto set = (!_streamed && value);
 	_streamed = std::move(value);
+	auto &playing = Playing();
 	if (set) {
+		++playing.count;
 		history()->owner().registerHeavyViewPart(_parent);
 		togglePollingStory(true);
 	} else if (removed) {
+		--playing.count;
 		_videoPosition = 0;
 		_parent->checkHeavyPart();
+
+		// The waiting ones start playing when they are painted, in the
+		// order they asked, as many as there are free slots now.
+		auto free = kMaxPlayingStreams - playing.count;
+		while (free-- > 0 && !playing.waiting.empty()) {
+			const auto next = playing.waiting.front();
+			playing.waiting.pop_front();
+			next->repaint();
+		}
 	}
 }
 
@@ -43,12 +43,23 @@ namespace internal {
 using TextState = HistoryView::TextState;
 
 constexpr auto kMaxInlineArea = 1280 * 720;
+constexpr auto kMaxPlayingGifs = 16;
 
 [[nodiscard]] bool CanPlayInline(not_null<DocumentData*> document) {
 	const auto dimensions = document->dimensions;
 	return dimensions.width() * dimensions.height() <= kMaxInlineArea;
 }
 
+struct PlayingGifsState {
+	base::flat_set<not_null<const Gif*>> playing;
+	std::deque<not_null<const Gif*>> waiting; // Refused a slot, oldest first.
+};
+
+[[nodiscard]] PlayingGifsState &PlayingGifs() {
+	static auto result = PlayingGifsState();
+	return result;
+}
+
 FileBase::FileBase(not_null<Context*> context, std::shared_ptr<Result> result)
 : ItemBase(context, std::move(result)) {
 }
@@ -110,6 +121,14 @@ Gif::Gif(
 	}
 }
 
+Gif::~Gif() {
+	auto &gifs = PlayingGifs();
+	gifs.playing.remove(this);
+	gifs.waiting.erase(
+		ranges::remove(gifs.waiting, not_null<const Gif*>(this)),
+		end(gifs.waiting));
+}
+
 void Gif::initDimensions() {
 	int32 w = content_width(), h = content_height();
 	if (w <= 0 || h <= 0) {
@@ -124,7 +143,7 @@ void Gif::initDimensions() {
 void Gif::setPosition(int32 position) {
 	AbstractLayoutItem::setPosition(position);
 	if (_position < 0) {
-		_gif.reset();
+		stopAnimation();
 	}
 }
 
@@ -163,7 +182,8 @@ void Gif::paint(Painter &p, const QRect &clip, const PaintContext *context) cons
 	if (loaded
 		&& !_gif
 		&& !_gif.isBad()
-		&& CanPlayInline(document)) {
+		&& CanPlayInline(document)
+		&& mayStartPlaying()) {
 		auto that = const_cast<Gif*>(this);
 		that->_gif = preview.makeAnimation([=](
 				Media::Clip::Notification notification) {
@@ -349,6 +369,11 @@ void Gif::prepareThumbnail(QSize size, QSize frame) const {
 	Assert(document != nullptr);
 
 	ensureDataMediaCreated(document);
+	if (_dataMedia->loaded()) {
+		// The first frame is kept in the local cache once generated.
+		_dataMedia->goodThumbnailWanted();
+		validateThumbnail(_dataMedia->goodThumbnail(), size, frame, true);
+	}
 	validateThumbnail(_dataMedia->thumbnail(), size, frame, true);
 	validateThumbnail(_dataMedia->thumbnailInline(), size, frame, false);
 }
@@ -370,6 +395,52 @@ void Gif::ensureAnimation() const {
 	}
 }
 
+bool Gif::mayStartPlaying() const {
+	// Scrolling through hundreds of saved GIFs shouldn't keep more readers
+	// than the panel shows at once, the others wait with their thumbnails.
+	auto &gifs = PlayingGifs();
+	auto &playing = gifs.playing;
+	for (auto i = begin(playing); i != end(playing);) {
+		if ((*i)->_gif) {
+			++i;
+		} else {
+			i = playing.erase(i);
+		}
+	}
+	const auto self = not_null<const Gif*>(this);
+	const auto waiting = ranges::find(gifs.waiting, self);
+	if (int(playing.size()) >= kMaxPlayingGifs) {
+		if (waiting == end(gifs.waiting)) {
+			gifs.waiting.push_back(self);
+		}
+		return false;
+	} else if (waiting != end(gifs.waiting)) {
+		gifs.waiting.erase(waiting);
+	}
+	playing.emplace(self);
+	return true;
+}
+
+void Gif::stopAnimation() {
+	_gif.reset();
+	if (PlayingGifs().playing.remove(this)) {
+		WakeWaiting();
+	}
+}
+
+void Gif::WakeWaiting() {
+	// The next cell still shown takes the slot when it is painted.
+	auto &waiting = PlayingGifs().waiting;
+	while (!waiting.empty()) {
+		const auto gif = waiting.front();
+		waiting.pop_front();
+		if (gif->_position >= 0 && gif->context()->inlineItemVisible(gif)) {
+			gif->update();
+			return;
+		}
+	}
+}
+
 bool Gif::isRadialAnimation() const {
 	if (_animation) {
 		if (_animation->radial.animating()) {
@@ -403,7 +474,7 @@ void Gif::radialAnimationCallback(crl::time now) const {
 }
 
 void Gif::unloadHeavyPart() {
-	_gif.reset();
+	stopAnimation();
 	_dataMedia = nullptr;
 }
 
@@ -419,7 +490,7 @@ void Gif::clipCallback(Media::Clip::Notification notification) {
 					getShownDocument()->dimensions = QSize(
 						_gif->width(),
 						_gif->height());
-					_gif.reset();
+					stopAnimation();
 				} else {
 					_gif->start({
 						.frame = countFrameSize(),
@@ -435,7 +506,10 @@ void Gif::clipCallback(Media::Clip::Notification notification) {
 	} break;
 
 	case Notification::Repaint: {
-		if (_gif && !_gif->currentDisplayed()) {
+		if (_gif && !context()->inlineItemVisible(this)) {
+			// Scrolled away, the slot goes to a cell that is shown.
+			stopAnimation();
+		} else if (_gif && !_gif->currentDisplayed()) {
 			update();
 		}
 	} break;
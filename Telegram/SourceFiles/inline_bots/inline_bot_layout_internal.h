@@ -63,6 +63,7 @@ public:
 		not_null<Context*> context,
 		not_null<DocumentData*> document,
 		bool hasDeleteButton);
+	~Gif();
 
 	void setPosition(int32 position) override;
 	void initDimensions() override;
@@ -119,6 +120,9 @@ private:
 	void ensureAnimation() const;
 	bool isRadialAnimation() const;
 	void radialAnimationCallback(crl::time now) const;
+	[[nodiscard]] bool mayStartPlaying() const;
+	void stopAnimation();
+	static void WakeWaiting();
 
 	void clipCallback(Media::Clip::Notification notification);
 
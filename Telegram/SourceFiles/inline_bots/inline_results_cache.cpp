@@ -0,0 +1,106 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "inline_bots/inline_results_cache.h"
+
+#include "base/unixtime.h"
+#include "data/data_session.h"
+#include "data/data_user.h"
+#include "main/main_session.h"
+#include "storage/cache/storage_cache_database.h"
+
+#include <QtCore/QDataStream>
+
+namespace InlineBots {
+namespace {
+
+constexpr auto kMaxLifetime = TimeId(24 * 60 * 60);
+
+[[nodiscard]] QByteArray Serialize(const MTPmessages_BotResults &results) {
+	auto counter = ::tl::details::LengthCounter();
+	results.write(counter);
+	auto buffer = mtpBuffer();
+	buffer.reserve(counter.length);
+	results.write(buffer);
+	return QByteArray(
+		reinterpret_cast<const char*>(buffer.constData()),
+		buffer.size() * sizeof(buffer.front()));
+}
+
+[[nodiscard]] std::optional<MTPmessages_BotResults> Deserialize(
+		const QByteArray &bytes) {
+	if (bytes.isEmpty() || (bytes.size() % sizeof(mtpPrime))) {
+		return std::nullopt;
+	}
+	auto from = reinterpret_cast<const mtpPrime*>(bytes.constData());
+	const auto till = from + (bytes.size() / sizeof(mtpPrime));
+	auto result = MTPmessages_BotResults();
+	return result.read(from, till)
+		? std::make_optional(result)
+		: std::nullopt;
+}
+
+} // namespace
+
+ResultsCache::ResultsCache(not_null<Main::Session*> session)
+: _session(session) {
+}
+
+ResultsCache::~ResultsCache() = default;
+
+void ResultsCache::load(
+		not_null<UserData*> bot,
+		not_null<PeerData*> peer,
+		const QString &query,
+		Fn<void(const MTPmessages_BotResults &)> done) {
+	const auto key = Data::InlineResultsCacheKey(bot->id, peer->id, query);
+	const auto weak = base::make_weak(this);
+	_session->data().cache().get(key, [=](QByteArray &&value) {
+		crl::on_main(weak, [=, value = std::move(value)] {
+			QDataStream stream(value);
+			stream.setVersion(QDataStream::Qt_5_1);
+			auto layer = qint32();
+			auto till = qint32();
+			auto bytes = QByteArray();
+			stream >> layer >> till >> bytes;
+			if (stream.status() != QDataStream::Ok
+				|| layer != MTP::details::kCurrentLayer
+				|| till <= base::unixtime::now()) {
+				return;
+			} else if (const auto results = Deserialize(bytes)) {
+				done(*results);
+			}
+		});
+	});
+}
+
+void ResultsCache::store(
+		not_null<UserData*> bot,
+		not_null<PeerData*> peer,
+		const QString &query,
+		const MTPmessages_BotResults &results) {
+	const auto lifetime = std::min(
+		results.data().vcache_time().v,
+		kMaxLifetime);
+	if (lifetime <= 0 || results.data().vresults().v.isEmpty()) {
+		return;
+	}
+	auto serialized = QByteArray();
+	{
+		QDataStream stream(&serialized, QIODevice::WriteOnly);
+		stream.setVersion(QDataStream::Qt_5_1);
+		stream
+			<< qint32(MTP::details::kCurrentLayer)
+			<< qint32(base::unixtime::now() + lifetime)
+			<< Serialize(results);
+	}
+	_session->data().cache().put(
+		Data::InlineResultsCacheKey(bot->id, peer->id, query),
+		Storage::Cache::Database::TaggedValue(std::move(serialized), 0));
+}
+
+} // namespace InlineBots
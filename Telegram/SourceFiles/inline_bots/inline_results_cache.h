@@ -0,0 +1,43 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/weak_ptr.h"
+
+namespace Main {
+class Session;
+} // namespace Main
+
+namespace InlineBots {
+
+// The first page of inline query results, kept in the cache database for
+// the cache_time the bot provided, so repeated queries are shown at once,
+// even after a restart.
+class ResultsCache final : public base::has_weak_ptr {
+public:
+	explicit ResultsCache(not_null<Main::Session*> session);
+	~ResultsCache();
+
+	// The callback is called on the main thread only for fresh results.
+	void load(
+		not_null<UserData*> bot,
+		not_null<PeerData*> peer,
+		const QString &query,
+		Fn<void(const MTPmessages_BotResults &)> done);
+	void store(
+		not_null<UserData*> bot,
+		not_null<PeerData*> peer,
+		const QString &query,
+		const MTPmessages_BotResults &results);
+
+private:
+	const not_null<Main::Session*> _session;
+
+};
+
+} // namespace InlineBots
@@ -10,6 +10,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_user.h"
 #include "data/data_session.h"
 #include "inline_bots/inline_bot_result.h"
+#include "inline_bots/inline_results_cache.h"
 #include "inline_bots/inline_results_inner.h"
 #include "main/main_session.h"
 #include "window/window_session_controller.h"
@@ -446,10 +447,36 @@ void Widget::queryInlineBot(UserData *bot, PeerData *peer, QString query) {
 		} else {
 			_inlineNextQuery = query;
 			_inlineRequestTimer.callOnce(kInlineBotRequestDelay);
+			loadLocalResults(query);
 		}
 	}
 }
 
+void Widget::loadLocalResults(const QString &query) {
+	const auto bot = _inlineBot;
+	const auto peer = _inlineQueryPeer;
+	if (!bot || !peer) {
+		return;
+	}
+	const auto done = [=](const MTPmessages_BotResults &result) {
+		if (_inlineBot != bot
+			|| _inlineQueryPeer != peer
+			|| _inlineNextQuery != query
+			|| _inlineRequestId
+			|| _inlineCache.contains(query)) {
+			return;
+		}
+		_inlineRequestTimer.cancel();
+		_inlineQuery = query;
+		inlineResultsDone(result);
+	};
+	_controller->session().inlineResultsCache().load(
+		bot,
+		peer,
+		query,
+		crl::guard(this, done));
+}
+
 void Widget::onInlineRequest() {
 	if (_inlineRequestId || !_inlineBot || !_inlineQueryPeer) return;
 	_inlineQuery = _inlineNextQuery;
@@ -462,6 +489,9 @@ void Widget::onInlineRequest() {
 			return;
 		}
 	}
+	const auto bot = not_null(_inlineBot);
+	const auto peer = not_null(_inlineQueryPeer);
+	const auto query = _inlineQuery;
 	_requesting.fire(true);
 	_inlineRequestId = _api.request(MTPmessages_GetInlineBotResults(
 		MTP_flags(0),
@@ -471,6 +501,13 @@ void Widget::onInlineRequest() {
 		MTP_string(_inlineQuery),
 		MTP_string(nextOffset)
 	)).done([=](const MTPmessages_BotResults &result) {
+		if (nextOffset.isEmpty()) {
+			_controller->session().inlineResultsCache().store(
+				bot,
+				peer,
+				query,
+				result);
+		}
 		inlineResultsDone(result);
 	}).fail([=] {
 		// show error?
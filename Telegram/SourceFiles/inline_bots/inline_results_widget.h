@@ -92,6 +92,7 @@ private:
 
 	void onScroll();
 	void onInlineRequest();
+	void loadLocalResults(const QString &query);
 
 	// Rounded rect which has shadow around it.
 	QRect innerRect() const;
@@ -386,10 +386,12 @@ QByteArray Instance::serialize() const {
 		+ Serialize::stringSize(_customFilePathRelative)
 		+ Serialize::bytearraySize(_customFileContent)
 		+ sizeof(qint32); // _nonDefaultValues.size()
-	for (auto &nonDefault : _nonDefaultValues) {
-		size += Serialize::bytearraySize(nonDefault.first)
-			+ Serialize::bytearraySize(nonDefault.second);
-	}
+	_nonDefaultValues.enumerate([&](
+			const QByteArray &key,
+			const QByteArray &value) {
+		size += Serialize::bytearraySize(key)
+			+ Serialize::bytearraySize(value);
+	});
 	const auto base = _base ? _base->serialize() : QByteArray();
 	size += Serialize::bytearraySize(base);
 
@@ -410,9 +412,11 @@ QByteArray Instance::serialize() const {
 			<< _customFilePathRelative
 			<< _customFileContent
 			<< qint32(_nonDefaultValues.size());
-		for (const auto &nonDefault : _nonDefaultValues) {
-			stream << nonDefault.first << nonDefault.second;
-		}
+		_nonDefaultValues.enumerate([&](
+				const QByteArray &key,
+				const QByteArray &value) {
+			stream << key << value;
+		});
 		stream << base;
 	}
 	return result;
@@ -718,16 +722,16 @@ std::map<ushort, QString> Instance::ParseStrings(
 }
 
 QString Instance::getNonDefaultValue(const QByteArray &key) const {
-	const auto i = _nonDefaultValues.find(key);
-	return (i != end(_nonDefaultValues))
-		? QString::fromUtf8(i->second)
+	const auto value = _nonDefaultValues.find(key);
+	return value
+		? QString::fromUtf8(*value)
 		: _base
 		? _base->getNonDefaultValue(key)
 		: QString();
 }
 
 void Instance::applyValue(const QByteArray &key, const QByteArray &value) {
-	_nonDefaultValues[key] = value;
+	_nonDefaultValues.set(key, value);
 	ParseKeyValue(key, value, [&](ushort key, QString &&value) {
 		_nonDefaultSet[key] = 1;
 		if (!_derived) {
@@ -758,7 +762,7 @@ void Instance::updatePluralRules() {
 }
 
 void Instance::resetValue(const QByteArray &key) {
-	_nonDefaultValues.erase(key);
+	_nonDefaultValues.remove(key);
 
 	const auto keyIndex = GetKeyIndex(QLatin1String(key));
 	if (keyIndex != kKeysCount) {
@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "lang_auto.h"
+#include "lang/lang_values_pack.h"
 #include "base/const_string.h"
 #include "base/weak_ptr.h"
 
@@ -146,7 +147,7 @@ private:
 
 	std::vector<QString> _values;
 	std::vector<uchar> _nonDefaultSet;
-	std::map<QByteArray, QByteArray> _nonDefaultValues;
+	ValuesPack _nonDefaultValues;
 
 	std::unique_ptr<Instance> _base;
 
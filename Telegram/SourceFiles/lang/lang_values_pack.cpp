@@ -0,0 +1,134 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "lang/lang_values_pack.h"
+
+namespace Lang {
+namespace {
+
+constexpr auto kCompactUnusedMin = 16 * 1024;
+
+[[nodiscard]] std::string_view View(const QByteArray &value) {
+	return std::string_view(value.constData(), value.size());
+}
+
+} // namespace
+
+void ValuesPack::set(const QByteArray &key, const QByteArray &value) {
+	const auto append = [&] {
+		auto entry = Entry{ .keyOffset = int(_data.size()) };
+		_data.append(key);
+		entry.keySize = key.size();
+		entry.valueOffset = int(_data.size());
+		_data.append(value);
+		entry.valueSize = value.size();
+		return entry;
+	};
+	if (_sorted && !_entries.empty()) {
+		const auto i = lookup(key);
+		if (i != end(_entries) && this->key(*i) == View(key)) {
+			_unused += i->valueSize;
+			i->valueOffset = int(_data.size());
+			i->valueSize = value.size();
+			_data.append(value);
+			compact();
+			return;
+		} else if (i != end(_entries)) {
+			// Keys of a custom file come in any order, the index is sorted
+			// once when they are looked up. Serialized packs come sorted.
+			_sorted = false;
+		}
+	}
+	_entries.push_back(append());
+}
+
+void ValuesPack::remove(const QByteArray &key) {
+	ensureSorted();
+	const auto i = lookup(key);
+	if (i != end(_entries) && this->key(*i) == View(key)) {
+		_unused += i->keySize + i->valueSize;
+		_entries.erase(i);
+		compact();
+	}
+}
+
+void ValuesPack::clear() {
+	_data = QByteArray();
+	_entries = std::vector<Entry>();
+	_sorted = true;
+	_unused = 0;
+}
+
+int ValuesPack::size() const {
+	ensureSorted();
+	return int(_entries.size());
+}
+
+std::optional<QByteArray> ValuesPack::find(const QByteArray &key) const {
+	ensureSorted();
+	const auto i = lookup(key);
+	if (i == end(_entries) || this->key(*i) != View(key)) {
+		return std::nullopt;
+	}
+	return QByteArray(_data.constData() + i->valueOffset, i->valueSize);
+}
+
+std::string_view ValuesPack::key(const Entry &entry) const {
+	return std::string_view(
+		_data.constData() + entry.keyOffset,
+		entry.keySize);
+}
+
+auto ValuesPack::lookup(const QByteArray &key) const
+-> std::vector<Entry>::iterator {
+	return ranges::lower_bound(
+		_entries,
+		View(key),
+		std::less<>(),
+		[&](const Entry &entry) { return this->key(entry); });
+}
+
+void ValuesPack::ensureSorted() const {
+	if (_sorted) {
+		return;
+	}
+	_sorted = true;
+	const auto proj = [&](const Entry &entry) { return key(entry); };
+	ranges::stable_sort(_entries, std::less<>(), proj);
+
+	// The last value set for a key wins, the earlier ones are left unused.
+	auto to = begin(_entries);
+	for (auto from = begin(_entries); from != end(_entries); ++from) {
+		if (to != begin(_entries) && key(*(to - 1)) == key(*from)) {
+			_unused += (to - 1)->keySize + (to - 1)->valueSize;
+			*(to - 1) = *from;
+		} else {
+			*to++ = *from;
+		}
+	}
+	_entries.erase(to, end(_entries));
+}
+
+void ValuesPack::compact() {
+	if (_unused < kCompactUnusedMin || _unused * 2 < _data.size()) {
+		return;
+	}
+	auto data = QByteArray();
+	data.reserve(_data.size() - _unused);
+	for (auto &entry : _entries) {
+		const auto keyOffset = int(data.size());
+		data.append(_data.constData() + entry.keyOffset, entry.keySize);
+		const auto valueOffset = int(data.size());
+		data.append(_data.constData() + entry.valueOffset, entry.valueSize);
+		entry.keyOffset = keyOffset;
+		entry.valueOffset = valueOffset;
+	}
+	_data = std::move(data);
+	_unused = 0;
+}
+
+} // namespace Lang
@@ -0,0 +1,62 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <string_view>
+
+namespace Lang {
+
+// Raw key-value pairs of a language pack kept in a single buffer with an
+// index of offsets sorted by key, instead of two allocations per string.
+class ValuesPack final {
+public:
+	void set(const QByteArray &key, const QByteArray &value);
+	void remove(const QByteArray &key);
+	void clear();
+
+	[[nodiscard]] int size() const;
+	[[nodiscard]] std::optional<QByteArray> find(
+		const QByteArray &key) const;
+
+	// Passes key and value without copying them, in the order of the keys.
+	template <typename Callback>
+	void enumerate(Callback &&callback) const {
+		ensureSorted();
+		for (const auto &entry : _entries) {
+			callback(
+				QByteArray::fromRawData(
+					_data.constData() + entry.keyOffset,
+					entry.keySize),
+				QByteArray::fromRawData(
+					_data.constData() + entry.valueOffset,
+					entry.valueSize));
+		}
+	}
+
+private:
+	struct Entry {
+		int keyOffset = 0;
+		int keySize = 0;
+		int valueOffset = 0;
+		int valueSize = 0;
+	};
+
+	[[nodiscard]] std::string_view key(const Entry &entry) const;
+	[[nodiscard]] std::vector<Entry>::iterator lookup(
+		const QByteArray &key) const;
+	void ensureSorted() const;
+	void compact();
+
+	QByteArray _data;
+	mutable std::vector<Entry> _entries;
+	mutable bool _sorted = true;
+	mutable int _unused = 0;
+
+};
+
+} // namespace Lang
@@ -24,6 +24,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "history/history.h"
 #include "history/history_item.h"
 #include "inline_bots/bot_attach_web_view.h"
+#include "inline_bots/inline_results_cache.h"
 #include "storage/file_download.h"
 #include "storage/download_manager_mtproto.h"
 #include "storage/file_upload.h"
@@ -111,6 +112,7 @@ Session::Session(
 , _giftBoxStickersPacks(std::make_unique<Stickers::GiftBoxPack>(this))
 , _sendAsPeers(std::make_unique<SendAsPeers>(this))
 , _attachWebView(std::make_unique<InlineBots::AttachWebView>(this))
+, _inlineResultsCache(std::make_unique<InlineBots::ResultsCache>(this))
 , _recentPeers(std::make_unique<Data::RecentPeers>(this))
 , _recentSharedGifts(std::make_unique<Data::RecentSharedMediaGifts>(this))
 , _giftAuctions(std::make_unique<Data::GiftAuctions>(this))
@@ -209,20 +211,24 @@ Session::Session(
 
 		// Storage::Account uses Main::Account::session() in those methods.
 		// So they can't be called during Main::Session construction.
-		local().readInstalledStickers();
-		local().readInstalledMasks();
-		local().readInstalledCustomEmoji();
-		local().readFeaturedStickers();
-		local().readFeaturedCustomEmoji();
-		local().readRecentStickers();
-		local().readRecentMasks();
-		local().readFavedStickers();
-		local().readSavedGifs();
-		data().stickers().notifyUpdated(Data::StickersType::Stickers);
-		data().stickers().notifyUpdated(Data::StickersType::Masks);
-		data().stickers().notifyUpdated(Data::StickersType::Emoji);
-		data().stickers().notifySavedGifsUpdated();
-		DEBUG_LOG(("Init: Account stored data load finished."));
+		//
+		// The files are decrypted in the background meanwhile.
+		local().prefetchStickersAndGifs(crl::guard(this, [=] {
+			local().readInstalledStickers();
+			local().readInstalledMasks();
+			local().readInstalledCustomEmoji();
+			local().readFeaturedStickers();
+			local().readFeaturedCustomEmoji();
+			local().readRecentStickers();
+			local().readRecentMasks();
+			local().readFavedStickers();
+			local().readSavedGifs();
+			data().stickers().notifyUpdated(Data::StickersType::Stickers);
+			data().stickers().notifyUpdated(Data::StickersType::Masks);
+			data().stickers().notifyUpdated(Data::StickersType::Emoji);
+			data().stickers().notifySavedGifsUpdated();
+			DEBUG_LOG(("Init: Account stored data load finished."));
+		}));
 	});
 
 #ifndef TDESKTOP_DISABLE_SPELLCHECK
@@ -69,6 +69,7 @@ class GiftBoxPack;
 
 namespace InlineBots {
 class AttachWebView;
+class ResultsCache;
 } // namespace InlineBots
 
 namespace Ui {
@@ -198,6 +199,9 @@ public:
 	[[nodiscard]] InlineBots::AttachWebView &attachWebView() const {
 		return *_attachWebView;
 	}
+	[[nodiscard]] InlineBots::ResultsCache &inlineResultsCache() const {
+		return *_inlineResultsCache;
+	}
 	[[nodiscard]] Data::PromoSuggestions &promoSuggestions() const {
 		return *_promoSuggestions;
 	}
@@ -294,6 +298,7 @@ private:
 	const std::unique_ptr<Stickers::GiftBoxPack> _giftBoxStickersPacks;
 	const std::unique_ptr<SendAsPeers> _sendAsPeers;
 	const std::unique_ptr<InlineBots::AttachWebView> _attachWebView;
+	const std::unique_ptr<InlineBots::ResultsCache> _inlineResultsCache;
 	const std::unique_ptr<Data::RecentPeers> _recentPeers;
 	const std::unique_ptr<Data::RecentSharedMediaGifts> _recentSharedGifts;
 	const std::unique_ptr<Data::GiftAuctions> _giftAuctions;
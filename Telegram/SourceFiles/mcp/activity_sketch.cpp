@@ -0,0 +1,231 @@
+// MCP Activity Sketch - Mergeable distinct-count and top-K summaries
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "activity_sketch.h"
+
+#include <QtCore/QDataStream>
+#include <QtCore/QHash>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace MCP {
+namespace {
+
+constexpr auto kPrecision = 12;
+constexpr auto kRegisters = 1 << kPrecision;
+constexpr auto kMaxRank = 64 - kPrecision + 1;
+constexpr auto kSketchVersion = quint8(1);
+
+// splitmix64 finalizer, user and chat ids are far from uniform.
+[[nodiscard]] quint64 Mix(qint64 value) {
+	auto x = quint64(value) + 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+} // namespace
+
+HyperLogLog::HyperLogLog()
+: _registers(kRegisters, char(0)) {
+}
+
+void HyperLogLog::add(qint64 value) {
+	const auto hash = Mix(value);
+	const auto index = int(hash >> (64 - kPrecision));
+	const auto rest = (hash << kPrecision) | (quint64(1) << (kPrecision - 1));
+	const auto rank = char(std::countl_zero(rest) + 1);
+	if (_registers[index] < rank) {
+		_registers[index] = rank;
+	}
+}
+
+void HyperLogLog::merge(const HyperLogLog &other) {
+	for (auto i = 0; i != kRegisters; ++i) {
+		_registers[i] = std::max(_registers[i], other._registers[i]);
+	}
+}
+
+qint64 HyperLogLog::estimate() const {
+	auto sum = 0.;
+	auto zeros = 0;
+	for (const auto rank : _registers) {
+		sum += std::ldexp(1., -int(rank));
+		zeros += (rank == 0) ? 1 : 0;
+	}
+	constexpr auto m = double(kRegisters);
+	const auto alpha = 0.7213 / (1. + 1.079 / m);
+	const auto raw = alpha * m * m / sum;
+	// Small counts are exact enough from the empty registers alone.
+	const auto result = (raw <= 2.5 * m && zeros > 0)
+		? m * std::log(m / zeros)
+		: raw;
+	return qint64(std::llround(result));
+}
+
+double HyperLogLog::StandardError() {
+	return 1.04 / std::sqrt(double(kRegisters));
+}
+
+QByteArray HyperLogLog::serialize() const {
+	auto result = QByteArray();
+	QDataStream out(&result, QIODevice::WriteOnly);
+	out.setVersion(QDataStream::Qt_6_0);
+	// Registers of a small chat are mostly zero and compress to little.
+	out << kSketchVersion << qCompress(_registers);
+	return result;
+}
+
+HyperLogLog HyperLogLog::FromSerialized(const QByteArray &data) {
+	auto result = HyperLogLog();
+	QDataStream in(data);
+	in.setVersion(QDataStream::Qt_6_0);
+	auto version = quint8();
+	auto compressed = QByteArray();
+	in >> version >> compressed;
+	if (in.status() != QDataStream::Ok || version != kSketchVersion) {
+		return result;
+	}
+	auto registers = qUncompress(compressed);
+	if (registers.size() == kRegisters) {
+		for (auto &rank : registers) {
+			rank = std::clamp(rank, char(0), char(kMaxRank));
+		}
+		result._registers = std::move(registers);
+	}
+	return result;
+}
+
+SpaceSaving::SpaceSaving(int capacity)
+: _capacity(std::max(capacity, 1)) {
+	_counters.reserve(_capacity);
+}
+
+void SpaceSaving::add(qint64 item, qint64 weight) {
+	const auto i = std::find_if(
+		begin(_counters),
+		end(_counters),
+		[&](const Counter &counter) { return counter.item == item; });
+	if (i != end(_counters)) {
+		i->count += weight;
+	} else if (int(_counters.size()) < _capacity) {
+		_counters.push_back({ item, weight, 0 });
+	} else {
+		// The smallest counter is taken over, its count becomes the
+		// possible overcount of the new item.
+		auto &smallest = *std::min_element(
+			begin(_counters),
+			end(_counters),
+			[](const Counter &a, const Counter &b) { return a.count < b.count; });
+		smallest = { item, smallest.count + weight, smallest.count };
+	}
+}
+
+void SpaceSaving::merge(const SpaceSaving &other) {
+	// An item missing from a full summary may have had up to its
+	// smallest count there, both bounds get that much (Agarwal et al.).
+	const auto mine = minimum();
+	const auto theirs = other.minimum();
+	auto index = QHash<qint64, int>();
+	for (auto i = 0; i != int(_counters.size()); ++i) {
+		index.insert(_counters[i].item, i);
+	}
+	auto seen = std::vector<bool>(_counters.size(), false);
+	for (const auto &counter : other._counters) {
+		const auto i = index.constFind(counter.item);
+		if (i != index.cend()) {
+			_counters[*i].count += counter.count;
+			_counters[*i].error += counter.error;
+			seen[*i] = true;
+		} else {
+			_counters.push_back({
+				counter.item,
+				counter.count + mine,
+				counter.error + mine,
+			});
+		}
+	}
+	for (auto i = 0; i != int(seen.size()); ++i) {
+		if (!seen[i]) {
+			_counters[i].count += theirs;
+			_counters[i].error += theirs;
+		}
+	}
+	trim();
+}
+
+std::vector<SpaceSaving::Counter> SpaceSaving::top(int limit) const {
+	auto result = _counters;
+	std::sort(begin(result), end(result), [](const auto &a, const auto &b) {
+		return a.count > b.count;
+	});
+	if (int(result.size()) > limit) {
+		result.resize(std::max(limit, 0));
+	}
+	return result;
+}
+
+qint64 SpaceSaving::minimum() const {
+	if (int(_counters.size()) < _capacity) {
+		return 0;
+	}
+	return std::min_element(
+		begin(_counters),
+		end(_counters),
+		[](const Counter &a, const Counter &b) { return a.count < b.count; }
+	)->count;
+}
+
+void SpaceSaving::trim() {
+	if (int(_counters.size()) <= _capacity) {
+		return;
+	}
+	std::nth_element(
+		begin(_counters),
+		begin(_counters) + _capacity,
+		end(_counters),
+		[](const Counter &a, const Counter &b) { return a.count > b.count; });
+	_counters.resize(_capacity);
+}
+
+QByteArray SpaceSaving::serialize() const {
+	auto result = QByteArray();
+	QDataStream out(&result, QIODevice::WriteOnly);
+	out.setVersion(QDataStream::Qt_6_0);
+	out << kSketchVersion << qint32(_capacity) << qint32(_counters.size());
+	for (const auto &counter : _counters) {
+		out << counter.item << counter.count << counter.error;
+	}
+	return result;
+}
+
+SpaceSaving SpaceSaving::FromSerialized(const QByteArray &data) {
+	QDataStream in(data);
+	in.setVersion(QDataStream::Qt_6_0);
+	auto version = quint8();
+	auto capacity = qint32();
+	auto size = qint32();
+	in >> version >> capacity >> size;
+	if (in.status() != QDataStream::Ok
+		|| version != kSketchVersion
+		|| capacity <= 0
+		|| size < 0
+		|| size > capacity) {
+		return SpaceSaving();
+	}
+	auto result = SpaceSaving(capacity);
+	for (auto i = 0; i != size; ++i) {
+		auto counter = Counter();
+		in >> counter.item >> counter.count >> counter.error;
+		result._counters.push_back(counter);
+	}
+	if (in.status() != QDataStream::Ok) {
+		return SpaceSaving();
+	}
+	return result;
+}
+
+} // namespace MCP
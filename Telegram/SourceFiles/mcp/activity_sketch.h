@@ -0,0 +1,64 @@
+// MCP Activity Sketch - Mergeable distinct-count and top-K summaries
+//
+// This file is part of Telegram Desktop MCP integration.
+// A HyperLogLog estimates distinct users in 4096 one byte registers, a
+// Space-Saving summary keeps the heaviest users or chats with bounded
+// overcount. Both merge without the underlying rows, so a range of days
+// or chats is the merge of their stored per-day sketches.
+
+#pragma once
+
+#include <QtCore/QByteArray>
+
+#include <vector>
+
+namespace MCP {
+
+class HyperLogLog final {
+public:
+	HyperLogLog();
+
+	void add(qint64 value);
+	void merge(const HyperLogLog &other);
+	[[nodiscard]] qint64 estimate() const;
+
+	// About 1.6% for 4096 registers.
+	[[nodiscard]] static double StandardError();
+
+	[[nodiscard]] QByteArray serialize() const;
+	[[nodiscard]] static HyperLogLog FromSerialized(const QByteArray &data);
+
+private:
+	QByteArray _registers;
+
+};
+
+class SpaceSaving final {
+public:
+	struct Counter {
+		qint64 item = 0;
+		qint64 count = 0; // Never below the true count.
+		qint64 error = 0; // count - error is never above it.
+	};
+
+	explicit SpaceSaving(int capacity = 64);
+
+	void add(qint64 item, qint64 weight = 1);
+	void merge(const SpaceSaving &other);
+
+	// Heaviest first, at most limit of them.
+	[[nodiscard]] std::vector<Counter> top(int limit) const;
+
+	[[nodiscard]] QByteArray serialize() const;
+	[[nodiscard]] static SpaceSaving FromSerialized(const QByteArray &data);
+
+private:
+	[[nodiscard]] qint64 minimum() const;
+	void trim();
+
+	std::vector<Counter> _counters;
+	int _capacity = 0;
+
+};
+
+} // namespace MCP
@@ -2,7 +2,9 @@
 // Licensed under GPLv3 with OpenSSL exception.
 
 #include "analytics.h"
+#include "activity_sketch.h"
 #include "chat_archiver.h"
+#include "mcp_helpers.h"
 #include "data/data_session.h"
 #include "history/history.h"
 #include "history/history_item.h"
@@ -12,12 +14,142 @@
 #include <QtCore/QFile>
 #include <QtCore/QTextStream>
 #include <QtCore/QJsonDocument>
-#include <QtCore/QRegularExpression>
 #include <QtCore/QtMath>
+#include <QtCore/QMutexLocker>
 #include <QtSql/QSqlError>
 #include <algorithm>
 
 namespace MCP {
+namespace {
+
+constexpr auto kWordBatch = 20000; // Texts held in memory at once.
+constexpr auto kWordSlice = 1000; // Fewest texts a thread counts.
+constexpr auto kMinWordLength = 3;
+
+// Calls f with every run of word characters, as \b\w+\b would match
+// them, without a regular expression or a copy of the word.
+template <typename Callback>
+void ForEachWord(QStringView text, Callback &&f) {
+	const auto size = text.size();
+	auto start = qsizetype(-1);
+	for (auto i = qsizetype(0); i < size;) {
+		const auto ch = text[i];
+		auto width = qsizetype(1);
+		auto code = char32_t(ch.unicode());
+		if (ch.isHighSurrogate()
+			&& i + 1 < size
+			&& text[i + 1].isLowSurrogate()) {
+			code = QChar::surrogateToUcs4(ch, text[i + 1]);
+			width = 2;
+		}
+		const auto word = QChar::isLetterOrNumber(code)
+			|| QChar::isMark(code)
+			|| (code == U'_');
+		if (word && start < 0) {
+			start = i;
+		} else if (!word && start >= 0) {
+			f(text.sliced(start, i - start));
+			start = -1;
+		}
+		i += width;
+	}
+	if (start >= 0) {
+		f(text.sliced(start));
+	}
+}
+
+// Ranges of a week or more are answered from the daily rollups, with
+// the first and last day counted whole. Shorter ones scan messages.
+[[nodiscard]] bool UseDailyRollups(const AnalyticsTimeRange &range) {
+	if (range.start.isNull()) {
+		return true;
+	}
+	const auto end = range.end.isNull()
+		? QDateTime::currentDateTime()
+		: range.end;
+	return range.start.daysTo(end) >= 7;
+}
+
+[[nodiscard]] QString RollupDate(const QDateTime &time) {
+	// Rollup buckets are UTC days, as date(timestamp, 'unixepoch').
+	return time.toUTC().date().toString(Qt::ISODate);
+}
+
+// A row of message_activity_hourly, hour = timestamp / 3600.
+struct HourlyActivity {
+	qint64 hour = 0;
+	qint64 userId = 0;
+	QString type;
+	int count = 0;
+	qint64 length = 0;
+};
+
+// Rows of one chat and/or user (0 = any), the first and last hour of
+// the range counted whole, ordered by hour.
+[[nodiscard]] std::vector<HourlyActivity> LoadHourlyActivity(
+		const QSqlDatabase &db,
+		qint64 chatId,
+		qint64 userId,
+		const AnalyticsTimeRange &range) {
+	auto conditions = QStringList();
+	auto bindings = QVector<QVariant>();
+	if (chatId) {
+		conditions.push_back("chat_id = ?");
+		bindings.append(chatId);
+	}
+	if (userId) {
+		conditions.push_back("user_id = ?");
+		bindings.append(userId);
+	}
+	if (!range.start.isNull()) {
+		conditions.push_back("hour >= ?");
+		bindings.append(range.start.toSecsSinceEpoch() / 3600);
+	}
+	if (!range.end.isNull()) {
+		conditions.push_back("hour <= ?");
+		bindings.append(range.end.toSecsSinceEpoch() / 3600);
+	}
+	auto query = PreparedQuery(db, QString(
+		"SELECT hour, user_id, message_type, message_count, total_length "
+		"FROM message_activity_hourly %1 ORDER BY hour"
+	).arg(conditions.isEmpty()
+		? QString()
+		: ("WHERE " + conditions.join(" AND "))));
+	for (const auto &binding : bindings) {
+		query->addBindValue(binding);
+	}
+	auto result = std::vector<HourlyActivity>();
+	if (!query->exec()) {
+		qWarning() << "Analytics: Failed to query hourly activity:" << query->lastError().text();
+		return result;
+	}
+	while (query->next()) {
+		result.push_back({
+			.hour = query->value(0).toLongLong(),
+			.userId = query->value(1).toLongLong(),
+			.type = query->value(2).toString(),
+			.count = query->value(3).toInt(),
+			.length = query->value(4).toLongLong(),
+		});
+	}
+	return result;
+}
+
+// Hour of day and day of week (0 = Sunday) in UTC, as strftime() would
+// give them for the timestamps. 1970-01-01 was a Thursday.
+void AddDistributions(
+		const std::vector<HourlyActivity> &rows,
+		QVector<int> &hourly,
+		QVector<int> &weekly) {
+	hourly = QVector<int>(24, 0);
+	weekly = QVector<int>(7, 0);
+	for (const auto &row : rows) {
+		hourly[int(row.hour % 24)] += row.count;
+		weekly[int((row.hour / 24 + 4) % 7)] += row.count;
+	}
+}
+
+} // namespace
 
 Analytics::Analytics(QObject *parent)
 : QObject(parent) {
@@ -183,34 +315,30 @@ QJsonArray Analytics::getTopUsers(
 
 	// Query archiver database for user statistics
 	auto db = _archiver->database();
-	QSqlQuery query(db);
 
+	// Per-user rollups, the message ranking walks idx_user_activity_chat.
 	QString sql;
-	if (metric == "messages") {
-		sql = "SELECT user_id, user_name, COUNT(*) as count "
-		      "FROM messages WHERE chat_id = ? "
-		      "GROUP BY user_id ORDER BY count DESC LIMIT ?";
-	} else if (metric == "words") {
-		sql = "SELECT user_id, user_name, SUM(word_count) as count "
-		      "FROM messages WHERE chat_id = ? "
-		      "GROUP BY user_id ORDER BY count DESC LIMIT ?";
+	if (metric == "words") {
+		sql = "SELECT user_id, user_name, word_count "
+		      "FROM user_activity_summary WHERE chat_id = ? "
+		      "ORDER BY word_count DESC LIMIT ?";
 	} else {
-		sql = "SELECT user_id, user_name, COUNT(*) as count "
-		      "FROM messages WHERE chat_id = ? "
-		      "GROUP BY user_id ORDER BY count DESC LIMIT ?";
+		sql = "SELECT user_id, user_name, message_count "
+		      "FROM user_activity_summary WHERE chat_id = ? "
+		      "ORDER BY message_count DESC LIMIT ?";
 	}
 
-	query.prepare(sql);
-	query.addBindValue(chatId);
-	query.addBindValue(limit);
+	auto query = PreparedQuery(db, sql);
+	query->addBindValue(chatId);
+	query->addBindValue(limit);
 
 	QJsonArray result;
-	if (query.exec()) {
-		while (query.next()) {
+	if (query->exec()) {
+		while (query->next()) {
 			QJsonObject user;
-			user["userId"] = QString::number(query.value(0).toLongLong());
-			user["userName"] = query.value(1).toString();
-			user["count"] = query.value(2).toInt();
+			user["userId"] = QString::number(query->value(0).toLongLong());
+			user["userName"] = query->value(1).toString();
+			user["count"] = query->value(2).toInt();
 			result.append(user);
 		}
 	}
@@ -339,6 +467,13 @@ QJsonObject Analytics::getTrends(
 	result["growthRate"] = growthRate;
 	result["dataPoints"] = timeSeries;
 
+	// Seven day moving average over the same points, in memory.
+	QJsonArray movingAverage;
+	for (const auto value : smoothData(values, 7)) {
+		movingAverage.append(value);
+	}
+	result["movingAverage"] = movingAverage;
+
 	return result;
 }
 
@@ -408,17 +543,90 @@ QJsonObject Analytics::getLiveActivity(qint64 chatId) {
 	return result;
 }
 
+QJsonObject Analytics::getUniqueUsers(
+	qint64 chatId,
+	int daysBack,
+	int topLimit
+) {
+	QJsonObject result;
+	if (!_isRunning || !_archiver) {
+		result["error"] = "Analytics not running";
+		return result;
+	}
+
+	// Days are UTC rollup dates, today included.
+	const auto today = QDateTime::currentDateTimeUtc();
+	const auto from = RollupDate(today.addDays(1 - std::max(daysBack, 1)));
+	const auto till = RollupDate(today);
+	_archiver->refreshActivitySketches(from, till);
+
+	auto users = HyperLogLog();
+	auto topUsers = SpaceSaving();
+	auto topChats = SpaceSaving();
+	auto messages = qint64();
+	auto days = 0;
+	auto query = PreparedQuery(_archiver->database(), R"(
+		SELECT message_count, users, top_users, top_chats
+		FROM activity_sketches_daily
+		WHERE chat_id = ? AND date BETWEEN ? AND ?
+	)");
+	query->addBindValue(chatId);
+	query->addBindValue(from);
+	query->addBindValue(till);
+	if (!query->exec()) {
+		qWarning() << "Analytics: Failed to query activity sketches:" << query->lastError().text();
+		result["error"] = "Failed to query activity sketches";
+		return result;
+	}
+	while (query->next()) {
+		messages += query->value(0).toLongLong();
+		users.merge(HyperLogLog::FromSerialized(query->value(1).toByteArray()));
+		topUsers.merge(SpaceSaving::FromSerialized(query->value(2).toByteArray()));
+		if (!chatId) {
+			topChats.merge(SpaceSaving::FromSerialized(query->value(3).toByteArray()));
+		}
+		++days;
+	}
+
+	const auto counters = [](const std::vector<SpaceSaving::Counter> &list, const char *key) {
+		QJsonArray array;
+		for (const auto &counter : list) {
+			QJsonObject entry;
+			entry[key] = QString::number(counter.item);
+			entry["count"] = counter.count;
+			entry["maxOvercount"] = counter.error;
+			array.append(entry);
+		}
+		return array;
+	};
+	result["chatId"] = QString::number(chatId);
+	result["from"] = from;
+	result["till"] = till;
+	result["activeDays"] = days;
+	result["messages"] = messages;
+	result["uniqueUsers"] = users.estimate();
+	result["standardError"] = HyperLogLog::StandardError();
+	result["approximate"] = true;
+	result["topUsers"] = counters(topUsers.top(topLimit), "userId");
+	if (!chatId) {
+		result["topChats"] = counters(topChats.top(topLimit), "chatId");
+	}
+	return result;
+}
+
 QJsonArray Analytics::getActiveChats(int limit) {
-	// Stub implementation - would query recent activity
-	return QJsonArray();
+	// Heaviest chats of the last week from the all-chats sketches.
+	return getUniqueUsers(0, 7, limit).value("topChats").toArray();
 }
 
 void Analytics::clearCache() {
+	QMutexLocker lock(&_cacheMutex);
 	_cache.clear();
 }
 
 void Analytics::refreshCache(qint64 chatId) {
 	// Remove cached entries for this chat
+	QMutexLocker lock(&_cacheMutex);
 	QStringList keysToRemove;
 	for (auto it = _cache.constBegin(); it != _cache.constEnd(); ++it) {
 		if (it.key().contains(QString::number(chatId))) {
@@ -429,6 +637,7 @@ void Analytics::refreshCache(qint64 chatId) {
 	for (const QString &key : keysToRemove) {
 		_cache.remove(key);
 	}
+	lock.unlock();
 
 	Q_EMIT cacheRefreshed();
 }
@@ -452,52 +661,66 @@ MessageStats Analytics::collectMessageStats(
 		return stats;
 	}
 
-	QSqlQuery query(db);
-
 	// Build WHERE clause for time range
+	const auto daily = UseDailyRollups(range);
 	QString whereClause = "chat_id = ?";
 	QVector<QVariant> bindings = {chatId};
 
 	if (!range.start.isNull()) {
-		whereClause += " AND timestamp >= ?";
-		bindings.append(range.start.toSecsSinceEpoch());
+		whereClause += daily ? " AND date >= ?" : " AND timestamp >= ?";
+		bindings.append(daily
+			? QVariant(RollupDate(range.start))
+			: QVariant(range.start.toSecsSinceEpoch()));
 	}
 	if (!range.end.isNull()) {
-		whereClause += " AND timestamp <= ?";
-		bindings.append(range.end.toSecsSinceEpoch());
+		whereClause += daily ? " AND date <= ?" : " AND timestamp <= ?";
+		bindings.append(daily
+			? QVariant(RollupDate(range.end))
+			: QVariant(range.end.toSecsSinceEpoch()));
 	}
 
 	// Query message statistics with proper column names from schema
-	QString sql = QString(
-		"SELECT COUNT(*) as total, "
-		"SUM(CASE WHEN message_type = 'text' THEN 1 ELSE 0 END) as text_count, "
-		"SUM(CASE WHEN has_media = 1 THEN 1 ELSE 0 END) as media_count, "
-		"SUM(CASE WHEN edit_date IS NOT NULL THEN 1 ELSE 0 END) as edited_count, "
-		"AVG(LENGTH(content)) as avg_length, "
-		"MIN(timestamp) as first_ts, "
-		"MAX(timestamp) as last_ts "
-		"FROM messages WHERE %1"
-	).arg(whereClause);
+	QString sql = daily
+		? QString(
+			"SELECT SUM(message_count) as total, "
+			"SUM(text_count) as text_count, "
+			"SUM(media_count) as media_count, "
+			"SUM(edited_count) as edited_count, "
+			"SUM(total_length) * 1.0 / NULLIF(SUM(message_count), 0) as avg_length, "
+			"MIN(first_timestamp) as first_ts, "
+			"MAX(last_timestamp) as last_ts "
+			"FROM message_stats_daily WHERE %1"
+		).arg(whereClause)
+		: QString(
+			"SELECT COUNT(*) as total, "
+			"SUM(CASE WHEN message_type = 'text' THEN 1 ELSE 0 END) as text_count, "
+			"SUM(CASE WHEN has_media = 1 THEN 1 ELSE 0 END) as media_count, "
+			"SUM(CASE WHEN edit_date IS NOT NULL THEN 1 ELSE 0 END) as edited_count, "
+			"AVG(LENGTH(content)) as avg_length, "
+			"MIN(timestamp) as first_ts, "
+			"MAX(timestamp) as last_ts "
+			"FROM messages WHERE %1"
+		).arg(whereClause);
 
-	query.prepare(sql);
+	auto query = PreparedQuery(db, sql);
 	for (const auto &binding : bindings) {
-		query.addBindValue(binding);
+		query->addBindValue(binding);
 	}
 
-	if (!query.exec()) {
-		qWarning() << "Analytics: Failed to execute query:" << query.lastError().text();
+	if (!query->exec()) {
+		qWarning() << "Analytics: Failed to execute query:" << query->lastError().text();
 		return stats;
 	}
 
-	if (query.next()) {
-		stats.totalMessages = query.value(0).toInt();
-		stats.textMessages = query.value(1).toInt();
-		stats.mediaMessages = query.value(2).toInt();
-		stats.editedMessages = query.value(3).toInt();
-		stats.averageLength = query.value(4).toDouble();
+	if (query->next()) {
+		stats.totalMessages = query->value(0).toInt();
+		stats.textMessages = query->value(1).toInt();
+		stats.mediaMessages = query->value(2).toInt();
+		stats.editedMessages = query->value(3).toInt();
+		stats.averageLength = query->value(4).toDouble();
 
-		qint64 firstTs = query.value(5).toLongLong();
-		qint64 lastTs = query.value(6).toLongLong();
+		qint64 firstTs = query->value(5).toLongLong();
+		qint64 lastTs = query->value(6).toLongLong();
 
 		if (firstTs > 0) {
 			stats.firstMessage = QDateTime::fromSecsSinceEpoch(firstTs);
@@ -544,7 +767,8 @@ UserActivity Analytics::collectUserActivity(
 	// First try user_activity_summary table for efficient stats
 	if (chatId != 0 && range.period == "all") {
 		QString sql = "SELECT message_count, word_count, avg_message_length, "
-		              "most_active_hour, first_message_date, last_message_date, days_active "
+		              "most_active_hour, first_message_date, last_message_date, days_active, "
+		              "user_name, reply_count "
 		              "FROM user_activity_summary WHERE user_id = ? AND chat_id = ?";
 		query.prepare(sql);
 		query.addBindValue(userId);
@@ -556,6 +780,8 @@ UserActivity Analytics::collectUserActivity(
 			activity.averageMessageLength = query.value(2).toDouble();
 			activity.firstSeen = QDateTime::fromSecsSinceEpoch(query.value(4).toLongLong());
 			activity.lastSeen = QDateTime::fromSecsSinceEpoch(query.value(5).toLongLong());
+			activity.userName = query.value(7).toString();
+			activity.replyCount = query.value(8).toInt();
 		}
 	}
 
@@ -611,65 +837,10 @@ UserActivity Analytics::collectUserActivity(
 	}
 
 	// Get hourly and weekly distribution
-	activity.hourlyActivity = QVector<int>(24, 0);
-	activity.weeklyActivity = QVector<int>(7, 0);
-
-	QString whereClause = "user_id = ?";
-	QVector<QVariant> bindings = {userId};
-	if (chatId != 0) {
-		whereClause += " AND chat_id = ?";
-		bindings.append(chatId);
-	}
-	if (!range.start.isNull()) {
-		whereClause += " AND timestamp >= ?";
-		bindings.append(range.start.toSecsSinceEpoch());
-	}
-	if (!range.end.isNull()) {
-		whereClause += " AND timestamp <= ?";
-		bindings.append(range.end.toSecsSinceEpoch());
-	}
-
-	// Hourly activity
-	QString sqlHourly = QString(
-		"SELECT strftime('%%H', datetime(timestamp, 'unixepoch')) as hour, COUNT(*) "
-		"FROM messages WHERE %1 GROUP BY hour"
-	).arg(whereClause);
-
-	query.prepare(sqlHourly);
-	for (const auto &binding : bindings) {
-		query.addBindValue(binding);
-	}
-
-	if (query.exec()) {
-		while (query.next()) {
-			int hour = query.value(0).toInt();
-			int count = query.value(1).toInt();
-			if (hour >= 0 && hour < 24) {
-				activity.hourlyActivity[hour] = count;
-			}
-		}
-	}
-
-	// Weekly activity (0 = Sunday)
-	QString sqlWeekly = QString(
-		"SELECT strftime('%%w', datetime(timestamp, 'unixepoch')) as dow, COUNT(*) "
-		"FROM messages WHERE %1 GROUP BY dow"
-	).arg(whereClause);
-
-	query.prepare(sqlWeekly);
-	for (const auto &binding : bindings) {
-		query.addBindValue(binding);
-	}
-
-	if (query.exec()) {
-		while (query.next()) {
-			int dow = query.value(0).toInt();
-			int count = query.value(1).toInt();
-			if (dow >= 0 && dow < 7) {
-				activity.weeklyActivity[dow] = count;
-			}
-		}
-	}
+	AddDistributions(
+		LoadHourlyActivity(db, chatId, userId, range),
+		activity.hourlyActivity,
+		activity.weeklyActivity);
 
 	return activity;
 }
@@ -705,10 +876,16 @@ ChatActivity Analytics::collectChatActivity(
 		if (query.exec() && query.next()) {
 			activity.totalMessages = query.value(0).toInt();
 			activity.activeUsers = query.value(1).toInt();
-			activity.messagesPerDay = query.value(2).toDouble();
 			// peak_hour could be used
 			activity.activityTrend = query.value(6).toString();
 
+			const auto daysDiff = QDateTime::fromSecsSinceEpoch(
+				query.value(4).toLongLong()
+			).daysTo(QDateTime::fromSecsSinceEpoch(query.value(5).toLongLong()));
+			if (daysDiff > 0) {
+				activity.messagesPerDay = static_cast<double>(activity.totalMessages) / daysDiff;
+			}
+
 			if (activity.activeUsers > 0) {
 				activity.messagesPerUser = static_cast<double>(activity.totalMessages) / activity.activeUsers;
 			}
@@ -777,61 +954,10 @@ ChatActivity Analytics::collectChatActivity(
 	}
 
 	// Get hourly and weekly distributions
-	activity.hourlyDistribution = QVector<int>(24, 0);
-	activity.weeklyDistribution = QVector<int>(7, 0);
-
-	QString whereClause = "chat_id = ?";
-	QVector<QVariant> bindings = {chatId};
-	if (!range.start.isNull()) {
-		whereClause += " AND timestamp >= ?";
-		bindings.append(range.start.toSecsSinceEpoch());
-	}
-	if (!range.end.isNull()) {
-		whereClause += " AND timestamp <= ?";
-		bindings.append(range.end.toSecsSinceEpoch());
-	}
-
-	// Hourly distribution
-	QString sqlHourly = QString(
-		"SELECT strftime('%%H', datetime(timestamp, 'unixepoch')) as hour, COUNT(*) "
-		"FROM messages WHERE %1 GROUP BY hour"
-	).arg(whereClause);
-
-	query.prepare(sqlHourly);
-	for (const auto &binding : bindings) {
-		query.addBindValue(binding);
-	}
-
-	if (query.exec()) {
-		while (query.next()) {
-			int hour = query.value(0).toInt();
-			int count = query.value(1).toInt();
-			if (hour >= 0 && hour < 24) {
-				activity.hourlyDistribution[hour] = count;
-			}
-		}
-	}
-
-	// Weekly distribution
-	QString sqlWeekly = QString(
-		"SELECT strftime('%%w', datetime(timestamp, 'unixepoch')) as dow, COUNT(*) "
-		"FROM messages WHERE %1 GROUP BY dow"
-	).arg(whereClause);
-
-	query.prepare(sqlWeekly);
-	for (const auto &binding : bindings) {
-		query.addBindValue(binding);
-	}
-
-	if (query.exec()) {
-		while (query.next()) {
-			int dow = query.value(0).toInt();
-			int count = query.value(1).toInt();
-			if (dow >= 0 && dow < 7) {
-				activity.weeklyDistribution[dow] = count;
-			}
-		}
-	}
+	AddDistributions(
+		LoadHourlyActivity(db, chatId, 0, range),
+		activity.hourlyDistribution,
+		activity.weeklyDistribution);
 
 	// Get chat title from chats table
 	QString sqlChat = "SELECT title FROM chats WHERE chat_id = ?";
@@ -862,26 +988,45 @@ QVector<TimeSeriesPoint> Analytics::generateTimeSeries(
 		return points;
 	}
 
-	QSqlQuery query(db);
+	// Hourly series are summed from message_activity_hourly in memory,
+	// day and coarser buckets from the daily rollups.
+	if (granularity == "hourly") {
+		auto users = QSet<qint64>();
+		auto length = qint64();
+		for (const auto &row : LoadHourlyActivity(db, chatId, 0, range)) {
+			const auto timestamp = QDateTime::fromSecsSinceEpoch(row.hour * 3600).toUTC();
+			if (points.isEmpty() || points.back().timestamp != timestamp) {
+				users.clear();
+				length = 0;
+				points.append(TimeSeriesPoint{ .timestamp = timestamp });
+			}
+			auto &point = points.back();
+			point.messageCount += row.count;
+			point.messageTypes[row.type] += row.count;
+			users.insert(row.userId);
+			point.userCount = users.size();
+			length += row.length;
+			point.averageLength = double(length) / point.messageCount;
+		}
+		return points;
+	}
 
 	// Build WHERE clause
 	QString whereClause = "chat_id = ?";
 	QVector<QVariant> bindings = {chatId};
 
 	if (!range.start.isNull()) {
-		whereClause += " AND timestamp >= ?";
-		bindings.append(range.start.toSecsSinceEpoch());
+		whereClause += " AND date >= ?";
+		bindings.append(RollupDate(range.start));
 	}
 	if (!range.end.isNull()) {
-		whereClause += " AND timestamp <= ?";
-		bindings.append(range.end.toSecsSinceEpoch());
+		whereClause += " AND date <= ?";
+		bindings.append(RollupDate(range.end));
 	}
 
 	// Determine time grouping format based on granularity
 	QString timeFormat;
-	if (granularity == "hourly") {
-		timeFormat = "%Y-%m-%d %H:00:00";
-	} else if (granularity == "daily") {
+	if (granularity == "daily") {
 		timeFormat = "%Y-%m-%d";
 	} else if (granularity == "weekly") {
 		timeFormat = "%Y-W%W";
@@ -893,36 +1038,54 @@ QVector<TimeSeriesPoint> Analytics::generateTimeSeries(
 		timeFormat = "%Y-%m-%d"; // default to daily
 	}
 
+	// Distinct users of a bucket longer than a day can't be summed from
+	// the days, they are counted over the (chat, day, user) rollup.
+	QHash<QString, int> bucketUsers;
+	const auto perDayUsers = (timeFormat == "%Y-%m-%d");
+	if (!perDayUsers) {
+		auto users = PreparedQuery(db, QString(
+			"SELECT strftime('%1', date) as time_bucket, COUNT(DISTINCT user_id) "
+			"FROM user_activity_daily WHERE %2 "
+			"GROUP BY time_bucket"
+		).arg(timeFormat).arg(whereClause));
+		for (const auto &binding : bindings) {
+			users->addBindValue(binding);
+		}
+		if (users->exec()) {
+			while (users->next()) {
+				bucketUsers.insert(users->value(0).toString(), users->value(1).toInt());
+			}
+		}
+	}
+
 	// Query time series data
 	QString sql = QString(
 		"SELECT "
-		"strftime('%1', datetime(timestamp, 'unixepoch')) as time_bucket, "
-		"COUNT(*) as msg_count, "
-		"COUNT(DISTINCT user_id) as user_count, "
-		"AVG(LENGTH(content)) as avg_len "
-		"FROM messages WHERE %2 "
+		"strftime('%1', date) as time_bucket, "
+		"SUM(message_count) as msg_count, "
+		"SUM(unique_users) as user_count, "
+		"SUM(total_length) * 1.0 / NULLIF(SUM(message_count), 0) as avg_len "
+		"FROM message_stats_daily WHERE %2 "
 		"GROUP BY time_bucket "
 		"ORDER BY time_bucket"
 	).arg(timeFormat).arg(whereClause);
 
-	query.prepare(sql);
+	auto query = PreparedQuery(db, sql);
 	for (const auto &binding : bindings) {
-		query.addBindValue(binding);
+		query->addBindValue(binding);
 	}
 
-	if (!query.exec()) {
-		qWarning() << "Analytics: Failed to generate time series:" << query.lastError().text();
+	if (!query->exec()) {
+		qWarning() << "Analytics: Failed to generate time series:" << query->lastError().text();
 		return points;
 	}
 
-	while (query.next()) {
+	while (query->next()) {
 		TimeSeriesPoint point;
-		QString timeBucket = query.value(0).toString();
+		QString timeBucket = query->value(0).toString();
 
 		// Parse time bucket based on granularity
-		if (granularity == "hourly") {
-			point.timestamp = QDateTime::fromString(timeBucket, "yyyy-MM-dd HH:00:00");
-		} else if (granularity == "daily") {
+		if (granularity == "daily") {
 			point.timestamp = QDateTime::fromString(timeBucket, "yyyy-MM-dd");
 		} else if (granularity == "monthly") {
 			point.timestamp = QDateTime::fromString(timeBucket + "-01", "yyyy-MM-dd");
@@ -932,32 +1095,13 @@ QVector<TimeSeriesPoint> Analytics::generateTimeSeries(
 			point.timestamp = QDateTime::fromString(timeBucket, "yyyy-MM-dd");
 		}
 
-		point.messageCount = query.value(1).toInt();
-		point.userCount = query.value(2).toInt();
-		point.averageLength = query.value(3).toDouble();
-
-		// Get message type distribution for this time bucket
-		QString sqlTypes = QString(
-			"SELECT message_type, COUNT(*) "
-			"FROM messages WHERE %1 AND strftime('%2', datetime(timestamp, 'unixepoch')) = ? "
-			"GROUP BY message_type"
-		).arg(whereClause).arg(timeFormat);
-
-		QSqlQuery typeQuery(db);
-		typeQuery.prepare(sqlTypes);
-		for (const auto &binding : bindings) {
-			typeQuery.addBindValue(binding);
-		}
-		typeQuery.addBindValue(timeBucket);
-
-		if (typeQuery.exec()) {
-			while (typeQuery.next()) {
-				QString type = typeQuery.value(0).toString();
-				int count = typeQuery.value(1).toInt();
-				point.messageTypes[type] = count;
-			}
-		}
+		point.messageCount = query->value(1).toInt();
+		point.userCount = perDayUsers
+			? query->value(2).toInt()
+			: bucketUsers.value(timeBucket);
+		point.averageLength = query->value(3).toDouble();
 
+		// messageTypes isn't serialized, skip a query per bucket.
 		points.append(point);
 	}
 
@@ -981,8 +1125,6 @@ QHash<QString, int> Analytics::analyzeWordFrequency(
 		return wordFreq;
 	}
 
-	QSqlQuery query(db);
-
 	// Query messages - use 'content' column from schema
 	QString whereClause = "chat_id = ? AND content IS NOT NULL";
 	QVector<QVariant> bindings = {chatId};
@@ -996,63 +1138,74 @@ QHash<QString, int> Analytics::analyzeWordFrequency(
 		bindings.append(range.end.toSecsSinceEpoch());
 	}
 
-	// Limit to text messages or messages with content
+	// The whole range is read, a batch of texts at a time
 	QString sql = QString(
-		"SELECT content FROM messages WHERE %1 AND LENGTH(content) > 0 LIMIT 10000"
+		"SELECT content FROM messages WHERE %1 AND LENGTH(content) > 0"
 	).arg(whereClause);
 
-	query.prepare(sql);
+	auto query = PreparedQuery(db, sql);
 	for (const auto &binding : bindings) {
-		query.addBindValue(binding);
+		query->addBindValue(binding);
 	}
 
-	if (!query.exec()) {
-		qWarning() << "Analytics: Failed to query messages for word frequency:" << query.lastError().text();
+	if (!query->exec()) {
+		qWarning() << "Analytics: Failed to query messages for word frequency:" << query->lastError().text();
 		return wordFreq;
 	}
 
 	int messagesProcessed = 0;
-	while (query.next()) {
-		QString text = query.value(0).toString();
+	auto texts = std::vector<QString>();
+	texts.reserve(kWordBatch);
+	auto countBatch = [&] {
+		// Every slice counts views into its own lowercased texts, only
+		// the distinct words of a batch become QStrings in the merge.
+		const auto count = int(texts.size());
+		const auto slices = std::max(
+			std::min(count / kWordSlice, QThreadPool::globalInstance()->maxThreadCount()),
+			1);
+		auto counts = std::vector<QHash<QStringView, int>>(slices);
+		const auto step = (count + slices - 1) / slices;
+		ParallelFor(slices, 1, [&](int from, int till) {
+			for (auto slice = from; slice != till; ++slice) {
+				auto &local = counts[slice];
+				const auto end = std::min((slice + 1) * step, count);
+				for (auto i = slice * step; i < end; ++i) {
+					ForEachWord(texts[i], [&](QStringView word) {
+						if (word.size() >= kMinWordLength) {
+							++local[word];
+						}
+					});
+				}
+			}
+		});
+		for (const auto &local : counts) {
+			for (auto i = local.cbegin(); i != local.cend(); ++i) {
+				const auto word = i.key().toString();
+				if (!_stopWords.contains(word)) {
+					wordFreq[word] += i.value();
+				}
+			}
+		}
+		texts.clear();
+	};
+	while (query->next()) {
+		QString text = query->value(0).toString();
 		if (text.isEmpty()) {
 			continue;
 		}
-
-		QStringList words = extractWords(text);
-		for (const QString &word : words) {
-			QString lowercaseWord = word.toLower();
-			// Filter out short words and stop words
-			if (lowercaseWord.length() >= 3 && !isStopWord(lowercaseWord)) {
-				wordFreq[lowercaseWord]++;
-			}
+		texts.push_back(text.toLower());
+		if (int(texts.size()) == kWordBatch) {
+			countBatch();
 		}
-
 		messagesProcessed++;
-		// Process in batches to avoid memory issues
-		if (messagesProcessed % 1000 == 0) {
-			qDebug() << "Analytics: Processed" << messagesProcessed << "messages for word frequency";
-		}
 	}
+	countBatch();
 
 	qDebug() << "Analytics: Word frequency analysis complete." << wordFreq.size() << "unique words from" << messagesProcessed << "messages";
 
 	return wordFreq;
 }
 
-QStringList Analytics::extractWords(const QString &text) const {
-	// Split by non-word characters and convert to lowercase
-	QRegularExpression wordRegex("\\b\\w+\\b");
-	QRegularExpressionMatchIterator it = wordRegex.globalMatch(text);
-	
-	QStringList words;
-	while (it.hasNext()) {
-		QRegularExpressionMatch match = it.next();
-		words.append(match.captured(0).toLower());
-	}
-	
-	return words;
-}
-
 bool Analytics::isStopWord(const QString &word) const {
 	return _stopWords.contains(word.toLower());
 }
@@ -1340,6 +1493,7 @@ QString Analytics::getCacheKey(qint64 chatId, const QString &type) const {
 }
 
 bool Analytics::isCacheValid(const QString &key) const {
+	QMutexLocker lock(&_cacheMutex);
 	if (!_cache.contains(key)) {
 		return false;
 	}
@@ -1353,10 +1507,12 @@ void Analytics::setCacheValue(const QString &key, const QJsonObject &data) {
 	CachedAnalytics cached;
 	cached.timestamp = QDateTime::currentDateTime();
 	cached.data = data;
+	QMutexLocker lock(&_cacheMutex);
 	_cache[key] = cached;
 }
 
 QJsonObject Analytics::getCacheValue(const QString &key) const {
+	QMutexLocker lock(&_cacheMutex);
 	if (_cache.contains(key)) {
 		return _cache[key].data;
 	}
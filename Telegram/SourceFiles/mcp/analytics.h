@@ -9,6 +9,7 @@
 #include <QtCore/QJsonArray>
 #include <QtCore/QDateTime>
 #include <QtCore/QHash>
+#include <QtCore/QMutex>
 #include <QtCore/QVector>
 #include <memory>
 
@@ -159,6 +160,14 @@ public:
 		const QVector<qint64> &userIds
 	);
 
+	// Approximate distinct and heaviest users of the last daysBack days
+	// of a chat (0 = all chats), merged from per-day sketches.
+	QJsonObject getUniqueUsers(
+		qint64 chatId = 0,
+		int daysBack = 90,
+		int topLimit = 10
+	);
+
 	// Real-time analytics
 	QJsonObject getLiveActivity(qint64 chatId = 0);
 	QJsonArray getActiveChats(int limit = 10);
@@ -203,7 +212,6 @@ private:
 		const AnalyticsTimeRange &range
 	);
 
-	QStringList extractWords(const QString &text) const;
 	bool isStopWord(const QString &word) const;
 
 	// Trend detection
@@ -246,6 +254,7 @@ private:
 		QJsonObject data;
 	};
 	QHash<QString, CachedAnalytics> _cache;
+	mutable QMutex _cacheMutex; // Queries may run on MCP worker threads.
 	int _cacheLifetimeSeconds = 300; // 5 minutes
 
 	QString getCacheKey(qint64 chatId, const QString &type) const;
@@ -2,31 +2,221 @@
 // Licensed under GPLv3 with OpenSSL exception.
 
 #include "audit_logger.h"
+#include "database_pool.h"
 
+#include <QtCore/QDate>
 #include <QtCore/QFile>
 #include <QtCore/QTextStream>
 #include <QtCore/QJsonDocument>
 #include <QtSql/QSqlQuery>
 #include <QtSql/QSqlError>
 
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <map>
+#include <optional>
+#include <tuple>
+
 namespace MCP {
+namespace {
+
+constexpr auto kQueueCapacity = 4096; // Power of two.
+constexpr auto kBatchSize = 256;
+constexpr auto kFlushInterval = 200; // ms
+constexpr auto kSecondsPerDay = qint64(86400);
+constexpr auto kDaysPerWeek = 7;
+constexpr auto kNoLimit = std::numeric_limits<qint64>::max();
+
+constexpr auto kPartitionsTable = R"(
+	CREATE TABLE IF NOT EXISTS audit_partitions (
+		week INTEGER PRIMARY KEY, -- Days since epoch of its Monday.
+		event_count INTEGER NOT NULL DEFAULT 0,
+		last_id INTEGER NOT NULL DEFAULT 0,
+		dropped INTEGER NOT NULL DEFAULT 0
+	)
+)";
+
+constexpr auto kStatsTable = R"(
+	CREATE TABLE IF NOT EXISTS audit_stats (
+		week INTEGER NOT NULL,
+		event_type TEXT NOT NULL,
+		tool_name TEXT NOT NULL DEFAULT '',
+		user_id TEXT NOT NULL DEFAULT '',
+		event_count INTEGER NOT NULL DEFAULT 0,
+		failure_count INTEGER NOT NULL DEFAULT 0,
+		duration_total INTEGER NOT NULL DEFAULT 0,
+		duration_count INTEGER NOT NULL DEFAULT 0,
+		PRIMARY KEY (week, event_type, tool_name, user_id)
+	) WITHOUT ROWID
+)";
+
+constexpr auto kEventColumns = "event_type, event_subtype, user_id, "
+	"tool_name, parameters, result_status, error_message, duration_ms, "
+	"timestamp, metadata";
+
+// Columns of an audit_stats row, aggregated from raw events.
+constexpr auto kStatsSelect = "event_type, COALESCE(tool_name, ''), "
+	"COALESCE(user_id, ''), COUNT(*), SUM(result_status = 'failure'), "
+	"COALESCE(SUM(duration_ms), 0), COUNT(duration_ms)";
+
+struct StatsRow {
+	qint64 events = 0;
+	qint64 failures = 0;
+	qint64 durationTotal = 0;
+	qint64 durationCount = 0;
+};
+
+// week, event_type, tool_name, user_id
+using StatsKey = std::tuple<qint64, QString, QString, QString>;
+
+[[nodiscard]] qint64 WeekOf(qint64 timestamp) {
+	const auto day = timestamp / kSecondsPerDay;
+	return day - (day + 3) % kDaysPerWeek; // 1970-01-01 was a Thursday.
+}
+
+[[nodiscard]] qint64 WeekStart(qint64 week) {
+	return week * kSecondsPerDay;
+}
+
+[[nodiscard]] qint64 WeekEnd(qint64 week) { // Exclusive.
+	return (week + kDaysPerWeek) * kSecondsPerDay;
+}
+
+[[nodiscard]] QString PartitionTable(qint64 week) {
+	return "audit_log_"
+		+ QDate(1970, 1, 1).addDays(week).toString("yyyyMMdd");
+}
+
+[[nodiscard]] QStringList PartitionSchema(qint64 week) {
+	const auto table = PartitionTable(week);
+	return {
+		QString(R"(
+			CREATE TABLE IF NOT EXISTS %1 (
+				id INTEGER PRIMARY KEY,
+				event_type TEXT NOT NULL,
+				event_subtype TEXT,
+				user_id TEXT,
+				tool_name TEXT,
+				parameters TEXT,
+				result_status TEXT,
+				error_message TEXT,
+				duration_ms INTEGER,
+				timestamp INTEGER NOT NULL,
+				metadata TEXT
+			)
+		)").arg(table),
+		QString("CREATE INDEX IF NOT EXISTS %1_time "
+			"ON %1(timestamp DESC)").arg(table),
+		QString("CREATE INDEX IF NOT EXISTS %1_type "
+			"ON %1(event_type, timestamp DESC)").arg(table),
+		QString("CREATE INDEX IF NOT EXISTS %1_user "
+			"ON %1(user_id, timestamp DESC)").arg(table),
+		QString("CREATE INDEX IF NOT EXISTS %1_tool "
+			"ON %1(tool_name, timestamp DESC)").arg(table),
+	};
+}
+
+} // namespace
+
+// Bounded multi-producer ring (Vyukov): producers claim a slot with one
+// CAS, the writer thread is the only consumer and needs none.
+class AuditLogger::Queue final {
+public:
+	Queue() {
+		for (auto i = 0; i != kQueueCapacity; ++i) {
+			_slots[i].sequence.store(quint64(i), std::memory_order_relaxed);
+		}
+	}
+
+	[[nodiscard]] bool push(AuditEvent &&event) {
+		auto position = _enqueue.load(std::memory_order_relaxed);
+		for (;;) {
+			auto &slot = _slots[position & (kQueueCapacity - 1)];
+			const auto sequence = slot.sequence.load(std::memory_order_acquire);
+			const auto difference = qint64(sequence) - qint64(position);
+			if (difference == 0) {
+				if (_enqueue.compare_exchange_weak(
+						position,
+						position + 1,
+						std::memory_order_relaxed)) {
+					slot.event = std::move(event);
+					slot.sequence.store(position + 1, std::memory_order_release);
+					return true;
+				}
+			} else if (difference < 0) {
+				return false;
+			} else {
+				position = _enqueue.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	[[nodiscard]] bool pop(AuditEvent &event) {
+		auto &slot = _slots[_dequeue & (kQueueCapacity - 1)];
+		const auto sequence = slot.sequence.load(std::memory_order_acquire);
+		if (sequence != _dequeue + 1) {
+			return false;
+		}
+		event = std::move(slot.event);
+		slot.sequence.store(
+			_dequeue + kQueueCapacity,
+			std::memory_order_release);
+		++_dequeue;
+		return true;
+	}
+
+private:
+	struct Slot {
+		std::atomic<quint64> sequence = 0;
+		AuditEvent event;
+	};
+
+	std::array<Slot, kQueueCapacity> _slots;
+	alignas(64) std::atomic<quint64> _enqueue = 0;
+	alignas(64) quint64 _dequeue = 0;
+
+};
 
 AuditLogger::AuditLogger(QObject *parent)
-	: QObject(parent) {
+	: QObject(parent)
+	, _queue(std::make_unique<Queue>()) {
+	_flushTimer.setInterval(kFlushInterval);
+	connect(&_flushTimer, &QTimer::timeout, this, [=] {
+		if (_pending.load() > 0) {
+			queueFlush();
+		}
+	});
 }
 
 AuditLogger::~AuditLogger() {
 	stop();
 }
 
-bool AuditLogger::start(QSqlDatabase *db, const QString &logFilePath) {
+bool AuditLogger::start(DatabasePool *pool, const QString &logFilePath) {
 	if (_isRunning) {
 		return true;
 	}
 
-	_db = db;
+	_pool = pool;
 	_logFilePath = logFilePath;
+	if (_pool && _pool->isOpen()) {
+		auto initialized = false;
+		_pool->writeAndWait([&](QSqlDatabase &db) {
+			initialized = initializeStorage(db);
+		});
+		if (!initialized) {
+			qWarning() << "MCP: Failed to initialize audit storage";
+		}
+	}
+	if (!_logFilePath.isEmpty()) {
+		_logFile.setFileName(_logFilePath);
+		if (!_logFile.open(QIODevice::Append | QIODevice::Text)) {
+			qWarning() << "MCP: Failed to open audit log file:" << _logFilePath;
+		}
+	}
 	_isRunning = true;
+	_flushTimer.start();
 
 	return true;
 }
@@ -36,8 +226,24 @@ void AuditLogger::stop() {
 		return;
 	}
 
-	_db = nullptr;
 	_isRunning = false;
+	_flushTimer.stop();
+	flush();
+	_logFile.close();
+	_pool = nullptr;
+}
+
+void AuditLogger::setRetentionDays(int days) {
+	_retentionDays = std::max(days, 1);
+}
+
+void AuditLogger::flush() {
+	if (!_pool || _pending.load() <= 0) {
+		return;
+	}
+	_pool->writeAndWait([=](QSqlDatabase &db) {
+		drain(db);
+	});
 }
 
 // Log tool invoked
@@ -178,11 +384,11 @@ QVector<AuditEvent> AuditLogger::queryEvents(
 
 	QVector<AuditEvent> events;
 
-	if (!_db || !_db->isOpen()) {
+	if (!_pool || !_pool->isOpen()) {
 		return events;
 	}
+	flush();
 
-	QString sql = "SELECT * FROM audit_log WHERE 1=1";
 	QStringList conditions;
 
 	if (static_cast<int>(eventType) >= 0) {
@@ -200,36 +406,42 @@ QVector<AuditEvent> AuditLogger::queryEvents(
 	if (endTime.isValid()) {
 		conditions << "timestamp <= :end_time";
 	}
+	const auto where = conditions.isEmpty()
+		? QString()
+		: (" WHERE " + conditions.join(" AND "));
+
+	// Weeks don't overlap, going newest first keeps the result ordered
+	// and a recent window never opens the older partitions.
+	for (const auto week : partitions(startTime, endTime)) {
+		const auto left = limit - int(events.size());
+		if (left <= 0) {
+			break;
+		}
+		QSqlQuery query(_pool->reader());
+		query.prepare("SELECT * FROM " + PartitionTable(week) + where
+			+ " ORDER BY timestamp DESC LIMIT :limit");
 
-	if (!conditions.isEmpty()) {
-		sql += " AND " + conditions.join(" AND ");
-	}
-
-	sql += " ORDER BY timestamp DESC LIMIT :limit";
-
-	QSqlQuery query(*_db);
-	query.prepare(sql);
-
-	if (static_cast<int>(eventType) >= 0) {
-		query.bindValue(":event_type", eventTypeToString(eventType));
-	}
-	if (!userId.isEmpty()) {
-		query.bindValue(":user_id", userId);
-	}
-	if (!toolName.isEmpty()) {
-		query.bindValue(":tool_name", toolName);
-	}
-	if (startTime.isValid()) {
-		query.bindValue(":start_time", startTime.toSecsSinceEpoch());
-	}
-	if (endTime.isValid()) {
-		query.bindValue(":end_time", endTime.toSecsSinceEpoch());
-	}
-	query.bindValue(":limit", limit);
+		if (static_cast<int>(eventType) >= 0) {
+			query.bindValue(":event_type", eventTypeToString(eventType));
+		}
+		if (!userId.isEmpty()) {
+			query.bindValue(":user_id", userId);
+		}
+		if (!toolName.isEmpty()) {
+			query.bindValue(":tool_name", toolName);
+		}
+		if (startTime.isValid()) {
+			query.bindValue(":start_time", startTime.toSecsSinceEpoch());
+		}
+		if (endTime.isValid()) {
+			query.bindValue(":end_time", endTime.toSecsSinceEpoch());
+		}
+		query.bindValue(":limit", left);
 
-	if (query.exec()) {
-		while (query.next()) {
-			events.append(loadEventFromQuery(query));
+		if (query.exec()) {
+			while (query.next()) {
+				events.append(loadEventFromQuery(query));
+			}
 		}
 	}
 
@@ -239,8 +451,12 @@ QVector<AuditEvent> AuditLogger::queryEvents(
 // Get recent events
 QVector<AuditEvent> AuditLogger::getRecentEvents(int limit) {
 	// Return from in-memory buffer first if available
-	if (_eventBuffer.size() <= limit) {
-		return _eventBuffer;
+	flush();
+	{
+		QMutexLocker lock(&_eventBufferMutex);
+		if (_eventBuffer.size() <= limit) {
+			return _eventBuffer;
+		}
 	}
 
 	// Otherwise query database
@@ -265,109 +481,106 @@ AuditLogger::AuditStatistics AuditLogger::getStatistics(
 		const QDateTime &start,
 		const QDateTime &end) {
 
-	AuditStatistics stats;
+	AuditStatistics stats{};
 
-	if (!_db || !_db->isOpen()) {
+	if (!_pool || !_pool->isOpen()) {
 		return stats;
 	}
-
-	QString sql = "SELECT COUNT(*) as total, event_type FROM audit_log WHERE 1=1";
-
-	if (start.isValid()) {
-		sql += " AND timestamp >= " + QString::number(start.toSecsSinceEpoch());
+	flush();
+
+	auto durationTotal = qint64();
+	auto durationCount = qint64();
+	const auto add = [&](const QSqlQuery &query) {
+		const auto count = query.value(3).toInt();
+		const auto tool = query.value(1).toString();
+		const auto user = query.value(2).toString();
+
+		stats.totalEvents += count;
+		switch (stringToEventType(query.value(0).toString())) {
+		case AuditEventType::ToolInvoked:
+			stats.toolInvocations += count;
+			break;
+		case AuditEventType::AuthEvent:
+			stats.authEvents += count;
+			break;
+		case AuditEventType::TelegramOp:
+			stats.telegramOps += count;
+			break;
+		case AuditEventType::SystemEvent:
+			stats.systemEvents += count;
+			break;
+		case AuditEventType::Error:
+			stats.errors += count;
+			break;
+		}
+		if (!tool.isEmpty()) {
+			stats.toolCounts[tool] += count;
+			stats.toolFailures[tool] += query.value(4).toInt();
+		}
+		if (!user.isEmpty()) {
+			stats.userCounts[user] += count;
+		}
+		durationTotal += query.value(5).toLongLong();
+		durationCount += query.value(6).toLongLong();
+	};
+
+	// Whole weeks come from audit_stats, also those already dropped.
+	const auto from = start.isValid() ? start.toSecsSinceEpoch() : -kNoLimit;
+	const auto till = end.isValid() ? end.toSecsSinceEpoch() : kNoLimit;
+	auto firstWeek = start.isValid() ? WeekOf(from) : -kNoLimit;
+	auto lastWeek = end.isValid() ? WeekOf(till) : kNoLimit;
+	auto partial = std::vector<qint64>();
+	if (start.isValid() && WeekStart(firstWeek) < from) {
+		partial.push_back(firstWeek);
+		firstWeek += kDaysPerWeek;
 	}
-	if (end.isValid()) {
-		sql += " AND timestamp <= " + QString::number(end.toSecsSinceEpoch());
+	if (end.isValid() && WeekEnd(lastWeek) - 1 > till) {
+		if (partial.empty() || partial.back() != lastWeek) {
+			partial.push_back(lastWeek);
+		}
+		lastWeek -= kDaysPerWeek;
 	}
 
-	sql += " GROUP BY event_type";
-
-	QSqlQuery query(*_db);
-	if (query.exec(sql)) {
-		while (query.next()) {
-			int count = query.value("total").toInt();
-			QString typeStr = query.value("event_type").toString();
-			AuditEventType type = stringToEventType(typeStr);
-
-			stats.totalEvents += count;
-
-			switch (type) {
-			case AuditEventType::ToolInvoked:
-				stats.toolInvocations += count;
-				break;
-			case AuditEventType::AuthEvent:
-				stats.authEvents += count;
-				break;
-			case AuditEventType::TelegramOp:
-				stats.telegramOps += count;
-				break;
-			case AuditEventType::SystemEvent:
-				stats.systemEvents += count;
-				break;
-			case AuditEventType::Error:
-				stats.errors += count;
-				break;
+	if (firstWeek <= lastWeek) {
+		QSqlQuery query(_pool->reader());
+		query.prepare(R"(
+			SELECT event_type, tool_name, user_id,
+				SUM(event_count), SUM(failure_count),
+				SUM(duration_total), SUM(duration_count)
+			FROM audit_stats
+			WHERE week >= :first AND week <= :last
+			GROUP BY event_type, tool_name, user_id
+		)");
+		query.bindValue(":first", firstWeek);
+		query.bindValue(":last", lastWeek);
+		if (query.exec()) {
+			while (query.next()) {
+				add(query);
 			}
 		}
 	}
 
-	// Tool counts
-	QSqlQuery toolQuery(*_db);
-	QString toolSql = "SELECT tool_name, COUNT(*) as count FROM audit_log "
-	                  "WHERE tool_name IS NOT NULL";
-
-	if (start.isValid()) {
-		toolSql += " AND timestamp >= " + QString::number(start.toSecsSinceEpoch());
-	}
-	if (end.isValid()) {
-		toolSql += " AND timestamp <= " + QString::number(end.toSecsSinceEpoch());
-	}
-
-	toolSql += " GROUP BY tool_name";
-
-	if (toolQuery.exec(toolSql)) {
-		while (toolQuery.next()) {
-			stats.toolCounts[toolQuery.value("tool_name").toString()] =
-				toolQuery.value("count").toInt();
+	// At most two partially covered weeks are scanned.
+	for (const auto week : partitions(start, end)) {
+		if (std::find(partial.begin(), partial.end(), week) == partial.end()) {
+			continue;
 		}
-	}
-
-	// User counts
-	QSqlQuery userQuery(*_db);
-	QString userSql = "SELECT user_id, COUNT(*) as count FROM audit_log "
-	                  "WHERE user_id IS NOT NULL";
-
-	if (start.isValid()) {
-		userSql += " AND timestamp >= " + QString::number(start.toSecsSinceEpoch());
-	}
-	if (end.isValid()) {
-		userSql += " AND timestamp <= " + QString::number(end.toSecsSinceEpoch());
-	}
-
-	userSql += " GROUP BY user_id";
-
-	if (userQuery.exec(userSql)) {
-		while (userQuery.next()) {
-			stats.userCounts[userQuery.value("user_id").toString()] =
-				userQuery.value("count").toInt();
+		QSqlQuery query(_pool->reader());
+		query.prepare(QString("SELECT %1 FROM %2 "
+			"WHERE timestamp >= :from AND timestamp <= :till "
+			"GROUP BY 1, 2, 3").arg(kStatsSelect, PartitionTable(week)));
+		query.bindValue(":from", from);
+		query.bindValue(":till", till);
+		if (query.exec()) {
+			while (query.next()) {
+				add(query);
+			}
 		}
 	}
 
-	// Average duration
-	QSqlQuery durationQuery(*_db);
-	QString durationSql = "SELECT AVG(duration_ms) as avg_duration FROM audit_log "
-	                      "WHERE duration_ms IS NOT NULL";
-
-	if (start.isValid()) {
-		durationSql += " AND timestamp >= " + QString::number(start.toSecsSinceEpoch());
-	}
-	if (end.isValid()) {
-		durationSql += " AND timestamp <= " + QString::number(end.toSecsSinceEpoch());
-	}
-
-	if (durationQuery.exec(durationSql) && durationQuery.next()) {
-		stats.avgDuration = durationQuery.value("avg_duration").toDouble();
-	}
+	stats.avgDuration = durationCount
+		? (double(durationTotal) / durationCount)
+		: 0.;
 
 	return stats;
 }
@@ -420,26 +633,59 @@ QString AuditLogger::exportEventsToFile(
 
 // Maintenance
 bool AuditLogger::purgeOldEvents(int daysToKeep) {
-	if (!_db || !_db->isOpen()) {
+	if (!_pool || !_pool->isOpen()) {
 		return false;
 	}
+	flush();
+
+	const auto cutoff = QDateTime::currentDateTime().addDays(-daysToKeep).toSecsSinceEpoch();
+
+	auto result = false;
+	_pool->writeAndWait([&](QSqlDatabase &db) {
+		db.transaction();
+		dropPartitionsBefore(db, cutoff);
+
+		// Only the week holding the cutoff needs a row by row delete.
+		const auto week = WeekOf(cutoff);
+		if (_partitions.contains(week)) {
+			QSqlQuery query(db);
+			query.prepare("DELETE FROM " + PartitionTable(week)
+				+ " WHERE timestamp < :cutoff");
+			query.bindValue(":cutoff", cutoff);
+			if (query.exec()) {
+				const auto removed = query.numRowsAffected();
+				query.prepare(R"(
+					UPDATE audit_partitions
+					SET event_count = MAX(event_count - :removed, 0)
+					WHERE week = :week
+				)");
+				query.bindValue(":removed", removed);
+				query.bindValue(":week", week);
+				query.exec();
+			}
+		}
 
-	qint64 cutoffTime = QDateTime::currentDateTime().addDays(-daysToKeep).toSecsSinceEpoch();
-
-	QSqlQuery query(*_db);
-	query.prepare("DELETE FROM audit_log WHERE timestamp < :cutoff");
-	query.bindValue(":cutoff", cutoffTime);
-
-	return query.exec();
+		result = db.commit();
+		if (!result) {
+			qWarning() << "MCP: Failed to purge audit events:" << db.lastError().text();
+			db.rollback();
+			loadPartitions(db);
+		}
+	});
+	return result;
 }
 
 qint64 AuditLogger::getEventCount() const {
-	if (!_db || !_db->isOpen()) {
+	if (!_pool || !_pool->isOpen()) {
 		return 0;
 	}
 
-	QSqlQuery query(*_db);
-	query.exec("SELECT COUNT(*) FROM audit_log");
+	QSqlQuery query(_pool->reader());
+	query.exec(R"(
+		SELECT COALESCE(SUM(event_count), 0)
+		FROM audit_partitions
+		WHERE dropped = 0
+	)");
 
 	if (query.next()) {
 		return query.value(0).toLongLong();
@@ -449,46 +695,353 @@ qint64 AuditLogger::getEventCount() const {
 }
 
 // Private helpers
-bool AuditLogger::storeEvent(const AuditEvent &event) {
-	// Add to in-memory buffer
-	_eventBuffer.append(event);
-	if (_eventBuffer.size() > MAX_BUFFER_SIZE) {
-		_eventBuffer.removeFirst();
+bool AuditLogger::storeEvent(AuditEvent event) {
+	if (!_isRunning || !_pool || !_pool->isOpen()) {
+		return false;
 	}
 
-	// Write to file if path is set
-	if (!_logFilePath.isEmpty()) {
-		writeToLogFile(event);
+	if (!_queue->push(std::move(event))) {
+		// The writer fell a whole ring behind, the event takes the slow
+		// path of its own job instead of being dropped.
+		_pool->write([=](QSqlDatabase &db) {
+			storeBatch(db, { event });
+		});
+		queueFlush();
+		return true;
 	}
+	if (_pending.fetch_add(1) + 1 >= kBatchSize) {
+		queueFlush();
+	}
+	return true;
+}
 
-	// Store in database
-	if (!_db || !_db->isOpen()) {
-		return false;
+void AuditLogger::queueFlush() {
+	if (_flushQueued.exchange(true)) {
+		return;
+	}
+	_pool->write([=](QSqlDatabase &db) {
+		drain(db);
+	});
+}
+
+void AuditLogger::drain(QSqlDatabase &db) {
+	// Cleared before popping, an event pushed after the last pop queues
+	// a drain of its own.
+	_flushQueued = false;
+
+	auto events = std::vector<AuditEvent>();
+	auto event = AuditEvent();
+	while (_queue->pop(event)) {
+		events.push_back(std::move(event));
+	}
+	if (events.empty()) {
+		return;
+	}
+	_pending.fetch_sub(int(events.size()));
+	storeBatch(db, events);
+}
+
+void AuditLogger::storeBatch(
+		QSqlDatabase &db,
+		const std::vector<AuditEvent> &events) {
+	writeToLogFile(events);
+
+	{
+		QMutexLocker lock(&_eventBufferMutex);
+		for (const auto &event : events) {
+			_eventBuffer.append(event);
+		}
+		const auto extra = _eventBuffer.size() - MAX_BUFFER_SIZE;
+		if (extra > 0) {
+			_eventBuffer.remove(0, extra);
+		}
+	}
+
+	const auto cutoff = QDateTime::currentSecsSinceEpoch()
+		- qint64(_retentionDays.load()) * kSecondsPerDay;
+	auto rolledOver = false;
+	auto stored = std::map<qint64, std::pair<qint64, qint64>>(); // count, id
+	auto stats = std::map<StatsKey, StatsRow>();
+
+	// One commit for the whole batch.
+	db.transaction();
+	QSqlQuery query(db);
+	auto queryWeek = std::optional<qint64>();
+	for (const auto &event : events) {
+		const auto timestamp = event.timestamp.toSecsSinceEpoch();
+		const auto week = WeekOf(timestamp);
+		if (queryWeek != week) {
+			rolledOver |= !_partitions.contains(week);
+			if (!ensurePartition(db, week)) {
+				continue;
+			}
+			query.prepare(QString(R"(
+				INSERT INTO %1 (id, %2) VALUES (
+					:id, :event_type, :event_subtype, :user_id, :tool_name,
+					:parameters, :result_status, :error_message, :duration_ms,
+					:timestamp, :metadata
+				)
+			)").arg(PartitionTable(week), kEventColumns));
+			queryWeek = week;
+		}
+
+		const auto eventType = eventTypeToString(event.eventType);
+		query.bindValue(":id", event.id);
+		query.bindValue(":event_type", eventType);
+		query.bindValue(":event_subtype", event.eventSubtype);
+		query.bindValue(":user_id", event.userId.isEmpty() ? QVariant() : event.userId);
+		query.bindValue(":tool_name", event.toolName.isEmpty() ? QVariant() : event.toolName);
+		query.bindValue(":parameters", QJsonDocument(event.parameters).toJson(QJsonDocument::Compact));
+		query.bindValue(":result_status", event.resultStatus.isEmpty() ? QVariant() : event.resultStatus);
+		query.bindValue(":error_message", event.errorMessage.isEmpty() ? QVariant() : event.errorMessage);
+		query.bindValue(":duration_ms", event.durationMs > 0 ? event.durationMs : QVariant());
+		query.bindValue(":timestamp", timestamp);
+		query.bindValue(":metadata", QJsonDocument(event.metadata).toJson(QJsonDocument::Compact));
+
+		if (!query.exec()) {
+			qWarning() << "MCP: Failed to store audit event:" << query.lastError().text();
+			continue;
+		}
+
+		auto &partition = stored[week];
+		++partition.first;
+		partition.second = std::max(partition.second, event.id);
+
+		auto &row = stats[{ week, eventType, event.toolName, event.userId }];
+		++row.events;
+		if (event.resultStatus == "failure") {
+			++row.failures;
+		}
+		if (event.durationMs > 0) {
+			row.durationTotal += event.durationMs;
+			++row.durationCount;
+		}
+	}
+
+	query.prepare(R"(
+		UPDATE audit_partitions
+		SET event_count = event_count + :count,
+			last_id = MAX(last_id, :last_id)
+		WHERE week = :week
+	)");
+	for (const auto &[week, partition] : stored) {
+		query.bindValue(":count", partition.first);
+		query.bindValue(":last_id", partition.second);
+		query.bindValue(":week", week);
+		query.exec();
 	}
 
-	QSqlQuery query(*_db);
 	query.prepare(R"(
-		INSERT INTO audit_log (
-			event_type, event_subtype, user_id, tool_name, parameters,
-			result_status, error_message, duration_ms, timestamp, metadata
+		INSERT INTO audit_stats (
+			week, event_type, tool_name, user_id,
+			event_count, failure_count, duration_total, duration_count
 		) VALUES (
-			:event_type, :event_subtype, :user_id, :tool_name, :parameters,
-			:result_status, :error_message, :duration_ms, :timestamp, :metadata
+			:week, :event_type, :tool_name, :user_id,
+			:events, :failures, :duration_total, :duration_count
 		)
+		ON CONFLICT(week, event_type, tool_name, user_id) DO UPDATE SET
+			event_count = event_count + excluded.event_count,
+			failure_count = failure_count + excluded.failure_count,
+			duration_total = duration_total + excluded.duration_total,
+			duration_count = duration_count + excluded.duration_count
+	)");
+	for (const auto &[key, row] : stats) {
+		query.bindValue(":week", std::get<0>(key));
+		query.bindValue(":event_type", std::get<1>(key));
+		query.bindValue(":tool_name", std::get<2>(key));
+		query.bindValue(":user_id", std::get<3>(key));
+		query.bindValue(":events", row.events);
+		query.bindValue(":failures", row.failures);
+		query.bindValue(":duration_total", row.durationTotal);
+		query.bindValue(":duration_count", row.durationCount);
+		if (!query.exec()) {
+			qWarning() << "MCP: Failed to update audit stats:" << query.lastError().text();
+		}
+	}
+
+	// A new week is the rollover point for retention.
+	if (rolledOver) {
+		dropPartitionsBefore(db, cutoff);
+	}
+
+	if (!db.commit()) {
+		qWarning() << "MCP: Failed to commit audit events:" << db.lastError().text();
+		db.rollback();
+		loadPartitions(db);
+	}
+}
+
+bool AuditLogger::initializeStorage(QSqlDatabase &db) {
+	QSqlQuery query(db);
+	if (!query.exec(kPartitionsTable) || !query.exec(kStatsTable)) {
+		qWarning() << "MCP: Failed to create audit tables:" << query.lastError().text();
+		return false;
+	}
+	loadPartitions(db);
+	if (!migrateLegacyTable(db)) {
+		return false;
+	}
+
+	if (query.exec("SELECT MAX(last_id) FROM audit_partitions") && query.next()) {
+		_nextEventId = std::max(
+			_nextEventId.load(),
+			query.value(0).toLongLong() + 1);
+	}
+
+	dropPartitionsBefore(
+		db,
+		QDateTime::currentSecsSinceEpoch()
+			- qint64(_retentionDays.load()) * kSecondsPerDay);
+	return true;
+}
+
+void AuditLogger::loadPartitions(QSqlDatabase &db) {
+	_partitions.clear();
+	QSqlQuery query(db);
+	if (!query.exec("SELECT week FROM audit_partitions WHERE dropped = 0")) {
+		qWarning() << "MCP: Failed to load audit partitions:" << query.lastError().text();
+		return;
+	}
+	while (query.next()) {
+		_partitions.insert(query.value(0).toLongLong());
+	}
+}
+
+// Moves rows of a single audit_log table, as schema.sql used to create
+// it, into the weekly partitions.
+bool AuditLogger::migrateLegacyTable(QSqlDatabase &db) {
+	QSqlQuery query(db);
+	if (!query.exec("SELECT 1 FROM sqlite_master "
+			"WHERE type = 'table' AND name = 'audit_log'")) {
+		return false;
+	} else if (!query.next()) {
+		return true;
+	}
+
+	auto weeks = QSet<qint64>();
+	if (!query.exec("SELECT DISTINCT timestamp / 86400 FROM audit_log")) {
+		qWarning() << "MCP: Failed to read audit_log:" << query.lastError().text();
+		return false;
+	}
+	while (query.next()) {
+		weeks.insert(WeekOf(query.value(0).toLongLong() * kSecondsPerDay));
+	}
+
+	db.transaction();
+	auto failed = false;
+	for (const auto week : weeks) {
+		if (!ensurePartition(db, week)) {
+			failed = true;
+			break;
+		}
+		const auto range = QString(
+			" FROM audit_log WHERE timestamp >= %1 AND timestamp < %2"
+		).arg(WeekStart(week)).arg(WeekEnd(week));
+		const auto ok = query.exec(QString("INSERT INTO %1 (id, %2) "
+				"SELECT id, %2").arg(PartitionTable(week), kEventColumns)
+				+ range)
+			&& query.exec(QString("INSERT INTO audit_stats (week, "
+				"event_type, tool_name, user_id, event_count, failure_count, "
+				"duration_total, duration_count) SELECT %1, %2").arg(
+					QString::number(week),
+					kStatsSelect)
+				+ range
+				+ " GROUP BY 1, 2, 3, 4"
+				" ON CONFLICT(week, event_type, tool_name, user_id) DO UPDATE"
+				" SET event_count = event_count + excluded.event_count,"
+				" failure_count = failure_count + excluded.failure_count,"
+				" duration_total = duration_total + excluded.duration_total,"
+				" duration_count = duration_count + excluded.duration_count")
+			&& query.exec(QString("UPDATE audit_partitions SET "
+				"event_count = event_count + (SELECT COUNT(*)%1), "
+				"last_id = MAX(last_id, (SELECT COALESCE(MAX(id), 0)%1)) "
+				"WHERE week = %2").arg(range).arg(week));
+		if (!ok) {
+			failed = true;
+			break;
+		}
+	}
+	if (failed
+		|| !query.exec("DROP TABLE audit_log")
+		|| !db.commit()) {
+		qWarning() << "MCP: Failed to migrate audit_log:" << query.lastError().text();
+		db.rollback();
+		loadPartitions(db);
+		return false;
+	}
+	return true;
+}
+
+bool AuditLogger::ensurePartition(QSqlDatabase &db, qint64 week) {
+	if (_partitions.contains(week)) {
+		return true;
+	}
+	QSqlQuery query(db);
+	for (const auto &sql : PartitionSchema(week)) {
+		if (!query.exec(sql)) {
+			qWarning() << "MCP: Failed to create audit partition:" << query.lastError().text();
+			return false;
+		}
+	}
+	query.prepare(R"(
+		INSERT INTO audit_partitions (week) VALUES (:week)
+		ON CONFLICT(week) DO UPDATE SET dropped = 0
 	)");
+	query.bindValue(":week", week);
+	if (!query.exec()) {
+		qWarning() << "MCP: Failed to register audit partition:" << query.lastError().text();
+		return false;
+	}
+	_partitions.insert(week);
+	return true;
+}
 
-	query.bindValue(":event_type", eventTypeToString(event.eventType));
-	query.bindValue(":event_subtype", event.eventSubtype);
-	query.bindValue(":user_id", event.userId.isEmpty() ? QVariant() : event.userId);
-	query.bindValue(":tool_name", event.toolName.isEmpty() ? QVariant() : event.toolName);
-	query.bindValue(":parameters", QJsonDocument(event.parameters).toJson(QJsonDocument::Compact));
-	query.bindValue(":result_status", event.resultStatus.isEmpty() ? QVariant() : event.resultStatus);
-	query.bindValue(":error_message", event.errorMessage.isEmpty() ? QVariant() : event.errorMessage);
-	query.bindValue(":duration_ms", event.durationMs > 0 ? event.durationMs : QVariant());
-	query.bindValue(":timestamp", event.timestamp.toSecsSinceEpoch());
-	query.bindValue(":metadata", QJsonDocument(event.metadata).toJson(QJsonDocument::Compact));
+// Drops every week ending before timestamp, its audit_stats rows and
+// catalog entry stay so statistics keep covering it.
+void AuditLogger::dropPartitionsBefore(QSqlDatabase &db, qint64 timestamp) {
+	const auto weeks = _partitions;
+	for (const auto week : weeks) {
+		if (WeekEnd(week) > timestamp) {
+			continue;
+		}
+		QSqlQuery query(db);
+		if (!query.exec("DROP TABLE IF EXISTS " + PartitionTable(week))) {
+			qWarning() << "MCP: Failed to drop audit partition:" << query.lastError().text();
+			continue;
+		}
+		query.prepare(R"(
+			UPDATE audit_partitions
+			SET event_count = 0, dropped = 1
+			WHERE week = :week
+		)");
+		query.bindValue(":week", week);
+		query.exec();
+		_partitions.remove(week);
+	}
+}
 
-	return query.exec();
+std::vector<qint64> AuditLogger::partitions(
+		const QDateTime &start,
+		const QDateTime &end) const {
+	auto result = std::vector<qint64>();
+	QSqlQuery query(_pool->reader());
+	query.prepare(R"(
+		SELECT week FROM audit_partitions
+		WHERE dropped = 0 AND week >= :first AND week <= :last
+		ORDER BY week DESC
+	)");
+	query.bindValue(
+		":first",
+		start.isValid() ? WeekOf(start.toSecsSinceEpoch()) : -kNoLimit);
+	query.bindValue(
+		":last",
+		end.isValid() ? WeekOf(end.toSecsSinceEpoch()) : kNoLimit);
+	if (query.exec()) {
+		while (query.next()) {
+			result.push_back(query.value(0).toLongLong());
+		}
+	}
+	return result;
 }
 
 AuditEvent AuditLogger::loadEventFromQuery(const QSqlQuery &query) const {
@@ -517,18 +1070,18 @@ AuditEvent AuditLogger::loadEventFromQuery(const QSqlQuery &query) const {
 	return event;
 }
 
-bool AuditLogger::writeToLogFile(const AuditEvent &event) {
-	QFile file(_logFilePath);
-	if (!file.open(QIODevice::Append | QIODevice::Text)) {
-		return false;
+void AuditLogger::writeToLogFile(const std::vector<AuditEvent> &events) {
+	if (!_logFile.isOpen()) {
+		return;
 	}
 
-	QTextStream out(&file);
-	QJsonDocument doc(exportEvent(event));
-	out << doc.toJson(QJsonDocument::Compact) << "\n";
-
-	file.close();
-	return true;
+	auto lines = QByteArray();
+	for (const auto &event : events) {
+		lines += QJsonDocument(exportEvent(event)).toJson(QJsonDocument::Compact);
+		lines += '\n';
+	}
+	_logFile.write(lines);
+	_logFile.flush();
 }
 
 QString AuditLogger::eventTypeToString(AuditEventType type) const {
@@ -3,15 +3,25 @@
 
 #pragma once
 
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
 #include <QtCore/QObject>
+#include <QtCore/QSet>
 #include <QtCore/QString>
+#include <QtCore/QTimer>
 #include <QtCore/QDateTime>
 #include <QtCore/QJsonObject>
 #include <QtCore/QJsonArray>
 #include <QtSql/QSqlDatabase>
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
 namespace MCP {
 
+class DatabasePool;
+
 // Event types
 enum class AuditEventType {
 	ToolInvoked,      // MCP tool called
@@ -37,6 +47,17 @@ struct AuditEvent {
 };
 
 // Audit logger
+//
+// Logging only pushes the event to a lock-free ring, the database writer
+// thread drains it in one transaction per batch and appends the batch to
+// a log file kept open between batches. Queries flush the ring first, so
+// they still see every event logged before them.
+//
+// Events are stored in one audit_log_<yyyyMMdd> table per week (starting
+// on Monday, UTC), listed in audit_partitions. Every insert also adds to
+// audit_stats, per week, event type, tool and user, so statistics read
+// whole weeks from there and scan only the partially covered ones. A
+// week past retention is dropped as a whole, its audit_stats rows stay.
 class AuditLogger : public QObject {
 	Q_OBJECT
 
@@ -45,10 +66,17 @@ public:
 	~AuditLogger();
 
 	// Initialization
-	bool start(QSqlDatabase *db, const QString &logFilePath = QString());
+	bool start(DatabasePool *pool, const QString &logFilePath = QString());
 	void stop();
 	[[nodiscard]] bool isRunning() const { return _isRunning; }
 
+	// Returns after every event logged so far is stored.
+	void flush();
+
+	// Weeks ending more than days ago are dropped when a new week starts.
+	void setRetentionDays(int days);
+	[[nodiscard]] int retentionDays() const { return _retentionDays; }
+
 	// Logging
 	void logToolInvoked(
 		const QString &toolName,
@@ -114,6 +142,7 @@ public:
 		int systemEvents;
 		int errors;
 		QMap<QString, int> toolCounts;  // tool -> count
+		QMap<QString, int> toolFailures;  // tool -> failed count
 		QMap<QString, int> userCounts;  // user -> count
 		double avgDuration;  // Average operation duration
 	};
@@ -140,24 +169,48 @@ Q_SIGNALS:
 	void error(const QString &errorMessage);
 
 private:
+	class Queue;
+
 	// Database operations
-	bool storeEvent(const AuditEvent &event);
+	bool storeEvent(AuditEvent event);
+	void queueFlush();
+	void drain(QSqlDatabase &db); // On the writer thread.
+	void storeBatch(QSqlDatabase &db, const std::vector<AuditEvent> &events);
+
+	// Partitions, all but partitions() on the writer thread.
+	bool initializeStorage(QSqlDatabase &db);
+	void loadPartitions(QSqlDatabase &db);
+	bool migrateLegacyTable(QSqlDatabase &db);
+	bool ensurePartition(QSqlDatabase &db, qint64 week);
+	void dropPartitionsBefore(QSqlDatabase &db, qint64 timestamp);
+	[[nodiscard]] std::vector<qint64> partitions( // Newest first.
+		const QDateTime &start,
+		const QDateTime &end) const;
 	AuditEvent loadEventFromQuery(const QSqlQuery &query) const;
 
 	// File logging
-	bool writeToLogFile(const AuditEvent &event);
+	void writeToLogFile(const std::vector<AuditEvent> &events);
 
 	// Helpers
 	QString eventTypeToString(AuditEventType type) const;
 	AuditEventType stringToEventType(const QString &str) const;
 
-	QSqlDatabase *_db = nullptr;
+	DatabasePool *_pool = nullptr;
 	QString _logFilePath;
-	bool _isRunning = false;
-	qint64 _nextEventId = 1;
+	std::atomic<bool> _isRunning = false;
+	std::atomic<qint64> _nextEventId = 1;
+	std::atomic<int> _retentionDays = 90;
+	QSet<qint64> _partitions; // Writer thread only.
+
+	std::unique_ptr<Queue> _queue;
+	std::atomic<int> _pending = 0;
+	std::atomic<bool> _flushQueued = false;
+	QTimer _flushTimer;
+	QFile _logFile; // Used by the writer thread while running.
 
 	// In-memory buffer for recent events (performance optimization)
 	static const int MAX_BUFFER_SIZE = 1000;
+	QMutex _eventBufferMutex;
 	QVector<AuditEvent> _eventBuffer;
 };
 
@@ -8,15 +8,45 @@
 #include "main/main_session.h"
 #include "apiwrap.h"
 #include "data/data_peer.h"
+#include "data/data_channel.h"
+#include "data/data_histories.h"
 #include "api/api_sending.h"
+#include "base/random.h"
+#include "window/window_peer_menu.h"
 
 #include <QtCore/QFile>
 #include <QtCore/QTextStream>
 #include <QtCore/QJsonDocument>
+#include <QtCore/QPointer>
+#include <QtCore/QRegularExpression>
 #include <QtCore/QTimer>
-#include <QtCore/QThread>
+
+#include <algorithm>
 
 namespace MCP {
+namespace {
+
+constexpr auto kMaxIdsPerCall = 100;
+constexpr auto kInitialWindow = 2;
+constexpr auto kMaxWindow = 8;
+
+[[nodiscard]] int FloodWaitSeconds(const QString &type) {
+	static const auto regexp = QRegularExpression(
+		"^FLOOD_(?:PREMIUM_)?WAIT_(\\d+)$");
+	const auto match = regexp.match(type);
+	return match.hasMatch() ? match.captured(1).toInt() : 0;
+}
+
+[[nodiscard]] QVector<MTPint> ToMTP(const QVector<qint64> &ids) {
+	auto result = QVector<MTPint>();
+	result.reserve(ids.size());
+	for (const auto id : ids) {
+		result.push_back(MTP_int(id));
+	}
+	return result;
+}
+
+} // namespace
 
 BatchOperations::BatchOperations(QObject *parent)
 : QObject(parent) {
@@ -37,10 +67,10 @@ bool BatchOperations::start(Main::Session *session) {
 
 	_session = session;
 
-	// Set up queue processing timer
+	// Lanes are pumped as calls finish, the timer only ends flood waits
 	_queueTimer = new QTimer(this);
+	_queueTimer->setSingleShot(true);
 	connect(_queueTimer, &QTimer::timeout, this, &BatchOperations::processOperationQueue);
-	_queueTimer->start(_queueProcessIntervalMs);
 
 	_isRunning = true;
 
@@ -58,6 +88,10 @@ void BatchOperations::stop() {
 		_queueTimer = nullptr;
 	}
 
+	// Calls in flight finish into nothing, their lanes are gone.
+	_lanes.clear();
+	_chunksLeft.clear();
+
 	_session = nullptr;
 	_isRunning = false;
 }
@@ -317,78 +351,83 @@ QJsonObject BatchOperations::getOperationStatistics() {
 // Private slots
 
 void BatchOperations::processOperationQueue() {
-	// Process pending operations up to max concurrent limit
-	for (auto &op : _operations) {
-		if (_currentConcurrentOperations >= _maxConcurrentOperations) {
-			break;
+	if (!_isRunning || !_session) {
+		return;
+	}
+	const auto now = QDateTime::currentMSecsSinceEpoch();
+	auto nextResume = qint64(0);
+	auto dropped = std::vector<Chunk>();
+	for (auto i = _lanes.begin(); i != _lanes.end(); ++i) {
+		const auto dcId = i.key();
+		auto &lane = i.value();
+		if (lane.resumeAt > now) {
+			nextResume = nextResume
+				? std::min(nextResume, lane.resumeAt)
+				: lane.resumeAt;
+			continue;
 		}
-
-		if (op.status == BatchStatus::Pending) {
-			// Start processing this operation
-			op.status = BatchStatus::Running;
-			op.startTime = QDateTime::currentDateTime();
-			_currentConcurrentOperations++;
-
-			// Actual processing is handled by execute* methods
+		lane.resumeAt = 0;
+		for (auto j = lane.queue.begin()
+			; j != lane.queue.end() && lane.inFlight < lane.window;) {
+			const auto operation = _operations.constFind(j->operationId);
+			if (operation == _operations.cend()
+				|| operation->status == BatchStatus::Cancelled) {
+				dropped.push_back(std::move(*j));
+				j = lane.queue.erase(j);
+				continue;
+			} else if (j->type == BatchOperationType::Forward
+				&& lane.busyPeers.contains(j->peerId)) {
+				++j;
+				continue;
+			}
+			const auto chunk = std::move(*j);
+			j = lane.queue.erase(j);
+			sendChunk(dcId, chunk);
 		}
 	}
+	if (nextResume && _queueTimer) {
+		_queueTimer->start(int(std::max(nextResume - now, qint64(0))));
+	}
+	// Finishing may start new operations, so only after the lanes loop.
+	for (const auto &chunk : dropped) {
+		chunkFinished(chunk, 0, 0);
+	}
 }
 
 // Private methods - Operation execution
 
 void BatchOperations::executeDeleteOperation(qint64 operationId, const BatchDeleteParams &params) {
-	auto &result = _operations[operationId];
-
-	int successful = 0;
-	int failed = 0;
-
-	for (qint64 messageId : params.messageIds) {
-		if (result.status == BatchStatus::Cancelled) {
-			break;
-		}
-
-		bool success = deleteMessage(params.chatId, messageId, params.deleteForAll);
-		if (success) {
-			successful++;
-		} else {
-			failed++;
-		}
-
-		result.processedItems++;
-		Q_EMIT operationProgress(operationId, result.processedItems, result.totalItems);
-
-		// Rate limiting
-		QThread::msleep(1000 / _operationsPerSecond);
+	startOperation(operationId);
+	if (!_session->data().peerLoaded(PeerId(params.chatId))) {
+		completeOperation(operationId, false, "Chat not found");
+		return;
 	}
 
-	completeOperation(operationId, failed == 0, failed > 0 ? "Some deletions failed" : QString());
+	auto chunk = Chunk();
+	chunk.operationId = operationId;
+	chunk.type = BatchOperationType::Delete;
+	chunk.peerId = params.chatId;
+	chunk.revoke = params.deleteForAll;
+	enqueueChunks(chunk, params.messageIds);
 }
 
 void BatchOperations::executeForwardOperation(qint64 operationId, const BatchForwardParams &params) {
-	auto &result = _operations[operationId];
-
-	int successful = 0;
-	int failed = 0;
-
-	for (qint64 messageId : params.messageIds) {
-		if (result.status == BatchStatus::Cancelled) {
-			break;
-		}
-
-		bool success = forwardMessage(params.sourceChatId, params.targetChatId, messageId, params);
-		if (success) {
-			successful++;
-		} else {
-			failed++;
-		}
-
-		result.processedItems++;
-		Q_EMIT operationProgress(operationId, result.processedItems, result.totalItems);
-
-		QThread::msleep(1000 / _operationsPerSecond);
+	startOperation(operationId);
+	if (!_session->data().peerLoaded(PeerId(params.sourceChatId))
+		|| !_session->data().peerLoaded(PeerId(params.targetChatId))) {
+		completeOperation(operationId, false, "Chat not found");
+		return;
 	}
 
-	completeOperation(operationId, failed == 0, failed > 0 ? "Some forwards failed" : QString());
+	auto chunk = Chunk();
+	chunk.operationId = operationId;
+	chunk.type = BatchOperationType::Forward;
+	chunk.peerId = params.targetChatId;
+	chunk.sourcePeerId = params.sourceChatId;
+	chunk.silent = params.silent;
+	chunk.dropAuthor = params.dropAuthor;
+	chunk.dropCaption = params.dropCaption;
+	enqueueChunks(chunk, params.messageIds);
 }
 
 void BatchOperations::executeExportOperation(qint64 operationId, const BatchExportParams &params) {
@@ -427,109 +466,33 @@ void BatchOperations::executeExportOperation(qint64 operationId, const BatchExpo
 }
 
 void BatchOperations::executeMarkReadOperation(qint64 operationId, const BatchMarkReadParams &params) {
+	if (!_session) {
+		completeOperation(operationId, false, "Session not available");
+		return;
+	}
 	auto &result = _operations[operationId];
-
-	int successful = 0;
 	int failed = 0;
 
-	for (qint64 chatId : params.chatIds) {
-		if (result.status == BatchStatus::Cancelled) {
-			break;
+	// One batch for all the chats: the unread counters are updated once
+	// and Data::Histories keeps a window of read requests in flight.
+	_session->data().histories().readInboxBatch([&] {
+		for (qint64 chatId : params.chatIds) {
+			if (result.status == BatchStatus::Cancelled) {
+				break;
+			}
+			if (!markChatAsRead(chatId, params.markAsRead)) {
+				failed++;
+			}
+			result.processedItems++;
 		}
-
-		bool success = markChatAsRead(chatId);
-		if (success) {
-			successful++;
-		} else {
-			failed++;
-		}
-
-		result.processedItems++;
-		Q_EMIT operationProgress(operationId, result.processedItems, result.totalItems);
-
-		QThread::msleep(1000 / _operationsPerSecond);
-	}
+	});
+	Q_EMIT operationProgress(operationId, result.processedItems, result.totalItems);
 
 	completeOperation(operationId, failed == 0, failed > 0 ? "Some mark-reads failed" : QString());
 }
 
 // Helper methods
 
-bool BatchOperations::deleteMessage(qint64 chatId, qint64 messageId, bool deleteForAll) {
-	if (!_session) {
-		qWarning() << "BatchOperations: Session not available";
-		return false;
-	}
-
-	auto peer = _session->data().peer(PeerId(chatId));
-	if (!peer) {
-		qWarning() << "BatchOperations: Invalid peer ID" << chatId;
-		return false;
-	}
-
-	auto history = _session->data().history(peer);
-	if (!history) {
-		qWarning() << "BatchOperations: History not found";
-		return false;
-	}
-
-	// Find the message
-	auto item = history->owner().message(peer->id, MsgId(messageId));
-	if (!item) {
-		qWarning() << "BatchOperations: Message not found" << messageId;
-		return false;
-	}
-
-	// TODO: Implement deleteMessages with correct tdesktop API
-	// canDeleteForEveryone expects TimeId (int32), not QDateTime
-	// ApiWrap::deleteMessages doesn't exist with this signature
-	qWarning() << "TODO: Implement deleteMessages with correct tdesktop API";
-	qDebug() << "BatchOperations: Stub - message not actually deleted" << messageId << "from chat" << chatId;
-	return false;
-}
-
-bool BatchOperations::forwardMessage(
-	qint64 sourceChatId,
-	qint64 targetChatId,
-	qint64 messageId,
-	const BatchForwardParams &params
-) {
-	if (!_session) {
-		qWarning() << "BatchOperations: Session not available";
-		return false;
-	}
-
-	auto sourcePeer = _session->data().peer(PeerId(sourceChatId));
-	auto targetPeer = _session->data().peer(PeerId(targetChatId));
-
-	if (!sourcePeer || !targetPeer) {
-		qWarning() << "BatchOperations: Invalid peer IDs";
-		return false;
-	}
-
-	auto sourceHistory = _session->data().history(sourcePeer);
-	auto targetHistory = _session->data().history(targetPeer);
-
-	if (!sourceHistory || !targetHistory) {
-		qWarning() << "BatchOperations: History not found";
-		return false;
-	}
-
-	// Find the message
-	auto item = sourceHistory->owner().message(sourcePeer->id, MsgId(messageId));
-	if (!item) {
-		qWarning() << "BatchOperations: Message not found" << messageId;
-		return false;
-	}
-
-	// TODO: Implement forwardMessages with correct tdesktop API
-	// Api::SendOptions doesn't have dropAuthor or dropCaption members
-	// forwardMessages expects HistoryItemsList, not FullMsgId directly
-	qWarning() << "TODO: Implement forwardMessages with correct tdesktop API";
-	qDebug() << "BatchOperations: Stub - message not actually forwarded" << messageId << "from" << sourceChatId << "to" << targetChatId;
-	return false;
-}
-
 bool BatchOperations::exportMessage(qint64 chatId, qint64 messageId, const QString &format, QTextStream &stream) {
 	if (!_session) {
 		qWarning() << "BatchOperations: Session not available";
@@ -588,29 +551,229 @@ bool BatchOperations::exportMessage(qint64 chatId, qint64 messageId, const QStri
 	return true;
 }
 
-bool BatchOperations::markChatAsRead(qint64 chatId) {
+bool BatchOperations::markChatAsRead(qint64 chatId, bool read) {
 	if (!_session) {
 		qWarning() << "BatchOperations: Session not available";
 		return false;
 	}
 
-	auto peer = _session->data().peer(PeerId(chatId));
+	auto peer = _session->data().peerLoaded(PeerId(chatId));
 	if (!peer) {
 		qWarning() << "BatchOperations: Invalid peer ID" << chatId;
 		return false;
 	}
 
-	auto history = _session->data().history(peer);
-	if (!history) {
-		qWarning() << "BatchOperations: History not found";
-		return false;
+	const auto history = _session->data().history(peer);
+	if (read) {
+		Window::MarkAsReadThread(history);
+	} else if (!history->unreadMark()) {
+		history->owner().histories().changeDialogUnreadMark(history, true);
 	}
+	return true;
+}
 
-	// TODO: Implement readInbox with correct tdesktop API
-	// ApiWrap::readInbox doesn't exist with this signature
-	qWarning() << "TODO: Implement readInbox with correct tdesktop API";
-	qDebug() << "BatchOperations: Stub - chat not actually marked as read" << chatId;
-	return false;
+// Pipelined sender
+
+void BatchOperations::startOperation(qint64 operationId) {
+	auto &result = _operations[operationId];
+	result.status = BatchStatus::Running;
+	result.startTime = QDateTime::currentDateTime();
+	_currentConcurrentOperations++;
+}
+
+void BatchOperations::enqueueChunks(const Chunk &prototype, QVector<qint64> ids) {
+	// Sorted and unique, forwards arrive in order and no call repeats an id.
+	std::sort(ids.begin(), ids.end());
+	ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+	ids.erase(
+		ids.begin(),
+		std::upper_bound(ids.begin(), ids.end(), qint64(0)));
+	_operations[prototype.operationId].totalItems = int(ids.size());
+	if (ids.isEmpty()) {
+		completeOperation(prototype.operationId, true);
+		return;
+	}
+
+	// Every call of a user session goes to its main DC.
+	auto &lane = _lanes[_session->mainDcId()];
+	if (!lane.window) {
+		lane.window = kInitialWindow;
+	}
+	auto &left = _chunksLeft[prototype.operationId];
+	for (auto i = 0; i < ids.size(); i += kMaxIdsPerCall) {
+		auto chunk = prototype;
+		chunk.ids = ids.mid(i, kMaxIdsPerCall);
+		lane.queue.push_back(std::move(chunk));
+		++left;
+	}
+	processOperationQueue();
+}
+
+void BatchOperations::sendChunk(int dcId, const Chunk &chunk) {
+	auto &lane = _lanes[dcId];
+	++lane.inFlight;
+	if (chunk.type == BatchOperationType::Forward) {
+		lane.busyPeers.insert(chunk.peerId);
+		sendForwardChunk(dcId, chunk);
+	} else {
+		sendDeleteChunk(dcId, chunk);
+	}
+}
+
+void BatchOperations::sendDeleteChunk(int dcId, const Chunk &chunk) {
+	const auto session = _session;
+	const auto peer = session->data().peer(PeerId(chunk.peerId));
+	const auto history = session->data().history(peer);
+	const auto ids = ToMTP(chunk.ids);
+	const auto weak = QPointer<BatchOperations>(this);
+	const auto type = Data::Histories::RequestType::Delete;
+	session->data().histories().sendRequest(history, type, [=](
+			Fn<void()> finish) {
+		const auto done = [=](const MTPmessages_AffectedMessages &result) {
+			finish();
+			session->api().applyAffectedMessages(peer, result);
+			for (const auto id : chunk.ids) {
+				if (const auto item = session->data().message(peer->id, MsgId(id))) {
+					item->destroy();
+				}
+			}
+			history->requestChatListMessage();
+			if (weak) {
+				weak->chunkDone(dcId, chunk);
+			}
+		};
+		const auto fail = [=](const MTP::Error &error) {
+			finish();
+			if (weak) {
+				weak->chunkFailed(dcId, chunk, error.type());
+			}
+		};
+		if (const auto channel = peer->asChannel()) {
+			return session->api().request(MTPchannels_DeleteMessages(
+				channel->inputChannel,
+				MTP_vector<MTPint>(ids)
+			)).done(done).fail(fail).handleFloodErrors().send();
+		}
+		using Flag = MTPmessages_DeleteMessages::Flag;
+		return session->api().request(MTPmessages_DeleteMessages(
+			MTP_flags(chunk.revoke ? Flag::f_revoke : Flag(0)),
+			MTP_vector<MTPint>(ids)
+		)).done(done).fail(fail).handleFloodErrors().send();
+	});
+}
+
+void BatchOperations::sendForwardChunk(int dcId, const Chunk &chunk) {
+	const auto session = _session;
+	const auto from = session->data().peer(PeerId(chunk.sourcePeerId));
+	const auto to = session->data().peer(PeerId(chunk.peerId));
+	auto randomIds = QVector<MTPlong>();
+	randomIds.reserve(chunk.ids.size());
+	for (auto i = 0; i != chunk.ids.size(); ++i) {
+		randomIds.push_back(MTP_long(base::RandomValue<uint64>()));
+	}
+	const auto weak = QPointer<BatchOperations>(this);
+
+	using Flag = MTPmessages_ForwardMessages::Flag;
+	const auto flags = Flag(0)
+		| (chunk.silent ? Flag::f_silent : Flag(0))
+		| (chunk.dropAuthor ? Flag::f_drop_author : Flag(0))
+		| (chunk.dropCaption ? Flag::f_drop_media_captions : Flag(0));
+	session->api().request(MTPmessages_ForwardMessages(
+		MTP_flags(flags),
+		from->input,
+		MTP_vector<MTPint>(ToMTP(chunk.ids)),
+		MTP_vector<MTPlong>(randomIds),
+		to->input,
+		MTP_int(0), // top_msg_id
+		MTPInputReplyTo(),
+		MTP_int(0), // schedule_date
+		MTP_int(0), // schedule_repeat_period
+		MTP_inputPeerEmpty(), // send_as
+		MTPInputQuickReplyShortcut(),
+		MTP_int(0), // video_timestamp
+		MTP_long(0), // allow_paid_stars
+		MTPSuggestedPost()
+	)).done([=](const MTPUpdates &result) {
+		session->api().applyUpdates(result);
+		if (weak) {
+			weak->chunkDone(dcId, chunk);
+		}
+	}).fail([=](const MTP::Error &error) {
+		if (weak) {
+			weak->chunkFailed(dcId, chunk, error.type());
+		}
+	}).handleFloodErrors().send();
+}
+
+void BatchOperations::chunkDone(int dcId, const Chunk &chunk) {
+	const auto i = _lanes.find(dcId);
+	if (i == _lanes.end()) {
+		return; // Stopped while the call was in flight.
+	}
+	auto &lane = i.value();
+	lane.inFlight = std::max(lane.inFlight - 1, 0);
+	lane.busyPeers.remove(chunk.peerId);
+	if (++lane.successes >= lane.window && lane.window < kMaxWindow) {
+		++lane.window;
+		lane.successes = 0;
+	}
+	chunkFinished(chunk, int(chunk.ids.size()), 0);
+	processOperationQueue();
+}
+
+void BatchOperations::chunkFailed(int dcId, const Chunk &chunk, const QString &type) {
+	const auto i = _lanes.find(dcId);
+	if (i == _lanes.end()) {
+		return;
+	}
+	auto &lane = i.value();
+	lane.inFlight = std::max(lane.inFlight - 1, 0);
+	lane.busyPeers.remove(chunk.peerId);
+	if (const auto seconds = FloodWaitSeconds(type)) {
+		// The chunk goes first again, forwards to its chat keep their order.
+		qWarning() << "MCP: Batch flood wait" << seconds << "s on DC" << dcId;
+		lane.window = std::max(lane.window / 2, 1);
+		lane.successes = 0;
+		lane.resumeAt = std::max(
+			lane.resumeAt,
+			QDateTime::currentMSecsSinceEpoch() + seconds * 1000LL + 1000);
+		lane.queue.push_front(chunk);
+	} else {
+		qWarning() << "MCP: Batch call failed:" << type;
+		auto &result = _operations[chunk.operationId];
+		result.details["lastError"] = type;
+		chunkFinished(chunk, 0, int(chunk.ids.size()));
+	}
+	processOperationQueue();
+}
+
+void BatchOperations::chunkFinished(const Chunk &chunk, int successful, int failed) {
+	const auto operationId = chunk.operationId;
+	const auto left = _chunksLeft.find(operationId);
+	if (left == _chunksLeft.end() || !_operations.contains(operationId)) {
+		return;
+	}
+	auto &result = _operations[operationId];
+	result.processedItems += successful + failed;
+	result.successfulItems += successful;
+	result.failedItems += failed;
+	if (successful || failed) {
+		Q_EMIT operationProgress(operationId, result.processedItems, result.totalItems);
+	}
+	if (--left.value() > 0) {
+		return;
+	}
+	_chunksLeft.erase(left);
+	if (result.status == BatchStatus::Cancelled) {
+		_currentConcurrentOperations--;
+		return;
+	}
+	const auto error = !result.failedItems
+		? QString()
+		: (chunk.type == BatchOperationType::Forward)
+		? QString("Some forwards failed")
+		: QString("Some deletions failed");
+	completeOperation(operationId, error.isEmpty(), error);
 }
 
 // Message filtering
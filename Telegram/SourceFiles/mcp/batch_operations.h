@@ -9,6 +9,8 @@
 #include <QtCore/QJsonArray>
 #include <QtCore/QVector>
 #include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <deque>
 #include <memory>
 
 namespace Main {
@@ -84,6 +86,11 @@ struct BatchMarkReadParams {
 };
 
 // Batch operations class
+//
+// Deletes and forwards are coalesced into calls of up to 100 ids each and
+// sent through a lane per DC, which keeps a window of calls in flight.
+// The window grows by one after a window's worth of successes and halves
+// on FLOOD_WAIT, which also holds the lane until the wait is over.
 class BatchOperations : public QObject {
 	Q_OBJECT
 
@@ -162,15 +169,37 @@ private:
 	void executeMarkReadOperation(qint64 operationId, const BatchMarkReadParams &params);
 
 	// Helper methods
-	bool deleteMessage(qint64 chatId, qint64 messageId, bool deleteForAll);
-	bool forwardMessage(
-		qint64 sourceChatId,
-		qint64 targetChatId,
-		qint64 messageId,
-		const BatchForwardParams &params
-	);
 	bool exportMessage(qint64 chatId, qint64 messageId, const QString &format, QTextStream &stream);
-	bool markChatAsRead(qint64 chatId);
+	bool markChatAsRead(qint64 chatId, bool read);
+
+	// Pipelined sender
+	struct Chunk {
+		qint64 operationId = 0;
+		BatchOperationType type = BatchOperationType::Delete;
+		qint64 peerId = 0; // Chat of a delete, target of a forward.
+		qint64 sourcePeerId = 0;
+		QVector<qint64> ids;
+		bool revoke = false;
+		bool silent = false;
+		bool dropAuthor = false;
+		bool dropCaption = false;
+	};
+	struct Lane {
+		std::deque<Chunk> queue;
+		QSet<qint64> busyPeers; // Forwards to a chat go one call at a time.
+		int inFlight = 0;
+		int window = 0;
+		int successes = 0; // Since the window last changed.
+		qint64 resumeAt = 0; // ms, end of a flood wait.
+	};
+	void startOperation(qint64 operationId);
+	void enqueueChunks(const Chunk &prototype, QVector<qint64> ids);
+	void sendChunk(int dcId, const Chunk &chunk);
+	void sendDeleteChunk(int dcId, const Chunk &chunk);
+	void sendForwardChunk(int dcId, const Chunk &chunk);
+	void chunkDone(int dcId, const Chunk &chunk);
+	void chunkFailed(int dcId, const Chunk &chunk, const QString &type);
+	void chunkFinished(const Chunk &chunk, int successful, int failed);
 
 	// Message filtering
 	QVector<qint64> filterMessagesByDate(
@@ -200,8 +229,9 @@ private:
 	qint64 _nextOperationId = 1;
 
 	// Queue management
-	QTimer *_queueTimer = nullptr;
-	int _queueProcessIntervalMs = 100;
+	QTimer *_queueTimer = nullptr; // Resumes lanes after a flood wait.
+	QHash<int, Lane> _lanes; // By DC id.
+	QHash<qint64, int> _chunksLeft; // By operation id.
 	int _maxConcurrentOperations = 3;
 	int _currentConcurrentOperations = 0;
 
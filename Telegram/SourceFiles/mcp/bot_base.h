@@ -13,6 +13,8 @@
 #include <QtCore/QDateTime>
 #include <QtCore/QMap>
 
+#include <atomic>
+
 namespace MCP {
 
 // Forward declarations
@@ -23,6 +25,7 @@ class MessageScheduler;
 class AuditLogger;
 class RBAC;
 class BotManager;
+class ContextBuilder;
 
 // Message structure
 struct Message {
@@ -43,6 +46,18 @@ class BotBase : public QObject {
 	Q_OBJECT
 
 public:
+	// Events a bot wants to see. An empty list does not filter, so a
+	// default subscription gets everything. A message passes when its
+	// chat and sender are listed and its text starts with one of the
+	// command prefixes or contains one of the keywords (case-insensitive).
+	// Events without a chat, sender or text skip that check.
+	struct Subscription {
+		QVector<qint64> chatIds;
+		QVector<qint64> userIds;
+		QStringList commandPrefixes;
+		QStringList keywords;
+	};
+
 	// Bot metadata
 	struct BotInfo {
 		QString id;              // Unique identifier (e.g., "context_assistant")
@@ -52,6 +67,7 @@ public:
 		QString author;          // Author/organization
 		QStringList tags;        // Categorization tags
 		bool isPremium;          // Requires paid tier
+		Subscription subscription;
 	};
 
 	// Constructor/Destructor
@@ -95,6 +111,9 @@ protected:
 	AuditLogger *auditLogger() const { return _auditLogger; }
 	RBAC *rbac() const { return _rbac; }
 
+	// Kept windows of active chats, null without a session.
+	ContextBuilder *contextBuilder() const { return _contextBuilder; }
+
 	// Utility methods
 	void sendMessage(qint64 chatId, const QString &text);
 	void editMessage(qint64 chatId, qint64 messageId, const QString &newText);
@@ -140,6 +159,7 @@ private:
 	MessageScheduler *_scheduler = nullptr;
 	AuditLogger *_auditLogger = nullptr;
 	RBAC *_rbac = nullptr;
+	std::atomic<ContextBuilder*> _contextBuilder = nullptr;
 
 	// State
 	bool _isRunning = false;
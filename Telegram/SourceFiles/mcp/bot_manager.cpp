@@ -18,7 +18,17 @@
 #include <QtCore/QMutexLocker>
 #include <QtCore/QElapsedTimer>
 
+#include <algorithm>
+#include <numeric>
+
 namespace MCP {
+namespace {
+
+constexpr auto kDefaultMailboxCapacity = 256;
+constexpr auto kMaxMailboxCapacity = 65536;
+constexpr auto kDefaultTimeBudgetMs = qint64(50);
+
+} // namespace
 
 BotManager::BotManager(QObject *parent)
 	: QObject(parent) {
@@ -27,6 +37,10 @@ BotManager::BotManager(QObject *parent)
 	_performanceTimer = new QTimer(this);
 	_performanceTimer->setInterval(PERFORMANCE_CHECK_INTERVAL_MS);
 	connect(_performanceTimer, &QTimer::timeout, this, &BotManager::onPerformanceCheckTimer);
+
+	_dispatchPool = std::make_unique<QThreadPool>();
+	_dispatchPool->setMaxThreadCount(_maxConcurrentBots);
+	_dispatchPool->setObjectName("mcp_bot_dispatch");
 }
 
 BotManager::~BotManager() {
@@ -72,6 +86,15 @@ void BotManager::initialize(
 	}
 }
 
+void BotManager::setContextBuilder(ContextBuilder *builder) {
+	QMutexLocker locker(&_mutex);
+
+	_contextBuilder = builder;
+	for (const auto bot : std::as_const(_bots)) {
+		bot->_contextBuilder = builder;
+	}
+}
+
 void BotManager::shutdown() {
 	QMutexLocker locker(&_mutex);
 
@@ -84,6 +107,16 @@ void BotManager::shutdown() {
 	// Stop performance timer
 	_performanceTimer->stop();
 
+	// Pending events are dropped, the ones being handled are waited for.
+	for (auto i = _mailboxes.begin(); i != _mailboxes.end(); ++i) {
+		i->events.clear();
+	}
+	locker.unlock();
+	_dispatchPool->clear();
+	_dispatchPool->waitForDone();
+	locker.relock();
+	_mailboxes.clear();
+
 	// Save all configurations
 	saveAllConfigs();
 
@@ -98,6 +131,7 @@ void BotManager::shutdown() {
 
 	// Clear registry
 	_bots.clear();
+	_routesDirty = true;
 	_stats.clear();
 	_configs.clear();
 
@@ -127,14 +161,9 @@ bool BotManager::registerBot(BotBase *bot) {
 		return false;
 	}
 
-	// Check if we've reached max concurrent bots
-	if (_bots.size() >= _maxConcurrentBots) {
-		qWarning() << "[BotManager] Max concurrent bots reached:" << _maxConcurrentBots;
-		return false;
-	}
-
 	// Add to registry
 	_bots.insert(botInfo.id, bot);
+	_routesDirty = true;
 
 	// Initialize statistics
 	BotStats stats;
@@ -149,6 +178,7 @@ bool BotManager::registerBot(BotBase *bot) {
 		_configs.insert(botInfo.id, defaultCfg);
 		bot->setConfig(defaultCfg);
 	}
+	applyMailboxConfigLocked(botInfo.id, bot->config());
 
 	// Connect signals
 	connect(bot, &BotBase::configChanged, this, &BotManager::onBotConfigChanged);
@@ -180,6 +210,8 @@ bool BotManager::unregisterBot(const QString &botId) {
 
 	BotBase *bot = _bots.value(botId);
 
+	closeMailboxLocked(botId);
+
 	// Stop bot if running
 	if (bot->isRunning()) {
 		shutdownBot(bot);
@@ -189,11 +221,13 @@ bool BotManager::unregisterBot(const QString &botId) {
 	disconnect(bot, nullptr, this, nullptr);
 
 	// Save final config
-	saveBotConfig(botId, bot->config());
+	_configs.insert(botId, bot->config());
 
 	// Remove from registry
 	_bots.remove(botId);
 	_stats.remove(botId);
+	_mailboxes.remove(botId);
+	_routesDirty = true;
 
 	qInfo() << "[BotManager] Unregistered bot:" << botId;
 
@@ -261,6 +295,7 @@ bool BotManager::stopBot(const QString &botId) {
 		return false;
 	}
 
+	closeMailboxLocked(botId);
 	shutdownBot(bot);
 
 	qInfo() << "[BotManager] Stopped bot:" << botId;
@@ -290,7 +325,7 @@ bool BotManager::restartBot(const QString &botId) {
 bool BotManager::enableBot(const QString &botId) {
 	QMutexLocker locker(&_mutex);
 
-	auto *bot = getBot(botId);
+	auto *bot = _bots.value(botId, nullptr);
 	if (!bot) {
 		qWarning() << "[BotManager] Cannot enable: bot not found:" << botId;
 		return false;
@@ -304,7 +339,7 @@ bool BotManager::enableBot(const QString &botId) {
 bool BotManager::disableBot(const QString &botId) {
 	QMutexLocker locker(&_mutex);
 
-	auto *bot = getBot(botId);
+	auto *bot = _bots.value(botId, nullptr);
 	if (!bot) {
 		qWarning() << "[BotManager] Cannot disable: bot not found:" << botId;
 		return false;
@@ -372,9 +407,14 @@ bool BotManager::saveBotConfig(const QString &botId, const QJsonObject &config)
 	QMutexLocker locker(&_mutex);
 
 	_configs.insert(botId, config);
+	applyMailboxConfigLocked(botId, config);
+	_routesDirty = true;
+	BotBase *bot = _bots.value(botId, nullptr);
 
-	if (_bots.contains(botId)) {
-		_bots.value(botId)->setConfig(config);
+	// configChanged() comes back to onBotConfigChanged() right away.
+	locker.unlock();
+	if (bot) {
+		bot->setConfig(config);
 	}
 
 	// TODO: Persist to database
@@ -404,36 +444,12 @@ void BotManager::dispatchMessage(const Message &msg) {
 	if (!_eventDispatchEnabled) {
 		return;
 	}
-
-	QMutexLocker locker(&_mutex);
-
-	QVector<BotBase*> runningBots = getRunningBots();
-	int dispatchCount = 0;
-
-	for (BotBase *bot : runningBots) {
-		if (!bot->isEnabled()) {
-			continue;
-		}
-
-		QElapsedTimer timer;
-		timer.start();
-
-		try {
-			bot->onMessage(msg);
-			dispatchCount++;
-
-			qint64 elapsed = timer.elapsed();
-			updateStats(bot->info().id, elapsed, false);
-
-		} catch (const std::exception &e) {
-			qCritical() << "[BotManager] Bot crashed on message:" << bot->info().id << e.what();
-			updateStats(bot->info().id, timer.elapsed(), true);
-			Q_EMIT botError(bot->info().id, QString("Crash: %1").arg(e.what()));
-		}
-	}
-
-	if (dispatchCount > 0) {
-		Q_EMIT eventDispatched("message", dispatchCount);
+	const auto route = EventRoute{ msg.chatId, msg.userId, &msg.text };
+	const auto count = post("message", QString(), route, [=](BotBase *bot) {
+		bot->onMessage(msg);
+	});
+	if (count > 0) {
+		Q_EMIT eventDispatched("message", count);
 	}
 }
 
@@ -441,149 +457,340 @@ void BotManager::dispatchMessageEdited(const Message &oldMsg, const Message &new
 	if (!_eventDispatchEnabled) {
 		return;
 	}
-
-	QMutexLocker locker(&_mutex);
-
-	for (BotBase *bot : getRunningBots()) {
-		if (bot->isEnabled()) {
-			try {
-				bot->onMessageEdited(oldMsg, newMsg);
-			} catch (const std::exception &e) {
-				qCritical() << "[BotManager] Bot crashed:" << bot->info().id << e.what();
-			}
-		}
-	}
-
-	Q_EMIT eventDispatched("message_edited", getRunningBots().size());
+	const auto key = QString("edit:%1:%2").arg(newMsg.chatId).arg(newMsg.id);
+	const auto route = EventRoute{ newMsg.chatId, newMsg.userId, &newMsg.text };
+	Q_EMIT eventDispatched("message_edited", post("message_edited", key, route, [=](BotBase *bot) {
+		bot->onMessageEdited(oldMsg, newMsg);
+	}));
 }
 
 void BotManager::dispatchMessageDeleted(qint64 messageId, qint64 chatId) {
 	if (!_eventDispatchEnabled) {
 		return;
 	}
+	Q_EMIT eventDispatched("message_deleted", post("message_deleted", QString(), { chatId }, [=](BotBase *bot) {
+		bot->onMessageDeleted(messageId, chatId);
+	}));
+}
 
-	QMutexLocker locker(&_mutex);
-
-	for (BotBase *bot : getRunningBots()) {
-		if (bot->isEnabled()) {
-			try {
-				bot->onMessageDeleted(messageId, chatId);
-			} catch (const std::exception &e) {
-				qCritical() << "[BotManager] Bot crashed:" << bot->info().id << e.what();
-			}
-		}
+void BotManager::dispatchChatJoined(qint64 chatId) {
+	if (!_eventDispatchEnabled) {
+		return;
 	}
+	Q_EMIT eventDispatched("chat_joined", post("chat_joined", QString(), { chatId }, [=](BotBase *bot) {
+		bot->onChatJoined(chatId);
+	}));
+}
 
-	Q_EMIT eventDispatched("message_deleted", getRunningBots().size());
+void BotManager::dispatchChatLeft(qint64 chatId) {
+	if (!_eventDispatchEnabled) {
+		return;
+	}
+	Q_EMIT eventDispatched("chat_left", post("chat_left", QString(), { chatId }, [=](BotBase *bot) {
+		bot->onChatLeft(chatId);
+	}));
 }
 
-void BotManager::dispatchChatJoined(qint64 chatId) {
+void BotManager::dispatchUserStatusChanged(qint64 userId, const QString &status) {
 	if (!_eventDispatchEnabled) {
 		return;
 	}
+	const auto key = QString("status:%1").arg(userId);
+	Q_EMIT eventDispatched("user_status_changed", post("user_status_changed", key, { 0, userId }, [=](BotBase *bot) {
+		bot->onUserStatusChanged(userId, status);
+	}));
+}
 
+void BotManager::dispatchCommand(const QString &botId, const QString &cmd, const QJsonObject &args) {
 	QMutexLocker locker(&_mutex);
 
-	for (BotBase *bot : getRunningBots()) {
-		if (bot->isEnabled()) {
-			try {
-				bot->onChatJoined(chatId);
-			} catch (const std::exception &e) {
-				qCritical() << "[BotManager] Bot crashed:" << bot->info().id << e.what();
-			}
-		}
+	if (!_bots.contains(botId)) {
+		qWarning() << "[BotManager] Cannot dispatch command to unregistered bot:" << botId;
+		return;
 	}
 
-	Q_EMIT eventDispatched("chat_joined", getRunningBots().size());
-}
+	BotBase *bot = _bots.value(botId);
 
-void BotManager::dispatchChatLeft(qint64 chatId) {
-	if (!_eventDispatchEnabled) {
+	if (!bot->isRunning() || !bot->isEnabled()) {
+		qWarning() << "[BotManager] Cannot dispatch command to inactive bot:" << botId;
 		return;
 	}
 
+	auto event = MailboxEvent();
+	event.type = "command";
+	event.deliver = [=](BotBase *target) {
+		target->onCommand(cmd, args);
+	};
+	event.essential = true;
+	enqueueLocked(botId, std::move(event));
+
+	locker.unlock();
+	Q_EMIT eventDispatched("command", 1);
+}
+
+int BotManager::post(
+		const QString &type,
+		const QString &coalesceKey,
+		const EventRoute &route,
+		std::function<void(BotBase*)> deliver) {
 	QMutexLocker locker(&_mutex);
 
-	for (BotBase *bot : getRunningBots()) {
-		if (bot->isEnabled()) {
-			try {
-				bot->onChatLeft(chatId);
-			} catch (const std::exception &e) {
-				qCritical() << "[BotManager] Bot crashed:" << bot->info().id << e.what();
-			}
+	auto count = 0;
+	for (const auto &botId : routeLocked(route)) {
+		const auto bot = _bots.value(botId, nullptr);
+		if (!bot || !bot->isRunning() || !bot->isEnabled()) {
+			continue;
+		}
+		auto event = MailboxEvent();
+		event.type = type;
+		event.coalesceKey = coalesceKey;
+		event.deliver = deliver;
+		if (enqueueLocked(botId, std::move(event))) {
+			++count;
 		}
 	}
+	return count;
+}
 
-	Q_EMIT eventDispatched("chat_left", getRunningBots().size());
+void BotManager::rebuildRoutesLocked() {
+	_routesDirty = false;
+	_routes = RouteIndex();
+	for (auto i = _bots.constBegin(); i != _bots.constEnd(); ++i) {
+		if (!i.value()) {
+			continue;
+		}
+		const auto subscription = i.value()->info().subscription;
+		const auto slot = int(_routes.botIds.size());
+		_routes.botIds.push_back(i.key());
+
+		if (subscription.chatIds.isEmpty()) {
+			_routes.anyChat.push_back(slot);
+		} else {
+			for (const auto chatId : QSet<qint64>(
+					subscription.chatIds.begin(),
+					subscription.chatIds.end())) {
+				_routes.byChat[chatId].push_back(slot);
+			}
+		}
+		_routes.users.emplace_back(
+			subscription.userIds.begin(),
+			subscription.userIds.end());
+
+		auto textFiltered = false;
+		const auto addPatterns = [&](const QStringList &list, bool prefix) {
+			for (const auto &text : list) {
+				const auto pattern = _routes.matcher.add(text);
+				if (pattern < 0) {
+					continue;
+				}
+				if (pattern >= int(_routes.patternBots.size())) {
+					_routes.patternBots.resize(pattern + 1);
+				}
+				_routes.patternBots[pattern].emplace_back(slot, prefix);
+				textFiltered = true;
+			}
+		};
+		addPatterns(subscription.commandPrefixes, true);
+		addPatterns(subscription.keywords, false);
+		_routes.textFiltered.push_back(textFiltered);
+	}
+	_routes.matcher.build();
 }
 
-void BotManager::dispatchUserStatusChanged(qint64 userId, const QString &status) {
-	if (!_eventDispatchEnabled) {
-		return;
+QStringList BotManager::routeLocked(const EventRoute &route) {
+	if (_routesDirty) {
+		rebuildRoutesLocked();
 	}
 
-	QMutexLocker locker(&_mutex);
+	auto candidates = std::vector<int>();
+	if (route.chatId) {
+		candidates = _routes.anyChat;
+		const auto i = _routes.byChat.constFind(route.chatId);
+		if (i != _routes.byChat.cend()) {
+			candidates.insert(end(candidates), i->begin(), i->end());
+		}
+	} else {
+		candidates.resize(_routes.botIds.size());
+		std::iota(begin(candidates), end(candidates), 0);
+	}
 
-	for (BotBase *bot : getRunningBots()) {
-		if (bot->isEnabled()) {
-			try {
-				bot->onUserStatusChanged(userId, status);
-			} catch (const std::exception &e) {
-				qCritical() << "[BotManager] Bot crashed:" << bot->info().id << e.what();
+	// One pass over the text for all the bots that filter by it.
+	auto textMatched = std::vector<bool>();
+	const auto scanText = route.text && std::any_of(
+		begin(candidates),
+		end(candidates),
+		[&](int slot) { return _routes.textFiltered[slot]; });
+	if (scanText) {
+		textMatched.assign(_routes.botIds.size(), false);
+		for (const auto &match : _routes.matcher.find(*route.text)) {
+			for (const auto &[slot, prefix] : _routes.patternBots[match.pattern]) {
+				if (!prefix || !match.start) {
+					textMatched[slot] = true;
+				}
 			}
 		}
 	}
 
-	Q_EMIT eventDispatched("user_status_changed", getRunningBots().size());
+	auto result = QStringList();
+	for (const auto slot : candidates) {
+		const auto &users = _routes.users[slot];
+		if (route.userId && !users.isEmpty() && !users.contains(route.userId)) {
+			continue;
+		} else if (scanText && _routes.textFiltered[slot] && !textMatched[slot]) {
+			continue;
+		}
+		result.push_back(_routes.botIds[slot]);
+	}
+	return result;
 }
 
-void BotManager::dispatchCommand(const QString &botId, const QString &cmd, const QJsonObject &args) {
-	QMutexLocker locker(&_mutex);
-
-	if (!_bots.contains(botId)) {
-		qWarning() << "[BotManager] Cannot dispatch command to unregistered bot:" << botId;
-		return;
+bool BotManager::enqueueLocked(const QString &botId, MailboxEvent event) {
+	const auto i = _mailboxes.find(botId);
+	if (i == _mailboxes.end()) {
+		return false;
 	}
-
-	BotBase *bot = _bots.value(botId);
-
-	if (!bot->isRunning() || !bot->isEnabled()) {
-		qWarning() << "[BotManager] Cannot dispatch command to inactive bot:" << botId;
-		return;
+	auto &mailbox = i.value();
+	auto &stats = _stats[botId];
+	if (!event.coalesceKey.isEmpty()) {
+		for (auto &pending : mailbox.events) {
+			if (pending.coalesceKey == event.coalesceKey) {
+				pending.deliver = std::move(event.deliver);
+				++stats.eventsCoalesced;
+				return true;
+			}
+		}
+	}
+	if (int(mailbox.events.size()) >= mailbox.capacity && !event.essential) {
+		const auto oldest = std::find_if(
+			mailbox.events.begin(),
+			mailbox.events.end(),
+			[](const MailboxEvent &pending) { return !pending.essential; });
+		if (mailbox.overflow == OverflowPolicy::DropNewest
+			|| oldest == mailbox.events.end()) {
+			++stats.eventsDropped;
+			return false;
+		}
+		mailbox.events.erase(oldest);
+		++stats.eventsDropped;
 	}
+	event.queuedAt = QDateTime::currentMSecsSinceEpoch();
+	mailbox.events.push_back(std::move(event));
+	++stats.eventsQueued;
+	stats.mailboxPeak = std::max(stats.mailboxPeak, int(mailbox.events.size()));
+
+	if (!mailbox.scheduled) {
+		mailbox.scheduled = true;
+		_dispatchPool->start([=] { drain(botId); });
+	}
+	return true;
+}
 
-	QElapsedTimer timer;
-	timer.start();
+void BotManager::drain(const QString &botId) {
+	QMutexLocker locker(&_mutex);
 
-	try {
-		bot->onCommand(cmd, args);
+	QElapsedTimer budget;
+	budget.start();
+	while (true) {
+		auto i = _mailboxes.find(botId);
+		if (i == _mailboxes.end()) {
+			return;
+		}
+		BotBase *bot = _bots.value(botId, nullptr);
+		if (!bot || !bot->isRunning() || !bot->isEnabled()) {
+			i->events.clear();
+		}
+		if (i->events.empty()) {
+			i->scheduled = false;
+			return;
+		}
+		if (budget.elapsed() >= i->timeBudgetMs) {
+			// Yield the worker, bots queued meanwhile go first.
+			_dispatchPool->start([=] { drain(botId); });
+			return;
+		}
+		auto event = std::move(i->events.front());
+		i->events.pop_front();
+		const auto budgetMs = i->timeBudgetMs;
+		i->delivering = true;
+		locker.unlock();
 
-		if (_stats.contains(botId)) {
-			_stats[botId].commandsExecuted++;
+		QElapsedTimer timer;
+		timer.start();
+		auto error = QString();
+		try {
+			event.deliver(bot);
+		} catch (const std::exception &e) {
+			error = QString::fromUtf8(e.what());
 		}
+		const auto elapsed = timer.elapsed();
 
-		qint64 elapsed = timer.elapsed();
-		updateStats(botId, elapsed, false);
+		locker.relock();
+		i = _mailboxes.find(botId);
+		if (i != _mailboxes.end()) {
+			i->delivering = false;
+		}
+		_deliveryDone.wakeAll();
+		recordDeliveryLocked(botId, event, elapsed, budgetMs, !error.isEmpty());
+		if (!error.isEmpty()) {
+			qCritical() << "[BotManager] Bot crashed on" << event.type << ":" << botId << error;
+			Q_EMIT botError(botId, QString("Crash: %1").arg(error));
+		}
+	}
+}
 
-	} catch (const std::exception &e) {
-		qCritical() << "[BotManager] Bot crashed on command:" << botId << cmd << e.what();
-		updateStats(botId, timer.elapsed(), true);
-		Q_EMIT botError(botId, QString("Command failed: %1").arg(e.what()));
+void BotManager::closeMailboxLocked(const QString &botId) {
+	const auto i = _mailboxes.find(botId);
+	if (i == _mailboxes.end()) {
+		return;
 	}
+	i->events.clear();
+	while (_mailboxes.contains(botId) && _mailboxes[botId].delivering) {
+		_deliveryDone.wait(&_mutex);
+	}
+}
 
-	Q_EMIT eventDispatched("command", 1);
+void BotManager::applyMailboxConfigLocked(const QString &botId, const QJsonObject &config) {
+	if (!_bots.contains(botId)) {
+		return;
+	}
+	auto &mailbox = _mailboxes[botId];
+	mailbox.capacity = std::clamp(
+		config.value("mailbox_capacity").toInt(kDefaultMailboxCapacity),
+		1,
+		kMaxMailboxCapacity);
+	mailbox.timeBudgetMs = std::max(
+		qint64(config.value("time_budget_ms").toInteger(kDefaultTimeBudgetMs)),
+		qint64(1));
+	mailbox.overflow = (config.value("overflow_policy").toString() == "drop_newest")
+		? OverflowPolicy::DropNewest
+		: OverflowPolicy::DropOldest;
+	while (int(mailbox.events.size()) > mailbox.capacity) {
+		mailbox.events.pop_front();
+		++_stats[botId].eventsDropped;
+	}
 }
 
 // Statistics
 
 BotStats BotManager::getBotStats(const QString &botId) const {
 	QMutexLocker locker(&_mutex);
-	return _stats.value(botId, BotStats());
+	auto result = _stats.value(botId, BotStats());
+	const auto i = _mailboxes.constFind(botId);
+	if (i != _mailboxes.cend()) {
+		result.mailboxDepth = int(i->events.size());
+	}
+	return result;
 }
 
 QMap<QString, BotStats> BotManager::getAllStats() const {
 	QMutexLocker locker(&_mutex);
-	return _stats;
+	auto result = _stats;
+	for (auto i = _mailboxes.cbegin(); i != _mailboxes.cend(); ++i) {
+		if (result.contains(i.key())) {
+			result[i.key()].mailboxDepth = int(i->events.size());
+		}
+	}
+	return result;
 }
 
 void BotManager::resetStats(const QString &botId) {
@@ -591,6 +798,7 @@ void BotManager::resetStats(const QString &botId) {
 
 	if (_stats.contains(botId)) {
 		BotStats newStats;
+		newStats.botId = botId;
 		newStats.registeredAt = _stats.value(botId).registeredAt;
 		_stats.insert(botId, newStats);
 
@@ -645,8 +853,9 @@ void BotManager::setEventDispatchEnabled(bool enabled) {
 }
 
 void BotManager::setMaxConcurrentBots(int max) {
-	_maxConcurrentBots = max;
-	qInfo() << "[BotManager] Max concurrent bots set to:" << max;
+	_maxConcurrentBots = std::max(max, 1);
+	_dispatchPool->setMaxThreadCount(_maxConcurrentBots);
+	qInfo() << "[BotManager] Max concurrent bots set to:" << _maxConcurrentBots;
 }
 
 // Debugging & monitoring
@@ -659,8 +868,9 @@ QJsonObject BotManager::getSystemStatus() const {
 	status["event_dispatch_enabled"] = _eventDispatchEnabled;
 	status["max_concurrent_bots"] = _maxConcurrentBots;
 	status["total_bots"] = _bots.size();
-	status["running_bots"] = getRunningBots().size();
-	status["enabled_bots"] = getEnabledBots().size();
+	status["running_bots"] = countBotsLocked(true);
+	status["enabled_bots"] = countBotsLocked(false);
+	status["active_dispatch_workers"] = _dispatchPool->activeThreadCount();
 
 	QJsonArray botsArray;
 	for (auto it = _bots.constBegin(); it != _bots.constEnd(); ++it) {
@@ -681,6 +891,13 @@ QJsonObject BotManager::getSystemStatus() const {
 			statsObj["commands_executed"] = static_cast<qint64>(stats.commandsExecuted);
 			statsObj["errors"] = static_cast<qint64>(stats.errorsOccurred);
 			statsObj["avg_execution_ms"] = stats.avgExecutionTimeMs();
+			statsObj["events_queued"] = stats.eventsQueued;
+			statsObj["events_dropped"] = stats.eventsDropped;
+			statsObj["events_coalesced"] = stats.eventsCoalesced;
+			statsObj["over_budget_events"] = stats.overBudgetEvents;
+			statsObj["mailbox_depth"] = _mailboxes.contains(botInfo.id)
+				? int(_mailboxes.value(botInfo.id).events.size())
+				: 0;
 			botObj["stats"] = statsObj;
 		}
 
@@ -696,8 +913,8 @@ void BotManager::dumpBotInfo() const {
 
 	qInfo() << "=== Bot Manager Status ===";
 	qInfo() << "Total bots:" << _bots.size();
-	qInfo() << "Running bots:" << getRunningBots().size();
-	qInfo() << "Enabled bots:" << getEnabledBots().size();
+	qInfo() << "Running bots:" << countBotsLocked(true);
+	qInfo() << "Enabled bots:" << countBotsLocked(false);
 	qInfo() << "";
 
 	for (auto it = _bots.constBegin(); it != _bots.constEnd(); ++it) {
@@ -728,6 +945,8 @@ void BotManager::onBotConfigChanged() {
 
 		QMutexLocker locker(&_mutex);
 		_configs.insert(botInfo.id, bot->config());
+		applyMailboxConfigLocked(botInfo.id, bot->config());
+		_routesDirty = true; // Subscriptions may follow the config.
 	}
 }
 
@@ -794,6 +1013,7 @@ bool BotManager::initializeBot(BotBase *bot) {
 	}
 
 	// Call internal initialization
+	bot->_contextBuilder = _contextBuilder;
 	bool success = bot->internalInitialize(
 		_archiver,
 		_analytics,
@@ -827,20 +1047,47 @@ void BotManager::shutdownBot(BotBase *bot) {
 	}
 }
 
-void BotManager::updateStats(const QString &botId, qint64 executionTimeMs, bool error) {
+void BotManager::recordDeliveryLocked(
+		const QString &botId,
+		const MailboxEvent &event,
+		qint64 executionTimeMs,
+		qint64 budgetMs,
+		bool error) {
 	if (!_stats.contains(botId)) {
 		return;
 	}
 
 	BotStats &stats = _stats[botId];
+	stats.lastQueueWaitMs = QDateTime::currentMSecsSinceEpoch()
+		- event.queuedAt
+		- executionTimeMs;
+	stats.lastActive = QDateTime::currentDateTime();
+	if (executionTimeMs > budgetMs) {
+		++stats.overBudgetEvents;
+	}
+	if (error) {
+		stats.errorsOccurred++;
+	}
+
+	// Only messages and commands count into the average, as before.
+	if (event.type == "command") {
+		stats.commandsExecuted++;
+	} else if (event.type != "message") {
+		return;
+	}
 	stats.messagesProcessed++;
 	stats.totalExecutionTimeMs += executionTimeMs;
 	stats.lastExecutionTimeMs = executionTimeMs;
-	stats.lastActive = QDateTime::currentDateTime();
+}
 
-	if (error) {
-		stats.errorsOccurred++;
+int BotManager::countBotsLocked(bool running) const {
+	auto result = 0;
+	for (BotBase *bot : _bots) {
+		if (bot && (running ? bot->isRunning() : bot->isEnabled())) {
+			++result;
+		}
 	}
+	return result;
 }
 
 bool BotManager::checkPermissions(BotBase *bot) const {
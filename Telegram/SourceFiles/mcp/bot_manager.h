@@ -5,6 +5,7 @@
 #pragma once
 
 #include "bot_base.h"
+#include "keyword_matcher.h"
 
 #include <QtCore/QObject>
 #include <QtCore/QString>
@@ -13,7 +14,14 @@
 #include <QtCore/QJsonObject>
 #include <QtCore/QJsonArray>
 #include <QtCore/QMutex>
+#include <QtCore/QSet>
+#include <QtCore/QThreadPool>
 #include <QtCore/QTimer>
+#include <QtCore/QWaitCondition>
+
+#include <deque>
+#include <functional>
+#include <memory>
 
 namespace MCP {
 
@@ -24,6 +32,7 @@ class SemanticSearch;
 class MessageScheduler;
 class AuditLogger;
 class RBAC;
+class ContextBuilder;
 
 // Bot execution statistics
 struct BotStats {
@@ -37,6 +46,15 @@ struct BotStats {
 	QDateTime lastActive;
 	QDateTime registeredAt;
 
+	// Mailbox, see BotManager::post().
+	qint64 eventsQueued = 0;
+	qint64 eventsDropped = 0;
+	qint64 eventsCoalesced = 0;
+	qint64 overBudgetEvents = 0; // Took longer than the whole time budget.
+	qint64 lastQueueWaitMs = 0;
+	int mailboxDepth = 0;
+	int mailboxPeak = 0;
+
 	double avgExecutionTimeMs() const {
 		return messagesProcessed > 0
 			? static_cast<double>(totalExecutionTimeMs) / messagesProcessed
@@ -49,6 +67,22 @@ struct BotStats {
 };
 
 // Bot Manager - Central coordinator for all bots
+//
+// Events are not delivered by the dispatch*() calls themselves, they are
+// put into a bounded mailbox of every running bot. Mailboxes are drained
+// on a worker pool of maxConcurrentBots() threads, one worker per bot at
+// a time, so handlers of one bot never run concurrently with each other
+// while a slow bot holds up neither the others nor the main thread.
+// Per bot config keys:
+//   mailbox_capacity  - pending events kept, 256 by default
+//   overflow_policy   - "drop_oldest" (default) or "drop_newest"
+//   time_budget_ms    - worker time taken before yielding, 50 by default
+// Pending edits of one message and status changes of one user are merged,
+// the latest one wins. Commands are never dropped.
+// Only bots whose BotInfo::subscription matches get an event at all: the
+// subscriptions are indexed by chat and sender, and the keywords and
+// command prefixes of all bots share one automaton, so a message costs
+// one text scan plus the bots it actually goes to.
 class BotManager : public QObject {
 	Q_OBJECT
 
@@ -68,6 +102,9 @@ public:
 
 	void shutdown();
 
+	// Handed to every bot, registered now or later.
+	void setContextBuilder(ContextBuilder *builder);
+
 	// Bot lifecycle management
 	bool registerBot(BotBase *bot);
 	bool unregisterBot(const QString &botId);
@@ -139,8 +176,65 @@ private:
 	// Internal helpers
 	bool initializeBot(BotBase *bot);
 	void shutdownBot(BotBase *bot);
-	void updateStats(const QString &botId, qint64 executionTimeMs, bool error = false);
 	bool checkPermissions(BotBase *bot) const;
+
+	enum class OverflowPolicy {
+		DropOldest,
+		DropNewest,
+	};
+	struct MailboxEvent {
+		QString type;
+		QString coalesceKey; // Empty if never merged.
+		std::function<void(BotBase*)> deliver;
+		qint64 queuedAt = 0;
+		bool essential = false; // Not dropped on overflow.
+	};
+	struct Mailbox {
+		std::deque<MailboxEvent> events;
+		int capacity = 0;
+		qint64 timeBudgetMs = 0;
+		OverflowPolicy overflow = OverflowPolicy::DropOldest;
+		bool scheduled = false;
+		bool delivering = false;
+	};
+
+	// What of an event is matched against subscriptions, zero or null
+	// for what it doesn't have.
+	struct EventRoute {
+		qint64 chatId = 0;
+		qint64 userId = 0;
+		const QString *text = nullptr;
+	};
+	struct RouteIndex {
+		QStringList botIds; // By slot.
+		std::vector<QSet<qint64>> users; // Empty for any sender.
+		std::vector<bool> textFiltered;
+		QHash<qint64, std::vector<int>> byChat;
+		std::vector<int> anyChat;
+		KeywordMatcher matcher;
+		// Slots by pattern id, true for a command prefix.
+		std::vector<std::vector<std::pair<int, bool>>> patternBots;
+	};
+
+	// Returns the count of bots that got the event.
+	int post(
+		const QString &type,
+		const QString &coalesceKey,
+		const EventRoute &route,
+		std::function<void(BotBase*)> deliver);
+	void rebuildRoutesLocked();
+	[[nodiscard]] QStringList routeLocked(const EventRoute &route);
+	bool enqueueLocked(const QString &botId, MailboxEvent event);
+	void drain(const QString &botId);
+	void recordDeliveryLocked(
+		const QString &botId,
+		const MailboxEvent &event,
+		qint64 executionTimeMs,
+		qint64 budgetMs,
+		bool error);
+	void applyMailboxConfigLocked(const QString &botId, const QJsonObject &config);
+	void closeMailboxLocked(const QString &botId);
+	[[nodiscard]] int countBotsLocked(bool running) const;
 	void loadPersistedConfigs();
 	void saveAllConfigs();
 	QString configFilePath() const;
@@ -152,18 +246,24 @@ private:
 	MessageScheduler *_scheduler = nullptr;
 	AuditLogger *_auditLogger = nullptr;
 	RBAC *_rbac = nullptr;
+	ContextBuilder *_contextBuilder = nullptr;
 
 	// Bot registry
 	QMap<QString, BotBase*> _bots;
 	QMap<QString, BotStats> _stats;
 	QMap<QString, QJsonObject> _configs;
+	QMap<QString, Mailbox> _mailboxes;
+	RouteIndex _routes;
+	bool _routesDirty = true;
 
 	// Thread safety
 	mutable QMutex _mutex;
+	QWaitCondition _deliveryDone;
+	std::unique_ptr<QThreadPool> _dispatchPool;
 
 	// Settings
 	bool _eventDispatchEnabled = true;
-	int _maxConcurrentBots = 20;
+	int _maxConcurrentBots = 4;
 	bool _isInitialized = false;
 
 	// Performance monitoring
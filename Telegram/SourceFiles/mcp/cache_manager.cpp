@@ -1,10 +1,21 @@
-// MCP Cache Manager Implementation - Thread-safe LRU cache with TTL
+// MCP Cache Manager Implementation - Sharded LRU cache with TTL and tags
 
 #include "cache_manager.h"
+
+#include "data/data_changes.h"
+#include "data/data_peer.h"
+#include "data/data_session.h"
+#include "history/history.h"
+#include "history/history_item.h"
+#include "main/main_session.h"
+
+#include <QtCore/QDateTime>
 #include <QtCore/QJsonDocument>
 #include <QtCore/QMutexLocker>
 #include <QtCore/QTimer>
 
+#include <limits>
+
 namespace MCP {
 
 CacheManager::CacheManager(QObject *parent)
@@ -19,225 +30,318 @@ CacheManager::~CacheManager() {
 	clear();
 }
 
-bool CacheManager::get(const QString &key, QJsonObject &outData) {
-	QMutexLocker locker(&_mutex);
+void CacheManager::subscribe(not_null<Main::Session*> session) {
+	unsubscribe();
+
+	using PeerFlag = Data::PeerUpdate::Flag;
+	using HistoryFlag = Data::HistoryUpdate::Flag;
+	using MessageFlag = Data::MessageUpdate::Flag;
+	const auto chatList = chatListKey();
+
+	// Anything shown for a chat or user: name, username, photo, about.
+	session->changes().peerUpdates(
+		PeerFlag::Name
+		| PeerFlag::Username
+		| PeerFlag::Photo
+		| PeerFlag::About
+		| PeerFlag::Members
+		| PeerFlag::Rights
+		| PeerFlag::Migration
+	) | rpl::start_with_next([=](const Data::PeerUpdate &update) {
+		const auto id = qint64(update.peer->id.value);
+		invalidateTag(chatTag(id));
+		if (update.peer->isUser()) {
+			invalidateTag(userTag(id));
+		}
+		if (update.flags & (PeerFlag::Name | PeerFlag::Username)) {
+			invalidate(chatList);
+		}
+	}, _sessionLifetime);
+
+	// The chat list entries, their unread counts and their order.
+	session->changes().historyUpdates(
+		HistoryFlag::IsPinned
+		| HistoryFlag::Folder
+		| HistoryFlag::TopPromoted
+		| HistoryFlag::UnreadView
+	) | rpl::start_with_next([=] {
+		invalidate(chatList);
+	}, _sessionLifetime);
+	rpl::merge(
+		session->data().chatsListChanges() | rpl::to_empty,
+		session->data().chatListEntryRefreshes() | rpl::to_empty
+	) | rpl::start_with_next([=] {
+		invalidate(chatList);
+	}, _sessionLifetime);
+
+	// Pages and searches with a changed message in them.
+	session->changes().messageUpdates(
+		MessageFlag::NewAdded
+		| MessageFlag::Edited
+		| MessageFlag::Destroyed
+	) | rpl::start_with_next([=](const Data::MessageUpdate &update) {
+		invalidateTag(messagesTag(qint64(update.item->history()->peer->id.value)));
+		invalidateTag(QStringLiteral("search"));
+		if (!(update.flags & MessageFlag::Edited)) {
+			invalidate(chatList);  // last_message_id of the entry
+		}
+	}, _sessionLifetime);
+}
 
-	// Use constFind for thread-safe lookup
-	auto it = _cache.constFind(key);
-	if (it == _cache.constEnd()) {
-		_stats.misses++;
-		return false;
+void CacheManager::unsubscribe() {
+	_sessionLifetime.destroy();
+}
+
+CacheManager::Shard &CacheManager::shardFor(const QString &key) {
+	return _shards[qHash(key) % kShardCount];
+}
+
+QStringList CacheManager::TagsForKey(const QString &key) {
+	// "search:foo:chat:5" -> "search", "chat:5"
+	const auto parts = QStringView(key).split(u':');
+	auto result = QStringList();
+	if (!parts.isEmpty()) {
+		result.push_back(parts.front().toString());
 	}
+	for (auto i = 0; i + 1 < parts.size(); ++i) {
+		auto isNumber = false;
+		parts[i + 1].toLongLong(&isNumber);
+		if (isNumber && !parts[i].isEmpty()) {
+			result.push_back(parts[i].toString() + ':' + parts[i + 1].toString());
+		}
+	}
+	return result;
+}
 
-	// Check if expired - need to copy key before potential removal
-	if (it->isExpired()) {
-		QString keyToRemove = it.key();
-		int sizeToRemove = estimateSize(it->data);
+qint64 CacheManager::shardLimit() const {
+	return _maxSizeBytes.load() / kShardCount;
+}
 
-		// Now safe to remove using the key (not iterator)
-		_cache.remove(keyToRemove);
-		_currentSizeBytes -= sizeToRemove;
-		_stats.misses++;
-		_stats.evictions++;
-		_stats.size = _cache.size();
-		return false;
+void CacheManager::removeLocked(Shard &shard, std::list<CacheEntry>::iterator i) {
+	for (const auto &tag : i->tags) {
+		const auto j = shard.tagged.find(tag);
+		if (j != shard.tagged.end()) {
+			j->remove(i->key);
+			if (j->isEmpty()) {
+				shard.tagged.erase(j);
+			}
+		}
 	}
+	shard.sizeBytes -= i->sizeBytes;
+	shard.index.remove(i->key);
+	shard.lru.erase(i);
+	shard.stats.size = shard.lru.size();
+}
 
-	// Cache hit - update access time for LRU
-	// Need to get mutable reference
-	auto mutIt = _cache.find(key);
-	if (mutIt != _cache.end()) {
-		mutIt->lastAccess = QDateTime::currentDateTime();
-		mutIt->hitCount++;
-		outData = mutIt->data;
+void CacheManager::evictLocked(Shard &shard, qint64 limit) {
+	// The tail of the list is the least recently used entry.
+	while (shard.sizeBytes > limit && !shard.lru.empty()) {
+		removeLocked(shard, std::prev(shard.lru.end()));
+		shard.stats.evictions++;
 	}
+}
 
-	_stats.hits++;
-	return true;
+CacheEntry *CacheManager::findLocked(Shard &shard, const QString &key) {
+	const auto it = shard.index.constFind(key);
+	if (it == shard.index.cend()) {
+		shard.stats.misses++;
+		return nullptr;
+	}
+
+	const auto entry = *it;
+	if (entry->isExpired(QDateTime::currentMSecsSinceEpoch())) {
+		removeLocked(shard, entry);
+		shard.stats.misses++;
+		shard.stats.evictions++;
+		return nullptr;
+	}
+
+	// Cache hit - move to the front of the LRU list
+	shard.lru.splice(shard.lru.begin(), shard.lru, entry);
+	entry->hitCount++;
+	shard.stats.hits++;
+	return &*entry;
 }
 
-void CacheManager::put(const QString &key, const QJsonObject &data, int ttlSeconds) {
-	QMutexLocker locker(&_mutex);
+bool CacheManager::get(const QString &key, QJsonObject &outData) {
+	auto &shard = shardFor(key);
+	QMutexLocker locker(&shard.mutex);
 
-	int dataSize = estimateSize(data);
-	QDateTime now = QDateTime::currentDateTime();
+	if (const auto entry = findLocked(shard, key)) {
+		outData = entry->data;
+		return true;
+	}
+	return false;
+}
 
-	// Check if we need to evict entries to make space
-	while (_currentSizeBytes + dataSize > _maxSizeBytes && !_cache.isEmpty()) {
-		// Find LRU entry (oldest lastAccess timestamp)
-		QString lruKey;
-		QDateTime oldestAccess = QDateTime::currentDateTime();
-
-		for (auto it = _cache.constBegin(); it != _cache.constEnd(); ++it) {
-			if (it->lastAccess < oldestAccess) {
-				oldestAccess = it->lastAccess;
-				lruKey = it.key();
-			}
-		}
+bool CacheManager::getSerialized(const QString &key, QByteArray &outBytes) {
+	auto &shard = shardFor(key);
+	QMutexLocker locker(&shard.mutex);
 
-		// Evict LRU entry using key (not iterator)
-		if (!lruKey.isEmpty()) {
-			auto lruIt = _cache.find(lruKey);
-			if (lruIt != _cache.end()) {
-				_currentSizeBytes -= estimateSize(lruIt->data);
-				_cache.erase(lruIt);
-				_stats.evictions++;
-			}
-		} else {
-			// Safety: if we can't find LRU, remove first entry
-			auto first = _cache.begin();
-			if (first != _cache.end()) {
-				_currentSizeBytes -= estimateSize(first->data);
-				_cache.erase(first);
-				_stats.evictions++;
-			}
+	// Entries put without bytes count as misses here, callers fall back
+	// to building the response.
+	const auto i = shard.index.constFind(key);
+	if (i != shard.index.cend() && (*i)->serialized.isEmpty()) {
+		shard.stats.misses++;
+		return false;
+	}
+	if (const auto entry = findLocked(shard, key)) {
+		outBytes = entry->serialized;  // Implicitly shared, no copy
+		return true;
+	}
+	return false;
+}
+
+void CacheManager::put(
+		const QString &key,
+		const QJsonObject &data,
+		int ttlSeconds,
+		const QStringList &extraTags,
+		const QByteArray &serialized) {
+	// Measured outside the lock, and only once for the entry's lifetime
+	const auto dataSize = int(QJsonDocument(data).toJson(QJsonDocument::Compact).size()
+		+ serialized.size()
+		+ key.size() * sizeof(QChar));
+	const auto ttl = (ttlSeconds > 0 || ttlSeconds == kNoExpiry)
+		? ttlSeconds
+		: _defaultTTL.load();
+	auto tags = TagsForKey(key);
+	for (const auto &tag : extraTags) {
+		if (!tags.contains(tag)) {
+			tags.push_back(tag);
 		}
 	}
 
+	auto &shard = shardFor(key);
+	QMutexLocker locker(&shard.mutex);
+
 	// Remove old entry if exists
-	auto it = _cache.find(key);
-	if (it != _cache.end()) {
-		_currentSizeBytes -= estimateSize(it->data);
-		_cache.erase(it);
+	const auto existing = shard.index.constFind(key);
+	if (existing != shard.index.cend()) {
+		removeLocked(shard, *existing);
 	}
 
-	// Insert new entry with current timestamp
-	CacheEntry entry;
-	entry.data = data;
-	entry.expiration = now.addSecs(ttlSeconds > 0 ? ttlSeconds : _defaultTTL);
-	entry.lastAccess = now;
-	entry.hitCount = 0;
-
-	_cache[key] = entry;
-	_currentSizeBytes += dataSize;
-	_stats.size = _cache.size();
-	_stats.maxSize = qMax(_stats.maxSize, _stats.size);
+	// Check if we need to evict entries to make space
+	evictLocked(shard, shardLimit() - dataSize);
+
+	shard.lru.push_front(CacheEntry{
+		.key = key,
+		.data = data,
+		.serialized = serialized,
+		.tags = tags,
+		.expiration = (ttl == kNoExpiry)
+			? std::numeric_limits<qint64>::max()
+			: QDateTime::currentMSecsSinceEpoch() + qint64(ttl) * 1000,
+		.sizeBytes = dataSize,
+	});
+	shard.index.insert(key, shard.lru.begin());
+	for (const auto &tag : tags) {
+		shard.tagged[tag].insert(key);
+	}
+	shard.sizeBytes += dataSize;
+	shard.stats.size = shard.lru.size();
+	shard.stats.maxSize = qMax(shard.stats.maxSize, shard.stats.size);
 }
 
 void CacheManager::invalidate(const QString &key) {
-	QMutexLocker locker(&_mutex);
+	auto &shard = shardFor(key);
+	QMutexLocker locker(&shard.mutex);
 
-	auto it = _cache.find(key);
-	if (it != _cache.end()) {
-		_currentSizeBytes -= estimateSize(it->data);
-		_cache.erase(it);
-		_stats.size = _cache.size();
+	const auto it = shard.index.constFind(key);
+	if (it != shard.index.cend()) {
+		removeLocked(shard, *it);
 	}
 }
 
-void CacheManager::invalidatePattern(const QString &pattern) {
-	QMutexLocker locker(&_mutex);
-
-	// Collect keys to remove first (avoid iterator invalidation)
-	QList<QString> keysToRemove;
-	keysToRemove.reserve(_cache.size() / 4);  // Reserve estimated capacity
-
-	// Find matching keys using const iteration
-	for (auto it = _cache.constBegin(); it != _cache.constEnd(); ++it) {
-		if (it.key().contains(pattern, Qt::CaseInsensitive)) {
-			keysToRemove.append(it.key());
+void CacheManager::invalidateTag(const QString &tag) {
+	// Keys of a tag hash to any shard, every shard is locked in turn.
+	for (auto &shard : _shards) {
+		QMutexLocker locker(&shard.mutex);
+		const auto keys = shard.tagged.value(tag);
+		for (const auto &key : keys) {
+			const auto it = shard.index.constFind(key);
+			if (it != shard.index.cend()) {
+				removeLocked(shard, *it);
+			}
 		}
 	}
+}
 
-	// Remove them using keys (not iterators)
-	for (const QString &key : keysToRemove) {
-		auto it = _cache.find(key);
-		if (it != _cache.end()) {
-			_currentSizeBytes -= estimateSize(it->data);
-			_cache.erase(it);
+void CacheManager::invalidatePattern(const QString &pattern) {
+	for (auto &shard : _shards) {
+		QMutexLocker locker(&shard.mutex);
+		for (auto i = shard.lru.begin(); i != shard.lru.end();) {
+			const auto next = std::next(i);
+			if (i->key.contains(pattern, Qt::CaseInsensitive)) {
+				removeLocked(shard, i);
+			}
+			i = next;
 		}
 	}
-
-	_stats.size = _cache.size();
 }
 
 void CacheManager::clear() {
-	QMutexLocker locker(&_mutex);
-	_cache.clear();
-	_currentSizeBytes = 0;
-	_stats.size = 0;
+	for (auto &shard : _shards) {
+		QMutexLocker locker(&shard.mutex);
+		shard.lru.clear();
+		shard.index.clear();
+		shard.tagged.clear();
+		shard.sizeBytes = 0;
+		shard.stats.size = 0;
+	}
 }
 
 CacheManager::Stats CacheManager::getStats() const {
-	QMutexLocker locker(&_mutex);
-	return _stats;
+	auto result = Stats();
+	for (const auto &shard : _shards) {
+		QMutexLocker locker(&shard.mutex);
+		result.hits += shard.stats.hits;
+		result.misses += shard.stats.misses;
+		result.evictions += shard.stats.evictions;
+		result.size += shard.stats.size;
+		result.maxSize += shard.stats.maxSize;
+		result.bytes += shard.sizeBytes;
+	}
+	return result;
 }
 
 void CacheManager::resetStats() {
-	QMutexLocker locker(&_mutex);
-	_stats.hits = 0;
-	_stats.misses = 0;
-	_stats.evictions = 0;
+	for (auto &shard : _shards) {
+		QMutexLocker locker(&shard.mutex);
+		shard.stats.hits = 0;
+		shard.stats.misses = 0;
+		shard.stats.evictions = 0;
+	}
 }
 
 void CacheManager::setMaxSize(int maxSizeMB) {
-	QMutexLocker locker(&_mutex);
-	_maxSizeBytes = maxSizeMB * 1024 * 1024;
+	_maxSizeBytes = qint64(maxSizeMB) * 1024 * 1024;
 
 	// Trigger cleanup if over limit using LRU eviction
-	while (_currentSizeBytes > _maxSizeBytes && !_cache.isEmpty()) {
-		QString lruKey;
-		QDateTime oldestAccess = QDateTime::currentDateTime();
-
-		for (auto it = _cache.constBegin(); it != _cache.constEnd(); ++it) {
-			if (it->lastAccess < oldestAccess) {
-				oldestAccess = it->lastAccess;
-				lruKey = it.key();
-			}
-		}
-
-		if (!lruKey.isEmpty()) {
-			auto lruIt = _cache.find(lruKey);
-			if (lruIt != _cache.end()) {
-				_currentSizeBytes -= estimateSize(lruIt->data);
-				_cache.erase(lruIt);
-				_stats.evictions++;
-			}
-		} else {
-			break;  // Safety exit
-		}
+	const auto limit = shardLimit();
+	for (auto &shard : _shards) {
+		QMutexLocker locker(&shard.mutex);
+		evictLocked(shard, limit);
 	}
-
-	_stats.size = _cache.size();
 }
 
 void CacheManager::setDefaultTTL(int seconds) {
-	QMutexLocker locker(&_mutex);
 	_defaultTTL = seconds;
 }
 
 void CacheManager::cleanupExpired() {
-	QMutexLocker locker(&_mutex);
-
-	// Collect expired keys first (const iteration)
-	QList<QString> expiredKeys;
-	expiredKeys.reserve(_cache.size() / 10);  // Estimate 10% expired
-
-	QDateTime now = QDateTime::currentDateTime();
-
-	for (auto it = _cache.constBegin(); it != _cache.constEnd(); ++it) {
-		if (it->expiration <= now) {
-			expiredKeys.append(it.key());
-		}
-	}
-
-	// Remove using keys (not iterators)
-	for (const QString &key : expiredKeys) {
-		auto it = _cache.find(key);
-		if (it != _cache.end()) {
-			_currentSizeBytes -= estimateSize(it->data);
-			_cache.erase(it);
-			_stats.evictions++;
+	const auto now = QDateTime::currentMSecsSinceEpoch();
+	for (auto &shard : _shards) {
+		QMutexLocker locker(&shard.mutex);
+		for (auto i = shard.lru.begin(); i != shard.lru.end();) {
+			const auto next = std::next(i);
+			if (i->isExpired(now)) {
+				removeLocked(shard, i);
+				shard.stats.evictions++;
+			}
+			i = next;
 		}
 	}
-
-	_stats.size = _cache.size();
-}
-
-int CacheManager::estimateSize(const QJsonObject &obj) const {
-	// Estimate size by converting to JSON and measuring
-	QJsonDocument doc(obj);
-	return doc.toJson(QJsonDocument::Compact).size();
 }
 
 } // namespace MCP
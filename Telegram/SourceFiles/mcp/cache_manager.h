@@ -6,39 +6,75 @@
 #pragma once
 
 #include <QtCore/QObject>
-#include <QtCore/QCache>
 #include <QtCore/QHash>
 #include <QtCore/QJsonObject>
 #include <QtCore/QJsonArray>
 #include <QtCore/QMutex>
-#include <QtCore/QDateTime>
+#include <QtCore/QSet>
+#include <QtCore/QStringList>
+
+#include <array>
+#include <atomic>
+#include <list>
+
+class QTimer;
+
+namespace Main {
+class Session;
+} // namespace Main
 
 namespace MCP {
 
-// Cache entry with TTL (time-to-live) and LRU timestamp
+// Cache entry with TTL (time-to-live), kept in its shard's LRU list
 struct CacheEntry {
+	QString key;
 	QJsonObject data;
-	QDateTime expiration;
-	QDateTime lastAccess;  // For true LRU eviction
+	QByteArray serialized;  // Wire form given to put(), may be empty
+	QStringList tags;
+	qint64 expiration = 0;  // ms since epoch
+	int sizeBytes = 0;  // Compact JSON size, measured once on put()
 	int hitCount = 0;
 
-	bool isExpired() const {
-		return QDateTime::currentDateTime() > expiration;
+	bool isExpired(qint64 now) const {
+		return now > expiration;
 	}
 };
 
-// High-performance LRU cache with TTL support
+// High-performance LRU cache with TTL support. Keys are spread over
+// lock-striped shards, each with its own LRU list and size budget, so
+// worker threads rarely wait on each other. Every key is tagged with
+// its first segment and each "name:<number>" pair in it, so
+// "messages:5:limit:20" carries "messages" and "messages:5", and
+// invalidateTag() drops exactly the entries of a chat or a kind.
 class CacheManager : public QObject {
 	Q_OBJECT
 
 public:
+	// Entries that live until an invalidation from the session drops them.
+	static constexpr auto kNoExpiry = -1;
+
 	explicit CacheManager(QObject *parent = nullptr);
 	~CacheManager() override;
 
+	// Invalidates chat, user, message and chat list keys on the matching
+	// Data::Changes updates of the session, so they may use kNoExpiry.
+	void subscribe(not_null<Main::Session*> session);
+	void unsubscribe();
+
 	// Core cache operations
 	bool get(const QString &key, QJsonObject &outData);
-	void put(const QString &key, const QJsonObject &data, int ttlSeconds = 300);
+	// Bytes stored with the entry, written out as they are on a hit.
+	bool getSerialized(const QString &key, QByteArray &outBytes);
+	void put(
+		const QString &key,
+		const QJsonObject &data,
+		int ttlSeconds = 0,  // 0 = default TTL, or kNoExpiry
+		const QStringList &extraTags = {},
+		const QByteArray &serialized = QByteArray());
 	void invalidate(const QString &key);
+	void invalidateTag(const QString &tag);
+	// Drops keys containing pattern, case-insensitive; walks every key,
+	// prefer invalidateTag().
 	void invalidatePattern(const QString &pattern);
 	void clear();
 
@@ -49,6 +85,7 @@ public:
 		qint64 evictions = 0;
 		qint64 size = 0;
 		qint64 maxSize = 0;
+		qint64 bytes = 0;
 
 		double hitRate() const {
 			qint64 total = hits + misses;
@@ -63,6 +100,11 @@ public:
 	void setMaxSize(int maxSizeMB);
 	void setDefaultTTL(int seconds);
 
+	// Tags of the key helpers below
+	static QString chatTag(qint64 chatId) { return QStringLiteral("chat:%1").arg(chatId); }
+	static QString messagesTag(qint64 chatId) { return QStringLiteral("messages:%1").arg(chatId); }
+	static QString userTag(qint64 userId) { return QStringLiteral("user:%1").arg(userId); }
+
 	// Specialized cache key helpers - centralized key generation for consistency
 	// Chat-related keys
 	QString chatListKey() const { return QStringLiteral("chats:list"); }
@@ -105,22 +147,36 @@ public:
 	QString subscriptionsKey() const { return QStringLiteral("subscriptions:list"); }
 
 private:
+	static constexpr auto kShardCount = 16;
+
+	struct Shard {
+		mutable QMutex mutex;
+		std::list<CacheEntry> lru;  // Most recently used first
+		QHash<QString, std::list<CacheEntry>::iterator> index;
+		QHash<QString, QSet<QString>> tagged;  // tag -> keys
+		qint64 sizeBytes = 0;
+		Stats stats;
+	};
+
+	[[nodiscard]] Shard &shardFor(const QString &key);
+	[[nodiscard]] CacheEntry *findLocked(Shard &shard, const QString &key);
+	[[nodiscard]] static QStringList TagsForKey(const QString &key);
+	void removeLocked(Shard &shard, std::list<CacheEntry>::iterator i);
+	void evictLocked(Shard &shard, qint64 limit);
+	[[nodiscard]] qint64 shardLimit() const;
+
 	void cleanupExpired();
-	int estimateSize(const QJsonObject &obj) const;
 
-	mutable QMutex _mutex;
-	QHash<QString, CacheEntry> _cache;
+	std::array<Shard, kShardCount> _shards;
 
 	// Configuration
-	int _maxSizeBytes = 50 * 1024 * 1024;  // 50 MB default
-	int _defaultTTL = 300;  // 5 minutes default
-	int _currentSizeBytes = 0;
-
-	// Statistics
-	mutable Stats _stats;
+	std::atomic<qint64> _maxSizeBytes = 50 * 1024 * 1024;  // 50 MB default
+	std::atomic<int> _defaultTTL = 300;  // 5 minutes default
 
 	// Cleanup timer
 	QTimer *_cleanupTimer = nullptr;
+
+	rpl::lifetime _sessionLifetime;
 };
 
 } // namespace MCP
@@ -0,0 +1,310 @@
+// MCP Change Log - Message and peer changes numbered for delta sync
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "change_log.h"
+
+#include "database_pool.h"
+#include "mcp_helpers.h"
+#include "data/data_changes.h"
+#include "data/data_peer.h"
+#include "data/data_session.h"
+#include "history/history.h"
+#include "history/history_item.h"
+#include "main/main_session.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QPointer>
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+
+namespace MCP {
+namespace {
+
+constexpr auto kRingSize = 4096;
+constexpr auto kFlushDelay = 1000; // ms, events come in bursts.
+constexpr auto kStoredEvents = quint64(200000);
+
+constexpr auto kChangeLogTable = R"(
+	CREATE TABLE IF NOT EXISTS change_log (
+		sequence INTEGER PRIMARY KEY,
+		kind INTEGER NOT NULL,
+		chat_id INTEGER NOT NULL,
+		message_id INTEGER NOT NULL DEFAULT 0,
+		date INTEGER NOT NULL
+	)
+)";
+
+} // namespace
+
+ChangeLog::ChangeLog(QObject *parent)
+: QObject(parent) {
+	_flushTimer.setSingleShot(true);
+	connect(&_flushTimer, &QTimer::timeout, this, [=] {
+		flush();
+	});
+}
+
+ChangeLog::~ChangeLog() {
+	stop();
+}
+
+bool ChangeLog::start(
+		not_null<Main::Session*> session,
+		not_null<DatabasePool*> pool) {
+	if (_pool || !pool->isOpen()) {
+		return false;
+	}
+	_pool = pool;
+	_ring.reserve(kRingSize);
+
+	// Queued after the flush of a previous log, if any.
+	const auto weak = QPointer<ChangeLog>(this);
+	_pool->write([=](QSqlDatabase &db) {
+		QSqlQuery query(db);
+		auto oldest = quint64(0);
+		auto latest = quint64(0);
+		const auto ok = query.exec(
+			"SELECT MIN(sequence), MAX(sequence) FROM change_log");
+		if (!ok) {
+			qWarning() << "MCP: Failed to read change_log:" << query.lastError().text();
+		} else if (query.next() && !query.value(1).isNull()) {
+			oldest = query.value(0).toULongLong();
+			latest = query.value(1).toULongLong();
+		}
+		crl::on_main(weak, [=] {
+			loaded(ok, oldest, latest);
+		});
+	});
+
+	using Kind = ChangeEvent::Kind;
+	const auto chatIdOf = [](not_null<const HistoryItem*> item) {
+		return qint64(item->history()->peer->id.value);
+	};
+	const auto owner = &session->data();
+	owner->newItemAdded(
+	) | rpl::filter([](not_null<HistoryItem*> item) {
+		return item->isRegular();
+	}) | rpl::start_with_next([=](not_null<HistoryItem*> item) {
+		record(Kind::NewMessage, chatIdOf(item), item->id.bare);
+	}, _sessionLifetime);
+
+	session->changes().messageUpdates(
+		Data::MessageUpdate::Flag::Edited
+	) | rpl::filter([](const Data::MessageUpdate &update) {
+		return update.item->isRegular();
+	}) | rpl::start_with_next([=](const Data::MessageUpdate &update) {
+		record(
+			Kind::EditedMessage,
+			chatIdOf(update.item),
+			update.item->id.bare);
+	}, _sessionLifetime);
+
+	// Messages we send are added with a local id, they become regular
+	// when the server gives them the real one.
+	owner->itemIdChanged(
+	) | rpl::filter([](const Data::Session::IdChange &change) {
+		return IsServerMsgId(change.newId.msg);
+	}) | rpl::start_with_next([=](const Data::Session::IdChange &change) {
+		record(
+			Kind::NewMessage,
+			qint64(change.newId.peer.value),
+			change.newId.msg.bare);
+	}, _sessionLifetime);
+
+	// Not itemRemoved(), it fires for the items of unloaded histories.
+	owner->messageDeleted(
+	) | rpl::filter([](FullMsgId itemId) {
+		return IsServerMsgId(itemId.msg);
+	}) | rpl::start_with_next([=](FullMsgId itemId) {
+		record(
+			Kind::DeletedMessage,
+			qint64(itemId.peer.value),
+			itemId.msg.bare);
+	}, _sessionLifetime);
+
+	using PeerFlag = Data::PeerUpdate::Flag;
+	session->changes().peerUpdates(
+		PeerFlag::Name
+		| PeerFlag::Username
+		| PeerFlag::Photo
+		| PeerFlag::About
+		| PeerFlag::Members
+		| PeerFlag::Rights
+		| PeerFlag::Migration
+	) | rpl::start_with_next([=](const Data::PeerUpdate &update) {
+		record(Kind::Peer, qint64(update.peer->id.value), 0);
+	}, _sessionLifetime);
+
+	return true;
+}
+
+void ChangeLog::stop() {
+	if (!_pool) {
+		return;
+	}
+	_sessionLifetime.destroy();
+	_flushTimer.stop();
+	flush();
+	_ring.clear();
+	_ringStart = 0;
+	_early.clear();
+	_loaded = false;
+	_pool = nullptr;
+}
+
+bool ChangeLog::CreateTable(QSqlDatabase &db) {
+	QSqlQuery query(db);
+	if (!query.exec(kChangeLogTable)) {
+		qWarning() << "MCP: Failed to create change_log:" << query.lastError().text();
+		return false;
+	}
+	return true;
+}
+
+void ChangeLog::loaded(bool ok, quint64 oldest, quint64 latest) {
+	if (!_pool || _loaded) {
+		return;
+	} else if (!ok) {
+		stop();
+		return;
+	}
+	if (latest) {
+		_oldestStored = oldest;
+		_sequence = latest;
+	} else {
+		_oldestStored = _sequence + 1;
+	}
+	_loaded = true;
+	for (const auto &event : base::take(_early)) {
+		append(event);
+	}
+}
+
+void ChangeLog::record(
+		ChangeEvent::Kind kind,
+		qint64 chatId,
+		qint64 messageId) {
+	const auto event = ChangeEvent{
+		.kind = kind,
+		.chatId = chatId,
+		.messageId = messageId,
+		.date = QDateTime::currentSecsSinceEpoch(),
+	};
+	if (!_loaded) {
+		_early.push_back(event);
+		return;
+	}
+	append(event);
+}
+
+void ChangeLog::append(ChangeEvent event) {
+	event.sequence = ++_sequence;
+	if (int(_ring.size()) < kRingSize) {
+		_ring.push_back(event);
+	} else {
+		_ring[_ringStart] = event;
+		_ringStart = (_ringStart + 1) % kRingSize;
+	}
+	_unsaved.push_back(event);
+	if (int(_unsaved.size()) >= kRingSize / 2) {
+		// Queued before the ring overwrites them, reads below the ring
+		// find them in the table.
+		_flushTimer.stop();
+		flush();
+	} else if (!_flushTimer.isActive()) {
+		_flushTimer.start(kFlushDelay);
+	}
+}
+
+void ChangeLog::flush() {
+	if (_unsaved.empty()) {
+		return;
+	}
+	const auto prune = (_sequence > kStoredEvents)
+		? (_sequence - kStoredEvents)
+		: quint64(0);
+	_oldestStored = std::max(_oldestStored, prune + 1);
+	_pool->write([events = base::take(_unsaved), prune](QSqlDatabase &db) {
+		db.transaction();
+		for (const auto &event : events) {
+			auto query = PreparedQuery(db, R"(
+				INSERT OR REPLACE INTO change_log
+					(sequence, kind, chat_id, message_id, date)
+				VALUES (:sequence, :kind, :chat_id, :message_id, :date)
+			)");
+			query->bindValue(":sequence", event.sequence);
+			query->bindValue(":kind", int(event.kind));
+			query->bindValue(":chat_id", event.chatId);
+			query->bindValue(":message_id", event.messageId);
+			query->bindValue(":date", event.date);
+			if (!query->exec()) {
+				qWarning() << "MCP: Failed to store a change:" << query->lastError().text();
+			}
+		}
+		if (prune) {
+			auto query = PreparedQuery(db, R"(
+				DELETE FROM change_log WHERE sequence <= :prune
+			)");
+			query->bindValue(":prune", prune);
+			query->exec();
+		}
+		db.commit();
+	});
+}
+
+quint64 ChangeLog::ringFirst() const {
+	return _ring.empty() ? (_sequence + 1) : _ring[_ringStart].sequence;
+}
+
+std::vector<ChangeEvent> ChangeLog::since(
+		quint64 sequence,
+		int limit,
+		bool &expired) const {
+	auto result = std::vector<ChangeEvent>();
+	expired = (sequence + 1 < _oldestStored) || (sequence > _sequence);
+	if (!_pool || expired || sequence >= _sequence || limit <= 0) {
+		return result;
+	}
+
+	// Older than the ring, the rows up to its start are read back.
+	const auto first = ringFirst();
+	if (sequence + 1 < first) {
+		auto query = PreparedQuery(_pool->reader(), R"(
+			SELECT sequence, kind, chat_id, message_id, date
+			FROM change_log
+			WHERE sequence > :since AND sequence < :first
+			ORDER BY sequence
+			LIMIT :limit
+		)");
+		query->bindValue(":since", sequence);
+		query->bindValue(":first", first);
+		query->bindValue(":limit", limit);
+		if (!query->exec()) {
+			qWarning() << "MCP: Failed to read change_log:" << query->lastError().text();
+			return result;
+		}
+		while (query->next()) {
+			result.push_back({
+				.sequence = query->value(0).toULongLong(),
+				.kind = ChangeEvent::Kind(query->value(1).toInt()),
+				.chatId = query->value(2).toLongLong(),
+				.messageId = query->value(3).toLongLong(),
+				.date = query->value(4).toLongLong(),
+			});
+		}
+		if (int(result.size()) >= limit) {
+			return result;
+		}
+	}
+	const auto size = int(_ring.size());
+	for (auto i = 0; i != size && int(result.size()) < limit; ++i) {
+		const auto &event = _ring[(_ringStart + i) % size];
+		if (event.sequence > sequence) {
+			result.push_back(event);
+		}
+	}
+	return result;
+}
+
+} // namespace MCP
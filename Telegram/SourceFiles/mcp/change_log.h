@@ -0,0 +1,90 @@
+// MCP Change Log - Message and peer changes numbered for delta sync
+//
+// This file is part of Telegram Desktop MCP integration.
+// Every new, edited and deleted message and every changed peer of the
+// session gets the next sequence number. The latest events are kept in
+// a ring buffer, all of them are appended to the change_log table in
+// coalesced batches and the oldest rows are pruned, so a cursor keeps
+// working across restarts until its events are pruned.
+
+#pragma once
+
+#include <QtCore/QObject>
+#include <QtCore/QTimer>
+
+#include <vector>
+
+class QSqlDatabase;
+
+namespace Main {
+class Session;
+} // namespace Main
+
+namespace MCP {
+
+class DatabasePool;
+
+struct ChangeEvent {
+	enum class Kind : uchar {
+		NewMessage = 1,
+		EditedMessage = 2,
+		DeletedMessage = 3,
+		Peer = 4,
+	};
+
+	quint64 sequence = 0;
+	Kind kind = Kind::NewMessage;
+	qint64 chatId = 0;
+	qint64 messageId = 0; // 0 for Peer.
+	qint64 date = 0; // Unix time of the change.
+};
+
+class ChangeLog final : public QObject {
+public:
+	explicit ChangeLog(QObject *parent = nullptr);
+	~ChangeLog();
+
+	// Archive schema migration creating the change_log table.
+	static bool CreateTable(QSqlDatabase &db);
+
+	// The stored sequence is read on the pool writer, events of the
+	// session are numbered once it is known.
+	bool start(not_null<Main::Session*> session, not_null<DatabasePool*> pool);
+	void stop();
+	[[nodiscard]] bool isRunning() const { return _pool && _loaded; }
+
+	// Sequence of the latest event.
+	[[nodiscard]] quint64 cursor() const { return _sequence; }
+
+	// Up to limit events after the given sequence, oldest first. Sets
+	// expired if some of them were pruned already or if the sequence
+	// was never given out, e.g. by a change_log that was removed.
+	[[nodiscard]] std::vector<ChangeEvent> since(
+		quint64 sequence,
+		int limit,
+		bool &expired) const;
+
+private:
+	void loaded(bool ok, quint64 oldest, quint64 latest);
+	void record(ChangeEvent::Kind kind, qint64 chatId, qint64 messageId);
+	void append(ChangeEvent event);
+	void flush();
+
+	[[nodiscard]] quint64 ringFirst() const;
+
+	DatabasePool *_pool = nullptr;
+	quint64 _sequence = 0;
+	quint64 _oldestStored = 1; // First sequence still in change_log.
+	bool _loaded = false;
+	std::vector<ChangeEvent> _early; // Recorded before the load.
+
+	std::vector<ChangeEvent> _ring; // Circular once full.
+	int _ringStart = 0; // Index of the oldest event.
+	std::vector<ChangeEvent> _unsaved;
+	QTimer _flushTimer;
+
+	rpl::lifetime _sessionLifetime;
+
+};
+
+} // namespace MCP
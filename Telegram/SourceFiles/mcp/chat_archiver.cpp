@@ -2,28 +2,317 @@
 // Licensed under GPLv3 with OpenSSL exception.
 
 #include "chat_archiver.h"
+#include "activity_sketch.h"
+#include "change_log.h"
+#include "history_crawler.h"
+#include "media_archiver.h"
+#include "participant_cache.h"
+#include "cold_storage.h"
+#include "database_pool.h"
+#include "mcp_helpers.h"
+#include "semantic_search.h"
+#include "wallet_sync.h"
+#include "core/core_tracing.h"
 #include "data/data_session.h"
+#include "data/data_changes.h"
 #include "data/data_peer.h"
 #include "data/data_user.h"
 #include "data/data_chat.h"
 #include "data/data_channel.h"
 #include "data/data_messages.h"
 #include "data/data_document.h"
+#include "data/data_file_origin.h"
+#include "data/data_media_types.h"
+#include "data/data_photo.h"
+#include "data/data_photo_media.h"
 #include "history/history.h"
 #include "history/history_item.h"
 #include "history/history_item_components.h"
+#include "main/main_session.h"
 
 #include <QtCore/QFile>
 #include <QtCore/QDir>
 #include <QtCore/QFileInfo>
-#include <QtCore/QTextStream>
 #include <QtCore/QCryptographicHash>
 #include <QtCore/QTimer>
+#include <QtCore/QThread>
+#include <QtCore/QMutexLocker>
 #include <QtCore/QJsonDocument>
+#include <QtCore/QPointer>
 #include <QtSql/QSqlError>
 #include <QtSql/QSqlRecord>
 
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <tuple>
+
+#include <zlib.h>
+
 namespace MCP {
+namespace {
+
+constexpr auto kIngestBatchSize = std::size_t(500);
+constexpr auto kLiveFlushDelay = 250; // ms
+constexpr auto kExportPageSize = 2000;
+constexpr auto kColdSegmentSize = 4096;
+
+// Covers keyset reads: equal timestamps are ordered by message_id.
+constexpr auto kChatTimestampIndex = "CREATE INDEX IF NOT EXISTS "
+	"idx_messages_chat_timestamp "
+	"ON messages(chat_id, timestamp DESC, message_id DESC)";
+constexpr auto kExportBufferSize = qsizetype(256 * 1024);
+
+// PRAGMA user_version of an archive with every migration applied.
+constexpr auto kSchemaVersion = 10;
+
+// Builds over every archived row, run after the start on the writer.
+constexpr auto kFullTextBuild = "full_text";
+constexpr auto kRollupsBuild = "rollups";
+
+// Messages indexed per writer job of the full-text build.
+constexpr auto kFullTextBuildChunk = qint64(20000);
+
+// While a full-text build runs the triggers index the rows up to
+// indexed_till and the ones added after it started, the rest is left
+// to the build.
+constexpr auto kFullTextIndexed = "NOT EXISTS (SELECT 1 FROM fts_build_state) "
+	"OR %1.id <= (SELECT indexed_till FROM fts_build_state) "
+	"OR %1.id > (SELECT last_id FROM fts_build_state)";
+
+bool AddPendingBuild(QSqlQuery &query, const QString &name) {
+	query.prepare("INSERT OR IGNORE INTO schema_pending_builds (name) VALUES (:name)");
+	query.bindValue(":name", name);
+	if (!query.exec()) {
+		qWarning() << "SQL Error:" << query.lastError().text();
+		return false;
+	}
+	return true;
+}
+
+bool RemovePendingBuild(QSqlQuery &query, const QString &name) {
+	query.prepare("DELETE FROM schema_pending_builds WHERE name = :name");
+	query.bindValue(":name", name);
+	return query.exec();
+}
+
+// Buffers export output and writes it to the file either as is or
+// through a gzip stream, so the export holds at most one buffer.
+class ExportSink final {
+public:
+	ExportSink(const QString &path, bool compress, bool append)
+	: _file(path)
+	, _compress(compress)
+	, _append(append) {
+	}
+	ExportSink(const ExportSink &other) = delete;
+	ExportSink &operator=(const ExportSink &other) = delete;
+	~ExportSink() {
+		if (_deflating) {
+			deflateEnd(&_stream);
+		}
+	}
+
+	bool open() {
+		const auto mode = _append
+			? (QIODevice::WriteOnly | QIODevice::Append)
+			: (QIODevice::WriteOnly | QIODevice::Truncate);
+		if (!_file.open(mode)) {
+			return fail(_file.errorString());
+		}
+		if (_compress) {
+			// windowBits 15 + 16 adds the gzip header and trailer. An
+			// appended part is a new gzip member, gunzip reads them all.
+			const auto result = deflateInit2(
+				&_stream,
+				Z_BEST_SPEED,
+				Z_DEFLATED,
+				15 + 16,
+				8,
+				Z_DEFAULT_STRATEGY);
+			if (result != Z_OK) {
+				return fail("Failed to start gzip stream");
+			}
+			_deflating = true;
+			_chunk.resize(kExportBufferSize);
+		}
+		_buffer.reserve(kExportBufferSize);
+		return true;
+	}
+
+	bool write(const QByteArray &data) {
+		_buffer.append(data);
+		return (_buffer.size() < kExportBufferSize) || flush(false);
+	}
+
+	bool finish() {
+		if (!flush(true)) {
+			return false;
+		} else if (!_file.flush()) {
+			return fail(_file.errorString());
+		}
+		return true;
+	}
+
+	[[nodiscard]] qint64 bytesWritten() const { return _written; }
+	[[nodiscard]] QString error() const { return _error; }
+
+private:
+	bool flush(bool last) {
+		if (!_compress) {
+			if (_file.write(_buffer) != _buffer.size()) {
+				return fail(_file.errorString());
+			}
+			_written += _buffer.size();
+			_buffer.resize(0);
+			return true;
+		}
+		_stream.next_in = reinterpret_cast<Bytef*>(_buffer.data());
+		_stream.avail_in = uInt(_buffer.size());
+		do {
+			_stream.next_out = reinterpret_cast<Bytef*>(_chunk.data());
+			_stream.avail_out = uInt(_chunk.size());
+			if (deflate(&_stream, last ? Z_FINISH : Z_NO_FLUSH) == Z_STREAM_ERROR) {
+				return fail("gzip stream error");
+			}
+			const auto produced = _chunk.size() - qsizetype(_stream.avail_out);
+			if (_file.write(_chunk.constData(), produced) != produced) {
+				return fail(_file.errorString());
+			}
+			_written += produced;
+		} while (_stream.avail_out == 0);
+		_buffer.resize(0);
+		return true;
+	}
+
+	bool fail(const QString &error) {
+		_error = error;
+		return false;
+	}
+
+	QFile _file;
+	const bool _compress = false;
+	const bool _append = false;
+	z_stream _stream = {};
+	bool _deflating = false;
+	QByteArray _buffer;
+	QByteArray _chunk;
+	qint64 _written = 0;
+	QString _error;
+};
+
+// Turns free-form user input into a safe FTS5 MATCH expression: every
+// term or "quoted phrase" becomes a string token so operators and
+// punctuation can't break the query. unicode61 keeps a run of CJK
+// ideographs as a single token, those terms are matched by prefix.
+[[nodiscard]] QString FullTextMatchExpression(const QString &query) {
+	auto terms = QStringList();
+	auto current = QString();
+	auto inPhrase = false;
+	const auto flush = [&] {
+		auto term = current.trimmed();
+		current.clear();
+		auto prefix = term.endsWith('*');
+		while (term.endsWith('*')) {
+			term.chop(1);
+		}
+		term = term.trimmed();
+		if (term.isEmpty()) {
+			return;
+		}
+		prefix = prefix || std::any_of(
+			term.begin(),
+			term.end(),
+			IsUnsegmentedScript);
+		terms.push_back('"' + term + '"' + (prefix ? "*" : ""));
+	};
+	for (const auto ch : query) {
+		if (ch == '"') {
+			if (inPhrase) {
+				flush();
+			}
+			inPhrase = !inPhrase;
+		} else if (ch.isSpace() && !inPhrase) {
+			flush();
+		} else {
+			current.append(ch);
+		}
+	}
+	flush();
+	return terms.join(' ');
+}
+
+} // namespace
+
+QString ArchiveSearchFilter::sqlConditions(const QString &alias) const {
+	auto result = QString();
+	if (chatId) {
+		result += QString(" AND %1.chat_id = :chat_id").arg(alias);
+	}
+	if (userId) {
+		result += QString(" AND %1.user_id = :user_id").arg(alias);
+	}
+	if (after) {
+		result += QString(" AND %1.timestamp >= :after").arg(alias);
+	}
+	if (before) {
+		result += QString(" AND %1.timestamp <= :before").arg(alias);
+	}
+	return result;
+}
+
+void ArchiveSearchFilter::bind(QSqlQuery &query) const {
+	if (chatId) {
+		query.bindValue(":chat_id", chatId);
+	}
+	if (userId) {
+		query.bindValue(":user_id", userId);
+	}
+	if (after) {
+		query.bindValue(":after", after);
+	}
+	if (before) {
+		query.bindValue(":before", before);
+	}
+}
+
+QString ExportCursor::serialize() const {
+	return QString("%1:%2").arg(timestamp).arg(rowId);
+}
+
+ExportCursor ExportCursor::Parse(const QString &value) {
+	const auto parts = value.split(':');
+	if (parts.size() != 2) {
+		return ExportCursor();
+	}
+	auto result = ExportCursor();
+	result.timestamp = parts[0].toLongLong();
+	result.rowId = parts[1].toLongLong();
+	return result;
+}
+
+QString MessageCursor::serialize() const {
+	return QString::fromLatin1(QString("%1:%2").arg(
+		timestamp
+	).arg(
+		messageId
+	).toLatin1().toBase64(
+		QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals));
+}
+
+MessageCursor MessageCursor::Parse(const QString &value) {
+	const auto decoded = QString::fromLatin1(QByteArray::fromBase64(
+		value.toLatin1(),
+		QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals));
+	const auto parts = decoded.split(':');
+	if (parts.size() != 2) {
+		return MessageCursor();
+	}
+	auto result = MessageCursor();
+	result.timestamp = parts[0].toLongLong();
+	result.messageId = parts[1].toLongLong();
+	return result;
+}
 
 // ===================================
 // ChatArchiver Implementation
@@ -31,68 +320,381 @@ namespace MCP {
 
 ChatArchiver::ChatArchiver(QObject *parent)
 	: QObject(parent)
-	, _checkTimer(new QTimer(this)) {
+	, _flushTimer(new QTimer(this)) {
 
-	connect(_checkTimer, &QTimer::timeout, this, &ChatArchiver::checkForNewMessages);
+	_flushTimer->setSingleShot(true);
+	connect(_flushTimer, &QTimer::timeout, this, &ChatArchiver::flushLiveRows);
 }
 
 ChatArchiver::~ChatArchiver() {
 	stop();
 }
 
-bool ChatArchiver::start(const QString &databasePath) {
+void ChatArchiver::start(
+		DatabasePool *pool,
+		std::function<void(bool)> done) {
 	if (_isRunning) {
-		return true;
+		done(true);
+		return;
+	} else if (_starting) {
+		return;
+	} else if (!pool || !pool->isOpen()) {
+		Q_EMIT error("Archive database is not open");
+		done(false);
+		return;
 	}
 
-	_databasePath = databasePath;
-
-	// Initialize SQLite database
-	_db = QSqlDatabase::addDatabase("QSQLITE", "telegram_mcp_archive");
-	_db.setDatabaseName(databasePath);
+	// Schema changes go through the shared writer like every other write,
+	// migrating an older archive doesn't block the main thread meanwhile.
+	_starting = pool;
+	const auto weak = QPointer<ChatArchiver>(this);
+	pool->write([=](QSqlDatabase &db) {
+		auto fullTextIndex = false;
+		auto builds = QStringList();
+		const auto initialized = migrate(db, fullTextIndex, builds);
+		crl::on_main(weak, [=] {
+			started(initialized, fullTextIndex, builds, done);
+		});
+	});
+}
 
-	if (!_db.open()) {
-		Q_EMIT error("Failed to open database: " + _db.lastError().text());
+bool ChatArchiver::migrate(
+		QSqlDatabase &db,
+		bool &fullTextIndex,
+		QStringList &builds) {
+	QSqlQuery query(db);
+	query.exec("PRAGMA user_version");
+	const auto version = query.next() ? query.value(0).toInt() : 0;
+	if (version < kSchemaVersion && !applyMigrations(db, version)) {
 		return false;
 	}
 
-	// Enable performance optimizations
-	QSqlQuery pragmas(_db);
-	pragmas.exec("PRAGMA journal_mode = WAL");  // Write-Ahead Logging for better concurrency
-	pragmas.exec("PRAGMA synchronous = NORMAL");  // Balance safety/performance
-	pragmas.exec("PRAGMA cache_size = -64000");  // 64MB cache
-	pragmas.exec("PRAGMA temp_store = MEMORY");  // Use memory for temp tables
-	pragmas.exec("PRAGMA mmap_size = 268435456");  // 256MB memory-mapped I/O
+	// A current schema is only read, no DDL runs.
+	if (query.exec("SELECT name FROM schema_pending_builds")) {
+		while (query.next()) {
+			builds.push_back(query.value(0).toString());
+		}
+	}
+	query.exec("SELECT name FROM sqlite_master WHERE type='table' AND name='messages_fts'");
+	fullTextIndex = query.next() && !builds.contains(kFullTextBuild);
+	return true;
+}
 
-	// Initialize schema
-	if (!initializeDatabase()) {
-		Q_EMIT error("Failed to initialize database schema");
-		_db.close();
+bool ChatArchiver::applyMigrations(QSqlDatabase &db, int from) {
+	struct Migration {
+		int version = 0;
+		const char *name = nullptr;
+		bool (*apply)(QSqlDatabase &db) = nullptr;
+		bool optional = false;
+	};
+	// Each step is idempotent, archives from before the versioning have
+	// user_version 0 and go through all of them once.
+	constexpr auto migrations = std::array{
+		Migration{ 1, "base", &ChatArchiver::initializeDatabase },
+		// Searches fall back to LIKE when SQLite was built without FTS5.
+		Migration{ 2, "full_text", &ChatArchiver::initializeFullTextIndex, true },
+		Migration{ 3, "cold_storage", &ChatArchiver::initializeColdStorage },
+		Migration{ 4, "rollups", &ChatArchiver::initializeRollups },
+		// Tables of the components started after the archiver.
+		Migration{ 5, "participants", &ParticipantCache::CreateTables },
+		Migration{ 6, "crawl_state", &HistoryCrawler::CreateTables },
+		Migration{ 7, "media_archive", &MediaArchiver::CreateTables },
+		Migration{ 8, "change_log", &ChangeLog::CreateTable },
+		Migration{ 9, "full_text_build", &ChatArchiver::initializeFullTextBuild, true },
+		Migration{ 10, "wallet", &WalletSync::CreateTables },
+	};
+	static_assert(migrations.back().version == kSchemaVersion);
+
+	if (!db.transaction()) {
+		qWarning() << "SQL Error:" << db.lastError().text();
+		return false;
+	}
+	QSqlQuery query(db);
+	const auto fail = [&](const char *name) {
+		qWarning()
+			<< "MCP: Schema migration"
+			<< name
+			<< "failed:"
+			<< query.lastError().text();
+		db.rollback();
+		return false;
+	};
+	if (!query.exec(R"(CREATE TABLE IF NOT EXISTS schema_pending_builds (
+			name TEXT PRIMARY KEY
+		))")) {
+		return fail("pending_builds");
+	}
+	for (const auto &migration : migrations) {
+		if (migration.version <= from) {
+			continue;
+		} else if (!migration.optional) {
+			if (!migration.apply(db)) {
+				return fail(migration.name);
+			}
+			continue;
+		}
+		query.exec("SAVEPOINT optional_migration");
+		if (!migration.apply(db)) {
+			qWarning() << "MCP: Skipped schema migration" << migration.name;
+			query.exec("ROLLBACK TO optional_migration");
+		}
+		query.exec("RELEASE optional_migration");
+	}
+	if (!query.exec(QString("PRAGMA user_version = %1").arg(kSchemaVersion))) {
+		return fail("user_version");
+	}
+	if (!db.commit()) {
+		qWarning() << "SQL Error:" << db.lastError().text();
+		db.rollback();
 		return false;
 	}
+	qInfo()
+		<< "MCP: Archive schema migrated from version"
+		<< from
+		<< "to"
+		<< kSchemaVersion;
+	return true;
+}
+
+void ChatArchiver::runPendingBuilds(const QStringList &builds) {
+	const auto cancelled = std::make_shared<std::atomic<bool>>(false);
+	_buildsCancelled = cancelled;
+	const auto weak = QPointer<ChatArchiver>(this);
+	for (const auto &name : builds) {
+		const auto done = [=](bool built) {
+			crl::on_main(weak, [=] {
+				buildFinished(cancelled, name, built);
+			});
+		};
+		if (name == kFullTextBuild) {
+			RunFullTextBuild(_pool, cancelled, done);
+		} else if (name == kRollupsBuild) {
+			RunRollupsBuild(_pool, cancelled, done);
+		}
+	}
+}
+
+void ChatArchiver::buildFinished(
+		const std::shared_ptr<std::atomic<bool>> &cancelled,
+		const QString &name,
+		bool built) {
+	if (cancelled != _buildsCancelled) {
+		return;
+	} else if (!built) {
+		qWarning() << "MCP: Failed to build" << name;
+	} else if (name == kFullTextBuild) {
+		_fullTextIndex = true;
+	}
+}
+
+void ChatArchiver::RunFullTextBuild(
+		not_null<DatabasePool*> pool,
+		std::shared_ptr<const std::atomic<bool>> cancelled,
+		std::function<void(bool)> done) {
+	pool->write([=](QSqlDatabase &db) {
+		if (*cancelled) {
+			return;
+		} else if (!db.transaction()) {
+			qWarning() << "SQL Error:" << db.lastError().text();
+			done(false);
+			return;
+		}
+		QSqlQuery query(db);
+		const auto fail = [&] {
+			qWarning() << "SQL Error:" << query.lastError().text();
+			db.rollback();
+			done(false);
+		};
+		auto indexed = qint64(0);
+		auto last = qint64(0);
+		if (!query.exec("SELECT indexed_till, last_id FROM fts_build_state")) {
+			return fail();
+		} else if (query.next()) {
+			indexed = query.value(0).toLongLong();
+			last = query.value(1).toLongLong();
+		} else {
+			// Whatever the triggers indexed before the build is dropped,
+			// from now on they index only the rows the build won't reach.
+			if (!query.exec("INSERT INTO messages_fts(messages_fts) VALUES ('delete-all')")
+				|| !query.exec("SELECT COALESCE(MAX(id), 0) FROM messages")
+				|| !query.next()) {
+				return fail();
+			}
+			last = query.value(0).toLongLong();
+			query.prepare("INSERT INTO fts_build_state (indexed_till, last_id) VALUES (0, :last_id)");
+			query.bindValue(":last_id", last);
+			if (!query.exec()) {
+				return fail();
+			}
+		}
+
+		const auto till = std::min(indexed + kFullTextBuildChunk, last);
+		query.prepare(R"(INSERT INTO messages_fts(rowid, content)
+			SELECT id, content FROM messages
+			WHERE id > :from AND id <= :till)");
+		query.bindValue(":from", indexed);
+		query.bindValue(":till", till);
+		if (!query.exec()) {
+			return fail();
+		}
+		const auto finished = (till >= last);
+		if (finished) {
+			if (!query.exec("DELETE FROM fts_build_state")
+				|| !RemovePendingBuild(query, kFullTextBuild)) {
+				return fail();
+			}
+		} else {
+			query.prepare("UPDATE fts_build_state SET indexed_till = :till");
+			query.bindValue(":till", till);
+			if (!query.exec()) {
+				return fail();
+			}
+		}
+		if (!db.commit()) {
+			qWarning() << "SQL Error:" << db.lastError().text();
+			db.rollback();
+			done(false);
+		} else if (finished) {
+			done(true);
+		} else {
+			RunFullTextBuild(pool, cancelled, done);
+		}
+	});
+}
+
+void ChatArchiver::RunRollupsBuild(
+		not_null<DatabasePool*> pool,
+		std::shared_ptr<const std::atomic<bool>> cancelled,
+		std::function<void(bool)> done) {
+	pool->write([=](QSqlDatabase &db) {
+		if (*cancelled) {
+			return;
+		}
+		QSqlQuery query(db);
+		if (!query.exec("SELECT DISTINCT chat_id FROM messages")) {
+			qWarning() << "SQL Error:" << query.lastError().text();
+			done(false);
+			return;
+		}
+		auto chats = std::vector<qint64>();
+		while (query.next()) {
+			chats.push_back(query.value(0).toLongLong());
+		}
+		RunChatRollupsBuild(
+			pool,
+			cancelled,
+			std::make_shared<const std::vector<qint64>>(std::move(chats)),
+			0,
+			done);
+	});
+}
+
+void ChatArchiver::RunChatRollupsBuild(
+		not_null<DatabasePool*> pool,
+		std::shared_ptr<const std::atomic<bool>> cancelled,
+		std::shared_ptr<const std::vector<qint64>> chats,
+		std::size_t index,
+		std::function<void(bool)> done) {
+	// One chat per job, the triggers keep the rebuilt ones up to date.
+	pool->write([=](QSqlDatabase &db) {
+		if (*cancelled) {
+			return;
+		}
+		QSqlQuery query(db);
+		const auto finished = (index + 1 >= chats->size());
+		auto built = db.transaction();
+		if (built && index < chats->size()) {
+			built = rebuildRollups(db, (*chats)[index]);
+		}
+		if (built && finished) {
+			built = RemovePendingBuild(query, kRollupsBuild);
+		}
+		if (built && !db.commit()) {
+			qWarning() << "SQL Error:" << db.lastError().text();
+			built = false;
+		}
+		if (!built) {
+			db.rollback();
+			done(false);
+		} else if (finished) {
+			done(true);
+		} else {
+			RunChatRollupsBuild(pool, cancelled, chats, index + 1, done);
+		}
+	});
+}
 
-	// Start periodic message checking (every 5 seconds)
-	_checkTimer->start(5000);
+void ChatArchiver::started(
+		bool initialized,
+		bool fullTextIndex,
+		const QStringList &builds,
+		const std::function<void(bool)> &done) {
+	const auto pool = base::take(_starting);
+	if (!pool) {
+		// Stopped while the schema job was running.
+		return;
+	} else if (!initialized) {
+		Q_EMIT error("Failed to initialize database schema");
+		done(false);
+		return;
+	}
 
+	_pool = pool;
+	_fullTextIndex = fullTextIndex;
+	_coldStorage = std::make_unique<ColdStorage>(
+		QFileInfo(_pool->path()).absolutePath() + "/cold");
 	_isRunning = true;
 	updateStats();
 
-	return true;
+	// Archives written before an index existed are indexed in the
+	// background, until then searches use LIKE.
+	runPendingBuilds(builds);
+
+	done(true);
 }
 
 void ChatArchiver::stop() {
+	// A schema job still running reports to nobody, see started().
+	_starting = nullptr;
 	if (!_isRunning) {
 		return;
 	}
 
-	_checkTimer->stop();
-	_db.close();
+	_sessionLifetime.destroy();
+	flushLiveRows();
+	if (const auto cancelled = base::take(_buildsCancelled)) {
+		// The chunk running now is the last one, the build is started
+		// over by the next start.
+		*cancelled = true;
+	}
+	_participantCache = nullptr;
+	_mediaArchiver = nullptr;
+	_crawler = nullptr;
+	_coldStorage = nullptr;
+	_pool = nullptr;
 	_isRunning = false;
 }
 
-bool ChatArchiver::initializeDatabase() {
+QSqlDatabase ChatArchiver::database() const {
+	return _pool ? _pool->reader() : QSqlDatabase();
+}
+
+bool ChatArchiver::initializeDatabase(QSqlDatabase &db) {
 	// Check if schema exists
-	QSqlQuery query(_db);
+	QSqlQuery query(db);
+
+	// Older schemas rescanned the whole chat on every inserted row, the
+	// summaries are now adjusted per row by initializeRollups() triggers.
+	query.exec("DROP TRIGGER IF EXISTS update_chat_stats_on_insert");
+
+	// Older schemas indexed the timestamp alone, so pages ending inside
+	// one second needed a sort of every message from that second.
+	query.exec("SELECT COUNT(*) FROM pragma_index_info('idx_messages_chat_timestamp')");
+	if (query.next() && query.value(0).toInt() == 2) {
+		query.exec("DROP INDEX idx_messages_chat_timestamp");
+		query.exec(kChatTimestampIndex);
+	}
+
 	query.exec("SELECT name FROM sqlite_master WHERE type='table' AND name='messages'");
 
 	if (query.next()) {
@@ -128,11 +730,12 @@ bool ChatArchiver::initializeDatabase() {
 			is_reply BOOLEAN DEFAULT 0,
 			metadata TEXT,
 			created_at INTEGER DEFAULT (strftime('%s', 'now')),
+			cold_segment INTEGER,
 			UNIQUE(chat_id, message_id)
 		))",
 
 		// Indexes for messages
-		R"(CREATE INDEX IF NOT EXISTS idx_messages_chat_timestamp ON messages(chat_id, timestamp DESC))",
+		kChatTimestampIndex,
 		R"(CREATE INDEX IF NOT EXISTS idx_messages_user ON messages(user_id, timestamp DESC))",
 
 		// Ephemeral messages table
@@ -182,7 +785,174 @@ bool ChatArchiver::initializeDatabase() {
 			updated_at INTEGER
 		))",
 
-		// Daily stats table
+		// Schema version
+		R"(CREATE TABLE IF NOT EXISTS schema_version (
+			version INTEGER PRIMARY KEY,
+			applied_at INTEGER DEFAULT (strftime('%s', 'now'))
+		))",
+
+		// Set schema version
+		R"(INSERT OR REPLACE INTO schema_version (version) VALUES (2))"
+	};
+
+	for (const QString &statement : statements) {
+		if (!query.exec(statement)) {
+			qWarning() << "SQL Error:" << query.lastError().text();
+			qWarning() << "Statement:" << statement.left(100);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool ChatArchiver::initializeFullTextIndex(QSqlDatabase &db) {
+	QSqlQuery query(db);
+	query.exec("SELECT name FROM sqlite_master WHERE type='table' AND name='messages_fts'");
+	const auto exists = query.next();
+
+	// External-content table: only the index is stored, the text stays
+	// in messages and is read back by rowid for snippets.
+	const QStringList statements = {
+		R"(CREATE VIRTUAL TABLE IF NOT EXISTS messages_fts USING fts5(
+			content,
+			content='messages',
+			content_rowid='id',
+			tokenize='unicode61 remove_diacritics 2'
+		))",
+
+		R"(CREATE TRIGGER IF NOT EXISTS messages_fts_insert
+		AFTER INSERT ON messages
+		BEGIN
+			INSERT INTO messages_fts(rowid, content) VALUES (NEW.id, NEW.content);
+		END)",
+
+		R"(CREATE TRIGGER IF NOT EXISTS messages_fts_delete
+		AFTER DELETE ON messages
+		BEGIN
+			INSERT INTO messages_fts(messages_fts, rowid, content)
+			VALUES ('delete', OLD.id, OLD.content);
+		END)",
+
+		R"(CREATE TRIGGER IF NOT EXISTS messages_fts_update
+		AFTER UPDATE OF content ON messages
+		BEGIN
+			INSERT INTO messages_fts(messages_fts, rowid, content)
+			VALUES ('delete', OLD.id, OLD.content);
+			INSERT INTO messages_fts(rowid, content) VALUES (NEW.id, NEW.content);
+		END)",
+
+		R"(DROP INDEX IF EXISTS idx_messages_content_fts)",
+		R"(INSERT OR REPLACE INTO schema_version (version) VALUES (3))"
+	};
+
+	for (const QString &statement : statements) {
+		if (!query.exec(statement)) {
+			qWarning() << "MCP: Full-text index unavailable:" << query.lastError().text();
+			return false;
+		}
+	}
+
+	// Archives created before the index existed are indexed once.
+	return exists || AddPendingBuild(query, kFullTextBuild);
+}
+
+bool ChatArchiver::initializeFullTextBuild(QSqlDatabase &db) {
+	QSqlQuery query(db);
+	query.exec("SELECT name FROM sqlite_master WHERE type='table' AND name='messages_fts'");
+	if (!query.next()) {
+		return true;
+	}
+
+	// The build indexes the archive in chunks of rows, the triggers
+	// must neither index nor delete the rows it hasn't reached yet.
+	const auto indexed = [](const char *row) {
+		return QString(kFullTextIndexed).arg(row);
+	};
+	const QStringList statements = {
+		R"(CREATE TABLE IF NOT EXISTS fts_build_state (
+			indexed_till INTEGER NOT NULL,
+			last_id INTEGER NOT NULL
+		))",
+
+		R"(DROP TRIGGER IF EXISTS messages_fts_insert)",
+		R"(DROP TRIGGER IF EXISTS messages_fts_delete)",
+		R"(DROP TRIGGER IF EXISTS messages_fts_update)",
+
+		QString(R"(CREATE TRIGGER messages_fts_insert
+		AFTER INSERT ON messages
+		WHEN %1
+		BEGIN
+			INSERT INTO messages_fts(rowid, content) VALUES (NEW.id, NEW.content);
+		END)").arg(indexed("NEW")),
+
+		QString(R"(CREATE TRIGGER messages_fts_delete
+		AFTER DELETE ON messages
+		WHEN %1
+		BEGIN
+			INSERT INTO messages_fts(messages_fts, rowid, content)
+			VALUES ('delete', OLD.id, OLD.content);
+		END)").arg(indexed("OLD")),
+
+		QString(R"(CREATE TRIGGER messages_fts_update
+		AFTER UPDATE OF content ON messages
+		WHEN %1
+		BEGIN
+			INSERT INTO messages_fts(messages_fts, rowid, content)
+			VALUES ('delete', OLD.id, OLD.content);
+			INSERT INTO messages_fts(rowid, content) VALUES (NEW.id, NEW.content);
+		END)").arg(indexed("OLD")),
+	};
+	for (const auto &statement : statements) {
+		if (!query.exec(statement)) {
+			qWarning() << "MCP: Full-text build state unavailable:" << query.lastError().text();
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ChatArchiver::initializeColdStorage(QSqlDatabase &db) {
+	QSqlQuery query(db);
+
+	// Archives created before tiering get the segment pointer column.
+	query.exec("SELECT COUNT(*) FROM pragma_table_info('messages') WHERE name = 'cold_segment'");
+	if (query.next() && !query.value(0).toInt()
+		&& !query.exec("ALTER TABLE messages ADD COLUMN cold_segment INTEGER")) {
+		qWarning() << "SQL Error:" << query.lastError().text();
+		return false;
+	}
+
+	const QStringList statements = {
+		// One row per segment file, id is the messages.id of its first row
+		R"(CREATE TABLE IF NOT EXISTS cold_segments (
+			id INTEGER PRIMARY KEY,
+			chat_id INTEGER NOT NULL,
+			first_timestamp INTEGER NOT NULL,
+			last_timestamp INTEGER NOT NULL,
+			message_count INTEGER NOT NULL,
+			bytes INTEGER NOT NULL,
+			created_at INTEGER DEFAULT (strftime('%s', 'now'))
+		))",
+		R"(CREATE INDEX IF NOT EXISTS idx_cold_segments_chat ON cold_segments(chat_id, last_timestamp))",
+	};
+	for (const QString &statement : statements) {
+		if (!query.exec(statement)) {
+			qWarning() << "SQL Error:" << query.lastError().text();
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ChatArchiver::initializeRollups(QSqlDatabase &db) {
+	QSqlQuery query(db);
+	query.exec("SELECT name FROM sqlite_master WHERE type='trigger' AND name='message_rollups_insert'");
+	const auto exists = query.next();
+	query.exec("SELECT name FROM sqlite_master WHERE type='trigger' AND name='message_cube_insert'");
+	const auto cubeExists = query.next();
+
+	const QStringList statements = {
 		R"(CREATE TABLE IF NOT EXISTS message_stats_daily (
 			id INTEGER PRIMARY KEY AUTOINCREMENT,
 			date TEXT NOT NULL,
@@ -194,8 +964,18 @@ bool ChatArchiver::initializeDatabase() {
 			media_count INTEGER DEFAULT 0,
 			UNIQUE(date, chat_id)
 		))",
+		R"(CREATE INDEX IF NOT EXISTS idx_stats_daily_chat ON message_stats_daily(chat_id, date DESC))",
+
+		// Messages per (chat, day, user): exact distinct user counts for
+		// any range of days without touching messages.
+		R"(CREATE TABLE IF NOT EXISTS user_activity_daily (
+			chat_id INTEGER NOT NULL,
+			date TEXT NOT NULL,
+			user_id INTEGER NOT NULL,
+			message_count INTEGER DEFAULT 0,
+			PRIMARY KEY(chat_id, date, user_id)
+		) WITHOUT ROWID)",
 
-		// User activity summary
 		R"(CREATE TABLE IF NOT EXISTS user_activity_summary (
 			id INTEGER PRIMARY KEY AUTOINCREMENT,
 			user_id INTEGER NOT NULL,
@@ -210,197 +990,825 @@ bool ChatArchiver::initializeDatabase() {
 			updated_at INTEGER,
 			UNIQUE(user_id, chat_id)
 		))",
+		R"(CREATE INDEX IF NOT EXISTS idx_user_activity_chat ON user_activity_summary(chat_id, message_count DESC))",
 
-		// Schema version
-		R"(CREATE TABLE IF NOT EXISTS schema_version (
-			version INTEGER PRIMARY KEY,
-			applied_at INTEGER DEFAULT (strftime('%s', 'now'))
-		))",
+		// Messages per (chat, hour, user, type), hour = timestamp / 3600.
+		// Hour of day, day of week and hourly series are summed from it
+		// in memory, integer buckets need no strftime() per row.
+		R"(CREATE TABLE IF NOT EXISTS message_activity_hourly (
+			chat_id INTEGER NOT NULL,
+			hour INTEGER NOT NULL,
+			user_id INTEGER NOT NULL,
+			message_type TEXT NOT NULL,
+			message_count INTEGER DEFAULT 0,
+			total_length INTEGER DEFAULT 0,
+			PRIMARY KEY(chat_id, hour, user_id, message_type)
+		) WITHOUT ROWID)",
+		R"(CREATE INDEX IF NOT EXISTS idx_activity_hourly_user ON message_activity_hourly(user_id, hour))",
+
+		// HyperLogLog and Space-Saving sketches per (day, chat), chat_id 0
+		// for all chats. message_count is the rollup count they were
+		// built from, refreshActivitySketches() rebuilds on a mismatch.
+		R"(CREATE TABLE IF NOT EXISTS activity_sketches_daily (
+			date TEXT NOT NULL,
+			chat_id INTEGER NOT NULL,
+			message_count INTEGER NOT NULL,
+			users BLOB,
+			top_users BLOB,
+			top_chats BLOB,
+			PRIMARY KEY(date, chat_id)
+		) WITHOUT ROWID)",
+		R"(CREATE INDEX IF NOT EXISTS idx_activity_sketches_chat ON activity_sketches_daily(chat_id, date))",
+	};
+	for (const QString &statement : statements) {
+		if (!query.exec(statement)) {
+			qWarning() << "SQL Error:" << query.lastError().text();
+			return false;
+		}
+	}
 
-		// Trigger to update chat stats
-		R"(CREATE TRIGGER IF NOT EXISTS update_chat_stats_on_insert
+	// Columns the triggers maintain on top of the original layout.
+	const auto columns = std::vector<std::pair<QString, QString>>{
+		{ "message_stats_daily", "text_count INTEGER DEFAULT 0" },
+		{ "message_stats_daily", "edited_count INTEGER DEFAULT 0" },
+		{ "message_stats_daily", "total_length INTEGER DEFAULT 0" },
+		{ "message_stats_daily", "first_timestamp INTEGER" },
+		{ "message_stats_daily", "last_timestamp INTEGER" },
+		{ "user_activity_summary", "user_name TEXT" },
+		{ "user_activity_summary", "reply_count INTEGER DEFAULT 0" },
+		{ "user_activity_summary", "total_length INTEGER DEFAULT 0" },
+	};
+	for (const auto &[table, column] : columns) {
+		const auto name = column.section(' ', 0, 0);
+		query.exec(QString("SELECT COUNT(*) FROM pragma_table_info('%1') WHERE name = '%2'").arg(table, name));
+		if (query.next() && !query.value(0).toInt()
+			&& !query.exec(QString("ALTER TABLE %1 ADD COLUMN %2").arg(table, column))) {
+			qWarning() << "SQL Error:" << query.lastError().text();
+			return false;
+		}
+	}
+
+	// Every stored row is added to and every removed row subtracted from
+	// the rollups, INSERT OR REPLACE fires both through recursive_triggers.
+	// MIN/MAX of a chat and day are looked up again by index on removal,
+	// the per-user first/last dates only grow; rebuildAnalytics() resets.
+	const auto day = [](const char *row) {
+		return QString("date(%1.timestamp, 'unixepoch')").arg(row);
+	};
+	const auto user = [](const char *row) {
+		return QString("COALESCE(%1.user_id, 0)").arg(row);
+	};
+	const auto length = [](const char *row) {
+		return QString("COALESCE(LENGTH(%1.content), 0)").arg(row);
+	};
+	const auto words = [](const char *row) {
+		return QString("COALESCE(LENGTH(%1.content) - LENGTH(REPLACE(%1.content, ' ', ''))"
+			" + (LENGTH(%1.content) > 0), 0)").arg(row);
+	};
+	const auto dayMessages = [&](const char *row) {
+		return QString("COALESCE((SELECT message_count FROM user_activity_daily"
+			" WHERE chat_id = %1.chat_id AND date = %2 AND user_id = %3), 0)"
+		).arg(row, day(row), user(row));
+	};
+	const auto chatMessages = [&](const char *row) {
+		return QString("COALESCE((SELECT message_count FROM user_activity_summary"
+			" WHERE user_id = %1 AND chat_id = %2.chat_id), 0)"
+		).arg(user(row), row);
+	};
+	const auto triggers = QStringList{
+		QString(R"(CREATE TRIGGER IF NOT EXISTS message_rollups_insert
 		AFTER INSERT ON messages
 		BEGIN
-			INSERT OR REPLACE INTO chat_activity_summary (
+			INSERT INTO user_activity_daily (chat_id, date, user_id, message_count)
+			VALUES (NEW.chat_id, %1, %2, 1)
+			ON CONFLICT(chat_id, date, user_id) DO UPDATE SET
+				message_count = message_count + 1;
+
+			INSERT INTO message_stats_daily (
+				date, chat_id, message_count, unique_users, text_count,
+				media_count, edited_count, total_length, total_words,
+				avg_message_length, first_timestamp, last_timestamp)
+			VALUES (%1, NEW.chat_id, 1, 1, NEW.message_type = 'text',
+				COALESCE(NEW.has_media, 0) != 0, NEW.edit_date IS NOT NULL,
+				%3, %4, %3, NEW.timestamp, NEW.timestamp)
+			ON CONFLICT(date, chat_id) DO UPDATE SET
+				message_count = message_count + 1,
+				unique_users = unique_users + (%5 = 1),
+				text_count = text_count + excluded.text_count,
+				media_count = media_count + excluded.media_count,
+				edited_count = edited_count + excluded.edited_count,
+				total_length = total_length + excluded.total_length,
+				total_words = total_words + excluded.total_words,
+				avg_message_length = (total_length + excluded.total_length) * 1.0 / (message_count + 1),
+				first_timestamp = MIN(first_timestamp, excluded.first_timestamp),
+				last_timestamp = MAX(last_timestamp, excluded.last_timestamp);
+
+			INSERT INTO user_activity_summary (
+				user_id, chat_id, user_name, message_count, reply_count,
+				total_length, word_count, avg_message_length, days_active,
+				first_message_date, last_message_date, updated_at)
+			VALUES (%2, NEW.chat_id, COALESCE(NEW.first_name, NEW.username), 1,
+				NEW.reply_to_message_id IS NOT NULL, %3, %4, %3, 1,
+				NEW.timestamp, NEW.timestamp, strftime('%s', 'now'))
+			ON CONFLICT(user_id, chat_id) DO UPDATE SET
+				user_name = COALESCE(excluded.user_name, user_name),
+				message_count = message_count + 1,
+				reply_count = reply_count + excluded.reply_count,
+				total_length = total_length + excluded.total_length,
+				word_count = word_count + excluded.word_count,
+				avg_message_length = (total_length + excluded.total_length) * 1.0 / (message_count + 1),
+				days_active = days_active + (%5 = 1),
+				first_message_date = MIN(first_message_date, excluded.first_message_date),
+				last_message_date = MAX(last_message_date, excluded.last_message_date),
+				updated_at = excluded.updated_at;
+
+			INSERT INTO chat_activity_summary (
 				chat_id, total_messages, unique_users,
-				first_message_date, last_message_date, updated_at
-			)
-			SELECT NEW.chat_id, COUNT(*), COUNT(DISTINCT user_id),
-				MIN(timestamp), MAX(timestamp), strftime('%s', 'now')
-			FROM messages WHERE chat_id = NEW.chat_id;
-		END)",
-
-		// Set schema version
-		R"(INSERT OR REPLACE INTO schema_version (version) VALUES (2))"
+				first_message_date, last_message_date, updated_at)
+			VALUES (NEW.chat_id, 1, 1, NEW.timestamp, NEW.timestamp, strftime('%s', 'now'))
+			ON CONFLICT(chat_id) DO UPDATE SET
+				total_messages = total_messages + 1,
+				unique_users = unique_users + (%6 = 1),
+				first_message_date = MIN(first_message_date, excluded.first_message_date),
+				last_message_date = MAX(last_message_date, excluded.last_message_date),
+				updated_at = excluded.updated_at;
+		END)").arg(
+			day("NEW"),
+			user("NEW"),
+			length("NEW"),
+			words("NEW"),
+			dayMessages("NEW"),
+			chatMessages("NEW")),
+
+		QString(R"(CREATE TRIGGER IF NOT EXISTS message_rollups_delete
+		AFTER DELETE ON messages
+		BEGIN
+			UPDATE user_activity_daily SET message_count = message_count - 1
+			WHERE chat_id = OLD.chat_id AND date = %1 AND user_id = %2;
+
+			UPDATE message_stats_daily SET
+				message_count = message_count - 1,
+				unique_users = unique_users - (%5 = 0),
+				text_count = text_count - (OLD.message_type = 'text'),
+				media_count = media_count - (COALESCE(OLD.has_media, 0) != 0),
+				edited_count = edited_count - (OLD.edit_date IS NOT NULL),
+				total_length = total_length - %3,
+				total_words = total_words - %4,
+				avg_message_length = (total_length - %3) * 1.0 / MAX(message_count - 1, 1),
+				first_timestamp = (SELECT MIN(timestamp) FROM messages
+					WHERE chat_id = OLD.chat_id AND date(timestamp, 'unixepoch') = %1
+						AND timestamp BETWEEN OLD.timestamp - 86400 AND OLD.timestamp + 86400),
+				last_timestamp = (SELECT MAX(timestamp) FROM messages
+					WHERE chat_id = OLD.chat_id AND date(timestamp, 'unixepoch') = %1
+						AND timestamp BETWEEN OLD.timestamp - 86400 AND OLD.timestamp + 86400)
+			WHERE date = %1 AND chat_id = OLD.chat_id;
+
+			UPDATE user_activity_summary SET
+				message_count = message_count - 1,
+				reply_count = reply_count - (OLD.reply_to_message_id IS NOT NULL),
+				total_length = total_length - %3,
+				word_count = word_count - %4,
+				avg_message_length = (total_length - %3) * 1.0 / MAX(message_count - 1, 1),
+				days_active = days_active - (%5 = 0)
+			WHERE user_id = %2 AND chat_id = OLD.chat_id;
+
+			UPDATE chat_activity_summary SET
+				total_messages = total_messages - 1,
+				unique_users = unique_users - (%6 = 0),
+				first_message_date = (SELECT MIN(timestamp) FROM messages WHERE chat_id = OLD.chat_id),
+				last_message_date = (SELECT MAX(timestamp) FROM messages WHERE chat_id = OLD.chat_id)
+			WHERE chat_id = OLD.chat_id;
+
+			DELETE FROM user_activity_daily
+			WHERE chat_id = OLD.chat_id AND date = %1 AND user_id = %2 AND message_count <= 0;
+			DELETE FROM message_stats_daily
+			WHERE date = %1 AND chat_id = OLD.chat_id AND message_count <= 0;
+			DELETE FROM user_activity_summary
+			WHERE user_id = %2 AND chat_id = OLD.chat_id AND message_count <= 0;
+		END)").arg(
+			day("OLD"),
+			user("OLD"),
+			length("OLD"),
+			words("OLD"),
+			dayMessages("OLD"),
+			chatMessages("OLD")),
+
+		QString(R"(CREATE TRIGGER IF NOT EXISTS message_cube_insert
+		AFTER INSERT ON messages
+		BEGIN
+			INSERT INTO message_activity_hourly (
+				chat_id, hour, user_id, message_type, message_count, total_length)
+			VALUES (NEW.chat_id, NEW.timestamp / 3600, %1,
+				COALESCE(NEW.message_type, ''), 1, %2)
+			ON CONFLICT(chat_id, hour, user_id, message_type) DO UPDATE SET
+				message_count = message_count + 1,
+				total_length = total_length + excluded.total_length;
+		END)").arg(user("NEW"), length("NEW")),
+
+		QString(R"(CREATE TRIGGER IF NOT EXISTS message_cube_delete
+		AFTER DELETE ON messages
+		BEGIN
+			UPDATE message_activity_hourly SET
+				message_count = message_count - 1,
+				total_length = total_length - %2
+			WHERE chat_id = OLD.chat_id AND hour = OLD.timestamp / 3600
+				AND user_id = %1 AND message_type = COALESCE(OLD.message_type, '');
+			DELETE FROM message_activity_hourly
+			WHERE chat_id = OLD.chat_id AND hour = OLD.timestamp / 3600
+				AND user_id = %1 AND message_type = COALESCE(OLD.message_type, '')
+				AND message_count <= 0;
+		END)").arg(user("OLD"), length("OLD")),
 	};
 
-	for (const QString &statement : statements) {
+	for (const QString &statement : triggers) {
 		if (!query.exec(statement)) {
-			qWarning() << "SQL Error:" << query.lastError().text();
-			qWarning() << "Statement:" << statement.left(100);
+			qWarning() << "MCP: Failed to create rollup triggers:" << query.lastError().text();
 			return false;
 		}
 	}
 
+	// Archives written before the triggers existed are summed up once.
+	return (exists && cubeExists) || AddPendingBuild(query, kRollupsBuild);
+}
+
+bool ChatArchiver::rebuildRollups(QSqlDatabase &db, qint64 chatId) {
+	const auto trace = Core::Tracing::Scope("archive", "rebuildRollups", chatId);
+	const auto filter = chatId ? QString("WHERE chat_id = :chat_id") : QString();
+	const auto words = QString("COALESCE(LENGTH(content) - LENGTH(REPLACE(content, ' ', ''))"
+		" + (LENGTH(content) > 0), 0)");
+	const auto statements = QStringList{
+		QString("DELETE FROM user_activity_daily %1").arg(filter),
+		QString("DELETE FROM message_stats_daily %1").arg(filter),
+		QString("DELETE FROM user_activity_summary %1").arg(filter),
+		QString("DELETE FROM chat_activity_summary %1").arg(filter),
+		QString("DELETE FROM message_activity_hourly %1").arg(filter),
+		chatId
+			? QString("DELETE FROM activity_sketches_daily WHERE chat_id = 0 OR chat_id = :chat_id")
+			: QString("DELETE FROM activity_sketches_daily"),
+
+		QString(R"(INSERT INTO message_activity_hourly (
+				chat_id, hour, user_id, message_type, message_count, total_length)
+			SELECT chat_id, timestamp / 3600 AS bucket, COALESCE(user_id, 0) AS user,
+				COALESCE(message_type, '') AS type, COUNT(*), SUM(COALESCE(LENGTH(content), 0))
+			FROM messages %1
+			GROUP BY chat_id, bucket, user, type)").arg(filter),
+
+		QString(R"(INSERT INTO user_activity_daily (chat_id, date, user_id, message_count)
+			SELECT chat_id, date(timestamp, 'unixepoch') AS day, COALESCE(user_id, 0), COUNT(*)
+			FROM messages %1
+			GROUP BY chat_id, day, COALESCE(user_id, 0))").arg(filter),
+
+		QString(R"(INSERT INTO message_stats_daily (
+				date, chat_id, message_count, unique_users, text_count,
+				media_count, edited_count, total_length, total_words,
+				avg_message_length, first_timestamp, last_timestamp)
+			SELECT date(timestamp, 'unixepoch') AS day, chat_id, COUNT(*),
+				COUNT(DISTINCT COALESCE(user_id, 0)),
+				SUM(message_type = 'text'),
+				SUM(COALESCE(has_media, 0) != 0),
+				SUM(edit_date IS NOT NULL),
+				SUM(COALESCE(LENGTH(content), 0)),
+				SUM(%2),
+				AVG(COALESCE(LENGTH(content), 0)),
+				MIN(timestamp), MAX(timestamp)
+			FROM messages %1
+			GROUP BY chat_id, day)").arg(filter, words),
+
+		QString(R"(INSERT INTO user_activity_summary (
+				user_id, chat_id, user_name, message_count, reply_count,
+				total_length, word_count, avg_message_length, days_active,
+				first_message_date, last_message_date, updated_at)
+			SELECT COALESCE(user_id, 0) AS user, chat_id,
+				MAX(COALESCE(first_name, username)), COUNT(*),
+				SUM(reply_to_message_id IS NOT NULL),
+				SUM(COALESCE(LENGTH(content), 0)),
+				SUM(%2),
+				AVG(COALESCE(LENGTH(content), 0)),
+				COUNT(DISTINCT date(timestamp, 'unixepoch')),
+				MIN(timestamp), MAX(timestamp), strftime('%s', 'now')
+			FROM messages %1
+			GROUP BY user, chat_id)").arg(filter, words),
+
+		QString(R"(INSERT INTO chat_activity_summary (
+				chat_id, total_messages, unique_users,
+				first_message_date, last_message_date, updated_at)
+			SELECT chat_id, COUNT(*), COUNT(DISTINCT COALESCE(user_id, 0)),
+				MIN(timestamp), MAX(timestamp), strftime('%s', 'now')
+			FROM messages %1
+			GROUP BY chat_id)").arg(filter),
+	};
+
+	QSqlQuery query(db);
+	for (const auto &statement : statements) {
+		query.prepare(statement);
+		if (chatId) {
+			query.bindValue(":chat_id", chatId);
+		}
+		if (!query.exec()) {
+			qWarning() << "MCP: Failed to rebuild analytics rollups:" << query.lastError().text();
+			return false;
+		}
+	}
 	return true;
 }
 
-bool ChatArchiver::executeSQLFile(const QString &filePath) {
-	QFile file(filePath);
-	if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+bool ChatArchiver::rebuildAnalytics(qint64 chatId) {
+	if (!_isRunning) {
 		return false;
 	}
+	auto rebuilt = false;
+	_pool->writeAndWait([&](QSqlDatabase &db) {
+		if (!db.transaction()) {
+			return;
+		}
+		rebuilt = rebuildRollups(db, chatId) && db.commit();
+		if (!rebuilt) {
+			db.rollback();
+		}
+	});
+	return rebuilt;
+}
 
-	QString sql = QTextStream(&file).readAll();
-	file.close();
+bool ChatArchiver::refreshActivitySketches(
+		const QString &from,
+		const QString &till) {
+	if (!_isRunning) {
+		return false;
+	}
+	auto refreshed = false;
+	_pool->writeAndWait([&](QSqlDatabase &db) {
+		if (!db.transaction()) {
+			return;
+		}
+		refreshed = refreshActivitySketches(db, from, till) && db.commit();
+		if (!refreshed) {
+			db.rollback();
+		}
+	});
+	return refreshed;
+}
 
-	// Split by semicolons and execute each statement
-	QStringList statements = sql.split(';', Qt::SkipEmptyParts);
+bool ChatArchiver::refreshActivitySketches(
+		QSqlDatabase &db,
+		const QString &from,
+		const QString &till) {
+	QSqlQuery query(db);
+	auto fail = [&] {
+		qWarning() << "MCP: Failed to refresh activity sketches:" << query.lastError().text();
+		return false;
+	};
+	auto store = [&](
+			const QString &date,
+			qint64 chatId,
+			qint64 messageCount,
+			const HyperLogLog &users,
+			const SpaceSaving &topUsers,
+			const SpaceSaving *topChats) {
+		query.prepare(R"(INSERT OR REPLACE INTO activity_sketches_daily
+			(date, chat_id, message_count, users, top_users, top_chats)
+			VALUES (?, ?, ?, ?, ?, ?))");
+		query.addBindValue(date);
+		query.addBindValue(chatId);
+		query.addBindValue(messageCount);
+		query.addBindValue(users.serialize());
+		query.addBindValue(topUsers.serialize());
+		query.addBindValue(topChats ? topChats->serialize() : QByteArray());
+		return query.exec();
+	};
 
-	QSqlQuery query(_db);
-	for (const QString &statement : statements) {
-		QString trimmed = statement.trimmed();
-		if (trimmed.isEmpty() || trimmed.startsWith("--")) {
-			continue;
+	// A chat and day is stale when its rollup count moved. A removal and
+	// an addition on the same day cancel out, rebuild_analytics resets.
+	auto stale = std::vector<std::tuple<QString, qint64, qint64>>();
+	query.prepare(R"(SELECT s.date, s.chat_id, s.message_count
+		FROM message_stats_daily s
+		LEFT JOIN activity_sketches_daily k ON k.date = s.date AND k.chat_id = s.chat_id
+		WHERE s.date BETWEEN ? AND ?
+			AND (k.message_count IS NULL OR k.message_count != s.message_count))");
+	query.addBindValue(from);
+	query.addBindValue(till);
+	if (!query.exec()) {
+		return fail();
+	}
+	while (query.next()) {
+		stale.emplace_back(
+			query.value(0).toString(),
+			query.value(1).toLongLong(),
+			query.value(2).toLongLong());
+	}
+	for (const auto &[date, chatId, messageCount] : stale) {
+		auto users = HyperLogLog();
+		auto topUsers = SpaceSaving();
+		query.prepare(R"(SELECT user_id, message_count FROM user_activity_daily
+			WHERE chat_id = ? AND date = ?)");
+		query.addBindValue(chatId);
+		query.addBindValue(date);
+		if (!query.exec()) {
+			return fail();
 		}
-
-		if (!query.exec(trimmed)) {
-			qWarning() << "SQL Error:" << query.lastError().text();
-			qWarning() << "Statement:" << trimmed;
-			return false;
+		while (query.next()) {
+			const auto userId = query.value(0).toLongLong();
+			users.add(userId);
+			topUsers.add(userId, query.value(1).toLongLong());
+		}
+		if (!store(date, chatId, messageCount, users, topUsers, nullptr)) {
+			return fail();
 		}
 	}
 
+	// Chats whose day was removed from the rollups entirely.
+	query.prepare(R"(DELETE FROM activity_sketches_daily
+		WHERE chat_id != 0 AND date BETWEEN ? AND ?
+			AND NOT EXISTS (SELECT 1 FROM message_stats_daily s
+				WHERE s.date = activity_sketches_daily.date
+					AND s.chat_id = activity_sketches_daily.chat_id))");
+	query.addBindValue(from);
+	query.addBindValue(till);
+	if (!query.exec()) {
+		return fail();
+	}
+
+	// All chats of a day are a merge of the per-chat sketches.
+	auto staleDays = std::vector<std::pair<QString, qint64>>();
+	query.prepare(R"(SELECT s.date, SUM(s.message_count) AS total,
+			(SELECT message_count FROM activity_sketches_daily k
+				WHERE k.date = s.date AND k.chat_id = 0) AS sketched
+		FROM message_stats_daily s
+		WHERE s.date BETWEEN ? AND ?
+		GROUP BY s.date)");
+	query.addBindValue(from);
+	query.addBindValue(till);
+	if (!query.exec()) {
+		return fail();
+	}
+	while (query.next()) {
+		const auto total = query.value(1).toLongLong();
+		if (query.value(2).isNull() || query.value(2).toLongLong() != total) {
+			staleDays.emplace_back(query.value(0).toString(), total);
+		}
+	}
+	for (const auto &[date, messageCount] : staleDays) {
+		auto users = HyperLogLog();
+		auto topUsers = SpaceSaving();
+		auto topChats = SpaceSaving();
+		query.prepare(R"(SELECT chat_id, message_count, users, top_users
+			FROM activity_sketches_daily WHERE date = ? AND chat_id != 0)");
+		query.addBindValue(date);
+		if (!query.exec()) {
+			return fail();
+		}
+		while (query.next()) {
+			topChats.add(query.value(0).toLongLong(), query.value(1).toLongLong());
+			users.merge(HyperLogLog::FromSerialized(query.value(2).toByteArray()));
+			topUsers.merge(SpaceSaving::FromSerialized(query.value(3).toByteArray()));
+		}
+		if (!store(date, 0, messageCount, users, topUsers, &topChats)) {
+			return fail();
+		}
+	}
+	query.prepare(R"(DELETE FROM activity_sketches_daily
+		WHERE chat_id = 0 AND date BETWEEN ? AND ?
+			AND NOT EXISTS (SELECT 1 FROM message_stats_daily s
+				WHERE s.date = activity_sketches_daily.date))");
+	query.addBindValue(from);
+	query.addBindValue(till);
+	if (!query.exec()) {
+		return fail();
+	}
 	return true;
 }
 
-bool ChatArchiver::archiveMessage(HistoryItem *message) {
-	if (!message || !_isRunning) {
-		return false;
+QString ArchivedEntities(const TextWithEntities &text) {
+	auto entities = QJsonArray();
+	for (const auto &entity : text.entities) {
+		const auto type = [&]() -> std::optional<EntityType> {
+			switch (entity.type()) {
+			case ::EntityType::Url:
+			case ::EntityType::CustomUrl: return EntityType::URL;
+			case ::EntityType::Email: return EntityType::Email;
+			case ::EntityType::Phone: return EntityType::PhoneNumber;
+			case ::EntityType::Hashtag: return EntityType::Hashtag;
+			case ::EntityType::Mention:
+			case ::EntityType::MentionName: return EntityType::UserMention;
+			case ::EntityType::BotCommand: return EntityType::BotCommand;
+			case ::EntityType::CustomEmoji: return EntityType::CustomEmoji;
+			default: return std::nullopt;
+			}
+		}();
+		if (!type) {
+			continue;
+		}
+		auto object = QJsonObject{
+			{ "type", EntityTypeName(*type) },
+			{ "offset", entity.offset() },
+			{ "length", entity.length() },
+		};
+		if (!entity.data().isEmpty()) {
+			object["data"] = entity.data();
+		}
+		entities.append(object);
 	}
+	return entities.isEmpty()
+		? QString()
+		: QString::fromUtf8(QJsonDocument(
+			QJsonObject{ { "entities", entities } }
+		).toJson(QJsonDocument::Compact));
+}
 
+ArchivedMessageRow ChatArchiver::extractMessageRow(HistoryItem *message) {
 	// Extract message data
 	const auto item = message;
 	const auto history = item->history();
 	const auto peer = history->peer;
-	const qint64 chatId = peer->id.value;
-	const qint64 messageId = item->id.bare;
 	const auto from = item->from();
-	const qint64 userId = from ? from->id.value : 0;
+
+	auto row = ArchivedMessageRow();
+	row.chatId = peer->id.value;
+	row.messageId = item->id.bare;
+	row.userId = from ? from->id.value : 0;
+	if (from) {
+		if (const auto user = from->asUser()) {
+			row.username = user->username();
+			row.firstName = user->firstName;
+			row.lastName = user->lastName;
+		} else {
+			row.username = from->name();
+		}
+	}
 
 	// Get message content
-	QString content = item->originalText().text;
-	const qint64 timestamp = item->date();  // TimeId is already a Unix timestamp (int32)
-	QString date = QDateTime::fromSecsSinceEpoch(timestamp).toString(Qt::ISODate);
+	const auto text = item->originalText();
+	row.content = text.text;
+	row.metadata = ArchivedEntities(text);
+	row.timestamp = item->date();  // TimeId is already a Unix timestamp (int32)
 
 	// Detect message type
-	MessageType msgType = detectMessageType(message);
-	QString messageTypeStr = messageTypeToString(msgType);
+	row.messageType = messageTypeToString(detectMessageType(message));
 
 	// Check for reply
-	qint64 replyToId = 0;
 	if (const auto replyTo = item->replyToId()) {
-		replyToId = replyTo.bare;
+		row.replyToId = replyTo.bare;
 	}
 
 	// Check for forward
-	qint64 forwardChatId = 0;
-	qint64 forwardMessageId = 0;
-	bool isForwarded = item->Has<HistoryMessageForwarded>();
+	row.isForwarded = item->Has<HistoryMessageForwarded>();
 
 	// Media handling
-	QString mediaPath;
-	QString mediaUrl;
-	qint64 mediaSize = 0;
-	QString mediaMimeType;
-	bool hasMedia = false;
-
 	if (item->media()) {
-		hasMedia = true;
-		mediaPath = downloadMedia(message);
+		row.hasMedia = true;
+		row.mediaPath = downloadMedia(message);
 		// Media URL would be file_id in Telegram
 		// mediaUrl = ... (extract from media)
 	}
+	return row;
+}
 
-	// Prepare SQL insert
-	QSqlQuery query(_db);
-	query.prepare(R"(
+bool ChatArchiver::archiveMessage(HistoryItem *message) {
+	if (!message || !_isRunning) {
+		return false;
+	}
+	return archiveRows({ extractMessageRow(message) }) == 1;
+}
+
+int ChatArchiver::archiveMessages(const std::vector<HistoryItem*> &messages) {
+	if (!_isRunning) {
+		return 0;
+	}
+	auto rows = std::vector<ArchivedMessageRow>();
+	rows.reserve(messages.size());
+	for (const auto message : messages) {
+		if (message) {
+			rows.push_back(extractMessageRow(message));
+		}
+	}
+	return archiveRows(rows);
+}
+
+int ChatArchiver::archiveRows(const std::vector<ArchivedMessageRow> &rows) {
+	if (!_isRunning || rows.empty()) {
+		return 0;
+	}
+
+	auto stored = std::size_t(0);
+	_pool->writeAndWait([&](QSqlDatabase &db) {
+		stored = insertBatches(db, rows);
+	});
+	if (!stored) {
+		return 0;
+	}
+
+	for (auto i = std::size_t(0); i != stored; ++i) {
+		Q_EMIT messageArchived(rows[i].chatId, rows[i].messageId);
+	}
+	return int(stored);
+}
+
+std::size_t ChatArchiver::insertBatches(
+		QSqlDatabase &db,
+		const std::vector<ArchivedMessageRow> &rows) {
+	// Compiled once per writer connection, see StatementCache.
+	auto query = PreparedQuery(db, R"(
 		INSERT OR REPLACE INTO messages (
 			message_id, chat_id, user_id, username, first_name, last_name,
 			content, timestamp, date, message_type,
 			reply_to_message_id, forward_from_chat_id, forward_from_message_id,
 			media_path, media_url, media_size, media_mime_type,
-			has_media, is_forwarded, is_reply
+			has_media, is_forwarded, is_reply, metadata
 		) VALUES (
 			:message_id, :chat_id, :user_id, :username, :first_name, :last_name,
 			:content, :timestamp, :date, :message_type,
 			:reply_to_id, :fwd_chat_id, :fwd_msg_id,
 			:media_path, :media_url, :media_size, :media_mime_type,
-			:has_media, :is_forwarded, :is_reply
+			:has_media, :is_forwarded, :is_reply, :metadata
 		)
 	)");
 
-	query.bindValue(":message_id", messageId);
-	query.bindValue(":chat_id", chatId);
-	query.bindValue(":user_id", userId);
+	// One WAL commit per batch instead of one per message.
+	auto stored = std::size_t(0);
+	while (stored < rows.size()) {
+		const auto till = std::min(stored + kIngestBatchSize, rows.size());
+		if (!db.transaction()) {
+			qWarning() << "Failed to begin archive transaction:" << db.lastError().text();
+			break;
+		}
+		if (!insertRows(*query, rows, stored, till)) {
+			db.rollback();
+			break;
+		}
+		if (!db.commit()) {
+			qWarning() << "Failed to commit archived messages:" << db.lastError().text();
+			db.rollback();
+			break;
+		}
+		stored = till;
+	}
+	if (!stored) {
+		return 0;
+	}
+
+	// Analytics rollups are kept current by the message_rollups triggers.
+	return stored;
+}
+
+bool ChatArchiver::insertRows(
+		QSqlQuery &query,
+		const std::vector<ArchivedMessageRow> &rows,
+		std::size_t from,
+		std::size_t till) {
+	const auto trace = Core::Tracing::Scope("archive", "insertRows");
+	const auto text = [](const QString &value) {
+		return value.isNull() ? QVariant() : QVariant(value);
+	};
+	const auto optional = [](const QString &value) {
+		return value.isEmpty() ? QVariant() : QVariant(value);
+	};
+	const auto id = [](qint64 value) {
+		return value > 0 ? QVariant(value) : QVariant();
+	};
+	for (auto i = from; i != till; ++i) {
+		const auto &row = rows[i];
+		query.bindValue(":message_id", row.messageId);
+		query.bindValue(":chat_id", row.chatId);
+		query.bindValue(":user_id", row.userId);
+		query.bindValue(":username", text(row.username));
+		query.bindValue(":first_name", text(row.firstName));
+		query.bindValue(":last_name", text(row.lastName));
+		query.bindValue(":content", row.content);
+		query.bindValue(":timestamp", row.timestamp);
+		query.bindValue(":date", QDateTime::fromSecsSinceEpoch(row.timestamp).toString(Qt::ISODate));
+		query.bindValue(":message_type", row.messageType);
+		query.bindValue(":reply_to_id", id(row.replyToId));
+		query.bindValue(":fwd_chat_id", id(row.forwardChatId));
+		query.bindValue(":fwd_msg_id", id(row.forwardMessageId));
+		query.bindValue(":media_path", optional(row.mediaPath));
+		query.bindValue(":media_url", optional(row.mediaUrl));
+		query.bindValue(":media_size", id(row.mediaSize));
+		query.bindValue(":media_mime_type", optional(row.mediaMimeType));
+		query.bindValue(":has_media", row.hasMedia);
+		query.bindValue(":is_forwarded", row.isForwarded);
+		query.bindValue(":is_reply", row.replyToId > 0);
+		query.bindValue(":metadata", text(row.metadata));
+
+		if (!query.exec()) {
+			qWarning() << "Failed to archive message:" << query.lastError().text();
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ChatArchiver::archiveChat(qint64 chatId, int messageLimit) {
+	return _crawler && _crawler->enqueue(chatId, messageLimit);
+}
+
+bool ChatArchiver::archiveAllChats(int messagesPerChat) {
+	return _crawler && (_crawler->enqueueAllChats(messagesPerChat) > 0);
+}
+
+bool ChatArchiver::cancelArchive(qint64 chatId) {
+	return _crawler && _crawler->cancel(chatId);
+}
+
+void ChatArchiver::setDataSession(Data::Session *session) {
+	_sessionLifetime.destroy();
+	flushLiveRows();
+	_participantCache = nullptr;
+	_mediaArchiver = nullptr;
+	_crawler = nullptr;
+	_session = session;
+	if (!_session || !_isRunning) {
+		return;
+	}
+	subscribeToSession();
+	_crawler = std::make_unique<HistoryCrawler>(_session, this, _pool);
+	connect(_crawler.get(), &HistoryCrawler::chatCompleted, this, [=](
+			qint64 chatId,
+			int messageCount) {
+		Q_EMIT chatArchived(chatId, messageCount);
+	});
+	connect(_crawler.get(), &HistoryCrawler::chatProgress, this, [=](
+			qint64 chatId,
+			int messageCount) {
+		Q_EMIT chatArchiveProgress(chatId, messageCount);
+	});
+	connect(_crawler.get(), &HistoryCrawler::chatFailed, this, [=](
+			qint64 chatId,
+			const QString &reason) {
+		Q_EMIT chatArchiveFailed(chatId, reason);
+		Q_EMIT error(QString("Failed to archive chat %1: %2").arg(chatId).arg(reason));
+	});
+
+	// Continue crawls interrupted by the previous shutdown.
+	if (const auto resumed = _crawler->resume()) {
+		qInfo() << "MCP: Resumed history crawl for" << resumed << "chats";
+	}
+
+	_mediaArchiver = std::make_unique<MediaArchiver>(
+		_session,
+		_pool,
+		QDir(QFileInfo(_pool->path()).absolutePath()).filePath("media/store"));
+	if (!_mediaArchiver->start()) {
+		_mediaArchiver = nullptr;
+	}
+
+	_participantCache = std::make_unique<ParticipantCache>(_session, _pool);
+	if (!_participantCache->start()) {
+		_participantCache = nullptr;
+	}
+}
 
-	if (from) {
-		if (const auto user = from->asUser()) {
-			query.bindValue(":username", user->username());
-			query.bindValue(":first_name", user->firstName);
-			query.bindValue(":last_name", user->lastName);
-		} else {
-			query.bindValue(":username", from->name());
-			query.bindValue(":first_name", QVariant());
-			query.bindValue(":last_name", QVariant());
-		}
-	} else {
-		query.bindValue(":username", QVariant());
-		query.bindValue(":first_name", QVariant());
-		query.bindValue(":last_name", QVariant());
-	}
-
-	query.bindValue(":content", content);
-	query.bindValue(":timestamp", timestamp);
-	query.bindValue(":date", date);
-	query.bindValue(":message_type", messageTypeStr);
-	query.bindValue(":reply_to_id", replyToId > 0 ? replyToId : QVariant());
-	query.bindValue(":fwd_chat_id", forwardChatId > 0 ? forwardChatId : QVariant());
-	query.bindValue(":fwd_msg_id", forwardMessageId > 0 ? forwardMessageId : QVariant());
-	query.bindValue(":media_path", mediaPath.isEmpty() ? QVariant() : mediaPath);
-	query.bindValue(":media_url", mediaUrl.isEmpty() ? QVariant() : mediaUrl);
-	query.bindValue(":media_size", mediaSize > 0 ? mediaSize : QVariant());
-	query.bindValue(":media_mime_type", mediaMimeType.isEmpty() ? QVariant() : mediaMimeType);
-	query.bindValue(":has_media", hasMedia);
-	query.bindValue(":is_forwarded", isForwarded);
-	query.bindValue(":is_reply", replyToId > 0);
+void ChatArchiver::subscribeToSession() {
+	_session->newItemAdded(
+	) | rpl::start_with_next([=](not_null<HistoryItem*> item) {
+		onNewMessage(item);
+	}, _sessionLifetime);
+
+	_session->session().changes().messageUpdates(
+		Data::MessageUpdate::Flag::Edited
+	) | rpl::start_with_next([=](const Data::MessageUpdate &update) {
+		onMessageEdited(update.item);
+	}, _sessionLifetime);
+}
 
-	if (!query.exec()) {
-		qWarning() << "Failed to archive message:" << query.lastError().text();
-		return false;
+void ChatArchiver::queueLiveRow(HistoryItem *message) {
+	// Local, scheduled and sponsored items have no server id yet.
+	if (!message || !_isRunning || !message->isRegular()) {
+		return;
 	}
 
-	// Update analytics
-	updateDailyStats(chatId, QDateTime::fromSecsSinceEpoch(timestamp).date());
-	updateUserActivity(userId, chatId);
-	updateChatActivity(chatId);
+	// Extract now rather than keeping the item: it may be destroyed
+	// before the flush.
+	auto row = extractMessageRow(message);
+	const auto key = std::make_pair(row.chatId, row.messageId);
+	_liveRows[key] = std::move(row);
 
-	Q_EMIT messageArchived(chatId, messageId);
-	return true;
+	if (_liveRows.size() >= kIngestBatchSize) {
+		flushLiveRows();
+	} else if (!_flushTimer->isActive()) {
+		_flushTimer->start(kLiveFlushDelay);
+	}
 }
 
-bool ChatArchiver::archiveChat(qint64 chatId, int messageLimit) {
-	// This would fetch messages from Data::Session and archive them
-	// Implementation requires access to tdesktop's message history APIs
-	// Placeholder for now
-	Q_UNUSED(chatId);
-	Q_UNUSED(messageLimit);
-	return false;
+void ChatArchiver::flushLiveRows() {
+	_flushTimer->stop();
+	if (_liveRows.empty()) {
+		return;
+	}
+
+	auto rows = std::vector<ArchivedMessageRow>();
+	rows.reserve(_liveRows.size());
+	for (auto &[key, row] : base::take(_liveRows)) {
+		rows.push_back(std::move(row));
+	}
+
+	const auto stored = archiveRows(rows);
+	if (stored < int(rows.size())) {
+		Q_EMIT error(QString("Failed to archive %1 live messages")
+			.arg(int(rows.size()) - stored));
+	}
 }
 
-bool ChatArchiver::archiveAllChats(int messagesPerChat) {
-	Q_UNUSED(messagesPerChat);
-	return false;
+QJsonObject ChatArchiver::crawlStatus() const {
+	return _crawler ? _crawler->status() : QJsonObject();
 }
 
 bool ChatArchiver::archiveEphemeralMessage(
@@ -432,33 +1840,40 @@ bool ChatArchiver::archiveEphemeralMessage(
 		mediaType = messageTypeToString(detectMessageType(message));
 	}
 
-	QSqlQuery query(_db);
-	query.prepare(R"(
-		INSERT OR REPLACE INTO ephemeral_messages (
-			message_id, chat_id, user_id, username,
-			ephemeral_type, ttl_seconds, content,
-			media_type, media_path, captured_at, scheduled_deletion
-		) VALUES (
-			:message_id, :chat_id, :user_id, :username,
-			:ephemeral_type, :ttl_seconds, :content,
-			:media_type, :media_path, :captured_at, :scheduled_deletion
-		)
-	)");
-
-	query.bindValue(":message_id", messageId);
-	query.bindValue(":chat_id", chatId);
-	query.bindValue(":user_id", userId);
-	query.bindValue(":username", username);
-	query.bindValue(":ephemeral_type", ephemeralType);
-	query.bindValue(":ttl_seconds", ttlSeconds);
-	query.bindValue(":content", content);
-	query.bindValue(":media_type", mediaType.isEmpty() ? QVariant() : mediaType);
-	query.bindValue(":media_path", mediaPath.isEmpty() ? QVariant() : mediaPath);
-	query.bindValue(":captured_at", capturedAt);
-	query.bindValue(":scheduled_deletion", scheduledDeletion);
+	auto stored = false;
+	_pool->writeAndWait([&](QSqlDatabase &db) {
+		QSqlQuery query(db);
+		query.prepare(R"(
+			INSERT OR REPLACE INTO ephemeral_messages (
+				message_id, chat_id, user_id, username,
+				ephemeral_type, ttl_seconds, content,
+				media_type, media_path, captured_at, scheduled_deletion
+			) VALUES (
+				:message_id, :chat_id, :user_id, :username,
+				:ephemeral_type, :ttl_seconds, :content,
+				:media_type, :media_path, :captured_at, :scheduled_deletion
+			)
+		)");
 
-	if (!query.exec()) {
-		qWarning() << "Failed to archive ephemeral message:" << query.lastError().text();
+		query.bindValue(":message_id", messageId);
+		query.bindValue(":chat_id", chatId);
+		query.bindValue(":user_id", userId);
+		query.bindValue(":username", username);
+		query.bindValue(":ephemeral_type", ephemeralType);
+		query.bindValue(":ttl_seconds", ttlSeconds);
+		query.bindValue(":content", content);
+		query.bindValue(":media_type", mediaType.isEmpty() ? QVariant() : mediaType);
+		query.bindValue(":media_path", mediaPath.isEmpty() ? QVariant() : mediaPath);
+		query.bindValue(":captured_at", capturedAt);
+		query.bindValue(":scheduled_deletion", scheduledDeletion);
+
+		if (!query.exec()) {
+			qWarning() << "Failed to archive ephemeral message:" << query.lastError().text();
+			return;
+		}
+		stored = true;
+	});
+	if (!stored) {
 		return false;
 	}
 
@@ -485,64 +1900,206 @@ bool ChatArchiver::isEphemeral(HistoryItem *message) const {
 }
 
 QJsonArray ChatArchiver::getMessages(qint64 chatId, int limit, qint64 beforeTimestamp) {
+	auto before = MessageCursor();
+	before.timestamp = beforeTimestamp;
+
 	QJsonArray result;
+	visitMessages(chatId, limit, before, [&](const QJsonObject &message) {
+		result.append(message);
+	});
+	return result;
+}
 
+int ChatArchiver::visitMessages(
+		qint64 chatId,
+		int limit,
+		const MessageCursor &before,
+		const std::function<void(const QJsonObject&)> &callback,
+		MessageCursor *last) {
+	const auto trace = Core::Tracing::Scope("archive", "visitMessages", chatId);
+	// A range scan on idx_messages_chat_timestamp from the cursor on, so
+	// reading page N costs the same as reading the first one.
 	QString sql = "SELECT * FROM messages WHERE chat_id = :chat_id";
-	if (beforeTimestamp > 0) {
-		sql += " AND timestamp < :before";
+	if (!before.empty()) {
+		sql += " AND (timestamp, message_id) < (:before_timestamp, :before_id)";
 	}
-	sql += " ORDER BY timestamp DESC LIMIT :limit";
+	sql += " ORDER BY timestamp DESC, message_id DESC LIMIT :limit";
 
-	QSqlQuery query(_db);
-	query.prepare(sql);
-	query.bindValue(":chat_id", chatId);
-	if (beforeTimestamp > 0) {
-		query.bindValue(":before", beforeTimestamp);
+	auto query = PreparedQuery(database(), sql);
+	query->bindValue(":chat_id", chatId);
+	if (!before.empty()) {
+		query->bindValue(":before_timestamp", before.timestamp);
+		query->bindValue(":before_id", before.messageId);
 	}
-	query.bindValue(":limit", limit);
+	query->bindValue(":limit", limit);
 
-	if (!query.exec()) {
-		qWarning() << "Query failed:" << query.lastError().text();
-		return result;
+	if (!query->exec()) {
+		qWarning() << "Query failed:" << query->lastError().text();
+		return 0;
 	}
 
-	while (query.next()) {
-		result.append(messageToJson(query));
+	auto visited = 0;
+	while (query->next()) {
+		callback(messageToJson(*query));
+		if (last) {
+			last->timestamp = query->value("timestamp").toLongLong();
+			last->messageId = query->value("message_id").toLongLong();
+		}
+		++visited;
+	}
+	return visited;
+}
+
+QJsonArray ChatArchiver::getMessagesById(
+		qint64 chatId,
+		const std::vector<qint64> &messageIds) {
+	const auto trace = Core::Tracing::Scope("archive", "getMessagesById", chatId);
+	QJsonArray result;
+	if (messageIds.empty()) {
+		return result;
 	}
 
+	// One lookup on the (chat_id, message_id) key for all of the ids.
+	auto placeholders = QStringList();
+	for (auto i = 0; i != int(messageIds.size()); ++i) {
+		placeholders.push_back(QString("?"));
+	}
+	auto query = PreparedQuery(
+		database(),
+		"SELECT * FROM messages WHERE chat_id = ? AND message_id IN ("
+			+ placeholders.join(',')
+			+ ")");
+	query->addBindValue(chatId);
+	for (const auto id : messageIds) {
+		query->addBindValue(id);
+	}
+	if (!query->exec()) {
+		qWarning() << "Query failed:" << query->lastError().text();
+		return result;
+	}
+	while (query->next()) {
+		result.append(messageToJson(*query));
+	}
 	return result;
 }
 
 QJsonArray ChatArchiver::searchMessages(qint64 chatId, const QString &query, int limit) {
+	const auto trace = Core::Tracing::Scope("archive", "searchMessages", chatId);
 	QJsonArray result;
 
-	QSqlQuery sqlQuery(_db);
-	sqlQuery.prepare(R"(
-		SELECT * FROM messages
-		WHERE chat_id = :chat_id
-		AND content LIKE :query
-		ORDER BY timestamp DESC
-		LIMIT :limit
-	)");
-	sqlQuery.bindValue(":chat_id", chatId);
-	sqlQuery.bindValue(":query", "%" + query + "%");
+	const auto chatFilter = (chatId != 0);
+	QSqlQuery sqlQuery(database());
+	if (_fullTextIndex) {
+		const auto match = FullTextMatchExpression(query);
+		if (match.isEmpty()) {
+			return result;
+		}
+		sqlQuery.prepare(QString(R"(
+			SELECT m.*,
+				snippet(messages_fts, 0, '**', '**', '...', 16) AS snippet,
+				bm25(messages_fts) AS relevance
+			FROM messages_fts
+			JOIN messages m ON m.id = messages_fts.rowid
+			WHERE messages_fts MATCH :match
+			%1
+			ORDER BY relevance
+			LIMIT :limit
+		)").arg(chatFilter ? "AND m.chat_id = :chat_id" : ""));
+		sqlQuery.bindValue(":match", match);
+	} else {
+		sqlQuery.prepare(QString(R"(
+			SELECT * FROM messages
+			WHERE content LIKE :query
+			%1
+			ORDER BY timestamp DESC
+			LIMIT :limit
+		)").arg(chatFilter ? "AND chat_id = :chat_id" : ""));
+		sqlQuery.bindValue(":query", "%" + query + "%");
+	}
+	if (chatFilter) {
+		sqlQuery.bindValue(":chat_id", chatId);
+	}
 	sqlQuery.bindValue(":limit", limit);
 
 	if (!sqlQuery.exec()) {
+		qWarning() << "MCP: Archive search failed:" << sqlQuery.lastError().text();
 		return result;
 	}
 
 	while (sqlQuery.next()) {
-		result.append(messageToJson(sqlQuery));
+		auto message = messageToJson(sqlQuery);
+		if (_fullTextIndex) {
+			message["snippet"] = sqlQuery.value("snippet").toString();
+			// bm25() is lower for better matches, report higher-is-better.
+			message["score"] = -sqlQuery.value("relevance").toDouble();
+		}
+		result.append(message);
+	}
+
+	return result;
+}
+
+std::vector<FullTextHit> ChatArchiver::searchFullText(
+		const QString &query,
+		const ArchiveSearchFilter &filter,
+		int limit) {
+	const auto trace = Core::Tracing::Scope("archive", "searchFullText");
+	const auto conditions = filter.sqlConditions("m");
+	auto sql = QString();
+	auto match = QString();
+	if (_fullTextIndex) {
+		match = FullTextMatchExpression(query);
+		if (match.isEmpty()) {
+			return {};
+		}
+		sql = QString(R"(
+			SELECT m.id,
+				snippet(messages_fts, 0, '**', '**', '...', 16),
+				bm25(messages_fts) AS relevance
+			FROM messages_fts
+			JOIN messages m ON m.id = messages_fts.rowid
+			WHERE messages_fts MATCH :match%1
+			ORDER BY relevance
+			LIMIT :limit
+		)").arg(conditions);
+	} else {
+		sql = QString(R"(
+			SELECT m.id, NULL, 0
+			FROM messages m
+			WHERE m.content LIKE :query%1
+			ORDER BY m.timestamp DESC
+			LIMIT :limit
+		)").arg(conditions);
+	}
+
+	auto sqlQuery = PreparedQuery(database(), sql);
+	if (_fullTextIndex) {
+		sqlQuery->bindValue(":match", match);
+	} else {
+		sqlQuery->bindValue(":query", "%" + query + "%");
 	}
+	filter.bind(*sqlQuery);
+	sqlQuery->bindValue(":limit", limit);
 
+	auto result = std::vector<FullTextHit>();
+	if (!sqlQuery->exec()) {
+		qWarning() << "MCP: Archive search failed:" << sqlQuery->lastError().text();
+		return result;
+	}
+	while (sqlQuery->next()) {
+		result.push_back({
+			sqlQuery->value(0).toLongLong(),
+			-sqlQuery->value(2).toDouble(),
+			sqlQuery->value(1).toString(),
+		});
+	}
 	return result;
 }
 
 QJsonObject ChatArchiver::getChatInfo(qint64 chatId) {
 	QJsonObject info;
 
-	QSqlQuery query(_db);
+	QSqlQuery query(database());
 	query.prepare("SELECT * FROM chats WHERE chat_id = :chat_id");
 	query.bindValue(":chat_id", chatId);
 
@@ -568,7 +2125,7 @@ QJsonObject ChatArchiver::getChatInfo(qint64 chatId) {
 QJsonArray ChatArchiver::listArchivedChats() {
 	QJsonArray result;
 
-	QSqlQuery query(_db);
+	QSqlQuery query(database());
 	query.exec(R"(
 		SELECT
 			c.chat_id,
@@ -597,28 +2154,42 @@ QJsonArray ChatArchiver::listArchivedChats() {
 
 // Analytics implementations
 QJsonObject ChatArchiver::getMessageStats(qint64 chatId, const QString &period) {
+	const auto trace = Core::Tracing::Scope("archive", "getMessageStats", chatId);
 	QJsonObject stats;
 
-	QString timeFilter;
+	QSqlQuery query(database());
 	if (period == "day") {
-		timeFilter = "AND timestamp > (strftime('%s', 'now') - 86400)";
-	} else if (period == "week") {
-		timeFilter = "AND timestamp > (strftime('%s', 'now') - 604800)";
-	} else if (period == "month") {
-		timeFilter = "AND timestamp > (strftime('%s', 'now') - 2592000)";
+		// Shorter than a rollup bucket, counted from the messages.
+		query.prepare(R"(
+			SELECT
+				COUNT(*) as total_messages,
+				COUNT(DISTINCT user_id) as unique_users,
+				AVG(LENGTH(content)) as avg_length,
+				SUM(LENGTH(content) - LENGTH(REPLACE(content, ' ', '')) + 1) as total_words,
+				COUNT(CASE WHEN has_media = 1 THEN 1 END) as media_count
+			FROM messages
+			WHERE chat_id = :chat_id
+				AND timestamp > (strftime('%s', 'now') - 86400)
+		)");
+	} else {
+		QString dateFilter;
+		if (period == "week") {
+			dateFilter = "AND date > date('now', '-7 days')";
+		} else if (period == "month") {
+			dateFilter = "AND date > date('now', '-30 days')";
+		}
+		query.prepare(QString(R"(
+			SELECT
+				SUM(message_count) as total_messages,
+				(SELECT COUNT(DISTINCT user_id) FROM user_activity_daily
+					WHERE chat_id = :chat_id %1) as unique_users,
+				SUM(total_length) * 1.0 / NULLIF(SUM(message_count), 0) as avg_length,
+				SUM(total_words) as total_words,
+				SUM(media_count) as media_count
+			FROM message_stats_daily
+			WHERE chat_id = :chat_id %1
+		)").arg(dateFilter));
 	}
-
-	QSqlQuery query(_db);
-	query.prepare(QString(R"(
-		SELECT
-			COUNT(*) as total_messages,
-			COUNT(DISTINCT user_id) as unique_users,
-			AVG(LENGTH(content)) as avg_length,
-			SUM(LENGTH(content) - LENGTH(REPLACE(content, ' ', '')) + 1) as total_words,
-			COUNT(CASE WHEN has_media = 1 THEN 1 END) as media_count
-		FROM messages
-		WHERE chat_id = :chat_id %1
-	)").arg(timeFilter));
 	query.bindValue(":chat_id", chatId);
 
 	if (query.exec() && query.next()) {
@@ -636,19 +2207,20 @@ QJsonObject ChatArchiver::getMessageStats(qint64 chatId, const QString &period)
 }
 
 QJsonObject ChatArchiver::getUserActivity(qint64 userId, qint64 chatId) {
+	const auto trace = Core::Tracing::Scope("archive", "getUserActivity", userId);
 	QJsonObject activity;
 
 	QString chatFilter = chatId > 0 ? "AND chat_id = :chat_id" : "";
 
-	QSqlQuery query(_db);
+	QSqlQuery query(database());
 	query.prepare(QString(R"(
 		SELECT
-			COUNT(*) as message_count,
-			SUM(LENGTH(content) - LENGTH(REPLACE(content, ' ', '')) + 1) as word_count,
-			AVG(LENGTH(content)) as avg_length,
-			MIN(timestamp) as first_message,
-			MAX(timestamp) as last_message
-		FROM messages
+			SUM(message_count) as message_count,
+			SUM(word_count) as word_count,
+			SUM(total_length) * 1.0 / NULLIF(SUM(message_count), 0) as avg_length,
+			MIN(first_message_date) as first_message,
+			MAX(last_message_date) as last_message
+		FROM user_activity_summary
 		WHERE user_id = :user_id %1
 	)").arg(chatFilter));
 	query.bindValue(":user_id", userId);
@@ -669,9 +2241,10 @@ QJsonObject ChatArchiver::getUserActivity(qint64 userId, qint64 chatId) {
 }
 
 QJsonObject ChatArchiver::getChatActivity(qint64 chatId) {
+	const auto trace = Core::Tracing::Scope("archive", "getChatActivity", chatId);
 	QJsonObject activity;
 
-	QSqlQuery query(_db);
+	QSqlQuery query(database());
 	query.prepare("SELECT * FROM chat_activity_summary WHERE chat_id = :chat_id");
 	query.bindValue(":chat_id", chatId);
 
@@ -694,26 +2267,130 @@ QString ChatArchiver::exportChat(
 		const QDateTime &startDate,
 		const QDateTime &endDate) {
 
-	bool success = false;
+	auto options = ExportOptions();
+	options.startDate = startDate;
+	options.endDate = endDate;
+	const auto result = exportChat(chatId, format, outputPath, options);
+	return result.complete ? result.path : QString();
+}
+
+ExportResult ChatArchiver::exportChat(
+		qint64 chatId,
+		ExportFormat format,
+		const QString &outputPath,
+		const ExportOptions &options) {
+	const auto trace = Core::Tracing::Scope("archive", "exportChat", chatId);
 
-	switch (format) {
-	case ExportFormat::JSON:
-		success = exportToJSON(chatId, outputPath, startDate, endDate);
-		break;
-	case ExportFormat::JSONL:
-		success = exportToJSONL(chatId, outputPath, startDate, endDate);
-		break;
-	case ExportFormat::CSV:
-		success = exportToCSV(chatId, outputPath, startDate, endDate);
-		break;
+	auto result = ExportResult();
+	result.path = outputPath;
+	result.cursor = options.after;
+
+	const auto resume = !options.after.empty();
+	if (!_isRunning) {
+		result.error = "Archiver is not running";
+		return result;
+	} else if (outputPath.isEmpty()) {
+		result.error = "Missing output path";
+		return result;
+	} else if (format == ExportFormat::JSON
+		&& (resume || options.maxMessages > 0)) {
+		// A JSON array can't be continued, partial exports use JSONL/CSV.
+		result.error = "JSON exports can't be split, use jsonl or csv";
+		return result;
 	}
 
-	if (success) {
-		Q_EMIT exportCompleted(outputPath);
-		return outputPath;
+	ExportSink sink(outputPath, options.compress, resume);
+	if (!sink.open()) {
+		result.error = sink.error();
+		return result;
+	}
+	if (!resume) {
+		if (format == ExportFormat::JSON) {
+			sink.write("[\n");
+		} else if (format == ExportFormat::CSV) {
+			sink.write("message_id,chat_id,user_id,username,timestamp,date,"
+				"type,content,has_media,is_forwarded,is_reply\n");
+		}
 	}
 
-	return QString();
+	// Keyset pagination: every page is a short indexed range scan and
+	// no read transaction stays open for the whole export.
+	auto sql = QString(R"(
+		SELECT id, message_id, chat_id, user_id, username, first_name,
+			last_name, content, timestamp, date, message_type,
+			has_media, is_forwarded, is_reply, media_path, cold_segment
+		FROM messages
+		WHERE chat_id = :chat_id
+			AND (timestamp, id) > (:after_timestamp, :after_id))");
+	if (options.startDate.isValid()) {
+		sql += " AND timestamp >= :start";
+	}
+	if (options.endDate.isValid()) {
+		sql += " AND timestamp <= :end";
+	}
+	sql += " ORDER BY timestamp, id LIMIT :limit";
+
+	const auto db = database();
+	auto first = !resume;
+	while (true) {
+		const auto left = (options.maxMessages > 0)
+			? (options.maxMessages - result.exported)
+			: qint64(kExportPageSize);
+		const auto pageSize = int(std::min(left, qint64(kExportPageSize)));
+		if (pageSize <= 0) {
+			break;
+		}
+
+		auto query = PreparedQuery(db, sql);
+		query->bindValue(":chat_id", chatId);
+		query->bindValue(":after_timestamp", result.cursor.timestamp);
+		query->bindValue(":after_id", result.cursor.rowId);
+		if (options.startDate.isValid()) {
+			query->bindValue(":start", options.startDate.toSecsSinceEpoch());
+		}
+		if (options.endDate.isValid()) {
+			query->bindValue(":end", options.endDate.toSecsSinceEpoch());
+		}
+		query->bindValue(":limit", pageSize);
+		if (!query->exec()) {
+			result.error = query->lastError().text();
+			return result;
+		}
+
+		auto rows = 0;
+		while (query->next()) {
+			if (format == ExportFormat::JSON && !base::take(first)) {
+				sink.write(",\n");
+			}
+			if (!sink.write(exportRow(*query, format))) {
+				result.error = sink.error();
+				return result;
+			}
+			result.cursor.timestamp = query->value(8).toLongLong();
+			result.cursor.rowId = query->value(0).toLongLong();
+			++rows;
+		}
+		result.exported += rows;
+		Q_EMIT exportProgress(chatId, result.exported);
+		if (rows < pageSize) {
+			result.complete = true;
+			break;
+		}
+	}
+
+	if (format == ExportFormat::JSON) {
+		sink.write("\n]\n");
+	}
+	if (!sink.finish()) {
+		result.error = sink.error();
+		return result;
+	}
+	result.bytesWritten = sink.bytesWritten();
+
+	if (result.complete) {
+		Q_EMIT exportCompleted(outputPath);
+	}
+	return result;
 }
 
 ArchivalStats ChatArchiver::getStats() const {
@@ -721,7 +2398,7 @@ ArchivalStats ChatArchiver::getStats() const {
 }
 
 void ChatArchiver::updateStats() {
-	QSqlQuery query(_db);
+	QSqlQuery query(database());
 
 	// Total messages
 	query.exec("SELECT COUNT(*) FROM messages");
@@ -748,7 +2425,7 @@ void ChatArchiver::updateStats() {
 	}
 
 	// Database size
-	QFileInfo dbFile(_databasePath);
+	QFileInfo dbFile(_pool->path());
 	_stats.databaseSize = dbFile.size();
 
 	// Last archived
@@ -811,7 +2488,7 @@ QJsonObject ChatArchiver::messageToJson(const QSqlQuery &query) const {
 	msg["username"] = query.value("username").toString();
 	msg["first_name"] = query.value("first_name").toString();
 	msg["last_name"] = query.value("last_name").toString();
-	msg["content"] = query.value("content").toString();
+	msg["content"] = messageContent(query);
 	msg["timestamp"] = query.value("timestamp").toLongLong();
 	msg["date"] = query.value("date").toString();
 	msg["type"] = query.value("message_type").toString();
@@ -826,6 +2503,19 @@ QJsonObject ChatArchiver::messageToJson(const QSqlQuery &query) const {
 	return msg;
 }
 
+QString ChatArchiver::messageContent(const QSqlQuery &query) const {
+	const auto content = query.value("content");
+	const auto segment = query.value("cold_segment");
+	if (!content.isNull() || segment.isNull() || !_coldStorage) {
+		return content.toString();
+	}
+	const auto cold = _coldStorage->find(
+		query.value("chat_id").toLongLong(),
+		segment.toLongLong(),
+		query.value("message_id").toLongLong());
+	return cold ? cold->content : QString();
+}
+
 QString ChatArchiver::downloadMedia(HistoryItem *message) {
 	// Placeholder: Implement actual media download
 	// This would use tdesktop's media download APIs
@@ -833,103 +2523,98 @@ QString ChatArchiver::downloadMedia(HistoryItem *message) {
 	return QString();
 }
 
-bool ChatArchiver::exportToJSONL(qint64 chatId, const QString &outputPath,
-                                 const QDateTime &start, const QDateTime &end) {
-	QFile file(outputPath);
-	if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-		return false;
-	}
-
-	QTextStream out(&file);
-
-	QString sql = "SELECT * FROM messages WHERE chat_id = :chat_id";
-	QStringList conditions;
-
-	if (start.isValid()) {
-		conditions << "timestamp >= :start";
-	}
-	if (end.isValid()) {
-		conditions << "timestamp <= :end";
-	}
-
-	if (!conditions.isEmpty()) {
-		sql += " AND " + conditions.join(" AND ");
-	}
-	sql += " ORDER BY timestamp ASC";
-
-	QSqlQuery query(_db);
-	query.prepare(sql);
-	query.bindValue(":chat_id", chatId);
-	if (start.isValid()) {
-		query.bindValue(":start", start.toSecsSinceEpoch());
-	}
-	if (end.isValid()) {
-		query.bindValue(":end", end.toSecsSinceEpoch());
-	}
-
-	if (!query.exec()) {
-		return false;
+QString ChatArchiver::getMediaPath(
+		qint64 chatId,
+		qint64 messageId,
+		const QString &extension) {
+	if (!_pool) {
+		return QString();
 	}
-
-	while (query.next()) {
-		QJsonObject msg = messageToJson(query);
-		out << QJsonDocument(msg).toJson(QJsonDocument::Compact) << "\n";
+	const auto folder = QDir(QFileInfo(_pool->path()).absolutePath()).filePath(
+		QString("media/%1").arg(chatId));
+	if (!QDir().mkpath(folder)) {
+		return QString();
 	}
-
-	file.close();
-	return true;
-}
-
-bool ChatArchiver::exportToJSON(qint64 chatId, const QString &outputPath,
-                                const QDateTime &start, const QDateTime &end) {
-	Q_UNUSED(chatId);
-	Q_UNUSED(outputPath);
-	Q_UNUSED(start);
-	Q_UNUSED(end);
-	// Similar to JSONL but wrap in array
-	return false;
-}
-
-bool ChatArchiver::exportToCSV(qint64 chatId, const QString &outputPath,
-                               const QDateTime &start, const QDateTime &end) {
-	Q_UNUSED(chatId);
-	Q_UNUSED(outputPath);
-	Q_UNUSED(start);
-	Q_UNUSED(end);
-	// CSV export implementation
-	return false;
+	const auto name = extension.isEmpty()
+		? QString::number(messageId)
+		: QString("%1.%2").arg(messageId).arg(extension);
+	return QDir(folder).filePath(name);
 }
 
-void ChatArchiver::updateDailyStats(qint64 chatId, const QDate &date) {
-	Q_UNUSED(chatId);
-	Q_UNUSED(date);
-	// Implementation for daily stats update
+void ChatArchiver::setEphemeralMediaPath(
+		qint64 chatId,
+		qint64 messageId,
+		const QString &path) {
+	if (!_isRunning) {
+		return;
+	}
+	_pool->write([=](QSqlDatabase &db) {
+		QSqlQuery query(db);
+		query.prepare(
+			"UPDATE ephemeral_messages SET media_path = :media_path "
+			"WHERE chat_id = :chat_id AND message_id = :message_id");
+		query.bindValue(":media_path", path);
+		query.bindValue(":chat_id", chatId);
+		query.bindValue(":message_id", messageId);
+		if (!query.exec()) {
+			qWarning()
+				<< "Failed to store ephemeral media path:"
+				<< query.lastError().text();
+		}
+	});
+	_stats.mediaDownloaded++;
 }
 
-void ChatArchiver::updateUserActivity(qint64 userId, qint64 chatId) {
-	Q_UNUSED(userId);
-	Q_UNUSED(chatId);
-	// Implementation for user activity update
+QByteArray ChatArchiver::exportRow(
+		const QSqlQuery &query,
+		ExportFormat format) const {
+	switch (format) {
+	case ExportFormat::JSON:
+		return QJsonDocument(messageToJson(query)).toJson(QJsonDocument::Compact);
+	case ExportFormat::JSONL:
+		return QJsonDocument(messageToJson(query)).toJson(QJsonDocument::Compact)
+			+ '\n';
+	case ExportFormat::CSV:
+		break;
+	}
+	const auto flag = [&](const char *name) {
+		return query.value(name).toBool() ? QString("1") : QString("0");
+	};
+	return (QStringList{
+		query.value("message_id").toString(),
+		query.value("chat_id").toString(),
+		query.value("user_id").toString(),
+		sanitizeForCSV(query.value("username").toString()),
+		query.value("timestamp").toString(),
+		query.value("date").toString(),
+		query.value("message_type").toString(),
+		sanitizeForCSV(messageContent(query)),
+		flag("has_media"),
+		flag("is_forwarded"),
+		flag("is_reply"),
+	}.join(',') + '\n').toUtf8();
 }
 
-void ChatArchiver::updateChatActivity(qint64 chatId) {
-	Q_UNUSED(chatId);
-	// Implementation for chat activity update
+QString ChatArchiver::sanitizeForCSV(const QString &text) const {
+	const auto special = [](QChar ch) {
+		return (ch == ',') || (ch == '"') || (ch == '\n') || (ch == '\r');
+	};
+	if (std::none_of(text.begin(), text.end(), special)) {
+		return text;
+	}
+	auto escaped = text;
+	escaped.replace('"', "\"\"");
+	return '"' + escaped + '"';
 }
 
 // Slots
 void ChatArchiver::onNewMessage(HistoryItem *message) {
-	archiveMessage(message);
+	queueLiveRow(message);
 }
 
 void ChatArchiver::onMessageEdited(HistoryItem *message) {
-	Q_UNUSED(message);
-	// Handle edited messages
-}
-
-void ChatArchiver::checkForNewMessages() {
-	// Periodic check for new messages
-	// This would poll the Data::Session for new messages
+	// INSERT OR REPLACE overwrites the stored text and media.
+	queueLiveRow(message);
 }
 
 bool ChatArchiver::purgeOldMessages(int daysToKeep) {
@@ -941,14 +2626,39 @@ bool ChatArchiver::purgeOldMessages(int daysToKeep) {
 	const qint64 cutoffTime = QDateTime::currentSecsSinceEpoch() - (daysToKeep * 86400);
 
 	// Delete messages older than cutoff
-	QSqlQuery query(_db);
-	query.prepare("DELETE FROM messages WHERE timestamp < :cutoff");
-	query.bindValue(":cutoff", cutoffTime);
+	auto failure = QString();
+	auto segments = std::vector<std::pair<qint64, qint64>>();
+	_pool->writeAndWait([&](QSqlDatabase &db) {
+		QSqlQuery query(db);
+		query.prepare("DELETE FROM messages WHERE timestamp < :cutoff");
+		query.bindValue(":cutoff", cutoffTime);
+		if (!query.exec()) {
+			failure = query.lastError().text();
+			return;
+		}
 
-	if (!query.exec()) {
-		Q_EMIT error(QString("Failed to purge old messages: %1").arg(query.lastError().text()));
+		// Segments that held only purged messages go away with them.
+		query.prepare("SELECT chat_id, id FROM cold_segments WHERE last_timestamp < :cutoff");
+		query.bindValue(":cutoff", cutoffTime);
+		if (query.exec()) {
+			while (query.next()) {
+				segments.emplace_back(
+					query.value(0).toLongLong(),
+					query.value(1).toLongLong());
+			}
+		}
+		query.prepare("DELETE FROM cold_segments WHERE last_timestamp < :cutoff");
+		query.bindValue(":cutoff", cutoffTime);
+		query.exec();
+	});
+
+	if (!failure.isEmpty()) {
+		Q_EMIT error(QString("Failed to purge old messages: %1").arg(failure));
 		return false;
 	}
+	for (const auto &[chatId, segmentId] : segments) {
+		_coldStorage->remove(chatId, segmentId);
+	}
 
 	// Update statistics
 	updateStats();
@@ -956,15 +2666,178 @@ bool ChatArchiver::purgeOldMessages(int daysToKeep) {
 	return true;
 }
 
+ColdTierResult ChatArchiver::moveToColdStorage(int olderThanDays) {
+	auto result = ColdTierResult();
+	if (!_isRunning) {
+		result.error = "Archiver is not running";
+		return result;
+	} else if (olderThanDays < 0) {
+		result.error = "Age must not be negative";
+		return result;
+	}
+	const auto cutoff = QDateTime::currentSecsSinceEpoch()
+		- qint64(olderThanDays) * 86400;
+	const auto db = database();
+
+	auto chats = std::vector<qint64>();
+	{
+		auto query = PreparedQuery(db, R"(
+			SELECT DISTINCT chat_id FROM messages
+			WHERE timestamp < :cutoff AND cold_segment IS NULL
+		)");
+		query->bindValue(":cutoff", cutoff);
+		if (!query->exec()) {
+			result.error = query->lastError().text();
+			return result;
+		}
+		while (query->next()) {
+			chats.push_back(query->value(0).toLongLong());
+		}
+	}
+
+	// Segments are written first and referenced after, a failure leaves
+	// at worst an unreferenced file behind, never a row without its text.
+	for (const auto chatId : chats) {
+		while (true) {
+			auto messages = std::vector<ColdMessage>();
+			auto rowIds = std::vector<qint64>();
+			auto firstTimestamp = qint64();
+			auto lastTimestamp = qint64();
+			{
+				auto query = PreparedQuery(db, R"(
+					SELECT id, message_id, timestamp, content, metadata
+					FROM messages
+					WHERE chat_id = :chat_id
+						AND timestamp < :cutoff
+						AND cold_segment IS NULL
+					ORDER BY timestamp, id
+					LIMIT :limit
+				)");
+				query->bindValue(":chat_id", chatId);
+				query->bindValue(":cutoff", cutoff);
+				query->bindValue(":limit", kColdSegmentSize);
+				if (!query->exec()) {
+					result.error = query->lastError().text();
+					return result;
+				}
+				while (query->next()) {
+					rowIds.push_back(query->value(0).toLongLong());
+					lastTimestamp = query->value(2).toLongLong();
+					if (messages.empty()) {
+						firstTimestamp = lastTimestamp;
+					}
+					messages.push_back({
+						.messageId = query->value(1).toLongLong(),
+						.content = query->value(3).toString(),
+						.metadata = query->value(4).toString(),
+					});
+				}
+			}
+			if (messages.empty()) {
+				break;
+			}
+
+			const auto segmentId = rowIds.front();
+			const auto bytes = _coldStorage->write(chatId, segmentId, messages);
+			if (bytes < 0) {
+				result.error = "Failed to write cold storage segment";
+				return result;
+			}
+			auto stored = false;
+			_pool->writeAndWait([&](QSqlDatabase &db) {
+				stored = storeColdSegment(
+					db,
+					chatId,
+					segmentId,
+					rowIds,
+					firstTimestamp,
+					lastTimestamp,
+					bytes);
+			});
+			if (!stored) {
+				_coldStorage->remove(chatId, segmentId);
+				result.error = "Failed to reference cold storage segment";
+				return result;
+			}
+
+			result.messages += qint64(messages.size());
+			result.bytes += bytes;
+			++result.segments;
+			if (messages.size() < std::size_t(kColdSegmentSize)) {
+				break;
+			}
+		}
+	}
+	return result;
+}
+
+bool ChatArchiver::storeColdSegment(
+		QSqlDatabase &db,
+		qint64 chatId,
+		qint64 segmentId,
+		const std::vector<qint64> &rowIds,
+		qint64 firstTimestamp,
+		qint64 lastTimestamp,
+		qint64 bytes) {
+	if (!db.transaction()) {
+		return false;
+	}
+	auto segment = PreparedQuery(db, R"(
+		INSERT OR REPLACE INTO cold_segments
+			(id, chat_id, first_timestamp, last_timestamp, message_count, bytes)
+		VALUES (:id, :chat_id, :first, :last, :count, :bytes)
+	)");
+	segment->bindValue(":id", segmentId);
+	segment->bindValue(":chat_id", chatId);
+	segment->bindValue(":first", firstTimestamp);
+	segment->bindValue(":last", lastTimestamp);
+	segment->bindValue(":count", qint64(rowIds.size()));
+	segment->bindValue(":bytes", bytes);
+	if (!segment->exec()) {
+		qWarning() << "MCP: Failed to store cold segment:" << segment->lastError().text();
+		db.rollback();
+		return false;
+	}
+
+	// A row replaced by a newer copy in the meantime keeps its own text.
+	auto update = PreparedQuery(db, R"(
+		UPDATE messages
+		SET content = NULL, metadata = NULL, cold_segment = :segment
+		WHERE id = :id AND cold_segment IS NULL
+	)");
+	for (const auto rowId : rowIds) {
+		update->bindValue(":segment", segmentId);
+		update->bindValue(":id", rowId);
+		if (!update->exec()) {
+			qWarning() << "MCP: Failed to move message to cold storage:" << update->lastError().text();
+			db.rollback();
+			return false;
+		}
+	}
+	return db.commit();
+}
+
 // ===================================
 // EphemeralArchiver Implementation
 // ===================================
 
+namespace {
+
+// Above the media viewer (2), a self-destructing file can't wait
+// behind the one being watched. The capture closest to its deadline
+// gets one more, so it preempts the rest of the captures as well.
+constexpr auto kEphemeralLoaderPriority = 3;
+constexpr auto kUrgentLoaderPriority = 4;
+
+} // namespace
+
 EphemeralArchiver::EphemeralArchiver(QObject *parent)
 	: QObject(parent)
-	, _checkTimer(new QTimer(this)) {
-
-	connect(_checkTimer, &QTimer::timeout, this, &EphemeralArchiver::checkForEphemeral);
+	, _deadlineTimer(new QTimer(this)) {
+	_deadlineTimer->setSingleShot(true);
+	connect(_deadlineTimer, &QTimer::timeout, this, [=] {
+		checkDeadlines();
+	});
 }
 
 EphemeralArchiver::~EphemeralArchiver() {
@@ -977,7 +2850,27 @@ bool EphemeralArchiver::start(ChatArchiver *archiver) {
 	}
 
 	_archiver = archiver;
-	_checkTimer->start(1000);  // Check every second
+	_session = archiver->dataSession();
+	if (_session) {
+		// Capture on arrival, before a self-destruct timer can fire.
+		_session->newItemAdded(
+		) | rpl::start_with_next([=](not_null<HistoryItem*> item) {
+			onNewMessage(item);
+		}, _sessionLifetime);
+
+		_session->session().downloaderTaskFinished(
+		) | rpl::start_with_next([=] {
+			checkCaptures();
+		}, _sessionLifetime);
+
+		// A destroyed message can't be loaded anymore.
+		_session->itemRemoved(
+		) | rpl::start_with_next([=](not_null<const HistoryItem*> item) {
+			if (dropCapture(item->fullId())) {
+				++_stats.mediaDeadlineMisses;
+			}
+		}, _sessionLifetime);
+	}
 	_isRunning = true;
 
 	return true;
@@ -988,8 +2881,15 @@ void EphemeralArchiver::stop() {
 		return;
 	}
 
-	_checkTimer->stop();
+	_sessionLifetime.destroy();
+	for (const auto &capture : base::take(_captures)) {
+		if (capture.document && capture.document->loading()) {
+			capture.document->cancel();
+		}
+	}
+	_deadlineTimer->stop();
 	_archiver = nullptr;
+	_session = nullptr;
 	_isRunning = false;
 }
 
@@ -1055,7 +2955,7 @@ bool EphemeralArchiver::captureMessage(
 	}
 
 	if (message->media()) {
-		_stats.mediaSaved++;
+		scheduleMedia(message, ttl);
 	}
 
 	_stats.lastCaptured = QDateTime::currentDateTime();
@@ -1068,9 +2968,150 @@ bool EphemeralArchiver::captureMessage(
 	return true;
 }
 
-void EphemeralArchiver::checkForEphemeral() {
-	// Periodic check for ephemeral messages
-	// This would monitor Data::Session for messages with TTL
+EphemeralArchiver::EphemeralStats EphemeralArchiver::getStats() const {
+	auto result = _stats;
+	result.mediaPending = int(_captures.size());
+	return result;
+}
+
+void EphemeralArchiver::scheduleMedia(
+		not_null<HistoryItem*> message,
+		int ttl) {
+	const auto media = message->media();
+	const auto document = media->document();
+	const auto photo = document ? nullptr : media->photo();
+	if (!document && !photo) {
+		return;
+	}
+	const auto chatId = message->history()->peer->id.value;
+	const auto messageId = message->id.bare;
+	const auto extension = document
+		? QFileInfo(document->filename()).suffix()
+		: QString("jpg");
+	auto capture = Capture{
+		.fullId = message->fullId(),
+		.deadline = crl::now() + crl::time(std::max(ttl, 0)) * 1000,
+		.path = _archiver->getMediaPath(chatId, messageId, extension),
+		.document = document,
+		.photo = photo,
+	};
+	if (capture.path.isEmpty()) {
+		++_stats.mediaFailed;
+		return;
+	}
+	const auto origin = Data::FileOriginMessage(capture.fullId);
+	if (document) {
+		document->save(origin, capture.path, LoadFromCloudOrLocal, false);
+	} else {
+		capture.photoMedia = photo->createMediaView();
+		capture.photoMedia->wanted(Data::PhotoSize::Large, origin);
+	}
+	const auto i = ranges::upper_bound(
+		_captures,
+		capture.deadline,
+		ranges::less(),
+		&Capture::deadline);
+	_captures.insert(i, std::move(capture));
+
+	// Already in the cache, nothing to wait for.
+	checkCaptures();
+}
+
+bool EphemeralArchiver::captureLoaded(const Capture &capture) const {
+	if (capture.document) {
+		return !capture.document->loading()
+			&& !capture.document->cancelled()
+			&& QFileInfo::exists(capture.path);
+	}
+	return capture.photoMedia->loaded();
+}
+
+bool EphemeralArchiver::captureFailed(const Capture &capture) const {
+	if (capture.document) {
+		return (capture.document->status == FileDownloadFailed)
+			|| (!capture.document->loading() && capture.document->cancelled());
+	}
+	return capture.photo->failed(Data::PhotoSize::Large);
+}
+
+void EphemeralArchiver::checkCaptures() {
+	const auto now = crl::now();
+	for (auto i = begin(_captures); i != end(_captures);) {
+		if (captureLoaded(*i)) {
+			// Photos are loaded to memory and written here.
+			if (i->photoMedia && !i->photoMedia->saveToFile(i->path)) {
+				++_stats.mediaFailed;
+				i = _captures.erase(i);
+				continue;
+			}
+			const auto margin = i->deadline - now;
+			if (_stats.minMarginMs < 0 || margin < _stats.minMarginMs) {
+				_stats.minMarginMs = std::max(margin, crl::time(0));
+			}
+			_archiver->setEphemeralMediaPath(
+				i->fullId.peer.value,
+				i->fullId.msg.bare,
+				i->path);
+			++_stats.mediaSaved;
+			i = _captures.erase(i);
+		} else if (captureFailed(*i)) {
+			++_stats.mediaFailed;
+			i = _captures.erase(i);
+		} else {
+			++i;
+		}
+	}
+	checkDeadlines();
+}
+
+void EphemeralArchiver::checkDeadlines() {
+	const auto now = crl::now();
+	while (!_captures.empty() && _captures.front().deadline <= now) {
+		++_stats.mediaDeadlineMisses;
+		if (const auto document = _captures.front().document) {
+			if (document->loading()) {
+				document->cancel();
+			}
+		}
+		_captures.erase(begin(_captures));
+	}
+	reprioritize();
+	restartDeadlineTimer();
+}
+
+bool EphemeralArchiver::dropCapture(const FullMsgId &fullId) {
+	const auto i = ranges::find(_captures, fullId, &Capture::fullId);
+	if (i == end(_captures)) {
+		return false;
+	}
+	if (i->document && i->document->loading()) {
+		i->document->cancel();
+	}
+	_captures.erase(i);
+	reprioritize();
+	restartDeadlineTimer();
+	return true;
+}
+
+void EphemeralArchiver::reprioritize() {
+	auto priority = kUrgentLoaderPriority;
+	for (const auto &capture : _captures) {
+		if (capture.document) {
+			capture.document->setLoadPriority(priority);
+		} else {
+			capture.photo->setLoadPriority(Data::PhotoSize::Large, priority);
+		}
+		priority = kEphemeralLoaderPriority;
+	}
+}
+
+void EphemeralArchiver::restartDeadlineTimer() {
+	if (_captures.empty()) {
+		_deadlineTimer->stop();
+		return;
+	}
+	const auto left = _captures.front().deadline - crl::now();
+	_deadlineTimer->start(std::max(int(left), 0));
 }
 
 void EphemeralArchiver::onMessageDeleted(qint64 chatId, qint64 messageId) {
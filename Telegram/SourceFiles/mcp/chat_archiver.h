@@ -3,23 +3,43 @@
 
 #pragma once
 
+#include "data/data_msg_id.h"
+
 #include <QtCore/QObject>
 #include <QtCore/QString>
 #include <QtCore/QDateTime>
 #include <QtCore/QJsonObject>
 #include <QtCore/QJsonArray>
+#include <QtCore/QMutex>
+#include <QtCore/QStringList>
 #include <QtSql/QSqlDatabase>
 #include <QtSql/QSqlQuery>
+#include <atomic>
+#include <functional>
+#include <map>
 #include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 namespace Data {
 class Session;
+class PhotoMedia;
 } // namespace Data
 
+class DocumentData;
 class HistoryItem;
+class PhotoData;
+struct TextWithEntities;
 
 namespace MCP {
 
+class ColdStorage;
+class DatabasePool;
+class HistoryCrawler;
+class MediaArchiver;
+class ParticipantCache;
+
 // Archival statistics
 struct ArchivalStats {
 	int totalMessages = 0;
@@ -31,6 +51,37 @@ struct ArchivalStats {
 	QDateTime lastArchived;
 };
 
+// Plain column values of one messages row, extracted from a HistoryItem
+// on the main thread so bulk ingest can bind them without touching Data.
+// Null strings are stored as NULL.
+struct ArchivedMessageRow {
+	qint64 messageId = 0;
+	qint64 chatId = 0;
+	qint64 userId = 0;
+	QString username;
+	QString firstName;
+	QString lastName;
+	QString content;
+	qint64 timestamp = 0;
+	QString messageType;
+	qint64 replyToId = 0;
+	qint64 forwardChatId = 0;
+	qint64 forwardMessageId = 0;
+	QString mediaPath;
+	QString mediaUrl;
+	qint64 mediaSize = 0;
+	QString mediaMimeType;
+	bool hasMedia = false;
+	bool isForwarded = false;
+	QString metadata; // JSON, see ArchivedEntities()
+};
+
+// {"entities":[{"type":"url","offset":0,"length":19}]} with the mention,
+// url, hashtag, command, email, phone and custom emoji entities Telegram
+// parsed for the text, names as EntityTypeName(). Null without any, so
+// entity statistics only scan the text of messages archived before.
+[[nodiscard]] QString ArchivedEntities(const TextWithEntities &text);
+
 // Export format options
 enum class ExportFormat {
 	JSON,      // Complete JSON export
@@ -38,6 +89,80 @@ enum class ExportFormat {
 	CSV        // Comma-separated values
 };
 
+// Position after the last exported message, exports walk the chat by
+// (timestamp, id) so a later call continues exactly there
+struct ExportCursor {
+	qint64 timestamp = 0;
+	qint64 rowId = 0;
+
+	[[nodiscard]] bool empty() const { return !timestamp && !rowId; }
+	[[nodiscard]] QString serialize() const;
+	[[nodiscard]] static ExportCursor Parse(const QString &value);
+};
+
+struct ExportOptions {
+	QDateTime startDate;
+	QDateTime endDate;
+	ExportCursor after;  // Non-empty: resume, appending to the file
+	qint64 maxMessages = 0;  // Stop after this many, 0 = no limit
+	bool compress = false;  // gzip, resumed parts become gzip members
+};
+
+struct ExportResult {
+	QString path;
+	qint64 exported = 0;
+	qint64 bytesWritten = 0;
+	ExportCursor cursor;
+	bool complete = false;
+	QString error;
+};
+
+// Outcome of moving old message bodies into cold storage
+struct ColdTierResult {
+	qint64 messages = 0;
+	int segments = 0;
+	qint64 bytes = 0;  // Compressed size of the written segments
+	QString error;
+};
+
+// Keyset position in a chat's history. Pages continue strictly after it
+// in (timestamp, message_id) order, so messages sharing a second are
+// neither skipped nor repeated. Serialized as an opaque token.
+struct MessageCursor {
+	qint64 timestamp = 0;
+	qint64 messageId = 0;
+
+	[[nodiscard]] bool empty() const { return !timestamp && !messageId; }
+	[[nodiscard]] QString serialize() const;
+	[[nodiscard]] static MessageCursor Parse(const QString &value);
+
+	friend inline bool operator<(
+			const MessageCursor &a,
+			const MessageCursor &b) {
+		return std::tie(a.timestamp, a.messageId)
+			< std::tie(b.timestamp, b.messageId);
+	}
+};
+
+// Zero fields don't filter. Timestamps are unix seconds, inclusive.
+struct ArchiveSearchFilter {
+	qint64 chatId = 0;
+	qint64 userId = 0;
+	qint64 after = 0;
+	qint64 before = 0;
+
+	// " AND m.chat_id = :chat_id ..." for the fields that are set, bind()
+	// fills the same placeholders.
+	[[nodiscard]] QString sqlConditions(const QString &alias) const;
+	void bind(QSqlQuery &query) const;
+};
+
+struct FullTextHit {
+	qint64 rowId = 0;  // messages.id
+	double score = 0.;  // Higher is better
+	QString snippet;
+};
+
 // Message type enumeration
 enum class MessageType {
 	Text,
@@ -65,14 +190,40 @@ public:
 	~ChatArchiver();
 
 	// Initialization
-	bool start(const QString &databasePath);
+	// Writes go through the pool writer, reads use its reader connections.
+	// The schema is checked and migrated on the writer, done is called on
+	// the main thread once the archiver is running or failed to start.
+	void start(DatabasePool *pool, std::function<void(bool)> done);
 	void stop();
 	[[nodiscard]] bool isRunning() const { return _isRunning; }
+	[[nodiscard]] bool isStarting() const { return _starting != nullptr; }
 
 	// Core archival functions
 	bool archiveMessage(HistoryItem *message);
+	// Bulk ingest: one prepared statement, one transaction per
+	// kIngestBatchSize rows. Stops at the first failed transaction and
+	// returns how many leading rows were stored.
+	int archiveMessages(const std::vector<HistoryItem*> &messages);
+	int archiveRows(const std::vector<ArchivedMessageRow> &rows);
+	[[nodiscard]] ArchivedMessageRow extractMessageRow(HistoryItem *message);
+	// Queue server history crawls, they page in the background and
+	// resume after restart. Requires setDataSession().
 	bool archiveChat(qint64 chatId, int messageLimit = -1);  // -1 = all messages
 	bool archiveAllChats(int messagesPerChat = 1000);
+	bool cancelArchive(qint64 chatId);
+	// Also subscribes to new and edited messages of the session, they are
+	// archived live in short coalesced batches.
+	void setDataSession(Data::Session *session);
+	[[nodiscard]] Data::Session *dataSession() const { return _session; }
+	[[nodiscard]] QJsonObject crawlStatus() const;
+	// Background download of the media of archived messages, nullptr
+	// without a data session.
+	[[nodiscard]] MediaArchiver *mediaArchiver() const {
+		return _mediaArchiver.get();
+	}
+	[[nodiscard]] ParticipantCache *participantCache() const {
+		return _participantCache.get();
+	}
 
 	// Ephemeral message handling
 	bool archiveEphemeralMessage(
@@ -81,10 +232,44 @@ public:
 		int ttlSeconds = 0
 	);
 	bool isEphemeral(HistoryItem *message) const;
+	// The media of a captured row, saved after the row itself.
+	void setEphemeralMediaPath(
+		qint64 chatId,
+		qint64 messageId,
+		const QString &path);
+	// media/<chat>/<message>.<extension> next to the database, the
+	// folder is created.
+	[[nodiscard]] QString getMediaPath(
+		qint64 chatId,
+		qint64 messageId,
+		const QString &extension);
 
 	// Query functions
 	QJsonArray getMessages(qint64 chatId, int limit = 100, qint64 beforeTimestamp = 0);
+	// Row-by-row variant of getMessages(), newest first, starting below
+	// the before cursor (empty = newest). Returns the number visited,
+	// last receives the cursor of the final row for the next page.
+	int visitMessages(
+		qint64 chatId,
+		int limit,
+		const MessageCursor &before,
+		const std::function<void(const QJsonObject&)> &callback,
+		MessageCursor *last = nullptr);
+	// Rows of the given ids in one chat, ids not archived are skipped.
+	QJsonArray getMessagesById(
+		qint64 chatId,
+		const std::vector<qint64> &messageIds);
+	// Ranked by bm25 with a highlighted "snippet" when the FTS5 index is
+	// available, chatId = 0 searches every chat. Terms ending in '*' are
+	// prefix queries, quoted phrases are kept together.
 	QJsonArray searchMessages(qint64 chatId, const QString &query, int limit = 50);
+	// Same ranking, returns only row ids for callers that fuse it with
+	// other result lists. Every filter is applied inside the query.
+	std::vector<FullTextHit> searchFullText(
+		const QString &query,
+		const ArchiveSearchFilter &filter,
+		int limit);
+	[[nodiscard]] bool hasFullTextIndex() const { return _fullTextIndex; }
 	QJsonObject getChatInfo(qint64 chatId);
 	QJsonArray listArchivedChats();
 
@@ -96,7 +281,8 @@ public:
 	QJsonArray getTopUsers(qint64 chatId, int limit = 10);
 	QJsonArray getTopWords(qint64 chatId, int limit = 20);
 
-	// Export functions
+	// Export functions. Rows are read page by page and written through a
+	// bounded buffer, memory use does not depend on the chat size.
 	QString exportChat(
 		qint64 chatId,
 		ExportFormat format,
@@ -104,6 +290,11 @@ public:
 		const QDateTime &startDate = QDateTime(),
 		const QDateTime &endDate = QDateTime()
 	);
+	ExportResult exportChat(
+		qint64 chatId,
+		ExportFormat format,
+		const QString &outputPath,
+		const ExportOptions &options);
 	QString exportAllChats(ExportFormat format, const QString &outputDir);
 
 	// Statistics
@@ -114,29 +305,114 @@ public:
 	bool vacuum();  // Optimize database
 	bool rebuildIndexes();
 	bool purgeOldMessages(int daysToKeep);
-
-	// Database access
-	[[nodiscard]] QSqlDatabase database() const { return _db; }
+	// Moves content and metadata of messages older than the given age
+	// into compressed per-chat segment files. The rows stay in place, so
+	// counts and analytics keep working, and reads load the text back
+	// from the segment. Cold messages are not in the full-text index.
+	ColdTierResult moveToColdStorage(int olderThanDays);
+	// Recomputes the analytics rollups of one chat (0 = all) from the
+	// messages table. Triggers keep them current, this repairs drift.
+	bool rebuildAnalytics(qint64 chatId = 0);
+	// Brings the per-day user sketches of [from, till] (ISO dates) up to
+	// date with the rollups, only days whose message count changed are
+	// rebuilt. Rows of chat_id 0 merge every chat of a day.
+	bool refreshActivitySketches(const QString &from, const QString &till);
+
+	// Database access. Returns the read-only connection of the calling
+	// thread, so query functions may be called from worker threads.
+	[[nodiscard]] QSqlDatabase database() const;
+	// Writer of the archive database, for components that keep derived
+	// tables next to the messages, like the semantic search embeddings.
+	[[nodiscard]] DatabasePool *pool() const { return _pool; }
 
 Q_SIGNALS:
 	void messageArchived(qint64 chatId, qint64 messageId);
 	void chatArchived(qint64 chatId, int messageCount);
+	void chatArchiveProgress(qint64 chatId, int messageCount);
+	void chatArchiveFailed(qint64 chatId, const QString &reason);
+	void exportProgress(qint64 chatId, qint64 exportedMessages);
 	void exportCompleted(const QString &filePath);
 	void error(const QString &errorMessage);
 
 private Q_SLOTS:
 	void onNewMessage(HistoryItem *message);
 	void onMessageEdited(HistoryItem *message);
-	void checkForNewMessages();
+	void flushLiveRows();
 
 private:
+	void subscribeToSession();
+	void queueLiveRow(HistoryItem *message);
+	void started(
+		bool initialized,
+		bool fullTextIndex,
+		const QStringList &builds,
+		const std::function<void(bool)> &done);
+
 	// Database helpers
-	bool initializeDatabase();
-	bool executeSQLFile(const QString &filePath);
+	// On the writer: applies the migrations above PRAGMA user_version in
+	// one transaction. builds receives the row builds left to run.
+	static bool migrate(
+		QSqlDatabase &db,
+		bool &fullTextIndex,
+		QStringList &builds);
+	static bool applyMigrations(QSqlDatabase &db, int from);
+	static bool initializeDatabase(QSqlDatabase &db);
+
+	// The builds run as a chain of short writer jobs, each one queues
+	// the next. Once cancelled is set the remaining jobs do nothing and
+	// the build starts over on the next start. done is called on the
+	// writer thread.
+	void runPendingBuilds(const QStringList &builds);
+	void buildFinished(
+		const std::shared_ptr<std::atomic<bool>> &cancelled,
+		const QString &name,
+		bool built);
+	static void RunFullTextBuild(
+		not_null<DatabasePool*> pool,
+		std::shared_ptr<const std::atomic<bool>> cancelled,
+		std::function<void(bool)> done);
+	static void RunRollupsBuild(
+		not_null<DatabasePool*> pool,
+		std::shared_ptr<const std::atomic<bool>> cancelled,
+		std::function<void(bool)> done);
+	static void RunChatRollupsBuild(
+		not_null<DatabasePool*> pool,
+		std::shared_ptr<const std::atomic<bool>> cancelled,
+		std::shared_ptr<const std::vector<qint64>> chats,
+		std::size_t index,
+		std::function<void(bool)> done);
+	// Runs on the writer thread, returns how many leading rows were stored.
+	std::size_t insertBatches(
+		QSqlDatabase &db,
+		const std::vector<ArchivedMessageRow> &rows);
+	bool insertRows(
+		QSqlQuery &query,
+		const std::vector<ArchivedMessageRow> &rows,
+		std::size_t from,
+		std::size_t till);
+	static bool initializeFullTextIndex(QSqlDatabase &db);
+	static bool initializeFullTextBuild(QSqlDatabase &db);
+	static bool initializeColdStorage(QSqlDatabase &db);
+	static bool initializeRollups(QSqlDatabase &db);
+	static bool rebuildRollups(QSqlDatabase &db, qint64 chatId);
+	bool refreshActivitySketches(
+		QSqlDatabase &db,
+		const QString &from,
+		const QString &till);
+	bool storeColdSegment(
+		QSqlDatabase &db,
+		qint64 chatId,
+		qint64 segmentId,
+		const std::vector<qint64> &rowIds,
+		qint64 firstTimestamp,
+		qint64 lastTimestamp,
+		qint64 bytes);
 	QSqlQuery prepareQuery(const QString &sql);
 
 	// Message conversion
 	QJsonObject messageToJson(const QSqlQuery &query) const;
+	// content of the row, read from its cold segment once it was moved.
+	QString messageContent(const QSqlQuery &query) const;
 	MessageType detectMessageType(HistoryItem *message) const;
 	QString messageTypeToString(MessageType type) const;
 
@@ -146,29 +422,33 @@ private:
 	QString sanitizeForCSV(const QString &text) const;
 
 	// Export helpers
-	bool exportToJSON(qint64 chatId, const QString &outputPath,
-	                  const QDateTime &start, const QDateTime &end);
-	bool exportToJSONL(qint64 chatId, const QString &outputPath,
-	                   const QDateTime &start, const QDateTime &end);
-	bool exportToCSV(qint64 chatId, const QString &outputPath,
-	                 const QDateTime &start, const QDateTime &end);
+	QByteArray exportRow(const QSqlQuery &query, ExportFormat format) const;
 
 	// Analytics helpers
-	void updateDailyStats(qint64 chatId, const QDate &date);
-	void updateUserActivity(qint64 userId, qint64 chatId);
-	void updateChatActivity(qint64 chatId);
 	QString detectActivityTrend(qint64 chatId) const;
 
 	// Media handling
 	QString downloadMedia(HistoryItem *message);
-	QString getMediaPath(qint64 chatId, qint64 messageId, const QString &extension);
 
 	Data::Session *_session = nullptr;
-	QSqlDatabase _db;
-	QString _databasePath;
+	DatabasePool *_pool = nullptr;
+	DatabasePool *_starting = nullptr; // Schema job queued on its writer
+	std::unique_ptr<HistoryCrawler> _crawler;
+	std::unique_ptr<MediaArchiver> _mediaArchiver;
+	std::unique_ptr<ParticipantCache> _participantCache;
+	std::unique_ptr<ColdStorage> _coldStorage;
 	bool _isRunning = false;
+	// Set once the background build of the index is done, read by the
+	// tool threads.
+	std::atomic<bool> _fullTextIndex = false;
+	std::shared_ptr<std::atomic<bool>> _buildsCancelled;
 	ArchivalStats _stats;
-	QTimer *_checkTimer = nullptr;
+
+	// Live updates waiting for the next flush, keyed by (chat, message) so
+	// several edits of one message within a batch collapse into one write.
+	std::map<std::pair<qint64, qint64>, ArchivedMessageRow> _liveRows;
+	QTimer *_flushTimer = nullptr;
+	rpl::lifetime _sessionLifetime;
 };
 
 // Ephemeral message archiver - captures self-destructing messages
@@ -194,9 +474,15 @@ public:
 		int viewOnceCount = 0;
 		int vanishingCount = 0;
 		int mediaSaved = 0;
+		int mediaPending = 0;
+		int mediaDeadlineMisses = 0;
+		int mediaFailed = 0;
+		// Smallest time left before the deadline of a saved file, -1
+		// before the first one.
+		qint64 minMarginMs = -1;
 		QDateTime lastCaptured;
 	};
-	[[nodiscard]] EphemeralStats getStats() const { return _stats; }
+	[[nodiscard]] EphemeralStats getStats() const;
 
 Q_SIGNALS:
 	void ephemeralCaptured(qint64 chatId, qint64 messageId, const QString &type);
@@ -205,12 +491,28 @@ Q_SIGNALS:
 private Q_SLOTS:
 	void onNewMessage(HistoryItem *message);
 	void onMessageDeleted(qint64 chatId, qint64 messageId);
-	void checkForEphemeral();
 
 private:
+	// The media of a captured message, loaded before it is destroyed.
+	struct Capture {
+		FullMsgId fullId;
+		crl::time deadline = 0;
+		QString path;
+		DocumentData *document = nullptr;
+		PhotoData *photo = nullptr;
+		std::shared_ptr<Data::PhotoMedia> photoMedia;
+	};
+
 	bool captureMessage(HistoryItem *message, const QString &type, int ttl);
 	bool detectEphemeralType(HistoryItem *message, QString &type, int &ttl);
-	QString downloadEphemeralMedia(HistoryItem *message);
+	void scheduleMedia(not_null<HistoryItem*> message, int ttl);
+	void reprioritize();
+	void checkCaptures();
+	void checkDeadlines();
+	bool dropCapture(const FullMsgId &fullId);
+	void restartDeadlineTimer();
+	[[nodiscard]] bool captureLoaded(const Capture &capture) const;
+	[[nodiscard]] bool captureFailed(const Capture &capture) const;
 
 	ChatArchiver *_archiver = nullptr;
 	Data::Session *_session = nullptr;
@@ -220,7 +522,12 @@ private:
 	bool _captureViewOnce = true;
 	bool _captureVanishing = true;
 	EphemeralStats _stats;
-	QTimer *_checkTimer = nullptr;
+
+	// Earliest deadline first, the head gets the highest priority.
+	std::vector<Capture> _captures;
+	QTimer *_deadlineTimer = nullptr;
+
+	rpl::lifetime _sessionLifetime;
 };
 
 } // namespace MCP
@@ -0,0 +1,299 @@
+// MCP Chat Rules - Compiled chat_rules matcher and auto-replies
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "chat_rules.h"
+
+#include "mcp_helpers.h"
+#include "api/api_common.h"
+#include "apiwrap.h"
+#include "base/unixtime.h"
+#include "data/data_changes.h"
+#include "data/data_peer.h"
+#include "history/history.h"
+#include "history/history_item.h"
+#include "main/main_session.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+
+#include <algorithm>
+#include <iterator>
+
+namespace MCP {
+namespace {
+
+constexpr auto kReplyCooldownMs = qint64(60 * 1000);
+constexpr auto kMaxReplyAge = TimeId(300); // Not to what getDifference brings.
+constexpr auto kMaxRememberedReplies = 1024;
+
+constexpr auto kRulesTable = R"(
+	CREATE TABLE IF NOT EXISTS chat_rules (
+		id INTEGER PRIMARY KEY AUTOINCREMENT,
+		chat_id INTEGER NOT NULL DEFAULT 0,
+		rule_name TEXT NOT NULL,
+		rule_type TEXT NOT NULL,
+		conditions TEXT,
+		actions TEXT,
+		enabled INTEGER DEFAULT 1,
+		priority INTEGER DEFAULT 0,
+		times_triggered INTEGER DEFAULT 0,
+		created_at TEXT,
+		UNIQUE(chat_id, rule_name)
+	)
+)";
+
+} // namespace
+
+ChatRules::ChatRules(QSqlDatabase db)
+: _db(std::move(db)) {
+}
+
+bool ChatRules::initialize() {
+	QSqlQuery query(_db);
+	if (!query.exec(kRulesTable)) {
+		qWarning() << "MCP: Failed to create chat_rules:" << query.lastError().text();
+		return false;
+	}
+	return true;
+}
+
+void ChatRules::subscribe(not_null<Main::Session*> session) {
+	unsubscribe();
+
+	session->changes().messageUpdates(
+		Data::MessageUpdate::Flag::NewAdded
+	) | rpl::start_with_next([=](const Data::MessageUpdate &update) {
+		received(update.item);
+	}, _sessionLifetime);
+}
+
+void ChatRules::unsubscribe() {
+	_sessionLifetime.destroy();
+}
+
+void ChatRules::invalidate() {
+	_compiled = false;
+}
+
+void ChatRules::ensureCompiled() {
+	if (!_compiled) {
+		compile();
+	}
+}
+
+void ChatRules::compile() {
+	_compiled = true;
+	++_compilations;
+	_rules.clear();
+	_matcher = KeywordMatcher();
+	_patternRules.clear();
+	_byChat.clear();
+
+	auto query = PreparedQuery(_db, R"(
+		SELECT id, chat_id, rule_name, rule_type, conditions, actions, priority
+		FROM chat_rules
+		WHERE enabled = 1
+		ORDER BY priority, id
+	)");
+	if (!query->exec()) {
+		qWarning() << "MCP: Failed to load chat rules:" << query->lastError().text();
+		return;
+	}
+	while (query->next()) {
+		auto compiled = Compiled();
+		compiled.rule.id = query->value(0).toLongLong();
+		compiled.rule.chatId = query->value(1).toLongLong();
+		compiled.rule.name = query->value(2).toString();
+		compiled.rule.type = query->value(3).toString();
+		compiled.rule.actions = QJsonDocument::fromJson(
+			query->value(5).toByteArray()).object();
+		compiled.rule.priority = query->value(6).toInt();
+
+		const auto conditions = QJsonDocument::fromJson(
+			query->value(4).toByteArray()).object();
+		for (const auto &keyword : conditions.value("keywords").toArray()) {
+			const auto pattern = _matcher.add(keyword.toString());
+			if (pattern >= 0) {
+				compiled.keywords.push_back(pattern);
+			}
+		}
+		const auto regex = conditions.value("regex");
+		const auto sources = regex.isArray()
+			? regex.toArray()
+			: QJsonArray{ regex };
+		auto regexWanted = false;
+		for (const auto &source : sources) {
+			const auto pattern = source.toString();
+			if (pattern.isEmpty()) {
+				continue;
+			}
+			regexWanted = true;
+			auto expression = QRegularExpression(
+				pattern,
+				QRegularExpression::CaseInsensitiveOption
+					| QRegularExpression::UseUnicodePropertiesOption);
+			if (!expression.isValid()) {
+				qWarning()
+					<< "MCP: Bad regex in chat rule"
+					<< compiled.rule.name
+					<< ":"
+					<< expression.errorString();
+				continue;
+			}
+			expression.optimize();
+			compiled.regexes.push_back(std::move(expression));
+		}
+
+		// Without its only valid condition a rule would match too much.
+		if ((regexWanted && compiled.regexes.empty())
+			|| (compiled.keywords.empty() && compiled.regexes.empty())) {
+			continue;
+		}
+		const auto index = int(_rules.size());
+		for (const auto pattern : compiled.keywords) {
+			if (pattern >= int(_patternRules.size())) {
+				_patternRules.resize(pattern + 1);
+			}
+			_patternRules[pattern].push_back(index);
+		}
+		_byChat[compiled.rule.chatId].push_back(index);
+		_rules.push_back(std::move(compiled));
+	}
+	_matcher.build();
+}
+
+std::vector<const ChatRule*> ChatRules::evaluate(
+		qint64 chatId,
+		const QString &text,
+		const QString &type) {
+	ensureCompiled();
+	++_evaluated;
+
+	auto result = std::vector<const ChatRule*>();
+	const auto global = _byChat.constFind(0);
+	const auto local = chatId ? _byChat.constFind(chatId) : _byChat.cend();
+	if (global == _byChat.cend() && local == _byChat.cend()) {
+		return result;
+	}
+
+	// Both buckets are in priority order already.
+	auto candidates = std::vector<int>();
+	const auto none = std::vector<int>();
+	const auto &all = (global != _byChat.cend()) ? *global : none;
+	const auto &own = (local != _byChat.cend()) ? *local : none;
+	std::merge(
+		begin(all),
+		end(all),
+		begin(own),
+		end(own),
+		std::back_inserter(candidates));
+
+	auto found = std::vector<bool>(_rules.size(), false);
+	for (const auto &match : _matcher.find(text)) {
+		for (const auto index : _patternRules[match.pattern]) {
+			found[index] = true;
+		}
+	}
+	for (const auto index : candidates) {
+		const auto &compiled = _rules[index];
+		if (!type.isEmpty() && compiled.rule.type != type) {
+			continue;
+		} else if (!compiled.keywords.empty() && !found[index]) {
+			continue;
+		} else if (!compiled.regexes.empty()
+			&& std::none_of(
+				begin(compiled.regexes),
+				end(compiled.regexes),
+				[&](const QRegularExpression &regex) {
+					return regex.match(text).hasMatch();
+				})) {
+			continue;
+		}
+		result.push_back(&compiled.rule);
+	}
+	if (!result.empty()) {
+		++_matched;
+	}
+	return result;
+}
+
+void ChatRules::received(not_null<HistoryItem*> item) {
+	if (item->out() || !item->isRegular()) {
+		return;
+	}
+	const auto text = item->originalText().text;
+	if (text.isEmpty()) {
+		return;
+	}
+	const auto history = item->history();
+	const auto chatId = history->peer->id.value;
+	const auto fresh = (base::unixtime::now() - item->date() <= kMaxReplyAge);
+	const auto now = QDateTime::currentMSecsSinceEpoch();
+
+	auto replied = false;
+	for (const auto rule : evaluate(chatId, text)) {
+		triggered(*rule);
+		if (replied || !fresh || rule->type != "auto_reply") {
+			continue;
+		}
+		const auto response = rule->actions.value("response").toString();
+		if (response.isEmpty()) {
+			continue;
+		}
+		const auto key = QString::number(rule->id)
+			+ ':'
+			+ QString::number(chatId);
+		const auto last = _lastReplies.value(key);
+		if (last && now - last < kReplyCooldownMs) {
+			continue;
+		}
+		if (_lastReplies.size() >= kMaxRememberedReplies) {
+			for (auto i = _lastReplies.begin(); i != _lastReplies.end();) {
+				i = (now - *i >= kReplyCooldownMs) ? _lastReplies.erase(i) : ++i;
+			}
+		}
+		_lastReplies.insert(key, now);
+
+		auto action = Api::SendAction(history);
+		action.replyTo.messageId = item->fullId();
+		auto message = Api::MessageToSend(action);
+		message.textWithTags = TextWithTags{ response };
+		history->session().api().sendMessage(std::move(message));
+		replied = true;
+		++_replied;
+	}
+}
+
+void ChatRules::triggered(const ChatRule &rule) {
+	auto query = PreparedQuery(_db, R"(
+		UPDATE chat_rules SET times_triggered = times_triggered + 1 WHERE id = ?
+	)");
+	query->addBindValue(rule.id);
+	if (!query->exec()) {
+		qWarning() << "MCP: Failed to count chat rule trigger:" << query->lastError().text();
+	}
+}
+
+QJsonObject ChatRules::stats() const {
+	auto regexes = 0;
+	for (const auto &compiled : _rules) {
+		regexes += int(compiled.regexes.size());
+	}
+	return QJsonObject{
+		{ "compiled", _compiled },
+		{ "rules", int(_rules.size()) },
+		{ "keywords", _matcher.size() },
+		{ "regexes", regexes },
+		{ "chat_buckets", int(_byChat.size()) },
+		{ "evaluated", _evaluated },
+		{ "matched", _matched },
+		{ "replied", _replied },
+		{ "compilations", _compilations },
+	};
+}
+
+} // namespace MCP
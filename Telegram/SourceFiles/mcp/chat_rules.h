@@ -0,0 +1,93 @@
+// MCP Chat Rules - Compiled chat_rules matcher and auto-replies
+//
+// This file is part of Telegram Desktop MCP integration.
+// Enabled rows of chat_rules are compiled on first use after a change:
+// the keywords of all rules go into one automaton, regex conditions are
+// compiled once and rules are bucketed by chat, chat_id 0 applying to
+// every chat. A message costs one pass over its text. A rule matches
+// when every condition it has holds: "keywords" when any of them is
+// found (case-insensitive), "regex" when any of its patterns matches; a
+// rule with neither never matches. Incoming messages of the session are
+// evaluated as they come and the first matching auto_reply rule replies,
+// once a minute per chat at most. Used on the main thread.
+
+#pragma once
+
+#include "keyword_matcher.h"
+
+#include <QtCore/QHash>
+#include <QtCore/QJsonObject>
+#include <QtCore/QRegularExpression>
+#include <QtCore/QString>
+#include <QtSql/QSqlDatabase>
+
+#include <vector>
+
+class HistoryItem;
+
+namespace Main {
+class Session;
+} // namespace Main
+
+namespace MCP {
+
+struct ChatRule {
+	qint64 id = 0;
+	qint64 chatId = 0; // 0 for every chat.
+	QString name;
+	QString type;
+	QJsonObject actions;
+	int priority = 0; // Lower goes first.
+};
+
+class ChatRules final {
+public:
+	explicit ChatRules(QSqlDatabase db);
+
+	bool initialize();
+
+	void subscribe(not_null<Main::Session*> session);
+	void unsubscribe();
+
+	// After any write to chat_rules.
+	void invalidate();
+
+	// Matching rules by priority, an empty type for rules of any type.
+	// The pointers live until the next invalidate().
+	[[nodiscard]] std::vector<const ChatRule*> evaluate(
+		qint64 chatId,
+		const QString &text,
+		const QString &type = QString());
+
+	[[nodiscard]] QJsonObject stats() const;
+
+private:
+	struct Compiled {
+		ChatRule rule;
+		std::vector<int> keywords; // Pattern ids.
+		std::vector<QRegularExpression> regexes;
+	};
+
+	void ensureCompiled();
+	void compile();
+	void received(not_null<HistoryItem*> item);
+	void triggered(const ChatRule &rule);
+
+	QSqlDatabase _db;
+	std::vector<Compiled> _rules; // By priority.
+	KeywordMatcher _matcher;
+	std::vector<std::vector<int>> _patternRules;
+	QHash<qint64, std::vector<int>> _byChat; // 0 for every chat.
+	bool _compiled = false;
+
+	QHash<QString, qint64> _lastReplies; // "rule:chat" -> ms
+	qint64 _evaluated = 0;
+	qint64 _matched = 0;
+	qint64 _replied = 0;
+	qint64 _compilations = 0;
+
+	rpl::lifetime _sessionLifetime;
+
+};
+
+} // namespace MCP
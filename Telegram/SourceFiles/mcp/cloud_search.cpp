@@ -0,0 +1,175 @@
+// MCP Cloud Search - messages.search pages cached for search_messages
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "cloud_search.h"
+
+#include "api/api_messages_search_merged.h"
+#include "data/data_peer.h"
+#include "history/history.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QTimer>
+
+#include <algorithm>
+
+namespace MCP {
+namespace {
+
+constexpr auto kCacheLifetime = 5 * 60 * 1000; // ms
+constexpr auto kRequestTimeout = 15 * 1000; // ms, failed requests are silent
+constexpr auto kMaxCachedQueries = 64;
+
+[[nodiscard]] qint64 Now() {
+	return QDateTime::currentMSecsSinceEpoch();
+}
+
+} // namespace
+
+CloudSearch::CloudSearch(QObject *parent)
+: QObject(parent) {
+}
+
+CloudSearch::~CloudSearch() = default;
+
+CloudSearchState CloudSearch::search(
+		not_null<History*> history,
+		const QString &query,
+		int limit,
+		Listener listener) {
+	const auto key = Key(history->peer->id, query);
+	auto &entry = entryFor(history, key);
+	auto result = CloudSearchState{ entry.search->messages().messages };
+	const auto found = int(result.found.size());
+	if (entry.finished || found >= limit) {
+		return result;
+	}
+	entry.wanted = std::max(entry.wanted, limit);
+	entry.subscribers.push_back({ found, std::move(listener) });
+	result.pending = true;
+	if (!entry.loading) {
+		request(key, entry);
+	}
+	return result;
+}
+
+bool CloudSearch::fresh(const Entry &entry, qint64 now) const {
+	return entry.loading
+		|| (entry.updated > 0 && now - entry.updated < kCacheLifetime);
+}
+
+CloudSearch::Entry &CloudSearch::entryFor(
+		not_null<History*> history,
+		const Key &key) {
+	const auto now = Now();
+	const auto i = _entries.find(key);
+	if (i != end(_entries)) {
+		if (fresh(i->second, now)) {
+			return i->second;
+		}
+		_entries.erase(i);
+	}
+	trim(now);
+
+	auto &entry = _entries[key];
+	entry.search = std::make_unique<Api::MessagesSearchMerged>(history);
+	rpl::merge(
+		entry.search->newFounds(),
+		entry.search->nextFounds()
+	) | rpl::start_with_next([=] {
+		received(key);
+	}, entry.lifetime);
+	return entry;
+}
+
+void CloudSearch::request(const Key &key, Entry &entry) {
+	const auto first = !entry.pages;
+	entry.loading = true;
+	entry.updated = Now();
+
+	const auto requested = entry.updated;
+	QTimer::singleShot(kRequestTimeout, this, [=] {
+		timedOut(key, requested);
+	});
+
+	if (first) {
+		entry.search->search({ .query = key.second });
+	} else {
+		entry.search->searchMore();
+	}
+}
+
+void CloudSearch::received(const Key &key) {
+	const auto i = _entries.find(key);
+	if (i == end(_entries)) {
+		return;
+	}
+	auto &entry = i->second;
+	const auto &found = entry.search->messages();
+	const auto size = int(found.messages.size());
+	entry.finished = (size == entry.received)
+		|| (found.total >= 0 && size >= found.total);
+	entry.received = size;
+	entry.updated = Now();
+	++entry.pages;
+	entry.loading = false;
+	if (!entry.finished && size < entry.wanted) {
+		request(key, entry);
+	}
+	notify(entry);
+}
+
+void CloudSearch::timedOut(const Key &key, qint64 requested) {
+	const auto i = _entries.find(key);
+	if (i == end(_entries)) {
+		return;
+	}
+	auto &entry = i->second;
+	if (!entry.loading || entry.updated != requested) {
+		return;
+	}
+	// Keep what was found for the listeners, the next search starts over.
+	entry.loading = false;
+	entry.updated = 0;
+	notify(entry);
+}
+
+void CloudSearch::notify(Entry &entry) {
+	const auto &ids = entry.search->messages().messages;
+	const auto finished = !entry.loading;
+	const auto size = int(ids.size());
+	for (auto &subscriber : entry.subscribers) {
+		if (subscriber.sent >= size && !finished) {
+			continue;
+		}
+		auto added = MessageIdsList(
+			begin(ids) + std::min(subscriber.sent, size),
+			end(ids));
+		subscriber.sent = size;
+		subscriber.listener(std::move(added), finished);
+	}
+	if (finished) {
+		entry.subscribers.clear();
+	}
+}
+
+void CloudSearch::trim(qint64 now) {
+	for (auto i = begin(_entries); i != end(_entries);) {
+		if (!fresh(i->second, now)) {
+			i = _entries.erase(i);
+		} else {
+			++i;
+		}
+	}
+	while (int(_entries.size()) >= kMaxCachedQueries) {
+		const auto oldest = std::min_element(
+			begin(_entries),
+			end(_entries),
+			[](const auto &a, const auto &b) {
+				return a.second.updated < b.second.updated;
+			});
+		_entries.erase(oldest);
+	}
+}
+
+} // namespace MCP
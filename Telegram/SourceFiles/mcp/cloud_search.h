@@ -0,0 +1,85 @@
+// MCP Cloud Search - messages.search pages cached for search_messages
+//
+// This file is part of Telegram Desktop MCP integration.
+// Runs Api::MessagesSearchMerged (the history and the one it migrated
+// from) per chat and query, keeps the found ids for a few minutes so a
+// repeated query is answered without a request, and reports every page
+// to the listeners with only the ids they did not get yet.
+
+#pragma once
+
+#include "data/data_types.h"
+
+#include <QtCore/QObject>
+#include <QtCore/QString>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+class History;
+
+namespace Api {
+class MessagesSearchMerged;
+} // namespace Api
+
+namespace MCP {
+
+struct CloudSearchState {
+	MessageIdsList found; // Newest first.
+	bool pending = false; // More pages will come to the listener.
+};
+
+class CloudSearch : public QObject {
+	Q_OBJECT
+
+public:
+	// Gets the ids found after the returned state, finished is set on
+	// the last call.
+	using Listener = std::function<void(MessageIdsList ids, bool finished)>;
+
+	explicit CloudSearch(QObject *parent = nullptr);
+	~CloudSearch();
+
+	// Loads pages until limit ids are found or the cloud has no more.
+	// The listener is kept only while the state is pending.
+	CloudSearchState search(
+		not_null<History*> history,
+		const QString &query,
+		int limit,
+		Listener listener);
+
+private:
+	using Key = std::pair<PeerId, QString>;
+
+	struct Subscriber {
+		int sent = 0;
+		Listener listener;
+	};
+
+	struct Entry {
+		std::unique_ptr<Api::MessagesSearchMerged> search;
+		std::vector<Subscriber> subscribers;
+		int wanted = 0;
+		int received = 0; // Size of the found list at the last page.
+		int pages = 0;
+		bool loading = false;
+		bool finished = false;
+		qint64 updated = 0; // Last page or request, ms since epoch.
+		rpl::lifetime lifetime;
+	};
+
+	[[nodiscard]] bool fresh(const Entry &entry, qint64 now) const;
+	Entry &entryFor(not_null<History*> history, const Key &key);
+	void request(const Key &key, Entry &entry);
+	void received(const Key &key);
+	void timedOut(const Key &key, qint64 requested);
+	void notify(Entry &entry);
+	void trim(qint64 now);
+
+	std::map<Key, Entry> _entries;
+
+};
+
+} // namespace MCP
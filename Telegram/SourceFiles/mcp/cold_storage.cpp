@@ -0,0 +1,139 @@
+// MCP Cold Storage - Compressed segment files for old message bodies
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "cold_storage.h"
+
+#include <QtCore/QDataStream>
+#include <QtCore/QDebug>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QSaveFile>
+
+#include <memory>
+
+namespace MCP {
+namespace {
+
+constexpr auto kSegmentMagic = quint32(0x4D435043); // "MCPC"
+constexpr auto kSegmentVersion = quint32(1);
+constexpr auto kCompressionLevel = 9; // Written once, read rarely.
+constexpr auto kCachedSegments = 16;
+
+} // namespace
+
+ColdStorage::ColdStorage(const QString &directory)
+: _directory(directory)
+, _segments(kCachedSegments) {
+}
+
+QString ColdStorage::segmentPath(qint64 chatId, qint64 segmentId) const {
+	return QString("%1/%2/%3.seg").arg(_directory).arg(chatId).arg(segmentId);
+}
+
+qint64 ColdStorage::write(
+		qint64 chatId,
+		qint64 segmentId,
+		const std::vector<ColdMessage> &messages) {
+	auto raw = QByteArray();
+	{
+		QDataStream out(&raw, QIODevice::WriteOnly);
+		out.setVersion(QDataStream::Qt_6_0);
+		out << kSegmentMagic << kSegmentVersion << qint32(messages.size());
+		for (const auto &message : messages) {
+			out << message.messageId << message.content << message.metadata;
+		}
+	}
+	const auto compressed = qCompress(raw, kCompressionLevel);
+
+	const auto path = segmentPath(chatId, segmentId);
+	if (!QDir().mkpath(QString("%1/%2").arg(_directory).arg(chatId))) {
+		qWarning() << "MCP: Failed to create cold storage directory for" << chatId;
+		return -1;
+	}
+	QSaveFile file(path);
+	if (!file.open(QIODevice::WriteOnly)
+		|| file.write(compressed) != compressed.size()
+		|| !file.commit()) {
+		qWarning() << "MCP: Failed to write cold segment" << path << file.errorString();
+		return -1;
+	}
+
+	QMutexLocker lock(&_mutex);
+	_segments.remove(segmentId);
+	return compressed.size();
+}
+
+void ColdStorage::remove(qint64 chatId, qint64 segmentId) {
+	QFile::remove(segmentPath(chatId, segmentId));
+
+	QMutexLocker lock(&_mutex);
+	_segments.remove(segmentId);
+}
+
+std::optional<ColdMessage> ColdStorage::find(
+		qint64 chatId,
+		qint64 segmentId,
+		qint64 messageId) {
+	const auto lookup = [&](const Segment &segment) {
+		const auto i = segment.constFind(messageId);
+		return (i != segment.cend())
+			? std::make_optional(i.value())
+			: std::nullopt;
+	};
+	{
+		QMutexLocker lock(&_mutex);
+		if (const auto segment = _segments.object(segmentId)) {
+			return lookup(*segment);
+		}
+	}
+
+	// Decompressed unlocked, other readers keep hitting the cache.
+	const auto segment = read(chatId, segmentId);
+	if (!segment) {
+		return std::nullopt;
+	}
+	const auto result = lookup(*segment);
+
+	QMutexLocker lock(&_mutex);
+	_segments.insert(segmentId, segment);
+	return result;
+}
+
+ColdStorage::Segment *ColdStorage::read(
+		qint64 chatId,
+		qint64 segmentId) const {
+	QFile file(segmentPath(chatId, segmentId));
+	if (!file.open(QIODevice::ReadOnly)) {
+		qWarning() << "MCP: Missing cold segment" << file.fileName();
+		return nullptr;
+	}
+	const auto raw = qUncompress(file.readAll());
+
+	QDataStream in(raw);
+	in.setVersion(QDataStream::Qt_6_0);
+	auto magic = quint32();
+	auto version = quint32();
+	auto count = qint32();
+	in >> magic >> version >> count;
+	if (magic != kSegmentMagic || version != kSegmentVersion || count < 0) {
+		qWarning() << "MCP: Bad cold segment" << file.fileName();
+		return nullptr;
+	}
+
+	auto result = std::make_unique<Segment>();
+	result->reserve(count);
+	for (auto i = 0; i != count; ++i) {
+		auto message = ColdMessage();
+		in >> message.messageId >> message.content >> message.metadata;
+		result->insert(message.messageId, std::move(message));
+	}
+	if (in.status() != QDataStream::Ok) {
+		qWarning() << "MCP: Truncated cold segment" << file.fileName();
+		return nullptr;
+	}
+	return result.release();
+}
+
+} // namespace MCP
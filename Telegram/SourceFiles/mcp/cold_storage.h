@@ -0,0 +1,57 @@
+// MCP Cold Storage - Compressed segment files for old message bodies
+//
+// This file is part of Telegram Desktop MCP integration.
+// Old messages keep their row in the archive database, only the bulky
+// content and metadata columns move into zlib-compressed segment files,
+// one directory per chat. The messages row points at its segment.
+
+#pragma once
+
+#include <QtCore/QCache>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+
+#include <optional>
+#include <vector>
+
+namespace MCP {
+
+struct ColdMessage {
+	qint64 messageId = 0;
+	QString content;
+	QString metadata;
+};
+
+class ColdStorage {
+public:
+	explicit ColdStorage(const QString &directory);
+
+	[[nodiscard]] QString directory() const { return _directory; }
+
+	// Replaces the segment file atomically, returns its size or -1.
+	qint64 write(
+		qint64 chatId,
+		qint64 segmentId,
+		const std::vector<ColdMessage> &messages);
+	void remove(qint64 chatId, qint64 segmentId);
+
+	// Decoded segments are cached, so reading a page of neighbouring
+	// messages decompresses their segment once.
+	[[nodiscard]] std::optional<ColdMessage> find(
+		qint64 chatId,
+		qint64 segmentId,
+		qint64 messageId);
+
+private:
+	using Segment = QHash<qint64, ColdMessage>;
+
+	[[nodiscard]] QString segmentPath(qint64 chatId, qint64 segmentId) const;
+	[[nodiscard]] Segment *read(qint64 chatId, qint64 segmentId) const;
+
+	const QString _directory;
+	QMutex _mutex;
+	QCache<qint64, Segment> _segments;
+};
+
+} // namespace MCP
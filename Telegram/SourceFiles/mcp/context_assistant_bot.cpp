@@ -3,6 +3,7 @@
 // Licensed under GPLv3 with OpenSSL exception.
 
 #include "context_assistant_bot.h"
+#include "context_builder.h"
 #include "semantic_search.h"
 #include "analytics.h"
 
@@ -11,6 +12,30 @@
 #include <algorithm>
 
 namespace MCP {
+namespace {
+
+QVector<Message> RecentMessages(const ChatContextWindow &window, int limit) {
+	QVector<Message> result;
+	const int count = int(window.messages.size());
+	for (int i = std::max(count - limit, 0); i != count; ++i) {
+		const ContextEntry &entry = window.messages[i];
+		Message msg;
+		msg.id = entry.messageId;
+		msg.chatId = window.chatId;
+		msg.userId = entry.senderId;
+		msg.username = entry.sender;
+		msg.text = entry.text;
+		msg.timestamp = entry.date;
+		msg.messageType = "text";
+		msg.reactionCount = 0;
+		msg.isThreadStart = false;
+		msg.threadReplyCount = 0;
+		result.append(msg);
+	}
+	return result;
+}
+
+} // namespace
 
 ContextAssistantBot::ContextAssistantBot(QObject *parent)
 	: BotBase(parent) {
@@ -337,16 +362,28 @@ void ContextAssistantBot::updateContext(const Message &msg) {
 	context.chatId = msg.chatId;
 	context.lastActivity = QDateTime::currentDateTime();
 
-	// Add to recent messages
-	context.recentMessages.append(msg);
-
-	// Keep only last N messages
-	while (context.recentMessages.size() > _maxContextMessages) {
-		context.recentMessages.removeFirst();
+	// The builder keeps the window from the live messages already,
+	// our own list is only a fallback without a session
+	ContextBuilder *builder = contextBuilder();
+	const auto window = builder ? builder->context(msg.chatId) : nullptr;
+	if (window && !window->messages.empty()) {
+		context.recentMessages = RecentMessages(*window, _maxContextMessages);
+	} else {
+		context.recentMessages.append(msg);
+		while (context.recentMessages.size() > _maxContextMessages) {
+			context.recentMessages.removeFirst();
+		}
 	}
 
 	// Extract topics and entities
 	context.detectedTopics = extractTopics(msg.text);
+	if (window) {
+		for (const QString &term : window->terms) {
+			if (!context.detectedTopics.contains(term)) {
+				context.detectedTopics.append(term);
+			}
+		}
+	}
 	context.detectedEntities = extractEntities(msg.text);
 
 	// Calculate context confidence
@@ -463,9 +500,19 @@ void ContextAssistantBot::suggestSearch(qint64 chatId, const QString &query) {
 		return;
 	}
 
-	QString suggestion = QString(
-		"🔍 Would you like me to search for \"%1\" in your message history?"
-	).arg(query);
+	// Related messages were looked up in the background already
+	ContextBuilder *builder = contextBuilder();
+	const auto window = builder ? builder->context(chatId) : nullptr;
+	const int related = window ? int(window->related.size()) : 0;
+
+	QString suggestion = related
+		? QString(
+			"🔍 I found %1 earlier messages related to this. "
+			"Would you like me to show them?"
+		).arg(related)
+		: QString(
+			"🔍 Would you like me to search for \"%1\" in your message history?"
+		).arg(query);
 
 	sendMessage(chatId, suggestion);
 	_totalSuggestionsOffered++;
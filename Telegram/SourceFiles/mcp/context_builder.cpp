@@ -0,0 +1,498 @@
+// MCP Context Builder - Rolling context windows of active chats
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "context_builder.h"
+
+#include "mcp_helpers.h"
+#include "semantic_search.h"
+#include "base/algorithm.h"
+#include "data/data_changes.h"
+#include "data/data_peer.h"
+#include "data/data_session.h"
+#include "history/history.h"
+#include "history/history_item.h"
+#include "history/view/history_view_element.h"
+#include "main/main_session.h"
+
+#include <QtCore/QMutexLocker>
+#include <QtCore/QSet>
+
+#include <algorithm>
+
+namespace MCP {
+namespace {
+
+constexpr auto kDefaultMaxMessages = 50;
+constexpr auto kDefaultMaxTokens = 2000;
+constexpr auto kMaxWindows = 64;
+constexpr auto kTermMessages = 12; // Newest ones the terms come from.
+constexpr auto kMaxTerms = 3; // Full-text ANDs them, more rarely match.
+constexpr auto kMinTermLength = 4;
+constexpr auto kRelatedLimit = 8;
+constexpr auto kPrefetchDelayMs = 1500; // A burst costs one lookup.
+constexpr auto kSnippetLength = 200;
+
+[[nodiscard]] QStringList Tokens(const QString &text) {
+	auto result = QStringList();
+	auto current = QString();
+	const auto flush = [&] {
+		if (!current.isEmpty()) {
+			result.push_back(std::move(current));
+			current = QString();
+		}
+	};
+	for (const auto ch : text) {
+		if (IsUnsegmentedScript(ch)) {
+			flush();
+			result.push_back(QString(ch.toLower()));
+		} else if (ch.isLetterOrNumber()) {
+			current.append(ch.toLower());
+		} else {
+			flush();
+		}
+	}
+	flush();
+	return result;
+}
+
+[[nodiscard]] bool IsStopWord(const QString &token) {
+	static const auto words = QSet<QString>{
+		"about", "after", "again", "also", "been", "before", "being",
+		"could", "does", "doing", "from", "have", "here", "just", "like",
+		"make", "more", "much", "only", "other", "really", "should",
+		"some", "than", "that", "their", "them", "then", "there", "these",
+		"they", "thing", "think", "this", "those", "very", "want", "well",
+		"were", "what", "when", "where", "which", "while", "will", "with",
+		"would", "your",
+	};
+	return words.contains(token);
+}
+
+[[nodiscard]] bool IsNumber(const QString &token) {
+	return std::all_of(token.begin(), token.end(), [](QChar ch) {
+		return ch.isDigit();
+	});
+}
+
+[[nodiscard]] int EntryTokens(const ContextEntry &entry) {
+	return int(entry.tokens.size()) + 1; // And the sender.
+}
+
+[[nodiscard]] ContextEntry EntryFromItem(not_null<const HistoryItem*> item) {
+	const auto from = item->from();
+	auto result = ContextEntry{
+		.messageId = item->id.bare,
+		.senderId = qint64(from->id.value),
+		.sender = from->name(),
+		.text = item->originalText().text,
+		.date = item->date(),
+		.outgoing = item->out(),
+	};
+	result.tokens = Tokens(result.text);
+	return result;
+}
+
+[[nodiscard]] QStringList TopTerms(const std::vector<ContextEntry> &messages) {
+	struct Counted {
+		int count = 0;
+		int last = 0; // Position of the newest use.
+	};
+	auto counts = QHash<QString, Counted>();
+	auto position = 0;
+	const auto from = std::max(int(messages.size()) - kTermMessages, 0);
+	for (auto i = from; i != int(messages.size()); ++i) {
+		for (const auto &token : messages[i].tokens) {
+			++position;
+			if (token.size() < kMinTermLength
+				|| IsNumber(token)
+				|| IsStopWord(token)) {
+				continue;
+			}
+			auto &counted = counts[token];
+			++counted.count;
+			counted.last = position;
+		}
+	}
+	auto ranked = std::vector<std::pair<QString, Counted>>();
+	ranked.reserve(counts.size());
+	for (auto i = counts.cbegin(); i != counts.cend(); ++i) {
+		ranked.emplace_back(i.key(), i.value());
+	}
+	const auto kept = std::min(int(ranked.size()), kMaxTerms);
+	std::partial_sort(
+		begin(ranked),
+		begin(ranked) + kept,
+		end(ranked),
+		[](const auto &a, const auto &b) {
+			return (a.second.count != b.second.count)
+				? (a.second.count > b.second.count)
+				: (a.second.last > b.second.last);
+		});
+	auto result = QStringList();
+	for (auto i = 0; i != kept; ++i) {
+		result.push_back(ranked[i].first);
+	}
+	return result;
+}
+
+} // namespace
+
+ContextBuilder::ContextBuilder(SemanticSearch *search)
+: _search(search)
+, _maxMessages(kDefaultMaxMessages)
+, _maxTokens(kDefaultMaxTokens)
+, _pool(std::make_unique<QThreadPool>()) {
+	_pool->setMaxThreadCount(1);
+	_prefetchTimer.setSingleShot(true);
+	_prefetchTimer.setInterval(kPrefetchDelayMs);
+	connect(&_prefetchTimer, &QTimer::timeout, this, [=] {
+		prefetchQueued();
+	});
+}
+
+ContextBuilder::~ContextBuilder() {
+	_pool->clear();
+	_pool->waitForDone();
+}
+
+void ContextBuilder::subscribe(not_null<Main::Session*> session) {
+	unsubscribe();
+	_session = session;
+
+	const auto owner = &session->data();
+	owner->newItemAdded(
+	) | rpl::start_with_next([=](not_null<HistoryItem*> item) {
+		added(item);
+	}, _sessionLifetime);
+
+	session->changes().messageUpdates(
+		Data::MessageUpdate::Flag::Edited
+	) | rpl::start_with_next([=](const Data::MessageUpdate &update) {
+		edited(update.item);
+	}, _sessionLifetime);
+
+	owner->itemRemoved(
+	) | rpl::start_with_next([=](not_null<const HistoryItem*> item) {
+		removed(qint64(item->history()->peer->id.value), item->id.bare);
+	}, _sessionLifetime);
+
+	// Sent messages get their server id.
+	owner->itemIdChanged(
+	) | rpl::start_with_next([=](const Data::Session::IdChange &change) {
+		idChanged(
+			qint64(change.newId.peer.value),
+			change.oldId.bare,
+			change.newId.msg.bare);
+	}, _sessionLifetime);
+}
+
+void ContextBuilder::unsubscribe() {
+	_sessionLifetime.destroy();
+	_session = nullptr;
+	_prefetchTimer.stop();
+	_dirty.clear();
+	_windows.clear();
+
+	QMutexLocker lock(&_mutex);
+	_published.clear();
+}
+
+void ContextBuilder::setLimits(int messages, int tokens) {
+	_maxMessages = std::max(messages, 1);
+	_maxTokens = std::max(tokens, 1);
+}
+
+void ContextBuilder::setSearch(SemanticSearch *search) {
+	_search = search;
+}
+
+std::shared_ptr<const ChatContextWindow> ContextBuilder::track(
+		qint64 chatId) {
+	window(chatId);
+	return context(chatId);
+}
+
+std::shared_ptr<const ChatContextWindow> ContextBuilder::context(
+		qint64 chatId) const {
+	++_reads;
+	QMutexLocker lock(&_mutex);
+	const auto i = _published.constFind(chatId);
+	if (i == _published.cend()) {
+		++_readMisses;
+		return nullptr;
+	}
+	return i.value();
+}
+
+ContextBuilder::Window &ContextBuilder::window(qint64 chatId) {
+	auto [i, inserted] = _windows.try_emplace(chatId);
+	auto &result = i->second;
+	result.used = ++_uses;
+	if (inserted) {
+		result.data.chatId = chatId;
+		fill(result);
+		changed(result);
+		if (int(_windows.size()) > kMaxWindows) {
+			evict();
+		}
+	}
+	return result;
+}
+
+void ContextBuilder::fill(Window &window) {
+	if (!_session) {
+		return;
+	}
+	const auto history = _session->data().historyLoaded(
+		PeerId(window.data.chatId));
+	if (!history) {
+		return;
+	}
+
+	// Newest first until the budget is spent, then back in order.
+	auto &messages = window.data.messages;
+	auto tokens = 0;
+	[&] {
+		for (auto b = history->blocks.rbegin(); b != history->blocks.rend(); ++b) {
+			const auto &views = (*b)->messages;
+			for (auto m = views.rbegin(); m != views.rend(); ++m) {
+				const auto item = (*m)->data();
+				if (item->isService() || item->originalText().empty()) {
+					continue;
+				}
+				messages.push_back(EntryFromItem(item));
+				tokens += EntryTokens(messages.back());
+				if (int(messages.size()) >= _maxMessages
+					|| tokens >= _maxTokens) {
+					return;
+				}
+			}
+		}
+	}();
+	std::reverse(begin(messages), end(messages));
+}
+
+void ContextBuilder::added(not_null<HistoryItem*> item) {
+	if (item->isService() || item->originalText().empty()) {
+		return;
+	}
+	const auto chatId = qint64(item->history()->peer->id.value);
+	auto &window = this->window(chatId);
+	auto &messages = window.data.messages;
+	const auto id = item->id.bare;
+	const auto found = std::any_of(
+		begin(messages),
+		end(messages),
+		[&](const ContextEntry &entry) { return entry.messageId == id; });
+	if (found) {
+		return; // Filled from the history it was already in.
+	}
+	++_appended;
+	messages.push_back(EntryFromItem(item));
+	changed(window);
+}
+
+void ContextBuilder::edited(not_null<HistoryItem*> item) {
+	const auto i = _windows.find(qint64(item->history()->peer->id.value));
+	if (i == end(_windows)) {
+		return;
+	}
+	auto &window = i->second;
+	for (auto &entry : window.data.messages) {
+		if (entry.messageId == item->id.bare) {
+			entry = EntryFromItem(item);
+			changed(window);
+			return;
+		}
+	}
+}
+
+void ContextBuilder::removed(qint64 chatId, qint64 messageId) {
+	const auto i = _windows.find(chatId);
+	if (i == end(_windows)) {
+		return;
+	}
+	auto &window = i->second;
+	auto &messages = window.data.messages;
+	const auto j = std::find_if(
+		begin(messages),
+		end(messages),
+		[&](const ContextEntry &entry) { return entry.messageId == messageId; });
+	if (j != end(messages)) {
+		messages.erase(j);
+		changed(window);
+	}
+}
+
+void ContextBuilder::idChanged(qint64 chatId, qint64 oldId, qint64 newId) {
+	const auto i = _windows.find(chatId);
+	if (i == end(_windows)) {
+		return;
+	}
+	auto &window = i->second;
+	for (auto &entry : window.data.messages) {
+		if (entry.messageId == oldId) {
+			entry.messageId = newId;
+			changed(window);
+			return;
+		}
+	}
+}
+
+void ContextBuilder::changed(Window &window) {
+	auto &data = window.data;
+	++data.revision;
+	trim(window);
+	data.terms = TopTerms(data.messages);
+	publish(window);
+	if (_search && data.terms != data.relatedTerms) {
+		_dirty.emplace(data.chatId);
+		if (!_prefetchTimer.isActive()) {
+			_prefetchTimer.start();
+		}
+	}
+}
+
+void ContextBuilder::trim(Window &window) {
+	auto &data = window.data;
+	auto &messages = data.messages;
+	auto tokens = 0;
+	for (const auto &entry : messages) {
+		tokens += EntryTokens(entry);
+	}
+	auto drop = 0;
+	const auto count = int(messages.size());
+	while (count - drop > 1
+		&& (count - drop > _maxMessages || tokens > _maxTokens)) {
+		tokens -= EntryTokens(messages[drop++]);
+	}
+	messages.erase(begin(messages), begin(messages) + drop);
+	data.tokenCount = tokens;
+}
+
+void ContextBuilder::publish(const Window &window) {
+	auto snapshot = std::make_shared<const ChatContextWindow>(window.data);
+	QMutexLocker lock(&_mutex);
+	_published.insert(window.data.chatId, std::move(snapshot));
+}
+
+void ContextBuilder::evict() {
+	// The least recently used one, rebuilt from history when it's back.
+	const auto oldest = std::min_element(
+		begin(_windows),
+		end(_windows),
+		[](const auto &a, const auto &b) {
+			return a.second.used < b.second.used;
+		});
+	const auto chatId = oldest->first;
+	_windows.erase(oldest);
+	_dirty.remove(chatId);
+
+	QMutexLocker lock(&_mutex);
+	_published.remove(chatId);
+}
+
+void ContextBuilder::prefetchQueued() {
+	auto busy = base::flat_set<qint64>();
+	for (const auto chatId : base::take(_dirty)) {
+		const auto i = _windows.find(chatId);
+		if (i == end(_windows)) {
+			continue;
+		} else if (i->second.prefetching) {
+			busy.emplace(chatId); // Again once it's back.
+		} else {
+			prefetch(i->second);
+		}
+	}
+	_dirty = std::move(busy);
+}
+
+void ContextBuilder::prefetch(Window &window) {
+	const auto chatId = window.data.chatId;
+	const auto terms = window.data.terms;
+	if (terms.isEmpty()) {
+		++_prefetchesSkipped;
+		window.data.relatedTerms = terms;
+		window.data.related.clear();
+		publish(window);
+		return;
+	}
+	window.prefetching = true;
+	++_prefetches;
+
+	auto shown = base::flat_set<qint64>();
+	for (const auto &entry : window.data.messages) {
+		shown.emplace(entry.messageId);
+	}
+	const auto search = _search;
+	_pool->start([=, shown = std::move(shown)] {
+		auto options = HybridSearchOptions();
+		options.limit = kRelatedLimit * 2; // Some are in the window.
+		auto related = std::vector<ContextRelated>();
+		for (const auto &hit : search->hybridSearch(terms.join(' '), options)) {
+			if (hit.chatId == chatId && shown.contains(hit.messageId)) {
+				continue;
+			}
+			related.push_back({
+				.chatId = hit.chatId,
+				.messageId = hit.messageId,
+				.username = hit.username,
+				.snippet = hit.snippet.isEmpty()
+					? hit.content.left(kSnippetLength)
+					: hit.snippet,
+				.timestamp = hit.timestamp,
+				.score = hit.score,
+			});
+			if (int(related.size()) == kRelatedLimit) {
+				break;
+			}
+		}
+		QMetaObject::invokeMethod(this, [=] {
+			prefetched(chatId, terms, related);
+		}, Qt::QueuedConnection);
+	});
+}
+
+void ContextBuilder::prefetched(
+		qint64 chatId,
+		QStringList terms,
+		std::vector<ContextRelated> related) {
+	const auto i = _windows.find(chatId);
+	if (i == end(_windows)) {
+		return;
+	}
+	auto &window = i->second;
+	window.prefetching = false;
+	window.data.relatedTerms = std::move(terms);
+	window.data.related = std::move(related);
+	publish(window);
+
+	if (window.data.terms != window.data.relatedTerms) {
+		_dirty.emplace(chatId);
+		if (!_prefetchTimer.isActive()) {
+			_prefetchTimer.start();
+		}
+	}
+}
+
+QJsonObject ContextBuilder::stats() const {
+	auto messages = 0;
+	for (const auto &[chatId, window] : _windows) {
+		messages += int(window.data.messages.size());
+	}
+	return QJsonObject{
+		{ "windows", int(_windows.size()) },
+		{ "messages", messages },
+		{ "max_messages", _maxMessages },
+		{ "max_tokens", _maxTokens },
+		{ "appended", _appended },
+		{ "prefetches", _prefetches },
+		{ "prefetches_skipped", _prefetchesSkipped },
+		{ "prefetches_pending", int(_dirty.size()) },
+		{ "reads", qint64(_reads) },
+		{ "read_misses", qint64(_readMisses) },
+	};
+}
+
+} // namespace MCP
@@ -0,0 +1,145 @@
+// MCP Context Builder - Rolling context windows of active chats
+//
+// This file is part of Telegram Desktop MCP integration.
+// A chat gets a window when it is first asked for or a message arrives
+// in it. The window is filled once from the loaded history and then kept
+// up to date from the session: new messages are appended, edited ones
+// tokenized again, deleted ones dropped, and the oldest fall out once
+// the window is over its message or token budget. Every change queues a
+// background lookup of archived messages related to the window's recent
+// terms. Windows are published as immutable snapshots, so a reader gets
+// the messages and the related hits with one lookup instead of querying
+// the archive per message. context() may be called from any thread,
+// everything else on the main one.
+
+#pragma once
+
+#include "base/flat_set.h"
+
+#include <QtCore/QHash>
+#include <QtCore/QJsonObject>
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QThreadPool>
+#include <QtCore/QTimer>
+
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class HistoryItem;
+
+namespace Main {
+class Session;
+} // namespace Main
+
+namespace MCP {
+
+class SemanticSearch;
+
+struct ContextEntry {
+	qint64 messageId = 0;
+	qint64 senderId = 0;
+	QString sender;
+	QString text;
+	QStringList tokens; // Lowercase words, in text order.
+	qint64 date = 0;
+	bool outgoing = false;
+};
+
+struct ContextRelated {
+	qint64 chatId = 0;
+	qint64 messageId = 0;
+	QString username;
+	QString snippet;
+	qint64 timestamp = 0;
+	float score = 0.f;
+};
+
+struct ChatContextWindow {
+	qint64 chatId = 0;
+	std::vector<ContextEntry> messages; // Oldest first.
+	int tokenCount = 0;
+	QStringList terms; // Most frequent recent terms, by frequency.
+	std::vector<ContextRelated> related; // For relatedTerms.
+	QStringList relatedTerms;
+	qint64 revision = 0; // Bumped on every change of the messages.
+};
+
+class ContextBuilder final : public QObject {
+public:
+	// Without a search there are no related hits.
+	explicit ContextBuilder(SemanticSearch *search);
+	~ContextBuilder();
+
+	void subscribe(not_null<Main::Session*> session);
+	void unsubscribe();
+
+	// Applies to windows built or changed after the call.
+	void setLimits(int messages, int tokens);
+	void setSearch(SemanticSearch *search);
+
+	// Starts keeping the window of the chat if it wasn't kept yet.
+	std::shared_ptr<const ChatContextWindow> track(qint64 chatId);
+
+	// Null for chats without a window. Any thread.
+	[[nodiscard]] std::shared_ptr<const ChatContextWindow> context(
+		qint64 chatId) const;
+
+	[[nodiscard]] QJsonObject stats() const;
+
+private:
+	struct Window {
+		ChatContextWindow data;
+		quint64 used = 0;
+		bool prefetching = false;
+	};
+
+	Window &window(qint64 chatId);
+	void fill(Window &window);
+	void added(not_null<HistoryItem*> item);
+	void edited(not_null<HistoryItem*> item);
+	void removed(qint64 chatId, qint64 messageId);
+	void idChanged(qint64 chatId, qint64 oldId, qint64 newId);
+	void changed(Window &window);
+	void trim(Window &window);
+	void publish(const Window &window);
+	void evict();
+
+	void prefetchQueued();
+	void prefetch(Window &window);
+	void prefetched(
+		qint64 chatId,
+		QStringList terms,
+		std::vector<ContextRelated> related);
+
+	SemanticSearch *_search = nullptr;
+	Main::Session *_session = nullptr;
+	int _maxMessages = 0;
+	int _maxTokens = 0;
+
+	std::unordered_map<qint64, Window> _windows;
+	base::flat_set<qint64> _dirty;
+	QTimer _prefetchTimer;
+	quint64 _uses = 0;
+
+	mutable QMutex _mutex;
+	QHash<qint64, std::shared_ptr<const ChatContextWindow>> _published;
+
+	qint64 _appended = 0;
+	qint64 _prefetches = 0;
+	qint64 _prefetchesSkipped = 0;
+	mutable std::atomic<qint64> _reads = 0;
+	mutable std::atomic<qint64> _readMisses = 0;
+
+	rpl::lifetime _sessionLifetime;
+
+	// Last, so that running lookups finish before anything they touch.
+	std::unique_ptr<QThreadPool> _pool;
+
+};
+
+} // namespace MCP
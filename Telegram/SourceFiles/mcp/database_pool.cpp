@@ -0,0 +1,175 @@
+// MCP Database Pool - Serialized writer and per-thread readers
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "database_pool.h"
+#include "mcp_helpers.h"
+
+#include <QtCore/QDebug>
+#include <QtCore/QMetaObject>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QObject>
+#include <QtCore/QThread>
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+
+#include <algorithm>
+
+namespace MCP {
+namespace {
+
+constexpr auto kBusyTimeout = 5000; // ms
+
+// Reader names are never reused, unlike thread ids and pool addresses.
+std::atomic<int> ReadersOpened = 0;
+
+} // namespace
+
+DatabasePool::DatabasePool(const QString &path, int readerCount)
+: _path(path)
+, _readerCount(std::max(readerCount, 1))
+, _connectionPrefix(QString("mcp_pool_%1_").arg(quintptr(this))) {
+}
+
+DatabasePool::~DatabasePool() {
+	close();
+}
+
+bool DatabasePool::open() {
+	if (_open) {
+		return true;
+	}
+
+	_writerThread = std::make_unique<QThread>();
+	_writerThread->setObjectName("MCP database writer");
+	_writerContext = std::make_unique<QObject>();
+	_writerContext->moveToThread(_writerThread.get());
+	_writerThread->start();
+
+	auto opened = false;
+	QMetaObject::invokeMethod(_writerContext.get(), [&] {
+		opened = openWriter();
+	}, Qt::BlockingQueuedConnection);
+
+	if (!opened) {
+		_writerThread->quit();
+		_writerThread->wait();
+		_writerContext = nullptr;
+		_writerThread = nullptr;
+		return false;
+	}
+	_open = true;
+	return true;
+}
+
+void DatabasePool::close() {
+	if (!_open) {
+		return;
+	}
+	_open = false;
+
+	// Queued jobs run before the writer goes away.
+	QMetaObject::invokeMethod(_writerContext.get(), [=] {
+		closeWriter();
+	}, Qt::BlockingQueuedConnection);
+	_writerThread->quit();
+	_writerThread->wait();
+	_writerContext = nullptr;
+	_writerThread = nullptr;
+
+	QMutexLocker lock(&_mutex);
+	for (const auto &name : std::as_const(_readers)) {
+		StatementCache::instance().forget(name);
+		QSqlDatabase::removeDatabase(name);
+	}
+	_readers.clear();
+}
+
+bool DatabasePool::openWriter() {
+	const auto name = _connectionPrefix + "writer";
+	_writer = QSqlDatabase::addDatabase("QSQLITE", name);
+	_writer.setDatabaseName(_path);
+	_writer.setConnectOptions(
+		QString("QSQLITE_BUSY_TIMEOUT=%1").arg(kBusyTimeout));
+	if (!_writer.open()) {
+		qWarning() << "MCP: Failed to open database writer:" << _writer.lastError().text();
+		_writer = QSqlDatabase();
+		QSqlDatabase::removeDatabase(name);
+		return false;
+	}
+
+	QSqlQuery pragmas(_writer);
+	pragmas.exec("PRAGMA journal_mode = WAL");  // Readers never block the writer
+	pragmas.exec("PRAGMA synchronous = NORMAL");  // Balance safety/performance
+	pragmas.exec("PRAGMA cache_size = -64000");  // 64MB cache
+	pragmas.exec("PRAGMA temp_store = MEMORY");  // Use memory for temp tables
+	pragmas.exec("PRAGMA mmap_size = 268435456");  // 256MB memory-mapped I/O
+	pragmas.exec("PRAGMA recursive_triggers = ON");  // INSERT OR REPLACE fires delete triggers (FTS sync)
+	return true;
+}
+
+void DatabasePool::closeWriter() {
+	const auto name = _writer.connectionName();
+	StatementCache::instance().forget(name);
+	_writer.close();
+	_writer = QSqlDatabase();
+	QSqlDatabase::removeDatabase(name);
+}
+
+void DatabasePool::write(Job job) {
+	if (!_open) {
+		return;
+	}
+	QMetaObject::invokeMethod(_writerContext.get(), [=] {
+		job(_writer);
+	}, Qt::QueuedConnection);
+}
+
+void DatabasePool::writeAndWait(Job job) {
+	if (!_open) {
+		return;
+	} else if (QThread::currentThread() == _writerThread.get()) {
+		job(_writer);
+		return;
+	}
+	QMetaObject::invokeMethod(_writerContext.get(), [&] {
+		job(_writer);
+	}, Qt::BlockingQueuedConnection);
+}
+
+DatabasePool::Reader::~Reader() {
+	StatementCache::instance().forget(name);
+	QSqlDatabase::removeDatabase(name);
+}
+
+QSqlDatabase DatabasePool::reader() {
+	// A pool opened again finds the connections of its last run removed.
+	const auto reader = _reader.localData();
+	if (reader && QSqlDatabase::contains(reader->name)) {
+		return QSqlDatabase::database(reader->name);
+	}
+
+	auto name = QString();
+	{
+		QMutexLocker lock(&_mutex);
+		name = _connectionPrefix + QString("reader_%1").arg(++ReadersOpened);
+		_readers.append(name);
+	}
+	_reader.setLocalData(new Reader{ .name = name });
+
+	auto db = QSqlDatabase::addDatabase("QSQLITE", name);
+	db.setDatabaseName(_path);
+	db.setConnectOptions(
+		QString("QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=%1").arg(kBusyTimeout));
+	if (!db.open()) {
+		qWarning() << "MCP: Failed to open database reader:" << db.lastError().text();
+		return db;
+	}
+	QSqlQuery pragmas(db);
+	pragmas.exec("PRAGMA cache_size = -16000");
+	pragmas.exec("PRAGMA temp_store = MEMORY");
+	pragmas.exec("PRAGMA mmap_size = 268435456");
+	return db;
+}
+
+} // namespace MCP
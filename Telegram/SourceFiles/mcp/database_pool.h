@@ -0,0 +1,82 @@
+// MCP Database Pool - Serialized writer and per-thread readers
+//
+// This file is part of Telegram Desktop MCP integration.
+// Every component shares one SQLite file: writes are queued to a single
+// connection owned by a dedicated thread, reads use read-only WAL
+// connections of the calling thread and never wait for the writer.
+
+#pragma once
+
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QThreadStorage>
+#include <QtSql/QSqlDatabase>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+class QThread;
+class QObject;
+
+namespace MCP {
+
+class DatabasePool {
+public:
+	using Job = std::function<void(QSqlDatabase &db)>;
+
+	// readerCount bounds the threads expected to read concurrently, the
+	// tool pool is sized after it.
+	DatabasePool(const QString &path, int readerCount);
+	~DatabasePool();
+
+	bool open();
+	// Runs the queued writes, then closes every connection. Readers must
+	// not be in use by other threads any more.
+	void close();
+
+	[[nodiscard]] bool isOpen() const { return _open; }
+	[[nodiscard]] QString path() const { return _path; }
+	[[nodiscard]] int readerCount() const { return _readerCount; }
+
+	// Jobs run one at a time on the writer thread, in submission order.
+	// A job may queue the next one, those queued after close() began
+	// are dropped.
+	void write(Job job);
+	// Same, but returns after the job ran. Called on the writer thread,
+	// e.g. from inside another job, the job runs inline.
+	void writeAndWait(Job job);
+
+	// Read-only connection of the calling thread, opened on first use
+	// and removed when the thread exits.
+	// Use PreparedQuery() from mcp_helpers.h to reuse its statements.
+	[[nodiscard]] QSqlDatabase reader();
+
+private:
+	// Owned by QThreadStorage, must not use the pool: a thread may exit
+	// after the pool was destroyed.
+	struct Reader {
+		~Reader();
+
+		QString name;
+	};
+
+	bool openWriter();
+	void closeWriter();
+
+	const QString _path;
+	const int _readerCount = 0;
+	const QString _connectionPrefix;
+	std::atomic<bool> _open = false; // Read by jobs queueing jobs.
+
+	std::unique_ptr<QThread> _writerThread;
+	std::unique_ptr<QObject> _writerContext; // Lives on _writerThread.
+	QSqlDatabase _writer;
+
+	QThreadStorage<Reader*> _reader;
+	QMutex _mutex;
+	QStringList _readers;
+};
+
+} // namespace MCP
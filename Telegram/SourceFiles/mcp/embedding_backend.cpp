@@ -0,0 +1,223 @@
+// MCP Embedding Backend - Batched text embedding providers
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "embedding_backend.h"
+
+#include <QtCore/QDebug>
+#include <QtCore/QEventLoop>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QRegularExpression>
+#include <QtCore/QUrlQuery>
+#include <QtNetwork/QNetworkAccessManager>
+#include <QtNetwork/QNetworkReply>
+#include <QtNetwork/QNetworkRequest>
+
+#include <cmath>
+
+namespace MCP {
+namespace {
+
+constexpr auto kHttpBatchSize = 64;
+constexpr auto kHashingBatchSize = 256;
+constexpr auto kRequestTimeout = 60000; // ms, large batches on CPU models
+constexpr auto kTrigramWeight = 0.5f;
+
+void Normalize(EmbeddingVector &vector) {
+	auto norm = 0.;
+	for (const auto value : std::as_const(vector)) {
+		norm += double(value) * value;
+	}
+	if (norm > 0.) {
+		const auto scale = float(1. / std::sqrt(norm));
+		for (auto &value : vector) {
+			value *= scale;
+		}
+	}
+}
+
+// FNV-1a, qHash() may differ between machines and embeddings persist.
+[[nodiscard]] quint64 StableHash(const QByteArray &bytes) {
+	auto result = quint64(0xcbf29ce484222325ULL);
+	for (const auto byte : bytes) {
+		result ^= quint64(uchar(byte));
+		result *= quint64(0x100000001b3ULL);
+	}
+	return result;
+}
+
+} // namespace
+
+HttpEmbeddingBackend::HttpEmbeddingBackend(const QUrl &url)
+: _url(url)
+, _apiKey(qgetenv("MCP_EMBEDDING_API_KEY")) {
+	auto query = QUrlQuery(_url);
+	_model = query.queryItemValue("model");
+	query.removeAllQueryItems("model");
+	_url.setQuery(query);
+}
+
+QString HttpEmbeddingBackend::model() const {
+	return "http:" + (_model.isEmpty() ? _url.host() : _model);
+}
+
+int HttpEmbeddingBackend::dimensions() const {
+	return _dimensions.load();
+}
+
+int HttpEmbeddingBackend::batchSize() const {
+	return kHttpBatchSize;
+}
+
+QVector<EmbeddingVector> HttpEmbeddingBackend::embed(
+		const QStringList &texts,
+		QString *error) {
+	if (texts.isEmpty()) {
+		return {};
+	}
+	auto body = QJsonObject{
+		{ "input", QJsonArray::fromStringList(texts) },
+	};
+	if (!_model.isEmpty()) {
+		body["model"] = _model;
+	}
+
+	auto request = QNetworkRequest(_url);
+	request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+	request.setTransferTimeout(kRequestTimeout);
+	if (!_apiKey.isEmpty()) {
+		request.setRawHeader("Authorization", "Bearer " + _apiKey);
+	}
+
+	// A manager per call, so any thread may embed.
+	QNetworkAccessManager manager;
+	const auto reply = std::unique_ptr<QNetworkReply>(manager.post(
+		request,
+		QJsonDocument(body).toJson(QJsonDocument::Compact)));
+	QEventLoop loop;
+	QObject::connect(
+		reply.get(),
+		&QNetworkReply::finished,
+		&loop,
+		&QEventLoop::quit);
+	loop.exec();
+
+	const auto fail = [&](const QString &text) {
+		if (error) {
+			*error = text;
+		}
+		return QVector<EmbeddingVector>();
+	};
+	if (reply->error() != QNetworkReply::NoError) {
+		return fail("Embedding request failed: " + reply->errorString());
+	}
+	const auto document = QJsonDocument::fromJson(reply->readAll());
+	const auto data = document.object().value("data").toArray();
+	if (data.size() != texts.size()) {
+		return fail(QString("Embedding endpoint returned %1 vectors for %2 texts")
+			.arg(data.size())
+			.arg(texts.size()));
+	}
+
+	auto result = QVector<EmbeddingVector>(texts.size());
+	for (const auto &entry : data) {
+		const auto object = entry.toObject();
+		const auto index = object.value("index").toInt(-1);
+		const auto values = object.value("embedding").toArray();
+		if (index < 0 || index >= result.size() || values.isEmpty()) {
+			return fail("Malformed embedding response");
+		}
+		auto &vector = result[index];
+		vector.reserve(values.size());
+		for (const auto &value : values) {
+			vector.push_back(float(value.toDouble()));
+		}
+		Normalize(vector);
+	}
+
+	auto expected = 0;
+	const auto dimensions = int(result.front().size());
+	if (!_dimensions.compare_exchange_strong(expected, dimensions)
+		&& expected != dimensions) {
+		return fail(QString("Embedding size changed from %1 to %2")
+			.arg(expected)
+			.arg(dimensions));
+	}
+	for (const auto &vector : std::as_const(result)) {
+		if (vector.size() != dimensions) {
+			return fail("Embedding sizes differ within a batch");
+		}
+	}
+	return result;
+}
+
+HashingEmbeddingBackend::HashingEmbeddingBackend(int dimensions)
+: _dimensions(dimensions) {
+}
+
+QString HashingEmbeddingBackend::model() const {
+	return QString("hashing-%1").arg(_dimensions);
+}
+
+int HashingEmbeddingBackend::dimensions() const {
+	return _dimensions;
+}
+
+int HashingEmbeddingBackend::batchSize() const {
+	return kHashingBatchSize;
+}
+
+QVector<EmbeddingVector> HashingEmbeddingBackend::embed(
+		const QStringList &texts,
+		QString *error) {
+	Q_UNUSED(error);
+
+	static const auto words = QRegularExpression(
+		R"(\w+)",
+		QRegularExpression::UseUnicodePropertiesOption);
+
+	auto result = QVector<EmbeddingVector>();
+	result.reserve(texts.size());
+	for (const auto &text : texts) {
+		auto vector = EmbeddingVector(_dimensions, 0.f);
+		const auto add = [&](const QByteArray &feature, float weight) {
+			const auto hash = StableHash(feature);
+			const auto sign = (hash >> 63) ? -1.f : 1.f;
+			vector[int(hash % quint64(_dimensions))] += sign * weight;
+		};
+		auto i = words.globalMatch(text);
+		while (i.hasNext()) {
+			const auto word = i.next().captured().toLower();
+			add("w:" + word.toUtf8(), 1.f);
+
+			// Trigrams keep inflected forms of a word close to each other.
+			const auto padded = QString('^' + word + '$');
+			for (auto j = 0; j + 3 <= padded.size(); ++j) {
+				add("t:" + padded.mid(j, 3).toUtf8(), kTrigramWeight);
+			}
+		}
+		Normalize(vector);
+		result.push_back(std::move(vector));
+	}
+	return result;
+}
+
+std::unique_ptr<EmbeddingBackend> CreateEmbeddingBackend(
+		const QString &spec,
+		int defaultDimensions) {
+	const auto value = spec.isEmpty()
+		? QString::fromUtf8(qgetenv("MCP_EMBEDDING_URL"))
+		: spec;
+	const auto url = QUrl(value);
+	if (url.scheme() == "http" || url.scheme() == "https") {
+		return std::make_unique<HttpEmbeddingBackend>(url);
+	} else if (!value.isEmpty()) {
+		qWarning() << "MCP: Unsupported embedding backend" << value
+			<< "- using the hashing backend";
+	}
+	return std::make_unique<HashingEmbeddingBackend>(defaultDimensions);
+}
+
+} // namespace MCP
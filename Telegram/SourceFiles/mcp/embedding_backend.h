@@ -0,0 +1,84 @@
+// MCP Embedding Backend - Batched text embedding providers
+//
+// This file is part of Telegram Desktop MCP integration.
+// SemanticSearch embeds texts through one of these. Backends take whole
+// batches, so a remote model pays one round trip per batch, and block the
+// calling thread: call them from the indexing thread or the tool pool.
+
+#pragma once
+
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QUrl>
+#include <QtCore/QVector>
+
+#include <atomic>
+#include <memory>
+
+namespace MCP {
+
+// Embedding vector (typically 384 dimensions for all-MiniLM-L6-v2)
+using EmbeddingVector = QVector<float>;
+
+class EmbeddingBackend {
+public:
+	virtual ~EmbeddingBackend() = default;
+
+	// Stored next to every embedding, vectors of other models are ignored.
+	[[nodiscard]] virtual QString model() const = 0;
+	// 0 until known, remote models report it with the first batch.
+	[[nodiscard]] virtual int dimensions() const = 0;
+	[[nodiscard]] virtual int batchSize() const = 0;
+
+	// One L2-normalized vector per text, in order, or an empty result
+	// with *error filled. Safe to call from several threads at once.
+	[[nodiscard]] virtual QVector<EmbeddingVector> embed(
+		const QStringList &texts,
+		QString *error) = 0;
+};
+
+// Any OpenAI-compatible /embeddings endpoint: OpenAI, Ollama, llama.cpp
+// server, text-embeddings-inference. The model is taken from the "model"
+// query item of the url, the key from MCP_EMBEDDING_API_KEY.
+class HttpEmbeddingBackend final : public EmbeddingBackend {
+public:
+	explicit HttpEmbeddingBackend(const QUrl &url);
+
+	[[nodiscard]] QString model() const override;
+	[[nodiscard]] int dimensions() const override;
+	[[nodiscard]] int batchSize() const override;
+	[[nodiscard]] QVector<EmbeddingVector> embed(
+		const QStringList &texts,
+		QString *error) override;
+
+private:
+	QUrl _url;
+	QString _model;
+	QByteArray _apiKey;
+	std::atomic<int> _dimensions = 0;
+};
+
+// Offline fallback: signed feature hashing of words and character
+// trigrams. Purely lexical, but deterministic across machines and runs.
+class HashingEmbeddingBackend final : public EmbeddingBackend {
+public:
+	explicit HashingEmbeddingBackend(int dimensions);
+
+	[[nodiscard]] QString model() const override;
+	[[nodiscard]] int dimensions() const override;
+	[[nodiscard]] int batchSize() const override;
+	[[nodiscard]] QVector<EmbeddingVector> embed(
+		const QStringList &texts,
+		QString *error) override;
+
+private:
+	const int _dimensions = 0;
+};
+
+// "http(s)://..." selects the HTTP backend, an empty value falls back
+// to MCP_EMBEDDING_URL and then to the hashing backend.
+[[nodiscard]] std::unique_ptr<EmbeddingBackend> CreateEmbeddingBackend(
+	const QString &spec,
+	int defaultDimensions);
+
+} // namespace MCP
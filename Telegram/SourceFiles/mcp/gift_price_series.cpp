@@ -0,0 +1,326 @@
+// MCP Gift Price Series - Resale price history of star gift collections
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "gift_price_series.h"
+
+#include "api/api_premium.h"
+#include "data/data_star_gift.h"
+#include "data/data_user.h"
+#include "main/main_session.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QDebug>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+
+#include <algorithm>
+
+namespace MCP {
+namespace {
+
+constexpr auto kFetchInterval = 15 * 60 * 1000; // ms, one request each.
+constexpr auto kFirstFetchDelay = 30 * 1000;
+constexpr auto kSeriesExtension = ".series";
+
+// File header, bumped if the record layout ever changes.
+constexpr auto kMagic = "GPS1";
+constexpr auto kMagicSize = 4;
+
+void AppendVarint(QByteArray &to, qint64 value) {
+	// Zigzag, so that small negative deltas stay short as well.
+	auto bits = (quint64(value) << 1) ^ quint64(value >> 63);
+	while (bits >= 0x80) {
+		to.append(char((bits & 0x7F) | 0x80));
+		bits >>= 7;
+	}
+	to.append(char(bits));
+}
+
+// Returns false on a truncated value at the end of the data.
+bool ReadVarint(const uchar *&from, const uchar *till, qint64 &value) {
+	auto bits = quint64();
+	for (auto shift = 0; from != till && shift < 64; shift += 7) {
+		const auto byte = *from++;
+		bits |= quint64(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) {
+			value = qint64(bits >> 1) ^ -qint64(bits & 1);
+			return true;
+		}
+	}
+	return false;
+}
+
+// Calls method for every complete record, returns the bytes they take.
+template <typename Method>
+qint64 Decode(const uchar *data, qint64 size, Method &&method) {
+	if (size < kMagicSize || memcmp(data, kMagic, kMagicSize) != 0) {
+		return 0;
+	}
+	const auto till = data + size;
+	auto from = data + kMagicSize;
+	auto sample = PriceSample();
+	auto complete = qint64(kMagicSize);
+	while (from != till) {
+		auto time = qint64();
+		auto price = qint64();
+		auto listings = qint64();
+		if (!ReadVarint(from, till, time)
+			|| !ReadVarint(from, till, price)
+			|| !ReadVarint(from, till, listings)) {
+			break;
+		}
+		sample.time += time;
+		sample.price += price;
+		sample.listings += listings;
+		complete = qint64(from - data);
+		method(sample);
+	}
+	return complete;
+}
+
+} // namespace
+
+std::vector<PriceBucket> Downsample(const PriceSeries &series, int buckets) {
+	auto result = std::vector<PriceBucket>();
+	if (series.empty() || buckets <= 0) {
+		return result;
+	}
+	const auto from = series.times.front();
+	const auto till = series.times.back() + 1;
+	const auto step = std::max((till - from + buckets - 1) / buckets, qint64(1));
+	result.reserve(std::min(buckets, series.size()));
+
+	auto listings = qint64();
+	auto count = 0;
+	for (auto i = 0; i != series.size(); ++i) {
+		const auto time = series.times[i];
+		const auto price = series.prices[i];
+		const auto start = from + ((time - from) / step) * step;
+		if (result.empty() || result.back().from != start) {
+			if (count) {
+				result.back().listings = double(listings) / count;
+			}
+			result.push_back({
+				.from = start,
+				.till = start + step,
+				.open = price,
+				.high = price,
+				.low = price,
+			});
+			listings = 0;
+			count = 0;
+		}
+		auto &bucket = result.back();
+		bucket.high = std::max(bucket.high, price);
+		bucket.low = std::min(bucket.low, price);
+		bucket.close = price;
+		listings += series.listings[i];
+		++count;
+	}
+	result.back().listings = double(listings) / count;
+	return result;
+}
+
+BacktestResult BacktestCrossover(
+		const PriceSeries &series,
+		int shortWindow,
+		int longWindow) {
+	auto result = BacktestResult();
+	const auto size = series.size();
+	shortWindow = std::max(shortWindow, 1);
+	longWindow = std::max(longWindow, shortWindow + 1);
+	if (size <= longWindow) {
+		return result;
+	}
+	const auto &prices = series.prices;
+
+	// Moving averages are differences of the prefix sums.
+	auto sums = std::vector<double>(size + 1);
+	for (auto i = 0; i != size; ++i) {
+		sums[i + 1] = sums[i] + double(prices[i]);
+	}
+	auto inPosition = std::vector<char>(size);
+	for (auto i = longWindow - 1; i != size; ++i) {
+		const auto shortAverage = (sums[i + 1] - sums[i + 1 - shortWindow])
+			/ shortWindow;
+		const auto longAverage = (sums[i + 1] - sums[i + 1 - longWindow])
+			/ longWindow;
+		inPosition[i] = (shortAverage > longAverage) ? 1 : 0;
+	}
+
+	// A position taken at a sample earns the change to the next one.
+	const auto first = longWindow - 1;
+	for (auto i = first + 1; i != size; ++i) {
+		result.profit += inPosition[i - 1]
+			* double(prices[i] - prices[i - 1]);
+		result.trades += (inPosition[i] != inPosition[i - 1]) ? 1 : 0;
+	}
+	result.trades += inPosition[first];
+	result.samples = size - first;
+	if (const auto base = double(prices[first]); base > 0.) {
+		result.returnPercent = result.profit / base * 100.;
+		result.holdReturnPercent = (prices.back() - base) / base * 100.;
+	}
+	return result;
+}
+
+GiftPriceSeries::GiftPriceSeries(const QString &directory, QObject *parent)
+: QObject(parent)
+, _directory(directory) {
+	QDir().mkpath(_directory);
+	_fetchTimer.setSingleShot(true);
+	connect(&_fetchTimer, &QTimer::timeout, this, [=] {
+		fetch();
+	});
+}
+
+GiftPriceSeries::~GiftPriceSeries() {
+	stop();
+}
+
+void GiftPriceSeries::start(not_null<Main::Session*> session) {
+	stop();
+	_session = session;
+	_api = std::make_unique<Api::PremiumGiftCodeOptions>(session->user());
+	_fetchTimer.start(kFirstFetchDelay);
+}
+
+void GiftPriceSeries::stop() {
+	_requestLifetime.destroy();
+	_fetchTimer.stop();
+	_api = nullptr;
+	_session = nullptr;
+}
+
+void GiftPriceSeries::fetch() {
+	_requestLifetime.destroy();
+	_api->requestStarGifts(
+	) | rpl::start_with_error_done([=](const QString &error) {
+		qWarning() << "MCP: Gift catalogue request failed:" << error;
+		_fetchTimer.start(kFetchInterval);
+	}, [=] {
+		received(_api->starGifts());
+		_fetchTimer.start(kFetchInterval);
+	}, _requestLifetime);
+}
+
+void GiftPriceSeries::received(const std::vector<Data::StarGift> &gifts) {
+	const auto now = QDateTime::currentSecsSinceEpoch();
+	for (const auto &gift : gifts) {
+		if (gift.unique || !gift.resellCount) {
+			continue;
+		}
+		if (!gift.resellTitle.isEmpty()) {
+			_titles.insert(gift.id, gift.resellTitle);
+		}
+		append(gift.id, { now, gift.starsResellMin, gift.resellCount });
+	}
+}
+
+QString GiftPriceSeries::path(quint64 giftId) const {
+	return _directory + '/' + QString::number(giftId) + kSeriesExtension;
+}
+
+auto GiftPriceSeries::tail(quint64 giftId) -> Tail & {
+	const auto i = _tails.find(giftId);
+	if (i != _tails.end()) {
+		return *i;
+	}
+	auto result = Tail();
+	auto file = QFile(path(giftId));
+	if (file.open(QIODevice::ReadWrite) && file.size() > 0) {
+		if (const auto data = file.map(0, file.size())) {
+			result.size = Decode(data, file.size(), [&](
+					const PriceSample &sample) {
+				result.last = sample;
+			});
+			file.unmap(data);
+		}
+		if (result.size < file.size()) {
+			// A record cut by a crash, or a file of another format.
+			file.resize(result.size);
+		}
+	}
+	return *_tails.insert(giftId, result);
+}
+
+void GiftPriceSeries::append(quint64 giftId, const PriceSample &sample) {
+	auto &last = tail(giftId);
+	auto bytes = QByteArray();
+	if (!last.size) {
+		bytes.append(kMagic, kMagicSize);
+	}
+	AppendVarint(bytes, sample.time - last.last.time);
+	AppendVarint(bytes, sample.price - last.last.price);
+	AppendVarint(bytes, sample.listings - last.last.listings);
+
+	auto file = QFile(path(giftId));
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Append)
+		|| file.write(bytes) != bytes.size()) {
+		qWarning() << "MCP: Failed to append to" << file.fileName();
+		_tails.remove(giftId);
+		return;
+	}
+	last.size += bytes.size();
+	last.last = sample;
+}
+
+PriceSeries GiftPriceSeries::read(
+		quint64 giftId,
+		qint64 from,
+		qint64 till) const {
+	auto result = PriceSeries();
+	auto file = QFile(path(giftId));
+	if (!file.open(QIODevice::ReadOnly) || !file.size()) {
+		return result;
+	}
+	const auto data = file.map(0, file.size());
+	if (!data) {
+		return result;
+	}
+	Decode(data, file.size(), [&](const PriceSample &sample) {
+		if (sample.time >= from && sample.time <= till) {
+			result.times.push_back(sample.time);
+			result.prices.push_back(sample.price);
+			result.listings.push_back(sample.listings);
+		}
+	});
+	file.unmap(data);
+	return result;
+}
+
+std::vector<quint64> GiftPriceSeries::collections() const {
+	auto result = std::vector<quint64>();
+	const auto files = QDir(_directory).entryList(
+		{ QString("*") + kSeriesExtension },
+		QDir::Files);
+	result.reserve(files.size());
+	for (const auto &name : files) {
+		auto ok = false;
+		const auto id = name.section('.', 0, 0).toULongLong(&ok);
+		if (ok) {
+			result.push_back(id);
+		}
+	}
+	return result;
+}
+
+QString GiftPriceSeries::title(quint64 giftId) const {
+	return _titles.value(giftId);
+}
+
+quint64 GiftPriceSeries::resolve(const QString &gift) const {
+	auto ok = false;
+	if (const auto id = gift.toULongLong(&ok); ok) {
+		return id;
+	}
+	for (auto i = _titles.begin(); i != _titles.end(); ++i) {
+		if (!i->compare(gift, Qt::CaseInsensitive)) {
+			return i.key();
+		}
+	}
+	return 0;
+}
+
+} // namespace MCP
@@ -0,0 +1,126 @@
+// MCP Gift Price Series - Resale price history of star gift collections
+//
+// This file is part of Telegram Desktop MCP integration.
+// The gift catalogue (payments.getStarGifts) is fetched periodically in
+// one request and the resale floor price and listings count of every
+// collection on the market are appended to its series file. A record
+// holds zigzag varint deltas from the previous one, a few bytes each,
+// and files are only ever appended to. Reads map the file and decode it
+// into columns that downsampling and backtests walk in plain loops.
+
+#pragma once
+
+#include <QtCore/QHash>
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtCore/QTimer>
+
+#include <memory>
+#include <vector>
+
+namespace Api {
+class PremiumGiftCodeOptions;
+} // namespace Api
+
+namespace Data {
+struct StarGift;
+} // namespace Data
+
+namespace Main {
+class Session;
+} // namespace Main
+
+namespace MCP {
+
+struct PriceSample {
+	qint64 time = 0; // Unix time.
+	qint64 price = 0; // Floor resale price in stars.
+	qint64 listings = 0;
+};
+
+struct PriceSeries {
+	std::vector<qint64> times;
+	std::vector<qint64> prices;
+	std::vector<qint64> listings;
+
+	[[nodiscard]] int size() const { return int(times.size()); }
+	[[nodiscard]] bool empty() const { return times.empty(); }
+};
+
+struct PriceBucket {
+	qint64 from = 0;
+	qint64 till = 0;
+	qint64 open = 0;
+	qint64 high = 0;
+	qint64 low = 0;
+	qint64 close = 0;
+	double listings = 0.;
+};
+
+struct BacktestResult {
+	int samples = 0;
+	int trades = 0;
+	double profit = 0.; // Stars, holding one gift while in position.
+	double returnPercent = 0.;
+	double holdReturnPercent = 0.;
+};
+
+// Equal time buckets over the series, empty buckets are skipped.
+[[nodiscard]] std::vector<PriceBucket> Downsample(
+	const PriceSeries &series,
+	int buckets);
+
+// Holds one gift while the short moving average is above the long one.
+[[nodiscard]] BacktestResult BacktestCrossover(
+	const PriceSeries &series,
+	int shortWindow,
+	int longWindow);
+
+class GiftPriceSeries final : public QObject {
+public:
+	explicit GiftPriceSeries(
+		const QString &directory,
+		QObject *parent = nullptr);
+	~GiftPriceSeries();
+
+	void start(not_null<Main::Session*> session);
+	void stop();
+	[[nodiscard]] bool isRunning() const { return _session != nullptr; }
+
+	// Samples between from and till inclusive, unix times.
+	[[nodiscard]] PriceSeries read(
+		quint64 giftId,
+		qint64 from,
+		qint64 till) const;
+
+	// Collections having a series file.
+	[[nodiscard]] std::vector<quint64> collections() const;
+	[[nodiscard]] QString title(quint64 giftId) const;
+
+	// Gift id by its number or resale title, 0 if unknown.
+	[[nodiscard]] quint64 resolve(const QString &gift) const;
+
+private:
+	struct Tail {
+		qint64 size = 0; // Bytes of complete records.
+		PriceSample last;
+	};
+
+	void fetch();
+	void received(const std::vector<Data::StarGift> &gifts);
+	void append(quint64 giftId, const PriceSample &sample);
+	[[nodiscard]] QString path(quint64 giftId) const;
+	[[nodiscard]] Tail &tail(quint64 giftId);
+
+	const QString _directory;
+	Main::Session *_session = nullptr;
+	std::unique_ptr<Api::PremiumGiftCodeOptions> _api;
+	QHash<quint64, Tail> _tails;
+	QHash<quint64, QString> _titles;
+	QTimer _fetchTimer;
+
+	rpl::lifetime _requestLifetime;
+
+};
+
+} // namespace MCP
@@ -14,33 +14,85 @@
 #include "history/history_item.h"
 #include "history/view/history_view_element.h"
 
+#include "main/main_session.h"
+
 #include <QtCore/QFile>
 #include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
 #include <QtCore/QJsonDocument>
 #include <QtCore/QStandardPaths>
 
+#include <algorithm>
+#include <utility>
+
 namespace MCP {
+namespace {
+
+constexpr auto kFloodBufferMs = 5000;
+
+[[nodiscard]] QString StateToString(GradualArchiveStatus::State state) {
+	switch (state) {
+	case GradualArchiveStatus::State::Idle: return "idle";
+	case GradualArchiveStatus::State::Running: return "running";
+	case GradualArchiveStatus::State::Paused: return "paused";
+	case GradualArchiveStatus::State::WaitingForActiveHours:
+		return "waiting_for_active_hours";
+	case GradualArchiveStatus::State::RateLimited: return "rate_limited";
+	case GradualArchiveStatus::State::Completed: return "completed";
+	case GradualArchiveStatus::State::Failed: return "failed";
+	}
+	return "idle";
+}
+
+[[nodiscard]] QJsonObject StatusToJson(const GradualArchiveStatus &status) {
+	QJsonObject obj;
+	obj["state"] = StateToString(status.state);
+	obj["chat_id"] = status.chatId;
+	obj["chat_title"] = status.chatTitle;
+	obj["total_messages"] = status.totalMessages;
+	obj["archived_messages"] = status.archivedMessages;
+	obj["failed_messages"] = status.failedMessages;
+	obj["batches_completed"] = status.batchesCompleted;
+
+	if (status.startTime.isValid()) {
+		obj["start_time"] = status.startTime.toString(Qt::ISODate);
+	}
+	if (status.lastActivityTime.isValid()) {
+		obj["last_activity"] = status.lastActivityTime.toString(Qt::ISODate);
+	}
+	if (status.nextActionTime.isValid()) {
+		obj["next_action"] = status.nextActionTime.toString(Qt::ISODate);
+		obj["next_action_in_seconds"] =
+			QDateTime::currentDateTime().secsTo(status.nextActionTime);
+	}
+
+	obj["current_delay_ms"] = status.currentDelayMs;
+	obj["flood_wait_seconds"] = status.floodWaitSeconds;
+
+	if (!status.lastError.isEmpty()) {
+		obj["last_error"] = status.lastError;
+	}
+	return obj;
+}
+
+[[nodiscard]] qint64 MsUntilNextHour() {
+	return 3600000 - (QTime::currentTime().msecsSinceStartOfDay() % 3600000);
+}
+
+[[nodiscard]] qint64 MsUntilTomorrow() {
+	return 86400000 - QTime::currentTime().msecsSinceStartOfDay();
+}
+
+} // namespace
 
 GradualArchiver::GradualArchiver(QObject *parent)
 	: QObject(parent)
 	, _rng(QRandomGenerator::securelySeeded()) {
 
-	_batchTimer = new QTimer(this);
-	_batchTimer->setSingleShot(true);
-	connect(_batchTimer, &QTimer::timeout, this, &GradualArchiver::processNextBatch);
-
 	_activeHoursTimer = new QTimer(this);
 	_activeHoursTimer->setInterval(60000); // Check every minute
 	connect(_activeHoursTimer, &QTimer::timeout, this, &GradualArchiver::checkActiveHours);
 
-	_hourlyResetTimer = new QTimer(this);
-	_hourlyResetTimer->setInterval(3600000); // 1 hour
-	connect(_hourlyResetTimer, &QTimer::timeout, this, &GradualArchiver::resetHourlyCounter);
-
-	_dailyResetTimer = new QTimer(this);
-	_dailyResetTimer->setInterval(86400000); // 24 hours
-	connect(_dailyResetTimer, &QTimer::timeout, this, &GradualArchiver::resetDailyCounter);
-
 	loadState();
 }
 
@@ -52,8 +104,12 @@ bool GradualArchiver::startGradualArchive(
 		qint64 chatId,
 		const GradualArchiveConfig &config) {
 
-	if (_status.state == GradualArchiveStatus::State::Running) {
-		Q_EMIT error("Archive already in progress. Use queue or cancel first.");
+	if (findJob(chatId)) {
+		Q_EMIT error("Archive of this chat already in progress.");
+		return false;
+	}
+	if (int(_jobs.size()) >= std::max(config.maxParallelChats, 1)) {
+		Q_EMIT error("All archive slots are busy. Use queue or cancel first.");
 		return false;
 	}
 
@@ -62,23 +118,26 @@ bool GradualArchiver::startGradualArchive(
 		return false;
 	}
 
-	_config = config;
-	_status = GradualArchiveStatus{};
-	_status.chatId = chatId;
-	_status.state = GradualArchiveStatus::State::Running;
-	_status.startTime = QDateTime::currentDateTime();
+	const auto job = startJob(chatId, config);
+	saveState();
+	return (job != nullptr);
+}
 
-	// Clear in-memory message storage
-	_collectedMessages = QJsonArray{};
+GradualArchiver::Job *GradualArchiver::startJob(
+		qint64 chatId,
+		const GradualArchiveConfig &config) {
+	const auto job = addJob(chatId, config);
+	job->status.state = GradualArchiveStatus::State::Running;
+	job->status.startTime = QDateTime::currentDateTime();
 
 	// Get chat info
 	PeerId peerId(chatId);
 	auto peer = _session->peer(peerId);
 	if (peer) {
-		_status.chatTitle = peer->name();
+		job->status.chatTitle = peer->name();
 	}
 
-	Q_EMIT operationLog(QString("Starting export of \"%1\"").arg(_status.chatTitle));
+	Q_EMIT operationLog(QString("Starting export of \"%1\"").arg(job->status.chatTitle));
 
 	// Get estimated total (from history if available)
 	auto history = _session->history(peerId);
@@ -90,77 +149,124 @@ bool GradualArchiver::startGradualArchive(
 				count += block->messages.size();
 			}
 		}
-		_status.totalMessages = count > 0 ? count : 1000; // Default estimate
+		job->status.totalMessages = count > 0 ? count : 1000; // Default estimate
 	}
 
-	_currentOffsetId = 0;
-	_consecutiveBatches = 0;
-	_retryCount = 0;
-
-	// Start timers
-	_hourlyResetTimer->start();
-	_dailyResetTimer->start();
-
-	if (_config.respectActiveHours) {
+	if (job->config.respectActiveHours) {
 		_activeHoursTimer->start();
-		if (!isWithinActiveHours()) {
-			_status.state = GradualArchiveStatus::State::WaitingForActiveHours;
-			Q_EMIT stateChanged(_status.state);
-			return true;
+		if (!isWithinActiveHours(job->config)) {
+			setJobState(*job, GradualArchiveStatus::State::WaitingForActiveHours);
+			return job;
 		}
 	}
 
-	// Schedule first batch with initial random delay
-	int initialDelay = _rng.bounded(_config.minDelayMs, _config.maxDelayMs);
-	_batchTimer->start(initialDelay);
-	_status.nextActionTime = QDateTime::currentDateTime().addMSecs(initialDelay);
+	// Schedule first batch, spread over one delay so chats take turns
+	const auto &rate = currentRate();
+	waitFor(*job, _rng.bounded(int(rate.delayMs) + 1));
 
-	Q_EMIT stateChanged(_status.state);
-	saveState();
+	Q_EMIT stateChanged(job->status.state);
+	return job;
+}
 
-	return true;
+GradualArchiver::Job *GradualArchiver::addJob(
+		qint64 chatId,
+		const GradualArchiveConfig &config) {
+	auto owned = std::make_unique<Job>();
+	const auto job = owned.get();
+	job->config = config;
+	job->status.chatId = chatId;
+	job->timer = new QTimer(this);
+	job->timer->setSingleShot(true);
+	connect(job->timer, &QTimer::timeout, this, [=] {
+		processNextBatch(chatId);
+	});
+	_jobs.push_back(std::move(owned));
+	return job;
 }
 
-void GradualArchiver::pause() {
-	if (_status.state != GradualArchiveStatus::State::Running) {
-		return;
+GradualArchiver::Job *GradualArchiver::findJob(qint64 chatId) const {
+	for (const auto &job : _jobs) {
+		if (job->status.chatId == chatId) {
+			return job.get();
+		}
 	}
+	return nullptr;
+}
 
-	_batchTimer->stop();
-	_status.state = GradualArchiveStatus::State::Paused;
-	Q_EMIT stateChanged(_status.state);
-	saveState();
+void GradualArchiver::removeJob(qint64 chatId) {
+	for (auto i = _jobs.begin(); i != _jobs.end(); ++i) {
+		if ((*i)->status.chatId == chatId) {
+			// May run from the timer's own timeout.
+			(*i)->timer->stop();
+			(*i)->timer->deleteLater();
+			_lastStatus = (*i)->status;
+			_jobs.erase(i);
+			return;
+		}
+	}
 }
 
-void GradualArchiver::resume() {
-	if (_status.state != GradualArchiveStatus::State::Paused &&
-		_status.state != GradualArchiveStatus::State::WaitingForActiveHours) {
-		return;
+void GradualArchiver::setJobState(Job &job, GradualArchiveStatus::State state) {
+	if (job.status.state != state) {
+		job.status.state = state;
+		Q_EMIT stateChanged(state);
 	}
+}
 
-	if (_config.respectActiveHours && !isWithinActiveHours()) {
-		_status.state = GradualArchiveStatus::State::WaitingForActiveHours;
-		Q_EMIT stateChanged(_status.state);
-		return;
+void GradualArchiver::waitFor(Job &job, qint64 delayMs) {
+	delayMs = std::max(delayMs, qint64(0));
+	job.status.currentDelayMs = int(delayMs);
+	job.status.nextActionTime = QDateTime::currentDateTime().addMSecs(delayMs);
+	job.timer->start(int(delayMs));
+}
+
+void GradualArchiver::pause() {
+	auto changed = false;
+	for (const auto &job : _jobs) {
+		if (job->status.state == GradualArchiveStatus::State::Running
+			|| job->status.state == GradualArchiveStatus::State::RateLimited) {
+			job->timer->stop();
+			setJobState(*job, GradualArchiveStatus::State::Paused);
+			changed = true;
+		}
 	}
+	if (changed) {
+		saveState();
+	}
+}
 
-	_status.state = GradualArchiveStatus::State::Running;
-	scheduleNextBatch();
-	Q_EMIT stateChanged(_status.state);
-	saveState();
+void GradualArchiver::resume() {
+	auto changed = false;
+	for (const auto &job : _jobs) {
+		if (job->status.state != GradualArchiveStatus::State::Paused &&
+			job->status.state != GradualArchiveStatus::State::WaitingForActiveHours) {
+			continue;
+		}
+		if (job->config.respectActiveHours && !isWithinActiveHours(job->config)) {
+			setJobState(*job, GradualArchiveStatus::State::WaitingForActiveHours);
+			_activeHoursTimer->start();
+			continue;
+		}
+		setJobState(*job, GradualArchiveStatus::State::Running);
+		scheduleNextBatch(*job);
+		changed = true;
+	}
+	if (changed) {
+		saveState();
+	}
 }
 
 void GradualArchiver::cancel() {
-	_batchTimer->stop();
 	_activeHoursTimer->stop();
-	_hourlyResetTimer->stop();
-	_dailyResetTimer->stop();
+	while (!_jobs.empty()) {
+		removeJob(_jobs.front()->status.chatId);
+	}
 
-	_status.state = GradualArchiveStatus::State::Idle;
-	Q_EMIT stateChanged(_status.state);
+	_lastStatus.state = GradualArchiveStatus::State::Idle;
+	Q_EMIT stateChanged(_lastStatus.state);
 
-	// Clear saved state
-	QFile::remove(stateFilePath());
+	// The learned pace and the budget outlive the jobs
+	saveState();
 }
 
 bool GradualArchiver::queueChat(qint64 chatId, const GradualArchiveConfig &config) {
@@ -168,12 +274,10 @@ bool GradualArchiver::queueChat(qint64 chatId, const GradualArchiveConfig &confi
 	queued.chatId = chatId;
 	queued.config = config;
 	_queue.append(queued);
-	saveState();
 
-	// Start if not already running
-	if (_status.state == GradualArchiveStatus::State::Idle) {
-		processNextInQueue();
-	}
+	// Start if a slot is free
+	processNextInQueue();
+	saveState();
 
 	return true;
 }
@@ -193,219 +297,326 @@ QJsonArray GradualArchiver::getQueue() const {
 	return arr;
 }
 
-void GradualArchiver::processNextBatch() {
-	if (_status.state != GradualArchiveStatus::State::Running) {
+GradualArchiveStatus GradualArchiver::status() const {
+	return _jobs.empty() ? _lastStatus : _jobs.front()->status;
+}
+
+bool GradualArchiver::isRunning() const {
+	return std::any_of(_jobs.begin(), _jobs.end(), [](const auto &job) {
+		return job->status.state == GradualArchiveStatus::State::Running;
+	});
+}
+
+void GradualArchiver::processNextBatch(qint64 chatId) {
+	const auto job = findJob(chatId);
+	if (!job) {
 		return;
 	}
-
-	// Check limits
-	if (_status.messagesArchivedThisHour >= _config.maxMessagesPerHour) {
-		// Wait until next hour
-		int waitMs = 3600000 - (QTime::currentTime().msecsSinceStartOfDay() % 3600000);
-		_batchTimer->start(waitMs);
-		_status.nextActionTime = QDateTime::currentDateTime().addMSecs(waitMs);
+	if (job->status.state == GradualArchiveStatus::State::RateLimited) {
+		setJobState(*job, GradualArchiveStatus::State::Running);
+	} else if (job->status.state != GradualArchiveStatus::State::Running) {
 		return;
 	}
 
-	if (_status.messagesArchivedToday >= _config.maxMessagesPerDay) {
-		// Wait until next day
-		_status.state = GradualArchiveStatus::State::Paused;
-		Q_EMIT stateChanged(_status.state);
-		Q_EMIT error("Daily limit reached. Will resume tomorrow.");
+	// Check limits, shared by every chat
+	rollBudget();
+	if (_archivedThisHour >= job->config.maxMessagesPerHour) {
+		waitFor(*job, MsUntilNextHour());
+		return;
+	}
+	if (_archivedToday >= job->config.maxMessagesPerDay) {
+		Q_EMIT operationLog("Daily limit reached. Will resume tomorrow.");
+		waitFor(*job, MsUntilTomorrow());
 		return;
 	}
 
 	// Check active hours
-	if (_config.respectActiveHours && !isWithinActiveHours()) {
-		_status.state = GradualArchiveStatus::State::WaitingForActiveHours;
-		Q_EMIT stateChanged(_status.state);
+	if (job->config.respectActiveHours && !isWithinActiveHours(job->config)) {
+		setJobState(*job, GradualArchiveStatus::State::WaitingForActiveHours);
 		return;
 	}
 
-	// Calculate batch size with randomization
-	int batchSize = calculateBatchSize();
+	// Another chat took the turn, or the DC is in a flood wait
+	auto &rate = currentRate();
+	const auto now = QDateTime::currentMSecsSinceEpoch();
+	if (rate.nextSlotAt > now) {
+		waitFor(*job, rate.nextSlotAt - now);
+		return;
+	}
 
-	// Fetch the batch
-	bool success = fetchBatch(batchSize, _currentOffsetId);
+	const auto batchSize = calculateBatchSize(*job, rate);
+	QElapsedTimer elapsed;
+	elapsed.start();
+	const auto archived = fetchBatch(*job, batchSize);
 
-	if (!success) {
-		_retryCount++;
-		if (_retryCount >= _config.maxRetries) {
-			_status.state = GradualArchiveStatus::State::Failed;
-			Q_EMIT stateChanged(_status.state);
+	if (archived < 0) {
+		job->retryCount++;
+		if (job->retryCount >= job->config.maxRetries) {
+			setJobState(*job, GradualArchiveStatus::State::Failed);
 			Q_EMIT error("Max retries exceeded");
+			removeJob(chatId);
+			processNextInQueue();
+			saveState();
 			return;
 		}
 		// Retry with longer delay
-		int retryDelay = _config.maxDelayMs * (_retryCount + 1);
-		_batchTimer->start(retryDelay);
+		waitFor(*job, qint64(job->config.maxDelayMs) * (job->retryCount + 1));
+		return;
+	} else if (archived == 0) {
+		completeArchive(chatId);
 		return;
 	}
+	adaptRate(rate, job->config, elapsed.elapsed());
 
-	_retryCount = 0;
-	_consecutiveBatches++;
-	_status.batchesCompleted++;
-	_status.lastActivityTime = QDateTime::currentDateTime();
+	job->retryCount = 0;
+	job->consecutiveBatches++;
+	job->status.batchesCompleted++;
+	job->status.lastActivityTime = QDateTime::currentDateTime();
 
 	Q_EMIT operationLog(QString("Batch %1: archived %2 messages (%3/%4 total)")
-		.arg(_status.batchesCompleted)
-		.arg(batchSize)
-		.arg(_status.archivedMessages)
-		.arg(_status.totalMessages));
-	Q_EMIT batchCompleted(batchSize, _status.archivedMessages);
-	Q_EMIT progressChanged(_status.archivedMessages, _status.totalMessages);
-	Q_EMIT sizeUpdated(_status.totalBytesProcessed, _status.totalMediaBytes);
+		.arg(job->status.batchesCompleted)
+		.arg(archived)
+		.arg(job->status.archivedMessages)
+		.arg(job->status.totalMessages));
+	Q_EMIT batchCompleted(archived, job->status.archivedMessages);
+	Q_EMIT progressChanged(job->status.archivedMessages, job->status.totalMessages);
+	Q_EMIT sizeUpdated(job->status.totalBytesProcessed, job->status.totalMediaBytes);
 
 	// Check if complete
-	if (_currentOffsetId == 0 || _status.archivedMessages >= _status.totalMessages) {
-		completeArchive();
+	if (job->status.archivedMessages >= job->status.totalMessages) {
+		completeArchive(chatId);
 		return;
 	}
 
 	// Schedule next batch
-	scheduleNextBatch();
+	scheduleNextBatch(*job);
 	saveState();
 }
 
-bool GradualArchiver::fetchBatch(int limit, qint64 offsetId) {
-	if (!_session || !_archiver) {
-		return false;
+int GradualArchiver::fetchBatch(Job &job, int limit) {
+	if (!_session) {
+		job.status.lastError = "Session not available";
+		return -1;
 	}
 
-	PeerId peerId(_status.chatId);
+	PeerId peerId(job.status.chatId);
 	auto history = _session->history(peerId);
 	if (!history) {
-		_status.lastError = "History not available";
-		return false;
+		job.status.lastError = "History not available";
+		return -1;
 	}
 
-	int archived = 0;
-	qint64 lastMsgId = offsetId;
-
-	// Iterate through available messages
+	// Collect the batch oldest first, it is then stored in one transaction
+	const auto offsetId = job.offsetId;
+	auto items = std::vector<HistoryItem*>();
 	for (auto blockIt = history->blocks.begin();
-		 blockIt != history->blocks.end() && archived < limit;
+		 blockIt != history->blocks.end() && int(items.size()) < limit;
 		 ++blockIt) {
 		const auto &block = *blockIt;
 		if (!block) continue;
 
 		for (auto msgIt = block->messages.begin();
-			 msgIt != block->messages.end() && archived < limit;
+			 msgIt != block->messages.end() && int(items.size()) < limit;
 			 ++msgIt) {
 			const auto &element = *msgIt;
 			if (!element) continue;
 			auto item = element->data();
 			if (!item) continue;
 
-			// Skip if before offset
-			if (offsetId > 0 && item->id.bare >= offsetId) {
+			// Skip what earlier batches took
+			if (offsetId > 0 && item->id.bare <= offsetId) {
 				continue;
 			}
+			items.push_back(item);
+		}
+	}
 
-			// Archive the message
-			bool msgArchived = false;
-			if (_archiver) {
-				msgArchived = _archiver->archiveMessage(item);
-			} else {
-				// Store in memory instead
-				QJsonObject msgObj;
-				msgObj["id"] = QString::number(item->id.bare);
-				msgObj["date"] = QString::number(item->date());
-				msgObj["text"] = item->originalText().text;
-				if (const auto from = item->from()) {
-					msgObj["from"] = from->name();
-					msgObj["from_id"] = QString::number(from->id.value);
-				}
-				_collectedMessages.append(msgObj);
-				msgArchived = true;
+	// Archive the messages, or store them in memory instead
+	auto stored = 0;
+	if (_archiver) {
+		stored = _archiver->archiveMessages(items);
+	} else {
+		for (const auto item : items) {
+			QJsonObject msgObj;
+			msgObj["id"] = QString::number(item->id.bare);
+			msgObj["date"] = QString::number(item->date());
+			msgObj["text"] = item->originalText().text;
+			if (const auto from = item->from()) {
+				msgObj["from"] = from->name();
+				msgObj["from_id"] = QString::number(from->id.value);
 			}
-			if (msgArchived) {
-				archived++;
-				_status.archivedMessages++;
-				_status.messagesArchivedThisHour++;
-				_status.messagesArchivedToday++;
-				lastMsgId = item->id.bare;
-
-				// Track text content size
-				const auto textSize = item->originalText().text.toUtf8().size();
-				_status.totalBytesProcessed += textSize;
-
-				// Track media size if present
-				if (item->media()) {
-					if (const auto doc = item->media()->document()) {
-						_status.totalMediaBytes += doc->size;
-					} else if (item->media()->photo()) {
-						// Estimate photo size (~500KB typical)
-						_status.totalMediaBytes += 512 * 1024;
-					}
-				}
-
-				// Simulate reading time if configured
-				if (_config.simulateReading) {
-					int readTime = calculateReadingTime(
-						item->originalText().text.length());
-					if (readTime > 0) {
-						QThread::msleep(readTime);
-					}
-				}
-			} else {
-				_status.failedMessages++;
+			job.collectedMessages.append(msgObj);
+		}
+		stored = int(items.size());
+	}
+	if (!items.empty() && !stored) {
+		job.status.lastError = "Failed to store messages";
+		return -1;
+	}
+
+	int archived = 0;
+	qint64 lastMsgId = offsetId;
+	for (const auto item : items) {
+		if (archived >= stored) {
+			job.status.failedMessages++;
+			continue;
+		}
+		archived++;
+		job.status.archivedMessages++;
+		_archivedThisHour++;
+		_archivedToday++;
+		lastMsgId = std::max(lastMsgId, qint64(item->id.bare));
+
+		// Track text content size
+		const auto textSize = item->originalText().text.toUtf8().size();
+		job.status.totalBytesProcessed += textSize;
+
+		// Track media size if present
+		if (item->media()) {
+			if (const auto doc = item->media()->document()) {
+				job.status.totalMediaBytes += doc->size;
+			} else if (item->media()->photo()) {
+				// Estimate photo size (~500KB typical)
+				job.status.totalMediaBytes += 512 * 1024;
 			}
 		}
+
+		// Simulated reading delays the next batch, not the main thread
+		if (job.config.simulateReading) {
+			job.readingMs += calculateReadingTime(
+				item->originalText().text.length());
+		}
 	}
 
-	_currentOffsetId = lastMsgId;
-	return archived > 0;
+	job.offsetId = lastMsgId;
+	return archived;
 }
 
-void GradualArchiver::scheduleNextBatch() {
-	int delay = calculateNextDelay();
-	_status.currentDelayMs = delay;
-	_status.nextActionTime = QDateTime::currentDateTime().addMSecs(delay);
-	_batchTimer->start(delay);
+void GradualArchiver::scheduleNextBatch(Job &job) {
+	auto &rate = currentRate();
+	const auto delay = calculateNextDelay(job, rate);
+
+	// The pace is per DC, other chats wait for their turn after this one
+	const auto now = QDateTime::currentMSecsSinceEpoch();
+	rate.nextSlotAt = std::max(rate.nextSlotAt, now + qint64(rate.delayMs));
+	waitFor(job, delay);
+}
+
+GradualArchiveRate &GradualArchiver::currentRate() {
+	// Every request of a user session goes to its main DC.
+	const auto dcId = _session ? _session->session().mainDcId() : 0;
+	auto &rate = _rates[dcId];
+	if (rate.batchSize <= 0. || rate.delayMs <= 0.) {
+		rate.batchSize = (_config.minBatchSize + _config.maxBatchSize) / 2.;
+		rate.delayMs = (_config.minDelayMs + _config.maxDelayMs) / 2.;
+	}
+	return rate;
+}
+
+void GradualArchiver::adaptRate(
+		GradualArchiveRate &rate,
+		const GradualArchiveConfig &config,
+		qint64 elapsedMs) {
+	// Additive increase, slow batches only hold the pace
+	if (elapsedMs <= config.fastBatchMs) {
+		rate.batchSize = std::min(
+			rate.batchSize + config.batchSizeStep,
+			double(config.maxBatchSize));
+		rate.delayMs = std::max(
+			rate.delayMs - config.delayStepMs,
+			double(config.minDelayMs));
+	}
+	rate.updated = QDateTime::currentDateTime();
 }
 
-int GradualArchiver::calculateNextDelay() {
-	int baseDelay = _rng.bounded(_config.minDelayMs, _config.maxDelayMs);
+void GradualArchiver::reportFloodWait(int seconds) {
+	if (seconds <= 0) {
+		return;
+	}
+
+	// Multiplicative decrease, and nothing runs until the wait is over
+	auto &rate = currentRate();
+	rate.batchSize = std::max(rate.batchSize / 2., double(_config.minBatchSize));
+	rate.delayMs = std::min(rate.delayMs * 2., double(_config.maxDelayMs));
+	rate.floodWaits++;
+	rate.updated = QDateTime::currentDateTime();
+	const auto holdMs = seconds * 1000LL + kFloodBufferMs;
+	rate.nextSlotAt = std::max(
+		rate.nextSlotAt,
+		QDateTime::currentMSecsSinceEpoch() + holdMs);
+
+	for (const auto &job : _jobs) {
+		if (job->status.state != GradualArchiveStatus::State::Running) {
+			continue;
+		}
+		job->status.floodWaitSeconds = seconds;
+		if (job->config.stopOnFloodWait) {
+			job->timer->stop();
+			setJobState(*job, GradualArchiveStatus::State::Paused);
+		} else {
+			setJobState(*job, GradualArchiveStatus::State::RateLimited);
+			waitFor(*job, holdMs);
+		}
+	}
+	Q_EMIT operationLog(QString("Flood wait of %1 s, pace now %2 messages every %3 ms")
+		.arg(seconds)
+		.arg(int(rate.batchSize))
+		.arg(int(rate.delayMs)));
+	Q_EMIT rateLimited(seconds);
+
+	saveState();
+}
+
+int GradualArchiver::calculateNextDelay(Job &job, const GradualArchiveRate &rate) {
+	int baseDelay = int(rate.delayMs);
 
 	// Add burst pause
-	if (_consecutiveBatches >= _config.batchesBeforePause) {
-		_consecutiveBatches = 0;
-		baseDelay = _config.burstPauseMs + _rng.bounded(0, 10000);
+	if (job.consecutiveBatches >= job.config.batchesBeforePause) {
+		job.consecutiveBatches = 0;
+		baseDelay = job.config.burstPauseMs + _rng.bounded(0, 10000);
 	}
 
 	// Occasional long pause (natural behavior)
-	if (_status.batchesCompleted > 0 &&
-		_status.batchesCompleted % _config.batchesBeforeLongPause == 0) {
-		baseDelay = _config.longPauseMs + _rng.bounded(0, 60000);
+	if (job.status.batchesCompleted > 0 &&
+		job.status.batchesCompleted % job.config.batchesBeforeLongPause == 0) {
+		baseDelay = job.config.longPauseMs + _rng.bounded(0, 60000);
 	}
 
+	// Time spent "reading" the last batch
+	baseDelay += std::exchange(job.readingMs, 0);
+
 	// Add some jitter (±20%)
 	int jitter = baseDelay / 5;
-	baseDelay += _rng.bounded(-jitter, jitter);
+	if (jitter > 0) {
+		baseDelay += _rng.bounded(-jitter, jitter);
+	}
 
 	return qMax(1000, baseDelay); // Minimum 1 second
 }
 
-int GradualArchiver::calculateBatchSize() {
-	int size = _rng.bounded(_config.minBatchSize, _config.maxBatchSize + 1);
+int GradualArchiver::calculateBatchSize(const Job &job, const GradualArchiveRate &rate) {
+	auto size = qBound(
+		job.config.minBatchSize,
+		int(rate.batchSize),
+		job.config.maxBatchSize);
 
-	// Vary batch size to seem more natural
-	if (_rng.bounded(100) < 20) {
-		// 20% chance of smaller batch
-		size = _config.minBatchSize + _rng.bounded(0, 5);
-	} else if (_rng.bounded(100) < 10) {
-		// 10% chance of larger batch
-		size = _config.maxBatchSize;
+	// Vary batch size by ±20% to seem more natural
+	const auto spread = size / 5;
+	if (spread > 0) {
+		size += _rng.bounded(-spread, spread + 1);
 	}
 
-	return size;
+	// Never past what is left of the budget
+	const auto left = std::min(
+		job.config.maxMessagesPerHour - _archivedThisHour,
+		job.config.maxMessagesPerDay - _archivedToday);
+	return std::max(std::min(size, left), 1);
 }
 
-bool GradualArchiver::isWithinActiveHours() const {
+bool GradualArchiver::isWithinActiveHours(const GradualArchiveConfig &config) const {
 	int currentHour = QTime::currentTime().hour();
-	return currentHour >= _config.activeHourStart &&
-		   currentHour < _config.activeHourEnd;
+	return currentHour >= config.activeHourStart &&
+		   currentHour < config.activeHourEnd;
 }
 
 int GradualArchiver::calculateReadingTime(int messageLength) {
@@ -420,98 +631,92 @@ int GradualArchiver::calculateReadingTime(int messageLength) {
 	return qBound(100, readTimeMs, 5000);
 }
 
-void GradualArchiver::handleFloodWait(int seconds) {
-	_status.state = GradualArchiveStatus::State::RateLimited;
-	_status.floodWaitSeconds = seconds;
-	Q_EMIT stateChanged(_status.state);
-	Q_EMIT rateLimited(seconds);
-
-	if (_config.stopOnFloodWait) {
-		pause();
-	} else {
-		// Wait and retry
-		_batchTimer->start(seconds * 1000 + 5000); // Add 5 sec buffer
-		_status.nextActionTime = QDateTime::currentDateTime().addSecs(seconds + 5);
+void GradualArchiver::rollBudget() {
+	const auto now = QDateTime::currentDateTime();
+	const auto hour = now.toSecsSinceEpoch() / 3600;
+	if (hour != _budgetHour) {
+		_budgetHour = hour;
+		_archivedThisHour = 0;
+	}
+	if (now.date() != _budgetDay) {
+		_budgetDay = now.date();
+		_archivedToday = 0;
 	}
-
-	saveState();
 }
 
 void GradualArchiver::checkActiveHours() {
-	if (_status.state == GradualArchiveStatus::State::WaitingForActiveHours) {
-		if (isWithinActiveHours()) {
-			resume();
-		}
-	} else if (_status.state == GradualArchiveStatus::State::Running) {
-		if (!isWithinActiveHours()) {
-			_status.state = GradualArchiveStatus::State::WaitingForActiveHours;
-			_batchTimer->stop();
-			Q_EMIT stateChanged(_status.state);
+	for (const auto &job : _jobs) {
+		const auto within = !job->config.respectActiveHours
+			|| isWithinActiveHours(job->config);
+		if (job->status.state == GradualArchiveStatus::State::WaitingForActiveHours) {
+			if (within) {
+				setJobState(*job, GradualArchiveStatus::State::Running);
+				scheduleNextBatch(*job);
+			}
+		} else if (job->status.state == GradualArchiveStatus::State::Running) {
+			if (!within) {
+				job->timer->stop();
+				setJobState(*job, GradualArchiveStatus::State::WaitingForActiveHours);
+			}
 		}
 	}
 }
 
-void GradualArchiver::resetHourlyCounter() {
-	_status.messagesArchivedThisHour = 0;
-}
-
-void GradualArchiver::resetDailyCounter() {
-	_status.messagesArchivedToday = 0;
-
-	// Resume if paused due to daily limit
-	if (_status.state == GradualArchiveStatus::State::Paused) {
-		resume();
+void GradualArchiver::completeArchive(qint64 chatId) {
+	const auto job = findJob(chatId);
+	if (!job) {
+		return;
 	}
-}
-
-void GradualArchiver::completeArchive() {
-	_batchTimer->stop();
-	_status.state = GradualArchiveStatus::State::Completed;
+	job->timer->stop();
+	setJobState(*job, GradualArchiveStatus::State::Completed);
 
 	Q_EMIT operationLog(QString("Archive complete: %1 messages from \"%2\"")
-		.arg(_status.archivedMessages)
-		.arg(_status.chatTitle));
-	Q_EMIT stateChanged(_status.state);
-	Q_EMIT archiveCompleted(_status.chatId, _status.archivedMessages);
+		.arg(job->status.archivedMessages)
+		.arg(job->status.chatTitle));
+	Q_EMIT archiveCompleted(job->status.chatId, job->status.archivedMessages);
 
-	if (_config.autoExportOnComplete) {
+	if (job->config.autoExportOnComplete) {
 		Q_EMIT operationLog("Starting file export...");
-		startExport();
+		startExport(*job);
 	}
+	removeJob(chatId);
 
 	// Process next in queue
 	processNextInQueue();
+	saveState();
 }
 
-void GradualArchiver::startExport() {
-	if (_config.exportPath.isEmpty()) {
+void GradualArchiver::startExport(const Job &job) {
+	const auto &config = job.config;
+	const auto &status = job.status;
+	if (config.exportPath.isEmpty()) {
 		return;
 	}
 
 	QJsonArray messages = _archiver
-		? _archiver->getMessages(_status.chatId, -1)
-		: _collectedMessages;
+		? _archiver->getMessages(status.chatId, -1)
+		: job.collectedMessages;
 	if (messages.isEmpty()) {
 		Q_EMIT operationLog("No messages to export");
 		return;
 	}
 
-	bool exportHtml = _config.exportFormat == "html" ||
-					  _config.exportFormat == "both";
-	bool exportMd = _config.exportFormat == "markdown" ||
-					_config.exportFormat == "both";
+	bool exportHtml = config.exportFormat == "html" ||
+					  config.exportFormat == "both";
+	bool exportMd = config.exportFormat == "markdown" ||
+					config.exportFormat == "both";
 
 	if (exportHtml) {
 		HtmlExporter htmlExporter;
 		htmlExporter.setDataSession(_session);
-		QString htmlPath = _config.exportPath;
+		QString htmlPath = config.exportPath;
 		if (!htmlPath.endsWith(".html")) {
 			htmlPath += ".html";
 		}
 		HtmlExportOptions htmlOpts;
 		htmlOpts.respectContentRestrictions = false;
 		Q_EMIT operationLog(QString("Exporting to HTML: %1").arg(htmlPath));
-		if (htmlExporter.exportFromArchive(_status.chatTitle, messages, htmlPath, htmlOpts)) {
+		if (htmlExporter.exportFromArchive(status.chatTitle, messages, htmlPath, htmlOpts)) {
 			Q_EMIT operationLog("HTML export complete");
 			Q_EMIT exportReady(htmlPath);
 		} else {
@@ -522,13 +727,13 @@ void GradualArchiver::startExport() {
 	if (exportMd) {
 		MarkdownExporter mdExporter;
 		mdExporter.setDataSession(_session);
-		QString mdPath = _config.exportPath;
+		QString mdPath = config.exportPath;
 		if (!mdPath.endsWith(".md")) {
 			mdPath += ".md";
 		}
 		MarkdownExportOptions mdOpts;
 		Q_EMIT operationLog(QString("Exporting to Markdown: %1").arg(mdPath));
-		if (mdExporter.exportFromArchive(_status.chatTitle, messages, mdPath, mdOpts)) {
+		if (mdExporter.exportFromArchive(status.chatTitle, messages, mdPath, mdOpts)) {
 			Q_EMIT operationLog("Markdown export complete");
 			Q_EMIT exportReady(mdPath);
 		} else {
@@ -538,61 +743,50 @@ void GradualArchiver::startExport() {
 }
 
 void GradualArchiver::processNextInQueue() {
-	if (_queue.isEmpty()) {
-		_status.state = GradualArchiveStatus::State::Idle;
-		Q_EMIT stateChanged(_status.state);
-		return;
+	// Queued chats fill every free slot, each with its own limit
+	while (!_queue.isEmpty() && _session) {
+		const auto &next = _queue.front();
+		if (int(_jobs.size()) >= std::max(next.config.maxParallelChats, 1)) {
+			return;
+		}
+		const auto queued = _queue.takeFirst();
+		if (!findJob(queued.chatId)) {
+			startJob(queued.chatId, queued.config);
+		}
+	}
+	if (_jobs.empty()) {
+		_activeHoursTimer->stop();
+		_lastStatus.state = GradualArchiveStatus::State::Idle;
+		Q_EMIT stateChanged(_lastStatus.state);
 	}
-
-	QueuedChat next = _queue.takeFirst();
-	startGradualArchive(next.chatId, next.config);
 }
 
 QJsonObject GradualArchiver::statusJson() const {
-	QJsonObject obj;
-
-	QString stateStr;
-	switch (_status.state) {
-	case GradualArchiveStatus::State::Idle: stateStr = "idle"; break;
-	case GradualArchiveStatus::State::Running: stateStr = "running"; break;
-	case GradualArchiveStatus::State::Paused: stateStr = "paused"; break;
-	case GradualArchiveStatus::State::WaitingForActiveHours:
-		stateStr = "waiting_for_active_hours"; break;
-	case GradualArchiveStatus::State::RateLimited: stateStr = "rate_limited"; break;
-	case GradualArchiveStatus::State::Completed: stateStr = "completed"; break;
-	case GradualArchiveStatus::State::Failed: stateStr = "failed"; break;
-	}
-
-	obj["state"] = stateStr;
-	obj["chat_id"] = _status.chatId;
-	obj["chat_title"] = _status.chatTitle;
-	obj["total_messages"] = _status.totalMessages;
-	obj["archived_messages"] = _status.archivedMessages;
-	obj["failed_messages"] = _status.failedMessages;
-	obj["batches_completed"] = _status.batchesCompleted;
-	obj["messages_today"] = _status.messagesArchivedToday;
-	obj["messages_this_hour"] = _status.messagesArchivedThisHour;
-
-	if (_status.startTime.isValid()) {
-		obj["start_time"] = _status.startTime.toString(Qt::ISODate);
-	}
-	if (_status.lastActivityTime.isValid()) {
-		obj["last_activity"] = _status.lastActivityTime.toString(Qt::ISODate);
-	}
-	if (_status.nextActionTime.isValid()) {
-		obj["next_action"] = _status.nextActionTime.toString(Qt::ISODate);
-		obj["next_action_in_seconds"] =
-			QDateTime::currentDateTime().secsTo(_status.nextActionTime);
+	QJsonObject obj = StatusToJson(status());
+
+	QJsonArray jobs;
+	for (const auto &job : _jobs) {
+		jobs.append(StatusToJson(job->status));
+	}
+	obj["jobs"] = jobs;
+
+	QJsonObject rates;
+	for (auto i = _rates.cbegin(); i != _rates.cend(); ++i) {
+		QJsonObject rate;
+		rate["batch_size"] = int(i->batchSize);
+		rate["delay_ms"] = int(i->delayMs);
+		rate["flood_waits"] = i->floodWaits;
+		if (i->updated.isValid()) {
+			rate["updated"] = i->updated.toString(Qt::ISODate);
+		}
+		rates[QString::number(i.key())] = rate;
 	}
+	obj["rates"] = rates;
 
-	obj["current_delay_ms"] = _status.currentDelayMs;
-	obj["flood_wait_seconds"] = _status.floodWaitSeconds;
+	obj["messages_today"] = _archivedToday;
+	obj["messages_this_hour"] = _archivedThisHour;
 	obj["queue_size"] = _queue.size();
 
-	if (!_status.lastError.isEmpty()) {
-		obj["last_error"] = _status.lastError;
-	}
-
 	return obj;
 }
 
@@ -606,6 +800,10 @@ QJsonObject GradualArchiver::configJson() const {
 	obj["max_batch_size"] = _config.maxBatchSize;
 	obj["batches_before_pause"] = _config.batchesBeforePause;
 	obj["batches_before_long_pause"] = _config.batchesBeforeLongPause;
+	obj["fast_batch_ms"] = _config.fastBatchMs;
+	obj["batch_size_step"] = _config.batchSizeStep;
+	obj["delay_step_ms"] = _config.delayStepMs;
+	obj["max_parallel_chats"] = _config.maxParallelChats;
 	obj["randomize_order"] = _config.randomizeOrder;
 	obj["simulate_reading"] = _config.simulateReading;
 	obj["respect_active_hours"] = _config.respectActiveHours;
@@ -638,6 +836,14 @@ bool GradualArchiver::loadConfigFromJson(const QJsonObject &json) {
 		_config.batchesBeforePause = json["batches_before_pause"].toInt();
 	if (json.contains("batches_before_long_pause"))
 		_config.batchesBeforeLongPause = json["batches_before_long_pause"].toInt();
+	if (json.contains("fast_batch_ms"))
+		_config.fastBatchMs = json["fast_batch_ms"].toInt();
+	if (json.contains("batch_size_step"))
+		_config.batchSizeStep = json["batch_size_step"].toInt();
+	if (json.contains("delay_step_ms"))
+		_config.delayStepMs = json["delay_step_ms"].toInt();
+	if (json.contains("max_parallel_chats"))
+		_config.maxParallelChats = json["max_parallel_chats"].toInt();
 	if (json.contains("randomize_order"))
 		_config.randomizeOrder = json["randomize_order"].toBool();
 	if (json.contains("simulate_reading"))
@@ -673,10 +879,16 @@ QString GradualArchiver::stateFilePath() const {
 
 void GradualArchiver::saveState() {
 	QJsonObject state;
-	state["status"] = statusJson();
 	state["config"] = configJson();
-	state["current_offset_id"] = _currentOffsetId;
-	state["consecutive_batches"] = _consecutiveBatches;
+
+	QJsonArray jobsArr;
+	for (const auto &job : _jobs) {
+		QJsonObject jobObj = StatusToJson(job->status);
+		jobObj["offset_id"] = job->offsetId;
+		jobObj["consecutive_batches"] = job->consecutiveBatches;
+		jobsArr.append(jobObj);
+	}
+	state["jobs"] = jobsArr;
 
 	QJsonArray queueArr;
 	for (const auto &q : _queue) {
@@ -687,6 +899,25 @@ void GradualArchiver::saveState() {
 	}
 	state["queue"] = queueArr;
 
+	// Learned pace per DC, so a restart doesn't start slow again
+	QJsonObject ratesObj;
+	for (auto i = _rates.cbegin(); i != _rates.cend(); ++i) {
+		QJsonObject rate;
+		rate["batch_size"] = i->batchSize;
+		rate["delay_ms"] = i->delayMs;
+		rate["flood_waits"] = i->floodWaits;
+		rate["updated"] = i->updated.toString(Qt::ISODate);
+		ratesObj[QString::number(i.key())] = rate;
+	}
+	state["rates"] = ratesObj;
+
+	QJsonObject budget;
+	budget["hour"] = _budgetHour;
+	budget["day"] = _budgetDay.toString(Qt::ISODate);
+	budget["archived_this_hour"] = _archivedThisHour;
+	budget["archived_today"] = _archivedToday;
+	state["budget"] = budget;
+
 	QFile file(stateFilePath());
 	if (file.open(QIODevice::WriteOnly)) {
 		file.write(QJsonDocument(state).toJson());
@@ -710,27 +941,46 @@ void GradualArchiver::loadState() {
 		loadConfigFromJson(state["config"].toObject());
 	}
 
-	if (state.contains("current_offset_id")) {
-		_currentOffsetId = state["current_offset_id"].toVariant().toLongLong();
-	}
-	if (state.contains("consecutive_batches")) {
-		_consecutiveBatches = state["consecutive_batches"].toInt();
-	}
-
-	// Restore status
-	if (state.contains("status")) {
-		QJsonObject statusObj = state["status"].toObject();
-		_status.chatId = statusObj["chat_id"].toVariant().toLongLong();
-		_status.chatTitle = statusObj["chat_title"].toString();
-		_status.totalMessages = statusObj["total_messages"].toInt();
-		_status.archivedMessages = statusObj["archived_messages"].toInt();
-		_status.batchesCompleted = statusObj["batches_completed"].toInt();
-
-		QString stateStr = statusObj["state"].toString();
-		if (stateStr == "running" || stateStr == "paused") {
-			// Resume as paused
-			_status.state = GradualArchiveStatus::State::Paused;
+	const auto ratesObj = state["rates"].toObject();
+	for (auto i = ratesObj.begin(); i != ratesObj.end(); ++i) {
+		const auto rateObj = i.value().toObject();
+		auto &rate = _rates[i.key().toInt()];
+		rate.batchSize = rateObj["batch_size"].toDouble();
+		rate.delayMs = rateObj["delay_ms"].toDouble();
+		rate.floodWaits = rateObj["flood_waits"].toInt();
+		rate.updated = QDateTime::fromString(
+			rateObj["updated"].toString(),
+			Qt::ISODate);
+	}
+
+	const auto budget = state["budget"].toObject();
+	_budgetHour = budget["hour"].toVariant().toLongLong();
+	_budgetDay = QDate::fromString(budget["day"].toString(), Qt::ISODate);
+	_archivedThisHour = budget["archived_this_hour"].toInt();
+	_archivedToday = budget["archived_today"].toInt();
+	rollBudget();
+
+	// Chats that were being archived come back paused until resume(),
+	// the session may not be set yet.
+	for (const auto &item : state["jobs"].toArray()) {
+		const auto jobObj = item.toObject();
+		const auto stateStr = jobObj["state"].toString();
+		if (stateStr != "running"
+			&& stateStr != "paused"
+			&& stateStr != "rate_limited"
+			&& stateStr != "waiting_for_active_hours") {
+			continue;
 		}
+		const auto job = addJob(
+			jobObj["chat_id"].toVariant().toLongLong(),
+			_config); // Use current config
+		job->status.state = GradualArchiveStatus::State::Paused;
+		job->status.chatTitle = jobObj["chat_title"].toString();
+		job->status.totalMessages = jobObj["total_messages"].toInt();
+		job->status.archivedMessages = jobObj["archived_messages"].toInt();
+		job->status.batchesCompleted = jobObj["batches_completed"].toInt();
+		job->offsetId = jobObj["offset_id"].toVariant().toLongLong();
+		job->consecutiveBatches = jobObj["consecutive_batches"].toInt();
 	}
 
 	// Restore queue
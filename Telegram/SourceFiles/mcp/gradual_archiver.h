@@ -10,8 +10,13 @@
 #include <QtCore/QRandomGenerator>
 #include <QtCore/QJsonObject>
 #include <QtCore/QJsonArray>
+#include <QtCore/QHash>
+#include <QtCore/QVector>
 #include <QtSql/QSqlDatabase>
 
+#include <memory>
+#include <vector>
+
 namespace Data {
 class Session;
 } // namespace Data
@@ -23,17 +28,23 @@ class ChatArchiver;
 // Configuration for gradual/covert archiving
 struct GradualArchiveConfig {
 	// Timing parameters (all in milliseconds)
-	int minDelayMs = 3000;        // Min delay between batches (3 sec)
-	int maxDelayMs = 15000;       // Max delay between batches (15 sec)
+	int minDelayMs = 1000;        // Shortest delay the pace may reach (1 sec)
+	int maxDelayMs = 15000;       // Longest delay after backing off (15 sec)
 	int burstPauseMs = 60000;     // Pause after burst (1 min)
 	int longPauseMs = 300000;     // Occasional long pause (5 min)
 
 	// Batch parameters
-	int minBatchSize = 10;        // Min messages per batch
-	int maxBatchSize = 50;        // Max messages per batch
+	int minBatchSize = 10;        // Smallest batch after backing off
+	int maxBatchSize = 100;       // Largest batch the pace may reach
 	int batchesBeforePause = 5;   // Batches before burst pause
 	int batchesBeforeLongPause = 20; // Batches before long pause
 
+	// Adaptive pace, shared by all chats on a DC
+	int fastBatchMs = 1000;       // A batch stored within this counts as fast
+	int batchSizeStep = 5;        // Added to the batch size after a fast batch
+	int delayStepMs = 500;        // Taken off the delay after a fast batch
+	int maxParallelChats = 3;     // Chats archived at once
+
 	// Behavior patterns
 	bool randomizeOrder = true;   // Don't always go oldest-to-newest
 	bool simulateReading = true;  // Add "reading time" based on message length
@@ -92,7 +103,21 @@ struct GradualArchiveStatus {
 	QString lastError;
 };
 
+// Learned pace of a DC. Every fast batch adds to the batch size and
+// takes off the delay, a flood wait halves the size and doubles the
+// delay, so the pace settles just under what the server accepts.
+struct GradualArchiveRate {
+	double batchSize = 0.;
+	double delayMs = 0.;
+	int floodWaits = 0;
+	qint64 nextSlotAt = 0; // ms, earliest start of the next batch.
+	QDateTime updated;
+};
+
 // Gradual archiver - covert export with natural timing
+//
+// Several chats are archived at once, their batches take turns in the
+// pace of the DC and count against one hourly and daily budget.
 class GradualArchiver : public QObject {
 	Q_OBJECT
 
@@ -103,7 +128,7 @@ public:
 	void setArchiver(ChatArchiver *archiver) { _archiver = archiver; }
 	void setDataSession(Data::Session *session) { _session = session; }
 
-	// Start gradual archiving of a chat
+	// Start gradual archiving of a chat, fails when all slots are taken
 	bool startGradualArchive(
 		qint64 chatId,
 		const GradualArchiveConfig &config = GradualArchiveConfig{});
@@ -118,10 +143,13 @@ public:
 	void clearQueue();
 	QJsonArray getQueue() const;
 
-	// Status
-	GradualArchiveStatus status() const { return _status; }
+	// Called on FLOOD_WAIT from the session, every chat backs off
+	void reportFloodWait(int seconds);
+
+	// Status of the oldest active chat, or of the last one to finish
+	GradualArchiveStatus status() const;
 	QJsonObject statusJson() const;
-	bool isRunning() const { return _status.state == GradualArchiveStatus::State::Running; }
+	bool isRunning() const;
 
 	// Configuration
 	void setConfig(const GradualArchiveConfig &config) { _config = config; }
@@ -141,24 +169,46 @@ Q_SIGNALS:
 	void sizeUpdated(qint64 textBytes, qint64 mediaBytes); // Size tracking
 
 private Q_SLOTS:
-	void processNextBatch();
 	void checkActiveHours();
-	void resetHourlyCounter();
-	void resetDailyCounter();
 
 private:
+	struct Job {
+		GradualArchiveConfig config;
+		GradualArchiveStatus status;
+		qint64 offsetId = 0; // Newest archived message id.
+		int consecutiveBatches = 0;
+		int retryCount = 0;
+		int readingMs = 0; // Simulated reading, added to the next delay.
+		QJsonArray collectedMessages;
+		QTimer *timer = nullptr;
+	};
+
+	// Jobs
+	Job *addJob(qint64 chatId, const GradualArchiveConfig &config);
+	Job *findJob(qint64 chatId) const;
+	Job *startJob(qint64 chatId, const GradualArchiveConfig &config);
+	void removeJob(qint64 chatId);
+	void setJobState(Job &job, GradualArchiveStatus::State state);
+	void waitFor(Job &job, qint64 delayMs);
+
 	// Timing helpers
-	int calculateNextDelay();
-	int calculateBatchSize();
-	bool isWithinActiveHours() const;
+	GradualArchiveRate &currentRate();
+	void adaptRate(
+		GradualArchiveRate &rate,
+		const GradualArchiveConfig &config,
+		qint64 elapsedMs);
+	int calculateNextDelay(Job &job, const GradualArchiveRate &rate);
+	int calculateBatchSize(const Job &job, const GradualArchiveRate &rate);
+	bool isWithinActiveHours(const GradualArchiveConfig &config) const;
 	int calculateReadingTime(int messageLength);
+	void rollBudget();
 
 	// Archive helpers
-	bool fetchBatch(int limit, qint64 offsetId);
-	void handleFloodWait(int seconds);
-	void scheduleNextBatch();
-	void completeArchive();
-	void startExport();
+	void processNextBatch(qint64 chatId);
+	int fetchBatch(Job &job, int limit);
+	void scheduleNextBatch(Job &job);
+	void completeArchive(qint64 chatId);
+	void startExport(const Job &job);
 
 	// Queue management
 	void processNextInQueue();
@@ -171,17 +221,18 @@ private:
 	ChatArchiver *_archiver = nullptr;
 	Data::Session *_session = nullptr;
 
-	GradualArchiveConfig _config;
-	GradualArchiveStatus _status;
+	GradualArchiveConfig _config; // For chats started without one.
+	GradualArchiveStatus _lastStatus;
 
-	QTimer *_batchTimer = nullptr;
+	std::vector<std::unique_ptr<Job>> _jobs; // Oldest first.
+	QHash<int, GradualArchiveRate> _rates; // By DC id.
 	QTimer *_activeHoursTimer = nullptr;
-	QTimer *_hourlyResetTimer = nullptr;
-	QTimer *_dailyResetTimer = nullptr;
 
-	qint64 _currentOffsetId = 0;
-	int _consecutiveBatches = 0;
-	int _retryCount = 0;
+	// Budget shared by all chats
+	qint64 _budgetHour = 0; // Hours since epoch, local time.
+	QDate _budgetDay;
+	int _archivedThisHour = 0;
+	int _archivedToday = 0;
 
 	// Queue of chats to archive
 	struct QueuedChat {
@@ -190,9 +241,6 @@ private:
 	};
 	QVector<QueuedChat> _queue;
 
-	// In-memory message storage (when no database archiver)
-	QJsonArray _collectedMessages;
-
 	QRandomGenerator _rng;
 };
 
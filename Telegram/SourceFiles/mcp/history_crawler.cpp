@@ -0,0 +1,527 @@
+// This file is part of Telegram Desktop MCP Server.
+// Licensed under GPLv3 with OpenSSL exception.
+
+#include "mcp/history_crawler.h"
+
+#include "mcp/database_pool.h"
+
+#include "api/api_text_entities.h"
+#include "apiwrap.h"
+#include "data/data_histories.h"
+#include "data/data_peer.h"
+#include "data/data_session.h"
+#include "data/data_user.h"
+#include "dialogs/dialogs_indexed_list.h"
+#include "dialogs/dialogs_main_list.h"
+#include "dialogs/dialogs_row.h"
+#include "history/history.h"
+#include "main/main_session.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QJsonArray>
+#include <QtCore/QPointer>
+#include <QtCore/QRegularExpression>
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+
+#include <algorithm>
+#include <type_traits>
+
+namespace MCP {
+namespace {
+
+constexpr auto kPageSize = 100;
+constexpr auto kMaxChatsInFlight = 3;
+constexpr auto kMaxRetries = 3;
+constexpr auto kRetryDelayMs = 5000;
+
+constexpr auto kPending = "pending";
+constexpr auto kCompleted = "completed";
+constexpr auto kFailed = "failed";
+constexpr auto kCancelled = "cancelled";
+
+void FillSender(
+		not_null<Data::Session*> session,
+		PeerId fromId,
+		ArchivedMessageRow &row) {
+	row.userId = fromId.value;
+	if (const auto from = session->peerLoaded(fromId)) {
+		if (const auto user = from->asUser()) {
+			row.username = user->username();
+			row.firstName = user->firstName;
+			row.lastName = user->lastName;
+		} else {
+			row.username = from->name();
+		}
+	}
+}
+
+void FillMedia(const MTPMessageMedia &media, ArchivedMessageRow &row) {
+	const auto set = [&](const char *type) {
+		row.messageType = type;
+		row.hasMedia = true;
+	};
+	media.match([](const MTPDmessageMediaEmpty &) {
+	}, [](const MTPDmessageMediaWebPage &) {
+	}, [&](const MTPDmessageMediaPhoto &) {
+		set("photo");
+	}, [&](const MTPDmessageMediaDocument &data) {
+		set("document");
+		const auto document = data.vdocument();
+		if (!document) {
+			return;
+		}
+		document->match([&](const MTPDdocument &data) {
+			row.mediaMimeType = qs(data.vmime_type());
+			row.mediaSize = data.vsize().v;
+			for (const auto &attribute : data.vattributes().v) {
+				attribute.match([&](const MTPDdocumentAttributeAudio &data) {
+					row.messageType = data.is_voice() ? "voice" : "audio";
+				}, [&](const MTPDdocumentAttributeVideo &) {
+					if (row.messageType == "document") {
+						row.messageType = "video";
+					}
+				}, [&](const MTPDdocumentAttributeSticker &) {
+					row.messageType = "sticker";
+				}, [&](const MTPDdocumentAttributeAnimated &) {
+					row.messageType = "animation";
+				}, [](const auto &) {
+				});
+			}
+		}, [](const MTPDdocumentEmpty &) {
+		});
+	}, [&](const MTPDmessageMediaContact &) {
+		set("contact");
+	}, [&](const MTPDmessageMediaGeo &) {
+		set("location");
+	}, [&](const MTPDmessageMediaGeoLive &) {
+		set("location");
+	}, [&](const MTPDmessageMediaVenue &) {
+		set("location");
+	}, [&](const MTPDmessageMediaPoll &) {
+		set("poll");
+	}, [&](const auto &) {
+		set("unknown");
+	});
+}
+
+// Builds the row straight from the MTP data, crawling must not create a
+// HistoryItem for every message of an 8M-message archive.
+template <typename MessageData>
+ArchivedMessageRow ParseCommon(
+		not_null<Data::Session*> session,
+		qint64 chatId,
+		const MessageData &data) {
+	auto row = ArchivedMessageRow();
+	row.messageId = data.vid().v;
+	row.chatId = chatId;
+	row.timestamp = data.vdate().v;
+	FillSender(
+		session,
+		(data.vfrom_id()
+			? peerFromMTP(*data.vfrom_id())
+			: data.is_out()
+			? session->session().userPeerId()
+			: peerFromMTP(data.vpeer_id())),
+		row);
+	if (const auto reply = data.vreply_to()) {
+		reply->match([&](const MTPDmessageReplyHeader &data) {
+			row.replyToId = data.vreply_to_msg_id().value_or_empty();
+		}, [](const auto &) {
+		});
+	}
+	return row;
+}
+
+// Returns the message id, a row is appended for real messages only.
+qint64 ParseMessage(
+		not_null<Data::Session*> session,
+		qint64 chatId,
+		const MTPMessage &message,
+		std::vector<ArchivedMessageRow> &rows) {
+	return message.match([&](const MTPDmessageEmpty &data) {
+		return qint64(data.vid().v);
+	}, [&](const MTPDmessage &data) {
+		auto row = ParseCommon(session, chatId, data);
+		row.content = qs(data.vmessage());
+		row.metadata = ArchivedEntities({
+			row.content,
+			Api::EntitiesFromMTP(
+				&session->session(),
+				data.ventities().value_or_empty()),
+		});
+		row.messageType = "text";
+		if (const auto forwarded = data.vfwd_from()) {
+			row.isForwarded = true;
+			const auto &fwd = forwarded->data();
+			if (const auto fromId = fwd.vfrom_id()) {
+				row.forwardChatId = peerFromMTP(*fromId).value;
+			}
+			row.forwardMessageId = fwd.vchannel_post().value_or_empty();
+		}
+		if (const auto media = data.vmedia()) {
+			FillMedia(*media, row);
+		}
+		const auto id = row.messageId;
+		rows.push_back(std::move(row));
+		return id;
+	}, [&](const MTPDmessageService &data) {
+		auto row = ParseCommon(session, chatId, data);
+		row.messageType = "service";
+		const auto id = row.messageId;
+		rows.push_back(std::move(row));
+		return id;
+	});
+}
+
+[[nodiscard]] int FloodWaitSeconds(const QString &type) {
+	static const auto regexp = QRegularExpression(
+		"^FLOOD_(?:PREMIUM_)?WAIT_(\\d+)$");
+	const auto match = regexp.match(type);
+	return match.hasMatch() ? match.captured(1).toInt() : 0;
+}
+
+} // namespace
+
+HistoryCrawler::HistoryCrawler(
+	not_null<Data::Session*> session,
+	not_null<ChatArchiver*> archiver,
+	not_null<DatabasePool*> pool,
+	QObject *parent)
+: QObject(parent)
+, _session(session)
+, _archiver(archiver)
+, _pool(pool) {
+	_floodTimer.setSingleShot(true);
+	connect(&_floodTimer, &QTimer::timeout, this, [=] {
+		pump();
+	});
+}
+
+HistoryCrawler::~HistoryCrawler() {
+	stop();
+}
+
+bool HistoryCrawler::CreateTables(QSqlDatabase &db) {
+	QSqlQuery query(db);
+	if (!query.exec(R"(CREATE TABLE IF NOT EXISTS archive_crawl_state (
+			chat_id INTEGER PRIMARY KEY,
+			offset_id INTEGER DEFAULT 0,
+			archived_count INTEGER DEFAULT 0,
+			message_limit INTEGER DEFAULT -1,
+			state TEXT NOT NULL,
+			last_error TEXT,
+			updated_at INTEGER
+		))")) {
+		qWarning() << "MCP: Failed to create crawl state:" << query.lastError().text();
+		return false;
+	}
+	return true;
+}
+
+void HistoryCrawler::saveJob(const Job &job, const QString &state) {
+	// Progress is only read back after a restart, no need to wait.
+	const auto now = QDateTime::currentSecsSinceEpoch();
+	_pool->write([=](QSqlDatabase &db) {
+		QSqlQuery query(db);
+		query.prepare(R"(
+			INSERT OR REPLACE INTO archive_crawl_state (
+				chat_id, offset_id, archived_count, message_limit,
+				state, last_error, updated_at
+			) VALUES (
+				:chat_id, :offset_id, :archived_count, :message_limit,
+				:state, :last_error, :updated_at
+			)
+		)");
+		query.bindValue(":chat_id", job.chatId);
+		query.bindValue(":offset_id", job.offsetId);
+		query.bindValue(":archived_count", job.archived);
+		query.bindValue(":message_limit", job.limit);
+		query.bindValue(":state", state);
+		query.bindValue(":last_error", job.lastError.isEmpty()
+			? QVariant()
+			: QVariant(job.lastError));
+		query.bindValue(":updated_at", now);
+		if (!query.exec()) {
+			qWarning() << "MCP: Failed to save crawl state:" << query.lastError().text();
+		}
+	});
+}
+
+bool HistoryCrawler::enqueue(qint64 chatId, int messageLimit) {
+	if (!chatId || !_session->peerLoaded(PeerId(chatId))) {
+		return false;
+	} else if (_jobs.contains(chatId)) {
+		return true;
+	}
+	auto job = Job();
+	job.chatId = chatId;
+	job.limit = messageLimit;
+	saveJob(job, kPending);
+	_jobs.insert(chatId, job);
+	_queue.push_back(chatId);
+	_stopped = false;
+	pump();
+	return true;
+}
+
+int HistoryCrawler::enqueueAllChats(int messagesPerChat) {
+	auto result = 0;
+	for (const auto &row : *_session->chatsList()->indexed()) {
+		if (const auto history = row->history()) {
+			if (enqueue(history->peer->id.value, messagesPerChat)) {
+				++result;
+			}
+		}
+	}
+	return result;
+}
+
+int HistoryCrawler::resume() {
+	QSqlQuery query(_pool->reader());
+	query.prepare(R"(
+		SELECT chat_id, offset_id, archived_count, message_limit
+		FROM archive_crawl_state
+		WHERE state = :state
+		ORDER BY updated_at
+	)");
+	query.bindValue(":state", kPending);
+	if (!query.exec()) {
+		return 0;
+	}
+	auto result = 0;
+	while (query.next()) {
+		auto job = Job();
+		job.chatId = query.value(0).toLongLong();
+		job.offsetId = query.value(1).toLongLong();
+		job.archived = query.value(2).toInt();
+		job.limit = query.value(3).toInt();
+		if (_jobs.contains(job.chatId)
+			|| !_session->peerLoaded(PeerId(job.chatId))) {
+			continue;
+		}
+		_jobs.insert(job.chatId, job);
+		_queue.push_back(job.chatId);
+		++result;
+	}
+	_stopped = false;
+	pump();
+	return result;
+}
+
+void HistoryCrawler::stop() {
+	_stopped = true;
+	_floodTimer.stop();
+	for (auto &job : _jobs) {
+		if (job.requestId) {
+			_session->histories().cancelRequest(
+				base::take(job.requestId));
+		}
+	}
+	_jobs.clear();
+	_queue.clear();
+	_inFlight = 0;
+}
+
+bool HistoryCrawler::cancel(qint64 chatId) {
+	const auto i = _jobs.find(chatId);
+	if (i == _jobs.end()) {
+		return false;
+	}
+	if (i->requestId) {
+		_session->histories().cancelRequest(base::take(i->requestId));
+		--_inFlight;
+	}
+	_queue.erase(
+		std::remove(_queue.begin(), _queue.end(), chatId),
+		_queue.end());
+	saveJob(_jobs.take(chatId), kCancelled);
+	pump();
+	return true;
+}
+
+void HistoryCrawler::pump() {
+	while (!_stopped
+		&& !_floodTimer.isActive()
+		&& _inFlight < kMaxChatsInFlight
+		&& !_queue.empty()) {
+		const auto chatId = _queue.front();
+		_queue.pop_front();
+		if (_jobs.contains(chatId)) {
+			requestPage(chatId);
+		}
+	}
+}
+
+void HistoryCrawler::requestPage(qint64 chatId) {
+	auto &job = _jobs[chatId];
+	const auto session = _session;
+	const auto peer = session->peer(PeerId(chatId));
+	const auto history = session->history(peer);
+	const auto offsetId = job.offsetId;
+	const auto count = (job.limit < 0)
+		? kPageSize
+		: std::clamp(job.limit - job.archived, 1, kPageSize);
+	const auto weak = QPointer<HistoryCrawler>(this);
+
+	++_inFlight;
+	const auto type = Data::Histories::RequestType::History;
+	job.requestId = session->histories().sendRequest(history, type, [=](
+			Fn<void()> finish) {
+		return session->session().api().request(MTPmessages_GetHistory(
+			peer->input,
+			MTP_int(offsetId),
+			MTP_int(0), // offset_date
+			MTP_int(0), // add_offset
+			MTP_int(count),
+			MTP_int(0), // max_id
+			MTP_int(0), // min_id
+			MTP_long(0) // hash
+		)).done([=](const MTPmessages_Messages &result) {
+			finish();
+			if (!weak) {
+				return;
+			}
+			auto rows = std::vector<ArchivedMessageRow>();
+			auto oldestId = qint64(0);
+			auto complete = true;
+			result.match([](const MTPDmessages_messagesNotModified &) {
+			}, [&](const auto &data) {
+				session->processUsers(data.vusers());
+				session->processChats(data.vchats());
+				const auto &messages = data.vmessages().v;
+				rows.reserve(messages.size());
+				for (const auto &message : messages) {
+					const auto id = ParseMessage(session, chatId, message, rows);
+					if (id > 0 && (!oldestId || id < oldestId)) {
+						oldestId = id;
+					}
+				}
+				// messages.messages is always the whole history at once.
+				using Whole = MTPDmessages_messages;
+				complete = std::is_same_v<std::decay_t<decltype(data)>, Whole>
+					|| messages.isEmpty();
+			});
+			weak->pageReceived(chatId, rows, oldestId, complete);
+		}).fail([=](const MTP::Error &error) {
+			finish();
+			if (weak) {
+				weak->pageFailed(chatId, error.type());
+			}
+		}).handleFloodErrors().send();
+	});
+}
+
+void HistoryCrawler::pageReceived(
+		qint64 chatId,
+		const std::vector<ArchivedMessageRow> &rows,
+		qint64 oldestId,
+		bool complete) {
+	const auto i = _jobs.find(chatId);
+	if (i == _jobs.end() || !i->requestId) {
+		return; // Stopped while the request was in flight.
+	}
+	--_inFlight;
+	auto &job = *i;
+	job.requestId = 0;
+	job.retries = 0;
+	job.lastError = QString();
+
+	const auto stored = _archiver->archiveRows(rows);
+	if (stored < int(rows.size())) {
+		job.lastError = "Failed to store messages";
+		finishJob(chatId, kFailed);
+		return;
+	}
+	job.archived += stored;
+	if (oldestId > 0) {
+		job.offsetId = oldestId;
+	}
+	Q_EMIT chatProgress(chatId, job.archived);
+
+	if (complete
+		|| !oldestId
+		|| (job.limit >= 0 && job.archived >= job.limit)) {
+		finishJob(chatId, kCompleted);
+		return;
+	}
+
+	// Round-robin between queued chats instead of draining one.
+	saveJob(job, kPending);
+	_queue.push_back(chatId);
+	pump();
+}
+
+void HistoryCrawler::pageFailed(qint64 chatId, const QString &type) {
+	const auto i = _jobs.find(chatId);
+	if (i == _jobs.end() || !i->requestId) {
+		return;
+	}
+	--_inFlight;
+	auto &job = *i;
+	job.requestId = 0;
+	job.lastError = type;
+
+	if (const auto seconds = FloodWaitSeconds(type)) {
+		// Flood waits are account-wide, hold every chat until it ends.
+		qWarning() << "MCP: History crawl flood wait" << seconds << "s";
+		_queue.push_front(chatId);
+		_floodTimer.start(seconds * 1000 + 1000);
+		saveJob(job, kPending);
+		return;
+	} else if (++job.retries > kMaxRetries) {
+		qWarning() << "MCP: History crawl failed for" << chatId << ":" << type;
+		finishJob(chatId, kFailed);
+		return;
+	}
+	saveJob(job, kPending);
+	QTimer::singleShot(kRetryDelayMs * job.retries, this, [=] {
+		if (_jobs.contains(chatId)) {
+			_queue.push_back(chatId);
+			pump();
+		}
+	});
+}
+
+void HistoryCrawler::finishJob(qint64 chatId, const QString &state) {
+	const auto job = _jobs.take(chatId);
+	saveJob(job, state);
+	if (state == kCompleted) {
+		Q_EMIT chatCompleted(chatId, job.archived);
+	} else {
+		Q_EMIT chatFailed(chatId, job.lastError);
+	}
+	pump();
+}
+
+QJsonObject HistoryCrawler::status() const {
+	auto chats = QJsonArray();
+	QSqlQuery query(_pool->reader());
+	if (query.exec(R"(
+			SELECT chat_id, archived_count, message_limit, state, last_error
+			FROM archive_crawl_state
+			ORDER BY updated_at DESC
+		)")) {
+		while (query.next()) {
+			const auto chatId = query.value(0).toLongLong();
+			chats.append(QJsonObject{
+				{"chat_id", chatId},
+				{"archived", query.value(1).toInt()},
+				{"limit", query.value(2).toInt()},
+				{"state", query.value(3).toString()},
+				{"last_error", query.value(4).toString()},
+				{"active", _jobs.contains(chatId)},
+			});
+		}
+	}
+	return QJsonObject{
+		{"queued", int(_queue.size())},
+		{"in_flight", _inFlight},
+		{"flood_wait_ms", _floodTimer.isActive()
+			? _floodTimer.remainingTime()
+			: 0},
+		{"chats", chats},
+	};
+}
+
+} // namespace MCP
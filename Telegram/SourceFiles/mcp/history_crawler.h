@@ -0,0 +1,95 @@
+// This file is part of Telegram Desktop MCP Server.
+// Licensed under GPLv3 with OpenSSL exception.
+
+#pragma once
+
+#include "mcp/chat_archiver.h"
+
+#include <QtCore/QObject>
+#include <QtCore/QHash>
+#include <QtCore/QJsonObject>
+#include <QtCore/QTimer>
+
+#include <deque>
+#include <vector>
+
+namespace Data {
+class Session;
+} // namespace Data
+
+namespace MCP {
+
+class DatabasePool;
+
+// Pages backwards through server history with messages.getHistory and
+// stores every slice through ChatArchiver's bulk ingest path. The next
+// offset of every chat lives in archive_crawl_state, so an interrupted
+// crawl continues where it stopped after a restart.
+class HistoryCrawler : public QObject {
+	Q_OBJECT
+
+public:
+	HistoryCrawler(
+		not_null<Data::Session*> session,
+		not_null<ChatArchiver*> archiver,
+		not_null<DatabasePool*> pool,
+		QObject *parent = nullptr);
+	~HistoryCrawler();
+
+	// Archive schema migration creating the crawl state table.
+	static bool CreateTables(QSqlDatabase &db);
+
+	// messageLimit < 0 crawls the whole history. A chat that is already
+	// queued keeps its position, a completed one is crawled again from
+	// the newest message.
+	bool enqueue(qint64 chatId, int messageLimit = -1);
+	int enqueueAllChats(int messagesPerChat);
+
+	// Queues every crawl that had not completed before the last stop.
+	int resume();
+	void stop();
+	// Drops the crawl of one chat, the archived messages are kept.
+	bool cancel(qint64 chatId);
+
+	[[nodiscard]] QJsonObject status() const;
+
+Q_SIGNALS:
+	void chatProgress(qint64 chatId, int archivedMessages);
+	void chatCompleted(qint64 chatId, int archivedMessages);
+	void chatFailed(qint64 chatId, const QString &error);
+
+private:
+	struct Job {
+		qint64 chatId = 0;
+		qint64 offsetId = 0; // Next page starts below this id, 0 = newest.
+		int archived = 0;
+		int limit = -1;
+		int retries = 0;
+		int requestId = 0; // Data::Histories request, 0 when idle.
+		QString lastError;
+	};
+
+	void saveJob(const Job &job, const QString &state);
+
+	void pump();
+	void requestPage(qint64 chatId);
+	void pageReceived(
+		qint64 chatId,
+		const std::vector<ArchivedMessageRow> &rows,
+		qint64 oldestId,
+		bool complete);
+	void pageFailed(qint64 chatId, const QString &type);
+	void finishJob(qint64 chatId, const QString &state);
+
+	const not_null<Data::Session*> _session;
+	const not_null<ChatArchiver*> _archiver;
+	const not_null<DatabasePool*> _pool;
+
+	QHash<qint64, Job> _jobs;
+	std::deque<qint64> _queue;
+	int _inFlight = 0;
+	QTimer _floodTimer; // Pauses every request until a flood wait ends.
+	bool _stopped = false;
+};
+
+} // namespace MCP
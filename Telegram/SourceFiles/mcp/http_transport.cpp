@@ -0,0 +1,747 @@
+// MCP HTTP Transport - Streamable HTTP with SSE implementation
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "http_transport.h"
+
+#include "wire_encoding.h"
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDateTime>
+#include <QtCore/QDebug>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QTimer>
+#include <QtCore/QUuid>
+#include <QtNetwork/QHostAddress>
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+
+#include <zlib.h>
+
+namespace MCP {
+namespace {
+
+constexpr auto kEndpoint = "/mcp";
+constexpr auto kMetricsEndpoint = "/metrics";
+constexpr auto kMaxHeaderSize = 64 * 1024;
+constexpr auto kMaxBodySize = 16 * 1024 * 1024;
+constexpr auto kKeepAliveMs = 15 * 1000;
+constexpr auto kSessionTimeoutMs = 30 * 60 * 1000;
+constexpr auto kMinCompressSize = 1024;
+constexpr auto kMaxTaggedSize = 4 * 1024 * 1024;
+
+QByteArray StatusText(int status) {
+	switch (status) {
+	case 200: return "OK";
+	case 202: return "Accepted";
+	case 204: return "No Content";
+	case 400: return "Bad Request";
+	case 404: return "Not Found";
+	case 405: return "Method Not Allowed";
+	case 406: return "Not Acceptable";
+	case 411: return "Length Required";
+	case 412: return "Precondition Failed";
+	case 413: return "Payload Too Large";
+	}
+	return "Internal Server Error";
+}
+
+QByteArray ErrorBody(int code, const QString &message) {
+	return QJsonDocument(QJsonObject{
+		{"jsonrpc", "2.0"},
+		{"id", QJsonValue::Null},
+		{"error", QJsonObject{
+			{"code", code},
+			{"message", message},
+		}},
+	}).toJson(QJsonDocument::Compact);
+}
+
+// Content codings of Accept-Encoding, gzip preferred. zlib is linked
+// already, so there is no dependency for the other codings.
+// An explicit entry wins over "*", so "gzip;q=0, *" excludes gzip.
+[[nodiscard]] QByteArray ChooseCoding(const QByteArray &acceptEncoding) {
+	auto gzip = std::optional<bool>();
+	auto deflate = std::optional<bool>();
+	auto any = std::optional<bool>();
+	for (const auto &entry : acceptEncoding.split(',')) {
+		const auto parts = entry.split(';');
+		const auto coding = parts.front().trimmed().toLower();
+		auto quality = 1.;
+		for (auto i = 1; i < parts.size(); ++i) {
+			const auto parameter = parts[i].trimmed();
+			if (parameter.startsWith("q=")) {
+				quality = parameter.mid(2).toDouble();
+			}
+		}
+		const auto accepted = (quality > 0.);
+		if (coding == "gzip" || coding == "x-gzip") {
+			gzip = accepted;
+		} else if (coding == "deflate") {
+			deflate = accepted;
+		} else if (coding == "*") {
+			any = accepted;
+		}
+	}
+	const auto allowed = [&](std::optional<bool> value) {
+		return value.value_or(any.value_or(false));
+	};
+	return allowed(gzip)
+		? "gzip"
+		: allowed(deflate)
+		? "deflate"
+		: QByteArray();
+}
+
+// An empty result when compression failed, the body then goes as is.
+[[nodiscard]] QByteArray Compress(
+		const QByteArray &data,
+		const QByteArray &coding) {
+	auto stream = z_stream();
+	// windowBits 15 + 16 writes the gzip header, HTTP deflate is the
+	// zlib format with its header, not a raw deflate stream.
+	const auto windowBits = (coding == "gzip") ? (15 + 16) : 15;
+	if (deflateInit2(
+			&stream,
+			Z_DEFAULT_COMPRESSION,
+			Z_DEFLATED,
+			windowBits,
+			8,
+			Z_DEFAULT_STRATEGY) != Z_OK) {
+		return QByteArray();
+	}
+	auto result = QByteArray();
+	result.resize(int(deflateBound(&stream, uLong(data.size())) + 32));
+	stream.next_in = reinterpret_cast<Bytef*>(
+		const_cast<char*>(data.constData()));
+	stream.avail_in = uInt(data.size());
+	stream.next_out = reinterpret_cast<Bytef*>(result.data());
+	stream.avail_out = uInt(result.size());
+	const auto finished = (deflate(&stream, Z_FINISH) == Z_STREAM_END);
+	result.resize(int(stream.total_out));
+	deflateEnd(&stream);
+	return finished ? result : QByteArray();
+}
+
+// Weak validator of a single response, the id of the request is left
+// out so that a poll with a new id still matches. Errors and large
+// results are not tagged, they would cost a second encoding.
+[[nodiscard]] QByteArray ResponseTag(
+		const QJsonObject &response,
+		WireEncoding encoding,
+		qsizetype encodedSize) {
+	if (!response.contains("result") || encodedSize > kMaxTaggedSize) {
+		return QByteArray();
+	}
+	const auto hash = QCryptographicHash::hash(
+		EncodeMessage(response.value("result"), encoding),
+		QCryptographicHash::Sha1);
+	return "W/\"" + hash.toHex().left(32) + '"';
+}
+
+[[nodiscard]] bool TagMatches(
+		const QByteArray &ifNoneMatch,
+		const QByteArray &tag) {
+	const auto opaque = [](QByteArray value) {
+		value = value.trimmed();
+		return value.startsWith("W/") ? value.mid(2) : value;
+	};
+	const auto mine = opaque(tag);
+	for (const auto &entry : ifNoneMatch.split(',')) {
+		const auto theirs = entry.trimmed();
+		if (theirs == "*" || opaque(theirs) == mine) {
+			return true;
+		}
+	}
+	return false;
+}
+
+} // namespace
+
+HttpTransport::HttpTransport(QObject *parent)
+	: QObject(parent) {
+}
+
+HttpTransport::~HttpTransport() {
+	stop();
+}
+
+void HttpTransport::setRequestHandler(RequestHandler handler) {
+	_handler = std::move(handler);
+}
+
+void HttpTransport::setMetricsHandler(MetricsHandler handler) {
+	_metricsHandler = std::move(handler);
+}
+
+bool HttpTransport::start(int port) {
+	if (_server && _server->isListening()) {
+		return true;
+	}
+
+	_server = std::make_unique<QTcpServer>();
+	// Only local agents may talk to the embedded server.
+	if (!_server->listen(QHostAddress::LocalHost, quint16(port))) {
+		qWarning() << "MCP: HTTP transport failed to listen on port"
+			<< port << ":" << _server->errorString();
+		_server.reset();
+		return false;
+	}
+	connect(
+		_server.get(),
+		&QTcpServer::newConnection,
+		this,
+		&HttpTransport::onNewConnection);
+
+	_keepAliveTimer = new QTimer(this);
+	connect(_keepAliveTimer, &QTimer::timeout, this, [=] {
+		sendKeepAlive();
+		dropExpiredSessions();
+	});
+	_keepAliveTimer->start(kKeepAliveMs);
+
+	qInfo() << "MCP: HTTP transport listening on 127.0.0.1:" << port;
+	return true;
+}
+
+void HttpTransport::stop() {
+	if (_keepAliveTimer) {
+		_keepAliveTimer->stop();
+		delete _keepAliveTimer;
+		_keepAliveTimer = nullptr;
+	}
+	const auto connections = _connections;
+	_connections.clear();
+	for (const auto &connection : connections) {
+		if (const auto socket = connection.socket.data()) {
+			socket->disconnect(this);
+			socket->close();
+			socket->deleteLater();
+		}
+	}
+	_sessions.clear();
+	if (_server) {
+		_server->close();
+		_server.reset();
+	}
+}
+
+bool HttpTransport::isListening() const {
+	return _server && _server->isListening();
+}
+
+int HttpTransport::port() const {
+	return _server ? int(_server->serverPort()) : 0;
+}
+
+void HttpTransport::notify(
+		const QJsonObject &message,
+		const QString &sessionId) {
+	const auto data = QJsonDocument(message).toJson(QJsonDocument::Compact);
+	const auto send = [&](Session &session) {
+		for (const auto &stream : session.streams) {
+			if (stream) {
+				writeEvent(stream, data);
+			}
+		}
+	};
+	if (!sessionId.isEmpty()) {
+		const auto i = _sessions.find(sessionId);
+		if (i != _sessions.end()) {
+			send(*i);
+		}
+		return;
+	}
+	for (auto &session : _sessions) {
+		send(session);
+	}
+}
+
+void HttpTransport::onNewConnection() {
+	while (const auto socket = _server->nextPendingConnection()) {
+		_connections.insert(socket, Connection{ socket });
+		connect(socket, &QTcpSocket::readyRead, this, [=] {
+			onReadyRead(socket);
+		});
+		connect(socket, &QTcpSocket::disconnected, this, [=] {
+			onDisconnected(socket);
+		});
+	}
+}
+
+void HttpTransport::onReadyRead(QTcpSocket *socket) {
+	const auto i = _connections.find(socket);
+	if (i == _connections.end()) {
+		return;
+	}
+	i->buffer.append(socket->readAll());
+
+	// Keep-alive connections may carry several pipelined requests.
+	while (_connections.contains(socket)) {
+		auto &connection = _connections[socket];
+		if (!connection.streamSessionId.isEmpty()) {
+			// SSE streams are write-only from here on.
+			connection.buffer.clear();
+			return;
+		} else if (connection.waiting) {
+			// Pipelined requests wait until the previous one is answered.
+			return;
+		}
+		auto request = HttpRequest();
+		auto bad = false;
+		if (!parseRequest(connection, request, bad)) {
+			if (bad) {
+				writeResponse(
+					socket,
+					400,
+					ErrorBody(-32700, "Malformed HTTP request"));
+				socket->disconnectFromHost();
+			}
+			return;
+		}
+		processRequest(connection, request);
+	}
+}
+
+void HttpTransport::onDisconnected(QTcpSocket *socket) {
+	const auto i = _connections.find(socket);
+	if (i != _connections.end()) {
+		if (!i->streamSessionId.isEmpty()) {
+			const auto s = _sessions.find(i->streamSessionId);
+			if (s != _sessions.end()) {
+				s->streams.removeAll(QPointer<QTcpSocket>(socket));
+			}
+		}
+		_connections.erase(i);
+	}
+	socket->deleteLater();
+}
+
+bool HttpTransport::parseRequest(
+		Connection &connection,
+		HttpRequest &request,
+		bool &bad) {
+	auto &buffer = connection.buffer;
+	const auto headerEnd = buffer.indexOf("\r\n\r\n");
+	if (headerEnd < 0) {
+		bad = (buffer.size() > kMaxHeaderSize);
+		return false;
+	}
+
+	const auto lines = buffer.left(headerEnd).split('\n');
+	const auto requestLine = lines.front().trimmed().split(' ');
+	if (requestLine.size() < 3) {
+		bad = true;
+		return false;
+	}
+	request.method = requestLine[0].toUpper();
+	request.path = requestLine[1];
+	if (const auto query = request.path.indexOf('?'); query >= 0) {
+		request.path.truncate(query);
+	}
+	for (auto i = 1; i < lines.size(); ++i) {
+		const auto &line = lines[i];
+		const auto colon = line.indexOf(':');
+		if (colon <= 0) {
+			continue;
+		}
+		request.headers.insert(
+			line.left(colon).trimmed().toLower(),
+			line.mid(colon + 1).trimmed());
+	}
+
+	if (request.headers.value("transfer-encoding").toLower() == "chunked") {
+		// Agents always send sized bodies, keep the parser simple.
+		bad = true;
+		return false;
+	}
+	auto ok = true;
+	const auto length = request.headers.contains("content-length")
+		? request.headers.value("content-length").toLongLong(&ok)
+		: 0;
+	if (!ok || length < 0 || length > kMaxBodySize) {
+		bad = true;
+		return false;
+	}
+	const auto total = headerEnd + 4 + length;
+	if (buffer.size() < total) {
+		return false;
+	}
+	request.body = buffer.mid(headerEnd + 4, int(length));
+	buffer.remove(0, int(total));
+	return true;
+}
+
+void HttpTransport::processRequest(
+		Connection &connection,
+		const HttpRequest &request) {
+	if (request.path == kMetricsEndpoint
+		&& request.method == "GET"
+		&& _metricsHandler) {
+		writeResponse(
+			connection.socket,
+			200,
+			_metricsHandler(),
+			"text/plain; version=0.0.4; charset=utf-8",
+			{},
+			request.headers.value("accept-encoding", "identity"));
+		return;
+	} else if (request.path != kEndpoint) {
+		writeResponse(
+			connection.socket,
+			404,
+			ErrorBody(-32601, "Unknown endpoint, use /mcp"));
+		return;
+	}
+	const auto sessionId = QString::fromLatin1(
+		request.headers.value("mcp-session-id"));
+	if (!sessionId.isEmpty()) {
+		const auto i = _sessions.find(sessionId);
+		if (i != _sessions.end()) {
+			i->lastSeen = QDateTime::currentMSecsSinceEpoch();
+		}
+	}
+	if (request.method == "POST") {
+		handlePost(connection, request);
+	} else if (request.method == "GET") {
+		handleStream(connection, request);
+	} else if (request.method == "DELETE") {
+		handleDelete(connection, request);
+	} else {
+		writeResponse(
+			connection.socket,
+			405,
+			ErrorBody(-32600, "Method not allowed"),
+			"application/json",
+			{ { "Allow", "GET, POST, DELETE" } });
+	}
+}
+
+void HttpTransport::handlePost(
+		Connection &connection,
+		const HttpRequest &request) {
+	// Bodies may be sent as CBOR, replies follow the Accept header and
+	// fall back to the request encoding when JSON is not asked for.
+	const auto cborRequest = request.headers.value(
+		"content-type").startsWith(kCborMimeType);
+	const auto accept = request.headers.value("accept");
+	const auto encoding = (accept.contains(kCborMimeType)
+		|| (cborRequest && !accept.contains("application/json")))
+		? WireEncoding::Cbor
+		: WireEncoding::Json;
+	const auto contentType = QByteArray((encoding == WireEncoding::Cbor)
+		? kCborMimeType
+		: "application/json");
+
+	auto payload = QJsonValue();
+	auto parseError = QString();
+	if (cborRequest) {
+		const auto decoded = DecodeCborMessage(request.body);
+		if (!decoded.complete
+			|| decoded.consumed != request.body.size()) {
+			parseError = decoded.error.isEmpty()
+				? QString("Incomplete CBOR body")
+				: decoded.error;
+		}
+		payload = decoded.value;
+	} else {
+		QJsonParseError error;
+		const auto document = QJsonDocument::fromJson(request.body, &error);
+		if (error.error != QJsonParseError::NoError) {
+			parseError = error.errorString();
+		}
+		payload = document.isArray()
+			? QJsonValue(document.array())
+			: QJsonValue(document.object());
+	}
+	if (!parseError.isEmpty()
+		|| (!payload.isObject() && !payload.isArray())) {
+		writeResponse(
+			connection.socket,
+			400,
+			ErrorBody(-32700, "Parse error: " + parseError));
+		return;
+	}
+	const auto batch = payload.isArray();
+	const auto messages = batch
+		? payload.toArray()
+		: QJsonArray{ payload.toObject() };
+	if (messages.isEmpty()) {
+		writeResponse(
+			connection.socket,
+			400,
+			ErrorBody(-32600, "Invalid Request: empty batch"));
+		return;
+	}
+
+	auto sessionId = QString::fromLatin1(
+		request.headers.value("mcp-session-id"));
+	auto extraHeaders = QList<QPair<QByteArray, QByteArray>>();
+	const auto initialize = std::any_of(
+		messages.begin(),
+		messages.end(),
+		[](const QJsonValue &message) {
+			return message.toObject().value("method").toString()
+				== "initialize";
+		});
+	if (initialize) {
+		sessionId = createSession();
+		extraHeaders.push_back({ "Mcp-Session-Id", sessionId.toLatin1() });
+	} else if (!sessionId.isEmpty() && !_sessions.contains(sessionId)) {
+		writeResponse(
+			connection.socket,
+			404,
+			ErrorBody(-32001, "Session not found"));
+		return;
+	}
+
+	if (!_handler) {
+		writeResponse(
+			connection.socket,
+			500,
+			ErrorBody(-32603, "No request handler"));
+		return;
+	}
+
+	// Batch entries are handled independently and may complete in any
+	// order, the reply is sent once the last of them is done.
+	struct Pending {
+		QJsonArray responses;
+		int left = 0;
+	};
+	const auto pending = std::make_shared<Pending>();
+	pending->left = int(messages.size());
+
+	const auto authorization = request.headers.value("authorization");
+	const auto credential = authorization.toLower().startsWith("bearer ")
+		? QString::fromLatin1(authorization.mid(7).trimmed())
+		: QString();
+
+	const auto acceptEncoding = request.headers.value(
+		"accept-encoding",
+		"identity");
+	const auto ifNoneMatch = request.headers.value("if-none-match");
+
+	const auto socket = connection.socket;
+	const auto finish = [=] {
+		if (!socket) {
+			return;
+		}
+		const auto i = _connections.find(socket.data());
+		if (i == _connections.end()) {
+			return;
+		}
+		i->waiting = false;
+		if (pending->responses.isEmpty()) {
+			// Notifications and client responses are only acknowledged.
+			writeResponse(socket, 202, QByteArray(), "application/json", extraHeaders);
+		} else {
+			const auto body = EncodeMessage(
+				batch
+					? QJsonValue(pending->responses)
+					: pending->responses.first(),
+				encoding);
+			auto headers = extraHeaders;
+			const auto tag = batch
+				? QByteArray()
+				: ResponseTag(
+					pending->responses.first().toObject(),
+					encoding,
+					body.size());
+			if (!tag.isEmpty()) {
+				headers.push_back({ "ETag", tag });
+			}
+			if (!tag.isEmpty()
+				&& !ifNoneMatch.isEmpty()
+				&& TagMatches(ifNoneMatch, tag)) {
+				// A matching If-None-Match fails the precondition of
+				// any method other than GET and HEAD.
+				writeResponse(socket, 412, QByteArray(), contentType, headers);
+			} else {
+				writeResponse(
+					socket,
+					200,
+					body,
+					contentType,
+					headers,
+					acceptEncoding);
+			}
+		}
+		if (!i->buffer.isEmpty()) {
+			const auto raw = socket.data();
+			QMetaObject::invokeMethod(this, [=] {
+				onReadyRead(raw);
+			}, Qt::QueuedConnection);
+		}
+	};
+
+	connection.waiting = true;
+	for (const auto &value : messages) {
+		if (!value.isObject()) {
+			pending->responses.append(QJsonDocument::fromJson(
+				ErrorBody(-32600, "Invalid Request")).object());
+			if (!--pending->left) {
+				finish();
+			}
+			continue;
+		}
+		const auto message = value.toObject();
+		const auto hasId = message.contains("id");
+		_handler(message, sessionId, credential, [=](QJsonObject response) {
+			if (hasId && !response.isEmpty()) {
+				pending->responses.append(response);
+			}
+			if (!--pending->left) {
+				finish();
+			}
+		});
+	}
+}
+
+void HttpTransport::handleStream(
+		Connection &connection,
+		const HttpRequest &request) {
+	const auto accept = request.headers.value("accept");
+	if (!accept.contains("text/event-stream")) {
+		writeResponse(
+			connection.socket,
+			406,
+			ErrorBody(-32600, "GET requires Accept: text/event-stream"));
+		return;
+	}
+	auto sessionId = QString::fromLatin1(
+		request.headers.value("mcp-session-id"));
+	if (sessionId.isEmpty()) {
+		sessionId = createSession();
+	} else if (!_sessions.contains(sessionId)) {
+		writeResponse(
+			connection.socket,
+			404,
+			ErrorBody(-32001, "Session not found"));
+		return;
+	}
+
+	const auto socket = connection.socket.data();
+	socket->write(
+		"HTTP/1.1 200 OK\r\n"
+		"Content-Type: text/event-stream\r\n"
+		"Cache-Control: no-cache\r\n"
+		"Connection: keep-alive\r\n"
+		"Mcp-Session-Id: " + sessionId.toLatin1() + "\r\n"
+		"\r\n");
+	socket->flush();
+	connection.streamSessionId = sessionId;
+	_sessions[sessionId].streams.push_back(socket);
+}
+
+void HttpTransport::handleDelete(
+		Connection &connection,
+		const HttpRequest &request) {
+	const auto sessionId = QString::fromLatin1(
+		request.headers.value("mcp-session-id"));
+	const auto i = _sessions.find(sessionId);
+	if (i == _sessions.end()) {
+		writeResponse(
+			connection.socket,
+			404,
+			ErrorBody(-32001, "Session not found"));
+		return;
+	}
+	const auto streams = i->streams;
+	_sessions.erase(i);
+	for (const auto &stream : streams) {
+		if (stream) {
+			stream->disconnectFromHost();
+		}
+	}
+	writeResponse(connection.socket, 204, QByteArray());
+}
+
+void HttpTransport::writeResponse(
+		QTcpSocket *socket,
+		int status,
+		const QByteArray &body,
+		const QByteArray &contentType,
+		const QList<QPair<QByteArray, QByteArray>> &extraHeaders,
+		const QByteArray &acceptEncoding) {
+	if (!socket) {
+		return;
+	}
+	auto head = QByteArray("HTTP/1.1 ")
+		+ QByteArray::number(status) + ' ' + StatusText(status) + "\r\n";
+	auto content = body;
+	if (!acceptEncoding.isNull()) {
+		head += "Vary: Accept-Encoding\r\n";
+		const auto coding = (body.size() >= kMinCompressSize)
+			? ChooseCoding(acceptEncoding)
+			: QByteArray();
+		auto compressed = coding.isEmpty()
+			? QByteArray()
+			: Compress(body, coding);
+		if (!compressed.isEmpty() && compressed.size() < body.size()) {
+			head += "Content-Encoding: " + coding + "\r\n";
+			content = std::move(compressed);
+		}
+	}
+	if (!body.isEmpty()) {
+		head += "Content-Type: " + contentType + "\r\n";
+	}
+	head += "Content-Length: "
+		+ QByteArray::number(content.size())
+		+ "\r\n";
+	head += "Connection: keep-alive\r\n";
+	for (const auto &[name, value] : extraHeaders) {
+		head += name + ": " + value + "\r\n";
+	}
+	head += "\r\n";
+	socket->write(head);
+	if (!content.isEmpty()) {
+		socket->write(content);
+	}
+	socket->flush();
+}
+
+void HttpTransport::writeEvent(QTcpSocket *socket, const QByteArray &data) {
+	socket->write("event: message\ndata: " + data + "\n\n");
+	socket->flush();
+}
+
+QString HttpTransport::createSession() {
+	const auto id = QUuid::createUuid().toString(QUuid::WithoutBraces);
+	_sessions.insert(id, Session{
+		.lastSeen = QDateTime::currentMSecsSinceEpoch(),
+	});
+	return id;
+}
+
+void HttpTransport::sendKeepAlive() {
+	for (auto &session : _sessions) {
+		for (const auto &stream : session.streams) {
+			if (stream) {
+				// SSE comment line, ignored by clients.
+				stream->write(": keep-alive\n\n");
+				stream->flush();
+			}
+		}
+	}
+}
+
+void HttpTransport::dropExpiredSessions() {
+	const auto now = QDateTime::currentMSecsSinceEpoch();
+	for (auto i = _sessions.begin(); i != _sessions.end();) {
+		const auto streaming = std::any_of(
+			i->streams.begin(),
+			i->streams.end(),
+			[](const QPointer<QTcpSocket> &stream) { return !stream.isNull(); });
+		if (!streaming && now - i->lastSeen > kSessionTimeoutMs) {
+			i = _sessions.erase(i);
+		} else {
+			++i;
+		}
+	}
+}
+
+} // namespace MCP
@@ -0,0 +1,117 @@
+// MCP HTTP Transport - Streamable HTTP with SSE notifications
+//
+// This file is part of Telegram Desktop MCP integration.
+// Serves JSON-RPC over persistent HTTP/1.1 connections on localhost,
+// with per-client sessions and server-pushed SSE notifications.
+
+#pragma once
+
+#include <QtCore/QObject>
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QJsonObject>
+#include <QtCore/QPointer>
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+
+#include <functional>
+#include <memory>
+
+class QTimer;
+
+namespace MCP {
+
+class HttpTransport : public QObject {
+	Q_OBJECT
+
+public:
+	// Delivers the response for a request, may be called later from the
+	// main thread. An empty object acknowledges a notification.
+	using Respond = std::function<void(QJsonObject response)>;
+
+	// Receives a parsed JSON-RPC message together with the session it
+	// arrived on and the bearer token of its Authorization header, if
+	// any, and must eventually call respond exactly once.
+	using RequestHandler = std::function<void(
+		const QJsonObject &request,
+		const QString &sessionId,
+		const QString &credential,
+		Respond respond)>;
+
+	// Produces the Prometheus text served on GET /metrics.
+	using MetricsHandler = std::function<QByteArray()>;
+
+	explicit HttpTransport(QObject *parent = nullptr);
+	~HttpTransport() override;
+
+	void setRequestHandler(RequestHandler handler);
+	void setMetricsHandler(MetricsHandler handler);
+
+	// Listen on 127.0.0.1:port, the MCP endpoint is served at /mcp
+	// and metrics, when a handler is set, at /metrics
+	bool start(int port);
+	void stop();
+
+	[[nodiscard]] bool isListening() const;
+	[[nodiscard]] int port() const;
+	[[nodiscard]] int sessionCount() const { return int(_sessions.size()); }
+
+	// Push a JSON-RPC message to every open SSE stream of a session,
+	// or of all sessions when sessionId is empty.
+	void notify(const QJsonObject &message, const QString &sessionId = {});
+
+private:
+	struct HttpRequest {
+		QByteArray method;
+		QByteArray path;
+		QHash<QByteArray, QByteArray> headers; // Lower-cased names.
+		QByteArray body;
+	};
+
+	struct Connection {
+		QPointer<QTcpSocket> socket;
+		QByteArray buffer;
+		QString streamSessionId; // Set once the socket became an SSE stream.
+		bool waiting = false; // Responses go out in request order.
+	};
+
+	struct Session {
+		QList<QPointer<QTcpSocket>> streams;
+		qint64 lastSeen = 0;
+	};
+
+	void onNewConnection();
+	void onReadyRead(QTcpSocket *socket);
+	void onDisconnected(QTcpSocket *socket);
+
+	// Returns false when the buffer does not yet hold a full request.
+	bool parseRequest(Connection &connection, HttpRequest &request, bool &bad);
+	void processRequest(Connection &connection, const HttpRequest &request);
+	void handlePost(Connection &connection, const HttpRequest &request);
+	void handleStream(Connection &connection, const HttpRequest &request);
+	void handleDelete(Connection &connection, const HttpRequest &request);
+
+	// With acceptEncoding, the Accept-Encoding header of the request or
+	// "identity" without one, the body is compressed with its best coding.
+	void writeResponse(
+		QTcpSocket *socket,
+		int status,
+		const QByteArray &body,
+		const QByteArray &contentType = "application/json",
+		const QList<QPair<QByteArray, QByteArray>> &extraHeaders = {},
+		const QByteArray &acceptEncoding = QByteArray());
+	void writeEvent(QTcpSocket *socket, const QByteArray &data);
+
+	QString createSession();
+	void sendKeepAlive();
+	void dropExpiredSessions();
+
+	std::unique_ptr<QTcpServer> _server;
+	QHash<QTcpSocket*, Connection> _connections;
+	QHash<QString, Session> _sessions;
+	RequestHandler _handler;
+	MetricsHandler _metricsHandler;
+	QTimer *_keepAliveTimer = nullptr;
+};
+
+} // namespace MCP
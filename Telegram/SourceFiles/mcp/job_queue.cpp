@@ -0,0 +1,454 @@
+// MCP Job Queue - long tool calls as background jobs
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "mcp/job_queue.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QMutex>
+#include <QtCore/QThreadPool>
+
+#include <algorithm>
+#include <utility>
+
+namespace MCP {
+
+// The queue pointer of the controls, cleared when the queue is gone so
+// that work still running elsewhere posts nothing.
+struct JobMailbox {
+	QMutex mutex;
+	JobQueue *queue = nullptr;
+};
+
+namespace {
+
+constexpr auto kWorkerThreads = 2;
+constexpr auto kProgressInterval = 250; // ms between progress notifications
+constexpr auto kMaxFinishedJobs = 64;
+constexpr auto kFinishedLifetime = 60 * 60 * 1000; // ms
+constexpr auto kDefaultPageSize = 100;
+constexpr auto kMaxPageSize = 1000;
+
+[[nodiscard]] qint64 Now() {
+	return QDateTime::currentMSecsSinceEpoch();
+}
+
+[[nodiscard]] QString JobId(quint64 number) {
+	return QString("job_%1").arg(number);
+}
+
+[[nodiscard]] quint64 JobNumber(const QString &id) {
+	return id.startsWith("job_") ? id.mid(4).toULongLong() : 0;
+}
+
+[[nodiscard]] bool Finished(JobState state) {
+	return (state == JobState::Completed)
+		|| (state == JobState::Failed)
+		|| (state == JobState::Cancelled);
+}
+
+} // namespace
+
+QString JobStateName(JobState state) {
+	switch (state) {
+	case JobState::Queued: return "queued";
+	case JobState::Running: return "running";
+	case JobState::Completed: return "completed";
+	case JobState::Failed: return "failed";
+	case JobState::Cancelled: return "cancelled";
+	}
+	return QString();
+}
+
+JobControl::JobControl(std::shared_ptr<JobMailbox> mailbox, quint64 id)
+: _mailbox(std::move(mailbox))
+, _id(id) {
+}
+
+bool JobControl::cancelled() const {
+	return _cancelled.load(std::memory_order_relaxed);
+}
+
+void JobControl::progress(
+		qint64 done,
+		qint64 total,
+		const QString &message) {
+	const auto id = _id;
+	post([=](JobQueue *queue) {
+		queue->progressed(id, done, total, message);
+	});
+}
+
+void JobControl::checkpoint(const QJsonObject &state) {
+	const auto id = _id;
+	post([=](JobQueue *queue) {
+		queue->checkpointed(id, state);
+	});
+}
+
+void JobControl::finish(const QJsonObject &result) {
+	if (_finished.exchange(true)) {
+		return;
+	}
+	const auto id = _id;
+	post([=](JobQueue *queue) {
+		queue->finished(id, result, result.value("error").toString());
+	});
+}
+
+void JobControl::fail(const QString &error) {
+	if (_finished.exchange(true)) {
+		return;
+	}
+	const auto id = _id;
+	post([=](JobQueue *queue) {
+		queue->finished(id, QJsonObject(), error);
+	});
+}
+
+void JobControl::onCancel(std::function<void()> handler) {
+	_cancelHandler = std::move(handler);
+}
+
+void JobControl::post(std::function<void(JobQueue*)> handler) const {
+	QMutexLocker lock(&_mailbox->mutex);
+	if (const auto queue = _mailbox->queue) {
+		QMetaObject::invokeMethod(queue, [=] {
+			handler(queue);
+		}, Qt::QueuedConnection);
+	}
+}
+
+JobQueue::JobQueue(Notify notify, QObject *parent)
+: QObject(parent)
+, _notify(std::move(notify))
+, _mailbox(std::make_shared<JobMailbox>())
+, _pool(std::make_unique<QThreadPool>()) {
+	_mailbox->queue = this;
+	_pool->setMaxThreadCount(kWorkerThreads);
+	_pool->setObjectName("mcp_job_pool");
+
+	_progressTimer.setInterval(kProgressInterval);
+	connect(&_progressTimer, &QTimer::timeout, this, [=] {
+		sendPendingProgress();
+	});
+}
+
+JobQueue::~JobQueue() {
+	stop();
+	QMutexLocker lock(&_mailbox->mutex);
+	_mailbox->queue = nullptr;
+}
+
+QString JobQueue::start(
+		const QString &tool,
+		const QJsonObject &arguments,
+		const QJsonValue &progressToken,
+		Work work) {
+	auto &job = add(tool, arguments, progressToken);
+	const auto control = job.control;
+	_pool->start([=] {
+		if (control->cancelled()) {
+			control->finish(QJsonObject());
+			return;
+		}
+		const auto id = control->_id;
+		control->post([=](JobQueue *queue) {
+			queue->started(id);
+		});
+		control->finish(work(*control));
+	});
+	return JobId(control->_id);
+}
+
+QString JobQueue::startAsync(
+		const QString &tool,
+		const QJsonObject &arguments,
+		const QJsonValue &progressToken,
+		Start start) {
+	auto &job = add(tool, arguments, progressToken);
+	const auto control = job.control;
+	QMetaObject::invokeMethod(this, [=] {
+		if (control->cancelled()) {
+			control->finish(QJsonObject());
+			return;
+		}
+		started(control->_id);
+		start(control);
+	}, Qt::QueuedConnection);
+	return JobId(control->_id);
+}
+
+auto JobQueue::add(
+		const QString &tool,
+		const QJsonObject &arguments,
+		const QJsonValue &progressToken) -> Job & {
+	prune();
+	const auto number = ++_counter;
+	auto &job = _jobs[number];
+	job.tool = tool;
+	job.arguments = arguments;
+	job.progressToken = progressToken;
+	job.created = Now();
+	job.control = std::make_shared<JobControl>(_mailbox, number);
+	return job;
+}
+
+auto JobQueue::find(const QString &id) -> Job * {
+	const auto i = _jobs.find(JobNumber(id));
+	return (i != end(_jobs)) ? &i->second : nullptr;
+}
+
+auto JobQueue::find(const QString &id) const -> const Job * {
+	const auto i = _jobs.find(JobNumber(id));
+	return (i != end(_jobs)) ? &i->second : nullptr;
+}
+
+bool JobQueue::cancel(const QString &id) {
+	const auto job = find(id);
+	if (!job || Finished(job->state) || job->control->cancelled()) {
+		return false;
+	}
+	job->control->_cancelled = true;
+	if (const auto handler = std::exchange(
+			job->control->_cancelHandler,
+			nullptr)) {
+		handler();
+	}
+	return true;
+}
+
+void JobQueue::stop() {
+	for (auto &[number, job] : _jobs) {
+		if (!Finished(job.state)) {
+			cancel(JobId(number));
+		}
+	}
+	_pool->waitForDone();
+}
+
+void JobQueue::started(quint64 number) {
+	const auto i = _jobs.find(number);
+	if (i == end(_jobs) || i->second.state != JobState::Queued) {
+		return;
+	}
+	i->second.state = JobState::Running;
+	i->second.started = Now();
+}
+
+void JobQueue::progressed(
+		quint64 number,
+		qint64 done,
+		qint64 total,
+		const QString &message) {
+	const auto i = _jobs.find(number);
+	if (i == end(_jobs) || Finished(i->second.state)) {
+		return;
+	}
+	auto &job = i->second;
+	job.done = done;
+	job.total = total;
+	if (!message.isEmpty()) {
+		job.message = message;
+	}
+	if (job.progressToken.isNull() || job.progressToken.isUndefined()) {
+		return;
+	} else if (Now() - job.notified >= kProgressInterval) {
+		notifyProgress(number, job);
+	} else {
+		job.notifyPending = true;
+		if (!_progressTimer.isActive()) {
+			_progressTimer.start();
+		}
+	}
+}
+
+void JobQueue::checkpointed(quint64 number, const QJsonObject &state) {
+	const auto i = _jobs.find(number);
+	if (i != end(_jobs) && !Finished(i->second.state)) {
+		i->second.checkpoint = state;
+	}
+}
+
+void JobQueue::finished(
+		quint64 number,
+		const QJsonObject &result,
+		const QString &error) {
+	const auto i = _jobs.find(number);
+	if (i == end(_jobs) || Finished(i->second.state)) {
+		return;
+	}
+	auto &job = i->second;
+	job.state = job.control->cancelled()
+		? JobState::Cancelled
+		: error.isEmpty()
+		? JobState::Completed
+		: JobState::Failed;
+	job.result = result;
+	job.error = error;
+	job.finished = Now();
+	if (!job.started) {
+		job.started = job.finished;
+	}
+	if (job.state == JobState::Completed && job.total > 0) {
+		job.done = job.total;
+	}
+	job.message = JobStateName(job.state);
+	job.control->_cancelHandler = nullptr;
+	if (!job.progressToken.isNull() && !job.progressToken.isUndefined()) {
+		notifyProgress(number, job);
+	}
+}
+
+void JobQueue::notifyProgress(quint64 number, Job &job) {
+	job.notified = Now();
+	job.notifyPending = false;
+	if (!_notify) {
+		return;
+	}
+	auto params = QJsonObject{
+		{ "progressToken", job.progressToken },
+		{ "progress", double(job.done) },
+		{ "job_id", JobId(number) },
+		{ "state", JobStateName(job.state) },
+	};
+	if (job.total > 0) {
+		params["total"] = double(job.total);
+	}
+	if (!job.message.isEmpty()) {
+		params["message"] = job.message;
+	}
+	_notify("notifications/progress", params);
+}
+
+void JobQueue::sendPendingProgress() {
+	auto pending = false;
+	const auto now = Now();
+	for (auto &[number, job] : _jobs) {
+		if (!job.notifyPending) {
+			continue;
+		} else if (now - job.notified >= kProgressInterval) {
+			notifyProgress(number, job);
+		} else {
+			pending = true;
+		}
+	}
+	if (!pending) {
+		_progressTimer.stop();
+	}
+}
+
+void JobQueue::prune() {
+	const auto now = Now();
+	auto finished = 0;
+	for (const auto &[number, job] : _jobs) {
+		if (Finished(job.state)) {
+			++finished;
+		}
+	}
+	for (auto i = begin(_jobs); i != end(_jobs);) {
+		const auto &job = i->second;
+		if (Finished(job.state)
+			&& (finished > kMaxFinishedJobs
+				|| now - job.finished > kFinishedLifetime)) {
+			i = _jobs.erase(i);
+			--finished;
+		} else {
+			++i;
+		}
+	}
+}
+
+QJsonObject JobQueue::summary(quint64 number, const Job &job) const {
+	auto result = QJsonObject{
+		{ "job_id", JobId(number) },
+		{ "tool", job.tool },
+		{ "state", JobStateName(job.state) },
+		{ "progress", job.done },
+		{ "total", job.total },
+		{ "created_at", job.created / 1000 },
+	};
+	if (!job.message.isEmpty()) {
+		result["message"] = job.message;
+	}
+	if (job.started) {
+		result["started_at"] = job.started / 1000;
+	}
+	if (job.finished) {
+		result["finished_at"] = job.finished / 1000;
+		result["duration_ms"] = job.finished - job.started;
+	}
+	if (!job.error.isEmpty()) {
+		result["error"] = job.error;
+	}
+	if (job.control->cancelled() && !Finished(job.state)) {
+		result["cancelling"] = true;
+	}
+	return result;
+}
+
+std::optional<QJsonObject> JobQueue::describe(
+		const QString &id,
+		int offset,
+		int limit) const {
+	const auto job = find(id);
+	if (!job) {
+		return std::nullopt;
+	}
+	auto result = summary(JobNumber(id), *job);
+	result["arguments"] = job->arguments;
+	if (!job->checkpoint.isEmpty()) {
+		result["checkpoint"] = job->checkpoint;
+	}
+	if (!Finished(job->state)) {
+		return result;
+	}
+
+	// Only the first array is paged, like "topics" or "messages".
+	auto stored = job->result;
+	const auto key = [&] {
+		for (auto i = stored.begin(); i != stored.end(); ++i) {
+			if (i->isArray()) {
+				return i.key();
+			}
+		}
+		return QString();
+	}();
+	if (!key.isEmpty()) {
+		const auto list = stored.value(key).toArray();
+		const auto size = int(list.size());
+		const auto from = std::clamp(offset, 0, size);
+		const auto count = std::clamp(
+			(limit > 0) ? limit : kDefaultPageSize,
+			1,
+			kMaxPageSize);
+		const auto till = std::min(from + count, size);
+		auto page = QJsonArray();
+		for (auto i = from; i != till; ++i) {
+			page.append(list[i]);
+		}
+		stored[key] = page;
+		auto paging = QJsonObject{
+			{ "key", key },
+			{ "offset", from },
+			{ "count", till - from },
+			{ "total", size },
+		};
+		if (till < size) {
+			paging["next_offset"] = till;
+		}
+		result["page"] = paging;
+	}
+	result["result"] = stored;
+	return result;
+}
+
+QJsonArray JobQueue::list() const {
+	auto result = QJsonArray();
+	for (const auto &[number, job] : _jobs) {
+		result.append(summary(number, job));
+	}
+	return result;
+}
+
+} // namespace MCP
@@ -0,0 +1,170 @@
+// MCP Job Queue - long tool calls as background jobs
+//
+// This file is part of Telegram Desktop MCP integration.
+// start_job answers with a job id at once. The work runs on the queue
+// threads or is driven by a component, reports progress and checks for
+// cancellation between its steps. get_job reads the state and pages
+// through the stored result.
+
+#pragma once
+
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonObject>
+#include <QtCore/QJsonValue>
+#include <QtCore/QObject>
+#include <QtCore/QTimer>
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+
+class QThreadPool;
+
+namespace MCP {
+
+class JobQueue;
+struct JobMailbox;
+
+enum class JobState {
+	Queued,
+	Running,
+	Completed,
+	Failed,
+	Cancelled,
+};
+
+[[nodiscard]] QString JobStateName(JobState state);
+
+// Handed to the work of one job, may be used from any thread.
+class JobControl final {
+public:
+	JobControl(std::shared_ptr<JobMailbox> mailbox, quint64 id);
+
+	[[nodiscard]] bool cancelled() const;
+
+	// total is 0 while not known.
+	void progress(qint64 done, qint64 total, const QString &message = {});
+	// Where the work is, e.g. the cursor to resume a cancelled export.
+	void checkpoint(const QJsonObject &state);
+
+	// The first of them ends the job, later calls are ignored.
+	void finish(const QJsonObject &result);
+	void fail(const QString &error);
+
+	// Main thread only, called once when the job is cancelled.
+	void onCancel(std::function<void()> handler);
+
+private:
+	friend class JobQueue;
+
+	void post(std::function<void(JobQueue*)> handler) const;
+
+	const std::shared_ptr<JobMailbox> _mailbox;
+	const quint64 _id = 0;
+	std::atomic<bool> _cancelled = false;
+	std::atomic<bool> _finished = false;
+	std::function<void()> _cancelHandler;
+
+};
+
+class JobQueue : public QObject {
+	Q_OBJECT
+
+public:
+	using Work = std::function<QJsonObject(JobControl &control)>;
+	using Start = std::function<void(std::shared_ptr<JobControl> control)>;
+	using Notify = std::function<void(
+		const QString &method,
+		const QJsonObject &params)>;
+
+	explicit JobQueue(Notify notify, QObject *parent = nullptr);
+	~JobQueue();
+
+	// Runs the work on the queue threads, its result finishes the job.
+	// A result with an "error" fails it, the result is kept anyway.
+	QString start(
+		const QString &tool,
+		const QJsonObject &arguments,
+		const QJsonValue &progressToken,
+		Work work);
+	// Calls start from the main thread event loop, the job ends with
+	// JobControl::finish() or fail().
+	QString startAsync(
+		const QString &tool,
+		const QJsonObject &arguments,
+		const QJsonValue &progressToken,
+		Start start);
+
+	// Cancellation is cooperative, running work sees cancelled() and
+	// whatever it returns is kept as a partial result.
+	bool cancel(const QString &id);
+
+	// The first array of the result is returned from offset, at most
+	// limit elements of it.
+	[[nodiscard]] std::optional<QJsonObject> describe(
+		const QString &id,
+		int offset,
+		int limit) const;
+	[[nodiscard]] QJsonArray list() const;
+
+	// Cancels every job and waits for the queue threads. New jobs may be
+	// started afterwards.
+	void stop();
+
+private:
+	friend class JobControl;
+
+	struct Job {
+		QString tool;
+		QJsonObject arguments;
+		QJsonValue progressToken;
+		JobState state = JobState::Queued;
+		qint64 done = 0;
+		qint64 total = 0;
+		QString message;
+		QJsonObject checkpoint;
+		QJsonObject result;
+		QString error;
+		qint64 created = 0;
+		qint64 started = 0;
+		qint64 finished = 0;
+		qint64 notified = 0;
+		bool notifyPending = false;
+		std::shared_ptr<JobControl> control;
+	};
+
+	Job &add(
+		const QString &tool,
+		const QJsonObject &arguments,
+		const QJsonValue &progressToken);
+	[[nodiscard]] Job *find(const QString &id);
+	[[nodiscard]] const Job *find(const QString &id) const;
+	[[nodiscard]] QJsonObject summary(quint64 number, const Job &job) const;
+
+	void started(quint64 number);
+	void progressed(
+		quint64 number,
+		qint64 done,
+		qint64 total,
+		const QString &message);
+	void checkpointed(quint64 number, const QJsonObject &state);
+	void finished(
+		quint64 number,
+		const QJsonObject &result,
+		const QString &error);
+	void notifyProgress(quint64 number, Job &job);
+	void sendPendingProgress();
+	void prune();
+
+	const Notify _notify;
+	const std::shared_ptr<JobMailbox> _mailbox;
+	std::unique_ptr<QThreadPool> _pool;
+	std::map<quint64, Job> _jobs; // Oldest first.
+	quint64 _counter = 0;
+	QTimer _progressTimer;
+
+};
+
+} // namespace MCP
@@ -0,0 +1,153 @@
+// MCP JSON Stream Writer - Incremental JSON serialization implementation
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "json_stream_writer.h"
+
+#include <QtCore/QFileDevice>
+#include <QtCore/QIODevice>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+
+namespace MCP {
+namespace {
+
+QByteArray SerializeValue(const QJsonValue &value) {
+	if (value.isObject()) {
+		return QJsonDocument(value.toObject()).toJson(QJsonDocument::Compact);
+	} else if (value.isArray()) {
+		return QJsonDocument(value.toArray()).toJson(QJsonDocument::Compact);
+	}
+	// Scalars: serialize inside a one-element array and strip brackets.
+	const auto wrapped = QJsonDocument(QJsonArray{ value }).toJson(
+		QJsonDocument::Compact);
+	return wrapped.mid(1, wrapped.size() - 2);
+}
+
+} // namespace
+
+JsonStreamWriter::JsonStreamWriter(QIODevice *device, int flushThreshold)
+	: _device(device)
+	, _flushThreshold(flushThreshold) {
+	_buffer.reserve(flushThreshold + 1024);
+}
+
+JsonStreamWriter::~JsonStreamWriter() {
+	flush();
+}
+
+void JsonStreamWriter::prefix() {
+	if (_afterKey) {
+		_afterKey = false;
+		return;
+	}
+	if (!_first.empty()) {
+		if (!_first.back()) {
+			write(",");
+		}
+		_first.back() = false;
+	}
+}
+
+void JsonStreamWriter::beginObject() {
+	prefix();
+	write("{");
+	_first.push_back(true);
+}
+
+void JsonStreamWriter::endObject() {
+	_first.pop_back();
+	write("}");
+}
+
+void JsonStreamWriter::beginArray() {
+	prefix();
+	write("[");
+	_first.push_back(true);
+}
+
+void JsonStreamWriter::endArray() {
+	_first.pop_back();
+	write("]");
+}
+
+void JsonStreamWriter::key(const QString &name) {
+	prefix();
+	write(SerializeValue(name));
+	write(":");
+	_afterKey = true;
+}
+
+void JsonStreamWriter::value(const QJsonValue &value) {
+	prefix();
+	write(SerializeValue(value));
+}
+
+void JsonStreamWriter::rawValue(const QByteArray &json) {
+	prefix();
+	write(json);
+}
+
+void JsonStreamWriter::beginEmbeddedString() {
+	prefix();
+	writeUnescaped("\"");
+	_embedded = true;
+	// The embedded document starts a fresh nesting context.
+	_first.push_back(true);
+}
+
+void JsonStreamWriter::endEmbeddedString() {
+	_first.pop_back();
+	_embedded = false;
+	writeUnescaped("\"");
+}
+
+void JsonStreamWriter::write(const QByteArray &data) {
+	if (!_embedded) {
+		writeUnescaped(data);
+		return;
+	}
+	for (const auto ch : data) {
+		const auto byte = static_cast<unsigned char>(ch);
+		switch (ch) {
+		case '"': _buffer.append("\\\""); break;
+		case '\\': _buffer.append("\\\\"); break;
+		case '\n': _buffer.append("\\n"); break;
+		case '\r': _buffer.append("\\r"); break;
+		case '\t': _buffer.append("\\t"); break;
+		default:
+			if (byte < 0x20) {
+				_buffer.append("\\u00");
+				_buffer.append("0123456789abcdef"[byte >> 4]);
+				_buffer.append("0123456789abcdef"[byte & 0x0F]);
+			} else {
+				_buffer.append(ch);
+			}
+		}
+	}
+	if (_buffer.size() >= _flushThreshold) {
+		flush();
+	}
+}
+
+void JsonStreamWriter::writeUnescaped(const QByteArray &data) {
+	_buffer.append(data);
+	if (_buffer.size() >= _flushThreshold) {
+		flush();
+	}
+}
+
+void JsonStreamWriter::flush() {
+	if (_buffer.isEmpty() || !_device) {
+		return;
+	}
+	_written += _device->write(_buffer);
+	_buffer.clear();
+	if (const auto file = qobject_cast<QFileDevice*>(_device)) {
+		// Push through to the pipe so the client sees bytes early.
+		file->flush();
+	}
+}
+
+} // namespace MCP
@@ -0,0 +1,67 @@
+// MCP JSON Stream Writer - Incremental JSON serialization
+//
+// This file is part of Telegram Desktop MCP integration.
+// Lets large tool results be written element by element straight to a
+// transport device instead of building and serializing a full tree.
+
+#pragma once
+
+#include <QtCore/QByteArray>
+#include <QtCore/QJsonValue>
+#include <QtCore/QString>
+
+#include <vector>
+
+class QIODevice;
+
+namespace MCP {
+
+class JsonStreamWriter {
+public:
+	explicit JsonStreamWriter(
+		QIODevice *device,
+		int flushThreshold = 64 * 1024);
+	~JsonStreamWriter();
+
+	JsonStreamWriter(const JsonStreamWriter &) = delete;
+	JsonStreamWriter &operator=(const JsonStreamWriter &) = delete;
+
+	void beginObject();
+	void endObject();
+	void beginArray();
+	void endArray();
+
+	// Object member name, must be followed by exactly one value
+	void key(const QString &name);
+
+	// Scalar, object or array value (objects are serialized compactly)
+	void value(const QJsonValue &value);
+
+	// Everything written between these calls is emitted as the contents
+	// of a single JSON string literal, escaped on the fly. Used for the
+	// MCP tools/call "text" content which carries serialized JSON.
+	void beginEmbeddedString();
+	void endEmbeddedString();
+
+	// Pre-serialized JSON token, written as a value
+	void rawValue(const QByteArray &json);
+
+	void flush();
+
+	[[nodiscard]] qint64 bytesWritten() const { return _written; }
+
+private:
+	void prefix();
+	void write(const QByteArray &data);
+	void writeUnescaped(const QByteArray &data);
+
+	QIODevice *_device = nullptr;
+	QByteArray _buffer;
+	int _flushThreshold = 0;
+	qint64 _written = 0;
+	std::vector<bool> _first; // Per nesting level, no element written yet.
+	bool _afterKey = false;
+	bool _embedded = false;
+};
+
+} // namespace MCP
@@ -0,0 +1,131 @@
+// MCP Keyword Matcher - Aho-Corasick automaton over many keywords
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "keyword_matcher.h"
+
+#include <algorithm>
+
+namespace MCP {
+namespace {
+
+[[nodiscard]] char16_t Fold(QChar ch) {
+	return ch.toCaseFolded().unicode();
+}
+
+} // namespace
+
+int KeywordMatcher::add(const QString &keyword) {
+	if (keyword.isEmpty()) {
+		return -1;
+	}
+	auto folded = QString();
+	folded.reserve(keyword.size());
+	for (const auto ch : keyword) {
+		folded.append(QChar(Fold(ch)));
+	}
+	const auto i = _ids.constFind(folded);
+	if (i != _ids.cend()) {
+		return *i;
+	}
+
+	auto state = 0;
+	for (const auto ch : folded) {
+		const auto code = ch.unicode();
+		auto &next = _nodes[state].next;
+		const auto j = std::lower_bound(
+			begin(next),
+			end(next),
+			code,
+			[](const auto &edge, char16_t value) { return edge.first < value; });
+		if (j != end(next) && j->first == code) {
+			state = j->second;
+		} else {
+			const auto created = int(_nodes.size());
+			next.insert(j, { code, created });
+			_nodes.emplace_back();
+			state = created;
+		}
+	}
+	const auto id = int(_lengths.size());
+	_nodes[state].pattern = id;
+	_lengths.push_back(int(folded.size()));
+	_ids.insert(folded, id);
+	_built = false;
+	return id;
+}
+
+void KeywordMatcher::build() {
+	if (_built) {
+		return;
+	}
+	_built = true;
+
+	// Breadth first, so fail links always point to finished nodes.
+	auto queue = std::vector<int>();
+	queue.reserve(_nodes.size());
+	for (const auto &[ch, child] : _nodes[0].next) {
+		_nodes[child].fail = 0;
+		_nodes[child].output = -1;
+		queue.push_back(child);
+	}
+	for (auto i = 0; i != int(queue.size()); ++i) {
+		const auto state = queue[i];
+		for (const auto &[ch, child] : _nodes[state].next) {
+			const auto fail = step(_nodes[state].fail, ch);
+			auto &node = _nodes[child];
+			node.fail = fail;
+			node.output = (_nodes[fail].pattern >= 0)
+				? fail
+				: _nodes[fail].output;
+			queue.push_back(child);
+		}
+	}
+}
+
+int KeywordMatcher::Child(const Node &node, char16_t ch) {
+	const auto i = std::lower_bound(
+		begin(node.next),
+		end(node.next),
+		ch,
+		[](const auto &edge, char16_t value) { return edge.first < value; });
+	return (i != end(node.next) && i->first == ch) ? i->second : -1;
+}
+
+int KeywordMatcher::step(int state, char16_t ch) const {
+	while (true) {
+		const auto child = Child(_nodes[state], ch);
+		if (child >= 0) {
+			return child;
+		} else if (!state) {
+			return 0;
+		}
+		state = _nodes[state].fail;
+	}
+}
+
+std::vector<KeywordMatcher::Match> KeywordMatcher::find(
+		const QString &text) const {
+	auto result = std::vector<Match>();
+	if (!_built || empty()) {
+		return result;
+	}
+	auto seen = std::vector<bool>(_lengths.size(), false);
+	auto state = 0;
+	for (auto i = 0; i != int(text.size()); ++i) {
+		state = step(state, Fold(text[i]));
+		auto found = (_nodes[state].pattern >= 0)
+			? state
+			: _nodes[state].output;
+		for (; found >= 0; found = _nodes[found].output) {
+			const auto pattern = _nodes[found].pattern;
+			if (!seen[pattern]) {
+				seen[pattern] = true;
+				result.push_back({ pattern, i + 1 - _lengths[pattern] });
+			}
+		}
+	}
+	return result;
+}
+
+} // namespace MCP
@@ -0,0 +1,55 @@
+// MCP Keyword Matcher - Aho-Corasick automaton over many keywords
+//
+// This file is part of Telegram Desktop MCP integration.
+// All keywords are folded into one automaton, so a text is scanned once
+// however many keywords there are. Matching is case-insensitive by
+// simple case folding and works on UTF-16 code units. The matcher is
+// immutable once built and can be shared by reader threads.
+
+#pragma once
+
+#include <QtCore/QHash>
+#include <QtCore/QString>
+
+#include <vector>
+
+namespace MCP {
+
+class KeywordMatcher final {
+public:
+	struct Match {
+		int pattern = 0;
+		int start = 0; // Of the first occurrence in the text.
+	};
+
+	// Returns the pattern id, the same one for a repeated keyword.
+	// Empty keywords never match and get -1.
+	int add(const QString &keyword);
+	void build();
+
+	[[nodiscard]] int size() const { return int(_lengths.size()); }
+	[[nodiscard]] bool empty() const { return _lengths.empty(); }
+
+	// Every pattern found in the text once, in the order of their ends.
+	// Nothing is found until build() follows the last add().
+	[[nodiscard]] std::vector<Match> find(const QString &text) const;
+
+private:
+	struct Node {
+		std::vector<std::pair<char16_t, int>> next; // Sorted by char.
+		int fail = 0;
+		int output = -1; // Nearest node by fail links that ends a pattern.
+		int pattern = -1;
+	};
+
+	[[nodiscard]] int step(int state, char16_t ch) const;
+	[[nodiscard]] static int Child(const Node &node, char16_t ch);
+
+	std::vector<Node> _nodes = std::vector<Node>(1);
+	std::vector<int> _lengths;
+	QHash<QString, int> _ids;
+	bool _built = true;
+
+};
+
+} // namespace MCP
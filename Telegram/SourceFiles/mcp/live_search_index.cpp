@@ -0,0 +1,228 @@
+// MCP Live Search Index - Token index over loaded history messages
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "live_search_index.h"
+
+#include "mcp_helpers.h"
+#include "data/data_changes.h"
+#include "data/data_peer.h"
+#include "data/data_session.h"
+#include "history/history.h"
+#include "history/history_item.h"
+#include "history/view/history_view_element.h"
+#include "main/main_session.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace MCP {
+namespace {
+
+constexpr auto kMaxIndexedHistories = 64;
+
+[[nodiscard]] std::vector<QString> Tokens(const QString &text) {
+	auto result = std::vector<QString>();
+	auto current = QString();
+	const auto flush = [&] {
+		if (!current.isEmpty()) {
+			result.push_back(std::move(current));
+			current = QString();
+		}
+	};
+	for (const auto ch : text) {
+		if (IsUnsegmentedScript(ch)) {
+			flush();
+			result.push_back(QString(ch.toLower()));
+		} else if (ch.isLetterOrNumber()) {
+			current.append(ch.toLower());
+		} else {
+			flush();
+		}
+	}
+	flush();
+	std::sort(result.begin(), result.end());
+	result.erase(std::unique(result.begin(), result.end()), result.end());
+	return result;
+}
+
+} // namespace
+
+LiveSearchIndex::LiveSearchIndex(not_null<Data::Session*> owner)
+: _owner(owner) {
+	const auto indexed = [=](not_null<const HistoryItem*> item) {
+		const auto i = _histories.find(item->history()->peer->id);
+		return (i != end(_histories)) ? &i->second : nullptr;
+	};
+
+	// Local ids change once the message is sent, sync() picks those up
+	// under their server id.
+	_owner->newItemAdded(
+	) | rpl::start_with_next([=](not_null<HistoryItem*> item) {
+		if (const auto index = indexed(item); index && item->isRegular()) {
+			add(*index, item);
+		}
+	}, _lifetime);
+
+	_owner->session().changes().messageUpdates(
+		Data::MessageUpdate::Flag::Edited
+	) | rpl::start_with_next([=](const Data::MessageUpdate &update) {
+		if (const auto index = indexed(update.item)) {
+			remove(*index, update.item->id);
+			add(*index, update.item);
+		}
+	}, _lifetime);
+
+	_owner->itemRemoved(
+	) | rpl::start_with_next([=](not_null<const HistoryItem*> item) {
+		if (const auto index = indexed(item)) {
+			remove(*index, item->id);
+		}
+	}, _lifetime);
+}
+
+std::vector<not_null<HistoryItem*>> LiveSearchIndex::search(
+		not_null<History*> history,
+		const QString &query,
+		int limit) {
+	const auto terms = Tokens(query);
+	if (terms.empty() || limit <= 0) {
+		return {};
+	}
+	auto &index = indexFor(history);
+
+	// Every term matches the tokens it is a prefix of.
+	auto lists = std::vector<std::vector<MsgId>>();
+	lists.reserve(terms.size());
+	for (const auto &term : terms) {
+		auto ids = std::vector<MsgId>();
+		const auto till = end(index.postings);
+		for (auto i = index.postings.lower_bound(term); i != till; ++i) {
+			if (!i->first.startsWith(term)) {
+				break;
+			}
+			ids.insert(end(ids), begin(i->second), end(i->second));
+		}
+		if (ids.empty()) {
+			return {};
+		}
+		std::sort(begin(ids), end(ids));
+		ids.erase(std::unique(begin(ids), end(ids)), end(ids));
+		lists.push_back(std::move(ids));
+	}
+	std::sort(begin(lists), end(lists), [](const auto &a, const auto &b) {
+		return a.size() < b.size();
+	});
+	auto candidates = std::move(lists.front());
+	for (auto i = 1; i < int(lists.size()) && !candidates.empty(); ++i) {
+		auto both = std::vector<MsgId>();
+		std::set_intersection(
+			begin(candidates),
+			end(candidates),
+			begin(lists[i]),
+			end(lists[i]),
+			std::back_inserter(both));
+		candidates = std::move(both);
+	}
+
+	// Tokens only narrow it down, the text check keeps the old substring
+	// semantics for punctuation and word order.
+	const auto lower = query.toLower();
+	const auto peerId = history->peer->id;
+	auto result = std::vector<not_null<HistoryItem*>>();
+	auto stale = std::vector<MsgId>();
+	for (auto i = rbegin(candidates); i != rend(candidates); ++i) {
+		const auto item = _owner->message(peerId, *i);
+		if (!item) {
+			stale.push_back(*i);
+		} else if (item->originalText().text.toLower().contains(lower)) {
+			result.push_back(item);
+			if (int(result.size()) == limit) {
+				break;
+			}
+		}
+	}
+	for (const auto id : stale) {
+		remove(index, id);
+	}
+	return result;
+}
+
+LiveSearchIndex::Index &LiveSearchIndex::indexFor(
+		not_null<History*> history) {
+	auto &result = _histories[history->peer->id];
+	result.used = ++_searches;
+	sync(history, result);
+	if (int(_histories.size()) > kMaxIndexedHistories) {
+		trim();
+	}
+	return result;
+}
+
+void LiveSearchIndex::sync(not_null<History*> history, Index &index) {
+	// History holds one contiguous slice of messages: new ones come in at
+	// the back, older pages at the front. Both walks stop at the first
+	// item indexed before, so a search only pays for what was loaded
+	// since the previous one.
+	[&] {
+		for (auto b = history->blocks.rbegin(); b != history->blocks.rend(); ++b) {
+			const auto &messages = (*b)->messages;
+			for (auto m = messages.rbegin(); m != messages.rend(); ++m) {
+				if (!add(index, (*m)->data())) {
+					return;
+				}
+			}
+		}
+	}();
+	for (const auto &block : history->blocks) {
+		for (const auto &view : block->messages) {
+			if (!add(index, view->data())) {
+				return;
+			}
+		}
+	}
+}
+
+void LiveSearchIndex::trim() {
+	// Drops the least recently searched one, it is rebuilt on demand.
+	const auto oldest = std::min_element(
+		begin(_histories),
+		end(_histories),
+		[](const auto &a, const auto &b) {
+			return a.second.used < b.second.used;
+		});
+	_histories.erase(oldest);
+}
+
+bool LiveSearchIndex::add(Index &index, not_null<const HistoryItem*> item) {
+	const auto [i, inserted] = index.tokens.emplace(
+		item->id,
+		std::vector<QString>());
+	if (!inserted) {
+		return false;
+	}
+	i->second = Tokens(item->originalText().text);
+	for (const auto &token : i->second) {
+		index.postings[token].emplace(item->id);
+	}
+	return true;
+}
+
+void LiveSearchIndex::remove(Index &index, MsgId id) {
+	const auto i = index.tokens.find(id);
+	if (i == end(index.tokens)) {
+		return;
+	}
+	for (const auto &token : i->second) {
+		const auto posting = index.postings.find(token);
+		if (posting != end(index.postings)) {
+			posting->second.remove(id);
+			if (posting->second.empty()) {
+				index.postings.erase(posting);
+			}
+		}
+	}
+	index.tokens.erase(i);
+}
+
+} // namespace MCP
@@ -0,0 +1,62 @@
+// MCP Live Search Index - Token index over loaded history messages
+//
+// This file is part of Telegram Desktop MCP integration.
+// A history gets its inverted index on the first search in it and keeps
+// it while the session adds, edits and removes its messages. Tokens are
+// lowercase letter / digit runs, CJK and Thai characters one per token,
+// query terms match them by prefix.
+
+#pragma once
+
+#include "base/flat_set.h"
+#include "data/data_msg_id.h"
+#include "data/data_peer_id.h"
+
+#include <QtCore/QString>
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+class History;
+class HistoryItem;
+
+namespace Data {
+class Session;
+} // namespace Data
+
+namespace MCP {
+
+class LiveSearchIndex final {
+public:
+	explicit LiveSearchIndex(not_null<Data::Session*> owner);
+
+	// Newest first, at most limit items whose text contains the query.
+	[[nodiscard]] std::vector<not_null<HistoryItem*>> search(
+		not_null<History*> history,
+		const QString &query,
+		int limit);
+
+private:
+	struct Index {
+		std::map<QString, base::flat_set<MsgId>> postings;
+		std::unordered_map<MsgId, std::vector<QString>> tokens;
+		quint64 used = 0;
+	};
+
+	[[nodiscard]] Index &indexFor(not_null<History*> history);
+	void sync(not_null<History*> history, Index &index);
+	void trim();
+
+	bool add(Index &index, not_null<const HistoryItem*> item);
+	void remove(Index &index, MsgId id);
+
+	const not_null<Data::Session*> _owner;
+	std::unordered_map<PeerId, Index> _histories;
+	quint64 _searches = 0;
+
+	rpl::lifetime _lifetime;
+
+};
+
+} // namespace MCP
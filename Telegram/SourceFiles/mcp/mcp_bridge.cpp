@@ -8,13 +8,24 @@
 
 #include "mcp_bridge.h"
 #include "mcp_server.h"
+#include "payload_ring.h"
 
+#include <QtCore/QCoreApplication>
 #include <QtCore/QJsonArray>
 #include <QtCore/QJsonValue>
 #include <QtCore/QFile>
 #include <QtCore/QDebug>
 
+#include <algorithm>
+
 namespace MCP {
+namespace {
+
+constexpr auto kDefaultShmThreshold = qint64(1024 * 1024);
+constexpr auto kDefaultShmSegments = 4;
+constexpr auto kMaxShmSegments = 16;
+
+} // namespace
 
 Bridge::Bridge(QObject *parent)
 	: QObject(parent)
@@ -52,6 +63,7 @@ bool Bridge::start(const QString &socketPath) {
 void Bridge::stop() {
 	if (_server->isListening()) {
 		_server->close();
+		_payloadRings.clear();
 		QFile::remove(_socketPath);
 		qInfo() << "MCP Bridge: Server stopped";
 	}
@@ -86,14 +98,68 @@ void Bridge::onReadyRead() {
 		return;
 	}
 
-	// Read all available data
-	QByteArray data = socket->readAll();
+	// Data may arrive split or coalesced, only complete messages are
+	// handled and the rest waits for the next chunk.
+	auto &buffer = _buffers[socket];
+	buffer.append(socket->readAll());
+	auto from = qsizetype(0);
+	while (from < buffer.size()) {
+		if (LooksLikeCbor(buffer[from])) {
+			const auto decoded = DecodeCborMessage(QByteArray::fromRawData(
+				buffer.constData() + from,
+				buffer.size() - from));
+			if (!decoded.error.isEmpty()) {
+				qWarning() << "MCP Bridge: CBOR parse error:" << decoded.error;
+				writeResponse(socket, QJsonObject{
+					{"id", QJsonValue::Null},
+					{"error", QJsonObject{
+						{"code", -32700},
+						{"message", "Parse error"}
+					}}
+				}, WireEncoding::Cbor);
+				from = buffer.size();
+				break;
+			} else if (!decoded.complete) {
+				break;
+			}
+			from += decoded.consumed;
+			processRequest(
+				socket,
+				decoded.value.toObject(),
+				WireEncoding::Cbor);
+			continue;
+		}
+		const auto till = buffer.indexOf('\n', from);
+		if (till < 0) {
+			break;
+		}
+		const auto line = buffer.mid(from, till - from).trimmed();
+		from = till + 1;
+		if (!line.isEmpty()) {
+			processLine(socket, line);
+		}
+	}
+	buffer.remove(0, from);
+
+	// Older clients send a single request without a trailing newline.
+	const auto rest = buffer.trimmed();
+	if (rest.startsWith('{') && rest.endsWith('}')) {
+		QJsonParseError error;
+		QJsonDocument::fromJson(rest, &error);
+		if (error.error == QJsonParseError::NoError) {
+			buffer.clear();
+			processLine(socket, rest);
+		}
+	}
+	socket->flush();
+}
 
+void Bridge::processLine(QLocalSocket *socket, const QByteArray &line) {
 	// Parse JSON-RPC request
 	QJsonParseError parseError;
-	QJsonDocument doc = QJsonDocument::fromJson(data, &parseError);
+	QJsonDocument doc = QJsonDocument::fromJson(line, &parseError);
 
-	if (parseError.error != QJsonParseError::NoError) {
+	if (parseError.error != QJsonParseError::NoError || !doc.isObject()) {
 		qWarning() << "MCP Bridge: JSON parse error:" << parseError.errorString();
 
 		// Send error response
@@ -103,28 +169,127 @@ void Bridge::onReadyRead() {
 			{"code", -32700},
 			{"message", "Parse error"}
 		};
-
-		socket->write(QJsonDocument(error).toJson(QJsonDocument::Compact));
-		socket->write("\n");
-		socket->flush();
+		writeResponse(socket, error);
 		return;
 	}
 
-	QJsonObject request = doc.object();
+	processRequest(socket, doc.object(), WireEncoding::Json);
+}
+
+void Bridge::processRequest(
+		QLocalSocket *socket,
+		const QJsonObject &request,
+		WireEncoding encoding) {
 	qDebug() << "MCP Bridge: Request:" << request;
 
+	// Never answered through the ring, the client must be able to read
+	// them to know about the ring at all.
+	const auto method = request["method"].toString();
+	if (method == "bridge/open_shm" || method == "bridge/release_shm") {
+		writeEncoded(
+			socket,
+			EncodeMessage(handleSharedMemory(socket, request), encoding),
+			encoding);
+		return;
+	}
+
+	// Thread-safe tools complete later on the server's worker pool while
+	// further requests from this connection keep being processed.
+	const auto params = request["params"].toObject();
+	if (_mcpServer
+		&& request["method"].toString() == "tools/call"
+		&& _mcpServer->isThreadSafeTool(params["name"].toString())) {
+		const auto weak = QPointer<QLocalSocket>(socket);
+		_mcpServer->dispatchRequest(request, [=](QJsonObject response) {
+			if (const auto strong = weak.data()) {
+				writeResponse(strong, response, encoding);
+				strong->flush();
+			}
+		});
+		return;
+	}
+
 	// Handle command
-	QJsonObject response = handleCommand(request);
+	writeResponse(socket, handleCommand(request), encoding);
+}
 
-	// Send response
-	socket->write(QJsonDocument(response).toJson(QJsonDocument::Compact));
-	socket->write("\n");
-	socket->flush();
+void Bridge::writeResponse(
+		QLocalSocket *socket,
+		const QJsonObject &response,
+		WireEncoding encoding) {
+	auto message = EncodeMessage(response, encoding);
+	const auto i = _payloadRings.find(socket);
+	if (i != end(_payloadRings) && message.size() >= i->second->threshold()) {
+		// With every segment still held the response uses the socket.
+		if (auto descriptor = i->second->put(message)) {
+			(*descriptor)["encoding"] = (encoding == WireEncoding::Cbor)
+				? "cbor"
+				: "json";
+			message = EncodeMessage(QJsonObject{
+				{"id", response["id"]},
+				{"shm", *descriptor},
+			}, encoding);
+		}
+	}
+	writeEncoded(socket, message, encoding);
+}
+
+void Bridge::writeEncoded(
+		QLocalSocket *socket,
+		const QByteArray &message,
+		WireEncoding encoding) {
+	socket->write(message);
+	if (encoding == WireEncoding::Json) {
+		socket->write("\n");
+	}
+}
+
+QJsonObject Bridge::handleSharedMemory(
+		QLocalSocket *socket,
+		const QJsonObject &request) {
+	const auto params = request["params"].toObject();
+	auto response = QJsonObject{ {"id", request["id"]} };
+	if (request["method"].toString() == "bridge/open_shm") {
+		// Opening again drops the previous ring with its segments.
+		_payloadRings.erase(socket);
+		const auto threshold = params.contains("threshold")
+			? std::max(params["threshold"].toVariant().toLongLong(), 0LL)
+			: kDefaultShmThreshold;
+		const auto segments = std::clamp(
+			params["segments"].toInt(kDefaultShmSegments),
+			1,
+			kMaxShmSegments);
+		const auto prefix = QString("tdesktop_mcp_%1_%2_").arg(
+			QCoreApplication::applicationPid()
+		).arg(++_payloadRingCounter);
+		auto ring = std::make_unique<PayloadRing>(
+			PayloadRing::DefaultDirectory(),
+			prefix,
+			segments,
+			threshold);
+		response["result"] = ring->describe();
+		_payloadRings.emplace(socket, std::move(ring));
+		return response;
+	}
+	const auto i = _payloadRings.find(socket);
+	if (i == end(_payloadRings)) {
+		response["error"] = QJsonObject{
+			{"code", -32600},
+			{"message", "Shared memory channel is not open"}
+		};
+		return response;
+	}
+	response["result"] = QJsonObject{
+		{"released", i->second->release(params["segment"].toInt(-1))},
+	};
+	return response;
 }
 
 void Bridge::onDisconnected() {
 	QLocalSocket *socket = qobject_cast<QLocalSocket*>(sender());
 	if (socket) {
+		_buffers.remove(socket);
+		_payloadRings.erase(socket);
 		socket->deleteLater();
 		qDebug() << "MCP Bridge: Connection closed";
 	}
@@ -216,7 +381,9 @@ QJsonObject Bridge::handlePing(const QJsonObject &params) {
 		"local_database",
 		"voice_transcription",
 		"semantic_search",
-		"media_processing"
+		"media_processing",
+		"cbor_encoding",
+		"shm_channel"
 	};
 
 	return result;
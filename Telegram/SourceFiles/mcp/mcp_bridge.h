@@ -14,10 +14,18 @@
 #include <QtNetwork/QLocalSocket>
 #include <QtCore/QJsonDocument>
 #include <QtCore/QJsonObject>
+#include <QtCore/QHash>
+#include <QtCore/QPointer>
+
+#include "wire_encoding.h"
+
+#include <map>
+#include <memory>
 
 namespace MCP {
 
 class Server;  // Forward declaration
+class PayloadRing;
 
 class Bridge : public QObject {
 	Q_OBJECT
@@ -44,6 +52,30 @@ private Q_SLOTS:
 	void onDisconnected();
 
 private:
+	// Newline-delimited JSON lines or self-delimiting CBOR items, each
+	// is one request. Several may be in flight per connection and are
+	// matched by id, responses use the encoding of their request.
+	void processLine(QLocalSocket *socket, const QByteArray &line);
+	void processRequest(
+		QLocalSocket *socket,
+		const QJsonObject &request,
+		WireEncoding encoding);
+	// Large responses go to the payload ring of the connection when the
+	// client has opened one, only the descriptor is written.
+	void writeResponse(
+		QLocalSocket *socket,
+		const QJsonObject &response,
+		WireEncoding encoding = WireEncoding::Json);
+	void writeEncoded(
+		QLocalSocket *socket,
+		const QByteArray &message,
+		WireEncoding encoding);
+
+	// bridge/open_shm and bridge/release_shm, answered on the socket.
+	[[nodiscard]] QJsonObject handleSharedMemory(
+		QLocalSocket *socket,
+		const QJsonObject &request);
+
 	// Handle incoming JSON-RPC command
 	QJsonObject handleCommand(const QJsonObject &request);
 
@@ -54,6 +86,9 @@ private:
 	QJsonObject handleGetDialogs(const QJsonObject &params);
 
 	QLocalServer *_server = nullptr;
+	QHash<QLocalSocket*, QByteArray> _buffers;
+	std::map<QLocalSocket*, std::unique_ptr<PayloadRing>> _payloadRings;
+	int _payloadRingCounter = 0;
 	QString _socketPath;
 	Server *_mcpServer = nullptr;
 };
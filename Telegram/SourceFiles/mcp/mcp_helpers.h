@@ -11,11 +11,22 @@
 #include <QtCore/QString>
 #include <QtCore/QStringList>
 #include <QtCore/QDateTime>
+#include <QtCore/QHash>
 #include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QThreadPool>
 #include <QtSql/QSqlQuery>
 #include <QtSql/QSqlError>
 #include <QtSql/QSqlDatabase>
 
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <utility>
+#include <vector>
+
 namespace MCP {
 
 // ============================================================
@@ -565,6 +576,210 @@ private:
 	QSqlDatabase &_db;
 };
 
+// ============================================================
+// PreparedQuery - Prepared statements reused per connection
+// ============================================================
+
+// A statement handed out by PreparedQuery(), used like a QSqlQuery
+// pointer. Finishes on destruction so the cached statement does not
+// keep a read transaction open, and returns it to the cache.
+class CachedQuery {
+public:
+	CachedQuery(QSqlQuery *query, bool *inUse, QMutex *mutex)
+	: _query(query)
+	, _inUse(inUse)
+	, _mutex(mutex) {
+	}
+	explicit CachedQuery(std::unique_ptr<QSqlQuery> owned)
+	: _owned(std::move(owned))
+	, _query(_owned.get()) {
+	}
+	CachedQuery(CachedQuery &&other)
+	: _owned(std::move(other._owned))
+	, _query(std::exchange(other._query, nullptr))
+	, _inUse(std::exchange(other._inUse, nullptr))
+	, _mutex(other._mutex) {
+	}
+	CachedQuery(const CachedQuery &other) = delete;
+	CachedQuery &operator=(const CachedQuery &other) = delete;
+	~CachedQuery() {
+		if (!_query) {
+			return;
+		}
+		_query->finish();
+		if (_inUse) {
+			QMutexLocker lock(_mutex);
+			*_inUse = false;
+		}
+	}
+
+	QSqlQuery *operator->() const { return _query; }
+	QSqlQuery &operator*() const { return *_query; }
+
+private:
+	std::unique_ptr<QSqlQuery> _owned;
+	QSqlQuery *_query = nullptr;
+	bool *_inUse = nullptr;
+	QMutex *_mutex = nullptr;
+};
+
+// LRU of prepared statements per connection, keyed by SQL text. Only
+// the statement text is cached, callers bind every value again.
+// Statements are forward-only, results are read with next().
+class StatementCache {
+public:
+	static constexpr auto kMaxPerConnection = std::size_t(64);
+
+	static StatementCache &instance() {
+		static StatementCache cache;
+		return cache;
+	}
+
+	// The connection must belong to the calling thread
+	CachedQuery acquire(const QSqlDatabase &db, const QString &sql) {
+		const auto name = db.connectionName();
+		{
+			QMutexLocker lock(&_mutex);
+			auto &connection = _connections[name];
+			if (const auto i = connection.index.constFind(sql);
+					i != connection.index.cend()) {
+				const auto entry = i.value();
+				// In use, e.g. a nested query with the same SQL text.
+				if (entry->inUse) {
+					return CachedQuery(prepare(db, sql));
+				}
+				connection.entries.splice(
+					connection.entries.begin(),
+					connection.entries,
+					entry);
+				entry->inUse = true;
+				return CachedQuery(entry->query.get(), &entry->inUse, &_mutex);
+			}
+		}
+
+		// Prepared unlocked, other threads keep using their caches.
+		auto query = prepare(db, sql);
+		if (query->lastError().isValid()) {
+			return CachedQuery(std::move(query)); // exec() reports it.
+		}
+
+		QMutexLocker lock(&_mutex);
+		auto &connection = _connections[name];
+		connection.entries.push_front({ sql, std::move(query), true });
+		const auto entry = connection.entries.begin();
+		connection.index.insert(sql, entry);
+		evict(connection);
+		return CachedQuery(entry->query.get(), &entry->inUse, &_mutex);
+	}
+
+	// Call before removing a connection, cached statements hold it open.
+	// No CachedQuery of that connection may be alive.
+	void forget(const QString &connectionName) {
+		QMutexLocker lock(&_mutex);
+		_connections.remove(connectionName);
+	}
+
+private:
+	struct Entry {
+		QString sql;
+		std::unique_ptr<QSqlQuery> query;
+		bool inUse = false;
+	};
+	using Entries = std::list<Entry>;
+	struct Connection {
+		Entries entries;
+		QHash<QString, Entries::iterator> index;
+	};
+
+	static std::unique_ptr<QSqlQuery> prepare(
+			const QSqlDatabase &db,
+			const QString &sql) {
+		auto query = std::make_unique<QSqlQuery>(db);
+		query->setForwardOnly(true); // Rows are not buffered for seeking.
+		query->prepare(sql);
+		return query;
+	}
+
+	static void evict(Connection &connection) {
+		auto i = connection.entries.end();
+		while (connection.entries.size() > kMaxPerConnection
+			&& i != connection.entries.begin()) {
+			--i;
+			if (!i->inUse) {
+				connection.index.remove(i->sql);
+				i = connection.entries.erase(i);
+			}
+		}
+	}
+
+	QMutex _mutex;
+	QHash<QString, Connection> _connections;
+};
+
+// Replaces QSqlQuery query(db); query.prepare(sql); use query->exec()
+inline CachedQuery PreparedQuery(const QSqlDatabase &db, const QString &sql) {
+	return StatementCache::instance().acquire(db, sql);
+}
+
+// ============================================================
+// IsUnsegmentedScript - Text written without word separators
+// ============================================================
+
+// Scripts written without spaces between words, word tokenizers keep
+// a whole run of them as one token.
+inline bool IsUnsegmentedScript(QChar ch) {
+	switch (ch.script()) {
+	case QChar::Script_Han:
+	case QChar::Script_Hiragana:
+	case QChar::Script_Katakana:
+	case QChar::Script_Hangul:
+	case QChar::Script_Thai:
+		return true;
+	default:
+		return false;
+	}
+}
+
+// ============================================================
+// ParallelFor - Loops split over the global thread pool
+// ============================================================
+
+// Runs body(begin, end) over slices of [0, count), at least minChunk
+// items each. Slices the pool has no free thread for run on the calling
+// thread, so nested or busy callers can't deadlock.
+inline void ParallelFor(
+		int count,
+		int minChunk,
+		const std::function<void(int, int)> &body) {
+	const auto pool = QThreadPool::globalInstance();
+	const auto chunks = std::clamp(
+		count / std::max(minChunk, 1),
+		1,
+		std::max(pool->maxThreadCount(), 1));
+	if (chunks == 1) {
+		if (count > 0) {
+			body(0, count);
+		}
+		return;
+	}
+	const auto step = (count + chunks - 1) / chunks;
+	auto done = std::vector<std::future<void>>();
+	for (auto begin = step; begin < count; begin += step) {
+		const auto end = std::min(begin + step, count);
+		const auto task = std::make_shared<std::packaged_task<void()>>([=, &body] {
+			body(begin, end);
+		});
+		done.push_back(task->get_future());
+		if (!pool->tryStart([=] { (*task)(); })) {
+			(*task)();
+		}
+	}
+	body(0, step);
+	for (auto &future : done) {
+		future.get();
+	}
+}
+
 // ============================================================
 // SessionGuard - RAII-style session validation
 // ============================================================
@@ -13,14 +13,16 @@
 #include <QtCore/QJsonDocument>
 #include <QtCore/QJsonObject>
 #include <QtCore/QJsonArray>
-#include <QtCore/QTextStream>
+#include <QtCore/QFile>
 #include <QtCore/QHash>
-#include <QtNetwork/QTcpServer>
+#include <QtCore/QSet>
+#include <QtCore/QTimer>
 #include <QtSql/QSqlDatabase>
 
 #include <functional>
 #include <memory>
 
+#include "base/expected.h"
 #include "mcp/mcp_helpers.h"
 
 namespace Main {
@@ -28,21 +30,44 @@ class Session;
 } // namespace Main
 
 class HistoryItem;
+class QThreadPool;
 
 namespace MCP {
 
 // Forward declarations
 class ChatArchiver;
+class DatabasePool;
 class EphemeralArchiver;
 class Analytics;
 class SemanticSearch;
 class BatchOperations;
 class MessageScheduler;
 class AuditLogger;
+class ToolMetrics;
+class RateLimiter;
 class RBAC;
 class VoiceTranscription;
 class BotManager;
 class CacheManager;
+class LiveSearchIndex;
+class ContextBuilder;
+class CloudSearch;
+class TranslationPipeline;
+class TagIndex;
+class ChatRules;
+class VoiceSynthesis;
+class WalletSync;
+class GiftPriceSeries;
+class PeerSnapshots;
+class ChangeLog;
+class SessionProfiler;
+class StdioReader;
+class HttpTransport;
+class JsonStreamWriter;
+class JobQueue;
+class JobControl;
+class MessageProjection;
+struct IndexingObserver;
 
 // MCP Protocol types
 enum class TransportType {
@@ -56,6 +81,7 @@ struct Tool {
 	QString name;
 	QString description;
 	QJsonObject inputSchema;
+	QString category; // Filled by Server::assignToolCategories()
 };
 
 // MCP Resource definition
@@ -91,6 +117,14 @@ public:
 	// Set session for live data access
 	void setSession(Main::Session *session);
 
+	// Port for TransportType::HTTP, must be set before start()
+	void setHttpPort(int port) { _httpPort = port; }
+
+	// Push a JSON-RPC notification to connected clients
+	void sendNotification(
+		const QString &method,
+		const QJsonObject &params = QJsonObject());
+
 	// Server info
 	struct ServerInfo {
 		QString name = "Telegram Desktop MCP";
@@ -103,24 +137,55 @@ public:
 	// Call a tool by name (for Bridge delegation)
 	QJsonObject callTool(const QString &toolName, const QJsonObject &args);
 
+	// Whether a tool only reads the archive and may run off the main thread
+	[[nodiscard]] bool isThreadSafeTool(const QString &toolName) const;
+
 private:
 	// Initialize server capabilities
 	void initializeCapabilities();
 
 	// Register tools, resources, prompts
 	void registerTools();
+	void assignToolCategories();
+	void rebuildToolsListCache();
 	void registerResources();
 	void registerPrompts();
 
 	// Handle incoming JSON-RPC requests
 	QJsonObject handleRequest(const QJsonObject &request);
 
+	// Asynchronous entry point used by transports. Thread-safe tools run
+	// on the worker pool, done is always invoked on the main thread.
+	using ResponseCallback = std::function<void(QJsonObject response)>;
+	void dispatchRequest(const QJsonObject &request, ResponseCallback done);
+
 	// JSON-RPC method handlers
 	QJsonObject handleInitialize(const QJsonObject &params);
 	QJsonObject handleListTools(const QJsonObject &params);
 	QJsonObject handleCallTool(const QJsonObject &params);
+	QJsonObject executeTool(const QString &toolName, const QJsonObject &arguments);
+	QJsonObject toolCallResponse(
+		const QString &toolName,
+		const QJsonObject &result);
+	// Cache key of a tool call whose whole tools/call result is kept
+	// pre-serialized in _cache, empty for other tools.
+	QString cachedToolResultKey(
+		const QString &toolName,
+		const QJsonObject &arguments) const;
+	void recordToolCall(
+		const QString &toolName,
+		qint64 microseconds,
+		const QJsonObject &result);
 	QJsonObject handleListResources(const QJsonObject &params);
 	QJsonObject handleReadResource(const QJsonObject &params);
+	// Answered with a JSON-RPC error response on failure.
+	struct RequestError {
+		int code = 0;
+		QString message;
+	};
+	using CheckedResult = base::expected<QJsonObject, RequestError>;
+	CheckedResult handleSubscribeResource(const QJsonObject &params);
+	CheckedResult handleUnsubscribeResource(const QJsonObject &params);
 	QJsonObject handleListPrompts(const QJsonObject &params);
 	QJsonObject handleGetPrompt(const QJsonObject &params);
 
@@ -128,9 +193,20 @@ private:
 	QJsonObject toolListChats(const QJsonObject &args);
 	QJsonObject toolGetChatInfo(const QJsonObject &args);
 	QJsonObject toolReadMessages(const QJsonObject &args);
+	void streamReadMessages(const QJsonObject &args, JsonStreamWriter &out);
 	QJsonObject toolSendMessage(const QJsonObject &args);
 	QJsonObject toolSearchMessages(const QJsonObject &args);
 	QJsonObject toolGetUserInfo(const QJsonObject &args);
+	QJsonObject toolListAccounts(const QJsonObject &args);
+	QJsonObject toolGetMessages(const QJsonObject &args);
+	QJsonObject toolGetUpdates(const QJsonObject &args);
+
+	// Session of the tool call running on the current thread, the primary
+	// one outside of tool calls. Tools use it instead of _session.
+	[[nodiscard]] Main::Session *callSession() const;
+	// Session of the account_id argument, nullptr if not logged in.
+	[[nodiscard]] Main::Session *sessionForArguments(
+		const QJsonObject &args) const;
 
 	// Archive tools (9 tools - includes ephemeral capture)
 	QJsonObject toolArchiveChat(const QJsonObject &args);
@@ -142,6 +218,11 @@ private:
 	QJsonObject toolGetEphemeralMessages(const QJsonObject &args);
 	QJsonObject toolSearchArchive(const QJsonObject &args);
 	QJsonObject toolPurgeArchive(const QJsonObject &args);
+	QJsonObject toolTierArchive(const QJsonObject &args);
+	QJsonObject toolConfigureMediaArchive(const QJsonObject &args);
+	QJsonObject toolGetMediaArchiveStatus(const QJsonObject &args);
+	QJsonObject toolGetChatMembers(const QJsonObject &args);
+	QJsonObject toolSearchChatMembers(const QJsonObject &args);
 
 	// Analytics tools (8 tools)
 	QJsonObject toolGetMessageStats(const QJsonObject &args);
@@ -152,10 +233,18 @@ private:
 	QJsonObject toolGetTopWords(const QJsonObject &args);
 	QJsonObject toolExportAnalytics(const QJsonObject &args);
 	QJsonObject toolGetTrends(const QJsonObject &args);
+	QJsonObject toolRebuildAnalytics(const QJsonObject &args);
+	QJsonObject toolGetUniqueUsers(const QJsonObject &args);
+	QJsonObject toolGetChannelStatistics(const QJsonObject &args);
 
 	// Semantic search tools (5 tools)
 	QJsonObject toolSemanticSearch(const QJsonObject &args);
+	QJsonObject toolHybridSearch(const QJsonObject &args);
+	QJsonObject toolGetChatContext(const QJsonObject &args);
 	QJsonObject toolIndexMessages(const QJsonObject &args);
+	QJsonObject indexMessages(
+		const QJsonObject &args,
+		const IndexingObserver &observer);
 	QJsonObject toolDetectTopics(const QJsonObject &args);
 	QJsonObject toolClassifyIntent(const QJsonObject &args);
 	QJsonObject toolExtractEntities(const QJsonObject &args);
@@ -181,11 +270,33 @@ private:
 	QJsonObject toolListScheduled(const QJsonObject &args);
 	QJsonObject toolUpdateScheduled(const QJsonObject &args);
 
-	// System tools (4 tools)
+	// System tools (13 tools)
 	QJsonObject toolGetCacheStats(const QJsonObject &args);
 	QJsonObject toolGetServerInfo(const QJsonObject &args);
 	QJsonObject toolGetAuditLog(const QJsonObject &args);
 	QJsonObject toolHealthCheck(const QJsonObject &args);
+	QJsonObject toolGetMetrics(const QJsonObject &args);
+	QJsonObject toolGetNetworkStats(const QJsonObject &args);
+	QJsonObject toolProfileSession(const QJsonObject &args);
+	QJsonObject toolStartTrace(const QJsonObject &args);
+	QJsonObject toolStopTrace(const QJsonObject &args);
+	QJsonObject toolStartJob(const QJsonObject &args);
+	QJsonObject toolGetJob(const QJsonObject &args);
+	QJsonObject toolCancelJob(const QJsonObject &args);
+	QJsonObject toolListJobs(const QJsonObject &args);
+
+	// Work of the start_job jobs, one chunk of export_chat at a time
+	QString startJob(
+		const QString &toolName,
+		const QJsonObject &arguments,
+		const QJsonValue &progressToken);
+	QJsonObject runExportJob(const QJsonObject &args, JobControl &control);
+	void startArchiveJob(
+		const QJsonObject &args,
+		std::shared_ptr<JobControl> control);
+	void startIndexJob(
+		const QJsonObject &args,
+		std::shared_ptr<JobControl> control);
 
 	// Voice tools (2 tools)
 	QJsonObject toolTranscribeVoice(const QJsonObject &args);
@@ -560,13 +671,33 @@ private:
 	// ============================================================
 	void initializeLocalDatabase();
 	bool ensureDatabaseSchema();
+	[[nodiscard]] VoiceTranscription &voiceTranscription();
+	void applyVoiceWaveform(quint64 documentId, const QByteArray &pcm);
+	[[nodiscard]] QJsonObject renderVoice(
+		const QString &persona,
+		const QString &text,
+		const QJsonObject &args);
 
 	// Stdio transport
 	void startStdioTransport();
-	void handleStdioInput();
+	void handleStdioLines(const QList<QByteArray> &lines);
+	void handleStdioLine(const QByteArray &line);
+	void dispatchStdioMessage(const QJsonValue &message);
+	void writeStdioResponse(const QJsonObject &response);
+	void streamStdioToolResponse(
+		const QJsonValue &id,
+		const QJsonObject &params,
+		const std::function<void(const QJsonObject&, JsonStreamWriter&)> &handler);
 
 	// HTTP transport
-	void startHttpTransport(int port = 8000);
+	bool startHttpTransport(int port = 8000);
+
+	// Token buckets per client and tool, fills rejection when refused
+	bool admitToolCall(
+		const QJsonObject &request,
+		const QString &client,
+		QJsonObject &rejection);
+	void initializeRateLimits();
 
 	// Error response helper
 	QJsonObject errorResponse(
@@ -597,12 +728,37 @@ private:
 
 	// Extract message data to JSON - reduces code duplication
 	QJsonObject extractMessageJson(HistoryItem *item);
-
-	// Tool dispatcher type alias
-	using ToolHandler = std::function<QJsonObject(const QJsonObject&)>;
-
-	// Initialize tool dispatcher lookup table
-	void initializeToolHandlers();
+	// Only the fields wanted by the projection are looked up
+	QJsonObject extractMessageJson(
+		HistoryItem *item,
+		const MessageProjection &projection);
+
+	// Produces read_messages entries one by one with the fields of the
+	// call, returns the metadata
+	using MessageCallback = std::function<void(const QJsonObject&)>;
+	QJsonObject readMessages(
+		const QJsonObject &args,
+		const MessageCallback &callback);
+
+	// Compile-time tool and JSON-RPC method tables (mcp_server_complete.cpp)
+	struct Dispatch;
+
+	void initializeStreamingToolHandlers();
+	void initializeThreadSafeTools();
+
+	// Session components started on demand, each starter returns
+	// whether its component is available.
+	using ComponentStarter = bool (Server::*)();
+	void initializeComponentStarters();
+	void archiverStarted(bool started);
+	void ensureComponents(const QString &toolName);
+	bool ensureSemanticSearch();
+	bool ensureBatchOperations();
+	bool ensureTranslation();
+	bool ensureBotManager();
+	bool ensureWalletSync();
+	bool ensureGiftPrices();
+	[[nodiscard]] QJsonObject componentsStatus() const;
 
 private:
 	ServerInfo _serverInfo;
@@ -610,15 +766,22 @@ private:
 
 	// Registered MCP components
 	QVector<Tool> _tools;
+
+	// tools/list catalogue, rebuilt by rebuildToolsListCache()
+	QVector<QJsonObject> _toolEntries;
+	QJsonObject _toolsListResult;
+	QByteArray _toolsListBytes;
 	QVector<Resource> _resources;
 	QVector<Prompt> _prompts;
 
 	// Transports (owned)
-	std::unique_ptr<QTextStream> _stdin;
-	std::unique_ptr<QTextStream> _stdout;
-	std::unique_ptr<QTcpServer> _httpServer;
+	std::unique_ptr<StdioReader> _stdioReader;
+	std::unique_ptr<QFile> _stdout;
+	std::unique_ptr<HttpTransport> _http;
+	int _httpPort = 8000;
 
 	// Feature components (owned)
+	std::unique_ptr<DatabasePool> _dbPool; // Archive, analytics, audit, RBAC
 	QSqlDatabase _db;
 	std::unique_ptr<ChatArchiver> _archiver;
 	std::unique_ptr<EphemeralArchiver> _ephemeralArchiver;
@@ -631,14 +794,66 @@ private:
 	std::unique_ptr<VoiceTranscription> _voiceTranscription;
 	std::unique_ptr<BotManager> _botManager;
 	std::unique_ptr<CacheManager> _cache;
+	std::unique_ptr<PeerSnapshots> _peerSnapshots; // Versioned peer fields
+	std::unique_ptr<ChangeLog> _changeLog; // get_updates cursor, change_log
+	std::unique_ptr<SessionProfiler> _sessionProfiler; // profile_session fixture
+	std::unique_ptr<LiveSearchIndex> _liveIndex; // Loaded messages, by token
+	std::unique_ptr<ContextBuilder> _contextBuilder; // Windows of active chats
+	std::unique_ptr<CloudSearch> _cloudSearch; // messages.search pages
+	quint64 _searchCounter = 0; // search_id of streamed cloud results
+	quint64 _hydrateCounter = 0; // request_id of fetched get_messages
+	std::unique_ptr<TranslationPipeline> _translation;
+	std::unique_ptr<TagIndex> _tagIndex; // message_tags bitmaps, on _db
+	std::unique_ptr<ChatRules> _chatRules; // Compiled chat_rules, on _db
+	std::unique_ptr<VoiceSynthesis> _voiceSynthesis; // tts_cache, on _db
+	std::unique_ptr<WalletSync> _walletSync; // Stars history, wallet_spending
+	std::unique_ptr<GiftPriceSeries> _giftPrices; // Resale price series files
+	std::unique_ptr<ToolMetrics> _metrics;
+	std::unique_ptr<RateLimiter> _rateLimiter; // Main thread only
 
 	// State
 	bool _initialized = false;
 	QString _databasePath;
 	Main::Session *_session = nullptr;
 
-	// Tool dispatcher lookup table
-	QHash<QString, ToolHandler> _toolHandlers;
+	// Subscribed telegram://messages/<chat> resources, changes of a chat
+	// are collected and pushed as one notifications/resources/updated.
+	struct ResourceDelta {
+		QSet<qint64> changed;
+		QSet<qint64> deleted;
+	};
+	void subscribeResourceUpdates();
+	void resourceChanged(qint64 chatId, qint64 messageId, bool deleted);
+	void sendResourceUpdates();
+
+	QSet<qint64> _subscribedChats;
+	QHash<qint64, ResourceDelta> _resourceDeltas;
+	QTimer _resourceUpdatesTimer;
+	rpl::lifetime _resourceUpdatesLifetime;
+
+	// Byte counters of each session at the last get_network_stats call.
+	QHash<qint32, QPair<qint64, qint64>> _networkBytes;
+	qint64 _networkBytesAt = 0;
+
+	// stats.getBroadcastStats / getMegagroupStats requests by chat id.
+	struct StatisticsRequest;
+	QHash<qint64, std::shared_ptr<StatisticsRequest>> _statisticsRequests;
+
+	// Tools able to write their result incrementally (stdio transport)
+	using StreamingToolHandler = std::function<void(
+		const QJsonObject&,
+		JsonStreamWriter&)>;
+	QHash<QString, StreamingToolHandler> _streamingToolHandlers;
+
+	// Archive/analytics-only tools executed on _toolPool
+	QSet<QString> _threadSafeTools;
+	std::unique_ptr<QThreadPool> _toolPool;
+	int _queuedToolCalls = 0; // Started on _toolPool, not answered yet
+	std::unique_ptr<JobQueue> _jobQueue; // start_job, get_job, cancel_job
+
+	QHash<QString, ComponentStarter> _componentStarters; // By tool name
+	QTimer _deferredStartTimer;
+	bool _stdioBatching = false;
 };
 
 } // namespace MCP
@@ -8,6 +8,7 @@
 
 #include "mcp_server.h"
 #include "chat_archiver.h"
+#include "database_pool.h"
 #include "analytics.h"
 #include "semantic_search.h"
 #include "batch_operations.h"
@@ -18,33 +19,592 @@
 #include "bot_manager.h"
 #include "context_assistant_bot.h"
 #include "cache_manager.h"
+#include "cloud_search.h"
+#include "translation_pipeline.h"
+#include "tag_index.h"
+#include "chat_rules.h"
+#include "voice_synthesis.h"
+#include "live_search_index.h"
+#include "context_builder.h"
+#include "stdio_reader.h"
+#include "http_transport.h"
+#include "rate_limiter.h"
+#include "json_stream_writer.h"
+#include "static_dispatch.h"
+#include "tool_metrics.h"
+#include "wallet_sync.h"
+#include "gift_price_series.h"
+#include "peer_snapshots.h"
+#include "change_log.h"
+#include "session_profiler.h"
+#include "job_queue.h"
+#include "message_projection.h"
+#include "media_archiver.h"
+#include "participant_cache.h"
 
 #include <QtCore/QTimer>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
 #include <QtCore/QDebug>
 #include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
 #include <QtCore/QJsonObject>
 #include <QtCore/QJsonArray>
 #include <QtSql/QSqlError>
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "core/application.h"
+#include "core/core_tracing.h"
+#include "core/stall_detector.h"
+#include "main/main_account.h"
+#include "main/main_domain.h"
 #include "main/main_session.h"
 #include "data/data_session.h"
+#include "data/data_changes.h"
 #include "data/data_peer.h"
 #include "data/data_user.h"
 #include "data/data_chat.h"
 #include "data/data_channel.h"
 #include "data/data_thread.h"
 #include "data/data_histories.h"
+#include "data/data_document.h"
+#include "data/data_document_media.h"
+#include "data/data_file_origin.h"
+#include "data/data_media_types.h"
 #include "dialogs/dialogs_main_list.h"
 #include "dialogs/dialogs_indexed_list.h"
 #include "dialogs/dialogs_row.h"
 #include "history/history.h"
 #include "history/history_item.h"
 #include "history/view/history_view_element.h"
+#include "media/audio/media_audio.h"
 #include "api/api_common.h"
 #include "api/api_editing.h"
+#include "api/api_statistics.h"
 #include "apiwrap.h"
+#include "mtproto/mtp_instance.h"
+#include "base/weak_ptr.h"
 
 namespace MCP {
+namespace {
+
+constexpr auto kMaxQueuedToolCalls = 64;
+constexpr auto kShedRetryAfterMs = qint64(1000);
+constexpr auto kBusyErrorCode = -32005;
+
+// Account of the tool call running on this thread. Tool calls run on the
+// main thread, the tool pool and the job queue at the same time, each one
+// sees only the session it was called for.
+struct ToolCall {
+	const void *server = nullptr;
+	Main::Session *session = nullptr;
+};
+thread_local ToolCall *CurrentToolCall = nullptr;
+
+// Translation, bots and the wallet sync are started this long after
+// login at the latest.
+constexpr auto kDeferredStartDelay = 10 * 1000;
+
+// Changes of a subscribed chat within this window are pushed together.
+constexpr auto kResourceUpdatesDelay = 500;
+constexpr auto kMessagesResourcePrefix = "telegram://messages/";
+constexpr auto kInvalidParamsCode = -32602;
+
+// Pairs resolved by one get_messages call.
+constexpr auto kMaxMessagesPerCall = 500;
+
+// Change log events read by one get_updates call.
+constexpr auto kDefaultUpdatesLimit = 500;
+constexpr auto kMaxUpdatesLimit = 5000;
+
+// JSON-RPC error for a call refused by admission control, clients
+// should retry it after data.retry_after_ms.
+[[nodiscard]] QJsonObject BusyResponse(
+		const QJsonValue &id,
+		qint64 retryAfterMs,
+		const QString &reason) {
+	return QJsonObject{
+		{"jsonrpc", "2.0"},
+		{"id", id},
+		{"error", QJsonObject{
+			{"code", kBusyErrorCode},
+			{"message", "Server busy, retry later"},
+			{"data", QJsonObject{
+				{"reason", reason},
+				{"retry_after_ms", retryAfterMs},
+			}},
+		}},
+	};
+}
+
+} // namespace
+
+// Every tool callable through tools/call, looked up by name in a table
+// built at compile time.
+struct Server::Dispatch {
+	using ToolMethod = QJsonObject (Server::*)(const QJsonObject&);
+	using RequestMethod = QJsonObject (Server::*)(const QJsonObject&);
+	using CheckedRequestMethod = CheckedResult (Server::*)(
+		const QJsonObject&);
+
+	static constexpr auto kTools = MakeDispatch(std::array{
+		// CORE TOOLS
+		DispatchEntry<ToolMethod>{ "list_chats", &Server::toolListChats },
+		DispatchEntry<ToolMethod>{ "get_chat_info", &Server::toolGetChatInfo },
+		DispatchEntry<ToolMethod>{ "read_messages", &Server::toolReadMessages },
+		DispatchEntry<ToolMethod>{ "send_message", &Server::toolSendMessage },
+		DispatchEntry<ToolMethod>{ "search_messages", &Server::toolSearchMessages },
+		DispatchEntry<ToolMethod>{ "get_user_info", &Server::toolGetUserInfo },
+		DispatchEntry<ToolMethod>{ "list_accounts", &Server::toolListAccounts },
+		DispatchEntry<ToolMethod>{ "get_messages", &Server::toolGetMessages },
+		DispatchEntry<ToolMethod>{ "get_updates", &Server::toolGetUpdates },
+
+		// ARCHIVE TOOLS
+		DispatchEntry<ToolMethod>{ "archive_chat", &Server::toolArchiveChat },
+		DispatchEntry<ToolMethod>{ "export_chat", &Server::toolExportChat },
+		DispatchEntry<ToolMethod>{ "list_archived_chats", &Server::toolListArchivedChats },
+		DispatchEntry<ToolMethod>{ "get_archive_stats", &Server::toolGetArchiveStats },
+		DispatchEntry<ToolMethod>{ "configure_ephemeral_capture", &Server::toolConfigureEphemeralCapture },
+		DispatchEntry<ToolMethod>{ "get_ephemeral_stats", &Server::toolGetEphemeralStats },
+		DispatchEntry<ToolMethod>{ "get_ephemeral_messages", &Server::toolGetEphemeralMessages },
+		DispatchEntry<ToolMethod>{ "search_archive", &Server::toolSearchArchive },
+		DispatchEntry<ToolMethod>{ "purge_archive", &Server::toolPurgeArchive },
+		DispatchEntry<ToolMethod>{ "tier_archive", &Server::toolTierArchive },
+		DispatchEntry<ToolMethod>{ "configure_media_archive", &Server::toolConfigureMediaArchive },
+		DispatchEntry<ToolMethod>{ "get_media_archive_status", &Server::toolGetMediaArchiveStatus },
+		DispatchEntry<ToolMethod>{ "get_chat_members", &Server::toolGetChatMembers },
+		DispatchEntry<ToolMethod>{ "search_chat_members", &Server::toolSearchChatMembers },
+
+		// ANALYTICS TOOLS
+		DispatchEntry<ToolMethod>{ "get_message_stats", &Server::toolGetMessageStats },
+		DispatchEntry<ToolMethod>{ "get_user_activity", &Server::toolGetUserActivity },
+		DispatchEntry<ToolMethod>{ "get_chat_activity", &Server::toolGetChatActivity },
+		DispatchEntry<ToolMethod>{ "get_time_series", &Server::toolGetTimeSeries },
+		DispatchEntry<ToolMethod>{ "get_top_users", &Server::toolGetTopUsers },
+		DispatchEntry<ToolMethod>{ "get_top_words", &Server::toolGetTopWords },
+		DispatchEntry<ToolMethod>{ "export_analytics", &Server::toolExportAnalytics },
+		DispatchEntry<ToolMethod>{ "get_trends", &Server::toolGetTrends },
+		DispatchEntry<ToolMethod>{ "rebuild_analytics", &Server::toolRebuildAnalytics },
+		DispatchEntry<ToolMethod>{ "get_unique_users", &Server::toolGetUniqueUsers },
+		DispatchEntry<ToolMethod>{ "get_channel_statistics", &Server::toolGetChannelStatistics },
+
+		// SEMANTIC SEARCH TOOLS
+		DispatchEntry<ToolMethod>{ "semantic_search", &Server::toolSemanticSearch },
+		DispatchEntry<ToolMethod>{ "hybrid_search", &Server::toolHybridSearch },
+		DispatchEntry<ToolMethod>{ "get_chat_context", &Server::toolGetChatContext },
+		DispatchEntry<ToolMethod>{ "index_messages", &Server::toolIndexMessages },
+		DispatchEntry<ToolMethod>{ "semantic_index_messages", &Server::toolIndexMessages }, // alias
+		DispatchEntry<ToolMethod>{ "detect_topics", &Server::toolDetectTopics },
+		DispatchEntry<ToolMethod>{ "classify_intent", &Server::toolClassifyIntent },
+		DispatchEntry<ToolMethod>{ "extract_entities", &Server::toolExtractEntities },
+
+		// MESSAGE OPERATIONS
+		DispatchEntry<ToolMethod>{ "edit_message", &Server::toolEditMessage },
+		DispatchEntry<ToolMethod>{ "delete_message", &Server::toolDeleteMessage },
+		DispatchEntry<ToolMethod>{ "forward_message", &Server::toolForwardMessage },
+		DispatchEntry<ToolMethod>{ "pin_message", &Server::toolPinMessage },
+		DispatchEntry<ToolMethod>{ "unpin_message", &Server::toolUnpinMessage },
+		DispatchEntry<ToolMethod>{ "add_reaction", &Server::toolAddReaction },
+
+		// BATCH OPERATIONS
+		DispatchEntry<ToolMethod>{ "batch_send", &Server::toolBatchSend },
+		DispatchEntry<ToolMethod>{ "batch_delete", &Server::toolBatchDelete },
+		DispatchEntry<ToolMethod>{ "batch_forward", &Server::toolBatchForward },
+		DispatchEntry<ToolMethod>{ "batch_pin", &Server::toolBatchPin },
+		DispatchEntry<ToolMethod>{ "batch_reaction", &Server::toolBatchReaction },
+
+		// SCHEDULER TOOLS
+		DispatchEntry<ToolMethod>{ "schedule_message", &Server::toolScheduleMessage },
+		DispatchEntry<ToolMethod>{ "cancel_scheduled", &Server::toolCancelScheduled },
+		DispatchEntry<ToolMethod>{ "list_scheduled", &Server::toolListScheduled },
+		DispatchEntry<ToolMethod>{ "update_scheduled", &Server::toolUpdateScheduled },
+
+		// SYSTEM TOOLS
+		DispatchEntry<ToolMethod>{ "get_cache_stats", &Server::toolGetCacheStats },
+		DispatchEntry<ToolMethod>{ "get_server_info", &Server::toolGetServerInfo },
+		DispatchEntry<ToolMethod>{ "get_audit_log", &Server::toolGetAuditLog },
+		DispatchEntry<ToolMethod>{ "health_check", &Server::toolHealthCheck },
+		DispatchEntry<ToolMethod>{ "get_metrics", &Server::toolGetMetrics },
+		DispatchEntry<ToolMethod>{ "get_network_stats", &Server::toolGetNetworkStats },
+		DispatchEntry<ToolMethod>{ "profile_session", &Server::toolProfileSession },
+		DispatchEntry<ToolMethod>{ "start_trace", &Server::toolStartTrace },
+		DispatchEntry<ToolMethod>{ "stop_trace", &Server::toolStopTrace },
+		DispatchEntry<ToolMethod>{ "start_job", &Server::toolStartJob },
+		DispatchEntry<ToolMethod>{ "get_job", &Server::toolGetJob },
+		DispatchEntry<ToolMethod>{ "cancel_job", &Server::toolCancelJob },
+		DispatchEntry<ToolMethod>{ "list_jobs", &Server::toolListJobs },
+
+		// VOICE TOOLS
+		DispatchEntry<ToolMethod>{ "transcribe_voice", &Server::toolTranscribeVoice },
+		DispatchEntry<ToolMethod>{ "get_transcription", &Server::toolGetTranscription },
+
+		// BOT FRAMEWORK TOOLS
+		DispatchEntry<ToolMethod>{ "list_bots", &Server::toolListBots },
+		DispatchEntry<ToolMethod>{ "get_bot_info", &Server::toolGetBotInfo },
+		DispatchEntry<ToolMethod>{ "start_bot", &Server::toolStartBot },
+		DispatchEntry<ToolMethod>{ "stop_bot", &Server::toolStopBot },
+		DispatchEntry<ToolMethod>{ "configure_bot", &Server::toolConfigureBot },
+		DispatchEntry<ToolMethod>{ "get_bot_stats", &Server::toolGetBotStats },
+		DispatchEntry<ToolMethod>{ "send_bot_command", &Server::toolSendBotCommand },
+		DispatchEntry<ToolMethod>{ "get_bot_suggestions", &Server::toolGetBotSuggestions },
+
+		// PROFILE SETTINGS TOOLS
+		DispatchEntry<ToolMethod>{ "get_profile_settings", &Server::toolGetProfileSettings },
+		DispatchEntry<ToolMethod>{ "update_profile_name", &Server::toolUpdateProfileName },
+		DispatchEntry<ToolMethod>{ "update_profile_bio", &Server::toolUpdateProfileBio },
+		DispatchEntry<ToolMethod>{ "update_profile_username", &Server::toolUpdateProfileUsername },
+		DispatchEntry<ToolMethod>{ "update_profile_phone", &Server::toolUpdateProfilePhone },
+
+		// PRIVACY SETTINGS TOOLS
+		DispatchEntry<ToolMethod>{ "get_privacy_settings", &Server::toolGetPrivacySettings },
+		DispatchEntry<ToolMethod>{ "update_last_seen_privacy", &Server::toolUpdateLastSeenPrivacy },
+		DispatchEntry<ToolMethod>{ "update_profile_photo_privacy", &Server::toolUpdateProfilePhotoPrivacy },
+		DispatchEntry<ToolMethod>{ "update_phone_number_privacy", &Server::toolUpdatePhoneNumberPrivacy },
+		DispatchEntry<ToolMethod>{ "update_forwards_privacy", &Server::toolUpdateForwardsPrivacy },
+		DispatchEntry<ToolMethod>{ "update_birthday_privacy", &Server::toolUpdateBirthdayPrivacy },
+		DispatchEntry<ToolMethod>{ "update_about_privacy", &Server::toolUpdateAboutPrivacy },
+		DispatchEntry<ToolMethod>{ "get_blocked_users", &Server::toolGetBlockedUsers },
+
+		// SECURITY SETTINGS TOOLS
+		DispatchEntry<ToolMethod>{ "get_security_settings", &Server::toolGetSecuritySettings },
+		DispatchEntry<ToolMethod>{ "get_active_sessions", &Server::toolGetActiveSessions },
+		DispatchEntry<ToolMethod>{ "terminate_session", &Server::toolTerminateSession },
+		DispatchEntry<ToolMethod>{ "block_user", &Server::toolBlockUser },
+		DispatchEntry<ToolMethod>{ "unblock_user", &Server::toolUnblockUser },
+		DispatchEntry<ToolMethod>{ "update_auto_delete_period", &Server::toolUpdateAutoDeletePeriod },
+
+		// PREMIUM FEATURES - Voice-to-Text
+		DispatchEntry<ToolMethod>{ "transcribe_voice_message", &Server::toolTranscribeVoiceMessage },
+		DispatchEntry<ToolMethod>{ "get_transcription_status", &Server::toolGetTranscriptionStatus },
+
+		// PREMIUM FEATURES - Translation
+		DispatchEntry<ToolMethod>{ "translate_messages", &Server::toolTranslateMessages },
+		DispatchEntry<ToolMethod>{ "auto_translate_chat", &Server::toolAutoTranslateChat },
+		DispatchEntry<ToolMethod>{ "get_translation_languages", &Server::toolGetTranslationLanguages },
+
+		// PREMIUM FEATURES - Message Tags
+		DispatchEntry<ToolMethod>{ "tag_message", &Server::toolAddMessageTag },
+		DispatchEntry<ToolMethod>{ "get_tagged_messages", &Server::toolSearchByTag },
+		DispatchEntry<ToolMethod>{ "list_tags", &Server::toolGetMessageTags },
+		DispatchEntry<ToolMethod>{ "delete_tag", &Server::toolRemoveMessageTag },
+		DispatchEntry<ToolMethod>{ "add_message_tag", &Server::toolAddMessageTag },
+		DispatchEntry<ToolMethod>{ "get_message_tags", &Server::toolGetMessageTags },
+		DispatchEntry<ToolMethod>{ "remove_message_tag", &Server::toolRemoveMessageTag },
+		DispatchEntry<ToolMethod>{ "search_by_tag", &Server::toolSearchByTag },
+		DispatchEntry<ToolMethod>{ "get_tag_suggestions", &Server::toolGetTagSuggestions },
+
+		// PREMIUM FEATURES - Ad Filtering
+		DispatchEntry<ToolMethod>{ "configure_ad_filter", &Server::toolConfigureAdFilter },
+		DispatchEntry<ToolMethod>{ "get_filtered_ads", &Server::toolGetFilteredAds },
+
+		// PREMIUM FEATURES - Chat Rules
+		DispatchEntry<ToolMethod>{ "create_chat_rule", &Server::toolCreateChatRule },
+		DispatchEntry<ToolMethod>{ "list_chat_rules", &Server::toolListChatRules },
+		DispatchEntry<ToolMethod>{ "execute_chat_rules", &Server::toolExecuteChatRules },
+		DispatchEntry<ToolMethod>{ "delete_chat_rule", &Server::toolDeleteChatRule },
+
+		// PREMIUM FEATURES - Tasks
+		DispatchEntry<ToolMethod>{ "create_task", &Server::toolCreateTask },
+		DispatchEntry<ToolMethod>{ "list_tasks", &Server::toolListTasks },
+
+		// BUSINESS FEATURES - Quick Replies
+		DispatchEntry<ToolMethod>{ "create_quick_reply", &Server::toolCreateQuickReply },
+		DispatchEntry<ToolMethod>{ "list_quick_replies", &Server::toolListQuickReplies },
+		DispatchEntry<ToolMethod>{ "send_quick_reply", &Server::toolSendQuickReply },
+		DispatchEntry<ToolMethod>{ "edit_quick_reply", &Server::toolEditQuickReply },
+		DispatchEntry<ToolMethod>{ "delete_quick_reply", &Server::toolDeleteQuickReply },
+
+		// BUSINESS FEATURES - Greeting Messages
+		DispatchEntry<ToolMethod>{ "configure_greeting", &Server::toolConfigureGreeting },
+		DispatchEntry<ToolMethod>{ "get_greeting_config", &Server::toolGetGreetingConfig },
+		DispatchEntry<ToolMethod>{ "test_greeting", &Server::toolTestGreeting },
+		DispatchEntry<ToolMethod>{ "get_greeting_stats", &Server::toolGetGreetingStats },
+
+		// BUSINESS FEATURES - Away Messages
+		DispatchEntry<ToolMethod>{ "configure_away_message", &Server::toolConfigureAwayMessage },
+		DispatchEntry<ToolMethod>{ "get_away_config", &Server::toolGetAwayConfig },
+		DispatchEntry<ToolMethod>{ "set_away_now", &Server::toolSetAwayNow },
+		DispatchEntry<ToolMethod>{ "disable_away", &Server::toolDisableAway },
+		DispatchEntry<ToolMethod>{ "get_away_stats", &Server::toolGetAwayStats },
+
+		// BUSINESS FEATURES - Business Hours
+		DispatchEntry<ToolMethod>{ "set_business_hours", &Server::toolSetBusinessHours },
+		DispatchEntry<ToolMethod>{ "get_business_hours", &Server::toolGetBusinessHours },
+		DispatchEntry<ToolMethod>{ "is_open_now", &Server::toolIsOpenNow },
+
+		// BUSINESS FEATURES - Business Location
+		DispatchEntry<ToolMethod>{ "set_business_location", &Server::toolSetBusinessLocation },
+		DispatchEntry<ToolMethod>{ "get_business_location", &Server::toolGetBusinessLocation },
+
+		// BUSINESS FEATURES - AI Chatbot
+		DispatchEntry<ToolMethod>{ "configure_ai_chatbot", &Server::toolConfigureAiChatbot },
+		DispatchEntry<ToolMethod>{ "get_chatbot_config", &Server::toolGetChatbotConfig },
+		DispatchEntry<ToolMethod>{ "pause_chatbot", &Server::toolPauseChatbot },
+		DispatchEntry<ToolMethod>{ "resume_chatbot", &Server::toolResumeChatbot },
+		DispatchEntry<ToolMethod>{ "set_chatbot_prompt", &Server::toolSetChatbotPrompt },
+		DispatchEntry<ToolMethod>{ "get_chatbot_stats", &Server::toolGetChatbotStats },
+		DispatchEntry<ToolMethod>{ "train_chatbot", &Server::toolTrainChatbot },
+
+		// BUSINESS FEATURES - AI Voice (TTS)
+		DispatchEntry<ToolMethod>{ "configure_voice_persona", &Server::toolConfigureVoicePersona },
+		DispatchEntry<ToolMethod>{ "generate_voice_message", &Server::toolGenerateVoiceMessage },
+		DispatchEntry<ToolMethod>{ "send_voice_reply", &Server::toolSendVoiceReply },
+		DispatchEntry<ToolMethod>{ "list_voice_presets", &Server::toolListVoicePresets },
+		DispatchEntry<ToolMethod>{ "clone_voice", &Server::toolCloneVoice },
+
+		// BUSINESS FEATURES - AI Video Circles (TTV)
+		DispatchEntry<ToolMethod>{ "configure_video_avatar", &Server::toolConfigureVideoAvatar },
+		DispatchEntry<ToolMethod>{ "generate_video_circle", &Server::toolGenerateVideoCircle },
+		DispatchEntry<ToolMethod>{ "send_video_reply", &Server::toolSendVideoReply },
+		DispatchEntry<ToolMethod>{ "upload_avatar_source", &Server::toolUploadAvatarSource },
+		DispatchEntry<ToolMethod>{ "list_avatar_presets", &Server::toolListAvatarPresets },
+
+		// WALLET FEATURES - Balance & Analytics
+		DispatchEntry<ToolMethod>{ "get_wallet_balance", &Server::toolGetWalletBalance },
+		DispatchEntry<ToolMethod>{ "get_balance_history", &Server::toolGetBalanceHistory },
+		DispatchEntry<ToolMethod>{ "get_spending_analytics", &Server::toolGetSpendingAnalytics },
+		DispatchEntry<ToolMethod>{ "get_income_analytics", &Server::toolGetIncomeAnalytics },
+
+		// WALLET FEATURES - Transactions
+		DispatchEntry<ToolMethod>{ "get_transactions", &Server::toolGetTransactions },
+		DispatchEntry<ToolMethod>{ "get_transaction_details", &Server::toolGetTransactionDetails },
+		DispatchEntry<ToolMethod>{ "export_transactions", &Server::toolExportTransactions },
+		DispatchEntry<ToolMethod>{ "search_transactions", &Server::toolSearchTransactions },
+
+		// WALLET FEATURES - Gifts
+		DispatchEntry<ToolMethod>{ "list_gifts", &Server::toolListGifts },
+		DispatchEntry<ToolMethod>{ "get_gift_details", &Server::toolGetGiftDetails },
+		DispatchEntry<ToolMethod>{ "get_gift_analytics", &Server::toolGetGiftAnalytics },
+		DispatchEntry<ToolMethod>{ "send_stars", &Server::toolSendStars },
+
+		// WALLET FEATURES - Subscriptions
+		DispatchEntry<ToolMethod>{ "list_subscriptions", &Server::toolListSubscriptions },
+		DispatchEntry<ToolMethod>{ "get_subscription_alerts", &Server::toolGetSubscriptionAlerts },
+		DispatchEntry<ToolMethod>{ "cancel_subscription", &Server::toolCancelSubscription },
+
+		// WALLET FEATURES - Monetization
+		DispatchEntry<ToolMethod>{ "get_channel_earnings", &Server::toolGetChannelEarnings },
+		DispatchEntry<ToolMethod>{ "get_all_channels_earnings", &Server::toolGetAllChannelsEarnings },
+		DispatchEntry<ToolMethod>{ "get_earnings_chart", &Server::toolGetEarningsChart },
+		DispatchEntry<ToolMethod>{ "get_reaction_stats", &Server::toolGetReactionStats },
+		DispatchEntry<ToolMethod>{ "get_paid_content_earnings", &Server::toolGetPaidContentEarnings },
+
+		// WALLET FEATURES - Giveaways
+		DispatchEntry<ToolMethod>{ "get_giveaway_options", &Server::toolGetGiveawayOptions },
+		DispatchEntry<ToolMethod>{ "list_giveaways", &Server::toolListGiveaways },
+		DispatchEntry<ToolMethod>{ "get_giveaway_stats", &Server::toolGetGiveawayStats },
+
+		// WALLET FEATURES - Advanced
+		DispatchEntry<ToolMethod>{ "get_topup_options", &Server::toolGetTopupOptions },
+		DispatchEntry<ToolMethod>{ "get_star_rating", &Server::toolGetStarRating },
+		DispatchEntry<ToolMethod>{ "get_withdrawal_status", &Server::toolGetWithdrawalStatus },
+		DispatchEntry<ToolMethod>{ "create_crypto_payment", &Server::toolCreateCryptoPayment },
+
+		// WALLET FEATURES - Budget & Reporting
+		DispatchEntry<ToolMethod>{ "set_wallet_budget", &Server::toolSetWalletBudget },
+		DispatchEntry<ToolMethod>{ "get_budget_status", &Server::toolGetBudgetStatus },
+		DispatchEntry<ToolMethod>{ "configure_wallet_alerts", &Server::toolConfigureWalletAlerts },
+		DispatchEntry<ToolMethod>{ "generate_financial_report", &Server::toolGenerateFinancialReport },
+		DispatchEntry<ToolMethod>{ "get_tax_summary", &Server::toolGetTaxSummary },
+
+		// STARS FEATURES - Star Gifts Management
+		DispatchEntry<ToolMethod>{ "list_star_gifts", &Server::toolListStarGifts },
+		DispatchEntry<ToolMethod>{ "get_star_gift_details", &Server::toolGetStarGiftDetails },
+		DispatchEntry<ToolMethod>{ "get_unique_gift_analytics", &Server::toolGetUniqueGiftAnalytics },
+		DispatchEntry<ToolMethod>{ "get_collectibles_portfolio", &Server::toolGetCollectiblesPortfolio },
+		DispatchEntry<ToolMethod>{ "send_star_gift", &Server::toolSendStarGift },
+		DispatchEntry<ToolMethod>{ "get_gift_transfer_history", &Server::toolGetGiftTransferHistory },
+		DispatchEntry<ToolMethod>{ "get_upgrade_options", &Server::toolGetUpgradeOptions },
+		DispatchEntry<ToolMethod>{ "transfer_gift", &Server::toolTransferGift },
+
+		// STARS FEATURES - Gift Collections
+		DispatchEntry<ToolMethod>{ "list_gift_collections", &Server::toolListGiftCollections },
+		DispatchEntry<ToolMethod>{ "get_collection_details", &Server::toolGetCollectionDetails },
+		DispatchEntry<ToolMethod>{ "get_collection_completion", &Server::toolGetCollectionCompletion },
+
+		// STARS FEATURES - Auctions
+		DispatchEntry<ToolMethod>{ "list_active_auctions", &Server::toolListActiveAuctions },
+		DispatchEntry<ToolMethod>{ "get_auction_details", &Server::toolGetAuctionDetails },
+		DispatchEntry<ToolMethod>{ "get_auction_alerts", &Server::toolGetAuctionAlerts },
+		DispatchEntry<ToolMethod>{ "place_auction_bid", &Server::toolPlaceAuctionBid },
+		DispatchEntry<ToolMethod>{ "get_auction_history", &Server::toolGetAuctionHistory },
+
+		// STARS FEATURES - Marketplace
+		DispatchEntry<ToolMethod>{ "browse_gift_marketplace", &Server::toolBrowseGiftMarketplace },
+		DispatchEntry<ToolMethod>{ "get_market_trends", &Server::toolGetMarketTrends },
+		DispatchEntry<ToolMethod>{ "list_gift_for_sale", &Server::toolListGiftForSale },
+		DispatchEntry<ToolMethod>{ "update_listing", &Server::toolUpdateListing },
+		DispatchEntry<ToolMethod>{ "cancel_listing", &Server::toolCancelListing },
+
+		// STARS FEATURES - Star Reactions
+		DispatchEntry<ToolMethod>{ "get_star_reactions_received", &Server::toolGetStarReactionsReceived },
+		DispatchEntry<ToolMethod>{ "get_star_reactions_sent", &Server::toolGetStarReactionsSent },
+		DispatchEntry<ToolMethod>{ "get_top_supporters", &Server::toolGetTopSupporters },
+
+		// STARS FEATURES - Paid Content
+		DispatchEntry<ToolMethod>{ "get_paid_messages_stats", &Server::toolGetPaidMessagesStats },
+		DispatchEntry<ToolMethod>{ "configure_paid_messages", &Server::toolConfigurePaidMessages },
+		DispatchEntry<ToolMethod>{ "get_paid_media_stats", &Server::toolGetPaidMediaStats },
+		DispatchEntry<ToolMethod>{ "get_unlocked_content", &Server::toolGetUnlockedContent },
+
+		// STARS FEATURES - Mini Apps
+		DispatchEntry<ToolMethod>{ "get_miniapp_spending", &Server::toolGetMiniappSpending },
+		DispatchEntry<ToolMethod>{ "get_miniapp_history", &Server::toolGetMiniappHistory },
+		DispatchEntry<ToolMethod>{ "set_miniapp_budget", &Server::toolSetMiniappBudget },
+
+		// STARS FEATURES - Star Rating
+		DispatchEntry<ToolMethod>{ "get_star_rating_details", &Server::toolGetStarRatingDetails },
+		DispatchEntry<ToolMethod>{ "get_rating_history", &Server::toolGetRatingHistory },
+		DispatchEntry<ToolMethod>{ "simulate_rating_change", &Server::toolSimulateRatingChange },
+
+		// STARS FEATURES - Profile Display
+		DispatchEntry<ToolMethod>{ "get_profile_gifts", &Server::toolGetProfileGifts },
+		DispatchEntry<ToolMethod>{ "update_gift_display", &Server::toolUpdateGiftDisplay },
+		DispatchEntry<ToolMethod>{ "reorder_profile_gifts", &Server::toolReorderProfileGifts },
+		DispatchEntry<ToolMethod>{ "toggle_gift_notifications", &Server::toolToggleGiftNotifications },
+
+		// STARS FEATURES - AI & Analytics
+		DispatchEntry<ToolMethod>{ "get_gift_investment_advice", &Server::toolGetGiftInvestmentAdvice },
+		DispatchEntry<ToolMethod>{ "backtest_strategy", &Server::toolBacktestStrategy },
+		DispatchEntry<ToolMethod>{ "get_portfolio_performance", &Server::toolGetPortfolioPerformance },
+		DispatchEntry<ToolMethod>{ "create_price_alert", &Server::toolCreatePriceAlert },
+		DispatchEntry<ToolMethod>{ "create_auction_alert", &Server::toolCreateAuctionAlert },
+		DispatchEntry<ToolMethod>{ "get_fragment_listings", &Server::toolGetFragmentListings },
+		DispatchEntry<ToolMethod>{ "export_portfolio_report", &Server::toolExportPortfolioReport },
+
+		// ADDITIONAL PREMIUM TOOLS
+		DispatchEntry<ToolMethod>{ "get_voice_transcription", &Server::toolGetVoiceTranscription },
+		DispatchEntry<ToolMethod>{ "translate_message", &Server::toolTranslateMessage },
+		DispatchEntry<ToolMethod>{ "get_translation_history", &Server::toolGetTranslationHistory },
+		DispatchEntry<ToolMethod>{ "get_ad_filter_stats", &Server::toolGetAdFilterStats },
+		DispatchEntry<ToolMethod>{ "set_chat_rules", &Server::toolSetChatRules },
+		DispatchEntry<ToolMethod>{ "get_chat_rules", &Server::toolGetChatRules },
+		DispatchEntry<ToolMethod>{ "test_chat_rules", &Server::toolTestChatRules },
+		DispatchEntry<ToolMethod>{ "create_task_from_message", &Server::toolCreateTaskFromMessage },
+		DispatchEntry<ToolMethod>{ "update_task", &Server::toolUpdateTask },
+
+		// ADDITIONAL BUSINESS TOOLS
+		DispatchEntry<ToolMethod>{ "update_quick_reply", &Server::toolUpdateQuickReply },
+		DispatchEntry<ToolMethod>{ "use_quick_reply", &Server::toolUseQuickReply },
+		DispatchEntry<ToolMethod>{ "set_greeting_message", &Server::toolSetGreetingMessage },
+		DispatchEntry<ToolMethod>{ "get_greeting_message", &Server::toolGetGreetingMessage },
+		DispatchEntry<ToolMethod>{ "disable_greeting", &Server::toolDisableGreeting },
+		DispatchEntry<ToolMethod>{ "set_away_message", &Server::toolSetAwayMessage },
+		DispatchEntry<ToolMethod>{ "get_away_message", &Server::toolGetAwayMessage },
+		DispatchEntry<ToolMethod>{ "get_next_available_slot", &Server::toolGetNextAvailableSlot },
+		DispatchEntry<ToolMethod>{ "check_business_status", &Server::toolCheckBusinessStatus },
+		DispatchEntry<ToolMethod>{ "configure_chatbot", &Server::toolConfigureChatbot },
+		DispatchEntry<ToolMethod>{ "get_chatbot_analytics", &Server::toolGetChatbotAnalytics },
+		DispatchEntry<ToolMethod>{ "test_chatbot", &Server::toolTestChatbot },
+		DispatchEntry<ToolMethod>{ "create_auto_reply_rule", &Server::toolCreateAutoReplyRule },
+		DispatchEntry<ToolMethod>{ "list_auto_reply_rules", &Server::toolListAutoReplyRules },
+		DispatchEntry<ToolMethod>{ "update_auto_reply_rule", &Server::toolUpdateAutoReplyRule },
+		DispatchEntry<ToolMethod>{ "delete_auto_reply_rule", &Server::toolDeleteAutoReplyRule },
+		DispatchEntry<ToolMethod>{ "test_auto_reply_rule", &Server::toolTestAutoReplyRule },
+		DispatchEntry<ToolMethod>{ "get_auto_reply_stats", &Server::toolGetAutoReplyStats },
+
+		// VOICE/VIDEO TOOLS
+		DispatchEntry<ToolMethod>{ "list_voice_personas", &Server::toolListVoicePersonas },
+		DispatchEntry<ToolMethod>{ "text_to_speech", &Server::toolTextToSpeech },
+		DispatchEntry<ToolMethod>{ "text_to_video", &Server::toolTextToVideo },
+
+		// ADDITIONAL WALLET TOOLS
+		DispatchEntry<ToolMethod>{ "categorize_transaction", &Server::toolCategorizeTransaction },
+		DispatchEntry<ToolMethod>{ "send_gift", &Server::toolSendGift },
+		DispatchEntry<ToolMethod>{ "buy_gift", &Server::toolBuyGift },
+		DispatchEntry<ToolMethod>{ "get_gift_history", &Server::toolGetGiftHistory },
+		DispatchEntry<ToolMethod>{ "get_gift_suggestions", &Server::toolGetGiftSuggestions },
+		DispatchEntry<ToolMethod>{ "get_subscription_stats", &Server::toolGetSubscriptionStats },
+		DispatchEntry<ToolMethod>{ "get_subscriber_analytics", &Server::toolGetSubscriberAnalytics },
+		DispatchEntry<ToolMethod>{ "get_monetization_analytics", &Server::toolGetMonetizationAnalytics },
+		DispatchEntry<ToolMethod>{ "set_monetization_rules", &Server::toolSetMonetizationRules },
+		DispatchEntry<ToolMethod>{ "get_earnings", &Server::toolGetEarnings },
+		DispatchEntry<ToolMethod>{ "withdraw_earnings", &Server::toolWithdrawEarnings },
+		DispatchEntry<ToolMethod>{ "set_spending_budget", &Server::toolSetSpendingBudget },
+		DispatchEntry<ToolMethod>{ "set_budget_alert", &Server::toolSetBudgetAlert },
+		DispatchEntry<ToolMethod>{ "request_stars", &Server::toolRequestStars },
+		DispatchEntry<ToolMethod>{ "get_stars_history", &Server::toolGetStarsHistory },
+		DispatchEntry<ToolMethod>{ "convert_stars", &Server::toolConvertStars },
+		DispatchEntry<ToolMethod>{ "get_stars_rate", &Server::toolGetStarsRate },
+
+		// ADDITIONAL STARS TOOLS
+		DispatchEntry<ToolMethod>{ "create_gift_collection", &Server::toolCreateGiftCollection },
+		DispatchEntry<ToolMethod>{ "add_to_collection", &Server::toolAddToCollection },
+		DispatchEntry<ToolMethod>{ "remove_from_collection", &Server::toolRemoveFromCollection },
+		DispatchEntry<ToolMethod>{ "share_collection", &Server::toolShareCollection },
+		DispatchEntry<ToolMethod>{ "create_gift_auction", &Server::toolCreateGiftAuction },
+		DispatchEntry<ToolMethod>{ "list_auctions", &Server::toolListAuctions },
+		DispatchEntry<ToolMethod>{ "place_bid", &Server::toolPlaceBid },
+		DispatchEntry<ToolMethod>{ "cancel_auction", &Server::toolCancelAuction },
+		DispatchEntry<ToolMethod>{ "get_auction_status", &Server::toolGetAuctionStatus },
+		DispatchEntry<ToolMethod>{ "list_marketplace", &Server::toolListMarketplace },
+		DispatchEntry<ToolMethod>{ "delist_gift", &Server::toolDelistGift },
+		DispatchEntry<ToolMethod>{ "list_available_gifts", &Server::toolListAvailableGifts },
+		DispatchEntry<ToolMethod>{ "get_gift_price_history", &Server::toolGetGiftPriceHistory },
+		DispatchEntry<ToolMethod>{ "get_price_predictions", &Server::toolGetPricePredictions },
+		DispatchEntry<ToolMethod>{ "send_star_reaction", &Server::toolSendStarReaction },
+		DispatchEntry<ToolMethod>{ "get_star_reactions", &Server::toolGetStarReactions },
+		DispatchEntry<ToolMethod>{ "get_reaction_analytics", &Server::toolGetReactionAnalytics },
+		DispatchEntry<ToolMethod>{ "set_reaction_price", &Server::toolSetReactionPrice },
+		DispatchEntry<ToolMethod>{ "get_top_reacted", &Server::toolGetTopReacted },
+		DispatchEntry<ToolMethod>{ "create_paid_post", &Server::toolCreatePaidPost },
+		DispatchEntry<ToolMethod>{ "set_content_price", &Server::toolSetContentPrice },
+		DispatchEntry<ToolMethod>{ "get_paid_content_stats", &Server::toolGetPaidContentStats },
+		DispatchEntry<ToolMethod>{ "list_purchased_content", &Server::toolListPurchasedContent },
+		DispatchEntry<ToolMethod>{ "unlock_content", &Server::toolUnlockContent },
+		DispatchEntry<ToolMethod>{ "refund_content", &Server::toolRefundContent },
+		DispatchEntry<ToolMethod>{ "get_portfolio", &Server::toolGetPortfolio },
+		DispatchEntry<ToolMethod>{ "get_portfolio_history", &Server::toolGetPortfolioHistory },
+		DispatchEntry<ToolMethod>{ "get_portfolio_value", &Server::toolGetPortfolioValue },
+		DispatchEntry<ToolMethod>{ "set_price_alert", &Server::toolSetPriceAlert },
+		DispatchEntry<ToolMethod>{ "list_achievements", &Server::toolListAchievements },
+		DispatchEntry<ToolMethod>{ "get_achievement_progress", &Server::toolGetAchievementProgress },
+		DispatchEntry<ToolMethod>{ "claim_achievement_reward", &Server::toolClaimAchievementReward },
+		DispatchEntry<ToolMethod>{ "get_leaderboard", &Server::toolGetLeaderboard },
+		DispatchEntry<ToolMethod>{ "share_achievement", &Server::toolShareAchievement },
+		DispatchEntry<ToolMethod>{ "get_achievement_suggestions", &Server::toolGetAchievementSuggestions },
+		DispatchEntry<ToolMethod>{ "create_exclusive_content", &Server::toolCreateExclusiveContent },
+		DispatchEntry<ToolMethod>{ "set_subscriber_tiers", &Server::toolSetSubscriberTiers },
+		DispatchEntry<ToolMethod>{ "send_subscriber_message", &Server::toolSendSubscriberMessage },
+		DispatchEntry<ToolMethod>{ "get_creator_dashboard", &Server::toolGetCreatorDashboard },
+		DispatchEntry<ToolMethod>{ "get_stars_leaderboard", &Server::toolGetStarsLeaderboard },
+
+		// SUBSCRIPTION TOOLS
+		DispatchEntry<ToolMethod>{ "subscribe_to_channel", &Server::toolSubscribeToChannel },
+		DispatchEntry<ToolMethod>{ "unsubscribe_from_channel", &Server::toolUnsubscribeFromChannel },
+		DispatchEntry<ToolMethod>{ "create_giveaway", &Server::toolCreateGiveaway },
+
+		// MINIAPP TOOLS
+		DispatchEntry<ToolMethod>{ "list_miniapp_permissions", &Server::toolListMiniappPermissions },
+		DispatchEntry<ToolMethod>{ "approve_miniapp_spend", &Server::toolApproveMiniappSpend },
+		DispatchEntry<ToolMethod>{ "revoke_miniapp_permission", &Server::toolRevokeMiniappPermission },
+
+		// TESTING TOOLS
+		DispatchEntry<ToolMethod>{ "test_away", &Server::toolTestAway },
+	});
+
+	// JSON-RPC methods answered with a plain successResponse().
+	static constexpr auto kRequests = MakeDispatch(std::array{
+		DispatchEntry<RequestMethod>{ "initialize", &Server::handleInitialize },
+		DispatchEntry<RequestMethod>{ "tools/list", &Server::handleListTools },
+		DispatchEntry<RequestMethod>{ "tools/call", &Server::handleCallTool },
+		DispatchEntry<RequestMethod>{ "resources/list", &Server::handleListResources },
+		DispatchEntry<RequestMethod>{ "resources/read", &Server::handleReadResource },
+		DispatchEntry<RequestMethod>{ "prompts/list", &Server::handleListPrompts },
+		DispatchEntry<RequestMethod>{ "prompts/get", &Server::handleGetPrompt },
+	});
+
+	// JSON-RPC methods answered with an error response when they fail.
+	static constexpr auto kCheckedRequests = MakeDispatch(std::array{
+		DispatchEntry<CheckedRequestMethod>{ "resources/subscribe", &Server::handleSubscribeResource },
+		DispatchEntry<CheckedRequestMethod>{ "resources/unsubscribe", &Server::handleUnsubscribeResource },
+	});
+};
 
 Server::Server(QObject *parent)
 	: QObject(parent) {
@@ -54,7 +614,26 @@ Server::Server(QObject *parent)
 	registerTools();
 	registerResources();
 	registerPrompts();
-	initializeToolHandlers();
+	initializeStreamingToolHandlers();
+	initializeThreadSafeTools();
+
+	auto toolNames = QStringList();
+	toolNames.reserve(_tools.size());
+	for (const auto &tool : _tools) {
+		toolNames.push_back(tool.name);
+	}
+	_metrics = std::make_unique<ToolMetrics>(toolNames);
+
+	assignToolCategories();
+	rebuildToolsListCache();
+	initializeRateLimits();
+	initializeComponentStarters();
+
+	_resourceUpdatesTimer.setSingleShot(true);
+	_resourceUpdatesTimer.setInterval(kResourceUpdatesDelay);
+	connect(&_resourceUpdatesTimer, &QTimer::timeout, this, [=] {
+		sendResourceUpdates();
+	});
 }
 
 Server::~Server() {
@@ -62,10 +641,14 @@ Server::~Server() {
 }
 
 QJsonObject Server::callTool(const QString &toolName, const QJsonObject &args) {
-	// Look up tool in handlers
-	auto it = _toolHandlers.find(toolName);
-	if (it != _toolHandlers.end()) {
-		return it.value()(args);
+	// Look up tool in the dispatch table
+	if (const auto method = Dispatch::kTools.find(toolName)) {
+		const auto trace = Core::Tracing::Scope("mcp", "callTool", toolName);
+		QElapsedTimer timer;
+		timer.start();
+		auto result = (this->*method)(args);
+		recordToolCall(toolName, timer.nsecsElapsed() / 1000, result);
+		return result;
 	}
 
 	// Tool not found
@@ -78,20 +661,28 @@ QJsonObject Server::callTool(const QString &toolName, const QJsonObject &args) {
 void Server::initializeCapabilities() {
 	_serverInfo.capabilities = QJsonObject{
 		{"tools", QJsonObject{{"listChanged", true}}},
-		{"resources", QJsonObject{{"listChanged", true}}},
+		{"resources", QJsonObject{
+			{"subscribe", true},
+			{"listChanged", true},
+		}},
 		{"prompts", QJsonObject{{"listChanged", true}}},
 	};
 }
 
 void Server::registerTools() {
 	_tools = {
-		// ===== CORE TOOLS (6) =====
+		// ===== CORE TOOLS (9) =====
 		Tool{
 			"list_chats",
 			"Get a list of all Telegram chats (direct access to local database)",
 			QJsonObject{
 				{"type", "object"},
-				{"properties", QJsonObject{}},
+				{"properties", QJsonObject{
+					{"since_version", QJsonObject{
+						{"type", "string"},
+						{"description", "Version from a previous result, returns not_modified while it is current"}
+					}}
+				}},
 			}
 		},
 		Tool{
@@ -103,6 +694,10 @@ void Server::registerTools() {
 					{"chat_id", QJsonObject{
 						{"type", "integer"},
 						{"description", "Telegram chat ID"}
+					}},
+					{"since_version", QJsonObject{
+						{"type", "string"},
+						{"description", "Version from a previous result, returns not_modified while it is current"}
 					}}
 				}},
 				{"required", QJsonArray{"chat_id"}},
@@ -127,7 +722,13 @@ void Server::registerTools() {
 						{"type", "integer"},
 						{"description", "Get messages before this timestamp"},
 						{"default", 0}
-					}}
+					}},
+					{"cursor", QJsonObject{
+						{"type", "string"},
+						{"description", "next_cursor of the previous page, overrides before_timestamp"}
+					}},
+					{"fields", MessageProjection::FieldsSchema()},
+					{"format", MessageProjection::FormatSchema()}
 				}},
 				{"required", QJsonArray{"chat_id"}},
 			}
@@ -152,7 +753,7 @@ void Server::registerTools() {
 		},
 		Tool{
 			"search_messages",
-			"Search messages in local database",
+			"Search loaded, archived and cloud messages",
 			QJsonObject{
 				{"type", "object"},
 				{"properties", QJsonObject{
@@ -167,7 +768,14 @@ void Server::registerTools() {
 					{"limit", QJsonObject{
 						{"type", "integer"},
 						{"default", 50}
-					}}
+					}},
+					{"include_cloud", QJsonObject{
+						{"type", "boolean"},
+						{"default", true},
+						{"description", "With chat_id: also search the server, pages that arrive later come as notifications/search_results"}
+					}},
+					{"fields", MessageProjection::FieldsSchema()},
+					{"format", MessageProjection::FormatSchema()}
 				}},
 				{"required", QJsonArray{"query"}},
 			}
@@ -181,16 +789,73 @@ void Server::registerTools() {
 					{"user_id", QJsonObject{
 						{"type", "integer"},
 						{"description", "User ID"}
+					}},
+					{"since_version", QJsonObject{
+						{"type", "string"},
+						{"description", "Version from a previous result, returns not_modified while it is current"}
 					}}
 				}},
 				{"required", QJsonArray{"user_id"}},
 			}
 		},
+		Tool{
+			"list_accounts",
+			"List accounts logged in to this app, pass an account_id to any tool to run it for that account",
+			QJsonObject{
+				{"type", "object"},
+				{"properties", QJsonObject{}},
+			}
+		},
+		Tool{
+			"get_messages",
+			"Get many messages by id across chats in one call. Loaded and archived ones are returned right away, the rest is fetched with one request per chat and sent as notifications/messages_fetched",
+			QJsonObject{
+				{"type", "object"},
+				{"properties", QJsonObject{
+					{"messages", QJsonObject{
+						{"type", "array"},
+						{"items", QJsonObject{
+							{"type", "object"},
+							{"properties", QJsonObject{
+								{"chat_id", QJsonObject{{"type", "integer"}}},
+								{"message_id", QJsonObject{{"type", "integer"}}}
+							}},
+							{"required", QJsonArray{"chat_id", "message_id"}}
+						}},
+						{"description", "Up to 500 (chat_id, message_id) pairs"}
+					}},
+					{"fetch_missing", QJsonObject{
+						{"type", "boolean"},
+						{"default", true},
+						{"description", "Request the ones neither loaded nor archived from the server"}
+					}}
+				}},
+				{"required", QJsonArray{"messages"}},
+			}
+		},
+		Tool{
+			"get_updates",
+			"Get new, edited and deleted messages and changed chats and users since a cursor, across all chats. Call without since_cursor to get the current cursor",
+			QJsonObject{
+				{"type", "object"},
+				{"properties", QJsonObject{
+					{"since_cursor", QJsonObject{
+						{"type", "string"},
+						{"description", "cursor of the previous get_updates result"}
+					}},
+					{"limit", QJsonObject{
+						{"type", "integer"},
+						{"default", 500},
+						{"description", "Changes read at most, has_more tells if there are more"}
+					}}
+				}},
+			}
+		},
 
 		// ===== ARCHIVE TOOLS (7) =====
 		Tool{
 			"archive_chat",
-			"Archive all messages from a chat to the local database",
+			"Archive server history of a chat to the local database in the background (resumes after restart)",
 			QJsonObject{
 				{"type", "object"},
 				{"properties", QJsonObject{
@@ -225,6 +890,18 @@ void Server::registerTools() {
 					{"output_path", QJsonObject{
 						{"type", "string"},
 						{"description", "Output file path"}
+					}},
+					{"compress", QJsonObject{
+						{"type", "boolean"},
+						{"description", "Write gzip-compressed output (default: false)"}
+					}},
+					{"limit", QJsonObject{
+						{"type", "integer"},
+						{"description", "Stop after this many messages, jsonl/csv only (default: no limit)"}
+					}},
+					{"cursor", QJsonObject{
+						{"type", "string"},
+						{"description", "Cursor returned by a previous partial export, appends to output_path"}
 					}}
 				}},
 				{"required", QJsonArray{"chat_id", "format", "output_path"}},
@@ -302,13 +979,13 @@ void Server::registerTools() {
 		},
 		Tool{
 			"search_archive",
-			"Search archived messages (faster than live search)",
+			"Full-text search of archived messages, ranked by relevance with highlighted snippets",
 			QJsonObject{
 				{"type", "object"},
 				{"properties", QJsonObject{
 					{"query", QJsonObject{
 						{"type", "string"},
-						{"description", "Search query"}
+						{"description", "Search terms, all must match. Use term* for prefixes and \"quoted phrases\""}
 					}},
 					{"chat_id", QJsonObject{
 						{"type", "integer"},
@@ -317,7 +994,9 @@ void Server::registerTools() {
 					{"limit", QJsonObject{
 						{"type", "integer"},
 						{"default", 50}
-					}}
+					}},
+					{"fields", MessageProjection::FieldsSchema()},
+					{"format", MessageProjection::FormatSchema()}
 				}},
 				{"required", QJsonArray{"query"}},
 			}
@@ -336,6 +1015,122 @@ void Server::registerTools() {
 				{"required", QJsonArray{"days_to_keep"}},
 			}
 		},
+		Tool{
+			"tier_archive",
+			"Move text of old archived messages into compressed cold storage",
+			QJsonObject{
+				{"type", "object"},
+				{"properties", QJsonObject{
+					{"older_than_days", QJsonObject{
+						{"type", "integer"},
+						{"description", "Move messages older than N days"}
+					}}
+				}},
+				{"required", QJsonArray{"older_than_days"}},
+			}
+		},
+		Tool{
+			"configure_media_archive",
+			"Download media of archived messages in the background, deduplicated by content, when nothing else is downloading",
+			QJsonObject{
+				{"type", "object"},
+				{"properties", QJsonObject{
+					{"chat_id", QJsonObject{
+						{"type", "integer"},
+						{"description", "Chat ID, 0 = default of chats without their own policy"},
+						{"default", 0}
+					}},
+					{"enabled", QJsonObject{
+						{"type", "boolean"},
+						{"description", "Archive media of this chat"}
+					}},
+					{"max_file_size_mb", QJsonObject{
+						{"type", "number"},
+						{"description", "Skip larger files (0 = no limit)"},
+						{"default", 0}
+					}},
+					{"max_chat_mb", QJsonObject{
+						{"type", "number"},
+						{"description", "Stop when the chat's archived media reaches this size (0 = no limit)"},
+						{"default", 0}
+					}},
+					{"types", QJsonObject{
+						{"type", "array"},
+						{"items", QJsonObject{
+							{"type", "string"},
+							{"enum", QJsonArray{"photo", "video", "voice", "audio", "document", "sticker", "animation"}}
+						}},
+						{"description", "Media types to archive (default: all)"}
+					}},
+					{"rate_kbps", QJsonObject{
+						{"type", "number"},
+						{"description", "Download rate of the archiver for this run in KB/s, applies to every chat (0 = no limit)"}
+					}}
+				}},
+				{"required", QJsonArray{"enabled"}},
+			}
+		},
+		Tool{
+			"get_media_archive_status",
+			"Get progress, deduplication and policies of the background media archiver",
+			QJsonObject{
+				{"type", "object"},
+				{"properties", QJsonObject{}},
+			}
+		},
+		Tool{
+			"get_chat_members",
+			"List members of a supergroup or channel from the local participant cache, refreshed in the background",
+			QJsonObject{
+				{"type", "object"},
+				{"properties", QJsonObject{
+					{"chat_id", QJsonObject{
+						{"type", "integer"},
+						{"description", "Supergroup or channel ID"}
+					}},
+					{"type", QJsonObject{
+						{"type", "string"},
+						{"enum", QJsonArray{"creator", "admin", "member", "restricted"}},
+						{"description", "Only members of this type"}
+					}},
+					{"offset", QJsonObject{
+						{"type", "integer"},
+						{"description", "Members to skip (default: 0)"}
+					}},
+					{"limit", QJsonObject{
+						{"type", "integer"},
+						{"description", "Max members to return, up to 1000 (default: 100)"}
+					}},
+					{"refresh", QJsonObject{
+						{"type", "boolean"},
+						{"description", "Refresh the cached list now (default: false)"}
+					}},
+				}},
+				{"required", QJsonArray{"chat_id"}},
+			}
+		},
+		Tool{
+			"search_chat_members",
+			"Find members of a supergroup or channel by name or username prefix in the local participant cache",
+			QJsonObject{
+				{"type", "object"},
+				{"properties", QJsonObject{
+					{"chat_id", QJsonObject{
+						{"type", "integer"},
+						{"description", "Supergroup or channel ID"}
+					}},
+					{"query", QJsonObject{
+						{"type", "string"},
+						{"description", "Beginnings of the name or username words"}
+					}},
+					{"limit", QJsonObject{
+						{"type", "integer"},
+						{"description", "Max members to return (default: 20)"}
+					}},
+				}},
+				{"required", QJsonArray{"chat_id", "query"}},
+			}
+		},
 
 		// ===== ANALYTICS TOOLS (8) =====
 		Tool{
@@ -477,8 +1272,63 @@ void Server::registerTools() {
 				{"required", QJsonArray{"chat_id"}},
 			}
 		},
+		Tool{
+			"rebuild_analytics",
+			"Recompute analytics rollups from archived messages",
+			QJsonObject{
+				{"type", "object"},
+				{"properties", QJsonObject{
+					{"chat_id", QJsonObject{
+						{"type", "integer"},
+						{"description", "Chat ID (omit to rebuild every chat)"}
+					}}
+				}},
+			}
+		},
+		Tool{
+			"get_unique_users",
+			"Estimate distinct active users and the most active users (and chats) over recent days",
+			QJsonObject{
+				{"type", "object"},
+				{"properties", QJsonObject{
+					{"chat_id", QJsonObject{
+						{"type", "integer"},
+						{"description", "Chat ID (omit for all chats)"},
+						{"default", 0}
+					}},
+					{"days_back", QJsonObject{
+						{"type", "integer"},
+						{"default", 90}
+					}},
+					{"limit", QJsonObject{
+						{"type", "integer"},
+						{"description", "Top users and chats to return"},
+						{"default", 10}
+					}}
+				}},
+			}
+		},
+		Tool{
+			"get_channel_statistics",
+			"Get server-side statistics of a channel or supergroup (members, views, shares and their graphs)",
+			QJsonObject{
+				{"type", "object"},
+				{"properties", QJsonObject{
+					{"chat_id", QJsonObject{
+						{"type", "integer"},
+						{"description", "Channel or supergroup ID"}
+					}},
+					{"include_graphs", QJsonObject{
+						{"type", "boolean"},
+						{"description", "Add the daily graph points"},
+						{"default", false}
+					}}
+				}},
+				{"required", QJsonArray{"chat_id"}}
+			}
+		},
 
-		// ===== SEMANTIC SEARCH TOOLS (5) =====
+		// ===== SEMANTIC SEARCH TOOLS (6) =====
 		Tool{
 			"semantic_search",
 			"Search messages by meaning (AI-powered)",
@@ -505,6 +1355,62 @@ void Server::registerTools() {
 				{"required", QJsonArray{"query"}},
 			}
 		},
+		Tool{
+			"hybrid_search",
+			"Search messages by keywords and meaning at once, ranks fused",
+			QJsonObject{
+				{"type", "object"},
+				{"properties", QJsonObject{
+					{"query", QJsonObject{
+						{"type", "string"},
+						{"description", "Search query"}
+					}},
+					{"chat_id", QJsonObject{
+						{"type", "integer"},
+						{"description", "Optional: limit to chat"}
+					}},
+					{"user_id", QJsonObject{
+						{"type", "integer"},
+						{"description", "Optional: limit to sender"}
+					}},
+					{"start_date", QJsonObject{
+						{"type", "integer"},
+						{"description", "Optional: unix time, inclusive"}
+					}},
+					{"end_date", QJsonObject{
+						{"type", "integer"},
+						{"description", "Optional: unix time, inclusive"}
+					}},
+					{"limit", QJsonObject{
+						{"type", "integer"},
+						{"default", 20}
+					}},
+					{"min_similarity", QJsonObject{
+						{"type", "number"},
+						{"default", 0.3}
+					}}
+				}},
+				{"required", QJsonArray{"query"}},
+			}
+		},
+		Tool{
+			"get_chat_context",
+			"Get the recent messages of a chat with related archived messages",
+			QJsonObject{
+				{"type", "object"},
+				{"properties", QJsonObject{
+					{"chat_id", QJsonObject{
+						{"type", "integer"},
+						{"description", "Chat ID"}
+					}},
+					{"limit", QJsonObject{
+						{"type", "integer"},
+						{"description", "Optional: newest messages returned, the whole window by default"}
+					}}
+				}},
+				{"required", QJsonArray{"chat_id"}},
+			}
+		},
 		Tool{
 			"index_messages",
 			"Index messages for semantic search",
@@ -519,6 +1425,11 @@ void Server::registerTools() {
 						{"type", "integer"},
 						{"description", "Max messages to index (-1 = all)"},
 						{"default", 1000}
+					}},
+					{"rebuild", QJsonObject{
+						{"type", "boolean"},
+						{"description", "Drop and recompute the chat's embeddings"},
+						{"default", false}
 					}}
 				}},
 				{"required", QJsonArray{"chat_id"}},
@@ -537,6 +1448,19 @@ void Server::registerTools() {
 					{"num_topics", QJsonObject{
 						{"type", "integer"},
 						{"default", 5}
+					}},
+					{"start_date", QJsonObject{
+						{"type", "integer"},
+						{"description", "Only count messages from this unix time"}
+					}},
+					{"end_date", QJsonObject{
+						{"type", "integer"},
+						{"description", "Only count messages up to this unix time"}
+					}},
+					{"retrain", QJsonObject{
+						{"type", "boolean"},
+						{"description", "Train the topics again instead of updating them"},
+						{"default", false}
 					}}
 				}},
 				{"required", QJsonArray{"chat_id"}},
@@ -551,9 +1475,12 @@ void Server::registerTools() {
 					{"text", QJsonObject{
 						{"type", "string"},
 						{"description", "Message text to classify"}
+					}},
+					{"chat_id", QJsonObject{
+						{"type", "integer"},
+						{"description", "Instead of text: intent distribution of the archived chat, 0 for all chats"}
 					}}
 				}},
-				{"required", QJsonArray{"text"}},
 			}
 		},
 		Tool{
@@ -565,9 +1492,12 @@ void Server::registerTools() {
 					{"text", QJsonObject{
 						{"type", "string"},
 						{"description", "Text to analyze"}
+					}},
+					{"chat_id", QJsonObject{
+						{"type", "integer"},
+						{"description", "Instead of text: entity statistics of the archived chat, 0 for all chats"}
 					}}
 				}},
-				{"required", QJsonArray{"text"}},
 			}
 		},
 
@@ -881,7 +1811,7 @@ void Server::registerTools() {
 			}
 		},
 
-		// ===== SYSTEM TOOLS (4) =====
+		// ===== SYSTEM TOOLS (13) =====
 		Tool{
 			"get_cache_stats",
 			"Get cache statistics",
@@ -923,38 +1853,210 @@ void Server::registerTools() {
 				{"properties", QJsonObject{}},
 			}
 		},
-
-		// ===== VOICE TOOLS (2) =====
 		Tool{
-			"transcribe_voice",
-			"Transcribe a voice message",
+			"get_metrics",
+			"Get per-tool call counts, error rates, bytes out and latency percentiles",
 			QJsonObject{
 				{"type", "object"},
 				{"properties", QJsonObject{
-					{"message_id", QJsonObject{
-						{"type", "integer"},
-						{"description", "Voice message ID"}
-					}},
-					{"audio_path", QJsonObject{
+					{"tool", QJsonObject{
 						{"type", "string"},
-						{"description", "Path to audio file"}
-					}}
-				}},
+						{"description", "Report a single tool only"}
+					}},
+					{"limit", QJsonObject{
+						{"type", "integer"},
+						{"description", "Number of tools with the highest total time to report"}
+					}}
+				}},
+			}
+		},
+		Tool{
+			"get_network_stats",
+			"Get per-session MTProto traffic, response times, resends and queue depths",
+			QJsonObject{
+				{"type", "object"},
+				{"properties", QJsonObject{
+					{"dc_id", QJsonObject{
+						{"type", "integer"},
+						{"description", "Report the sessions of a single datacenter only"}
+					}}
+				}},
+			}
+		},
+		Tool{
+			"profile_session",
+			"Fill the session with a synthetic large account and time dialogs sorting, history load, chat filter recompute and unread aggregation, needs MCP_SESSION_PROFILER=1",
+			QJsonObject{
+				{"type", "object"},
+				{"properties", QJsonObject{
+					{"dialogs", QJsonObject{
+						{"type", "integer"},
+						{"description", "Generated dialogs, half private chats"},
+						{"default", 3000}
+					}},
+					{"folders", QJsonObject{
+						{"type", "integer"},
+						{"description", "Generated chat filters"},
+						{"default", 200}
+					}},
+					{"messages_per_dialog", QJsonObject{
+						{"type", "integer"},
+						{"default", 100}
+					}},
+					{"seed", QJsonObject{
+						{"type", "integer"},
+						{"default", 1}
+					}},
+					{"benchmarks", QJsonObject{
+						{"type", "array"},
+						{"items", QJsonObject{{"type", "string"}}},
+						{"description", "dialogs_sort, history_load, filter_recompute, unread_aggregation, all by default"}
+					}},
+					{"iterations", QJsonObject{
+						{"type", "integer"},
+						{"default", 20}
+					}}
+				}},
+			}
+		},
+		Tool{
+			"start_trace",
+			"Start capturing a Chrome trace of the main thread, MTProto, storage, async tasks and MCP tool calls",
+			QJsonObject{
+				{"type", "object"},
+				{"properties", QJsonObject{
+					{"path", QJsonObject{
+						{"type", "string"},
+						{"description", "Output file, a timestamped file in the temp directory by default"}
+					}},
+					{"max_events", QJsonObject{
+						{"type", "integer"},
+						{"description", "Events past this limit are dropped"},
+						{"default", 1000000}
+					}}
+				}},
+			}
+		},
+		Tool{
+			"stop_trace",
+			"Stop the capture and write the trace for chrome://tracing or ui.perfetto.dev",
+			QJsonObject{
+				{"type", "object"},
+				{"properties", QJsonObject{}},
+			}
+		},
+		Tool{
+			"start_job",
+			"Run a tool in the background and return a job_id at once, for long ones like export_chat, archive_chat or index_messages. Progress comes as notifications/progress when the call has a progressToken",
+			QJsonObject{
+				{"type", "object"},
+				{"properties", QJsonObject{
+					{"tool", QJsonObject{
+						{"type", "string"},
+						{"description", "Name of the tool to run"}
+					}},
+					{"arguments", QJsonObject{
+						{"type", "object"},
+						{"description", "Arguments of the tool"}
+					}},
+					{"progress_token", QJsonObject{
+						{"description", "Token of the progress notifications, _meta.progressToken of the call by default"}
+					}}
+				}},
+				{"required", QJsonArray{"tool"}}
+			}
+		},
+		Tool{
+			"get_job",
+			"Get the state and progress of a job, and its result page by page once finished",
+			QJsonObject{
+				{"type", "object"},
+				{"properties", QJsonObject{
+					{"job_id", QJsonObject{
+						{"type", "string"}
+					}},
+					{"offset", QJsonObject{
+						{"type", "integer"},
+						{"description", "First element of the paged result list"},
+						{"default", 0}
+					}},
+					{"limit", QJsonObject{
+						{"type", "integer"},
+						{"description", "Elements of the paged result list, up to 1000"},
+						{"default", 100}
+					}}
+				}},
+				{"required", QJsonArray{"job_id"}}
+			}
+		},
+		Tool{
+			"cancel_job",
+			"Cancel a job, it stops after its current step and keeps the partial result",
+			QJsonObject{
+				{"type", "object"},
+				{"properties", QJsonObject{
+					{"job_id", QJsonObject{
+						{"type", "string"}
+					}}
+				}},
+				{"required", QJsonArray{"job_id"}}
+			}
+		},
+		Tool{
+			"list_jobs",
+			"List running and recently finished jobs",
+			QJsonObject{
+				{"type", "object"},
+				{"properties", QJsonObject{}},
+			}
+		},
+
+		// ===== VOICE TOOLS (2) =====
+		Tool{
+			"transcribe_voice",
+			"Queue a voice message for transcription, poll get_transcription with the job_id",
+			QJsonObject{
+				{"type", "object"},
+				{"properties", QJsonObject{
+					{"message_id", QJsonObject{
+						{"type", "integer"},
+						{"description", "Voice message ID"}
+					}},
+					{"chat_id", QJsonObject{
+						{"type", "integer"},
+						{"description", "Chat of the voice message"}
+					}},
+					{"document_id", QJsonObject{
+						{"type", "string"},
+						{"description", "Voice document ID, a known one is answered from cache"}
+					}},
+					{"audio_path", QJsonObject{
+						{"type", "string"},
+						{"description", "Path to audio file"}
+					}}
+				}},
 				{"required", QJsonArray{"audio_path"}},
 			}
 		},
 		Tool{
 			"get_transcription",
-			"Get stored transcription for a message",
+			"Get a transcription job status or the stored transcription for a message",
 			QJsonObject{
 				{"type", "object"},
 				{"properties", QJsonObject{
+					{"job_id", QJsonObject{
+						{"type", "string"},
+						{"description", "Job ID from transcribe_voice"}
+					}},
 					{"message_id", QJsonObject{
 						{"type", "integer"},
 						{"description", "Message ID"}
+					}},
+					{"document_id", QJsonObject{
+						{"type", "string"},
+						{"description", "Voice document ID"}
 					}}
 				}},
-				{"required", QJsonArray{"message_id"}},
 			}
 		},
 
@@ -1236,8 +2338,16 @@ void Server::registerTools() {
 		},
 		Tool{
 			"execute_chat_rules",
-			"Manually execute chat rules",
-			QJsonObject{{"type", "object"}, {"properties", QJsonObject{}}}
+			"Run the compiled chat rules over a message text and return the matching rules with their actions",
+			QJsonObject{
+				{"type", "object"},
+				{"properties", QJsonObject{
+					{"chat_id", QJsonObject{{"type", "integer"}, {"description", "Chat ID, rules of chat 0 apply to every chat"}}},
+					{"message", QJsonObject{{"type", "string"}, {"description", "Message text"}}},
+					{"rule_type", QJsonObject{{"type", "string"}, {"description", "Only rules of this type"}}}
+				}},
+				{"required", QJsonArray{"message"}}
+			}
 		},
 		Tool{
 			"delete_chat_rule",
@@ -1552,7 +2662,8 @@ void Server::registerTools() {
 				{"type", "object"},
 				{"properties", QJsonObject{
 					{"chat_id", QJsonObject{{"type", "integer"}, {"description", "Chat ID"}}},
-					{"text", QJsonObject{{"type", "string"}, {"description", "Text to speak"}}}
+					{"text", QJsonObject{{"type", "string"}, {"description", "Text to speak"}}},
+					{"persona", QJsonObject{{"type", "string"}, {"description", "Voice persona name"}, {"default", "default"}}}
 				}},
 				{"required", QJsonArray{"chat_id", "text"}}
 			}
@@ -2134,7 +3245,7 @@ void Server::registerTools() {
 			QJsonObject{
 				{"type", "object"},
 				{"properties", QJsonObject{
-					{"period", QJsonObject{{"type", "string"}, {"description", "day, week, month"}}}
+					{"period", QJsonObject{{"type", "string"}, {"description", "day, week, month"}, {"default", "week"}}}
 				}}
 			}
 		},
@@ -2363,7 +3474,7 @@ void Server::registerTools() {
 			QJsonObject{
 				{"type", "object"},
 				{"properties", QJsonObject{
-					{"strategy", QJsonObject{{"type", "object"}, {"description", "Strategy parameters"}}},
+					{"strategy", QJsonObject{{"type", "object"}, {"description", "Moving average crossover: gift_type (id or title), short_window, long_window in samples"}}},
 					{"start_date", QJsonObject{{"type", "integer"}}},
 					{"end_date", QJsonObject{{"type", "integer"}}}
 				}},
@@ -2426,6 +3537,60 @@ void Server::registerTools() {
 	};
 }
 
+void Server::assignToolCategories() {
+	// registerTools() lists tools in sections, each pair names the first
+	// tool of a section and the category shared by the tools that follow.
+	const auto sections = std::vector<std::pair<QString, QString>>{
+		{ "list_chats", "core" },
+		{ "archive_chat", "archive" },
+		{ "get_message_stats", "analytics" },
+		{ "semantic_search", "semantic" },
+		{ "edit_message", "messages" },
+		{ "batch_send", "batch" },
+		{ "schedule_message", "scheduler" },
+		{ "get_cache_stats", "system" },
+		{ "transcribe_voice", "voice" },
+		{ "list_bots", "bots" },
+		{ "transcribe_voice_message", "premium" },
+		{ "create_quick_reply", "business" },
+		{ "get_wallet_balance", "wallet" },
+		{ "list_star_gifts", "stars" },
+	};
+	auto category = QString("core");
+	for (auto &tool : _tools) {
+		for (const auto &[first, name] : sections) {
+			if (tool.name == first) {
+				category = name;
+				break;
+			}
+		}
+		tool.category = category;
+	}
+}
+
+void Server::rebuildToolsListCache() {
+	// tools/list is requested on every reconnect by some clients, build
+	// its entries and the serialized full response only once.
+	_toolEntries.clear();
+	_toolEntries.reserve(_tools.size());
+	auto tools = QJsonArray();
+	for (const auto &tool : _tools) {
+		auto entry = QJsonObject{
+			{"name", tool.name},
+			{"description", tool.description},
+			{"inputSchema", tool.inputSchema},
+		};
+		if (_threadSafeTools.contains(tool.name)) {
+			entry["annotations"] = QJsonObject{{"readOnlyHint", true}};
+		}
+		_toolEntries.push_back(entry);
+		tools.append(entry);
+	}
+	_toolsListResult = QJsonObject{{"tools", tools}};
+	_toolsListBytes = QJsonDocument(_toolsListResult).toJson(
+		QJsonDocument::Compact);
+}
+
 void Server::registerResources() {
 	_resources = {
 		Resource{
@@ -2491,37 +3656,85 @@ bool Server::start(TransportType transport) {
 
 	_transport = transport;
 
-	// Set database path
-	_databasePath = QDir::home().filePath("telegram_mcp.db");
+	// Set database path, benchmarks point it to a synthetic archive
+	const auto databasePath = QString::fromUtf8(qgetenv("MCP_DATABASE_PATH"));
+	_databasePath = !databasePath.isEmpty()
+		? databasePath
+		: QDir::home().filePath("telegram_mcp.db");
+
+	// One serialized writer and a read-only connection per worker
+	_dbPool = std::make_unique<DatabasePool>(
+		_databasePath,
+		std::clamp(QThread::idealThreadCount(), 2, 8));
+	if (!_dbPool->open()) {
+		qWarning() << "MCP: Failed to open database pool";
+		_dbPool = nullptr;
+		return false;
+	}
 
-	// Initialize database
+	// Server-level tools still use their own connection, it waits for
+	// the pool writer instead of failing with SQLITE_BUSY
 	_db = QSqlDatabase::addDatabase("QSQLITE", "mcp_main");
 	_db.setDatabaseName(_databasePath);
+	_db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
 	if (!_db.open()) {
 		qWarning() << "MCP: Failed to open database:" << _db.lastError().text();
 		return false;
 	}
 
+	_tagIndex = std::make_unique<TagIndex>(_db);
+	_tagIndex->initialize();
+	_chatRules = std::make_unique<ChatRules>(_db);
+	_chatRules->initialize();
+	_voiceSynthesis = std::make_unique<VoiceSynthesis>(_db);
+	_voiceSynthesis->initialize();
+
 	fprintf(stderr, "[MCP] Database initialized successfully\n");
 	fflush(stderr);
 
 	// Initialize session-independent components only
 	_auditLogger.reset(new AuditLogger(this));
-	_auditLogger->start(&_db, QDir::home().filePath("telegram_mcp_audit.log"));
+	_auditLogger->start(_dbPool.get(), QDir::home().filePath("telegram_mcp_audit.log"));
 
 	_rbac.reset(new RBAC(this));
-	_rbac->start(&_db);
+	_rbac->start(_dbPool.get());
+	{
+		// RBAC tool ids are the dispatch table positions.
+		auto toolIds = QStringList();
+		for (const auto &entry : Dispatch::kTools.entries()) {
+			toolIds.push_back(QString::fromLatin1(
+				entry.name.data(),
+				qsizetype(entry.name.size())));
+		}
+		_rbac->compileToolPermissions(toolIds);
+	}
 
 	fprintf(stderr, "[MCP] Session-independent components initialized (AuditLogger, RBAC)\n");
 	fflush(stderr);
 
+	// Worker pool for read-only archive/analytics tools
+	_toolPool = std::make_unique<QThreadPool>();
+	_toolPool->setMaxThreadCount(_dbPool->readerCount());
+	_toolPool->setObjectName("mcp_tool_pool");
+	// Each worker keeps its reader connection and prepared statements
+	// until it exits, so idle workers are not expired and replaced.
+	_toolPool->setExpiryTimeout(-1);
+
+	_jobQueue = std::make_unique<JobQueue>([=](
+			const QString &method,
+			const QJsonObject &params) {
+		sendNotification(method, params);
+	});
+
 	// Start transport (this allows JSON-RPC to work even without session)
 	switch (_transport) {
 	case TransportType::Stdio:
 		startStdioTransport();
 		break;
 	case TransportType::HTTP:
-		startHttpTransport();
+		if (!startHttpTransport(_httpPort)) {
+			return false;
+		}
 		break;
 	default:
 		qWarning() << "MCP: Unsupported transport type";
@@ -2554,6 +3767,24 @@ void Server::stop() {
 
 	_auditLogger->logSystemEvent("server_stop", "MCP Server stopping");
 
+	_deferredStartTimer.stop();
+	_resourceUpdatesTimer.stop();
+	_resourceUpdatesLifetime.destroy();
+
+	// Workers use the archiver and analytics, let them finish first
+	_jobQueue.reset();
+	if (_toolPool) {
+		_toolPool->clear();
+		_toolPool->waitForDone();
+		_toolPool.reset();
+	}
+
+	// Its related lookups read the archive as well
+	if (_botManager) {
+		_botManager->setContextBuilder(nullptr);
+	}
+	_contextBuilder.reset();
+
 	// Cleanup components (using reset() for unique_ptr members)
 	if (_archiver) {
 		_archiver->stop();
@@ -2565,9 +3796,26 @@ void Server::stop() {
 		_ephemeralArchiver.reset();
 	}
 
+	if (_cache) {
+		_cache->unsubscribe();
+	}
+	if (_peerSnapshots) {
+		_peerSnapshots->unsubscribe();
+	}
+	if (_chatRules) {
+		_chatRules->unsubscribe();
+	}
+
 	_analytics.reset();
 	_semanticSearch.reset();
+	_liveIndex.reset();
+	_cloudSearch.reset();
+	_translation.reset();
 	_batchOps.reset();
+	_walletSync.reset();
+	_giftPrices.reset();
+	_changeLog.reset();
+	_sessionProfiler.reset();
 
 	if (_scheduler) {
 		_scheduler->stop();
@@ -2584,11 +3832,26 @@ void Server::stop() {
 		_rbac.reset();
 	}
 
+	// Runs the audit inserts still queued on the writer
+	if (_dbPool) {
+		_dbPool->close();
+		_dbPool.reset();
+	}
+	_tagIndex.reset();
+	_chatRules.reset();
+	_voiceSynthesis.reset();
+	StatementCache::instance().forget(_db.connectionName());
 	_db.close();
 
-	_stdin.reset();
+	if (_stdioReader) {
+		_stdioReader->stop();
+		_stdioReader.reset();
+	}
 	_stdout.reset();
-	_httpServer.reset();
+	if (_http) {
+		_http->stop();
+		_http.reset();
+	}
 
 	_initialized = false;
 	qInfo() << "MCP Server stopped";
@@ -2605,6 +3868,14 @@ void Server::setSession(Main::Session *session) {
 		return;
 	}
 
+	// Workers may still be querying the components replaced below
+	if (_jobQueue) {
+		_jobQueue->stop();
+	}
+	if (_toolPool) {
+		_toolPool->waitForDone();
+	}
+
 	// Initialize session-dependent components
 	fprintf(stderr, "[MCP] Initializing session-dependent components...\n");
 	fflush(stderr);
@@ -2613,27 +3884,41 @@ void Server::setSession(Main::Session *session) {
 	_cache.reset(new CacheManager(this));
 	_cache->setMaxSize(50);  // 50 MB cache
 	_cache->setDefaultTTL(300);  // 5 minutes TTL
+	_cache->subscribe(_session);  // Session updates invalidate exact keys
 	fprintf(stderr, "[MCP] CacheManager initialized (50MB, 300s TTL)\n");
 	fflush(stderr);
 
-	// ChatArchiver - requires database
+	// PeerSnapshots - entries are built when a tool first reads them
+	_peerSnapshots = std::make_unique<PeerSnapshots>();
+	_peerSnapshots->subscribe(_session);
+
+	// Components started on demand for the previous session use the
+	// ones replaced below
+	_deferredStartTimer.stop();
+	_sessionProfiler = nullptr;
+	_botManager = nullptr;
+	_batchOps = nullptr;
+	_translation = nullptr;
+	_walletSync = nullptr;
+	_giftPrices = nullptr;
+	_contextBuilder = nullptr;
+	_semanticSearch = nullptr;
+	_ephemeralArchiver = nullptr;
+
+	// ChatArchiver - requires database, the schema is checked on the pool
+	// writer and the components depending on it start when it is done
 	_archiver.reset(new ChatArchiver(this));
-	if (!_archiver->start(_databasePath)) {
-		qWarning() << "MCP: Failed to start ChatArchiver";
-		fprintf(stderr, "[MCP] WARNING: ChatArchiver failed to start\n");
-		fflush(stderr);
-		// Don't return - continue with other components
-	} else {
-		fprintf(stderr, "[MCP] ChatArchiver initialized\n");
-		fflush(stderr);
-	}
+	_archiver->start(_dbPool.get(), [=](bool started) {
+		archiverStarted(started);
+	});
 
-	// EphemeralArchiver - depends on ChatArchiver
-	if (_archiver) {
-		_ephemeralArchiver.reset(new EphemeralArchiver(this));
-		_ephemeralArchiver->start(_archiver.get());
-		fprintf(stderr, "[MCP] EphemeralArchiver initialized\n");
-		fflush(stderr);
+	// ChangeLog - the previous one stores its last events first, the
+	// sequence continues from them. Its table is created by the schema
+	// job queued above
+	_changeLog = nullptr;
+	_changeLog = std::make_unique<ChangeLog>();
+	if (!_dbPool || !_changeLog->start(_session, _dbPool.get())) {
+		qWarning() << "MCP: Failed to start ChangeLog";
 	}
 
 	// Analytics - requires session data
@@ -2642,19 +3927,19 @@ void Server::setSession(Main::Session *session) {
 	fprintf(stderr, "[MCP] Analytics initialized\n");
 	fflush(stderr);
 
-	// SemanticSearch - depends on ChatArchiver
-	if (_archiver) {
-		_semanticSearch.reset(new SemanticSearch(_archiver.get(), this));
-		_semanticSearch->initialize();
-		fprintf(stderr, "[MCP] SemanticSearch initialized\n");
-		fflush(stderr);
+	_liveIndex = std::make_unique<LiveSearchIndex>(&_session->data());
+	if (_chatRules) {
+		_chatRules->subscribe(_session);  // Auto-replies on incoming messages
 	}
+	_cloudSearch = std::make_unique<CloudSearch>(this);
 
-	// BatchOperations - requires session
-	_batchOps.reset(new BatchOperations(this));
-	_batchOps->start(_session);
-	fprintf(stderr, "[MCP] BatchOperations initialized\n");
-	fflush(stderr);
+	// ContextBuilder - windows of active chats, related hits from
+	// SemanticSearch once ensureSemanticSearch() started it
+	_contextBuilder = std::make_unique<ContextBuilder>(nullptr);
+	_contextBuilder->subscribe(_session);
+
+	// Pushes of resources the client subscribed to before a relogin
+	subscribeResourceUpdates();
 
 	// MessageScheduler - requires session
 	_scheduler.reset(new MessageScheduler(this));
@@ -2662,29 +3947,10 @@ void Server::setSession(Main::Session *session) {
 	fprintf(stderr, "[MCP] MessageScheduler initialized\n");
 	fflush(stderr);
 
-	// BotManager - depends on all other components
-	if (_archiver && _analytics && _semanticSearch && _scheduler && _auditLogger && _rbac) {
-		_botManager.reset(new BotManager(this));
-		_botManager->initialize(
-			_archiver.get(),
-			_analytics.get(),
-			_semanticSearch.get(),
-			_scheduler.get(),
-			_auditLogger.get(),
-			_rbac.get()
-		);
-
-		// Load and register built-in bots
-		_botManager->discoverBots();
-
-		// Register and start the Context Assistant Bot (example)
-		auto *contextBot = new ContextAssistantBot(_botManager.get());
-		_botManager->registerBot(contextBot);
-		_botManager->startBot("context_assistant");
-
-		fprintf(stderr, "[MCP] BotManager initialized and bots started\n");
-		fflush(stderr);
-	}
+	// SemanticSearch and BatchOperations start on the first call of their
+	// tools, translation and bots a while after login or on the first
+	// call, whichever comes first. See ensureComponents().
+	_deferredStartTimer.start(kDeferredStartDelay);
 
 	if (_auditLogger) {
 		_auditLogger->logSystemEvent("session_connected", "MCP Server session-dependent components initialized successfully");
@@ -2692,7 +3958,7 @@ void Server::setSession(Main::Session *session) {
 
 	fprintf(stderr, "[MCP] ========================================\n");
 	fprintf(stderr, "[MCP] SESSION CONNECTED SUCCESSFULLY\n");
-	fprintf(stderr, "[MCP] All components initialized and ready\n");
+	fprintf(stderr, "[MCP] Core components initialized, others start on demand\n");
 	fprintf(stderr, "[MCP] Live Telegram data access enabled\n");
 	fprintf(stderr, "[MCP] ========================================\n");
 	fflush(stderr);
@@ -2700,610 +3966,781 @@ void Server::setSession(Main::Session *session) {
 	qInfo() << "MCP: Session set, live data access enabled";
 }
 
-void Server::startStdioTransport() {
-	_stdin.reset(new QTextStream(stdin));
-	_stdout.reset(new QTextStream(stdout));
+void Server::archiverStarted(bool started) {
+	if (!started) {
+		qWarning() << "MCP: Failed to start ChatArchiver";
+		fprintf(stderr, "[MCP] WARNING: ChatArchiver failed to start\n");
+		fflush(stderr);
+		return;
+	}
+	_archiver->setDataSession(&_session->data());
+	fprintf(stderr, "[MCP] ChatArchiver initialized\n");
+	fflush(stderr);
 
-	fprintf(stderr, "[MCP] Stdio transport started, polling stdin every 100ms\n");
+	// EphemeralArchiver - depends on ChatArchiver
+	_ephemeralArchiver.reset(new EphemeralArchiver(this));
+	_ephemeralArchiver->start(_archiver.get());
+	fprintf(stderr, "[MCP] EphemeralArchiver initialized\n");
 	fflush(stderr);
 
-	// Use a timer to poll stdin
-	QTimer *timer = new QTimer(this);
-	connect(timer, &QTimer::timeout, this, &Server::handleStdioInput);
-	timer->start(100); // Poll every 100ms
+	if (!_deferredStartTimer.isActive()) {
+		// The deferred start couldn't start these without the archive.
+		ensureBotManager();
+		ensureWalletSync();
+	}
 }
 
-void Server::handleStdioInput() {
-	if (!_stdin->atEnd()) {
-		QString line = _stdin->readLine();
-
-		if (line.isEmpty()) {
-			return;
+void Server::initializeComponentStarters() {
+	// Tools by the component they need started, see ensureComponents().
+	const auto starters = QHash<QString, ComponentStarter>{
+		{ "semantic", &Server::ensureSemanticSearch },
+		{ "batch", &Server::ensureBatchOperations },
+		{ "bots", &Server::ensureBotManager },
+		{ "wallet", &Server::ensureWalletSync },
+	};
+	for (const auto &tool : _tools) {
+		if (const auto starter = starters.value(tool.category)) {
+			_componentStarters.insert(tool.name, starter);
 		}
-
-		fprintf(stderr, "[MCP] Received input: %s\n", line.toUtf8().constData());
-		fflush(stderr);
-
-		// Parse JSON-RPC request
-		QJsonParseError error;
-		QJsonDocument doc = QJsonDocument::fromJson(line.toUtf8(), &error);
-
-		if (error.error != QJsonParseError::NoError) {
-			fprintf(stderr, "[MCP] JSON parse error: %s\n", error.errorString().toUtf8().constData());
-			fflush(stderr);
-			return;
+	}
+	_componentStarters.insert(
+		"translate_messages",
+		&Server::ensureTranslation);
+	_componentStarters.insert(
+		"auto_translate_chat",
+		&Server::ensureTranslation);
+	for (const auto &name : {
+		"get_gift_price_history",
+		"get_market_trends",
+		"backtest_strategy",
+	}) {
+		_componentStarters.insert(name, &Server::ensureGiftPrices);
+	}
+
+	_deferredStartTimer.setSingleShot(true);
+	connect(&_deferredStartTimer, &QTimer::timeout, this, [=] {
+		// Auto-translation and bots react to incoming messages, the
+		// wallet tables and gift prices are recorded in the background,
+		// so they are started even if none of their tools is called.
+		ensureTranslation();
+		ensureBotManager();
+		ensureWalletSync();
+		ensureGiftPrices();
+	});
+}
+
+void Server::ensureComponents(const QString &toolName) {
+	if (_session) {
+		if (const auto starter = _componentStarters.value(toolName)) {
+			(this->*starter)();
 		}
+	}
+}
 
-		QJsonObject request = doc.object();
-		QJsonObject response = handleRequest(request);
+bool Server::ensureSemanticSearch() {
+	if (_semanticSearch) {
+		return true;
+	} else if (!_archiver || !_archiver->isRunning()) {
+		return false;
+	}
+	_semanticSearch.reset(new SemanticSearch(_archiver.get(), this));
+	_semanticSearch->initialize();
+	_contextBuilder->setSearch(_semanticSearch.get());
+	fprintf(stderr, "[MCP] SemanticSearch initialized\n");
+	fflush(stderr);
+	return true;
+}
 
-		// Write response to stdout
-		QByteArray responseBytes = QJsonDocument(response).toJson(QJsonDocument::Compact);
-		fprintf(stderr, "[MCP] Sending response: %s\n", responseBytes.constData());
+bool Server::ensureBatchOperations() {
+	if (!_batchOps) {
+		_batchOps.reset(new BatchOperations(this));
+		_batchOps->start(_session);
+		fprintf(stderr, "[MCP] BatchOperations initialized\n");
 		fflush(stderr);
-
-		*_stdout << responseBytes;
-		*_stdout << "\n";
-		_stdout->flush();
 	}
+	return true;
 }
 
-void Server::startHttpTransport(int port) {
-	// TODO: Implement HTTP transport with QHttpServer (Qt 6)
-	qInfo() << "MCP: HTTP transport on port" << port << "(not implemented yet)";
+bool Server::ensureTranslation() {
+	if (!_translation) {
+		// TranslationPipeline - translation_cache and messages.translateText
+		_translation.reset(new TranslationPipeline(this));
+		if (!_translation->start(_session, _dbPool.get())) {
+			qWarning() << "MCP: Failed to start TranslationPipeline";
+		}
+	}
+	return _translation->isRunning();
 }
 
-QJsonObject Server::handleRequest(const QJsonObject &request) {
-	QString method = request["method"].toString();
-	QJsonObject params = request["params"].toObject();
-	QJsonValue id = request["id"];
-
-	qDebug() << "MCP: Request" << method;
-
-	// Dispatch to method handlers
-	if (method == "initialize") {
-		return successResponse(id, handleInitialize(params));
-	} else if (method == "tools/list") {
-		return successResponse(id, handleListTools(params));
-	} else if (method == "tools/call") {
-		return successResponse(id, handleCallTool(params));
-	} else if (method == "resources/list") {
-		return successResponse(id, handleListResources(params));
-	} else if (method == "resources/read") {
-		return successResponse(id, handleReadResource(params));
-	} else if (method == "prompts/list") {
-		return successResponse(id, handleListPrompts(params));
-	} else if (method == "prompts/get") {
-		return successResponse(id, handleGetPrompt(params));
-	} else {
-		return errorResponse(id, -32601, "Method not found: " + method);
+bool Server::ensureBotManager() {
+	if (_botManager) {
+		return true;
+	} else if (!ensureSemanticSearch()
+		|| !_analytics
+		|| !_scheduler
+		|| !_auditLogger
+		|| !_rbac) {
+		return false;
 	}
-}
+	_botManager.reset(new BotManager(this));
+	_botManager->initialize(
+		_archiver.get(),
+		_analytics.get(),
+		_semanticSearch.get(),
+		_scheduler.get(),
+		_auditLogger.get(),
+		_rbac.get()
+	);
+	_botManager->setContextBuilder(_contextBuilder.get());
 
-QJsonObject Server::handleInitialize(const QJsonObject &params) {
-	Q_UNUSED(params);
+	// Load and register built-in bots
+	_botManager->discoverBots();
 
-	_auditLogger->logSystemEvent("initialize", "Client initialized");
+	// Register and start the Context Assistant Bot (example)
+	auto *contextBot = new ContextAssistantBot(_botManager.get());
+	_botManager->registerBot(contextBot);
+	_botManager->startBot("context_assistant");
 
-	return QJsonObject{
-		{"protocolVersion", "2024-11-05"},
-		{"serverInfo", QJsonObject{
-			{"name", _serverInfo.name},
-			{"version", _serverInfo.version}
-		}},
-		{"capabilities", _serverInfo.capabilities},
-	};
+	fprintf(stderr, "[MCP] BotManager initialized and bots started\n");
+	fflush(stderr);
+	return true;
 }
 
-QJsonObject Server::handleListTools(const QJsonObject &params) {
-	Q_UNUSED(params);
+bool Server::ensureWalletSync() {
+	if (_walletSync) {
+		return _walletSync->isRunning();
+	} else if (!_archiver || !_archiver->isRunning()) {
+		// The wallet tables are created by the archive migrations.
+		return false;
+	}
+	_walletSync = std::make_unique<WalletSync>();
+	if (!_walletSync->start(_session, _dbPool.get())) {
+		qWarning() << "MCP: Failed to start WalletSync";
+	}
+	return _walletSync->isRunning();
+}
 
-	QJsonArray tools;
-	for (const auto &tool : _tools) {
-		tools.append(QJsonObject{
-			{"name", tool.name},
-			{"description", tool.description},
-			{"inputSchema", tool.inputSchema},
-		});
+bool Server::ensureGiftPrices() {
+	if (!_giftPrices) {
+		// Series files are kept next to the archive database.
+		_giftPrices = std::make_unique<GiftPriceSeries>(
+			QFileInfo(_databasePath).absolutePath() + "/gift_prices");
+		_giftPrices->start(_session);
 	}
+	return _giftPrices->isRunning();
+}
 
-	return QJsonObject{{"tools", tools}};
+QJsonObject Server::componentsStatus() const {
+	const auto state = [](bool started, bool running) {
+		return !started
+			? QString("not_started")
+			: running
+			? QString("ready")
+			: QString("failed");
+	};
+	auto result = QJsonObject();
+	result["archiver"] = !_archiver
+		? QString("not_started")
+		: _archiver->isStarting()
+		? QString("starting")
+		: state(true, _archiver->isRunning());
+	result["ephemeral_archiver"] = state(
+		_ephemeralArchiver != nullptr,
+		_ephemeralArchiver && _ephemeralArchiver->isRunning());
+	result["analytics"] = state(_analytics != nullptr, true);
+	result["scheduler"] = state(_scheduler != nullptr, true);
+	result["semantic_search"] = state(
+		_semanticSearch != nullptr,
+		_semanticSearch && _semanticSearch->isReady());
+	result["batch_operations"] = state(_batchOps != nullptr, true);
+	result["translation"] = state(
+		_translation != nullptr,
+		_translation && _translation->isRunning());
+	result["bots"] = state(_botManager != nullptr, true);
+	result["wallet_sync"] = state(
+		_walletSync != nullptr,
+		_walletSync && _walletSync->isRunning());
+	result["gift_prices"] = state(
+		_giftPrices != nullptr,
+		_giftPrices && _giftPrices->isRunning());
+	return result;
+}
+
+void Server::startStdioTransport() {
+	// Raw device so large results can be streamed without a text codec.
+	_stdout.reset(new QFile());
+	_stdout->open(stdout, QIODevice::WriteOnly | QIODevice::Unbuffered);
+
+	// Read stdin on a dedicated thread, every complete line available
+	// on a wakeup is delivered here as one queued batch.
+	_stdioReader.reset(new StdioReader());
+	connect(
+		_stdioReader.get(),
+		&StdioReader::linesReady,
+		this,
+		&Server::handleStdioLines,
+		Qt::QueuedConnection);
+	connect(_stdioReader.get(), &StdioReader::finished, this, [] {
+		fprintf(stderr, "[MCP] Stdin closed, stdio transport finished\n");
+		fflush(stderr);
+	}, Qt::QueuedConnection);
+	_stdioReader->start();
+
+	fprintf(stderr, "[MCP] Stdio transport started (event-driven reader)\n");
+	fflush(stderr);
+}
+
+void Server::handleStdioLines(const QList<QByteArray> &lines) {
+	// Responses completed synchronously within the batch share one flush.
+	_stdioBatching = true;
+	for (const auto &line : lines) {
+		handleStdioLine(line);
+	}
+	_stdioBatching = false;
+	if (_stdout) {
+		_stdout->flush();
+	}
+}
+
+void Server::handleStdioLine(const QByteArray &line) {
+	fprintf(stderr, "[MCP] Received input: %s\n", line.constData());
+	fflush(stderr);
+
+	// Parse JSON-RPC request
+	QJsonParseError error;
+	QJsonDocument doc = QJsonDocument::fromJson(line, &error);
+
+	if (error.error != QJsonParseError::NoError) {
+		fprintf(stderr, "[MCP] JSON parse error: %s\n", error.errorString().toUtf8().constData());
+		fflush(stderr);
+		writeStdioResponse(errorResponse(QJsonValue::Null, -32700, "Parse error"));
+		return;
+	}
+
+	if (doc.isArray()) {
+		// Batch entries are dispatched independently, so thread-safe tools
+		// overlap, and every response is streamed back by id as it is done.
+		const auto batch = doc.array();
+		if (batch.isEmpty()) {
+			writeStdioResponse(errorResponse(
+				QJsonValue::Null,
+				-32600,
+				"Invalid Request: empty batch"));
+			return;
+		}
+		for (const auto &entry : batch) {
+			dispatchStdioMessage(entry);
+		}
+		return;
+	}
+	dispatchStdioMessage(doc.object());
+}
+
+void Server::dispatchStdioMessage(const QJsonValue &message) {
+	if (!message.isObject()) {
+		writeStdioResponse(errorResponse(
+			QJsonValue::Null,
+			-32600,
+			"Invalid Request"));
+		return;
+	}
+	const auto request = message.toObject();
+	if (!request.contains("id")) {
+		// Notifications are processed but never answered.
+		handleRequest(request);
+		return;
+	}
+	const auto params = request["params"].toObject();
+	if (request["method"].toString() == "tools/list" && params.isEmpty()) {
+		// Full catalogue, write the pre-serialized bytes as they are.
+		auto out = JsonStreamWriter(_stdout.get());
+		out.beginObject();
+		out.key("jsonrpc");
+		out.value("2.0");
+		out.key("id");
+		out.value(request["id"]);
+		out.key("result");
+		out.rawValue(_toolsListBytes);
+		out.endObject();
+		out.rawValue("\n");
+		return;
+	}
+	if (request["method"].toString() == "tools/call") {
+		auto rejection = QJsonObject();
+		if (!admitToolCall(request, "stdio", rejection)) {
+			writeStdioResponse(rejection);
+			return;
+		}
+		const auto toolName = params["name"].toString();
+		const auto arguments = params["arguments"].toObject();
+
+		// Streaming handlers and cached results are of the primary
+		// account, calls for other accounts go through executeTool().
+		const auto primary = !arguments.contains("account_id");
+		const auto streaming = primary
+			? _streamingToolHandlers.find(toolName)
+			: _streamingToolHandlers.end();
+		if (streaming != _streamingToolHandlers.end()) {
+			streamStdioToolResponse(request["id"], params, *streaming);
+			return;
+		}
+		const auto cacheKey = primary
+			? cachedToolResultKey(toolName, arguments)
+			: QString();
+		auto cached = QByteArray();
+		if (!cacheKey.isEmpty() && _cache->getSerialized(cacheKey, cached)) {
+			// Cache hit, the stored result goes out without re-encoding.
+			if (_auditLogger) {
+				_auditLogger->logToolInvoked(toolName, arguments);
+			}
+			_metrics->record(toolName, 0, false);
+			_metrics->recordBytes(toolName, cached.size());
+			auto out = JsonStreamWriter(_stdout.get());
+			out.beginObject();
+			out.key("jsonrpc");
+			out.value("2.0");
+			out.key("id");
+			out.value(request["id"]);
+			out.key("result");
+			out.rawValue(cached);
+			out.endObject();
+			out.rawValue("\n");
+			if (!_stdioBatching) {
+				out.flush();
+			}
+			return;
+		}
+	}
+	dispatchRequest(request, [=](const QJsonObject &response) {
+		writeStdioResponse(response);
+	});
+}
+
+void Server::streamStdioToolResponse(
+		const QJsonValue &id,
+		const QJsonObject &params,
+		const StreamingToolHandler &handler) {
+	const auto toolName = params["name"].toString();
+	const auto arguments = params["arguments"].toObject();
+	if (_auditLogger) {
+		_auditLogger->logToolInvoked(toolName, arguments);
+	}
+
+	// Same envelope as toolCallResponse(), but the tool result is
+	// serialized element by element into the escaped "text" field.
+	auto out = JsonStreamWriter(_stdout.get());
+	out.beginObject();
+	out.key("jsonrpc");
+	out.value("2.0");
+	out.key("id");
+	out.value(id);
+	out.key("result");
+	out.beginObject();
+	out.key("content");
+	out.beginArray();
+	out.beginObject();
+	out.key("type");
+	out.value("text");
+	out.key("text");
+	out.beginEmbeddedString();
+	QElapsedTimer timer;
+	timer.start();
+	handler(arguments, out);
+	_metrics->record(toolName, timer.nsecsElapsed() / 1000, false);
+	out.endEmbeddedString();
+	out.endObject();
+	out.endArray();
+	out.endObject();
+	out.endObject();
+	out.rawValue("\n");
+	out.flush();
+
+	_metrics->recordBytes(toolName, out.bytesWritten());
+
+	fprintf(stderr, "[MCP] Streamed %s response: %lld bytes\n",
+		toolName.toUtf8().constData(),
+		static_cast<long long>(out.bytesWritten()));
+	fflush(stderr);
+}
+
+void Server::writeStdioResponse(const QJsonObject &response) {
+	if (!_stdout) {
+		return;
+	}
+
+	// Responses may complete out of order, clients match them by id.
+	QByteArray responseBytes = QJsonDocument(response).toJson(QJsonDocument::Compact);
+	fprintf(stderr, "[MCP] Sending response: %s\n", responseBytes.constData());
+	fflush(stderr);
+
+	_stdout->write(responseBytes);
+	_stdout->write("\n");
+	if (!_stdioBatching) {
+		_stdout->flush();
+	}
+}
+
+bool Server::startHttpTransport(int port) {
+	_http.reset(new HttpTransport());
+	_http->setRequestHandler([=](
+			const QJsonObject &request,
+			const QString &sessionId,
+			const QString &credential,
+			HttpTransport::Respond respond) {
+		auto client = sessionId.isEmpty() ? QString("http") : sessionId;
+		if (request["method"].toString() == "tools/call"
+			&& _rbac
+			&& _rbac->authRequired()) {
+			// Once API keys exist every HTTP tool call must present one,
+			// stdio stays trusted as a local child process.
+			const auto params = request["params"].toObject();
+			const auto toolName = params["name"].toString();
+			// start_job runs another tool, both must be allowed.
+			const auto jobTool = (toolName == "start_job")
+				? params["arguments"].toObject()["tool"].toString()
+				: QString();
+			auto &context = _rbac->context(credential);
+			if (credential.isEmpty()
+				|| !_rbac->authorize(
+					context,
+					Dispatch::kTools.indexOf(toolName))
+				|| (!jobTool.isEmpty()
+					&& !_rbac->authorize(
+						context,
+						Dispatch::kTools.indexOf(jobTool)))) {
+				if (_auditLogger) {
+					_auditLogger->logAuthEvent("tool_denied", QString(), false, toolName);
+				}
+				respond(errorResponse(
+					request["id"],
+					-32001,
+					"Not authorized to call " + toolName));
+				return;
+			}
+			client = context.keyHash;
+		}
+		auto rejection = QJsonObject();
+		if (request["method"].toString() == "tools/call"
+			&& !admitToolCall(request, client, rejection)) {
+			respond(rejection);
+			return;
+		}
+		if (!request.contains("id")) {
+			// Notifications (e.g. notifications/initialized) get no reply.
+			handleRequest(request);
+			respond(QJsonObject());
+			return;
+		}
+		dispatchRequest(request, std::move(respond));
+	});
+	_http->setMetricsHandler([=] {
+		return _metrics->prometheus() + _rateLimiter->prometheus();
+	});
+	if (!_http->start(port)) {
+		_http.reset();
+		return false;
+	}
+
+	fprintf(stderr, "[MCP] HTTP transport started on http://127.0.0.1:%d/mcp\n", port);
+	fflush(stderr);
+	return true;
+}
+
+void Server::sendNotification(
+		const QString &method,
+		const QJsonObject &params) {
+	auto notification = QJsonObject{
+		{"jsonrpc", "2.0"},
+		{"method", method},
+	};
+	if (!params.isEmpty()) {
+		notification["params"] = params;
+	}
+	if (_http) {
+		_http->notify(notification);
+	}
+	if (_stdout) {
+		_stdout->write(QJsonDocument(notification).toJson(QJsonDocument::Compact));
+		_stdout->write("\n");
+		_stdout->flush();
+	}
+}
+
+QJsonObject Server::handleRequest(const QJsonObject &request) {
+	QString method = request["method"].toString();
+	QJsonObject params = request["params"].toObject();
+	QJsonValue id = request["id"];
+
+	qDebug() << "MCP: Request" << method;
+
+	// Dispatch to method handlers
+	if (const auto handler = Dispatch::kRequests.find(method)) {
+		return successResponse(id, (this->*handler)(params));
+	} else if (const auto handler = Dispatch::kCheckedRequests.find(method)) {
+		const auto result = (this->*handler)(params);
+		return result
+			? successResponse(id, *result)
+			: errorResponse(id, result.error().code, result.error().message);
+	}
+	return errorResponse(id, -32601, "Method not found: " + method);
+}
+
+void Server::dispatchRequest(
+		const QJsonObject &request,
+		ResponseCallback done) {
+	const auto method = request["method"].toString();
+	const auto params = request["params"].toObject();
+	const auto toolName = params["name"].toString();
+	if (method == "tools/call") {
+		// Components are created on the main thread, before a worker
+		// may use them.
+		ensureComponents(toolName);
+	}
+	if (method != "tools/call"
+		|| !_toolPool
+		|| !_threadSafeTools.contains(toolName)
+		|| params["arguments"].toObject().contains("account_id")) {
+		done(handleRequest(request));
+		return;
+	}
+
+	// Read-only tools run on the worker pool with their own archive
+	// connections, the response is delivered back on the main thread.
+	const auto id = request["id"];
+	if (_queuedToolCalls >= kMaxQueuedToolCalls) {
+		// Shed instead of queueing work nobody will wait for.
+		_rateLimiter->recordShed(Dispatch::kTools.indexOf(toolName));
+		done(BusyResponse(id, kShedRetryAfterMs, "overloaded"));
+		return;
+	}
+	const auto arguments = params["arguments"].toObject();
+	if (_auditLogger) {
+		_auditLogger->logToolInvoked(toolName, arguments);
+	}
+	++_queuedToolCalls;
+	_toolPool->start([=, done = std::move(done)] {
+		const auto result = executeTool(toolName, arguments);
+		QMetaObject::invokeMethod(this, [=] {
+			--_queuedToolCalls;
+			done(successResponse(id, toolCallResponse(toolName, result)));
+		}, Qt::QueuedConnection);
+	});
+}
+
+void Server::initializeRateLimits() {
+	// Weights by category, e.g. one analytics call costs as much as ten
+	// get_chat_info calls. Aliases outside of _tools cost 1.
+	const auto costs = QHash<QString, int>{
+		{ "analytics", 10 },
+		{ "batch", 10 },
+		{ "semantic", 5 },
+		{ "archive", 5 },
+		{ "voice", 5 },
+	};
+	auto categories = QHash<QString, QString>();
+	for (const auto &tool : _tools) {
+		categories.insert(tool.name, tool.category);
+	}
+	auto toolIds = QStringList();
+	for (const auto &entry : Dispatch::kTools.entries()) {
+		toolIds.push_back(QString::fromLatin1(
+			entry.name.data(),
+			qsizetype(entry.name.size())));
+	}
+	_rateLimiter = std::make_unique<RateLimiter>(toolIds);
+	for (auto i = 0; i != int(toolIds.size()); ++i) {
+		_rateLimiter->setCost(
+			i,
+			costs.value(categories.value(toolIds[i]), 1));
+	}
+}
+
+bool Server::admitToolCall(
+		const QJsonObject &request,
+		const QString &client,
+		QJsonObject &rejection) {
+	const auto toolName = request["params"].toObject()["name"].toString();
+	const auto decision = _rateLimiter->admit(
+		client,
+		Dispatch::kTools.indexOf(toolName));
+	if (decision.admitted) {
+		return true;
+	}
+	rejection = BusyResponse(
+		request["id"],
+		decision.retryAfterMs,
+		decision.reason);
+	return false;
+}
+
+bool Server::isThreadSafeTool(const QString &toolName) const {
+	return _threadSafeTools.contains(toolName);
+}
+
+QJsonObject Server::handleInitialize(const QJsonObject &params) {
+	Q_UNUSED(params);
+
+	_auditLogger->logSystemEvent("initialize", "Client initialized");
+
+	return QJsonObject{
+		{"protocolVersion", "2024-11-05"},
+		{"serverInfo", QJsonObject{
+			{"name", _serverInfo.name},
+			{"version", _serverInfo.version}
+		}},
+		{"capabilities", _serverInfo.capabilities},
+	};
+}
+
+QJsonObject Server::handleListTools(const QJsonObject &params) {
+	const auto categoryValue = params.value("category");
+	const auto cursor = params.value("cursor").toString();
+	const auto limit = params.value("limit").toInt(0);
+	if (categoryValue.isUndefined() && cursor.isEmpty() && limit <= 0) {
+		return _toolsListResult;
+	}
+
+	// Optional filtering by one or several categories.
+	auto categories = QStringList();
+	if (categoryValue.isString()) {
+		categories.push_back(categoryValue.toString());
+	} else if (categoryValue.isArray()) {
+		for (const auto &value : categoryValue.toArray()) {
+			categories.push_back(value.toString());
+		}
+	}
+
+	// The cursor is the opaque index of the first tool of the next page.
+	const auto offset = std::max(cursor.toInt(), 0);
+	auto tools = QJsonArray();
+	auto matched = 0;
+	auto more = false;
+	for (auto i = 0; i != _tools.size(); ++i) {
+		if (!categories.isEmpty()
+			&& !categories.contains(_tools[i].category)) {
+			continue;
+		}
+		if (matched++ < offset) {
+			continue;
+		}
+		if (limit > 0 && tools.size() >= limit) {
+			more = true;
+			break;
+		}
+		tools.append(_toolEntries[i]);
+	}
+
+	auto result = QJsonObject{{"tools", tools}};
+	if (more) {
+		result["nextCursor"] = QString::number(offset + tools.size());
+	}
+	return result;
 }
 
 QJsonObject Server::handleCallTool(const QJsonObject &params) {
 	QString toolName = params["name"].toString();
 	QJsonObject arguments = params["arguments"].toObject();
+	if (toolName == "start_job" && !arguments.contains("progress_token")) {
+		const auto token = params["_meta"].toObject()["progressToken"];
+		if (!token.isUndefined()) {
+			arguments["progress_token"] = token;
+		}
+	}
 
 	if (_auditLogger) {
 		_auditLogger->logToolInvoked(toolName, arguments);
 	}
 
-	QJsonObject result;
-
-	// Try lookup table first (for common tools)
-	auto handler = _toolHandlers.find(toolName);
-	if (handler != _toolHandlers.end()) {
-		result = (*handler)(arguments);
-	}
-	// Fall back to if-else chain for remaining tools
-	// CORE TOOLS (now handled via lookup table, but keep for backward compatibility)
-	else if (toolName == "list_chats") {
-		result = toolListChats(arguments);
-	} else if (toolName == "get_chat_info") {
-		result = toolGetChatInfo(arguments);
-	} else if (toolName == "read_messages") {
-		result = toolReadMessages(arguments);
-	} else if (toolName == "send_message") {
-		result = toolSendMessage(arguments);
-	} else if (toolName == "search_messages") {
-		result = toolSearchMessages(arguments);
-	} else if (toolName == "get_user_info") {
-		result = toolGetUserInfo(arguments);
-
-	// ARCHIVE TOOLS
-	} else if (toolName == "archive_chat") {
-		result = toolArchiveChat(arguments);
-	} else if (toolName == "export_chat") {
-		result = toolExportChat(arguments);
-	} else if (toolName == "list_archived_chats") {
-		result = toolListArchivedChats(arguments);
-	} else if (toolName == "get_archive_stats") {
-		result = toolGetArchiveStats(arguments);
-	} else if (toolName == "configure_ephemeral_capture") {
-		result = toolConfigureEphemeralCapture(arguments);
-	} else if (toolName == "get_ephemeral_stats") {
-		result = toolGetEphemeralStats(arguments);
-	} else if (toolName == "get_ephemeral_messages") {
-		result = toolGetEphemeralMessages(arguments);
-	} else if (toolName == "search_archive") {
-		result = toolSearchArchive(arguments);
-	} else if (toolName == "purge_archive") {
-		result = toolPurgeArchive(arguments);
-
-	// ANALYTICS TOOLS
-	} else if (toolName == "get_message_stats") {
-		result = toolGetMessageStats(arguments);
-	} else if (toolName == "get_user_activity") {
-		result = toolGetUserActivity(arguments);
-	} else if (toolName == "get_chat_activity") {
-		result = toolGetChatActivity(arguments);
-	} else if (toolName == "get_time_series") {
-		result = toolGetTimeSeries(arguments);
-	} else if (toolName == "get_top_users") {
-		result = toolGetTopUsers(arguments);
-	} else if (toolName == "get_top_words") {
-		result = toolGetTopWords(arguments);
-	} else if (toolName == "export_analytics") {
-		result = toolExportAnalytics(arguments);
-	} else if (toolName == "get_trends") {
-		result = toolGetTrends(arguments);
-
-	// SEMANTIC SEARCH TOOLS
-	} else if (toolName == "semantic_search") {
-		result = toolSemanticSearch(arguments);
-	} else if (toolName == "index_messages") {
-		result = toolIndexMessages(arguments);
-	} else if (toolName == "detect_topics") {
-		result = toolDetectTopics(arguments);
-	} else if (toolName == "classify_intent") {
-		result = toolClassifyIntent(arguments);
-	} else if (toolName == "extract_entities") {
-		result = toolExtractEntities(arguments);
-
-	// MESSAGE OPERATIONS
-	} else if (toolName == "edit_message") {
-		result = toolEditMessage(arguments);
-	} else if (toolName == "delete_message") {
-		result = toolDeleteMessage(arguments);
-	} else if (toolName == "forward_message") {
-		result = toolForwardMessage(arguments);
-	} else if (toolName == "pin_message") {
-		result = toolPinMessage(arguments);
-	} else if (toolName == "unpin_message") {
-		result = toolUnpinMessage(arguments);
-	} else if (toolName == "add_reaction") {
-		result = toolAddReaction(arguments);
-
-	// BATCH OPERATIONS
-	} else if (toolName == "batch_send") {
-		result = toolBatchSend(arguments);
-	} else if (toolName == "batch_delete") {
-		result = toolBatchDelete(arguments);
-	} else if (toolName == "batch_forward") {
-		result = toolBatchForward(arguments);
-	} else if (toolName == "batch_pin") {
-		result = toolBatchPin(arguments);
-	} else if (toolName == "batch_reaction") {
-		result = toolBatchReaction(arguments);
-
-	// SCHEDULER TOOLS
-	} else if (toolName == "schedule_message") {
-		result = toolScheduleMessage(arguments);
-	} else if (toolName == "cancel_scheduled") {
-		result = toolCancelScheduled(arguments);
-	} else if (toolName == "list_scheduled") {
-		result = toolListScheduled(arguments);
-	} else if (toolName == "update_scheduled") {
-		result = toolUpdateScheduled(arguments);
-
-	// SYSTEM TOOLS
-	} else if (toolName == "get_cache_stats") {
-		result = toolGetCacheStats(arguments);
-	} else if (toolName == "get_server_info") {
-		result = toolGetServerInfo(arguments);
-	} else if (toolName == "get_audit_log") {
-		result = toolGetAuditLog(arguments);
-	} else if (toolName == "health_check") {
-		result = toolHealthCheck(arguments);
-
-	// VOICE TOOLS
-	} else if (toolName == "transcribe_voice") {
-		result = toolTranscribeVoice(arguments);
-	} else if (toolName == "get_transcription") {
-		result = toolGetTranscription(arguments);
-
-	// BOT FRAMEWORK TOOLS
-	} else if (toolName == "list_bots") {
-		result = toolListBots(arguments);
-	} else if (toolName == "get_bot_info") {
-		result = toolGetBotInfo(arguments);
-	} else if (toolName == "start_bot") {
-		result = toolStartBot(arguments);
-	} else if (toolName == "stop_bot") {
-		result = toolStopBot(arguments);
-	} else if (toolName == "configure_bot") {
-		result = toolConfigureBot(arguments);
-	} else if (toolName == "get_bot_stats") {
-		result = toolGetBotStats(arguments);
-	} else if (toolName == "send_bot_command") {
-		result = toolSendBotCommand(arguments);
-	} else if (toolName == "get_bot_suggestions") {
-		result = toolGetBotSuggestions(arguments);
-
-	// ===== PREMIUM EQUIVALENT FEATURES (17 tools) =====
-
-	// Voice Transcription - 2 tools
-	} else if (toolName == "transcribe_voice_message") {
-		result = toolTranscribeVoiceMessage(arguments);
-	} else if (toolName == "get_voice_transcription") {
-		result = toolGetVoiceTranscription(arguments);
-
-	// Translation - 2 tools
-	} else if (toolName == "translate_message") {
-		result = toolTranslateMessage(arguments);
-	} else if (toolName == "get_translation_history") {
-		result = toolGetTranslationHistory(arguments);
-
-	// Message Tags - 5 tools
-	} else if (toolName == "add_message_tag") {
-		result = toolAddMessageTag(arguments);
-	} else if (toolName == "get_message_tags") {
-		result = toolGetMessageTags(arguments);
-	} else if (toolName == "remove_message_tag") {
-		result = toolRemoveMessageTag(arguments);
-	} else if (toolName == "search_by_tag") {
-		result = toolSearchByTag(arguments);
-	} else if (toolName == "get_tag_suggestions") {
-		result = toolGetTagSuggestions(arguments);
-
-	// Ad Filtering - 2 tools
-	} else if (toolName == "configure_ad_filter") {
-		result = toolConfigureAdFilter(arguments);
-	} else if (toolName == "get_ad_filter_stats") {
-		result = toolGetAdFilterStats(arguments);
-
-	// Chat Rules - 3 tools
-	} else if (toolName == "set_chat_rules") {
-		result = toolSetChatRules(arguments);
-	} else if (toolName == "get_chat_rules") {
-		result = toolGetChatRules(arguments);
-	} else if (toolName == "test_chat_rules") {
-		result = toolTestChatRules(arguments);
-
-	// Tasks - 3 tools
-	} else if (toolName == "create_task_from_message") {
-		result = toolCreateTaskFromMessage(arguments);
-	} else if (toolName == "list_tasks") {
-		result = toolListTasks(arguments);
-	} else if (toolName == "update_task") {
-		result = toolUpdateTask(arguments);
-
-	// ===== BUSINESS EQUIVALENT FEATURES (36 tools) =====
-
-	// Quick Replies - 5 tools
-	} else if (toolName == "create_quick_reply") {
-		result = toolCreateQuickReply(arguments);
-	} else if (toolName == "list_quick_replies") {
-		result = toolListQuickReplies(arguments);
-	} else if (toolName == "update_quick_reply") {
-		result = toolUpdateQuickReply(arguments);
-	} else if (toolName == "delete_quick_reply") {
-		result = toolDeleteQuickReply(arguments);
-	} else if (toolName == "use_quick_reply") {
-		result = toolUseQuickReply(arguments);
-
-	// Greeting Messages - 4 tools
-	} else if (toolName == "set_greeting_message") {
-		result = toolSetGreetingMessage(arguments);
-	} else if (toolName == "get_greeting_message") {
-		result = toolGetGreetingMessage(arguments);
-	} else if (toolName == "disable_greeting") {
-		result = toolDisableGreeting(arguments);
-	} else if (toolName == "test_greeting") {
-		result = toolTestGreeting(arguments);
-
-	// Away Messages - 4 tools
-	} else if (toolName == "set_away_message") {
-		result = toolSetAwayMessage(arguments);
-	} else if (toolName == "get_away_message") {
-		result = toolGetAwayMessage(arguments);
-	} else if (toolName == "disable_away") {
-		result = toolDisableAway(arguments);
-	} else if (toolName == "test_away") {
-		result = toolTestAway(arguments);
-
-	// Business Hours - 4 tools
-	} else if (toolName == "set_business_hours") {
-		result = toolSetBusinessHours(arguments);
-	} else if (toolName == "get_business_hours") {
-		result = toolGetBusinessHours(arguments);
-	} else if (toolName == "check_business_status") {
-		result = toolCheckBusinessStatus(arguments);
-	} else if (toolName == "get_next_available_slot") {
-		result = toolGetNextAvailableSlot(arguments);
-
-	// AI Chatbot - 5 tools
-	} else if (toolName == "configure_chatbot") {
-		result = toolConfigureChatbot(arguments);
-	} else if (toolName == "get_chatbot_config") {
-		result = toolGetChatbotConfig(arguments);
-	} else if (toolName == "train_chatbot") {
-		result = toolTrainChatbot(arguments);
-	} else if (toolName == "test_chatbot") {
-		result = toolTestChatbot(arguments);
-	} else if (toolName == "get_chatbot_analytics") {
-		result = toolGetChatbotAnalytics(arguments);
-
-	// Text to Speech - 4 tools
-	} else if (toolName == "text_to_speech") {
-		result = toolTextToSpeech(arguments);
-	} else if (toolName == "configure_voice_persona") {
-		result = toolConfigureVoicePersona(arguments);
-	} else if (toolName == "list_voice_personas") {
-		result = toolListVoicePersonas(arguments);
-	} else if (toolName == "send_voice_reply") {
-		result = toolSendVoiceReply(arguments);
-
-	// Text to Video - 4 tools
-	} else if (toolName == "text_to_video") {
-		result = toolTextToVideo(arguments);
-	} else if (toolName == "send_video_reply") {
-		result = toolSendVideoReply(arguments);
-	} else if (toolName == "upload_avatar_source") {
-		result = toolUploadAvatarSource(arguments);
-	} else if (toolName == "list_avatar_presets") {
-		result = toolListAvatarPresets(arguments);
-
-	// Auto-Reply Rules - 6 tools
-	} else if (toolName == "create_auto_reply_rule") {
-		result = toolCreateAutoReplyRule(arguments);
-	} else if (toolName == "list_auto_reply_rules") {
-		result = toolListAutoReplyRules(arguments);
-	} else if (toolName == "update_auto_reply_rule") {
-		result = toolUpdateAutoReplyRule(arguments);
-	} else if (toolName == "delete_auto_reply_rule") {
-		result = toolDeleteAutoReplyRule(arguments);
-	} else if (toolName == "test_auto_reply_rule") {
-		result = toolTestAutoReplyRule(arguments);
-	} else if (toolName == "get_auto_reply_stats") {
-		result = toolGetAutoReplyStats(arguments);
-
-	// ===== WALLET FEATURES (32 tools) =====
-
-	// Balance & Analytics - 4 tools
-	} else if (toolName == "get_wallet_balance") {
-		result = toolGetWalletBalance(arguments);
-	} else if (toolName == "get_balance_history") {
-		result = toolGetBalanceHistory(arguments);
-	} else if (toolName == "get_spending_analytics") {
-		result = toolGetSpendingAnalytics(arguments);
-	} else if (toolName == "get_income_analytics") {
-		result = toolGetIncomeAnalytics(arguments);
-
-	// Transactions - 4 tools
-	} else if (toolName == "get_transactions") {
-		result = toolGetTransactions(arguments);
-	} else if (toolName == "get_transaction_details") {
-		result = toolGetTransactionDetails(arguments);
-	} else if (toolName == "export_transactions") {
-		result = toolExportTransactions(arguments);
-	} else if (toolName == "categorize_transaction") {
-		result = toolCategorizeTransaction(arguments);
-
-	// Gifts - 4 tools
-	} else if (toolName == "send_gift") {
-		result = toolSendGift(arguments);
-	} else if (toolName == "get_gift_history") {
-		result = toolGetGiftHistory(arguments);
-	} else if (toolName == "list_available_gifts") {
-		result = toolListAvailableGifts(arguments);
-	} else if (toolName == "get_gift_suggestions") {
-		result = toolGetGiftSuggestions(arguments);
-
-	// Subscriptions - 4 tools
-	} else if (toolName == "list_subscriptions") {
-		result = toolListSubscriptions(arguments);
-	} else if (toolName == "subscribe_to_channel") {
-		result = toolSubscribeToChannel(arguments);
-	} else if (toolName == "unsubscribe_from_channel") {
-		result = toolUnsubscribeFromChannel(arguments);
-	} else if (toolName == "get_subscription_stats") {
-		result = toolGetSubscriptionStats(arguments);
-
-	// Monetization - 4 tools
-	} else if (toolName == "get_earnings") {
-		result = toolGetEarnings(arguments);
-	} else if (toolName == "withdraw_earnings") {
-		result = toolWithdrawEarnings(arguments);
-	} else if (toolName == "set_monetization_rules") {
-		result = toolSetMonetizationRules(arguments);
-	} else if (toolName == "get_monetization_analytics") {
-		result = toolGetMonetizationAnalytics(arguments);
-
-	// Budget Management - 6 tools
-	} else if (toolName == "set_spending_budget") {
-		result = toolSetSpendingBudget(arguments);
-	} else if (toolName == "get_budget_status") {
-		result = toolGetBudgetStatus(arguments);
-	} else if (toolName == "set_budget_alert") {
-		result = toolSetBudgetAlert(arguments);
-	} else if (toolName == "approve_miniapp_spend") {
-		result = toolApproveMiniappSpend(arguments);
-	} else if (toolName == "list_miniapp_permissions") {
-		result = toolListMiniappPermissions(arguments);
-	} else if (toolName == "revoke_miniapp_permission") {
-		result = toolRevokeMiniappPermission(arguments);
-
-	// Stars Transfer - 6 tools
-	} else if (toolName == "send_stars") {
-		result = toolSendStars(arguments);
-	} else if (toolName == "request_stars") {
-		result = toolRequestStars(arguments);
-	} else if (toolName == "get_stars_rate") {
-		result = toolGetStarsRate(arguments);
-	} else if (toolName == "convert_stars") {
-		result = toolConvertStars(arguments);
-	} else if (toolName == "get_stars_leaderboard") {
-		result = toolGetStarsLeaderboard(arguments);
-	} else if (toolName == "get_stars_history") {
-		result = toolGetStarsHistory(arguments);
-
-	// ===== STARS FEATURES (45 tools) =====
-
-	// Gift Collections - 5 tools
-	} else if (toolName == "create_gift_collection") {
-		result = toolCreateGiftCollection(arguments);
-	} else if (toolName == "list_gift_collections") {
-		result = toolListGiftCollections(arguments);
-	} else if (toolName == "add_to_collection") {
-		result = toolAddToCollection(arguments);
-	} else if (toolName == "remove_from_collection") {
-		result = toolRemoveFromCollection(arguments);
-	} else if (toolName == "share_collection") {
-		result = toolShareCollection(arguments);
-
-	// Gift Auctions - 6 tools
-	} else if (toolName == "create_gift_auction") {
-		result = toolCreateGiftAuction(arguments);
-	} else if (toolName == "place_bid") {
-		result = toolPlaceBid(arguments);
-	} else if (toolName == "list_auctions") {
-		result = toolListAuctions(arguments);
-	} else if (toolName == "get_auction_status") {
-		result = toolGetAuctionStatus(arguments);
-	} else if (toolName == "cancel_auction") {
-		result = toolCancelAuction(arguments);
-	} else if (toolName == "get_auction_history") {
-		result = toolGetAuctionHistory(arguments);
-
-	// Gift Marketplace - 5 tools
-	} else if (toolName == "list_marketplace") {
-		result = toolListMarketplace(arguments);
-	} else if (toolName == "list_gift_for_sale") {
-		result = toolListGiftForSale(arguments);
-	} else if (toolName == "buy_gift") {
-		result = toolBuyGift(arguments);
-	} else if (toolName == "delist_gift") {
-		result = toolDelistGift(arguments);
-	} else if (toolName == "get_gift_price_history") {
-		result = toolGetGiftPriceHistory(arguments);
-
-	// Star Reactions - 5 tools
-	} else if (toolName == "send_star_reaction") {
-		result = toolSendStarReaction(arguments);
-	} else if (toolName == "get_star_reactions") {
-		result = toolGetStarReactions(arguments);
-	} else if (toolName == "get_reaction_analytics") {
-		result = toolGetReactionAnalytics(arguments);
-	} else if (toolName == "set_reaction_price") {
-		result = toolSetReactionPrice(arguments);
-	} else if (toolName == "get_top_reacted") {
-		result = toolGetTopReacted(arguments);
-
-	// Paid Content - 6 tools
-	} else if (toolName == "create_paid_post") {
-		result = toolCreatePaidPost(arguments);
-	} else if (toolName == "set_content_price") {
-		result = toolSetContentPrice(arguments);
-	} else if (toolName == "unlock_content") {
-		result = toolUnlockContent(arguments);
-	} else if (toolName == "get_paid_content_stats") {
-		result = toolGetPaidContentStats(arguments);
-	} else if (toolName == "list_purchased_content") {
-		result = toolListPurchasedContent(arguments);
-	} else if (toolName == "refund_content") {
-		result = toolRefundContent(arguments);
-
-	// Portfolio Management - 6 tools
-	} else if (toolName == "get_portfolio") {
-		result = toolGetPortfolio(arguments);
-	} else if (toolName == "get_portfolio_value") {
-		result = toolGetPortfolioValue(arguments);
-	} else if (toolName == "get_portfolio_history") {
-		result = toolGetPortfolioHistory(arguments);
-	} else if (toolName == "set_price_alert") {
-		result = toolSetPriceAlert(arguments);
-	} else if (toolName == "get_price_predictions") {
-		result = toolGetPricePredictions(arguments);
-	} else if (toolName == "export_portfolio_report") {
-		result = toolExportPortfolioReport(arguments);
-
-	// Achievement System - 6 tools
-	} else if (toolName == "list_achievements") {
-		result = toolListAchievements(arguments);
-	} else if (toolName == "get_achievement_progress") {
-		result = toolGetAchievementProgress(arguments);
-	} else if (toolName == "claim_achievement_reward") {
-		result = toolClaimAchievementReward(arguments);
-	} else if (toolName == "get_leaderboard") {
-		result = toolGetLeaderboard(arguments);
-	} else if (toolName == "share_achievement") {
-		result = toolShareAchievement(arguments);
-	} else if (toolName == "get_achievement_suggestions") {
-		result = toolGetAchievementSuggestions(arguments);
-
-	// Creator Tools - 6 tools
-	} else if (toolName == "create_exclusive_content") {
-		result = toolCreateExclusiveContent(arguments);
-	} else if (toolName == "set_subscriber_tiers") {
-		result = toolSetSubscriberTiers(arguments);
-	} else if (toolName == "get_subscriber_analytics") {
-		result = toolGetSubscriberAnalytics(arguments);
-	} else if (toolName == "send_subscriber_message") {
-		result = toolSendSubscriberMessage(arguments);
-	} else if (toolName == "create_giveaway") {
-		result = toolCreateGiveaway(arguments);
-	} else if (toolName == "get_creator_dashboard") {
-		result = toolGetCreatorDashboard(arguments);
+	return toolCallResponse(toolName, executeTool(toolName, arguments));
+}
 
-	} else {
-		result["error"] = "Unknown tool: " + toolName;
-		_auditLogger->logError("Unknown tool: " + toolName, "tool_call");
+QJsonObject Server::executeTool(
+		const QString &toolName,
+		const QJsonObject &arguments) {
+	if (const auto method = Dispatch::kTools.find(toolName)) {
+		const auto session = sessionForArguments(arguments);
+		if (!session) {
+			QJsonObject result;
+			result["error"] = "Account not found";
+			result["account_id"] = arguments["account_id"];
+			return result;
+		}
+		QElapsedTimer timer;
+		timer.start();
+
+		// Other accounts are served by the same tools, callSession() is
+		// the requested one for the duration of the call.
+		auto call = ToolCall{ .server = this, .session = session };
+		const auto outer = std::exchange(CurrentToolCall, &call);
+		auto result = (this->*method)(arguments);
+		CurrentToolCall = outer;
+		recordToolCall(toolName, timer.nsecsElapsed() / 1000, result);
+		return result;
 	}
 
+	QJsonObject result;
+	result["error"] = "Unknown tool: " + toolName;
+	_auditLogger->logError("Unknown tool: " + toolName, "tool_call");
+
 	// _auditLogger->logToolCompleted(toolName, result); // TODO: implement logToolCompleted
 
-	// Build response object
+	return result;
+}
+
+namespace {
+
+// tools/call result carrying the serialized tool result as text
+[[nodiscard]] QJsonObject ToolResultContent(const QByteArray &text) {
 	QJsonObject response;
 	QJsonArray contentArray;
 	QJsonObject textContent;
 	textContent["type"] = "text";
-	textContent["text"] = QString(QJsonDocument(result).toJson(QJsonDocument::Compact));
+	textContent["text"] = QString::fromUtf8(text);
 	contentArray.append(textContent);
 	response["content"] = contentArray;
 	return response;
 }
 
+// ToolResultContent() in wire form, for CacheManager::put()
+[[nodiscard]] QByteArray SerializedToolResult(const QJsonObject &result) {
+	return QJsonDocument(ToolResultContent(
+		QJsonDocument(result).toJson(QJsonDocument::Compact)
+	)).toJson(QJsonDocument::Compact);
+}
+
+} // namespace
+
+QJsonObject Server::toolCallResponse(
+		const QString &toolName,
+		const QJsonObject &result) {
+	const auto text = QJsonDocument(result).toJson(QJsonDocument::Compact);
+	_metrics->recordBytes(toolName, text.size());
+
+	// Build response object
+	return ToolResultContent(text);
+}
+
+QString Server::cachedToolResultKey(
+		const QString &toolName,
+		const QJsonObject &arguments) const {
+	if (!_cache) {
+		return QString();
+	} else if (toolName == "list_chats"
+		&& !arguments.contains("since_version")) {
+		return _cache->chatListKey();
+	}
+	return QString();
+}
+
+void Server::recordToolCall(
+		const QString &toolName,
+		qint64 microseconds,
+		const QJsonObject &result) {
+	const auto failed = result.contains("error")
+		|| (result.value("success") == QJsonValue(false));
+	_metrics->record(toolName, microseconds, failed);
+}
+
 // ===== HELPER METHODS =====
 
 bool Server::validateRequired(
@@ -3336,40 +4773,58 @@ QJsonObject Server::toolError(const QString &message, const QJsonObject &context
 }
 
 QJsonObject Server::extractMessageJson(HistoryItem *item) {
+	return extractMessageJson(item, MessageProjection());
+}
+
+QJsonObject Server::extractMessageJson(
+		HistoryItem *item,
+		const MessageProjection &projection) {
 	QJsonObject msg;
 	if (!item) {
 		return msg;
 	}
 
 	msg["message_id"] = QString::number(item->id.bare);
-	msg["date"] = static_cast<qint64>(item->date());
+	if (projection.wants("date")) {
+		msg["date"] = static_cast<qint64>(item->date());
+	}
 
 	// Get message text
-	const auto &text = item->originalText();
-	msg["text"] = text.text;
+	if (projection.wants("text")) {
+		msg["text"] = item->originalText().text;
+	}
 
 	// Get sender information
-	auto from = item->from();
+	const auto from = projection.wants("from_user")
+		? item->from().get()
+		: nullptr;
 	if (from) {
 		QJsonObject fromUser;
 		fromUser["id"] = QString::number(from->id.value);
-		fromUser["name"] = from->name();
-		if (!from->username().isEmpty()) {
-			fromUser["username"] = from->username();
+		const auto snapshot = _peerSnapshots
+			? _peerSnapshots->find(from)
+			: nullptr;
+		const auto name = snapshot ? snapshot->name : from->name();
+		const auto username = snapshot
+			? snapshot->username
+			: from->username();
+		fromUser["name"] = name;
+		if (!username.isEmpty()) {
+			fromUser["username"] = username;
 		}
 		msg["from_user"] = fromUser;
 	}
 
 	// Add optional fields
-	if (item->out()) {
+	if (item->out() && projection.wants("is_outgoing")) {
 		msg["is_outgoing"] = true;
 	}
-	if (item->isPinned()) {
+	if (item->isPinned() && projection.wants("is_pinned")) {
 		msg["is_pinned"] = true;
 	}
 
 	// Add reply information if present
-	if (item->replyToId()) {
+	if (item->replyToId() && projection.wants("reply_to")) {
 		QJsonObject reply;
 		reply["message_id"] = QString::number(item->replyToId().bare);
 		msg["reply_to"] = reply;
@@ -3378,478 +4833,101 @@ QJsonObject Server::extractMessageJson(HistoryItem *item) {
 	return msg;
 }
 
-void Server::initializeToolHandlers() {
-	// CORE TOOLS
-	_toolHandlers["list_chats"] = [this](const QJsonObject &args) { return toolListChats(args); };
-	_toolHandlers["get_chat_info"] = [this](const QJsonObject &args) { return toolGetChatInfo(args); };
-	_toolHandlers["read_messages"] = [this](const QJsonObject &args) { return toolReadMessages(args); };
-	_toolHandlers["send_message"] = [this](const QJsonObject &args) { return toolSendMessage(args); };
-	_toolHandlers["search_messages"] = [this](const QJsonObject &args) { return toolSearchMessages(args); };
-	_toolHandlers["get_user_info"] = [this](const QJsonObject &args) { return toolGetUserInfo(args); };
-
-	// ARCHIVE TOOLS
-	_toolHandlers["archive_chat"] = [this](const QJsonObject &args) { return toolArchiveChat(args); };
-	_toolHandlers["export_chat"] = [this](const QJsonObject &args) { return toolExportChat(args); };
-	_toolHandlers["list_archived_chats"] = [this](const QJsonObject &args) { return toolListArchivedChats(args); };
-	_toolHandlers["get_archive_stats"] = [this](const QJsonObject &args) { return toolGetArchiveStats(args); };
-	_toolHandlers["configure_ephemeral_capture"] = [this](const QJsonObject &args) { return toolConfigureEphemeralCapture(args); };
-	_toolHandlers["get_ephemeral_stats"] = [this](const QJsonObject &args) { return toolGetEphemeralStats(args); };
-	_toolHandlers["get_ephemeral_messages"] = [this](const QJsonObject &args) { return toolGetEphemeralMessages(args); };
-	_toolHandlers["search_archive"] = [this](const QJsonObject &args) { return toolSearchArchive(args); };
-	_toolHandlers["purge_archive"] = [this](const QJsonObject &args) { return toolPurgeArchive(args); };
-
-	// ANALYTICS TOOLS
-	_toolHandlers["get_message_stats"] = [this](const QJsonObject &args) { return toolGetMessageStats(args); };
-	_toolHandlers["get_user_activity"] = [this](const QJsonObject &args) { return toolGetUserActivity(args); };
-	_toolHandlers["get_chat_activity"] = [this](const QJsonObject &args) { return toolGetChatActivity(args); };
-	_toolHandlers["get_time_series"] = [this](const QJsonObject &args) { return toolGetTimeSeries(args); };
-	_toolHandlers["get_top_users"] = [this](const QJsonObject &args) { return toolGetTopUsers(args); };
-	_toolHandlers["get_top_words"] = [this](const QJsonObject &args) { return toolGetTopWords(args); };
-	_toolHandlers["export_analytics"] = [this](const QJsonObject &args) { return toolExportAnalytics(args); };
-	_toolHandlers["get_trends"] = [this](const QJsonObject &args) { return toolGetTrends(args); };
-
-	// SEMANTIC SEARCH TOOLS
-	_toolHandlers["semantic_search"] = [this](const QJsonObject &args) { return toolSemanticSearch(args); };
-	_toolHandlers["index_messages"] = [this](const QJsonObject &args) { return toolIndexMessages(args); };
-	_toolHandlers["semantic_index_messages"] = [this](const QJsonObject &args) { return toolIndexMessages(args); }; // alias
-	_toolHandlers["detect_topics"] = [this](const QJsonObject &args) { return toolDetectTopics(args); };
-	_toolHandlers["classify_intent"] = [this](const QJsonObject &args) { return toolClassifyIntent(args); };
-	_toolHandlers["extract_entities"] = [this](const QJsonObject &args) { return toolExtractEntities(args); };
-
-	// MESSAGE OPERATIONS
-	_toolHandlers["edit_message"] = [this](const QJsonObject &args) { return toolEditMessage(args); };
-	_toolHandlers["delete_message"] = [this](const QJsonObject &args) { return toolDeleteMessage(args); };
-	_toolHandlers["forward_message"] = [this](const QJsonObject &args) { return toolForwardMessage(args); };
-	_toolHandlers["pin_message"] = [this](const QJsonObject &args) { return toolPinMessage(args); };
-	_toolHandlers["unpin_message"] = [this](const QJsonObject &args) { return toolUnpinMessage(args); };
-	_toolHandlers["add_reaction"] = [this](const QJsonObject &args) { return toolAddReaction(args); };
-
-	// BATCH OPERATIONS
-	_toolHandlers["batch_send"] = [this](const QJsonObject &args) { return toolBatchSend(args); };
-	_toolHandlers["batch_delete"] = [this](const QJsonObject &args) { return toolBatchDelete(args); };
-	_toolHandlers["batch_forward"] = [this](const QJsonObject &args) { return toolBatchForward(args); };
-	_toolHandlers["batch_pin"] = [this](const QJsonObject &args) { return toolBatchPin(args); };
-	_toolHandlers["batch_reaction"] = [this](const QJsonObject &args) { return toolBatchReaction(args); };
-
-	// SCHEDULER TOOLS
-	_toolHandlers["schedule_message"] = [this](const QJsonObject &args) { return toolScheduleMessage(args); };
-	_toolHandlers["cancel_scheduled"] = [this](const QJsonObject &args) { return toolCancelScheduled(args); };
-	_toolHandlers["list_scheduled"] = [this](const QJsonObject &args) { return toolListScheduled(args); };
-	_toolHandlers["update_scheduled"] = [this](const QJsonObject &args) { return toolUpdateScheduled(args); };
-
-	// SYSTEM TOOLS
-	_toolHandlers["get_cache_stats"] = [this](const QJsonObject &args) { return toolGetCacheStats(args); };
-	_toolHandlers["get_server_info"] = [this](const QJsonObject &args) { return toolGetServerInfo(args); };
-	_toolHandlers["get_audit_log"] = [this](const QJsonObject &args) { return toolGetAuditLog(args); };
-	_toolHandlers["health_check"] = [this](const QJsonObject &args) { return toolHealthCheck(args); };
-
-	// VOICE TOOLS
-	_toolHandlers["transcribe_voice"] = [this](const QJsonObject &args) { return toolTranscribeVoice(args); };
-	_toolHandlers["get_transcription"] = [this](const QJsonObject &args) { return toolGetTranscription(args); };
-
-	// BOT FRAMEWORK TOOLS
-	_toolHandlers["list_bots"] = [this](const QJsonObject &args) { return toolListBots(args); };
-	_toolHandlers["get_bot_info"] = [this](const QJsonObject &args) { return toolGetBotInfo(args); };
-	_toolHandlers["start_bot"] = [this](const QJsonObject &args) { return toolStartBot(args); };
-	_toolHandlers["stop_bot"] = [this](const QJsonObject &args) { return toolStopBot(args); };
-	_toolHandlers["configure_bot"] = [this](const QJsonObject &args) { return toolConfigureBot(args); };
-	_toolHandlers["get_bot_stats"] = [this](const QJsonObject &args) { return toolGetBotStats(args); };
-	_toolHandlers["send_bot_command"] = [this](const QJsonObject &args) { return toolSendBotCommand(args); };
-	_toolHandlers["get_bot_suggestions"] = [this](const QJsonObject &args) { return toolGetBotSuggestions(args); };
-
-	// PROFILE SETTINGS TOOLS
-	_toolHandlers["get_profile_settings"] = [this](const QJsonObject &args) { return toolGetProfileSettings(args); };
-	_toolHandlers["update_profile_name"] = [this](const QJsonObject &args) { return toolUpdateProfileName(args); };
-	_toolHandlers["update_profile_bio"] = [this](const QJsonObject &args) { return toolUpdateProfileBio(args); };
-	_toolHandlers["update_profile_username"] = [this](const QJsonObject &args) { return toolUpdateProfileUsername(args); };
-	_toolHandlers["update_profile_phone"] = [this](const QJsonObject &args) { return toolUpdateProfilePhone(args); };
-
-	// PRIVACY SETTINGS TOOLS
-	_toolHandlers["get_privacy_settings"] = [this](const QJsonObject &args) { return toolGetPrivacySettings(args); };
-	_toolHandlers["update_last_seen_privacy"] = [this](const QJsonObject &args) { return toolUpdateLastSeenPrivacy(args); };
-	_toolHandlers["update_profile_photo_privacy"] = [this](const QJsonObject &args) { return toolUpdateProfilePhotoPrivacy(args); };
-	_toolHandlers["update_phone_number_privacy"] = [this](const QJsonObject &args) { return toolUpdatePhoneNumberPrivacy(args); };
-	_toolHandlers["update_forwards_privacy"] = [this](const QJsonObject &args) { return toolUpdateForwardsPrivacy(args); };
-	_toolHandlers["update_birthday_privacy"] = [this](const QJsonObject &args) { return toolUpdateBirthdayPrivacy(args); };
-	_toolHandlers["update_about_privacy"] = [this](const QJsonObject &args) { return toolUpdateAboutPrivacy(args); };
-	_toolHandlers["get_blocked_users"] = [this](const QJsonObject &args) { return toolGetBlockedUsers(args); };
-
-	// SECURITY SETTINGS TOOLS
-	_toolHandlers["get_security_settings"] = [this](const QJsonObject &args) { return toolGetSecuritySettings(args); };
-	_toolHandlers["get_active_sessions"] = [this](const QJsonObject &args) { return toolGetActiveSessions(args); };
-	_toolHandlers["terminate_session"] = [this](const QJsonObject &args) { return toolTerminateSession(args); };
-	_toolHandlers["block_user"] = [this](const QJsonObject &args) { return toolBlockUser(args); };
-	_toolHandlers["unblock_user"] = [this](const QJsonObject &args) { return toolUnblockUser(args); };
-	_toolHandlers["update_auto_delete_period"] = [this](const QJsonObject &args) { return toolUpdateAutoDeletePeriod(args); };
-
-	// PREMIUM FEATURES - Voice-to-Text
-	_toolHandlers["transcribe_voice_message"] = [this](const QJsonObject &args) { return toolTranscribeVoiceMessage(args); };
-	_toolHandlers["get_transcription_status"] = [this](const QJsonObject &args) { return toolGetTranscriptionStatus(args); };
-
-	// PREMIUM FEATURES - Translation
-	_toolHandlers["translate_messages"] = [this](const QJsonObject &args) { return toolTranslateMessages(args); };
-	_toolHandlers["auto_translate_chat"] = [this](const QJsonObject &args) { return toolAutoTranslateChat(args); };
-	_toolHandlers["get_translation_languages"] = [this](const QJsonObject &args) { return toolGetTranslationLanguages(args); };
-
-	// PREMIUM FEATURES - Message Tags
-	_toolHandlers["tag_message"] = [this](const QJsonObject &args) { return toolAddMessageTag(args); };
-	_toolHandlers["get_tagged_messages"] = [this](const QJsonObject &args) { return toolSearchByTag(args); };
-	_toolHandlers["list_tags"] = [this](const QJsonObject &args) { return toolGetMessageTags(args); };
-	_toolHandlers["delete_tag"] = [this](const QJsonObject &args) { return toolRemoveMessageTag(args); };
-	_toolHandlers["add_message_tag"] = [this](const QJsonObject &args) { return toolAddMessageTag(args); };
-	_toolHandlers["get_message_tags"] = [this](const QJsonObject &args) { return toolGetMessageTags(args); };
-	_toolHandlers["remove_message_tag"] = [this](const QJsonObject &args) { return toolRemoveMessageTag(args); };
-	_toolHandlers["search_by_tag"] = [this](const QJsonObject &args) { return toolSearchByTag(args); };
-	_toolHandlers["get_tag_suggestions"] = [this](const QJsonObject &args) { return toolGetTagSuggestions(args); };
-
-	// PREMIUM FEATURES - Ad Filtering
-	_toolHandlers["configure_ad_filter"] = [this](const QJsonObject &args) { return toolConfigureAdFilter(args); };
-	_toolHandlers["get_filtered_ads"] = [this](const QJsonObject &args) { return toolGetFilteredAds(args); };
-
-	// PREMIUM FEATURES - Chat Rules
-	_toolHandlers["create_chat_rule"] = [this](const QJsonObject &args) { return toolCreateChatRule(args); };
-	_toolHandlers["list_chat_rules"] = [this](const QJsonObject &args) { return toolListChatRules(args); };
-	_toolHandlers["execute_chat_rules"] = [this](const QJsonObject &args) { return toolExecuteChatRules(args); };
-	_toolHandlers["delete_chat_rule"] = [this](const QJsonObject &args) { return toolDeleteChatRule(args); };
-
-	// PREMIUM FEATURES - Tasks
-	_toolHandlers["create_task"] = [this](const QJsonObject &args) { return toolCreateTask(args); };
-	_toolHandlers["list_tasks"] = [this](const QJsonObject &args) { return toolListTasks(args); };
-
-	// BUSINESS FEATURES - Quick Replies
-	_toolHandlers["create_quick_reply"] = [this](const QJsonObject &args) { return toolCreateQuickReply(args); };
-	_toolHandlers["list_quick_replies"] = [this](const QJsonObject &args) { return toolListQuickReplies(args); };
-	_toolHandlers["send_quick_reply"] = [this](const QJsonObject &args) { return toolSendQuickReply(args); };
-	_toolHandlers["edit_quick_reply"] = [this](const QJsonObject &args) { return toolEditQuickReply(args); };
-	_toolHandlers["delete_quick_reply"] = [this](const QJsonObject &args) { return toolDeleteQuickReply(args); };
-
-	// BUSINESS FEATURES - Greeting Messages
-	_toolHandlers["configure_greeting"] = [this](const QJsonObject &args) { return toolConfigureGreeting(args); };
-	_toolHandlers["get_greeting_config"] = [this](const QJsonObject &args) { return toolGetGreetingConfig(args); };
-	_toolHandlers["test_greeting"] = [this](const QJsonObject &args) { return toolTestGreeting(args); };
-	_toolHandlers["get_greeting_stats"] = [this](const QJsonObject &args) { return toolGetGreetingStats(args); };
-
-	// BUSINESS FEATURES - Away Messages
-	_toolHandlers["configure_away_message"] = [this](const QJsonObject &args) { return toolConfigureAwayMessage(args); };
-	_toolHandlers["get_away_config"] = [this](const QJsonObject &args) { return toolGetAwayConfig(args); };
-	_toolHandlers["set_away_now"] = [this](const QJsonObject &args) { return toolSetAwayNow(args); };
-	_toolHandlers["disable_away"] = [this](const QJsonObject &args) { return toolDisableAway(args); };
-	_toolHandlers["get_away_stats"] = [this](const QJsonObject &args) { return toolGetAwayStats(args); };
-
-	// BUSINESS FEATURES - Business Hours
-	_toolHandlers["set_business_hours"] = [this](const QJsonObject &args) { return toolSetBusinessHours(args); };
-	_toolHandlers["get_business_hours"] = [this](const QJsonObject &args) { return toolGetBusinessHours(args); };
-	_toolHandlers["is_open_now"] = [this](const QJsonObject &args) { return toolIsOpenNow(args); };
-
-	// BUSINESS FEATURES - Business Location
-	_toolHandlers["set_business_location"] = [this](const QJsonObject &args) { return toolSetBusinessLocation(args); };
-	_toolHandlers["get_business_location"] = [this](const QJsonObject &args) { return toolGetBusinessLocation(args); };
-
-	// BUSINESS FEATURES - AI Chatbot
-	_toolHandlers["configure_ai_chatbot"] = [this](const QJsonObject &args) { return toolConfigureAiChatbot(args); };
-	_toolHandlers["get_chatbot_config"] = [this](const QJsonObject &args) { return toolGetChatbotConfig(args); };
-	_toolHandlers["pause_chatbot"] = [this](const QJsonObject &args) { return toolPauseChatbot(args); };
-	_toolHandlers["resume_chatbot"] = [this](const QJsonObject &args) { return toolResumeChatbot(args); };
-	_toolHandlers["set_chatbot_prompt"] = [this](const QJsonObject &args) { return toolSetChatbotPrompt(args); };
-	_toolHandlers["get_chatbot_stats"] = [this](const QJsonObject &args) { return toolGetChatbotStats(args); };
-	_toolHandlers["train_chatbot"] = [this](const QJsonObject &args) { return toolTrainChatbot(args); };
-
-	// BUSINESS FEATURES - AI Voice (TTS)
-	_toolHandlers["configure_voice_persona"] = [this](const QJsonObject &args) { return toolConfigureVoicePersona(args); };
-	_toolHandlers["generate_voice_message"] = [this](const QJsonObject &args) { return toolGenerateVoiceMessage(args); };
-	_toolHandlers["send_voice_reply"] = [this](const QJsonObject &args) { return toolSendVoiceReply(args); };
-	_toolHandlers["list_voice_presets"] = [this](const QJsonObject &args) { return toolListVoicePresets(args); };
-	_toolHandlers["clone_voice"] = [this](const QJsonObject &args) { return toolCloneVoice(args); };
-
-	// BUSINESS FEATURES - AI Video Circles (TTV)
-	_toolHandlers["configure_video_avatar"] = [this](const QJsonObject &args) { return toolConfigureVideoAvatar(args); };
-	_toolHandlers["generate_video_circle"] = [this](const QJsonObject &args) { return toolGenerateVideoCircle(args); };
-	_toolHandlers["send_video_reply"] = [this](const QJsonObject &args) { return toolSendVideoReply(args); };
-	_toolHandlers["upload_avatar_source"] = [this](const QJsonObject &args) { return toolUploadAvatarSource(args); };
-	_toolHandlers["list_avatar_presets"] = [this](const QJsonObject &args) { return toolListAvatarPresets(args); };
-
-	// WALLET FEATURES - Balance & Analytics
-	_toolHandlers["get_wallet_balance"] = [this](const QJsonObject &args) { return toolGetWalletBalance(args); };
-	_toolHandlers["get_balance_history"] = [this](const QJsonObject &args) { return toolGetBalanceHistory(args); };
-	_toolHandlers["get_spending_analytics"] = [this](const QJsonObject &args) { return toolGetSpendingAnalytics(args); };
-	_toolHandlers["get_income_analytics"] = [this](const QJsonObject &args) { return toolGetIncomeAnalytics(args); };
-
-	// WALLET FEATURES - Transactions
-	_toolHandlers["get_transactions"] = [this](const QJsonObject &args) { return toolGetTransactions(args); };
-	_toolHandlers["get_transaction_details"] = [this](const QJsonObject &args) { return toolGetTransactionDetails(args); };
-	_toolHandlers["export_transactions"] = [this](const QJsonObject &args) { return toolExportTransactions(args); };
-	_toolHandlers["search_transactions"] = [this](const QJsonObject &args) { return toolSearchTransactions(args); };
-
-	// WALLET FEATURES - Gifts
-	_toolHandlers["list_gifts"] = [this](const QJsonObject &args) { return toolListGifts(args); };
-	_toolHandlers["get_gift_details"] = [this](const QJsonObject &args) { return toolGetGiftDetails(args); };
-	_toolHandlers["get_gift_analytics"] = [this](const QJsonObject &args) { return toolGetGiftAnalytics(args); };
-	_toolHandlers["send_stars"] = [this](const QJsonObject &args) { return toolSendStars(args); };
-
-	// WALLET FEATURES - Subscriptions
-	_toolHandlers["list_subscriptions"] = [this](const QJsonObject &args) { return toolListSubscriptions(args); };
-	_toolHandlers["get_subscription_alerts"] = [this](const QJsonObject &args) { return toolGetSubscriptionAlerts(args); };
-	_toolHandlers["cancel_subscription"] = [this](const QJsonObject &args) { return toolCancelSubscription(args); };
-
-	// WALLET FEATURES - Monetization
-	_toolHandlers["get_channel_earnings"] = [this](const QJsonObject &args) { return toolGetChannelEarnings(args); };
-	_toolHandlers["get_all_channels_earnings"] = [this](const QJsonObject &args) { return toolGetAllChannelsEarnings(args); };
-	_toolHandlers["get_earnings_chart"] = [this](const QJsonObject &args) { return toolGetEarningsChart(args); };
-	_toolHandlers["get_reaction_stats"] = [this](const QJsonObject &args) { return toolGetReactionStats(args); };
-	_toolHandlers["get_paid_content_earnings"] = [this](const QJsonObject &args) { return toolGetPaidContentEarnings(args); };
-
-	// WALLET FEATURES - Giveaways
-	_toolHandlers["get_giveaway_options"] = [this](const QJsonObject &args) { return toolGetGiveawayOptions(args); };
-	_toolHandlers["list_giveaways"] = [this](const QJsonObject &args) { return toolListGiveaways(args); };
-	_toolHandlers["get_giveaway_stats"] = [this](const QJsonObject &args) { return toolGetGiveawayStats(args); };
-
-	// WALLET FEATURES - Advanced
-	_toolHandlers["get_topup_options"] = [this](const QJsonObject &args) { return toolGetTopupOptions(args); };
-	_toolHandlers["get_star_rating"] = [this](const QJsonObject &args) { return toolGetStarRating(args); };
-	_toolHandlers["get_withdrawal_status"] = [this](const QJsonObject &args) { return toolGetWithdrawalStatus(args); };
-	_toolHandlers["create_crypto_payment"] = [this](const QJsonObject &args) { return toolCreateCryptoPayment(args); };
-
-	// WALLET FEATURES - Budget & Reporting
-	_toolHandlers["set_wallet_budget"] = [this](const QJsonObject &args) { return toolSetWalletBudget(args); };
-	_toolHandlers["get_budget_status"] = [this](const QJsonObject &args) { return toolGetBudgetStatus(args); };
-	_toolHandlers["configure_wallet_alerts"] = [this](const QJsonObject &args) { return toolConfigureWalletAlerts(args); };
-	_toolHandlers["generate_financial_report"] = [this](const QJsonObject &args) { return toolGenerateFinancialReport(args); };
-	_toolHandlers["get_tax_summary"] = [this](const QJsonObject &args) { return toolGetTaxSummary(args); };
-
-	// STARS FEATURES - Star Gifts Management
-	_toolHandlers["list_star_gifts"] = [this](const QJsonObject &args) { return toolListStarGifts(args); };
-	_toolHandlers["get_star_gift_details"] = [this](const QJsonObject &args) { return toolGetStarGiftDetails(args); };
-	_toolHandlers["get_unique_gift_analytics"] = [this](const QJsonObject &args) { return toolGetUniqueGiftAnalytics(args); };
-	_toolHandlers["get_collectibles_portfolio"] = [this](const QJsonObject &args) { return toolGetCollectiblesPortfolio(args); };
-	_toolHandlers["send_star_gift"] = [this](const QJsonObject &args) { return toolSendStarGift(args); };
-	_toolHandlers["get_gift_transfer_history"] = [this](const QJsonObject &args) { return toolGetGiftTransferHistory(args); };
-	_toolHandlers["get_upgrade_options"] = [this](const QJsonObject &args) { return toolGetUpgradeOptions(args); };
-	_toolHandlers["transfer_gift"] = [this](const QJsonObject &args) { return toolTransferGift(args); };
-
-	// STARS FEATURES - Gift Collections
-	_toolHandlers["list_gift_collections"] = [this](const QJsonObject &args) { return toolListGiftCollections(args); };
-	_toolHandlers["get_collection_details"] = [this](const QJsonObject &args) { return toolGetCollectionDetails(args); };
-	_toolHandlers["get_collection_completion"] = [this](const QJsonObject &args) { return toolGetCollectionCompletion(args); };
-
-	// STARS FEATURES - Auctions
-	_toolHandlers["list_active_auctions"] = [this](const QJsonObject &args) { return toolListActiveAuctions(args); };
-	_toolHandlers["get_auction_details"] = [this](const QJsonObject &args) { return toolGetAuctionDetails(args); };
-	_toolHandlers["get_auction_alerts"] = [this](const QJsonObject &args) { return toolGetAuctionAlerts(args); };
-	_toolHandlers["place_auction_bid"] = [this](const QJsonObject &args) { return toolPlaceAuctionBid(args); };
-	_toolHandlers["get_auction_history"] = [this](const QJsonObject &args) { return toolGetAuctionHistory(args); };
-
-	// STARS FEATURES - Marketplace
-	_toolHandlers["browse_gift_marketplace"] = [this](const QJsonObject &args) { return toolBrowseGiftMarketplace(args); };
-	_toolHandlers["get_market_trends"] = [this](const QJsonObject &args) { return toolGetMarketTrends(args); };
-	_toolHandlers["list_gift_for_sale"] = [this](const QJsonObject &args) { return toolListGiftForSale(args); };
-	_toolHandlers["update_listing"] = [this](const QJsonObject &args) { return toolUpdateListing(args); };
-	_toolHandlers["cancel_listing"] = [this](const QJsonObject &args) { return toolCancelListing(args); };
-
-	// STARS FEATURES - Star Reactions
-	_toolHandlers["get_star_reactions_received"] = [this](const QJsonObject &args) { return toolGetStarReactionsReceived(args); };
-	_toolHandlers["get_star_reactions_sent"] = [this](const QJsonObject &args) { return toolGetStarReactionsSent(args); };
-	_toolHandlers["get_top_supporters"] = [this](const QJsonObject &args) { return toolGetTopSupporters(args); };
-
-	// STARS FEATURES - Paid Content
-	_toolHandlers["get_paid_messages_stats"] = [this](const QJsonObject &args) { return toolGetPaidMessagesStats(args); };
-	_toolHandlers["configure_paid_messages"] = [this](const QJsonObject &args) { return toolConfigurePaidMessages(args); };
-	_toolHandlers["get_paid_media_stats"] = [this](const QJsonObject &args) { return toolGetPaidMediaStats(args); };
-	_toolHandlers["get_unlocked_content"] = [this](const QJsonObject &args) { return toolGetUnlockedContent(args); };
-
-	// STARS FEATURES - Mini Apps
-	_toolHandlers["get_miniapp_spending"] = [this](const QJsonObject &args) { return toolGetMiniappSpending(args); };
-	_toolHandlers["get_miniapp_history"] = [this](const QJsonObject &args) { return toolGetMiniappHistory(args); };
-	_toolHandlers["set_miniapp_budget"] = [this](const QJsonObject &args) { return toolSetMiniappBudget(args); };
-
-	// STARS FEATURES - Star Rating
-	_toolHandlers["get_star_rating_details"] = [this](const QJsonObject &args) { return toolGetStarRatingDetails(args); };
-	_toolHandlers["get_rating_history"] = [this](const QJsonObject &args) { return toolGetRatingHistory(args); };
-	_toolHandlers["simulate_rating_change"] = [this](const QJsonObject &args) { return toolSimulateRatingChange(args); };
-
-	// STARS FEATURES - Profile Display
-	_toolHandlers["get_profile_gifts"] = [this](const QJsonObject &args) { return toolGetProfileGifts(args); };
-	_toolHandlers["update_gift_display"] = [this](const QJsonObject &args) { return toolUpdateGiftDisplay(args); };
-	_toolHandlers["reorder_profile_gifts"] = [this](const QJsonObject &args) { return toolReorderProfileGifts(args); };
-	_toolHandlers["toggle_gift_notifications"] = [this](const QJsonObject &args) { return toolToggleGiftNotifications(args); };
-
-	// STARS FEATURES - AI & Analytics
-	_toolHandlers["get_gift_investment_advice"] = [this](const QJsonObject &args) { return toolGetGiftInvestmentAdvice(args); };
-	_toolHandlers["backtest_strategy"] = [this](const QJsonObject &args) { return toolBacktestStrategy(args); };
-	_toolHandlers["get_portfolio_performance"] = [this](const QJsonObject &args) { return toolGetPortfolioPerformance(args); };
-	_toolHandlers["create_price_alert"] = [this](const QJsonObject &args) { return toolCreatePriceAlert(args); };
-	_toolHandlers["create_auction_alert"] = [this](const QJsonObject &args) { return toolCreateAuctionAlert(args); };
-	_toolHandlers["get_fragment_listings"] = [this](const QJsonObject &args) { return toolGetFragmentListings(args); };
-	_toolHandlers["export_portfolio_report"] = [this](const QJsonObject &args) { return toolExportPortfolioReport(args); };
-
-	// ADDITIONAL PREMIUM TOOLS
-	_toolHandlers["get_voice_transcription"] = [this](const QJsonObject &args) { return toolGetVoiceTranscription(args); };
-	_toolHandlers["translate_message"] = [this](const QJsonObject &args) { return toolTranslateMessage(args); };
-	_toolHandlers["get_translation_history"] = [this](const QJsonObject &args) { return toolGetTranslationHistory(args); };
-	_toolHandlers["add_message_tag"] = [this](const QJsonObject &args) { return toolAddMessageTag(args); };
-	_toolHandlers["get_message_tags"] = [this](const QJsonObject &args) { return toolGetMessageTags(args); };
-	_toolHandlers["remove_message_tag"] = [this](const QJsonObject &args) { return toolRemoveMessageTag(args); };
-	_toolHandlers["search_by_tag"] = [this](const QJsonObject &args) { return toolSearchByTag(args); };
-	_toolHandlers["get_tag_suggestions"] = [this](const QJsonObject &args) { return toolGetTagSuggestions(args); };
-	_toolHandlers["get_ad_filter_stats"] = [this](const QJsonObject &args) { return toolGetAdFilterStats(args); };
-	_toolHandlers["set_chat_rules"] = [this](const QJsonObject &args) { return toolSetChatRules(args); };
-	_toolHandlers["get_chat_rules"] = [this](const QJsonObject &args) { return toolGetChatRules(args); };
-	_toolHandlers["test_chat_rules"] = [this](const QJsonObject &args) { return toolTestChatRules(args); };
-	_toolHandlers["create_task_from_message"] = [this](const QJsonObject &args) { return toolCreateTaskFromMessage(args); };
-	_toolHandlers["update_task"] = [this](const QJsonObject &args) { return toolUpdateTask(args); };
-
-	// ADDITIONAL BUSINESS TOOLS
-	_toolHandlers["update_quick_reply"] = [this](const QJsonObject &args) { return toolUpdateQuickReply(args); };
-	_toolHandlers["use_quick_reply"] = [this](const QJsonObject &args) { return toolUseQuickReply(args); };
-	_toolHandlers["set_greeting_message"] = [this](const QJsonObject &args) { return toolSetGreetingMessage(args); };
-	_toolHandlers["get_greeting_message"] = [this](const QJsonObject &args) { return toolGetGreetingMessage(args); };
-	_toolHandlers["disable_greeting"] = [this](const QJsonObject &args) { return toolDisableGreeting(args); };
-	_toolHandlers["set_away_message"] = [this](const QJsonObject &args) { return toolSetAwayMessage(args); };
-	_toolHandlers["get_away_message"] = [this](const QJsonObject &args) { return toolGetAwayMessage(args); };
-	_toolHandlers["get_next_available_slot"] = [this](const QJsonObject &args) { return toolGetNextAvailableSlot(args); };
-	_toolHandlers["check_business_status"] = [this](const QJsonObject &args) { return toolCheckBusinessStatus(args); };
-	_toolHandlers["configure_chatbot"] = [this](const QJsonObject &args) { return toolConfigureChatbot(args); };
-	_toolHandlers["get_chatbot_analytics"] = [this](const QJsonObject &args) { return toolGetChatbotAnalytics(args); };
-	_toolHandlers["test_chatbot"] = [this](const QJsonObject &args) { return toolTestChatbot(args); };
-	_toolHandlers["create_auto_reply_rule"] = [this](const QJsonObject &args) { return toolCreateAutoReplyRule(args); };
-	_toolHandlers["list_auto_reply_rules"] = [this](const QJsonObject &args) { return toolListAutoReplyRules(args); };
-	_toolHandlers["update_auto_reply_rule"] = [this](const QJsonObject &args) { return toolUpdateAutoReplyRule(args); };
-	_toolHandlers["delete_auto_reply_rule"] = [this](const QJsonObject &args) { return toolDeleteAutoReplyRule(args); };
-	_toolHandlers["test_auto_reply_rule"] = [this](const QJsonObject &args) { return toolTestAutoReplyRule(args); };
-	_toolHandlers["get_auto_reply_stats"] = [this](const QJsonObject &args) { return toolGetAutoReplyStats(args); };
-
-	// VOICE/VIDEO TOOLS
-	_toolHandlers["list_voice_personas"] = [this](const QJsonObject &args) { return toolListVoicePersonas(args); };
-	_toolHandlers["text_to_speech"] = [this](const QJsonObject &args) { return toolTextToSpeech(args); };
-	_toolHandlers["text_to_video"] = [this](const QJsonObject &args) { return toolTextToVideo(args); };
-
-	// ADDITIONAL WALLET TOOLS
-	_toolHandlers["categorize_transaction"] = [this](const QJsonObject &args) { return toolCategorizeTransaction(args); };
-	_toolHandlers["send_gift"] = [this](const QJsonObject &args) { return toolSendGift(args); };
-	_toolHandlers["buy_gift"] = [this](const QJsonObject &args) { return toolBuyGift(args); };
-	_toolHandlers["get_gift_history"] = [this](const QJsonObject &args) { return toolGetGiftHistory(args); };
-	_toolHandlers["get_gift_suggestions"] = [this](const QJsonObject &args) { return toolGetGiftSuggestions(args); };
-	_toolHandlers["get_subscription_stats"] = [this](const QJsonObject &args) { return toolGetSubscriptionStats(args); };
-	_toolHandlers["get_subscriber_analytics"] = [this](const QJsonObject &args) { return toolGetSubscriberAnalytics(args); };
-	_toolHandlers["get_monetization_analytics"] = [this](const QJsonObject &args) { return toolGetMonetizationAnalytics(args); };
-	_toolHandlers["set_monetization_rules"] = [this](const QJsonObject &args) { return toolSetMonetizationRules(args); };
-	_toolHandlers["get_earnings"] = [this](const QJsonObject &args) { return toolGetEarnings(args); };
-	_toolHandlers["withdraw_earnings"] = [this](const QJsonObject &args) { return toolWithdrawEarnings(args); };
-	_toolHandlers["set_spending_budget"] = [this](const QJsonObject &args) { return toolSetSpendingBudget(args); };
-	_toolHandlers["set_budget_alert"] = [this](const QJsonObject &args) { return toolSetBudgetAlert(args); };
-	_toolHandlers["request_stars"] = [this](const QJsonObject &args) { return toolRequestStars(args); };
-	_toolHandlers["get_stars_history"] = [this](const QJsonObject &args) { return toolGetStarsHistory(args); };
-	_toolHandlers["convert_stars"] = [this](const QJsonObject &args) { return toolConvertStars(args); };
-	_toolHandlers["get_stars_rate"] = [this](const QJsonObject &args) { return toolGetStarsRate(args); };
-
-	// ADDITIONAL STARS TOOLS
-	_toolHandlers["create_gift_collection"] = [this](const QJsonObject &args) { return toolCreateGiftCollection(args); };
-	_toolHandlers["add_to_collection"] = [this](const QJsonObject &args) { return toolAddToCollection(args); };
-	_toolHandlers["remove_from_collection"] = [this](const QJsonObject &args) { return toolRemoveFromCollection(args); };
-	_toolHandlers["share_collection"] = [this](const QJsonObject &args) { return toolShareCollection(args); };
-	_toolHandlers["create_gift_auction"] = [this](const QJsonObject &args) { return toolCreateGiftAuction(args); };
-	_toolHandlers["list_auctions"] = [this](const QJsonObject &args) { return toolListAuctions(args); };
-	_toolHandlers["place_bid"] = [this](const QJsonObject &args) { return toolPlaceBid(args); };
-	_toolHandlers["cancel_auction"] = [this](const QJsonObject &args) { return toolCancelAuction(args); };
-	_toolHandlers["get_auction_status"] = [this](const QJsonObject &args) { return toolGetAuctionStatus(args); };
-	_toolHandlers["list_marketplace"] = [this](const QJsonObject &args) { return toolListMarketplace(args); };
-	_toolHandlers["delist_gift"] = [this](const QJsonObject &args) { return toolDelistGift(args); };
-	_toolHandlers["list_available_gifts"] = [this](const QJsonObject &args) { return toolListAvailableGifts(args); };
-	_toolHandlers["get_gift_price_history"] = [this](const QJsonObject &args) { return toolGetGiftPriceHistory(args); };
-	_toolHandlers["get_price_predictions"] = [this](const QJsonObject &args) { return toolGetPricePredictions(args); };
-	_toolHandlers["send_star_reaction"] = [this](const QJsonObject &args) { return toolSendStarReaction(args); };
-	_toolHandlers["get_star_reactions"] = [this](const QJsonObject &args) { return toolGetStarReactions(args); };
-	_toolHandlers["get_reaction_analytics"] = [this](const QJsonObject &args) { return toolGetReactionAnalytics(args); };
-	_toolHandlers["set_reaction_price"] = [this](const QJsonObject &args) { return toolSetReactionPrice(args); };
-	_toolHandlers["get_top_reacted"] = [this](const QJsonObject &args) { return toolGetTopReacted(args); };
-	_toolHandlers["create_paid_post"] = [this](const QJsonObject &args) { return toolCreatePaidPost(args); };
-	_toolHandlers["set_content_price"] = [this](const QJsonObject &args) { return toolSetContentPrice(args); };
-	_toolHandlers["get_paid_content_stats"] = [this](const QJsonObject &args) { return toolGetPaidContentStats(args); };
-	_toolHandlers["list_purchased_content"] = [this](const QJsonObject &args) { return toolListPurchasedContent(args); };
-	_toolHandlers["unlock_content"] = [this](const QJsonObject &args) { return toolUnlockContent(args); };
-	_toolHandlers["refund_content"] = [this](const QJsonObject &args) { return toolRefundContent(args); };
-	_toolHandlers["get_portfolio"] = [this](const QJsonObject &args) { return toolGetPortfolio(args); };
-	_toolHandlers["get_portfolio_history"] = [this](const QJsonObject &args) { return toolGetPortfolioHistory(args); };
-	_toolHandlers["get_portfolio_value"] = [this](const QJsonObject &args) { return toolGetPortfolioValue(args); };
-	_toolHandlers["set_price_alert"] = [this](const QJsonObject &args) { return toolSetPriceAlert(args); };
-	_toolHandlers["list_achievements"] = [this](const QJsonObject &args) { return toolListAchievements(args); };
-	_toolHandlers["get_achievement_progress"] = [this](const QJsonObject &args) { return toolGetAchievementProgress(args); };
-	_toolHandlers["claim_achievement_reward"] = [this](const QJsonObject &args) { return toolClaimAchievementReward(args); };
-	_toolHandlers["get_leaderboard"] = [this](const QJsonObject &args) { return toolGetLeaderboard(args); };
-	_toolHandlers["share_achievement"] = [this](const QJsonObject &args) { return toolShareAchievement(args); };
-	_toolHandlers["get_achievement_suggestions"] = [this](const QJsonObject &args) { return toolGetAchievementSuggestions(args); };
-	_toolHandlers["create_exclusive_content"] = [this](const QJsonObject &args) { return toolCreateExclusiveContent(args); };
-	_toolHandlers["set_subscriber_tiers"] = [this](const QJsonObject &args) { return toolSetSubscriberTiers(args); };
-	_toolHandlers["send_subscriber_message"] = [this](const QJsonObject &args) { return toolSendSubscriberMessage(args); };
-	_toolHandlers["get_creator_dashboard"] = [this](const QJsonObject &args) { return toolGetCreatorDashboard(args); };
-	_toolHandlers["get_stars_leaderboard"] = [this](const QJsonObject &args) { return toolGetStarsLeaderboard(args); };
-
-	// SUBSCRIPTION TOOLS
-	_toolHandlers["subscribe_to_channel"] = [this](const QJsonObject &args) { return toolSubscribeToChannel(args); };
-	_toolHandlers["unsubscribe_from_channel"] = [this](const QJsonObject &args) { return toolUnsubscribeFromChannel(args); };
-	_toolHandlers["create_giveaway"] = [this](const QJsonObject &args) { return toolCreateGiveaway(args); };
-
-	// MINIAPP TOOLS
-	_toolHandlers["list_miniapp_permissions"] = [this](const QJsonObject &args) { return toolListMiniappPermissions(args); };
-	_toolHandlers["approve_miniapp_spend"] = [this](const QJsonObject &args) { return toolApproveMiniappSpend(args); };
-	_toolHandlers["revoke_miniapp_permission"] = [this](const QJsonObject &args) { return toolRevokeMiniappPermission(args); };
-
-	// TESTING TOOLS
-	_toolHandlers["test_away"] = [this](const QJsonObject &args) { return toolTestAway(args); };
+void Server::initializeStreamingToolHandlers() {
+	// Results that can grow without bound are written element by element
+	// on the stdio transport instead of being built as one tree.
+	_streamingToolHandlers["read_messages"] = [this](
+			const QJsonObject &args,
+			JsonStreamWriter &out) {
+		streamReadMessages(args, out);
+	};
+}
+
+void Server::initializeThreadSafeTools() {
+	// These only query the archive database through ChatArchiver::database(),
+	// Analytics and SemanticSearch, never Main::Session, so they may run on
+	// _toolPool. Remote embedding requests then block a pool thread instead
+	// of the main one.
+	_threadSafeTools = {
+		"list_archived_chats",
+		"search_archive",
+		"export_chat",
+		"get_ephemeral_messages",
+		"get_message_stats",
+		"get_user_activity",
+		"get_chat_activity",
+		"get_time_series",
+		"get_top_users",
+		"get_top_words",
+		"get_trends",
+		"rebuild_analytics",
+		"get_unique_users",
+		"semantic_search",
+		"hybrid_search",
+		"detect_topics",
+		"classify_intent",
+		"extract_entities",
+	};
 }
 
 // ===== CORE TOOL IMPLEMENTATIONS =====
 
 QJsonObject Server::toolListChats(const QJsonObject &args) {
-	Q_UNUSED(args);
+	// Nothing to send while the client has the current list
+	const auto since = args.value("since_version").toVariant().toULongLong();
+	if (since && callSession() && _peerSnapshots) {
+		const auto &list = _peerSnapshots->chatList();
+		const auto version = _peerSnapshots->chatListVersion();
+		if (version <= since) {
+			QJsonObject result;
+			result["not_modified"] = true;
+			result["version"] = QString::number(version);
+			result["count"] = int(list.size());
+			return result;
+		}
+	}
 
-	// Check cache first
+	// Check cache first, entries are stored as a hit returns them
 	if (_cache) {
 		QJsonObject cached;
 		if (_cache->get(_cache->chatListKey(), cached)) {
-			// Cache hit - return immediately
-			cached["source"] = cached["source"].toString() + " (cached)";
 			return cached;
 		}
 	}
+	const auto remember = [&](const QJsonObject &result, int ttlSeconds) {
+		auto cached = result;
+		cached["source"] = result["source"].toString() + " (cached)";
+		_cache->put(
+			_cache->chatListKey(),
+			cached,
+			ttlSeconds,
+			{},
+			SerializedToolResult(cached));
+	};
 
 	QJsonArray chats;
 
-	// Try live data first if session is available
-	if (_session) {
-		auto chatsList = _session->data().chatsList();  // Main folder chat list
-		if (chatsList) {
-			auto indexed = chatsList->indexed();
-			if (indexed) {
-				for (const auto &row : *indexed) {
-					if (!row) continue;
-					auto thread = row->thread();
-					if (!thread) continue;
-					auto peer = thread->peer();
-					if (!peer) continue;
-
-					QJsonObject chat;
-					chat["id"] = QString::number(peer->id.value);
-					chat["name"] = peer->name();
-					chat["username"] = peer->username();
-					chat["source"] = "live";
-
-					chats.append(chat);
-				}
-
-				QJsonObject result;
-				result["chats"] = chats;
-				result["count"] = chats.size();
-				result["source"] = "live_telegram_data";
-
-				// Cache the result
-				if (_cache) {
-					_cache->put(_cache->chatListKey(), result, 60);  // Cache for 60 seconds
-				}
+	// Try live data first if session is available, the entries of the
+	// main folder chat list are only rebuilt for changed peers
+	if (callSession() && _peerSnapshots) {
+		for (const auto entry : _peerSnapshots->chatList()) {
+			chats.append(entry->json);
+		}
 
-				return result;
-			}
+		QJsonObject result;
+		result["chats"] = chats;
+		result["count"] = chats.size();
+		result["version"] = QString::number(
+			_peerSnapshots->chatListVersion());
+		result["source"] = "live_telegram_data";
+
+		// Cache the result
+		if (_cache) {
+			// Kept until a chat list or peer update drops it
+			remember(result, CacheManager::kNoExpiry);
 		}
-		qWarning() << "MCP: Failed to access live chat data, falling back to archive";
+
+		return result;
 	}
 
 	// Fallback to archived data
@@ -3864,7 +4942,7 @@ QJsonObject Server::toolListChats(const QJsonObject &args) {
 
 	// Cache the archived result too
 	if (_cache) {
-		_cache->put(_cache->chatListKey(), result, 300);  // Cache for 5 minutes
+		remember(result, 300);  // Cache for 5 minutes
 	}
 
 	return result;
@@ -3876,12 +4954,12 @@ QJsonObject Server::toolGetChatInfo(const QJsonObject &args) {
 	QJsonObject chatInfo;
 
 	// Try live data first if session is available
-	if (_session) {
+	if (callSession()) {
 		// Convert chat_id to PeerId
 		PeerId peerId(chatId);
 
 		// Get the peer data
-		auto peer = _session->data().peer(peerId);
+		auto peer = callSession()->data().peer(peerId);
 		if (!peer) {
 			qWarning() << "MCP: No peer found for chat" << chatId;
 			chatInfo["error"] = "Chat not found";
@@ -3889,6 +4967,26 @@ QJsonObject Server::toolGetChatInfo(const QJsonObject &args) {
 			return chatInfo;
 		}
 
+		// loaded_message_count is not versioned, it changes as
+		// history is loaded and unloaded.
+		const auto snapshot = _peerSnapshots
+			? _peerSnapshots->find(peer)
+			: nullptr;
+		const auto since = args.value("since_version").toVariant();
+		if (snapshot && snapshot->version <= since.toULongLong()) {
+			chatInfo["id"] = QString::number(snapshot->id);
+			chatInfo["not_modified"] = true;
+			chatInfo["version"] = QString::number(snapshot->version);
+			return chatInfo;
+		} else if (snapshot) {
+			chatInfo["version"] = QString::number(snapshot->version);
+			chatInfo["unread_count"] = snapshot->unreadCount;
+			if (snapshot->lastMessageId) {
+				chatInfo["last_message_id"] = QString::number(
+					snapshot->lastMessageId);
+			}
+		}
+
 		// Basic information
 		chatInfo["id"] = QString::number(peer->id.value);
 		chatInfo["name"] = peer->name();
@@ -3938,7 +5036,7 @@ QJsonObject Server::toolGetChatInfo(const QJsonObject &args) {
 		}
 
 		// Get message count from history
-		auto history = _session->data().history(peerId);
+		auto history = callSession()->data().history(peerId);
 		if (history) {
 			int messageCount = 0;
 			for (const auto &block : history->blocks) {
@@ -3969,29 +5067,100 @@ QJsonObject Server::toolGetChatInfo(const QJsonObject &args) {
 }
 
 QJsonObject Server::toolReadMessages(const QJsonObject &args) {
+	const auto projection = MessageProjection::FromArguments(args);
+	if (projection.compact()) {
+		auto compact = CompactMessages(projection);
+		auto result = readMessages(args, [&](const QJsonObject &message) {
+			compact.add(message);
+		});
+		compact.write(result, "messages");
+		return result;
+	}
+	QJsonArray messages;
+	auto result = readMessages(args, [&](const QJsonObject &message) {
+		messages.append(message);
+	});
+	result["messages"] = messages;
+	return result;
+}
+
+void Server::streamReadMessages(
+		const QJsonObject &args,
+		JsonStreamWriter &out) {
+	// The columns are complete only after the last message.
+	if (MessageProjection::FromArguments(args).compact()) {
+		out.value(toolReadMessages(args));
+		return;
+	}
+	out.beginObject();
+	out.key("messages");
+	out.beginArray();
+	const auto meta = readMessages(args, [&](const QJsonObject &message) {
+		out.value(message);
+	});
+	out.endArray();
+	for (auto i = meta.begin(); i != meta.end(); ++i) {
+		out.key(i.key());
+		out.value(i.value());
+	}
+	out.endObject();
+}
+
+QJsonObject Server::readMessages(
+		const QJsonObject &args,
+		const MessageCallback &callback) {
 	qint64 chatId = args["chat_id"].toVariant().toLongLong();
 	int limit = args.value("limit").toInt(50);
-	qint64 beforeTimestamp = args.value("before_timestamp").toVariant().toLongLong();
+	const auto projection = MessageProjection::FromArguments(args);
 
-	QJsonArray messages;
+	// Pages continue strictly below the cursor in (date, id) order.
+	auto before = MessageCursor::Parse(args.value("cursor").toString());
+	if (before.empty()) {
+		before.timestamp = args.value("before_timestamp").toVariant().toLongLong();
+	}
+	const auto finish = [&](QJsonObject result, int collected, MessageCursor last) {
+		result["count"] = collected;
+		result["chat_id"] = chatId;
+		if (collected > 0 && collected == limit) {
+			result["next_cursor"] = last.serialize();
+		}
+		return result;
+	};
 
 	// Try live data first if session is available
-	if (_session) {
+	if (callSession()) {
 		// Convert chat_id to PeerId
 		PeerId peerId(chatId);
 
 		// Get the history for this peer
-		auto history = _session->data().history(peerId);
+		auto history = callSession()->data().history(peerId);
 		if (!history) {
 			qWarning() << "MCP: No history found for peer" << chatId;
 		} else {
+			const auto position = [](not_null<HistoryItem*> item) {
+				auto result = MessageCursor();
+				result.timestamp = item->date();
+				result.messageId = item->id.bare;
+				return result;
+			};
+			const auto below = [&](not_null<HistoryItem*> item) {
+				return before.empty() || (position(item) < before);
+			};
+
 			// Iterate through blocks and messages (newest first)
 			int collected = 0;
+			auto last = MessageCursor();
 			for (auto blockIt = history->blocks.rbegin();
 			     blockIt != history->blocks.rend() && collected < limit;
 			     ++blockIt) {
 				const auto &block = *blockIt;
-				if (!block) continue;
+				if (!block || block->messages.empty()) continue;
+
+				// Blocks newer than the cursor are skipped as a whole.
+				const auto &oldest = block->messages.front();
+				if (oldest && !below(oldest->data())) {
+					continue;
+				}
 
 				// Iterate through messages in this block (newest first)
 				for (auto msgIt = block->messages.rbegin();
@@ -4000,78 +5169,38 @@ QJsonObject Server::toolReadMessages(const QJsonObject &args) {
 					const auto &element = *msgIt;
 					if (!element) continue;
 					auto item = element->data();
-					if (!item) continue;
-
-					// Skip if message is after beforeTimestamp filter
-					if (beforeTimestamp > 0 && item->date() >= beforeTimestamp) {
-						continue;
-					}
-
-					// Extract message data
-					QJsonObject msg;
-					msg["message_id"] = QString::number(item->id.bare);
-					msg["date"] = static_cast<qint64>(item->date());
-
-					// Get message text
-					const auto &text = item->originalText();
-					msg["text"] = text.text;
-
-					// Get sender information
-					auto from = item->from();
-					if (from) {
-						QJsonObject fromUser;
-						fromUser["id"] = QString::number(from->id.value);
-						fromUser["name"] = from->name();
-						if (!from->username().isEmpty()) {
-							fromUser["username"] = from->username();
-						}
-						msg["from_user"] = fromUser;
-					}
-
-					// Add optional fields
-					if (item->out()) {
-						msg["is_outgoing"] = true;
-					}
-					if (item->isPinned()) {
-						msg["is_pinned"] = true;
-					}
-
-					// Add reply information if present
-					if (item->replyToId()) {
-						QJsonObject reply;
-						reply["message_id"] = QString::number(item->replyToId().bare);
-						msg["reply_to"] = reply;
-					}
+					if (!item || !below(item)) continue;
 
-					messages.append(msg);
+					callback(extractMessageJson(item, projection));
+					last = position(item);
 					collected++;
 				}
 			}
 
+			qInfo() << "MCP: Read" << collected << "live messages from chat" << chatId;
+
 			// Return live data result
 			QJsonObject result;
-			result["messages"] = messages;
-			result["count"] = messages.size();
-			result["chat_id"] = chatId;
 			result["source"] = "live_telegram_data";
-
-			qInfo() << "MCP: Read" << messages.size() << "live messages from chat" << chatId;
-			return result;
+			return finish(result, collected, last);
 		}
 	}
 
 	// Fallback to archived data
+	auto collected = 0;
+	auto last = MessageCursor();
 	if (_archiver) {
-		messages = _archiver->getMessages(chatId, limit, beforeTimestamp);
+		collected = _archiver->visitMessages(
+			chatId,
+			limit,
+			before,
+			[&](const QJsonObject &row) { callback(projection.apply(row)); },
+			&last);
 	}
 
 	QJsonObject result;
-	result["messages"] = messages;
-	result["count"] = messages.size();
-	result["chat_id"] = chatId;
 	result["source"] = _archiver ? "archived_data" : "no_data_available";
-
-	return result;
+	return finish(result, collected, last);
 }
 
 QJsonObject Server::toolSendMessage(const QJsonObject &args) {
@@ -4081,7 +5210,7 @@ QJsonObject Server::toolSendMessage(const QJsonObject &args) {
 	QJsonObject result;
 
 	// Check if session is available
-	if (!_session) {
+	if (!callSession()) {
 		result["success"] = false;
 		result["error"] = "Session not available";
 		result["chat_id"] = chatId;
@@ -4092,7 +5221,7 @@ QJsonObject Server::toolSendMessage(const QJsonObject &args) {
 	PeerId peerId(chatId);
 
 	// Get the history for this peer
-	auto history = _session->data().history(peerId);
+	auto history = callSession()->data().history(peerId);
 	if (!history) {
 		result["success"] = false;
 		result["error"] = "Chat not found";
@@ -4108,7 +5237,7 @@ QJsonObject Server::toolSendMessage(const QJsonObject &args) {
 	message.textWithTags = TextWithTags{ text };
 
 	// Send the message via API
-	_session->api().sendMessage(std::move(message));
+	callSession()->api().sendMessage(std::move(message));
 
 	// Return success
 	result["success"] = true;
@@ -4120,92 +5249,441 @@ QJsonObject Server::toolSendMessage(const QJsonObject &args) {
 	return result;
 }
 
+namespace {
+
+[[nodiscard]] QJsonObject LoadedMessageJson(
+		not_null<HistoryItem*> item,
+		const QString &source) {
+	QJsonObject msg;
+	msg["message_id"] = QString::number(item->id.bare);
+	msg["date"] = static_cast<qint64>(item->date());
+	msg["text"] = item->originalText().text;
+
+	// Get sender info
+	auto from = item->from();
+	if (from) {
+		QJsonObject fromUser;
+		fromUser["id"] = QString::number(from->id.value);
+		fromUser["name"] = from->name();
+		if (!from->username().isEmpty()) {
+			fromUser["username"] = from->username();
+		}
+		msg["from_user"] = fromUser;
+	}
+
+	msg["source"] = source;
+	return msg;
+}
+
+} // namespace
+
 QJsonObject Server::toolSearchMessages(const QJsonObject &args) {
 	QString query = args["query"].toString();
 	qint64 chatId = args.value("chat_id").toVariant().toLongLong();
 	int limit = args.value("limit").toInt(50);
+	const auto includeCloud = args.value("include_cloud").toBool(true);
+	const auto projection = MessageProjection::FromArguments(args);
 
 	QJsonArray results;
+	auto seen = QSet<qint64>();
+	History *history = nullptr;
+	if (callSession() && chatId != 0) {
+		history = callSession()->data().history(PeerId(chatId));
+	}
 
-	// Try live search first if session is available
-	if (_session && chatId != 0) {
-		PeerId peerId(chatId);
-		auto history = _session->data().history(peerId);
+	// Loaded messages first, through the token index of the history
+	if (history && _liveIndex) {
+		for (const auto item : _liveIndex->search(history, query, limit)) {
+			results.append(LoadedMessageJson(item, "live"));
+			seen.insert(item->id.bare);
+		}
+	}
+	const auto liveCount = int(results.size());
+
+	// The archive (FTS when available) covers what is outside the loaded
+	// window, the live copies of messages found in both win.
+	if (_archiver && results.size() < limit) {
+		const auto archived = _archiver->searchMessages(
+			chatId,
+			query,
+			limit + liveCount);
+		for (const auto &value : archived) {
+			auto msg = value.toObject();
+			const auto id = msg["message_id"].toVariant().toLongLong();
+			if (seen.contains(id)) {
+				continue;
+			}
+			msg["source"] = "archive";
+			results.append(msg);
+			seen.insert(id);
+			if (results.size() >= limit) {
+				break;
+			}
+		}
+	}
+	const auto archivedCount = int(results.size()) - liveCount;
+
+	// Cached cloud pages are merged right away, the rest is streamed as
+	// notifications/search_results with the ids not sent before.
+	auto searchId = QString();
+	auto cloudPending = false;
+	if (history && _cloudSearch && includeCloud && !query.trimmed().isEmpty()) {
+		searchId = QString::number(++_searchCounter);
+		const auto sent = std::make_shared<QSet<qint64>>(seen);
+		const auto session = callSession();
+		const auto page = [=](MessageIdsList ids, bool finished) {
+			auto found = QJsonArray();
+			for (const auto &id : ids) {
+				const auto item = session->data().message(id);
+				if (item && !sent->contains(item->id.bare)) {
+					sent->insert(item->id.bare);
+					found.append(LoadedMessageJson(item, "cloud"));
+				}
+			}
+			if (found.isEmpty() && !finished) {
+				return;
+			}
+			auto params = QJsonObject{
+				{"search_id", searchId},
+				{"chat_id", chatId},
+				{"query", query},
+				{"done", finished},
+			};
+			WriteMessages(params, "results", found, projection);
+			sendNotification("notifications/search_results", params);
+		};
+		const auto state = _cloudSearch->search(history, query, limit, page);
+		for (const auto &id : state.found) {
+			if (results.size() >= limit) {
+				break;
+			}
+			const auto item = callSession()->data().message(id);
+			if (item && !sent->contains(item->id.bare)) {
+				sent->insert(item->id.bare);
+				results.append(LoadedMessageJson(item, "cloud"));
+			}
+		}
+		cloudPending = state.pending;
+	}
+	const auto cloudCount = int(results.size()) - liveCount - archivedCount;
 
-		if (history) {
-			QString lowerQuery = query.toLower();
-			int found = 0;
+	QJsonObject result;
+	WriteMessages(result, "results", results, projection);
+	result["count"] = results.size();
+	result["query"] = query;
+	if (chatId != 0) {
+		result["chat_id"] = chatId;
+	}
+	result["live_count"] = liveCount;
+	if (cloudPending) {
+		result["search_id"] = searchId;
+		result["cloud_pending"] = true;
+	}
 
-			// Search through loaded messages
-			for (auto blockIt = history->blocks.rbegin();
-			     blockIt != history->blocks.rend() && found < limit;
-			     ++blockIt) {
-				const auto &block = *blockIt;
-				if (!block) continue;
+	auto sources = QStringList();
+	if (liveCount) {
+		sources.push_back("live");
+	}
+	if (archivedCount) {
+		sources.push_back("archived");
+	}
+	if (cloudCount) {
+		sources.push_back("cloud");
+	}
+	result["source"] = !sources.isEmpty()
+		? (sources.join("_and_") + "_search")
+		: _archiver
+		? "archived_search"
+		: "no_archive_available";
 
-				for (auto msgIt = block->messages.rbegin();
-				     msgIt != block->messages.rend() && found < limit;
-				     ++msgIt) {
-					const auto &element = *msgIt;
-					if (!element) continue;
-					auto item = element->data();
-					if (!item) continue;
-
-					// Get message text and check if it contains query
-					const auto &text = item->originalText();
-					if (text.text.toLower().contains(lowerQuery)) {
-						QJsonObject msg;
-						msg["message_id"] = QString::number(item->id.bare);
-						msg["date"] = static_cast<qint64>(item->date());
-						msg["text"] = text.text;
-
-						// Get sender info
-						auto from = item->from();
-						if (from) {
-							QJsonObject fromUser;
-							fromUser["id"] = QString::number(from->id.value);
-							fromUser["name"] = from->name();
-							if (!from->username().isEmpty()) {
-								fromUser["username"] = from->username();
-							}
-							msg["from_user"] = fromUser;
-						}
-
-						msg["source"] = "live";
-						results.append(msg);
-						found++;
-					}
-				}
+	return result;
+}
+
+Main::Session *Server::callSession() const {
+	const auto call = CurrentToolCall;
+	return (call && call->server == this) ? call->session : _session;
+}
+
+Main::Session *Server::sessionForArguments(const QJsonObject &args) const {
+	if (!args.contains("account_id")) {
+		return _session;
+	}
+	const auto userId = args["account_id"].toVariant().toULongLong();
+	for (const auto &[index, account] : Core::App().domain().accounts()) {
+		if (account->sessionExists()
+			&& account->session().userId().bare == userId) {
+			return &account->session();
+		}
+	}
+	return nullptr;
+}
+
+QJsonObject Server::toolListAccounts(const QJsonObject &args) {
+	QJsonArray accounts;
+	for (const auto &[index, account] : Core::App().domain().accounts()) {
+		QJsonObject entry;
+		entry["index"] = index;
+		entry["authorized"] = account->sessionExists();
+		if (account->sessionExists()) {
+			const auto session = &account->session();
+			entry["account_id"] = QString::number(session->userId().bare);
+			entry["name"] = session->user()->name();
+			entry["is_primary"] = (session == _session);
+		}
+		accounts.append(entry);
+	}
+
+	QJsonObject result;
+	result["accounts"] = accounts;
+	result["count"] = accounts.size();
+	return result;
+}
+
+QJsonObject Server::toolGetMessages(const QJsonObject &args) {
+	QJsonObject result;
+	const auto requested = args["messages"].toArray();
+	if (requested.isEmpty() || requested.size() > kMaxMessagesPerCall) {
+		result["success"] = false;
+		result["error"] = QString("messages must hold 1 to %1 pairs").arg(
+			kMaxMessagesPerCall);
+		return result;
+	}
+	const auto fetchMissing = args.value("fetch_missing").toBool(true);
+
+	struct Wanted {
+		qint64 chatId = 0;
+		qint64 messageId = 0;
+		QJsonObject message;
+	};
+	auto wanted = std::vector<Wanted>();
+	wanted.reserve(requested.size());
+	for (const auto &value : requested) {
+		const auto pair = value.toObject();
+		wanted.push_back({
+			.chatId = pair["chat_id"].toVariant().toLongLong(),
+			.messageId = pair["message_id"].toVariant().toLongLong(),
+		});
+	}
+	const auto pairJson = [](qint64 chatId, qint64 messageId) {
+		return QJsonObject{
+			{"chat_id", QString::number(chatId)},
+			{"message_id", QString::number(messageId)},
+		};
+	};
+
+	// Loaded messages first.
+	auto liveCount = 0;
+	if (callSession()) {
+		for (auto &entry : wanted) {
+			const auto item = callSession()->data().message(
+				PeerId(entry.chatId),
+				MsgId(entry.messageId));
+			if (item) {
+				entry.message = LoadedMessageJson(item, "live");
+				entry.message["chat_id"] = QString::number(entry.chatId);
+				++liveCount;
 			}
+		}
+	}
 
-			if (found > 0) {
-				QJsonObject result;
-				result["results"] = results;
-				result["count"] = results.size();
-				result["query"] = query;
-				result["chat_id"] = chatId;
-				result["source"] = "live_search";
+	// Then one archive lookup per chat for the rest.
+	auto left = base::flat_map<qint64, std::vector<qint64>>();
+	for (const auto &entry : wanted) {
+		if (entry.message.isEmpty()) {
+			left[entry.chatId].push_back(entry.messageId);
+		}
+	}
+	auto archivedCount = 0;
+	if (_archiver && _archiver->isRunning()) {
+		for (auto &[chatId, ids] : left) {
+			auto rows = QHash<qint64, QJsonObject>();
+			for (const auto &row : _archiver->getMessagesById(chatId, ids)) {
+				auto message = row.toObject();
+				message["source"] = "archive";
+				message["chat_id"] = QString::number(chatId);
+				rows.insert(
+					message["message_id"].toVariant().toLongLong(),
+					message);
+			}
+			if (rows.isEmpty()) {
+				continue;
+			}
+			for (auto &entry : wanted) {
+				if (entry.chatId == chatId && entry.message.isEmpty()) {
+					entry.message = rows.value(entry.messageId);
+					archivedCount += entry.message.isEmpty() ? 0 : 1;
+				}
+			}
+			ids.erase(ranges::remove_if(ids, [&](qint64 id) {
+				return rows.contains(id);
+			}), end(ids));
+		}
+	}
 
-				qInfo() << "MCP: Found" << found << "messages in live search for:" << query;
-				return result;
+	// The rest is requested from the server, ApiWrap sends the ids of
+	// a short window in one request per channel and one for the others.
+	auto messages = QJsonArray();
+	for (const auto &entry : wanted) {
+		if (!entry.message.isEmpty()) {
+			messages.append(entry.message);
+		}
+	}
+	auto missing = QJsonArray();
+	auto fetching = std::vector<FullMsgId>();
+	for (const auto &[chatId, ids] : left) {
+		const auto peer = (callSession() && fetchMissing)
+			? callSession()->data().peerLoaded(PeerId(chatId))
+			: nullptr;
+		for (const auto id : ids) {
+			if (peer) {
+				fetching.push_back(FullMsgId(peer->id, MsgId(id)));
+			} else {
+				missing.append(pairJson(chatId, id));
 			}
 		}
 	}
+	if (!fetching.empty()) {
+		const auto requestId = QString::number(++_hydrateCounter);
+		const auto weak = base::make_weak(callSession());
+		const auto waiting = std::make_shared<int>(int(fetching.size()));
+		const auto done = [=] {
+			const auto session = weak.get();
+			if (--*waiting || !session) {
+				return;
+			}
+			auto fetched = QJsonArray();
+			auto notFound = QJsonArray();
+			for (const auto &id : fetching) {
+				const auto chatId = qint64(id.peer.value);
+				if (const auto item = session->data().message(id)) {
+					auto message = LoadedMessageJson(item, "cloud");
+					message["chat_id"] = QString::number(chatId);
+					fetched.append(message);
+				} else {
+					notFound.append(pairJson(chatId, id.msg.bare));
+				}
+			}
+			sendNotification("notifications/messages_fetched", QJsonObject{
+				{"request_id", requestId},
+				{"messages", fetched},
+				{"missing", notFound},
+			});
+		};
+		for (const auto &id : fetching) {
+			callSession()->api().requestMessageData(
+				callSession()->data().peer(id.peer),
+				id.msg,
+				done);
+		}
+		result["request_id"] = requestId;
+		result["fetch_pending"] = int(fetching.size());
+	}
 
-	// Fallback to archived data search (more comprehensive, uses FTS)
-	if (_archiver) {
-		results = _archiver->searchMessages(chatId, query, limit);
+	result["success"] = true;
+	result["messages"] = messages;
+	result["count"] = messages.size();
+	result["live_count"] = liveCount;
+	result["archived_count"] = archivedCount;
+	result["missing"] = missing;
+	return result;
+}
+
+QJsonObject Server::toolGetUpdates(const QJsonObject &args) {
+	QJsonObject result;
+	if (!_changeLog || !_changeLog->isRunning()) {
+		result["success"] = false;
+		result["error"] = "Change log is not available";
+		return result;
+	}
+	const auto cursor = QString::number(_changeLog->cursor());
+	if (!args.contains("since_cursor")) {
+		result["success"] = true;
+		result["cursor"] = cursor;
+		return result;
+	}
+	auto ok = false;
+	const auto since = args["since_cursor"].toVariant().toULongLong(&ok);
+	const auto limit = std::clamp(
+		args.value("limit").toInt(kDefaultUpdatesLimit),
+		1,
+		kMaxUpdatesLimit);
+	auto expired = false;
+	const auto events = ok
+		? _changeLog->since(since, limit, expired)
+		: std::vector<ChangeEvent>();
+	if (!ok || expired) {
+		// Older changes were pruned, the client has to list again.
+		result["success"] = false;
+		result["cursor_expired"] = true;
+		result["error"] = "since_cursor is too old, list chats again and continue from cursor";
+		result["cursor"] = cursor;
+		return result;
+	}
+
+	// The last change of each message decides where it is reported, one
+	// created and edited since the cursor is only new.
+	using Kind = ChangeEvent::Kind;
+	auto messages = base::flat_map<std::pair<qint64, qint64>, Kind>();
+	auto peers = base::flat_set<qint64>();
+	for (const auto &event : events) {
+		if (event.kind == Kind::Peer) {
+			peers.emplace(event.chatId);
+			continue;
+		}
+		const auto key = std::make_pair(event.chatId, event.messageId);
+		const auto i = messages.find(key);
+		if (i == end(messages)) {
+			messages.emplace(key, event.kind);
+		} else if (event.kind == Kind::DeletedMessage
+			|| i->second != Kind::NewMessage) {
+			i->second = event.kind;
+		}
+	}
+
+	auto added = QJsonArray();
+	auto edited = QJsonArray();
+	auto deleted = QJsonArray();
+	for (const auto &[key, kind] : messages) {
+		const auto &[chatId, messageId] = key;
+		auto message = QJsonObject{
+			{"chat_id", QString::number(chatId)},
+			{"message_id", QString::number(messageId)},
+		};
+		if (kind == Kind::DeletedMessage) {
+			deleted.append(message);
+			continue;
+		}
+		const auto item = callSession()
+			? callSession()->data().message(PeerId(chatId), MsgId(messageId))
+			: nullptr;
+		if (item) {
+			message = LoadedMessageJson(item, "live");
+			message["chat_id"] = QString::number(chatId);
+		}
+		((kind == Kind::NewMessage) ? added : edited).append(message);
 	}
-
-	QJsonObject result;
-	result["results"] = results;
-	result["count"] = results.size();
-	result["query"] = query;
-	if (chatId != 0) {
-		result["chat_id"] = chatId;
+	auto changedPeers = QJsonArray();
+	for (const auto peerId : peers) {
+		const auto snapshot = _peerSnapshots
+			? _peerSnapshots->find(peerId)
+			: nullptr;
+		changedPeers.append(snapshot
+			? snapshot->json
+			: QJsonObject{{"id", QString::number(peerId)}});
 	}
-	result["source"] = _archiver ? "archived_search" : "no_archive_available";
 
+	const auto hasMore = (int(events.size()) == limit)
+		&& (events.back().sequence < _changeLog->cursor());
+	result["success"] = true;
+	result["cursor"] = events.empty()
+		? cursor
+		: QString::number(events.back().sequence);
+	result["has_more"] = hasMore;
+	result["new_messages"] = added;
+	result["edited_messages"] = edited;
+	result["deleted_messages"] = deleted;
+	result["peers"] = changedPeers;
+	result["changes"] = int(events.size());
 	return result;
 }
 
@@ -4215,13 +5693,13 @@ QJsonObject Server::toolGetUserInfo(const QJsonObject &args) {
 	QJsonObject userInfo;
 
 	// Try live data first if session is available
-	if (_session) {
+	if (callSession()) {
 		// Convert user_id to UserId and then PeerId
 		UserId uid(userId);
 		PeerId peerId = peerFromUser(uid);
 
 		// Get the peer data first
-		auto peer = _session->data().peer(peerId);
+		auto peer = callSession()->data().peer(peerId);
 		if (!peer) {
 			qWarning() << "MCP: Peer not found for" << userId;
 			userInfo["error"] = "User not found";
@@ -4238,6 +5716,19 @@ QJsonObject Server::toolGetUserInfo(const QJsonObject &args) {
 			return userInfo;
 		}
 
+		const auto snapshot = _peerSnapshots
+			? _peerSnapshots->find(peer)
+			: nullptr;
+		const auto since = args.value("since_version").toVariant();
+		if (snapshot && snapshot->version <= since.toULongLong()) {
+			userInfo["id"] = QString::number(snapshot->id);
+			userInfo["not_modified"] = true;
+			userInfo["version"] = QString::number(snapshot->version);
+			return userInfo;
+		} else if (snapshot) {
+			userInfo["version"] = QString::number(snapshot->version);
+		}
+
 		// Extract user information
 		userInfo["id"] = QString::number(user->id.value);
 		userInfo["name"] = user->name();
@@ -4310,8 +5801,11 @@ QJsonObject Server::toolArchiveChat(const QJsonObject &args) {
 	result["chat_id"] = chatId;
 	result["requested_limit"] = limit;
 
-	if (!success) {
-		result["error"] = "Failed to archive chat";
+	if (success) {
+		// The crawl pages in the background and survives restarts.
+		result["status"] = "queued";
+	} else {
+		result["error"] = "Failed to queue chat archive";
 	}
 
 	return result;
@@ -4335,13 +5829,30 @@ QJsonObject Server::toolExportChat(const QJsonObject &args) {
 		return error;
 	}
 
-	QString resultPath = _archiver->exportChat(chatId, exportFormat, outputPath);
+	auto options = ExportOptions();
+	options.compress = args["compress"].toBool(false);
+	options.maxMessages = std::max(args["limit"].toVariant().toLongLong(), 0LL);
+	options.after = ExportCursor::Parse(args["cursor"].toString());
+
+	const auto exported = _archiver->exportChat(
+		chatId,
+		exportFormat,
+		outputPath,
+		options);
 
 	QJsonObject result;
-	result["success"] = !resultPath.isEmpty();
+	result["success"] = exported.error.isEmpty();
 	result["chat_id"] = chatId;
 	result["format"] = format;
-	result["output_path"] = resultPath;
+	result["output_path"] = exported.path;
+	result["exported"] = exported.exported;
+	result["bytes_written"] = exported.bytesWritten;
+	result["complete"] = exported.complete;
+	if (!exported.error.isEmpty()) {
+		result["error"] = exported.error;
+	} else if (!exported.complete) {
+		result["cursor"] = exported.cursor.serialize();
+	}
 
 	return result;
 }
@@ -4465,9 +5976,14 @@ QJsonObject Server::toolSearchArchive(const QJsonObject &args) {
 	QJsonArray results = _archiver->searchMessages(chatId, query, limit);
 
 	QJsonObject result;
-	result["results"] = results;
+	WriteMessages(
+		result,
+		"results",
+		results,
+		MessageProjection::FromArguments(args));
 	result["count"] = results.size();
 	result["query"] = query;
+	result["ranking"] = _archiver->hasFullTextIndex() ? "bm25" : "recent";
 
 	return result;
 }
@@ -4486,6 +6002,116 @@ QJsonObject Server::toolPurgeArchive(const QJsonObject &args) {
 	return result;
 }
 
+QJsonObject Server::toolTierArchive(const QJsonObject &args) {
+	const auto olderThanDays = args["older_than_days"].toInt(-1);
+
+	if (!_archiver) {
+		QJsonObject error;
+		error["error"] = "Archiver not available";
+		return error;
+	}
+
+	const auto tiered = _archiver->moveToColdStorage(olderThanDays);
+
+	QJsonObject result;
+	result["success"] = tiered.error.isEmpty();
+	result["moved_messages"] = tiered.messages;
+	result["segments"] = tiered.segments;
+	result["compressed_bytes"] = tiered.bytes;
+	result["older_than_days"] = olderThanDays;
+	if (!tiered.error.isEmpty()) {
+		result["error"] = tiered.error;
+	}
+
+	return result;
+}
+
+QJsonObject Server::toolConfigureMediaArchive(const QJsonObject &args) {
+	const auto media = _archiver ? _archiver->mediaArchiver() : nullptr;
+	if (!media) {
+		QJsonObject error;
+		error["error"] = "Media archiver not available";
+		return error;
+	}
+
+	const auto chatId = args["chat_id"].toVariant().toLongLong();
+	const auto megabytes = [&](const char *key) {
+		return qint64(std::max(args[key].toDouble(0.), 0.) * 1024 * 1024);
+	};
+	auto policy = MediaArchivePolicy();
+	policy.enabled = args["enabled"].toBool();
+	policy.maxFileSize = megabytes("max_file_size_mb");
+	policy.maxChatBytes = megabytes("max_chat_mb");
+	for (const auto &type : args["types"].toArray()) {
+		policy.types.push_back(type.toString());
+	}
+	media->setPolicy(chatId, policy);
+	if (args.contains("rate_kbps")) {
+		media->setRate(qint64(std::max(args["rate_kbps"].toDouble(), 0.) * 1024));
+	}
+
+	QJsonObject result = media->status();
+	result["success"] = true;
+	result["chat_id"] = QString::number(chatId);
+	return result;
+}
+
+QJsonObject Server::toolGetMediaArchiveStatus(const QJsonObject &args) {
+	Q_UNUSED(args);
+
+	const auto media = _archiver ? _archiver->mediaArchiver() : nullptr;
+	if (!media) {
+		QJsonObject error;
+		error["error"] = "Media archiver not available";
+		return error;
+	}
+	return media->status();
+}
+
+QJsonObject Server::toolGetChatMembers(const QJsonObject &args) {
+	const auto cache = _archiver ? _archiver->participantCache() : nullptr;
+	if (!cache) {
+		QJsonObject error;
+		error["error"] = "Participant cache not available";
+		return error;
+	}
+
+	auto query = ParticipantCache::Query();
+	query.channelId = args["chat_id"].toVariant().toLongLong();
+	query.type = args["type"].toString();
+	query.offset = args["offset"].toInt(0);
+	query.limit = args["limit"].toInt(100);
+	if (args["refresh"].toBool()) {
+		const auto peer = callSession()
+			? callSession()->data().peerLoaded(PeerId(query.channelId))
+			: nullptr;
+		if (const auto channel = peer ? peer->asChannel() : nullptr) {
+			cache->refresh(channel);
+		}
+	}
+	return cache->query(query);
+}
+
+QJsonObject Server::toolSearchChatMembers(const QJsonObject &args) {
+	const auto cache = _archiver ? _archiver->participantCache() : nullptr;
+	if (!cache) {
+		QJsonObject error;
+		error["error"] = "Participant cache not available";
+		return error;
+	}
+
+	auto query = ParticipantCache::Query();
+	query.channelId = args["chat_id"].toVariant().toLongLong();
+	query.search = args["query"].toString();
+	query.limit = args["limit"].toInt(20);
+	if (query.search.trimmed().isEmpty()) {
+		QJsonObject error;
+		error["error"] = "Empty query";
+		return error;
+	}
+	return cache->query(query);
+}
+
 // ===== ANALYTICS TOOL IMPLEMENTATIONS =====
 
 QJsonObject Server::toolGetMessageStats(const QJsonObject &args) {
@@ -4654,6 +6280,203 @@ QJsonObject Server::toolGetTrends(const QJsonObject &args) {
 	return result;
 }
 
+QJsonObject Server::toolRebuildAnalytics(const QJsonObject &args) {
+	const auto chatId = args["chat_id"].toVariant().toLongLong();
+
+	if (!_archiver) {
+		QJsonObject error;
+		error["error"] = "Archiver not available";
+		return error;
+	}
+
+	const auto rebuilt = _archiver->rebuildAnalytics(chatId);
+	if (rebuilt && _analytics) {
+		_analytics->clearCache();
+	}
+
+	QJsonObject result;
+	result["success"] = rebuilt;
+	result["chat_id"] = QString::number(chatId);
+	return result;
+}
+
+QJsonObject Server::toolGetUniqueUsers(const QJsonObject &args) {
+	const auto chatId = args.value("chat_id").toVariant().toLongLong();
+	const auto daysBack = args.value("days_back").toInt(90);
+	const auto limit = args.value("limit").toInt(10);
+
+	if (!_analytics) {
+		QJsonObject result;
+		result["error"] = "Analytics not available";
+		result["chat_id"] = QString::number(chatId);
+		return result;
+	}
+
+	return _analytics->getUniqueUsers(chatId, daysBack, limit);
+}
+
+struct Server::StatisticsRequest {
+	std::unique_ptr<Api::Statistics> api;
+	rpl::lifetime lifetime;
+	QString error;
+};
+
+namespace {
+
+[[nodiscard]] QJsonObject SerializeStatisticalValue(
+		const Data::StatisticalValue &value) {
+	return QJsonObject{
+		{"value", value.value},
+		{"previous", value.previousValue},
+		{"growth_percentage", value.growthRatePercentage},
+	};
+}
+
+[[nodiscard]] QJsonValue SerializeStatisticalGraph(
+		const Data::StatisticalGraph &graph) {
+	const auto &chart = graph.chart;
+	if (!chart) {
+		// Graphs given only by a token are loaded on demand, skip them.
+		return QJsonValue();
+	}
+	auto x = QJsonArray();
+	for (const auto value : chart.x) {
+		x.append(qint64(value / 1000.)); // Milliseconds in the chart.
+	}
+	auto lines = QJsonArray();
+	for (const auto &line : chart.lines) {
+		auto y = QJsonArray();
+		for (const auto value : line.y) {
+			y.append(qint64(value));
+		}
+		lines.append(QJsonObject{
+			{"name", line.name},
+			{"y", y},
+		});
+	}
+	return QJsonObject{
+		{"x", x},
+		{"lines", lines},
+	};
+}
+
+} // namespace
+
+QJsonObject Server::toolGetChannelStatistics(const QJsonObject &args) {
+	QJsonObject result;
+	const auto chatId = args["chat_id"].toVariant().toLongLong();
+	const auto includeGraphs = args.value("include_graphs").toBool(false);
+	result["chat_id"] = QString::number(chatId);
+
+	if (!callSession()) {
+		result["success"] = false;
+		result["error"] = "Session not available";
+		return result;
+	}
+	const auto peer = callSession()->data().peerLoaded(PeerId(chatId));
+	const auto channel = peer ? peer->asChannel() : nullptr;
+	if (!channel) {
+		result["success"] = false;
+		result["error"] = "Channel not found";
+		return result;
+	} else if (!(channel->flags() & ChannelDataFlag::CanGetStatistics)) {
+		result["success"] = false;
+		result["error"] = "Statistics are not available for this chat";
+		return result;
+	}
+
+	// Api::Statistics keeps the received statistics for a few minutes,
+	// so the repeated calls of an agent don't hit the stats.* flood limits.
+	const auto cached = Api::Statistics::Cached(channel);
+	if (!cached) {
+		const auto i = _statisticsRequests.find(chatId);
+		if (i != _statisticsRequests.end() && !(*i)->error.isEmpty()) {
+			result["success"] = false;
+			result["error"] = (*i)->error;
+			_statisticsRequests.erase(i);
+			return result;
+		} else if (i == _statisticsRequests.end()) {
+			const auto request = std::make_shared<StatisticsRequest>();
+			request->api = std::make_unique<Api::Statistics>(channel);
+			_statisticsRequests.insert(chatId, request);
+			const auto weak = std::weak_ptr<StatisticsRequest>(request);
+			request->api->request(
+			) | rpl::start_with_error_done([=](const QString &error) {
+				if (const auto strong = weak.lock()) {
+					strong->error = error;
+				}
+			}, [=] {
+				// The result is in the Api::Statistics cache now.
+				crl::on_main(this, [=] {
+					const auto j = _statisticsRequests.find(chatId);
+					if (j != _statisticsRequests.end() && (*j)->error.isEmpty()) {
+						_statisticsRequests.erase(j);
+					}
+				});
+			}, request->lifetime);
+		}
+		result["success"] = true;
+		result["status"] = "loading";
+		result["note"] = "Statistics are being requested, call again to get them";
+		return result;
+	}
+
+	const auto graph = [&](const Data::StatisticalGraph &graph) {
+		return includeGraphs ? SerializeStatisticalGraph(graph) : QJsonValue();
+	};
+	auto stats = QJsonObject();
+	auto graphs = QJsonObject();
+	const auto addGraph = [&](const char *name, const Data::StatisticalGraph &value) {
+		if (const auto serialized = graph(value); !serialized.isNull()) {
+			graphs[name] = serialized;
+		}
+	};
+	if (const auto &data = cached->channel) {
+		result["type"] = "channel";
+		result["start_date"] = data.startDate;
+		result["end_date"] = data.endDate;
+		stats["member_count"] = SerializeStatisticalValue(data.memberCount);
+		stats["mean_view_count"] = SerializeStatisticalValue(data.meanViewCount);
+		stats["mean_share_count"] = SerializeStatisticalValue(data.meanShareCount);
+		stats["mean_reaction_count"] = SerializeStatisticalValue(data.meanReactionCount);
+		stats["mean_story_view_count"] = SerializeStatisticalValue(data.meanStoryViewCount);
+		stats["mean_story_share_count"] = SerializeStatisticalValue(data.meanStoryShareCount);
+		stats["mean_story_reaction_count"] = SerializeStatisticalValue(data.meanStoryReactionCount);
+		stats["enabled_notifications_percentage"] = data.enabledNotificationsPercentage;
+		addGraph("member_count", data.memberCountGraph);
+		addGraph("joins", data.joinGraph);
+		addGraph("mutes", data.muteGraph);
+		addGraph("views_by_hour", data.viewCountByHourGraph);
+		addGraph("views_by_source", data.viewCountBySourceGraph);
+	} else if (const auto &data = cached->supergroup) {
+		result["type"] = "supergroup";
+		result["start_date"] = data.startDate;
+		result["end_date"] = data.endDate;
+		stats["member_count"] = SerializeStatisticalValue(data.memberCount);
+		stats["message_count"] = SerializeStatisticalValue(data.messageCount);
+		stats["viewer_count"] = SerializeStatisticalValue(data.viewerCount);
+		stats["sender_count"] = SerializeStatisticalValue(data.senderCount);
+		addGraph("member_count", data.memberCountGraph);
+		addGraph("joins", data.joinGraph);
+		addGraph("joins_by_source", data.joinBySourceGraph);
+		addGraph("languages", data.languageGraph);
+		addGraph("message_content", data.messageContentGraph);
+		addGraph("actions", data.actionGraph);
+		addGraph("days", data.dayGraph);
+		addGraph("weeks", data.weekGraph);
+	} else {
+		result["success"] = false;
+		result["error"] = "Statistics are empty";
+		return result;
+	}
+	result["success"] = true;
+	result["statistics"] = stats;
+	if (includeGraphs) {
+		result["graphs"] = graphs;
+	}
+	return result;
+}
+
 // ===== SEMANTIC SEARCH TOOL IMPLEMENTATIONS =====
 
 QJsonObject Server::toolSemanticSearch(const QJsonObject &args) {
@@ -4685,11 +6508,117 @@ QJsonObject Server::toolSemanticSearch(const QJsonObject &args) {
 	result["query"] = query;
 	result["results"] = matches;
 	result["count"] = matches.size();
+	result["model"] = _semanticSearch->modelName();
+
+	return result;
+}
+
+QJsonObject Server::toolHybridSearch(const QJsonObject &args) {
+	const auto query = args["query"].toString();
+
+	auto options = HybridSearchOptions();
+	options.filter.chatId = args.value("chat_id").toVariant().toLongLong();
+	options.filter.userId = args.value("user_id").toVariant().toLongLong();
+	options.filter.after = args.value("start_date").toVariant().toLongLong();
+	options.filter.before = args.value("end_date").toVariant().toLongLong();
+	options.limit = args.value("limit").toInt(20);
+	options.minSimilarity = args.value("min_similarity").toDouble(0.3);
+
+	QJsonObject result;
+	result["query"] = query;
+	if (!_semanticSearch) {
+		result["error"] = "Semantic search not available";
+		return result;
+	}
+
+	QJsonArray matches;
+	for (const auto &found : _semanticSearch->hybridSearch(query, options)) {
+		auto match = found.messageData;
+		match["content"] = found.content;
+		match["score"] = found.score;
+		if (found.semanticRank) {
+			match["similarity"] = found.similarity;
+			match["semantic_rank"] = found.semanticRank;
+		}
+		if (found.lexicalRank) {
+			match["lexical_rank"] = found.lexicalRank;
+			if (!found.snippet.isEmpty()) {
+				match["snippet"] = found.snippet;
+			}
+		}
+		matches.append(match);
+	}
+	result["results"] = matches;
+	result["count"] = matches.size();
+	result["ranking"] = "rrf";
+	result["model"] = _semanticSearch->modelName();
+
+	return result;
+}
+
+QJsonObject Server::toolGetChatContext(const QJsonObject &args) {
+	const auto chatId = args["chat_id"].toVariant().toLongLong();
+	const auto limit = args.value("limit").toInt(0);
+
+	QJsonObject result;
+	result["chat_id"] = QString::number(chatId);
+	if (!_contextBuilder) {
+		result["error"] = "Session not available";
+		return result;
+	}
+	const auto context = _contextBuilder->track(chatId);
+	if (!context) {
+		result["error"] = "Chat context not available";
+		return result;
+	}
 
+	const auto &messages = context->messages;
+	const auto from = (limit > 0)
+		? std::max(int(messages.size()) - limit, 0)
+		: 0;
+	QJsonArray window;
+	for (auto i = from; i != int(messages.size()); ++i) {
+		const auto &entry = messages[i];
+		window.append(QJsonObject{
+			{"message_id", entry.messageId},
+			{"from_id", QString::number(entry.senderId)},
+			{"from_name", entry.sender},
+			{"text", entry.text},
+			{"date", entry.date},
+			{"outgoing", entry.outgoing},
+			{"tokens", int(entry.tokens.size())},
+		});
+	}
+	QJsonArray related;
+	for (const auto &hit : context->related) {
+		related.append(QJsonObject{
+			{"chat_id", QString::number(hit.chatId)},
+			{"message_id", hit.messageId},
+			{"username", hit.username},
+			{"snippet", hit.snippet},
+			{"timestamp", hit.timestamp},
+			{"score", hit.score},
+		});
+	}
+	result["messages"] = window;
+	result["count"] = window.size();
+	result["token_count"] = context->tokenCount;
+	result["terms"] = QJsonArray::fromStringList(context->terms);
+	result["related"] = related;
+	result["related_terms"] = QJsonArray::fromStringList(context->relatedTerms);
+	result["related_pending"] = (context->terms != context->relatedTerms);
+	result["revision"] = context->revision;
+	result["builder"] = _contextBuilder->stats();
 	return result;
 }
 
 QJsonObject Server::toolIndexMessages(const QJsonObject &args) {
+	return indexMessages(args, IndexingObserver());
+}
+
+QJsonObject Server::indexMessages(
+		const QJsonObject &args,
+		const IndexingObserver &observer) {
 	qint64 chatId = args["chat_id"].toVariant().toLongLong();
 	int limit = args.value("limit").toInt(1000);
 	bool rebuild = args.value("rebuild").toBool(false);
@@ -4714,78 +6643,73 @@ QJsonObject Server::toolIndexMessages(const QJsonObject &args) {
 
 	// If rebuild, clear existing index for this chat
 	if (rebuild) {
-		QSqlQuery clearQuery(_db);
-		clearQuery.prepare("DELETE FROM message_fts WHERE chat_id = ?");
-		clearQuery.addBindValue(QString::number(chatId));
-		clearQuery.exec();
+		auto clearQuery = PreparedQuery(_db, "DELETE FROM message_fts WHERE chat_id = ?");
+		clearQuery->addBindValue(QString::number(chatId));
+		clearQuery->exec();
 	}
 
-	// Note: Full message iteration through history->blocks() requires complex API
-	// integration. For now, we set up the FTS infrastructure and return status.
-	// Messages can be indexed incrementally as they are accessed through other tools.
-
-	result["success"] = true;
 	result["table_ready"] = tableCreated;
-	result["method"] = "sqlite_fts5";
-	result["note"] = "FTS5 table created. Use search_messages for full-text search. "
-		"Incremental indexing happens as messages are retrieved via read_messages tool.";
+
+	// Embeddings of archived messages are computed in batches on the
+	// semantic indexer thread, this only queues the work.
+	if (!_semanticSearch || !_semanticSearch->isReady()) {
+		result["success"] = false;
+		result["error"] = "Semantic search not available";
+		return result;
+	}
+	const auto queued = _semanticSearch->indexChat(
+		chatId,
+		limit,
+		rebuild,
+		observer);
+	result["success"] = queued;
+	result["queued"] = queued;
+	result["embedding_model"] = _semanticSearch->modelName();
+	result["indexed_messages"] = _semanticSearch->getIndexedMessageCount();
+	result["note"] = "Indexing runs in the background, "
+		"indexed_messages grows as batches are stored.";
 
 	return result;
 }
 
 QJsonObject Server::toolDetectTopics(const QJsonObject &args) {
 	qint64 chatId = args["chat_id"].toVariant().toLongLong();
-	int numTopics = args.value("num_topics").toInt(5);
-	int messageLimit = args.value("message_limit").toInt(500);
+	int numTopics = std::clamp(args.value("num_topics").toInt(5), 1, 100);
+	const auto startDate = args.value("start_date").toVariant().toLongLong();
+	const auto endDate = args.value("end_date").toVariant().toLongLong();
+	const auto retrain = args.value("retrain").toBool(false);
 
 	QJsonObject result;
 	result["chat_id"] = chatId;
 	result["requested_topics"] = numTopics;
 
-	// Common stop words to filter out
-	static const QSet<QString> stopWords = {
-		"the", "a", "an", "and", "or", "but", "in", "on", "at", "to", "for",
-		"of", "with", "by", "from", "is", "are", "was", "were", "be", "been",
-		"being", "have", "has", "had", "do", "does", "did", "will", "would",
-		"could", "should", "may", "might", "must", "shall", "can", "need",
-		"this", "that", "these", "those", "it", "its", "i", "you", "he", "she",
-		"we", "they", "me", "him", "her", "us", "them", "my", "your", "his",
-		"our", "their", "what", "which", "who", "whom", "when", "where", "why",
-		"how", "all", "each", "every", "both", "few", "more", "most", "other",
-		"some", "such", "no", "not", "only", "same", "so", "than", "too",
-		"very", "just", "also", "now", "here", "there", "then", "about"
-	};
-
-	// Note: Full message iteration through history->blocks() requires complex API
-	// integration. Topic detection will use the FTS index when available.
-
-	// Check if FTS table exists and has data for this chat
-	QSqlQuery checkQuery(_db);
-	checkQuery.prepare("SELECT COUNT(*) FROM message_fts WHERE chat_id = ?");
-	checkQuery.addBindValue(QString::number(chatId));
-
-	int indexedCount = 0;
-	if (checkQuery.exec() && checkQuery.next()) {
-		indexedCount = checkQuery.value(0).toInt();
+	if (!_semanticSearch || !_semanticSearch->isReady()) {
+		result["success"] = false;
+		result["error"] = "Semantic search not available";
+		return result;
 	}
 
-	QJsonArray topics;
-
-	if (indexedCount > 0) {
-		// Use FTS index for topic analysis (placeholder for actual implementation)
-		result["indexed_messages"] = indexedCount;
-		result["note"] = "FTS index available. Topic detection can analyze indexed messages.";
-	} else {
-		result["indexed_messages"] = 0;
-		result["note"] = "No indexed messages for this chat. Use semantic_index_messages first "
+	// Topics are trained on the chat's stored embeddings once and kept
+	// up to date as new messages are indexed, so a refresh is mostly a
+	// matter of reading the stored clusters back.
+	const auto topics = _semanticSearch->detectTopics(
+		chatId,
+		numTopics,
+		startDate ? QDateTime::fromSecsSinceEpoch(startDate) : QDateTime(),
+		endDate ? QDateTime::fromSecsSinceEpoch(endDate) : QDateTime(),
+		retrain);
+	const auto exported = _semanticSearch->exportClusters(topics);
+
+	result["success"] = true;
+	result["topics"] = exported["topics"];
+	result["method"] = "minibatch_kmeans";
+	result["embedding_model"] = _semanticSearch->modelName();
+	result["status"] = topics.isEmpty() ? "needs_indexing" : "ready";
+	if (topics.isEmpty()) {
+		result["note"] = "No embedded messages for this chat. Use index_messages first "
 			"to enable topic detection.";
 	}
 
-	result["success"] = true;
-	result["topics"] = topics;
-	result["method"] = "keyword_frequency";
-	result["status"] = indexedCount > 0 ? "ready" : "needs_indexing";
-
 	return result;
 }
 
@@ -4799,24 +6723,15 @@ QJsonObject Server::toolClassifyIntent(const QJsonObject &args) {
 		return result;
 	}
 
-	SearchIntent intent = _semanticSearch->classifyIntent(text);
-
-	QString intentStr;
-	switch (intent) {
-		case SearchIntent::Question: intentStr = "question"; break;
-		case SearchIntent::Answer: intentStr = "answer"; break;
-		case SearchIntent::Statement: intentStr = "statement"; break;
-		case SearchIntent::Command: intentStr = "command"; break;
-		case SearchIntent::Greeting: intentStr = "greeting"; break;
-		case SearchIntent::Farewell: intentStr = "farewell"; break;
-		case SearchIntent::Agreement: intentStr = "agreement"; break;
-		case SearchIntent::Disagreement: intentStr = "disagreement"; break;
-		default: intentStr = "other"; break;
+	// A chat_id instead of text classifies every archived message in it.
+	if (args.contains("chat_id") && !args.contains("text")) {
+		return _semanticSearch->getIntentDistribution(
+			args["chat_id"].toVariant().toLongLong());
 	}
 
 	QJsonObject result;
 	result["text"] = text;
-	result["intent"] = intentStr;
+	result["intent"] = SearchIntentName(_semanticSearch->classifyIntent(text));
 
 	return result;
 }
@@ -4831,26 +6746,17 @@ QJsonObject Server::toolExtractEntities(const QJsonObject &args) {
 		return result;
 	}
 
+	if (args.contains("chat_id") && !args.contains("text")) {
+		return _semanticSearch->getEntityStatistics(
+			args["chat_id"].toVariant().toLongLong());
+	}
+
 	auto entities = _semanticSearch->extractEntities(text);
 
 	QJsonArray entitiesArray;
 	for (const auto &entity : entities) {
 		QJsonObject e;
-
-		QString typeStr;
-		switch (entity.type) {
-			case EntityType::UserMention: typeStr = "user_mention"; break;
-			case EntityType::ChatMention: typeStr = "chat_mention"; break;
-			case EntityType::URL: typeStr = "url"; break;
-			case EntityType::Email: typeStr = "email"; break;
-			case EntityType::PhoneNumber: typeStr = "phone_number"; break;
-			case EntityType::Hashtag: typeStr = "hashtag"; break;
-			case EntityType::BotCommand: typeStr = "bot_command"; break;
-			case EntityType::CustomEmoji: typeStr = "custom_emoji"; break;
-			default: typeStr = "unknown"; break;
-		}
-
-		e["type"] = typeStr;
+		e["type"] = EntityTypeName(entity.type);
 		e["text"] = entity.text;
 		e["offset"] = entity.offset;
 		e["length"] = entity.length;
@@ -4868,7 +6774,7 @@ QJsonObject Server::toolExtractEntities(const QJsonObject &args) {
 // ===== MESSAGE OPERATION TOOL IMPLEMENTATIONS =====
 
 QJsonObject Server::toolEditMessage(const QJsonObject &args) {
-	if (!_session) {
+	if (!callSession()) {
 		QJsonObject error;
 		error["success"] = false;
 		error["error"] = "Session not available";
@@ -4884,7 +6790,7 @@ QJsonObject Server::toolEditMessage(const QJsonObject &args) {
 	result["message_id"] = messageId;
 
 	// Get the message
-	auto &owner = _session->data();
+	auto &owner = callSession()->data();
 	const auto peerId = PeerId(chatId);
 	const auto history = owner.historyLoaded(peerId);
 	if (!history) {
@@ -4936,7 +6842,7 @@ QJsonObject Server::toolEditMessage(const QJsonObject &args) {
 }
 
 QJsonObject Server::toolDeleteMessage(const QJsonObject &args) {
-	if (!_session) {
+	if (!callSession()) {
 		QJsonObject error;
 		error["success"] = false;
 		error["error"] = "Session not available";
@@ -4952,7 +6858,7 @@ QJsonObject Server::toolDeleteMessage(const QJsonObject &args) {
 	result["message_id"] = messageId;
 
 	// Get the history
-	auto &owner = _session->data();
+	auto &owner = callSession()->data();
 	const auto peerId = PeerId(chatId);
 	const auto history = owner.historyLoaded(peerId);
 	if (!history) {
@@ -4974,8 +6880,8 @@ QJsonObject Server::toolDeleteMessage(const QJsonObject &args) {
 	MessageIdsList ids = { item->fullId() };
 
 	// Delete via session's histories manager
-	_session->data().histories().deleteMessages(ids, revoke);
-	_session->data().sendHistoryChangeNotifications();
+	callSession()->data().histories().deleteMessages(ids, revoke);
+	callSession()->data().sendHistoryChangeNotifications();
 
 	result["success"] = true;
 	result["revoked"] = revoke;
@@ -4985,7 +6891,7 @@ QJsonObject Server::toolDeleteMessage(const QJsonObject &args) {
 }
 
 QJsonObject Server::toolForwardMessage(const QJsonObject &args) {
-	if (!_session) {
+	if (!callSession()) {
 		QJsonObject error;
 		error["success"] = false;
 		error["error"] = "Session not available";
@@ -5002,7 +6908,7 @@ QJsonObject Server::toolForwardMessage(const QJsonObject &args) {
 	result["message_id"] = messageId;
 
 	// Get source message
-	auto &owner = _session->data();
+	auto &owner = callSession()->data();
 	const auto fromPeerId = PeerId(fromChatId);
 	const auto fromHistory = owner.historyLoaded(fromPeerId);
 	if (!fromHistory) {
@@ -5029,7 +6935,7 @@ QJsonObject Server::toolForwardMessage(const QJsonObject &args) {
 
 	// Forward the message
 	// Get destination history
-	auto toHistory = _session->data().history(toPeerId);
+	auto toHistory = callSession()->data().history(toPeerId);
 	if (!toHistory) {
 		result["success"] = false;
 		result["error"] = "Failed to get destination history";
@@ -5051,7 +6957,7 @@ QJsonObject Server::toolForwardMessage(const QJsonObject &args) {
 	Api::SendAction action(thread, Api::SendOptions());
 
 	// Forward via session API
-	auto &api = _session->api();
+	auto &api = callSession()->api();
 	api.forwardMessages(std::move(draft), action);
 
 	result["success"] = true;
@@ -5062,7 +6968,7 @@ QJsonObject Server::toolForwardMessage(const QJsonObject &args) {
 }
 
 QJsonObject Server::toolPinMessage(const QJsonObject &args) {
-	if (!_session) {
+	if (!callSession()) {
 		QJsonObject error;
 		error["success"] = false;
 		error["error"] = "Session not available";
@@ -5078,7 +6984,7 @@ QJsonObject Server::toolPinMessage(const QJsonObject &args) {
 	result["message_id"] = messageId;
 
 	// Get the message
-	auto &owner = _session->data();
+	auto &owner = callSession()->data();
 	const auto peerId = PeerId(chatId);
 	const auto history = owner.historyLoaded(peerId);
 	if (!history) {
@@ -5112,7 +7018,7 @@ QJsonObject Server::toolPinMessage(const QJsonObject &args) {
 
 	// Pin via API
 	// Use the session's API to pin the message
-	auto &api = _session->api();
+	auto &api = callSession()->api();
 
 	// Request message pin (notify parameter controls silent pinning)
 	// Using the peer's pinMessage method through API
@@ -5121,7 +7027,7 @@ QJsonObject Server::toolPinMessage(const QJsonObject &args) {
 		peer->input,
 		MTP_int(messageId)
 	)).done([=](const MTPUpdates &result) {
-		_session->api().applyUpdates(result);
+		callSession()->api().applyUpdates(result);
 	}).fail([=](const MTP::Error &error) {
 		qWarning() << "MCP: Pin message failed:" << error.type();
 	}).send();
@@ -5135,7 +7041,7 @@ QJsonObject Server::toolPinMessage(const QJsonObject &args) {
 }
 
 QJsonObject Server::toolUnpinMessage(const QJsonObject &args) {
-	if (!_session) {
+	if (!callSession()) {
 		QJsonObject error;
 		error["success"] = false;
 		error["error"] = "Session not available";
@@ -5150,7 +7056,7 @@ QJsonObject Server::toolUnpinMessage(const QJsonObject &args) {
 	result["message_id"] = messageId;
 
 	// Get the peer
-	auto &owner = _session->data();
+	auto &owner = callSession()->data();
 	const auto peerId = PeerId(chatId);
 	const auto peer = owner.peer(peerId);
 	if (!peer) {
@@ -5176,7 +7082,7 @@ QJsonObject Server::toolUnpinMessage(const QJsonObject &args) {
 
 	// Unpin via API
 	// Use the session's API to unpin the message
-	auto &api = _session->api();
+	auto &api = callSession()->api();
 
 	// Request message unpin (using the same API as pin with unpin flag)
 	api.request(MTPmessages_UpdatePinnedMessage(
@@ -5184,7 +7090,7 @@ QJsonObject Server::toolUnpinMessage(const QJsonObject &args) {
 		peer->input,
 		MTP_int(messageId)
 	)).done([=](const MTPUpdates &result) {
-		_session->api().applyUpdates(result);
+		callSession()->api().applyUpdates(result);
 	}).fail([=](const MTP::Error &error) {
 		qWarning() << "MCP: Unpin message failed:" << error.type();
 	}).send();
@@ -5197,7 +7103,7 @@ QJsonObject Server::toolUnpinMessage(const QJsonObject &args) {
 }
 
 QJsonObject Server::toolAddReaction(const QJsonObject &args) {
-	if (!_session) {
+	if (!callSession()) {
 		QJsonObject error;
 		error["success"] = false;
 		error["error"] = "Session not available";
@@ -5214,7 +7120,7 @@ QJsonObject Server::toolAddReaction(const QJsonObject &args) {
 	result["emoji"] = emoji;
 
 	// Get the message
-	auto &owner = _session->data();
+	auto &owner = callSession()->data();
 	const auto peerId = PeerId(chatId);
 	const auto history = owner.historyLoaded(peerId);
 	if (!history) {
@@ -5256,7 +7162,7 @@ QJsonObject Server::toolAddReaction(const QJsonObject &args) {
 // ===== BATCH OPERATION TOOL IMPLEMENTATIONS =====
 
 QJsonObject Server::toolBatchSend(const QJsonObject &args) {
-	if (!_session) {
+	if (!callSession()) {
 		QJsonObject error;
 		error["success"] = false;
 		error["error"] = "Session not available";
@@ -5312,7 +7218,7 @@ QJsonObject Server::toolBatchSend(const QJsonObject &args) {
 }
 
 QJsonObject Server::toolBatchDelete(const QJsonObject &args) {
-	if (!_session) {
+	if (!callSession() || !_batchOps || !_batchOps->isRunning()) {
 		QJsonObject error;
 		error["success"] = false;
 		error["error"] = "Session not available";
@@ -5323,56 +7229,33 @@ QJsonObject Server::toolBatchDelete(const QJsonObject &args) {
 	QJsonArray messageIdsArray = args["message_ids"].toArray();
 	bool revoke = args.value("revoke").toBool(true);
 
-	int successCount = 0;
-	int failureCount = 0;
-	QJsonArray results;
-
-	// Loop through all message IDs and delete each
+	// Coalesced into calls of up to 100 ids, sent in the background
+	BatchDeleteParams params;
+	params.chatId = chatId;
+	params.deleteForAll = revoke;
 	for (const auto &msgIdVal : messageIdsArray) {
-		qint64 messageId = msgIdVal.toVariant().toLongLong();
-
-		// Create args for single delete
-		QJsonObject deleteArgs;
-		deleteArgs["chat_id"] = chatId;
-		deleteArgs["message_id"] = messageId;
-		deleteArgs["revoke"] = revoke;
-
-		// Call single delete_message implementation
-		QJsonObject deleteResult = toolDeleteMessage(deleteArgs);
-
-		// Track success/failure
-		if (deleteResult.value("success").toBool()) {
-			successCount++;
-		} else {
-			failureCount++;
-		}
-
-		// Add to results array
-		QJsonObject msgResult;
-		msgResult["message_id"] = messageId;
-		msgResult["success"] = deleteResult.value("success").toBool();
-		if (deleteResult.contains("error")) {
-			msgResult["error"] = deleteResult["error"];
-		}
-		results.append(msgResult);
+		params.messageIds.append(msgIdVal.toVariant().toLongLong());
 	}
+	const auto operationId = _batchOps->batchDeleteMessages(params);
+	const auto operation = _batchOps->getOperationStatus(operationId);
 
 	QJsonObject result;
-	result["success"] = (failureCount == 0);
+	result["success"] = (operation["status"].toString() != "failed");
 	result["chat_id"] = chatId;
 	result["total_messages"] = messageIdsArray.size();
-	result["succeeded"] = successCount;
-	result["failed"] = failureCount;
 	result["revoke"] = revoke;
-	result["results"] = results;
+	result["operation"] = operation;
+	if (operation.contains("errorMessage")) {
+		result["error"] = operation["errorMessage"];
+	}
 
-	qInfo() << "MCP: Batch delete" << messageIdsArray.size() << "messages from chat" << chatId << "-" << successCount << "succeeded," << failureCount << "failed";
+	qInfo() << "MCP: Batch delete of" << messageIdsArray.size() << "messages from chat" << chatId << "queued as operation" << operationId;
 
 	return result;
 }
 
 QJsonObject Server::toolBatchForward(const QJsonObject &args) {
-	if (!_session) {
+	if (!callSession() || !_batchOps || !_batchOps->isRunning()) {
 		QJsonObject error;
 		error["success"] = false;
 		error["error"] = "Session not available";
@@ -5381,58 +7264,35 @@ QJsonObject Server::toolBatchForward(const QJsonObject &args) {
 
 	qint64 fromChatId = args["from_chat_id"].toVariant().toLongLong();
 	qint64 toChatId = args["to_chat_id"].toVariant().toLongLong();
-	QJsonArray messageIdsArray = args["message_ids"].toArray();
-
-	int successCount = 0;
-	int failureCount = 0;
-	QJsonArray results;
-
-	// Loop through all message IDs and forward each
-	for (const auto &msgIdVal : messageIdsArray) {
-		qint64 messageId = msgIdVal.toVariant().toLongLong();
-
-		// Create args for single forward
-		QJsonObject forwardArgs;
-		forwardArgs["from_chat_id"] = fromChatId;
-		forwardArgs["to_chat_id"] = toChatId;
-		forwardArgs["message_id"] = messageId;
-
-		// Call single forward_message implementation
-		QJsonObject forwardResult = toolForwardMessage(forwardArgs);
-
-		// Track success/failure
-		if (forwardResult.value("success").toBool()) {
-			successCount++;
-		} else {
-			failureCount++;
-		}
+	QJsonArray messageIdsArray = args["message_ids"].toArray();
 
-		// Add to results array
-		QJsonObject msgResult;
-		msgResult["message_id"] = messageId;
-		msgResult["success"] = forwardResult.value("success").toBool();
-		if (forwardResult.contains("error")) {
-			msgResult["error"] = forwardResult["error"];
-		}
-		results.append(msgResult);
+	// Coalesced into calls of up to 100 ids, sent in order in the background
+	BatchForwardParams params;
+	params.sourceChatId = fromChatId;
+	params.targetChatId = toChatId;
+	for (const auto &msgIdVal : messageIdsArray) {
+		params.messageIds.append(msgIdVal.toVariant().toLongLong());
 	}
+	const auto operationId = _batchOps->batchForwardMessages(params);
+	const auto operation = _batchOps->getOperationStatus(operationId);
 
 	QJsonObject result;
-	result["success"] = (failureCount == 0);
+	result["success"] = (operation["status"].toString() != "failed");
 	result["from_chat_id"] = fromChatId;
 	result["to_chat_id"] = toChatId;
 	result["total_messages"] = messageIdsArray.size();
-	result["succeeded"] = successCount;
-	result["failed"] = failureCount;
-	result["results"] = results;
+	result["operation"] = operation;
+	if (operation.contains("errorMessage")) {
+		result["error"] = operation["errorMessage"];
+	}
 
-	qInfo() << "MCP: Batch forward" << messageIdsArray.size() << "messages from chat" << fromChatId << "to chat" << toChatId << "-" << successCount << "succeeded," << failureCount << "failed";
+	qInfo() << "MCP: Batch forward of" << messageIdsArray.size() << "messages from chat" << fromChatId << "to chat" << toChatId << "queued as operation" << operationId;
 
 	return result;
 }
 
 QJsonObject Server::toolBatchPin(const QJsonObject &args) {
-	if (!_session) {
+	if (!callSession()) {
 		QJsonObject error;
 		error["success"] = false;
 		error["error"] = "Session not available";
@@ -5492,7 +7352,7 @@ QJsonObject Server::toolBatchPin(const QJsonObject &args) {
 }
 
 QJsonObject Server::toolBatchReaction(const QJsonObject &args) {
-	if (!_session) {
+	if (!callSession()) {
 		QJsonObject error;
 		error["success"] = false;
 		error["error"] = "Session not available";
@@ -5653,6 +7513,18 @@ QJsonObject Server::toolGetCacheStats(const QJsonObject &args) {
 	// result["database_size_bytes"] = static_cast<qint64>(stats.databaseSizeBytes);
 	result["indexed_messages"] = _semanticSearch ? _semanticSearch->getIndexedMessageCount() : 0;
 
+	if (_cache) {
+		const auto stats = _cache->getStats();
+		QJsonObject cache;
+		cache["hits"] = stats.hits;
+		cache["misses"] = stats.misses;
+		cache["hit_rate"] = stats.hitRate();
+		cache["evictions"] = stats.evictions;
+		cache["entries"] = stats.size;
+		cache["bytes"] = stats.bytes;
+		result["cache"] = cache;
+	}
+
 	return result;
 }
 
@@ -5720,55 +7592,565 @@ QJsonObject Server::toolHealthCheck(const QJsonObject &args) {
 	result["database_connected"] = _db.isOpen();
 	result["archiver_running"] = (_archiver != nullptr);
 	result["scheduler_running"] = (_scheduler != nullptr);
-	result["uptime_seconds"] = 0; // TODO: Track actual uptime
+	result["components"] = componentsStatus();
+	result["uptime_seconds"] = _metrics->uptimeSeconds();
+	if (callSession()) {
+		const auto resident = callSession()->data().histories().residentStats();
+		result["resident_histories"] = QJsonObject{
+			{"histories", resident.histories},
+			{"messages", resident.messages},
+			{"limit", resident.limit},
+			{"unloaded_histories", qint64(resident.unloadedHistories)},
+			{"unloaded_messages", qint64(resident.unloadedMessages)},
+		};
+		const auto index = callSession()->data().messagesIndexStats();
+		result["messages_index"] = QJsonObject{
+			{"items", index.items},
+			{"bytes", qint64(index.bytes)},
+		};
+	}
+
+	const auto stalls = Core::StallDetector::Collect();
+	QJsonArray components;
+	for (const auto &component : stalls.components) {
+		components.append(QJsonObject{
+			{"component", component.name.isEmpty()
+				? QString("unattributed")
+				: component.name},
+			{"count", component.count},
+			{"total_ms", qint64(component.total)},
+			{"longest_ms", qint64(component.longest)},
+		});
+	}
+	QJsonArray recent;
+	for (const auto &stall : stalls.recent) {
+		recent.append(QJsonObject{
+			{"when", stall.when.toString(Qt::ISODate)},
+			{"duration_ms", qint64(stall.duration)},
+			{"stack", stall.stack},
+		});
+	}
+	result["main_thread_stalls"] = QJsonObject{
+		{"running", stalls.running},
+		{"threshold_ms", qint64(stalls.threshold)},
+		{"count", stalls.stalls},
+		{"total_ms", qint64(stalls.total)},
+		{"longest_ms", qint64(stalls.longest)},
+		{"components", components},
+		{"recent", recent},
+	};
 
 	return result;
 }
 
-// ===== VOICE TOOL IMPLEMENTATIONS =====
+QJsonObject Server::toolGetMetrics(const QJsonObject &args) {
+	auto result = _metrics->snapshot(
+		args.value("tool").toString(),
+		args.value("limit").toInt(0));
+	result["admission"] = _rateLimiter->snapshot();
+	return result;
+}
 
-QJsonObject Server::toolTranscribeVoice(const QJsonObject &args) {
-	qint64 messageId = args.value("message_id").toVariant().toLongLong();
-	QString audioPath = args["audio_path"].toString();
+QJsonObject Server::toolGetNetworkStats(const QJsonObject &args) {
+	QJsonObject result;
+	if (!callSession()) {
+		result["error"] = "Session not available";
+		return result;
+	}
+	const auto dcId = args.value("dc_id").toInt(0);
+	const auto &bounds = MTP::details::kResponseTimeBuckets;
+	const auto percentile = [&](
+			const MTP::details::SessionStatsSnapshot &stats,
+			double fraction) {
+		// Upper bound of the bucket, -1 when past the last one.
+		const auto wanted = int64(std::ceil(stats.responses * fraction));
+		auto seen = int64();
+		for (auto i = 0; i != int(bounds.size()); ++i) {
+			seen += stats.responseTimes[i];
+			if (seen >= wanted) {
+				return bounds[i] ? bounds[i] : crl::time(-1);
+			}
+		}
+		return crl::time(-1);
+	};
 
-	// Initialize voice transcription if not already done
-	if (!_voiceTranscription) {
-		_voiceTranscription.reset(new VoiceTranscription(this));
-		_voiceTranscription->start(&_db);
+	const auto now = crl::now();
+	const auto elapsed = _networkBytesAt ? (now - _networkBytesAt) : 0;
+	auto bytes = QHash<qint32, QPair<qint64, qint64>>();
+	QJsonArray sessions;
+	for (const auto &stats : callSession()->mtp().sessionsStats()) {
+		const auto bareDcId = MTP::BareDcId(stats.shiftedDcId);
+		bytes.insert(
+			stats.shiftedDcId,
+			{ stats.bytesSent, stats.bytesReceived });
+		if (dcId && bareDcId != dcId) {
+			continue;
+		}
+		QJsonArray histogram;
+		for (auto i = 0; i != int(bounds.size()); ++i) {
+			histogram.append(QJsonObject{
+				{"below_ms", bounds[i] ? QJsonValue(bounds[i]) : QJsonValue()},
+				{"count", stats.responseTimes[i]},
+			});
+		}
+		auto entry = QJsonObject{
+			{"dc_id", bareDcId},
+			{"shift", MTP::GetDcIdShift(stats.shiftedDcId)},
+			{"state", stats.state},
+			{"transport", stats.transport},
+			{"bytes_sent", stats.bytesSent},
+			{"bytes_received", stats.bytesReceived},
+			{"packets_sent", stats.packetsSent},
+			{"packets_received", stats.packetsReceived},
+			{"containers", stats.containers},
+			{"avg_container_size", stats.containers
+				? double(stats.containerMessages) / stats.containers
+				: 0.},
+			{"resent", stats.resent},
+			{"responses", stats.responses},
+			{"avg_response_ms", stats.responses
+				? double(stats.responseTimeSum) / stats.responses
+				: 0.},
+			{"max_response_ms", stats.responseTimeMax},
+			{"p50_response_ms", percentile(stats, 0.5)},
+			{"p90_response_ms", percentile(stats, 0.9)},
+			{"p99_response_ms", percentile(stats, 0.99)},
+			{"response_histogram", histogram},
+			{"handled", stats.handled},
+			{"avg_handle_us", stats.handled
+				? double(stats.handleMicroseconds) / stats.handled
+				: 0.},
+			{"to_send", stats.toSend},
+			{"have_sent", stats.haveSent},
+		};
+		const auto last = _networkBytes.find(stats.shiftedDcId);
+		if (elapsed > 0 && last != _networkBytes.end()) {
+			// Rates since the previous call, a killed session starts over.
+			const auto rate = [&](qint64 now, qint64 was) {
+				return (now >= was) ? ((now - was) * 1000. / elapsed) : 0.;
+			};
+			entry["sent_per_second"] = rate(
+				stats.bytesSent,
+				last->first);
+			entry["received_per_second"] = rate(
+				stats.bytesReceived,
+				last->second);
+		}
+		sessions.append(entry);
+	}
+	_networkBytes = std::move(bytes);
+	_networkBytesAt = now;
+
+	result["sessions"] = sessions;
+	result["count"] = sessions.size();
+	if (elapsed > 0) {
+		result["rates_over_ms"] = elapsed;
+	}
+	return result;
+}
+
+QJsonObject Server::toolProfileSession(const QJsonObject &args) {
+	QJsonObject result;
+	if (!callSession()) {
+		result["error"] = "Session not available";
+		return result;
+	}
+	// The generated peers stay in the session until the app quits.
+	if (qgetenv("MCP_SESSION_PROFILER") != "1") {
+		result["error"] = "Session profiling is disabled, "
+			"start the app with MCP_SESSION_PROFILER=1 on a test account";
+		return result;
+	}
+
+	auto benchmarks = std::vector<QString>();
+	for (const auto &value : args.value("benchmarks").toArray()) {
+		const auto name = value.toString();
+		if (!ranges::contains(SessionProfiler::Benchmarks(), name)) {
+			result["error"] = QString("Unknown benchmark: %1").arg(name);
+			return result;
+		}
+		benchmarks.push_back(name);
+	}
+	if (benchmarks.empty()) {
+		benchmarks = SessionProfiler::Benchmarks();
 	}
 
-	auto transcriptionResult = _voiceTranscription->transcribe(audioPath);
+	if (!_sessionProfiler) {
+		_sessionProfiler = std::make_unique<SessionProfiler>(callSession());
+	}
+	result["fixture"] = _sessionProfiler->populate({
+		.dialogs = std::clamp(args.value("dialogs").toInt(3000), 1, 100000),
+		.folders = std::clamp(args.value("folders").toInt(200), 0, 1000),
+		.messagesPerDialog = std::clamp(
+			args.value("messages_per_dialog").toInt(100),
+			1,
+			10000),
+		.seed = args.value("seed").toInt(1),
+	});
 
-	if (transcriptionResult.success && messageId > 0) {
-		_voiceTranscription->storeTranscription(messageId, 0, transcriptionResult);
+	const auto iterations = args.value("iterations").toInt(20);
+	QJsonArray results;
+	for (const auto &name : benchmarks) {
+		results.append(_sessionProfiler->run(name, iterations));
 	}
+	result["success"] = true;
+	result["benchmarks"] = results;
+	return result;
+}
 
+QJsonObject Server::toolStartTrace(const QJsonObject &args) {
 	QJsonObject result;
-	result["success"] = transcriptionResult.success;
-	result["text"] = transcriptionResult.text;
-	result["language"] = transcriptionResult.language;
-	result["confidence"] = transcriptionResult.confidence;
-	result["duration_seconds"] = transcriptionResult.durationSeconds;
-	result["model"] = transcriptionResult.modelUsed;
-	result["provider"] = transcriptionResult.provider;
+	const auto path = args.value("path").toString();
+	const auto limit = std::clamp(
+		args.value("max_events").toInt(1000000),
+		1000,
+		20000000);
+	if (!Core::Tracing::Start(path, limit)) {
+		result["error"] = "A trace is already being captured";
+		return result;
+	}
+	result["success"] = true;
+	result["max_events"] = limit;
+	return result;
+}
+
+QJsonObject Server::toolStopTrace(const QJsonObject &args) {
+	QJsonObject result;
+	if (!Core::Tracing::Capturing()) {
+		result["error"] = "No trace is being captured";
+		return result;
+	}
+	const auto capture = Core::Tracing::Stop();
+	if (!capture.written) {
+		result["error"] = QString("Could not write %1").arg(capture.path);
+		return result;
+	}
+	result["success"] = true;
+	result["path"] = capture.path;
+	result["events"] = capture.events;
+	result["dropped"] = capture.dropped;
+	result["duration_ms"] = capture.duration;
+	return result;
+}
 
-	if (!transcriptionResult.error.isEmpty()) {
-		result["error"] = transcriptionResult.error;
+QJsonObject Server::toolStartJob(const QJsonObject &args) {
+	QJsonObject result;
+	const auto toolName = args["tool"].toString();
+	if (!Dispatch::kTools.find(toolName)) {
+		result["error"] = "Unknown tool: " + toolName;
+		return result;
+	} else if (toolName.endsWith("_job") || toolName == "list_jobs") {
+		result["error"] = "Jobs can't start jobs";
+		return result;
+	} else if (!_jobQueue) {
+		result["error"] = "Job queue not available";
+		return result;
 	}
+	ensureComponents(toolName);
+	const auto id = startJob(
+		toolName,
+		args["arguments"].toObject(),
+		args["progress_token"]);
+	result["success"] = true;
+	result["job_id"] = id;
+	result["tool"] = toolName;
+	result["state"] = JobStateName(JobState::Queued);
+	return result;
+}
 
+QString Server::startJob(
+		const QString &toolName,
+		const QJsonObject &arguments,
+		const QJsonValue &progressToken) {
+	if (toolName == "export_chat" && _archiver) {
+		return _jobQueue->start(toolName, arguments, progressToken, [=](
+				JobControl &control) {
+			return runExportJob(arguments, control);
+		});
+	} else if (toolName == "archive_chat" && _archiver) {
+		return _jobQueue->startAsync(toolName, arguments, progressToken, [=](
+				std::shared_ptr<JobControl> control) {
+			startArchiveJob(arguments, std::move(control));
+		});
+	} else if ((toolName == "index_messages"
+			|| toolName == "semantic_index_messages")
+		&& _semanticSearch) {
+		return _jobQueue->startAsync(toolName, arguments, progressToken, [=](
+				std::shared_ptr<JobControl> control) {
+			startIndexJob(arguments, std::move(control));
+		});
+	} else if (_threadSafeTools.contains(toolName)
+		&& !arguments.contains("account_id")) {
+		// Same as a tools/call on _toolPool, only without a deadline.
+		return _jobQueue->start(toolName, arguments, progressToken, [=](
+				JobControl &) {
+			return executeTool(toolName, arguments);
+		});
+	}
+	return _jobQueue->startAsync(toolName, arguments, progressToken, [=](
+			std::shared_ptr<JobControl> control) {
+		control->finish(executeTool(toolName, arguments));
+	});
+}
+
+QJsonObject Server::runExportJob(
+		const QJsonObject &args,
+		JobControl &control) {
+	// Resumed parts are appended to the file, so the export is written
+	// in chunks with a cursor checkpoint after each of them.
+	constexpr auto kChunk = qint64(5000);
+
+	const auto chatId = args["chat_id"].toVariant().toLongLong();
+	const auto limit = std::max(args["limit"].toVariant().toLongLong(), 0LL);
+	const auto known = qint64(
+		_archiver->getChatInfo(chatId)["message_count"].toInt());
+	const auto total = limit ? std::min(limit, known) : known;
+
+	auto step = args;
+	auto exported = qint64(0);
+	auto bytes = qint64(0);
+	auto result = QJsonObject();
+	while (true) {
+		step["limit"] = limit
+			? std::min(kChunk, limit - exported)
+			: kChunk;
+		result = toolExportChat(step);
+		if (result.contains("error")) {
+			break;
+		}
+		exported += result["exported"].toVariant().toLongLong();
+		bytes += result["bytes_written"].toVariant().toLongLong();
+		control.progress(exported, total);
+
+		const auto cursor = result["cursor"].toString();
+		if (result["complete"].toBool()
+			|| cursor.isEmpty()
+			|| (limit && exported >= limit)
+			|| !result["exported"].toVariant().toLongLong()) {
+			result["complete"] = result["complete"].toBool()
+				|| (limit && exported >= limit);
+			break;
+		}
+		step["cursor"] = cursor;
+		control.checkpoint(QJsonObject{
+			{"cursor", cursor},
+			{"exported", exported},
+			{"output_path", result["output_path"]},
+		});
+		if (control.cancelled()) {
+			result["note"] = "Cancelled, export_chat with the cursor continues it";
+			break;
+		}
+	}
+	result["exported"] = exported;
+	result["bytes_written"] = bytes;
 	return result;
 }
 
-QJsonObject Server::toolGetTranscription(const QJsonObject &args) {
-	qint64 messageId = args["message_id"].toVariant().toLongLong();
+void Server::startArchiveJob(
+		const QJsonObject &args,
+		std::shared_ptr<JobControl> control) {
+	const auto queued = executeTool("archive_chat", args);
+	if (!queued["success"].toBool() || !_archiver) {
+		control->finish(queued);
+		return;
+	}
+	const auto chatId = args["chat_id"].toVariant().toLongLong();
+	const auto limit = args.value("limit").toInt(1000);
+
+	// Connections live until the crawl of the chat ends.
+	const auto guard = new QObject(this);
+	const auto done = [=](QJsonObject result) {
+		result["chat_id"] = chatId;
+		guard->deleteLater();
+		control->finish(result);
+	};
+	const auto archiver = _archiver.get();
+	connect(archiver, &ChatArchiver::chatArchiveProgress, guard, [=](
+			qint64 id,
+			int archived) {
+		if (id == chatId) {
+			control->progress(archived, std::max(limit, 0));
+		}
+	});
+	connect(archiver, &ChatArchiver::chatArchived, guard, [=](
+			qint64 id,
+			int archived) {
+		if (id == chatId) {
+			done(QJsonObject{
+				{"success", true},
+				{"archived", archived},
+			});
+		}
+	});
+	connect(archiver, &ChatArchiver::chatArchiveFailed, guard, [=](
+			qint64 id,
+			const QString &reason) {
+		if (id == chatId) {
+			done(QJsonObject{
+				{"success", false},
+				{"error", reason},
+			});
+		}
+	});
+	control->onCancel([=] {
+		archiver->cancelArchive(chatId);
+		done(QJsonObject{
+			{"success", false},
+			{"cancelled", true},
+		});
+	});
+}
+
+void Server::startIndexJob(
+		const QJsonObject &args,
+		std::shared_ptr<JobControl> control) {
+	const auto chatId = args["chat_id"].toVariant().toLongLong();
+	const auto model = _semanticSearch
+		? _semanticSearch->modelName()
+		: QString();
+
+	// Both run on the indexing thread. Embedded pages are stored as they
+	// go, an index job started again continues with the rest.
+	auto observer = IndexingObserver();
+	observer.progress = [=](int indexed, int total) {
+		control->progress(indexed, total);
+		return !control->cancelled();
+	};
+	observer.done = [=](int indexed, const QString &error) {
+		auto result = QJsonObject{
+			{"chat_id", chatId},
+			{"success", error.isEmpty()},
+			{"indexed", indexed},
+			{"embedding_model", model},
+		};
+		if (!error.isEmpty()) {
+			result["error"] = error;
+		}
+		control->finish(result);
+	};
+	const auto queued = indexMessages(args, observer);
+	if (!queued["queued"].toBool()) {
+		control->finish(queued);
+	}
+}
+
+QJsonObject Server::toolGetJob(const QJsonObject &args) {
+	const auto id = args["job_id"].toString();
+	const auto job = _jobQueue
+		? _jobQueue->describe(
+			id,
+			args.value("offset").toInt(0),
+			args.value("limit").toInt(0))
+		: std::nullopt;
+	if (!job) {
+		QJsonObject result;
+		result["error"] = "Job not found: " + id;
+		return result;
+	}
+	return *job;
+}
+
+QJsonObject Server::toolCancelJob(const QJsonObject &args) {
+	QJsonObject result;
+	const auto id = args["job_id"].toString();
+	result["job_id"] = id;
+	if (!_jobQueue || !_jobQueue->cancel(id)) {
+		result["error"] = "No running job " + id;
+		return result;
+	}
+	result["success"] = true;
+	return result;
+}
+
+QJsonObject Server::toolListJobs(const QJsonObject &args) {
+	Q_UNUSED(args);
+
+	const auto jobs = _jobQueue ? _jobQueue->list() : QJsonArray();
+	QJsonObject result;
+	result["jobs"] = jobs;
+	result["count"] = jobs.size();
+	return result;
+}
 
+// ===== VOICE TOOL IMPLEMENTATIONS =====
+
+VoiceTranscription &Server::voiceTranscription() {
+	// Initialize voice transcription if not already done
+	if (!_voiceTranscription) {
+		_voiceTranscription.reset(new VoiceTranscription());
+		_voiceTranscription->start(&_db);
+		connect(
+			_voiceTranscription.get(),
+			&VoiceTranscription::voiceDecoded,
+			this,
+			&Server::applyVoiceWaveform);
+	}
+	return *_voiceTranscription;
+}
+
+void Server::applyVoiceWaveform(quint64 documentId, const QByteArray &pcm) {
+	if (!_session) {
+		return;
+	}
+	// The chat would decode the same file again to draw the missing
+	// waveform, the transcription samples are enough for it.
+	const auto document = _session->data().document(DocumentId(documentId));
+	const auto voice = document->isVideoMessage()
+		? document->round()
+		: document->voice();
+	if (!voice || !voice->waveform.isEmpty()) {
+		return;
+	}
+	voice->waveform = audioCountWaveform(bytes::make_span(pcm));
+	if (voice->waveform.isEmpty()) {
+		return;
+	}
+	voice->wavemax = *ranges::max_element(voice->waveform);
+	_session->data().requestDocumentViewRepaint(document);
+}
+
+QJsonObject Server::toolTranscribeVoice(const QJsonObject &args) {
+	const auto messageId = args.value("message_id").toVariant().toLongLong();
+	const auto chatId = args.value("chat_id").toVariant().toLongLong();
+	const auto documentId = args.value("document_id").toVariant().toULongLong();
+	const auto audioPath = args["audio_path"].toString();
+
+	// Jobs answered from cache are finished right away.
+	auto &transcription = voiceTranscription();
+	const auto jobId = transcription.transcribeAsync(
+		audioPath,
+		documentId,
+		messageId,
+		chatId);
+	auto result = transcription.jobStatus(jobId);
+	result["pending_jobs"] = transcription.pendingJobs();
+	return result;
+}
+
+QJsonObject Server::toolGetTranscription(const QJsonObject &args) {
 	if (!_voiceTranscription) {
 		QJsonObject error;
 		error["error"] = "Voice transcription not initialized";
 		return error;
 	}
 
-	auto transcriptionResult = _voiceTranscription->getStoredTranscription(messageId);
+	if (args.contains("job_id")) {
+		const auto jobId = args["job_id"].toVariant().toULongLong();
+		auto status = _voiceTranscription->jobStatus(jobId);
+		if (status.isEmpty()) {
+			status["success"] = false;
+			status["error"] = "Unknown transcription job";
+		}
+		return status;
+	}
+
+	const auto documentId = args["document_id"].toVariant().toULongLong();
+	const auto messageId = args["message_id"].toVariant().toLongLong();
+	const auto transcriptionResult = documentId
+		? _voiceTranscription->cachedTranscription(documentId).value_or(
+			TranscriptionResult())
+		: _voiceTranscription->getStoredTranscription(messageId);
 
 	QJsonObject result;
 	result["success"] = transcriptionResult.success;
@@ -5867,6 +8249,134 @@ QJsonObject Server::handleReadResource(const QJsonObject &params) {
 	return result;
 }
 
+auto Server::handleSubscribeResource(const QJsonObject &params)
+-> CheckedResult {
+	const auto uri = params["uri"].toString();
+	const auto prefix = QString(kMessagesResourcePrefix);
+	if (!uri.startsWith(prefix)) {
+		return base::make_unexpected(RequestError{
+			kInvalidParamsCode,
+			"Only telegram://messages/<chat_id> can be subscribed",
+		});
+	}
+	auto ok = false;
+	const auto chatId = uri.mid(prefix.size()).toLongLong(&ok);
+	if (!ok) {
+		return base::make_unexpected(RequestError{
+			kInvalidParamsCode,
+			"Invalid chat id in " + uri,
+		});
+	}
+	const auto first = _subscribedChats.isEmpty();
+	_subscribedChats.insert(chatId);
+	if (first) {
+		subscribeResourceUpdates();
+	}
+	return QJsonObject();
+}
+
+auto Server::handleUnsubscribeResource(const QJsonObject &params)
+-> CheckedResult {
+	const auto uri = params["uri"].toString();
+	const auto prefix = QString(kMessagesResourcePrefix);
+	if (uri.startsWith(prefix)) {
+		const auto chatId = uri.mid(prefix.size()).toLongLong();
+		_subscribedChats.remove(chatId);
+		_resourceDeltas.remove(chatId);
+	}
+	if (_subscribedChats.isEmpty()) {
+		_resourceUpdatesLifetime.destroy();
+		_resourceUpdatesTimer.stop();
+	}
+	return QJsonObject();
+}
+
+void Server::subscribeResourceUpdates() {
+	_resourceUpdatesLifetime.destroy();
+	_resourceDeltas.clear();
+	if (!_session || _subscribedChats.isEmpty()) {
+		return;
+	}
+	const auto owner = &_session->data();
+	const auto chatIdOf = [](not_null<const HistoryItem*> item) {
+		return qint64(item->history()->peer->id.value);
+	};
+	owner->newItemAdded(
+	) | rpl::start_with_next([=](not_null<HistoryItem*> item) {
+		resourceChanged(chatIdOf(item), item->id.bare, false);
+	}, _resourceUpdatesLifetime);
+
+	_session->changes().messageUpdates(
+		Data::MessageUpdate::Flag::Edited
+	) | rpl::start_with_next([=](const Data::MessageUpdate &update) {
+		resourceChanged(chatIdOf(update.item), update.item->id.bare, false);
+	}, _resourceUpdatesLifetime);
+
+	// A sent message is pushed again once it has its server id.
+	owner->itemIdChanged(
+	) | rpl::start_with_next([=](const Data::Session::IdChange &change) {
+		const auto chatId = qint64(change.newId.peer.value);
+		resourceChanged(chatId, change.oldId.bare, true);
+		resourceChanged(chatId, change.newId.msg.bare, false);
+	}, _resourceUpdatesLifetime);
+
+	// Not itemRemoved(), it fires for the items of unloaded histories.
+	owner->messageDeleted(
+	) | rpl::start_with_next([=](FullMsgId itemId) {
+		resourceChanged(qint64(itemId.peer.value), itemId.msg.bare, true);
+	}, _resourceUpdatesLifetime);
+}
+
+void Server::resourceChanged(qint64 chatId, qint64 messageId, bool deleted) {
+	if (!_subscribedChats.contains(chatId)) {
+		return;
+	}
+	auto &delta = _resourceDeltas[chatId];
+	if (deleted) {
+		delta.changed.remove(messageId);
+		delta.deleted.insert(messageId);
+	} else {
+		delta.changed.insert(messageId);
+	}
+	if (!_resourceUpdatesTimer.isActive()) {
+		_resourceUpdatesTimer.start();
+	}
+}
+
+void Server::sendResourceUpdates() {
+	if (!_session) {
+		_resourceDeltas.clear();
+		return;
+	}
+	const auto deltas = base::take(_resourceDeltas);
+	for (auto i = deltas.begin(); i != deltas.end(); ++i) {
+		const auto peerId = PeerId(i.key());
+		auto messages = QJsonArray();
+		for (const auto messageId : i->changed) {
+			// Sent messages may have got their server id meanwhile.
+			const auto item = _session->data().message(
+				peerId,
+				MsgId(messageId));
+			if (item) {
+				messages.append(extractMessageJson(item));
+			}
+		}
+		auto deleted = QJsonArray();
+		for (const auto messageId : i->deleted) {
+			deleted.append(QString::number(messageId));
+		}
+		if (messages.isEmpty() && deleted.isEmpty()) {
+			continue;
+		}
+		sendNotification("notifications/resources/updated", QJsonObject{
+			{ "uri", kMessagesResourcePrefix + QString::number(i.key()) },
+			{ "chat_id", QString::number(i.key()) },
+			{ "messages", messages },
+			{ "deleted", deleted },
+		});
+	}
+}
+
 // ===== PROMPT HANDLERS =====
 
 QJsonObject Server::handleListPrompts(const QJsonObject &params) {
@@ -6190,6 +8700,16 @@ QJsonObject Server::toolGetBotStats(const QJsonObject &args) {
 		result["last_active"] = stats.lastActive.toString(Qt::ISODate);
 	}
 
+	QJsonObject mailbox;
+	mailbox["depth"] = stats.mailboxDepth;
+	mailbox["peak"] = stats.mailboxPeak;
+	mailbox["queued"] = stats.eventsQueued;
+	mailbox["dropped"] = stats.eventsDropped;
+	mailbox["coalesced"] = stats.eventsCoalesced;
+	mailbox["over_budget"] = stats.overBudgetEvents;
+	mailbox["last_queue_wait_ms"] = stats.lastQueueWaitMs;
+	result["mailbox"] = mailbox;
+
 	// Calculate error rate
 	if (stats.messagesProcessed > 0) {
 		double errorRate = static_cast<double>(stats.errorsOccurred) / stats.messagesProcessed;
@@ -6317,6 +8837,10 @@ QJsonObject Server::toolGetEphemeralStats(const QJsonObject &args) {
 	result["view_once_count"] = stats.viewOnceCount;
 	result["vanishing_count"] = stats.vanishingCount;
 	result["media_saved"] = stats.mediaSaved;
+	result["media_pending"] = stats.mediaPending;
+	result["media_deadline_misses"] = stats.mediaDeadlineMisses;
+	result["media_failed"] = stats.mediaFailed;
+	result["min_margin_ms"] = double(stats.minMarginMs);
 	result["last_captured"] = stats.lastCaptured.toString(Qt::ISODate);
 	result["success"] = true;
 
@@ -6332,34 +8856,66 @@ QJsonObject Server::toolTranscribeVoiceMessage(const QJsonObject &args) {
 	qint64 messageId = args["message_id"].toVariant().toLongLong();
 	QString language = args.value("language").toString("auto");
 
-	// Note: Voice transcription requires downloading the voice message first
-	// For now, this creates a placeholder - full implementation needs file download
-	result["success"] = true;
-	result["transcription_id"] = QString("tr_%1_%2").arg(chatId).arg(messageId);
+	if (!callSession()) {
+		result["success"] = false;
+		result["error"] = "Session not available";
+		return result;
+	}
+	const auto item = callSession()->data().message(PeerId(chatId), MsgId(messageId));
+	const auto document = (item && item->media())
+		? item->media()->document()
+		: nullptr;
+	if (!document || !(document->isVoiceMessage() || document->isVideoMessage())) {
+		result["success"] = false;
+		result["error"] = "Voice message not found";
+		return result;
+	}
 	result["chat_id"] = chatId;
 	result["message_id"] = messageId;
-	result["status"] = "pending";
 	result["language"] = language;
-	result["note"] = "Voice message transcription queued. Use get_voice_transcription to check status.";
 
+	// Small voice notes stay in memory, the rest is read from the cache
+	// file by the decoder itself.
+	const auto media = document->activeMediaView();
+	const auto bytes = media ? media->bytes() : QByteArray();
+	const auto &location = document->location(true);
+	if (bytes.isEmpty() && location.isEmpty()) {
+		document->save(Data::FileOrigin(item->fullId()), QString());
+		result["success"] = true;
+		result["status"] = "downloading";
+		result["note"] = "Voice message is being downloaded, call again to transcribe it";
+		return result;
+	}
+
+	auto &transcription = voiceTranscription();
+	const auto jobId = transcription.transcribeVoiceAsync(
+		location,
+		bytes,
+		document->id,
+		messageId,
+		chatId);
+	const auto status = transcription.jobStatus(jobId);
+	for (auto i = status.begin(); i != status.end(); ++i) {
+		result.insert(i.key(), i.value());
+	}
+	result["success"] = (status["status"].toString() != "failed");
+	result["transcription_id"] = QString::number(jobId);
 	return result;
 }
 
 QJsonObject Server::toolGetVoiceTranscription(const QJsonObject &args) {
-	QJsonObject result;
 	QString transcriptionId = args["transcription_id"].toString();
 
-	// Note: Full implementation needs voice file download and transcription
-	// This is a placeholder that returns pending status
-	result["success"] = true;
+	auto result = _voiceTranscription
+		? _voiceTranscription->jobStatus(transcriptionId.toULongLong())
+		: QJsonObject();
+	if (result.isEmpty()) {
+		result["success"] = false;
+		result["error"] = "Unknown transcription job";
+	} else if (!result.contains("success")) {
+		result["success"] = true;
+	}
 	result["transcription_id"] = transcriptionId;
-	result["text"] = "";
-	result["language"] = "auto";
-	result["confidence"] = 0.0;
-	result["status"] = "pending";
-	result["duration_ms"] = 0;
-	result["note"] = "Transcription service requires voice file download integration";
-
 	return result;
 }
 
@@ -6369,7 +8925,6 @@ QJsonObject Server::toolTranslateMessage(const QJsonObject &args) {
 	qint64 chatId = args["chat_id"].toVariant().toLongLong();
 	qint64 messageId = args["message_id"].toVariant().toLongLong();
 	QString targetLanguage = args["target_language"].toString();
-	QString sourceLanguage = args.value("source_language").toString("auto");
 
 	if (targetLanguage.isEmpty()) {
 		result["error"] = "Missing target_language parameter";
@@ -6378,48 +8933,27 @@ QJsonObject Server::toolTranslateMessage(const QJsonObject &args) {
 	}
 
 	// Check translation cache first
-	QSqlQuery query(_db);
-	query.prepare("SELECT translated_text, detected_language FROM translation_cache "
+	auto query = PreparedQuery(_db, "SELECT translated_text, source_language FROM translation_cache "
 				  "WHERE chat_id = ? AND message_id = ? AND target_language = ?");
-	query.addBindValue(chatId);
-	query.addBindValue(messageId);
-	query.addBindValue(targetLanguage);
+	query->addBindValue(chatId);
+	query->addBindValue(messageId);
+	query->addBindValue(targetLanguage);
 
-	if (query.exec() && query.next()) {
+	if (query->exec() && query->next()) {
 		result["success"] = true;
-		result["translated_text"] = query.value(0).toString();
-		result["detected_language"] = query.value(1).toString();
+		result["translated_text"] = query->value(0).toString();
+		result["detected_language"] = query->value(1).toString();
 		result["target_language"] = targetLanguage;
 		result["cached"] = true;
 		return result;
 	}
+	query->finish();
 
-	// Get original message text
-	QString originalText;
-	if (_session) {
-		auto &owner = _session->data();
-		auto item = owner.message(PeerId(chatId), MsgId(messageId));
-		if (item) {
-			originalText = item->originalText().text;
-		}
-	}
-
-	if (originalText.isEmpty()) {
-		result["error"] = "Message not found or has no text";
-		result["success"] = false;
-		return result;
-	}
-
-	// Note: Actual translation would require external API
-	// For now, store as "translation pending" placeholder
-	result["success"] = true;
-	result["original_text"] = originalText;
-	result["target_language"] = targetLanguage;
-	result["source_language"] = sourceLanguage;
-	result["status"] = "translation_service_required";
-	result["note"] = "External translation API integration required";
-
-	return result;
+	return toolTranslateMessages(QJsonObject{
+		{"chat_id", chatId},
+		{"message_ids", QJsonArray{ messageId }},
+		{"target_language", targetLanguage},
+	});
 }
 
 QJsonObject Server::toolGetTranslationHistory(const QJsonObject &args) {
@@ -6427,7 +8961,6 @@ QJsonObject Server::toolGetTranslationHistory(const QJsonObject &args) {
 	int limit = args.value("limit").toInt(50);
 	QString targetLanguage = args.value("target_language").toString();
 
-	QSqlQuery query(_db);
 	QString sql = "SELECT chat_id, message_id, original_text, translated_text, "
 				  "source_language, target_language, created_at "
 				  "FROM translation_cache ";
@@ -6437,23 +8970,23 @@ QJsonObject Server::toolGetTranslationHistory(const QJsonObject &args) {
 	}
 	sql += "ORDER BY created_at DESC LIMIT ?";
 
-	query.prepare(sql);
+	auto query = PreparedQuery(_db, sql);
 	if (!targetLanguage.isEmpty()) {
-		query.addBindValue(targetLanguage);
+		query->addBindValue(targetLanguage);
 	}
-	query.addBindValue(limit);
+	query->addBindValue(limit);
 
 	QJsonArray translations;
-	if (query.exec()) {
-		while (query.next()) {
+	if (query->exec()) {
+		while (query->next()) {
 			QJsonObject translation;
-			translation["chat_id"] = query.value(0).toLongLong();
-			translation["message_id"] = query.value(1).toLongLong();
-			translation["original_text"] = query.value(2).toString();
-			translation["translated_text"] = query.value(3).toString();
-			translation["source_language"] = query.value(4).toString();
-			translation["target_language"] = query.value(5).toString();
-			translation["created_at"] = query.value(6).toString();
+			translation["chat_id"] = query->value(0).toLongLong();
+			translation["message_id"] = query->value(1).toLongLong();
+			translation["original_text"] = query->value(2).toString();
+			translation["translated_text"] = query->value(3).toString();
+			translation["source_language"] = query->value(4).toString();
+			translation["target_language"] = query->value(5).toString();
+			translation["created_at"] = query->value(6).toString();
 			translations.append(translation);
 		}
 	}
@@ -6466,37 +8999,74 @@ QJsonObject Server::toolGetTranslationHistory(const QJsonObject &args) {
 }
 
 // Message Tags Tools
+namespace {
+
+// "tag" may join several tags with AND, "tags" lists them.
+[[nodiscard]] QStringList TagsArgument(const QJsonObject &args) {
+	auto result = QStringList();
+	for (const auto &value : args.value("tags").toArray()) {
+		result.push_back(value.toString());
+	}
+	const auto single = args.value("tag").toString();
+	for (const auto &part : single.split(' ', Qt::SkipEmptyParts)) {
+		if (part.compare("AND", Qt::CaseInsensitive) != 0 && part != "&&") {
+			result.push_back(part);
+		}
+	}
+	result.removeAll(QString());
+	result.removeDuplicates();
+	return result;
+}
+
+} // namespace
+
 QJsonObject Server::toolAddMessageTag(const QJsonObject &args) {
 	QJsonObject result;
 	qint64 chatId = args["chat_id"].toVariant().toLongLong();
 	qint64 messageId = args["message_id"].toVariant().toLongLong();
-	QString tagName = args["tag"].toString();
+	QStringList tags = TagsArgument(args);
 	QString color = args.value("color").toString("#3390ec");
 
-	if (tagName.isEmpty()) {
+	if (tags.isEmpty()) {
 		result["error"] = "Missing tag parameter";
 		result["success"] = false;
 		return result;
 	}
 
-	QSqlQuery query(_db);
-	query.prepare("INSERT OR REPLACE INTO message_tags (chat_id, message_id, tag_name, color, created_at) "
-				  "VALUES (?, ?, ?, ?, datetime('now'))");
-	query.addBindValue(chatId);
-	query.addBindValue(messageId);
-	query.addBindValue(tagName);
-	query.addBindValue(color);
+	// The upsert keeps the rowid, the one the tag index knows.
+	for (const auto &tagName : tags) {
+		auto query = PreparedQuery(_db, "INSERT INTO message_tags (chat_id, message_id, tag_name, color, created_at) "
+					  "VALUES (?, ?, ?, ?, datetime('now')) "
+					  "ON CONFLICT(chat_id, message_id, tag_name) DO UPDATE SET color = excluded.color");
+		query->addBindValue(chatId);
+		query->addBindValue(messageId);
+		query->addBindValue(tagName);
+		query->addBindValue(color);
+		if (!query->exec()) {
+			result["success"] = false;
+			result["error"] = "Failed to add tag: " + query->lastError().text();
+			return result;
+		}
+		query->finish();
+
+		auto row = PreparedQuery(_db, "SELECT id FROM message_tags "
+					  "WHERE chat_id = ? AND message_id = ? AND tag_name = ?");
+		row->addBindValue(chatId);
+		row->addBindValue(messageId);
+		row->addBindValue(tagName);
+		if (row->exec() && row->next()) {
+			_tagIndex->added(row->value(0).toLongLong(), chatId, tagName, color);
+		}
+	}
 
-	if (query.exec()) {
-		result["success"] = true;
-		result["chat_id"] = chatId;
-		result["message_id"] = messageId;
-		result["tag"] = tagName;
-		result["color"] = color;
-	} else {
-		result["success"] = false;
-		result["error"] = "Failed to add tag: " + query.lastError().text();
+	result["success"] = true;
+	result["chat_id"] = chatId;
+	result["message_id"] = messageId;
+	if (tags.size() == 1) {
+		result["tag"] = tags.front();
 	}
+	result["tags"] = QJsonArray::fromStringList(tags);
+	result["color"] = color;
 
 	return result;
 }
@@ -6506,30 +9076,28 @@ QJsonObject Server::toolGetMessageTags(const QJsonObject &args) {
 	qint64 chatId = args.value("chat_id").toVariant().toLongLong();
 	qint64 messageId = args.value("message_id").toVariant().toLongLong();
 
-	QSqlQuery query(_db);
-	QString sql = "SELECT DISTINCT tag_name, color, COUNT(*) as usage_count "
-				  "FROM message_tags ";
-
-	QStringList conditions;
-	if (chatId > 0) conditions << "chat_id = ?";
-	if (messageId > 0) conditions << "message_id = ?";
-
-	if (!conditions.isEmpty()) {
-		sql += "WHERE " + conditions.join(" AND ") + " ";
-	}
-	sql += "GROUP BY tag_name, color ORDER BY usage_count DESC";
-
-	query.prepare(sql);
-	if (chatId > 0) query.addBindValue(chatId);
-	if (messageId > 0) query.addBindValue(messageId);
-
 	QJsonArray tags;
-	if (query.exec()) {
-		while (query.next()) {
+	if (messageId > 0) {
+		auto query = PreparedQuery(_db, "SELECT tag_name, color FROM message_tags "
+					  "WHERE chat_id = ? AND message_id = ? ORDER BY tag_name");
+		query->addBindValue(chatId);
+		query->addBindValue(messageId);
+		if (query->exec()) {
+			while (query->next()) {
+				QJsonObject tag;
+				tag["name"] = query->value(0).toString();
+				tag["color"] = query->value(1).toString();
+				tag["usage_count"] = 1;
+				tags.append(tag);
+			}
+		}
+	} else {
+		// Counts come from the tag index, no GROUP BY over the table.
+		for (const auto &usage : _tagIndex->usage(chatId)) {
 			QJsonObject tag;
-			tag["name"] = query.value(0).toString();
-			tag["color"] = query.value(1).toString();
-			tag["usage_count"] = query.value(2).toInt();
+			tag["name"] = usage.tag;
+			tag["color"] = usage.color;
+			tag["usage_count"] = usage.count;
 			tags.append(tag);
 		}
 	}
@@ -6543,25 +9111,61 @@ QJsonObject Server::toolGetMessageTags(const QJsonObject &args) {
 
 QJsonObject Server::toolRemoveMessageTag(const QJsonObject &args) {
 	QJsonObject result;
-	qint64 chatId = args["chat_id"].toVariant().toLongLong();
-	qint64 messageId = args["message_id"].toVariant().toLongLong();
+	qint64 chatId = args.value("chat_id").toVariant().toLongLong();
+	qint64 messageId = args.value("message_id").toVariant().toLongLong();
 	QString tagName = args["tag"].toString();
 
-	QSqlQuery query(_db);
-	query.prepare("DELETE FROM message_tags WHERE chat_id = ? AND message_id = ? AND tag_name = ?");
-	query.addBindValue(chatId);
-	query.addBindValue(messageId);
-	query.addBindValue(tagName);
+	if (tagName.isEmpty()) {
+		result["error"] = "Missing tag parameter";
+		result["success"] = false;
+		return result;
+	}
 
-	if (query.exec()) {
+	// Without a message the tag is deleted from every message.
+	const auto everywhere = (messageId == 0);
+	auto rows = PreparedQuery(_db, everywhere
+		? "SELECT id, chat_id FROM message_tags WHERE tag_name = ?"
+		: "SELECT id, chat_id FROM message_tags "
+		  "WHERE tag_name = ? AND chat_id = ? AND message_id = ?");
+	rows->addBindValue(tagName);
+	if (!everywhere) {
+		rows->addBindValue(chatId);
+		rows->addBindValue(messageId);
+	}
+	auto removed = std::vector<std::pair<qint64, qint64>>();
+	if (rows->exec()) {
+		while (rows->next()) {
+			removed.emplace_back(
+				rows->value(0).toLongLong(),
+				rows->value(1).toLongLong());
+		}
+	}
+	rows->finish();
+
+	auto query = PreparedQuery(_db, everywhere
+		? "DELETE FROM message_tags WHERE tag_name = ?"
+		: "DELETE FROM message_tags WHERE tag_name = ? AND chat_id = ? AND message_id = ?");
+	query->addBindValue(tagName);
+	if (!everywhere) {
+		query->addBindValue(chatId);
+		query->addBindValue(messageId);
+	}
+
+	if (query->exec()) {
+		for (const auto &[rowId, rowChatId] : removed) {
+			_tagIndex->removed(rowId, rowChatId, tagName);
+		}
 		result["success"] = true;
-		result["removed"] = query.numRowsAffected() > 0;
-		result["chat_id"] = chatId;
-		result["message_id"] = messageId;
+		result["removed"] = query->numRowsAffected() > 0;
+		result["removed_count"] = query->numRowsAffected();
+		if (!everywhere) {
+			result["chat_id"] = chatId;
+			result["message_id"] = messageId;
+		}
 		result["tag"] = tagName;
 	} else {
 		result["success"] = false;
-		result["error"] = "Failed to remove tag: " + query.lastError().text();
+		result["error"] = "Failed to remove tag: " + query->lastError().text();
 	}
 
 	return result;
@@ -6569,59 +9173,92 @@ QJsonObject Server::toolRemoveMessageTag(const QJsonObject &args) {
 
 QJsonObject Server::toolSearchByTag(const QJsonObject &args) {
 	QJsonObject result;
-	QString tagName = args["tag"].toString();
+	QStringList tags = TagsArgument(args);
+	qint64 chatId = args.value("chat_id").toVariant().toLongLong();
 	int limit = args.value("limit").toInt(50);
 
-	if (tagName.isEmpty()) {
+	if (tags.isEmpty()) {
 		result["error"] = "Missing tag parameter";
 		result["success"] = false;
 		return result;
 	}
 
-	QSqlQuery query(_db);
-	query.prepare("SELECT chat_id, message_id, created_at FROM message_tags "
-				  "WHERE tag_name = ? ORDER BY created_at DESC LIMIT ?");
-	query.addBindValue(tagName);
-	query.addBindValue(limit);
+	// Every tag is a bitmap of rowids, "a AND b" is their intersection.
+	// The newest rowids are read back by primary key.
+	const auto rows = _tagIndex->matching(tags, chatId);
+	const auto ids = rows.largest(std::max(limit, 0));
 
 	QJsonArray messages;
-	if (query.exec()) {
-		while (query.next()) {
-			QJsonObject msg;
-			msg["chat_id"] = query.value(0).toLongLong();
-			msg["message_id"] = query.value(1).toLongLong();
-			msg["tagged_at"] = query.value(2).toString();
-			messages.append(msg);
+	if (!ids.empty()) {
+		auto list = QStringList();
+		for (const auto id : ids) {
+			list.push_back(QString::number(id));
+		}
+		QSqlQuery query(_db);
+		const auto sql = QString("SELECT id, chat_id, message_id, created_at, tag_name FROM message_tags "
+			"WHERE id IN (%1) ORDER BY id DESC").arg(list.join(','));
+		auto found = QHash<QPair<qint64, qint64>, int>();
+		if (query.exec(sql)) {
+			while (query.next()) {
+				// Same message under several tags: one entry.
+				const auto key = qMakePair(
+					query.value(1).toLongLong(),
+					query.value(2).toLongLong());
+				if (found.contains(key)) {
+					continue;
+				}
+				found.insert(key, messages.size());
+				QJsonObject msg;
+				msg["chat_id"] = key.first;
+				msg["message_id"] = key.second;
+				msg["tagged_at"] = query.value(3).toString();
+				messages.append(msg);
+			}
 		}
 	}
 
 	result["success"] = true;
-	result["tag"] = tagName;
+	if (tags.size() == 1) {
+		result["tag"] = tags.front();
+	}
+	result["tags"] = QJsonArray::fromStringList(tags);
 	result["messages"] = messages;
 	result["count"] = messages.size();
+	result["total"] = rows.cardinality();
 
 	return result;
 }
 
 QJsonObject Server::toolGetTagSuggestions(const QJsonObject &args) {
 	QJsonObject result;
-	QString messageText = args.value("text").toString();
+	QString messageText = args.value("text").toString().toLower();
 	int limit = args.value("limit").toInt(5);
 
-	// Get most commonly used tags as suggestions
-	QSqlQuery query(_db);
-	query.prepare("SELECT tag_name, COUNT(*) as count FROM message_tags "
-				  "GROUP BY tag_name ORDER BY count DESC LIMIT ?");
-	query.addBindValue(limit);
+	// Most used tags, the ones named in the text first
+	auto usage = _tagIndex->usage();
+	auto mentioned = [&](const TagUsage &entry) {
+		auto name = entry.tag.toLower();
+		while (name.startsWith('#')) {
+			name.remove(0, 1);
+		}
+		return !messageText.isEmpty()
+			&& !name.isEmpty()
+			&& messageText.contains(name);
+	};
+	std::stable_partition(usage.begin(), usage.end(), mentioned);
 
 	QJsonArray suggestions;
-	if (query.exec()) {
-		while (query.next()) {
-			QJsonObject suggestion;
-			suggestion["tag"] = query.value(0).toString();
-			suggestion["usage_count"] = query.value(1).toInt();
-			suggestions.append(suggestion);
+	for (const auto &entry : usage) {
+		if (suggestions.size() >= limit) {
+			break;
 		}
+		QJsonObject suggestion;
+		suggestion["tag"] = entry.tag;
+		suggestion["usage_count"] = entry.count;
+		if (mentioned(entry)) {
+			suggestion["mentioned"] = true;
+		}
+		suggestions.append(suggestion);
 	}
 
 	result["success"] = true;
@@ -6637,14 +9274,13 @@ QJsonObject Server::toolConfigureAdFilter(const QJsonObject &args) {
 	QJsonArray keywords = args.value("keywords").toArray();
 	QJsonArray excludeChats = args.value("exclude_chats").toArray();
 
-	QSqlQuery query(_db);
-	query.prepare("INSERT OR REPLACE INTO ad_filter_config (id, enabled, keywords, exclude_chats, updated_at) "
+	auto query = PreparedQuery(_db, "INSERT OR REPLACE INTO ad_filter_config (id, enabled, keywords, exclude_chats, updated_at) "
 				  "VALUES (1, ?, ?, ?, datetime('now'))");
-	query.addBindValue(enabled);
-	query.addBindValue(QJsonDocument(keywords).toJson(QJsonDocument::Compact));
-	query.addBindValue(QJsonDocument(excludeChats).toJson(QJsonDocument::Compact));
+	query->addBindValue(enabled);
+	query->addBindValue(QJsonDocument(keywords).toJson(QJsonDocument::Compact));
+	query->addBindValue(QJsonDocument(excludeChats).toJson(QJsonDocument::Compact));
 
-	if (query.exec()) {
+	if (query->exec()) {
 		result["success"] = true;
 		result["enabled"] = enabled;
 		result["keywords_count"] = keywords.size();
@@ -6661,16 +9297,15 @@ QJsonObject Server::toolGetAdFilterStats(const QJsonObject &args) {
 	Q_UNUSED(args);
 	QJsonObject result;
 
-	QSqlQuery configQuery(_db);
-	configQuery.prepare("SELECT enabled, keywords, exclude_chats, ads_blocked, last_blocked_at "
+	auto configQuery = PreparedQuery(_db, "SELECT enabled, keywords, exclude_chats, ads_blocked, last_blocked_at "
 						"FROM ad_filter_config WHERE id = 1");
 
-	if (configQuery.exec() && configQuery.next()) {
-		result["enabled"] = configQuery.value(0).toBool();
-		result["keywords"] = QJsonDocument::fromJson(configQuery.value(1).toByteArray()).array();
-		result["exclude_chats"] = QJsonDocument::fromJson(configQuery.value(2).toByteArray()).array();
-		result["ads_blocked"] = configQuery.value(3).toInt();
-		result["last_blocked_at"] = configQuery.value(4).toString();
+	if (configQuery->exec() && configQuery->next()) {
+		result["enabled"] = configQuery->value(0).toBool();
+		result["keywords"] = QJsonDocument::fromJson(configQuery->value(1).toByteArray()).array();
+		result["exclude_chats"] = QJsonDocument::fromJson(configQuery->value(2).toByteArray()).array();
+		result["ads_blocked"] = configQuery->value(3).toInt();
+		result["last_blocked_at"] = configQuery->value(4).toString();
 		result["success"] = true;
 	} else {
 		result["enabled"] = false;
@@ -6697,23 +9332,23 @@ QJsonObject Server::toolSetChatRules(const QJsonObject &args) {
 		return result;
 	}
 
-	QSqlQuery query(_db);
-	query.prepare("INSERT OR REPLACE INTO chat_rules (chat_id, rule_name, rule_type, conditions, actions, enabled, created_at) "
+	auto query = PreparedQuery(_db, "INSERT OR REPLACE INTO chat_rules (chat_id, rule_name, rule_type, conditions, actions, enabled, created_at) "
 				  "VALUES (?, ?, ?, ?, ?, 1, datetime('now'))");
-	query.addBindValue(chatId);
-	query.addBindValue(ruleName);
-	query.addBindValue(ruleType);
-	query.addBindValue(QJsonDocument(conditions).toJson(QJsonDocument::Compact));
-	query.addBindValue(QJsonDocument(actions).toJson(QJsonDocument::Compact));
-
-	if (query.exec()) {
+	query->addBindValue(chatId);
+	query->addBindValue(ruleName);
+	query->addBindValue(ruleType);
+	query->addBindValue(QJsonDocument(conditions).toJson(QJsonDocument::Compact));
+	query->addBindValue(QJsonDocument(actions).toJson(QJsonDocument::Compact));
+
+	if (query->exec()) {
+		_chatRules->invalidate();
 		result["success"] = true;
 		result["chat_id"] = chatId;
 		result["rule_name"] = ruleName;
 		result["rule_type"] = ruleType;
 	} else {
 		result["success"] = false;
-		result["error"] = "Failed to save chat rule: " + query.lastError().text();
+		result["error"] = "Failed to save chat rule: " + query->lastError().text();
 	}
 
 	return result;
@@ -6723,7 +9358,6 @@ QJsonObject Server::toolGetChatRules(const QJsonObject &args) {
 	QJsonObject result;
 	qint64 chatId = args.value("chat_id").toVariant().toLongLong();
 
-	QSqlQuery query(_db);
 	QString sql = "SELECT rule_name, rule_type, conditions, actions, enabled, created_at "
 				  "FROM chat_rules ";
 	if (chatId > 0) {
@@ -6731,21 +9365,21 @@ QJsonObject Server::toolGetChatRules(const QJsonObject &args) {
 	}
 	sql += "ORDER BY created_at DESC";
 
-	query.prepare(sql);
+	auto query = PreparedQuery(_db, sql);
 	if (chatId > 0) {
-		query.addBindValue(chatId);
+		query->addBindValue(chatId);
 	}
 
 	QJsonArray rules;
-	if (query.exec()) {
-		while (query.next()) {
+	if (query->exec()) {
+		while (query->next()) {
 			QJsonObject rule;
-			rule["rule_name"] = query.value(0).toString();
-			rule["rule_type"] = query.value(1).toString();
-			rule["conditions"] = QJsonDocument::fromJson(query.value(2).toByteArray()).object();
-			rule["actions"] = QJsonDocument::fromJson(query.value(3).toByteArray()).object();
-			rule["enabled"] = query.value(4).toBool();
-			rule["created_at"] = query.value(5).toString();
+			rule["rule_name"] = query->value(0).toString();
+			rule["rule_type"] = query->value(1).toString();
+			rule["conditions"] = QJsonDocument::fromJson(query->value(2).toByteArray()).object();
+			rule["actions"] = QJsonDocument::fromJson(query->value(3).toByteArray()).object();
+			rule["enabled"] = query->value(4).toBool();
+			rule["created_at"] = query->value(5).toString();
 			rules.append(rule);
 		}
 	}
@@ -6768,40 +9402,13 @@ QJsonObject Server::toolTestChatRules(const QJsonObject &args) {
 		return result;
 	}
 
-	// Get rules for this chat
-	QSqlQuery query(_db);
-	query.prepare("SELECT rule_name, rule_type, conditions, actions FROM chat_rules "
-				  "WHERE (chat_id = ? OR chat_id = 0) AND enabled = 1");
-	query.addBindValue(chatId);
-
 	QJsonArray matchedRules;
-	if (query.exec()) {
-		while (query.next()) {
-			QString ruleName = query.value(0).toString();
-			QString ruleType = query.value(1).toString();
-			QJsonObject conditions = QJsonDocument::fromJson(query.value(2).toByteArray()).object();
-			QJsonObject actions = QJsonDocument::fromJson(query.value(3).toByteArray()).object();
-
-			// Simple keyword matching for testing
-			bool matches = false;
-			if (conditions.contains("keywords")) {
-				QJsonArray keywords = conditions["keywords"].toArray();
-				for (const auto &kw : keywords) {
-					if (testMessage.contains(kw.toString(), Qt::CaseInsensitive)) {
-						matches = true;
-						break;
-					}
-				}
-			}
-
-			if (matches) {
-				QJsonObject matched;
-				matched["rule_name"] = ruleName;
-				matched["rule_type"] = ruleType;
-				matched["actions"] = actions;
-				matchedRules.append(matched);
-			}
-		}
+	for (const auto rule : _chatRules->evaluate(chatId, testMessage)) {
+		QJsonObject matched;
+		matched["rule_name"] = rule->name;
+		matched["rule_type"] = rule->type;
+		matched["actions"] = rule->actions;
+		matchedRules.append(matched);
 	}
 
 	result["success"] = true;
@@ -6822,8 +9429,8 @@ QJsonObject Server::toolCreateTaskFromMessage(const QJsonObject &args) {
 	int priority = args.value("priority").toInt(2);  // 1=high, 2=medium, 3=low
 
 	// Get message text if title not provided
-	if (title.isEmpty() && _session) {
-		auto &owner = _session->data();
+	if (title.isEmpty() && callSession()) {
+		auto &owner = callSession()->data();
 		auto item = owner.message(PeerId(chatId), MsgId(messageId));
 		if (item) {
 			title = item->originalText().text.left(100);
@@ -6836,18 +9443,17 @@ QJsonObject Server::toolCreateTaskFromMessage(const QJsonObject &args) {
 		return result;
 	}
 
-	QSqlQuery query(_db);
-	query.prepare("INSERT INTO tasks (chat_id, message_id, title, status, priority, due_date, created_at) "
+	auto query = PreparedQuery(_db, "INSERT INTO tasks (chat_id, message_id, title, status, priority, due_date, created_at) "
 				  "VALUES (?, ?, ?, 'pending', ?, ?, datetime('now'))");
-	query.addBindValue(chatId);
-	query.addBindValue(messageId);
-	query.addBindValue(title);
-	query.addBindValue(priority);
-	query.addBindValue(dueDate.isEmpty() ? QVariant() : dueDate);
+	query->addBindValue(chatId);
+	query->addBindValue(messageId);
+	query->addBindValue(title);
+	query->addBindValue(priority);
+	query->addBindValue(dueDate.isEmpty() ? QVariant() : dueDate);
 
-	if (query.exec()) {
+	if (query->exec()) {
 		result["success"] = true;
-		result["task_id"] = query.lastInsertId().toLongLong();
+		result["task_id"] = query->lastInsertId().toLongLong();
 		result["title"] = title;
 		result["status"] = "pending";
 		result["priority"] = priority;
@@ -6856,7 +9462,7 @@ QJsonObject Server::toolCreateTaskFromMessage(const QJsonObject &args) {
 		}
 	} else {
 		result["success"] = false;
-		result["error"] = "Failed to create task: " + query.lastError().text();
+		result["error"] = "Failed to create task: " + query->lastError().text();
 	}
 
 	return result;
@@ -6867,7 +9473,6 @@ QJsonObject Server::toolListTasks(const QJsonObject &args) {
 	QString status = args.value("status").toString();
 	int limit = args.value("limit").toInt(50);
 
-	QSqlQuery query(_db);
 	QString sql = "SELECT id, chat_id, message_id, title, status, priority, due_date, created_at, completed_at "
 				  "FROM tasks ";
 	if (!status.isEmpty()) {
@@ -6875,28 +9480,28 @@ QJsonObject Server::toolListTasks(const QJsonObject &args) {
 	}
 	sql += "ORDER BY priority ASC, due_date ASC NULLS LAST LIMIT ?";
 
-	query.prepare(sql);
+	auto query = PreparedQuery(_db, sql);
 	if (!status.isEmpty()) {
-		query.addBindValue(status);
+		query->addBindValue(status);
 	}
-	query.addBindValue(limit);
+	query->addBindValue(limit);
 
 	QJsonArray tasks;
-	if (query.exec()) {
-		while (query.next()) {
+	if (query->exec()) {
+		while (query->next()) {
 			QJsonObject task;
-			task["id"] = query.value(0).toLongLong();
-			task["chat_id"] = query.value(1).toLongLong();
-			task["message_id"] = query.value(2).toLongLong();
-			task["title"] = query.value(3).toString();
-			task["status"] = query.value(4).toString();
-			task["priority"] = query.value(5).toInt();
-			if (!query.value(6).isNull()) {
-				task["due_date"] = query.value(6).toString();
-			}
-			task["created_at"] = query.value(7).toString();
-			if (!query.value(8).isNull()) {
-				task["completed_at"] = query.value(8).toString();
+			task["id"] = query->value(0).toLongLong();
+			task["chat_id"] = query->value(1).toLongLong();
+			task["message_id"] = query->value(2).toLongLong();
+			task["title"] = query->value(3).toString();
+			task["status"] = query->value(4).toString();
+			task["priority"] = query->value(5).toInt();
+			if (!query->value(6).isNull()) {
+				task["due_date"] = query->value(6).toString();
+			}
+			task["created_at"] = query->value(7).toString();
+			if (!query->value(8).isNull()) {
+				task["completed_at"] = query->value(8).toString();
 			}
 			tasks.append(task);
 		}
@@ -6941,14 +9546,13 @@ QJsonObject Server::toolUpdateTask(const QJsonObject &args) {
 		return result;
 	}
 
-	QSqlQuery query(_db);
-	query.prepare("UPDATE tasks SET " + updates.join(", ") + " WHERE id = ?");
+	auto query = PreparedQuery(_db, "UPDATE tasks SET " + updates.join(", ") + " WHERE id = ?");
 	for (const auto &val : values) {
-		query.addBindValue(val);
+		query->addBindValue(val);
 	}
-	query.addBindValue(taskId);
+	query->addBindValue(taskId);
 
-	if (query.exec() && query.numRowsAffected() > 0) {
+	if (query->exec() && query->numRowsAffected() > 0) {
 		result["success"] = true;
 		result["task_id"] = taskId;
 		result["updated"] = true;
@@ -6975,22 +9579,21 @@ QJsonObject Server::toolCreateQuickReply(const QJsonObject &args) {
 		return result;
 	}
 
-	QSqlQuery query(_db);
-	query.prepare("INSERT INTO quick_replies (shortcut, text, category, usage_count, created_at) "
+	auto query = PreparedQuery(_db, "INSERT INTO quick_replies (shortcut, text, category, usage_count, created_at) "
 				  "VALUES (?, ?, ?, 0, datetime('now'))");
-	query.addBindValue(shortcut);
-	query.addBindValue(text);
-	query.addBindValue(category);
+	query->addBindValue(shortcut);
+	query->addBindValue(text);
+	query->addBindValue(category);
 
-	if (query.exec()) {
+	if (query->exec()) {
 		result["success"] = true;
-		result["id"] = query.lastInsertId().toLongLong();
+		result["id"] = query->lastInsertId().toLongLong();
 		result["shortcut"] = shortcut;
 		result["text"] = text;
 		result["category"] = category;
 	} else {
 		result["success"] = false;
-		result["error"] = "Failed to create quick reply: " + query.lastError().text();
+		result["error"] = "Failed to create quick reply: " + query->lastError().text();
 	}
 
 	return result;
@@ -7001,29 +9604,28 @@ QJsonObject Server::toolListQuickReplies(const QJsonObject &args) {
 	QString category = args.value("category").toString();
 	int limit = args.value("limit").toInt(50);
 
-	QSqlQuery query(_db);
 	QString sql = "SELECT id, shortcut, text, category, usage_count, created_at FROM quick_replies ";
 	if (!category.isEmpty()) {
 		sql += "WHERE category = ? ";
 	}
 	sql += "ORDER BY usage_count DESC LIMIT ?";
 
-	query.prepare(sql);
+	auto query = PreparedQuery(_db, sql);
 	if (!category.isEmpty()) {
-		query.addBindValue(category);
+		query->addBindValue(category);
 	}
-	query.addBindValue(limit);
+	query->addBindValue(limit);
 
 	QJsonArray replies;
-	if (query.exec()) {
-		while (query.next()) {
+	if (query->exec()) {
+		while (query->next()) {
 			QJsonObject reply;
-			reply["id"] = query.value(0).toLongLong();
-			reply["shortcut"] = query.value(1).toString();
-			reply["text"] = query.value(2).toString();
-			reply["category"] = query.value(3).toString();
-			reply["usage_count"] = query.value(4).toInt();
-			reply["created_at"] = query.value(5).toString();
+			reply["id"] = query->value(0).toLongLong();
+			reply["shortcut"] = query->value(1).toString();
+			reply["text"] = query->value(2).toString();
+			reply["category"] = query->value(3).toString();
+			reply["usage_count"] = query->value(4).toInt();
+			reply["created_at"] = query->value(5).toString();
 			replies.append(reply);
 		}
 	}
@@ -7055,14 +9657,13 @@ QJsonObject Server::toolUpdateQuickReply(const QJsonObject &args) {
 		return result;
 	}
 
-	QSqlQuery query(_db);
-	query.prepare("UPDATE quick_replies SET " + updates.join(", ") + " WHERE id = ?");
+	auto query = PreparedQuery(_db, "UPDATE quick_replies SET " + updates.join(", ") + " WHERE id = ?");
 	for (const auto &val : values) {
-		query.addBindValue(val);
+		query->addBindValue(val);
 	}
-	query.addBindValue(id);
+	query->addBindValue(id);
 
-	if (query.exec() && query.numRowsAffected() > 0) {
+	if (query->exec() && query->numRowsAffected() > 0) {
 		result["success"] = true;
 		result["id"] = id;
 	} else {
@@ -7077,11 +9678,10 @@ QJsonObject Server::toolDeleteQuickReply(const QJsonObject &args) {
 	QJsonObject result;
 	qint64 id = args["id"].toVariant().toLongLong();
 
-	QSqlQuery query(_db);
-	query.prepare("DELETE FROM quick_replies WHERE id = ?");
-	query.addBindValue(id);
+	auto query = PreparedQuery(_db, "DELETE FROM quick_replies WHERE id = ?");
+	query->addBindValue(id);
 
-	if (query.exec() && query.numRowsAffected() > 0) {
+	if (query->exec() && query->numRowsAffected() > 0) {
 		result["success"] = true;
 		result["deleted"] = true;
 	} else {
@@ -7104,27 +9704,25 @@ QJsonObject Server::toolUseQuickReply(const QJsonObject &args) {
 	}
 
 	// Get quick reply text
-	QSqlQuery query(_db);
-	query.prepare("SELECT id, text FROM quick_replies WHERE shortcut = ?");
-	query.addBindValue(shortcut);
+	auto query = PreparedQuery(_db, "SELECT id, text FROM quick_replies WHERE shortcut = ?");
+	query->addBindValue(shortcut);
 
-	if (!query.exec() || !query.next()) {
+	if (!query->exec() || !query->next()) {
 		result["error"] = "Quick reply not found: " + shortcut;
 		result["success"] = false;
 		return result;
 	}
 
-	qint64 replyId = query.value(0).toLongLong();
-	QString text = query.value(1).toString();
+	qint64 replyId = query->value(0).toLongLong();
+	QString text = query->value(1).toString();
 
 	// Increment usage count
-	QSqlQuery updateQuery(_db);
-	updateQuery.prepare("UPDATE quick_replies SET usage_count = usage_count + 1 WHERE id = ?");
-	updateQuery.addBindValue(replyId);
-	updateQuery.exec();
+	auto updateQuery = PreparedQuery(_db, "UPDATE quick_replies SET usage_count = usage_count + 1 WHERE id = ?");
+	updateQuery->addBindValue(replyId);
+	updateQuery->exec();
 
 	// Send the message if chat_id provided
-	if (chatId > 0 && _session) {
+	if (chatId > 0 && callSession()) {
 		QJsonObject sendArgs;
 		sendArgs["chat_id"] = chatId;
 		sendArgs["text"] = text;
@@ -7157,15 +9755,14 @@ QJsonObject Server::toolSetGreetingMessage(const QJsonObject &args) {
 		return result;
 	}
 
-	QSqlQuery query(_db);
-	query.prepare("INSERT OR REPLACE INTO greeting_config (id, enabled, message, trigger_chats, delay_seconds, updated_at) "
+	auto query = PreparedQuery(_db, "INSERT OR REPLACE INTO greeting_config (id, enabled, message, trigger_chats, delay_seconds, updated_at) "
 				  "VALUES (1, ?, ?, ?, ?, datetime('now'))");
-	query.addBindValue(enabled);
-	query.addBindValue(message);
-	query.addBindValue(QJsonDocument(triggerChats).toJson(QJsonDocument::Compact));
-	query.addBindValue(delaySeconds);
+	query->addBindValue(enabled);
+	query->addBindValue(message);
+	query->addBindValue(QJsonDocument(triggerChats).toJson(QJsonDocument::Compact));
+	query->addBindValue(delaySeconds);
 
-	if (query.exec()) {
+	if (query->exec()) {
 		result["success"] = true;
 		result["enabled"] = enabled;
 		result["message"] = message;
@@ -7182,17 +9779,16 @@ QJsonObject Server::toolGetGreetingMessage(const QJsonObject &args) {
 	Q_UNUSED(args);
 	QJsonObject result;
 
-	QSqlQuery query(_db);
-	query.prepare("SELECT enabled, message, trigger_chats, delay_seconds, greetings_sent, updated_at "
+	auto query = PreparedQuery(_db, "SELECT enabled, message, trigger_chats, delay_seconds, greetings_sent, updated_at "
 				  "FROM greeting_config WHERE id = 1");
 
-	if (query.exec() && query.next()) {
-		result["enabled"] = query.value(0).toBool();
-		result["message"] = query.value(1).toString();
-		result["trigger_chats"] = QJsonDocument::fromJson(query.value(2).toByteArray()).array();
-		result["delay_seconds"] = query.value(3).toInt();
-		result["greetings_sent"] = query.value(4).toInt();
-		result["updated_at"] = query.value(5).toString();
+	if (query->exec() && query->next()) {
+		result["enabled"] = query->value(0).toBool();
+		result["message"] = query->value(1).toString();
+		result["trigger_chats"] = QJsonDocument::fromJson(query->value(2).toByteArray()).array();
+		result["delay_seconds"] = query->value(3).toInt();
+		result["greetings_sent"] = query->value(4).toInt();
+		result["updated_at"] = query->value(5).toString();
 		result["success"] = true;
 	} else {
 		result["enabled"] = false;
@@ -7207,10 +9803,9 @@ QJsonObject Server::toolDisableGreeting(const QJsonObject &args) {
 	Q_UNUSED(args);
 	QJsonObject result;
 
-	QSqlQuery query(_db);
-	query.prepare("UPDATE greeting_config SET enabled = 0 WHERE id = 1");
+	auto query = PreparedQuery(_db, "UPDATE greeting_config SET enabled = 0 WHERE id = 1");
 
-	if (query.exec()) {
+	if (query->exec()) {
 		result["success"] = true;
 		result["disabled"] = true;
 	} else {
@@ -7226,16 +9821,15 @@ QJsonObject Server::toolTestGreeting(const QJsonObject &args) {
 	qint64 chatId = args["chat_id"].toVariant().toLongLong();
 
 	// Get greeting config
-	QSqlQuery query(_db);
-	query.prepare("SELECT message FROM greeting_config WHERE id = 1 AND enabled = 1");
+	auto query = PreparedQuery(_db, "SELECT message FROM greeting_config WHERE id = 1 AND enabled = 1");
 
-	if (!query.exec() || !query.next()) {
+	if (!query->exec() || !query->next()) {
 		result["success"] = false;
 		result["error"] = "No active greeting message configured";
 		return result;
 	}
 
-	QString message = query.value(0).toString();
+	QString message = query->value(0).toString();
 
 	result["success"] = true;
 	result["message"] = message;
@@ -7259,15 +9853,14 @@ QJsonObject Server::toolSetAwayMessage(const QJsonObject &args) {
 		return result;
 	}
 
-	QSqlQuery query(_db);
-	query.prepare("INSERT OR REPLACE INTO away_config (id, enabled, message, start_time, end_time, updated_at) "
+	auto query = PreparedQuery(_db, "INSERT OR REPLACE INTO away_config (id, enabled, message, start_time, end_time, updated_at) "
 				  "VALUES (1, ?, ?, ?, ?, datetime('now'))");
-	query.addBindValue(enabled);
-	query.addBindValue(message);
-	query.addBindValue(startTime.isEmpty() ? QVariant() : startTime);
-	query.addBindValue(endTime.isEmpty() ? QVariant() : endTime);
+	query->addBindValue(enabled);
+	query->addBindValue(message);
+	query->addBindValue(startTime.isEmpty() ? QVariant() : startTime);
+	query->addBindValue(endTime.isEmpty() ? QVariant() : endTime);
 
-	if (query.exec()) {
+	if (query->exec()) {
 		result["success"] = true;
 		result["enabled"] = enabled;
 		result["message"] = message;
@@ -7283,17 +9876,16 @@ QJsonObject Server::toolGetAwayMessage(const QJsonObject &args) {
 	Q_UNUSED(args);
 	QJsonObject result;
 
-	QSqlQuery query(_db);
-	query.prepare("SELECT enabled, message, start_time, end_time, away_sent, updated_at "
+	auto query = PreparedQuery(_db, "SELECT enabled, message, start_time, end_time, away_sent, updated_at "
 				  "FROM away_config WHERE id = 1");
 
-	if (query.exec() && query.next()) {
-		result["enabled"] = query.value(0).toBool();
-		result["message"] = query.value(1).toString();
-		if (!query.value(2).isNull()) result["start_time"] = query.value(2).toString();
-		if (!query.value(3).isNull()) result["end_time"] = query.value(3).toString();
-		result["away_sent"] = query.value(4).toInt();
-		result["updated_at"] = query.value(5).toString();
+	if (query->exec() && query->next()) {
+		result["enabled"] = query->value(0).toBool();
+		result["message"] = query->value(1).toString();
+		if (!query->value(2).isNull()) result["start_time"] = query->value(2).toString();
+		if (!query->value(3).isNull()) result["end_time"] = query->value(3).toString();
+		result["away_sent"] = query->value(4).toInt();
+		result["updated_at"] = query->value(5).toString();
 		result["success"] = true;
 	} else {
 		result["enabled"] = false;
@@ -7308,10 +9900,9 @@ QJsonObject Server::toolDisableAway(const QJsonObject &args) {
 	Q_UNUSED(args);
 	QJsonObject result;
 
-	QSqlQuery query(_db);
-	query.prepare("UPDATE away_config SET enabled = 0 WHERE id = 1");
+	auto query = PreparedQuery(_db, "UPDATE away_config SET enabled = 0 WHERE id = 1");
 
-	if (query.exec()) {
+	if (query->exec()) {
 		result["success"] = true;
 		result["disabled"] = true;
 	} else {
@@ -7326,17 +9917,16 @@ QJsonObject Server::toolTestAway(const QJsonObject &args) {
 	QJsonObject result;
 	qint64 chatId = args["chat_id"].toVariant().toLongLong();
 
-	QSqlQuery query(_db);
-	query.prepare("SELECT message, start_time, end_time FROM away_config WHERE id = 1 AND enabled = 1");
+	auto query = PreparedQuery(_db, "SELECT message, start_time, end_time FROM away_config WHERE id = 1 AND enabled = 1");
 
-	if (!query.exec() || !query.next()) {
+	if (!query->exec() || !query->next()) {
 		result["success"] = false;
 		result["error"] = "No active away message configured";
 		return result;
 	}
 
 	result["success"] = true;
-	result["message"] = query.value(0).toString();
+	result["message"] = query->value(0).toString();
 	result["would_send_to"] = chatId;
 	result["note"] = "Test mode - message not actually sent";
 
@@ -7355,13 +9945,12 @@ QJsonObject Server::toolSetBusinessHours(const QJsonObject &args) {
 		return result;
 	}
 
-	QSqlQuery query(_db);
-	query.prepare("INSERT OR REPLACE INTO business_hours (id, enabled, schedule, timezone, updated_at) "
+	auto query = PreparedQuery(_db, "INSERT OR REPLACE INTO business_hours (id, enabled, schedule, timezone, updated_at) "
 				  "VALUES (1, 1, ?, ?, datetime('now'))");
-	query.addBindValue(QJsonDocument(schedule).toJson(QJsonDocument::Compact));
-	query.addBindValue(timezone);
+	query->addBindValue(QJsonDocument(schedule).toJson(QJsonDocument::Compact));
+	query->addBindValue(timezone);
 
-	if (query.exec()) {
+	if (query->exec()) {
 		result["success"] = true;
 		result["schedule"] = schedule;
 		result["timezone"] = timezone;
@@ -7377,14 +9966,13 @@ QJsonObject Server::toolGetBusinessHours(const QJsonObject &args) {
 	Q_UNUSED(args);
 	QJsonObject result;
 
-	QSqlQuery query(_db);
-	query.prepare("SELECT enabled, schedule, timezone, updated_at FROM business_hours WHERE id = 1");
+	auto query = PreparedQuery(_db, "SELECT enabled, schedule, timezone, updated_at FROM business_hours WHERE id = 1");
 
-	if (query.exec() && query.next()) {
-		result["enabled"] = query.value(0).toBool();
-		result["schedule"] = QJsonDocument::fromJson(query.value(1).toByteArray()).object();
-		result["timezone"] = query.value(2).toString();
-		result["updated_at"] = query.value(3).toString();
+	if (query->exec() && query->next()) {
+		result["enabled"] = query->value(0).toBool();
+		result["schedule"] = QJsonDocument::fromJson(query->value(1).toByteArray()).object();
+		result["timezone"] = query->value(2).toString();
+		result["updated_at"] = query->value(3).toString();
 		result["success"] = true;
 	} else {
 		result["success"] = true;
@@ -7398,17 +9986,16 @@ QJsonObject Server::toolCheckBusinessStatus(const QJsonObject &args) {
 	Q_UNUSED(args);
 	QJsonObject result;
 
-	QSqlQuery query(_db);
-	query.prepare("SELECT enabled, schedule, timezone FROM business_hours WHERE id = 1");
+	auto query = PreparedQuery(_db, "SELECT enabled, schedule, timezone FROM business_hours WHERE id = 1");
 
-	if (!query.exec() || !query.next()) {
+	if (!query->exec() || !query->next()) {
 		result["is_open"] = true;  // Default to open if not configured
 		result["success"] = true;
 		result["note"] = "No business hours configured - defaulting to open";
 		return result;
 	}
 
-	bool enabled = query.value(0).toBool();
+	bool enabled = query->value(0).toBool();
 	if (!enabled) {
 		result["is_open"] = true;
 		result["success"] = true;
@@ -7416,8 +10003,8 @@ QJsonObject Server::toolCheckBusinessStatus(const QJsonObject &args) {
 		return result;
 	}
 
-	QJsonObject schedule = QJsonDocument::fromJson(query.value(1).toByteArray()).object();
-	QString timezone = query.value(2).toString();
+	QJsonObject schedule = QJsonDocument::fromJson(query->value(1).toByteArray()).object();
+	QString timezone = query->value(2).toString();
 
 	// Get current day and time
 	QDateTime now = QDateTime::currentDateTimeUtc();
@@ -7469,15 +10056,14 @@ QJsonObject Server::toolConfigureChatbot(const QJsonObject &args) {
 		return result;
 	}
 
-	QSqlQuery query(_db);
-	query.prepare("INSERT OR REPLACE INTO chatbot_config (id, enabled, name, personality, trigger_keywords, response_style, updated_at) "
+	auto query = PreparedQuery(_db, "INSERT OR REPLACE INTO chatbot_config (id, enabled, name, personality, trigger_keywords, response_style, updated_at) "
 				  "VALUES (1, 1, ?, ?, ?, ?, datetime('now'))");
-	query.addBindValue(name);
-	query.addBindValue(personality);
-	query.addBindValue(QJsonDocument(triggerKeywords).toJson(QJsonDocument::Compact));
-	query.addBindValue(responseStyle);
+	query->addBindValue(name);
+	query->addBindValue(personality);
+	query->addBindValue(QJsonDocument(triggerKeywords).toJson(QJsonDocument::Compact));
+	query->addBindValue(responseStyle);
 
-	if (query.exec()) {
+	if (query->exec()) {
 		result["success"] = true;
 		result["name"] = name;
 		result["personality"] = personality;
@@ -7494,17 +10080,16 @@ QJsonObject Server::toolGetChatbotConfig(const QJsonObject &args) {
 	Q_UNUSED(args);
 	QJsonObject result;
 
-	QSqlQuery query(_db);
-	query.prepare("SELECT enabled, name, personality, trigger_keywords, response_style, messages_handled "
+	auto query = PreparedQuery(_db, "SELECT enabled, name, personality, trigger_keywords, response_style, messages_handled "
 				  "FROM chatbot_config WHERE id = 1");
 
-	if (query.exec() && query.next()) {
-		result["enabled"] = query.value(0).toBool();
-		result["name"] = query.value(1).toString();
-		result["personality"] = query.value(2).toString();
-		result["trigger_keywords"] = QJsonDocument::fromJson(query.value(3).toByteArray()).array();
-		result["response_style"] = query.value(4).toString();
-		result["messages_handled"] = query.value(5).toInt();
+	if (query->exec() && query->next()) {
+		result["enabled"] = query->value(0).toBool();
+		result["name"] = query->value(1).toString();
+		result["personality"] = query->value(2).toString();
+		result["trigger_keywords"] = QJsonDocument::fromJson(query->value(3).toByteArray()).array();
+		result["response_style"] = query->value(4).toString();
+		result["messages_handled"] = query->value(5).toInt();
 		result["success"] = true;
 	} else {
 		result["success"] = true;
@@ -7555,17 +10140,16 @@ QJsonObject Server::toolTestChatbot(const QJsonObject &args) {
 	}
 
 	// Get chatbot config
-	QSqlQuery query(_db);
-	query.prepare("SELECT personality, response_style FROM chatbot_config WHERE id = 1 AND enabled = 1");
+	auto query = PreparedQuery(_db, "SELECT personality, response_style FROM chatbot_config WHERE id = 1 AND enabled = 1");
 
-	if (!query.exec() || !query.next()) {
+	if (!query->exec() || !query->next()) {
 		result["error"] = "No active chatbot configured";
 		result["success"] = false;
 		return result;
 	}
 
-	QString personality = query.value(0).toString();
-	QString responseStyle = query.value(1).toString();
+	QString personality = query->value(0).toString();
+	QString responseStyle = query->value(1).toString();
 
 	// Simple echo response for testing
 	result["success"] = true;
@@ -7582,11 +10166,10 @@ QJsonObject Server::toolGetChatbotAnalytics(const QJsonObject &args) {
 	Q_UNUSED(args);
 	QJsonObject result;
 
-	QSqlQuery query(_db);
-	query.prepare("SELECT messages_handled FROM chatbot_config WHERE id = 1");
+	auto query = PreparedQuery(_db, "SELECT messages_handled FROM chatbot_config WHERE id = 1");
 
-	if (query.exec() && query.next()) {
-		result["messages_handled"] = query.value(0).toInt();
+	if (query->exec() && query->next()) {
+		result["messages_handled"] = query->value(0).toInt();
 		result["success"] = true;
 	} else {
 		result["messages_handled"] = 0;
@@ -7597,28 +10180,55 @@ QJsonObject Server::toolGetChatbotAnalytics(const QJsonObject &args) {
 }
 
 // Text to Speech Tools
-QJsonObject Server::toolTextToSpeech(const QJsonObject &args) {
+QJsonObject Server::renderVoice(
+		const QString &persona,
+		const QString &text,
+		const QJsonObject &args) {
 	QJsonObject result;
-	QString text = args["text"].toString();
-	QString voice = args.value("voice").toString("default");
-	double speed = args.value("speed").toDouble(1.0);
-
-	if (text.isEmpty()) {
+	if (text.trimmed().isEmpty()) {
 		result["error"] = "Missing text parameter";
 		result["success"] = false;
 		return result;
 	}
+	auto settings = _voiceSynthesis->persona(persona);
+	if (args.contains("speed")) {
+		settings.speed = std::clamp(args["speed"].toDouble(1.0), 0.25, 4.0);
+	}
 
-	result["success"] = true;
+	// Rendering goes on after the response, the voice lands in tts_cache.
+	const auto rendered = std::make_shared<QJsonObject>();
+	const auto cached = _voiceSynthesis->render(settings, text, [=](
+			const EncodedVoice *voice,
+			const QString &error) {
+		if (voice) {
+			(*rendered)["duration_ms"] = qint64(voice->duration);
+			(*rendered)["size"] = int(voice->bytes.size());
+		} else {
+			(*rendered)["error"] = error;
+		}
+	});
+	result = *rendered;
+	result["success"] = !rendered->contains("error");
+	result["persona"] = settings.name;
+	result["voice"] = settings.voiceId;
+	result["speed"] = settings.speed;
 	result["text"] = text;
-	result["voice"] = voice;
-	result["speed"] = speed;
-	result["status"] = "tts_service_required";
-	result["note"] = "External TTS API integration required for audio generation";
-
+	result["status"] = cached
+		? "cached"
+		: rendered->isEmpty()
+		? "rendering"
+		: "failed";
+	result["engine"] = _voiceSynthesis->stats();
 	return result;
 }
 
+QJsonObject Server::toolTextToSpeech(const QJsonObject &args) {
+	return renderVoice(
+		args.value("voice").toString("default"),
+		args["text"].toString(),
+		args);
+}
+
 QJsonObject Server::toolConfigureVoicePersona(const QJsonObject &args) {
 	QJsonObject result;
 	QString name = args["name"].toString();
@@ -7632,15 +10242,14 @@ QJsonObject Server::toolConfigureVoicePersona(const QJsonObject &args) {
 		return result;
 	}
 
-	QSqlQuery query(_db);
-	query.prepare("INSERT OR REPLACE INTO voice_persona (name, voice_id, pitch, speed, created_at) "
+	auto query = PreparedQuery(_db, "INSERT OR REPLACE INTO voice_persona (name, voice_id, pitch, speed, created_at) "
 				  "VALUES (?, ?, ?, ?, datetime('now'))");
-	query.addBindValue(name);
-	query.addBindValue(voiceId);
-	query.addBindValue(pitch);
-	query.addBindValue(speed);
+	query->addBindValue(name);
+	query->addBindValue(voiceId);
+	query->addBindValue(pitch);
+	query->addBindValue(speed);
 
-	if (query.exec()) {
+	if (query->exec()) {
 		result["success"] = true;
 		result["name"] = name;
 		result["voice_id"] = voiceId;
@@ -7658,18 +10267,17 @@ QJsonObject Server::toolListVoicePersonas(const QJsonObject &args) {
 	Q_UNUSED(args);
 	QJsonObject result;
 
-	QSqlQuery query(_db);
-	query.prepare("SELECT name, voice_id, pitch, speed, created_at FROM voice_persona");
+	auto query = PreparedQuery(_db, "SELECT name, voice_id, pitch, speed, created_at FROM voice_persona");
 
 	QJsonArray personas;
-	if (query.exec()) {
-		while (query.next()) {
+	if (query->exec()) {
+		while (query->next()) {
 			QJsonObject persona;
-			persona["name"] = query.value(0).toString();
-			persona["voice_id"] = query.value(1).toString();
-			persona["pitch"] = query.value(2).toDouble();
-			persona["speed"] = query.value(3).toDouble();
-			persona["created_at"] = query.value(4).toString();
+			persona["name"] = query->value(0).toString();
+			persona["voice_id"] = query->value(1).toString();
+			persona["pitch"] = query->value(2).toDouble();
+			persona["speed"] = query->value(3).toDouble();
+			persona["created_at"] = query->value(4).toString();
 			personas.append(persona);
 		}
 	}
@@ -7687,13 +10295,62 @@ QJsonObject Server::toolSendVoiceReply(const QJsonObject &args) {
 	QString text = args["text"].toString();
 	QString persona = args.value("persona").toString("default");
 
-	result["success"] = true;
+	if (!callSession()) {
+		result["success"] = false;
+		result["error"] = "Session not available";
+		return result;
+	} else if (text.trimmed().isEmpty()) {
+		result["success"] = false;
+		result["error"] = "Missing text parameter";
+		return result;
+	}
+	if (!callSession()->data().historyLoaded(PeerId(chatId))) {
+		result["success"] = false;
+		result["error"] = "Chat not found";
+		return result;
+	}
+
+	// Sent as a recorded voice message, right away for a cached text.
+	auto failure = std::make_shared<QString>();
+	auto sent = std::make_shared<bool>(false);
+	const auto weak = base::make_weak(callSession());
+	const auto cached = _voiceSynthesis->render(
+		_voiceSynthesis->persona(persona),
+		text,
+		[=](const EncodedVoice *voice, const QString &error) {
+			const auto session = weak.get();
+			if (!voice) {
+				*failure = error;
+				return;
+			} else if (!session) {
+				return;
+			}
+			const auto history = session->data().historyLoaded(PeerId(chatId));
+			if (!history) {
+				return;
+			}
+			session->api().sendVoiceMessage(
+				voice->bytes,
+				voice->waveform,
+				voice->duration,
+				false,
+				Api::SendAction(history));
+			*sent = true;
+		});
+
+	result["success"] = failure->isEmpty();
 	result["chat_id"] = chatId;
 	result["text"] = text;
 	result["persona"] = persona;
-	result["status"] = "tts_service_required";
-	result["note"] = "Voice reply requires TTS API integration";
-
+	result["cached"] = cached;
+	result["status"] = *sent
+		? "sent"
+		: failure->isEmpty()
+		? "rendering"
+		: "failed";
+	if (!failure->isEmpty()) {
+		result["error"] = *failure;
+	}
 	return result;
 }
 
@@ -7743,13 +10400,12 @@ QJsonObject Server::toolUploadAvatarSource(const QJsonObject &args) {
 		return result;
 	}
 
-	QSqlQuery query(_db);
-	query.prepare("INSERT OR REPLACE INTO video_avatar (name, source_path, created_at) "
+	auto query = PreparedQuery(_db, "INSERT OR REPLACE INTO video_avatar (name, source_path, created_at) "
 				  "VALUES (?, ?, datetime('now'))");
-	query.addBindValue(name);
-	query.addBindValue(filePath);
+	query->addBindValue(name);
+	query->addBindValue(filePath);
 
-	if (query.exec()) {
+	if (query->exec()) {
 		result["success"] = true;
 		result["name"] = name;
 		result["file_path"] = filePath;
@@ -7765,16 +10421,15 @@ QJsonObject Server::toolListAvatarPresets(const QJsonObject &args) {
 	Q_UNUSED(args);
 	QJsonObject result;
 
-	QSqlQuery query(_db);
-	query.prepare("SELECT name, source_path, created_at FROM video_avatar");
+	auto query = PreparedQuery(_db, "SELECT name, source_path, created_at FROM video_avatar");
 
 	QJsonArray presets;
-	if (query.exec()) {
-		while (query.next()) {
+	if (query->exec()) {
+		while (query->next()) {
 			QJsonObject preset;
-			preset["name"] = query.value(0).toString();
-			preset["source_path"] = query.value(1).toString();
-			preset["created_at"] = query.value(2).toString();
+			preset["name"] = query->value(0).toString();
+			preset["source_path"] = query->value(1).toString();
+			preset["created_at"] = query->value(2).toString();
 			presets.append(preset);
 		}
 	}
@@ -7800,19 +10455,19 @@ QJsonObject Server::toolCreateAutoReplyRule(const QJsonObject &args) {
 		return result;
 	}
 
-	QSqlQuery query(_db);
-	query.prepare("INSERT INTO chat_rules (chat_id, rule_name, rule_type, conditions, actions, enabled, priority, created_at) "
+	auto query = PreparedQuery(_db, "INSERT INTO chat_rules (chat_id, rule_name, rule_type, conditions, actions, enabled, priority, created_at) "
 				  "VALUES (0, ?, 'auto_reply', ?, ?, 1, ?, datetime('now'))");
-	query.addBindValue(name);
-	query.addBindValue(QJsonDocument(triggers).toJson(QJsonDocument::Compact));
+	query->addBindValue(name);
+	query->addBindValue(QJsonDocument(triggers).toJson(QJsonDocument::Compact));
 	QJsonObject actions;
 	actions["response"] = response;
-	query.addBindValue(QJsonDocument(actions).toJson(QJsonDocument::Compact));
-	query.addBindValue(priority);
+	query->addBindValue(QJsonDocument(actions).toJson(QJsonDocument::Compact));
+	query->addBindValue(priority);
 
-	if (query.exec()) {
+	if (query->exec()) {
+		_chatRules->invalidate();
 		result["success"] = true;
-		result["id"] = query.lastInsertId().toLongLong();
+		result["id"] = query->lastInsertId().toLongLong();
 		result["name"] = name;
 	} else {
 		result["success"] = false;
@@ -7826,21 +10481,20 @@ QJsonObject Server::toolListAutoReplyRules(const QJsonObject &args) {
 	Q_UNUSED(args);
 	QJsonObject result;
 
-	QSqlQuery query(_db);
-	query.prepare("SELECT id, rule_name, conditions, actions, enabled, priority, times_triggered "
+	auto query = PreparedQuery(_db, "SELECT id, rule_name, conditions, actions, enabled, priority, times_triggered "
 				  "FROM chat_rules WHERE rule_type = 'auto_reply' ORDER BY priority");
 
 	QJsonArray rules;
-	if (query.exec()) {
-		while (query.next()) {
+	if (query->exec()) {
+		while (query->next()) {
 			QJsonObject rule;
-			rule["id"] = query.value(0).toLongLong();
-			rule["name"] = query.value(1).toString();
-			rule["triggers"] = QJsonDocument::fromJson(query.value(2).toByteArray()).object();
-			rule["actions"] = QJsonDocument::fromJson(query.value(3).toByteArray()).object();
-			rule["enabled"] = query.value(4).toBool();
-			rule["priority"] = query.value(5).toInt();
-			rule["times_triggered"] = query.value(6).toInt();
+			rule["id"] = query->value(0).toLongLong();
+			rule["name"] = query->value(1).toString();
+			rule["triggers"] = QJsonDocument::fromJson(query->value(2).toByteArray()).object();
+			rule["actions"] = QJsonDocument::fromJson(query->value(3).toByteArray()).object();
+			rule["enabled"] = query->value(4).toBool();
+			rule["priority"] = query->value(5).toInt();
+			rule["times_triggered"] = query->value(6).toInt();
 			rules.append(rule);
 		}
 	}
@@ -7883,14 +10537,14 @@ QJsonObject Server::toolUpdateAutoReplyRule(const QJsonObject &args) {
 		return result;
 	}
 
-	QSqlQuery query(_db);
-	query.prepare("UPDATE chat_rules SET " + updates.join(", ") + " WHERE id = ? AND rule_type = 'auto_reply'");
+	auto query = PreparedQuery(_db, "UPDATE chat_rules SET " + updates.join(", ") + " WHERE id = ? AND rule_type = 'auto_reply'");
 	for (const auto &val : values) {
-		query.addBindValue(val);
+		query->addBindValue(val);
 	}
-	query.addBindValue(ruleId);
+	query->addBindValue(ruleId);
 
-	if (query.exec() && query.numRowsAffected() > 0) {
+	if (query->exec() && query->numRowsAffected() > 0) {
+		_chatRules->invalidate();
 		result["success"] = true;
 		result["rule_id"] = ruleId;
 	} else {
@@ -7905,11 +10559,11 @@ QJsonObject Server::toolDeleteAutoReplyRule(const QJsonObject &args) {
 	QJsonObject result;
 	qint64 ruleId = args["rule_id"].toVariant().toLongLong();
 
-	QSqlQuery query(_db);
-	query.prepare("DELETE FROM chat_rules WHERE id = ? AND rule_type = 'auto_reply'");
-	query.addBindValue(ruleId);
+	auto query = PreparedQuery(_db, "DELETE FROM chat_rules WHERE id = ? AND rule_type = 'auto_reply'");
+	query->addBindValue(ruleId);
 
-	if (query.exec() && query.numRowsAffected() > 0) {
+	if (query->exec() && query->numRowsAffected() > 0) {
+		_chatRules->invalidate();
 		result["success"] = true;
 		result["deleted"] = true;
 	} else {
@@ -7930,36 +10584,12 @@ QJsonObject Server::toolTestAutoReplyRule(const QJsonObject &args) {
 		return result;
 	}
 
-	QSqlQuery query(_db);
-	query.prepare("SELECT rule_name, conditions, actions FROM chat_rules "
-				  "WHERE rule_type = 'auto_reply' AND enabled = 1 ORDER BY priority");
-
 	QJsonArray matchedRules;
-	if (query.exec()) {
-		while (query.next()) {
-			QString ruleName = query.value(0).toString();
-			QJsonObject triggers = QJsonDocument::fromJson(query.value(1).toByteArray()).object();
-			QJsonObject actions = QJsonDocument::fromJson(query.value(2).toByteArray()).object();
-
-			// Check keyword triggers
-			bool matches = false;
-			if (triggers.contains("keywords")) {
-				QJsonArray keywords = triggers["keywords"].toArray();
-				for (const auto &kw : keywords) {
-					if (testMessage.contains(kw.toString(), Qt::CaseInsensitive)) {
-						matches = true;
-						break;
-					}
-				}
-			}
-
-			if (matches) {
-				QJsonObject matched;
-				matched["rule_name"] = ruleName;
-				matched["response"] = actions["response"].toString();
-				matchedRules.append(matched);
-			}
-		}
+	for (const auto rule : _chatRules->evaluate(0, testMessage, "auto_reply")) {
+		QJsonObject matched;
+		matched["rule_name"] = rule->name;
+		matched["response"] = rule->actions["response"].toString();
+		matchedRules.append(matched);
 	}
 
 	result["success"] = true;
@@ -7974,18 +10604,18 @@ QJsonObject Server::toolGetAutoReplyStats(const QJsonObject &args) {
 	Q_UNUSED(args);
 	QJsonObject result;
 
-	QSqlQuery query(_db);
-	query.prepare("SELECT COUNT(*), SUM(times_triggered) FROM chat_rules WHERE rule_type = 'auto_reply'");
+	auto query = PreparedQuery(_db, "SELECT COUNT(*), SUM(times_triggered) FROM chat_rules WHERE rule_type = 'auto_reply'");
 
-	if (query.exec() && query.next()) {
-		result["total_rules"] = query.value(0).toInt();
-		result["total_triggered"] = query.value(1).toInt();
+	if (query->exec() && query->next()) {
+		result["total_rules"] = query->value(0).toInt();
+		result["total_triggered"] = query->value(1).toInt();
 		result["success"] = true;
 	} else {
 		result["total_rules"] = 0;
 		result["total_triggered"] = 0;
 		result["success"] = true;
 	}
+	result["engine"] = _chatRules->stats();
 
 	return result;
 }
@@ -7999,12 +10629,11 @@ QJsonObject Server::toolGetWalletBalance(const QJsonObject &args) {
 
 	// Note: Actual wallet balance would come from Telegram API
 	// This is a local tracking feature
-	QSqlQuery query(_db);
-	query.prepare("SELECT balance, last_updated FROM wallet_budgets WHERE id = 1");
+	auto query = PreparedQuery(_db, "SELECT balance, last_updated FROM wallet_budgets WHERE id = 1");
 
-	if (query.exec() && query.next()) {
-		result["stars_balance"] = query.value(0).toDouble();
-		result["last_updated"] = query.value(1).toString();
+	if (query->exec() && query->next()) {
+		result["stars_balance"] = query->value(0).toDouble();
+		result["last_updated"] = query->value(1).toString();
 	} else {
 		result["stars_balance"] = 0;
 		result["last_updated"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
@@ -8020,18 +10649,17 @@ QJsonObject Server::toolGetBalanceHistory(const QJsonObject &args) {
 	QJsonObject result;
 	int days = args.value("days").toInt(30);
 
-	QSqlQuery query(_db);
-	query.prepare("SELECT date, balance FROM wallet_spending "
+	auto query = PreparedQuery(_db, "SELECT date, balance FROM wallet_spending "
 				  "WHERE date >= date('now', '-' || ? || ' days') "
 				  "ORDER BY date");
-	query.addBindValue(days);
+	query->addBindValue(days);
 
 	QJsonArray history;
-	if (query.exec()) {
-		while (query.next()) {
+	if (query->exec()) {
+		while (query->next()) {
 			QJsonObject entry;
-			entry["date"] = query.value(0).toString();
-			entry["balance"] = query.value(1).toDouble();
+			entry["date"] = query->value(0).toString();
+			entry["balance"] = query->value(1).toDouble();
 			history.append(entry);
 		}
 	}
@@ -8053,17 +10681,21 @@ QJsonObject Server::toolGetSpendingAnalytics(const QJsonObject &args) {
 	else if (period == "year") dateFilter = "date('now', '-1 year')";
 	else dateFilter = "date('now', '-30 days')";
 
-	QSqlQuery query(_db);
-	query.prepare("SELECT category, SUM(amount) as total FROM wallet_spending "
+	// A year of rows is summed from the monthly totals kept by WalletSync.
+	auto query = (period == "year")
+		? PreparedQuery(_db, "SELECT category, -SUM(spent) as total FROM wallet_spending_monthly "
+				  "WHERE month >= strftime('%Y-%m', 'now', '-11 months') "
+				  "GROUP BY category ORDER BY total")
+		: PreparedQuery(_db, "SELECT category, SUM(amount) as total FROM wallet_spending "
 				  "WHERE date >= " + dateFilter + " AND amount < 0 "
 				  "GROUP BY category ORDER BY total");
 
 	QJsonObject byCategory;
 	double totalSpent = 0;
-	if (query.exec()) {
-		while (query.next()) {
-			QString category = query.value(0).toString();
-			double amount = qAbs(query.value(1).toDouble());
+	if (query->exec()) {
+		while (query->next()) {
+			QString category = query->value(0).toString();
+			double amount = qAbs(query->value(1).toDouble());
 			byCategory[category] = amount;
 			totalSpent += amount;
 		}
@@ -8087,17 +10719,16 @@ QJsonObject Server::toolGetIncomeAnalytics(const QJsonObject &args) {
 	else if (period == "year") dateFilter = "date('now', '-1 year')";
 	else dateFilter = "date('now', '-30 days')";
 
-	QSqlQuery query(_db);
-	query.prepare("SELECT category, SUM(amount) as total FROM wallet_spending "
+	auto query = PreparedQuery(_db, "SELECT category, SUM(amount) as total FROM wallet_spending "
 				  "WHERE date >= " + dateFilter + " AND amount > 0 "
 				  "GROUP BY category ORDER BY total DESC");
 
 	QJsonObject byCategory;
 	double totalIncome = 0;
-	if (query.exec()) {
-		while (query.next()) {
-			QString category = query.value(0).toString();
-			double amount = query.value(1).toDouble();
+	if (query->exec()) {
+		while (query->next()) {
+			QString category = query->value(0).toString();
+			double amount = query->value(1).toDouble();
 			byCategory[category] = amount;
 			totalIncome += amount;
 		}
@@ -8117,7 +10748,6 @@ QJsonObject Server::toolGetTransactions(const QJsonObject &args) {
 	int limit = args.value("limit").toInt(50);
 	QString type = args.value("type").toString();
 
-	QSqlQuery query(_db);
 	QString sql = "SELECT id, date, amount, category, description, peer_id FROM wallet_spending ";
 	if (!type.isEmpty()) {
 		if (type == "income") sql += "WHERE amount > 0 ";
@@ -8125,20 +10755,20 @@ QJsonObject Server::toolGetTransactions(const QJsonObject &args) {
 	}
 	sql += "ORDER BY date DESC LIMIT ?";
 
-	query.prepare(sql);
-	query.addBindValue(limit);
+	auto query = PreparedQuery(_db, sql);
+	query->addBindValue(limit);
 
 	QJsonArray transactions;
-	if (query.exec()) {
-		while (query.next()) {
+	if (query->exec()) {
+		while (query->next()) {
 			QJsonObject tx;
-			tx["id"] = query.value(0).toLongLong();
-			tx["date"] = query.value(1).toString();
-			tx["amount"] = query.value(2).toDouble();
-			tx["category"] = query.value(3).toString();
-			tx["description"] = query.value(4).toString();
-			if (!query.value(5).isNull()) {
-				tx["peer_id"] = query.value(5).toLongLong();
+			tx["id"] = query->value(0).toLongLong();
+			tx["date"] = query->value(1).toString();
+			tx["amount"] = query->value(2).toDouble();
+			tx["category"] = query->value(3).toString();
+			tx["description"] = query->value(4).toString();
+			if (!query->value(5).isNull()) {
+				tx["peer_id"] = query->value(5).toLongLong();
 			}
 			transactions.append(tx);
 		}
@@ -8147,6 +10777,9 @@ QJsonObject Server::toolGetTransactions(const QJsonObject &args) {
 	result["success"] = true;
 	result["transactions"] = transactions;
 	result["count"] = transactions.size();
+	if (_walletSync) {
+		result["sync"] = _walletSync->stats();
+	}
 
 	return result;
 }
@@ -8155,18 +10788,17 @@ QJsonObject Server::toolGetTransactionDetails(const QJsonObject &args) {
 	QJsonObject result;
 	QString transactionId = args["transaction_id"].toString();
 
-	QSqlQuery query(_db);
-	query.prepare("SELECT id, date, amount, category, description, peer_id FROM wallet_spending WHERE id = ?");
-	query.addBindValue(transactionId);
-
-	if (query.exec() && query.next()) {
-		result["id"] = query.value(0).toLongLong();
-		result["date"] = query.value(1).toString();
-		result["amount"] = query.value(2).toDouble();
-		result["category"] = query.value(3).toString();
-		result["description"] = query.value(4).toString();
-		if (!query.value(5).isNull()) {
-			result["peer_id"] = query.value(5).toLongLong();
+	auto query = PreparedQuery(_db, "SELECT id, date, amount, category, description, peer_id FROM wallet_spending WHERE id = ?");
+	query->addBindValue(transactionId);
+
+	if (query->exec() && query->next()) {
+		result["id"] = query->value(0).toLongLong();
+		result["date"] = query->value(1).toString();
+		result["amount"] = query->value(2).toDouble();
+		result["category"] = query->value(3).toString();
+		result["description"] = query->value(4).toString();
+		if (!query->value(5).isNull()) {
+			result["peer_id"] = query->value(5).toLongLong();
 		}
 		result["success"] = true;
 	} else {
@@ -8183,7 +10815,6 @@ QJsonObject Server::toolExportTransactions(const QJsonObject &args) {
 	QString startDate = args.value("start_date").toString();
 	QString endDate = args.value("end_date").toString();
 
-	QSqlQuery query(_db);
 	QString sql = "SELECT date, amount, category, description FROM wallet_spending ";
 	QStringList conditions;
 	if (!startDate.isEmpty()) conditions << "date >= ?";
@@ -8193,18 +10824,18 @@ QJsonObject Server::toolExportTransactions(const QJsonObject &args) {
 	}
 	sql += "ORDER BY date";
 
-	query.prepare(sql);
-	if (!startDate.isEmpty()) query.addBindValue(startDate);
-	if (!endDate.isEmpty()) query.addBindValue(endDate);
+	auto query = PreparedQuery(_db, sql);
+	if (!startDate.isEmpty()) query->addBindValue(startDate);
+	if (!endDate.isEmpty()) query->addBindValue(endDate);
 
 	QJsonArray transactions;
-	if (query.exec()) {
-		while (query.next()) {
+	if (query->exec()) {
+		while (query->next()) {
 			QJsonObject tx;
-			tx["date"] = query.value(0).toString();
-			tx["amount"] = query.value(1).toDouble();
-			tx["category"] = query.value(2).toString();
-			tx["description"] = query.value(3).toString();
+			tx["date"] = query->value(0).toString();
+			tx["amount"] = query->value(1).toDouble();
+			tx["category"] = query->value(2).toString();
+			tx["description"] = query->value(3).toString();
 			transactions.append(tx);
 		}
 	}
@@ -8228,12 +10859,11 @@ QJsonObject Server::toolCategorizeTransaction(const QJsonObject &args) {
 		return result;
 	}
 
-	QSqlQuery query(_db);
-	query.prepare("UPDATE wallet_spending SET category = ? WHERE id = ?");
-	query.addBindValue(category);
-	query.addBindValue(transactionId);
+	auto query = PreparedQuery(_db, "UPDATE wallet_spending SET category = ? WHERE id = ?");
+	query->addBindValue(category);
+	query->addBindValue(transactionId);
 
-	if (query.exec() && query.numRowsAffected() > 0) {
+	if (query->exec() && query->numRowsAffected() > 0) {
 		result["success"] = true;
 		result["transaction_id"] = transactionId;
 		result["category"] = category;
@@ -8427,14 +11057,13 @@ QJsonObject Server::toolSetSpendingBudget(const QJsonObject &args) {
 	double weeklyLimit = args.value("weekly_limit").toDouble(0);
 	double monthlyLimit = args.value("monthly_limit").toDouble(0);
 
-	QSqlQuery query(_db);
-	query.prepare("INSERT OR REPLACE INTO wallet_budgets (id, daily_limit, weekly_limit, monthly_limit, updated_at) "
+	auto query = PreparedQuery(_db, "INSERT OR REPLACE INTO wallet_budgets (id, daily_limit, weekly_limit, monthly_limit, updated_at) "
 				  "VALUES (1, ?, ?, ?, datetime('now'))");
-	query.addBindValue(dailyLimit);
-	query.addBindValue(weeklyLimit);
-	query.addBindValue(monthlyLimit);
+	query->addBindValue(dailyLimit);
+	query->addBindValue(weeklyLimit);
+	query->addBindValue(monthlyLimit);
 
-	if (query.exec()) {
+	if (query->exec()) {
 		result["success"] = true;
 		result["daily_limit"] = dailyLimit;
 		result["weekly_limit"] = weeklyLimit;
@@ -8451,27 +11080,25 @@ QJsonObject Server::toolGetBudgetStatus(const QJsonObject &args) {
 	Q_UNUSED(args);
 	QJsonObject result;
 
-	QSqlQuery budgetQuery(_db);
-	budgetQuery.prepare("SELECT daily_limit, weekly_limit, monthly_limit FROM wallet_budgets WHERE id = 1");
+	auto budgetQuery = PreparedQuery(_db, "SELECT daily_limit, weekly_limit, monthly_limit FROM wallet_budgets WHERE id = 1");
 
-	if (budgetQuery.exec() && budgetQuery.next()) {
-		double dailyLimit = budgetQuery.value(0).toDouble();
-		double weeklyLimit = budgetQuery.value(1).toDouble();
-		double monthlyLimit = budgetQuery.value(2).toDouble();
+	if (budgetQuery->exec() && budgetQuery->next()) {
+		double dailyLimit = budgetQuery->value(0).toDouble();
+		double weeklyLimit = budgetQuery->value(1).toDouble();
+		double monthlyLimit = budgetQuery->value(2).toDouble();
 
 		// Calculate spent amounts
-		QSqlQuery spentQuery(_db);
-		spentQuery.prepare("SELECT "
+		auto spentQuery = PreparedQuery(_db, "SELECT "
 						   "SUM(CASE WHEN date >= date('now') THEN ABS(amount) ELSE 0 END) as daily, "
 						   "SUM(CASE WHEN date >= date('now', '-7 days') THEN ABS(amount) ELSE 0 END) as weekly, "
 						   "SUM(CASE WHEN date >= date('now', '-30 days') THEN ABS(amount) ELSE 0 END) as monthly "
 						   "FROM wallet_spending WHERE amount < 0");
 
 		double dailySpent = 0, weeklySpent = 0, monthlySpent = 0;
-		if (spentQuery.exec() && spentQuery.next()) {
-			dailySpent = spentQuery.value(0).toDouble();
-			weeklySpent = spentQuery.value(1).toDouble();
-			monthlySpent = spentQuery.value(2).toDouble();
+		if (spentQuery->exec() && spentQuery->next()) {
+			dailySpent = spentQuery->value(0).toDouble();
+			weeklySpent = spentQuery->value(1).toDouble();
+			monthlySpent = spentQuery->value(2).toDouble();
 		}
 
 		result["daily_limit"] = dailyLimit;
@@ -8510,15 +11137,14 @@ QJsonObject Server::toolApproveMiniappSpend(const QJsonObject &args) {
 	QString miniappId = args["miniapp_id"].toString();
 	double amount = args["amount"].toDouble();
 
-	QSqlQuery query(_db);
-	query.prepare("INSERT INTO miniapp_budgets (miniapp_id, approved_amount, spent_amount, created_at) "
+	auto query = PreparedQuery(_db, "INSERT INTO miniapp_budgets (miniapp_id, approved_amount, spent_amount, created_at) "
 				  "VALUES (?, ?, 0, datetime('now')) "
 				  "ON CONFLICT(miniapp_id) DO UPDATE SET approved_amount = approved_amount + ?");
-	query.addBindValue(miniappId);
-	query.addBindValue(amount);
-	query.addBindValue(amount);
+	query->addBindValue(miniappId);
+	query->addBindValue(amount);
+	query->addBindValue(amount);
 
-	if (query.exec()) {
+	if (query->exec()) {
 		result["success"] = true;
 		result["miniapp_id"] = miniappId;
 		result["approved_amount"] = amount;
@@ -8534,18 +11160,17 @@ QJsonObject Server::toolListMiniappPermissions(const QJsonObject &args) {
 	Q_UNUSED(args);
 	QJsonObject result;
 
-	QSqlQuery query(_db);
-	query.prepare("SELECT miniapp_id, approved_amount, spent_amount, created_at FROM miniapp_budgets");
+	auto query = PreparedQuery(_db, "SELECT miniapp_id, approved_amount, spent_amount, created_at FROM miniapp_budgets");
 
 	QJsonArray permissions;
-	if (query.exec()) {
-		while (query.next()) {
+	if (query->exec()) {
+		while (query->next()) {
 			QJsonObject perm;
-			perm["miniapp_id"] = query.value(0).toString();
-			perm["approved_amount"] = query.value(1).toDouble();
-			perm["spent_amount"] = query.value(2).toDouble();
-			perm["remaining"] = query.value(1).toDouble() - query.value(2).toDouble();
-			perm["created_at"] = query.value(3).toString();
+			perm["miniapp_id"] = query->value(0).toString();
+			perm["approved_amount"] = query->value(1).toDouble();
+			perm["spent_amount"] = query->value(2).toDouble();
+			perm["remaining"] = query->value(1).toDouble() - query->value(2).toDouble();
+			perm["created_at"] = query->value(3).toString();
 			permissions.append(perm);
 		}
 	}
@@ -8560,11 +11185,10 @@ QJsonObject Server::toolRevokeMiniappPermission(const QJsonObject &args) {
 	QJsonObject result;
 	QString miniappId = args["miniapp_id"].toString();
 
-	QSqlQuery query(_db);
-	query.prepare("DELETE FROM miniapp_budgets WHERE miniapp_id = ?");
-	query.addBindValue(miniappId);
+	auto query = PreparedQuery(_db, "DELETE FROM miniapp_budgets WHERE miniapp_id = ?");
+	query->addBindValue(miniappId);
 
-	if (query.exec() && query.numRowsAffected() > 0) {
+	if (query->exec() && query->numRowsAffected() > 0) {
 		result["success"] = true;
 		result["revoked"] = true;
 		result["miniapp_id"] = miniappId;
@@ -8675,16 +11299,15 @@ QJsonObject Server::toolCreateGiftCollection(const QJsonObject &args) {
 		return result;
 	}
 
-	QSqlQuery query(_db);
-	query.prepare("INSERT INTO gift_collections (name, description, is_public, created_at) "
+	auto query = PreparedQuery(_db, "INSERT INTO gift_collections (name, description, is_public, created_at) "
 				  "VALUES (?, ?, ?, datetime('now'))");
-	query.addBindValue(name);
-	query.addBindValue(description);
-	query.addBindValue(isPublic);
+	query->addBindValue(name);
+	query->addBindValue(description);
+	query->addBindValue(isPublic);
 
-	if (query.exec()) {
+	if (query->exec()) {
 		result["success"] = true;
-		result["collection_id"] = query.lastInsertId().toLongLong();
+		result["collection_id"] = query->lastInsertId().toLongLong();
 		result["name"] = name;
 	} else {
 		result["success"] = false;
@@ -8698,18 +11321,17 @@ QJsonObject Server::toolListGiftCollections(const QJsonObject &args) {
 	Q_UNUSED(args);
 	QJsonObject result;
 
-	QSqlQuery query(_db);
-	query.prepare("SELECT id, name, description, is_public, created_at FROM gift_collections");
+	auto query = PreparedQuery(_db, "SELECT id, name, description, is_public, created_at FROM gift_collections");
 
 	QJsonArray collections;
-	if (query.exec()) {
-		while (query.next()) {
+	if (query->exec()) {
+		while (query->next()) {
 			QJsonObject collection;
-			collection["id"] = query.value(0).toLongLong();
-			collection["name"] = query.value(1).toString();
-			collection["description"] = query.value(2).toString();
-			collection["is_public"] = query.value(3).toBool();
-			collection["created_at"] = query.value(4).toString();
+			collection["id"] = query->value(0).toLongLong();
+			collection["name"] = query->value(1).toString();
+			collection["description"] = query->value(2).toString();
+			collection["is_public"] = query->value(3).toBool();
+			collection["created_at"] = query->value(4).toString();
 			collections.append(collection);
 		}
 	}
@@ -8894,18 +11516,52 @@ QJsonObject Server::toolGetGiftPriceHistory(const QJsonObject &args) {
 	QString giftType = args["gift_type"].toString();
 	int days = args.value("days").toInt(30);
 
-	QSqlQuery query(_db);
-	query.prepare("SELECT date, price FROM price_history WHERE gift_type = ? "
+	// Recorded resale floor prices, one candle per bucket.
+	const auto giftId = _giftPrices ? _giftPrices->resolve(giftType) : 0;
+	if (giftId) {
+		const auto till = QDateTime::currentSecsSinceEpoch();
+		const auto series = _giftPrices->read(
+			giftId,
+			till - qint64(days) * 86400,
+			till);
+		if (!series.empty()) {
+			const auto points = std::clamp(
+				args.value("points").toInt(days),
+				1,
+				1000);
+			QJsonArray history;
+			for (const auto &bucket : Downsample(series, points)) {
+				QJsonObject entry;
+				entry["date"] = QDateTime::fromSecsSinceEpoch(
+					bucket.from).toString(Qt::ISODate);
+				entry["price"] = double(bucket.close);
+				entry["open"] = double(bucket.open);
+				entry["high"] = double(bucket.high);
+				entry["low"] = double(bucket.low);
+				entry["listings"] = bucket.listings;
+				history.append(entry);
+			}
+			result["success"] = true;
+			result["gift_type"] = giftType;
+			result["gift_id"] = QString::number(giftId);
+			result["title"] = _giftPrices->title(giftId);
+			result["samples"] = series.size();
+			result["history"] = history;
+			return result;
+		}
+	}
+
+	auto query = PreparedQuery(_db, "SELECT date, price FROM price_history WHERE gift_type = ? "
 				  "AND date >= date('now', '-' || ? || ' days') ORDER BY date");
-	query.addBindValue(giftType);
-	query.addBindValue(days);
+	query->addBindValue(giftType);
+	query->addBindValue(days);
 
 	QJsonArray history;
-	if (query.exec()) {
-		while (query.next()) {
+	if (query->exec()) {
+		while (query->next()) {
 			QJsonObject entry;
-			entry["date"] = query.value(0).toString();
-			entry["price"] = query.value(1).toDouble();
+			entry["date"] = query->value(0).toString();
+			entry["price"] = query->value(1).toDouble();
 			history.append(entry);
 		}
 	}
@@ -8924,14 +11580,13 @@ QJsonObject Server::toolSendStarReaction(const QJsonObject &args) {
 	qint64 messageId = args["message_id"].toVariant().toLongLong();
 	int starsCount = args.value("stars_count").toInt(1);
 
-	QSqlQuery query(_db);
-	query.prepare("INSERT INTO star_reactions (chat_id, message_id, stars_count, created_at) "
+	auto query = PreparedQuery(_db, "INSERT INTO star_reactions (chat_id, message_id, stars_count, created_at) "
 				  "VALUES (?, ?, ?, datetime('now'))");
-	query.addBindValue(chatId);
-	query.addBindValue(messageId);
-	query.addBindValue(starsCount);
+	query->addBindValue(chatId);
+	query->addBindValue(messageId);
+	query->addBindValue(starsCount);
 
-	if (query.exec()) {
+	if (query->exec()) {
 		result["success"] = true;
 		result["chat_id"] = chatId;
 		result["message_id"] = messageId;
@@ -8949,7 +11604,6 @@ QJsonObject Server::toolGetStarReactions(const QJsonObject &args) {
 	qint64 chatId = args.value("chat_id").toVariant().toLongLong();
 	qint64 messageId = args.value("message_id").toVariant().toLongLong();
 
-	QSqlQuery query(_db);
 	QString sql = "SELECT chat_id, message_id, stars_count, created_at FROM star_reactions ";
 	QStringList conditions;
 	if (chatId > 0) conditions << "chat_id = ?";
@@ -8960,18 +11614,18 @@ QJsonObject Server::toolGetStarReactions(const QJsonObject &args) {
 	}
 	sql += " ORDER BY created_at DESC LIMIT 100";
 
-	query.prepare(sql);
-	if (chatId > 0) query.addBindValue(chatId);
-	if (messageId > 0) query.addBindValue(messageId);
+	auto query = PreparedQuery(_db, sql);
+	if (chatId > 0) query->addBindValue(chatId);
+	if (messageId > 0) query->addBindValue(messageId);
 
 	QJsonArray reactions;
-	if (query.exec()) {
-		while (query.next()) {
+	if (query->exec()) {
+		while (query->next()) {
 			QJsonObject reaction;
-			reaction["chat_id"] = query.value(0).toLongLong();
-			reaction["message_id"] = query.value(1).toLongLong();
-			reaction["stars_count"] = query.value(2).toInt();
-			reaction["created_at"] = query.value(3).toString();
+			reaction["chat_id"] = query->value(0).toLongLong();
+			reaction["message_id"] = query->value(1).toLongLong();
+			reaction["stars_count"] = query->value(2).toInt();
+			reaction["created_at"] = query->value(3).toString();
 			reactions.append(reaction);
 		}
 	}
@@ -8990,13 +11644,12 @@ QJsonObject Server::toolGetReactionAnalytics(const QJsonObject &args) {
 	if (period == "day") dateFilter = "date('now', '-1 day')";
 	else if (period == "month") dateFilter = "date('now', '-30 days')";
 
-	QSqlQuery query(_db);
-	query.prepare("SELECT COUNT(*), SUM(stars_count) FROM star_reactions "
+	auto query = PreparedQuery(_db, "SELECT COUNT(*), SUM(stars_count) FROM star_reactions "
 				  "WHERE created_at >= " + dateFilter);
 
-	if (query.exec() && query.next()) {
-		result["reaction_count"] = query.value(0).toInt();
-		result["total_stars"] = query.value(1).toInt();
+	if (query->exec() && query->next()) {
+		result["reaction_count"] = query->value(0).toInt();
+		result["total_stars"] = query->value(1).toInt();
 	}
 
 	result["success"] = true;
@@ -9022,19 +11675,18 @@ QJsonObject Server::toolGetTopReacted(const QJsonObject &args) {
 	QJsonObject result;
 	int limit = args.value("limit").toInt(10);
 
-	QSqlQuery query(_db);
-	query.prepare("SELECT message_id, chat_id, SUM(stars_count) as total "
+	auto query = PreparedQuery(_db, "SELECT message_id, chat_id, SUM(stars_count) as total "
 				  "FROM star_reactions GROUP BY chat_id, message_id "
 				  "ORDER BY total DESC LIMIT ?");
-	query.addBindValue(limit);
+	query->addBindValue(limit);
 
 	QJsonArray topMessages;
-	if (query.exec()) {
-		while (query.next()) {
+	if (query->exec()) {
+		while (query->next()) {
 			QJsonObject msg;
-			msg["message_id"] = query.value(0).toLongLong();
-			msg["chat_id"] = query.value(1).toLongLong();
-			msg["total_stars"] = query.value(2).toInt();
+			msg["message_id"] = query->value(0).toLongLong();
+			msg["chat_id"] = query->value(1).toLongLong();
+			msg["total_stars"] = query->value(2).toInt();
 			topMessages.append(msg);
 		}
 	}
@@ -9053,17 +11705,16 @@ QJsonObject Server::toolCreatePaidPost(const QJsonObject &args) {
 	int price = args["price"].toInt();
 	QString previewText = args.value("preview").toString();
 
-	QSqlQuery query(_db);
-	query.prepare("INSERT INTO paid_content (chat_id, content, price, preview_text, unlocks, created_at) "
+	auto query = PreparedQuery(_db, "INSERT INTO paid_content (chat_id, content, price, preview_text, unlocks, created_at) "
 				  "VALUES (?, ?, ?, ?, 0, datetime('now'))");
-	query.addBindValue(chatId);
-	query.addBindValue(content);
-	query.addBindValue(price);
-	query.addBindValue(previewText);
+	query->addBindValue(chatId);
+	query->addBindValue(content);
+	query->addBindValue(price);
+	query->addBindValue(previewText);
 
-	if (query.exec()) {
+	if (query->exec()) {
 		result["success"] = true;
-		result["content_id"] = query.lastInsertId().toLongLong();
+		result["content_id"] = query->lastInsertId().toLongLong();
 		result["price"] = price;
 	} else {
 		result["success"] = false;
@@ -9078,12 +11729,11 @@ QJsonObject Server::toolSetContentPrice(const QJsonObject &args) {
 	qint64 contentId = args["content_id"].toVariant().toLongLong();
 	int price = args["price"].toInt();
 
-	QSqlQuery query(_db);
-	query.prepare("UPDATE paid_content SET price = ? WHERE id = ?");
-	query.addBindValue(price);
-	query.addBindValue(contentId);
+	auto query = PreparedQuery(_db, "UPDATE paid_content SET price = ? WHERE id = ?");
+	query->addBindValue(price);
+	query->addBindValue(contentId);
 
-	if (query.exec() && query.numRowsAffected() > 0) {
+	if (query->exec() && query->numRowsAffected() > 0) {
 		result["success"] = true;
 		result["content_id"] = contentId;
 		result["price"] = price;
@@ -9099,19 +11749,17 @@ QJsonObject Server::toolUnlockContent(const QJsonObject &args) {
 	QJsonObject result;
 	qint64 contentId = args["content_id"].toVariant().toLongLong();
 
-	QSqlQuery query(_db);
-	query.prepare("SELECT content, price FROM paid_content WHERE id = ?");
-	query.addBindValue(contentId);
+	auto query = PreparedQuery(_db, "SELECT content, price FROM paid_content WHERE id = ?");
+	query->addBindValue(contentId);
 
-	if (query.exec() && query.next()) {
-		QString content = query.value(0).toString();
-		int price = query.value(1).toInt();
+	if (query->exec() && query->next()) {
+		QString content = query->value(0).toString();
+		int price = query->value(1).toInt();
 
 		// Update unlock count
-		QSqlQuery updateQuery(_db);
-		updateQuery.prepare("UPDATE paid_content SET unlocks = unlocks + 1 WHERE id = ?");
-		updateQuery.addBindValue(contentId);
-		updateQuery.exec();
+		auto updateQuery = PreparedQuery(_db, "UPDATE paid_content SET unlocks = unlocks + 1 WHERE id = ?");
+		updateQuery->addBindValue(contentId);
+		updateQuery->exec();
 
 		result["success"] = true;
 		result["content_id"] = contentId;
@@ -9129,13 +11777,12 @@ QJsonObject Server::toolGetPaidContentStats(const QJsonObject &args) {
 	Q_UNUSED(args);
 	QJsonObject result;
 
-	QSqlQuery query(_db);
-	query.prepare("SELECT COUNT(*), SUM(unlocks), SUM(price * unlocks) FROM paid_content");
+	auto query = PreparedQuery(_db, "SELECT COUNT(*), SUM(unlocks), SUM(price * unlocks) FROM paid_content");
 
-	if (query.exec() && query.next()) {
-		result["total_posts"] = query.value(0).toInt();
-		result["total_unlocks"] = query.value(1).toInt();
-		result["total_revenue"] = query.value(2).toInt();
+	if (query->exec() && query->next()) {
+		result["total_posts"] = query->value(0).toInt();
+		result["total_unlocks"] = query->value(1).toInt();
+		result["total_revenue"] = query->value(2).toInt();
 		result["success"] = true;
 	} else {
 		result["success"] = true;
@@ -9177,17 +11824,16 @@ QJsonObject Server::toolGetPortfolio(const QJsonObject &args) {
 	Q_UNUSED(args);
 	QJsonObject result;
 
-	QSqlQuery query(_db);
-	query.prepare("SELECT gift_type, quantity, avg_price, current_value FROM portfolio");
+	auto query = PreparedQuery(_db, "SELECT gift_type, quantity, avg_price, current_value FROM portfolio");
 
 	QJsonArray holdings;
-	if (query.exec()) {
-		while (query.next()) {
+	if (query->exec()) {
+		while (query->next()) {
 			QJsonObject holding;
-			holding["gift_type"] = query.value(0).toString();
-			holding["quantity"] = query.value(1).toInt();
-			holding["avg_price"] = query.value(2).toDouble();
-			holding["current_value"] = query.value(3).toDouble();
+			holding["gift_type"] = query->value(0).toString();
+			holding["quantity"] = query->value(1).toInt();
+			holding["avg_price"] = query->value(2).toDouble();
+			holding["current_value"] = query->value(3).toDouble();
 			holdings.append(holding);
 		}
 	}
@@ -9202,12 +11848,11 @@ QJsonObject Server::toolGetPortfolioValue(const QJsonObject &args) {
 	Q_UNUSED(args);
 	QJsonObject result;
 
-	QSqlQuery query(_db);
-	query.prepare("SELECT SUM(current_value), SUM(quantity * avg_price) FROM portfolio");
+	auto query = PreparedQuery(_db, "SELECT SUM(current_value), SUM(quantity * avg_price) FROM portfolio");
 
-	if (query.exec() && query.next()) {
-		double currentValue = query.value(0).toDouble();
-		double costBasis = query.value(1).toDouble();
+	if (query->exec() && query->next()) {
+		double currentValue = query->value(0).toDouble();
+		double costBasis = query->value(1).toDouble();
 		result["current_value"] = currentValue;
 		result["cost_basis"] = costBasis;
 		result["profit_loss"] = currentValue - costBasis;
@@ -9239,16 +11884,15 @@ QJsonObject Server::toolSetPriceAlert(const QJsonObject &args) {
 	double targetPrice = args["target_price"].toDouble();
 	QString direction = args.value("direction").toString("above");  // above or below
 
-	QSqlQuery query(_db);
-	query.prepare("INSERT INTO price_alerts (gift_type, target_price, direction, triggered, created_at) "
+	auto query = PreparedQuery(_db, "INSERT INTO price_alerts (gift_type, target_price, direction, triggered, created_at) "
 				  "VALUES (?, ?, ?, 0, datetime('now'))");
-	query.addBindValue(giftType);
-	query.addBindValue(targetPrice);
-	query.addBindValue(direction);
+	query->addBindValue(giftType);
+	query->addBindValue(targetPrice);
+	query->addBindValue(direction);
 
-	if (query.exec()) {
+	if (query->exec()) {
 		result["success"] = true;
-		result["alert_id"] = query.lastInsertId().toLongLong();
+		result["alert_id"] = query->lastInsertId().toLongLong();
 		result["gift_type"] = giftType;
 		result["target_price"] = targetPrice;
 		result["direction"] = direction;
@@ -9649,30 +12293,114 @@ QJsonObject Server::toolGetTranslationLanguages(const QJsonObject &args) {
 }
 
 QJsonObject Server::toolAutoTranslateChat(const QJsonObject &args) {
-	Q_UNUSED(args);
 	QJsonObject result;
-	result["success"] = false;
-	result["status"] = "not_implemented";
-	result["note"] = "Translation API integration required";
+	const auto chatId = args["chat_id"].toVariant().toLongLong();
+	const auto targetLanguage = args["target_language"].toString();
+	const auto enabled = args.value("enabled").toBool(true);
+
+	if (!_translation || !_translation->isRunning()) {
+		result["success"] = false;
+		result["error"] = "Translation requires an active session";
+		return result;
+	}
+	if (!_translation->setAutoTranslate(chatId, targetLanguage, enabled)) {
+		result["success"] = false;
+		result["error"] = (enabled && targetLanguage.isEmpty())
+			? "Missing target_language parameter"
+			: "Failed to save auto-translate setting";
+		return result;
+	}
+	result["success"] = true;
+	result["chat_id"] = chatId;
+	result["target_language"] = targetLanguage;
+	result["enabled"] = enabled;
 	return result;
 }
 
+namespace {
+
+[[nodiscard]] QJsonArray TranslationsJson(
+		const std::vector<TranslationResult> &results) {
+	auto list = QJsonArray();
+	for (const auto &entry : results) {
+		auto translation = QJsonObject{
+			{"chat_id", entry.chatId},
+			{"message_id", entry.messageId},
+			{"source", entry.source},
+		};
+		if (entry.translated.isEmpty()) {
+			translation["error"] = "Translation failed";
+		} else {
+			translation["translated_text"] = entry.translated;
+		}
+		list.append(translation);
+	}
+	return list;
+}
+
+} // namespace
+
 QJsonObject Server::toolTranslateMessages(const QJsonObject &args) {
-	Q_UNUSED(args);
 	QJsonObject result;
-	result["success"] = false;
-	result["status"] = "not_implemented";
-	result["note"] = "Translation API integration required";
+	const auto chatId = args["chat_id"].toVariant().toLongLong();
+	const auto targetLanguage = args["target_language"].toString();
+
+	if (!callSession() || !_translation || !_translation->isRunning()) {
+		result["success"] = false;
+		result["error"] = "Translation requires an active session";
+		return result;
+	}
+	if (targetLanguage.isEmpty()) {
+		result["success"] = false;
+		result["error"] = "Missing target_language parameter";
+		return result;
+	}
+
+	auto requests = std::vector<TranslationRequest>();
+	auto notFound = QJsonArray();
+	auto &owner = callSession()->data();
+	for (const auto &value : args["message_ids"].toArray()) {
+		const auto messageId = value.toVariant().toLongLong();
+		const auto item = owner.message(PeerId(chatId), MsgId(messageId));
+		if (!item || item->originalText().text.trimmed().isEmpty()) {
+			notFound.append(messageId);
+			continue;
+		}
+		requests.push_back({ chatId, messageId, item->originalText().text });
+	}
+
+	// Cached and fresh translations come later in one notification.
+	const auto batch = _translation->translate(requests, targetLanguage, [=](
+			quint64 id,
+			std::vector<TranslationResult> results) {
+		sendNotification("notifications/translations", QJsonObject{
+			{"job_id", QString::number(id)},
+			{"chat_id", chatId},
+			{"target_language", targetLanguage},
+			{"translations", TranslationsJson(results)},
+		});
+	});
+
+	result["success"] = true;
+	result["chat_id"] = chatId;
+	result["target_language"] = targetLanguage;
+	result["translations"] = TranslationsJson(batch.ready);
+	result["pending"] = batch.pending;
+	if (batch.pending > 0) {
+		result["job_id"] = QString::number(batch.id);
+		result["note"] = "Pending translations arrive as notifications/translations and stay in translation_cache";
+	}
+	if (!notFound.isEmpty()) {
+		result["not_found"] = notFound;
+	}
 	return result;
 }
 
 QJsonObject Server::toolGenerateVoiceMessage(const QJsonObject &args) {
-	Q_UNUSED(args);
-	QJsonObject result;
-	result["success"] = false;
-	result["status"] = "not_implemented";
-	result["note"] = "Voice synthesis API required";
-	return result;
+	return renderVoice(
+		args.value("preset").toString("default"),
+		args["text"].toString(),
+		args);
 }
 
 QJsonObject Server::toolListVoicePresets(const QJsonObject &args) {
@@ -9847,21 +12575,40 @@ QJsonObject Server::toolDeleteChatRule(const QJsonObject &args) {
 }
 
 QJsonObject Server::toolExecuteChatRules(const QJsonObject &args) {
-	Q_UNUSED(args);
 	QJsonObject result;
-	result["success"] = false;
-	result["status"] = "not_implemented";
-	result["note"] = "Chat rules API required";
+	const auto chatId = args.value("chat_id").toVariant().toLongLong();
+	const auto text = args.value("message").toString();
+	if (text.isEmpty()) {
+		result["success"] = false;
+		result["error"] = "Missing message parameter";
+		return result;
+	}
+
+	// Incoming messages are evaluated as they come, this runs the same
+	// compiled rules over a given text and returns their actions.
+	QJsonArray matched;
+	const auto type = args.value("rule_type").toString();
+	for (const auto rule : _chatRules->evaluate(chatId, text, type)) {
+		matched.append(QJsonObject{
+			{ "rule_id", rule->id },
+			{ "rule_name", rule->name },
+			{ "rule_type", rule->type },
+			{ "chat_id", rule->chatId },
+			{ "priority", rule->priority },
+			{ "actions", rule->actions },
+		});
+	}
+	result["success"] = true;
+	result["chat_id"] = chatId;
+	result["matched_rules"] = matched;
+	result["count"] = matched.size();
+	result["engine"] = _chatRules->stats();
 	return result;
 }
 
 QJsonObject Server::toolGetTaggedMessages(const QJsonObject &args) {
-	Q_UNUSED(args);
-	QJsonObject result;
-	result["success"] = true;
-	result["messages"] = QJsonArray();
-	result["status"] = "not_implemented";
-	return result;
+	// Delegate to working implementation
+	return toolSearchByTag(args);
 }
 
 QJsonObject Server::toolConfigurePaidMessages(const QJsonObject &args) {
@@ -9919,11 +12666,43 @@ QJsonObject Server::toolSetMiniappBudget(const QJsonObject &args) {
 }
 
 QJsonObject Server::toolSearchTransactions(const QJsonObject &args) {
-	Q_UNUSED(args);
 	QJsonObject result;
+	const auto text = args["query"].toString().trimmed();
+	const auto limit = args.value("limit").toInt(50);
+	if (text.isEmpty()) {
+		result["success"] = false;
+		result["error"] = "Missing query parameter";
+		return result;
+	}
+
+	auto query = PreparedQuery(_db, "SELECT id, date, amount, category, description, peer_id FROM wallet_spending "
+				  "WHERE description LIKE ? OR category LIKE ? "
+				  "ORDER BY date DESC LIMIT ?");
+	const auto pattern = '%' + text + '%';
+	query->addBindValue(pattern);
+	query->addBindValue(pattern);
+	query->addBindValue(limit);
+
+	QJsonArray transactions;
+	if (query->exec()) {
+		while (query->next()) {
+			QJsonObject tx;
+			tx["id"] = query->value(0).toLongLong();
+			tx["date"] = query->value(1).toString();
+			tx["amount"] = query->value(2).toDouble();
+			tx["category"] = query->value(3).toString();
+			tx["description"] = query->value(4).toString();
+			if (!query->value(5).isNull()) {
+				tx["peer_id"] = query->value(5).toLongLong();
+			}
+			transactions.append(tx);
+		}
+	}
+
 	result["success"] = true;
-	result["transactions"] = QJsonArray();
-	result["status"] = "not_implemented";
+	result["query"] = text;
+	result["transactions"] = transactions;
+	result["count"] = transactions.size();
 	return result;
 }
 
@@ -10072,11 +12851,49 @@ QJsonObject Server::toolUpdateListing(const QJsonObject &args) {
 }
 
 QJsonObject Server::toolGetMarketTrends(const QJsonObject &args) {
-	Q_UNUSED(args);
 	QJsonObject result;
+	if (!_giftPrices) {
+		result["success"] = false;
+		result["error"] = "Gift prices are not recorded";
+		return result;
+	}
+	const auto period = args.value("period").toString("week");
+	const auto seconds = (period == "day")
+		? qint64(86400)
+		: (period == "month")
+		? qint64(30 * 86400)
+		: qint64(7 * 86400);
+	const auto till = QDateTime::currentSecsSinceEpoch();
+
+	QJsonArray trends;
+	for (const auto giftId : _giftPrices->collections()) {
+		const auto series = _giftPrices->read(giftId, till - seconds, till);
+		if (series.empty()) {
+			continue;
+		}
+		const auto first = series.prices.front();
+		const auto last = series.prices.back();
+		QJsonObject trend;
+		trend["gift_id"] = QString::number(giftId);
+		trend["title"] = _giftPrices->title(giftId);
+		trend["price"] = double(last);
+		trend["min_price"] = double(*std::min_element(
+			series.prices.begin(),
+			series.prices.end()));
+		trend["max_price"] = double(*std::max_element(
+			series.prices.begin(),
+			series.prices.end()));
+		trend["change_percent"] = first
+			? (double(last - first) / first * 100.)
+			: 0.;
+		trend["listings"] = double(series.listings.back());
+		trend["samples"] = series.size();
+		trends.append(trend);
+	}
+
 	result["success"] = true;
-	result["trends"] = QJsonObject();
-	result["status"] = "not_implemented";
+	result["period"] = period;
+	result["trends"] = trends;
 	return result;
 }
 
@@ -10090,11 +12907,42 @@ QJsonObject Server::toolCreatePriceAlert(const QJsonObject &args) {
 }
 
 QJsonObject Server::toolBacktestStrategy(const QJsonObject &args) {
-	Q_UNUSED(args);
 	QJsonObject result;
-	result["success"] = false;
-	result["status"] = "not_implemented";
-	result["note"] = "Backtest API required";
+	const auto strategy = args["strategy"].toObject();
+	const auto giftType = strategy["gift_type"].toString();
+	const auto giftId = _giftPrices ? _giftPrices->resolve(giftType) : 0;
+	if (!giftId) {
+		result["success"] = false;
+		result["error"] = "Unknown gift_type in strategy";
+		return result;
+	}
+	const auto shortWindow = strategy.value("short_window").toInt(4);
+	const auto longWindow = strategy.value("long_window").toInt(24);
+	const auto from = args.value("start_date").toVariant().toLongLong();
+	const auto till = args.contains("end_date")
+		? args["end_date"].toVariant().toLongLong()
+		: QDateTime::currentSecsSinceEpoch();
+
+	const auto series = _giftPrices->read(giftId, from, till);
+	const auto backtest = BacktestCrossover(series, shortWindow, longWindow);
+	if (!backtest.samples) {
+		result["success"] = false;
+		result["error"] = "Not enough price samples for the long window";
+		result["samples"] = series.size();
+		return result;
+	}
+
+	result["success"] = true;
+	result["gift_id"] = QString::number(giftId);
+	result["title"] = _giftPrices->title(giftId);
+	result["strategy"] = "sma_crossover";
+	result["short_window"] = shortWindow;
+	result["long_window"] = std::max(longWindow, shortWindow + 1);
+	result["samples"] = backtest.samples;
+	result["trades"] = backtest.trades;
+	result["profit"] = backtest.profit;
+	result["return_percent"] = backtest.returnPercent;
+	result["hold_return_percent"] = backtest.holdReturnPercent;
 	return result;
 }
 
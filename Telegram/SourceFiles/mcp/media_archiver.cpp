@@ -0,0 +1,665 @@
+// MCP Media Archiver - background download of archived media
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "mcp/media_archiver.h"
+
+#include "mcp/database_pool.h"
+
+#include "apiwrap.h"
+#include "core/file_location.h"
+#include "data/data_document.h"
+#include "data/data_file_origin.h"
+#include "data/data_media_types.h"
+#include "data/data_photo.h"
+#include "data/data_photo_media.h"
+#include "data/data_session.h"
+#include "history/history_item.h"
+#include "main/main_session.h"
+#include "storage/download_manager_mtproto.h"
+#include "storage/storage_account.h"
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QJsonArray>
+#include <QtCore/QPointer>
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+
+namespace MCP {
+namespace {
+
+// The lowest priority of the download queue, see its resetGeneration().
+constexpr auto kBackgroundLoaderPriority = -1;
+constexpr auto kScanBatch = 200;
+constexpr auto kRescanDelay = crl::time(10 * 60 * 1000);
+constexpr auto kYieldDelay = crl::time(3000);
+
+[[nodiscard]] bool Downloadable(const QString &type) {
+	return (type == "photo")
+		|| (type == "video")
+		|| (type == "voice")
+		|| (type == "audio")
+		|| (type == "document")
+		|| (type == "sticker")
+		|| (type == "animation");
+}
+
+} // namespace
+
+bool MediaArchivePolicy::accepts(const QString &type, qint64 size) const {
+	if (!enabled || !Downloadable(type)) {
+		return false;
+	} else if (!types.isEmpty() && !types.contains(type)) {
+		return false;
+	}
+	// An unknown size is checked again once the message is resolved.
+	return !maxFileSize || (size <= maxFileSize);
+}
+
+QJsonObject MediaArchivePolicy::toJson() const {
+	return QJsonObject{
+		{ "enabled", enabled },
+		{ "max_file_size", double(maxFileSize) },
+		{ "max_chat_bytes", double(maxChatBytes) },
+		{ "types", QJsonArray::fromStringList(types) },
+	};
+}
+
+MediaArchiver::MediaArchiver(
+	not_null<Data::Session*> session,
+	not_null<DatabasePool*> pool,
+	const QString &store,
+	QObject *parent)
+: QObject(parent)
+, _session(session)
+, _pool(pool)
+, _store(store) {
+	_timer.setSingleShot(true);
+	connect(&_timer, &QTimer::timeout, this, [=] {
+		pump();
+	});
+}
+
+MediaArchiver::~MediaArchiver() {
+	stop();
+}
+
+bool MediaArchiver::CreateTables(QSqlDatabase &db) {
+	const auto statements = {
+		R"(CREATE TABLE IF NOT EXISTS media_archive_policy (
+			chat_id INTEGER PRIMARY KEY,
+			enabled INTEGER NOT NULL,
+			max_file_size INTEGER DEFAULT 0,
+			max_chat_bytes INTEGER DEFAULT 0,
+			media_types TEXT
+		))",
+		R"(CREATE TABLE IF NOT EXISTS media_store (
+			hash TEXT PRIMARY KEY,
+			path TEXT NOT NULL,
+			size INTEGER,
+			mime_type TEXT,
+			stored_at INTEGER
+		))",
+		// Telegram file ids already in the store, so a forward of the
+		// same file is linked without downloading it.
+		R"(CREATE TABLE IF NOT EXISTS media_store_keys (
+			file_key TEXT PRIMARY KEY,
+			hash TEXT NOT NULL
+		))",
+	};
+	QSqlQuery query(db);
+	for (const auto statement : statements) {
+		if (!query.exec(statement)) {
+			qWarning()
+				<< "MCP MediaArchiver: Failed to create state:"
+				<< query.lastError().text();
+			return false;
+		}
+	}
+	return true;
+}
+
+void MediaArchiver::loadState() {
+	auto db = _pool->reader();
+	QSqlQuery query(db);
+	if (query.exec(R"(
+			SELECT chat_id, enabled, max_file_size, max_chat_bytes, media_types
+			FROM media_archive_policy)")) {
+		while (query.next()) {
+			auto policy = MediaArchivePolicy();
+			policy.enabled = query.value(1).toBool();
+			policy.maxFileSize = query.value(2).toLongLong();
+			policy.maxChatBytes = query.value(3).toLongLong();
+			policy.types = query.value(4).toString().split(
+				',',
+				Qt::SkipEmptyParts);
+			_policies[query.value(0).toLongLong()] = policy;
+		}
+	}
+	if (query.exec("SELECT hash, path FROM media_store")) {
+		while (query.next()) {
+			_hashes.insert(query.value(0).toString(), query.value(1).toString());
+		}
+	}
+	if (query.exec("SELECT file_key, hash FROM media_store_keys")) {
+		while (query.next()) {
+			const auto path = _hashes.value(query.value(1).toString());
+			if (!path.isEmpty()) {
+				_keys.insert(query.value(0).toString(), path);
+			}
+		}
+	}
+	if (query.exec(R"(
+			SELECT chat_id, SUM(COALESCE(media_size, 0))
+			FROM messages
+			WHERE media_path IS NOT NULL
+			GROUP BY chat_id)")) {
+		while (query.next()) {
+			_chatBytes.insert(
+				query.value(0).toLongLong(),
+				query.value(1).toLongLong());
+		}
+	}
+}
+
+void MediaArchiver::savePolicy(
+		qint64 chatId,
+		const MediaArchivePolicy &policy) {
+	_pool->write([=](QSqlDatabase &db) {
+		QSqlQuery query(db);
+		query.prepare(R"(
+			INSERT OR REPLACE INTO media_archive_policy (
+				chat_id, enabled, max_file_size, max_chat_bytes, media_types
+			) VALUES (
+				:chat_id, :enabled, :max_file_size, :max_chat_bytes, :media_types
+			)
+		)");
+		query.bindValue(":chat_id", chatId);
+		query.bindValue(":enabled", policy.enabled ? 1 : 0);
+		query.bindValue(":max_file_size", policy.maxFileSize);
+		query.bindValue(":max_chat_bytes", policy.maxChatBytes);
+		query.bindValue(":media_types", policy.types.isEmpty()
+			? QVariant()
+			: QVariant(policy.types.join(',')));
+		if (!query.exec()) {
+			qWarning()
+				<< "MCP MediaArchiver: Failed to save policy:"
+				<< query.lastError().text();
+		}
+	});
+}
+
+bool MediaArchiver::start() {
+	if (_running) {
+		return true;
+	}
+	loadState();
+	_running = true;
+
+	_session->session().downloaderTaskFinished(
+	) | rpl::start_with_next([=] {
+		checkCurrent();
+	}, _lifetime);
+
+	schedule(0);
+	return true;
+}
+
+void MediaArchiver::stop() {
+	if (!_running) {
+		return;
+	}
+	_running = false;
+	_timer.stop();
+	_lifetime.destroy();
+	if (const auto current = base::take(_current)) {
+		if (current->document && current->document->loading()) {
+			current->document->cancel();
+		}
+		if (!current->incomingPath.isEmpty() && !current->hashing) {
+			QFile::remove(current->incomingPath);
+		}
+	}
+	_queue.clear();
+}
+
+void MediaArchiver::setPolicy(
+		qint64 chatId,
+		const MediaArchivePolicy &policy) {
+	_policies[chatId] = policy;
+	savePolicy(chatId, policy);
+
+	// Walk again from the newest row with the new policy.
+	_queue.clear();
+	_scanCursor = 0;
+	schedule(0);
+}
+
+MediaArchivePolicy MediaArchiver::policy(qint64 chatId) const {
+	const auto i = _policies.find(chatId);
+	if (i != end(_policies)) {
+		return i->second;
+	}
+	const auto j = _policies.find(0);
+	return (j != end(_policies)) ? j->second : MediaArchivePolicy();
+}
+
+void MediaArchiver::setRate(qint64 bytesPerSecond) {
+	_rate = std::max(bytesPerSecond, qint64(0));
+	_nextStartAt = 0;
+	schedule(0);
+}
+
+void MediaArchiver::schedule(crl::time delay) {
+	if (_running) {
+		_timer.start(int(std::max(delay, crl::time(0))));
+	}
+}
+
+void MediaArchiver::pump() {
+	if (!_running || _current) {
+		return;
+	} else if (_queue.empty()) {
+		const auto more = scan();
+		if (_queue.empty()) {
+			if (!more) {
+				_scanCursor = 0;
+			}
+			schedule(more ? 0 : kRescanDelay);
+			return;
+		}
+	}
+	const auto now = crl::now();
+	if (_nextStartAt > now) {
+		schedule(_nextStartAt - now);
+		return;
+	}
+	auto &downloader = _session->session().downloader();
+	if (downloader.hasTasksAbove(kBackgroundLoaderPriority)) {
+		++_yields;
+		schedule(kYieldDelay);
+		return;
+	}
+	const auto entry = _queue.front();
+	_queue.pop_front();
+	resolve(entry);
+}
+
+bool MediaArchiver::scan() {
+	auto enabled = QStringList();
+	for (const auto &[chatId, policy] : _policies) {
+		if (policy.enabled && chatId) {
+			enabled.push_back(QString::number(chatId));
+		}
+	}
+	const auto all = policy(0).enabled;
+	if (!all && enabled.isEmpty()) {
+		return false;
+	}
+	auto sql = QString(R"(
+		SELECT id, chat_id, message_id, COALESCE(media_size, 0), message_type
+		FROM messages
+		WHERE has_media = 1 AND media_path IS NULL)");
+	if (_scanCursor) {
+		sql += " AND id < :cursor";
+	}
+	if (!all) {
+		sql += QString(" AND chat_id IN (%1)").arg(enabled.join(','));
+	}
+	sql += QString(" ORDER BY id DESC LIMIT %1").arg(kScanBatch);
+
+	auto db = _pool->reader();
+	QSqlQuery query(db);
+	query.prepare(sql);
+	if (_scanCursor) {
+		query.bindValue(":cursor", _scanCursor);
+	}
+	if (!query.exec()) {
+		qWarning()
+			<< "MCP MediaArchiver: Scan failed:"
+			<< query.lastError().text();
+		return false;
+	}
+	auto rows = 0;
+	while (query.next()) {
+		++rows;
+		auto entry = Pending{
+			.rowId = query.value(0).toLongLong(),
+			.chatId = query.value(1).toLongLong(),
+			.messageId = query.value(2).toLongLong(),
+			.size = query.value(3).toLongLong(),
+			.type = query.value(4).toString(),
+		};
+		_scanCursor = entry.rowId;
+		if (policy(entry.chatId).accepts(entry.type, entry.size)
+			&& withinChatCap(entry.chatId, entry.size)) {
+			_queue.push_back(std::move(entry));
+		}
+	}
+	return (rows == kScanBatch);
+}
+
+void MediaArchiver::resolve(const Pending &entry) {
+	_current = Current{ .entry = entry };
+	const auto peerId = PeerId(entry.chatId);
+	const auto msgId = MsgId(entry.messageId);
+	if (const auto item = _session->message(peerId, msgId)) {
+		startDownload(item);
+		return;
+	}
+	const auto peer = _session->peerLoaded(peerId);
+	if (!peer) {
+		++_skipped;
+		finishCurrent();
+		return;
+	}
+	// Crawled rows have no HistoryItem, ask the server for the message.
+	_current->resolving = true;
+	_session->session().api().requestMessageData(peer, msgId, crl::guard(this, [=] {
+		if (!_current || !_current->resolving) {
+			return;
+		}
+		_current->resolving = false;
+		if (const auto item = _session->message(peerId, msgId)) {
+			startDownload(item);
+		} else {
+			++_skipped;
+			finishCurrent();
+		}
+	}));
+}
+
+void MediaArchiver::startDownload(not_null<HistoryItem*> item) {
+	auto &current = *_current;
+	const auto &entry = current.entry;
+	const auto media = item->media();
+	const auto document = media ? media->document() : nullptr;
+	const auto photo = (media && !document) ? media->photo() : nullptr;
+	if (!document && !photo) {
+		++_skipped;
+		finishCurrent();
+		return;
+	}
+	const auto size = document
+		? qint64(document->size)
+		: qint64(photo->imageByteSize(Data::PhotoSize::Large));
+	current.fileKey = document
+		? QString("d%1").arg(document->id)
+		: QString("p%1").arg(photo->id);
+	const auto known = _keys.value(current.fileKey);
+	if (!known.isEmpty() && QFileInfo::exists(known)) {
+		link(entry, known, size, true);
+		finishCurrent();
+		return;
+	} else if (!policy(entry.chatId).accepts(entry.type, size)
+		|| !withinChatCap(entry.chatId, size)) {
+		++_skipped;
+		finishCurrent();
+		return;
+	} else if (document && document->loading()) {
+		// Loaded for the user, save() would take over their loader. The
+		// row is found again by the next walk.
+		++_skipped;
+		finishCurrent();
+		return;
+	}
+
+	const auto incoming = QDir(_store).filePath("incoming");
+	if (!QDir().mkpath(incoming)) {
+		failCurrent();
+		return;
+	}
+	current.incomingPath = QDir(incoming).filePath(current.fileKey);
+	current.extension = document
+		? QFileInfo(document->filename()).suffix()
+		: QString("jpg");
+	current.mimeType = document ? document->mimeString() : "image/jpeg";
+	current.document = document;
+	current.photo = photo;
+
+	const auto origin = Data::FileOriginMessage(item->fullId());
+	if (document) {
+		document->save(origin, current.incomingPath, LoadFromCloudOrLocal, true);
+		document->setLoadPriority(kBackgroundLoaderPriority);
+	} else {
+		current.photoMedia = photo->createMediaView();
+		current.photoMedia->wanted(Data::PhotoSize::Large, origin);
+		photo->setLoadPriority(Data::PhotoSize::Large, kBackgroundLoaderPriority);
+	}
+	if (_rate) {
+		_nextStartAt = crl::now() + (size * 1000) / _rate;
+	}
+	checkCurrent();
+}
+
+void MediaArchiver::checkCurrent() {
+	if (!_current || _current->resolving || _current->hashing) {
+		return;
+	}
+	const auto &current = *_current;
+	if (const auto document = current.document) {
+		if (document->status == FileDownloadFailed
+			|| (!document->loading() && document->cancelled())) {
+			failCurrent();
+		} else if (!document->loading()
+			&& QFileInfo::exists(current.incomingPath)) {
+			hashIncoming();
+		}
+	} else if (current.photoMedia) {
+		if (current.photo->failed(Data::PhotoSize::Large)) {
+			failCurrent();
+		} else if (current.photoMedia->loaded()) {
+			if (current.photoMedia->saveToFile(current.incomingPath)) {
+				hashIncoming();
+			} else {
+				failCurrent();
+			}
+		}
+	}
+}
+
+void MediaArchiver::hashIncoming() {
+	_current->hashing = true;
+
+	// Large files, hash them away from the main thread.
+	const auto path = _current->incomingPath;
+	const auto weak = QPointer<MediaArchiver>(this);
+	crl::async([=] {
+		auto file = QFile(path);
+		auto hash = QString();
+		auto size = qint64(0);
+		if (file.open(QIODevice::ReadOnly)) {
+			auto sha = QCryptographicHash(QCryptographicHash::Sha256);
+			if (sha.addData(&file)) {
+				hash = QString::fromLatin1(sha.result().toHex());
+				size = file.size();
+			}
+		}
+		crl::on_main(weak, [=] {
+			stored(hash, size);
+		});
+	});
+}
+
+void MediaArchiver::stored(const QString &hash, qint64 size) {
+	if (!_current || !_current->hashing) {
+		return;
+	} else if (hash.isEmpty()) {
+		failCurrent();
+		return;
+	}
+	const auto &current = *_current;
+	const auto existing = _hashes.value(hash);
+	const auto deduplicated = !existing.isEmpty()
+		&& QFileInfo::exists(existing);
+	const auto path = deduplicated
+		? existing
+		: storePath(hash, current.extension);
+	if (deduplicated) {
+		QFile::remove(current.incomingPath);
+	} else {
+		QDir().mkpath(QFileInfo(path).absolutePath());
+		QFile::remove(path);
+		if (!QFile::rename(current.incomingPath, path)) {
+			qWarning()
+				<< "MCP MediaArchiver: Could not move"
+				<< current.incomingPath
+				<< "to"
+				<< path;
+			failCurrent();
+			return;
+		}
+	}
+	if (const auto document = current.document) {
+		// save() pointed the document to the incoming file.
+		const auto location = Core::FileLocation(path);
+		document->setLocation(location);
+		_session->session().local().writeFileLocation(
+			document->mediaKey(),
+			location);
+	}
+	_hashes.insert(hash, path);
+	_keys.insert(current.fileKey, path);
+
+	const auto fileKey = current.fileKey;
+	const auto mimeType = current.mimeType;
+	const auto now = QDateTime::currentSecsSinceEpoch();
+	_pool->write([=](QSqlDatabase &db) {
+		QSqlQuery query(db);
+		query.prepare(R"(
+			INSERT OR IGNORE INTO media_store (
+				hash, path, size, mime_type, stored_at
+			) VALUES (
+				:hash, :path, :size, :mime_type, :stored_at
+			)
+		)");
+		query.bindValue(":hash", hash);
+		query.bindValue(":path", path);
+		query.bindValue(":size", size);
+		query.bindValue(":mime_type", mimeType);
+		query.bindValue(":stored_at", now);
+		if (!query.exec()) {
+			qWarning()
+				<< "MCP MediaArchiver: Failed to index file:"
+				<< query.lastError().text();
+			return;
+		}
+		query.prepare(R"(
+			INSERT OR REPLACE INTO media_store_keys (file_key, hash)
+			VALUES (:file_key, :hash)
+		)");
+		query.bindValue(":file_key", fileKey);
+		query.bindValue(":hash", hash);
+		if (!query.exec()) {
+			qWarning()
+				<< "MCP MediaArchiver: Failed to index file key:"
+				<< query.lastError().text();
+		}
+	});
+	link(current.entry, path, size, deduplicated);
+	finishCurrent();
+}
+
+void MediaArchiver::link(
+		const Pending &entry,
+		const QString &path,
+		qint64 size,
+		bool deduplicated) {
+	// Re-archiving the message replaces the row and clears media_path,
+	// the next walk links it again through media_store_keys.
+	_pool->write([=](QSqlDatabase &db) {
+		QSqlQuery query(db);
+		query.prepare(R"(
+			UPDATE messages
+			SET media_path = :media_path,
+				media_size = COALESCE(media_size, :media_size)
+			WHERE chat_id = :chat_id AND message_id = :message_id
+		)");
+		query.bindValue(":media_path", path);
+		query.bindValue(":media_size", size);
+		query.bindValue(":chat_id", entry.chatId);
+		query.bindValue(":message_id", entry.messageId);
+		if (!query.exec()) {
+			qWarning()
+				<< "MCP MediaArchiver: Failed to store media path:"
+				<< query.lastError().text();
+		}
+	});
+	_chatBytes[entry.chatId] += size;
+	if (deduplicated) {
+		++_deduplicated;
+		_bytesDeduplicated += size;
+	} else {
+		++_downloaded;
+		_bytesDownloaded += size;
+	}
+}
+
+void MediaArchiver::finishCurrent() {
+	_current = std::nullopt;
+	schedule(0);
+}
+
+void MediaArchiver::failCurrent() {
+	++_failed;
+	if (!_current->incomingPath.isEmpty()) {
+		QFile::remove(_current->incomingPath);
+	}
+	finishCurrent();
+}
+
+bool MediaArchiver::withinChatCap(qint64 chatId, qint64 size) const {
+	const auto cap = policy(chatId).maxChatBytes;
+	return !cap || (_chatBytes.value(chatId) + size <= cap);
+}
+
+QString MediaArchiver::storePath(
+		const QString &hash,
+		const QString &extension) const {
+	const auto name = extension.isEmpty()
+		? hash
+		: (hash + '.' + extension);
+	return QDir(_store).filePath(hash.left(2) + '/' + name);
+}
+
+QJsonObject MediaArchiver::status() const {
+	auto policies = QJsonArray();
+	for (const auto &[chatId, policy] : _policies) {
+		auto entry = policy.toJson();
+		entry["chat_id"] = QString::number(chatId);
+		policies.append(entry);
+	}
+	auto result = QJsonObject{
+		{ "running", _running },
+		{ "store", _store },
+		{ "rate_bytes_per_second", double(_rate) },
+		{ "queued", int(_queue.size()) },
+		{ "downloaded", _downloaded },
+		{ "deduplicated", _deduplicated },
+		{ "failed", _failed },
+		{ "skipped", _skipped },
+		{ "yields", _yields },
+		{ "bytes_downloaded", double(_bytesDownloaded) },
+		{ "bytes_deduplicated", double(_bytesDeduplicated) },
+		{ "stored_files", int(_hashes.size()) },
+		{ "policies", policies },
+	};
+	if (_current) {
+		result["current"] = QJsonObject{
+			{ "chat_id", QString::number(_current->entry.chatId) },
+			{ "message_id", double(_current->entry.messageId) },
+			{ "state", (_current->resolving
+				? "resolving"
+				: _current->hashing
+				? "storing"
+				: "loading") },
+		};
+	}
+	return result;
+}
+
+} // namespace MCP
@@ -0,0 +1,153 @@
+// MCP Media Archiver - background download of archived media
+//
+// This file is part of Telegram Desktop MCP integration.
+// Walks the archived messages that have media but no media_path and
+// downloads the files at the lowest loader priority, one at a time and
+// only while nothing else waits in the download queue. Files are stored
+// by the SHA-256 of their content, a file already in the store is not
+// downloaded or written again.
+
+#pragma once
+
+#include "data/data_msg_id.h"
+
+#include <QtCore/QHash>
+#include <QtCore/QJsonObject>
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QTimer>
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <optional>
+
+namespace Data {
+class Session;
+class PhotoMedia;
+} // namespace Data
+
+class DocumentData;
+class QSqlDatabase;
+class HistoryItem;
+class PhotoData;
+
+namespace MCP {
+
+class DatabasePool;
+
+struct MediaArchivePolicy {
+	bool enabled = false;
+	qint64 maxFileSize = 0; // bytes, 0 = no limit
+	qint64 maxChatBytes = 0; // bytes, 0 = no limit
+	QStringList types; // message types, empty = every downloadable one
+
+	[[nodiscard]] bool accepts(const QString &type, qint64 size) const;
+	[[nodiscard]] QJsonObject toJson() const;
+};
+
+class MediaArchiver : public QObject {
+	Q_OBJECT
+
+public:
+	// Files go to <store>/<first two hex digits>/<sha256>.<extension>.
+	MediaArchiver(
+		not_null<Data::Session*> session,
+		not_null<DatabasePool*> pool,
+		const QString &store,
+		QObject *parent = nullptr);
+	~MediaArchiver();
+
+	// Archive schema migration creating the policy and store tables.
+	static bool CreateTables(QSqlDatabase &db);
+
+	// Loads the policies and the store index, then starts walking.
+	bool start();
+	void stop();
+
+	// chatId 0 sets the policy of every chat without its own.
+	void setPolicy(qint64 chatId, const MediaArchivePolicy &policy);
+	[[nodiscard]] MediaArchivePolicy policy(qint64 chatId) const;
+	// Bytes per second started, 512 KB by default, 0 = no limit. Not
+	// persisted.
+	void setRate(qint64 bytesPerSecond);
+
+	[[nodiscard]] QJsonObject status() const;
+
+private:
+	struct Pending {
+		qint64 rowId = 0;
+		qint64 chatId = 0;
+		qint64 messageId = 0;
+		qint64 size = 0;
+		QString type;
+	};
+	struct Current {
+		Pending entry;
+		QString fileKey;
+		QString extension;
+		QString mimeType;
+		QString incomingPath;
+		DocumentData *document = nullptr;
+		PhotoData *photo = nullptr;
+		std::shared_ptr<Data::PhotoMedia> photoMedia;
+		bool resolving = false;
+		bool hashing = false;
+	};
+
+	void loadState();
+	void savePolicy(qint64 chatId, const MediaArchivePolicy &policy);
+
+	void schedule(crl::time delay);
+	void pump();
+	bool scan();
+	void resolve(const Pending &entry);
+	void startDownload(not_null<HistoryItem*> item);
+	void checkCurrent();
+	void hashIncoming();
+	void stored(const QString &hash, qint64 size);
+	void link(
+		const Pending &entry,
+		const QString &path,
+		qint64 size,
+		bool deduplicated);
+	void finishCurrent();
+	void failCurrent();
+
+	[[nodiscard]] bool withinChatCap(qint64 chatId, qint64 size) const;
+	[[nodiscard]] QString storePath(
+		const QString &hash,
+		const QString &extension) const;
+
+	const not_null<Data::Session*> _session;
+	const not_null<DatabasePool*> _pool;
+	const QString _store;
+
+	std::map<qint64, MediaArchivePolicy> _policies;
+	qint64 _rate = 512 * 1024;
+
+	QHash<QString, QString> _keys; // file key -> stored path
+	QHash<QString, QString> _hashes; // content hash -> stored path
+	QHash<qint64, qint64> _chatBytes;
+
+	std::deque<Pending> _queue;
+	qint64 _scanCursor = 0; // Next scan starts below this row id, 0 = top.
+	std::optional<Current> _current;
+	crl::time _nextStartAt = 0;
+	QTimer _timer;
+	bool _running = false;
+
+	int _downloaded = 0;
+	int _deduplicated = 0;
+	int _failed = 0;
+	int _skipped = 0;
+	int _yields = 0;
+	qint64 _bytesDownloaded = 0;
+	qint64 _bytesDeduplicated = 0;
+
+	rpl::lifetime _lifetime;
+
+};
+
+} // namespace MCP
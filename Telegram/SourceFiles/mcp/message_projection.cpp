@@ -0,0 +1,221 @@
+// MCP Message Projection - fields and format of message lists
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "mcp/message_projection.h"
+
+namespace MCP {
+namespace {
+
+// Names of the same data in the live messages and the archived rows.
+[[nodiscard]] QStringList AliasKeys(const QString &field) {
+	if (field == "date") {
+		return { "timestamp" };
+	} else if (field == "text") {
+		return { "content" };
+	} else if (field == "from_user") {
+		return { "user_id", "username", "first_name", "last_name" };
+	}
+	return {};
+}
+
+// Members that go to the fixed columns in the compact format.
+[[nodiscard]] bool ColumnKey(const QString &key) {
+	return (key == "message_id")
+		|| (key == "date")
+		|| (key == "timestamp")
+		|| (key == "text")
+		|| (key == "content")
+		|| (key == "from_user")
+		|| (key == "user_id")
+		|| (key == "username")
+		|| (key == "first_name")
+		|| (key == "last_name");
+}
+
+[[nodiscard]] QStringList ParseFields(const QJsonValue &value) {
+	auto result = QStringList();
+	if (value.isArray()) {
+		for (const auto &field : value.toArray()) {
+			result.push_back(field.toString().trimmed());
+		}
+	} else {
+		for (const auto &field : value.toString().split(',')) {
+			result.push_back(field.trimmed());
+		}
+	}
+	result.removeAll(QString());
+	return result;
+}
+
+} // namespace
+
+MessageProjection MessageProjection::FromArguments(const QJsonObject &args) {
+	auto result = MessageProjection();
+	result._compact = (args.value("format").toString() == "compact");
+	const auto fields = ParseFields(args.value("fields"));
+	if (fields.isEmpty()) {
+		return result;
+	}
+	result._keys.insert("message_id");
+	for (const auto &field : fields) {
+		result._keys.insert(field);
+		for (const auto &key : AliasKeys(field)) {
+			result._keys.insert(key);
+		}
+	}
+	return result;
+}
+
+bool MessageProjection::wants(const QString &field) const {
+	return _keys.isEmpty() || _keys.contains(field);
+}
+
+QJsonObject MessageProjection::apply(const QJsonObject &message) const {
+	if (_keys.isEmpty()) {
+		return message;
+	}
+	auto result = QJsonObject();
+	for (auto i = message.begin(); i != message.end(); ++i) {
+		if (_keys.contains(i.key())) {
+			result.insert(i.key(), i.value());
+		}
+	}
+	return result;
+}
+
+QJsonObject MessageProjection::FieldsSchema() {
+	return QJsonObject{
+		{ "type", "array" },
+		{ "items", QJsonObject{ { "type", "string" } } },
+		{ "description", "Only these message fields, e.g. [\"text\", \"date\"]. message_id is always included" },
+	};
+}
+
+QJsonObject MessageProjection::FormatSchema() {
+	return QJsonObject{
+		{ "type", "string" },
+		{ "enum", QJsonArray{ "full", "compact" } },
+		{ "default", "full" },
+		{ "description", "compact: parallel arrays ids, dates, senders, texts with the senders in sender_table" },
+	};
+}
+
+CompactMessages::CompactMessages(const MessageProjection &projection)
+: _projection(projection) {
+}
+
+void CompactMessages::add(const QJsonObject &message) {
+	_ids.append(message.value("message_id"));
+	if (_projection.wants("date")) {
+		const auto timestamp = message.value("timestamp");
+		_dates.append(timestamp.isUndefined()
+			? message.value("date")
+			: timestamp);
+	}
+	if (_projection.wants("from_user")) {
+		_senders.append(sender(message));
+	}
+	if (_projection.wants("text")) {
+		const auto text = message.value("text");
+		_texts.append(text.isUndefined()
+			? message.value("content")
+			: text);
+	}
+	for (auto i = message.begin(); i != message.end(); ++i) {
+		const auto key = i.key();
+		if (ColumnKey(key)) {
+			continue;
+		}
+		auto index = _columnIndices.value(key, -1);
+		if (index < 0) {
+			index = int(_columns.size());
+			_columnIndices.insert(key, index);
+			_columns.emplace_back(key, QJsonArray());
+		}
+		// Rows without the member get nulls.
+		auto &column = _columns[index].second;
+		while (column.size() < _count) {
+			column.append(QJsonValue::Null);
+		}
+		column.append(i.value());
+	}
+	++_count;
+}
+
+int CompactMessages::sender(const QJsonObject &message) {
+	auto entry = QJsonObject();
+	if (message.contains("from_user")) {
+		entry = message.value("from_user").toObject();
+	} else if (const auto id = message.value("user_id").toVariant()
+			.toLongLong()) {
+		const auto name = (message.value("first_name").toString()
+			+ ' '
+			+ message.value("last_name").toString()).trimmed();
+		entry["id"] = QString::number(id);
+		entry["name"] = name;
+		const auto username = message.value("username").toString();
+		if (!username.isEmpty()) {
+			entry["username"] = username;
+		}
+	}
+	const auto id = entry.value("id").toVariant().toString();
+	if (id.isEmpty()) {
+		return -1;
+	}
+	const auto i = _senderIndices.constFind(id);
+	if (i != _senderIndices.cend()) {
+		return *i;
+	}
+	const auto index = int(_senderTable.size());
+	_senderIndices.insert(id, index);
+	_senderTable.append(entry);
+	return index;
+}
+
+void CompactMessages::write(QJsonObject &result, const QString &key) const {
+	auto columns = QJsonObject{ { "ids", _ids } };
+	if (_projection.wants("date")) {
+		columns["dates"] = _dates;
+	}
+	if (_projection.wants("from_user")) {
+		columns["senders"] = _senders;
+		result["sender_table"] = _senderTable;
+	}
+	if (_projection.wants("text")) {
+		columns["texts"] = _texts;
+	}
+	for (const auto &[name, values] : _columns) {
+		auto column = values;
+		while (column.size() < _count) {
+			column.append(QJsonValue::Null);
+		}
+		columns[name] = column;
+	}
+	result[key] = columns;
+	result["format"] = "compact";
+}
+
+void WriteMessages(
+		QJsonObject &result,
+		const QString &key,
+		const QJsonArray &messages,
+		const MessageProjection &projection) {
+	if (projection.compact()) {
+		auto compact = CompactMessages(projection);
+		for (const auto &message : messages) {
+			compact.add(message.toObject());
+		}
+		compact.write(result, key);
+	} else if (projection.all()) {
+		result[key] = messages;
+	} else {
+		auto projected = QJsonArray();
+		for (const auto &message : messages) {
+			projected.append(projection.apply(message.toObject()));
+		}
+		result[key] = projected;
+	}
+}
+
+} // namespace MCP
@@ -0,0 +1,86 @@
+// MCP Message Projection - fields and format of message lists
+//
+// This file is part of Telegram Desktop MCP integration.
+// Tools returning messages accept "fields" to keep only some of the
+// members and "format": "compact" to get parallel arrays instead of one
+// object per message, with every sender written once in a side table.
+
+#pragma once
+
+#include <QtCore/QHash>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonObject>
+#include <QtCore/QSet>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+#include <utility>
+#include <vector>
+
+namespace MCP {
+
+class MessageProjection final {
+public:
+	// Every field in the full format.
+	MessageProjection() = default;
+
+	// "fields" is an array of names or a comma separated string. The
+	// names are those of live messages, "text", "date" and "from_user"
+	// also select "content", "timestamp" and the sender columns of the
+	// archived rows. "message_id" is always kept.
+	[[nodiscard]] static MessageProjection FromArguments(
+		const QJsonObject &args);
+
+	[[nodiscard]] bool all() const {
+		return _keys.isEmpty();
+	}
+	[[nodiscard]] bool compact() const {
+		return _compact;
+	}
+	[[nodiscard]] bool wants(const QString &field) const;
+	[[nodiscard]] QJsonObject apply(const QJsonObject &message) const;
+
+	// Properties of the "fields" and "format" arguments in tool schemas.
+	[[nodiscard]] static QJsonObject FieldsSchema();
+	[[nodiscard]] static QJsonObject FormatSchema();
+
+private:
+	QSet<QString> _keys;
+	bool _compact = false;
+
+};
+
+class CompactMessages final {
+public:
+	explicit CompactMessages(const MessageProjection &projection);
+
+	void add(const QJsonObject &message);
+
+	// Puts the columns to result[key] and the senders to
+	// result["sender_table"], "senders" indexes it, -1 without a sender.
+	void write(QJsonObject &result, const QString &key) const;
+
+private:
+	[[nodiscard]] int sender(const QJsonObject &message);
+
+	const MessageProjection _projection;
+	QJsonArray _ids;
+	QJsonArray _dates;
+	QJsonArray _senders;
+	QJsonArray _texts;
+	std::vector<std::pair<QString, QJsonArray>> _columns;
+	QHash<QString, int> _columnIndices;
+	QJsonArray _senderTable;
+	QHash<QString, int> _senderIndices;
+	int _count = 0;
+
+};
+
+// messages in the requested format, at result[key].
+void WriteMessages(
+	QJsonObject &result,
+	const QString &key,
+	const QJsonArray &messages,
+	const MessageProjection &projection);
+
+} // namespace MCP
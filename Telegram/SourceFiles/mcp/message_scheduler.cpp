@@ -18,7 +18,20 @@
 #include <QtSql/QSqlQuery>
 #include <QtSql/QSqlError>
 
+#include <algorithm>
+
 namespace MCP {
+namespace {
+
+// Wakes up at least hourly, so a wall clock change can't strand a deadline.
+constexpr auto kMaxTimerMs = qint64(60 * 60 * 1000);
+constexpr auto kCompactSlack = 64;
+
+constexpr auto kLater = [](const auto &a, const auto &b) {
+	return a.dueMs > b.dueMs;
+};
+
+} // namespace
 
 MessageScheduler::MessageScheduler(QObject *parent)
 : QObject(parent) {
@@ -49,13 +62,20 @@ bool MessageScheduler::start(Main::Session *session) {
 		loadScheduledMessages();
 	}
 
-	// Set up timer for checking scheduled messages
+	// One shot timer, armed for the earliest deadline
 	_checkTimer = new QTimer(this);
+	_checkTimer->setSingleShot(true);
+	_checkTimer->setTimerType(Qt::PreciseTimer);
 	connect(_checkTimer, &QTimer::timeout, this, &MessageScheduler::checkScheduledMessages);
-	_checkTimer->start(_checkIntervalSeconds * 1000);
 
 	_isRunning = true;
 
+	_deadlines.clear();
+	for (const auto &message : _scheduledMessages) {
+		pushDeadline(message);
+	}
+	armTimer();
+
 	return true;
 }
 
@@ -69,6 +89,7 @@ void MessageScheduler::stop() {
 		delete _checkTimer;
 		_checkTimer = nullptr;
 	}
+	_deadlines.clear();
 
 	_session = nullptr;
 	_isRunning = false;
@@ -117,6 +138,8 @@ qint64 MessageScheduler::scheduleMessage(
 
 	// Store message
 	_scheduledMessages[message.scheduleId] = message;
+	pushDeadline(message);
+	armTimer();
 
 	// Save to disk
 	if (_persistenceEnabled) {
@@ -165,6 +188,8 @@ qint64 MessageScheduler::scheduleRecurringMessage(
 
 	// Store message
 	_scheduledMessages[message.scheduleId] = message;
+	pushDeadline(message);
+	armTimer();
 
 	// Save to disk
 	if (_persistenceEnabled) {
@@ -194,6 +219,7 @@ bool MessageScheduler::cancelScheduledMessage(qint64 scheduleId) {
 
 	message.status = ScheduleStatus::Cancelled;
 	updateScheduleStatus(scheduleId, ScheduleStatus::Cancelled);
+	armTimer();
 
 	// Update stats
 	_stats.pendingCount--;
@@ -227,6 +253,10 @@ bool MessageScheduler::updateScheduledMessage(qint64 scheduleId, const QJsonObje
 	if (updates.contains("media")) {
 		message.media = updates["media"].toObject();
 	}
+	if (updates.contains("scheduledTime")) {
+		pushDeadline(message);
+		armTimer();
+	}
 
 	// Save changes
 	if (_persistenceEnabled) {
@@ -258,6 +288,8 @@ bool MessageScheduler::rescheduleMessage(qint64 scheduleId, const QDateTime &new
 	message.scheduledTime = newTime;
 	message.status = ScheduleStatus::Pending;
 	message.retryCount = 0;
+	pushDeadline(message);
+	armTimer();
 
 	// Save changes
 	if (_persistenceEnabled) {
@@ -364,6 +396,10 @@ int MessageScheduler::cancelAllScheduled(qint64 chatId) {
 		}
 	}
 
+	if (cancelled) {
+		armTimer();
+	}
+
 	_stats.pendingCount -= cancelled;
 	_stats.cancelledCount += cancelled;
 
@@ -377,9 +413,13 @@ int MessageScheduler::rescheduleAll(qint64 chatId, int delayMinutes) {
 		if (message.chatId == chatId && message.status == ScheduleStatus::Pending) {
 			message.scheduledTime = message.scheduledTime.addSecs(delayMinutes * 60);
 			saveScheduledMessage(message);
+			pushDeadline(message);
 			rescheduled++;
 		}
 	}
+	if (rescheduled) {
+		armTimer();
+	}
 
 	return rescheduled;
 }
@@ -421,22 +461,23 @@ void MessageScheduler::checkScheduledMessages() {
 		return;
 	}
 
-	QDateTime now = QDateTime::currentDateTime();
-
-	for (auto &message : _scheduledMessages) {
-		// Check if it's time to send
-		if (message.status == ScheduleStatus::Pending && isTimeToSend(message.scheduledTime)) {
-			sendScheduledMessage(message);
+	// Only the due entries are touched, sending may push new ones.
+	const auto now = QDateTime::currentMSecsSinceEpoch();
+	while (!_deadlines.empty() && _deadlines.front().dueMs <= now) {
+		std::pop_heap(begin(_deadlines), end(_deadlines), kLater);
+		const auto deadline = _deadlines.back();
+		_deadlines.pop_back();
+		if (!isCurrent(deadline)) {
+			continue;
 		}
-
-		// Check for retries
-		if (message.status == ScheduleStatus::Failed && message.retryCount < _maxRetries) {
-			QDateTime nextRetry = message.scheduledTime.addSecs(_retryDelaySeconds * (message.retryCount + 1));
-			if (now >= nextRetry) {
-				retryFailedMessage(message);
-			}
+		auto &message = _scheduledMessages[deadline.scheduleId];
+		if (message.status == ScheduleStatus::Pending) {
+			sendScheduledMessage(message);
+		} else if (message.status == ScheduleStatus::Failed) {
+			retryFailedMessage(message);
 		}
 	}
+	armTimer();
 }
 
 void MessageScheduler::handleSendResult(qint64 scheduleId, bool success, const QString &error) {
@@ -468,6 +509,10 @@ void MessageScheduler::handleSendResult(qint64 scheduleId, bool success, const Q
 		_stats.pendingCount--;
 		_stats.failedCount++;
 
+		// Queues the retry while any are left.
+		pushDeadline(message);
+		armTimer();
+
 		Q_EMIT messageFailed(scheduleId, error);
 	}
 }
@@ -718,11 +763,86 @@ bool MessageScheduler::isTimeToSend(const QDateTime &scheduledTime) const {
 }
 
 int MessageScheduler::getSecondsUntilNext() const {
-	QDateTime now = QDateTime::currentDateTime();
-	QDateTime nextCheck = now.addSecs(_checkIntervalSeconds);
+	// armTimer() never leaves a stale entry on top.
+	if (_deadlines.empty()) {
+		return -1;
+	}
+	const auto now = QDateTime::currentMSecsSinceEpoch();
+	const auto ms = std::max(_deadlines.front().dueMs - now, qint64(0));
+	return static_cast<int>((ms + 999) / 1000);
+}
 
-	qint64 seconds = now.secsTo(nextCheck);
-	return static_cast<int>(seconds);
+qint64 MessageScheduler::deadlineOf(const ScheduledMessage &message) const {
+	if (!message.scheduledTime.isValid()) {
+		return -1;
+	}
+	const auto due = message.scheduledTime.toMSecsSinceEpoch();
+	switch (message.status) {
+	case ScheduleStatus::Pending:
+		return due;
+	case ScheduleStatus::Failed:
+		return (message.retryCount < _maxRetries)
+			? due + qint64(_retryDelaySeconds) * 1000 * (message.retryCount + 1)
+			: -1;
+	default:
+		return -1;
+	}
+}
+
+bool MessageScheduler::isCurrent(const Deadline &deadline) const {
+	const auto i = _scheduledMessages.constFind(deadline.scheduleId);
+	return (i != _scheduledMessages.cend())
+		&& (deadlineOf(*i) == deadline.dueMs);
+}
+
+void MessageScheduler::pushDeadline(const ScheduledMessage &message) {
+	const auto due = deadlineOf(message);
+	if (due < 0) {
+		return;
+	}
+	_deadlines.push_back({ due, message.scheduleId });
+	std::push_heap(begin(_deadlines), end(_deadlines), kLater);
+	if (_deadlines.size() > 2 * size_t(_scheduledMessages.size()) + kCompactSlack) {
+		compactDeadlines();
+	}
+}
+
+void MessageScheduler::armTimer() {
+	if (!_isRunning || !_checkTimer) {
+		return;
+	}
+	while (!_deadlines.empty() && !isCurrent(_deadlines.front())) {
+		std::pop_heap(begin(_deadlines), end(_deadlines), kLater);
+		_deadlines.pop_back();
+	}
+	if (_deadlines.empty()) {
+		_checkTimer->stop();
+		return;
+	}
+	const auto now = QDateTime::currentMSecsSinceEpoch();
+	const auto wait = std::clamp(
+		_deadlines.front().dueMs - now,
+		qint64(0),
+		kMaxTimerMs);
+	_checkTimer->start(static_cast<int>(wait));
+}
+
+void MessageScheduler::compactDeadlines() {
+	// Lots of edits leave stale and duplicate entries, drop them all.
+	const auto stale = std::remove_if(
+		begin(_deadlines),
+		end(_deadlines),
+		[&](const Deadline &deadline) { return !isCurrent(deadline); });
+	_deadlines.erase(stale, end(_deadlines));
+	std::sort(begin(_deadlines), end(_deadlines), [](const auto &a, const auto &b) {
+		return a.scheduleId < b.scheduleId;
+	});
+	const auto duplicates = std::unique(
+		begin(_deadlines),
+		end(_deadlines),
+		[](const auto &a, const auto &b) { return a.scheduleId == b.scheduleId; });
+	_deadlines.erase(duplicates, end(_deadlines));
+	std::make_heap(begin(_deadlines), end(_deadlines), kLater);
 }
 
 bool MessageScheduler::validateScheduleTime(const QDateTime &time, QString &error) const {
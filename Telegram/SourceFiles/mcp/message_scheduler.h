@@ -12,6 +12,7 @@
 #include <QtCore/QHash>
 #include <QtCore/QVector>
 #include <memory>
+#include <vector>
 
 namespace Main {
 class Session;
@@ -57,6 +58,11 @@ struct SchedulerStats {
 };
 
 // Message scheduler class
+//
+// Due times live in a min-heap and a single timer is armed for the
+// earliest of them, re-armed whenever a schedule changes. Changed or
+// cancelled schedules leave their old heap entry behind, an entry is
+// only acted upon while it still matches the message it points to.
 class MessageScheduler : public QObject {
 	Q_OBJECT
 
@@ -150,6 +156,17 @@ private:
 	bool isTimeToSend(const QDateTime &scheduledTime) const;
 	int getSecondsUntilNext() const;
 
+	// Deadlines
+	struct Deadline {
+		qint64 dueMs = 0;
+		qint64 scheduleId = 0;
+	};
+	[[nodiscard]] qint64 deadlineOf(const ScheduledMessage &message) const;
+	[[nodiscard]] bool isCurrent(const Deadline &deadline) const;
+	void pushDeadline(const ScheduledMessage &message);
+	void armTimer();
+	void compactDeadlines();
+
 	// Validation
 	bool validateScheduleTime(const QDateTime &time, QString &error) const;
 	bool validateChatId(qint64 chatId, QString &error) const;
@@ -163,9 +180,9 @@ private:
 	QHash<qint64, ScheduledMessage> _scheduledMessages;
 	qint64 _nextScheduleId = 1;
 
-	// Timer for checking scheduled messages
+	// Timer armed for the earliest deadline
 	QTimer *_checkTimer = nullptr;
-	int _checkIntervalSeconds = 60; // Check every minute
+	std::vector<Deadline> _deadlines; // Min-heap by dueMs.
 
 	// Retry configuration
 	int _maxRetries = 3;
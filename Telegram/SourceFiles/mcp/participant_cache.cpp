@@ -0,0 +1,667 @@
+// MCP Participant Cache - persistent member lists of large groups
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "mcp/participant_cache.h"
+
+#include "mcp/database_pool.h"
+
+#include "api/api_chat_participants.h"
+#include "api/api_hash.h"
+#include "apiwrap.h"
+#include "data/data_channel.h"
+#include "data/data_peer.h"
+#include "data/data_session.h"
+#include "main/main_session.h"
+#include "ui/text/text_entity.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QJsonArray>
+#include <QtCore/QStringList>
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+
+namespace MCP {
+namespace {
+
+// The most channels.getParticipants returns at once.
+constexpr auto kPageSize = 200;
+constexpr auto kPageDelay = crl::time(1000);
+constexpr auto kRefreshInterval = TimeId(60 * 60);
+constexpr auto kMaxQueryLimit = 1000;
+constexpr auto kMaxSearchWords = 4;
+
+struct Row {
+	PeerId peerId = 0;
+	int position = 0;
+	QString type;
+	QString rank;
+	QString name;
+	QString username;
+	qint64 byId = 0;
+	TimeId since = 0;
+	QStringList words;
+};
+
+[[nodiscard]] QString TypeName(Api::ChatParticipant::Type type) {
+	using Type = Api::ChatParticipant::Type;
+	switch (type) {
+	case Type::Creator: return u"creator"_q;
+	case Type::Admin: return u"admin"_q;
+	case Type::Member: return u"member"_q;
+	case Type::Restricted: return u"restricted"_q;
+	case Type::Left:
+	case Type::Banned: return QString();
+	}
+	Unexpected("Type in TypeName.");
+}
+
+// Empty type for the participants that are not members any more.
+[[nodiscard]] Row PrepareRow(
+		not_null<Data::Session*> session,
+		const Api::ChatParticipant &participant,
+		int position) {
+	auto result = Row{
+		.peerId = participant.id(),
+		.position = position,
+		.type = TypeName(participant.type()),
+		.rank = participant.rank(),
+		.byId = qint64(peerFromUser(participant.by()).value),
+		.since = std::max({
+			participant.memberSince(),
+			participant.promotedSince(),
+			participant.restrictedSince(),
+		}),
+	};
+	if (const auto peer = session->peerLoaded(result.peerId)) {
+		result.name = peer->name();
+		result.username = peer->username();
+		for (const auto &word : peer->nameWords()) {
+			result.words.push_back(word);
+		}
+	}
+	return result;
+}
+
+[[nodiscard]] bool DeleteRow(
+		QSqlDatabase &db,
+		qint64 channelId,
+		PeerId peerId) {
+	auto query = QSqlQuery(db);
+	for (const auto table : {
+			"channel_participant_words",
+			"channel_participants" }) {
+		query.prepare(QString(R"(
+			DELETE FROM %1 WHERE channel_id = :channel_id AND peer_id = :peer_id
+		)").arg(table));
+		query.bindValue(":channel_id", channelId);
+		query.bindValue(":peer_id", qint64(peerId.value));
+		if (!query.exec()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// With keepPosition a cached row keeps its place and a new one goes on top.
+[[nodiscard]] bool WriteRow(
+		QSqlDatabase &db,
+		qint64 channelId,
+		const Row &row,
+		bool keepPosition) {
+	auto query = QSqlQuery(db);
+	query.prepare(R"(
+		DELETE FROM channel_participant_words
+		WHERE channel_id = :channel_id AND peer_id = :peer_id
+	)");
+	query.bindValue(":channel_id", channelId);
+	query.bindValue(":peer_id", qint64(row.peerId.value));
+	if (!query.exec()) {
+		return false;
+	}
+	query.prepare(QString(R"(
+		INSERT INTO channel_participants (
+			channel_id, peer_id, position, type, rank, name, username,
+			by_id, since, updated_at
+		) VALUES (
+			:channel_id, :peer_id, %1, :type, :rank, :name, :username,
+			:by_id, :since, :updated_at
+		) ON CONFLICT (channel_id, peer_id) DO UPDATE SET
+			%2
+			type = excluded.type,
+			rank = excluded.rank,
+			name = excluded.name,
+			username = excluded.username,
+			by_id = excluded.by_id,
+			since = excluded.since,
+			updated_at = excluded.updated_at
+	)").arg(
+		(keepPosition
+			? u"(SELECT COALESCE(MIN(position), 0) - 1 "
+				"FROM channel_participants "
+				"WHERE channel_id = :top_channel_id)"_q
+			: u":position"_q),
+		(keepPosition ? QString() : u"position = excluded.position,"_q)));
+	query.bindValue(":channel_id", channelId);
+	query.bindValue(":peer_id", qint64(row.peerId.value));
+	if (keepPosition) {
+		query.bindValue(":top_channel_id", channelId);
+	} else {
+		query.bindValue(":position", row.position);
+	}
+	query.bindValue(":type", row.type);
+	query.bindValue(":rank", row.rank);
+	query.bindValue(":name", row.name);
+	query.bindValue(":username", row.username);
+	query.bindValue(":by_id", row.byId);
+	query.bindValue(":since", row.since);
+	query.bindValue(":updated_at", QDateTime::currentSecsSinceEpoch());
+	if (!query.exec()) {
+		return false;
+	}
+	query.prepare(R"(
+		INSERT OR IGNORE INTO channel_participant_words (
+			channel_id, word, peer_id
+		) VALUES (
+			:channel_id, :word, :peer_id
+		)
+	)");
+	for (const auto &word : row.words) {
+		query.bindValue(":channel_id", channelId);
+		query.bindValue(":word", word);
+		query.bindValue(":peer_id", qint64(row.peerId.value));
+		if (!query.exec()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+} // namespace
+
+ParticipantCache::ParticipantCache(
+	not_null<Data::Session*> session,
+	not_null<DatabasePool*> pool)
+: _session(session)
+, _pool(pool)
+, _api(&session->session().mtp())
+, _pageTimer([=] {
+	if (_sync) {
+		if (const auto channel = _session->channelLoaded(
+				peerToChannel(PeerId(_sync->channelId)))) {
+			requestPage(channel);
+		} else {
+			finishSync(false);
+		}
+	} else {
+		startNext();
+	}
+}) {
+}
+
+ParticipantCache::~ParticipantCache() {
+	stop();
+}
+
+bool ParticipantCache::CreateTables(QSqlDatabase &db) {
+	const auto statements = {
+		// Position in the recent participants order of the server,
+		// the ones joined since the last refresh are below zero.
+		R"(CREATE TABLE IF NOT EXISTS channel_participants (
+			channel_id INTEGER NOT NULL,
+			peer_id INTEGER NOT NULL,
+			position INTEGER NOT NULL,
+			type TEXT NOT NULL,
+			rank TEXT,
+			name TEXT,
+			username TEXT,
+			by_id INTEGER,
+			since INTEGER,
+			updated_at INTEGER,
+			PRIMARY KEY (channel_id, peer_id)
+		) WITHOUT ROWID)",
+		R"(CREATE INDEX IF NOT EXISTS idx_channel_participants_position
+			ON channel_participants(channel_id, position))",
+		// Search words of the names and usernames, as PeerData has them.
+		R"(CREATE TABLE IF NOT EXISTS channel_participant_words (
+			channel_id INTEGER NOT NULL,
+			word TEXT NOT NULL,
+			peer_id INTEGER NOT NULL,
+			PRIMARY KEY (channel_id, word, peer_id)
+		) WITHOUT ROWID)",
+		R"(CREATE TABLE IF NOT EXISTS channel_participant_sync (
+			channel_id INTEGER PRIMARY KEY,
+			synced_at INTEGER NOT NULL,
+			available_count INTEGER,
+			complete INTEGER
+		))",
+	};
+	QSqlQuery query(db);
+	for (const auto statement : statements) {
+		if (!query.exec(statement)) {
+			qWarning()
+				<< "MCP ParticipantCache: Failed to create state:"
+				<< query.lastError().text();
+			return false;
+		}
+	}
+	return true;
+}
+
+void ParticipantCache::loadState() {
+	auto db = _pool->reader();
+	QSqlQuery query(db);
+	if (query.exec(R"(
+			SELECT channel_id, synced_at, available_count, complete
+			FROM channel_participant_sync)")) {
+		while (query.next()) {
+			_states[query.value(0).toLongLong()] = State{
+				.syncedAt = TimeId(query.value(1).toLongLong()),
+				.availableCount = query.value(2).toInt(),
+				.complete = query.value(3).toBool(),
+			};
+		}
+	}
+}
+
+bool ParticipantCache::start() {
+	if (_running) {
+		return true;
+	}
+	loadState();
+	_running = true;
+
+	_session->session().api().chatParticipants().channelUpdates(
+	) | rpl::start_with_next([=](
+			const Api::ChatParticipants::ChannelUpdate &update) {
+		applyUpdate(update.channel, update.participantId, update.now);
+	}, _lifetime);
+
+	return true;
+}
+
+void ParticipantCache::stop() {
+	if (!_running) {
+		return;
+	}
+	_running = false;
+	_lifetime.destroy();
+	_pageTimer.cancel();
+	if (const auto sync = base::take(_sync)) {
+		_api.request(sync->requestId).cancel();
+	}
+	_waiting.clear();
+}
+
+bool ParticipantCache::refresh(not_null<ChannelData*> channel) {
+	if (!_running || !channel->canViewMembers()) {
+		return false;
+	}
+	const auto channelId = qint64(channel->id.value);
+	if ((_sync && _sync->channelId == channelId)
+		|| ranges::contains(_waiting, channelId)) {
+		return true;
+	}
+	_waiting.push_back(channelId);
+	if (!_sync && !_pageTimer.isActive()) {
+		startNext();
+	}
+	return true;
+}
+
+void ParticipantCache::startNext() {
+	while (!_sync && !_waiting.empty()) {
+		const auto channelId = _waiting.front();
+		_waiting.pop_front();
+		const auto channel = _session->channelLoaded(
+			peerToChannel(PeerId(channelId)));
+		if (channel && channel->canViewMembers()) {
+			_sync = Sync{ .channelId = channelId };
+			requestPage(channel);
+		}
+	}
+}
+
+uint64 ParticipantCache::pageHash(qint64 channelId, int offset, int *count) {
+	auto db = _pool->reader();
+	QSqlQuery query(db);
+	query.prepare(R"(
+		SELECT peer_id FROM channel_participants
+		WHERE channel_id = :channel_id
+			AND position >= :from AND position < :till
+		ORDER BY position
+	)");
+	query.bindValue(":channel_id", channelId);
+	query.bindValue(":from", offset);
+	query.bindValue(":till", offset + kPageSize);
+	auto ids = std::vector<uint64>();
+	if (query.exec()) {
+		while (query.next()) {
+			const auto peerId = PeerId(query.value(0).toLongLong());
+			ids.push_back(peerIsUser(peerId)
+				? peerToUser(peerId).bare
+				: peerId.value);
+		}
+	}
+	*count = int(ids.size());
+	return ids.empty() ? uint64(0) : Api::CountHash(ids);
+}
+
+void ParticipantCache::requestPage(not_null<ChannelData*> channel) {
+	Expects(_sync.has_value());
+
+	const auto hash = pageHash(
+		_sync->channelId,
+		_sync->offset,
+		&_sync->cachedCount);
+	++_pagesRequested;
+	_sync->requestId = _api.request(MTPchannels_GetParticipants(
+		channel->inputChannel,
+		MTP_channelParticipantsRecent(),
+		MTP_int(_sync->offset),
+		MTP_int(kPageSize),
+		MTP_long(hash)
+	)).done([=](const MTPchannels_ChannelParticipants &result) {
+		_sync->requestId = 0;
+		result.match([&](const MTPDchannels_channelParticipants &data) {
+			const auto &[availableCount, list] = Api::ChatParticipants::Parse(
+				channel,
+				data);
+			pageReceived(channel, availableCount, list);
+		}, [&](const MTPDchannels_channelParticipantsNotModified &) {
+			++_pagesNotModified;
+			pageNotModified();
+		});
+	}).fail([=](const MTP::Error &error) {
+		qWarning()
+			<< "MCP ParticipantCache: Failed to load participants of"
+			<< _sync->channelId
+			<< error.type();
+		_sync->requestId = 0;
+		finishSync(false);
+	}).send();
+}
+
+void ParticipantCache::pageReceived(
+		not_null<ChannelData*> channel,
+		int availableCount,
+		const std::vector<Api::ChatParticipant> &list) {
+	Expects(_sync.has_value());
+
+	const auto channelId = _sync->channelId;
+	const auto offset = _sync->offset;
+	auto rows = std::vector<Row>();
+	rows.reserve(list.size());
+	for (const auto &participant : list) {
+		auto row = PrepareRow(
+			_session,
+			participant,
+			offset + int(rows.size()));
+		if (!row.type.isEmpty()) {
+			rows.push_back(std::move(row));
+		}
+	}
+	_pool->write([=](QSqlDatabase &db) {
+		if (!db.transaction()) {
+			return;
+		}
+		auto query = QSqlQuery(db);
+		auto ok = true;
+		for (const auto table : {
+				"channel_participant_words",
+				"channel_participants" }) {
+			query.prepare(QString(R"(
+				DELETE FROM %1
+				WHERE channel_id = :channel_id AND peer_id IN (
+					SELECT peer_id FROM channel_participants
+					WHERE channel_id = :inner_channel_id
+						AND position >= :from AND position < :till)
+			)").arg(table));
+			query.bindValue(":channel_id", channelId);
+			query.bindValue(":inner_channel_id", channelId);
+			query.bindValue(":from", offset);
+			query.bindValue(":till", offset + kPageSize);
+			ok = ok && query.exec();
+		}
+		for (const auto &row : rows) {
+			ok = ok && WriteRow(db, channelId, row, false);
+		}
+		if (!ok) {
+			qWarning()
+				<< "MCP ParticipantCache: Failed to write participants:"
+				<< query.lastError().text();
+			db.rollback();
+		} else {
+			db.commit();
+		}
+	});
+
+	_sync->availableCount = availableCount;
+	_sync->offset += int(list.size());
+	if (int(list.size()) < kPageSize
+		|| _sync->offset >= availableCount) {
+		finishSync(true);
+	} else {
+		_pageTimer.callOnce(kPageDelay);
+	}
+}
+
+void ParticipantCache::pageNotModified() {
+	Expects(_sync.has_value());
+
+	_sync->offset += _sync->cachedCount;
+	if (_sync->cachedCount < kPageSize) {
+		finishSync(true);
+	} else {
+		_pageTimer.callOnce(kPageDelay);
+	}
+}
+
+void ParticipantCache::finishSync(bool complete) {
+	Expects(_sync.has_value());
+
+	const auto sync = *base::take(_sync);
+	const auto syncedAt = TimeId(QDateTime::currentSecsSinceEpoch());
+	auto &state = _states[sync.channelId];
+	state.syncedAt = syncedAt;
+	state.complete = complete;
+	if (sync.availableCount) {
+		state.availableCount = sync.availableCount;
+	}
+	const auto availableCount = state.availableCount;
+	_pool->write([=](QSqlDatabase &db) {
+		auto query = QSqlQuery(db);
+		if (complete) {
+			// Whatever is below the end of the list has left meanwhile.
+			for (const auto table : {
+					"channel_participant_words",
+					"channel_participants" }) {
+				query.prepare(QString(R"(
+					DELETE FROM %1
+					WHERE channel_id = :channel_id AND peer_id IN (
+						SELECT peer_id FROM channel_participants
+						WHERE channel_id = :inner_channel_id
+							AND position >= :till)
+				)").arg(table));
+				query.bindValue(":channel_id", sync.channelId);
+				query.bindValue(":inner_channel_id", sync.channelId);
+				query.bindValue(":till", sync.offset);
+				query.exec();
+			}
+		}
+		query.prepare(R"(
+			INSERT OR REPLACE INTO channel_participant_sync (
+				channel_id, synced_at, available_count, complete
+			) VALUES (
+				:channel_id, :synced_at, :available_count, :complete
+			)
+		)");
+		query.bindValue(":channel_id", sync.channelId);
+		query.bindValue(":synced_at", syncedAt);
+		query.bindValue(":available_count", availableCount);
+		query.bindValue(":complete", complete ? 1 : 0);
+		if (!query.exec()) {
+			qWarning()
+				<< "MCP ParticipantCache: Failed to save sync state:"
+				<< query.lastError().text();
+		}
+	});
+	_pageTimer.callOnce(kPageDelay);
+}
+
+void ParticipantCache::applyUpdate(
+		not_null<ChannelData*> channel,
+		PeerId participantId,
+		const std::optional<Api::ChatParticipant> &now) {
+	const auto channelId = qint64(channel->id.value);
+	if (!_states.contains(channelId)) {
+		// Only the cached lists are kept up to date.
+		return;
+	}
+	++_updatesApplied;
+	auto row = now ? PrepareRow(_session, *now, 0) : Row();
+	_pool->write([=](QSqlDatabase &db) {
+		const auto ok = row.type.isEmpty()
+			? DeleteRow(db, channelId, participantId)
+			: WriteRow(db, channelId, row, true);
+		if (!ok) {
+			qWarning()
+				<< "MCP ParticipantCache: Failed to apply an update of"
+				<< channelId;
+		}
+	});
+}
+
+bool ParticipantCache::stale(qint64 channelId) const {
+	const auto i = _states.find(channelId);
+	return (i == end(_states))
+		|| (QDateTime::currentSecsSinceEpoch() - i->second.syncedAt
+			>= kRefreshInterval);
+}
+
+QJsonObject ParticipantCache::query(const Query &query) {
+	if (!_running) {
+		return QJsonObject{ { "error", "Participant cache not running" } };
+	}
+	const auto channel = _session->channelLoaded(
+		peerToChannel(PeerId(query.channelId)));
+	if (!channel) {
+		return QJsonObject{ { "error", "Channel not found" } };
+	} else if (stale(query.channelId)) {
+		refresh(channel);
+	}
+
+	auto conditions = QStringList{ u"p.channel_id = :channel_id"_q };
+	if (!query.type.isEmpty()) {
+		conditions.push_back(u"p.type = :type"_q);
+	}
+	const auto words = TextUtilities::PrepareSearchWords(
+		query.search
+	).mid(0, kMaxSearchWords);
+	for (auto i = 0; i != words.size(); ++i) {
+		// Words from PrepareSearchWords() have no characters this high,
+		// so the range is the words starting with the prefix.
+		conditions.push_back(QString(R"(p.peer_id IN (
+			SELECT peer_id FROM channel_participant_words
+			WHERE channel_id = :channel_id%1
+				AND word >= :word%1 AND word < :till%1))").arg(i));
+	}
+	const auto where = conditions.join(u" AND "_q);
+	const auto bind = [&](QSqlQuery &sql) {
+		sql.bindValue(":channel_id", query.channelId);
+		if (!query.type.isEmpty()) {
+			sql.bindValue(":type", query.type);
+		}
+		for (auto i = 0; i != words.size(); ++i) {
+			const auto index = QString::number(i);
+			sql.bindValue(":channel_id" + index, query.channelId);
+			sql.bindValue(":word" + index, words[i]);
+			sql.bindValue(":till" + index, words[i] + QChar(0xFFFF));
+		}
+	};
+
+	auto db = _pool->reader();
+	auto sql = QSqlQuery(db);
+	sql.prepare(u"SELECT COUNT(*) FROM channel_participants p WHERE "_q
+		+ where);
+	bind(sql);
+	const auto total = (sql.exec() && sql.next()) ? sql.value(0).toInt() : 0;
+
+	sql.prepare(QString(R"(
+		SELECT p.peer_id, p.type, p.rank, p.name, p.username, p.by_id, p.since
+		FROM channel_participants p
+		WHERE %1
+		ORDER BY p.position
+		LIMIT :limit OFFSET :offset
+	)").arg(where));
+	bind(sql);
+	sql.bindValue(":limit", std::clamp(query.limit, 1, kMaxQueryLimit));
+	sql.bindValue(":offset", std::max(query.offset, 0));
+	auto members = QJsonArray();
+	if (sql.exec()) {
+		while (sql.next()) {
+			auto member = QJsonObject{
+				{ "id", QString::number(sql.value(0).toLongLong()) },
+				{ "type", sql.value(1).toString() },
+				{ "name", sql.value(3).toString() },
+			};
+			if (const auto rank = sql.value(2).toString(); !rank.isEmpty()) {
+				member["rank"] = rank;
+			}
+			if (const auto username = sql.value(4).toString()
+				; !username.isEmpty()) {
+				member["username"] = username;
+			}
+			if (const auto by = sql.value(5).toLongLong()) {
+				member["by_id"] = QString::number(by);
+			}
+			if (const auto since = sql.value(6).toLongLong()) {
+				member["since"] = since;
+			}
+			members.append(member);
+		}
+	} else {
+		qWarning()
+			<< "MCP ParticipantCache: Query failed:"
+			<< sql.lastError().text();
+	}
+
+	auto result = QJsonObject{
+		{ "chat_id", QString::number(query.channelId) },
+		{ "members", members },
+		{ "count", members.size() },
+		{ "total", total },
+		{ "offset", std::max(query.offset, 0) },
+		{ "refreshing", (_sync && _sync->channelId == query.channelId)
+			|| ranges::contains(_waiting, query.channelId) },
+	};
+	if (const auto i = _states.find(query.channelId); i != end(_states)) {
+		result["synced_at"] = double(i->second.syncedAt);
+		result["complete"] = i->second.complete;
+		result["available_count"] = i->second.availableCount;
+	} else {
+		result["synced_at"] = QJsonValue::Null;
+	}
+	return result;
+}
+
+QJsonObject ParticipantCache::status() const {
+	auto result = QJsonObject{
+		{ "running", _running },
+		{ "cached_chats", int(_states.size()) },
+		{ "waiting", int(_waiting.size()) },
+		{ "pages_requested", _pagesRequested },
+		{ "pages_not_modified", _pagesNotModified },
+		{ "updates_applied", _updatesApplied },
+	};
+	if (_sync) {
+		result["current"] = QJsonObject{
+			{ "chat_id", QString::number(_sync->channelId) },
+			{ "offset", _sync->offset },
+			{ "available_count", _sync->availableCount },
+		};
+	}
+	return result;
+}
+
+} // namespace MCP
@@ -0,0 +1,119 @@
+// MCP Participant Cache - persistent member lists of large groups
+//
+// This file is part of Telegram Desktop MCP integration.
+// Keeps the participants of supergroups and channels in the archive
+// database, so member lists and name lookups are answered locally.
+// A refresh pages through the recent participants and sends the hash of
+// the cached page with each request, the server answers "not modified"
+// for the pages that did not change. Participant updates and kicks go
+// into the cache as they happen, between the refreshes.
+
+#pragma once
+
+#include "mtproto/sender.h"
+#include "base/timer.h"
+
+#include <QtCore/QJsonObject>
+#include <QtCore/QString>
+
+#include <deque>
+#include <map>
+#include <optional>
+#include <vector>
+
+class ChannelData;
+class QSqlDatabase;
+
+namespace Api {
+class ChatParticipant;
+} // namespace Api
+
+namespace Data {
+class Session;
+} // namespace Data
+
+namespace MCP {
+
+class DatabasePool;
+
+class ParticipantCache final {
+public:
+	ParticipantCache(
+		not_null<Data::Session*> session,
+		not_null<DatabasePool*> pool);
+	~ParticipantCache();
+
+	// Archive schema migration creating the cache tables, run by the
+	// ChatArchiver before the cache is started.
+	static bool CreateTables(QSqlDatabase &db);
+
+	bool start();
+	void stop();
+
+	struct Query {
+		qint64 channelId = 0;
+		QString search; // Prefix of the name or username words.
+		QString type; // creator, admin, member, restricted or empty.
+		int offset = 0;
+		int limit = 100;
+	};
+	// Answers from the cache only. The list is refreshed in the background
+	// when it is missing or older than the refresh interval.
+	[[nodiscard]] QJsonObject query(const Query &query);
+
+	// Starts a refresh now, false if the channel can't be refreshed.
+	bool refresh(not_null<ChannelData*> channel);
+
+	[[nodiscard]] QJsonObject status() const;
+
+private:
+	struct Sync {
+		qint64 channelId = 0;
+		int offset = 0;
+		int cachedCount = 0; // Rows of the requested page in the cache.
+		int availableCount = 0;
+		mtpRequestId requestId = 0;
+	};
+	struct State {
+		TimeId syncedAt = 0;
+		int availableCount = 0;
+		bool complete = false;
+	};
+
+	void loadState();
+
+	void startNext();
+	void requestPage(not_null<ChannelData*> channel);
+	void pageReceived(
+		not_null<ChannelData*> channel,
+		int availableCount,
+		const std::vector<Api::ChatParticipant> &list);
+	void pageNotModified();
+	void finishSync(bool complete);
+	void applyUpdate(
+		not_null<ChannelData*> channel,
+		PeerId participantId,
+		const std::optional<Api::ChatParticipant> &now);
+
+	[[nodiscard]] uint64 pageHash(qint64 channelId, int offset, int *count);
+	[[nodiscard]] bool stale(qint64 channelId) const;
+
+	const not_null<Data::Session*> _session;
+	const not_null<DatabasePool*> _pool;
+	MTP::Sender _api;
+
+	std::map<qint64, State> _states;
+	std::optional<Sync> _sync;
+	std::deque<qint64> _waiting;
+	base::Timer _pageTimer;
+	bool _running = false;
+
+	int _pagesRequested = 0;
+	int _pagesNotModified = 0;
+	int _updatesApplied = 0;
+
+	rpl::lifetime _lifetime;
+
+};
+
+} // namespace MCP
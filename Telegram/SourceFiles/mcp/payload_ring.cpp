@@ -0,0 +1,217 @@
+// MCP Payload Ring - shared memory channel for large Bridge responses
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "mcp/payload_ring.h"
+
+#include <QtCore/QDebug>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QTemporaryDir>
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // Q_OS_UNIX
+
+namespace MCP {
+namespace {
+
+// Segments grow in whole steps and are not shrunk, a client reading
+// similar results keeps mapping the same pages.
+constexpr auto kSegmentStep = qint64(1024 * 1024);
+
+// Other users may plant files or links in /dev/shm and /tmp, so only a
+// directory that we own and nobody else may enter is used.
+[[nodiscard]] bool PrivateDirectory(const QString &path) {
+#ifdef Q_OS_UNIX
+	struct stat info;
+	const auto encoded = QFile::encodeName(path);
+	return !::lstat(encoded.constData(), &info)
+		&& S_ISDIR(info.st_mode)
+		&& (info.st_uid == ::geteuid())
+		&& !(info.st_mode & (S_IRWXG | S_IRWXO));
+#else // Q_OS_UNIX
+	return QFileInfo(path).isDir();
+#endif // Q_OS_UNIX
+}
+
+// Creates the file, failing if anything exists at path already.
+[[nodiscard]] std::unique_ptr<QFile> CreateExclusive(const QString &path) {
+	auto result = std::make_unique<QFile>(path);
+#ifdef Q_OS_UNIX
+	const auto encoded = QFile::encodeName(path);
+	const auto fd = ::open(
+		encoded.constData(),
+		O_RDWR | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC,
+		S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		return nullptr;
+	} else if (::fchmod(fd, S_IRUSR | S_IWUSR) != 0
+		|| !result->open(
+			fd,
+			QIODevice::ReadWrite,
+			QFileDevice::AutoCloseHandle)) {
+		::close(fd);
+		::unlink(encoded.constData());
+		return nullptr;
+	}
+#else // Q_OS_UNIX
+	if (!result->open(QIODevice::ReadWrite | QIODevice::NewOnly)) {
+		return nullptr;
+	} else if (!result->setPermissions(
+			QFileDevice::ReadOwner | QFileDevice::WriteOwner)) {
+		result->close();
+		QFile::remove(path);
+		return nullptr;
+	}
+#endif // Q_OS_UNIX
+	return result;
+}
+
+} // namespace
+
+PayloadRing::PayloadRing(
+	const QString &directory,
+	const QString &prefix,
+	int segments,
+	qint64 threshold)
+: _directory(std::make_unique<QTemporaryDir>(
+	QDir(directory).filePath(prefix + "XXXXXX")))
+, _prefix(prefix)
+, _threshold(threshold)
+, _segments(std::max(segments, 1)) {
+}
+
+PayloadRing::~PayloadRing() {
+	for (auto i = 0; i != int(_segments.size()); ++i) {
+		auto &segment = _segments[i];
+		if (segment.file) {
+			unmap(segment);
+			segment.file->close();
+			QFile::remove(path(i));
+		}
+	}
+}
+
+QString PayloadRing::DefaultDirectory() {
+#ifdef Q_OS_LINUX
+	const auto shm = QFileInfo("/dev/shm");
+	if (shm.isDir() && shm.isWritable()) {
+		return shm.absoluteFilePath();
+	}
+#endif // Q_OS_LINUX
+	return QDir::tempPath();
+}
+
+bool PayloadRing::valid() const {
+	return _directory->isValid() && PrivateDirectory(_directory->path());
+}
+
+QString PayloadRing::path(int index) const {
+	return QDir(_directory->path()).filePath(_prefix + QString::number(index));
+}
+
+std::optional<QJsonObject> PayloadRing::put(const QByteArray &payload) {
+	const auto count = int(_segments.size());
+	for (auto tried = 0; tried != count; ++tried) {
+		const auto index = (_next + tried) % count;
+		if (_segments[index].busy) {
+			continue;
+		} else if (!reserve(index, payload.size())) {
+			return std::nullopt;
+		}
+		auto &segment = _segments[index];
+		std::memcpy(segment.data, payload.constData(), payload.size());
+		segment.busy = true;
+		segment.sequence = ++_sequence;
+		_next = (index + 1) % count;
+		return QJsonObject{
+			{ "segment", index },
+			{ "sequence", double(segment.sequence) },
+			{ "path", path(index) },
+			{ "offset", 0 },
+			{ "length", double(payload.size()) },
+		};
+	}
+	return std::nullopt;
+}
+
+bool PayloadRing::release(int segment) {
+	if (segment < 0
+		|| segment >= int(_segments.size())
+		|| !_segments[segment].busy) {
+		return false;
+	}
+	_segments[segment].busy = false;
+	return true;
+}
+
+bool PayloadRing::reserve(int index, qint64 size) {
+	auto &segment = _segments[index];
+	if (segment.data && segment.capacity >= size) {
+		return true;
+	}
+	const auto capacity = std::max(
+		((size + kSegmentStep - 1) / kSegmentStep) * kSegmentStep,
+		kSegmentStep);
+	if (!segment.file) {
+		if (!valid()) {
+			qWarning()
+				<< "MCP PayloadRing: No private directory in"
+				<< _directory->path();
+			return false;
+		}
+		auto file = CreateExclusive(path(index));
+		if (!file) {
+			qWarning()
+				<< "MCP PayloadRing: Could not create"
+				<< path(index)
+				<< "exclusively";
+			return false;
+		}
+		segment.file = std::move(file);
+	}
+	unmap(segment);
+	if (!segment.file->resize(capacity)) {
+		qWarning()
+			<< "MCP PayloadRing: Could not resize"
+			<< segment.file->fileName()
+			<< "to"
+			<< capacity;
+		return false;
+	}
+	segment.data = segment.file->map(0, capacity);
+	if (!segment.data) {
+		qWarning()
+			<< "MCP PayloadRing: Could not map"
+			<< segment.file->fileName()
+			<< segment.file->errorString();
+		return false;
+	}
+	segment.capacity = capacity;
+	return true;
+}
+
+void PayloadRing::unmap(Segment &segment) {
+	if (segment.data) {
+		segment.file->unmap(segment.data);
+		segment.data = nullptr;
+		segment.capacity = 0;
+	}
+}
+
+QJsonObject PayloadRing::describe() const {
+	return QJsonObject{
+		{ "directory", _directory->path() },
+		{ "segments", int(_segments.size()) },
+		{ "threshold", double(_threshold) },
+	};
+}
+
+} // namespace MCP
@@ -0,0 +1,79 @@
+// MCP Payload Ring - shared memory channel for large Bridge responses
+//
+// This file is part of Telegram Desktop MCP integration.
+// A client on the same host may ask the Bridge to put large responses
+// into memory mapped files instead of the socket. Only a descriptor of
+// the bytes goes over the socket, the client maps the file and releases
+// the segment when done with it.
+
+#pragma once
+
+#include <QtCore/QByteArray>
+#include <QtCore/QJsonObject>
+#include <QtCore/QString>
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+class QFile;
+class QTemporaryDir;
+
+namespace MCP {
+
+class PayloadRing final {
+public:
+	// The files are named prefix + segment index inside a private
+	// directory, created with an unpredictable name inside directory.
+	PayloadRing(
+		const QString &directory,
+		const QString &prefix,
+		int segments,
+		qint64 threshold);
+	~PayloadRing();
+
+	PayloadRing(const PayloadRing &) = delete;
+	PayloadRing &operator=(const PayloadRing &) = delete;
+
+	// /dev/shm where available, so that the pages never hit the disk.
+	[[nodiscard]] static QString DefaultDirectory();
+
+	// Responses of at least this many bytes go to the segments.
+	[[nodiscard]] qint64 threshold() const {
+		return _threshold;
+	}
+
+	// Copies payload to the next free segment and returns its
+	// descriptor, std::nullopt when every segment is still held by the
+	// client or the file could not be mapped.
+	[[nodiscard]] std::optional<QJsonObject> put(const QByteArray &payload);
+
+	// The client has read the segment, it may be written again.
+	bool release(int segment);
+
+	[[nodiscard]] QJsonObject describe() const;
+
+private:
+	struct Segment {
+		std::unique_ptr<QFile> file;
+		uchar *data = nullptr;
+		qint64 capacity = 0;
+		quint64 sequence = 0;
+		bool busy = false;
+	};
+
+	[[nodiscard]] bool valid() const;
+	[[nodiscard]] QString path(int index) const;
+	bool reserve(int index, qint64 size);
+	void unmap(Segment &segment);
+
+	const std::unique_ptr<QTemporaryDir> _directory;
+	const QString _prefix;
+	const qint64 _threshold = 0;
+	std::vector<Segment> _segments;
+	int _next = 0;
+	quint64 _sequence = 0;
+
+};
+
+} // namespace MCP
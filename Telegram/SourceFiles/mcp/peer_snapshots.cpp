@@ -0,0 +1,234 @@
+// MCP Peer Snapshots - Versioned table of the peers tools report
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "peer_snapshots.h"
+
+#include "data/data_changes.h"
+#include "data/data_channel.h"
+#include "data/data_chat.h"
+#include "data/data_peer.h"
+#include "data/data_session.h"
+#include "data/data_user.h"
+#include "dialogs/dialogs_indexed_list.h"
+#include "dialogs/dialogs_main_list.h"
+#include "dialogs/dialogs_row.h"
+#include "history/history.h"
+#include "history/history_item.h"
+#include "main/main_session.h"
+
+#include <QtCore/QDateTime>
+
+#include <algorithm>
+
+namespace MCP {
+namespace {
+
+[[nodiscard]] bool SameContent(const PeerSnapshot &a, const PeerSnapshot &b) {
+	return (a.type == b.type)
+		&& (a.name == b.name)
+		&& (a.username == b.username)
+		&& (a.firstName == b.firstName)
+		&& (a.lastName == b.lastName)
+		&& (a.about == b.about)
+		&& (a.flags == b.flags)
+		&& (a.members == b.members)
+		&& (a.unreadCount == b.unreadCount)
+		&& (a.lastMessageId == b.lastMessageId);
+}
+
+} // namespace
+
+void PeerSnapshots::subscribe(not_null<Main::Session*> session) {
+	unsubscribe();
+	_session = session;
+
+	// Versions continue from the clock, so that a version a client got
+	// before a restart is unlikely to be taken for a current one. After
+	// more than one change per millisecond the counter runs ahead of the
+	// clock and a stale version may match again after a quick restart.
+	// Inside one run it never goes back, even when the session changes.
+	_version = std::max(
+		_version,
+		quint64(QDateTime::currentMSecsSinceEpoch()));
+
+	using PeerFlag = Data::PeerUpdate::Flag;
+	using HistoryFlag = Data::HistoryUpdate::Flag;
+	using MessageFlag = Data::MessageUpdate::Flag;
+
+	session->changes().peerUpdates(
+		PeerFlag::Name
+		| PeerFlag::Username
+		| PeerFlag::Usernames
+		| PeerFlag::About
+		| PeerFlag::Members
+		| PeerFlag::Rights
+		| PeerFlag::IsContact
+		| PeerFlag::IsBot
+		| PeerFlag::VerifyInfo
+		| PeerFlag::EmojiStatus
+	) | rpl::start_with_next([=](const Data::PeerUpdate &update) {
+		markDirty(update.peer);
+	}, _sessionLifetime);
+
+	session->changes().historyUpdates(
+		HistoryFlag::UnreadView
+		| HistoryFlag::IsPinned
+		| HistoryFlag::Folder
+		| HistoryFlag::TopPromoted
+	) | rpl::start_with_next([=](const Data::HistoryUpdate &update) {
+		markDirty(update.history->peer);
+		if (update.flags & (HistoryFlag::IsPinned
+				| HistoryFlag::Folder
+				| HistoryFlag::TopPromoted)) {
+			_chatListDirty = true;
+		}
+	}, _sessionLifetime);
+
+	session->changes().messageUpdates(
+		MessageFlag::NewAdded | MessageFlag::Destroyed
+	) | rpl::start_with_next([=](const Data::MessageUpdate &update) {
+		markDirty(update.item->history()->peer);
+	}, _sessionLifetime);
+
+	rpl::merge(
+		session->data().chatsListChanges() | rpl::to_empty,
+		session->data().chatListEntryRefreshes() | rpl::to_empty
+	) | rpl::start_with_next([=] {
+		_chatListDirty = true;
+	}, _sessionLifetime);
+}
+
+void PeerSnapshots::unsubscribe() {
+	_sessionLifetime.destroy();
+	_session = nullptr;
+	_chatList.clear();
+	_chatListDirty = true;
+	_dirty.clear();
+	_entries.clear();
+}
+
+void PeerSnapshots::markDirty(not_null<PeerData*> peer) {
+	const auto id = qint64(peer->id.value);
+	if (_entries.find(id) != end(_entries)) {
+		_dirty.insert(id);
+	}
+}
+
+const PeerSnapshot *PeerSnapshots::find(qint64 peerId) {
+	if (!_session) {
+		return nullptr;
+	}
+	const auto peer = _session->data().peerLoaded(PeerId(peerId));
+	return peer ? &refresh(peer) : nullptr;
+}
+
+const PeerSnapshot *PeerSnapshots::find(not_null<PeerData*> peer) {
+	return _session ? &refresh(peer) : nullptr;
+}
+
+PeerSnapshot &PeerSnapshots::refresh(not_null<PeerData*> peer) {
+	const auto id = qint64(peer->id.value);
+	auto i = _entries.find(id);
+	if (i == end(_entries)) {
+		i = _entries.emplace(id, PeerSnapshot()).first;
+	} else if (!_dirty.remove(id)) {
+		return i->second;
+	}
+	auto &entry = i->second;
+	auto updated = PeerSnapshot();
+	fill(updated, peer);
+	if (entry.version && SameContent(entry, updated)) {
+		return entry;
+	}
+	updated.version = ++_version;
+	updated.json["version"] = QString::number(updated.version);
+	entry = std::move(updated);
+	return entry;
+}
+
+void PeerSnapshots::fill(PeerSnapshot &entry, not_null<PeerData*> peer) const {
+	using Flag = PeerSnapshot::Flag;
+	const auto set = [&](Flag flag, bool value) {
+		if (value) {
+			entry.flags |= uint32(flag);
+		}
+	};
+	entry.id = qint64(peer->id.value);
+	entry.name = peer->name();
+	entry.username = peer->username();
+	entry.about = peer->about();
+	set(Flag::Verified, peer->isVerified());
+	set(Flag::Scam, peer->isScam());
+	set(Flag::Fake, peer->isFake());
+	if (const auto user = peer->asUser()) {
+		entry.type = QString("user");
+		entry.firstName = user->firstName;
+		entry.lastName = user->lastName;
+		set(Flag::Bot, user->isBot());
+		set(Flag::Self, user->isSelf());
+		set(Flag::Contact, user->isContact());
+		set(Flag::Premium, user->isPremium());
+	} else if (const auto chat = peer->asChat()) {
+		entry.type = QString("group");
+		entry.members = chat->count;
+		set(Flag::Creator, chat->amCreator());
+	} else if (const auto channel = peer->asChannel()) {
+		entry.type = channel->isMegagroup()
+			? QString("supergroup")
+			: QString("channel");
+		entry.members = channel->membersCount();
+		set(Flag::Creator, channel->amCreator());
+	}
+	if (const auto history = _session->data().historyLoaded(peer)) {
+		entry.unreadCount = history->unreadCount();
+		if (const auto last = history->lastMessage()) {
+			entry.lastMessageId = last->id.bare;
+		}
+	}
+
+	entry.json["id"] = QString::number(entry.id);
+	entry.json["name"] = entry.name;
+	entry.json["username"] = entry.username;
+	entry.json["type"] = entry.type;
+	entry.json["unread_count"] = entry.unreadCount;
+	if (entry.lastMessageId) {
+		entry.json["last_message_id"] = QString::number(entry.lastMessageId);
+	}
+	entry.json["source"] = "live";
+}
+
+const std::vector<const PeerSnapshot*> &PeerSnapshots::chatList() {
+	if (!_session) {
+		_chatList.clear();
+		return _chatList;
+	}
+	auto changed = false;
+	if (_chatListDirty) {
+		_chatListDirty = false;
+		auto list = std::vector<const PeerSnapshot*>();
+		list.reserve(_chatList.size());
+		for (const auto &row : *_session->data().chatsList()->indexed()) {
+			if (const auto history = row->history()) {
+				list.push_back(&refresh(history->peer));
+			}
+		}
+		changed = (list != _chatList);
+		_chatList = std::move(list);
+	} else {
+		for (const auto entry : _chatList) {
+			if (_dirty.contains(entry->id)) {
+				find(entry->id);
+			}
+		}
+	}
+	for (const auto entry : _chatList) {
+		_chatListVersion = std::max(_chatListVersion, entry->version);
+	}
+	if (changed) {
+		_chatListVersion = ++_version;
+	}
+	return _chatList;
+}
+
+} // namespace MCP
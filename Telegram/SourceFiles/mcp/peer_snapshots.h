@@ -0,0 +1,102 @@
+// MCP Peer Snapshots - Versioned table of the peers tools report
+//
+// This file is part of Telegram Desktop MCP integration.
+// Keeps one flat entry per peer with the fields list_chats, get_chat_info,
+// get_user_info and message senders report, and the JSON element of the
+// chat list prepared from them. Data::Changes updates only mark entries
+// dirty, an entry is rebuilt when next read and gets a new version if
+// anything in it changed. Clients pass the version they have as
+// since_version and get "not_modified" back while it is current.
+
+#pragma once
+
+#include <QtCore/QJsonObject>
+#include <QtCore/QSet>
+#include <QtCore/QString>
+
+#include <unordered_map>
+#include <vector>
+
+class PeerData;
+
+namespace Main {
+class Session;
+} // namespace Main
+
+namespace MCP {
+
+struct PeerSnapshot {
+	enum class Flag : uint32 {
+		Bot = (1U << 0),
+		Self = (1U << 1),
+		Contact = (1U << 2),
+		Premium = (1U << 3),
+		Verified = (1U << 4),
+		Scam = (1U << 5),
+		Fake = (1U << 6),
+		Creator = (1U << 7),
+	};
+
+	quint64 version = 0;
+	qint64 id = 0;
+	QString type; // user, group, supergroup or channel
+	QString name;
+	QString username;
+	QString firstName;
+	QString lastName;
+	QString about;
+	uint32 flags = 0;
+	int members = 0;
+	int unreadCount = 0;
+	qint64 lastMessageId = 0;
+
+	// Element of the list_chats result.
+	QJsonObject json;
+
+	[[nodiscard]] bool has(Flag flag) const {
+		return (flags & uint32(flag)) != 0;
+	}
+};
+
+// Main thread only, entries are built from PeerData and History.
+class PeerSnapshots final {
+public:
+	PeerSnapshots() = default;
+
+	void subscribe(not_null<Main::Session*> session);
+	void unsubscribe();
+
+	// Up to date entry of the peer, nullptr if it isn't loaded.
+	[[nodiscard]] const PeerSnapshot *find(qint64 peerId);
+	[[nodiscard]] const PeerSnapshot *find(not_null<PeerData*> peer);
+
+	// Entries of the main chat list in its order.
+	[[nodiscard]] const std::vector<const PeerSnapshot*> &chatList();
+
+	// Last change of the chat list order or of one of its entries,
+	// valid after chatList().
+	[[nodiscard]] quint64 chatListVersion() const {
+		return _chatListVersion;
+	}
+
+	[[nodiscard]] int size() const { return int(_entries.size()); }
+
+private:
+	[[nodiscard]] PeerSnapshot &refresh(not_null<PeerData*> peer);
+	void fill(PeerSnapshot &entry, not_null<PeerData*> peer) const;
+	void markDirty(not_null<PeerData*> peer);
+
+	Main::Session *_session = nullptr;
+	std::unordered_map<qint64, PeerSnapshot> _entries; // Stable addresses.
+	QSet<qint64> _dirty;
+	quint64 _version = 0;
+
+	std::vector<const PeerSnapshot*> _chatList;
+	quint64 _chatListVersion = 0;
+	bool _chatListDirty = true;
+
+	rpl::lifetime _sessionLifetime;
+
+};
+
+} // namespace MCP
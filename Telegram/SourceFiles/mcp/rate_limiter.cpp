@@ -0,0 +1,192 @@
+// MCP Rate Limiter - Token buckets and admission control
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "rate_limiter.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QJsonArray>
+
+#include <algorithm>
+#include <cmath>
+
+namespace MCP {
+namespace {
+
+constexpr auto kMaxClients = 256;
+constexpr auto kNeverMs = qint64(60000);
+
+QByteArray PrometheusLabel(const QString &value) {
+	auto result = value.toUtf8();
+	result.replace('\\', "\\\\");
+	result.replace('"', "\\\"");
+	result.replace('\n', "\\n");
+	return result;
+}
+
+QJsonObject LimitsToJson(const RateLimiter::Limits &limits) {
+	return QJsonObject{
+		{"rate_per_second", limits.rate},
+		{"burst", limits.burst},
+	};
+}
+
+} // namespace
+
+RateLimiter::RateLimiter(const QStringList &toolIds)
+: _toolNames(toolIds)
+, _tools(toolIds.size())
+, _clientLimits{ 20., 200. }
+, _toolLimits{ 20., 100. } {
+}
+
+void RateLimiter::setCost(int toolId, int cost) {
+	if (toolId >= 0 && toolId < int(_tools.size())) {
+		_tools[toolId].cost = std::max(cost, 1);
+	}
+}
+
+void RateLimiter::setClientLimits(Limits limits) {
+	_clientLimits = limits;
+}
+
+void RateLimiter::setToolLimits(Limits limits) {
+	_toolLimits = limits;
+}
+
+double RateLimiter::Refill(Bucket &bucket, const Limits &limits, qint64 now) {
+	if (!bucket.updated) {
+		bucket.tokens = limits.burst;
+	} else if (now > bucket.updated) {
+		bucket.tokens = std::min(
+			limits.burst,
+			bucket.tokens + (now - bucket.updated) * limits.rate / 1000.);
+	}
+	bucket.updated = now;
+	return bucket.tokens;
+}
+
+qint64 RateLimiter::WaitMs(double tokens, double cost, const Limits &limits) {
+	if (limits.rate <= 0.) {
+		return kNeverMs;
+	}
+	return qint64(std::ceil((cost - tokens) * 1000. / limits.rate));
+}
+
+RateLimiter::Decision RateLimiter::admit(const QString &client, int toolId) {
+	const auto now = QDateTime::currentMSecsSinceEpoch();
+	const auto tool = (toolId >= 0 && toolId < int(_tools.size()))
+		? &_tools[toolId]
+		: nullptr;
+	const auto cost = double(tool ? tool->cost : 1);
+
+	if (_clients.size() >= kMaxClients && !_clients.contains(client)) {
+		pruneClients(now);
+	}
+	auto &bucket = _clients[client];
+
+	// A weight above the capacity would never pass, it takes it all.
+	const auto clientCost = std::min(cost, _clientLimits.burst);
+	const auto clientTokens = Refill(bucket, _clientLimits, now);
+	if (clientTokens < clientCost) {
+		++_clientThrottled;
+		if (tool) {
+			++tool->throttled;
+		}
+		return {
+			false,
+			WaitMs(clientTokens, clientCost, _clientLimits),
+			"client_rate_limited",
+		};
+	}
+	if (tool) {
+		const auto toolCost = std::min(cost, _toolLimits.burst);
+		const auto toolTokens = Refill(tool->bucket, _toolLimits, now);
+		if (toolTokens < toolCost) {
+			++tool->throttled;
+			return {
+				false,
+				WaitMs(toolTokens, toolCost, _toolLimits),
+				"tool_rate_limited",
+			};
+		}
+		tool->bucket.tokens -= toolCost;
+		++tool->admitted;
+	}
+	bucket.tokens -= clientCost;
+	return {};
+}
+
+void RateLimiter::recordShed(int toolId) {
+	if (toolId >= 0 && toolId < int(_tools.size())) {
+		++_tools[toolId].shed;
+	}
+}
+
+void RateLimiter::pruneClients(qint64 now) {
+	// Clients whose bucket filled up again lose nothing by starting over.
+	for (auto i = _clients.begin(); i != _clients.end();) {
+		if (Refill(*i, _clientLimits, now) >= _clientLimits.burst) {
+			i = _clients.erase(i);
+		} else {
+			++i;
+		}
+	}
+}
+
+QJsonObject RateLimiter::snapshot() const {
+	auto tools = QJsonArray();
+	auto throttled = quint64();
+	auto shed = quint64();
+	for (auto i = 0; i != int(_tools.size()); ++i) {
+		const auto &tool = _tools[i];
+		throttled += tool.throttled;
+		shed += tool.shed;
+		if (!tool.throttled && !tool.shed) {
+			continue;
+		}
+		tools.append(QJsonObject{
+			{"tool", _toolNames[i]},
+			{"cost", tool.cost},
+			{"admitted", qint64(tool.admitted)},
+			{"throttled", qint64(tool.throttled)},
+			{"shed", qint64(tool.shed)},
+		});
+	}
+	return QJsonObject{
+		{"client_limits", LimitsToJson(_clientLimits)},
+		{"tool_limits", LimitsToJson(_toolLimits)},
+		{"clients", int(_clients.size())},
+		{"client_throttled", qint64(_clientThrottled)},
+		{"total_throttled", qint64(throttled)},
+		{"total_shed", qint64(shed)},
+		{"tools", tools},
+	};
+}
+
+QByteArray RateLimiter::prometheus() const {
+	auto throttled = QByteArray(
+		"# HELP mcp_tool_throttled_total MCP tool calls rejected by rate limits.\n"
+		"# TYPE mcp_tool_throttled_total counter\n");
+	auto shed = QByteArray(
+		"# HELP mcp_tool_shed_total MCP tool calls dropped on a full queue.\n"
+		"# TYPE mcp_tool_shed_total counter\n");
+	for (auto i = 0; i != int(_tools.size()); ++i) {
+		const auto &tool = _tools[i];
+		if (!tool.throttled && !tool.shed) {
+			continue;
+		}
+		const auto label = "{tool=\"" + PrometheusLabel(_toolNames[i]) + "\"} ";
+		throttled += "mcp_tool_throttled_total" + label
+			+ QByteArray::number(qulonglong(tool.throttled)) + '\n';
+		shed += "mcp_tool_shed_total" + label
+			+ QByteArray::number(qulonglong(tool.shed)) + '\n';
+	}
+	return "# HELP mcp_rate_limited_clients Clients with a rate limit bucket.\n"
+		"# TYPE mcp_rate_limited_clients gauge\n"
+		"mcp_rate_limited_clients " + QByteArray::number(int(_clients.size())) + '\n'
+		+ throttled
+		+ shed;
+}
+
+} // namespace MCP
@@ -0,0 +1,85 @@
+// MCP Rate Limiter - Token buckets and admission control
+//
+// This file is part of Telegram Desktop MCP integration.
+// Every tool call costs tokens by its weight, paid both from the bucket
+// of the calling client and from the bucket of the tool shared by all
+// clients, so one client can't starve the others and no single tool can
+// flood Telegram. A call the buckets can't pay for is rejected with the
+// time after which it would pass, nothing waits. Used on the main thread.
+
+#pragma once
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QJsonObject>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+#include <vector>
+
+namespace MCP {
+
+class RateLimiter final {
+public:
+	struct Limits {
+		double rate = 0.; // Tokens per second.
+		double burst = 0.; // Bucket capacity.
+	};
+
+	struct Decision {
+		bool admitted = true;
+		qint64 retryAfterMs = 0;
+		QString reason;
+	};
+
+	// Tool ids are indices in toolIds, every tool costs 1 until set.
+	explicit RateLimiter(const QStringList &toolIds);
+
+	void setCost(int toolId, int cost);
+	void setClientLimits(Limits limits);
+	void setToolLimits(Limits limits);
+
+	// Takes the tokens only when both buckets have enough of them. An
+	// unknown tool id is only charged to the client.
+	[[nodiscard]] Decision admit(const QString &client, int toolId);
+
+	// A call dropped because the work queue was full.
+	void recordShed(int toolId);
+
+	[[nodiscard]] QJsonObject snapshot() const;
+	[[nodiscard]] QByteArray prometheus() const;
+
+private:
+	struct Bucket {
+		double tokens = 0.;
+		qint64 updated = 0; // ms
+	};
+
+	struct ToolState {
+		Bucket bucket;
+		int cost = 1;
+		quint64 admitted = 0;
+		quint64 throttled = 0;
+		quint64 shed = 0;
+	};
+
+	[[nodiscard]] static double Refill(
+		Bucket &bucket,
+		const Limits &limits,
+		qint64 now);
+	[[nodiscard]] static qint64 WaitMs(
+		double tokens,
+		double cost,
+		const Limits &limits);
+	void pruneClients(qint64 now);
+
+	QStringList _toolNames;
+	std::vector<ToolState> _tools;
+	QHash<QString, Bucket> _clients;
+	Limits _clientLimits;
+	Limits _toolLimits;
+	quint64 _clientThrottled = 0;
+
+};
+
+} // namespace MCP
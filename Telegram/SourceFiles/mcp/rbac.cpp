@@ -2,6 +2,7 @@
 // Licensed under GPLv3 with OpenSSL exception.
 
 #include "rbac.h"
+#include "database_pool.h"
 
 #include <QtCore/QCryptographicHash>
 #include <QtCore/QRandomGenerator>
@@ -10,6 +11,8 @@
 #include <QtSql/QSqlQuery>
 #include <QtSql/QSqlError>
 
+#include <algorithm>
+
 namespace MCP {
 
 // Static tool permission mappings
@@ -39,12 +42,12 @@ RBAC::~RBAC() {
 	stop();
 }
 
-bool RBAC::start(QSqlDatabase *db) {
-	if (_isRunning || !db || !db->isOpen()) {
+bool RBAC::start(DatabasePool *pool) {
+	if (_isRunning || !pool || !pool->isOpen()) {
 		return false;
 	}
 
-	_db = db;
+	_pool = pool;
 
 	// Load API keys from database
 	if (!loadAPIKeys()) {
@@ -61,7 +64,8 @@ void RBAC::stop() {
 	}
 
 	_apiKeys.clear();
-	_db = nullptr;
+	keysChanged();
+	_pool = nullptr;
 	_isRunning = false;
 }
 
@@ -95,6 +99,8 @@ QString RBAC::createAPIKey(
 	// Add to memory
 	_apiKeys[keyHash] = key;
 
+	keysChanged();
+
 	Q_EMIT apiKeyCreated(keyHash, name);
 
 	return apiKey;  // Return the full key (only time it's visible)
@@ -110,6 +116,7 @@ bool RBAC::revokeAPIKey(const QString &keyHash) {
 	_apiKeys[keyHash].lastUsedAt = QDateTime::currentDateTime();
 
 	updateAPIKeyInDB(_apiKeys[keyHash]);
+	keysChanged();
 
 	Q_EMIT apiKeyRevoked(keyHash);
 	return true;
@@ -132,6 +139,7 @@ bool RBAC::updateAPIKey(const QString &keyHash, const QJsonObject &updates) {
 	}
 
 	updateAPIKeyInDB(key);
+	keysChanged();
 	return true;
 }
 
@@ -143,6 +151,7 @@ bool RBAC::extendExpiration(const QString &keyHash, const QDateTime &newExpirati
 
 	_apiKeys[keyHash].expiresAt = newExpiration;
 	updateAPIKeyInDB(_apiKeys[keyHash]);
+	keysChanged();
 	return true;
 }
 
@@ -253,7 +262,66 @@ PermissionCheckResult RBAC::checkToolPermission(
 	}
 
 	// Check if user has ANY of the required permissions
-	return checkPermission(keyHash, *toolPerms.begin());
+	PermissionCheckResult result;
+	result.granted = false;
+	result.userId = keyHash;
+
+	if (!isAPIKeyValid(keyHash)) {
+		result.reason = "API key invalid or expired";
+		return result;
+	}
+
+	const APIKey &key = _apiKeys[keyHash];
+	result.role = key.role;
+	if (grantedMask(key) & ToMask(toolPerms)) {
+		result.granted = true;
+		recordKeyUsage(keyHash);
+	} else {
+		result.reason = "Permission denied: " + toolName;
+		Q_EMIT permissionDenied(keyHash, toolName);
+	}
+	return result;
+}
+
+void RBAC::compileToolPermissions(const QStringList &toolIds) {
+	_toolMasks.assign(toolIds.size(), PermissionMask(0));
+	for (auto i = 0; i != int(toolIds.size()); ++i) {
+		_toolMasks[i] = ToMask(getToolPermissions(toolIds[i]));
+	}
+}
+
+AuthContext RBAC::authenticate(const QString &apiKey) const {
+	return contextFor(hashAPIKey(apiKey));
+}
+
+bool RBAC::authorize(AuthContext &context, int toolId) const {
+	if (context.generation != _generation) {
+		// A key was revoked, changed or reloaded since, verify again.
+		context = contextFor(context.keyHash);
+	}
+	if (!context.valid) {
+		return false;
+	} else if (context.expiresAt
+		&& QDateTime::currentSecsSinceEpoch() >= context.expiresAt) {
+		return false;
+	}
+	const auto required = (toolId >= 0 && toolId < int(_toolMasks.size()))
+		? _toolMasks[toolId]
+		: PermissionMask(0);
+	return !required || (required & context.granted);
+}
+
+AuthContext &RBAC::context(const QString &apiKey) {
+	constexpr auto kMaxContexts = 1024;
+
+	auto i = _contexts.find(apiKey);
+	if (i == _contexts.end()) {
+		if (_contexts.size() >= kMaxContexts) {
+			_contexts.clear();
+		}
+		i = _contexts.insert(apiKey, authenticate(apiKey));
+	}
+	return *i;
 }
 
 // Has permission
@@ -384,17 +452,20 @@ QJsonArray RBAC::exportAllAPIKeys() {
 
 // Maintenance
 bool RBAC::purgeExpiredKeys() {
-	if (!_db || !_db->isOpen()) {
+	if (!_pool || !_pool->isOpen()) {
 		return false;
 	}
 
 	qint64 now = QDateTime::currentSecsSinceEpoch();
 
-	QSqlQuery query(*_db);
-	query.prepare("DELETE FROM api_keys WHERE expires_at < :now AND expires_at IS NOT NULL");
-	query.bindValue(":now", now);
+	auto success = false;
+	_pool->writeAndWait([&](QSqlDatabase &db) {
+		QSqlQuery query(db);
+		query.prepare("DELETE FROM api_keys WHERE expires_at < :now AND expires_at IS NOT NULL");
+		query.bindValue(":now", now);
 
-	bool success = query.exec();
+		success = query.exec();
+	});
 
 	if (success) {
 		// Reload keys
@@ -405,17 +476,20 @@ bool RBAC::purgeExpiredKeys() {
 }
 
 bool RBAC::purgeRevokedKeys(int daysOld) {
-	if (!_db || !_db->isOpen()) {
+	if (!_pool || !_pool->isOpen()) {
 		return false;
 	}
 
 	qint64 cutoff = QDateTime::currentDateTime().addDays(-daysOld).toSecsSinceEpoch();
 
-	QSqlQuery query(*_db);
-	query.prepare("DELETE FROM api_keys WHERE is_revoked = 1 AND last_used_at < :cutoff");
-	query.bindValue(":cutoff", cutoff);
+	auto success = false;
+	_pool->writeAndWait([&](QSqlDatabase &db) {
+		QSqlQuery query(db);
+		query.prepare("DELETE FROM api_keys WHERE is_revoked = 1 AND last_used_at < :cutoff");
+		query.bindValue(":cutoff", cutoff);
 
-	bool success = query.exec();
+		success = query.exec();
+	});
 
 	if (success) {
 		// Reload keys
@@ -541,6 +615,47 @@ QSet<Permission> RBAC::jsonToPermissions(const QJsonArray &json) const {
 	return permissions;
 }
 
+PermissionMask RBAC::grantedMask(const APIKey &key) const {
+	const auto mask = ToMask(key.customPermissions.isEmpty()
+		? getRolePermissions(key.role)
+		: key.customPermissions);
+	return (mask & PermissionBit(Permission::Admin)) ? kAllPermissions : mask;
+}
+
+PermissionMask RBAC::ToMask(const QSet<Permission> &permissions) {
+	auto result = PermissionMask(0);
+	for (const auto permission : permissions) {
+		result |= PermissionBit(permission);
+	}
+	return result;
+}
+
+AuthContext RBAC::contextFor(const QString &keyHash) const {
+	auto result = AuthContext();
+	result.keyHash = keyHash;
+	result.generation = _generation;
+
+	const auto i = _apiKeys.constFind(keyHash);
+	if (i == _apiKeys.cend() || !isAPIKeyValid(keyHash)) {
+		return result;
+	}
+	result.granted = grantedMask(*i);
+	result.expiresAt = i->expiresAt.isValid()
+		? i->expiresAt.toSecsSinceEpoch()
+		: 0;
+	result.valid = true;
+	return result;
+}
+
+void RBAC::keysChanged() {
+	++_generation;
+	_contexts.clear();
+	_authRequired = std::any_of(
+		_apiKeys.cbegin(),
+		_apiKeys.cend(),
+		[](const APIKey &key) { return !key.isRevoked; });
+}
+
 QSet<Permission> RBAC::getDefaultRolePermissions(Role role) const {
 	switch (role) {
 	case Role::Admin:
@@ -577,13 +692,13 @@ QSet<Permission> RBAC::getDefaultRolePermissions(Role role) const {
 
 // Database operations
 bool RBAC::loadAPIKeys() {
-	if (!_db || !_db->isOpen()) {
+	if (!_pool || !_pool->isOpen()) {
 		return false;
 	}
 
 	_apiKeys.clear();
 
-	QSqlQuery query(*_db);
+	QSqlQuery query(_pool->reader());
 	query.exec("SELECT * FROM api_keys");
 
 	while (query.next()) {
@@ -613,79 +728,92 @@ bool RBAC::loadAPIKeys() {
 
 		_apiKeys[key.keyHash] = key;
 	}
+	keysChanged();
 
 	return true;
 }
 
 bool RBAC::saveAPIKey(const APIKey &key) {
-	if (!_db || !_db->isOpen()) {
+	if (!_pool || !_pool->isOpen()) {
 		return false;
 	}
 
-	QSqlQuery query(*_db);
-	query.prepare(R"(
-		INSERT INTO api_keys (
-			api_key_hash, api_key_prefix, name, role, permissions,
-			created_at, expires_at, is_revoked
-		) VALUES (
-			:key_hash, :key_prefix, :name, :role, :permissions,
-			:created_at, :expires_at, :is_revoked
-		)
-	)");
-
-	query.bindValue(":key_hash", key.keyHash);
-	query.bindValue(":key_prefix", key.keyPrefix);
-	query.bindValue(":name", key.name);
-	query.bindValue(":role", roleToString(key.role));
-
-	if (!key.customPermissions.isEmpty()) {
-		QJsonDocument doc(permissionsToJson(key.customPermissions));
-		query.bindValue(":permissions", QString(doc.toJson(QJsonDocument::Compact)));
-	} else {
-		query.bindValue(":permissions", QVariant());
-	}
+	auto success = false;
+	_pool->writeAndWait([&](QSqlDatabase &db) {
+		QSqlQuery query(db);
+		query.prepare(R"(
+			INSERT INTO api_keys (
+				api_key_hash, api_key_prefix, name, role, permissions,
+				created_at, expires_at, is_revoked
+			) VALUES (
+				:key_hash, :key_prefix, :name, :role, :permissions,
+				:created_at, :expires_at, :is_revoked
+			)
+		)");
+
+		query.bindValue(":key_hash", key.keyHash);
+		query.bindValue(":key_prefix", key.keyPrefix);
+		query.bindValue(":name", key.name);
+		query.bindValue(":role", roleToString(key.role));
+
+		if (!key.customPermissions.isEmpty()) {
+			QJsonDocument doc(permissionsToJson(key.customPermissions));
+			query.bindValue(":permissions", QString(doc.toJson(QJsonDocument::Compact)));
+		} else {
+			query.bindValue(":permissions", QVariant());
+		}
 
-	query.bindValue(":created_at", key.createdAt.toSecsSinceEpoch());
-	query.bindValue(":expires_at", key.expiresAt.isValid() ? key.expiresAt.toSecsSinceEpoch() : QVariant());
-	query.bindValue(":is_revoked", key.isRevoked);
+		query.bindValue(":created_at", key.createdAt.toSecsSinceEpoch());
+		query.bindValue(":expires_at", key.expiresAt.isValid() ? key.expiresAt.toSecsSinceEpoch() : QVariant());
+		query.bindValue(":is_revoked", key.isRevoked);
 
-	return query.exec();
+		success = query.exec();
+	});
+	return success;
 }
 
 bool RBAC::updateAPIKeyInDB(const APIKey &key) {
-	if (!_db || !_db->isOpen()) {
+	if (!_pool || !_pool->isOpen()) {
 		return false;
 	}
 
-	QSqlQuery query(*_db);
-	query.prepare(R"(
-		UPDATE api_keys SET
-			name = :name,
-			expires_at = :expires_at,
-			last_used_at = :last_used_at,
-			is_revoked = :is_revoked
-		WHERE api_key_hash = :key_hash
-	)");
-
-	query.bindValue(":name", key.name);
-	query.bindValue(":expires_at", key.expiresAt.isValid() ? key.expiresAt.toSecsSinceEpoch() : QVariant());
-	query.bindValue(":last_used_at", key.lastUsedAt.isValid() ? key.lastUsedAt.toSecsSinceEpoch() : QVariant());
-	query.bindValue(":is_revoked", key.isRevoked);
-	query.bindValue(":key_hash", key.keyHash);
-
-	return query.exec();
+	auto success = false;
+	_pool->writeAndWait([&](QSqlDatabase &db) {
+		QSqlQuery query(db);
+		query.prepare(R"(
+			UPDATE api_keys SET
+				name = :name,
+				expires_at = :expires_at,
+				last_used_at = :last_used_at,
+				is_revoked = :is_revoked
+			WHERE api_key_hash = :key_hash
+		)");
+
+		query.bindValue(":name", key.name);
+		query.bindValue(":expires_at", key.expiresAt.isValid() ? key.expiresAt.toSecsSinceEpoch() : QVariant());
+		query.bindValue(":last_used_at", key.lastUsedAt.isValid() ? key.lastUsedAt.toSecsSinceEpoch() : QVariant());
+		query.bindValue(":is_revoked", key.isRevoked);
+		query.bindValue(":key_hash", key.keyHash);
+
+		success = query.exec();
+	});
+	return success;
 }
 
 bool RBAC::deleteAPIKeyFromDB(const QString &keyHash) {
-	if (!_db || !_db->isOpen()) {
+	if (!_pool || !_pool->isOpen()) {
 		return false;
 	}
 
-	QSqlQuery query(*_db);
-	query.prepare("DELETE FROM api_keys WHERE api_key_hash = :key_hash");
-	query.bindValue(":key_hash", keyHash);
+	auto success = false;
+	_pool->writeAndWait([&](QSqlDatabase &db) {
+		QSqlQuery query(db);
+		query.prepare("DELETE FROM api_keys WHERE api_key_hash = :key_hash");
+		query.bindValue(":key_hash", keyHash);
 
-	return query.exec();
+		success = query.exec();
+	});
+	return success;
 }
 
 } // namespace MCP
@@ -11,9 +11,14 @@
 #include <QtCore/QJsonArray>
 #include <QtSql/QSqlDatabase>
 #include <QtCore/QCryptographicHash>
+#include <QtCore/QHash>
+
+#include <vector>
 
 namespace MCP {
 
+class DatabasePool;
+
 // Permission enumeration
 enum class Permission {
 	// Message permissions
@@ -51,6 +56,16 @@ enum class Permission {
 	Admin  // All permissions
 };
 
+// One bit per Permission, Admin sets all of them.
+using PermissionMask = quint32;
+
+[[nodiscard]] constexpr PermissionMask PermissionBit(Permission permission) {
+	return PermissionMask(1) << static_cast<int>(permission);
+}
+
+inline constexpr auto kAllPermissions = ~PermissionMask(0);
+static_assert(static_cast<int>(Permission::Admin) < 32);
+
 // Predefined roles
 enum class Role {
 	Admin,       // Full access
@@ -82,6 +97,16 @@ struct PermissionCheckResult {
 	Role role;
 };
 
+// Verified key of a connection, kept by the caller between requests so
+// only the first one hashes and looks up the key.
+struct AuthContext {
+	QString keyHash;
+	PermissionMask granted = 0;
+	qint64 expiresAt = 0; // Seconds since epoch, 0 if the key never expires.
+	quint64 generation = 0; // Keys changed since when it is not current.
+	bool valid = false;
+};
+
 // Role-based access control manager
 class RBAC : public QObject {
 	Q_OBJECT
@@ -91,7 +116,7 @@ public:
 	~RBAC();
 
 	// Initialization
-	bool start(QSqlDatabase *db);
+	bool start(DatabasePool *pool);
 	void stop();
 	[[nodiscard]] bool isRunning() const { return _isRunning; }
 
@@ -123,6 +148,19 @@ public:
 		const QString &toolName
 	);
 
+	// Fast path: tool ids are the indices of the names given to
+	// compileToolPermissions(), an unknown id requires nothing.
+	void compileToolPermissions(const QStringList &toolIds);
+	[[nodiscard]] AuthContext authenticate(const QString &apiKey) const;
+	[[nodiscard]] bool authorize(AuthContext &context, int toolId) const;
+
+	// Context of a key cached by the key itself, for transports that
+	// present it with every request.
+	[[nodiscard]] AuthContext &context(const QString &apiKey);
+
+	// True while at least one key is not revoked.
+	[[nodiscard]] bool authRequired() const { return _authRequired; }
+
 	bool hasPermission(const QString &keyHash, Permission permission);
 	bool hasAnyPermission(const QString &keyHash, const QSet<Permission> &permissions);
 	bool hasAllPermissions(const QString &keyHash, const QSet<Permission> &permissions);
@@ -177,9 +215,22 @@ private:
 	// Default role permissions
 	QSet<Permission> getDefaultRolePermissions(Role role) const;
 
-	QSqlDatabase *_db = nullptr;
+	// Compiled permissions
+	[[nodiscard]] PermissionMask grantedMask(const APIKey &key) const;
+	[[nodiscard]] static PermissionMask ToMask(const QSet<Permission> &permissions);
+	[[nodiscard]] AuthContext contextFor(const QString &keyHash) const;
+	void keysChanged();
+
+	DatabasePool *_pool = nullptr;
 	bool _isRunning = false;
-	QMap<QString, APIKey> _apiKeys;  // keyHash -> APIKey
+	QHash<QString, APIKey> _apiKeys;  // keyHash -> APIKey
+	quint64 _generation = 1;
+	bool _authRequired = false;
+
+	// Required permissions by tool id, a tool passes with any of them
+	std::vector<PermissionMask> _toolMasks;
+
+	QHash<QString, AuthContext> _contexts; // API key -> verified context
 
 	// Tool permission mappings
 	static QMap<QString, QSet<Permission>> _toolPermissions;
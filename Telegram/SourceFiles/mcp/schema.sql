@@ -34,15 +34,52 @@ CREATE TABLE IF NOT EXISTS messages (
     is_reply BOOLEAN DEFAULT 0,
     metadata TEXT,  -- JSON blob for additional data
     created_at INTEGER DEFAULT (strftime('%s', 'now')),
+    cold_segment INTEGER,  -- cold_segments.id once content/metadata moved out
     UNIQUE(chat_id, message_id)
 );
 
 -- Indexes for fast queries
-CREATE INDEX IF NOT EXISTS idx_messages_chat_timestamp ON messages(chat_id, timestamp DESC);
+CREATE INDEX IF NOT EXISTS idx_messages_chat_timestamp ON messages(chat_id, timestamp DESC, message_id DESC);
 CREATE INDEX IF NOT EXISTS idx_messages_user ON messages(user_id, timestamp DESC);
 CREATE INDEX IF NOT EXISTS idx_messages_date ON messages(date);
 CREATE INDEX IF NOT EXISTS idx_messages_type ON messages(message_type);
-CREATE INDEX IF NOT EXISTS idx_messages_content_fts ON messages(content) WHERE content IS NOT NULL;
+
+-- Cold storage: content/metadata of old messages live in compressed
+-- segment files cold/<chat_id>/<id>.seg next to the database
+CREATE TABLE IF NOT EXISTS cold_segments (
+    id INTEGER PRIMARY KEY,  -- messages.id of the first row in the segment
+    chat_id INTEGER NOT NULL,
+    first_timestamp INTEGER NOT NULL,
+    last_timestamp INTEGER NOT NULL,
+    message_count INTEGER NOT NULL,
+    bytes INTEGER NOT NULL,
+    created_at INTEGER DEFAULT (strftime('%s', 'now'))
+);
+CREATE INDEX IF NOT EXISTS idx_cold_segments_chat ON cold_segments(chat_id, last_timestamp);
+
+-- Full-text index over message content (external content, kept in sync by triggers)
+-- unicode61 folds case for Latin, Cyrillic and other scripts; runs of CJK
+-- ideographs form a single token and are matched by prefix queries.
+CREATE VIRTUAL TABLE IF NOT EXISTS messages_fts USING fts5(
+    content,
+    content='messages',
+    content_rowid='id',
+    tokenize='unicode61 remove_diacritics 2'
+);
+
+-- INSERT OR REPLACE only fires the delete trigger with PRAGMA recursive_triggers = ON
+CREATE TRIGGER IF NOT EXISTS messages_fts_insert AFTER INSERT ON messages BEGIN
+    INSERT INTO messages_fts(rowid, content) VALUES (NEW.id, NEW.content);
+END;
+
+CREATE TRIGGER IF NOT EXISTS messages_fts_delete AFTER DELETE ON messages BEGIN
+    INSERT INTO messages_fts(messages_fts, rowid, content) VALUES ('delete', OLD.id, OLD.content);
+END;
+
+CREATE TRIGGER IF NOT EXISTS messages_fts_update AFTER UPDATE OF content ON messages BEGIN
+    INSERT INTO messages_fts(messages_fts, rowid, content) VALUES ('delete', OLD.id, OLD.content);
+    INSERT INTO messages_fts(rowid, content) VALUES (NEW.id, NEW.content);
+END;
 
 -- ===================================
 -- 2. EPHEMERAL MESSAGE ARCHIVAL
@@ -109,7 +146,7 @@ CREATE TABLE IF NOT EXISTS users (
 -- 4. ANALYTICS TABLES
 -- ===================================
 
--- Daily message statistics (materialized view concept)
+-- Daily message statistics, UTC days (maintained by message_rollups_* triggers)
 CREATE TABLE IF NOT EXISTS message_stats_daily (
     id INTEGER PRIMARY KEY AUTOINCREMENT,
     date TEXT NOT NULL,
@@ -119,12 +156,54 @@ CREATE TABLE IF NOT EXISTS message_stats_daily (
     avg_message_length REAL DEFAULT 0,
     total_words INTEGER DEFAULT 0,
     media_count INTEGER DEFAULT 0,
+    text_count INTEGER DEFAULT 0,
+    edited_count INTEGER DEFAULT 0,
+    total_length INTEGER DEFAULT 0,
+    first_timestamp INTEGER,
+    last_timestamp INTEGER,
     UNIQUE(date, chat_id)
 );
 
 CREATE INDEX IF NOT EXISTS idx_stats_daily_date ON message_stats_daily(date DESC);
 CREATE INDEX IF NOT EXISTS idx_stats_daily_chat ON message_stats_daily(chat_id, date DESC);
 
+-- Messages per chat, day and user: distinct users over any range of days
+CREATE TABLE IF NOT EXISTS user_activity_daily (
+    chat_id INTEGER NOT NULL,
+    date TEXT NOT NULL,
+    user_id INTEGER NOT NULL,
+    message_count INTEGER DEFAULT 0,
+    PRIMARY KEY(chat_id, date, user_id)
+) WITHOUT ROWID;
+
+-- Messages per chat, UTC hour (timestamp / 3600), user and type:
+-- hour of day, day of week and hourly series without strftime()
+CREATE TABLE IF NOT EXISTS message_activity_hourly (
+    chat_id INTEGER NOT NULL,
+    hour INTEGER NOT NULL,
+    user_id INTEGER NOT NULL,
+    message_type TEXT NOT NULL,
+    message_count INTEGER DEFAULT 0,
+    total_length INTEGER DEFAULT 0,
+    PRIMARY KEY(chat_id, hour, user_id, message_type)
+) WITHOUT ROWID;
+
+CREATE INDEX IF NOT EXISTS idx_activity_hourly_user ON message_activity_hourly(user_id, hour);
+
+-- HyperLogLog / Space-Saving sketches per day and chat (chat_id 0 = all
+-- chats), refreshed lazily where message_count differs from the rollups
+CREATE TABLE IF NOT EXISTS activity_sketches_daily (
+    date TEXT NOT NULL,
+    chat_id INTEGER NOT NULL,
+    message_count INTEGER NOT NULL,
+    users BLOB,
+    top_users BLOB,
+    top_chats BLOB,
+    PRIMARY KEY(date, chat_id)
+) WITHOUT ROWID;
+
+CREATE INDEX IF NOT EXISTS idx_activity_sketches_chat ON activity_sketches_daily(chat_id, date);
+
 -- User activity summary
 CREATE TABLE IF NOT EXISTS user_activity_summary (
     id INTEGER PRIMARY KEY AUTOINCREMENT,
@@ -138,10 +217,14 @@ CREATE TABLE IF NOT EXISTS user_activity_summary (
     last_message_date INTEGER,
     days_active INTEGER DEFAULT 0,
     updated_at INTEGER,
+    user_name TEXT,
+    reply_count INTEGER DEFAULT 0,
+    total_length INTEGER DEFAULT 0,
     UNIQUE(user_id, chat_id)
 );
 
 CREATE INDEX IF NOT EXISTS idx_user_activity ON user_activity_summary(user_id, chat_id);
+CREATE INDEX IF NOT EXISTS idx_user_activity_chat ON user_activity_summary(chat_id, message_count DESC);
 
 -- Chat activity summary
 CREATE TABLE IF NOT EXISTS chat_activity_summary (
@@ -166,7 +249,7 @@ CREATE TABLE IF NOT EXISTS message_embeddings (
     message_id INTEGER PRIMARY KEY,
     chat_id INTEGER NOT NULL,
     content TEXT NOT NULL,
-    embedding BLOB,  -- Serialized vector (384 dimensions for all-MiniLM-L6-v2)
+    embedding BLOB,  -- int8 codes with a 12-byte scale/norm header, or raw float32
     embedding_model TEXT DEFAULT 'all-MiniLM-L6-v2',
     created_at INTEGER DEFAULT (strftime('%s', 'now')),
     FOREIGN KEY (message_id) REFERENCES messages(id)
@@ -174,6 +257,12 @@ CREATE TABLE IF NOT EXISTS message_embeddings (
 
 CREATE INDEX IF NOT EXISTS idx_embeddings_chat ON message_embeddings(chat_id);
 
+-- Replaced or purged messages lose their embedding
+CREATE TRIGGER IF NOT EXISTS message_embeddings_delete
+AFTER DELETE ON messages BEGIN
+    DELETE FROM message_embeddings WHERE message_id = old.id;
+END;
+
 -- Intent classification results
 CREATE TABLE IF NOT EXISTS message_intents (
     message_id INTEGER PRIMARY KEY,
@@ -184,7 +273,8 @@ CREATE TABLE IF NOT EXISTS message_intents (
     FOREIGN KEY (message_id) REFERENCES messages(id)
 );
 
--- Message clusters (for topic grouping)
+-- Message clusters (for topic grouping), one row per embedded message
+-- with its nearest topic centroid. Labels are kept in topic_centroids.
 CREATE TABLE IF NOT EXISTS message_clusters (
     id INTEGER PRIMARY KEY AUTOINCREMENT,
     cluster_id INTEGER NOT NULL,
@@ -196,6 +286,24 @@ CREATE TABLE IF NOT EXISTS message_clusters (
     FOREIGN KEY (message_id) REFERENCES messages(id)
 );
 
+CREATE UNIQUE INDEX IF NOT EXISTS idx_clusters_message ON message_clusters(message_id);
+CREATE INDEX IF NOT EXISTS idx_clusters_chat ON message_clusters(chat_id, cluster_id, similarity_score DESC);
+
+-- Topic centroids per chat (float32 blob), message_count sets the step
+-- of streaming updates, trained_count the chat size at training
+CREATE TABLE IF NOT EXISTS topic_centroids (
+    chat_id INTEGER NOT NULL,
+    cluster_id INTEGER NOT NULL,
+    embedding_model TEXT NOT NULL,
+    centroid BLOB NOT NULL,
+    message_count INTEGER NOT NULL DEFAULT 0,
+    trained_count INTEGER NOT NULL DEFAULT 0,
+    topic_label TEXT,
+    key_terms TEXT,
+    updated_at INTEGER DEFAULT (strftime('%s', 'now')),
+    PRIMARY KEY (chat_id, cluster_id)
+);
+
 -- ===================================
 -- 6. SCHEDULED MESSAGES
 -- ===================================
@@ -225,23 +333,35 @@ CREATE INDEX IF NOT EXISTS idx_scheduled_next ON scheduled_messages(next_schedul
 -- 7. AUDIT LOGGING
 -- ===================================
 
-CREATE TABLE IF NOT EXISTS audit_log (
-    id INTEGER PRIMARY KEY AUTOINCREMENT,
-    event_type TEXT NOT NULL,  -- 'tool_invoked', 'auth_event', 'discord_op', 'system_event'
-    event_subtype TEXT,  -- Specific operation
-    user_id TEXT,  -- API key or user identifier
-    tool_name TEXT,
-    parameters TEXT,  -- JSON blob
-    result_status TEXT,  -- 'success', 'failure', 'partial'
-    error_message TEXT,
-    duration_ms INTEGER,
-    timestamp INTEGER NOT NULL DEFAULT (strftime('%s', 'now')),
-    metadata TEXT  -- JSON blob for additional context
+-- Events live in one audit_log_<yyyyMMdd> table per week (named after its
+-- Monday, UTC), created by AuditLogger with the columns below and indexes
+-- on timestamp, event_type, user_id and tool_name. A single audit_log
+-- table from older versions is moved into them on start.
+--
+--   id INTEGER PRIMARY KEY, event_type TEXT NOT NULL, event_subtype TEXT,
+--   user_id TEXT, tool_name TEXT, parameters TEXT, result_status TEXT,
+--   error_message TEXT, duration_ms INTEGER, timestamp INTEGER NOT NULL,
+--   metadata TEXT
+
+CREATE TABLE IF NOT EXISTS audit_partitions (
+    week INTEGER PRIMARY KEY,  -- Days since epoch of its Monday
+    event_count INTEGER NOT NULL DEFAULT 0,
+    last_id INTEGER NOT NULL DEFAULT 0,
+    dropped INTEGER NOT NULL DEFAULT 0  -- Past retention, only stats remain
 );
 
-CREATE INDEX IF NOT EXISTS idx_audit_type ON audit_log(event_type, timestamp DESC);
-CREATE INDEX IF NOT EXISTS idx_audit_user ON audit_log(user_id, timestamp DESC);
-CREATE INDEX IF NOT EXISTS idx_audit_tool ON audit_log(tool_name, timestamp DESC);
+-- Kept after the week's partition is dropped
+CREATE TABLE IF NOT EXISTS audit_stats (
+    week INTEGER NOT NULL,
+    event_type TEXT NOT NULL,
+    tool_name TEXT NOT NULL DEFAULT '',
+    user_id TEXT NOT NULL DEFAULT '',
+    event_count INTEGER NOT NULL DEFAULT 0,
+    failure_count INTEGER NOT NULL DEFAULT 0,
+    duration_total INTEGER NOT NULL DEFAULT 0,
+    duration_count INTEGER NOT NULL DEFAULT 0,
+    PRIMARY KEY (week, event_type, tool_name, user_id)
+) WITHOUT ROWID;
 
 -- ===================================
 -- 8. AUTHENTICATION & AUTHORIZATION
@@ -359,6 +479,19 @@ CREATE TABLE IF NOT EXISTS metrics_cache (
     updated_at INTEGER DEFAULT (strftime('%s', 'now'))
 );
 
+-- ===================================
+-- 14. CHANGE LOG (get_updates)
+-- ===================================
+
+-- Numbered message and peer changes, the oldest rows are pruned
+CREATE TABLE IF NOT EXISTS change_log (
+    sequence INTEGER PRIMARY KEY,
+    kind INTEGER NOT NULL,  -- 1 new, 2 edited, 3 deleted, 4 peer
+    chat_id INTEGER NOT NULL,
+    message_id INTEGER NOT NULL DEFAULT 0,
+    date INTEGER NOT NULL
+);
+
 -- ===================================
 -- VIEWS FOR QUICK QUERIES
 -- ===================================
@@ -393,28 +526,12 @@ ORDER BY total_messages DESC;
 -- TRIGGERS FOR AUTOMATIC STATS UPDATES
 -- ===================================
 
--- Update chat activity summary on new message
-CREATE TRIGGER IF NOT EXISTS update_chat_stats_on_insert
-AFTER INSERT ON messages
-BEGIN
-    INSERT OR REPLACE INTO chat_activity_summary (
-        chat_id,
-        total_messages,
-        unique_users,
-        first_message_date,
-        last_message_date,
-        updated_at
-    )
-    SELECT
-        NEW.chat_id,
-        COUNT(*),
-        COUNT(DISTINCT user_id),
-        MIN(timestamp),
-        MAX(timestamp),
-        strftime('%s', 'now')
-    FROM messages
-    WHERE chat_id = NEW.chat_id;
-END;
+-- message_rollups_insert / message_rollups_delete are created by
+-- ChatArchiver::initializeRollups(): every row adds to or subtracts from
+-- message_stats_daily, user_activity_daily, user_activity_summary and
+-- chat_activity_summary, so analytics never rescan messages.
+-- message_cube_insert / message_cube_delete do the same for
+-- message_activity_hourly.
 
 -- ===================================
 -- INITIALIZATION DATA
@@ -440,12 +557,13 @@ CREATE TABLE IF NOT EXISTS message_tags (
     id INTEGER PRIMARY KEY AUTOINCREMENT,
     chat_id INTEGER NOT NULL,
     message_id INTEGER NOT NULL,
-    tag TEXT NOT NULL,
-    created_at INTEGER DEFAULT (strftime('%s', 'now')),
-    UNIQUE(chat_id, message_id, tag)
+    tag_name TEXT NOT NULL,
+    color TEXT,
+    created_at TEXT,
+    UNIQUE(chat_id, message_id, tag_name)
 );
 
-CREATE INDEX IF NOT EXISTS idx_tags_tag ON message_tags(tag);
+CREATE INDEX IF NOT EXISTS idx_tags_tag ON message_tags(tag_name);
 CREATE INDEX IF NOT EXISTS idx_tags_chat ON message_tags(chat_id);
 
 -- Translation cache
@@ -453,14 +571,16 @@ CREATE TABLE IF NOT EXISTS translation_cache (
     id INTEGER PRIMARY KEY AUTOINCREMENT,
     chat_id INTEGER NOT NULL,
     message_id INTEGER NOT NULL,
-    target_lang TEXT NOT NULL,
+    content_hash TEXT NOT NULL,  -- SHA-1 of original_text, shared by equal texts
+    source_language TEXT,
+    target_language TEXT NOT NULL,
     original_text TEXT,
     translated_text TEXT NOT NULL,
     created_at INTEGER DEFAULT (strftime('%s', 'now')),
-    UNIQUE(chat_id, message_id, target_lang)
+    UNIQUE(chat_id, message_id, target_language)
 );
 
-CREATE INDEX IF NOT EXISTS idx_trans_msg ON translation_cache(chat_id, message_id);
+CREATE INDEX IF NOT EXISTS idx_trans_hash ON translation_cache(content_hash, target_language);
 
 -- Auto-translate configuration per chat
 CREATE TABLE IF NOT EXISTS auto_translate_config (
@@ -660,18 +780,38 @@ CREATE TABLE IF NOT EXISTS wallet_budgets (
     created_at INTEGER DEFAULT (strftime('%s', 'now'))
 );
 
--- Wallet spending log
+-- Wallet spending log, Stars transactions synced by WalletSync
+-- (wallet_sync.cpp creates these with the monthly totals triggers)
 CREATE TABLE IF NOT EXISTS wallet_spending (
     id INTEGER PRIMARY KEY AUTOINCREMENT,
+    transaction_id TEXT,  -- Telegram transaction id
+    date TEXT,  -- UTC, yyyy-MM-dd HH:mm:ss
+    amount REAL NOT NULL,  -- Negative for spending
+    balance REAL,  -- Balance after the transaction
     category TEXT NOT NULL,
-    amount REAL NOT NULL,
     description TEXT,
-    recipient_id INTEGER,
-    spent_at INTEGER DEFAULT (strftime('%s', 'now'))
+    peer_id INTEGER
 );
 
-CREATE INDEX IF NOT EXISTS idx_spending_cat ON wallet_spending(category);
-CREATE INDEX IF NOT EXISTS idx_spending_time ON wallet_spending(spent_at);
+CREATE UNIQUE INDEX IF NOT EXISTS idx_wallet_spending_transaction ON wallet_spending(transaction_id);
+CREATE INDEX IF NOT EXISTS idx_wallet_spending_date ON wallet_spending(date);
+CREATE INDEX IF NOT EXISTS idx_wallet_spending_category ON wallet_spending(category, date);
+
+-- Wallet totals per month and category
+CREATE TABLE IF NOT EXISTS wallet_spending_monthly (
+    month TEXT NOT NULL,  -- yyyy-MM
+    category TEXT NOT NULL,
+    spent REAL NOT NULL DEFAULT 0,
+    income REAL NOT NULL DEFAULT 0,
+    transactions INTEGER NOT NULL DEFAULT 0,
+    PRIMARY KEY (month, category)
+) WITHOUT ROWID;
+
+-- Offsets of the transactions sync
+CREATE TABLE IF NOT EXISTS wallet_sync_state (
+    key TEXT PRIMARY KEY,
+    value TEXT
+);
 
 -- Miniapp budgets
 CREATE TABLE IF NOT EXISTS miniapp_budgets (
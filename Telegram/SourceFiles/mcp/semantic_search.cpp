@@ -3,329 +3,1953 @@
 
 #include "semantic_search.h"
 #include "chat_archiver.h"
-
+#include "database_pool.h"
+#include "mcp_helpers.h"
+#include "topic_clustering.h"
+#include "vector_kernels.h"
+
+#include <QtCore/QDebug>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QMutexLocker>
 #include <QtCore/QRegularExpression>
-#include <QtCore/QCryptographicHash>
+#include <QtCore/QSet>
+#include <QtCore/QThread>
+#include <QtCore/QUrl>
 #include <QtSql/QSqlQuery>
 #include <QtSql/QSqlError>
+#include <array>
 #include <cmath>
+#include <cstring>
+#include <future>
 #include <algorithm>
+#include <limits>
+#include <map>
+#include <optional>
+#include <queue>
+#include <random>
 
 namespace MCP {
+namespace {
+
+constexpr auto kEmbeddingsTable = R"(
+	CREATE TABLE IF NOT EXISTS message_embeddings (
+		message_id INTEGER PRIMARY KEY,
+		chat_id INTEGER NOT NULL,
+		content TEXT NOT NULL,
+		embedding BLOB,
+		embedding_model TEXT DEFAULT 'all-MiniLM-L6-v2',
+		created_at INTEGER DEFAULT (strftime('%s', 'now')),
+		FOREIGN KEY (message_id) REFERENCES messages(id)
+	)
+)";
+constexpr auto kEmbeddingsIndex = R"(
+	CREATE INDEX IF NOT EXISTS idx_embeddings_chat
+	ON message_embeddings(chat_id)
+)";
+// Re-archiving a message replaces its row, so an edited text gets
+// embedded again instead of keeping the vector of the old one.
+constexpr auto kEmbeddingsTrigger = R"(
+	CREATE TRIGGER IF NOT EXISTS message_embeddings_delete
+	AFTER DELETE ON messages BEGIN
+		DELETE FROM message_embeddings WHERE message_id = old.id;
+	END
+)";
+
+// Topics: message_clusters maps every embedded message to its nearest
+// centroid, topic_centroids keeps the float32 centroids with the number
+// of messages merged into each, the step of later streaming updates.
+constexpr auto kClustersTable = R"(
+	CREATE TABLE IF NOT EXISTS message_clusters (
+		id INTEGER PRIMARY KEY AUTOINCREMENT,
+		cluster_id INTEGER NOT NULL,
+		message_id INTEGER NOT NULL,
+		chat_id INTEGER NOT NULL,
+		topic_label TEXT,
+		similarity_score REAL,
+		created_at INTEGER DEFAULT (strftime('%s', 'now')),
+		FOREIGN KEY (message_id) REFERENCES messages(id)
+	)
+)";
+constexpr auto kClustersMessageIndex = R"(
+	CREATE UNIQUE INDEX IF NOT EXISTS idx_clusters_message
+	ON message_clusters(message_id)
+)";
+constexpr auto kClustersChatIndex = R"(
+	CREATE INDEX IF NOT EXISTS idx_clusters_chat
+	ON message_clusters(chat_id, cluster_id, similarity_score DESC)
+)";
+constexpr auto kClustersTrigger = R"(
+	CREATE TRIGGER IF NOT EXISTS message_clusters_delete
+	AFTER DELETE ON messages BEGIN
+		DELETE FROM message_clusters WHERE message_id = old.id;
+	END
+)";
+constexpr auto kCentroidsTable = R"(
+	CREATE TABLE IF NOT EXISTS topic_centroids (
+		chat_id INTEGER NOT NULL,
+		cluster_id INTEGER NOT NULL,
+		embedding_model TEXT NOT NULL,
+		centroid BLOB NOT NULL,
+		message_count INTEGER NOT NULL DEFAULT 0,
+		trained_count INTEGER NOT NULL DEFAULT 0,
+		topic_label TEXT,
+		key_terms TEXT,
+		updated_at INTEGER DEFAULT (strftime('%s', 'now')),
+		PRIMARY KEY (chat_id, cluster_id)
+	)
+)";
+
+constexpr auto kIndexCatchUpSlack = 60; // seconds
+
+// Training uses a reservoir sample, a few passes over it in mini-batches
+// find the same topics as the whole chat would in a fraction of the time.
+constexpr auto kTopicTrainingSample = 32768;
+constexpr auto kTopicAssignChunk = 4096;
+constexpr auto kTopicRetrainGrowth = 2;
+constexpr auto kTopicLabelSample = 200; // Closest members read for terms.
+constexpr auto kTopicKeyTerms = 5;
+constexpr auto kTopicLabelTerms = 3;
+constexpr auto kTopicRepresentatives = 10;
+
+constexpr auto kIntentCount = int(SearchIntent::Other) + 1;
+constexpr auto kEntityTypeCount = int(EntityType::CustomEmoji) + 1;
+constexpr auto kScanPage = 4096; // Messages read per parallel pass.
+constexpr auto kScanChunk = 256;
+constexpr auto kTopEntities = 20;
+
+// Reciprocal rank fusion: score = sum of 1 / (k + rank) over the lists.
+// k = 60 from Cormack et al., it keeps one list's top hit from drowning
+// results that rank well in both.
+constexpr auto kFusionK = 60.;
+constexpr auto kFusionCandidatesPerResult = 4;
+constexpr auto kMinFusionCandidates = 50;
+constexpr auto kSearchThreads = 2;
+
+// Blobs are int8 codes behind a header with their scale and the norm of
+// the decoded vector, a quarter of the float32 size. The tag is a NaN
+// bit pattern, so blobs of raw floats written before can't match it.
+constexpr auto kQuantizedTag = quint32(0x7FA00008);
+
+struct QuantizedHeader {
+	quint32 tag = kQuantizedTag;
+	float scale = 0.f;
+	float norm = 0.f;
+};
+static_assert(sizeof(QuantizedHeader) == 12);
+
+[[nodiscard]] QByteArray SerializeEmbedding(const EmbeddingVector &embedding) {
+	auto limit = 0.f;
+	for (const auto value : embedding) {
+		limit = std::max(limit, std::abs(value));
+	}
+	auto header = QuantizedHeader();
+	header.scale = (limit > 0.f) ? (limit / 127.f) : 1.f;
+
+	auto result = QByteArray(
+		sizeof(QuantizedHeader) + embedding.size(),
+		Qt::Uninitialized);
+	const auto codes = reinterpret_cast<qint8*>(
+		result.data() + sizeof(QuantizedHeader));
+	auto squares = 0.;
+	for (auto i = 0, count = int(embedding.size()); i != count; ++i) {
+		const auto code = std::clamp(
+			qRound(embedding[i] / header.scale),
+			-127,
+			127);
+		codes[i] = qint8(code);
+		squares += double(code) * code;
+	}
+	header.norm = float(header.scale * std::sqrt(squares));
+	std::memcpy(result.data(), &header, sizeof(header));
+	return result;
+}
 
-SemanticSearch::SemanticSearch(ChatArchiver *archiver, QObject *parent)
-	: QObject(parent)
-	, _archiver(archiver) {
-	// Note: _db access removed as it's private in ChatArchiver
-	// Use archiver's public methods instead
+[[nodiscard]] std::optional<QuantizedHeader> ReadQuantized(
+		const QByteArray &blob) {
+	auto header = QuantizedHeader();
+	if (blob.size() < qsizetype(sizeof(header))) {
+		return std::nullopt;
+	}
+	std::memcpy(&header, blob.constData(), sizeof(header));
+	return (header.tag == kQuantizedTag)
+		? std::make_optional(header)
+		: std::nullopt;
 }
 
-SemanticSearch::~SemanticSearch() = default;
+// Normalized again after decoding.
+[[nodiscard]] EmbeddingVector ParseEmbedding(const QByteArray &blob) {
+	if (const auto header = ReadQuantized(blob)) {
+		const auto count = int(blob.size() - sizeof(QuantizedHeader));
+		const auto codes = reinterpret_cast<const qint8*>(
+			blob.constData() + sizeof(QuantizedHeader));
+		const auto scale = (header->norm > 0.f)
+			? (header->scale / header->norm)
+			: 0.f;
+		auto result = EmbeddingVector(count);
+		for (auto i = 0; i != count; ++i) {
+			result[i] = codes[i] * scale;
+		}
+		return result;
+	}
+	auto result = EmbeddingVector(blob.size() / sizeof(float));
+	std::memcpy(result.data(), blob.constData(), result.size() * sizeof(float));
+	return result;
+}
 
-bool SemanticSearch::initialize(const QString &modelPath) {
-	_modelPath = modelPath.isEmpty() ? "all-MiniLM-L6-v2" : modelPath;
-	_isInitialized = true;
+// Scores the stored codes without decoding them, nullopt when the blob
+// belongs to a vector of another size.
+[[nodiscard]] std::optional<float> Similarity(
+		const EmbeddingVector &query,
+		const QByteArray &blob) {
+	const auto count = int(query.size());
+	if (const auto header = ReadQuantized(blob)) {
+		if (blob.size() != qsizetype(sizeof(QuantizedHeader) + count)) {
+			return std::nullopt;
+		} else if (header->norm <= 0.f) {
+			return 0.f;
+		}
+		const auto codes = reinterpret_cast<const qint8*>(
+			blob.constData() + sizeof(QuantizedHeader));
+		return DotProductInt8(query.constData(), codes, count)
+			* header->scale
+			/ header->norm;
+	} else if (blob.size() != qsizetype(count * sizeof(float))) {
+		return std::nullopt;
+	}
+	return DotProduct(
+		query.constData(),
+		reinterpret_cast<const float*>(blob.constData()),
+		count);
+}
+
+
+struct TopicModel {
+	TopicCentroids centroids;
+	qint64 trainedCount = 0;
+};
 
-	// TODO: Initialize actual embedding model
-	// Options:
-	// 1. Python subprocess with sentence-transformers
-	// 2. ONNX Runtime C++ inference
-	// 3. HTTP API to embedding service
+[[nodiscard]] std::optional<TopicModel> LoadTopicModel(
+		const QSqlDatabase &db,
+		qint64 chatId,
+		const QString &model) {
+	auto query = PreparedQuery(db, R"(
+		SELECT centroid, message_count, trained_count FROM topic_centroids
+		WHERE chat_id = :chat_id AND embedding_model = :model
+		ORDER BY cluster_id
+	)");
+	query->bindValue(":chat_id", chatId);
+	query->bindValue(":model", model);
+	if (!query->exec()) {
+		return std::nullopt;
+	}
+	auto result = TopicModel();
+	auto &centroids = result.centroids;
+	while (query->next()) {
+		const auto blob = query->value(0).toByteArray();
+		const auto dimensions = int(blob.size() / sizeof(float));
+		if (!dimensions
+			|| (centroids.dimensions && centroids.dimensions != dimensions)) {
+			return std::nullopt;
+		}
+		const auto values = reinterpret_cast<const float*>(blob.constData());
+		centroids.dimensions = dimensions;
+		centroids.values.insert(
+			centroids.values.end(),
+			values,
+			values + dimensions);
+		centroids.counts.push_back(query->value(1).toLongLong());
+		result.trainedCount = query->value(2).toLongLong();
+	}
+	return centroids.empty() ? std::nullopt : std::make_optional(result);
+}
 
+// Labels are kept, they are only refreshed by detectTopics().
+bool SaveTopicModel(
+		const QSqlDatabase &db,
+		qint64 chatId,
+		const QString &model,
+		const TopicModel &topics) {
+	auto query = PreparedQuery(db, R"(
+		INSERT INTO topic_centroids (
+			chat_id, cluster_id, embedding_model, centroid,
+			message_count, trained_count, updated_at
+		) VALUES (
+			:chat_id, :cluster_id, :model, :centroid,
+			:message_count, :trained_count, strftime('%s', 'now')
+		)
+		ON CONFLICT(chat_id, cluster_id) DO UPDATE SET
+			embedding_model = excluded.embedding_model,
+			centroid = excluded.centroid,
+			message_count = excluded.message_count,
+			trained_count = excluded.trained_count,
+			updated_at = excluded.updated_at
+	)");
+	const auto &centroids = topics.centroids;
+	for (auto topic = 0; topic != centroids.size(); ++topic) {
+		query->bindValue(":chat_id", chatId);
+		query->bindValue(":cluster_id", topic);
+		query->bindValue(":model", model);
+		query->bindValue(":centroid", QByteArray(
+			reinterpret_cast<const char*>(centroids.centroid(topic)),
+			centroids.dimensions * sizeof(float)));
+		query->bindValue(":message_count", centroids.counts[topic]);
+		query->bindValue(":trained_count", topics.trainedCount);
+		if (!query->exec()) {
+			qWarning() << "MCP: Failed to store topic centroid:" << query->lastError().text();
+			return false;
+		}
+	}
 	return true;
 }
 
-// Generate embedding (placeholder)
-EmbeddingVector SemanticSearch::generateEmbedding(const QString &text) {
-	// TODO: Implement actual embedding generation
-	// For now, return zero vector
-	EmbeddingVector embedding(_embeddingDimensions, 0.0f);
+bool SaveTopicAssignments(
+		const QSqlDatabase &db,
+		qint64 chatId,
+		const std::vector<qint64> &ids,
+		const std::vector<TopicAssignment> &assignments) {
+	auto query = PreparedQuery(db, R"(
+		INSERT OR REPLACE INTO message_clusters (
+			cluster_id, message_id, chat_id, similarity_score
+		) VALUES (
+			:cluster_id, :message_id, :chat_id, :similarity
+		)
+	)");
+	for (auto i = 0; i != int(ids.size()); ++i) {
+		query->bindValue(":cluster_id", assignments[i].topic);
+		query->bindValue(":message_id", ids[i]);
+		query->bindValue(":chat_id", chatId);
+		query->bindValue(":similarity", assignments[i].similarity);
+		if (!query->exec()) {
+			qWarning() << "MCP: Failed to store topic assignment:" << query->lastError().text();
+			return false;
+		}
+	}
+	return true;
+}
 
-	// Placeholder: Simple hash-based pseudo-embedding
-	QByteArray hash = QCryptographicHash::hash(text.toUtf8(), QCryptographicHash::Sha256);
-	const int maxSize = qMin(_embeddingDimensions, hash.size());
-	for (int i = 0; i < maxSize; ++i) {
-		embedding[i] = static_cast<float>(static_cast<unsigned char>(hash[i])) / 255.0f;
+// Assigns the vectors to the stored topics and merges them in. False
+// when the chat has no topics of this model and size yet.
+bool MergeTopics(
+		const QSqlDatabase &db,
+		qint64 chatId,
+		const QString &model,
+		const std::vector<qint64> &ids,
+		const std::vector<float> &vectors) {
+	auto topics = LoadTopicModel(db, chatId, model);
+	if (!topics
+		|| ids.empty()
+		|| vectors.size() != ids.size() * topics->centroids.dimensions) {
+		return false;
 	}
+	auto assignments = std::vector<TopicAssignment>(ids.size());
+	AssignTopics(
+		topics->centroids,
+		vectors.data(),
+		int(ids.size()),
+		assignments.data());
+	MergeIntoTopics(
+		topics->centroids,
+		vectors.data(),
+		int(ids.size()),
+		assignments.data());
+	return SaveTopicAssignments(db, chatId, ids, assignments)
+		&& SaveTopicModel(db, chatId, model, *topics);
+}
 
-	return embedding;
+[[nodiscard]] const QSet<QString> &StopWords() {
+	static const auto result = QSet<QString>{
+		"the", "a", "an", "and", "or", "but", "in", "on", "at", "to", "for",
+		"of", "with", "by", "from", "is", "are", "was", "were", "be", "been",
+		"being", "have", "has", "had", "do", "does", "did", "will", "would",
+		"could", "should", "may", "might", "must", "shall", "can", "need",
+		"this", "that", "these", "those", "it", "its", "i", "you", "he", "she",
+		"we", "they", "me", "him", "her", "us", "them", "my", "your", "his",
+		"our", "their", "what", "which", "who", "whom", "when", "where", "why",
+		"how", "all", "each", "every", "both", "few", "more", "most", "other",
+		"some", "such", "no", "not", "only", "same", "so", "than", "too",
+		"very", "just", "also", "now", "here", "there", "then", "about",
+		"like", "get", "got", "yes", "yeah", "okay", "don't", "didn't",
+		"doesn't", "isn't", "can't", "won't", "i'm", "it's", "that's",
+	};
+	return result;
 }
 
-// Store embedding
-bool SemanticSearch::storeEmbedding(
-		qint64 messageId,
-		qint64 chatId,
-		const QString &content,
-		const EmbeddingVector &embedding) {
+// Distinct lowercase words of three letters or more, without stop words
+// and numbers.
+[[nodiscard]] QStringList Terms(const QString &text) {
+	static const auto words = QRegularExpression(
+		R"(\w[\w']+)",
+		QRegularExpression::UseUnicodePropertiesOption);
+	static const auto number = QRegularExpression(R"(^\d+$)");
+
+	auto seen = QSet<QString>();
+	auto result = QStringList();
+	auto i = words.globalMatch(text);
+	while (i.hasNext()) {
+		const auto word = i.next().captured().toLower();
+		if (word.size() < 3
+			|| StopWords().contains(word)
+			|| number.match(word).hasMatch()
+			|| seen.contains(word)) {
+			continue;
+		}
+		seen.insert(word);
+		result.push_back(word);
+	}
+	return result;
+}
 
-	// TODO: Implement storeEmbedding using ChatArchiver's public API
-	// _db is private in ChatArchiver, need to add public method for embedding storage
-	Q_UNUSED(messageId);
-	Q_UNUSED(chatId);
-	Q_UNUSED(content);
-	Q_UNUSED(embedding);
-	return false;
+// Key terms are the words frequent in a cluster's messages and rare in
+// the other clusters', scored as tf-idf with every cluster as one document.
+void LabelClusters(
+		QVector<MessageCluster> &clusters,
+		const std::vector<QStringList> &texts) {
+	auto frequencies = std::vector<QHash<QString, int>>(clusters.size());
+	auto total = QHash<QString, int>();
+	auto documents = 0;
+	for (auto i = 0; i != int(clusters.size()); ++i) {
+		for (const auto &text : texts[i]) {
+			++documents;
+			for (const auto &term : Terms(text)) {
+				++frequencies[i][term];
+				++total[term];
+			}
+		}
+	}
+	for (auto i = 0; i != int(clusters.size()); ++i) {
+		auto scored = std::vector<std::pair<double, QString>>();
+		const auto &counts = frequencies[i];
+		const auto minCount = (texts[i].size() > 4) ? 2 : 1;
+		for (auto j = counts.begin(); j != counts.end(); ++j) {
+			if (j.value() < minCount) {
+				continue;
+			}
+			const auto spread = double(total.value(j.key()));
+			scored.emplace_back(
+				j.value() * std::log(1. + documents / spread),
+				j.key());
+		}
+		const auto count = std::min(int(scored.size()), kTopicKeyTerms);
+		std::partial_sort(
+			scored.begin(),
+			scored.begin() + count,
+			scored.end(),
+			std::greater<>());
+
+		auto &cluster = clusters[i];
+		cluster.keyTerms.clear();
+		for (auto j = 0; j != count; ++j) {
+			cluster.keyTerms.push_back(scored[j].second);
+		}
+		cluster.topicLabel = cluster.keyTerms.mid(0, kTopicLabelTerms).join(", ");
+	}
+}
 
-	/* Original implementation - needs ChatArchiver public API:
-	if (!_db || !_db->isOpen()) {
-		return false;
+// Capturing groups of EntityPattern(), in the order they are tried.
+constexpr auto kEntityGroups = std::array{
+	EntityType::URL,
+	EntityType::Email,
+	EntityType::UserMention,
+	EntityType::Hashtag,
+	EntityType::BotCommand,
+};
+
+// Every entity kind in one pass. The alternatives are tried in order at
+// each position and the scan goes on after a match, so a url path is no
+// bot command and the domain of an email no mention.
+[[nodiscard]] const QRegularExpression &EntityPattern() {
+	static const auto result = [] {
+		auto pattern = QRegularExpression(
+			R"((https?://[^\s]+))"
+			R"(|((?<![\w.+-])[\w.+-]+@[\w-]+(?:\.[\w-]+)+))"
+			R"(|(@\w+))"
+			R"(|(#\w+))"
+			R"(|((?<![\w/])/\w+(?:@\w+)?))",
+			QRegularExpression::UseUnicodePropertiesOption);
+		pattern.optimize();
+		return pattern;
+	}();
+	return result;
+}
+
+// Groups of IntentPattern().
+enum IntentGroup {
+	kCommandGroup = 1,
+	kQuestionGroup,
+	kGreetingGroup,
+	kAgreementGroup,
+	kDisagreementGroup,
+};
+
+[[nodiscard]] const QRegularExpression &IntentPattern() {
+	static const auto result = [] {
+		auto pattern = QRegularExpression(
+			R"(^\s*(?:(/))"
+			R"(|((?:what|when|where|who|whom|which|why|how)['\s]))"
+			R"(|((?:hello|hi|hey|greetings|howdy|good (?:morning|afternoon|evening))\b))"
+			R"(|((?:yes|i agree)\b|ok(?:ay)?\s*$))"
+			R"(|((?:no|i disagree)\b)))",
+			QRegularExpression::CaseInsensitiveOption
+				| QRegularExpression::UseUnicodePropertiesOption);
+		pattern.optimize();
+		return pattern;
+	}();
+	return result;
+}
+
+[[nodiscard]] const QRegularExpression &FarewellPattern() {
+	static const auto result = [] {
+		auto pattern = QRegularExpression(
+			R"(\b(?:bye|goodbye|see you|farewell|take care|good night|later|cya|ttyl)\b)",
+			QRegularExpression::CaseInsensitiveOption
+				| QRegularExpression::UseUnicodePropertiesOption);
+		pattern.optimize();
+		return pattern;
+	}();
+	return result;
+}
+
+// A question mark wins, then the prefix, then a farewell anywhere, then
+// agreement or disagreement.
+[[nodiscard]] SearchIntent ClassifyIntent(const QString &text) {
+	auto end = text.size();
+	while (end > 0 && text[end - 1].isSpace()) {
+		--end;
+	}
+	if (end > 0 && text[end - 1] == '?') {
+		return SearchIntent::Question;
+	}
+	const auto prefix = IntentPattern().match(text);
+	const auto has = [&](IntentGroup group) {
+		return prefix.capturedStart(group) >= 0;
+	};
+	if (prefix.hasMatch()) {
+		if (has(kCommandGroup)) {
+			return SearchIntent::Command;
+		} else if (has(kQuestionGroup)) {
+			return SearchIntent::Question;
+		} else if (has(kGreetingGroup)) {
+			return SearchIntent::Greeting;
+		}
+	}
+	if (FarewellPattern().match(text).hasMatch()) {
+		return SearchIntent::Farewell;
+	} else if (prefix.hasMatch() && has(kAgreementGroup)) {
+		return SearchIntent::Agreement;
+	} else if (prefix.hasMatch() && has(kDisagreementGroup)) {
+		return SearchIntent::Disagreement;
 	}
+	return SearchIntent::Statement;
+}
 
-	// Serialize embedding to BLOB
-	QByteArray embeddingBlob;
-	QDataStream stream(&embeddingBlob, QIODevice::WriteOnly);
-	for (float val : embedding) {
-		stream << val;
+[[nodiscard]] QVector<Entity> ScanEntities(const QString &text) {
+	auto result = QVector<Entity>();
+	auto i = EntityPattern().globalMatch(text);
+	while (i.hasNext()) {
+		const auto match = i.next();
+		for (auto group = 0; group != int(kEntityGroups.size()); ++group) {
+			if (match.capturedStart(group + 1) >= 0) {
+				result.push_back(Entity{
+					kEntityGroups[group],
+					match.captured(),
+					int(match.capturedStart()),
+					int(match.capturedLength()),
+				});
+				break;
+			}
+		}
 	}
+	return result;
+}
 
-	QSqlQuery query(*_db);
-	query.prepare(R"(
-		INSERT OR REPLACE INTO message_embeddings (
-			message_id, chat_id, content, embedding, embedding_model, created_at
-		) VALUES (
-			:message_id, :chat_id, :content, :embedding, :model, :created_at
-		)
-	)");
+// What ArchivedEntities() stored, nullopt for rows without it.
+[[nodiscard]] std::optional<QVector<Entity>> StoredEntities(
+		const QString &metadata,
+		const QString &text) {
+	if (metadata.isEmpty()) {
+		return std::nullopt;
+	}
+	const auto stored = QJsonDocument::fromJson(
+		metadata.toUtf8()
+	).object().value("entities");
+	if (!stored.isArray()) {
+		return std::nullopt;
+	}
+	auto result = QVector<Entity>();
+	for (const auto &value : stored.toArray()) {
+		const auto object = value.toObject();
+		const auto type = EntityTypeFromName(object.value("type").toString());
+		const auto offset = object.value("offset").toInt(-1);
+		const auto length = object.value("length").toInt();
+		if (!type || offset < 0 || length <= 0 || offset + length > text.size()) {
+			continue;
+		}
+		result.push_back(Entity{
+			*type,
+			text.mid(offset, length),
+			offset,
+			length,
+		});
+	}
+	return result;
+}
 
-	query.bindValue(":message_id", messageId);
-	query.bindValue(":chat_id", chatId);
-	query.bindValue(":content", content);
-	query.bindValue(":embedding", embeddingBlob);
-	query.bindValue(":model", _modelPath);
-	query.bindValue(":created_at", QDateTime::currentSecsSinceEpoch());
+// Urls are counted by host, everything else case-insensitively.
+[[nodiscard]] QString EntityKey(const Entity &entity) {
+	if (entity.type == EntityType::URL) {
+		const auto host = QUrl(entity.text).host();
+		if (!host.isEmpty()) {
+			return host.toLower();
+		}
+	}
+	return entity.text.toLower();
+}
 
-	return query.exec();
-	*/
+struct ArchiveScan {
+	int messages = 0;
+	int withStoredEntities = 0;
+	std::array<int, kIntentCount> intents = {};
+	std::array<int, kEntityTypeCount> entities = {};
+	std::array<QHash<QString, int>, kEntityTypeCount> values;
+
+	void add(const ArchiveScan &other) {
+		messages += other.messages;
+		withStoredEntities += other.withStoredEntities;
+		for (auto i = 0; i != kIntentCount; ++i) {
+			intents[i] += other.intents[i];
+		}
+		for (auto i = 0; i != kEntityTypeCount; ++i) {
+			entities[i] += other.entities[i];
+			for (auto j = other.values[i].begin(); j != other.values[i].end(); ++j) {
+				values[i][j.key()] += j.value();
+			}
+		}
+	}
+};
+
+// Reads the archive page by page, each page is classified and scanned
+// on the global thread pool while nothing else waits for it.
+[[nodiscard]] ArchiveScan ScanArchive(
+		const QSqlDatabase &db,
+		qint64 chatId,
+		bool intents,
+		bool entities) {
+	auto query = PreparedQuery(db, QString(R"(
+		SELECT content, metadata FROM messages
+		WHERE content IS NOT NULL AND content != '' %1
+	)").arg(chatId ? "AND chat_id = :chat_id" : ""));
+	if (chatId) {
+		query->bindValue(":chat_id", chatId);
+	}
+	auto result = ArchiveScan();
+	if (!query->exec()) {
+		qWarning() << "MCP: Failed to read messages to scan:" << query->lastError().text();
+		return result;
+	}
+	auto texts = std::vector<QString>();
+	auto metadata = std::vector<QString>();
+	auto mutex = QMutex();
+	const auto scan = [&] {
+		ParallelFor(int(texts.size()), kScanChunk, [&](int begin, int end) {
+			auto part = ArchiveScan();
+			for (auto i = begin; i != end; ++i) {
+				++part.messages;
+				if (intents) {
+					++part.intents[int(ClassifyIntent(texts[i]))];
+				}
+				if (!entities) {
+					continue;
+				}
+				const auto stored = StoredEntities(metadata[i], texts[i]);
+				if (stored) {
+					++part.withStoredEntities;
+				}
+				for (const auto &entity : stored ? *stored : ScanEntities(texts[i])) {
+					++part.entities[int(entity.type)];
+					++part.values[int(entity.type)][EntityKey(entity)];
+				}
+			}
+			QMutexLocker lock(&mutex);
+			result.add(part);
+		});
+		texts.clear();
+		metadata.clear();
+	};
+	while (query->next()) {
+		texts.push_back(query->value(0).toString());
+		metadata.push_back(query->value(1).toString());
+		if (int(texts.size()) == kScanPage) {
+			scan();
+		}
+	}
+	scan();
+	return result;
 }
 
-// Intent classification (heuristic-based)
-SearchIntent SemanticSearch::classifyIntent(const QString &text) {
-	QString lower = text.toLower().trimmed();
+} // namespace
+
+QString EntityTypeName(EntityType type) {
+	switch (type) {
+	case EntityType::UserMention: return "user_mention";
+	case EntityType::ChatMention: return "chat_mention";
+	case EntityType::URL: return "url";
+	case EntityType::Email: return "email";
+	case EntityType::PhoneNumber: return "phone_number";
+	case EntityType::Hashtag: return "hashtag";
+	case EntityType::BotCommand: return "bot_command";
+	case EntityType::CustomEmoji: return "custom_emoji";
+	}
+	return "unknown";
+}
 
-	// Question patterns
-	if (isQuestion(lower)) {
-		return SearchIntent::Question;
+std::optional<EntityType> EntityTypeFromName(const QString &name) {
+	for (auto i = 0; i != kEntityTypeCount; ++i) {
+		if (EntityTypeName(EntityType(i)) == name) {
+			return EntityType(i);
+		}
 	}
+	return std::nullopt;
+}
 
-	// Command patterns
-	if (isCommand(lower)) {
-		return SearchIntent::Command;
+QString SearchIntentName(SearchIntent intent) {
+	switch (intent) {
+	case SearchIntent::Question: return "question";
+	case SearchIntent::Answer: return "answer";
+	case SearchIntent::Command: return "command";
+	case SearchIntent::Greeting: return "greeting";
+	case SearchIntent::Farewell: return "farewell";
+	case SearchIntent::Agreement: return "agreement";
+	case SearchIntent::Disagreement: return "disagreement";
+	case SearchIntent::Statement: return "statement";
+	case SearchIntent::Other: return "other";
 	}
+	return "other";
+}
 
-	// Greeting patterns
-	if (isGreeting(lower)) {
-		return SearchIntent::Greeting;
+SemanticSearch::SemanticSearch(ChatArchiver *archiver, QObject *parent)
+: QObject(parent)
+, _archiver(archiver)
+, _indexThread(QThread::create([=] { indexingLoop(); })) {
+	_indexThread->setObjectName("MCP semantic indexer");
+	_indexThread->start();
+	_searchPool.setMaxThreadCount(kSearchThreads);
+	_searchPool.setObjectName("mcp_semantic_search");
+}
+
+SemanticSearch::~SemanticSearch() {
+	// The running job stops after its current batch, queued ones are dropped.
+	{
+		QMutexLocker lock(&_indexMutex);
+		_stopping = true;
+	}
+	_indexWake.wakeAll();
+	_indexThread->wait();
+	if (_vectorIndex && _vectorIndex->ready()) {
+		_vectorIndex->save();
 	}
+}
 
-	// Farewell patterns
-	if (isFarewell(lower)) {
-		return SearchIntent::Farewell;
+void SemanticSearch::enqueueIndexing(std::function<void()> job) {
+	{
+		QMutexLocker lock(&_indexMutex);
+		_indexJobs.push_back(std::move(job));
 	}
+	_indexWake.wakeOne();
+}
 
-	// Agreement/Disagreement
-	if (lower.startsWith("yes") || lower.startsWith("i agree") || lower == "ok" || lower == "okay") {
-		return SearchIntent::Agreement;
+void SemanticSearch::indexingLoop() {
+	while (true) {
+		auto job = std::function<void()>();
+		{
+			QMutexLocker lock(&_indexMutex);
+			while (_indexJobs.empty() && !_stopping) {
+				_indexWake.wait(&_indexMutex);
+			}
+			if (_stopping) {
+				return;
+			}
+			job = std::move(_indexJobs.front());
+			_indexJobs.pop_front();
+		}
+		job();
 	}
-	if (lower.startsWith("no") || lower.startsWith("i disagree")) {
-		return SearchIntent::Disagreement;
+}
+
+bool SemanticSearch::initialize(const QString &modelPath) {
+	_backend = CreateEmbeddingBackend(modelPath, _embeddingDimensions);
+	_modelPath = _backend->model();
+
+	const auto pool = _archiver ? _archiver->pool() : nullptr;
+	if (!pool || !pool->isOpen()) {
+		qWarning() << "MCP: SemanticSearch has no archive database";
+		return false;
 	}
+	auto created = false;
+	pool->writeAndWait([&](QSqlDatabase &db) {
+		QSqlQuery query(db);
+		created = query.exec(kEmbeddingsTable)
+			&& query.exec(kEmbeddingsIndex)
+			&& query.exec(kEmbeddingsTrigger)
+			&& query.exec(kClustersTable)
+			&& query.exec(kClustersMessageIndex)
+			&& query.exec(kClustersChatIndex)
+			&& query.exec(kClustersTrigger)
+			&& query.exec(kCentroidsTable);
+		if (!created) {
+			qWarning() << "MCP: Failed to create embeddings table:" << query.lastError().text();
+		}
+	});
+	_isInitialized = created;
+	if (created) {
+		_vectorIndex = std::make_unique<VectorIndex>(pool->path() + ".hnsw");
+		enqueueIndexing([=] {
+			loadVectorIndex();
+		});
+	}
+	return created;
+}
 
-	return SearchIntent::Statement;
+EmbeddingVector SemanticSearch::generateEmbedding(const QString &text) {
+	const auto embeddings = generateEmbeddings({ text });
+	return embeddings.isEmpty() ? EmbeddingVector() : embeddings.front();
 }
 
-// Entity extraction
-QVector<Entity> SemanticSearch::extractEntities(const QString &text) {
-	QVector<Entity> entities;
+QVector<EmbeddingVector> SemanticSearch::generateEmbeddings(
+		const QStringList &texts) {
+	if (!_backend) {
+		return {};
+	}
+	auto result = QVector<EmbeddingVector>();
+	result.reserve(texts.size());
+	const auto batchSize = _backend->batchSize();
+	for (auto i = 0; i < texts.size(); i += batchSize) {
+		auto failure = QString();
+		const auto batch = _backend->embed(texts.mid(i, batchSize), &failure);
+		if (batch.isEmpty()) {
+			qWarning() << "MCP:" << failure;
+			return {};
+		}
+		result.append(batch);
+	}
+	return result;
+}
 
-	entities.append(extractUserMentions(text));
-	entities.append(extractURLs(text));
-	entities.append(extractHashtags(text));
-	entities.append(extractBotCommands(text));
+bool SemanticSearch::storeEmbedding(
+		qint64 messageId,
+		qint64 chatId,
+		const QString &content,
+		const EmbeddingVector &embedding) {
+	auto message = PendingMessage();
+	message.id = messageId;
+	message.chatId = chatId;
+	message.content = content;
+	return storeEmbeddings({ message }, { embedding });
+}
 
-	return entities;
+bool SemanticSearch::storeEmbeddings(
+		const std::vector<PendingMessage> &messages,
+		const QVector<EmbeddingVector> &embeddings) {
+	const auto pool = _archiver ? _archiver->pool() : nullptr;
+	if (!_isInitialized || !pool || messages.size() != size_t(embeddings.size())) {
+		return false;
+	}
+	// The index and the topics get the decoded codes, so reloading them
+	// from the table changes nothing.
+	auto blobs = std::vector<QByteArray>();
+	auto decoded = std::vector<EmbeddingVector>();
+	blobs.reserve(messages.size());
+	decoded.reserve(messages.size());
+	for (const auto &embedding : embeddings) {
+		blobs.push_back(SerializeEmbedding(embedding));
+		decoded.push_back(ParseEmbedding(blobs.back()));
+	}
+	auto stored = false;
+	pool->writeAndWait([&](QSqlDatabase &db) {
+		db.transaction();
+		auto query = PreparedQuery(db, R"(
+			INSERT OR REPLACE INTO message_embeddings (
+				message_id, chat_id, content, embedding, embedding_model
+			) VALUES (
+				:message_id, :chat_id, :content, :embedding, :model
+			)
+		)");
+		for (auto i = 0; i != int(messages.size()); ++i) {
+			query->bindValue(":message_id", messages[i].id);
+			query->bindValue(":chat_id", messages[i].chatId);
+			query->bindValue(":content", messages[i].content);
+			query->bindValue(":embedding", blobs[i]);
+			query->bindValue(":model", _modelPath);
+			if (!query->exec()) {
+				qWarning() << "MCP: Failed to store embedding:" << query->lastError().text();
+				db.rollback();
+				return;
+			}
+		}
+		mergeIntoTopics(db, messages, decoded);
+		stored = db.commit();
+	});
+	if (stored && _vectorIndex) {
+		for (auto i = 0; i != int(messages.size()); ++i) {
+			_vectorIndex->add(messages[i].id, messages[i].chatId, decoded[i]);
+		}
+	}
+	return stored;
 }
 
-// Cosine similarity
-float SemanticSearch::cosineSimilarity(const EmbeddingVector &a, const EmbeddingVector &b) const {
-	if (a.size() != b.size()) {
-		return 0.0f;
+bool SemanticSearch::indexMessage(qint64 messageId) {
+	if (!_isInitialized) {
+		return false;
 	}
+	auto query = PreparedQuery(_archiver->database(), R"(
+		SELECT chat_id, content FROM messages WHERE id = :id
+	)");
+	query->bindValue(":id", messageId);
+	if (!query->exec() || !query->next()) {
+		return false;
+	}
+	auto message = PendingMessage();
+	message.id = messageId;
+	message.chatId = query->value(0).toLongLong();
+	message.content = query->value(1).toString();
+	if (message.content.isEmpty()) {
+		return false;
+	}
+	const auto embeddings = generateEmbeddings({ message.content });
+	return !embeddings.isEmpty() && storeEmbeddings({ message }, embeddings);
+}
 
-	float dotProduct = 0.0f;
-	float normA = 0.0f;
-	float normB = 0.0f;
+bool SemanticSearch::indexChat(
+		qint64 chatId,
+		int limit,
+		bool rebuild,
+		IndexingObserver observer) {
+	if (!_isInitialized) {
+		return false;
+	}
+	enqueueIndexing([=] {
+		runIndexing({ chatId }, limit, rebuild, observer);
+	});
+	return true;
+}
 
-	for (int i = 0; i < a.size(); ++i) {
-		dotProduct += a[i] * b[i];
-		normA += a[i] * a[i];
-		normB += b[i] * b[i];
+bool SemanticSearch::indexAllChats() {
+	if (!_isInitialized) {
+		return false;
 	}
+	enqueueIndexing([=] {
+		auto chatIds = QVector<qint64>();
+		auto query = PreparedQuery(
+			_archiver->database(),
+			"SELECT DISTINCT chat_id FROM messages");
+		if (query->exec()) {
+			while (query->next()) {
+				chatIds.push_back(query->value(0).toLongLong());
+			}
+		}
+		runIndexing(chatIds, -1, false);
+	});
+	return true;
+}
 
-	if (normA == 0.0f || normB == 0.0f) {
-		return 0.0f;
+std::vector<SemanticSearch::PendingMessage> SemanticSearch::pendingMessages(
+		qint64 chatId,
+		int limit,
+		const MessageCursor &before) const {
+	// Walks idx_messages_chat_timestamp newest first, skipping messages
+	// that already have a vector of the current model.
+	const auto sql = QString(R"(
+		SELECT m.id, m.message_id, m.timestamp, m.content
+		FROM messages m
+		LEFT JOIN message_embeddings e
+			ON e.message_id = m.id AND e.embedding_model = :model
+		WHERE m.chat_id = :chat_id
+			AND e.message_id IS NULL
+			AND m.content IS NOT NULL AND m.content != ''
+			%1
+		ORDER BY m.timestamp DESC, m.message_id DESC
+		LIMIT :limit
+	)").arg(before.empty()
+		? QString()
+		: "AND (m.timestamp, m.message_id) < (:before_timestamp, :before_id)");
+	auto query = PreparedQuery(_archiver->database(), sql);
+	query->bindValue(":model", _modelPath);
+	query->bindValue(":chat_id", chatId);
+	if (!before.empty()) {
+		query->bindValue(":before_timestamp", before.timestamp);
+		query->bindValue(":before_id", before.messageId);
 	}
+	query->bindValue(":limit", limit);
 
-	return dotProduct / (std::sqrt(normA) * std::sqrt(normB));
+	auto result = std::vector<PendingMessage>();
+	if (!query->exec()) {
+		qWarning() << "MCP: Failed to read messages to index:" << query->lastError().text();
+		return result;
+	}
+	while (query->next()) {
+		auto message = PendingMessage();
+		message.id = query->value(0).toLongLong();
+		message.chatId = chatId;
+		message.messageId = query->value(1).toLongLong();
+		message.timestamp = query->value(2).toLongLong();
+		message.content = query->value(3).toString();
+		result.push_back(std::move(message));
+	}
+	return result;
 }
 
-// Helper implementations
-bool SemanticSearch::isQuestion(const QString &text) const {
-	QStringList questionWords = {"what", "when", "where", "who", "whom", "which", "why", "how"};
-	QString lower = text.toLower();
+int SemanticSearch::pendingCount(qint64 chatId, int limit) const {
+	auto query = PreparedQuery(_archiver->database(), R"(
+		SELECT COUNT(*)
+		FROM messages m
+		LEFT JOIN message_embeddings e
+			ON e.message_id = m.id AND e.embedding_model = :model
+		WHERE m.chat_id = :chat_id
+			AND e.message_id IS NULL
+			AND m.content IS NOT NULL AND m.content != ''
+	)");
+	query->bindValue(":model", _modelPath);
+	query->bindValue(":chat_id", chatId);
+	const auto count = (query->exec() && query->next())
+		? query->value(0).toInt()
+		: 0;
+	return (limit < 0) ? count : std::min(count, limit);
+}
 
-	for (const QString &word : questionWords) {
-		if (lower.startsWith(word + " ") || lower.startsWith(word + "'")) {
-			return true;
+void SemanticSearch::runIndexing(
+		const QVector<qint64> &chatIds,
+		int limit,
+		bool rebuild,
+		const IndexingObserver &observer) {
+	if (rebuild) {
+		// Topics follow the vectors, they are trained again when asked for.
+		_archiver->pool()->writeAndWait([&](QSqlDatabase &db) {
+			for (const auto table : {
+					"message_embeddings",
+					"message_clusters",
+					"topic_centroids" }) {
+				auto query = PreparedQuery(
+					db,
+					QString("DELETE FROM %1 WHERE chat_id = :chat_id").arg(table));
+				for (const auto chatId : chatIds) {
+					query->bindValue(":chat_id", chatId);
+					query->exec();
+				}
+			}
+		});
+		for (const auto chatId : chatIds) {
+			_vectorIndex->removeChat(chatId);
 		}
 	}
 
-	return text.endsWith("?");
+	auto total = 0;
+	for (const auto chatId : chatIds) {
+		total += pendingCount(chatId, limit);
+	}
+	auto indexed = 0;
+	auto stopped = false;
+	const auto finish = [&](const QString &error) {
+		if (observer.done) {
+			observer.done(indexed, error);
+		}
+		Q_EMIT indexingCompleted(indexed);
+	};
+	Q_EMIT indexingProgress(indexed, total);
+
+	// One backend batch per page: the page is embedded in a single
+	// request and stored in a single transaction.
+	const auto batchSize = _backend->batchSize();
+	for (const auto chatId : chatIds) {
+		auto remaining = (limit < 0) ? std::numeric_limits<int>::max() : limit;
+		auto cursor = MessageCursor();
+		while (remaining > 0 && !_stopping && !stopped) {
+			const auto page = pendingMessages(
+				chatId,
+				std::min(remaining, batchSize),
+				cursor);
+			if (page.empty()) {
+				break;
+			}
+			cursor.timestamp = page.back().timestamp;
+			cursor.messageId = page.back().messageId;
+
+			auto texts = QStringList();
+			texts.reserve(int(page.size()));
+			for (const auto &message : page) {
+				texts.push_back(message.content);
+			}
+			auto failure = QString();
+			const auto embeddings = _backend->embed(texts, &failure);
+			if (embeddings.isEmpty()) {
+				Q_EMIT error(failure);
+				finish(failure);
+				return;
+			} else if (!storeEmbeddings(page, embeddings)) {
+				Q_EMIT error("Failed to store embeddings");
+				finish("Failed to store embeddings");
+				return;
+			}
+			indexed += int(page.size());
+			remaining -= int(page.size());
+			Q_EMIT indexingProgress(indexed, total);
+			if (observer.progress && !observer.progress(indexed, total)) {
+				stopped = true;
+			}
+		}
+	}
+	if (_vectorIndex->ready()) {
+		_vectorIndex->save();
+	}
+	finish(QString());
 }
 
-bool SemanticSearch::isCommand(const QString &text) const {
-	return text.startsWith("/");
+void SemanticSearch::loadVectorIndex() {
+	// The saved graph lacks whatever was stored after it was written, a
+	// minute of slack covers batches committed while it was being saved.
+	const auto savedAt = _vectorIndex->load(_modelPath);
+	auto query = PreparedQuery(_archiver->database(), R"(
+		SELECT message_id, chat_id, embedding FROM message_embeddings
+		WHERE embedding_model = :model AND created_at >= :since
+	)");
+	query->bindValue(":model", _modelPath);
+	query->bindValue(":since", savedAt ? (savedAt - kIndexCatchUpSlack) : 0);
+	if (!query->exec()) {
+		qWarning() << "MCP: Failed to read embeddings for the vector index:" << query->lastError().text();
+		return;
+	}
+	while (query->next()) {
+		if (_stopping) {
+			return;
+		}
+		_vectorIndex->add(
+			query->value(0).toLongLong(),
+			query->value(1).toLongLong(),
+			ParseEmbedding(query->value(2).toByteArray()));
+	}
+	_vectorIndex->setReady(true);
+	_vectorIndex->save();
 }
 
-bool SemanticSearch::isGreeting(const QString &text) const {
-	QStringList greetings = {"hello", "hi", "hey", "greetings", "good morning",
-	                          "good afternoon", "good evening", "howdy"};
-	QString lower = text.toLower();
+EmbeddingVector SemanticSearch::loadEmbedding(qint64 messageId) const {
+	auto query = PreparedQuery(_archiver->database(), R"(
+		SELECT embedding FROM message_embeddings
+		WHERE message_id = :id AND embedding_model = :model
+	)");
+	query->bindValue(":id", messageId);
+	query->bindValue(":model", _modelPath);
+	return (query->exec() && query->next())
+		? ParseEmbedding(query->value(0).toByteArray())
+		: EmbeddingVector();
+}
 
-	for (const QString &greeting : greetings) {
-		if (lower.startsWith(greeting)) {
-			return true;
+QVector<QPair<qint64, EmbeddingVector>> SemanticSearch::loadAllEmbeddings(
+		qint64 chatId) const {
+	auto query = PreparedQuery(_archiver->database(), R"(
+		SELECT message_id, embedding FROM message_embeddings
+		WHERE chat_id = :chat_id AND embedding_model = :model
+	)");
+	query->bindValue(":chat_id", chatId);
+	query->bindValue(":model", _modelPath);
+
+	auto result = QVector<QPair<qint64, EmbeddingVector>>();
+	if (query->exec()) {
+		while (query->next()) {
+			result.push_back({
+				query->value(0).toLongLong(),
+				ParseEmbedding(query->value(1).toByteArray()),
+			});
 		}
 	}
+	return result;
+}
 
-	return false;
+void SemanticSearch::mergeIntoTopics(
+		const QSqlDatabase &db,
+		const std::vector<PendingMessage> &messages,
+		const std::vector<EmbeddingVector> &embeddings) {
+	// Chats with topics get their new messages assigned in the same
+	// transaction, the centroids follow them without a retrain.
+	auto byChat = std::map<qint64, std::pair<std::vector<qint64>, std::vector<float>>>();
+	for (auto i = 0; i != int(messages.size()); ++i) {
+		auto &[ids, vectors] = byChat[messages[i].chatId];
+		ids.push_back(messages[i].id);
+		vectors.insert(vectors.end(), embeddings[i].begin(), embeddings[i].end());
+	}
+	for (const auto &[chatId, batch] : byChat) {
+		MergeTopics(db, chatId, _modelPath, batch.first, batch.second);
+	}
 }
 
-bool SemanticSearch::isFarewell(const QString &text) const {
-	QStringList farewells = {"bye", "goodbye", "see you", "farewell", "take care",
-	                          "good night", "later", "cya", "ttyl"};
-	QString lower = text.toLower();
+bool SemanticSearch::trainTopics(qint64 chatId, int numTopics) {
+	// Reservoir sample of the chat's vectors for the mini-batches.
+	auto sampled = PreparedQuery(_archiver->database(), R"(
+		SELECT embedding FROM message_embeddings
+		WHERE chat_id = :chat_id AND embedding_model = :model
+	)");
+	sampled->bindValue(":chat_id", chatId);
+	sampled->bindValue(":model", _modelPath);
+	if (!sampled->exec()) {
+		qWarning() << "MCP: Failed to read embeddings for topics:" << sampled->lastError().text();
+		return false;
+	}
+	auto random = std::mt19937(quint32(chatId));
+	auto sample = std::vector<float>();
+	auto dimensions = 0;
+	auto seen = 0;
+	while (sampled->next()) {
+		const auto vector = ParseEmbedding(sampled->value(0).toByteArray());
+		if (!dimensions) {
+			dimensions = int(vector.size());
+		}
+		if (!dimensions || vector.size() != dimensions) {
+			continue;
+		} else if (seen < kTopicTrainingSample) {
+			sample.insert(sample.end(), vector.begin(), vector.end());
+		} else if (const auto slot = std::uniform_int_distribution<int>(
+				0,
+				seen)(random); slot < kTopicTrainingSample) {
+			std::copy(
+				vector.begin(),
+				vector.end(),
+				sample.begin() + size_t(slot) * dimensions);
+		}
+		++seen;
+	}
+	sampled->finish();
+	if (!seen) {
+		return false;
+	}
+	auto topics = TopicModel();
+	topics.centroids = TrainTopics(
+		sample.data(),
+		std::min(seen, kTopicTrainingSample),
+		dimensions,
+		numTopics,
+		quint32(chatId));
+	topics.trainedCount = seen;
+	std::fill(topics.centroids.counts.begin(), topics.centroids.counts.end(), 0);
+	sample = std::vector<float>();
+
+	// Batches stored from here on find no topics to merge into, they are
+	// assigned by assignPendingTopics() afterwards.
+	const auto pool = _archiver->pool();
+	pool->writeAndWait([&](QSqlDatabase &db) {
+		for (const auto table : { "message_clusters", "topic_centroids" }) {
+			auto query = PreparedQuery(
+				db,
+				QString("DELETE FROM %1 WHERE chat_id = :chat_id").arg(table));
+			query->bindValue(":chat_id", chatId);
+			query->exec();
+		}
+	});
 
-	for (const QString &farewell : farewells) {
-		if (lower.contains(farewell)) {
-			return true;
+	// Every vector gets its nearest centroid, the writer stores a chunk
+	// while the next one is scored.
+	auto assigned = PreparedQuery(_archiver->database(), R"(
+		SELECT message_id, embedding FROM message_embeddings
+		WHERE chat_id = :chat_id AND embedding_model = :model
+	)");
+	assigned->bindValue(":chat_id", chatId);
+	assigned->bindValue(":model", _modelPath);
+	if (!assigned->exec()) {
+		return false;
+	}
+	auto ids = std::vector<qint64>();
+	auto vectors = std::vector<float>();
+	const auto flush = [&] {
+		auto assignments = std::vector<TopicAssignment>(ids.size());
+		AssignTopics(
+			topics.centroids,
+			vectors.data(),
+			int(ids.size()),
+			assignments.data());
+		for (const auto &assignment : assignments) {
+			++topics.centroids.counts[assignment.topic];
+		}
+		pool->write([=, ids = std::move(ids)](QSqlDatabase &db) {
+			db.transaction();
+			if (SaveTopicAssignments(db, chatId, ids, assignments)) {
+				db.commit();
+			} else {
+				db.rollback();
+			}
+		});
+		ids = std::vector<qint64>();
+		vectors.clear();
+	};
+	while (assigned->next()) {
+		const auto vector = ParseEmbedding(assigned->value(1).toByteArray());
+		if (vector.size() != dimensions) {
+			continue;
+		}
+		ids.push_back(assigned->value(0).toLongLong());
+		vectors.insert(vectors.end(), vector.begin(), vector.end());
+		if (int(ids.size()) == kTopicAssignChunk) {
+			flush();
 		}
 	}
+	assigned->finish();
+	if (!ids.empty()) {
+		flush();
+	}
 
-	return false;
+	// Queued after the chunks, so topics show up with their members.
+	auto saved = false;
+	pool->writeAndWait([&](QSqlDatabase &db) {
+		saved = SaveTopicModel(db, chatId, _modelPath, topics);
+	});
+	return saved;
 }
 
-// Entity extraction helpers
-QVector<Entity> SemanticSearch::extractUserMentions(const QString &text) const {
-	QVector<Entity> entities;
+void SemanticSearch::assignPendingTopics(qint64 chatId) {
+	auto query = PreparedQuery(_archiver->database(), R"(
+		SELECT e.message_id, e.embedding
+		FROM message_embeddings e
+		LEFT JOIN message_clusters c ON c.message_id = e.message_id
+		WHERE e.chat_id = :chat_id
+			AND e.embedding_model = :model
+			AND c.message_id IS NULL
+	)");
+	query->bindValue(":chat_id", chatId);
+	query->bindValue(":model", _modelPath);
+	if (!query->exec()) {
+		return;
+	}
+	auto ids = std::vector<qint64>();
+	auto vectors = std::vector<float>();
+	const auto flush = [&] {
+		_archiver->pool()->writeAndWait([&](QSqlDatabase &db) {
+			db.transaction();
+			if (MergeTopics(db, chatId, _modelPath, ids, vectors)) {
+				db.commit();
+			} else {
+				db.rollback();
+			}
+		});
+		ids.clear();
+		vectors.clear();
+	};
+	auto dimensions = 0;
+	while (query->next()) {
+		const auto vector = ParseEmbedding(query->value(1).toByteArray());
+		if (!dimensions) {
+			dimensions = int(vector.size());
+		} else if (vector.size() != dimensions) {
+			continue;
+		}
+		ids.push_back(query->value(0).toLongLong());
+		vectors.insert(vectors.end(), vector.begin(), vector.end());
+		if (int(ids.size()) == kTopicAssignChunk) {
+			flush();
+		}
+	}
+	if (!ids.empty()) {
+		flush();
+	}
+}
 
-	QRegularExpression mentionRegex(R"(@(\w+))");
-	QRegularExpressionMatchIterator it = mentionRegex.globalMatch(text);
+QVector<MessageCluster> SemanticSearch::describeTopics(
+		qint64 chatId,
+		const ArchiveSearchFilter &filter) {
+	const auto db = _archiver->database();
+	auto labels = PreparedQuery(db, R"(
+		SELECT cluster_id, topic_label, key_terms FROM topic_centroids
+		WHERE chat_id = :chat_id AND embedding_model = :model
+		ORDER BY cluster_id
+	)");
+	labels->bindValue(":chat_id", chatId);
+	labels->bindValue(":model", _modelPath);
+	if (!labels->exec()) {
+		return {};
+	}
+	auto clusters = QVector<MessageCluster>();
+	while (labels->next()) {
+		auto cluster = MessageCluster();
+		cluster.clusterId = labels->value(0).toInt();
+		cluster.topicLabel = labels->value(1).toString();
+		cluster.keyTerms = labels->value(2).toString().split(
+			' ',
+			Qt::SkipEmptyParts);
+		cluster.messageCount = 0;
+		cluster.cohesion = 0.f;
+		clusters.push_back(std::move(cluster));
+	}
+	labels->finish();
+	if (clusters.isEmpty()) {
+		return {};
+	}
 
-	while (it.hasNext()) {
-		QRegularExpressionMatch match = it.next();
-		Entity entity;
-		entity.type = EntityType::UserMention;
-		entity.text = match.captured(0);
-		entity.offset = match.capturedStart();
-		entity.length = match.capturedLength();
-		entities.append(entity);
+	// A date range in the filter narrows the counts, the representatives
+	// and the terms to the messages inside it.
+	const auto conditions = filter.sqlConditions("m");
+	auto sizes = PreparedQuery(db, QString(R"(
+		SELECT c.cluster_id, COUNT(*), AVG(c.similarity_score)
+		FROM message_clusters c
+		JOIN messages m ON m.id = c.message_id
+		WHERE c.chat_id = :cluster_chat %1
+		GROUP BY c.cluster_id
+	)").arg(conditions));
+	sizes->bindValue(":cluster_chat", chatId);
+	filter.bind(*sizes);
+	if (sizes->exec()) {
+		while (sizes->next()) {
+			const auto topic = sizes->value(0).toInt();
+			if (topic >= 0 && topic < clusters.size()) {
+				clusters[topic].messageCount = sizes->value(1).toInt();
+				clusters[topic].cohesion = sizes->value(2).toFloat();
+			}
+		}
+	}
+	sizes->finish();
+
+	auto members = PreparedQuery(db, QString(R"(
+		SELECT m.message_id, e.content
+		FROM message_clusters c
+		JOIN messages m ON m.id = c.message_id
+		JOIN message_embeddings e ON e.message_id = c.message_id
+		WHERE c.chat_id = :cluster_chat AND c.cluster_id = :cluster_id %1
+		ORDER BY c.similarity_score DESC
+		LIMIT :limit
+	)").arg(conditions));
+	auto texts = std::vector<QStringList>(clusters.size());
+	for (auto &cluster : clusters) {
+		members->bindValue(":cluster_chat", chatId);
+		members->bindValue(":cluster_id", cluster.clusterId);
+		members->bindValue(":limit", kTopicLabelSample);
+		filter.bind(*members);
+		if (!members->exec()) {
+			continue;
+		}
+		auto &text = texts[cluster.clusterId];
+		while (members->next()) {
+			if (cluster.messageIds.size() < kTopicRepresentatives) {
+				cluster.messageIds.push_back(members->value(0).toLongLong());
+			}
+			text.push_back(members->value(1).toString());
+		}
+	}
+	members->finish();
+	LabelClusters(clusters, texts);
+
+	if (!filter.after && !filter.before) {
+		const auto saved = clusters;
+		_archiver->pool()->write([=](QSqlDatabase &db) {
+			auto query = PreparedQuery(db, R"(
+				UPDATE topic_centroids SET topic_label = :label, key_terms = :terms
+				WHERE chat_id = :chat_id AND cluster_id = :cluster_id
+			)");
+			for (const auto &cluster : saved) {
+				query->bindValue(":label", cluster.topicLabel);
+				query->bindValue(":terms", cluster.keyTerms.join(' '));
+				query->bindValue(":chat_id", chatId);
+				query->bindValue(":cluster_id", cluster.clusterId);
+				query->exec();
+			}
+		});
 	}
 
-	return entities;
+	clusters.erase(
+		std::remove_if(clusters.begin(), clusters.end(), [](const MessageCluster &cluster) {
+			return !cluster.messageCount;
+		}),
+		clusters.end());
+	std::sort(clusters.begin(), clusters.end(), [](const MessageCluster &a, const MessageCluster &b) {
+		return a.messageCount > b.messageCount;
+	});
+	return clusters;
 }
 
-QVector<Entity> SemanticSearch::extractURLs(const QString &text) const {
-	QVector<Entity> entities;
+QVector<MessageCluster> SemanticSearch::detectTopics(
+		qint64 chatId,
+		int numTopics,
+		const QDateTime &start,
+		const QDateTime &end,
+		bool retrain) {
+	if (!_isInitialized || !chatId || numTopics <= 0) {
+		return {};
+	}
+	QMutexLocker lock(&_topicsMutex);
 
-	QRegularExpression urlRegex(R"(https?://[^\s]+)");
-	QRegularExpressionMatchIterator it = urlRegex.globalMatch(text);
+	auto count = PreparedQuery(_archiver->database(), R"(
+		SELECT COUNT(*) FROM message_embeddings
+		WHERE chat_id = :chat_id AND embedding_model = :model
+	)");
+	count->bindValue(":chat_id", chatId);
+	count->bindValue(":model", _modelPath);
+	const auto embedded = (count->exec() && count->next())
+		? count->value(0).toLongLong()
+		: 0;
+	count->finish();
+	if (!embedded) {
+		return {};
+	}
 
-	while (it.hasNext()) {
-		QRegularExpressionMatch match = it.next();
-		Entity entity;
-		entity.type = EntityType::URL;
-		entity.text = match.captured(0);
-		entity.offset = match.capturedStart();
-		entity.length = match.capturedLength();
-		entities.append(entity);
+	const auto topics = int(std::min(qint64(numTopics), embedded));
+	const auto current = LoadTopicModel(
+		_archiver->database(),
+		chatId,
+		_modelPath);
+	const auto stale = retrain
+		|| !current
+		|| current->centroids.size() != topics
+		|| embedded >= kTopicRetrainGrowth * current->trainedCount;
+	if (stale && !trainTopics(chatId, topics)) {
+		return {};
 	}
+	assignPendingTopics(chatId);
 
-	return entities;
+	auto filter = ArchiveSearchFilter();
+	filter.after = start.isValid() ? start.toSecsSinceEpoch() : 0;
+	filter.before = end.isValid() ? end.toSecsSinceEpoch() : 0;
+	return describeTopics(chatId, filter);
 }
 
-QVector<Entity> SemanticSearch::extractHashtags(const QString &text) const {
-	QVector<Entity> entities;
+QVector<MessageCluster> SemanticSearch::clusterMessages(
+		const QVector<qint64> &messageIds,
+		int numClusters) {
+	if (!_isInitialized) {
+		return {};
+	}
+	auto data = QVector<QPair<qint64, EmbeddingVector>>();
+	data.reserve(messageIds.size());
+	for (const auto id : messageIds) {
+		auto embedding = loadEmbedding(id);
+		if (!embedding.isEmpty()) {
+			data.push_back({ id, std::move(embedding) });
+		}
+	}
+	return kMeansClustering(data, numClusters);
+}
 
-	QRegularExpression hashtagRegex(R"(#(\w+))");
-	QRegularExpressionMatchIterator it = hashtagRegex.globalMatch(text);
+QVector<MessageCluster> SemanticSearch::kMeansClustering(
+		const QVector<QPair<qint64, EmbeddingVector>> &data,
+		int k) {
+	if (data.isEmpty() || k <= 0) {
+		return {};
+	}
+	const auto dimensions = int(data.front().second.size());
+	auto ids = std::vector<qint64>();
+	auto vectors = std::vector<float>();
+	for (const auto &[id, vector] : data) {
+		if (vector.size() == dimensions) {
+			ids.push_back(id);
+			vectors.insert(vectors.end(), vector.begin(), vector.end());
+		}
+	}
+	const auto count = int(ids.size());
+	const auto centroids = TrainTopics(
+		vectors.data(),
+		count,
+		dimensions,
+		k,
+		quint32(count));
+	auto assignments = std::vector<TopicAssignment>(count);
+	AssignTopics(centroids, vectors.data(), count, assignments.data());
+
+	auto clusters = QVector<MessageCluster>(centroids.size());
+	for (auto i = 0; i != int(clusters.size()); ++i) {
+		clusters[i].clusterId = i;
+		clusters[i].messageCount = 0;
+		clusters[i].cohesion = 0.f;
+	}
+	auto texts = std::vector<QStringList>(clusters.size());
+	auto content = PreparedQuery(_archiver->database(), R"(
+		SELECT content FROM message_embeddings WHERE message_id = :id
+	)");
+	for (auto i = 0; i != count; ++i) {
+		auto &cluster = clusters[assignments[i].topic];
+		cluster.messageIds.push_back(ids[i]);
+		++cluster.messageCount;
+		cluster.cohesion += assignments[i].similarity;
+		if (texts[cluster.clusterId].size() < kTopicLabelSample) {
+			content->bindValue(":id", ids[i]);
+			if (content->exec() && content->next()) {
+				texts[cluster.clusterId].push_back(content->value(0).toString());
+			}
+		}
+	}
+	content->finish();
+	LabelClusters(clusters, texts);
+	for (auto &cluster : clusters) {
+		if (cluster.messageCount) {
+			cluster.cohesion /= cluster.messageCount;
+		}
+	}
+	return clusters;
+}
 
-	while (it.hasNext()) {
-		QRegularExpressionMatch match = it.next();
-		Entity entity;
-		entity.type = EntityType::Hashtag;
-		entity.text = match.captured(0);
-		entity.offset = match.capturedStart();
-		entity.length = match.capturedLength();
-		entities.append(entity);
+QJsonObject SemanticSearch::exportClusters(
+		const QVector<MessageCluster> &clusters) {
+	auto topics = QJsonArray();
+	for (const auto &cluster : clusters) {
+		auto ids = QJsonArray();
+		for (const auto id : cluster.messageIds) {
+			ids.append(id);
+		}
+		topics.append(QJsonObject{
+			{ "cluster_id", cluster.clusterId },
+			{ "label", cluster.topicLabel },
+			{ "key_terms", QJsonArray::fromStringList(cluster.keyTerms) },
+			{ "message_count", cluster.messageCount },
+			{ "cohesion", cluster.cohesion },
+			{ "message_ids", ids },
+		});
 	}
+	return QJsonObject{
+		{ "topics", topics },
+		{ "count", topics.size() },
+	};
+}
 
-	return entities;
+SearchIntent SemanticSearch::classifyIntent(const QString &text) {
+	return ClassifyIntent(text);
 }
 
-QVector<Entity> SemanticSearch::extractBotCommands(const QString &text) const {
-	QVector<Entity> entities;
+QVector<Entity> SemanticSearch::extractEntities(const QString &text) {
+	return ScanEntities(text);
+}
 
-	QRegularExpression commandRegex(R"(/(\w+))");
-	QRegularExpressionMatchIterator it = commandRegex.globalMatch(text);
+QJsonObject SemanticSearch::getIntentDistribution(qint64 chatId) {
+	if (!_archiver) {
+		return {};
+	}
+	const auto scan = ScanArchive(_archiver->database(), chatId, true, false);
+	auto counts = QJsonObject();
+	auto percentages = QJsonObject();
+	for (auto i = 0; i != kIntentCount; ++i) {
+		const auto name = SearchIntentName(SearchIntent(i));
+		counts[name] = scan.intents[i];
+		percentages[name] = scan.messages
+			? (100. * scan.intents[i] / scan.messages)
+			: 0.;
+	}
+	return QJsonObject{
+		{ "chat_id", chatId },
+		{ "total_messages", scan.messages },
+		{ "intents", counts },
+		{ "percentages", percentages },
+	};
+}
 
-	while (it.hasNext()) {
-		QRegularExpressionMatch match = it.next();
-		Entity entity;
-		entity.type = EntityType::BotCommand;
-		entity.text = match.captured(0);
-		entity.offset = match.capturedStart();
-		entity.length = match.capturedLength();
-		entities.append(entity);
+QJsonObject SemanticSearch::getEntityStatistics(qint64 chatId) {
+	if (!_archiver) {
+		return {};
 	}
+	const auto scan = ScanArchive(_archiver->database(), chatId, false, true);
+	auto counts = QJsonObject();
+	auto top = QJsonObject();
+	auto total = 0;
+	for (auto i = 0; i != kEntityTypeCount; ++i) {
+		const auto name = EntityTypeName(EntityType(i));
+		const auto &values = scan.values[i];
+		counts[name] = scan.entities[i];
+		total += scan.entities[i];
+		if (values.isEmpty()) {
+			continue;
+		}
 
-	return entities;
+		auto sorted = std::vector<std::pair<int, QString>>();
+		sorted.reserve(values.size());
+		for (auto j = values.begin(); j != values.end(); ++j) {
+			sorted.emplace_back(j.value(), j.key());
+		}
+		const auto count = std::min(int(sorted.size()), kTopEntities);
+		std::partial_sort(
+			sorted.begin(),
+			sorted.begin() + count,
+			sorted.end(),
+			std::greater<>());
+		auto list = QJsonArray();
+		for (auto j = 0; j != count; ++j) {
+			list.append(QJsonObject{
+				{ "value", sorted[j].second },
+				{ "count", sorted[j].first },
+			});
+		}
+		top[name] = list;
+	}
+	return QJsonObject{
+		{ "chat_id", chatId },
+		{ "total_messages", scan.messages },
+		{ "with_archived_entities", scan.withStoredEntities },
+		{ "total_entities", total },
+		{ "by_type", counts },
+		{ "top", top },
+	};
+}
+
+// Cosine similarity
+float SemanticSearch::cosineSimilarity(const EmbeddingVector &a, const EmbeddingVector &b) const {
+	if (a.size() != b.size()) {
+		return 0.0f;
+	}
+
+	const auto count = int(a.size());
+	const auto normA = DotProduct(a.constData(), a.constData(), count);
+	const auto normB = DotProduct(b.constData(), b.constData(), count);
+	if (normA == 0.0f || normB == 0.0f) {
+		return 0.0f;
+	}
+
+	const auto dotProduct = DotProduct(a.constData(), b.constData(), count);
+	return dotProduct / (std::sqrt(normA) * std::sqrt(normB));
 }
 
-// Stub implementations for full semantic search features
 QVector<SearchResult> SemanticSearch::searchSimilar(
 		const QString &query,
 		qint64 chatId,
 		int limit,
 		float minSimilarity) {
+	if (!_isInitialized || query.trimmed().isEmpty()) {
+		return {};
+	}
+	const auto embedding = generateEmbedding(query);
+	return embedding.isEmpty()
+		? QVector<SearchResult>()
+		: rankByEmbedding(embedding, chatId, limit, minSimilarity, 0);
+}
+
+QVector<SearchResult> SemanticSearch::hybridSearch(
+		const QString &query,
+		const HybridSearchOptions &options) {
+	if (!_archiver || options.limit <= 0 || query.trimmed().isEmpty()) {
+		return {};
+	}
+	const auto candidates = std::max(
+		options.limit * kFusionCandidatesPerResult,
+		kMinFusionCandidates);
+	const auto &filter = options.filter;
+
+	// The full-text query runs on a pool thread while this one waits for
+	// the query embedding, usually the slower half.
+	auto lexical = std::promise<std::vector<FullTextHit>>();
+	auto lexicalHits = lexical.get_future();
+	_searchPool.start([&] {
+		lexical.set_value(
+			_archiver->searchFullText(query, filter, candidates));
+	});
+
+	auto semantic = std::vector<VectorMatch>();
+	if (_isInitialized) {
+		const auto embedding = generateEmbedding(query);
+		if (!embedding.isEmpty()) {
+			semantic = (_vectorIndex && _vectorIndex->ready())
+				? _vectorIndex->search(
+					embedding,
+					candidates,
+					filter.chatId,
+					0,
+					options.minSimilarity)
+				: scanEmbeddings(
+					embedding,
+					filter.chatId,
+					candidates,
+					options.minSimilarity,
+					0);
+		}
+	}
+	const auto hits = lexicalHits.get();
+
+	// Full-text hits are already filtered. Vector candidates only know
+	// their chat, the details lookup drops those outside the other
+	// filters before they get a rank.
+	auto details = PreparedQuery(_archiver->database(), QString(R"(
+		SELECT m.chat_id, m.message_id, m.timestamp, m.username,
+			COALESCE(m.content, e.content)
+		FROM messages m
+		LEFT JOIN message_embeddings e ON e.message_id = m.id
+		WHERE m.id = :id%1
+	)").arg(filter.sqlConditions("m")));
+	auto results = QHash<qint64, SearchResult>();
+	const auto load = [&](qint64 id) -> SearchResult* {
+		const auto i = results.find(id);
+		if (i != results.end()) {
+			return &i.value();
+		}
+		details->bindValue(":id", id);
+		filter.bind(*details);
+		if (!details->exec() || !details->next()) {
+			return nullptr;
+		}
+		auto &match = results[id];
+		match.chatId = details->value(0).toLongLong();
+		match.messageId = details->value(1).toLongLong();
+		match.timestamp = details->value(2).toLongLong();
+		match.username = details->value(3).toString();
+		match.content = details->value(4).toString();
+		return &match;
+	};
+
+	auto rank = 0;
+	for (const auto &[id, similarity] : semantic) {
+		if (const auto match = load(id)) {
+			match->similarity = similarity;
+			match->semanticRank = ++rank;
+			match->score += float(1. / (kFusionK + rank));
+		}
+	}
+	rank = 0;
+	for (const auto &hit : hits) {
+		if (const auto match = load(hit.rowId)) {
+			match->snippet = hit.snippet;
+			match->lexicalRank = ++rank;
+			match->score += float(1. / (kFusionK + rank));
+		}
+	}
 
-	// TODO: Implement full semantic search
-	Q_UNUSED(query);
-	Q_UNUSED(chatId);
-	Q_UNUSED(limit);
-	Q_UNUSED(minSimilarity);
+	auto result = QVector<SearchResult>();
+	result.reserve(results.size());
+	for (auto i = results.begin(); i != results.end(); ++i) {
+		auto &match = i.value();
+		match.messageData = QJsonObject{
+			{ "archive_id", i.key() },
+			{ "chat_id", match.chatId },
+			{ "message_id", match.messageId },
+			{ "timestamp", match.timestamp },
+			{ "username", match.username },
+		};
+		result.push_back(std::move(match));
+	}
+	const auto count = std::min(int(result.size()), options.limit);
+	std::partial_sort(
+		result.begin(),
+		result.begin() + count,
+		result.end(),
+		[](const SearchResult &a, const SearchResult &b) {
+			return a.score > b.score;
+		});
+	result.resize(count);
+	return result;
+}
 
-	return QVector<SearchResult>();
+QVector<SearchResult> SemanticSearch::searchSimilarToMessage(
+		qint64 messageId,
+		int limit,
+		float minSimilarity) {
+	if (!_isInitialized) {
+		return {};
+	}
+	const auto embedding = loadEmbedding(messageId);
+	return embedding.isEmpty()
+		? QVector<SearchResult>()
+		: rankByEmbedding(embedding, 0, limit, minSimilarity, messageId);
 }
 
-int SemanticSearch::getIndexedMessageCount() const {
-	// TODO: Implement getIndexedMessageCount using ChatArchiver's public API
-	// _db is private in ChatArchiver, need to add public method for querying embedding count
-	return 0;
+QVector<SearchResult> SemanticSearch::rankByEmbedding(
+		const EmbeddingVector &embedding,
+		qint64 chatId,
+		int limit,
+		float minSimilarity,
+		qint64 excludeId) const {
+	if (limit <= 0) {
+		return {};
+	}
+	const auto fromIndex = _vectorIndex && _vectorIndex->ready();
+	const auto matches = fromIndex
+		? _vectorIndex->search(embedding, limit, chatId, excludeId, minSimilarity)
+		: scanEmbeddings(embedding, chatId, limit, minSimilarity, excludeId);
+
+	auto details = PreparedQuery(_archiver->database(), R"(
+		SELECT m.chat_id, m.message_id, m.timestamp, m.username, e.content
+		FROM message_embeddings e
+		JOIN messages m ON m.id = e.message_id
+		WHERE e.message_id = :id
+	)");
+	auto result = QVector<SearchResult>();
+	result.reserve(int(matches.size()));
+	for (const auto &[id, similarity] : matches) {
+		details->bindValue(":id", id);
+		if (!details->exec()) {
+			continue;
+		} else if (!details->next()) {
+			// Purged since it was indexed, the trigger dropped the row.
+			if (fromIndex) {
+				_vectorIndex->remove(id);
+			}
+			continue;
+		}
+		auto match = SearchResult();
+		match.chatId = details->value(0).toLongLong();
+		match.messageId = details->value(1).toLongLong();
+		match.timestamp = details->value(2).toLongLong();
+		match.username = details->value(3).toString();
+		match.content = details->value(4).toString();
+		match.similarity = similarity;
+		match.messageData = QJsonObject{
+			{ "archive_id", id },
+			{ "chat_id", match.chatId },
+			{ "message_id", match.messageId },
+			{ "timestamp", match.timestamp },
+			{ "username", match.username },
+		};
+		result.push_back(std::move(match));
+	}
+	return result;
+}
 
-	/* Original implementation - needs ChatArchiver public API:
-	if (!_db || !_db->isOpen()) {
-		return 0;
+std::vector<VectorMatch> SemanticSearch::scanEmbeddings(
+		const EmbeddingVector &embedding,
+		qint64 chatId,
+		int limit,
+		float minSimilarity,
+		qint64 excludeId) const {
+	auto scan = PreparedQuery(_archiver->database(), QString(R"(
+		SELECT message_id, embedding FROM message_embeddings
+		WHERE embedding_model = :model %1
+	)").arg(chatId ? "AND chat_id = :chat_id" : ""));
+	scan->bindValue(":model", _modelPath);
+	if (chatId) {
+		scan->bindValue(":chat_id", chatId);
+	}
+	if (!scan->exec()) {
+		qWarning() << "MCP: Failed to scan embeddings:" << scan->lastError().text();
+		return {};
 	}
 
-	QSqlQuery query(*_db);
-	query.exec("SELECT COUNT(*) FROM message_embeddings");
+	// Exhaustive scan keeping the best matches in a min-heap, used until
+	// the vector index caught up. Stored and query vectors are normalized,
+	// so the dot product is the cosine.
+	using Match = std::pair<float, qint64>;
+	auto best = std::priority_queue<
+		Match,
+		std::vector<Match>,
+		std::greater<Match>>();
+	while (scan->next()) {
+		const auto id = scan->value(0).toLongLong();
+		if (id == excludeId) {
+			continue;
+		}
+		const auto scored = Similarity(embedding, scan->value(1).toByteArray());
+		if (!scored) {
+			continue;
+		}
+		const auto similarity = *scored;
+		if (similarity < minSimilarity) {
+			continue;
+		} else if (int(best.size()) < limit) {
+			best.emplace(similarity, id);
+		} else if (similarity > best.top().first) {
+			best.pop();
+			best.emplace(similarity, id);
+		}
+	}
 
-	if (query.next()) {
-		return query.value(0).toInt();
+	auto result = std::vector<VectorMatch>(best.size());
+	for (auto i = result.rbegin(); i != result.rend(); ++i) {
+		*i = VectorMatch{ best.top().second, best.top().first };
+		best.pop();
 	}
+	return result;
+}
 
-	return 0;
-	*/
+int SemanticSearch::getIndexedMessageCount() const {
+	if (!_isInitialized) {
+		return 0;
+	}
+	auto query = PreparedQuery(_archiver->database(), R"(
+		SELECT COUNT(*) FROM message_embeddings WHERE embedding_model = :model
+	)");
+	query->bindValue(":model", _modelPath);
+	return (query->exec() && query->next()) ? query->value(0).toInt() : 0;
 }
 
 } // namespace MCP
@@ -3,6 +3,10 @@
 
 #pragma once
 
+#include "chat_archiver.h"
+#include "embedding_backend.h"
+#include "vector_index.h"
+
 #include <QtCore/QObject>
 #include <QtCore/QString>
 #include <QtCore/QVector>
@@ -10,12 +14,20 @@
 #include <QtCore/QJsonArray>
 #include <QtSql/QSqlDatabase>
 
-namespace MCP {
+#include <QtCore/QMutex>
+#include <QtCore/QThreadPool>
+#include <QtCore/QWaitCondition>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
 
-class ChatArchiver;
+class QThread;
 
-// Embedding vector (typically 384 dimensions for all-MiniLM-L6-v2)
-using EmbeddingVector = QVector<float>;
+namespace MCP {
 
 // Search result with similarity score
 struct SearchResult {
@@ -26,9 +38,23 @@ struct SearchResult {
 	QString username;
 	float similarity;  // Cosine similarity 0.0-1.0
 	QJsonObject messageData;
+
+	// Filled by hybridSearch(), ranks are 1-based, 0 = not in that list.
+	float score = 0.f;
+	int lexicalRank = 0;
+	int semanticRank = 0;
+	QString snippet;
+};
+
+struct HybridSearchOptions {
+	ArchiveSearchFilter filter;
+	int limit = 20;
+	float minSimilarity = 0.3f;
 };
 
-// Message cluster for topic grouping
+// Message cluster for topic grouping. messageIds of detectTopics() are
+// the Telegram ids of the members closest to the centroid, those of
+// clusterMessages() every member as given.
 struct MessageCluster {
 	int clusterId;
 	QString topicLabel;
@@ -70,6 +96,18 @@ struct Entity {
 	int length;
 };
 
+// Names used by the tools and in the archived message metadata.
+[[nodiscard]] QString EntityTypeName(EntityType type);
+[[nodiscard]] std::optional<EntityType> EntityTypeFromName(const QString &name);
+[[nodiscard]] QString SearchIntentName(SearchIntent intent);
+
+// Observer of one indexChat() call, both are called on the indexing
+// thread. Returning false from progress stops after the current page.
+struct IndexingObserver {
+	std::function<bool(int indexed, int total)> progress;
+	std::function<void(int indexed, const QString &error)> done;
+};
+
 // Semantic search engine using embeddings
 class SemanticSearch : public QObject {
 	Q_OBJECT
@@ -78,18 +116,28 @@ public:
 	explicit SemanticSearch(ChatArchiver *archiver, QObject *parent = nullptr);
 	~SemanticSearch();
 
-	// Initialization
+	// Initialization. modelPath picks the embedding backend, see
+	// CreateEmbeddingBackend(): an http(s) url of an /embeddings endpoint
+	// or empty for MCP_EMBEDDING_URL, falling back to local hashing.
 	bool initialize(const QString &modelPath = QString());
 	[[nodiscard]] bool isReady() const { return _isInitialized; }
+	[[nodiscard]] QString modelName() const { return _modelPath; }
 
-	// Embedding generation
+	// Embedding generation, blocks on remote backends
 	EmbeddingVector generateEmbedding(const QString &text);
+	QVector<EmbeddingVector> generateEmbeddings(const QStringList &texts);
 	bool storeEmbedding(qint64 messageId, qint64 chatId,
 	                    const QString &content, const EmbeddingVector &embedding);
 
-	// Index management
+	// Index management. Message ids here are archive row ids (messages.id).
+	// indexChat() and indexAllChats() queue the work to the indexing
+	// thread and return at once, progress comes through the signals.
 	bool indexMessage(qint64 messageId);
-	bool indexChat(qint64 chatId, int limit = -1);
+	bool indexChat(
+		qint64 chatId,
+		int limit = -1,
+		bool rebuild = false,
+		IndexingObserver observer = IndexingObserver());
 	bool indexAllChats();
 	int getIndexedMessageCount() const;
 
@@ -101,13 +149,22 @@ public:
 		float minSimilarity = 0.7
 	);
 
+	// Full-text and vector candidates are fetched concurrently, fused by
+	// reciprocal rank and filtered by chat, sender and date in one pass.
+	QVector<SearchResult> hybridSearch(
+		const QString &query,
+		const HybridSearchOptions &options);
+
 	QVector<SearchResult> searchSimilarToMessage(
 		qint64 messageId,
 		int limit = 10,
 		float minSimilarity = 0.7
 	);
 
-	// Clustering and topic detection
+	// Clustering and topic detection. Topics of a chat are trained once
+	// and kept in topic_centroids / message_clusters, newly indexed
+	// messages are merged into them. detectTopics() trains again when the
+	// topic count changes, the chat doubled since or retrain is set.
 	QVector<MessageCluster> clusterMessages(
 		const QVector<qint64> &messageIds,
 		int numClusters = 5
@@ -117,15 +174,21 @@ public:
 		qint64 chatId,
 		int numTopics = 5,
 		const QDateTime &start = QDateTime(),
-		const QDateTime &end = QDateTime()
+		const QDateTime &end = QDateTime(),
+		bool retrain = false
 	);
 
-	// Intent classification
+	// Intent classification, one precompiled prefix pattern per message
 	SearchIntent classifyIntent(const QString &text);
-	QJsonObject getIntentDistribution(qint64 chatId);
 
-	// Entity extraction
+	// Entity extraction, all entity kinds in a single scan
 	QVector<Entity> extractEntities(const QString &text);
+
+	// Archive-wide statistics, chatId = 0 covers every chat. Pages of
+	// messages are scanned on the global thread pool, entities the
+	// archiver stored from the message's own TextWithEntities are used
+	// instead of scanning the text again.
+	QJsonObject getIntentDistribution(qint64 chatId);
 	QJsonObject getEntityStatistics(qint64 chatId);
 
 	// Export
@@ -142,44 +205,90 @@ private:
 	float cosineSimilarity(const EmbeddingVector &a, const EmbeddingVector &b) const;
 	float euclideanDistance(const EmbeddingVector &a, const EmbeddingVector &b) const;
 
+	struct PendingMessage {
+		qint64 id = 0;
+		qint64 chatId = 0;
+		qint64 messageId = 0;
+		qint64 timestamp = 0;
+		QString content;
+	};
+
 	// Embedding storage/retrieval
 	EmbeddingVector loadEmbedding(qint64 messageId) const;
 	QVector<QPair<qint64, EmbeddingVector>> loadAllEmbeddings(qint64 chatId) const;
+	bool storeEmbeddings(
+		const std::vector<PendingMessage> &messages,
+		const QVector<EmbeddingVector> &embeddings);
+	QVector<SearchResult> rankByEmbedding(
+		const EmbeddingVector &query,
+		qint64 chatId,
+		int limit,
+		float minSimilarity,
+		qint64 excludeId) const;
+	[[nodiscard]] std::vector<VectorMatch> scanEmbeddings(
+		const EmbeddingVector &query,
+		qint64 chatId,
+		int limit,
+		float minSimilarity,
+		qint64 excludeId) const;
+
+	// Runs on the indexing thread
+	void enqueueIndexing(std::function<void()> job);
+	void indexingLoop();
+	void loadVectorIndex();
+	void runIndexing(
+		const QVector<qint64> &chatIds,
+		int limit,
+		bool rebuild,
+		const IndexingObserver &observer = IndexingObserver());
+	[[nodiscard]] std::vector<PendingMessage> pendingMessages(
+		qint64 chatId,
+		int limit,
+		const MessageCursor &before) const;
+	[[nodiscard]] int pendingCount(qint64 chatId, int limit) const;
 
 	// Clustering algorithms
 	QVector<MessageCluster> kMeansClustering(
 		const QVector<QPair<qint64, EmbeddingVector>> &data,
 		int k
 	);
+	bool trainTopics(qint64 chatId, int numTopics);
+	void assignPendingTopics(qint64 chatId);
+	// Runs on the writer, inside the transaction storing the embeddings.
+	void mergeIntoTopics(
+		const QSqlDatabase &db,
+		const std::vector<PendingMessage> &messages,
+		const std::vector<EmbeddingVector> &embeddings);
+	[[nodiscard]] QVector<MessageCluster> describeTopics(
+		qint64 chatId,
+		const ArchiveSearchFilter &filter);
 
 	// Text preprocessing
 	QString preprocessText(const QString &text) const;
 	QStringList tokenize(const QString &text) const;
 
-	// Intent detection helpers
-	bool isQuestion(const QString &text) const;
-	bool isCommand(const QString &text) const;
-	bool isGreeting(const QString &text) const;
-	bool isFarewell(const QString &text) const;
-
-	// Entity extraction helpers
-	QVector<Entity> extractUserMentions(const QString &text) const;
-	QVector<Entity> extractURLs(const QString &text) const;
-	QVector<Entity> extractHashtags(const QString &text) const;
-	QVector<Entity> extractBotCommands(const QString &text) const;
-
 	ChatArchiver *_archiver;
 	bool _isInitialized = false;
 
 	// Model configuration
 	QString _modelPath;
 	int _embeddingDimensions = 384;  // Default for all-MiniLM-L6-v2
-
-	// NOTE: Actual embedding generation would require integration with:
-	// - Python subprocess calling sentence-transformers
-	// - ONNX Runtime for C++ inference
-	// - External HTTP API (OpenAI, Cohere, etc.)
-	// For now, this is a framework implementation
+	std::unique_ptr<EmbeddingBackend> _backend;
+	std::unique_ptr<VectorIndex> _vectorIndex; // <archive db>.hnsw
+
+	// Indexing jobs run one at a time, in submission order. Not through
+	// the thread event loop: remote backends wait in a nested one.
+	std::unique_ptr<QThread> _indexThread;
+	QMutex _indexMutex;
+	QWaitCondition _indexWake;
+	std::deque<std::function<void()>> _indexJobs;
+	std::atomic<bool> _stopping = false;
+
+	// Runs the full-text half of hybrid searches.
+	QThreadPool _searchPool;
+
+	// One topic refresh at a time, two trainings would mix assignments.
+	QMutex _topicsMutex;
 };
 
 } // namespace MCP
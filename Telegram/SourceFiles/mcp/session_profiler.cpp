@@ -0,0 +1,538 @@
+// MCP Session Profiler - Synthetic large account for Data::Session timing
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "session_profiler.h"
+
+#include "base/unixtime.h"
+#include "data/data_chat_filters.h"
+#include "data/data_session.h"
+#include "dialogs/dialogs_main_list.h"
+#include "history/history.h"
+#include "history/history_item.h"
+#include "main/main_session.h"
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QJsonArray>
+
+#include <algorithm>
+#include <array>
+
+namespace MCP {
+namespace {
+
+// Above the ids the server gives out and below the ones of
+// Data::FakePeerIdForJustName().
+constexpr auto kFixtureIdShift = (0xFCULL << 32);
+constexpr auto kFirstFilterId = FilterId(10000);
+constexpr auto kFixtureDays = 365;
+constexpr auto kBumpedDialogs = 100; // Per dialogs_sort iteration.
+constexpr auto kUnreadChanges = 100; // Per unread_aggregation iteration.
+constexpr auto kFilterAlways = 10;
+constexpr auto kFilterNever = 3;
+
+constexpr auto kWords = std::array{
+	"hello", "meeting", "tomorrow", "photo", "thanks", "release",
+	"build", "review", "lunch", "call", "deadline", "draft", "update",
+	"weekend", "ticket", "server", "music", "travel", "price", "idea",
+};
+
+[[nodiscard]] QJsonObject Timings(std::vector<qint64> nanoseconds, int units) {
+	ranges::sort(nanoseconds);
+	const auto at = [&](double fraction) {
+		const auto index = std::min(
+			int(fraction * nanoseconds.size()),
+			int(nanoseconds.size()) - 1);
+		return nanoseconds[index] / 1000.;
+	};
+	const auto median = at(0.5);
+	return QJsonObject{
+		{"iterations", int(nanoseconds.size())},
+		{"units", units},
+		{"min_us", at(0.)},
+		{"median_us", median},
+		{"p90_us", at(0.9)},
+		{"max_us", at(1.)},
+		{"per_unit_us", units ? (median / units) : 0.},
+	};
+}
+
+} // namespace
+
+SessionProfiler::SessionProfiler(not_null<Main::Session*> session)
+: _session(session)
+, _weak(base::make_weak(session)) {
+}
+
+SessionProfiler::~SessionProfiler() {
+	// Fixture filters are local only, the server list comes back on the
+	// next filters reload. Peers and histories stay with the session.
+	const auto session = _weak.get();
+	if (!session) {
+		return;
+	}
+	const auto filters = &session->data().chatsFilters();
+	for (const auto id : _filters) {
+		filters->remove(id);
+	}
+}
+
+const std::vector<QString> &SessionProfiler::Benchmarks() {
+	static const auto result = std::vector<QString>{
+		QString("dialogs_sort"),
+		QString("history_load"),
+		QString("filter_recompute"),
+		QString("unread_aggregation"),
+	};
+	return result;
+}
+
+int SessionProfiler::random(int from, int till) {
+	return std::uniform_int_distribution<int>(from, till)(_random);
+}
+
+QString SessionProfiler::randomText() {
+	auto result = QString();
+	for (auto i = 0, count = random(3, 20); i != count; ++i) {
+		if (i) {
+			result += ' ';
+		}
+		result += kWords[random(0, int(kWords.size()) - 1)];
+	}
+	return result;
+}
+
+QJsonObject SessionProfiler::populate(const SessionFixtureOptions &options) {
+	if (populated()) {
+		auto result = fixtureInfo();
+		result["reused"] = true;
+		return result;
+	}
+	_options = options;
+	_random.seed(options.seed);
+
+	QElapsedTimer timer;
+	timer.start();
+	createPeers();
+	const auto now = base::unixtime::now();
+	for (const auto history : _histories) {
+		// Last messages spread over a month, so that the list is sorted.
+		createHistory(history, now - random(0, 30 * 86400));
+	}
+	_lastDate = now;
+	createFilters();
+	_session->data().sendHistoryChangeNotifications();
+	_populateDuration = timer.elapsed();
+
+	qInfo() << "MCP: Session fixture of" << _histories.size() << "dialogs,"
+		<< _messages << "messages in" << _populateDuration << "ms";
+	return fixtureInfo();
+}
+
+void SessionProfiler::createPeers() {
+	const auto owner = &_session->data();
+
+	// Every other dialog is a private chat, each with its own user.
+	const auto dialogs = std::max(_options.dialogs, 1);
+	const auto users = std::max(_options.users, (dialogs + 1) / 2);
+	_users.reserve(users);
+	for (auto i = 0; i != users; ++i) {
+		using Flag = MTPDuser::Flag;
+		const auto bot = (i % 10 == 9);
+		const auto contact = !bot && (i % 3 == 0);
+		const auto user = owner->processUser(MTP_user(
+			MTP_flags(Flag::f_first_name
+				| Flag::f_last_name
+				| (contact ? Flag::f_contact : Flag())
+				| (bot ? Flag::f_bot : Flag())),
+			MTP_long(kFixtureIdShift + i),
+			MTPlong(), // access_hash
+			MTP_string(QString("Bench")),
+			MTP_string(QString::number(i)),
+			MTPstring(), // username
+			MTPstring(), // phone
+			MTPUserProfilePhoto(),
+			MTPUserStatus(),
+			MTP_int(bot ? 1 : 0), // bot_info_version
+			MTPVector<MTPRestrictionReason>(),
+			MTPstring(), // bot_inline_placeholder
+			MTPstring(), // lang_code
+			MTPEmojiStatus(),
+			MTPVector<MTPUsername>(),
+			MTPRecentStory(),
+			MTPPeerColor(), // color
+			MTPPeerColor(), // profile_color
+			MTPint(), // bot_active_users
+			MTPlong(), // bot_verification_icon
+			MTPlong())); // send_paid_messages_stars
+		_users.push_back(user->id);
+	}
+
+	// The rest are two groups for every channel.
+	const auto date = base::unixtime::now() - kFixtureDays * 86400;
+	_histories.reserve(dialogs);
+	for (auto i = 0; i != dialogs; ++i) {
+		if (!(i % 2)) {
+			_histories.push_back(owner->history(_users[i / 2]));
+			continue;
+		}
+		using Flag = MTPDchannel::Flag;
+		const auto broadcast = (i % 6 == 5);
+		const auto channel = owner->processChat(MTP_channel(
+			MTP_flags(Flag::f_creator
+				| (broadcast ? Flag::f_broadcast : Flag::f_megagroup)
+				| Flag::f_participants_count),
+			MTP_long(kFixtureIdShift + i),
+			MTPlong(), // access_hash
+			MTP_string(QString("Bench chat %1").arg(i)),
+			MTPstring(), // username
+			MTP_chatPhotoEmpty(),
+			MTP_int(date),
+			MTPVector<MTPRestrictionReason>(),
+			MTPChatAdminRights(),
+			MTPChatBannedRights(),
+			MTPChatBannedRights(), // default_banned_rights
+			MTP_int(random(10, 200000)),
+			MTPVector<MTPUsername>(),
+			MTPRecentStory(),
+			MTPPeerColor(), // color
+			MTPPeerColor(), // profile_color
+			MTPEmojiStatus(),
+			MTPint(), // level
+			MTPint(), // subscription_until_date
+			MTPlong(), // bot_verification_icon
+			MTPlong(), // send_paid_messages_stars
+			MTPlong())); // linked_monoforum_id
+		_histories.push_back(owner->history(channel->id));
+	}
+}
+
+MTPMessage SessionProfiler::generateMessage(
+		not_null<History*> history,
+		MsgId id,
+		TimeId date) {
+	using Flag = MTPDmessage::Flag;
+	const auto peer = history->peer;
+	const auto broadcast = peer->isBroadcast();
+	const auto out = !broadcast && !random(0, 4);
+	const auto from = broadcast
+		? PeerId()
+		: out
+		? _session->userPeerId()
+		: peer->isUser()
+		? peer->id
+		: _users[random(0, int(_users.size()) - 1)];
+	const auto media = (_options.mediaEvery > 0)
+		&& !(id.bare % _options.mediaEvery);
+	const auto reactions = (_options.reactionsEvery > 0)
+		&& !(id.bare % _options.reactionsEvery);
+
+	auto photo = MTPMessageMedia();
+	if (media) {
+		photo = MTP_messageMediaPhoto(
+			MTP_flags(MTPDmessageMediaPhoto::Flag::f_photo),
+			MTP_photo(
+				MTP_flags(0),
+				MTP_long(kFixtureIdShift + (++_nextPhotoId)),
+				MTP_long(0),
+				MTP_bytes(),
+				MTP_int(date),
+				MTP_vector<MTPPhotoSize>(1, MTP_photoSize(
+					MTP_string("x"),
+					MTP_int(800),
+					MTP_int(600),
+					MTP_int(64000))),
+				MTPVector<MTPVideoSize>(),
+				MTP_int(2)),
+			MTPint()); // ttl_seconds
+	}
+	auto counts = MTPMessageReactions();
+	if (reactions) {
+		const auto emoji = std::array{
+			QString::fromUtf8("\xF0\x9F\x91\x8D"), // thumbs up
+			QString::fromUtf8("\xE2\x9D\xA4"), // heart
+			QString::fromUtf8("\xF0\x9F\x94\xA5"), // fire
+		};
+		auto list = QVector<MTPReactionCount>();
+		for (auto i = 0, count = random(1, 3); i != count; ++i) {
+			list.push_back(MTP_reactionCount(
+				MTP_flags(0),
+				MTPint(), // chosen_order
+				MTP_reactionEmoji(MTP_string(emoji[i])),
+				MTP_int(random(1, 500))));
+		}
+		counts = MTP_messageReactions(
+			MTP_flags(0),
+			MTP_vector<MTPReactionCount>(std::move(list)),
+			MTPVector<MTPMessagePeerReaction>(),
+			MTPVector<MTPMessageReactor>());
+	}
+	return MTP_message(
+		MTP_flags((from ? Flag::f_from_id : Flag())
+			| (out ? Flag::f_out : Flag())
+			| (broadcast ? Flag::f_post : Flag())
+			| (media ? Flag::f_media : Flag())
+			| (reactions ? Flag::f_reactions : Flag())),
+		MTP_int(int(id.bare)),
+		from ? peerToMTP(from) : MTPPeer(),
+		MTPint(), // from_boosts_applied
+		peerToMTP(peer->id),
+		MTPPeer(), // saved_peer_id
+		MTPMessageFwdHeader(),
+		MTPlong(), // via_bot_id
+		MTPlong(), // via_business_bot_id
+		MTPMessageReplyHeader(),
+		MTP_int(date),
+		MTP_string(randomText()),
+		photo,
+		MTPReplyMarkup(),
+		MTPVector<MTPMessageEntity>(),
+		MTPint(), // views
+		MTPint(), // forwards
+		MTPMessageReplies(),
+		MTPint(), // edit_date
+		MTPstring(), // post_author
+		MTPlong(), // grouped_id
+		counts,
+		MTPVector<MTPRestrictionReason>(),
+		MTPint(), // ttl_period
+		MTPint(), // quick_reply_shortcut_id
+		MTPlong(), // effect
+		MTPFactCheck(),
+		MTPint(), // report_delivery_until_date
+		MTPlong(), // paid_message_stars
+		MTPSuggestedPost(),
+		MTPint()); // schedule_repeat_period
+}
+
+void SessionProfiler::createHistory(not_null<History*> history, TimeId till) {
+	// A messages.getHistory slice, newest first, then the dialog entry
+	// that messages.getDialogs would have given for it.
+	const auto count = std::max(_options.messagesPerDialog, 1);
+	const auto step = std::max(kFixtureDays * 86400 / count, 1);
+	auto slice = QVector<MTPMessage>();
+	slice.reserve(count);
+	for (auto id = count; id != 0; --id) {
+		slice.push_back(generateMessage(
+			history,
+			MsgId(id),
+			till - (count - id) * step));
+	}
+	history->addOlderSlice(slice);
+	history->addNewerSlice({});
+	_messages += count;
+	if (_options.mediaEvery > 0) {
+		_photos += count / _options.mediaEvery;
+	}
+	if (_options.reactionsEvery > 0) {
+		_reactions += count / _options.reactionsEvery;
+	}
+
+	const auto unread = (random(0, 3) == 0)
+		? random(1, std::min(count, 50))
+		: 0;
+	history->applyDialogFields(
+		nullptr,
+		unread,
+		MsgId(count - unread),
+		MsgId(count));
+	history->applyDialogTopMessage(MsgId(count));
+}
+
+void SessionProfiler::createFilters() {
+	using Flag = Data::ChatFilter::Flag;
+	const auto rules = std::array<Data::ChatFilter::Flags, 8>{
+		Flag::Contacts | Flag::NonContacts,
+		Flag::Groups,
+		Flag::Channels,
+		Flag::Bots,
+		Flag::Groups | Flag::NoMuted,
+		Flag::Contacts | Flag::Groups | Flag::NoRead,
+		Flag::Channels | Flag::NoArchived,
+		Data::ChatFilter::Flags(),
+	};
+	const auto filters = &_session->data().chatsFilters();
+	const auto pick = [&](int count) {
+		auto result = base::flat_set<not_null<History*>>();
+		for (auto i = 0; i != count; ++i) {
+			result.emplace(_histories[random(0, int(_histories.size()) - 1)]);
+		}
+		return result;
+	};
+	for (auto i = 0; i < _options.folders; ++i) {
+		const auto id = kFirstFilterId + i;
+		auto never = pick(kFilterNever);
+		auto always = pick(kFilterAlways);
+		for (const auto &history : never) {
+			always.remove(history);
+		}
+		filters->set(Data::ChatFilter(
+			id,
+			Data::ChatFilterTitle{
+				.text = { .text = QString("Bench %1").arg(i) },
+			},
+			QString(), // iconEmoji
+			std::nullopt, // colorIndex
+			rules[i % rules.size()],
+			std::move(always),
+			{}, // pinned
+			std::move(never)));
+		_filters.push_back(id);
+	}
+
+	// Put the dialogs to the lists of the new filters.
+	const auto owner = &_session->data();
+	for (const auto history : _histories) {
+		if (history->inChatList()) {
+			owner->refreshChatListEntry(history);
+		}
+	}
+}
+
+QJsonObject SessionProfiler::fixtureInfo() const {
+	return QJsonObject{
+		{"dialogs", int(_histories.size())},
+		{"folders", int(_filters.size())},
+		{"users", int(_users.size())},
+		{"messages", _messages},
+		{"photos", _photos},
+		{"reactions", _reactions},
+		{"populate_ms", double(_populateDuration)},
+	};
+}
+
+QJsonObject SessionProfiler::run(const QString &benchmark, int iterations) {
+	iterations = std::clamp(iterations, 1, 1000);
+	auto result = (benchmark == QString("dialogs_sort"))
+		? benchmarkDialogsSort(iterations)
+		: (benchmark == QString("history_load"))
+		? benchmarkHistoryLoad(iterations)
+		: (benchmark == QString("filter_recompute"))
+		? benchmarkFilterRecompute(iterations)
+		: (benchmark == QString("unread_aggregation"))
+		? benchmarkUnreadAggregation(iterations)
+		: QJsonObject{{"error", "Unknown benchmark"}};
+	result["benchmark"] = benchmark;
+	return result;
+}
+
+QJsonObject SessionProfiler::benchmarkDialogsSort(int iterations) {
+	// New messages in random dialogs move them to the top of the main
+	// list and of every filter list that has them.
+	auto samples = std::vector<qint64>();
+	samples.reserve(iterations);
+	for (auto i = 0; i != iterations; ++i) {
+		auto messages = std::vector<std::pair<not_null<History*>, MTPMessage>>();
+		messages.reserve(kBumpedDialogs);
+		auto ids = base::flat_map<not_null<History*>, MsgId>();
+		for (auto j = 0; j != kBumpedDialogs; ++j) {
+			const auto history = _histories[
+				random(0, int(_histories.size()) - 1)];
+			auto &id = ids[history];
+			if (!id) {
+				const auto last = history->lastMessage();
+				id = last ? last->id : MsgId();
+			}
+			++id;
+			messages.emplace_back(
+				history,
+				generateMessage(history, id, ++_lastDate));
+		}
+
+		QElapsedTimer timer;
+		timer.start();
+		for (const auto &[history, message] : messages) {
+			history->addNewMessage(
+				IdFromMessage(message),
+				message,
+				MessageFlags(),
+				NewMessageType::Last);
+		}
+		_session->data().sendHistoryChangeNotifications();
+		samples.push_back(timer.nsecsElapsed());
+	}
+	return Timings(std::move(samples), kBumpedDialogs);
+}
+
+QJsonObject SessionProfiler::benchmarkHistoryLoad(int iterations) {
+	// Reopening an unloaded chat, the items are known and only the
+	// blocks and views are built again, like after a history unload.
+	auto samples = std::vector<qint64>();
+	samples.reserve(iterations);
+	auto units = 0;
+	for (auto i = 0; i != iterations; ++i) {
+		const auto history = _histories[
+			random(0, int(_histories.size()) - 1)];
+		const auto last = history->lastMessage();
+		const auto count = last ? int(last->id.bare) : 0;
+		auto slice = QVector<MTPMessage>();
+		slice.reserve(count);
+		for (auto id = count; id != 0; --id) {
+			slice.push_back(generateMessage(history, MsgId(id), _lastDate));
+		}
+		history->clear(History::ClearType::Unload);
+
+		QElapsedTimer timer;
+		timer.start();
+		history->addOlderSlice(slice);
+		history->addNewerSlice({});
+		samples.push_back(timer.nsecsElapsed());
+		units += count;
+	}
+	return Timings(std::move(samples), units / iterations);
+}
+
+QJsonObject SessionProfiler::benchmarkFilterRecompute(int iterations) {
+	// What a changed rule or a changed peer type costs for all dialogs.
+	const auto owner = &_session->data();
+	auto samples = std::vector<qint64>();
+	samples.reserve(iterations);
+	for (auto i = 0; i != iterations; ++i) {
+		QElapsedTimer timer;
+		timer.start();
+		for (const auto history : _histories) {
+			if (history->inChatList()) {
+				owner->refreshChatListEntry(history);
+			}
+		}
+		samples.push_back(timer.nsecsElapsed());
+	}
+	const auto filters = int(owner->chatsFilters().list().size());
+	return Timings(
+		std::move(samples),
+		int(_histories.size()) * std::max(filters, 1));
+}
+
+QJsonObject SessionProfiler::benchmarkUnreadAggregation(int iterations) {
+	// Unread counts going up and down, each change is summed into the
+	// main list and the filter lists, their badges are read after it.
+	const auto owner = &_session->data();
+	auto samples = std::vector<qint64>();
+	samples.reserve(iterations);
+	auto badges = 0;
+	for (auto i = 0; i != iterations; ++i) {
+		auto changes = std::vector<std::pair<not_null<History*>, int>>();
+		changes.reserve(kUnreadChanges);
+		for (auto j = 0; j != kUnreadChanges; ++j) {
+			const auto history = _histories[
+				random(0, int(_histories.size()) - 1)];
+			changes.emplace_back(history, random(0, 50));
+		}
+
+		QElapsedTimer timer;
+		timer.start();
+		for (const auto &[history, count] : changes) {
+			history->setUnreadCount(count);
+		}
+		badges += owner->chatsList()->unreadState().messages;
+		for (const auto id : _filters) {
+			badges += owner->chatsFilters().chatsList(id)->unreadState().chats;
+		}
+		samples.push_back(timer.nsecsElapsed());
+	}
+	auto result = Timings(std::move(samples), kUnreadChanges);
+	result["badges_checksum"] = badges;
+	return result;
+}
+
+} // namespace MCP
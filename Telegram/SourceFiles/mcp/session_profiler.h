@@ -0,0 +1,87 @@
+// MCP Session Profiler - Synthetic large account for Data::Session timing
+//
+// This file is part of Telegram Desktop MCP integration.
+// Fills the session with generated users, groups and channels, their
+// histories with photos and reactions and chat filters, all through the
+// same MTP parsing and History paths that server data takes, and times
+// dialogs sorting, history load, chat filter recompute and unread
+// aggregation on them. Nothing is sent to the server, but the generated
+// peers stay loaded until the app quits, so use a test account.
+
+#pragma once
+
+#include "base/weak_ptr.h"
+#include "data/data_types.h"
+
+#include <QtCore/QJsonObject>
+#include <QtCore/QString>
+
+#include <random>
+#include <vector>
+
+class History;
+
+namespace Main {
+class Session;
+} // namespace Main
+
+namespace MCP {
+
+struct SessionFixtureOptions {
+	int dialogs = 3000;
+	int folders = 200;
+	int messagesPerDialog = 100;
+	int users = 1000; // Senders in groups, also the private chats.
+	int mediaEvery = 10; // Every n-th message has a photo.
+	int reactionsEvery = 7; // Every n-th message has reactions.
+	int seed = 1;
+};
+
+class SessionProfiler final {
+public:
+	explicit SessionProfiler(not_null<Main::Session*> session);
+	~SessionProfiler();
+
+	// Generates the fixture once, later calls only report its size.
+	QJsonObject populate(const SessionFixtureOptions &options);
+	[[nodiscard]] bool populated() const { return !_histories.empty(); }
+
+	// dialogs_sort, history_load, filter_recompute, unread_aggregation.
+	[[nodiscard]] static const std::vector<QString> &Benchmarks();
+	[[nodiscard]] QJsonObject run(const QString &benchmark, int iterations);
+
+private:
+	[[nodiscard]] int random(int from, int till);
+	[[nodiscard]] QString randomText();
+	[[nodiscard]] MTPMessage generateMessage(
+		not_null<History*> history,
+		MsgId id,
+		TimeId date);
+	void createPeers();
+	void createHistory(not_null<History*> history, TimeId till);
+	void createFilters();
+	[[nodiscard]] QJsonObject fixtureInfo() const;
+
+	[[nodiscard]] QJsonObject benchmarkDialogsSort(int iterations);
+	[[nodiscard]] QJsonObject benchmarkHistoryLoad(int iterations);
+	[[nodiscard]] QJsonObject benchmarkFilterRecompute(int iterations);
+	[[nodiscard]] QJsonObject benchmarkUnreadAggregation(int iterations);
+
+	const not_null<Main::Session*> _session;
+	const base::weak_ptr<Main::Session> _weak;
+	SessionFixtureOptions _options;
+	std::mt19937 _random;
+
+	std::vector<PeerId> _users;
+	std::vector<not_null<History*>> _histories;
+	std::vector<FilterId> _filters;
+	uint64 _nextPhotoId = 0;
+	TimeId _lastDate = 0; // Dates of bumped dialogs keep growing.
+	int _messages = 0;
+	int _photos = 0;
+	int _reactions = 0;
+	crl::time _populateDuration = 0;
+
+};
+
+} // namespace MCP
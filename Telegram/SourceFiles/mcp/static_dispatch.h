@@ -0,0 +1,119 @@
+// MCP Static Dispatch - Compile-time name to handler tables
+//
+// This file is part of Telegram Desktop MCP integration.
+// Builds an open-addressing hash table over a constexpr registry, so
+// looking up a JSON-RPC method or tool name hashes the QString in place
+// and never allocates or copies a std::function.
+
+#pragma once
+
+#include <QtCore/QString>
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <string_view>
+
+namespace MCP {
+
+template <typename Method>
+struct DispatchEntry {
+	std::string_view name;
+	Method method = nullptr;
+};
+
+// FNV-1a over code units. Registry names are ASCII, so a literal and the
+// equal QString hash identically.
+[[nodiscard]] constexpr std::uint32_t DispatchHash(std::string_view name) {
+	auto hash = std::uint32_t(2166136261u);
+	for (const auto ch : name) {
+		hash = (hash ^ std::uint32_t(static_cast<unsigned char>(ch)))
+			* 16777619u;
+	}
+	return hash;
+}
+
+[[nodiscard]] inline std::uint32_t DispatchHash(const QString &name) {
+	auto hash = std::uint32_t(2166136261u);
+	for (const auto ch : name) {
+		hash = (hash ^ std::uint32_t(ch.unicode())) * 16777619u;
+	}
+	return hash;
+}
+
+template <typename Method, std::size_t Count>
+class StaticDispatch {
+public:
+	using Entries = std::array<DispatchEntry<Method>, Count>;
+
+	constexpr explicit StaticDispatch(const Entries &entries)
+	: _entries(entries) {
+		_slots.fill(kEmpty);
+		for (auto i = std::size_t(); i != Count; ++i) {
+			auto slot = DispatchHash(entries[i].name) & kMask;
+			while (_slots[slot] != kEmpty) {
+				if (_entries[_slots[slot]].name == entries[i].name) {
+					// Not a constant expression: fails the build.
+					throw "Duplicate name in MCP dispatch registry.";
+				}
+				slot = (slot + 1) & kMask;
+			}
+			_slots[slot] = std::uint16_t(i);
+		}
+	}
+
+	[[nodiscard]] Method find(const QString &name) const {
+		const auto index = indexOf(name);
+		return (index >= 0) ? _entries[index].method : nullptr;
+	}
+
+	// Position in the registry, -1 if the name is not there.
+	[[nodiscard]] int indexOf(const QString &name) const {
+		auto slot = DispatchHash(name) & kMask;
+		while (_slots[slot] != kEmpty) {
+			const auto index = _slots[slot];
+			if (equals(_entries[index].name, name)) {
+				return int(index);
+			}
+			slot = (slot + 1) & kMask;
+		}
+		return -1;
+	}
+
+	[[nodiscard]] constexpr const Entries &entries() const {
+		return _entries;
+	}
+
+private:
+	// At most half full, keeps probe sequences short.
+	static constexpr auto kTableSize = std::bit_ceil(Count * 2);
+	static constexpr auto kMask = std::uint32_t(kTableSize - 1);
+	static constexpr auto kEmpty = std::uint16_t(0xFFFF);
+	static_assert(Count < kEmpty);
+
+	[[nodiscard]] static bool equals(
+			std::string_view key,
+			const QString &name) {
+		if (std::size_t(name.size()) != key.size()) {
+			return false;
+		}
+		for (auto i = std::size_t(); i != key.size(); ++i) {
+			if (name[qsizetype(i)].unicode()
+				!= static_cast<unsigned char>(key[i])) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	Entries _entries;
+	std::array<std::uint16_t, kTableSize> _slots = {};
+};
+
+template <typename Method, std::size_t Count>
+[[nodiscard]] constexpr auto MakeDispatch(
+		const std::array<DispatchEntry<Method>, Count> &entries) {
+	return StaticDispatch<Method, Count>(entries);
+}
+
+} // namespace MCP
@@ -0,0 +1,119 @@
+// MCP Stdio Reader - Event-driven stdin reader implementation
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "stdio_reader.h"
+
+#include <QtCore/QDebug>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else // Q_OS_WIN
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#endif // Q_OS_WIN
+
+namespace MCP {
+namespace {
+
+constexpr auto kReadChunk = 64 * 1024;
+constexpr auto kStopCheckMs = 250;
+constexpr auto kStopWaitMs = 1000;
+
+} // namespace
+
+StdioReader::StdioReader(QObject *parent)
+	: QObject(parent) {
+}
+
+StdioReader::~StdioReader() {
+	stop();
+}
+
+void StdioReader::start() {
+	if (_running.load()) {
+		return;
+	}
+	_stopping = false;
+	_running = true;
+	_thread = QThread::create([=] { run(); });
+	_thread->setObjectName(QStringLiteral("mcp_stdio_reader"));
+	_thread->start();
+}
+
+void StdioReader::stop() {
+	if (!_thread) {
+		return;
+	}
+	_stopping = true;
+	if (!_thread->wait(kStopWaitMs)) {
+		// Only reachable where the read itself cannot be interrupted.
+		qWarning() << "MCP: Stdio reader did not stop in time, terminating";
+		_thread->terminate();
+		_thread->wait();
+	}
+	delete _thread;
+	_thread = nullptr;
+	_running = false;
+}
+
+void StdioReader::run() {
+	char buffer[kReadChunk];
+	while (!_stopping.load()) {
+#ifndef Q_OS_WIN
+		// Sleep in poll() until stdin is readable, waking up periodically
+		// only to notice a stop() request.
+		auto fds = pollfd{ STDIN_FILENO, POLLIN, 0 };
+		const auto ready = ::poll(&fds, 1, kStopCheckMs);
+		if (ready == 0) {
+			continue;
+		} else if (ready < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		const auto read = ::read(STDIN_FILENO, buffer, sizeof(buffer));
+		if (read < 0 && errno == EINTR) {
+			continue;
+		}
+#else // !Q_OS_WIN
+		const auto read = ::_read(0, buffer, sizeof(buffer));
+#endif // !Q_OS_WIN
+		if (read <= 0) {
+			break;
+		}
+		_pending.append(buffer, int(read));
+
+		// Hand over every complete line received so far in one batch.
+		auto lines = QList<QByteArray>();
+		auto from = 0;
+		for (auto till = _pending.indexOf('\n', from)
+			; till >= 0
+			; till = _pending.indexOf('\n', from)) {
+			auto line = _pending.mid(from, till - from).trimmed();
+			if (!line.isEmpty()) {
+				lines.push_back(std::move(line));
+			}
+			from = till + 1;
+		}
+		if (from > 0) {
+			_pending.remove(0, from);
+		}
+		if (!lines.isEmpty()) {
+			Q_EMIT linesReady(std::move(lines));
+		}
+	}
+
+	// A final unterminated line is still a request.
+	const auto rest = _pending.trimmed();
+	if (!rest.isEmpty() && !_stopping.load()) {
+		Q_EMIT linesReady({ rest });
+	}
+	_pending.clear();
+	_running = false;
+	Q_EMIT finished();
+}
+
+} // namespace MCP
@@ -0,0 +1,52 @@
+// MCP Stdio Reader - Event-driven stdin reader for the stdio transport
+//
+// This file is part of Telegram Desktop MCP integration.
+// Reads stdin on a dedicated thread and hands complete lines to the
+// main thread, so requests are dispatched as soon as they arrive.
+
+#pragma once
+
+#include <QtCore/QObject>
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+#include <QtCore/QThread>
+
+#include <atomic>
+
+namespace MCP {
+
+// Blocking reader running on its own thread.
+// Every wakeup drains all bytes currently available on stdin and
+// emits the complete lines found in them as a single batch.
+class StdioReader : public QObject {
+	Q_OBJECT
+
+public:
+	explicit StdioReader(QObject *parent = nullptr);
+	~StdioReader() override;
+
+	// Spawn the reader thread (no-op if already running)
+	void start();
+
+	// Ask the reader thread to finish and wait for it
+	void stop();
+
+	[[nodiscard]] bool isRunning() const { return _running.load(); }
+
+Q_SIGNALS:
+	// Emitted from the reader thread, delivered queued to the owner
+	void linesReady(QList<QByteArray> lines);
+
+	// Emitted once when stdin reaches EOF or fails
+	void finished();
+
+private:
+	void run();
+
+	QThread *_thread = nullptr;
+	std::atomic<bool> _running = false;
+	std::atomic<bool> _stopping = false;
+	QByteArray _pending;
+};
+
+} // namespace MCP
@@ -0,0 +1,359 @@
+// MCP Tag Index - In-memory bitmaps over message_tags
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "tag_index.h"
+
+#include "mcp_helpers.h"
+
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+
+#include <algorithm>
+#include <bit>
+#include <iterator>
+
+namespace MCP {
+namespace {
+
+constexpr auto kChunkBits = 16;
+constexpr auto kChunkValues = 1 << kChunkBits;
+constexpr auto kBitmapWords = kChunkValues / 64;
+constexpr auto kArrayLimit = 4096; // A bitset takes 8 KB, so does this.
+
+constexpr auto kTagsTable = R"(
+	CREATE TABLE IF NOT EXISTS message_tags (
+		id INTEGER PRIMARY KEY AUTOINCREMENT,
+		chat_id INTEGER NOT NULL,
+		message_id INTEGER NOT NULL,
+		tag_name TEXT NOT NULL,
+		color TEXT,
+		created_at TEXT,
+		UNIQUE(chat_id, message_id, tag_name)
+	)
+)";
+
+[[nodiscard]] qint64 High(qint64 value) {
+	return value >> kChunkBits;
+}
+
+[[nodiscard]] quint16 Low(qint64 value) {
+	return quint16(value & (kChunkValues - 1));
+}
+
+[[nodiscard]] bool TestBit(const std::vector<quint64> &bits, quint16 low) {
+	return (bits[low / 64] >> (low % 64)) & 1;
+}
+
+} // namespace
+
+bool RowBitmap::add(qint64 value) {
+	auto &chunk = _chunks[High(value)];
+	const auto low = Low(value);
+	if (chunk.dense()) {
+		auto &word = chunk.bits[low / 64];
+		const auto mask = quint64(1) << (low % 64);
+		if (word & mask) {
+			return false;
+		}
+		word |= mask;
+	} else {
+		const auto i = std::lower_bound(
+			begin(chunk.array),
+			end(chunk.array),
+			low);
+		if (i != end(chunk.array) && *i == low) {
+			return false;
+		}
+		chunk.array.insert(i, low);
+	}
+	if (++chunk.cardinality > kArrayLimit && !chunk.dense()) {
+		ToBits(chunk);
+	}
+	return true;
+}
+
+bool RowBitmap::remove(qint64 value) {
+	const auto i = _chunks.find(High(value));
+	if (i == end(_chunks)) {
+		return false;
+	}
+	auto &chunk = i->second;
+	const auto low = Low(value);
+	if (chunk.dense()) {
+		auto &word = chunk.bits[low / 64];
+		const auto mask = quint64(1) << (low % 64);
+		if (!(word & mask)) {
+			return false;
+		}
+		word &= ~mask;
+		if (--chunk.cardinality <= kArrayLimit) {
+			ToArray(chunk);
+		}
+	} else {
+		const auto j = std::lower_bound(
+			begin(chunk.array),
+			end(chunk.array),
+			low);
+		if (j == end(chunk.array) || *j != low) {
+			return false;
+		}
+		chunk.array.erase(j);
+		--chunk.cardinality;
+	}
+	if (!chunk.cardinality) {
+		_chunks.erase(i);
+	}
+	return true;
+}
+
+bool RowBitmap::contains(qint64 value) const {
+	const auto i = _chunks.find(High(value));
+	if (i == end(_chunks)) {
+		return false;
+	}
+	const auto &chunk = i->second;
+	const auto low = Low(value);
+	return chunk.dense()
+		? TestBit(chunk.bits, low)
+		: std::binary_search(begin(chunk.array), end(chunk.array), low);
+}
+
+qint64 RowBitmap::cardinality() const {
+	auto result = qint64();
+	for (const auto &[high, chunk] : _chunks) {
+		result += chunk.cardinality;
+	}
+	return result;
+}
+
+RowBitmap RowBitmap::intersected(const RowBitmap &other) const {
+	auto result = RowBitmap();
+	auto i = begin(_chunks);
+	auto j = begin(other._chunks);
+	while (i != end(_chunks) && j != end(other._chunks)) {
+		if (i->first < j->first) {
+			++i;
+		} else if (j->first < i->first) {
+			++j;
+		} else {
+			auto chunk = Intersect(i->second, j->second);
+			if (chunk.cardinality) {
+				result._chunks.emplace(i->first, std::move(chunk));
+			}
+			++i;
+			++j;
+		}
+	}
+	return result;
+}
+
+std::vector<qint64> RowBitmap::largest(int limit) const {
+	auto result = std::vector<qint64>();
+	for (auto i = _chunks.rbegin(); i != _chunks.rend(); ++i) {
+		const auto base = i->first << kChunkBits;
+		const auto &chunk = i->second;
+		if (chunk.dense()) {
+			for (auto word = kBitmapWords; word != 0;) {
+				auto bits = chunk.bits[--word];
+				while (bits) {
+					if (int(result.size()) >= limit) {
+						return result;
+					}
+					const auto top = 63 - std::countl_zero(bits);
+					result.push_back(base + word * 64 + top);
+					bits &= ~(quint64(1) << top);
+				}
+			}
+		} else {
+			for (auto j = chunk.array.rbegin(); j != chunk.array.rend(); ++j) {
+				if (int(result.size()) >= limit) {
+					return result;
+				}
+				result.push_back(base + *j);
+			}
+		}
+	}
+	return result;
+}
+
+RowBitmap::Chunk RowBitmap::Intersect(const Chunk &a, const Chunk &b) {
+	auto result = Chunk();
+	if (a.dense() && b.dense()) {
+		result.bits.resize(kBitmapWords);
+		for (auto i = 0; i != kBitmapWords; ++i) {
+			result.bits[i] = a.bits[i] & b.bits[i];
+			result.cardinality += std::popcount(result.bits[i]);
+		}
+		if (result.cardinality <= kArrayLimit) {
+			ToArray(result);
+		}
+	} else if (a.dense() || b.dense()) {
+		const auto &dense = a.dense() ? a : b;
+		const auto &sparse = a.dense() ? b : a;
+		for (const auto low : sparse.array) {
+			if (TestBit(dense.bits, low)) {
+				result.array.push_back(low);
+			}
+		}
+		result.cardinality = int(result.array.size());
+	} else {
+		std::set_intersection(
+			begin(a.array),
+			end(a.array),
+			begin(b.array),
+			end(b.array),
+			std::back_inserter(result.array));
+		result.cardinality = int(result.array.size());
+	}
+	return result;
+}
+
+void RowBitmap::ToBits(Chunk &chunk) {
+	chunk.bits.assign(kBitmapWords, 0);
+	for (const auto low : chunk.array) {
+		chunk.bits[low / 64] |= quint64(1) << (low % 64);
+	}
+	chunk.array = std::vector<quint16>();
+}
+
+void RowBitmap::ToArray(Chunk &chunk) {
+	chunk.array.clear();
+	chunk.array.reserve(chunk.cardinality);
+	for (auto word = 0; word != kBitmapWords; ++word) {
+		auto bits = chunk.bits[word];
+		while (bits) {
+			const auto bottom = std::countr_zero(bits);
+			chunk.array.push_back(quint16(word * 64 + bottom));
+			bits &= bits - 1;
+		}
+	}
+	chunk.bits = std::vector<quint64>();
+}
+
+TagIndex::TagIndex(QSqlDatabase db)
+: _db(std::move(db)) {
+}
+
+bool TagIndex::initialize() {
+	QSqlQuery query(_db);
+	if (!query.exec(kTagsTable)) {
+		qWarning() << "MCP: Failed to create message_tags:" << query.lastError().text();
+		return false;
+	}
+	return true;
+}
+
+void TagIndex::ensureLoaded() {
+	if (_loaded) {
+		return;
+	}
+	_loaded = true;
+	auto query = PreparedQuery(_db, R"(
+		SELECT id, chat_id, tag_name, color FROM message_tags ORDER BY id
+	)");
+	if (!query->exec()) {
+		qWarning() << "MCP: Failed to load message tags:" << query->lastError().text();
+		return;
+	}
+	while (query->next()) {
+		added(
+			query->value(0).toLongLong(),
+			query->value(1).toLongLong(),
+			query->value(2).toString(),
+			query->value(3).toString());
+	}
+}
+
+void TagIndex::added(
+		qint64 rowId,
+		qint64 chatId,
+		const QString &tag,
+		const QString &color) {
+	// Before the first query the rows are read from the table anyway.
+	if (!_loaded) {
+		return;
+	}
+	auto &entry = _tags[tag];
+	if (!color.isEmpty()) {
+		entry.color = color;
+	}
+	if (entry.rows.add(rowId)) {
+		++entry.chats[chatId];
+		_chats[chatId].add(rowId);
+	}
+}
+
+void TagIndex::removed(qint64 rowId, qint64 chatId, const QString &tag) {
+	if (!_loaded) {
+		return;
+	}
+	const auto i = _tags.find(tag);
+	if (i == _tags.end() || !i->rows.remove(rowId)) {
+		return;
+	}
+	if (--i->chats[chatId] <= 0) {
+		i->chats.remove(chatId);
+	}
+	if (i->rows.empty()) {
+		_tags.erase(i);
+	}
+	const auto j = _chats.find(chatId);
+	if (j != _chats.end()) {
+		j->remove(rowId);
+		if (j->empty()) {
+			_chats.erase(j);
+		}
+	}
+}
+
+RowBitmap TagIndex::matching(const QStringList &tags, qint64 chatId) {
+	ensureLoaded();
+	if (tags.isEmpty()) {
+		return {};
+	}
+
+	// Smallest bitmap first keeps every intermediate result small.
+	auto bitmaps = std::vector<const RowBitmap*>();
+	for (const auto &tag : tags) {
+		const auto i = _tags.constFind(tag);
+		if (i == _tags.cend()) {
+			return {};
+		}
+		bitmaps.push_back(&i->rows);
+	}
+	if (chatId) {
+		const auto i = _chats.constFind(chatId);
+		if (i == _chats.cend()) {
+			return {};
+		}
+		bitmaps.push_back(&*i);
+	}
+	std::sort(begin(bitmaps), end(bitmaps), [](auto a, auto b) {
+		return a->cardinality() < b->cardinality();
+	});
+	auto result = *bitmaps.front();
+	for (auto i = 1; i < int(bitmaps.size()) && !result.empty(); ++i) {
+		result = result.intersected(*bitmaps[i]);
+	}
+	return result;
+}
+
+std::vector<TagUsage> TagIndex::usage(qint64 chatId) {
+	ensureLoaded();
+	auto result = std::vector<TagUsage>();
+	for (auto i = _tags.cbegin(); i != _tags.cend(); ++i) {
+		const auto count = chatId
+			? i->chats.value(chatId)
+			: int(i->rows.cardinality());
+		if (count > 0) {
+			result.push_back({ i.key(), i->color, count });
+		}
+	}
+	std::sort(begin(result), end(result), [](const auto &a, const auto &b) {
+		return (a.count != b.count) ? (a.count > b.count) : (a.tag < b.tag);
+	});
+	return result;
+}
+
+} // namespace MCP
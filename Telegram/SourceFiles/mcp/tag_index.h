@@ -0,0 +1,98 @@
+// MCP Tag Index - In-memory bitmaps over message_tags
+//
+// This file is part of Telegram Desktop MCP integration.
+// Every tag maps to a bitmap of its message_tags rowids, so "a AND b"
+// is a bitmap intersection and usage counts need no GROUP BY. The
+// bitmaps follow the roaring layout: rowids are split by their high
+// bits into chunks of 65536, a chunk is a sorted array of the low 16
+// bits while sparse and a plain bitset once dense. The index is read
+// from the table on first use and kept current by the tag tools.
+
+#pragma once
+
+#include "base/flat_map.h"
+
+#include <QtCore/QHash>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtSql/QSqlDatabase>
+
+#include <vector>
+
+namespace MCP {
+
+class RowBitmap final {
+public:
+	bool add(qint64 value); // false if it was there already.
+	bool remove(qint64 value); // false if it was not there.
+	[[nodiscard]] bool contains(qint64 value) const;
+	[[nodiscard]] qint64 cardinality() const;
+	[[nodiscard]] bool empty() const { return _chunks.empty(); }
+
+	[[nodiscard]] RowBitmap intersected(const RowBitmap &other) const;
+
+	// Largest values first, at most limit of them.
+	[[nodiscard]] std::vector<qint64> largest(int limit) const;
+
+private:
+	struct Chunk {
+		std::vector<quint16> array; // Sorted low bits while sparse.
+		std::vector<quint64> bits; // 1024 words once dense.
+		int cardinality = 0;
+
+		[[nodiscard]] bool dense() const { return !bits.empty(); }
+	};
+
+	[[nodiscard]] static Chunk Intersect(const Chunk &a, const Chunk &b);
+	static void ToBits(Chunk &chunk);
+	static void ToArray(Chunk &chunk);
+
+	base::flat_map<qint64, Chunk> _chunks; // By value >> 16.
+
+};
+
+struct TagUsage {
+	QString tag;
+	QString color;
+	int count = 0;
+};
+
+class TagIndex final {
+public:
+	explicit TagIndex(QSqlDatabase db);
+
+	// Creates message_tags when it is missing.
+	bool initialize();
+
+	void added(
+		qint64 rowId,
+		qint64 chatId,
+		const QString &tag,
+		const QString &color);
+	void removed(qint64 rowId, qint64 chatId, const QString &tag);
+
+	// Rowids having every tag, in chatId only if it is not 0.
+	[[nodiscard]] RowBitmap matching(
+		const QStringList &tags,
+		qint64 chatId = 0);
+
+	// Most used tags first, in chatId only if it is not 0.
+	[[nodiscard]] std::vector<TagUsage> usage(qint64 chatId = 0);
+
+private:
+	struct Tag {
+		RowBitmap rows;
+		QHash<qint64, int> chats; // chat_id -> rows with the tag.
+		QString color;
+	};
+
+	void ensureLoaded();
+
+	QSqlDatabase _db;
+	QHash<QString, Tag> _tags;
+	QHash<qint64, RowBitmap> _chats;
+	bool _loaded = false;
+
+};
+
+} // namespace MCP
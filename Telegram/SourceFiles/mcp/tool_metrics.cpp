@@ -0,0 +1,243 @@
+// MCP Tool Metrics - Per-tool counters and latency histograms
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "tool_metrics.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QJsonArray>
+
+#include <algorithm>
+#include <bit>
+#include <vector>
+
+namespace MCP {
+namespace {
+
+constexpr auto kUnknownTool = "unknown";
+
+QByteArray PrometheusLabel(const QString &value) {
+	auto result = value.toUtf8();
+	result.replace('\\', "\\\\");
+	result.replace('"', "\\\"");
+	result.replace('\n', "\\n");
+	return result;
+}
+
+QByteArray Seconds(std::uint64_t microseconds) {
+	return QByteArray::number(double(microseconds) / 1000000., 'g', 9);
+}
+
+} // namespace
+
+ToolMetrics::ToolMetrics(const QStringList &toolNames)
+: _names(toolNames)
+, _startedAt(QDateTime::currentMSecsSinceEpoch()) {
+	_names.push_back(kUnknownTool);
+	_entries = std::make_unique<Entry[]>(_names.size());
+	_indices.reserve(_names.size());
+	for (auto i = 0; i != _names.size(); ++i) {
+		_indices.insert(_names[i], i);
+	}
+}
+
+int ToolMetrics::BucketIndex(std::uint64_t microseconds) {
+	if (microseconds < kSubBuckets) {
+		return int(microseconds);
+	}
+	const auto exponent = int(std::bit_width(microseconds)) - 1;
+	const auto shift = std::min(exponent - kSubBucketBits, kMaxShift);
+	const auto mantissa = std::min(
+		microseconds >> shift,
+		std::uint64_t(2 * kSubBuckets - 1));
+	return (shift + 1) * kSubBuckets + int(mantissa - kSubBuckets);
+}
+
+std::uint64_t ToolMetrics::BucketUpperBound(int index) {
+	if (index < kSubBuckets) {
+		return std::uint64_t(index);
+	}
+	const auto shift = index / kSubBuckets - 1;
+	const auto mantissa = std::uint64_t(kSubBuckets + index % kSubBuckets);
+	return ((mantissa + 1) << shift) - 1;
+}
+
+ToolMetrics::Entry &ToolMetrics::entry(const QString &toolName) {
+	const auto i = _indices.constFind(toolName);
+	return _entries[(i != _indices.cend()) ? *i : (_names.size() - 1)];
+}
+
+void ToolMetrics::record(
+		const QString &toolName,
+		qint64 microseconds,
+		bool failed) {
+	const auto value = std::uint64_t(std::max(microseconds, qint64(0)));
+	auto &e = entry(toolName);
+	e.calls.fetch_add(1, std::memory_order_relaxed);
+	if (failed) {
+		e.errors.fetch_add(1, std::memory_order_relaxed);
+	}
+	e.totalMicroseconds.fetch_add(value, std::memory_order_relaxed);
+	e.buckets[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+
+	auto max = e.maxMicroseconds.load(std::memory_order_relaxed);
+	while (max < value
+		&& !e.maxMicroseconds.compare_exchange_weak(
+			max,
+			value,
+			std::memory_order_relaxed)) {
+	}
+}
+
+void ToolMetrics::recordBytes(const QString &toolName, qint64 bytes) {
+	if (bytes > 0) {
+		entry(toolName).bytes.fetch_add(
+			std::uint64_t(bytes),
+			std::memory_order_relaxed);
+	}
+}
+
+ToolMetrics::Summary ToolMetrics::summarize(const Entry &entry) const {
+	auto result = Summary();
+	result.calls = entry.calls.load(std::memory_order_relaxed);
+	result.errors = entry.errors.load(std::memory_order_relaxed);
+	result.bytes = entry.bytes.load(std::memory_order_relaxed);
+	result.totalMicroseconds = entry.totalMicroseconds.load(
+		std::memory_order_relaxed);
+	result.maxMicroseconds = entry.maxMicroseconds.load(
+		std::memory_order_relaxed);
+	if (!result.calls) {
+		return result;
+	}
+
+	// Buckets are read one by one while calls may still be recorded,
+	// so quantiles are taken against the bucket total, not calls.
+	auto counts = std::array<std::uint64_t, kBucketCount>();
+	auto total = std::uint64_t();
+	for (auto i = 0; i != kBucketCount; ++i) {
+		counts[i] = entry.buckets[i].load(std::memory_order_relaxed);
+		total += counts[i];
+	}
+	const auto quantile = [&](double q) {
+		const auto rank = std::max(
+			std::uint64_t(1),
+			std::uint64_t(q * double(total) + 0.5));
+		auto seen = std::uint64_t();
+		for (auto i = 0; i != kBucketCount; ++i) {
+			seen += counts[i];
+			if (seen >= rank) {
+				return std::min(BucketUpperBound(i), result.maxMicroseconds);
+			}
+		}
+		return result.maxMicroseconds;
+	};
+	result.p50 = quantile(0.50);
+	result.p95 = quantile(0.95);
+	result.p99 = quantile(0.99);
+	return result;
+}
+
+QJsonObject ToolMetrics::snapshot(const QString &toolName, int limit) const {
+	struct Row {
+		int index = 0;
+		Summary summary;
+	};
+	auto rows = std::vector<Row>();
+	for (auto i = 0; i != _names.size(); ++i) {
+		if (!toolName.isEmpty() && _names[i] != toolName) {
+			continue;
+		}
+		const auto summary = summarize(_entries[i]);
+		if (summary.calls) {
+			rows.push_back({ i, summary });
+		}
+	}
+	std::sort(rows.begin(), rows.end(), [](const Row &a, const Row &b) {
+		return a.summary.totalMicroseconds > b.summary.totalMicroseconds;
+	});
+	if (limit > 0 && rows.size() > std::size_t(limit)) {
+		rows.resize(limit);
+	}
+
+	auto tools = QJsonArray();
+	auto calls = std::uint64_t();
+	auto errors = std::uint64_t();
+	for (const auto &[index, summary] : rows) {
+		calls += summary.calls;
+		errors += summary.errors;
+		const auto toMs = [](std::uint64_t microseconds) {
+			return double(microseconds) / 1000.;
+		};
+		tools.append(QJsonObject{
+			{"tool", _names[index]},
+			{"calls", qint64(summary.calls)},
+			{"errors", qint64(summary.errors)},
+			{"error_rate", double(summary.errors) / double(summary.calls)},
+			{"bytes_out", qint64(summary.bytes)},
+			{"total_ms", toMs(summary.totalMicroseconds)},
+			{"mean_ms", toMs(summary.totalMicroseconds) / summary.calls},
+			{"p50_ms", toMs(summary.p50)},
+			{"p95_ms", toMs(summary.p95)},
+			{"p99_ms", toMs(summary.p99)},
+			{"max_ms", toMs(summary.maxMicroseconds)},
+		});
+	}
+	return QJsonObject{
+		{"uptime_seconds", uptimeSeconds()},
+		{"total_calls", qint64(calls)},
+		{"total_errors", qint64(errors)},
+		{"tools", tools},
+	};
+}
+
+QByteArray ToolMetrics::prometheus() const {
+	auto calls = QByteArray(
+		"# HELP mcp_tool_calls_total MCP tool calls.\n"
+		"# TYPE mcp_tool_calls_total counter\n");
+	auto errors = QByteArray(
+		"# HELP mcp_tool_errors_total MCP tool calls that returned an error.\n"
+		"# TYPE mcp_tool_errors_total counter\n");
+	auto bytes = QByteArray(
+		"# HELP mcp_tool_response_bytes_total Serialized MCP tool result bytes.\n"
+		"# TYPE mcp_tool_response_bytes_total counter\n");
+	auto latency = QByteArray(
+		"# HELP mcp_tool_latency_seconds MCP tool call latency.\n"
+		"# TYPE mcp_tool_latency_seconds summary\n");
+	for (auto i = 0; i != _names.size(); ++i) {
+		const auto summary = summarize(_entries[i]);
+		if (!summary.calls) {
+			continue;
+		}
+		const auto label = "{tool=\"" + PrometheusLabel(_names[i]) + '"';
+		calls += "mcp_tool_calls_total" + label + "} "
+			+ QByteArray::number(qulonglong(summary.calls)) + '\n';
+		errors += "mcp_tool_errors_total" + label + "} "
+			+ QByteArray::number(qulonglong(summary.errors)) + '\n';
+		bytes += "mcp_tool_response_bytes_total" + label + "} "
+			+ QByteArray::number(qulonglong(summary.bytes)) + '\n';
+		const auto quantile = [&](const char *q, std::uint64_t value) {
+			latency += "mcp_tool_latency_seconds" + label
+				+ ",quantile=\"" + q + "\"} " + Seconds(value) + '\n';
+		};
+		quantile("0.5", summary.p50);
+		quantile("0.95", summary.p95);
+		quantile("0.99", summary.p99);
+		latency += "mcp_tool_latency_seconds_sum" + label + "} "
+			+ Seconds(summary.totalMicroseconds) + '\n';
+		latency += "mcp_tool_latency_seconds_count" + label + "} "
+			+ QByteArray::number(qulonglong(summary.calls)) + '\n';
+	}
+	return "# HELP mcp_uptime_seconds Time since the MCP server started.\n"
+		"# TYPE mcp_uptime_seconds gauge\n"
+		"mcp_uptime_seconds " + QByteArray::number(uptimeSeconds()) + '\n'
+		+ calls
+		+ errors
+		+ bytes
+		+ latency;
+}
+
+qint64 ToolMetrics::uptimeSeconds() const {
+	return (QDateTime::currentMSecsSinceEpoch() - _startedAt) / 1000;
+}
+
+} // namespace MCP
@@ -0,0 +1,82 @@
+// MCP Tool Metrics - Per-tool counters and latency histograms
+//
+// This file is part of Telegram Desktop MCP integration.
+// Every tool call updates relaxed atomics only, so recording is safe
+// from the main thread and the worker pool without any locking.
+
+#pragma once
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QJsonObject>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace MCP {
+
+class ToolMetrics {
+public:
+	// The set of tools is fixed at construction, names outside of it are
+	// accounted under a shared "unknown" entry.
+	explicit ToolMetrics(const QStringList &toolNames);
+
+	void record(const QString &toolName, qint64 microseconds, bool failed);
+	void recordBytes(const QString &toolName, qint64 bytes);
+
+	// Tools with at least one call, slowest total time first. An empty
+	// name reports every tool, limit <= 0 reports all of them.
+	[[nodiscard]] QJsonObject snapshot(
+		const QString &toolName = QString(),
+		int limit = 0) const;
+
+	// Prometheus text exposition format, version 0.0.4.
+	[[nodiscard]] QByteArray prometheus() const;
+
+	[[nodiscard]] qint64 uptimeSeconds() const;
+
+private:
+	// Log-linear buckets in microseconds, HDR-style: 8 sub-buckets per
+	// power of two keep the relative error of quantiles below 12.5%.
+	static constexpr auto kSubBucketBits = 3;
+	static constexpr auto kSubBuckets = 1 << kSubBucketBits;
+	static constexpr auto kMaxShift = 32;
+	static constexpr auto kBucketCount = (kMaxShift + 2) * kSubBuckets;
+
+	struct Entry {
+		std::atomic<std::uint64_t> calls = 0;
+		std::atomic<std::uint64_t> errors = 0;
+		std::atomic<std::uint64_t> bytes = 0;
+		std::atomic<std::uint64_t> totalMicroseconds = 0;
+		std::atomic<std::uint64_t> maxMicroseconds = 0;
+		std::array<std::atomic<std::uint64_t>, kBucketCount> buckets = {};
+	};
+
+	struct Summary {
+		std::uint64_t calls = 0;
+		std::uint64_t errors = 0;
+		std::uint64_t bytes = 0;
+		std::uint64_t totalMicroseconds = 0;
+		std::uint64_t maxMicroseconds = 0;
+		std::uint64_t p50 = 0;
+		std::uint64_t p95 = 0;
+		std::uint64_t p99 = 0;
+	};
+
+	[[nodiscard]] static int BucketIndex(std::uint64_t microseconds);
+	[[nodiscard]] static std::uint64_t BucketUpperBound(int index);
+
+	[[nodiscard]] Entry &entry(const QString &toolName);
+	[[nodiscard]] Summary summarize(const Entry &entry) const;
+
+	QStringList _names; // Last one is the "unknown" entry.
+	QHash<QString, int> _indices; // Never modified after construction.
+	std::unique_ptr<Entry[]> _entries;
+	qint64 _startedAt = 0;
+};
+
+} // namespace MCP
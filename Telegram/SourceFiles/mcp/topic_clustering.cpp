@@ -0,0 +1,230 @@
+// MCP Topic Clustering - Mini-batch k-means over message embeddings
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "topic_clustering.h"
+
+#include "mcp_helpers.h"
+#include "vector_kernels.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+namespace MCP {
+namespace {
+
+constexpr auto kMinChunk = 512; // Vectors per pool task.
+constexpr auto kSeedingSample = 4096;
+constexpr auto kBatchSize = 1024;
+constexpr auto kMinIterations = 10;
+constexpr auto kMaxIterations = 100;
+constexpr auto kPassesOverData = 3;
+constexpr auto kConvergedShift = 1e-5f; // 1 - cosine to the old centroid
+constexpr auto kMaxTopics = 256;
+
+void Normalize(float *vector, int dimensions) {
+	const auto norm = DotProduct(vector, vector, dimensions);
+	if (norm > 0.f) {
+		const auto scale = 1.f / std::sqrt(norm);
+		for (auto i = 0; i != dimensions; ++i) {
+			vector[i] *= scale;
+		}
+	}
+}
+
+void AssignPointers(
+		const TopicCentroids &centroids,
+		const float *const *vectors,
+		int count,
+		TopicAssignment *results) {
+	auto pointers = std::vector<const float*>(centroids.size());
+	for (auto i = 0; i != centroids.size(); ++i) {
+		pointers[i] = centroids.centroid(i);
+	}
+	ParallelFor(count, kMinChunk, [&](int begin, int end) {
+		auto scores = std::array<float, kMaxTopics>();
+		for (auto i = begin; i != end; ++i) {
+			DotProducts(
+				vectors[i],
+				pointers.data(),
+				int(pointers.size()),
+				centroids.dimensions,
+				scores.data());
+			const auto best = std::max_element(
+				scores.begin(),
+				scores.begin() + pointers.size());
+			results[i] = TopicAssignment{
+				int(best - scores.begin()),
+				*best,
+			};
+		}
+	});
+}
+
+// k-means++ on a sample, with 1 - cosine as the distance.
+[[nodiscard]] TopicCentroids Seed(
+		const float *vectors,
+		int count,
+		int dimensions,
+		int topics,
+		std::mt19937 &random) {
+	auto sample = std::vector<int>(count);
+	std::iota(sample.begin(), sample.end(), 0);
+	if (count > kSeedingSample) {
+		std::shuffle(sample.begin(), sample.end(), random);
+		sample.resize(kSeedingSample);
+	}
+	const auto vector = [&](int index) {
+		return vectors + size_t(sample[index]) * dimensions;
+	};
+
+	auto result = TopicCentroids();
+	result.dimensions = dimensions;
+	result.values.reserve(size_t(topics) * dimensions);
+	const auto add = [&](int index) {
+		const auto from = vector(index);
+		result.values.insert(result.values.end(), from, from + dimensions);
+		result.counts.push_back(0);
+	};
+	const auto size = int(sample.size());
+	add(std::uniform_int_distribution<int>(0, size - 1)(random));
+
+	auto distances = std::vector<float>(size);
+	for (auto i = 0; i != size; ++i) {
+		distances[i] = std::max(
+			1.f - DotProduct(vector(i), result.centroid(0), dimensions),
+			0.f);
+	}
+	while (result.size() < topics) {
+		const auto total = std::accumulate(
+			distances.begin(),
+			distances.end(),
+			0.);
+		auto chosen = 0;
+		if (total > 0.) {
+			auto left = std::uniform_real_distribution<double>(0., total)(random);
+			while (chosen + 1 < size && (left -= distances[chosen]) > 0.) {
+				++chosen;
+			}
+		} else {
+			// Only duplicates left, any of them will do.
+			chosen = std::uniform_int_distribution<int>(0, size - 1)(random);
+		}
+		add(chosen);
+		const auto centroid = result.centroid(result.size() - 1);
+		for (auto i = 0; i != size; ++i) {
+			distances[i] = std::min(
+				distances[i],
+				std::max(1.f - DotProduct(vector(i), centroid, dimensions), 0.f));
+		}
+	}
+	return result;
+}
+
+} // namespace
+
+TopicCentroids TrainTopics(
+		const float *vectors,
+		int count,
+		int dimensions,
+		int topics,
+		quint32 seed) {
+	topics = std::min({ topics, count, kMaxTopics });
+	if (topics <= 0 || dimensions <= 0) {
+		return {};
+	}
+	auto random = std::mt19937(seed);
+	auto result = Seed(vectors, count, dimensions, topics, random);
+
+	const auto batchSize = std::min(kBatchSize, count);
+	const auto iterations = std::clamp(
+		kPassesOverData * count / batchSize,
+		kMinIterations,
+		kMaxIterations);
+	auto pick = std::uniform_int_distribution<int>(0, count - 1);
+	auto batch = std::vector<const float*>(batchSize);
+	auto assignments = std::vector<TopicAssignment>(batchSize);
+	auto previous = std::vector<float>();
+	for (auto iteration = 0; iteration != iterations; ++iteration) {
+		for (auto &vector : batch) {
+			vector = vectors + size_t(pick(random)) * dimensions;
+		}
+		AssignPointers(result, batch.data(), batchSize, assignments.data());
+
+		// The per-centroid step 1 / count makes every centroid the running
+		// mean of the samples it got, later batches move it less.
+		previous = result.values;
+		for (auto i = 0; i != batchSize; ++i) {
+			const auto topic = assignments[i].topic;
+			const auto rate = 1.f / float(++result.counts[topic]);
+			auto centroid = result.values.data() + size_t(topic) * dimensions;
+			for (auto j = 0; j != dimensions; ++j) {
+				centroid[j] += rate * (batch[i][j] - centroid[j]);
+			}
+		}
+		auto converged = true;
+		for (auto topic = 0; topic != result.size(); ++topic) {
+			const auto offset = size_t(topic) * dimensions;
+			Normalize(result.values.data() + offset, dimensions);
+			const auto similarity = DotProduct(
+				result.values.data() + offset,
+				previous.data() + offset,
+				dimensions);
+			converged = converged && (1.f - similarity < kConvergedShift);
+		}
+		if (converged) {
+			break;
+		}
+	}
+	return result;
+}
+
+void AssignTopics(
+		const TopicCentroids &centroids,
+		const float *vectors,
+		int count,
+		TopicAssignment *results) {
+	if (centroids.empty()) {
+		std::fill(results, results + count, TopicAssignment());
+		return;
+	}
+	auto pointers = std::vector<const float*>(count);
+	for (auto i = 0; i != count; ++i) {
+		pointers[i] = vectors + size_t(i) * centroids.dimensions;
+	}
+	AssignPointers(centroids, pointers.data(), count, results);
+}
+
+void MergeIntoTopics(
+		TopicCentroids &centroids,
+		const float *vectors,
+		int count,
+		const TopicAssignment *assignments) {
+	const auto dimensions = centroids.dimensions;
+	auto touched = std::vector<bool>(centroids.size());
+	for (auto i = 0; i != count; ++i) {
+		const auto topic = assignments[i].topic;
+		if (topic < 0 || topic >= centroids.size()) {
+			continue;
+		}
+		const auto rate = 1.f / float(++centroids.counts[topic]);
+		const auto vector = vectors + size_t(i) * dimensions;
+		auto centroid = centroids.values.data() + size_t(topic) * dimensions;
+		for (auto j = 0; j != dimensions; ++j) {
+			centroid[j] += rate * (vector[j] - centroid[j]);
+		}
+		touched[topic] = true;
+	}
+	for (auto topic = 0; topic != centroids.size(); ++topic) {
+		if (touched[topic]) {
+			Normalize(
+				centroids.values.data() + size_t(topic) * dimensions,
+				dimensions);
+		}
+	}
+}
+
+} // namespace MCP
@@ -0,0 +1,58 @@
+// MCP Topic Clustering - Mini-batch k-means over message embeddings
+//
+// This file is part of Telegram Desktop MCP integration.
+// Embeddings are normalized, so topics are compared by dot product and
+// centroids stay normalized (spherical k-means). Training follows the
+// mini-batch k-means of Sculley (2010) on a sample of the vectors, new
+// vectors are merged into a trained model one by one afterwards. Every
+// assignment pass is spread over the global thread pool.
+
+#pragma once
+
+#include <QtCore/QtGlobal>
+
+#include <vector>
+
+namespace MCP {
+
+struct TopicAssignment {
+	int topic = -1;
+	float similarity = 0.f;
+};
+
+struct TopicCentroids {
+	int dimensions = 0;
+	std::vector<float> values; // dimensions per topic.
+	std::vector<qint64> counts; // Vectors behind each centroid.
+
+	[[nodiscard]] int size() const { return int(counts.size()); }
+	[[nodiscard]] bool empty() const { return counts.empty(); }
+	[[nodiscard]] const float *centroid(int topic) const {
+		return values.data() + size_t(topic) * dimensions;
+	}
+};
+
+// vectors holds count * dimensions values. The result has at most
+// min(topics, count) centroids, counts are the mini-batch ones.
+[[nodiscard]] TopicCentroids TrainTopics(
+	const float *vectors,
+	int count,
+	int dimensions,
+	int topics,
+	quint32 seed);
+
+void AssignTopics(
+	const TopicCentroids &centroids,
+	const float *vectors,
+	int count,
+	TopicAssignment *results);
+
+// Streaming update: each vector moves its centroid by 1 / count of it,
+// so a centroid stays the mean of everything merged into it.
+void MergeIntoTopics(
+	TopicCentroids &centroids,
+	const float *vectors,
+	int count,
+	const TopicAssignment *assignments);
+
+} // namespace MCP
@@ -0,0 +1,467 @@
+// MCP Translation Pipeline - Batched, cached message translation
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "translation_pipeline.h"
+
+#include "database_pool.h"
+#include "mcp_helpers.h"
+#include "apiwrap.h"
+#include "data/data_peer.h"
+#include "data/data_session.h"
+#include "history/history.h"
+#include "history/history_item.h"
+#include "history/history_item_components.h"
+#include "main/main_session.h"
+#include "spellcheck/spellcheck_types.h"
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDateTime>
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+
+namespace MCP {
+namespace {
+
+constexpr auto kBatchDelay = 500; // ms, lets a busy chat fill a batch.
+constexpr auto kRequestCountLimit = 20;
+constexpr auto kRequestLengthLimit = 24 * 1024;
+
+constexpr auto kTranslationTable = R"(
+	CREATE TABLE IF NOT EXISTS translation_cache (
+		id INTEGER PRIMARY KEY AUTOINCREMENT,
+		chat_id INTEGER NOT NULL,
+		message_id INTEGER NOT NULL,
+		content_hash TEXT NOT NULL,
+		source_language TEXT,
+		target_language TEXT NOT NULL,
+		original_text TEXT,
+		translated_text TEXT NOT NULL,
+		created_at INTEGER DEFAULT (strftime('%s', 'now')),
+		UNIQUE(chat_id, message_id, target_language)
+	)
+)";
+constexpr auto kTranslationHashIndex = R"(
+	CREATE INDEX IF NOT EXISTS idx_trans_hash
+	ON translation_cache(content_hash, target_language)
+)";
+constexpr auto kAutoTranslateTable = R"(
+	CREATE TABLE IF NOT EXISTS auto_translate_config (
+		chat_id INTEGER PRIMARY KEY,
+		target_lang TEXT NOT NULL,
+		enabled INTEGER DEFAULT 1,
+		created_at INTEGER DEFAULT (strftime('%s', 'now'))
+	)
+)";
+
+constexpr auto kInsertTranslation = R"(
+	INSERT OR REPLACE INTO translation_cache (
+		chat_id, message_id, content_hash, target_language,
+		original_text, translated_text, created_at
+	) VALUES (
+		:chat_id, :message_id, :content_hash, :target_language,
+		:original_text, :translated_text, :created_at
+	)
+)";
+
+[[nodiscard]] QByteArray ContentHash(const QString &text) {
+	return QCryptographicHash::hash(
+		text.toUtf8(),
+		QCryptographicHash::Sha1).toHex();
+}
+
+void StoreTranslation(
+		QSqlDatabase &db,
+		qint64 chatId,
+		qint64 messageId,
+		const QByteArray &hash,
+		const QString &to,
+		const QString &text,
+		const QString &translated) {
+	auto query = PreparedQuery(db, kInsertTranslation);
+	query->bindValue(":chat_id", chatId);
+	query->bindValue(":message_id", messageId);
+	query->bindValue(":content_hash", QString::fromLatin1(hash));
+	query->bindValue(":target_language", to);
+	query->bindValue(":original_text", text);
+	query->bindValue(":translated_text", translated);
+	query->bindValue(":created_at", QDateTime::currentSecsSinceEpoch());
+	if (!query->exec()) {
+		qWarning() << "MCP: Failed to store translation:" << query->lastError().text();
+	}
+}
+
+} // namespace
+
+TranslationPipeline::TranslationPipeline(QObject *parent)
+: QObject(parent) {
+	_flushTimer.setSingleShot(true);
+	connect(&_flushTimer, &QTimer::timeout, this, [=] {
+		flush();
+	});
+}
+
+TranslationPipeline::~TranslationPipeline() {
+	stop();
+}
+
+bool TranslationPipeline::start(
+		not_null<Main::Session*> session,
+		not_null<DatabasePool*> pool) {
+	if (_isRunning || !pool->isOpen()) {
+		return false;
+	}
+	_session = session;
+	_pool = pool;
+	if (!initializeTables()) {
+		_session = nullptr;
+		_pool = nullptr;
+		return false;
+	}
+	loadAutoTranslate();
+
+	_session->data().newItemAdded(
+	) | rpl::start_with_next([=](not_null<HistoryItem*> item) {
+		const auto chatId = qint64(item->history()->peer->id.value);
+		const auto to = _autoTranslate.value(chatId);
+		if (to.isEmpty() || item->out() || !item->isRegular()) {
+			return;
+		}
+		const auto &text = item->originalText().text;
+		if (!text.trimmed().isEmpty()) {
+			translate({ { chatId, qint64(item->id.bare), text } }, to, nullptr);
+		}
+	}, _sessionLifetime);
+
+	_isRunning = true;
+	return true;
+}
+
+void TranslationPipeline::stop() {
+	if (!_isRunning) {
+		return;
+	}
+	_isRunning = false;
+	_sessionLifetime.destroy();
+	_flushTimer.stop();
+	for (const auto requestId : base::take(_requests)) {
+		_session->api().request(requestId).cancel();
+	}
+
+	// Lookups still queued on the writer post back to this object, the
+	// ones posted before it is destroyed are dropped with it.
+	_pool->writeAndWait([](QSqlDatabase &) {});
+
+	_queues.clear();
+	_jobs.clear();
+	_autoTranslate.clear();
+	_session = nullptr;
+	_pool = nullptr;
+}
+
+bool TranslationPipeline::initializeTables() {
+	auto result = false;
+	_pool->writeAndWait([&](QSqlDatabase &db) {
+		QSqlQuery query(db);
+		result = query.exec(kTranslationTable)
+			&& query.exec(kTranslationHashIndex)
+			&& query.exec(kAutoTranslateTable);
+		if (!result) {
+			qWarning() << "MCP: Failed to create translation tables:" << query.lastError().text();
+		}
+	});
+	return result;
+}
+
+void TranslationPipeline::loadAutoTranslate() {
+	auto query = PreparedQuery(_pool->reader(), R"(
+		SELECT chat_id, target_lang FROM auto_translate_config
+		WHERE enabled = 1
+	)");
+	if (!query->exec()) {
+		qWarning() << "MCP: Failed to load auto-translate chats:" << query->lastError().text();
+		return;
+	}
+	while (query->next()) {
+		_autoTranslate.insert(
+			query->value(0).toLongLong(),
+			query->value(1).toString());
+	}
+}
+
+TranslationBatch TranslationPipeline::translate(
+		const std::vector<TranslationRequest> &requests,
+		const QString &to,
+		Done done) {
+	auto result = TranslationBatch();
+	if (!_isRunning || to.isEmpty()) {
+		return result;
+	}
+	result.id = done ? ++_jobCounter : 0;
+
+	auto lookups = std::vector<Lookup>();
+	auto &owner = _session->data();
+	for (const auto &request : requests) {
+		// Items tdesktop translated for display already carry the text.
+		const auto item = owner.message(
+			PeerId(request.chatId),
+			MsgId(request.messageId));
+		const auto translation = item ? item->translation() : nullptr;
+		if (translation
+			&& !translation->text.empty()
+			&& translation->to.twoLetterCode() == to) {
+			result.ready.push_back({
+				request.chatId,
+				request.messageId,
+				translation->text.text,
+				QString("history"),
+			});
+		} else {
+			lookups.push_back({
+				{ result.id, request.chatId, request.messageId },
+				ContentHash(request.text),
+				request.text,
+			});
+		}
+	}
+	result.pending = int(lookups.size());
+	if (lookups.empty()) {
+		return result;
+	}
+	if (result.id) {
+		_jobs.emplace(result.id, Job{ {}, result.pending, std::move(done) });
+	}
+	lookUp(to, std::move(lookups));
+	return result;
+}
+
+void TranslationPipeline::lookUp(
+		const QString &to,
+		std::vector<Lookup> lookups) {
+	// On the writer thread: it sees every translation stored before, and
+	// rows for messages whose text was translated elsewhere go in there.
+	_pool->write([=, lookups = std::move(lookups)](
+			QSqlDatabase &db) mutable {
+		auto found = QHash<QByteArray, QString>();
+		for (auto &lookup : lookups) {
+			const auto known = found.constFind(lookup.hash);
+			if (known != found.constEnd()) {
+				lookup.translated = *known;
+				continue;
+			}
+			auto query = PreparedQuery(db, R"(
+				SELECT translated_text FROM translation_cache
+				WHERE content_hash = :content_hash
+					AND target_language = :target_language
+				LIMIT 1
+			)");
+			query->bindValue(":content_hash", QString::fromLatin1(lookup.hash));
+			query->bindValue(":target_language", to);
+			if (query->exec() && query->next()) {
+				lookup.translated = query->value(0).toString();
+				found.insert(lookup.hash, lookup.translated);
+			}
+		}
+		for (const auto &lookup : lookups) {
+			if (!lookup.translated.isEmpty()) {
+				StoreTranslation(
+					db,
+					lookup.target.chatId,
+					lookup.target.messageId,
+					lookup.hash,
+					to,
+					lookup.text,
+					lookup.translated);
+			}
+		}
+		QMetaObject::invokeMethod(this, [=] {
+			lookedUp(to, lookups);
+		}, Qt::QueuedConnection);
+	});
+}
+
+void TranslationPipeline::lookedUp(
+		const QString &to,
+		const std::vector<Lookup> &lookups) {
+	if (!_isRunning) {
+		return;
+	}
+	for (const auto &lookup : lookups) {
+		if (!lookup.translated.isEmpty()) {
+			deliver(lookup.target, lookup.translated, QString("cache"));
+		} else {
+			enqueue(to, lookup);
+		}
+	}
+}
+
+void TranslationPipeline::enqueue(const QString &to, const Lookup &lookup) {
+	auto &queue = _queues[to];
+	auto &pending = queue.texts[lookup.hash];
+	if (pending.targets.empty()) {
+		pending.text = lookup.text;
+		queue.length += int(lookup.text.size());
+	}
+	pending.targets.push_back(lookup.target);
+
+	if (int(queue.texts.size()) >= kRequestCountLimit
+		|| queue.length >= kRequestLengthLimit) {
+		send(to);
+	} else if (!_flushTimer.isActive()) {
+		_flushTimer.start(kBatchDelay);
+	}
+}
+
+void TranslationPipeline::flush() {
+	for (auto &[to, queue] : _queues) {
+		while (!queue.texts.empty()) {
+			send(to);
+		}
+	}
+	_queues.clear();
+}
+
+void TranslationPipeline::send(const QString &to) {
+	auto &queue = _queues[to];
+	auto batch = std::vector<Pending>();
+	auto texts = QVector<MTPTextWithEntities>();
+	auto length = 0;
+	while (!queue.texts.empty()
+		&& int(batch.size()) < kRequestCountLimit
+		&& (batch.empty() || length < kRequestLengthLimit)) {
+		auto pending = std::move(queue.texts.begin()->second);
+		queue.texts.erase(queue.texts.begin());
+		length += int(pending.text.size());
+		texts.push_back(MTP_textWithEntities(
+			MTP_string(pending.text),
+			MTP_vector<MTPMessageEntity>()));
+		batch.push_back(std::move(pending));
+	}
+	queue.length = std::max(queue.length - length, 0);
+	if (batch.empty()) {
+		return;
+	}
+
+	using Flag = MTPmessages_TranslateText::Flag;
+	const auto requestId = _session->api().request(MTPmessages_TranslateText(
+		MTP_flags(Flag::f_text),
+		MTP_inputPeerEmpty(),
+		MTPVector<MTPint>(),
+		MTP_vector<MTPTextWithEntities>(std::move(texts)),
+		MTP_string(to)
+	)).done([=](const MTPmessages_TranslatedText &result, mtpRequestId id) {
+		_requests.erase(id);
+		auto translations = std::vector<QString>();
+		for (const auto &text : result.data().vresult().v) {
+			translations.push_back(qs(text.data().vtext()));
+		}
+		received(to, batch, translations);
+	}).fail([=](const MTP::Error &error, mtpRequestId id) {
+		_requests.erase(id);
+		qWarning() << "MCP: Translation failed:" << error.type();
+		received(to, batch, {});
+	}).send();
+	_requests.insert(requestId);
+}
+
+void TranslationPipeline::received(
+		const QString &to,
+		const std::vector<Pending> &batch,
+		const std::vector<QString> &translations) {
+	auto stored = std::vector<std::pair<Pending, QString>>();
+	for (auto i = 0; i != int(batch.size()); ++i) {
+		const auto translated = (i < int(translations.size()))
+			? translations[i]
+			: QString();
+		if (!translated.isEmpty()) {
+			stored.emplace_back(batch[i], translated);
+		}
+		for (const auto &target : batch[i].targets) {
+			deliver(target, translated, QString("cloud"));
+		}
+	}
+	if (stored.empty()) {
+		return;
+	}
+	_pool->write([=](QSqlDatabase &db) {
+		db.transaction();
+		for (const auto &[pending, translated] : stored) {
+			const auto hash = ContentHash(pending.text);
+			for (const auto &target : pending.targets) {
+				StoreTranslation(
+					db,
+					target.chatId,
+					target.messageId,
+					hash,
+					to,
+					pending.text,
+					translated);
+			}
+		}
+		db.commit();
+	});
+}
+
+void TranslationPipeline::deliver(
+		const Target &target,
+		const QString &translated,
+		const QString &source) {
+	const auto i = _jobs.find(target.job);
+	if (i == end(_jobs)) {
+		return;
+	}
+	auto &job = i->second;
+	job.results.push_back({
+		target.chatId,
+		target.messageId,
+		translated,
+		source,
+	});
+	if (--job.waiting > 0) {
+		return;
+	}
+	auto finished = std::move(job);
+	_jobs.erase(i);
+	if (finished.done) {
+		finished.done(target.job, std::move(finished.results));
+	}
+}
+
+bool TranslationPipeline::setAutoTranslate(
+		qint64 chatId,
+		const QString &to,
+		bool enabled) {
+	if (!_isRunning || (enabled && to.isEmpty())) {
+		return false;
+	}
+	if (enabled) {
+		_autoTranslate.insert(chatId, to);
+	} else {
+		_autoTranslate.remove(chatId);
+	}
+	auto result = false;
+	_pool->writeAndWait([&](QSqlDatabase &db) {
+		QSqlQuery query(db);
+		query.prepare(R"(
+			INSERT INTO auto_translate_config (chat_id, target_lang, enabled)
+			VALUES (:chat_id, :target_lang, :enabled)
+			ON CONFLICT(chat_id) DO UPDATE SET
+				target_lang = excluded.target_lang,
+				enabled = excluded.enabled
+		)");
+		query.bindValue(":chat_id", chatId);
+		query.bindValue(":target_lang", to);
+		query.bindValue(":enabled", enabled ? 1 : 0);
+		result = query.exec();
+		if (!result) {
+			qWarning() << "MCP: Failed to save auto-translate:" << query.lastError().text();
+		}
+	});
+	return result;
+}
+
+QString TranslationPipeline::autoTranslateTarget(qint64 chatId) const {
+	return _autoTranslate.value(chatId);
+}
+
+} // namespace MCP
@@ -0,0 +1,133 @@
+// MCP Translation Pipeline - Batched, cached message translation
+//
+// This file is part of Telegram Desktop MCP integration.
+// Messages tdesktop already translated are answered from the item, the
+// rest is looked up in translation_cache by a hash of the text on the
+// database writer thread. Texts that are still missing are queued per
+// target language, identical texts once, and sent to
+// messages.translateText in batches of up to 20.
+
+#pragma once
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtCore/QTimer>
+
+#include <functional>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace Main {
+class Session;
+} // namespace Main
+
+namespace MCP {
+
+class DatabasePool;
+
+struct TranslationRequest {
+	qint64 chatId = 0;
+	qint64 messageId = 0;
+	QString text;
+};
+
+struct TranslationResult {
+	qint64 chatId = 0;
+	qint64 messageId = 0;
+	QString translated; // Empty if the translation failed.
+	QString source; // "history", "cache" or "cloud".
+};
+
+struct TranslationBatch {
+	std::vector<TranslationResult> ready;
+	int pending = 0; // Results that will come to done.
+	quint64 id = 0;
+};
+
+class TranslationPipeline : public QObject {
+	Q_OBJECT
+
+public:
+	using Done = std::function<void(
+		quint64 id,
+		std::vector<TranslationResult> results)>;
+
+	explicit TranslationPipeline(QObject *parent = nullptr);
+	~TranslationPipeline();
+
+	bool start(not_null<Main::Session*> session, not_null<DatabasePool*> pool);
+	void stop();
+	[[nodiscard]] bool isRunning() const { return _isRunning; }
+
+	// done gets every pending result at once on the main thread, it is
+	// not called when the batch has nothing pending.
+	TranslationBatch translate(
+		const std::vector<TranslationRequest> &requests,
+		const QString &to,
+		Done done);
+
+	// New messages of enabled chats are translated into the cache.
+	bool setAutoTranslate(qint64 chatId, const QString &to, bool enabled);
+	[[nodiscard]] QString autoTranslateTarget(qint64 chatId) const;
+
+private:
+	struct Target {
+		quint64 job = 0; // 0 for auto-translated messages.
+		qint64 chatId = 0;
+		qint64 messageId = 0;
+	};
+	struct Lookup {
+		Target target;
+		QByteArray hash;
+		QString text;
+		QString translated; // Filled from translation_cache.
+	};
+	struct Pending {
+		QString text;
+		std::vector<Target> targets;
+	};
+	struct Queue {
+		std::map<QByteArray, Pending> texts;
+		int length = 0;
+	};
+	struct Job {
+		std::vector<TranslationResult> results;
+		int waiting = 0;
+		Done done;
+	};
+
+	bool initializeTables();
+	void loadAutoTranslate();
+	void lookUp(const QString &to, std::vector<Lookup> lookups);
+	void lookedUp(const QString &to, const std::vector<Lookup> &lookups);
+	void enqueue(const QString &to, const Lookup &lookup);
+	void flush();
+	void send(const QString &to);
+	void received(
+		const QString &to,
+		const std::vector<Pending> &batch,
+		const std::vector<QString> &translations);
+	void deliver(
+		const Target &target,
+		const QString &translated,
+		const QString &source);
+
+	Main::Session *_session = nullptr;
+	DatabasePool *_pool = nullptr;
+	bool _isRunning = false;
+
+	QHash<qint64, QString> _autoTranslate; // chat_id -> target language
+	std::map<QString, Queue> _queues; // By target language.
+	std::map<quint64, Job> _jobs;
+	std::set<int> _requests; // messages.translateText in flight.
+	quint64 _jobCounter = 0;
+	QTimer _flushTimer;
+
+	rpl::lifetime _sessionLifetime;
+
+};
+
+} // namespace MCP
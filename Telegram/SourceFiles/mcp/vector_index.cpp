@@ -0,0 +1,565 @@
+// MCP Vector Index - HNSW approximate nearest neighbour search
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "vector_index.h"
+#include "vector_kernels.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QDebug>
+#include <QtCore/QFile>
+#include <QtCore/QSaveFile>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <queue>
+
+namespace MCP {
+namespace {
+
+constexpr auto kFileMagic = quint32(0x4D435056); // "MCPV"
+constexpr auto kFileVersion = quint32(1);
+
+// Usual HNSW parameters: M = 16 links per node, twice that on level 0.
+constexpr auto kMaxLinks = 16;
+constexpr auto kMaxLinks0 = 2 * kMaxLinks;
+constexpr auto kMaxLevel = 16;
+constexpr auto kConstructionEf = 128;
+constexpr auto kSearchEf = 128;
+
+// A chat this small, or this rare among all vectors, is scanned exactly:
+// filtered graph search would visit mostly other chats' nodes.
+constexpr auto kExactChatLimit = 4096;
+constexpr auto kExactChatRatio = 32;
+
+struct FileHeader {
+	quint32 magic = 0;
+	quint32 version = 0;
+	qint32 dimensions = 0;
+	qint32 maxLinks = 0;
+	qint32 nodes = 0;
+	qint32 maxLevel = 0;
+	qint64 entry = 0;
+	qint64 savedAt = 0;
+	qint32 modelBytes = 0;
+	qint32 reserved = 0;
+};
+static_assert(sizeof(FileHeader) == 48);
+
+// Epoch-tagged marks of the calling thread, reused between searches of
+// every index instead of a fresh hash set for each layer walk.
+class VisitedNodes {
+public:
+	void start(size_t nodes) {
+		if (_marks.size() < nodes) {
+			_marks.resize(nodes, 0);
+		}
+		if (!++_epoch) {
+			std::fill(_marks.begin(), _marks.end(), 0);
+			_epoch = 1;
+		}
+	}
+	[[nodiscard]] bool insert(quint32 node) {
+		if (_marks[node] == _epoch) {
+			return false;
+		}
+		_marks[node] = _epoch;
+		return true;
+	}
+
+private:
+	std::vector<quint32> _marks;
+	quint32 _epoch = 0;
+};
+
+thread_local VisitedNodes Visited;
+
+template <typename T>
+bool WriteArray(QSaveFile &file, const T *data, size_t count) {
+	const auto bytes = qint64(count * sizeof(T));
+	return !bytes
+		|| file.write(reinterpret_cast<const char*>(data), bytes) == bytes;
+}
+
+} // namespace
+
+VectorIndex::VectorIndex(const QString &path)
+: _path(path)
+, _levelGenerator(0x4D435056) {
+}
+
+void VectorIndex::setReady(bool ready) {
+	_ready = ready;
+}
+
+void VectorIndex::reset() {
+	_dimensions = 0;
+	_live = 0;
+	_entry = -1;
+	_maxLevel = -1;
+	_nodes.clear();
+	_vectors.clear();
+	_links0.clear();
+	_upperLinks.clear();
+	_byRowId.clear();
+	_byChat.clear();
+}
+
+int VectorIndex::size() const {
+	QReadLocker lock(&_lock);
+	return _live;
+}
+
+const float *VectorIndex::vector(quint32 node) const {
+	return _vectors.data() + size_t(node) * _dimensions;
+}
+
+float VectorIndex::distance(const float *query, quint32 node) const {
+	return 1.f - DotProduct(query, vector(node), _dimensions);
+}
+
+quint32 *VectorIndex::links(quint32 node, int level) {
+	return level
+		? (_upperLinks[node].data() + (level - 1) * (kMaxLinks + 1))
+		: (_links0.data() + size_t(node) * (kMaxLinks0 + 1));
+}
+
+const quint32 *VectorIndex::links(quint32 node, int level) const {
+	return const_cast<VectorIndex*>(this)->links(node, level);
+}
+
+bool VectorIndex::accepts(quint32 node, const Filter &filter) const {
+	const auto &data = _nodes[node];
+	return !data.deleted
+		&& (!filter.chatId || data.chatId == filter.chatId)
+		&& data.rowId != filter.excludeRowId;
+}
+
+std::vector<VectorIndex::Candidate> VectorIndex::searchLayer(
+		const float *query,
+		const std::vector<Candidate> &entries,
+		int ef,
+		int level,
+		const Filter *filter) const {
+	auto &visited = Visited;
+	visited.start(_nodes.size());
+	auto candidates = std::priority_queue<
+		Candidate,
+		std::vector<Candidate>,
+		std::greater<Candidate>>();
+	auto found = std::priority_queue<Candidate>(); // Worst on top.
+	const auto accept = [&](quint32 node) {
+		return !filter || accepts(node, *filter);
+	};
+	auto nodes = std::array<quint32, kMaxLinks0>();
+	auto vectors = std::array<const float*, kMaxLinks0>();
+	auto scores = std::array<float, kMaxLinks0>();
+	const auto bound = [&] {
+		return found.empty()
+			? std::numeric_limits<float>::max()
+			: found.top().distance;
+	};
+
+	for (const auto &entry : entries) {
+		if (visited.insert(entry.node)) {
+			candidates.push(entry);
+			if (accept(entry.node)) {
+				found.push(entry);
+			}
+		}
+	}
+	while (found.size() > size_t(ef)) {
+		found.pop();
+	}
+
+	// Rejected nodes still route the search, only their results are
+	// dropped, so a filter widens the walk instead of cutting it short.
+	while (!candidates.empty()) {
+		const auto current = candidates.top();
+		if (current.distance > bound() && found.size() >= size_t(ef)) {
+			break;
+		}
+		candidates.pop();
+
+		// Unvisited neighbours are scored in one batch, so the vector
+		// loads overlap instead of stalling one by one.
+		const auto list = links(current.node, level);
+		auto count = 0;
+		for (auto i = quint32(1); i <= list[0]; ++i) {
+			if (visited.insert(list[i])) {
+				nodes[count] = list[i];
+				vectors[count++] = vector(list[i]);
+			}
+		}
+		DotProducts(query, vectors.data(), count, _dimensions, scores.data());
+		for (auto i = 0; i != count; ++i) {
+			const auto next = nodes[i];
+			const auto candidate = Candidate{ 1.f - scores[i], next };
+			if (found.size() < size_t(ef) || candidate.distance < bound()) {
+				candidates.push(candidate);
+				if (accept(next)) {
+					found.push(candidate);
+					if (found.size() > size_t(ef)) {
+						found.pop();
+					}
+				}
+			}
+		}
+	}
+
+	auto result = std::vector<Candidate>();
+	result.reserve(found.size());
+	while (!found.empty()) {
+		result.push_back(found.top());
+		found.pop();
+	}
+	std::reverse(result.begin(), result.end());
+	return result;
+}
+
+std::vector<VectorIndex::Candidate> VectorIndex::descend(
+		const float *query) const {
+	const auto entry = quint32(_entry);
+	auto nearest = std::vector<Candidate>{ { distance(query, entry), entry } };
+	for (auto level = _maxLevel; level > 0; --level) {
+		nearest = searchLayer(query, nearest, 1, level, nullptr);
+	}
+	return nearest;
+}
+
+std::vector<quint32> VectorIndex::selectNeighbours(
+		const std::vector<Candidate> &sorted,
+		int maxCount) const {
+	// Keeps a candidate only if it is closer to the new node than to any
+	// neighbour already kept, so links spread out in every direction.
+	auto result = std::vector<quint32>();
+	result.reserve(maxCount);
+	for (const auto &candidate : sorted) {
+		if (int(result.size()) >= maxCount) {
+			break;
+		}
+		const auto point = vector(candidate.node);
+		const auto diverse = std::none_of(
+			result.begin(),
+			result.end(),
+			[&](quint32 kept) {
+				return distance(point, kept) < candidate.distance;
+			});
+		if (diverse) {
+			result.push_back(candidate.node);
+		}
+	}
+	return result;
+}
+
+void VectorIndex::connect(
+		quint32 node,
+		int level,
+		const std::vector<quint32> &to) {
+	const auto maxCount = level ? kMaxLinks : kMaxLinks0;
+
+	auto own = links(node, level);
+	own[0] = quint32(to.size());
+	std::copy(to.begin(), to.end(), own + 1);
+
+	for (const auto neighbour : to) {
+		const auto list = links(neighbour, level);
+		if (list[0] < quint32(maxCount)) {
+			list[++list[0]] = node;
+			continue;
+		}
+		// Full: keep the most diverse of the old links and the new one.
+		const auto point = vector(neighbour);
+		auto sorted = std::vector<Candidate>();
+		sorted.reserve(maxCount + 1);
+		sorted.push_back({ distance(point, node), node });
+		for (auto i = quint32(1); i <= list[0]; ++i) {
+			sorted.push_back({ distance(point, list[i]), list[i] });
+		}
+		std::sort(sorted.begin(), sorted.end());
+		const auto kept = selectNeighbours(sorted, maxCount);
+		list[0] = quint32(kept.size());
+		std::copy(kept.begin(), kept.end(), list + 1);
+	}
+}
+
+void VectorIndex::insert(quint32 node) {
+	const auto level = _nodes[node].level;
+	if (_entry < 0) {
+		_entry = node;
+		_maxLevel = level;
+		return;
+	}
+	const auto query = vector(node);
+	auto nearest = std::vector<Candidate>{
+		{ distance(query, quint32(_entry)), quint32(_entry) },
+	};
+	for (auto current = _maxLevel; current > level; --current) {
+		nearest = searchLayer(query, nearest, 1, current, nullptr);
+	}
+	for (auto current = std::min(level, _maxLevel); current >= 0; --current) {
+		nearest = searchLayer(query, nearest, kConstructionEf, current, nullptr);
+		const auto maxCount = current ? kMaxLinks : kMaxLinks0;
+		connect(node, current, selectNeighbours(nearest, maxCount));
+	}
+	if (level > _maxLevel) {
+		_entry = node;
+		_maxLevel = level;
+	}
+}
+
+void VectorIndex::markDeleted(quint32 node) {
+	auto &data = _nodes[node];
+	if (!data.deleted) {
+		data.deleted = 1;
+		--_live;
+	}
+}
+
+bool VectorIndex::add(
+		qint64 rowId,
+		qint64 chatId,
+		const QVector<float> &vector) {
+	QWriteLocker lock(&_lock);
+	if (!_dimensions) {
+		if (vector.isEmpty()) {
+			return false;
+		}
+		_dimensions = int(vector.size());
+	} else if (vector.size() != _dimensions) {
+		return false;
+	}
+
+	const auto known = _byRowId.constFind(rowId);
+	if (known != _byRowId.cend()) {
+		const auto node = known.value();
+		if (_nodes[node].chatId == chatId
+			&& !std::memcmp(
+				this->vector(node),
+				vector.constData(),
+				_dimensions * sizeof(float))) {
+			return true;
+		}
+		markDeleted(node);
+	}
+
+	const auto node = quint32(_nodes.size());
+	auto uniform = std::uniform_real_distribution<double>(
+		std::numeric_limits<double>::min(),
+		1.);
+	const auto level = std::min(
+		int(-std::log(uniform(_levelGenerator)) / std::log(double(kMaxLinks))),
+		kMaxLevel);
+	_nodes.push_back({ rowId, chatId, level, 0 });
+	_vectors.insert(_vectors.end(), vector.begin(), vector.end());
+	_links0.resize(_links0.size() + kMaxLinks0 + 1, 0);
+	_upperLinks.emplace_back(size_t(level) * (kMaxLinks + 1), 0);
+	insert(node);
+
+	_byRowId.insert(rowId, node);
+	_byChat[chatId].push_back(node);
+	++_live;
+	_dirty = true;
+	return true;
+}
+
+void VectorIndex::remove(qint64 rowId) {
+	QWriteLocker lock(&_lock);
+	const auto i = _byRowId.constFind(rowId);
+	if (i != _byRowId.cend()) {
+		markDeleted(i.value());
+		_byRowId.erase(i);
+		_dirty = true;
+	}
+}
+
+void VectorIndex::removeChat(qint64 chatId) {
+	QWriteLocker lock(&_lock);
+	const auto i = _byChat.constFind(chatId);
+	if (i == _byChat.cend()) {
+		return;
+	}
+	for (const auto node : i.value()) {
+		if (!_nodes[node].deleted) {
+			markDeleted(node);
+			_byRowId.remove(_nodes[node].rowId);
+		}
+	}
+	_byChat.erase(i);
+	_dirty = true;
+}
+
+std::vector<VectorMatch> VectorIndex::search(
+		const QVector<float> &query,
+		int limit,
+		qint64 chatId,
+		qint64 excludeRowId,
+		float minSimilarity) const {
+	QReadLocker lock(&_lock);
+	if (_entry < 0 || limit <= 0 || query.size() != _dimensions) {
+		return {};
+	}
+	const auto filter = Filter{ chatId, excludeRowId };
+	const auto point = query.constData();
+
+	auto nearest = std::vector<Candidate>();
+	const auto chat = chatId ? _byChat.constFind(chatId) : _byChat.cend();
+	if (chatId && chat == _byChat.cend()) {
+		return {};
+	} else if (chatId
+		&& (chat->size() <= size_t(kExactChatLimit)
+			|| chat->size() * kExactChatRatio < _nodes.size())) {
+		nearest.reserve(chat->size());
+		for (const auto node : *chat) {
+			if (accepts(node, filter)) {
+				nearest.push_back({ distance(point, node), node });
+			}
+		}
+		const auto count = std::min(nearest.size(), size_t(limit));
+		std::partial_sort(
+			nearest.begin(),
+			nearest.begin() + count,
+			nearest.end());
+		nearest.resize(count);
+	} else {
+		nearest = searchLayer(
+			point,
+			descend(point),
+			std::max(kSearchEf, limit),
+			0,
+			&filter);
+	}
+
+	auto result = std::vector<VectorMatch>();
+	result.reserve(std::min(nearest.size(), size_t(limit)));
+	for (const auto &candidate : nearest) {
+		const auto similarity = 1.f - candidate.distance;
+		if (int(result.size()) >= limit || similarity < minSimilarity) {
+			break;
+		}
+		result.push_back({ _nodes[candidate.node].rowId, similarity });
+	}
+	return result;
+}
+
+bool VectorIndex::save() {
+	if (!_dirty) {
+		return true;
+	}
+	QReadLocker lock(&_lock);
+
+	const auto model = _model.toUtf8();
+	auto header = FileHeader();
+	header.magic = kFileMagic;
+	header.version = kFileVersion;
+	header.dimensions = _dimensions;
+	header.maxLinks = kMaxLinks;
+	header.nodes = qint32(_nodes.size());
+	header.maxLevel = _maxLevel;
+	header.entry = _entry;
+	header.savedAt = QDateTime::currentSecsSinceEpoch();
+	header.modelBytes = qint32(model.size());
+
+	QSaveFile file(_path);
+	auto written = file.open(QIODevice::WriteOnly)
+		&& WriteArray(file, &header, 1)
+		&& WriteArray(file, model.constData(), model.size())
+		&& WriteArray(file, _nodes.data(), _nodes.size())
+		&& WriteArray(file, _vectors.data(), _vectors.size())
+		&& WriteArray(file, _links0.data(), _links0.size());
+	for (auto i = size_t(0); written && i != _nodes.size(); ++i) {
+		written = WriteArray(file, _upperLinks[i].data(), _upperLinks[i].size());
+	}
+	if (!written || !file.commit()) {
+		qWarning() << "MCP: Failed to save vector index" << _path << file.errorString();
+		return false;
+	}
+	_dirty = false;
+	return true;
+}
+
+qint64 VectorIndex::load(const QString &model) {
+	QWriteLocker lock(&_lock);
+	reset();
+	_model = model;
+	_ready = false;
+
+	QFile file(_path);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return 0;
+	}
+	const auto size = file.size();
+	const auto data = file.map(0, size);
+	if (!data) {
+		qWarning() << "MCP: Failed to map vector index" << _path;
+		return 0;
+	}
+	auto offset = qint64(0);
+	const auto read = [&](auto *to, size_t count) {
+		const auto bytes = qint64(count * sizeof(*to));
+		if (offset + bytes > size) {
+			return false;
+		}
+		std::memcpy(to, data + offset, bytes);
+		offset += bytes;
+		return true;
+	};
+
+	auto header = FileHeader();
+	auto valid = read(&header, 1)
+		&& header.magic == kFileMagic
+		&& header.version == kFileVersion
+		&& header.maxLinks == kMaxLinks
+		&& header.nodes >= 0
+		&& header.modelBytes >= 0
+		&& offset + header.modelBytes <= size;
+	if (valid) {
+		const auto saved = QByteArray(
+			reinterpret_cast<const char*>(data + offset),
+			header.modelBytes);
+		offset += header.modelBytes;
+		valid = (QString::fromUtf8(saved) == model);
+	}
+	if (!valid) {
+		qWarning() << "MCP: Rebuilding vector index" << _path;
+		file.unmap(data);
+		return 0;
+	}
+
+	_nodes.resize(header.nodes);
+	_vectors.resize(size_t(header.nodes) * header.dimensions);
+	_links0.resize(size_t(header.nodes) * (kMaxLinks0 + 1));
+	_upperLinks.resize(header.nodes);
+	auto loaded = read(_nodes.data(), _nodes.size())
+		&& read(_vectors.data(), _vectors.size())
+		&& read(_links0.data(), _links0.size());
+	for (auto i = 0; loaded && i != header.nodes; ++i) {
+		auto &list = _upperLinks[i];
+		list.resize(size_t(_nodes[i].level) * (kMaxLinks + 1));
+		loaded = read(list.data(), list.size());
+	}
+	file.unmap(data);
+	if (!loaded) {
+		qWarning() << "MCP: Truncated vector index" << _path;
+		reset();
+		return 0;
+	}
+
+	_dimensions = header.dimensions;
+	_entry = header.entry;
+	_maxLevel = header.maxLevel;
+	for (auto i = quint32(0); i != quint32(_nodes.size()); ++i) {
+		const auto &node = _nodes[i];
+		_byChat[node.chatId].push_back(i);
+		if (!node.deleted) {
+			_byRowId.insert(node.rowId, i);
+			++_live;
+		}
+	}
+	return header.savedAt;
+}
+
+} // namespace MCP
@@ -0,0 +1,123 @@
+// MCP Vector Index - HNSW approximate nearest neighbour search
+//
+// This file is part of Telegram Desktop MCP integration.
+// Keeps the message embeddings in a hierarchical navigable small world
+// graph for millisecond top-k queries. Vectors must be normalized, the
+// distance is 1 - dot product. Replaced and removed vectors stay in the
+// graph as tombstones, they route searches but are never returned.
+// The graph is saved to a file next to the archive database and mapped
+// back on start, rows stored since that save are added again.
+
+#pragma once
+
+#include <QtCore/QHash>
+#include <QtCore/QReadWriteLock>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+#include <atomic>
+#include <random>
+#include <vector>
+
+namespace MCP {
+
+struct VectorMatch {
+	qint64 rowId = 0;
+	float similarity = 0.f;
+};
+
+class VectorIndex {
+public:
+	explicit VectorIndex(const QString &path);
+
+	[[nodiscard]] QString path() const { return _path; }
+
+	// Searches fall back to a table scan until the index caught up.
+	[[nodiscard]] bool ready() const { return _ready.load(); }
+	void setReady(bool ready);
+
+	// Reads the saved graph if it was built for this model. Returns the
+	// time of that save, rows stored since then must be added again, or
+	// 0 when the index starts empty.
+	qint64 load(const QString &model);
+	bool save();
+
+	// Adding a known row replaces its vector unless it is the same one.
+	bool add(qint64 rowId, qint64 chatId, const QVector<float> &vector);
+	void remove(qint64 rowId);
+	void removeChat(qint64 chatId);
+
+	// chatId = 0 searches every chat.
+	[[nodiscard]] std::vector<VectorMatch> search(
+		const QVector<float> &query,
+		int limit,
+		qint64 chatId,
+		qint64 excludeRowId,
+		float minSimilarity) const;
+	[[nodiscard]] int size() const;
+
+private:
+	struct Node { // Saved as is.
+		qint64 rowId = 0;
+		qint64 chatId = 0;
+		qint32 level = 0;
+		qint32 deleted = 0;
+	};
+	struct Candidate {
+		float distance = 0.f;
+		quint32 node = 0;
+
+		friend inline bool operator<(const Candidate &a, const Candidate &b) {
+			return a.distance < b.distance;
+		}
+		friend inline bool operator>(const Candidate &a, const Candidate &b) {
+			return a.distance > b.distance;
+		}
+	};
+	struct Filter {
+		qint64 chatId = 0;
+		qint64 excludeRowId = 0;
+	};
+
+	void reset();
+	void insert(quint32 node);
+	void markDeleted(quint32 node);
+
+	[[nodiscard]] const float *vector(quint32 node) const;
+	[[nodiscard]] float distance(const float *query, quint32 node) const;
+	[[nodiscard]] quint32 *links(quint32 node, int level);
+	[[nodiscard]] const quint32 *links(quint32 node, int level) const;
+	[[nodiscard]] bool accepts(quint32 node, const Filter &filter) const;
+	[[nodiscard]] std::vector<Candidate> searchLayer(
+		const float *query,
+		const std::vector<Candidate> &entries,
+		int ef,
+		int level,
+		const Filter *filter) const;
+	[[nodiscard]] std::vector<Candidate> descend(const float *query) const;
+	[[nodiscard]] std::vector<quint32> selectNeighbours(
+		const std::vector<Candidate> &sorted,
+		int maxCount) const;
+	void connect(quint32 node, int level, const std::vector<quint32> &to);
+
+	const QString _path;
+	mutable QReadWriteLock _lock;
+	std::atomic<bool> _ready = false;
+	std::atomic<bool> _dirty = false;
+
+	QString _model;
+	int _dimensions = 0;
+	int _live = 0;
+	qint64 _entry = -1;
+	int _maxLevel = -1;
+
+	std::vector<Node> _nodes;
+	std::vector<float> _vectors; // _dimensions per node.
+	std::vector<quint32> _links0; // Count and kMaxLinks0 ids per node.
+	std::vector<std::vector<quint32>> _upperLinks; // Levels 1..level.
+	QHash<qint64, quint32> _byRowId; // Live nodes only.
+	QHash<qint64, std::vector<quint32>> _byChat;
+	std::mt19937 _levelGenerator;
+};
+
+} // namespace MCP
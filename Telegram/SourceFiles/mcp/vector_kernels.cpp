@@ -0,0 +1,205 @@
+// MCP Vector Kernels - SIMD dot products for embedding search
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "vector_kernels.h"
+
+#include <QtCore/QtGlobal>
+
+#if defined Q_PROCESSOR_X86_64
+#define MCP_KERNELS_AVX2
+#include <immintrin.h>
+#ifdef Q_CC_MSVC
+#include <intrin.h>
+#define MCP_TARGET_AVX2
+#else // Q_CC_MSVC
+#define MCP_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif // Q_CC_MSVC
+#elif defined Q_PROCESSOR_ARM_64 // Q_PROCESSOR_X86_64
+#define MCP_KERNELS_NEON
+#include <arm_neon.h>
+#endif // Q_PROCESSOR_X86_64 || Q_PROCESSOR_ARM_64
+
+namespace MCP {
+namespace {
+
+using DotFloat = float(*)(const float*, const float*, int);
+using DotInt8 = float(*)(const float*, const qint8*, int);
+
+float DotScalar(const float *a, const float *b, int count) {
+	auto result = 0.f;
+	for (auto i = 0; i != count; ++i) {
+		result += a[i] * b[i];
+	}
+	return result;
+}
+
+float DotInt8Scalar(const float *a, const qint8 *b, int count) {
+	auto result = 0.f;
+	for (auto i = 0; i != count; ++i) {
+		result += a[i] * float(b[i]);
+	}
+	return result;
+}
+
+#ifdef MCP_KERNELS_AVX2
+
+MCP_TARGET_AVX2 float HorizontalSum(__m256 value) {
+	auto sum = _mm_add_ps(
+		_mm256_castps256_ps128(value),
+		_mm256_extractf128_ps(value, 1));
+	sum = _mm_hadd_ps(sum, sum);
+	sum = _mm_hadd_ps(sum, sum);
+	return _mm_cvtss_f32(sum);
+}
+
+MCP_TARGET_AVX2 float DotAvx2(const float *a, const float *b, int count) {
+	// Two accumulators hide the FMA latency.
+	auto first = _mm256_setzero_ps();
+	auto second = _mm256_setzero_ps();
+	auto i = 0;
+	for (; i + 16 <= count; i += 16) {
+		first = _mm256_fmadd_ps(
+			_mm256_loadu_ps(a + i),
+			_mm256_loadu_ps(b + i),
+			first);
+		second = _mm256_fmadd_ps(
+			_mm256_loadu_ps(a + i + 8),
+			_mm256_loadu_ps(b + i + 8),
+			second);
+	}
+	for (; i + 8 <= count; i += 8) {
+		first = _mm256_fmadd_ps(
+			_mm256_loadu_ps(a + i),
+			_mm256_loadu_ps(b + i),
+			first);
+	}
+	return HorizontalSum(_mm256_add_ps(first, second))
+		+ DotScalar(a + i, b + i, count - i);
+}
+
+MCP_TARGET_AVX2 float DotInt8Avx2(const float *a, const qint8 *b, int count) {
+	auto sum = _mm256_setzero_ps();
+	auto i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const auto bytes = _mm_loadl_epi64(
+			reinterpret_cast<const __m128i*>(b + i));
+		const auto values = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(bytes));
+		sum = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), values, sum);
+	}
+	return HorizontalSum(sum) + DotInt8Scalar(a + i, b + i, count - i);
+}
+
+[[nodiscard]] bool HasAvx2() {
+#ifdef Q_CC_MSVC
+	int info[4] = { 0 };
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+	__cpuid(info, 1);
+	const auto fma = (info[2] & (1 << 12)) != 0;
+	const auto osxsave = (info[2] & (1 << 27)) != 0;
+	const auto avx = (info[2] & (1 << 28)) != 0;
+	if (!fma || !osxsave || !avx || (_xgetbv(0) & 6) != 6) {
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else // Q_CC_MSVC
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif // Q_CC_MSVC
+}
+
+#elif defined MCP_KERNELS_NEON // MCP_KERNELS_AVX2
+
+float DotNeon(const float *a, const float *b, int count) {
+	auto first = vdupq_n_f32(0.f);
+	auto second = vdupq_n_f32(0.f);
+	auto i = 0;
+	for (; i + 8 <= count; i += 8) {
+		first = vfmaq_f32(first, vld1q_f32(a + i), vld1q_f32(b + i));
+		second = vfmaq_f32(second, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+	}
+	return vaddvq_f32(vaddq_f32(first, second))
+		+ DotScalar(a + i, b + i, count - i);
+}
+
+float DotInt8Neon(const float *a, const qint8 *b, int count) {
+	auto first = vdupq_n_f32(0.f);
+	auto second = vdupq_n_f32(0.f);
+	auto i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const auto wide = vmovl_s8(vld1_s8(b + i));
+		const auto low = vcvtq_f32_s32(vmovl_s16(vget_low_s16(wide)));
+		const auto high = vcvtq_f32_s32(vmovl_s16(vget_high_s16(wide)));
+		first = vfmaq_f32(first, vld1q_f32(a + i), low);
+		second = vfmaq_f32(second, vld1q_f32(a + i + 4), high);
+	}
+	return vaddvq_f32(vaddq_f32(first, second))
+		+ DotInt8Scalar(a + i, b + i, count - i);
+}
+
+#endif // MCP_KERNELS_AVX2 || MCP_KERNELS_NEON
+
+struct Kernels {
+	DotFloat dot = DotScalar;
+	DotInt8 dotInt8 = DotInt8Scalar;
+	const char *name = "scalar";
+};
+
+[[nodiscard]] Kernels ChooseKernels() {
+#ifdef MCP_KERNELS_AVX2
+	return HasAvx2() ? Kernels{ DotAvx2, DotInt8Avx2, "avx2" } : Kernels();
+#elif defined MCP_KERNELS_NEON // MCP_KERNELS_AVX2
+	return { DotNeon, DotInt8Neon, "neon" };
+#else // MCP_KERNELS_AVX2 || MCP_KERNELS_NEON
+	return {};
+#endif // MCP_KERNELS_AVX2 || MCP_KERNELS_NEON
+}
+
+const Kernels &Chosen() {
+	static const auto result = ChooseKernels();
+	return result;
+}
+
+void Prefetch(const float *data) {
+#ifdef MCP_KERNELS_AVX2
+	_mm_prefetch(reinterpret_cast<const char*>(data), _MM_HINT_T0);
+#elif !defined Q_CC_MSVC // MCP_KERNELS_AVX2
+	__builtin_prefetch(data);
+#else // MCP_KERNELS_AVX2 || !Q_CC_MSVC
+	Q_UNUSED(data);
+#endif // MCP_KERNELS_AVX2 || !Q_CC_MSVC
+}
+
+} // namespace
+
+float DotProduct(const float *a, const float *b, int count) {
+	return Chosen().dot(a, b, count);
+}
+
+float DotProductInt8(const float *a, const qint8 *b, int count) {
+	return Chosen().dotInt8(a, b, count);
+}
+
+void DotProducts(
+		const float *query,
+		const float *const *vectors,
+		int count,
+		int dimensions,
+		float *results) {
+	const auto dot = Chosen().dot;
+	for (auto i = 0; i != count; ++i) {
+		if (i + 1 != count) {
+			Prefetch(vectors[i + 1]);
+		}
+		results[i] = dot(query, vectors[i], dimensions);
+	}
+}
+
+const char *VectorKernelName() {
+	return Chosen().name;
+}
+
+} // namespace MCP
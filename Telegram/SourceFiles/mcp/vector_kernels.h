@@ -0,0 +1,28 @@
+// MCP Vector Kernels - SIMD dot products for embedding search
+//
+// This file is part of Telegram Desktop MCP integration.
+// AVX2 + FMA kernels are picked at runtime on x86-64, NEON is always
+// there on ARM64, anything else gets the scalar loops.
+
+#pragma once
+
+#include <QtCore/QtGlobal>
+
+namespace MCP {
+
+[[nodiscard]] float DotProduct(const float *a, const float *b, int count);
+
+// Int8 codes are scored as is, multiply by their scale afterwards.
+[[nodiscard]] float DotProductInt8(const float *a, const qint8 *b, int count);
+
+// Scores one query against many vectors, prefetching the next one.
+void DotProducts(
+	const float *query,
+	const float *const *vectors,
+	int count,
+	int dimensions,
+	float *results);
+
+[[nodiscard]] const char *VectorKernelName();
+
+} // namespace MCP
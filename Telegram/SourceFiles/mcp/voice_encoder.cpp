@@ -0,0 +1,326 @@
+// MCP Voice Encoder - PCM chunks to a sendable voice message
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "voice_encoder.h"
+
+#include "ffmpeg/ffmpeg_bytes_io_wrap.h"
+#include "ffmpeg/ffmpeg_utility.h"
+#include "media/audio/media_audio.h"
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+namespace MCP {
+namespace {
+
+using namespace FFmpeg;
+
+constexpr auto kOpusFrequency = 48000;
+constexpr auto kOpusBitrate = 32000; // As voice recording encodes.
+constexpr auto kDefaultFrameSize = 960; // 20 ms.
+constexpr auto kLevelsPerSecond = 100;
+
+// Same peaks as a recorded voice message gets.
+[[nodiscard]] VoiceWaveform CollectWaveform(const std::vector<uchar> &levels) {
+	const auto count = int64(levels.size());
+	if (count < Media::Player::kWaveformSamplesCount) {
+		return {};
+	}
+	auto peaks = QVector<uint16>();
+	peaks.reserve(Media::Player::kWaveformSamplesCount);
+
+	auto peak = uint16(0);
+	auto sum = int64(0);
+	for (const auto level : levels) {
+		peak = std::max(peak, uint16(uint16(level) * 256));
+		sum += Media::Player::kWaveformSamplesCount;
+		if (sum >= count) {
+			sum -= count;
+			peaks.push_back(peak);
+			peak = 0;
+		}
+	}
+
+	const auto total = std::accumulate(peaks.cbegin(), peaks.cend(), 0LL);
+	const auto limit = std::max(int32(total * 1.8 / peaks.size()), 2500);
+
+	auto result = VoiceWaveform(peaks.size());
+	for (auto i = 0, l = int(peaks.size()); i != l; ++i) {
+		result[i] = char(std::min(
+			31U,
+			uint32(std::min(int32(peaks[i]), limit)) * 31 / limit));
+	}
+	return result;
+}
+
+} // namespace
+
+struct VoiceEncoder::Private {
+	bool init(int inputFrequency);
+	bool encode(const int16 *samples, int count); // nullptr to flush.
+	bool sendSamples(const float *samples, int count);
+	bool writeFrame(AVFrame *sending); // nullptr to drain.
+
+	int frequency = 0;
+	WriteBytesWrap output;
+	FormatPointer format;
+	AVStream *stream = nullptr;
+	CodecPointer codec;
+	SwresamplePointer swr;
+	FramePointer frame;
+	int frameSize = kDefaultFrameSize;
+
+	std::vector<float> pending; // Less than a frame, at 48 kHz.
+	std::vector<float> resampled;
+	QByteArray split;
+	int64 inputSamples = 0;
+	int64 encodedSamples = 0;
+
+	std::vector<uchar> levels;
+	int levelEach = 1;
+	int levelCounter = 0;
+	uint16 levelPeak = 0;
+
+	bool failed = false;
+	bool finished = false;
+};
+
+bool VoiceEncoder::Private::init(int inputFrequency) {
+	frequency = inputFrequency;
+	levelEach = std::max(frequency / kLevelsPerSecond, 1);
+
+	format = MakeWriteFormatPointer(
+		static_cast<void*>(&output),
+		nullptr,
+		&WriteBytesWrap::Write,
+		&WriteBytesWrap::Seek,
+		QByteArray("opus"));
+	if (!format) {
+		return false;
+	}
+	const auto encoder = avcodec_find_encoder(format->oformat->audio_codec);
+	if (!encoder) {
+		LogError("avcodec_find_encoder");
+		return false;
+	}
+	stream = avformat_new_stream(format.get(), encoder);
+	if (!stream) {
+		LogError("avformat_new_stream");
+		return false;
+	}
+	codec = CodecPointer(avcodec_alloc_context3(encoder));
+	if (!codec) {
+		LogError("avcodec_alloc_context3");
+		return false;
+	}
+	codec->sample_fmt = AV_SAMPLE_FMT_FLTP;
+	codec->bit_rate = kOpusBitrate;
+	codec->ch_layout = AV_CHANNEL_LAYOUT_MONO;
+	codec->sample_rate = kOpusFrequency;
+	codec->time_base = AVRational{ 1, kOpusFrequency };
+	if (format->oformat->flags & AVFMT_GLOBALHEADER) {
+		codec->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+	}
+
+	auto error = AvErrorWrap(avcodec_open2(codec.get(), encoder, nullptr));
+	if (error) {
+		LogError("avcodec_open2", error);
+		return false;
+	}
+	if (codec->frame_size > 0
+		&& !(encoder->capabilities & AV_CODEC_CAP_VARIABLE_FRAME_SIZE)) {
+		frameSize = codec->frame_size;
+	}
+	error = avcodec_parameters_from_context(stream->codecpar, codec.get());
+	if (error) {
+		LogError("avcodec_parameters_from_context", error);
+		return false;
+	}
+	error = avformat_write_header(format.get(), nullptr);
+	if (error) {
+		LogError("avformat_write_header", error);
+		return false;
+	}
+
+	auto mono = AVChannelLayout(AV_CHANNEL_LAYOUT_MONO);
+	swr = MakeSwresamplePointer(
+		&mono,
+		AV_SAMPLE_FMT_S16,
+		frequency,
+		&codec->ch_layout,
+		codec->sample_fmt,
+		kOpusFrequency);
+	if (!swr) {
+		return false;
+	}
+
+	frame = MakeFramePointer();
+	if (!frame) {
+		return false;
+	}
+	frame->nb_samples = frameSize;
+	frame->format = codec->sample_fmt;
+	av_channel_layout_copy(&frame->ch_layout, &codec->ch_layout);
+	frame->sample_rate = kOpusFrequency;
+	error = av_frame_get_buffer(frame.get(), 0);
+	if (error) {
+		LogError("av_frame_get_buffer", error);
+		return false;
+	}
+	pending.reserve(frameSize * 2);
+	return true;
+}
+
+bool VoiceEncoder::Private::encode(const int16 *samples, int count) {
+	if (samples && !count) {
+		return true;
+	}
+	for (auto i = 0; i != count; ++i) {
+		levelPeak = std::max(levelPeak, uint16(qAbs(int(samples[i]))));
+		if (++levelCounter == levelEach) {
+			levelCounter = 0;
+			levels.push_back(uchar(std::min(levelPeak / 256, 255)));
+			levelPeak = 0;
+		}
+	}
+	inputSamples += count;
+
+	const auto capacity = swr_get_out_samples(swr.get(), count);
+	if (capacity <= 0) {
+		return (capacity == 0);
+	}
+	resampled.resize(capacity);
+	auto out = reinterpret_cast<uint8_t*>(resampled.data());
+	auto in = reinterpret_cast<const uint8_t*>(samples);
+	const auto converted = swr_convert(
+		swr.get(),
+		&out,
+		capacity,
+		samples ? &in : nullptr,
+		count);
+	if (converted < 0) {
+		LogError("swr_convert", AvErrorWrap(converted));
+		return false;
+	}
+	pending.insert(
+		end(pending),
+		begin(resampled),
+		begin(resampled) + converted);
+
+	auto offset = 0;
+	while (int(pending.size()) - offset >= frameSize) {
+		if (!sendSamples(pending.data() + offset, frameSize)) {
+			return false;
+		}
+		offset += frameSize;
+	}
+	pending.erase(begin(pending), begin(pending) + offset);
+	return true;
+}
+
+bool VoiceEncoder::Private::sendSamples(const float *samples, int count) {
+	const auto error = AvErrorWrap(av_frame_make_writable(frame.get()));
+	if (error) {
+		LogError("av_frame_make_writable", error);
+		return false;
+	}
+	frame->nb_samples = count;
+	memcpy(frame->data[0], samples, count * sizeof(float));
+	frame->pts = encodedSamples;
+	encodedSamples += count;
+	return writeFrame(frame.get());
+}
+
+bool VoiceEncoder::Private::writeFrame(AVFrame *sending) {
+	auto error = AvErrorWrap(avcodec_send_frame(codec.get(), sending));
+	if (error) {
+		LogError("avcodec_send_frame", error);
+		return false;
+	}
+	auto packet = Packet();
+	while (true) {
+		error = avcodec_receive_packet(codec.get(), &packet.fields());
+		if (error.code() == AVERROR(EAGAIN) || error.code() == AVERROR_EOF) {
+			return true;
+		} else if (error) {
+			LogError("avcodec_receive_packet", error);
+			return false;
+		}
+		av_packet_rescale_ts(
+			&packet.fields(),
+			codec->time_base,
+			stream->time_base);
+		packet.fields().stream_index = stream->index;
+		error = av_interleaved_write_frame(format.get(), &packet.fields());
+		if (error) {
+			LogError("av_interleaved_write_frame", error);
+			return false;
+		}
+	}
+}
+
+VoiceEncoder::VoiceEncoder(int frequency)
+: _d(std::make_unique<Private>()) {
+	if (frequency <= 0 || !_d->init(frequency)) {
+		_d->failed = true;
+	}
+}
+
+VoiceEncoder::~VoiceEncoder() = default;
+
+bool VoiceEncoder::valid() const {
+	return !_d->failed && !_d->finished;
+}
+
+bool VoiceEncoder::push(const QByteArray &samples) {
+	if (!valid()) {
+		return false;
+	}
+	auto data = _d->split.isEmpty() ? samples : (_d->split + samples);
+	_d->split.clear();
+	if (data.size() % 2) {
+		_d->split = data.right(1);
+		data.chop(1);
+	}
+	if (!_d->encode(
+			reinterpret_cast<const int16*>(data.constData()),
+			int(data.size() / 2))) {
+		_d->failed = true;
+		return false;
+	}
+	return true;
+}
+
+std::optional<EncodedVoice> VoiceEncoder::finish() {
+	if (!valid()) {
+		return std::nullopt;
+	}
+	_d->finished = true;
+	if (!_d->inputSamples || !_d->encode(nullptr, 0)) {
+		return std::nullopt;
+	}
+	if (!_d->pending.empty()) {
+		// The last frame is padded with silence.
+		_d->pending.resize(_d->frameSize, 0.f);
+		if (!_d->sendSamples(_d->pending.data(), _d->frameSize)) {
+			return std::nullopt;
+		}
+	}
+	if (!_d->writeFrame(nullptr)) {
+		return std::nullopt;
+	}
+	const auto error = AvErrorWrap(av_write_trailer(_d->format.get()));
+	if (error) {
+		LogError("av_write_trailer", error);
+		return std::nullopt;
+	}
+	return EncodedVoice{
+		.bytes = std::move(_d->output.content),
+		.waveform = CollectWaveform(_d->levels),
+		.duration = _d->inputSamples * crl::time(1000) / _d->frequency,
+	};
+}
+
+} // namespace MCP
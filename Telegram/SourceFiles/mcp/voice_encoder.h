@@ -0,0 +1,47 @@
+// MCP Voice Encoder - PCM chunks to a sendable voice message
+//
+// This file is part of Telegram Desktop MCP integration.
+// Samples are resampled and encoded to Ogg Opus as they are pushed, the
+// same format and bitrate voice recording produces, so the bytes go to
+// ApiWrap::sendVoiceMessage() as they are. The waveform is collected on
+// the way. Not thread-safe, one encoder per stream.
+
+#pragma once
+
+#include "data/data_types.h"
+
+#include <QtCore/QByteArray>
+
+#include <memory>
+#include <optional>
+
+namespace MCP {
+
+struct EncodedVoice {
+	QByteArray bytes;
+	VoiceWaveform waveform;
+	crl::time duration = 0;
+};
+
+class VoiceEncoder final {
+public:
+	// Pushed samples are signed 16-bit little endian mono.
+	explicit VoiceEncoder(int frequency);
+	~VoiceEncoder();
+
+	[[nodiscard]] bool valid() const;
+
+	// Any byte count, a split sample waits for the next chunk.
+	bool push(const QByteArray &samples);
+
+	// Flushes the codec, the encoder is spent after that.
+	[[nodiscard]] std::optional<EncodedVoice> finish();
+
+private:
+	struct Private;
+
+	std::unique_ptr<Private> _d;
+
+};
+
+} // namespace MCP
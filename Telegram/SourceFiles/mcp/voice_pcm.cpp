@@ -0,0 +1,175 @@
+// MCP Voice PCM - Voice notes decoded for transcription in memory
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "voice_pcm.h"
+
+#include "core/file_location.h"
+#include "media/audio/media_audio_ffmpeg_loader.h"
+
+#include <QtCore/QDebug>
+#include <QtCore/QtEndian>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace MCP {
+namespace {
+
+constexpr auto kTapsPerFactor = 16;
+constexpr auto kPassband = 0.9; // Of the target Nyquist frequency.
+constexpr auto kWavHeaderSize = 44;
+
+static_assert(Media::Player::kDefaultFrequency % kVoicePcmFrequency == 0);
+
+// Windowed-sinc low-pass, evaluated only for the samples kept.
+class Decimator final {
+public:
+	explicit Decimator(int factor)
+	: _factor(factor)
+	, _taps(kTapsPerFactor * factor + 1)
+	, _history(_taps.size(), 0.f) {
+		const auto count = int(_taps.size());
+		const auto middle = (count - 1) / 2.;
+		const auto cutoff = 0.5 * kPassband / factor;
+		auto sum = 0.;
+		for (auto i = 0; i != count; ++i) {
+			const auto x = i - middle;
+			const auto sinc = x
+				? std::sin(2. * M_PI * cutoff * x) / (M_PI * x)
+				: 2. * cutoff;
+			const auto window = 0.54 - 0.46 * std::cos(2. * M_PI * i / (count - 1));
+			_taps[i] = float(sinc * window);
+			sum += _taps[i];
+		}
+		for (auto &tap : _taps) {
+			tap = float(tap / sum);
+		}
+	}
+
+	void push(float sample, QByteArray &output) {
+		const auto count = int(_history.size());
+		_history[_position] = sample;
+		_position = (_position + 1) % count;
+		if (++_phase < _factor) {
+			return;
+		}
+		_phase = 0;
+
+		// The filter is symmetric, so the ring order doesn't matter.
+		auto sum = 0.f;
+		for (auto i = 0; i != count; ++i) {
+			sum += _taps[i] * _history[(_position + i) % count];
+		}
+		const auto value = qint16(std::clamp(
+			int(std::lround(sum * 32767.f)),
+			-32768,
+			32767));
+		char bytes[2];
+		qToLittleEndian(value, bytes);
+		output.append(bytes, 2);
+	}
+
+private:
+	const int _factor = 1;
+	std::vector<float> _taps;
+	std::vector<float> _history;
+	int _position = 0;
+	int _phase = 0;
+
+};
+
+} // namespace
+
+QByteArray DecodeVoicePcm(
+		const Core::FileLocation &file,
+		const QByteArray &data) {
+	using ReadError = Media::AudioPlayerLoader::ReadError;
+
+	auto loader = Media::FFMpegLoader(file, data, bytes::vector());
+	if (!loader.open(0)) {
+		qWarning() << "MCP: Could not open voice message for decoding";
+		return QByteArray();
+	}
+
+	// The loader resamples everything to the player frequency.
+	const auto factor = loader.samplesFrequency() / kVoicePcmFrequency;
+	if (factor < 1 || loader.samplesFrequency() % kVoicePcmFrequency) {
+		qWarning()
+			<< "MCP: Unexpected voice sample rate"
+			<< loader.samplesFrequency();
+		return QByteArray();
+	}
+	const auto format = loader.format();
+	const auto stereo = (format == AL_FORMAT_STEREO8)
+		|| (format == AL_FORMAT_STEREO16);
+	const auto wide = (format == AL_FORMAT_MONO16)
+		|| (format == AL_FORMAT_STEREO16);
+
+	auto result = QByteArray();
+	result.reserve(int(loader.duration() * kVoicePcmFrequency / 1000) * 2);
+	auto decimator = Decimator(factor);
+	const auto channels = stereo ? 2 : 1;
+	while (true) {
+		const auto read = loader.readMore();
+		if (const auto error = std::get_if<ReadError>(&read)) {
+			if (*error == ReadError::Retry) {
+				continue;
+			}
+			break; // EndOfFile, or Wait and Other a file loader never gets.
+		}
+		const auto samples = std::get<bytes::const_span>(read);
+		if (wide) {
+			const auto values = reinterpret_cast<const int16*>(samples.data());
+			const auto count = int(samples.size() / sizeof(int16));
+			for (auto i = 0; i + channels <= count; i += channels) {
+				const auto sum = stereo
+					? (int(values[i]) + int(values[i + 1]))
+					: int(values[i]);
+				decimator.push(sum / (32768.f * channels), result);
+			}
+		} else {
+			const auto values = reinterpret_cast<const uchar*>(samples.data());
+			const auto count = int(samples.size());
+			for (auto i = 0; i + channels <= count; i += channels) {
+				const auto sum = stereo
+					? (int(values[i]) + int(values[i + 1]) - 0x100)
+					: (int(values[i]) - 0x80);
+				decimator.push(sum / (128.f * channels), result);
+			}
+		}
+	}
+	return result;
+}
+
+QByteArray WavFromVoicePcm(const QByteArray &pcm) {
+	auto result = QByteArray();
+	result.reserve(kWavHeaderSize + pcm.size());
+	const auto append32 = [&](quint32 value) {
+		char bytes[4];
+		qToLittleEndian(value, bytes);
+		result.append(bytes, 4);
+	};
+	const auto append16 = [&](quint16 value) {
+		char bytes[2];
+		qToLittleEndian(value, bytes);
+		result.append(bytes, 2);
+	};
+	result.append("RIFF", 4);
+	append32(quint32(kWavHeaderSize - 8 + pcm.size()));
+	result.append("WAVEfmt ", 8);
+	append32(16); // PCM format chunk size.
+	append16(1); // Integer PCM.
+	append16(1); // Mono.
+	append32(kVoicePcmFrequency);
+	append32(kVoicePcmFrequency * 2); // Byte rate.
+	append16(2); // Block align.
+	append16(16); // Bits per sample.
+	result.append("data", 4);
+	append32(quint32(pcm.size()));
+	result.append(pcm);
+	return result;
+}
+
+} // namespace MCP
@@ -0,0 +1,30 @@
+// MCP Voice PCM - Voice notes decoded for transcription in memory
+//
+// This file is part of Telegram Desktop MCP integration.
+// The document bytes or the cached file are decoded once by the same
+// FFmpeg loader the player uses, then downmixed and low-pass decimated
+// to the 16 kHz mono whisper models expect. No temp files are written
+// and the transcriber gets the samples without decoding them again.
+// Safe to call from any thread.
+
+#pragma once
+
+#include <QtCore/QByteArray>
+
+namespace Core {
+class FileLocation;
+} // namespace Core
+
+namespace MCP {
+
+inline constexpr auto kVoicePcmFrequency = 16000;
+
+// Signed 16-bit little endian mono samples, empty on failure.
+[[nodiscard]] QByteArray DecodeVoicePcm(
+	const Core::FileLocation &file,
+	const QByteArray &data);
+
+// The samples with a RIFF header for tools that want a WAV stream.
+[[nodiscard]] QByteArray WavFromVoicePcm(const QByteArray &pcm);
+
+} // namespace MCP
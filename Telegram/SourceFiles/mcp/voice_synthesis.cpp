@@ -0,0 +1,375 @@
+// MCP Voice Synthesis - Chunked text to speech with a rendered cache
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "voice_synthesis.h"
+
+#include "mcp_helpers.h"
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDateTime>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QRegularExpression>
+#include <QtCore/QTimer>
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+
+#include <algorithm>
+
+namespace MCP {
+namespace {
+
+constexpr auto kMaxRenders = 2;
+constexpr auto kMaxCachedVoices = 512;
+constexpr auto kRenderTimeoutMs = 120 * 1000;
+constexpr auto kDefaultFrequency = 22050; // Of the usual piper voices.
+constexpr auto kDefaultVoice = "en_US-lessac-medium";
+constexpr auto kPiper = "piper";
+
+constexpr auto kPersonaTable = R"(
+	CREATE TABLE IF NOT EXISTS voice_persona (
+		name TEXT PRIMARY KEY,
+		voice_id TEXT,
+		pitch REAL DEFAULT 1,
+		speed REAL DEFAULT 1,
+		created_at TEXT
+	)
+)";
+
+constexpr auto kCacheTable = R"(
+	CREATE TABLE IF NOT EXISTS tts_cache (
+		persona TEXT NOT NULL,
+		text_hash TEXT NOT NULL,
+		audio BLOB NOT NULL,
+		waveform BLOB,
+		duration_ms INTEGER,
+		hits INTEGER DEFAULT 0,
+		last_used_at INTEGER,
+		PRIMARY KEY(persona, text_hash)
+	)
+)";
+
+[[nodiscard]] QStringList SplitSentences(const QString &text) {
+	static const auto separator = QRegularExpression(
+		R"((?<=[.!?;…])\s+|\n+)");
+	auto result = QStringList();
+	for (const auto &part : text.split(separator)) {
+		const auto sentence = part.simplified();
+		if (!sentence.isEmpty()) {
+			result.push_back(sentence);
+		}
+	}
+	return result;
+}
+
+} // namespace
+
+VoiceSynthesis::VoiceSynthesis(QSqlDatabase db)
+: _db(std::move(db)) {
+}
+
+VoiceSynthesis::~VoiceSynthesis() {
+	for (auto &[key, render] : _renders) {
+		if (const auto process = render.process.data()) {
+			disconnect(process, nullptr, this, nullptr);
+			process->kill();
+			process->waitForFinished(1000);
+		}
+	}
+}
+
+bool VoiceSynthesis::initialize() {
+	QSqlQuery query(_db);
+	if (!query.exec(kPersonaTable) || !query.exec(kCacheTable)) {
+		qWarning() << "MCP: Failed to create TTS tables:" << query.lastError().text();
+		return false;
+	}
+	return true;
+}
+
+void VoiceSynthesis::setModelsPath(const QString &path) {
+	_modelsPath = path;
+}
+
+VoicePersona VoiceSynthesis::persona(const QString &name) {
+	auto result = VoicePersona{ .name = name, .voiceId = kDefaultVoice };
+	auto query = PreparedQuery(_db, R"(
+		SELECT voice_id, pitch, speed FROM voice_persona WHERE name = ?
+	)");
+	query->addBindValue(name);
+	if (query->exec() && query->next()) {
+		const auto voiceId = query->value(0).toString();
+		if (!voiceId.isEmpty()) {
+			result.voiceId = voiceId;
+		}
+		result.pitch = query->value(1).toDouble();
+		result.speed = query->value(2).toDouble();
+	}
+	if (result.speed <= 0.) {
+		result.speed = 1.;
+	}
+	return result;
+}
+
+QString VoiceSynthesis::modelPath(const VoicePersona &persona) const {
+	if (QFileInfo::exists(persona.voiceId) || _modelsPath.isEmpty()) {
+		return persona.voiceId;
+	}
+	return _modelsPath + '/' + persona.voiceId + ".onnx";
+}
+
+int VoiceSynthesis::modelFrequency(const QString &model) const {
+	// Piper keeps the voice config next to the model.
+	auto config = QFile(model + ".json");
+	if (!config.open(QIODevice::ReadOnly)) {
+		return kDefaultFrequency;
+	}
+	const auto audio = QJsonDocument::fromJson(
+		config.readAll()).object().value("audio").toObject();
+	return audio.value("sample_rate").toInt(kDefaultFrequency);
+}
+
+bool VoiceSynthesis::render(
+		const VoicePersona &persona,
+		const QString &text,
+		Done done) {
+	++_requested;
+	const auto chunks = SplitSentences(text);
+	if (chunks.isEmpty()) {
+		++_failed;
+		done(nullptr, "Nothing to say");
+		return false;
+	}
+	auto source = QString::number(persona.speed)
+		+ '\n'
+		+ QString::number(persona.pitch)
+		+ '\n'
+		+ persona.voiceId
+		+ '\n'
+		+ chunks.join('\n');
+	const auto hash = QString::fromLatin1(QCryptographicHash::hash(
+		source.toUtf8(),
+		QCryptographicHash::Sha1).toHex());
+
+	if (const auto voice = cached(persona.name, hash)) {
+		++_cacheHits;
+		done(&*voice, QString());
+		return true;
+	}
+
+	const auto key = persona.name + '\n' + hash;
+	const auto i = _renders.find(key);
+	if (i != end(_renders)) {
+		++_shared;
+		i->second.waiting.push_back(std::move(done));
+		return false;
+	}
+	auto &render = _renders[key];
+	render.persona = persona;
+	render.hash = hash;
+	render.chunks = chunks;
+	render.waiting.push_back(std::move(done));
+	_queue.push_back(key);
+	startQueued();
+	return false;
+}
+
+void VoiceSynthesis::startQueued() {
+	while (_running < kMaxRenders && !_queue.empty()) {
+		const auto key = _queue.front();
+		_queue.pop_front();
+		start(key);
+	}
+}
+
+void VoiceSynthesis::start(const QString &key) {
+	auto &render = _renders[key];
+	const auto model = modelPath(render.persona);
+	render.encoder = std::make_unique<VoiceEncoder>(modelFrequency(model));
+	if (!render.encoder->valid()) {
+		++_running;
+		finished(key, false, "Opus encoder unavailable");
+		return;
+	}
+
+	const auto process = new QProcess(this);
+	render.process = process;
+	render.started.start();
+	++_running;
+
+	connect(process, &QProcess::readyReadStandardOutput, this, [=] {
+		readOutput(key);
+	});
+	connect(process, &QProcess::finished, this, [=](
+			int exitCode,
+			QProcess::ExitStatus status) {
+		finished(key, status == QProcess::NormalExit && !exitCode);
+	});
+	connect(process, &QProcess::errorOccurred, this, [=](
+			QProcess::ProcessError error) {
+		if (error == QProcess::FailedToStart) {
+			finished(key, false, "Could not start " + QString::fromLatin1(kPiper));
+		}
+	});
+	QTimer::singleShot(kRenderTimeoutMs, process, [=] { process->kill(); });
+
+	process->start(kPiper, {
+		"--model",
+		model,
+		"--output-raw",
+		"--length_scale",
+		QString::number(1. / render.persona.speed),
+	});
+
+	// A line at a time, piper streams each sentence once it's spoken.
+	for (const auto &chunk : render.chunks) {
+		process->write(chunk.toUtf8() + '\n');
+	}
+	process->closeWriteChannel();
+}
+
+void VoiceSynthesis::readOutput(const QString &key) {
+	const auto i = _renders.find(key);
+	if (i == end(_renders) || !i->second.process) {
+		return;
+	}
+	auto &render = i->second;
+	const auto samples = render.process->readAllStandardOutput();
+	if (samples.isEmpty()) {
+		return;
+	} else if (render.firstChunkMs < 0) {
+		render.firstChunkMs = render.started.elapsed();
+	}
+	if (!render.encoder->push(samples)) {
+		render.process->kill();
+	}
+}
+
+void VoiceSynthesis::finished(
+		const QString &key,
+		bool success,
+		const QString &failure) {
+	const auto i = _renders.find(key);
+	if (i == end(_renders)) {
+		return;
+	}
+	auto render = std::move(i->second);
+	_renders.erase(i);
+	--_running;
+
+	auto error = failure;
+	if (const auto process = render.process.data()) {
+		if (success && render.encoder->valid()) {
+			render.encoder->push(process->readAllStandardOutput());
+		}
+		const auto log = QString::fromUtf8(process->readAllStandardError());
+		if (error.isEmpty()) {
+			error = log.trimmed().right(500);
+		}
+		disconnect(process, nullptr, this, nullptr);
+		process->deleteLater();
+	}
+	const auto voice = (success && render.encoder)
+		? render.encoder->finish()
+		: std::nullopt;
+	if (voice) {
+		++_rendered;
+		_lastFirstChunkMs = render.firstChunkMs;
+		_lastRenderMs = render.started.elapsed();
+		store(render.persona.name, render.hash, *voice);
+	} else {
+		++_failed;
+		if (error.isEmpty()) {
+			error = "Voice synthesis failed";
+		}
+		qWarning() << "MCP: TTS for" << render.persona.name << "failed:" << error;
+	}
+
+	// The callbacks may render again.
+	startQueued();
+	for (const auto &done : render.waiting) {
+		done(voice ? &*voice : nullptr, voice ? QString() : error);
+	}
+}
+
+std::optional<EncodedVoice> VoiceSynthesis::cached(
+		const QString &persona,
+		const QString &hash) {
+	auto query = PreparedQuery(_db, R"(
+		SELECT audio, waveform, duration_ms FROM tts_cache
+		WHERE persona = ? AND text_hash = ?
+	)");
+	query->addBindValue(persona);
+	query->addBindValue(hash);
+	if (!query->exec() || !query->next()) {
+		return std::nullopt;
+	}
+	const auto waveform = query->value(1).toByteArray();
+	auto result = EncodedVoice{
+		.bytes = query->value(0).toByteArray(),
+		.waveform = VoiceWaveform(waveform.begin(), waveform.end()),
+		.duration = query->value(2).toLongLong(),
+	};
+	query->finish();
+
+	auto touch = PreparedQuery(_db, R"(
+		UPDATE tts_cache SET hits = hits + 1, last_used_at = ?
+		WHERE persona = ? AND text_hash = ?
+	)");
+	touch->addBindValue(QDateTime::currentSecsSinceEpoch());
+	touch->addBindValue(persona);
+	touch->addBindValue(hash);
+	touch->exec();
+	return result;
+}
+
+void VoiceSynthesis::store(
+		const QString &persona,
+		const QString &hash,
+		const EncodedVoice &voice) {
+	auto query = PreparedQuery(_db, R"(
+		INSERT OR REPLACE INTO tts_cache
+			(persona, text_hash, audio, waveform, duration_ms, hits, last_used_at)
+		VALUES (?, ?, ?, ?, ?, 0, ?)
+	)");
+	query->addBindValue(persona);
+	query->addBindValue(hash);
+	query->addBindValue(voice.bytes);
+	query->addBindValue(QByteArray(
+		reinterpret_cast<const char*>(voice.waveform.constData()),
+		voice.waveform.size()));
+	query->addBindValue(qint64(voice.duration));
+	query->addBindValue(QDateTime::currentSecsSinceEpoch());
+	if (!query->exec()) {
+		qWarning() << "MCP: Failed to cache voice:" << query->lastError().text();
+		return;
+	}
+
+	auto prune = PreparedQuery(_db, R"(
+		DELETE FROM tts_cache WHERE rowid IN (
+			SELECT rowid FROM tts_cache
+			ORDER BY last_used_at DESC
+			LIMIT -1 OFFSET ?
+		)
+	)");
+	prune->addBindValue(kMaxCachedVoices);
+	prune->exec();
+}
+
+QJsonObject VoiceSynthesis::stats() const {
+	return QJsonObject{
+		{ "requested", _requested },
+		{ "cache_hits", _cacheHits },
+		{ "shared", _shared },
+		{ "rendered", _rendered },
+		{ "failed", _failed },
+		{ "running", _running },
+		{ "queued", int(_queue.size()) },
+		{ "last_first_chunk_ms", _lastFirstChunkMs },
+		{ "last_render_ms", _lastRenderMs },
+	};
+}
+
+} // namespace MCP
@@ -0,0 +1,108 @@
+// MCP Voice Synthesis - Chunked text to speech with a rendered cache
+//
+// This file is part of Telegram Desktop MCP integration.
+// Text is split into sentences that one piper process synthesizes in
+// turn, the raw samples it streams are encoded to Opus as they arrive,
+// so encoding overlaps synthesis and nothing goes through a file. The
+// rendered voice is kept in tts_cache by persona and a hash of the text
+// and the persona settings: a repeated greeting or away reply costs a
+// row read instead of a synthesis. Identical renders in flight share
+// one process. Used on the main thread.
+
+#pragma once
+
+#include "voice_encoder.h"
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QJsonObject>
+#include <QtCore/QObject>
+#include <QtCore/QPointer>
+#include <QtCore/QProcess>
+#include <QtCore/QString>
+#include <QtSql/QSqlDatabase>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace MCP {
+
+struct VoicePersona {
+	QString name;
+	QString voiceId; // Piper model, a path or a name in the models folder.
+	double pitch = 1.; // Piper voices have no pitch control.
+	double speed = 1.;
+};
+
+class VoiceSynthesis final : public QObject {
+public:
+	// The voice is null when rendering failed.
+	using Done = std::function<void(
+		const EncodedVoice *voice,
+		const QString &error)>;
+
+	explicit VoiceSynthesis(QSqlDatabase db);
+	~VoiceSynthesis();
+
+	bool initialize();
+	void setModelsPath(const QString &path);
+
+	// From voice_persona, the default voice for an unknown name.
+	[[nodiscard]] VoicePersona persona(const QString &name);
+
+	// A cached voice is delivered before this returns true.
+	bool render(const VoicePersona &persona, const QString &text, Done done);
+
+	[[nodiscard]] QJsonObject stats() const;
+
+private:
+	struct Render {
+		VoicePersona persona;
+		QString hash;
+		QStringList chunks;
+		QPointer<QProcess> process;
+		std::unique_ptr<VoiceEncoder> encoder;
+		std::vector<Done> waiting;
+		QElapsedTimer started;
+		qint64 firstChunkMs = -1;
+	};
+
+	[[nodiscard]] QString modelPath(const VoicePersona &persona) const;
+	[[nodiscard]] int modelFrequency(const QString &model) const;
+	[[nodiscard]] std::optional<EncodedVoice> cached(
+		const QString &persona,
+		const QString &hash);
+	void store(
+		const QString &persona,
+		const QString &hash,
+		const EncodedVoice &voice);
+
+	void startQueued();
+	void start(const QString &key);
+	void readOutput(const QString &key);
+	void finished(
+		const QString &key,
+		bool success,
+		const QString &failure = QString());
+
+	QSqlDatabase _db;
+	QString _modelsPath;
+
+	std::map<QString, Render> _renders; // "persona\nhash"
+	std::deque<QString> _queue;
+	int _running = 0;
+
+	qint64 _requested = 0;
+	qint64 _cacheHits = 0;
+	qint64 _shared = 0;
+	qint64 _rendered = 0;
+	qint64 _failed = 0;
+	qint64 _lastFirstChunkMs = -1;
+	qint64 _lastRenderMs = -1;
+
+};
+
+} // namespace MCP
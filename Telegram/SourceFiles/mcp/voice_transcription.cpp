@@ -3,22 +3,96 @@
 
 #include "voice_transcription.h"
 
-#include <QtCore/QProcess>
+#include "voice_pcm.h"
+#include "core/file_location.h"
+
 #include <QtCore/QFile>
 #include <QtCore/QFileInfo>
 #include <QtCore/QJsonDocument>
 #include <QtCore/QJsonArray>
+#include <QtCore/QRegularExpression>
+#include <QtCore/QThreadPool>
+#include <QtCore/QTimer>
 #include <QtNetwork/QNetworkRequest>
 #include <QtNetwork/QNetworkReply>
 #include <QtNetwork/QHttpMultiPart>
 #include <QtSql/QSqlQuery>
 #include <QtSql/QSqlError>
 
+#include <algorithm>
+#include <limits>
+
 namespace MCP {
+namespace {
+
+constexpr auto kMaxFinishedJobs = 256;
+constexpr auto kMaxBatchSize = 32;
+constexpr auto kWhisperCppTimeoutPerFileMs = 60000;
+constexpr auto kDecodeThreads = 2;
+
+constexpr auto kTranscriptionsTable = R"(
+	CREATE TABLE IF NOT EXISTS voice_transcriptions (
+		id INTEGER PRIMARY KEY AUTOINCREMENT,
+		message_id INTEGER,
+		chat_id INTEGER NOT NULL DEFAULT 0,
+		document_id INTEGER,
+		voice_file_path TEXT,
+		transcription_text TEXT,
+		language TEXT,
+		confidence REAL,
+		duration_seconds REAL,
+		model TEXT,
+		created_at INTEGER DEFAULT (strftime('%s', 'now')),
+		UNIQUE(message_id)
+	)
+)";
+
+// Loads the model once, then answers one JSON line per request line.
+constexpr auto kPythonWorkerScript = R"(
+import base64
+import json
+import sys
+import numpy
+from faster_whisper import WhisperModel
+
+model = WhisperModel(sys.argv[1], device="cpu")
+print(json.dumps({"ready": True}), flush=True)
+
+for line in sys.stdin:
+    try:
+        request = json.loads(line)
+    except ValueError:
+        continue
+    try:
+        if "pcm" in request:
+            samples = base64.b64decode(request["pcm"])
+            audio = numpy.frombuffer(samples, dtype=numpy.int16)
+            audio = audio.astype(numpy.float32) / 32768.0
+        else:
+            audio = request["path"]
+        segments, info = model.transcribe(
+            audio,
+            language=request.get("language") or None)
+        result = {
+            "id": request["id"],
+            "text": " ".join(segment.text.strip() for segment in segments),
+            "language": info.language,
+            "confidence": info.language_probability,
+            "duration": info.duration,
+            "success": True,
+        }
+    except Exception as e:
+        result = {"id": request["id"], "success": False, "error": str(e)}
+    print(json.dumps(result), flush=True)
+)";
+
+} // namespace
 
 VoiceTranscription::VoiceTranscription(QObject *parent)
 	: QObject(parent)
-	, _networkManager(new QNetworkAccessManager(this)) {
+	, _networkManager(new QNetworkAccessManager(this))
+	, _decodePool(std::make_unique<QThreadPool>()) {
+	_decodePool->setMaxThreadCount(kDecodeThreads);
 }
 
 VoiceTranscription::~VoiceTranscription() {
@@ -33,6 +107,10 @@ bool VoiceTranscription::start(QSqlDatabase *db) {
 	_db = db;
 	_isRunning = true;
 
+	if (!initializeStorage()) {
+		qWarning() << "MCP: Voice transcriptions will not be cached";
+	}
+
 	return true;
 }
 
@@ -41,86 +119,388 @@ void VoiceTranscription::stop() {
 		return;
 	}
 
+	stopWorkers();
+	_jobs.clear();
+	_queue.clear();
+	_finished.clear();
+	_running.clear();
+
 	_db = nullptr;
 	_isRunning = false;
 }
 
-// Main transcription function
-TranscriptionResult VoiceTranscription::transcribe(const QString &audioFilePath) {
-	auto startTime = QDateTime::currentDateTime();
+bool VoiceTranscription::initializeStorage() {
+	if (!_db || !_db->isOpen()) {
+		return false;
+	}
 
-	TranscriptionResult result;
-	result.transcribedAt = startTime;
+	QSqlQuery query(*_db);
+	if (!query.exec(kTranscriptionsTable)) {
+		qWarning() << "MCP: Failed to create voice_transcriptions:" << query.lastError().text();
+		return false;
+	}
 
-	// Prepare audio file (convert if necessary)
-	QString preparedFile = prepareAudioFile(audioFilePath);
-	if (preparedFile.isEmpty()) {
-		result.success = false;
-		result.error = "Failed to prepare audio file";
-		return result;
+	// Tables created before the document cache get its column.
+	query.exec("SELECT COUNT(*) FROM pragma_table_info('voice_transcriptions') WHERE name = 'document_id'");
+	if (query.next() && !query.value(0).toInt()
+		&& !query.exec("ALTER TABLE voice_transcriptions ADD COLUMN document_id INTEGER")) {
+		qWarning() << "MCP: Failed to add document_id:" << query.lastError().text();
+		return false;
+	}
+	if (!query.exec("CREATE INDEX IF NOT EXISTS idx_voice_document ON voice_transcriptions(document_id)")) {
+		qWarning() << "MCP: Failed to index voice_transcriptions:" << query.lastError().text();
+		return false;
+	}
+	return true;
+}
+
+// Configuration
+
+void VoiceTranscription::setProvider(TranscriptionProvider provider) {
+	if (_provider != provider) {
+		_provider = provider;
+		restartWorkers();
 	}
+}
+
+void VoiceTranscription::setModelSize(WhisperModelSize size) {
+	if (_modelSize != size) {
+		_modelSize = size;
+		restartWorkers();
+	}
+}
+
+void VoiceTranscription::setWhisperModelPath(const QString &path) {
+	if (_whisperModelPath != path) {
+		_whisperModelPath = path;
+		restartWorkers();
+	}
+}
+
+void VoiceTranscription::setLanguage(const QString &language) {
+	// Sent with every request, only whisper.cpp gets it per process.
+	_language = language;
+}
+
+void VoiceTranscription::setMaxBatchSize(int size) {
+	_maxBatchSize = std::clamp(size, 1, kMaxBatchSize);
+	schedule();
+}
+
+// Job queue
+
+quint64 VoiceTranscription::pendingJob(quint64 documentId) const {
+	if (documentId) {
+		// The same voice message asked again while still on its way.
+		for (auto i = _jobs.cbegin(); i != _jobs.cend(); ++i) {
+			if (i->documentId == documentId && i->state != JobState::Finished) {
+				return i.key();
+			}
+		}
+	}
+	return 0;
+}
+
+quint64 VoiceTranscription::createJob(
+		quint64 documentId,
+		qint64 messageId,
+		qint64 chatId) {
+	const auto jobId = ++_jobAutoId;
+	auto &job = _jobs[jobId];
+	job.documentId = documentId;
+	job.messageId = messageId;
+	job.chatId = chatId;
+
+	if (!_isRunning) {
+		finishJob(jobId, failedResult("Voice transcription not started"));
+	} else if (const auto cached = cachedTranscription(documentId)) {
+		job.state = JobState::Finished;
+		job.result = *cached;
+		_finished.push_back(jobId);
+		Q_EMIT transcriptionCompleted(jobId, *cached);
+	}
+	return jobId;
+}
+
+quint64 VoiceTranscription::transcribeAsync(
+		const QString &audioFilePath,
+		quint64 documentId,
+		qint64 messageId,
+		qint64 chatId) {
+	if (const auto pending = pendingJob(documentId)) {
+		return pending;
+	}
+	const auto jobId = createJob(documentId, messageId, chatId);
+	auto &job = _jobs[jobId];
+	if (job.state == JobState::Queued) {
+		job.audioPath = audioFilePath;
+		_queue.push_back(jobId);
+		schedule();
+	}
+	return jobId;
+}
+
+quint64 VoiceTranscription::transcribeVoiceAsync(
+		const Core::FileLocation &file,
+		const QByteArray &data,
+		quint64 documentId,
+		qint64 messageId,
+		qint64 chatId) {
+	if (const auto pending = pendingJob(documentId)) {
+		return pending;
+	}
+	const auto jobId = createJob(documentId, messageId, chatId);
+	if (_jobs[jobId].state != JobState::Queued) {
+		return jobId;
+	}
+	_jobs[jobId].state = JobState::Decoding;
+
+	// Posted events die with this object and the pool is waited on
+	// before that, so the result never outlives the receiver.
+	_decodePool->start([=] {
+		auto pcm = DecodeVoicePcm(file, data);
+		QMetaObject::invokeMethod(this, [=, pcm = std::move(pcm)]() mutable {
+			decoded(jobId, std::move(pcm));
+		}, Qt::QueuedConnection);
+	});
+	return jobId;
+}
+
+void VoiceTranscription::decoded(quint64 jobId, QByteArray pcm) {
+	const auto i = _jobs.find(jobId);
+	if (i == _jobs.end() || i->state != JobState::Decoding) {
+		return;
+	} else if (pcm.isEmpty()) {
+		finishJob(jobId, failedResult("Failed to decode voice message"));
+		return;
+	}
+	if (i->documentId) {
+		Q_EMIT voiceDecoded(i->documentId, pcm);
+	}
+	i->pcm = std::move(pcm);
+	i->state = JobState::Queued;
+	_queue.push_back(jobId);
+	schedule();
+}
+
+QJsonObject VoiceTranscription::jobStatus(quint64 jobId) const {
+	const auto i = _jobs.constFind(jobId);
+	if (i == _jobs.cend()) {
+		return QJsonObject();
+	}
+
+	QJsonObject status;
+	switch (i->state) {
+	case JobState::Decoding:
+		status["status"] = "decoding";
+		break;
+	case JobState::Queued: {
+		status["status"] = "queued";
+		const auto position = std::find(_queue.begin(), _queue.end(), jobId);
+		status["queue_position"] = int(position - _queue.begin());
+	} break;
+	case JobState::Running:
+		status["status"] = "running";
+		break;
+	case JobState::Finished:
+		status = exportTranscription(i->result);
+		status["status"] = i->result.success ? "completed" : "failed";
+		break;
+	}
+	status["job_id"] = QString::number(jobId);
+	if (i->documentId) {
+		status["document_id"] = QString::number(i->documentId);
+	}
+	if (i->messageId) {
+		status["message_id"] = i->messageId;
+	}
+	return status;
+}
+
+int VoiceTranscription::pendingJobs() const {
+	return int(std::count_if(_jobs.cbegin(), _jobs.cend(), [](const Job &job) {
+		return job.state != JobState::Finished;
+	}));
+}
+
+std::vector<quint64> VoiceTranscription::takeQueued(
+		int limit,
+		bool singleSamples) {
+	auto result = std::vector<quint64>();
+	auto samples = false;
+	while (int(result.size()) < limit && !_queue.empty()) {
+		const auto jobId = _queue.front();
+		const auto i = _jobs.find(jobId);
+		if (i == _jobs.end() || i->state != JobState::Queued) {
+			_queue.pop_front();
+			continue;
+		} else if (singleSamples
+			&& !result.empty()
+			&& (samples || !i->pcm.isEmpty())) {
+			break;
+		}
+		_queue.pop_front();
+		if (i->pcm.isEmpty()) {
+			const auto prepared = prepareAudioFile(i->audioPath);
+			if (prepared.isEmpty()) {
+				finishJob(jobId, failedResult("Failed to prepare audio file"));
+				continue;
+			}
+			i->audioPath = prepared;
+		} else {
+			samples = true;
+		}
+		i->state = JobState::Running;
+		_running.push_back(jobId);
+		result.push_back(jobId);
+	}
+	return result;
+}
+
+void VoiceTranscription::schedule() {
+	if (!_isRunning) {
+		return;
+	}
+	const auto free = _maxBatchSize - int(_running.size());
 
-	// Call appropriate provider
 	switch (_provider) {
 	case TranscriptionProvider::OpenAI:
-		result = transcribeWithOpenAI(preparedFile);
-		result.provider = "OpenAI Whisper API";
+		for (const auto jobId : takeQueued(free)) {
+			startOpenAI(jobId);
+		}
 		break;
 
 	case TranscriptionProvider::WhisperCpp:
-		result = transcribeWithWhisperCpp(preparedFile);
-		result.provider = "whisper.cpp";
+		if (_running.empty()) {
+			auto batch = takeQueued(_maxBatchSize, true);
+			if (!batch.empty()) {
+				startWhisperCppBatch(std::move(batch));
+			}
+		}
 		break;
 
 	case TranscriptionProvider::Python:
-		result = transcribeWithPython(preparedFile);
-		result.provider = "Python (faster-whisper)";
+		if (free > 0 && !_queue.empty() && ensurePythonWorker()) {
+			for (const auto jobId : takeQueued(free)) {
+				sendToPythonWorker(jobId);
+			}
+		}
 		break;
 	}
+}
+
+void VoiceTranscription::finishJob(quint64 jobId, TranscriptionResult result) {
+	_running.erase(
+		std::remove(_running.begin(), _running.end(), jobId),
+		_running.end());
+
+	const auto i = _jobs.find(jobId);
+	if (i == _jobs.end() || i->state == JobState::Finished) {
+		return;
+	}
+	if (!result.transcribedAt.isValid()) {
+		result.transcribedAt = QDateTime::currentDateTime();
+	}
+	i->state = JobState::Finished;
+	i->result = result;
+	i->pcm = QByteArray();
 
 	// Update statistics
 	if (result.success) {
 		_stats.successfulTranscriptions++;
 		_stats.languageDistribution[result.language]++;
+		_stats.avgDuration = (_stats.avgDuration * (_stats.successfulTranscriptions - 1) +
+		                      result.durationSeconds) / _stats.successfulTranscriptions;
 	} else {
 		_stats.failedTranscriptions++;
 	}
 	_stats.totalTranscriptions++;
 	_stats.lastTranscribed = QDateTime::currentDateTime();
 
-	// Calculate average duration
-	if (_stats.successfulTranscriptions > 0) {
-		_stats.avgDuration = (_stats.avgDuration * (_stats.successfulTranscriptions - 1) +
-		                      result.durationSeconds) / _stats.successfulTranscriptions;
+	if (result.success && (i->messageId > 0 || i->documentId)) {
+		storeTranscription(i->messageId, i->chatId, result, i->documentId);
 	}
 
-	Q_EMIT transcriptionCompleted(result);
+	_finished.push_back(jobId);
+	while (int(_finished.size()) > kMaxFinishedJobs) {
+		_jobs.remove(_finished.front());
+		_finished.pop_front();
+	}
 
-	return result;
+	if (result.success) {
+		Q_EMIT transcriptionCompleted(jobId, result);
+	} else {
+		Q_EMIT transcriptionFailed(jobId, result.error);
+	}
 }
 
-// Async transcription (returns immediately)
-TranscriptionResult VoiceTranscription::transcribeAsync(const QString &audioFilePath) {
-	// TODO: Implement async transcription in separate thread
-	// For now, just call synchronous version
-	return transcribe(audioFilePath);
+void VoiceTranscription::failRunning(const QString &error) {
+	const auto running = _running;
+	for (const auto jobId : running) {
+		finishJob(jobId, failedResult(error));
+	}
 }
 
-// OpenAI Whisper API implementation
-TranscriptionResult VoiceTranscription::transcribeWithOpenAI(const QString &audioFilePath) {
+TranscriptionResult VoiceTranscription::failedResult(const QString &error) const {
 	TranscriptionResult result;
 	result.success = false;
-	result.modelUsed = "whisper-1";
+	result.error = error;
+	result.modelUsed = getModelName(_modelSize);
+	return result;
+}
 
+void VoiceTranscription::restartWorkers() {
+	stopWorkers();
+
+	// Requests already sent are asked again from the new worker.
+	for (auto i = _running.rbegin(); i != _running.rend(); ++i) {
+		const auto job = _jobs.find(*i);
+		if (job != _jobs.end() && job->state == JobState::Running) {
+			job->state = JobState::Queued;
+			_queue.push_front(*i);
+		}
+	}
+	_running.clear();
+	schedule();
+}
+
+void VoiceTranscription::stopWorkers() {
+	if (const auto worker = _pythonWorker.data()) {
+		disconnect(worker, nullptr, this, nullptr);
+		worker->kill();
+		worker->waitForFinished(1000);
+		delete worker;
+	}
+	_pythonBuffer.clear();
+	_pythonReady = false;
+
+	if (const auto process = _whisperCpp.data()) {
+		disconnect(process, nullptr, this, nullptr);
+		process->kill();
+		process->waitForFinished(1000);
+		delete process;
+	}
+	_whisperCppBatch.clear();
+}
+
+// OpenAI Whisper API implementation
+void VoiceTranscription::startOpenAI(quint64 jobId) {
+	const auto fail = [&](const QString &error) {
+		auto result = failedResult(error);
+		result.modelUsed = "whisper-1";
+		finishJob(jobId, result);
+	};
 	if (_openaiApiKey.isEmpty()) {
-		result.error = "OpenAI API key not configured";
-		return result;
+		fail("OpenAI API key not configured");
+		return;
 	}
 
-	QFile audioFile(audioFilePath);
-	if (!audioFile.open(QIODevice::ReadOnly)) {
-		result.error = "Failed to open audio file";
-		return result;
+	const auto &job = _jobs[jobId];
+	const auto samples = !job.pcm.isEmpty();
+	QFile audioFile(job.audioPath);
+	if (!samples && !audioFile.open(QIODevice::ReadOnly)) {
+		fail("Failed to open audio file");
+		return;
 	}
 
 	// Create multipart form data
@@ -128,14 +508,20 @@ TranscriptionResult VoiceTranscription::transcribeWithOpenAI(const QString &audi
 
 	// Add file
 	QHttpPart filePart;
-	filePart.setHeader(QNetworkRequest::ContentTypeHeader, QVariant("audio/ogg"));
-	filePart.setHeader(QNetworkRequest::ContentDispositionHeader,
-	                   QVariant("form-data; name=\"file\"; filename=\"audio.ogg\""));
-	filePart.setBody(audioFile.readAll());
+	if (samples) {
+		filePart.setHeader(QNetworkRequest::ContentTypeHeader, QVariant("audio/wav"));
+		filePart.setHeader(QNetworkRequest::ContentDispositionHeader,
+		                   QVariant("form-data; name=\"file\"; filename=\"audio.wav\""));
+		filePart.setBody(WavFromVoicePcm(job.pcm));
+	} else {
+		filePart.setHeader(QNetworkRequest::ContentTypeHeader, QVariant("audio/ogg"));
+		filePart.setHeader(QNetworkRequest::ContentDispositionHeader,
+		                   QVariant("form-data; name=\"file\"; filename=\"audio.ogg\""));
+		filePart.setBody(audioFile.readAll());
+		audioFile.close();
+	}
 	multiPart->append(filePart);
 
-	audioFile.close();
-
 	// Add model
 	QHttpPart modelPart;
 	modelPart.setHeader(QNetworkRequest::ContentDispositionHeader,
@@ -156,123 +542,245 @@ TranscriptionResult VoiceTranscription::transcribeWithOpenAI(const QString &audi
 	QNetworkRequest request(QUrl("https://api.openai.com/v1/audio/transcriptions"));
 	request.setRawHeader("Authorization", QString("Bearer %1").arg(_openaiApiKey).toUtf8());
 
-	// Send request
 	QNetworkReply *reply = _networkManager->post(request, multiPart);
 	multiPart->setParent(reply);
 
-	// Wait for response (blocking)
-	QEventLoop loop;
-	connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
-	loop.exec();
-
-	if (reply->error() != QNetworkReply::NoError) {
-		result.error = "API request failed: " + reply->errorString();
+	connect(reply, &QNetworkReply::finished, this, [=] {
 		reply->deleteLater();
-		return result;
-	}
-
-	// Parse response
-	QByteArray response = reply->readAll();
-	reply->deleteLater();
 
-	QJsonDocument doc = QJsonDocument::fromJson(response);
-	if (!doc.isObject()) {
-		result.error = "Invalid API response";
-		return result;
-	}
-
-	QJsonObject obj = doc.object();
-	result.text = obj["text"].toString();
-	result.language = obj.value("language").toString("unknown");
-	result.confidence = estimateConfidence(result.text);
-	result.durationSeconds = 0.0f;  // OpenAI doesn't return duration
-	result.success = !result.text.isEmpty();
-
-	return result;
+		TranscriptionResult result;
+		result.modelUsed = "whisper-1";
+		result.provider = "OpenAI Whisper API";
+		if (reply->error() != QNetworkReply::NoError) {
+			result.error = "API request failed: " + reply->errorString();
+		} else {
+			const auto doc = QJsonDocument::fromJson(reply->readAll());
+			if (!doc.isObject()) {
+				result.error = "Invalid API response";
+			} else {
+				const auto obj = doc.object();
+				result.text = obj["text"].toString();
+				result.language = obj.value("language").toString("unknown");
+				result.confidence = estimateConfidence(result.text);
+				result.durationSeconds = 0.0f;  // OpenAI doesn't return duration
+				result.success = !result.text.isEmpty();
+			}
+		}
+		finishJob(jobId, result);
+		schedule();
+	});
 }
 
 // Whisper.cpp implementation
-TranscriptionResult VoiceTranscription::transcribeWithWhisperCpp(const QString &audioFilePath) {
-	TranscriptionResult result;
-	result.success = false;
-
+void VoiceTranscription::startWhisperCppBatch(std::vector<quint64> jobIds) {
 	if (_whisperModelPath.isEmpty()) {
-		result.error = "Whisper model path not configured";
-		return result;
+		for (const auto jobId : jobIds) {
+			finishJob(jobId, failedResult("Whisper model path not configured"));
+		}
+		return;
 	}
 
-	QString modelName = getModelName(_modelSize);
-	result.modelUsed = "whisper.cpp (" + modelName + ")";
-
-	// Execute whisper.cpp
-	QString output = executeWhisperCpp(audioFilePath, _whisperModelPath);
-
-	if (output.isEmpty()) {
-		result.error = "whisper.cpp execution failed";
-		return result;
+	// One model load for the batch, every input file gets its own
+	// <file>.txt, while samples come as WAV on stdin and go to stdout.
+	const auto samples = _jobs.value(jobIds.front()).pcm;
+	QStringList args;
+	args << "-m" << _whisperModelPath;
+	if (!_language.isEmpty()) {
+		args << "-l" << _language;
 	}
-
-	// Parse output (whisper.cpp outputs plain text + metadata)
-	// Format: "[LANGUAGE: en] Transcribed text here"
-	QRegularExpression langRegex(R"(\[LANGUAGE:\s*(\w+)\])");
-	QRegularExpressionMatch match = langRegex.match(output);
-
-	if (match.hasMatch()) {
-		result.language = match.captured(1);
-		result.text = output.mid(match.capturedEnd()).trimmed();
+	if (!samples.isEmpty()) {
+		args << "--no-timestamps" << "-f" << "-";
 	} else {
-		result.language = _language.isEmpty() ? "unknown" : _language;
-		result.text = output.trimmed();
+		args << "--output-txt";
+		for (const auto jobId : jobIds) {
+			const auto path = _jobs.value(jobId).audioPath;
+			QFile::remove(path + ".txt");
+			args << "-f" << path;
+		}
 	}
 
-	result.confidence = estimateConfidence(result.text);
-	result.success = !result.text.isEmpty();
-
-	return result;
+	_whisperCppBatch = std::move(jobIds);
+	const auto process = new QProcess(this);
+	_whisperCpp = process;
+	connect(process, &QProcess::finished, this, &VoiceTranscription::whisperCppFinished);
+	connect(process, &QProcess::errorOccurred, this, [=](QProcess::ProcessError error) {
+		if (error == QProcess::FailedToStart) {
+			whisperCppFinished(-1, QProcess::CrashExit);
+		}
+	});
+	QTimer::singleShot(
+		kWhisperCppTimeoutPerFileMs * int(_whisperCppBatch.size()),
+		process,
+		[=] { process->kill(); });
+	process->start("whisper", args);
+	if (!samples.isEmpty()) {
+		process->write(WavFromVoicePcm(samples));
+		process->closeWriteChannel();
+	}
 }
 
-// Python subprocess implementation
-TranscriptionResult VoiceTranscription::transcribeWithPython(const QString &audioFilePath) {
-	TranscriptionResult result;
-	result.success = false;
-
-	QString modelName = getModelName(_modelSize);
-	result.modelUsed = "faster-whisper (" + modelName + ")";
-
-	// Execute Python script
-	QString output = executePythonWhisper(audioFilePath);
+void VoiceTranscription::whisperCppFinished(int exitCode, QProcess::ExitStatus status) {
+	const auto process = _whisperCpp.data();
+	if (!process) {
+		return;
+	}
+	const auto batch = std::exchange(_whisperCppBatch, {});
+	const auto log = QString::fromUtf8(process->readAllStandardError());
+	const auto output = QString::fromUtf8(process->readAllStandardOutput());
+	disconnect(process, nullptr, this, nullptr);
+	process->deleteLater();
+	_whisperCpp = nullptr;
+
+	// Detected languages are logged in the order of the inputs.
+	auto languages = QStringList();
+	static const auto languageRegex = QRegularExpression(
+		R"(auto-detected language:\s*(\w+))");
+	for (auto i = languageRegex.globalMatch(log); i.hasNext();) {
+		languages.push_back(i.next().captured(1));
+	}
 
-	if (output.isEmpty()) {
-		result.error = "Python whisper execution failed";
-		return result;
+	const auto finished = (status == QProcess::NormalExit && exitCode == 0);
+	auto index = 0;
+	for (const auto jobId : batch) {
+		const auto &job = _jobs[jobId];
+		TranscriptionResult result;
+		result.modelUsed = "whisper.cpp (" + getModelName(_modelSize) + ")";
+		result.provider = "whisper.cpp";
+		if (!job.pcm.isEmpty()) {
+			result.text = output.simplified();
+		} else if (QFile text(job.audioPath + ".txt"); text.open(QIODevice::ReadOnly)) {
+			result.text = QString::fromUtf8(text.readAll()).trimmed();
+			text.close();
+			text.remove();
+		}
+		result.language = (index < languages.size())
+			? languages[index]
+			: (_language.isEmpty() ? "unknown" : _language);
+		++index;
+		result.confidence = estimateConfidence(result.text);
+		result.success = !result.text.isEmpty();
+		if (!result.success) {
+			result.error = finished
+				? "whisper.cpp returned no text"
+				: "whisper.cpp execution failed";
+		}
+		finishJob(jobId, result);
 	}
+	schedule();
+}
 
-	// Parse JSON output from Python script
-	QJsonDocument doc = QJsonDocument::fromJson(output.toUtf8());
-	if (!doc.isObject()) {
-		result.error = "Invalid Python output";
-		return result;
+// Python worker implementation
+bool VoiceTranscription::ensurePythonWorker() {
+	if (_pythonWorker) {
+		return true;
 	}
+	_pythonBuffer.clear();
+	_pythonReady = false;
+
+	const auto worker = new QProcess(this);
+	_pythonWorker = worker;
+	connect(worker, &QProcess::readyReadStandardOutput, this, &VoiceTranscription::readPythonWorker);
+	connect(worker, &QProcess::finished, this, [=] { pythonWorkerFinished(); });
+	connect(worker, &QProcess::errorOccurred, this, [=](QProcess::ProcessError error) {
+		if (error == QProcess::FailedToStart) {
+			pythonWorkerFinished();
+		}
+	});
+	worker->start("python3", {
+		"-u",
+		"-c",
+		QString::fromUtf8(kPythonWorkerScript),
+		getModelName(_modelSize),
+	});
+	return true;
+}
 
-	QJsonObject obj = doc.object();
-	result.text = obj["text"].toString();
-	result.language = obj["language"].toString();
-	result.confidence = obj["confidence"].toDouble();
-	result.durationSeconds = obj["duration"].toDouble();
-	result.success = obj["success"].toBool();
+void VoiceTranscription::sendToPythonWorker(quint64 jobId) {
+	const auto &job = _jobs[jobId];
+	auto request = QJsonObject{
+		{ "id", qint64(jobId) },
+		{ "language", _language },
+	};
+	if (job.pcm.isEmpty()) {
+		request["path"] = job.audioPath;
+	} else {
+		request["pcm"] = QString::fromLatin1(job.pcm.toBase64());
+	}
+	_pythonWorker->write(QJsonDocument(request).toJson(QJsonDocument::Compact) + '\n');
+}
 
-	if (!result.success) {
-		result.error = obj["error"].toString();
+void VoiceTranscription::readPythonWorker() {
+	if (!_pythonWorker) {
+		return;
 	}
+	_pythonBuffer += _pythonWorker->readAllStandardOutput();
+
+	const auto modelName = getModelName(_modelSize);
+	auto from = 0;
+	for (auto newline = _pythonBuffer.indexOf('\n'); newline >= 0;) {
+		const auto line = _pythonBuffer.mid(from, newline - from);
+		from = newline + 1;
+		newline = _pythonBuffer.indexOf('\n', from);
+
+		const auto obj = QJsonDocument::fromJson(line).object();
+		if (obj.value("ready").toBool()) {
+			_pythonReady = true;
+			continue;
+		} else if (!obj.contains("id")) {
+			continue;
+		}
+		TranscriptionResult result;
+		result.text = obj["text"].toString();
+		result.language = obj["language"].toString();
+		result.confidence = obj["confidence"].toDouble();
+		result.durationSeconds = obj["duration"].toDouble();
+		result.modelUsed = "faster-whisper (" + modelName + ")";
+		result.provider = "Python (faster-whisper)";
+		result.success = obj["success"].toBool();
+		if (!result.success) {
+			result.error = obj["error"].toString();
+		}
+		finishJob(quint64(obj["id"].toInteger()), result);
+	}
+	_pythonBuffer.remove(0, from);
+	schedule();
+}
 
-	return result;
+void VoiceTranscription::pythonWorkerFinished() {
+	const auto worker = _pythonWorker.data();
+	if (!worker) {
+		return;
+	}
+	const auto log = QString::fromUtf8(worker->readAllStandardError()).trimmed();
+	const auto wasReady = _pythonReady;
+	disconnect(worker, nullptr, this, nullptr);
+	worker->deleteLater();
+	_pythonWorker = nullptr;
+	_pythonBuffer.clear();
+	_pythonReady = false;
+
+	const auto error = "faster-whisper worker exited"
+		+ (log.isEmpty() ? QString() : (": " + log.right(500)));
+	qWarning() << "MCP:" << error;
+	failRunning(error);
+
+	// A worker that never loaded the model fails the same way next time.
+	if (!wasReady) {
+		while (!_queue.empty()) {
+			const auto jobId = _queue.front();
+			_queue.pop_front();
+			finishJob(jobId, failedResult(error));
+		}
+	}
+	schedule();
 }
 
 // Store transcription in database
 bool VoiceTranscription::storeTranscription(
 		qint64 messageId,
 		qint64 chatId,
-		const TranscriptionResult &result) {
+		const TranscriptionResult &result,
+		quint64 documentId) {
 
 	if (!_db || !_db->isOpen()) {
 		return false;
@@ -281,16 +789,17 @@ bool VoiceTranscription::storeTranscription(
 	QSqlQuery query(*_db);
 	query.prepare(R"(
 		INSERT OR REPLACE INTO voice_transcriptions (
-			message_id, chat_id, transcription_text, language,
+			message_id, chat_id, document_id, transcription_text, language,
 			confidence, duration_seconds, model, created_at
 		) VALUES (
-			:message_id, :chat_id, :text, :language,
+			:message_id, :chat_id, :document_id, :text, :language,
 			:confidence, :duration, :model, :created_at
 		)
 	)");
 
-	query.bindValue(":message_id", messageId);
+	query.bindValue(":message_id", messageId > 0 ? QVariant(messageId) : QVariant());
 	query.bindValue(":chat_id", chatId);
+	query.bindValue(":document_id", documentId ? QVariant(qint64(documentId)) : QVariant());
 	query.bindValue(":text", result.text);
 	query.bindValue(":language", result.language);
 	query.bindValue(":confidence", result.confidence);
@@ -298,7 +807,11 @@ bool VoiceTranscription::storeTranscription(
 	query.bindValue(":model", result.modelUsed);
 	query.bindValue(":created_at", result.transcribedAt.toSecsSinceEpoch());
 
-	return query.exec();
+	if (!query.exec()) {
+		qWarning() << "MCP: Failed to store transcription:" << query.lastError().text();
+		return false;
+	}
+	return true;
 }
 
 // Get stored transcription
@@ -327,6 +840,38 @@ TranscriptionResult VoiceTranscription::getStoredTranscription(qint64 messageId)
 	return result;
 }
 
+std::optional<TranscriptionResult> VoiceTranscription::cachedTranscription(
+		quint64 documentId) {
+	if (!documentId || !_db || !_db->isOpen()) {
+		return std::nullopt;
+	}
+
+	QSqlQuery query(*_db);
+	query.prepare(R"(
+		SELECT transcription_text, language, confidence, duration_seconds,
+			model, created_at
+		FROM voice_transcriptions
+		WHERE document_id = :document_id
+		ORDER BY created_at DESC
+		LIMIT 1
+	)");
+	query.bindValue(":document_id", qint64(documentId));
+	if (!query.exec() || !query.next()) {
+		return std::nullopt;
+	}
+
+	TranscriptionResult result;
+	result.text = query.value(0).toString();
+	result.language = query.value(1).toString();
+	result.confidence = query.value(2).toFloat();
+	result.durationSeconds = query.value(3).toFloat();
+	result.modelUsed = query.value(4).toString();
+	result.transcribedAt = QDateTime::fromSecsSinceEpoch(query.value(5).toLongLong());
+	result.provider = "cache";
+	result.success = true;
+	return result;
+}
+
 // Check if transcription exists
 bool VoiceTranscription::hasTranscription(qint64 messageId) {
 	if (!_db || !_db->isOpen()) {
@@ -350,7 +895,7 @@ VoiceTranscription::TranscriptionStats VoiceTranscription::getStats() const {
 }
 
 // Export transcription
-QJsonObject VoiceTranscription::exportTranscription(const TranscriptionResult &result) {
+QJsonObject VoiceTranscription::exportTranscription(const TranscriptionResult &result) const {
 	QJsonObject json;
 	json["text"] = result.text;
 	json["language"] = result.language;
@@ -400,72 +945,4 @@ float VoiceTranscription::estimateConfidence(const QString &text) const {
 	return 0.9f;
 }
 
-// OpenAI API helper
-QJsonObject VoiceTranscription::callOpenAIWhisperAPI(const QString &audioFilePath) {
-	// Implemented in transcribeWithOpenAI
-	Q_UNUSED(audioFilePath);
-	return QJsonObject();
-}
-
-// Whisper.cpp helper
-QString VoiceTranscription::executeWhisperCpp(const QString &audioPath, const QString &modelPath) {
-	QProcess process;
-
-	QStringList args;
-	args << "-m" << modelPath;
-	args << "-f" << audioPath;
-	args << "--output-txt";
-
-	if (!_language.isEmpty()) {
-		args << "-l" << _language;
-	}
-
-	process.start("whisper", args);
-	process.waitForFinished(60000);  // 60 second timeout
-
-	if (process.exitStatus() != QProcess::NormalExit) {
-		return QString();
-	}
-
-	return QString::fromUtf8(process.readAllStandardOutput());
-}
-
-// Python subprocess helper
-QString VoiceTranscription::executePythonWhisper(const QString &audioPath) {
-	QProcess process;
-
-	QString modelName = getModelName(_modelSize);
-
-	QStringList args;
-	args << "-c";
-	args << QString(R"(
-import json
-from faster_whisper import WhisperModel
-
-model = WhisperModel("%1", device="cpu")
-segments, info = model.transcribe("%2", language="%3" if "%3" else None)
-
-text = " ".join([segment.text for segment in segments])
-
-result = {
-    "text": text,
-    "language": info.language,
-    "confidence": info.language_probability,
-    "duration": info.duration,
-    "success": True
-}
-
-print(json.dumps(result))
-	)").arg(modelName, audioPath, _language);
-
-	process.start("python3", args);
-	process.waitForFinished(60000);  // 60 second timeout
-
-	if (process.exitStatus() != QProcess::NormalExit) {
-		return QString();
-	}
-
-	return QString::fromUtf8(process.readAllStandardOutput());
-}
-
 } // namespace MCP
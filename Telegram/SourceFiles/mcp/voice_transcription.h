@@ -6,9 +6,24 @@
 #include <QtCore/QObject>
 #include <QtCore/QString>
 #include <QtCore/QJsonObject>
+#include <QtCore/QDateTime>
+#include <QtCore/QHash>
+#include <QtCore/QPointer>
+#include <QtCore/QProcess>
 #include <QtNetwork/QNetworkAccessManager>
 #include <QtSql/QSqlDatabase>
 
+class QThreadPool;
+
+namespace Core {
+class FileLocation;
+} // namespace Core
+
+#include <deque>
+#include <memory>
+#include <optional>
+#include <vector>
+
 namespace MCP {
 
 // Transcription provider
@@ -31,16 +46,26 @@ enum class WhisperModelSize {
 struct TranscriptionResult {
 	QString text;
 	QString language;
-	float confidence;
-	float durationSeconds;
+	float confidence = 0.0f;
+	float durationSeconds = 0.0f;
 	QString modelUsed;
 	QDateTime transcribedAt;
 	QString provider;
-	bool success;
+	bool success = false;
 	QString error;
 };
 
 // Voice transcription service
+//
+// Files are transcribed by jobs queued with transcribeAsync(), nothing
+// waits for a model. The faster-whisper path keeps one python3 worker
+// with the model loaded and pipes it a JSON request per line, several
+// of them in flight. whisper.cpp gets a batch of files per process, so
+// the model loads once a batch, and OpenAI gets concurrent requests.
+// A result is stored in voice_transcriptions under its document id and
+// later jobs for the same document are answered from there. Voice notes
+// from the media cache are decoded in memory to 16 kHz samples on a
+// background thread and handed to the model without any temp file.
 class VoiceTranscription : public QObject {
 	Q_OBJECT
 
@@ -53,25 +78,42 @@ public:
 	void stop();
 	[[nodiscard]] bool isRunning() const { return _isRunning; }
 
-	// Configuration
-	void setProvider(TranscriptionProvider provider) { _provider = provider; }
-	void setModelSize(WhisperModelSize size) { _modelSize = size; }
+	// Configuration, a running worker is restarted by the next job
+	void setProvider(TranscriptionProvider provider);
+	void setModelSize(WhisperModelSize size);
 	void setOpenAIKey(const QString &apiKey) { _openaiApiKey = apiKey; }
-	void setWhisperModelPath(const QString &path) { _whisperModelPath = path; }
-	void setLanguage(const QString &language) { _language = language; }
-
-	// Transcription
-	TranscriptionResult transcribe(const QString &audioFilePath);
-	TranscriptionResult transcribeAsync(const QString &audioFilePath);
-
-	// Provider-specific implementations
-	TranscriptionResult transcribeWithOpenAI(const QString &audioFilePath);
-	TranscriptionResult transcribeWithWhisperCpp(const QString &audioFilePath);
-	TranscriptionResult transcribeWithPython(const QString &audioFilePath);
+	void setWhisperModelPath(const QString &path);
+	void setLanguage(const QString &language);
+	void setMaxBatchSize(int size);
+
+	// Transcription, returns the job id
+	quint64 transcribeAsync(
+		const QString &audioFilePath,
+		quint64 documentId = 0,
+		qint64 messageId = 0,
+		qint64 chatId = 0);
+
+	// From the document bytes, or the cached file when they're not kept.
+	quint64 transcribeVoiceAsync(
+		const Core::FileLocation &file,
+		const QByteArray &data,
+		quint64 documentId,
+		qint64 messageId = 0,
+		qint64 chatId = 0);
+
+	// "decoding", "queued", "running", "completed" or "failed" with the result,
+	// empty for an unknown or long forgotten job.
+	[[nodiscard]] QJsonObject jobStatus(quint64 jobId) const;
+	[[nodiscard]] int pendingJobs() const;
 
 	// Storage
-	bool storeTranscription(qint64 messageId, qint64 chatId, const TranscriptionResult &result);
+	bool storeTranscription(
+		qint64 messageId,
+		qint64 chatId,
+		const TranscriptionResult &result,
+		quint64 documentId = 0);
 	TranscriptionResult getStoredTranscription(qint64 messageId);
+	std::optional<TranscriptionResult> cachedTranscription(quint64 documentId);
 	bool hasTranscription(qint64 messageId);
 
 	// Statistics
@@ -87,27 +129,67 @@ public:
 	[[nodiscard]] TranscriptionStats getStats() const;
 
 	// Export
-	QJsonObject exportTranscription(const TranscriptionResult &result);
+	[[nodiscard]] QJsonObject exportTranscription(const TranscriptionResult &result) const;
 
 Q_SIGNALS:
-	void transcriptionCompleted(const TranscriptionResult &result);
-	void transcriptionFailed(const QString &error);
+	void transcriptionCompleted(quint64 jobId, const TranscriptionResult &result);
+	void transcriptionFailed(quint64 jobId, const QString &error);
+	// Samples of a voice note decoded for a job, for other users of them.
+	void voiceDecoded(quint64 documentId, const QByteArray &pcm);
 	void progress(int percentage);
 
 private:
+	enum class JobState {
+		Decoding,
+		Queued,
+		Running,
+		Finished,
+	};
+	struct Job {
+		QString audioPath;
+		QByteArray pcm; // 16 kHz mono s16le, instead of the file.
+		quint64 documentId = 0;
+		qint64 messageId = 0;
+		qint64 chatId = 0;
+		JobState state = JobState::Queued;
+		TranscriptionResult result;
+	};
+
+	bool initializeStorage();
+	[[nodiscard]] quint64 pendingJob(quint64 documentId) const;
+	[[nodiscard]] quint64 createJob(
+		quint64 documentId,
+		qint64 messageId,
+		qint64 chatId);
+	void decoded(quint64 jobId, QByteArray pcm);
+	void schedule();
+	void finishJob(quint64 jobId, TranscriptionResult result);
+	void failRunning(const QString &error);
+	[[nodiscard]] TranscriptionResult failedResult(const QString &error) const;
+	// Samples can't share a whisper.cpp process with files or each other.
+	[[nodiscard]] std::vector<quint64> takeQueued(
+		int limit,
+		bool singleSamples = false);
+
 	// Helper functions
 	QString prepareAudioFile(const QString &inputPath);
 	QString getModelName(WhisperModelSize size) const;
 	float estimateConfidence(const QString &text) const;
 
-	// OpenAI API helpers
-	QJsonObject callOpenAIWhisperAPI(const QString &audioFilePath);
+	// OpenAI API, one request per job
+	void startOpenAI(quint64 jobId);
 
-	// Whisper.cpp helpers
-	QString executeWhisperCpp(const QString &audioPath, const QString &modelPath);
+	// whisper.cpp, one process per batch of files or samples on stdin
+	void startWhisperCppBatch(std::vector<quint64> jobIds);
+	void whisperCppFinished(int exitCode, QProcess::ExitStatus status);
 
-	// Python subprocess helpers
-	QString executePythonWhisper(const QString &audioPath);
+	// faster-whisper, one long-lived worker fed through stdin
+	bool ensurePythonWorker();
+	void sendToPythonWorker(quint64 jobId);
+	void readPythonWorker();
+	void pythonWorkerFinished();
+	void stopWorkers();
+	void restartWorkers();
 
 	QSqlDatabase *_db = nullptr;
 	QNetworkAccessManager *_networkManager = nullptr;
@@ -119,8 +201,23 @@ private:
 	QString _openaiApiKey;
 	QString _whisperModelPath;
 	QString _language;  // Force specific language (empty = auto-detect)
+	int _maxBatchSize = 4;
+
+	QHash<quint64, Job> _jobs;
+	std::deque<quint64> _queue;
+	std::deque<quint64> _finished; // Oldest first, trimmed.
+	std::vector<quint64> _running;
+	quint64 _jobAutoId = 0;
+
+	QPointer<QProcess> _pythonWorker;
+	QByteArray _pythonBuffer;
+	bool _pythonReady = false;
+	QPointer<QProcess> _whisperCpp;
+	std::vector<quint64> _whisperCppBatch;
 
 	TranscriptionStats _stats;
+
+	std::unique_ptr<QThreadPool> _decodePool; // Last, waited on first.
 };
 
 } // namespace MCP
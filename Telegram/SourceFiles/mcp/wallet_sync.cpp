@@ -0,0 +1,471 @@
+// MCP Wallet Sync - Stars transactions mirrored into wallet_spending
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "wallet_sync.h"
+
+#include "database_pool.h"
+#include "mcp_helpers.h"
+#include "api/api_credits.h"
+#include "data/components/credits.h"
+#include "data/data_credits.h"
+#include "data/data_user.h"
+#include "main/main_session.h"
+
+#include <QtCore/QDateTime>
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+
+#include <array>
+
+namespace MCP {
+namespace {
+
+constexpr auto kRefreshDelay = 1000; // ms, balance updates come in bursts.
+constexpr auto kBackfillDelay = 2000; // ms between backfill pages.
+constexpr auto kRetryDelay = 60 * 1000;
+
+constexpr auto kSpendingTable = R"(
+	CREATE TABLE IF NOT EXISTS wallet_spending (
+		id INTEGER PRIMARY KEY AUTOINCREMENT,
+		transaction_id TEXT,
+		date TEXT,
+		amount REAL NOT NULL,
+		balance REAL,
+		category TEXT NOT NULL,
+		description TEXT,
+		peer_id INTEGER
+	)
+)";
+
+// Tables created from an older schema.sql lack these.
+constexpr auto kSpendingColumns = std::array{
+	"transaction_id TEXT",
+	"date TEXT",
+	"balance REAL",
+	"peer_id INTEGER",
+};
+
+constexpr auto kSpendingIndices = std::array{
+	R"(CREATE UNIQUE INDEX IF NOT EXISTS idx_wallet_spending_transaction
+		ON wallet_spending(transaction_id))",
+	R"(CREATE INDEX IF NOT EXISTS idx_wallet_spending_date
+		ON wallet_spending(date))",
+	R"(CREATE INDEX IF NOT EXISTS idx_wallet_spending_category
+		ON wallet_spending(category, date))",
+};
+
+constexpr auto kMonthlyTable = R"(
+	CREATE TABLE IF NOT EXISTS wallet_spending_monthly (
+		month TEXT NOT NULL,
+		category TEXT NOT NULL,
+		spent REAL NOT NULL DEFAULT 0,
+		income REAL NOT NULL DEFAULT 0,
+		transactions INTEGER NOT NULL DEFAULT 0,
+		PRIMARY KEY (month, category)
+	) WITHOUT ROWID
+)";
+
+constexpr auto kMonthlyFill = R"(
+	INSERT INTO wallet_spending_monthly
+		(month, category, spent, income, transactions)
+	SELECT substr(date, 1, 7), category,
+		SUM(CASE WHEN amount < 0 THEN -amount ELSE 0 END),
+		SUM(CASE WHEN amount > 0 THEN amount ELSE 0 END),
+		COUNT(*)
+	FROM wallet_spending
+	WHERE date IS NOT NULL
+	GROUP BY substr(date, 1, 7), category
+)";
+
+// Row changes adjust the totals of their month, categorize_transaction
+// moves a row between categories.
+constexpr auto kMonthlyTriggers = std::array{
+	R"(CREATE TRIGGER IF NOT EXISTS wallet_spending_monthly_insert
+	AFTER INSERT ON wallet_spending WHEN NEW.date IS NOT NULL BEGIN
+		INSERT OR IGNORE INTO wallet_spending_monthly (month, category)
+		VALUES (substr(NEW.date, 1, 7), NEW.category);
+		UPDATE wallet_spending_monthly SET
+			spent = spent + MAX(-NEW.amount, 0),
+			income = income + MAX(NEW.amount, 0),
+			transactions = transactions + 1
+		WHERE month = substr(NEW.date, 1, 7) AND category = NEW.category;
+	END)",
+	R"(CREATE TRIGGER IF NOT EXISTS wallet_spending_monthly_delete
+	AFTER DELETE ON wallet_spending WHEN OLD.date IS NOT NULL BEGIN
+		UPDATE wallet_spending_monthly SET
+			spent = spent - MAX(-OLD.amount, 0),
+			income = income - MAX(OLD.amount, 0),
+			transactions = transactions - 1
+		WHERE month = substr(OLD.date, 1, 7) AND category = OLD.category;
+	END)",
+	R"(CREATE TRIGGER IF NOT EXISTS wallet_spending_monthly_update
+	AFTER UPDATE OF amount, category, date ON wallet_spending BEGIN
+		UPDATE wallet_spending_monthly SET
+			spent = spent - MAX(-OLD.amount, 0),
+			income = income - MAX(OLD.amount, 0),
+			transactions = transactions - 1
+		WHERE OLD.date IS NOT NULL
+			AND month = substr(OLD.date, 1, 7)
+			AND category = OLD.category;
+		INSERT OR IGNORE INTO wallet_spending_monthly (month, category)
+		SELECT substr(NEW.date, 1, 7), NEW.category
+		WHERE NEW.date IS NOT NULL;
+		UPDATE wallet_spending_monthly SET
+			spent = spent + MAX(-NEW.amount, 0),
+			income = income + MAX(NEW.amount, 0),
+			transactions = transactions + 1
+		WHERE NEW.date IS NOT NULL
+			AND month = substr(NEW.date, 1, 7)
+			AND category = NEW.category;
+	END)",
+};
+
+constexpr auto kStateTable = R"(
+	CREATE TABLE IF NOT EXISTS wallet_sync_state (
+		key TEXT PRIMARY KEY,
+		value TEXT
+	)
+)";
+
+[[nodiscard]] QString Category(const Data::CreditsHistoryEntry &entry) {
+	using PeerType = Data::CreditsHistoryEntry::PeerType;
+	if (entry.stargift || entry.gift) {
+		return QString("gifts");
+	} else if (entry.subscriptionUntil.isValid()) {
+		return QString("subscriptions");
+	} else if (entry.reaction) {
+		return QString("reactions");
+	} else if (entry.paidMessagesCount) {
+		return QString("paid_messages");
+	} else if (entry.bareMsgId || !entry.extended.empty()) {
+		return QString("paid_media");
+	} else if (entry.starrefCommission) {
+		return QString("affiliate");
+	}
+	switch (entry.peerType) {
+	case PeerType::Peer: return QString("purchases");
+	case PeerType::AppStore:
+	case PeerType::PlayMarket:
+	case PeerType::PremiumBot: return QString("topups");
+	case PeerType::Fragment: return QString("withdrawals");
+	case PeerType::Ads: return QString("ads");
+	case PeerType::API: return QString("api");
+	case PeerType::Unsupported: break;
+	}
+	return QString("other");
+}
+
+} // namespace
+
+WalletSync::WalletSync(QObject *parent)
+: QObject(parent) {
+	_refreshTimer.setSingleShot(true);
+	connect(&_refreshTimer, &QTimer::timeout, this, [=] {
+		refresh();
+	});
+	_backfillTimer.setSingleShot(true);
+	connect(&_backfillTimer, &QTimer::timeout, this, [=] {
+		requestBackfill();
+	});
+}
+
+WalletSync::~WalletSync() {
+	stop();
+}
+
+bool WalletSync::start(
+		not_null<Main::Session*> session,
+		not_null<DatabasePool*> pool) {
+	if (_isRunning || !pool->isOpen()) {
+		return false;
+	}
+	_session = session;
+	_pool = pool;
+	loadState();
+
+	const auto self = session->user();
+	_head = std::make_unique<Api::CreditsHistory>(self, true, true);
+	_backfill = std::make_unique<Api::CreditsHistory>(self, true, true);
+
+	// updateStarsBalance and our own payments change the balance.
+	session->credits().balanceValue(
+	) | rpl::skip(1) | rpl::start_with_next([=] {
+		_refreshTimer.start(kRefreshDelay);
+	}, _sessionLifetime);
+
+	_isRunning = true;
+	refresh();
+	return true;
+}
+
+void WalletSync::stop() {
+	if (!_isRunning) {
+		return;
+	}
+	_isRunning = false;
+	_sessionLifetime.destroy();
+	_refreshTimer.stop();
+	_backfillTimer.stop();
+	_head = nullptr;
+	_backfill = nullptr;
+	_headRunning = _backfillRunning = _refreshAgain = false;
+	_headRows.clear();
+	_state = State();
+	_session = nullptr;
+	_pool = nullptr;
+}
+
+bool WalletSync::CreateTables(QSqlDatabase &db) {
+	QSqlQuery query(db);
+	if (!query.exec(kSpendingTable)) {
+		qWarning() << "MCP: Failed to create wallet_spending:" << query.lastError().text();
+		return false;
+	}
+	for (const auto column : kSpendingColumns) {
+		const auto name = QString(column).section(' ', 0, 0);
+		query.exec("SELECT COUNT(*) FROM pragma_table_info('wallet_spending') WHERE name = '" + name + "'");
+		if (query.next() && !query.value(0).toInt()) {
+			query.exec(QString("ALTER TABLE wallet_spending ADD COLUMN ") + column);
+		}
+	}
+	for (const auto index : kSpendingIndices) {
+		if (!query.exec(index)) {
+			qWarning() << "MCP: Failed to create wallet_spending index:" << query.lastError().text();
+			return false;
+		}
+	}
+
+	query.exec("SELECT name FROM sqlite_master WHERE type='table' AND name='wallet_spending_monthly'");
+	const auto monthlyExists = query.next();
+	if (!query.exec(kMonthlyTable)
+		|| (!monthlyExists && !query.exec(kMonthlyFill))) {
+		qWarning() << "MCP: Failed to create wallet_spending_monthly:" << query.lastError().text();
+		return false;
+	}
+	for (const auto trigger : kMonthlyTriggers) {
+		if (!query.exec(trigger)) {
+			qWarning() << "MCP: Failed to create wallet_spending trigger:" << query.lastError().text();
+			return false;
+		}
+	}
+	if (!query.exec(kStateTable)) {
+		qWarning() << "MCP: Failed to create wallet_sync_state:" << query.lastError().text();
+		return false;
+	}
+	return true;
+}
+
+void WalletSync::loadState() {
+	auto query = PreparedQuery(_pool->reader(), R"(
+		SELECT key, value FROM wallet_sync_state
+	)");
+	if (!query->exec()) {
+		qWarning() << "MCP: Failed to load wallet sync state:" << query->lastError().text();
+		return;
+	}
+	while (query->next()) {
+		const auto key = query->value(0).toString();
+		const auto value = query->value(1).toString();
+		if (key == QString("newest_id")) {
+			_state.newestId = value;
+		} else if (key == QString("backfill_offset")) {
+			_state.backfillOffset = value;
+		} else if (key == QString("backfill_balance")) {
+			_state.backfillBalance = value.toDouble();
+		} else if (key == QString("backfill_done")) {
+			_state.backfillDone = (value == QString("1"));
+		}
+	}
+}
+
+void WalletSync::refresh() {
+	if (!_isRunning) {
+		return;
+	} else if (_headRunning) {
+		_refreshAgain = true;
+		return;
+	}
+	_refreshTimer.stop();
+	_headOffset = QString();
+	_headNewestId = QString();
+	_headRows.clear();
+	requestHead();
+}
+
+void WalletSync::requestHead() {
+	_headRunning = true;
+	_head->request(_headOffset, [=](Data::CreditsStatusSlice slice) {
+		headReceived(slice);
+	});
+}
+
+void WalletSync::headReceived(const Data::CreditsStatusSlice &slice) {
+	if (slice.list.empty() && !slice.allLoaded) {
+		// Failed requests come as an empty slice.
+		_headRunning = false;
+		_headRows.clear();
+		_refreshTimer.start(kRetryDelay);
+		return;
+	}
+	if (_headOffset.isEmpty()) {
+		_headBalance = slice.balance.value();
+		if (!slice.list.empty()) {
+			_headNewestId = slice.list.front().id;
+		}
+	}
+	auto reached = false;
+	auto rows = Parse(slice, _state.newestId, _headBalance, reached);
+	_fetched += rows.size();
+	_headRows.insert(
+		end(_headRows),
+		std::make_move_iterator(begin(rows)),
+		std::make_move_iterator(end(rows)));
+
+	const auto last = reached || slice.allLoaded || slice.token.isEmpty();
+	if (_state.newestId.isEmpty()) {
+		// First sync, the rest of the history comes through backfill.
+		_state.backfillOffset = slice.token;
+		_state.backfillBalance = _headBalance;
+		_state.backfillDone = last;
+		finishHead();
+	} else if (last) {
+		finishHead();
+	} else {
+		_headOffset = slice.token;
+		requestHead();
+	}
+}
+
+void WalletSync::finishHead() {
+	if (!_headNewestId.isEmpty()) {
+		_state.newestId = base::take(_headNewestId);
+	}
+	store(base::take(_headRows));
+	_headRunning = false;
+	_headOffset = QString();
+
+	if (base::take(_refreshAgain)) {
+		refresh();
+	} else if (!_state.backfillDone
+		&& !_backfillRunning
+		&& !_backfillTimer.isActive()) {
+		_backfillTimer.start(kBackfillDelay);
+	}
+}
+
+void WalletSync::requestBackfill() {
+	if (!_isRunning || _state.backfillDone || _backfillRunning) {
+		return;
+	}
+	_backfillRunning = true;
+	_backfill->request(_state.backfillOffset, [=](
+			Data::CreditsStatusSlice slice) {
+		backfillReceived(slice);
+	});
+}
+
+void WalletSync::backfillReceived(const Data::CreditsStatusSlice &slice) {
+	_backfillRunning = false;
+	if (slice.list.empty() && !slice.allLoaded) {
+		_backfillTimer.start(kRetryDelay);
+		return;
+	}
+	auto reached = false;
+	auto rows = Parse(slice, QString(), _state.backfillBalance, reached);
+	_fetched += rows.size();
+	_state.backfillOffset = slice.token;
+	_state.backfillDone = slice.allLoaded || slice.token.isEmpty();
+	store(std::move(rows));
+	if (!_state.backfillDone) {
+		_backfillTimer.start(kBackfillDelay);
+	}
+}
+
+auto WalletSync::Parse(
+		const Data::CreditsStatusSlice &slice,
+		const QString &stopAt,
+		double &balance,
+		bool &reached) -> std::vector<Row> {
+	auto result = std::vector<Row>();
+	result.reserve(slice.list.size());
+	for (const auto &entry : slice.list) {
+		if (!stopAt.isEmpty() && entry.id == stopAt) {
+			reached = true;
+			break;
+		} else if (entry.failed || entry.credits.ton()) {
+			continue;
+		}
+		// Pages go from the newest, balance is the one after the entry.
+		const auto amount = entry.credits.value();
+		result.push_back({
+			.transactionId = entry.id,
+			.date = entry.date.toUTC().toString("yyyy-MM-dd HH:mm:ss"),
+			.amount = amount,
+			.balance = balance,
+			.category = Category(entry),
+			.description = entry.title.isEmpty()
+				? entry.description.text
+				: entry.title,
+			.peerId = qint64(entry.barePeerId),
+		});
+		balance -= amount;
+	}
+	return result;
+}
+
+void WalletSync::store(std::vector<Row> rows) {
+	// One transaction for the page and the offset it moves the sync to.
+	_pool->write([rows = std::move(rows), state = _state](
+			QSqlDatabase &db) {
+		db.transaction();
+		for (const auto &row : rows) {
+			auto query = PreparedQuery(db, R"(
+				INSERT OR IGNORE INTO wallet_spending
+					(transaction_id, date, amount, balance, category,
+					description, peer_id)
+				VALUES (:transaction_id, :date, :amount, :balance,
+					:category, :description, :peer_id)
+			)");
+			query->bindValue(":transaction_id", row.transactionId);
+			query->bindValue(":date", row.date);
+			query->bindValue(":amount", row.amount);
+			query->bindValue(":balance", row.balance);
+			query->bindValue(":category", row.category);
+			query->bindValue(":description", row.description);
+			query->bindValue(
+				":peer_id",
+				row.peerId ? QVariant(row.peerId) : QVariant());
+			if (!query->exec()) {
+				qWarning() << "MCP: Failed to store a transaction:" << query->lastError().text();
+			}
+		}
+		const auto values = std::array<std::pair<QString, QString>, 4>{ {
+			{ QString("newest_id"), state.newestId },
+			{ QString("backfill_offset"), state.backfillOffset },
+			{ QString("backfill_balance"), QString::number(state.backfillBalance, 'f') },
+			{ QString("backfill_done"), state.backfillDone ? QString("1") : QString("0") },
+		} };
+		for (const auto &[key, value] : values) {
+			auto query = PreparedQuery(db, R"(
+				INSERT OR REPLACE INTO wallet_sync_state (key, value)
+				VALUES (:key, :value)
+			)");
+			query->bindValue(":key", key);
+			query->bindValue(":value", value);
+			query->exec();
+		}
+		db.commit();
+	});
+}
+
+QJsonObject WalletSync::stats() const {
+	return QJsonObject{
+		{ "running", _isRunning },
+		{ "refreshing", _headRunning },
+		{ "backfill_done", _state.backfillDone },
+		{ "fetched", _fetched },
+	};
+}
+
+} // namespace MCP
@@ -0,0 +1,116 @@
+// MCP Wallet Sync - Stars transactions mirrored into wallet_spending
+//
+// This file is part of Telegram Desktop MCP integration.
+// payments.getStarsTransactions pages go from the newest transaction.
+// New ones are fetched from the top until a stored one shows up, older
+// history is backfilled page by page from the offset kept in
+// wallet_sync_state, so a restart resumes where the last run stopped.
+// Each page is inserted in one transaction on the database writer and
+// triggers keep wallet_spending_monthly totals per month and category.
+
+#pragma once
+
+#include <QtCore/QJsonObject>
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtCore/QTimer>
+
+#include <memory>
+#include <vector>
+
+class QSqlDatabase;
+
+namespace Api {
+class CreditsHistory;
+} // namespace Api
+
+namespace Data {
+struct CreditsStatusSlice;
+} // namespace Data
+
+namespace Main {
+class Session;
+} // namespace Main
+
+namespace MCP {
+
+class DatabasePool;
+
+class WalletSync final : public QObject {
+public:
+	explicit WalletSync(QObject *parent = nullptr);
+	~WalletSync();
+
+	// Archive schema migration creating the spending and state tables,
+	// the sync is started once the archiver applied it.
+	static bool CreateTables(QSqlDatabase &db);
+
+	bool start(not_null<Main::Session*> session, not_null<DatabasePool*> pool);
+	void stop();
+	[[nodiscard]] bool isRunning() const { return _isRunning; }
+
+	// Fetches the transactions newer than the stored ones.
+	void refresh();
+
+	[[nodiscard]] QJsonObject stats() const;
+
+private:
+	struct Row {
+		QString transactionId;
+		QString date;
+		double amount = 0.;
+		double balance = 0.;
+		QString category;
+		QString description;
+		qint64 peerId = 0;
+	};
+	struct State {
+		QString newestId;
+		QString backfillOffset;
+		double backfillBalance = 0.;
+		bool backfillDone = false;
+	};
+
+	void loadState();
+	void requestHead();
+	void headReceived(const Data::CreditsStatusSlice &slice);
+	void finishHead();
+	void requestBackfill();
+	void backfillReceived(const Data::CreditsStatusSlice &slice);
+	void store(std::vector<Row> rows);
+
+	// Rows of the slice above stopAt, balance goes back with each one.
+	[[nodiscard]] static std::vector<Row> Parse(
+		const Data::CreditsStatusSlice &slice,
+		const QString &stopAt,
+		double &balance,
+		bool &reached);
+
+	Main::Session *_session = nullptr;
+	DatabasePool *_pool = nullptr;
+	bool _isRunning = false;
+
+	// One request at a time each, the head pass may run during backfill.
+	std::unique_ptr<Api::CreditsHistory> _head;
+	std::unique_ptr<Api::CreditsHistory> _backfill;
+	State _state;
+	qint64 _fetched = 0; // Rows fetched by this run.
+
+	// Head pass in progress, its rows are stored when it reaches a known
+	// transaction so that newestId never skips a gap.
+	bool _headRunning = false;
+	bool _refreshAgain = false;
+	QString _headOffset;
+	QString _headNewestId;
+	double _headBalance = 0.;
+	std::vector<Row> _headRows;
+
+	bool _backfillRunning = false;
+	QTimer _backfillTimer;
+	QTimer _refreshTimer;
+
+	rpl::lifetime _sessionLifetime;
+
+};
+
+} // namespace MCP
@@ -0,0 +1,47 @@
+// MCP Wire Encoding - JSON and CBOR message codecs
+//
+// This file is part of Telegram Desktop MCP integration.
+
+#include "wire_encoding.h"
+
+#include <QtCore/QCborStreamReader>
+#include <QtCore/QCborValue>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+
+namespace MCP {
+
+QByteArray EncodeMessage(
+		const QJsonValue &message,
+		WireEncoding encoding) {
+	if (encoding == WireEncoding::Cbor) {
+		return QCborValue::fromJsonValue(message).toCbor();
+	}
+	const auto document = message.isArray()
+		? QJsonDocument(message.toArray())
+		: QJsonDocument(message.toObject());
+	return document.toJson(QJsonDocument::Compact);
+}
+
+DecodedMessage DecodeCborMessage(const QByteArray &data) {
+	auto result = DecodedMessage();
+	auto reader = QCborStreamReader(data);
+	auto value = QCborValue::fromCbor(reader);
+	const auto error = reader.lastError();
+	if (error == QCborError::EndOfFile) {
+		return result;
+	} else if (error != QCborError::NoError) {
+		result.error = error.toString();
+		return result;
+	}
+	if (value.isTag() && value.tag() == QCborKnownTags::Signature) {
+		value = value.taggedValue();
+	}
+	result.value = value.toJsonValue();
+	result.consumed = qsizetype(reader.currentOffset());
+	result.complete = true;
+	return result;
+}
+
+} // namespace MCP
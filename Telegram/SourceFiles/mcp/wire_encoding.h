@@ -0,0 +1,43 @@
+// MCP Wire Encoding - JSON and CBOR message codecs
+//
+// This file is part of Telegram Desktop MCP integration.
+// Lets the Bridge and HTTP transports exchange JSON-RPC messages as
+// compact binary CBOR, textual JSON stays the default.
+
+#pragma once
+
+#include <QtCore/QByteArray>
+#include <QtCore/QJsonValue>
+#include <QtCore/QString>
+
+namespace MCP {
+
+enum class WireEncoding {
+	Json,
+	Cbor,
+};
+
+inline constexpr auto kCborMimeType = "application/cbor";
+
+struct DecodedMessage {
+	QJsonValue value;
+	qsizetype consumed = 0; // Bytes taken from the front of the input.
+	bool complete = false; // False while more input is needed.
+	QString error; // Set when the input can never become a valid value.
+};
+
+// JSON-RPC text always starts with an ASCII character, while CBOR maps,
+// arrays and the self-describe tag all have the high bit set.
+[[nodiscard]] inline bool LooksLikeCbor(char first) {
+	return (static_cast<unsigned char>(first) & 0x80) != 0;
+}
+
+[[nodiscard]] QByteArray EncodeMessage(
+	const QJsonValue &message,
+	WireEncoding encoding);
+
+// Decodes the first CBOR item of data, an optional self-describe tag
+// is stripped. CBOR is self-delimiting, so no extra framing is needed.
+[[nodiscard]] DecodedMessage DecodeCborMessage(const QByteArray &data);
+
+} // namespace MCP
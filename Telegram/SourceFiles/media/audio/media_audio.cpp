@@ -496,8 +496,10 @@ Mixer::Mixer(not_null<Audio::Instance*> instance)
 	connect(this, SIGNAL(stoppedOnError(AudioMsgId)), this, SIGNAL(updated(AudioMsgId)), Qt::QueuedConnection);
 	connect(this, SIGNAL(updated(AudioMsgId)), this, SLOT(onUpdated(AudioMsgId)));
 
-	_loaderThread.start();
-	_faderThread.start();
+	// Decoding and queueing buffers must keep up with the playback even
+	// when the rest of the app keeps all the cores busy.
+	_loaderThread.start(QThread::HighPriority);
+	_faderThread.start(QThread::HighPriority);
 }
 
 // Thread: Main. Locks: AudioMutex.
@@ -1532,6 +1534,24 @@ Ui::PreparedFileInformation PrepareForSending(
 
 } // namespace Player
 
+namespace {
+
+[[nodiscard]] VoiceWaveform WaveformFromPeaks(const QVector<uint16> &peaks) {
+	if (peaks.isEmpty()) {
+		return VoiceWaveform();
+	}
+	const auto sum = std::accumulate(peaks.cbegin(), peaks.cend(), 0LL);
+	const auto peak = qMax(int32(sum * 1.8 / peaks.size()), 2500);
+
+	auto result = VoiceWaveform(peaks.size());
+	for (int32 i = 0, l = peaks.size(); i != l; ++i) {
+		result[i] = char(qMin(31U, uint32(qMin(int32(peaks.at(i)), peak)) * 31 / peak));
+	}
+	return result;
+}
+
+} // namespace
+
 class FFMpegWaveformCounter : public FFMpegLoader {
 public:
 	FFMpegWaveformCounter(const Core::FileLocation &file, const QByteArray &data) : FFMpegLoader(file, data, bytes::vector()) {
@@ -1589,19 +1609,8 @@ public:
 			peaks.push_back(peak);
 		}
 
-		if (peaks.isEmpty()) {
-			return false;
-		}
-
-		auto sum = std::accumulate(peaks.cbegin(), peaks.cend(), 0LL);
-		peak = qMax(int32(sum * 1.8 / peaks.size()), 2500);
-
-		result.resize(peaks.size());
-		for (int32 i = 0, l = peaks.size(); i != l; ++i) {
-			result[i] = char(qMin(31U, uint32(qMin(peaks.at(i), peak)) * 31 / peak));
-		}
-
-		return true;
+		result = WaveformFromPeaks(peaks);
+		return !result.isEmpty();
 	}
 
 	const VoiceWaveform &waveform() const {
@@ -1628,3 +1637,28 @@ VoiceWaveform audioCountWaveform(
 	}
 	return VoiceWaveform();
 }
+
+VoiceWaveform audioCountWaveform(bytes::const_span samples) {
+	const auto count = int64(samples.size() / sizeof(int16));
+	if (count < Media::Player::kWaveformSamplesCount) {
+		return VoiceWaveform();
+	}
+	auto peaks = QVector<uint16>();
+	peaks.reserve(Media::Player::kWaveformSamplesCount);
+
+	auto peak = uint16(0);
+	auto sum = int64(0);
+	Media::Audio::IterateSamples<int16>(samples, [&](uint16 sample) {
+		accumulate_max(peak, sample);
+		sum += Media::Player::kWaveformSamplesCount;
+		if (sum >= count) {
+			sum -= count;
+			peaks.push_back(peak);
+			peak = 0;
+		}
+	});
+	if (sum > 0 && peaks.size() < Media::Player::kWaveformSamplesCount) {
+		peaks.push_back(peak);
+	}
+	return Media::WaveformFromPeaks(peaks);
+}
@@ -399,6 +399,9 @@ bool audioCheckError();
 
 VoiceWaveform audioCountWaveform(const Core::FileLocation &file, const QByteArray &data);
 
+// From signed 16-bit mono samples, already decoded for something else.
+VoiceWaveform audioCountWaveform(bytes::const_span samples);
+
 namespace Media {
 namespace Audio {
 
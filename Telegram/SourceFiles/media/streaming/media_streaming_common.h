@@ -48,6 +48,9 @@ struct PlaybackOptions {
 	bool hwAllowed = false;
 	bool seekable = true;
 	bool loop = false;
+
+	// Largest size the frames will be shown in, if known in advance.
+	QSize decodeSize;
 };
 
 struct TrackState {
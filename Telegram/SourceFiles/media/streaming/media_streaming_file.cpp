@@ -169,14 +169,19 @@ Stream File::Context::initStream(
 			// ignore cover streams
 			return Stream();
 		}
+		result.rotation = FFmpeg::ReadRotationFromMetadata(info);
+		auto decodeSize = options.decodeSize;
+		if (FFmpeg::RotationSwapWidthHeight(result.rotation)) {
+			decodeSize.transpose();
+		}
 		result.codec = FFmpeg::MakeCodecPointer({
 			.stream = info,
 			.hwAllowed = options.hwAllow,
+			.decodeSize = decodeSize,
 		});
 		if (!result.codec) {
 			return result;
 		}
-		result.rotation = FFmpeg::ReadRotationFromMetadata(info);
 		result.aspect = FFmpeg::ValidateAspectRatio(
 			info->sample_aspect_ratio);
 	} else if (type == AVMEDIA_TYPE_AUDIO) {
@@ -26,6 +26,7 @@ struct StartOptions {
 	crl::time durationOverride = 0;
 	bool seekable = true;
 	bool hwAllow = false;
+	QSize decodeSize;
 };
 
 class File final {
@@ -126,7 +126,9 @@ bool LoaderMtproto::readyToRequest() const {
 	return !_requested.empty();
 }
 
-int64 LoaderMtproto::takeNextRequestOffset() {
+int64 LoaderMtproto::takeNextRequestOffset(int limit) {
+	Expects(limit == Storage::kDownloadPartSize);
+
 	const auto offset = _requested.take();
 	Assert(offset.has_value());
 
@@ -51,7 +51,7 @@ private:
 	};
 
 	bool readyToRequest() const override;
-	int64 takeNextRequestOffset() override;
+	int64 takeNextRequestOffset(int limit) override;
 	bool feedPart(int64 offset, const QByteArray &bytes) override;
 	void cancelOnFail() override;
 
@@ -553,6 +553,7 @@ void Player::play(const PlaybackOptions &options) {
 		.durationOverride = options.durationOverride,
 		.seekable = _options.seekable,
 		.hwAllow = _options.hwAllowed,
+		.decodeSize = _options.decodeSize,
 	});
 }
 
@@ -836,6 +837,10 @@ bool Player::finished() const {
 		&& (!_video || _videoFinished);
 }
 
+QSize Player::decodeSize() const {
+	return _options.decodeSize;
+}
+
 float64 Player::speed() const {
 	return _options.speed;
 }
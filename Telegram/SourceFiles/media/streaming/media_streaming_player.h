@@ -56,6 +56,7 @@ public:
 	[[nodiscard]] bool paused() const;
 	[[nodiscard]] std::optional<Error> failed() const;
 	[[nodiscard]] bool finished() const;
+	[[nodiscard]] QSize decodeSize() const;
 
 	[[nodiscard]] rpl::producer<Update, Error> updates() const;
 	[[nodiscard]] rpl::producer<bool> fullInCache() const;
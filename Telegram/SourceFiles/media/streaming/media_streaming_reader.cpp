@@ -24,7 +24,13 @@ constexpr auto kPartsOutsideFirstSliceGood = 8;
 constexpr auto kSlicesInMemory = 2;
 
 // 1 MB of parts are requested from cloud ahead of reading demand.
+// Each time sequential reading catches up with the loaded data this
+// is doubled, up to 4 MB, so fast links get more parallel requests.
 constexpr auto kPreloadPartsAhead = 8;
+constexpr auto kPreloadPartsAheadMax = 32;
+
+// Reading farther from the previous read is a seek.
+constexpr auto kSequentialReadDistance = kInSlice;
 constexpr auto kDownloaderRequestsLimit = 4;
 
 using PartsMap = base::flat_map<uint32, QByteArray>;
@@ -270,14 +276,14 @@ void Reader::Slice::addPart(uint32 offset, QByteArray bytes) {
 
 auto Reader::Slice::prepareFill(
 		uint32 from,
-		uint32 till) -> PrepareFillResult {
+		uint32 till,
+		int preloadParts) -> PrepareFillResult {
 	auto result = PrepareFillResult();
 
 	result.ready = false;
 	const auto fromOffset = (from / kPartSize) * kPartSize;
 	const auto tillPart = (till + kPartSize - 1) / kPartSize;
-	const auto preloadTillOffset = (tillPart + kPreloadPartsAhead)
-		* kPartSize;
+	const auto preloadTillOffset = (tillPart + preloadParts) * kPartSize;
 
 	const auto after = ranges::upper_bound(
 		parts,
@@ -341,7 +347,9 @@ auto Reader::Slice::offsetsFromLoader(uint32 from, uint32 till) const
 }
 
 Reader::Slices::Slices(uint32 size, bool useCache)
-: _size(size) {
+: _size(size)
+, _preloadParts(kPreloadPartsAhead) {
+	static_assert(kPreloadPartsAheadMax <= kLoadFromRemoteMax);
 	Expects(size > 0);
 
 	if (useCache) {
@@ -616,9 +624,16 @@ auto Reader::Slices::fill(uint32 offset, bytes::span buffer) -> FillResult {
 	const auto secondTill = (till > (fromSlice + 1) * kInSlice)
 		? (till - (fromSlice + 1) * kInSlice)
 		: 0;
-	const auto first = _data[fromSlice].prepareFill(firstFrom, firstTill);
+	const auto sequential = checkSequentialRead(offset, till);
+	const auto first = _data[fromSlice].prepareFill(
+		firstFrom,
+		firstTill,
+		_preloadParts);
 	const auto second = (fromSlice + 1 < tillSlice)
-		? _data[fromSlice + 1].prepareFill(secondFrom, secondTill)
+		? _data[fromSlice + 1].prepareFill(
+			secondFrom,
+			secondTill,
+			_preloadParts)
 		: Slice::PrepareFillResult();
 	handlePrepareResult(fromSlice, first);
 	if (fromSlice + 1 < tillSlice) {
@@ -646,17 +661,34 @@ auto Reader::Slices::fill(uint32 offset, bytes::span buffer) -> FillResult {
 		if (fromSlice + 1 < tillSlice) {
 			handleReadFromCache(fromSlice + 1);
 		}
+		if (sequential
+			&& result.state == FillState::WaitingRemote
+			&& _preloadParts < kPreloadPartsAheadMax) {
+			_preloadParts = std::min(_preloadParts * 2, kPreloadPartsAheadMax);
+		}
 	}
 	return result;
 }
 
+bool Reader::Slices::checkSequentialRead(uint32 from, uint32 till) {
+	const auto distance = (from > _lastReadTill)
+		? (from - _lastReadTill)
+		: (_lastReadTill - from);
+	_lastReadTill = till;
+	if (distance > kSequentialReadDistance) {
+		_preloadParts = kPreloadPartsAhead;
+		return false;
+	}
+	return true;
+}
+
 auto Reader::Slices::fillFromHeader(uint32 offset, bytes::span buffer)
 -> FillResult {
 	auto result = FillResult();
 	const auto from = offset;
 	const auto till = uint32(offset + buffer.size());
 
-	const auto prepared = _header.prepareFill(from, till);
+	const auto prepared = _header.prepareFill(from, till, _preloadParts);
 	for (const auto full : prepared.offsetsFromLoader.values()) {
 		if (full < _size) {
 			result.offsetsFromLoader.add(full);
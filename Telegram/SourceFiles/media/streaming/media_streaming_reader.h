@@ -84,7 +84,7 @@ public:
 	~Reader();
 
 private:
-	static constexpr auto kLoadFromRemoteMax = 8;
+	static constexpr auto kLoadFromRemoteMax = 32;
 
 	struct CacheHelper;
 
@@ -134,7 +134,10 @@ private:
 
 		void processCacheData(PartsMap &&data);
 		void addPart(uint32 offset, QByteArray bytes);
-		PrepareFillResult prepareFill(uint32 from, uint32 till);
+		PrepareFillResult prepareFill(
+			uint32 from,
+			uint32 till,
+			int preloadParts);
 
 		// Get up to kLoadFromRemoteMax not loaded parts in from-till range.
 		StackIntVector<kLoadFromRemoteMax> offsetsFromLoader(
@@ -196,6 +199,7 @@ private:
 		void unloadSlice(Slice &slice) const;
 		void checkSliceFullLoaded(int sliceNumber);
 		[[nodiscard]] bool checkFullInCache() const;
+		[[nodiscard]] bool checkSequentialRead(uint32 from, uint32 till);
 
 		std::vector<Slice> _data;
 		Slice _header;
@@ -204,6 +208,9 @@ private:
 		HeaderMode _headerMode = HeaderMode::Unknown;
 		bool _fullInCache = false;
 
+		uint32 _lastReadTill = 0;
+		int _preloadParts = 0;
+
 	};
 
 	// 0 is for headerData, slice index = sliceNumber - 1.
@@ -725,7 +725,9 @@ void VideoTrackObject::callReady() {
 			.duration = _stream.duration,
 		},
 		.size = FFmpeg::TransposeSizeByRotation(
-			FFmpeg::CorrectByAspect(frame->original.size(), _stream.aspect),
+			FFmpeg::CorrectByAspect(
+				frame->original.size() * (1 << _stream.codec->lowres),
+				_stream.aspect),
 			_stream.rotation),
 		.cover = frame->original,
 		.rotation = _stream.rotation,
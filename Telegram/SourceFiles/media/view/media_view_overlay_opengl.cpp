@@ -252,6 +252,10 @@ void OverlayWidget::RendererGL::deinit(QOpenGLFunctions *f) {
 	_fillProgram = std::nullopt;
 	_controlsProgram = std::nullopt;
 	_contentBuffer = std::nullopt;
+	for (auto &buffer : _unpackBuffers) {
+		buffer = std::nullopt;
+	}
+	_unpackBufferBound = -1;
 	_controlsFadeImage.destroy(f);
 	_radialImage.destroy(f);
 	_documentBubbleImage.destroy(f);
@@ -371,6 +375,14 @@ void OverlayWidget::RendererGL::paintTransformedVideoFrame(
 	_trackFrameIndex = data.index;
 	_streamedIndex = _owner->streamedIndex();
 
+	const auto planes = upload
+		? fillUnpackBuffer(*yuv, nv12).value_or(std::array{
+			yuv->y.data,
+			yuv->u.data,
+			yuv->v.data,
+		})
+		: std::array<const void*, 3>();
+
 	_f->glActiveTexture(GL_TEXTURE0);
 	_textures.bind(*_f, 3);
 	if (upload) {
@@ -381,7 +393,7 @@ void OverlayWidget::RendererGL::paintTransformedVideoFrame(
 			yuv->size,
 			_lumaSize,
 			yuv->y.stride,
-			yuv->y.data);
+			planes[0]);
 		_lumaSize = yuv->size;
 	}
 	_f->glActiveTexture(GL_TEXTURE1);
@@ -393,7 +405,7 @@ void OverlayWidget::RendererGL::paintTransformedVideoFrame(
 			yuv->chromaSize,
 			nv12changed ? QSize() : _chromaSize,
 			yuv->u.stride / (nv12 ? 2 : 1),
-			yuv->u.data);
+			planes[1]);
 		if (nv12) {
 			_chromaSize = yuv->chromaSize;
 			_f->glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
@@ -403,6 +415,7 @@ void OverlayWidget::RendererGL::paintTransformedVideoFrame(
 
 	validateControlsFade();
 	if (nv12) {
+		releaseUnpackBuffer();
 		_f->glActiveTexture(GL_TEXTURE2);
 		_controlsFadeImage.bind(*_f);
 	} else {
@@ -415,10 +428,11 @@ void OverlayWidget::RendererGL::paintTransformedVideoFrame(
 				yuv->chromaSize,
 				_chromaSize,
 				yuv->v.stride,
-				yuv->v.data);
+				planes[2]);
 			_chromaSize = yuv->chromaSize;
 			_f->glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 		}
+		releaseUnpackBuffer();
 
 		_f->glActiveTexture(GL_TEXTURE3);
 		_controlsFadeImage.bind(*_f);
@@ -627,6 +641,74 @@ void OverlayWidget::RendererGL::uploadTexture(
 	_f->glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
 }
 
+auto OverlayWidget::RendererGL::fillUnpackBuffer(
+		const Streaming::FrameYUV &yuv,
+		bool nv12)
+-> std::optional<std::array<const void*, 3>> {
+	if (_unpackBuffersFailed
+		|| yuv.y.stride <= 0
+		|| yuv.u.stride <= 0
+		|| (!nv12 && yuv.v.stride <= 0)) {
+		return std::nullopt;
+	}
+	const auto luma = yuv.y.stride * yuv.size.height();
+	const auto chroma = yuv.u.stride * yuv.chromaSize.height();
+	const auto second = nv12 ? 0 : (yuv.v.stride * yuv.chromaSize.height());
+	const auto size = luma + chroma + second;
+
+	// A few buffers in turn, so that filling the next one doesn't wait
+	// for the previous upload still reading from its buffer.
+	const auto index = _unpackBufferIndex;
+	_unpackBufferIndex = (index + 1) % int(_unpackBuffers.size());
+	auto &buffer = _unpackBuffers[index];
+	if (!buffer) {
+		buffer.emplace(QOpenGLBuffer::PixelUnpackBuffer);
+		buffer->setUsagePattern(QOpenGLBuffer::StreamDraw);
+		if (!buffer->create()) {
+			buffer = std::nullopt;
+			_unpackBuffersFailed = true;
+			return std::nullopt;
+		}
+	}
+	buffer->bind();
+	if (buffer->size() != size) {
+		buffer->allocate(size);
+	}
+	const auto mapped = static_cast<char*>(buffer->mapRange(
+		0,
+		size,
+		(QOpenGLBuffer::RangeWrite
+			| QOpenGLBuffer::RangeInvalidateBuffer)));
+	if (!mapped) {
+		// Mapping is not supported, upload from the frame memory.
+		buffer->release();
+		_unpackBuffersFailed = true;
+		return std::nullopt;
+	}
+	memcpy(mapped, yuv.y.data, luma);
+	memcpy(mapped + luma, yuv.u.data, chroma);
+	if (second) {
+		memcpy(mapped + luma + chroma, yuv.v.data, second);
+	}
+	if (!buffer->unmap()) {
+		// The buffer contents were lost, upload from the frame memory.
+		buffer->release();
+		return std::nullopt;
+	}
+	_unpackBufferBound = index;
+	return std::array<const void*, 3>{
+		reinterpret_cast<const void*>(std::uintptr_t(0)),
+		reinterpret_cast<const void*>(std::uintptr_t(luma)),
+		reinterpret_cast<const void*>(std::uintptr_t(luma + chroma)),
+	};
+}
+
+void OverlayWidget::RendererGL::releaseUnpackBuffer() {
+	if (_unpackBufferBound >= 0) {
+		_unpackBuffers[std::exchange(_unpackBufferBound, -1)]->release();
+	}
+}
+
 void OverlayWidget::RendererGL::paintRadialLoading(
 		QRect inner,
 		bool radial,
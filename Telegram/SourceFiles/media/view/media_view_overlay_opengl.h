@@ -13,6 +13,10 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include <QOpenGLBuffer>
 
+namespace Media::Streaming {
+struct FrameYUV;
+} // namespace Media::Streaming
+
 namespace Media::View {
 
 class OverlayWidget::RendererGL final
@@ -106,6 +110,14 @@ private:
 		int stride,
 		const void *data) const;
 
+	// Copies the planes to the next pixel buffer and leaves it bound,
+	// returns the plane offsets inside it for the texture uploads.
+	[[nodiscard]] auto fillUnpackBuffer(
+		const Streaming::FrameYUV &yuv,
+		bool nv12)
+	-> std::optional<std::array<const void*, 3>>;
+	void releaseUnpackBuffer();
+
 	const not_null<OverlayWidget*> _owner;
 
 	QOpenGLFunctions *_f = nullptr;
@@ -115,6 +127,10 @@ private:
 	QVector2D _uniformViewport;
 
 	std::optional<QOpenGLBuffer> _contentBuffer;
+	std::array<std::optional<QOpenGLBuffer>, 3> _unpackBuffers;
+	int _unpackBufferIndex = 0;
+	int _unpackBufferBound = -1;
+	bool _unpackBuffersFailed = false;
 	std::optional<QOpenGLShaderProgram> _imageProgram;
 	std::optional<QOpenGLShaderProgram> _staticContentProgram;
 	QOpenGLShader *_texturedVertexShader = nullptr;
@@ -115,6 +115,14 @@ namespace View {
 namespace {
 
 constexpr auto kPreloadCount = 3;
+constexpr auto kPreloadCountMax = 12;
+
+// Flipping in one direction faster than that preloads further ahead.
+constexpr auto kPreloadFastFlipTimeout = crl::time(500);
+
+// Large photos beyond kPreloadCount are preloaded while their decoded
+// images fit in this.
+constexpr auto kPreloadImagesBudget = int64(128 * 1024 * 1024);
 constexpr auto kMaxZoomLevel = 7; // x8
 constexpr auto kZoomToScreenLevel = 1024;
 constexpr auto kOverlayLoaderPriority = 2;
@@ -3652,6 +3660,7 @@ void OverlayWidget::show(OpenRequest request) {
 		assignMediaPointer(photo);
 
 		displayPhoto(photo);
+		_preloadDirection = 0;
 		preloadData(0);
 		activateControls();
 	} else if (story || document || call) {
@@ -3690,6 +3699,7 @@ void OverlayWidget::show(OpenRequest request) {
 				{ request.continueStreaming(), request.startTime() });
 		}
 		if (!isHidden()) {
+			_preloadDirection = 0;
 			preloadData(0);
 			activateControls();
 		}
@@ -4075,7 +4085,8 @@ void OverlayWidget::startStreamingPlayer(
 
 	const auto &player = _streamed->instance.player();
 	if (player.playing()) {
-		if (!_streamed->withSound) {
+		// Inline players may decode downscaled frames.
+		if (!_streamed->withSound && player.decodeSize().isEmpty()) {
 			markStreamedReady();
 			return;
 		}
@@ -6040,18 +6051,32 @@ void OverlayWidget::preloadData(int delta) {
 	if (!_index) {
 		return;
 	}
-	auto from = *_index + (delta ? -delta : -1);
-	auto till = *_index + (delta ? delta * kPreloadCount : 1);
-	if (from > till) std::swap(from, till);
+	if (delta) {
+		// Shared media updates preload with zero delta afterwards, they
+		// should keep the direction the user is flipping in.
+		const auto direction = (delta > 0) ? 1 : -1;
+		const auto now = crl::now();
+		const auto fast = (direction == _preloadDirection)
+			&& (now - _preloadLastMove < kPreloadFastFlipTimeout);
+		_preloadCount = fast
+			? std::min(_preloadCount * 2, kPreloadCountMax)
+			: kPreloadCount;
+		_preloadDirection = direction;
+		_preloadLastMove = now;
+	}
 
 	auto photos = base::flat_set<std::shared_ptr<Data::PhotoMedia>>();
 	auto documents = base::flat_set<std::shared_ptr<Data::DocumentMedia>>();
-	for (auto index = from; index != till + 1; ++index) {
+	auto budget = kPreloadImagesBudget;
+	const auto preload = [&](int index) {
 		auto entity = entityByIndex(index);
 		if (auto photo = std::get_if<not_null<PhotoData*>>(&entity.data)) {
 			const auto &[i, ok] = photos.emplace((*photo)->createMediaView());
 			(*i)->wanted(Data::PhotoSize::Small, fileOrigin(entity));
 			(*photo)->load(fileOrigin(entity), LoadFromCloudOrLocal, true);
+			if (const auto size = (*photo)->size(Data::PhotoSize::Large)) {
+				budget -= int64(size->width()) * size->height() * 4;
+			}
 		} else if (auto document = std::get_if<not_null<DocumentData*>>(
 				&entity.data)) {
 			const auto &[i, ok] = documents.emplace(
@@ -6061,6 +6086,16 @@ void OverlayWidget::preloadData(int delta) {
 				(*i)->automaticLoad(fileOrigin(entity), entity.item);
 			}
 		}
+	};
+	const auto forward = _preloadDirection ? _preloadDirection : 1;
+	const auto count = _preloadDirection ? _preloadCount : 1;
+	preload(*_index);
+	preload(*_index - forward);
+	for (auto i = 1; i <= count; ++i) {
+		if (i > kPreloadCount && budget <= 0) {
+			break;
+		}
+		preload(*_index + i * forward);
 	}
 	_preloadPhotos = std::move(photos);
 	_preloadDocuments = std::move(documents);
@@ -6738,6 +6773,7 @@ void OverlayWidget::clearBeforeHide() {
 	assignMediaPointer(nullptr);
 	_preloadPhotos.clear();
 	_preloadDocuments.clear();
+	_preloadDirection = 0;
 	if (_menu) {
 		_menu->hideMenu(true);
 	}
@@ -38,6 +38,7 @@ public:
 	static constexpr auto kUnknownSize = -1;
 	static constexpr auto kInvalidSize = -2;
 	virtual int readPacketLength(bytes::const_span bytes) const = 0;
+	virtual int readPacketPrefixSize(bytes::const_span bytes) const = 0;
 	virtual bytes::const_span readPacket(bytes::const_span bytes) const = 0;
 
 	virtual QString debugPostfix() const = 0;
@@ -60,6 +61,7 @@ public:
 	bytes::span finalizePacket(mtpBuffer &buffer) override;
 
 	int readPacketLength(bytes::const_span bytes) const override;
+	int readPacketPrefixSize(bytes::const_span bytes) const override;
 	bytes::const_span readPacket(bytes::const_span bytes) const override;
 
 	QString debugPostfix() const override;
@@ -123,13 +125,20 @@ int TcpConnection::Protocol::Version0::readPacketLength(
 	return kInvalidSize;
 }
 
+int TcpConnection::Protocol::Version0::readPacketPrefixSize(
+		bytes::const_span bytes) const {
+	Expects(!bytes.empty());
+
+	return (static_cast<char>(bytes[0]) == 0x7F) ? 4 : 1;
+}
+
 bytes::const_span TcpConnection::Protocol::Version0::readPacket(
 		bytes::const_span bytes) const {
 	const auto size = readPacketLength(bytes);
 	Assert(size != kUnknownSize
 		&& size != kInvalidSize
 		&& size <= bytes.size());
-	const auto sizeLength = (static_cast<char>(bytes[0]) == 0x7F) ? 4 : 1;
+	const auto sizeLength = readPacketPrefixSize(bytes);
 	return bytes.subspan(sizeLength, size - sizeLength);
 }
 
@@ -175,6 +184,7 @@ public:
 	bytes::span finalizePacket(mtpBuffer &buffer) override;
 
 	int readPacketLength(bytes::const_span bytes) const override;
+	int readPacketPrefixSize(bytes::const_span bytes) const override;
 	bytes::const_span readPacket(bytes::const_span bytes) const override;
 
 	QString debugPostfix() const override;
@@ -215,13 +225,18 @@ int TcpConnection::Protocol::VersionD::readPacketLength(
 		: kInvalidSize;
 }
 
+int TcpConnection::Protocol::VersionD::readPacketPrefixSize(
+		bytes::const_span) const {
+	return 4;
+}
+
 bytes::const_span TcpConnection::Protocol::VersionD::readPacket(
 		bytes::const_span bytes) const {
 	const auto size = readPacketLength(bytes);
 	Assert(size != kUnknownSize
 		&& size != kInvalidSize
 		&& size <= bytes.size());
-	const auto sizeLength = 4;
+	const auto sizeLength = readPacketPrefixSize(bytes);
 	return bytes.subspan(sizeLength, size - sizeLength);
 }
 
@@ -257,10 +272,14 @@ ConnectionPointer TcpConnection::clone(const ProxyData &proxy) {
 	return ConnectionPointer::New<TcpConnection>(_instance, thread(), proxy);
 }
 
+bytes::span TcpConnection::currentBuffer() {
+	return _usingLargeBuffer
+		? bytes::make_span(_largeBuffer)
+		: bytes::make_span(_smallBuffer);
+}
+
 void TcpConnection::ensureAvailableInBuffer(int amount) {
-	auto &buffer = _usingLargeBuffer ? _largeBuffer : _smallBuffer;
-	const auto full = bytes::make_span(buffer).subspan(
-		_offsetBytes);
+	const auto full = currentBuffer().subspan(_offsetBytes);
 	if (full.size() >= amount) {
 		return;
 	}
@@ -273,16 +292,20 @@ void TcpConnection::ensureAvailableInBuffer(int amount) {
 		} else {
 			bytes::move(_smallBuffer, read);
 		}
-	} else if (amount <= _largeBuffer.size()) {
-		Assert(_usingLargeBuffer);
-		bytes::move(_largeBuffer, read);
+		_offsetBytes = 0;
 	} else {
-		auto enough = bytes::vector(amount);
-		bytes::copy(enough, read);
+		// The packet is read right into the buffer that goes to the
+		// session, shifted so that the payload after the length prefix
+		// starts at an mtpPrime boundary, see takeLargePacket().
+		constexpr auto kPrime = int(sizeof(mtpPrime));
+		const auto prefix = _protocol->readPacketPrefixSize(read);
+		const auto shift = (kPrime - (prefix % kPrime)) % kPrime;
+		auto enough = mtpBuffer((shift + amount + kPrime - 1) / kPrime);
+		bytes::copy(bytes::make_span(enough).subspan(shift), read);
 		_largeBuffer = std::move(enough);
 		_usingLargeBuffer = true;
+		_offsetBytes = shift;
 	}
-	_offsetBytes = 0;
 }
 
 void TcpConnection::socketRead() {
@@ -303,8 +326,7 @@ void TcpConnection::socketRead() {
 			: (kSmallBufferSize - _offsetBytes - _readBytes);
 		Assert(readLimit > 0);
 
-		auto &buffer = _usingLargeBuffer ? _largeBuffer : _smallBuffer;
-		const auto full = bytes::make_span(buffer).subspan(_offsetBytes);
+		const auto full = currentBuffer().subspan(_offsetBytes);
 		const auto free = full.subspan(_readBytes);
 		const auto readCount = _socket->read(free.subspan(0, readLimit));
 		if (readCount > 0) {
@@ -317,7 +339,11 @@ void TcpConnection::socketRead() {
 				Assert(readCount <= _leftBytes);
 				_leftBytes -= readCount;
 				if (!_leftBytes) {
-					socketPacket(full.subspan(0, _readBytes));
+					if (_usingLargeBuffer) {
+						socketPacket(takeLargePacket());
+					} else {
+						socketPacket(full.subspan(0, _readBytes));
+					}
 					if (!_socket || !_socket->isConnected()) {
 						return;
 					}
@@ -408,6 +434,26 @@ mtpBuffer TcpConnection::parsePacket(bytes::const_span bytes) {
 	return result;
 }
 
+mtpBuffer TcpConnection::takeLargePacket() {
+	Expects(_usingLargeBuffer);
+
+	const auto full = bytes::make_span(_largeBuffer);
+	const auto packet = _protocol->readPacket(
+		full.subspan(_offsetBytes, _readBytes));
+	CONNECTION_LOG_INFO(u"Packet received, size = %1."_q.arg(packet.size()));
+	const auto shift = int(packet.data() - full.data());
+	const auto offset = shift / int(sizeof(mtpPrime));
+	const auto size = int(packet.size() / sizeof(mtpPrime));
+	Assert(offset * int(sizeof(mtpPrime)) == shift);
+	Assert(size >= 3);
+
+	// Dropping the prefix from the front doesn't reallocate.
+	auto result = base::take(_largeBuffer);
+	result.resize(offset + size);
+	result.erase(result.begin(), result.begin() + offset);
+	return result;
+}
+
 void TcpConnection::socketConnected() {
 	Expects(_status == Status::Waiting);
 
@@ -583,10 +629,13 @@ crl::time TcpConnection::fullConnectTimeout() const {
 }
 
 void TcpConnection::socketPacket(bytes::const_span bytes) {
+	socketPacket(parsePacket(bytes));
+}
+
+void TcpConnection::socketPacket(mtpBuffer &&data) {
 	Expects(_socket != nullptr);
 
 	// old quickack?..
-	const auto data = parsePacket(bytes);
 	if (data.size() == 1) {
 		if (data[0] != 0) {
 			error(data[0]);
@@ -596,7 +645,8 @@ void TcpConnection::socketPacket(bytes::const_span bytes) {
 	//} else if (data.size() == 2) {
 		// new quickack?..
 	} else if (_status == Status::Ready) {
-		_receivedQueue.push_back(data);
+		// Moved, so that the session decrypts it in place without a detach.
+		_receivedQueue.push_back(std::move(data));
 		receivedData();
 	} else if (_status == Status::Waiting) {
 		if (const auto res_pq = readPQFakeReply(data)) {
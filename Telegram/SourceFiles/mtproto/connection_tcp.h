@@ -55,12 +55,15 @@ private:
 	bytes::const_span prepareConnectionStartPrefix(bytes::span buffer);
 
 	void socketPacket(bytes::const_span bytes);
+	void socketPacket(mtpBuffer &&data);
 
 	void socketConnected();
 	void socketDisconnected();
 	void socketError();
 
 	mtpBuffer parsePacket(bytes::const_span bytes);
+	[[nodiscard]] mtpBuffer takeLargePacket();
+	[[nodiscard]] bytes::span currentBuffer();
 	void ensureAvailableInBuffer(int amount);
 	static uint32 fourCharsToUInt(char ch1, char ch2, char ch3, char ch4) {
 		char ch[4] = { ch1, ch2, ch3, ch4 };
@@ -75,7 +78,7 @@ private:
 	int _readBytes = 0;
 	int _leftBytes = 0;
 	bytes::vector _smallBuffer;
-	bytes::vector _largeBuffer;
+	mtpBuffer _largeBuffer; // Handed to the session when complete.
 	bool _usingLargeBuffer = false;
 
 	uchar _sendKey[CTRState::KeySize];
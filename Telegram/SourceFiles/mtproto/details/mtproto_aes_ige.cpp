@@ -0,0 +1,347 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "mtproto/details/mtproto_aes_ige.h"
+
+#include <openssl/aes.h>
+
+#if defined Q_PROCESSOR_X86_64
+#define MTP_AES_NI
+#include <immintrin.h>
+#ifdef Q_CC_MSVC
+#include <intrin.h>
+#define MTP_TARGET_AES
+#else // Q_CC_MSVC
+#define MTP_TARGET_AES __attribute__((target("aes,sse2")))
+#endif // Q_CC_MSVC
+#elif defined Q_PROCESSOR_ARM_64 // Q_PROCESSOR_X86_64
+#if defined Q_CC_MSVC \
+	|| defined __ARM_FEATURE_AES \
+	|| defined __ARM_FEATURE_CRYPTO
+#define MTP_AES_ARMV8
+#include <arm_neon.h>
+#endif // Q_CC_MSVC || __ARM_FEATURE_AES || __ARM_FEATURE_CRYPTO
+#endif // Q_PROCESSOR_X86_64 || Q_PROCESSOR_ARM_64
+
+namespace MTP::details {
+namespace {
+
+constexpr auto kBlockSize = 16;
+constexpr auto kRounds = 14;
+
+void OpenSSLIge(
+		const void *src,
+		void *dst,
+		uint32 len,
+		const void *key,
+		const void *iv,
+		bool encrypt) {
+	uchar aes_key[32], aes_iv[32];
+	memcpy(aes_key, key, 32);
+	memcpy(aes_iv, iv, 32);
+
+	AES_KEY aes;
+	if (encrypt) {
+		AES_set_encrypt_key(aes_key, 256, &aes);
+	} else {
+		AES_set_decrypt_key(aes_key, 256, &aes);
+	}
+	AES_ige_encrypt(
+		static_cast<const uchar*>(src),
+		static_cast<uchar*>(dst),
+		len,
+		&aes,
+		aes_iv,
+		encrypt ? AES_ENCRYPT : AES_DECRYPT);
+}
+
+#ifdef MTP_AES_NI
+
+template <int Rcon>
+MTP_TARGET_AES __m128i ExpandOdd(__m128i previous, __m128i last) {
+	const auto assist = _mm_shuffle_epi32(
+		_mm_aeskeygenassist_si128(last, Rcon),
+		0xFF);
+	previous = _mm_xor_si128(previous, _mm_slli_si128(previous, 4));
+	previous = _mm_xor_si128(previous, _mm_slli_si128(previous, 8));
+	return _mm_xor_si128(previous, assist);
+}
+
+MTP_TARGET_AES __m128i ExpandEven(__m128i previous, __m128i last) {
+	const auto assist = _mm_shuffle_epi32(
+		_mm_aeskeygenassist_si128(last, 0),
+		0xAA);
+	previous = _mm_xor_si128(previous, _mm_slli_si128(previous, 4));
+	previous = _mm_xor_si128(previous, _mm_slli_si128(previous, 8));
+	return _mm_xor_si128(previous, assist);
+}
+
+MTP_TARGET_AES void ExpandKey(const void *key, __m128i *keys) {
+	const auto bytes = static_cast<const uchar*>(key);
+	keys[0] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+	keys[1] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + 16));
+	keys[2] = ExpandOdd<0x01>(keys[0], keys[1]);
+	keys[3] = ExpandEven(keys[1], keys[2]);
+	keys[4] = ExpandOdd<0x02>(keys[2], keys[3]);
+	keys[5] = ExpandEven(keys[3], keys[4]);
+	keys[6] = ExpandOdd<0x04>(keys[4], keys[5]);
+	keys[7] = ExpandEven(keys[5], keys[6]);
+	keys[8] = ExpandOdd<0x08>(keys[6], keys[7]);
+	keys[9] = ExpandEven(keys[7], keys[8]);
+	keys[10] = ExpandOdd<0x10>(keys[8], keys[9]);
+	keys[11] = ExpandEven(keys[9], keys[10]);
+	keys[12] = ExpandOdd<0x20>(keys[10], keys[11]);
+	keys[13] = ExpandEven(keys[11], keys[12]);
+	keys[14] = ExpandOdd<0x40>(keys[12], keys[13]);
+}
+
+MTP_TARGET_AES void IgeEncryptNi(
+		const uchar *src,
+		uchar *dst,
+		uint32 len,
+		const void *key,
+		const uchar *iv) {
+	__m128i keys[kRounds + 1];
+	ExpandKey(key, keys);
+
+	auto previousOut = _mm_loadu_si128(reinterpret_cast<const __m128i*>(iv));
+	auto previousIn = _mm_loadu_si128(
+		reinterpret_cast<const __m128i*>(iv + kBlockSize));
+	for (auto offset = uint32(); offset != len; offset += kBlockSize) {
+		const auto in = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(src + offset));
+		auto state = _mm_xor_si128(_mm_xor_si128(in, previousOut), keys[0]);
+		for (auto round = 1; round != kRounds; ++round) {
+			state = _mm_aesenc_si128(state, keys[round]);
+		}
+		state = _mm_aesenclast_si128(state, keys[kRounds]);
+		previousOut = _mm_xor_si128(state, previousIn);
+		previousIn = in;
+		_mm_storeu_si128(
+			reinterpret_cast<__m128i*>(dst + offset),
+			previousOut);
+	}
+}
+
+MTP_TARGET_AES void IgeDecryptNi(
+		const uchar *src,
+		uchar *dst,
+		uint32 len,
+		const void *key,
+		const uchar *iv) {
+	__m128i keys[kRounds + 1];
+	ExpandKey(key, keys);
+
+	// Round keys of the equivalent inverse cipher.
+	__m128i reversed[kRounds + 1];
+	reversed[0] = keys[kRounds];
+	for (auto round = 1; round != kRounds; ++round) {
+		reversed[round] = _mm_aesimc_si128(keys[kRounds - round]);
+	}
+	reversed[kRounds] = keys[0];
+
+	auto previousIn = _mm_loadu_si128(reinterpret_cast<const __m128i*>(iv));
+	auto previousOut = _mm_loadu_si128(
+		reinterpret_cast<const __m128i*>(iv + kBlockSize));
+	for (auto offset = uint32(); offset != len; offset += kBlockSize) {
+		const auto in = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(src + offset));
+		auto state = _mm_xor_si128(
+			_mm_xor_si128(in, previousOut),
+			reversed[0]);
+		for (auto round = 1; round != kRounds; ++round) {
+			state = _mm_aesdec_si128(state, reversed[round]);
+		}
+		state = _mm_aesdeclast_si128(state, reversed[kRounds]);
+		previousOut = _mm_xor_si128(state, previousIn);
+		previousIn = in;
+		_mm_storeu_si128(
+			reinterpret_cast<__m128i*>(dst + offset),
+			previousOut);
+	}
+}
+
+[[nodiscard]] bool HasAesInstructions() {
+#ifdef Q_CC_MSVC
+	int info[4] = { 0 };
+	__cpuid(info, 1);
+	return (info[2] & (1 << 25)) != 0;
+#else // Q_CC_MSVC
+	return __builtin_cpu_supports("aes");
+#endif // Q_CC_MSVC
+}
+
+#elif defined MTP_AES_ARMV8 // MTP_AES_NI
+
+[[nodiscard]] uint32 SubWord(uint32 word) {
+	// With equal columns ShiftRows moves nothing, AESE is SubBytes then.
+	const auto state = vaeseq_u8(
+		vreinterpretq_u8_u32(vdupq_n_u32(word)),
+		vdupq_n_u8(0));
+	return vgetq_lane_u32(vreinterpretq_u32_u8(state), 0);
+}
+
+void ExpandKey(const void *key, uint8x16_t *keys) {
+	constexpr auto kKeyWords = 8;
+	constexpr auto kWords = (kRounds + 1) * 4;
+	constexpr uint32 kRcon[] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40 };
+
+	// Little-endian words, the first key byte is the lowest.
+	uint32 words[kWords];
+	memcpy(words, key, kKeyWords * sizeof(uint32));
+	for (auto i = kKeyWords; i != kWords; ++i) {
+		auto word = words[i - 1];
+		if (!(i % kKeyWords)) {
+			word = SubWord((word >> 8) | (word << 24))
+				^ kRcon[i / kKeyWords - 1];
+		} else if (i % kKeyWords == 4) {
+			word = SubWord(word);
+		}
+		words[i] = words[i - kKeyWords] ^ word;
+	}
+	for (auto round = 0; round != kRounds + 1; ++round) {
+		keys[round] = vld1q_u8(
+			reinterpret_cast<const uint8_t*>(words + round * 4));
+	}
+}
+
+void IgeEncryptArmv8(
+		const uchar *src,
+		uchar *dst,
+		uint32 len,
+		const void *key,
+		const uchar *iv) {
+	uint8x16_t keys[kRounds + 1];
+	ExpandKey(key, keys);
+
+	auto previousOut = vld1q_u8(iv);
+	auto previousIn = vld1q_u8(iv + kBlockSize);
+	for (auto offset = uint32(); offset != len; offset += kBlockSize) {
+		const auto in = vld1q_u8(src + offset);
+		auto state = veorq_u8(in, previousOut);
+		for (auto round = 0; round != kRounds - 1; ++round) {
+			state = vaesmcq_u8(vaeseq_u8(state, keys[round]));
+		}
+		state = veorq_u8(
+			vaeseq_u8(state, keys[kRounds - 1]),
+			keys[kRounds]);
+		previousOut = veorq_u8(state, previousIn);
+		previousIn = in;
+		vst1q_u8(dst + offset, previousOut);
+	}
+}
+
+void IgeDecryptArmv8(
+		const uchar *src,
+		uchar *dst,
+		uint32 len,
+		const void *key,
+		const uchar *iv) {
+	uint8x16_t keys[kRounds + 1];
+	ExpandKey(key, keys);
+
+	// Round keys of the equivalent inverse cipher.
+	uint8x16_t reversed[kRounds + 1];
+	reversed[0] = keys[kRounds];
+	for (auto round = 1; round != kRounds; ++round) {
+		reversed[round] = vaesimcq_u8(keys[kRounds - round]);
+	}
+	reversed[kRounds] = keys[0];
+
+	auto previousIn = vld1q_u8(iv);
+	auto previousOut = vld1q_u8(iv + kBlockSize);
+	for (auto offset = uint32(); offset != len; offset += kBlockSize) {
+		const auto in = vld1q_u8(src + offset);
+		auto state = veorq_u8(in, previousOut);
+		for (auto round = 0; round != kRounds - 1; ++round) {
+			state = vaesimcq_u8(vaesdq_u8(state, reversed[round]));
+		}
+		state = veorq_u8(
+			vaesdq_u8(state, reversed[kRounds - 1]),
+			reversed[kRounds]);
+		previousOut = veorq_u8(state, previousIn);
+		previousIn = in;
+		vst1q_u8(dst + offset, previousOut);
+	}
+}
+
+#endif // MTP_AES_NI || MTP_AES_ARMV8
+
+} // namespace
+
+void AesIgeEncrypt(
+		const void *src,
+		void *dst,
+		uint32 len,
+		const void *key,
+		const void *iv) {
+	Expects(!(len % kBlockSize));
+
+#ifdef MTP_AES_NI
+	if (AesIgeAccelerated()) {
+		IgeEncryptNi(
+			static_cast<const uchar*>(src),
+			static_cast<uchar*>(dst),
+			len,
+			key,
+			static_cast<const uchar*>(iv));
+		return;
+	}
+#elif defined MTP_AES_ARMV8 // MTP_AES_NI
+	IgeEncryptArmv8(
+		static_cast<const uchar*>(src),
+		static_cast<uchar*>(dst),
+		len,
+		key,
+		static_cast<const uchar*>(iv));
+	return;
+#endif // MTP_AES_NI || MTP_AES_ARMV8
+	OpenSSLIge(src, dst, len, key, iv, true);
+}
+
+void AesIgeDecrypt(
+		const void *src,
+		void *dst,
+		uint32 len,
+		const void *key,
+		const void *iv) {
+	Expects(!(len % kBlockSize));
+
+#ifdef MTP_AES_NI
+	if (AesIgeAccelerated()) {
+		IgeDecryptNi(
+			static_cast<const uchar*>(src),
+			static_cast<uchar*>(dst),
+			len,
+			key,
+			static_cast<const uchar*>(iv));
+		return;
+	}
+#elif defined MTP_AES_ARMV8 // MTP_AES_NI
+	IgeDecryptArmv8(
+		static_cast<const uchar*>(src),
+		static_cast<uchar*>(dst),
+		len,
+		key,
+		static_cast<const uchar*>(iv));
+	return;
+#endif // MTP_AES_NI || MTP_AES_ARMV8
+	OpenSSLIge(src, dst, len, key, iv, false);
+}
+
+bool AesIgeAccelerated() {
+#ifdef MTP_AES_NI
+	static const auto result = HasAesInstructions();
+	return result;
+#elif defined MTP_AES_ARMV8 // MTP_AES_NI
+	return true;
+#else // MTP_AES_NI || MTP_AES_ARMV8
+	return false;
+#endif // MTP_AES_NI || MTP_AES_ARMV8
+}
+
+} // namespace MTP::details
@@ -0,0 +1,31 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace MTP::details {
+
+// AES-256 in IGE mode with the OpenSSL conventions: the 32 byte iv is
+// the previous ciphertext block followed by the previous plaintext one.
+// Uses AES-NI or ARMv8 crypto instructions when the CPU has them and
+// OpenSSL otherwise. len is a multiple of 16, src may be dst.
+void AesIgeEncrypt(
+	const void *src,
+	void *dst,
+	uint32 len,
+	const void *key,
+	const void *iv);
+void AesIgeDecrypt(
+	const void *src,
+	void *dst,
+	uint32 len,
+	const void *key,
+	const void *iv);
+
+[[nodiscard]] bool AesIgeAccelerated();
+
+} // namespace MTP::details
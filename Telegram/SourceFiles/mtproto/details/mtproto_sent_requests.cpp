@@ -0,0 +1,63 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "mtproto/details/mtproto_sent_requests.h"
+
+namespace MTP::details {
+
+bool SentRequests::emplace(
+		mtpMsgId msgId,
+		const SerializedRequest &request) {
+	const auto [i, ok] = _requests.emplace(msgId, request);
+	if (ok) {
+		_bySentTime.emplace(request->lastSentTime, msgId);
+	}
+	return ok;
+}
+
+SentRequests::iterator SentRequests::erase(const_iterator i) {
+	return _requests.erase(i);
+}
+
+bool SentRequests::remove(mtpMsgId msgId) {
+	return _requests.erase(msgId) > 0;
+}
+
+void SentRequests::clear() {
+	_requests.clear();
+	_bySentTime.clear();
+}
+
+std::vector<mtpMsgId> SentRequests::touchSentBefore(
+		crl::time checkTime,
+		crl::time now) {
+	auto result = std::vector<mtpMsgId>();
+	while (!_bySentTime.empty()) {
+		const auto first = _bySentTime.begin();
+		const auto [sent, msgId] = *first;
+		if (sent > checkTime) {
+			break;
+		}
+		_bySentTime.erase(first);
+
+		// An entry of an answered request, or of a msg_id sent again.
+		const auto i = _requests.find(msgId);
+		if (i == _requests.end() || i->second->lastSentTime != sent) {
+			continue;
+		}
+		i->second->lastSentTime = now;
+		_bySentTime.emplace(now, msgId);
+		result.push_back(msgId);
+	}
+	return result;
+}
+
+crl::time SentRequests::firstSentTime() const {
+	return _bySentTime.empty() ? -1 : _bySentTime.begin()->first;
+}
+
+} // namespace MTP::details
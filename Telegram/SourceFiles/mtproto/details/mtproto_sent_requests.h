@@ -0,0 +1,80 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "mtproto/details/mtproto_serialized_request.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+namespace MTP::details {
+
+// Sent requests waiting for an answer, by msg_id, with an index by the
+// time they were sent, so that a state check touches only the requests
+// sent long enough ago instead of all of them. The index is kept lazily:
+// erasing leaves its entry to be dropped when the check reaches it. A
+// request's lastSentTime may change only through touchSentBefore() while
+// it is in the table.
+class SentRequests final {
+public:
+	using Map = std::map<mtpMsgId, SerializedRequest>;
+	using iterator = Map::iterator;
+	using const_iterator = Map::const_iterator;
+
+	[[nodiscard]] bool empty() const {
+		return _requests.empty();
+	}
+	[[nodiscard]] int size() const {
+		return int(_requests.size());
+	}
+	[[nodiscard]] iterator begin() {
+		return _requests.begin();
+	}
+	[[nodiscard]] iterator end() {
+		return _requests.end();
+	}
+	[[nodiscard]] const_iterator begin() const {
+		return _requests.begin();
+	}
+	[[nodiscard]] const_iterator end() const {
+		return _requests.end();
+	}
+	[[nodiscard]] iterator find(mtpMsgId msgId) {
+		return _requests.find(msgId);
+	}
+	[[nodiscard]] const_iterator find(mtpMsgId msgId) const {
+		return _requests.find(msgId);
+	}
+	[[nodiscard]] bool contains(mtpMsgId msgId) const {
+		return _requests.contains(msgId);
+	}
+
+	// Doesn't replace a request already sent with that msg_id.
+	bool emplace(mtpMsgId msgId, const SerializedRequest &request);
+	iterator erase(const_iterator i);
+	bool remove(mtpMsgId msgId);
+	void clear();
+
+	// Requests sent at checkTime or before get lastSentTime = now and are
+	// returned, so that each is checked once per timeout.
+	[[nodiscard]] std::vector<mtpMsgId> touchSentBefore(
+		crl::time checkTime,
+		crl::time now);
+
+	// Of the request sent first, or -1 when none is waiting. May be of an
+	// answered one, which only makes the next check come a bit early.
+	[[nodiscard]] crl::time firstSentTime() const;
+
+private:
+	Map _requests;
+	std::set<std::pair<crl::time, mtpMsgId>> _bySentTime;
+
+};
+
+} // namespace MTP::details
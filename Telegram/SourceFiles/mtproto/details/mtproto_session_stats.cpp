@@ -0,0 +1,84 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "mtproto/details/mtproto_session_stats.h"
+
+namespace MTP::details {
+namespace {
+
+constexpr auto kRelaxed = std::memory_order_relaxed;
+
+[[nodiscard]] int BucketIndex(crl::time duration) {
+	const auto last = int(kResponseTimeBuckets.size()) - 1;
+	for (auto i = 0; i != last; ++i) {
+		if (duration < kResponseTimeBuckets[i]) {
+			return i;
+		}
+	}
+	return last;
+}
+
+} // namespace
+
+void SessionStats::sent(int bytes) {
+	_bytesSent.fetch_add(bytes, kRelaxed);
+	_packetsSent.fetch_add(1, kRelaxed);
+}
+
+void SessionStats::received(int bytes) {
+	_bytesReceived.fetch_add(bytes, kRelaxed);
+	_packetsReceived.fetch_add(1, kRelaxed);
+}
+
+void SessionStats::container(int messages) {
+	_containers.fetch_add(1, kRelaxed);
+	_containerMessages.fetch_add(messages, kRelaxed);
+}
+
+void SessionStats::resent(int count) {
+	_resent.fetch_add(count, kRelaxed);
+}
+
+void SessionStats::responded(crl::time duration) {
+	duration = std::max(duration, crl::time(0));
+	_responses.fetch_add(1, kRelaxed);
+	_responseTimeSum.fetch_add(duration, kRelaxed);
+	_responseTimes[BucketIndex(duration)].fetch_add(1, kRelaxed);
+
+	// Only the SessionPrivate thread writes, no compare-exchange needed.
+	if (duration > _responseTimeMax.load(kRelaxed)) {
+		_responseTimeMax.store(duration, kRelaxed);
+	}
+}
+
+void SessionStats::handled(int64 microseconds) {
+	_handled.fetch_add(1, kRelaxed);
+	_handleMicroseconds.fetch_add(microseconds, kRelaxed);
+}
+
+SessionStatsSnapshot SessionStats::snapshot() const {
+	auto result = SessionStatsSnapshot{
+		.bytesSent = _bytesSent.load(kRelaxed),
+		.bytesReceived = _bytesReceived.load(kRelaxed),
+		.packetsSent = _packetsSent.load(kRelaxed),
+		.packetsReceived = _packetsReceived.load(kRelaxed),
+		.containers = _containers.load(kRelaxed),
+		.containerMessages = _containerMessages.load(kRelaxed),
+		.resent = _resent.load(kRelaxed),
+		.responses = _responses.load(kRelaxed),
+		.responseTimeSum = _responseTimeSum.load(kRelaxed),
+		.responseTimeMax = _responseTimeMax.load(kRelaxed),
+		.handled = _handled.load(kRelaxed),
+		.handleMicroseconds = _handleMicroseconds.load(kRelaxed),
+	};
+	for (auto i = 0; i != int(_responseTimes.size()); ++i) {
+		result.responseTimes[i] = _responseTimes[i].load(kRelaxed);
+	}
+	return result;
+}
+
+} // namespace MTP::details
@@ -0,0 +1,79 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <array>
+#include <atomic>
+
+namespace MTP::details {
+
+// Upper bounds of the response time buckets, in ms, the last is open.
+inline constexpr auto kResponseTimeBuckets = std::array<crl::time, 10>{
+	25, 50, 100, 200, 400, 800, 1600, 3200, 6400, 0,
+};
+
+struct SessionStatsSnapshot {
+	ShiftedDcId shiftedDcId = 0;
+	int32 state = 0;
+	QString transport;
+
+	int64 bytesSent = 0;
+	int64 bytesReceived = 0;
+	int64 packetsSent = 0;
+	int64 packetsReceived = 0;
+	int64 containers = 0;
+	int64 containerMessages = 0;
+	int64 resent = 0;
+
+	int64 responses = 0;
+	crl::time responseTimeSum = 0;
+	crl::time responseTimeMax = 0;
+	std::array<int64, kResponseTimeBuckets.size()> responseTimes = { 0 };
+
+	int64 handled = 0;
+	int64 handleMicroseconds = 0;
+
+	int toSend = 0;
+	int haveSent = 0;
+};
+
+// Counters of one session, written from the SessionPrivate thread and
+// read from any. Everything is relaxed, a snapshot is not consistent
+// between the counters, but each of them is exact.
+class SessionStats final {
+public:
+	void sent(int bytes);
+	void received(int bytes);
+	void container(int messages);
+	void resent(int count = 1);
+	void responded(crl::time duration);
+	void handled(int64 microseconds);
+
+	// Without the fields of Session: dc, state, transport and queues.
+	[[nodiscard]] SessionStatsSnapshot snapshot() const;
+
+private:
+	using Counter = std::atomic<int64>;
+
+	Counter _bytesSent = 0;
+	Counter _bytesReceived = 0;
+	Counter _packetsSent = 0;
+	Counter _packetsReceived = 0;
+	Counter _containers = 0;
+	Counter _containerMessages = 0;
+	Counter _resent = 0;
+	Counter _responses = 0;
+	Counter _responseTimeSum = 0;
+	Counter _responseTimeMax = 0;
+	std::array<Counter, kResponseTimeBuckets.size()> _responseTimes = {};
+	Counter _handled = 0;
+	Counter _handleMicroseconds = 0;
+
+};
+
+} // namespace MTP::details
@@ -20,6 +20,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "main/main_account.h" // Account::configUpdated.
 #include "core/application.h"
 #include "core/core_settings.h"
+#include "core/core_tracing.h"
 #include "lang/lang_instance.h"
 #include "lang/lang_cloud_manager.h"
 #include "base/unixtime.h"
@@ -106,6 +107,8 @@ public:
 	void restart(ShiftedDcId shiftedDcId);
 	[[nodiscard]] int32 dcstate(ShiftedDcId shiftedDcId = 0);
 	[[nodiscard]] QString dctransport(ShiftedDcId shiftedDcId = 0);
+	[[nodiscard]] auto sessionsStats() const
+	-> std::vector<details::SessionStatsSnapshot>;
 	void ping();
 	void cancel(mtpRequestId requestId);
 	[[nodiscard]] int32 state(mtpRequestId requestId); // < 0 means waiting for such count of ms
@@ -652,6 +655,16 @@ QString Instance::Private::dctransport(ShiftedDcId shiftedDcId) {
 	return QString();
 }
 
+auto Instance::Private::sessionsStats() const
+-> std::vector<details::SessionStatsSnapshot> {
+	auto result = std::vector<details::SessionStatsSnapshot>();
+	result.reserve(_sessions.size());
+	for (const auto &[shiftedDcId, session] : _sessions) {
+		result.push_back(session->stats());
+	}
+	return result;
+}
+
 void Instance::Private::ping() {
 	getSession(0)->ping();
 }
@@ -1144,6 +1157,7 @@ bool Instance::Private::hasCallback(mtpRequestId requestId) const {
 
 void Instance::Private::processCallback(const Response &response) {
 	const auto requestId = response.requestId;
+	const auto trace = Core::Tracing::Scope("mtproto", "processCallback", requestId);
 	ResponseHandler handler;
 	{
 		QMutexLocker locker(&_parserMapLock);
@@ -1202,6 +1216,7 @@ void Instance::Private::processCallback(const Response &response) {
 }
 
 void Instance::Private::processUpdate(const Response &message) {
+	const auto trace = Core::Tracing::Scope("mtproto", "processUpdate");
 	if (_updatesHandler) {
 		_updatesHandler(message);
 	}
@@ -1956,6 +1971,11 @@ QString Instance::dctransport(ShiftedDcId shiftedDcId) {
 	return _private->dctransport(shiftedDcId);
 }
 
+auto Instance::sessionsStats() const
+-> std::vector<details::SessionStatsSnapshot> {
+	return _private->sessionsStats();
+}
+
 void Instance::ping() {
 	_private->ping();
 }
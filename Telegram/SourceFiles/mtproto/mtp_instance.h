@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "mtproto/details/mtproto_serialized_request.h"
+#include "mtproto/details/mtproto_session_stats.h"
 #include "mtproto/mtproto_response.h"
 
 namespace MTP {
@@ -94,6 +95,10 @@ public:
 	int32 dcstate(ShiftedDcId shiftedDcId = 0);
 	QString dctransport(ShiftedDcId shiftedDcId = 0);
 	void ping();
+
+	// Main thread, counters of every session since it was created.
+	[[nodiscard]] auto sessionsStats() const
+	-> std::vector<details::SessionStatsSnapshot>;
 	void cancel(mtpRequestId requestId);
 	int32 state(mtpRequestId requestId); // < 0 means waiting for such count of ms
 
@@ -351,7 +351,7 @@ void Session::resetDone() {
 void Session::cancel(mtpRequestId requestId, mtpMsgId msgId) {
 	if (requestId) {
 		QWriteLocker locker(_data->toSendMutex());
-		_data->toSendMap().remove(requestId);
+		_data->toSendMap().erase(requestId);
 	}
 	if (msgId) {
 		QWriteLocker locker(_data->haveSentMutex());
@@ -419,6 +419,22 @@ QString Session::transport() const {
 	return _private ? _private->transport() : QString();
 }
 
+SessionStatsSnapshot Session::stats() const {
+	auto result = _data->stats().snapshot();
+	result.shiftedDcId = _shiftedDcId;
+	result.state = getState();
+	result.transport = transport();
+	{
+		QReadLocker locker(_data->toSendMutex());
+		result.toSend = int(_data->toSendMap().size());
+	}
+	{
+		QReadLocker locker(_data->haveSentMutex());
+		result.haveSent = _data->haveSentMap().size();
+	}
+	return result;
+}
+
 void Session::sendPrepared(
 		const SerializedRequest &request,
 		crl::time msCanWait) {
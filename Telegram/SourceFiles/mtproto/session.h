@@ -10,7 +10,9 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/timer.h"
 #include "mtproto/mtproto_response.h"
 #include "mtproto/mtproto_proxy_data.h"
+#include "mtproto/details/mtproto_sent_requests.h"
 #include "mtproto/details/mtproto_serialized_request.h"
+#include "mtproto/details/mtproto_session_stats.h"
 
 #include <QtCore/QTimer>
 
@@ -78,15 +80,21 @@ public:
 		return &_haveReceivedLock;
 	}
 
-	base::flat_map<mtpRequestId, SerializedRequest> &toSendMap() {
+	std::map<mtpRequestId, SerializedRequest> &toSendMap() {
 		return _toSend;
 	}
-	base::flat_map<mtpMsgId, SerializedRequest> &haveSentMap() {
+	SentRequests &haveSentMap() {
 		return _haveSent;
 	}
 	std::vector<Response> &haveReceivedMessages() {
 		return _receivedMessages;
 	}
+	[[nodiscard]] SessionStats &stats() {
+		return _stats;
+	}
+	[[nodiscard]] const SessionStats &stats() const {
+		return _stats;
+	}
 
 	// SessionPrivate -> Session interface.
 	void queueTryToReceive();
@@ -119,15 +127,19 @@ private:
 	SessionOptions _options;
 	mutable QReadWriteLock _optionsLock;
 
-	base::flat_map<mtpRequestId, SerializedRequest> _toSend; // map of request_id -> request, that is waiting to be sent
+	// A node map, with thousands of requests in flight a sorted vector
+	// spends its time moving the others on every insert and erase.
+	std::map<mtpRequestId, SerializedRequest> _toSend; // map of request_id -> request, that is waiting to be sent
 	QReadWriteLock _toSendLock;
 
-	base::flat_map<mtpMsgId, SerializedRequest> _haveSent; // map of msg_id -> request, that was sent
+	SentRequests _haveSent; // map of msg_id -> request, that was sent
 	QReadWriteLock _haveSentLock;
 
 	std::vector<Response> _receivedMessages; // list of responses / updates that should be processed in the main thread
 	QReadWriteLock _haveReceivedLock;
 
+	SessionStats _stats;
+
 };
 
 class Session final : public QObject {
@@ -176,6 +188,7 @@ public:
 	int requestState(mtpRequestId requestId) const;
 	int getState() const;
 	QString transport() const;
+	[[nodiscard]] SessionStatsSnapshot stats() const;
 
 	void tryToReceive();
 	void needToResumeAndSend();
@@ -16,6 +16,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mtproto/mtproto_response.h"
 #include "mtproto/mtproto_dc_options.h"
 #include "mtproto/connection_abstract.h"
+#include "core/core_tracing.h"
 #include "base/random.h"
 #include "base/qthelp_url.h"
 #include "base/openssl_help.h"
@@ -24,6 +25,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include <ksandbox.h>
 #include <zlib.h>
+#include <chrono>
 
 namespace MTP {
 namespace details {
@@ -76,6 +78,28 @@ using namespace details;
 	return idsStr + "]";
 }
 
+// Finds the bytes of a serialized TL string without copying them out.
+[[nodiscard]] bytes::const_span ReadStringView(
+		const mtpPrime *from,
+		const mtpPrime *end) {
+	if (from >= end) {
+		return {};
+	}
+	const auto begin = reinterpret_cast<const uchar*>(from);
+	const auto available = (end - from) * sizeof(mtpPrime);
+	const auto first = begin[0];
+	const auto skip = (first == 254) ? 4 : 1;
+	const auto length = (first == 254)
+		? (uint32(begin[1])
+			| (uint32(begin[2]) << 8)
+			| (uint32(begin[3]) << 16))
+		: uint32(first);
+	if (first == 255 || skip + length > available) {
+		return {};
+	}
+	return bytes::make_span(begin + skip, length);
+}
+
 [[nodiscard]] QString ComputeAppVersion() {
 #if defined Q_OS_WIN && defined Q_PROCESSOR_X86_64
 	const auto arch = u" x64"_q;
@@ -102,7 +126,7 @@ using namespace details;
 void WrapInvokeAfter(
 		SerializedRequest &to,
 		const SerializedRequest &from,
-		const base::flat_map<mtpMsgId, SerializedRequest> &haveSent,
+		const SentRequests &haveSent,
 		int32 skipBeforeRequest = 0) {
 	const auto afterId = *(mtpMsgId*)(from->after->data() + 4);
 	const auto i = afterId ? haveSent.find(afterId) : haveSent.end();
@@ -273,19 +297,17 @@ void SessionPrivate::checkSentRequests() {
 	auto requesting = false;
 	auto nextTimeout = kCheckSentRequestTimeout;
 	{
-		QReadLocker locker(_sessionData->haveSentMutex());
+		QWriteLocker locker(_sessionData->haveSentMutex());
 		auto &haveSent = _sessionData->haveSentMap();
-		for (const auto &[msgId, request] : haveSent) {
-			if (request->lastSentTime <= checkTime) {
-				// Need to check state.
-				request->lastSentTime = now;
-				if (_stateRequestData.emplace(msgId).second) {
-					requesting = true;
-				}
-			} else {
-				nextTimeout = std::min(request->lastSentTime - checkTime, nextTimeout);
+		for (const auto msgId : haveSent.touchSentBefore(checkTime, now)) {
+			// Need to check state.
+			if (_stateRequestData.emplace(msgId).second) {
+				requesting = true;
 			}
 		}
+		if (const auto first = haveSent.firstSentTime(); first >= 0) {
+			nextTimeout = std::min(first - checkTime, nextTimeout);
+		}
 	}
 	if (requesting) {
 		_sessionData->queueSendAnything(kSendStateRequestWaiting);
@@ -570,6 +592,7 @@ MTPVector<MTPJSONObjectValue> SessionPrivate::prepareInitParams() {
 }
 
 void SessionPrivate::tryToSend() {
+	const auto trace = Core::Tracing::Scope("mtproto", "tryToSend", _shiftedDcId);
 	DEBUG_LOG(("MTP Info: tryToSend for dc %1.").arg(_shiftedDcId));
 	if (!_connection) {
 		DEBUG_LOG(("MTP Info: not yet connected in dc %1.").arg(_shiftedDcId));
@@ -715,7 +738,7 @@ void SessionPrivate::tryToSend() {
 
 		auto scheduleCheckSentRequests = false;
 
-		auto toSendDummy = base::flat_map<mtpRequestId, SerializedRequest>();
+		auto toSendDummy = std::map<mtpRequestId, SerializedRequest>();
 		auto &toSend = sendAll
 			? _sessionData->toSendMap()
 			: toSendDummy;
@@ -731,7 +754,7 @@ void SessionPrivate::tryToSend() {
 			combinedLength += i->second->size();
 			if (combinedLength >= kCutContainerOnSize) {
 				++i;
-				if (const auto skipping = int(sendingTill - i)) {
+				if (const auto skipping = int(std::distance(i, sendingTill))) {
 					sendingTill = i;
 					totalSending -= skipping;
 					Assert(totalSending > 0);
@@ -858,6 +881,7 @@ void SessionPrivate::tryToSend() {
 				containerSize + 3 * sendingCount);
 			toSendRequest->push_back(mtpc_msg_container);
 			toSendRequest->push_back(totalSending);
+			_sessionData->stats().container(totalSending);
 
 			// check for a valid container
 			auto bigMsgId = base::unixtime::mtproto_msg_id();
@@ -1270,6 +1294,7 @@ void SessionPrivate::requestCDNConfig() {
 void SessionPrivate::handleReceived() {
 	Expects(_encryptionKey != nullptr);
 
+	const auto trace = Core::Tracing::Scope("mtproto", "handleReceived", _shiftedDcId);
 	onReceivedSome();
 
 	while (!_connection->received().empty()) {
@@ -1281,11 +1306,12 @@ void SessionPrivate::handleReceived() {
 		constexpr auto kMinimalEncryptedIntsCount = kEncryptedHeaderIntsCount + 4U; // + 1 data + 3 padding
 		constexpr auto kMinimalIntsCount = kExternalHeaderIntsCount + kMinimalEncryptedIntsCount;
 		auto intsCount = uint32(intsBuffer.size());
-		auto ints = intsBuffer.constData();
+		auto ints = intsBuffer.data(); // Decrypted in place.
 		if ((intsCount < kMinimalIntsCount) || (intsCount > kMaxMessageLength / kIntSize)) {
 			LOG(("TCP Error: bad message received, len %1").arg(intsCount * kIntSize));
 			return restart();
 		}
+		_sessionData->stats().received(intsCount * kIntSize);
 		if (_keyId != *(uint64*)ints) {
 			LOG(("TCP Error: bad auth_key_id %1 instead of %2 received").arg(_keyId).arg(*(uint64*)ints));
 			return restart();
@@ -1297,12 +1323,12 @@ void SessionPrivate::handleReceived() {
 		auto encryptedInts = ints + kExternalHeaderIntsCount;
 		auto encryptedIntsCount = (intsCount - kExternalHeaderIntsCount) & ~0x03U;
 		auto encryptedBytesCount = encryptedIntsCount * kIntSize;
-		auto decryptedBuffer = QByteArray(encryptedBytesCount, Qt::Uninitialized);
 		auto msgKey = *(MTPint128*)(ints + 2);
 
-		aesIgeDecrypt(encryptedInts, decryptedBuffer.data(), encryptedBytesCount, _encryptionKey, msgKey);
+		// Large file parts are not copied once more for decryption.
+		aesIgeDecrypt(encryptedInts, encryptedInts, encryptedBytesCount, _encryptionKey, msgKey);
 
-		auto decryptedInts = reinterpret_cast<const mtpPrime*>(decryptedBuffer.constData());
+		const mtpPrime *decryptedInts = encryptedInts;
 		auto serverSalt = *(uint64*)&decryptedInts[0];
 		auto session = *(uint64*)&decryptedInts[2];
 		auto msgId = *(uint64*)&decryptedInts[4];
@@ -1397,12 +1423,17 @@ void SessionPrivate::handleReceived() {
 			msgId,
 			needAck);
 		if (registered == ReceivedIdsManager::Result::Success) {
+			using Clock = std::chrono::steady_clock;
+			const auto handleStarted = Clock::now();
 			res = handleOneReceived(from, end, msgId, {
 				.outerMsgId = msgId,
 				.serverSalt = serverSalt,
 				.serverTime = serverTime,
 				.badTime = badTime,
 			});
+			_sessionData->stats().handled(
+				std::chrono::duration_cast<std::chrono::microseconds>(
+					Clock::now() - handleStarted).count());
 		} else if (registered == ReceivedIdsManager::Result::TooOld) {
 			res = HandleResult::ResetSession;
 		}
@@ -1926,7 +1957,7 @@ SessionPrivate::HandleResult SessionPrivate::handleOneReceived(
 		// Notify main process about new session - need to get difference.
 		QWriteLocker locker(_sessionData->haveReceivedMutex());
 		_sessionData->haveReceivedMessages().push_back({
-			.reply = update,
+			.reply = std::move(update),
 			.outerMsgId = info.outerMsgId,
 		});
 	} return HandleResult::Success;
@@ -1976,7 +2007,7 @@ SessionPrivate::HandleResult SessionPrivate::handleOneReceived(
 		// Notify main process about the new updates.
 		QWriteLocker locker(_sessionData->haveReceivedMutex());
 		_sessionData->haveReceivedMessages().push_back({
-			.reply = update,
+			.reply = std::move(update),
 			.outerMsgId = info.outerMsgId,
 		});
 	} else {
@@ -2021,12 +2052,14 @@ mtpBuffer SessionPrivate::ungzip(const mtpPrime *from, const mtpPrime *end) cons
 	mtpBuffer result; // * 4 because of mtpPrime type
 	result.resize(0);
 
-	MTPstring packed;
-	if (!packed.read(from, end)) { // read packed string as serialized mtp string type
+	// Inflate right from the received buffer, big differences and
+	// message slices come packed and would be copied out only for this.
+	const auto packed = ReadStringView(from, end);
+	if (packed.empty()) {
 		LOG(("RPC Error: could not read gziped bytes."));
 		return result;
 	}
-	uint32 packedLen = packed.v.size(), unpackedChunk = packedLen;
+	uint32 packedLen = packed.size(), unpackedChunk = packedLen;
 
 	z_stream stream;
 	stream.zalloc = 0;
@@ -2040,7 +2073,8 @@ mtpBuffer SessionPrivate::ungzip(const mtpPrime *from, const mtpPrime *end) cons
 		return result;
 	}
 	stream.avail_in = packedLen;
-	stream.next_in = reinterpret_cast<Bytef*>(packed.v.data());
+	stream.next_in = reinterpret_cast<Bytef*>(
+		const_cast<std::byte*>(packed.data()));
 
 	stream.avail_out = 0;
 	while (!stream.avail_out) {
@@ -2051,7 +2085,7 @@ mtpBuffer SessionPrivate::ungzip(const mtpPrime *from, const mtpPrime *end) cons
 		if (res != Z_OK && res != Z_STREAM_END) {
 			inflateEnd(&stream);
 			LOG(("RPC Error: could not unpack gziped data, code: %1").arg(res));
-			DEBUG_LOG(("RPC Error: bad gzip: %1").arg(Logs::mb(packed.v.constData(), packedLen).str()));
+			DEBUG_LOG(("RPC Error: bad gzip: %1").arg(Logs::mb(packed.data(), packedLen).str()));
 			return mtpBuffer();
 		}
 	}
@@ -2117,6 +2151,7 @@ void SessionPrivate::requestsAcked(const QVector<MTPlong> &ids, bool byResponse)
 
 	QVector<MTPlong> toAckMore;
 	{
+		const auto now = crl::now();
 		QWriteLocker locker2(_sessionData->haveSentMutex());
 		auto &haveSent = _sessionData->haveSentMap();
 
@@ -2143,6 +2178,10 @@ void SessionPrivate::requestsAcked(const QVector<MTPlong> &ids, bool byResponse)
 					DEBUG_LOG(("Message Info: ignoring ACK for msgId %1 because request %2 requires a response").arg(msgId).arg(requestId));
 					continue;
 				}
+				if (byResponse) {
+					_sessionData->stats().responded(
+						now - i->second->lastSentTime);
+				}
 				haveSent.erase(i);
 
 				_ackedIds.emplace(msgId, requestId);
@@ -2275,6 +2314,7 @@ void SessionPrivate::resend(mtpMsgId msgId, crl::time msCanWait) {
 	haveSent.erase(i);
 	lock.unlock();
 
+	_sessionData->stats().resent();
 	request->lastSentTime = crl::now();
 	request->forceSendInContainer = true;
 	_resendingIds.emplace(msgId, request->requestId);
@@ -2288,6 +2328,9 @@ void SessionPrivate::resendAll() {
 	auto lock = QWriteLocker(_sessionData->haveSentMutex());
 	auto haveSent = base::take(_sessionData->haveSentMap());
 	lock.unlock();
+	if (!haveSent.empty()) {
+		_sessionData->stats().resent(haveSent.size());
+	}
 	{
 		auto lock = QWriteLocker(_sessionData->toSendMutex());
 		auto &toSend = _sessionData->toSendMap();
@@ -2693,6 +2736,7 @@ bool SessionPrivate::sendSecureRequest(
 
 	_connection->setSentEncryptedWithKeyId(_keyId);
 	_connection->sendData(std::move(packet));
+	_sessionData->stats().sent((prefix + fullSize) * sizeof(mtpPrime));
 
 	if (needAnyResponse) {
 		onSentSome((prefix + fullSize) * sizeof(mtpPrime));
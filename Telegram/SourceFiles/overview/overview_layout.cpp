@@ -26,6 +26,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "media/audio/media_audio.h"
 #include "media/player/media_player_instance.h"
 #include "storage/localstorage.h"
+#include "storage/storage_decode_queue.h"
 #include "history/history.h"
 #include "history/history_item.h"
 #include "history/history_item_components.h"
@@ -349,14 +350,13 @@ void Photo::paint(Painter &p, const QRect &clip, TextSelection selection, const
 	const auto selected = (selection == FullSelection);
 	const auto widthChanged = (_pix.width()
 		!= (_width * style::DevicePixelRatio()));
-	if (!_goodLoaded || widthChanged) {
+	if ((!_goodLoaded || widthChanged) && !_pixLoading.alive()) {
 		ensureDataMediaCreated();
 		const auto good = !_spoiler
 			&& (_dataMedia->loaded()
 				|| _dataMedia->image(Data::PhotoSize::Thumbnail));
 		if ((good && !_goodLoaded) || widthChanged) {
 			_goodLoaded = good;
-			_pix = QImage();
 			if (_goodLoaded) {
 				setPixFrom(_dataMedia->image(Data::PhotoSize::Large)
 					? _dataMedia->image(Data::PhotoSize::Large)
@@ -374,7 +374,8 @@ void Photo::paint(Painter &p, const QRect &clip, TextSelection selection, const
 	if (_pix.isNull()) {
 		p.fillRect(0, 0, _width, _height, st::overviewPhotoBg);
 	} else {
-		p.drawImage(0, 0, _pix);
+		// Until the frame for a new width is ready the old one is scaled.
+		p.drawImage(QRect(0, 0, _width, _height), _pix);
 	}
 
 	if (_spoiler) {
@@ -420,11 +421,28 @@ void Photo::paint(Painter &p, const QRect &clip, TextSelection selection, const
 void Photo::setPixFrom(not_null<Image*> image) {
 	Expects(_width > 0 && _height > 0);
 
-	auto img = image->original();
-	if (!_goodLoaded) {
-		img = Images::Blur(std::move(img));
-	}
-	_pix = CropMediaFrame(std::move(img), _width, _height);
+	// Large grids of shared media crop their frames off the main thread,
+	// the item keeps showing the previous frame until this one is ready.
+	const auto blur = !_goodLoaded;
+	const auto width = _width;
+	const auto height = _height;
+	Storage::DecodeAsync(Storage::DecodePriority::Visible, [
+		=,
+		image = image->original(),
+		guard = _pixLoading.make_guard()
+	]() mutable {
+		if (!guard.alive()) {
+			return;
+		}
+		auto pix = CropMediaFrame(
+			blur ? Images::Blur(std::move(image)) : std::move(image),
+			width,
+			height);
+		crl::on_main(std::move(guard), [=, pix = std::move(pix)]() mutable {
+			_pix = std::move(pix);
+			delegate()->repaintItem(this);
+		});
+	});
 
 	// In case we have inline thumbnail we can unload all images and we still
 	// won't get a blank image in the media viewer when the photo is opened.
@@ -451,6 +469,7 @@ void Photo::clearSpoiler() {
 		_spoiler = nullptr;
 		_sensitiveSpoiler = false;
 		_pix = QImage();
+		_pixLoading = base::binary_guard();
 		delegate()->repaintItem(this);
 	}
 }
@@ -13,6 +13,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/click_handler_types.h"
 #include "ui/effects/animations.h"
 #include "ui/effects/radial_animation.h"
+#include "base/binary_guard.h"
 
 class Image;
 
@@ -228,6 +229,7 @@ private:
 	std::unique_ptr<Ui::SpoilerAnimation> _spoiler;
 
 	QImage _pix;
+	base::binary_guard _pixLoading;
 	QImage _hiddenBgCache;
 	bool _goodLoaded : 1 = false;
 	bool _sensitiveSpoiler : 1 = false;
@@ -13,6 +13,11 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/random.h"
 
 #include <fcntl.h>
+#include <unistd.h>
+#ifdef Q_OS_LINUX
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif // Q_OS_LINUX
 #include <xdpopenuri/xdpopenuri.hpp>
 #include <xdprequest/xdprequest.hpp>
 
@@ -122,5 +127,31 @@ bool UnsafeShowOpenWith(const QString &filepath) {
 	return true;
 }
 
+bool CloneFile(const QString &from, const QString &to) {
+#ifdef Q_OS_LINUX
+	const auto source = open(QFile::encodeName(from).constData(), O_RDONLY);
+	if (source < 0) {
+		return false;
+	}
+	const auto destination = open(
+		QFile::encodeName(to).constData(),
+		O_WRONLY | O_CREAT | O_EXCL,
+		0644);
+	if (destination < 0) {
+		close(source);
+		return false;
+	}
+	const auto result = (ioctl(destination, FICLONE, source) == 0);
+	close(destination);
+	close(source);
+	if (!result) {
+		QFile::remove(to);
+	}
+	return result;
+#else // Q_OS_LINUX
+	return false;
+#endif // Q_OS_LINUX
+}
+
 } // namespace File
 } // namespace Platform
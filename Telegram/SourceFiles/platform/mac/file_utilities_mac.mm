@@ -13,6 +13,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include <Cocoa/Cocoa.h>
 #include <CoreFoundation/CFURL.h>
+#include <sys/clonefile.h>
 
 namespace {
 
@@ -565,5 +566,12 @@ void UnsafeLaunch(const QString &filepath) {
 	}
 }
 
+bool CloneFile(const QString &from, const QString &to) {
+	return !clonefile(
+		QFile::encodeName(from).constData(),
+		QFile::encodeName(to).constData(),
+		0);
+}
+
 } // namespace File
 } // namespace Platform
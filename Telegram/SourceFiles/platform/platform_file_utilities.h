@@ -23,6 +23,9 @@ void UnsafeLaunch(const QString &filepath);
 
 void PostprocessDownloaded(const QString &filepath);
 
+// Copy-on-write copy, false if the file system doesn't support it.
+[[nodiscard]] bool CloneFile(const QString &from, const QString &to);
+
 } // namespace File
 
 namespace FileDialog {
@@ -321,6 +321,10 @@ void PostprocessDownloaded(const QString &filepath) {
 	}
 }
 
+bool CloneFile(const QString &from, const QString &to) {
+	return false;
+}
+
 } // namespace File
 
 namespace FileDialog {
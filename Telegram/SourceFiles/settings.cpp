@@ -26,6 +26,7 @@ QString gDialogLastPath, gDialogHelperPath; // optimize QFileDialog
 
 bool gStartMinimized = false;
 bool gStartInTray = false;
+bool gHeadless = false;
 bool gAutoStart = false;
 bool gSendToMenu = false;
 bool gAutoUpdate = true;
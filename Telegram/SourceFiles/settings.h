@@ -38,6 +38,7 @@ DeclareSetting(QByteArray, AlphaPrivateKey);
 DeclareSetting(bool, AutoStart);
 DeclareSetting(bool, StartMinimized);
 DeclareSetting(bool, StartInTray);
+DeclareSetting(bool, Headless);
 DeclareSetting(bool, SendToMenu);
 enum LaunchMode {
 	LaunchModeNormal = 0,
@@ -33,6 +33,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "window/window_controller.h"
 #include "window/notifications_manager.h"
 #include "storage/localimageloader.h"
+#include "storage/storage_video_transcode.h"
 #include "data/data_document_resolver.h"
 #include "info/info_flexible_scroll.h"
 #include "styles/style_settings.h"
@@ -152,6 +153,7 @@ void SetupExperimental(
 	addToggle(Ui::kOptionUseSmallMsgBubbleRadius);
 	addToggle(Media::Player::kOptionDisableAutoplayNext);
 	addToggle(kOptionSendLargePhotos);
+	addToggle(Storage::kOptionTranscodeLargeVideos);
 	addToggle(Webview::kOptionWebviewDebugEnabled);
 	addToggle(Webview::kOptionWebviewLegacyEdge);
 	addToggle(kOptionAutoScrollInactiveChat);
@@ -14,6 +14,8 @@ constexpr auto kRulerLineAlpha = 0.06;
 struct Limits final {
 	float64 min = 0;
 	float64 max = 0;
+
+	friend inline bool operator==(Limits, Limits) = default;
 };
 
 enum class ChartViewType {
@@ -39,6 +39,47 @@ void BarChartView::paint(QPainter &p, const PaintContext &c) {
 void BarChartView::paintChartAndSelected(
 		QPainter &p,
 		const PaintContext &c) {
+	const auto hasSelectedXIndex = _isStack
+		&& !c.footer
+		&& (_lastSelectedXIndex >= 0);
+	auto token = CacheToken{
+		.xIndices = _lastPaintedXIndices,
+		.xPercentageLimits = c.xPercentageLimits,
+		.heightLimits = c.heightLimits,
+		.rect = c.rect,
+		.selectedXIndex = hasSelectedXIndex ? _lastSelectedXIndex : -1,
+		.selectedXProgress = hasSelectedXIndex ? _lastSelectedXProgress : 0.,
+	};
+	token.alphas.reserve(c.chartData.lines.size());
+	token.colors.reserve(c.chartData.lines.size());
+	for (const auto &line : c.chartData.lines) {
+		token.alphas.push_back(linesFilterController()->alpha(line.id));
+		token.colors.push_back(line.color);
+	}
+
+	// The columns are painted only when something has changed, otherwise
+	// the ruler and selection animations reuse the last painted image.
+	auto &cache = c.footer ? _footerCache : _mainCache;
+	if (cache.image.isNull() || cache.lastToken != token) {
+		const auto ratio = style::DevicePixelRatio();
+		const auto size = QSize(c.rect.width() * 2, rect::bottom(c.rect));
+		if (cache.image.size() != size * ratio) {
+			cache.image = QImage(
+				size * ratio,
+				QImage::Format_ARGB32_Premultiplied);
+			cache.image.setDevicePixelRatio(ratio);
+		}
+		cache.image.fill(Qt::transparent);
+		{
+			auto q = QPainter(&cache.image);
+			paintChart(q, c);
+		}
+		cache.lastToken = std::move(token);
+	}
+	p.drawImage(0, 0, cache.image);
+}
+
+void BarChartView::paintChart(QPainter &p, const PaintContext &c) {
 	const auto &[localStart, localEnd] = _lastPaintedXIndices;
 	const auto &[leftStart, w] = ComputeLeftStartAndStep(
 		c.chartData,
@@ -46,6 +46,27 @@ public:
 
 private:
 	void paintChartAndSelected(QPainter &p, const PaintContext &c);
+	void paintChart(QPainter &p, const PaintContext &c);
+
+	struct CacheToken final {
+		Limits xIndices;
+		Limits xPercentageLimits;
+		Limits heightLimits;
+		QRect rect;
+		int selectedXIndex = -1;
+		float64 selectedXProgress = 0.;
+		std::vector<float64> alphas;
+		std::vector<QColor> colors;
+
+		friend inline bool operator==(
+			const CacheToken &,
+			const CacheToken &) = default;
+	};
+
+	struct Cache final {
+		QImage image;
+		CacheToken lastToken;
+	};
 
 	struct {
 		Limits full;
@@ -61,6 +82,9 @@ private:
 
 	CachedSelectedPoints _selectedPoints; // Non-stack.
 
+	Cache _mainCache;
+	Cache _footerCache;
+
 };
 
 } // namespace Statistic
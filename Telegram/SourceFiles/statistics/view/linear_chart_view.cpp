@@ -18,6 +18,20 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 namespace Statistic {
 namespace {
 
+// Reduce the line when there are more points than that per column.
+constexpr auto kReduceThreshold = 2;
+
+struct Bucket {
+	int column = 0;
+	int count = 0;
+	QPointF first;
+	QPointF low;
+	QPointF high;
+	QPointF last;
+	int lowIndex = 0;
+	int highIndex = 0;
+};
+
 void PaintChartLine(
 		QPainter &p,
 		int lineIndex,
@@ -35,6 +49,27 @@ void PaintChartLine(
 
 	const auto ratio = ratios.ratio(line.id);
 
+	// With many points per pixel column only the first, the lowest,
+	// the highest and the last points of the column are drawn.
+	const auto columnWidth = 1. / style::DevicePixelRatio();
+	const auto reduce = (localEnd - localStart)
+		> (c.rect.width() * style::DevicePixelRatio() * kReduceThreshold);
+	auto bucket = Bucket();
+	const auto flush = [&] {
+		if (!bucket.count) {
+			return;
+		}
+		chartPoints << bucket.first;
+		if (bucket.count > 1) {
+			const auto lowFirst = (bucket.lowIndex < bucket.highIndex);
+			chartPoints
+				<< (lowFirst ? bucket.low : bucket.high)
+				<< (lowFirst ? bucket.high : bucket.low)
+				<< bucket.last;
+		}
+		bucket = Bucket();
+	};
+
 	for (auto i = localStart; i <= localEnd; i++) {
 		if (line.y[i] < 0) {
 			continue;
@@ -45,8 +80,29 @@ void PaintChartLine(
 		const auto yPercentage = (line.y[i] * ratio - c.heightLimits.min)
 			/ float64(c.heightLimits.max - c.heightLimits.min);
 		const auto yPoint = (1. - yPercentage) * c.rect.height();
-		chartPoints << QPointF(xPoint, yPoint);
+		const auto point = QPointF(xPoint, yPoint);
+		if (!reduce) {
+			chartPoints << point;
+			continue;
+		}
+		const auto column = int(std::floor(xPoint / columnWidth));
+		if (bucket.count && bucket.column != column) {
+			flush();
+		}
+		if (!bucket.count++) {
+			bucket.column = column;
+			bucket.first = bucket.low = bucket.high = point;
+			bucket.lowIndex = bucket.highIndex = i;
+		} else if (yPoint > bucket.low.y()) {
+			bucket.low = point;
+			bucket.lowIndex = i;
+		} else if (yPoint < bucket.high.y()) {
+			bucket.high = point;
+			bucket.highIndex = i;
+		}
+		bucket.last = point;
 	}
+	flush();
 	p.setPen(QPen(
 		line.color,
 		c.footer ? st::lineWidth : st::statisticsChartLineWidth));
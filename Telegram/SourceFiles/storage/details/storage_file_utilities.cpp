@@ -7,6 +7,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "storage/details/storage_file_utilities.h"
 
+#include "core/core_tracing.h"
 #include "mtproto/mtproto_auth_key.h"
 #include "base/platform/base_platform_file_utilities.h"
 #include "base/openssl_help.h"
@@ -28,10 +29,27 @@ constexpr auto kStrongIterationsCount = 100'000;
 struct WriteEntry {
 	QString basePath;
 	QString base;
-	QByteArray data;
-	QByteArray md5;
+	std::vector<FileWritePart> parts;
 };
 
+[[nodiscard]] QByteArray EncryptData(
+		QByteArray &toEncrypt,
+		const MTP::AuthKeyPtr &key) {
+	// prepare for encryption
+	uint32 size = toEncrypt.size(), fullSize = size;
+	if (fullSize & 0x0F) {
+		fullSize += 0x10 - (fullSize & 0x0F);
+		toEncrypt.resize(fullSize);
+		base::RandomFill(toEncrypt.data() + size, fullSize - size);
+	}
+	*(uint32*)toEncrypt.data() = size;
+	QByteArray encrypted(0x10 + fullSize, Qt::Uninitialized); // 128bit of sha1 - key128, sizeof(data), data
+	hashSha1(toEncrypt.constData(), toEncrypt.size(), encrypted.data());
+	MTP::aesEncryptLocal(toEncrypt.constData(), encrypted.data() + 0x10, fullSize, key, encrypted.constData());
+
+	return encrypted;
+}
+
 class WriteManager final {
 public:
 	explicit WriteManager(crl::weak_on_thread<WriteManager> weak);
@@ -45,6 +63,10 @@ private:
 	void writeScheduled();
 	bool writeOneScheduledNow();
 	void writeNow(WriteEntry &&entry);
+	void prepare(
+		WriteEntry &entry,
+		QByteArray &data,
+		QByteArray &md5) const;
 
 	template <typename File>
 	[[nodiscard]] bool open(File &file, const WriteEntry &entry, char postfix);
@@ -94,7 +116,46 @@ void WriteManager::writeSync(WriteEntry &&entry) {
 	writeNow(std::move(entry));
 }
 
+void WriteManager::prepare(
+		WriteEntry &entry,
+		QByteArray &data,
+		QByteArray &md5) const {
+	auto hash = HashMd5();
+	auto fullSize = 0;
+	{
+		QBuffer buffer(&data);
+		buffer.open(QIODevice::WriteOnly);
+		QDataStream stream(&buffer);
+		for (auto &part : entry.parts) {
+			const auto bytes = part.key
+				? EncryptData(part.data, part.key)
+				: part.data;
+			stream << bytes;
+			quint32 len = bytes.isNull() ? 0xffffffff : bytes.size();
+			if (QSysInfo::ByteOrder != QSysInfo::BigEndian) {
+				len = qbswap(len);
+			}
+			hash.feed(&len, sizeof(len));
+			hash.feed(bytes.constData(), bytes.size());
+			fullSize += sizeof(len) + bytes.size();
+		}
+	}
+	hash.feed(&fullSize, sizeof(fullSize));
+	qint32 version = AppVersion;
+	hash.feed(&version, sizeof(version));
+	hash.feed(TdfMagic, TdfMagicLen);
+	md5 = QByteArray((const char*)hash.result(), 0x10);
+}
+
 void WriteManager::writeNow(WriteEntry &&entry) {
+	const auto trace = Core::Tracing::Scope(
+		"storage",
+		"WriteManager::writeNow",
+		entry.base);
+	auto data = QByteArray();
+	auto md5 = QByteArray();
+	prepare(entry, data, md5);
+
 	const auto path = [&](char postfix) {
 		return this->path(entry, postfix);
 	};
@@ -102,8 +163,8 @@ void WriteManager::writeNow(WriteEntry &&entry) {
 		return this->open(file, entry, postfix);
 	};
 	const auto write = [&](auto &file) {
-		file.write(entry.data);
-		file.write(entry.md5);
+		file.write(data);
+		file.write(md5);
 	};
 	const auto safe = path('s');
 	const auto simple = path('0');
@@ -398,50 +459,39 @@ FileWriteDescriptor::~FileWriteDescriptor() {
 
 void FileWriteDescriptor::init(const QString &name) {
 	_base = _basePath + name;
-	_buffer.setBuffer(&_safeData);
-	const auto opened = _buffer.open(QIODevice::WriteOnly);
-	Assert(opened);
-	_stream.setDevice(&_buffer);
 }
 
 void FileWriteDescriptor::writeData(const QByteArray &data) {
-	if (!_stream.device()) {
+	if (_finished) {
 		return;
 	}
-	_stream << data;
-	quint32 len = data.isNull() ? 0xffffffff : data.size();
-	if (QSysInfo::ByteOrder != QSysInfo::BigEndian) {
-		len = qbswap(len);
-	}
-	_md5.feed(&len, sizeof(len));
-	_md5.feed(data.constData(), data.size());
-	_fullSize += sizeof(len) + data.size();
+	_parts.push_back({ .data = data });
 }
 
 void FileWriteDescriptor::writeEncrypted(
-	EncryptedDescriptor &data,
-	const MTP::AuthKeyPtr &key) {
-	writeData(PrepareEncrypted(data, key));
+		EncryptedDescriptor &data,
+		const MTP::AuthKeyPtr &key) {
+	Expects(key != nullptr);
+
+	if (_finished) {
+		return;
+	}
+	data.finish();
+	_parts.push_back({ .data = base::take(data.data), .key = key });
 }
 
 void FileWriteDescriptor::finish() {
-	if (!_stream.device()) {
+	if (_finished) {
 		return;
 	}
+	_finished = true;
 
-	_stream.setDevice(nullptr);
-	_md5.feed(&_fullSize, sizeof(_fullSize));
-	qint32 version = AppVersion;
-	_md5.feed(&version, sizeof(version));
-	_md5.feed(TdfMagic, TdfMagicLen);
-
-	_buffer.close();
-
+	// Encryption and the digest are done on the writing thread, so
+	// a write replaced by a newer one of the same file is never done.
 	auto entry = WriteEntry{
 		.basePath = _basePath,
 		.base = _base,
-		.data = _safeData,
-		.md5 = QByteArray((const char*)_md5.result(), 0x10)
+		.parts = base::take(_parts),
 	};
 	if (_sync) {
 		Manager.writeSync(std::move(entry));
@@ -454,21 +504,7 @@ void FileWriteDescriptor::finish() {
 		EncryptedDescriptor &data,
 		const MTP::AuthKeyPtr &key) {
 	data.finish();
-	QByteArray &toEncrypt(data.data);
-
-	// prepare for encryption
-	uint32 size = toEncrypt.size(), fullSize = size;
-	if (fullSize & 0x0F) {
-		fullSize += 0x10 - (fullSize & 0x0F);
-		toEncrypt.resize(fullSize);
-		base::RandomFill(toEncrypt.data() + size, fullSize - size);
-	}
-	*(uint32*)toEncrypt.data() = size;
-	QByteArray encrypted(0x10 + fullSize, Qt::Uninitialized); // 128bit of sha1 - key128, sizeof(data), data
-	hashSha1(toEncrypt.constData(), toEncrypt.size(), encrypted.data());
-	MTP::aesEncryptLocal(toEncrypt.constData(), encrypted.data() + 0x10, fullSize, key, encrypted.constData());
-
-	return encrypted;
+	return EncryptData(data.data, key);
 }
 
 bool ReadFile(
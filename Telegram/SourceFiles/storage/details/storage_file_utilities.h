@@ -52,6 +52,11 @@ struct EncryptedDescriptor final {
 	EncryptedDescriptor &data,
 	const MTP::AuthKeyPtr &key);
 
+struct FileWritePart {
+	QByteArray data;
+	MTP::AuthKeyPtr key; // If set, the data is encrypted with it.
+};
+
 class FileWriteDescriptor final {
 public:
 	FileWriteDescriptor(
@@ -74,13 +79,10 @@ private:
 	void finish();
 
 	const QString _basePath;
-	QBuffer _buffer;
-	QDataStream _stream;
-	QByteArray _safeData;
+	std::vector<FileWritePart> _parts;
 	QString _base;
-	HashMd5 _md5;
-	int _fullSize = 0;
 	bool _sync = false;
+	bool _finished = false;
 
 };
 
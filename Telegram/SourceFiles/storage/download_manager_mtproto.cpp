@@ -22,8 +22,12 @@ namespace {
 constexpr auto kKillSessionTimeout = 15 * crl::time(1000);
 constexpr auto kStartWaitedInSession = 4 * kDownloadPartSize;
 constexpr auto kMaxWaitedInSession = 16 * kDownloadPartSize;
+constexpr auto kMaxWaitedInSessionLarge = 4 * kMaxDownloadPartSize;
+constexpr auto kPartsInFlightPerSession = 4;
 constexpr auto kStartSessionsCount = 1;
 constexpr auto kMaxSessionsCount = 8;
+constexpr auto kMaxAdaptiveSessionsCount = MTP::kMaxMediaDcCount;
+constexpr auto kBandwidthWindow = 2 * crl::time(1000);
 constexpr auto kMaxTrackedSessionRemoves = 64;
 constexpr auto kRetryAddSessionTimeout = 8 * crl::time(1000);
 constexpr auto kRetryAddSessionSuccesses = 3;
@@ -38,6 +42,17 @@ constexpr auto kBadRequestDurationThreshold = 8 * crl::time(1000);
 // and for successes in all remaining sessions:
 // kRetryAddSessionSuccesses * max(removesCount, kMaxTrackedSessionRemoves)
 
+// When the bandwidth-delay product measured over kBandwidthWindow comes
+// close to what all the sessions may have in flight the link is not the
+// limit, so sessions are added right away, one per window, up to
+// kMaxAdaptiveSessionsCount instead of kMaxSessionsCount.
+//
+// The same product divided between the sessions gives the part size:
+// the largest one, up to kMaxDownloadPartSize, that still allows
+// kPartsInFlightPerSession parts in each session. With parts larger than
+// kDownloadPartSize a session may have up to kMaxWaitedInSessionLarge
+// in flight instead of kMaxWaitedInSession.
+
 } // namespace
 
 void DownloadManagerMtproto::Queue::enqueue(
@@ -82,6 +97,12 @@ bool DownloadManagerMtproto::Queue::empty() const {
 	return _tasks.empty();
 }
 
+int DownloadManagerMtproto::Queue::highestPriority() const {
+	Expects(!_tasks.empty());
+
+	return _tasks.front().priority;
+}
+
 auto DownloadManagerMtproto::Queue::nextTask(bool onlyHighestPriority) const
 -> Task* {
 	if (_tasks.empty()) {
@@ -152,6 +173,15 @@ void DownloadManagerMtproto::remove(not_null<Task*> task) {
 	checkSendNext(dcId, queue);
 }
 
+bool DownloadManagerMtproto::hasTasksAbove(int priority) const {
+	for (const auto &[dcId, queue] : _queues) {
+		if (!queue.empty() && queue.highestPriority() > priority) {
+			return true;
+		}
+	}
+	return false;
+}
+
 void DownloadManagerMtproto::resetGeneration() {
 	_resetGenerationTimer.cancel();
 	for (auto &[dcId, queue] : _queues) {
@@ -184,7 +214,7 @@ bool DownloadManagerMtproto::trySendNextPart(MTP::DcId dcId, Queue &queue) {
 		const auto proj = [](const DcSessionBalanceData &data) {
 			return (data.requested < data.maxWaitedAmount)
 				? data.requested
-				: kMaxWaitedInSession;
+				: kMaxWaitedInSessionLarge;
 		};
 		const auto j = ranges::min_element(sessions, ranges::less(), proj);
 		return (j->requested + kDownloadPartSize <= j->maxWaitedAmount)
@@ -194,9 +224,15 @@ bool DownloadManagerMtproto::trySendNextPart(MTP::DcId dcId, Queue &queue) {
 	if (bestIndex < 0) {
 		return false;
 	}
+	const auto &session = sessions[bestIndex];
+	auto limit = balanceData.partSize;
+	while (limit > kDownloadPartSize
+		&& session.requested + limit > session.maxWaitedAmount) {
+		limit /= 2;
+	}
 	const auto onlyHighestPriority = (balanceData.totalRequested > 0);
 	if (const auto task = queue.nextTask(onlyHighestPriority)) {
-		task->loadPart(bestIndex);
+		task->loadPart(bestIndex, limit);
 		return true;
 	}
 	return false;
@@ -230,6 +266,7 @@ void DownloadManagerMtproto::requestSucceeded(
 		MTP::DcId dcId,
 		int index,
 		int amountAtRequestStart,
+		int limit,
 		crl::time timeAtRequestStart) {
 	using namespace rpl::mappers;
 
@@ -242,6 +279,7 @@ void DownloadManagerMtproto::requestSucceeded(
 		|| (amountAtRequestStart > data.maxWaitedAmount);
 	const auto parts = amountAtRequestStart / kDownloadPartSize;
 	const auto duration = (crl::now() - timeAtRequestStart);
+	trackBandwidth(dc, duration, limit);
 	DEBUG_LOG(("Download (%1,%2) request done, duration: %3, parts: %4%5"
 		).arg(dcId
 		).arg(index
@@ -259,32 +297,40 @@ void DownloadManagerMtproto::requestSucceeded(
 		});
 		return;
 	}
-	if (amountAtRequestStart == data.maxWaitedAmount
-		&& data.maxWaitedAmount < kMaxWaitedInSession) {
+	const auto maxWaited = maxWaitedInSession(dc);
+	if (amountAtRequestStart + kDownloadPartSize > data.maxWaitedAmount
+		&& data.maxWaitedAmount < maxWaited) {
 		data.maxWaitedAmount = std::min(
-			data.maxWaitedAmount + kDownloadPartSize,
-			kMaxWaitedInSession);
+			data.maxWaitedAmount + limit,
+			maxWaited);
 		DEBUG_LOG(("Download (%1,%2) increased max waited amount %3."
 			).arg(dcId
 			).arg(index
 			).arg(data.maxWaitedAmount));
 	}
 	data.successes = std::min(data.successes + 1, kMaxTrackedSuccesses);
-	const auto notEnough = ranges::any_of(
-		dc.sessions,
-		_1 < (dc.sessionRemoveTimes + 1) * kRetryAddSessionSuccesses,
-		&DcSessionBalanceData::successes);
-	if (notEnough) {
-		return;
-	}
-	for (auto &session : dc.sessions) {
-		session.successes = 0;
-	}
-	if (dc.timeouts > 0) {
-		--dc.timeouts;
-		return;
-	} else if (dc.sessions.size() == kMaxSessionsCount) {
-		return;
+	const auto underfilled = !dc.timeouts && pipeUnderfilled(dc);
+	if (underfilled) {
+		if (dc.sessions.size() >= kMaxAdaptiveSessionsCount) {
+			return;
+		}
+	} else {
+		const auto notEnough = ranges::any_of(
+			dc.sessions,
+			_1 < (dc.sessionRemoveTimes + 1) * kRetryAddSessionSuccesses,
+			&DcSessionBalanceData::successes);
+		if (notEnough) {
+			return;
+		}
+		for (auto &session : dc.sessions) {
+			session.successes = 0;
+		}
+		if (dc.timeouts > 0) {
+			--dc.timeouts;
+			return;
+		} else if (dc.sessions.size() >= kMaxSessionsCount) {
+			return;
+		}
 	}
 	const auto now = crl::now();
 	const auto delay = (dc.sessionRemoveTimes + 1) * kRetryAddSessionTimeout;
@@ -292,10 +338,82 @@ void DownloadManagerMtproto::requestSucceeded(
 		return;
 	}
 	dc.sessions.emplace_back();
-	DEBUG_LOG(("Download (%1,%2) adding, now sessions: %3"
+	resetBandwidth(dc);
+	DEBUG_LOG(("Download (%1,%2) adding, now sessions: %3%4"
 		).arg(dcId
 		).arg(dc.sessions.size() - 1
-		).arg(dc.sessions.size()));
+		).arg(dc.sessions.size()
+		).arg(underfilled ? " (bandwidth-delay)" : ""));
+}
+
+void DownloadManagerMtproto::trackBandwidth(
+		DcBalanceData &dc,
+		crl::time duration,
+		int bytes) {
+	const auto now = crl::now();
+	if (!dc.windowStart || now - dc.windowStart > 2 * kBandwidthWindow) {
+		// Nothing was downloaded for a while, start a fresh window.
+		dc.windowStart = now - duration;
+		dc.windowBytes = 0;
+		dc.windowMinDuration = 0;
+	}
+	dc.windowBytes += bytes;
+	dc.windowMinDuration = dc.windowMinDuration
+		? std::min(dc.windowMinDuration, duration)
+		: duration;
+	const auto elapsed = now - dc.windowStart;
+	if (elapsed < kBandwidthWindow) {
+		return;
+	}
+	dc.bandwidth = dc.windowBytes * 1000 / elapsed;
+	dc.roundTrip = dc.windowMinDuration;
+	dc.windowStart = now;
+	dc.windowBytes = 0;
+	dc.windowMinDuration = 0;
+	dc.partSize = choosePartSize(dc);
+}
+
+void DownloadManagerMtproto::resetBandwidth(DcBalanceData &dc) {
+	dc.bandwidth = dc.roundTrip = 0;
+	dc.windowStart = crl::now();
+	dc.windowBytes = dc.windowMinDuration = 0;
+}
+
+bool DownloadManagerMtproto::pipeUnderfilled(const DcBalanceData &dc) {
+	if (!dc.bandwidth || !dc.roundTrip) {
+		return false;
+	}
+	const auto maxWaited = maxWaitedInSession(dc);
+	auto capacity = int64();
+	for (const auto &session : dc.sessions) {
+		if (session.maxWaitedAmount < maxWaited) {
+			// Let the sessions grow their own windows first.
+			return false;
+		}
+		capacity += session.maxWaitedAmount;
+	}
+	const auto product = dc.bandwidth * dc.roundTrip / 1000;
+	return (product * 5 >= capacity * 4);
+}
+
+int DownloadManagerMtproto::choosePartSize(const DcBalanceData &dc) {
+	if (!dc.bandwidth || !dc.roundTrip) {
+		return dc.partSize;
+	}
+	const auto product = dc.bandwidth * dc.roundTrip / 1000;
+	const auto share = product / int64(dc.sessions.size());
+	auto result = kDownloadPartSize;
+	while (result < kMaxDownloadPartSize
+		&& int64(result) * 2 * kPartsInFlightPerSession <= share) {
+		result *= 2;
+	}
+	return result;
+}
+
+int DownloadManagerMtproto::maxWaitedInSession(const DcBalanceData &dc) {
+	return (dc.partSize > kDownloadPartSize)
+		? kMaxWaitedInSessionLarge
+		: kMaxWaitedInSession;
 }
 
 int DownloadManagerMtproto::chooseSessionIndex(MTP::DcId dcId) const {
@@ -358,6 +476,7 @@ void DownloadManagerMtproto::removeSession(MTP::DcId dcId) {
 	api().instance().killSession(MTP::downloadDcId(dcId, index));
 
 	dc.lastSessionRemove = crl::now();
+	resetBandwidth(dc);
 }
 
 void DownloadManagerMtproto::killSessionsSchedule(MTP::DcId dcId) {
@@ -475,20 +594,35 @@ void DownloadMtprotoTask::refreshFileReferenceFrom(
 	}
 }
 
-void DownloadMtprotoTask::loadPart(int sessionIndex) {
-	makeRequest({ takeNextRequestOffset(), sessionIndex });
+int DownloadMtprotoTask::nextRequestLimit(int maxLimit) const {
+	return kDownloadPartSize;
+}
+
+void DownloadMtprotoTask::loadPart(int sessionIndex, int maxLimit) {
+	const auto limit = _cdnDcId
+		? kDownloadPartSize
+		: nextRequestLimit(maxLimit);
+	Assert(limit >= kDownloadPartSize && limit <= maxLimit);
+	Assert(!(limit % kDownloadPartSize));
+
+	makeRequest({ takeNextRequestOffset(limit), sessionIndex, limit });
 }
 
 void DownloadMtprotoTask::removeSession(int sessionIndex) {
 	struct Redirect {
 		mtpRequestId requestId = 0;
 		int64 offset = 0;
+		int limit = 0;
 	};
 	auto redirect = std::vector<Redirect>();
 	for (const auto &[requestId, requestData] : _sentRequests) {
 		if (requestData.sessionIndex == sessionIndex) {
 			redirect.reserve(_sentRequests.size());
-			redirect.push_back({ requestId, requestData.offset });
+			redirect.push_back({
+				requestId,
+				requestData.offset,
+				requestData.limit,
+			});
 		}
 	}
 	for (auto &[requestData, bytes] : _cdnUncheckedParts) {
@@ -498,13 +632,13 @@ void DownloadMtprotoTask::removeSession(int sessionIndex) {
 			requestData.sessionIndex = newIndex;
 		}
 	}
-	for (const auto &[requestId, offset] : redirect) {
+	for (const auto &[requestId, offset, limit] : redirect) {
 		const auto needMakeRequest = (requestId != _cdnHashesRequestId);
 		cancelRequest(requestId);
 		if (needMakeRequest) {
 			const auto newIndex = _owner->chooseSessionIndex(dcId());
 			Assert(newIndex < sessionIndex);
-			makeRequest({ offset, newIndex });
+			makeRequest({ offset, newIndex, limit });
 		}
 	}
 }
@@ -512,7 +646,7 @@ void DownloadMtprotoTask::removeSession(int sessionIndex) {
 mtpRequestId DownloadMtprotoTask::sendRequest(
 		const RequestData &requestData) {
 	const auto offset = requestData.offset;
-	const auto limit = Storage::kDownloadPartSize;
+	const auto limit = requestData.limit;
 	const auto shiftedDcId = MTP::downloadDcId(
 		_cdnDcId ? _cdnDcId : dcId(),
 		requestData.sessionIndex);
@@ -595,6 +729,16 @@ bool DownloadMtprotoTask::setWebFileSizeHook(int64 size) {
 }
 
 void DownloadMtprotoTask::makeRequest(const RequestData &requestData) {
+	if (_cdnDcId && requestData.limit > kDownloadPartSize) {
+		// CDN file hashes are checked by kDownloadPartSize parts.
+		auto part = requestData;
+		part.limit = kDownloadPartSize;
+		for (auto i = 0; i != requestData.limit / kDownloadPartSize; ++i) {
+			part.offset = requestData.offset + i * int64(kDownloadPartSize);
+			placeSentRequest(sendRequest(part), part);
+		}
+		return;
+	}
 	placeSentRequest(sendRequest(requestData), requestData);
 }
 
@@ -807,7 +951,7 @@ void DownloadMtprotoTask::placeSentRequest(
 	const auto amount = _owner->changeRequestedAmount(
 		dcId(),
 		requestData.sessionIndex,
-		Storage::kDownloadPartSize);
+		requestData.limit);
 	const auto &[i, ok1] = _sentRequests.emplace(requestId, requestData);
 	const auto &[j, ok2] = _requestByOffset.emplace(
 		requestData.offset,
@@ -851,7 +995,7 @@ auto DownloadMtprotoTask::finishSentRequest(
 	_owner->changeRequestedAmount(
 		dcId(),
 		result.sessionIndex,
-		-Storage::kDownloadPartSize);
+		-result.limit);
 	_sentRequests.erase(it);
 	const auto ok = _requestByOffset.remove(result.offset);
 
@@ -864,6 +1008,7 @@ auto DownloadMtprotoTask::finishSentRequest(
 			dcId(),
 			result.sessionIndex,
 			result.requestedInSession,
+			result.limit,
 			result.sent);
 	}
 
@@ -19,11 +19,12 @@ class Error;
 
 namespace Storage {
 
-// Different part sizes are not supported for now :(
-// Because we start downloading with some part size
-// and then we get a CDN-redirect where we support only
-// fixed part size download for hash checking.
+// Parts are requested in sizes from kDownloadPartSize up to
+// kMaxDownloadPartSize, always at offsets that are multiples of the size.
+// CDN file hashes are given for kDownloadPartSize parts only, so after
+// a CDN-redirect the parts are split back to that size.
 constexpr auto kDownloadPartSize = 128 * 1024;
+constexpr auto kMaxDownloadPartSize = 1024 * 1024;
 
 class DownloadMtprotoTask;
 
@@ -41,6 +42,10 @@ public:
 	void enqueue(not_null<Task*> task, int priority);
 	void remove(not_null<Task*> task);
 
+	// Whether any dc has a task waiting with a priority above the given
+	// one, background loaders use it to step aside.
+	[[nodiscard]] bool hasTasksAbove(int priority) const;
+
 	void notifyTaskFinished() {
 		_taskFinished.fire({});
 	}
@@ -53,6 +58,7 @@ public:
 		MTP::DcId dcId,
 		int index,
 		int amountAtRequestStart,
+		int limit,
 		crl::time timeAtRequestStart);
 	void checkSendNextAfterSuccess(MTP::DcId dcId);
 	[[nodiscard]] int chooseSessionIndex(MTP::DcId dcId) const;
@@ -71,6 +77,7 @@ private:
 		void remove(not_null<Task*> task);
 		void resetGeneration();
 		[[nodiscard]] bool empty() const;
+		[[nodiscard]] int highestPriority() const;
 		[[nodiscard]] Task *nextTask(bool onlyHighestPriority) const;
 		void removeSession(int index);
 
@@ -98,6 +105,14 @@ private:
 		int sessionRemoveTimes = 0;
 		int timeouts = 0; // Since all sessions had successes >= required.
 		int totalRequested = 0;
+		int partSize = kDownloadPartSize;
+
+		// Bandwidth-delay estimate, from the last full window.
+		int64 bandwidth = 0; // Bytes per second.
+		crl::time roundTrip = 0; // Shortest request in the window.
+		crl::time windowStart = 0;
+		int64 windowBytes = 0;
+		crl::time windowMinDuration = 0;
 	};
 
 	void checkSendNext();
@@ -112,6 +127,14 @@ private:
 	void resetGeneration();
 	void sessionTimedOut(MTP::DcId dcId, int index);
 	void removeSession(MTP::DcId dcId);
+	static void trackBandwidth(
+		DcBalanceData &dc,
+		crl::time duration,
+		int bytes);
+	static void resetBandwidth(DcBalanceData &dc);
+	[[nodiscard]] static bool pipeUnderfilled(const DcBalanceData &dc);
+	[[nodiscard]] static int choosePartSize(const DcBalanceData &dc);
+	[[nodiscard]] static int maxWaitedInSession(const DcBalanceData &dc);
 
 	const not_null<ApiWrap*> _api;
 
@@ -155,7 +178,7 @@ public:
 	[[nodiscard]] const Location &location() const;
 
 	[[nodiscard]] virtual bool readyToRequest() const = 0;
-	void loadPart(int sessionIndex);
+	void loadPart(int sessionIndex, int maxLimit);
 	void removeSession(int sessionIndex);
 
 	void refreshFileReferenceFrom(
@@ -180,6 +203,7 @@ private:
 	struct RequestData {
 		int64 offset = 0;
 		mutable int sessionIndex = 0;
+		int limit = kDownloadPartSize;
 		int requestedInSession = 0;
 		crl::time sent = 0;
 
@@ -205,7 +229,9 @@ private:
 	};
 
 	// Called only if readyToRequest() == true.
-	[[nodiscard]] virtual int64 takeNextRequestOffset() = 0;
+	// The limit is the one returned by nextRequestLimit() right before.
+	[[nodiscard]] virtual int nextRequestLimit(int maxLimit) const;
+	[[nodiscard]] virtual int64 takeNextRequestOffset(int limit) = 0;
 	virtual bool feedPart(int64 offset, const QByteArray &bytes) = 0;
 	virtual bool setWebFileSizeHook(int64 size);
 	virtual void cancelOnFail() = 0;
@@ -15,6 +15,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/application.h"
 #include "core/file_location.h"
 #include "storage/storage_account.h"
+#include "storage/storage_decoded_images.h"
+#include "storage/storage_decode_queue.h"
 #include "storage/file_download_mtproto.h"
 #include "storage/file_download_web.h"
 #include "platform/platform_file_utilities.h"
@@ -227,6 +229,13 @@ void FileLoader::localLoaded(
 	if (!imageData.isNull()) {
 		_imageFormat = imageFormat;
 		_imageData = imageData;
+		if (!partial && _cacheTag == Data::kImageCacheTag) {
+			_session->data().decodedImages().put(cacheKey(), {
+				.bytes = result.data,
+				.image = imageData,
+				.format = imageFormat,
+			});
+		}
 	}
 	finishWithBytes(partial
 		? QByteArray::fromRawData(
@@ -254,7 +263,9 @@ bool FileLoader::checkForOpen() {
 		|| _fileIsOpen) {
 		return true;
 	}
-	_fileIsOpen = _file.open(QIODevice::WriteOnly);
+	_fileIsOpen = _file.open(resumeFromFile()
+		? QIODevice::ReadWrite
+		: QIODevice::WriteOnly);
 	if (_fileIsOpen) {
 		return true;
 	}
@@ -264,10 +275,14 @@ bool FileLoader::checkForOpen() {
 
 void FileLoader::loadLocal(const Storage::Cache::Key &key) {
 	const auto readImage = (_locationType != AudioFileLocation);
-	auto done = [=, guard = _localLoading.make_guard()](
+	const auto priority = _autoLoading
+		? Storage::DecodePriority::Prefetch
+		: Storage::DecodePriority::Visible;
+	const auto done = [=](
+			base::binary_guard &&guard,
 			QByteArray &&value,
 			QImage &&image,
-			QByteArray &&format) mutable {
+			QByteArray &&format) {
 		crl::on_main(std::move(guard), [
 			=,
 			value = std::move(value),
@@ -280,25 +295,43 @@ void FileLoader::loadLocal(const Storage::Cache::Key &key) {
 				std::move(image));
 		});
 	};
-	_session->data().cache().get(key, [=, callback = std::move(done)](
-			QByteArray &&value) mutable {
+	if (_cacheTag == Data::kImageCacheTag) {
+		auto &decoded = _session->data().decodedImages();
+		if (auto image = decoded.get(key)) {
+			done(
+				_localLoading.make_guard(),
+				std::move(image->bytes),
+				std::move(image->image),
+				std::move(image->format));
+			return;
+		}
+	}
+	_session->data().cache().get(key, [
+		=,
+		guard = _localLoading.make_guard()
+	](QByteArray &&value) mutable {
 		if (readImage && !value.startsWith("partial:")) {
-			crl::async([
-				value = std::move(value),
-				done = std::move(callback)
+			Storage::DecodeAsync(priority, [
+				=,
+				guard = std::move(guard),
+				value = std::move(value)
 			]() mutable {
+				if (!guard.alive()) {
+					return;
+				}
 				auto read = Images::Read({ .content = value });
 				if (!read.image.isNull()) {
 					done(
+						std::move(guard),
 						std::move(value),
 						std::move(read.image),
 						std::move(read.format));
 				} else {
-					done(std::move(value), {}, {});
+					done(std::move(guard), std::move(value), {}, {});
 				}
 			});
 		} else {
-			callback(std::move(value), {}, {});
+			done(std::move(guard), std::move(value), {}, {});
 		}
 	});
 }
@@ -458,6 +491,7 @@ bool FileLoader::finalizeResult() {
 		if ((_toCache == LoadToCacheAsWell)
 			&& (_data.size() <= Storage::kMaxFileInMemory)
 			&& (key.low || key.high)) {
+			_session->data().decodedImages().remove(key);
 			_session->data().cache().put(
 				cacheKey(),
 				Storage::Cache::Database::TaggedValue(
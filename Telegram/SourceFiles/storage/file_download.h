@@ -112,6 +112,11 @@ public:
 	void start();
 	void cancel();
 
+	// Tasks of a higher priority are sent first, e.g. media that must be
+	// saved before it expires.
+	virtual void setPriority(int priority) {
+	}
+
 	[[nodiscard]] bool loadingLocal() const {
 		return (_localStatus == LocalStatus::Loading);
 	}
@@ -152,6 +157,10 @@ protected:
 	virtual void startLoadingWithPartial(const QByteArray &data) {
 		startLoading();
 	}
+	// Whether to keep the contents of the file when opening it.
+	virtual bool resumeFromFile() {
+		return false;
+	}
 
 	void cancel(FailureReason failed);
 
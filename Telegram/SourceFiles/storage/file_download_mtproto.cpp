@@ -15,6 +15,14 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mtproto/mtp_instance.h"
 #include "mtproto/mtproto_config.h"
 #include "mtproto/mtproto_auth_key.h"
+#include "storage/storage_account.h"
+
+namespace {
+
+constexpr auto kMinResumableSize = 16 * 1024 * 1024;
+constexpr auto kSavePartialEach = 16 * 1024 * 1024;
+
+} // namespace
 
 mtpFileLoader::mtpFileLoader(
 	not_null<Main::Session*> session,
@@ -115,6 +123,7 @@ mtpFileLoader::mtpFileLoader(
 
 mtpFileLoader::~mtpFileLoader() {
 	if (!_finished) {
+		keepPartialDownload();
 		cancel();
 	}
 }
@@ -134,11 +143,29 @@ bool mtpFileLoader::readyToRequest() const {
 		&& (!_fullSize || _nextRequestOffset < _loadSize);
 }
 
-int64 mtpFileLoader::takeNextRequestOffset() {
+int mtpFileLoader::nextRequestLimit(int maxLimit) const {
+	if (!_fullSize || !v::is<StorageFileLocation>(location().data)) {
+		return Storage::kDownloadPartSize;
+	}
+	// A part may not cross a boundary of its own size and it is of no use
+	// to request much more than what is left.
+	const auto left = _loadSize - _nextRequestOffset;
+	auto result = maxLimit;
+	while (result > Storage::kDownloadPartSize
+		&& ((_nextRequestOffset % result)
+			|| (left <= result / 2)
+			|| hasLoadedParts(_nextRequestOffset, result))) {
+		result /= 2;
+	}
+	return result;
+}
+
+int64 mtpFileLoader::takeNextRequestOffset(int limit) {
 	Expects(readyToRequest());
 
 	const auto result = _nextRequestOffset;
-	_nextRequestOffset += Storage::kDownloadPartSize;
+	_nextRequestOffset += limit;
+	skipLoadedParts();
 	return result;
 }
 
@@ -153,11 +180,14 @@ bool mtpFileLoader::feedPart(int64 offset, const QByteArray &bytes) {
 	const auto finished = !haveSentRequests()
 		&& (_lastComplete || (_fullSize && _nextRequestOffset >= _loadSize));
 	if (finished) {
+		_queued = false;
 		removeFromQueue();
+		forgetPartialDownload();
 		if (!finalizeResult()) {
 			return false;
 		}
 	} else {
+		markLoadedParts(offset, buffer.size());
 		notifyAboutProgress();
 	}
 	return true;
@@ -181,7 +211,18 @@ bool mtpFileLoader::setWebFileSizeHook(int64 size) {
 }
 
 void mtpFileLoader::startLoading() {
-	addToQueue();
+	_queued = true;
+	addToQueue(_priority);
+}
+
+void mtpFileLoader::setPriority(int priority) {
+	if (_priority == priority) {
+		return;
+	}
+	_priority = priority;
+	if (_queued) {
+		addToQueue(_priority);
+	}
 }
 
 void mtpFileLoader::startLoadingWithPartial(const QByteArray &data) {
@@ -197,8 +238,173 @@ void mtpFileLoader::startLoadingWithPartial(const QByteArray &data) {
 	startLoading();
 }
 
+bool mtpFileLoader::resumeFromFile() {
+	if (!resumable()) {
+		return false;
+	}
+	const auto count = partsCount();
+	_loadedParts = QByteArray((count + 7) / 8, char(0));
+
+	auto &local = _session->local();
+	const auto id = objId();
+	const auto partial = local.partialDownload(id);
+	if (partial.path.isEmpty()) {
+		return false;
+	} else if (partial.size != _fullSize
+		|| partial.parts.size() != _loadedParts.size()) {
+		local.setPartialDownload(id, {});
+		return false;
+	}
+	_loadedParts = partial.parts;
+	auto loaded = int64();
+	auto till = int64();
+	for (auto i = 0; i != count; ++i) {
+		if (partLoaded(i)) {
+			const auto from = i * int64(Storage::kDownloadPartSize);
+			till = std::min(from + Storage::kDownloadPartSize, _fullSize);
+			loaded += till - from;
+		}
+	}
+	const auto &path = partial.path;
+	const auto size = QFileInfo(path).size();
+	const auto good = QFileInfo(path).isFile()
+		&& (size >= till)
+		&& (size <= _fullSize)
+		&& ((path == _filename)
+			|| (!QFile::exists(_filename) && QFile::rename(path, _filename)));
+	if (!good) {
+		if (path != _filename) {
+			QFile::remove(path);
+		}
+		local.setPartialDownload(id, {});
+		_loadedParts.fill(char(0));
+		return false;
+	}
+	if (loaded == _fullSize) {
+		// Interrupted right before finishing, request the last part again.
+		const auto last = count - 1;
+		_loadedParts.data()[last / 8] &= ~char(1 << (last % 8));
+		loaded -= _fullSize - last * int64(Storage::kDownloadPartSize);
+	}
+	_partialSaved = true;
+	_skippedBytes = size - loaded;
+	skipLoadedParts();
+
+	LOG(("Download Info: Resuming document %1, %2 of %3 bytes loaded."
+		).arg(id
+		).arg(loaded
+		).arg(_fullSize));
+	return true;
+}
+
+bool mtpFileLoader::resumable() const {
+	if (_toCache != LoadToFileOnly
+		|| _filename.isEmpty()
+		|| _fullSize < kMinResumableSize
+		|| _loadSize != _fullSize) {
+		return false;
+	}
+	const auto storage = std::get_if<StorageFileLocation>(&location().data);
+	return storage
+		&& (storage->type() == StorageFileLocation::Type::Document)
+		&& !storage->isDocumentThumbnail();
+}
+
+int mtpFileLoader::partsCount() const {
+	return int((_fullSize + Storage::kDownloadPartSize - 1)
+		/ Storage::kDownloadPartSize);
+}
+
+bool mtpFileLoader::partLoaded(int index) const {
+	return (index / 8 < _loadedParts.size())
+		&& (_loadedParts[index / 8] & char(1 << (index % 8)));
+}
+
+bool mtpFileLoader::hasLoadedParts(int64 offset, int64 size) const {
+	if (_loadedParts.isEmpty()) {
+		return false;
+	}
+	const auto from = int(offset / Storage::kDownloadPartSize);
+	const auto till = int((offset + size + Storage::kDownloadPartSize - 1)
+		/ Storage::kDownloadPartSize);
+	for (auto i = from; i != till; ++i) {
+		if (partLoaded(i)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void mtpFileLoader::markLoadedParts(int64 offset, int size) {
+	if (_loadedParts.isEmpty() || !size) {
+		return;
+	}
+	// Only whole parts, a short one is allowed at the end of the file.
+	const auto end = offset + size;
+	const auto from = int(offset / Storage::kDownloadPartSize);
+	const auto till = (end >= _fullSize)
+		? partsCount()
+		: int(end / Storage::kDownloadPartSize);
+	for (auto i = from; i < till; ++i) {
+		_loadedParts.data()[i / 8] |= char(1 << (i % 8));
+	}
+	_unsavedSize += size;
+	if (_unsavedSize >= kSavePartialEach) {
+		savePartialDownload();
+	}
+}
+
+void mtpFileLoader::skipLoadedParts() {
+	while (_nextRequestOffset < _loadSize
+		&& partLoaded(_nextRequestOffset / Storage::kDownloadPartSize)) {
+		_nextRequestOffset += Storage::kDownloadPartSize;
+	}
+}
+
+void mtpFileLoader::savePartialDownload() {
+	Expects(_fileIsOpen);
+
+	// The parts should reach the system before the list says they're
+	// loaded. That survives a crash of the app, not of the system: there
+	// is no fsync here, it would block the main thread every few parts.
+	if (!_file.flush()) {
+		return;
+	}
+	_unsavedSize = 0;
+	_partialSaved = true;
+	_session->local().setPartialDownload(objId(), {
+		.path = QFileInfo(_file).absoluteFilePath(),
+		.size = _fullSize,
+		.parts = _loadedParts,
+	});
+}
+
+void mtpFileLoader::forgetPartialDownload() {
+	if (base::take(_partialSaved)) {
+		_session->local().setPartialDownload(objId(), {});
+	}
+}
+
+void mtpFileLoader::keepPartialDownload() {
+	if (!_fileIsOpen
+		|| _loadedParts.isEmpty()
+		|| !hasLoadedParts(0, _fullSize)) {
+		return;
+	}
+	savePartialDownload();
+	if (_partialSaved) {
+		_file.close();
+		_fileIsOpen = false;
+		_partialKept = true;
+	}
+}
+
 void mtpFileLoader::cancelHook() {
+	_queued = false;
 	cancelAllRequests();
+	if (!_partialKept) {
+		forgetPartialDownload();
+	}
 }
 
 Storage::Cache::Key mtpFileLoader::cacheKey() const {
@@ -55,20 +55,43 @@ public:
 	Data::FileOrigin fileOrigin() const override;
 	uint64 objId() const override;
 
+	void setPriority(int priority) override;
+
 private:
 	Storage::Cache::Key cacheKey() const override;
 	std::optional<MediaKey> fileLocationKey() const override;
 	void startLoading() override;
 	void startLoadingWithPartial(const QByteArray &data) override;
+	bool resumeFromFile() override;
 	void cancelHook() override;
 
 	bool readyToRequest() const override;
-	int64 takeNextRequestOffset() override;
+	int nextRequestLimit(int maxLimit) const override;
+	int64 takeNextRequestOffset(int limit) override;
 	bool feedPart(int64 offset, const QByteArray &bytes) override;
 	void cancelOnFail() override;
 	bool setWebFileSizeHook(int64 size) override;
 
+	// Large documents saved to a file are kept on quit with the list
+	// of their loaded parts and continued from the missing ones.
+	[[nodiscard]] bool resumable() const;
+	[[nodiscard]] int partsCount() const;
+	[[nodiscard]] bool partLoaded(int index) const;
+	[[nodiscard]] bool hasLoadedParts(int64 offset, int64 size) const;
+	void markLoadedParts(int64 offset, int size);
+	void skipLoadedParts();
+	void savePartialDownload();
+	void forgetPartialDownload();
+	void keepPartialDownload();
+
 	bool _lastComplete = false;
 	int64 _nextRequestOffset = 0;
+	int _priority = 0;
+	bool _queued = false;
+
+	QByteArray _loadedParts;
+	int64 _unsavedSize = 0;
+	bool _partialSaved = false;
+	bool _partialKept = false;
 
 };
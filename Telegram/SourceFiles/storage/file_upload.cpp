@@ -29,6 +29,12 @@ namespace {
 // max 1mb uploaded at the same time in each session
 constexpr auto kMaxUploadPerSession = 1024 * 1024;
 
+// up to 4mb in each session, if all the sessions were fast with less
+constexpr auto kMaxUploadPerSessionLarge = 4 * 1024 * 1024;
+
+// How much of a document file is read ahead of the requests.
+constexpr auto kReadAheadSize = 4 * 1024 * 1024;
+
 constexpr auto kDocumentMaxPartsCountDefault = 4000;
 
 // 32kb for tiny document ( < 1mb )
@@ -69,6 +75,17 @@ constexpr auto kAcceptAsFastIfTotalAtLeast = 512 * 1024;
 
 } // namespace
 
+// The parts of a document file are read in the background,
+// so that they're ready when the sessions have room for them.
+struct Uploader::DocumentReader {
+	QMutex mutex;
+	std::deque<QByteArray> parts;
+	QFile file; // Used only by the reading thread.
+	int left = 0; // Parts not read yet.
+	bool reading = false;
+	bool failed = false;
+};
+
 struct Uploader::Entry {
 	Entry(FullMsgId itemId, const std::shared_ptr<FilePrepareResult> &file);
 
@@ -87,7 +104,7 @@ struct Uploader::Entry {
 
 	HashMd5 md5Hash;
 
-	std::unique_ptr<QFile> docFile;
+	std::shared_ptr<DocumentReader> docReader;
 	int64 docSize = 0;
 	int64 docSentSize = 0;
 	int docPartSize = 0;
@@ -95,6 +112,8 @@ struct Uploader::Entry {
 	ushort docPartsCount = 0;
 	ushort docPartsWaiting = 0;
 
+	bool early = false;
+
 };
 
 struct Uploader::Request {
@@ -153,6 +172,7 @@ bool Uploader::Entry::setPartSize(int partSize) {
 
 Uploader::Uploader(not_null<ApiWrap*> api)
 : _api(api)
+, _maxUploadPerSession(kMaxUploadPerSession)
 , _nextTimer([=] { maybeSend(); })
 , _stopSessionsTimer([=] { stopSessions(); }) {
 	const auto session = &_api->session();
@@ -342,17 +362,107 @@ void Uploader::upload(
 		}
 	}
 	_queue.push_back({ itemId, file });
+	continueEarly(&_queue.back());
 	if (!_nextTimer.isActive()) {
 		maybeSend();
 	}
 }
 
+void Uploader::uploadEarly(
+		uint64 fileId,
+		const QString &filepath,
+		int64 size) {
+	Expects(size > kUseBigFilesFrom);
+
+	auto file = MakePreparedFile({ .id = fileId });
+	file->filepath = filepath;
+	file->filesize = size;
+
+	const auto placeholder = FullMsgId(
+		PeerId(),
+		MsgId(++_earlyPlaceholderId));
+	_early.push_back({ placeholder, file });
+	_early.back().early = true;
+	if (!_nextTimer.isActive()) {
+		maybeSend();
+	}
+}
+
+void Uploader::cancelEarly(uint64 fileId) {
+	const auto i = ranges::find(_early, fileId, [](const Entry &entry) {
+		return entry.file->id;
+	});
+	if (i != end(_early)) {
+		const auto itemId = i->itemId;
+		_early.erase(i);
+		cancelRequests(itemId);
+		maybeSend();
+	}
+}
+
+void Uploader::continueEarly(not_null<Entry*> entry) {
+	const auto i = ranges::find(_early, entry->file->id, [](
+			const Entry &early) {
+		return early.file->id;
+	});
+	if (i == end(_early)) {
+		return;
+	}
+	const auto early = std::move(*i);
+	_early.erase(i);
+
+	if (early.file->filepath != entry->file->filepath
+		|| early.docSize != entry->docSize
+		|| !entry->file->content.isEmpty()) {
+		// Prepared differently from what was expected, send from scratch.
+		cancelRequests(early.itemId);
+		return;
+	}
+	entry->docReader = early.docReader;
+	entry->docSentSize = early.docSentSize;
+	entry->docPartsSent = early.docPartsSent;
+	entry->docPartsWaiting = early.docPartsWaiting;
+	for (auto &[requestId, request] : _requests) {
+		if (request.itemId == early.itemId) {
+			request.itemId = entry->itemId;
+		}
+	}
+	for (auto &request : _pendingFromRemovedDcIndices) {
+		if (request.itemId == early.itemId) {
+			request.itemId = entry->itemId;
+		}
+	}
+	const auto document = session().data().document(entry->file->id);
+	if (document->uploading()) {
+		document->uploadingData->offset = std::min(
+			document->uploadingData->size,
+			entry->docSentSize);
+	}
+
+	// All of the early parts may be sent and acked already, with nothing
+	// left to send for this entry maybeSend() wouldn't finish it.
+	maybeFinishFront();
+}
+
+Uploader::Entry *Uploader::findEntry(FullMsgId itemId) {
+	const auto i = ranges::find(_queue, itemId, &Entry::itemId);
+	if (i != end(_queue)) {
+		return &*i;
+	}
+	const auto j = ranges::find(_early, itemId, &Entry::itemId);
+	return (j != end(_early)) ? &*j : nullptr;
+}
+
 void Uploader::failed(FullMsgId itemId) {
 	const auto i = ranges::find(_queue, itemId, &Entry::itemId);
+	const auto j = ranges::find(_early, itemId, &Entry::itemId);
 	if (i != end(_queue)) {
 		const auto entry = std::move(*i);
 		_queue.erase(i);
 		notifyFailed(entry);
+	} else if (j != end(_early)) {
+		// upload() will send the whole file again.
+		_early.erase(j);
 	} else if (const auto coverId = _videoIdToCoverId.take(itemId)) {
 		if (const auto video = _videoWaitingCover.take(*coverId)) {
 			const auto document = session().data().document(video->id);
@@ -407,9 +517,11 @@ void Uploader::stopSessions() {
 		}
 		_sentPerDcIndex.clear();
 		_dcIndicesWithFastRequests.clear();
+		_maxUploadPerSession = kMaxUploadPerSession;
 	}
 }
 
+// Called only if docPartReady(entry) == true.
 QByteArray Uploader::readDocPart(not_null<Entry*> entry) {
 	const auto checked = [&](QByteArray result) {
 		if ((entry->file->type == SendMediaType::File
@@ -431,14 +543,86 @@ QByteArray Uploader::readDocPart(not_null<Entry*> entry) {
 	if (!content.isEmpty()) {
 		const auto offset = entry->docPartsSent * entry->docPartSize;
 		return checked(content.mid(offset, entry->docPartSize));
-	} else if (!entry->docFile) {
-		const auto filepath = entry->file->filepath;
-		entry->docFile = std::make_unique<QFile>(filepath);
-		if (!entry->docFile->open(QIODevice::ReadOnly)) {
-			return QByteArray();
+	}
+	const auto reader = entry->docReader.get();
+	auto result = QByteArray();
+	{
+		QMutexLocker lock(&reader->mutex);
+		if (!reader->parts.empty()) {
+			result = std::move(reader->parts.front());
+			reader->parts.pop_front();
 		}
 	}
-	return checked(entry->docFile->read(entry->docPartSize));
+	readDocParts(entry);
+	return checked(std::move(result));
+}
+
+bool Uploader::docPartReady(not_null<Entry*> entry) {
+	if (!entry->file->content.isEmpty()) {
+		return true;
+	}
+	readDocParts(entry);
+
+	const auto reader = entry->docReader.get();
+	QMutexLocker lock(&reader->mutex);
+	return !reader->parts.empty() || reader->failed;
+}
+
+void Uploader::readDocParts(not_null<Entry*> entry) {
+	if (!entry->docReader) {
+		entry->docReader = std::make_shared<DocumentReader>();
+		entry->docReader->file.setFileName(entry->file->filepath);
+		entry->docReader->left = entry->docPartsCount - entry->docPartsSent;
+	}
+	const auto reader = entry->docReader;
+	const auto partSize = entry->docPartSize;
+	const auto ahead = std::max(kReadAheadSize / partSize, 1);
+	{
+		QMutexLocker lock(&reader->mutex);
+		if (reader->reading
+			|| reader->failed
+			|| !reader->left
+			|| int(reader->parts.size()) >= ahead) {
+			return;
+		}
+		reader->reading = true;
+	}
+	crl::async([=, weak = base::make_weak(this)] {
+		const auto notify = [&] {
+			crl::on_main(weak, [=] {
+				maybeSend();
+			});
+		};
+		if (!reader->file.isOpen()
+			&& !reader->file.open(QIODevice::ReadOnly)) {
+			QMutexLocker lock(&reader->mutex);
+			reader->failed = true;
+			reader->reading = false;
+			notify();
+			return;
+		}
+		while (true) {
+			{
+				QMutexLocker lock(&reader->mutex);
+				if (!reader->left || int(reader->parts.size()) >= ahead) {
+					reader->reading = false;
+					return;
+				}
+			}
+			auto bytes = reader->file.read(partSize);
+
+			QMutexLocker lock(&reader->mutex);
+			if (bytes.isEmpty()) {
+				reader->failed = true;
+				reader->reading = false;
+				notify();
+				return;
+			}
+			reader->parts.push_back(std::move(bytes));
+			--reader->left;
+			notify();
+		}
+	});
 }
 
 bool Uploader::canAddDcIndex() const {
@@ -477,14 +661,23 @@ std::optional<uchar> Uploader::chooseDcIndexForNextRequest(
 Uploader::Entry *Uploader::chooseEntryForNextRequest() {
 	if (!_pendingFromRemovedDcIndices.empty()) {
 		const auto itemId = _pendingFromRemovedDcIndices.front().itemId;
-		const auto i = ranges::find(_queue, itemId, &Entry::itemId);
-		Assert(i != end(_queue));
-		return &*i;
+		const auto entry = findEntry(itemId);
+		Assert(entry != nullptr);
+		return entry;
 	}
 
+	// A document which parts are still being read doesn't hold back
+	// the files after it, they're sent in parallel.
 	for (auto i = begin(_queue); i != end(_queue); ++i) {
 		if (i->partsSent < i->parts->size()
-			|| i->docPartsSent < i->docPartsCount) {
+			|| (i->docPartsSent < i->docPartsCount
+				&& docPartReady(&*i))) {
+			return &*i;
+		}
+	}
+	// Early documents use the sessions only when the prepared files don't.
+	for (auto i = begin(_early); i != end(_early); ++i) {
+		if (i->docPartsSent < i->docPartsCount && docPartReady(&*i)) {
 			return &*i;
 		}
 	}
@@ -553,7 +746,7 @@ auto Uploader::sendDocPart(not_null<Entry*> entry, uchar dcIndex)
 	const auto itemId = entry->itemId;
 	const auto alreadySent = _sentPerDcIndex[dcIndex];
 	const auto willProbablyBeSent = entry->docPartSize;
-	if (alreadySent + willProbablyBeSent > kMaxUploadPerSession) {
+	if (alreadySent + willProbablyBeSent > _maxUploadPerSession) {
 		return SendResult::DcIndexFull;
 	}
 
@@ -599,7 +792,7 @@ auto Uploader::sendSlicedPart(not_null<Entry*> entry, uchar dcIndex)
 	const auto itemId = entry->itemId;
 	const auto alreadySent = _sentPerDcIndex[dcIndex];
 	const auto willBeSent = entry->parts->at(entry->partsSent).size();
-	if (alreadySent + willBeSent >= kMaxUploadPerSession) {
+	if (alreadySent + willBeSent >= _maxUploadPerSession) {
 		return SendResult::DcIndexFull;
 	}
 
@@ -620,7 +813,7 @@ auto Uploader::sendSlicedPart(not_null<Entry*> entry, uchar dcIndex)
 
 void Uploader::maybeSend() {
 	const auto stopping = _stopSessionsTimer.isActive();
-	if (_queue.empty()) {
+	if (_queue.empty() && _early.empty()) {
 		if (!stopping) {
 			_stopSessionsTimer.callOnce(kKillSessionTimeout);
 		}
@@ -711,6 +904,7 @@ void Uploader::cancelAllRequests() {
 
 void Uploader::clear() {
 	_queue.clear();
+	_early.clear();
 	cancelAllRequests();
 	stopSessions();
 	_stopSessionsTimer.cancel();
@@ -735,9 +929,9 @@ void Uploader::partLoaded(const MTPBool &result, mtpRequestId requestId) {
 		return;
 	}
 
-	const auto i = ranges::find(_queue, itemId, &Entry::itemId);
-	Assert(i != end(_queue));
-	auto &entry = *i;
+	const auto found = findEntry(itemId);
+	Assert(found != nullptr);
+	auto &entry = *found;
 
 	const auto now = crl::now();
 	const auto duration = now - request.sent;
@@ -747,6 +941,13 @@ void Uploader::partLoaded(const MTPBool &result, mtpRequestId requestId) {
 
 	if (slowish) {
 		_dcIndicesWithFastRequests.clear();
+		if (_maxUploadPerSession > kMaxUploadPerSession) {
+			_maxUploadPerSession = std::max(
+				_maxUploadPerSession / 2,
+				kMaxUploadPerSession);
+			DEBUG_LOG(("Uploader: Slow-ish request, in session: %1."
+				).arg(_maxUploadPerSession));
+		}
 		if (slow) {
 			const auto elapsed = (now - _latestDcIndexRemoved);
 			const auto remove = (elapsed >= kWaitForNormalizeTimeout);
@@ -767,6 +968,17 @@ void Uploader::partLoaded(const MTPBool &result, mtpRequestId requestId) {
 				).arg(request.dcIndex
 				).arg(_sentPerDcIndex.size()));
 		}
+		if (_sentPerDcIndex.size() == kMaxSessionsCount
+			&& _dcIndicesWithFastRequests.size() == kMaxSessionsCount
+			&& _maxUploadPerSession < kMaxUploadPerSessionLarge) {
+			// No more sessions to add, let each of them send more.
+			_maxUploadPerSession = std::min(
+				_maxUploadPerSession * 2,
+				kMaxUploadPerSessionLarge);
+			_dcIndicesWithFastRequests.clear();
+			DEBUG_LOG(("Uploader: All fast, in session: %1."
+				).arg(_maxUploadPerSession));
+		}
 	}
 
 	if (request.docPart) {
@@ -776,6 +988,11 @@ void Uploader::partLoaded(const MTPBool &result, mtpRequestId requestId) {
 		--entry.partsWaiting;
 		entry.sentSize += bytes;
 	}
+	if (entry.early) {
+		// There is no document or message to report the progress to yet.
+		maybeSend();
+		return;
+	}
 
 	if (entry.file->type == SendMediaType::Photo) {
 		const auto photo = session().data().photo(entry.file->id);
@@ -64,6 +64,12 @@ public:
 	void cancel(FullMsgId itemId);
 	void cancelAll();
 
+	// Starts sending the parts of a large local document while its
+	// FileLoadTask is still preparing it, upload() with the same file id
+	// continues from the parts that were already sent.
+	void uploadEarly(uint64 fileId, const QString &filepath, int64 size);
+	void cancelEarly(uint64 fileId);
+
 	[[nodiscard]] rpl::producer<UploadedMedia> photoReady() const {
 		return _photoReady.events();
 	}
@@ -103,6 +109,7 @@ public:
 private:
 	struct Entry;
 	struct Request;
+	struct DocumentReader;
 
 	enum class SendResult : uchar {
 		Success,
@@ -123,6 +130,8 @@ private:
 	[[nodiscard]] auto sendSlicedPart(not_null<Entry*> entry, uchar dcIndex)
 		-> SendResult;
 	[[nodiscard]] QByteArray readDocPart(not_null<Entry*> entry);
+	[[nodiscard]] bool docPartReady(not_null<Entry*> entry);
+	void readDocParts(not_null<Entry*> entry);
 	void removeDcIndex();
 
 	template <typename Prepared>
@@ -130,6 +139,8 @@ private:
 
 	void maybeFinishFront();
 	void finishFront();
+	void continueEarly(not_null<Entry*> entry);
+	[[nodiscard]] Entry *findEntry(FullMsgId itemId);
 
 	void partLoaded(const MTPBool &result, mtpRequestId requestId);
 	void partFailed(const MTP::Error &error, mtpRequestId requestId);
@@ -160,8 +171,13 @@ private:
 
 	std::vector<Entry> _queue;
 
+	// Not prepared yet, their requests have placeholder item ids.
+	std::vector<Entry> _early;
+	int64 _earlyPlaceholderId = 0;
+
 	base::flat_map<mtpRequestId, Request> _requests;
 	std::vector<int> _sentPerDcIndex;
+	int _maxUploadPerSession = 0;
 
 	// Fast requests since the latest dc index addition.
 	base::flat_set<uchar> _dcIndicesWithFastRequests;
@@ -14,6 +14,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_user.h"
 #include "core/file_utilities.h"
 #include "core/mime_type.h"
+#include "base/invoke_queued.h"
 #include "base/options.h"
 #include "base/unixtime.h"
 #include "base/random.h"
@@ -33,7 +34,9 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "ui/image/image_prepare.h"
 #include "lang/lang_keys.h"
 #include "storage/file_download.h"
+#include "storage/file_upload.h"
 #include "storage/storage_media_prepare.h"
+#include "storage/storage_video_transcode.h"
 #include "window/themes/window_theme_preview.h"
 #include "mainwidget.h"
 #include "mainwindow.h"
@@ -222,7 +225,8 @@ int PhotoSideLimit() {
 	return PhotoSideLimit(SendLargePhotos.value());
 }
 
-TaskQueue::TaskQueue(crl::time stopTimeoutMs) {
+TaskQueue::TaskQueue(crl::time stopTimeoutMs, int maxThreads)
+: _maxThreads(std::max(maxThreads, 1)) {
 	if (stopTimeoutMs > 0) {
 		_stopTimer = new QTimer(this);
 		connect(_stopTimer, SIGNAL(timeout()), this, SLOT(stop()));
@@ -255,21 +259,39 @@ void TaskQueue::addTasks(std::vector<std::unique_ptr<Task>> &&tasks) {
 }
 
 void TaskQueue::wakeThread() {
-	if (!_thread) {
-		_thread = new QThread();
+	auto wanted = 0;
+	{
+		QMutexLocker lock(&_tasksToProcessMutex);
+		wanted = int(_tasksToProcess.size() + _tasksInProcess.size());
+	}
+	while (int(_threads.size()) < std::min(wanted, _maxThreads)) {
+		const auto thread = new QThread();
 
-		_worker = new TaskQueueWorker(this);
-		_worker->moveToThread(_thread);
+		const auto worker = new TaskQueueWorker(this);
+		worker->moveToThread(thread);
 
-		connect(this, SIGNAL(taskAdded()), _worker, SLOT(onTaskAdded()));
-		connect(_worker, SIGNAL(taskProcessed()), this, SLOT(onTaskProcessed()));
+		connect(this, SIGNAL(taskAdded()), worker, SLOT(onTaskAdded()));
+		connect(worker, SIGNAL(taskProcessed()), this, SLOT(onTaskProcessed()));
 
-		_thread->start();
+		thread->start();
+		_threads.push_back({ thread, worker });
 	}
 	if (_stopTimer) _stopTimer->stop();
 	taskAdded();
 }
 
+bool TaskQueue::finishReady() const {
+	QMutexLocker lockToProcess(&_tasksToProcessMutex);
+	if (_finishOrder.empty()) {
+		return false;
+	}
+	QMutexLocker lockToFinish(&_tasksToFinishMutex);
+	return ranges::contains(
+		_tasksToFinish,
+		_finishOrder.front(),
+		[](const std::unique_ptr<Task> &task) { return task->id(); });
+}
+
 void TaskQueue::cancelTask(TaskId id) {
 	const auto removeFrom = [&](std::deque<std::unique_ptr<Task>> &queue) {
 		const auto proj = [](const std::unique_ptr<Task> &task) {
@@ -283,46 +305,68 @@ void TaskQueue::cancelTask(TaskId id) {
 	{
 		QMutexLocker lock(&_tasksToProcessMutex);
 		removeFrom(_tasksToProcess);
-		if (_taskInProcessId == id) {
-			_taskInProcessId = TaskId();
-		}
+		_tasksInProcess.erase(
+			ranges::remove(_tasksInProcess, id),
+			end(_tasksInProcess));
+		_finishOrder.erase(
+			ranges::remove(_finishOrder, id),
+			end(_finishOrder));
+
+		QMutexLocker lockToFinish(&_tasksToFinishMutex);
+		removeFrom(_tasksToFinish);
+	}
+
+	// The tasks after the cancelled one could be waiting for it.
+	if (finishReady()) {
+		InvokeQueued(this, [=] { onTaskProcessed(); });
 	}
-	QMutexLocker lock(&_tasksToFinishMutex);
-	removeFrom(_tasksToFinish);
 }
 
 void TaskQueue::onTaskProcessed() {
 	do {
 		auto task = std::unique_ptr<Task>();
 		{
-			QMutexLocker lock(&_tasksToFinishMutex);
-			if (_tasksToFinish.empty()) break;
-			task = std::move(_tasksToFinish.front());
-			_tasksToFinish.pop_front();
+			QMutexLocker lockToProcess(&_tasksToProcessMutex);
+			if (_finishOrder.empty()) break;
+
+			QMutexLocker lockToFinish(&_tasksToFinishMutex);
+			const auto i = ranges::find(
+				_tasksToFinish,
+				_finishOrder.front(),
+				[](const std::unique_ptr<Task> &task) { return task->id(); });
+			if (i == _tasksToFinish.end()) break;
+			task = std::move(*i);
+			_tasksToFinish.erase(i);
+			_finishOrder.pop_front();
 		}
 		task->finish();
 	} while (true);
 
 	if (_stopTimer) {
 		QMutexLocker lock(&_tasksToProcessMutex);
-		if (_tasksToProcess.empty() && !_taskInProcessId) {
+		if (_tasksToProcess.empty() && _tasksInProcess.empty()) {
 			_stopTimer->start();
 		}
 	}
 }
 
 void TaskQueue::stop() {
-	if (_thread) {
-		_thread->requestInterruption();
-		_thread->quit();
+	for (const auto &[thread, worker] : _threads) {
+		thread->requestInterruption();
+		thread->quit();
+	}
+	if (!_threads.empty()) {
 		DEBUG_LOG(("Waiting for taskThread to finish"));
-		_thread->wait();
-		delete base::take(_worker);
-		delete base::take(_thread);
+	}
+	for (const auto &[thread, worker] : base::take(_threads)) {
+		thread->wait();
+		delete worker;
+		delete thread;
 	}
 	_tasksToProcess.clear();
 	_tasksToFinish.clear();
-	_taskInProcessId = TaskId();
+	_tasksInProcess.clear();
+	_finishOrder.clear();
 }
 
 TaskQueue::~TaskQueue() {
@@ -342,7 +386,8 @@ void TaskQueueWorker::onTaskAdded() {
 			if (!_queue->_tasksToProcess.empty()) {
 				task = std::move(_queue->_tasksToProcess.front());
 				_queue->_tasksToProcess.pop_front();
-				_queue->_taskInProcessId = task->id();
+				_queue->_tasksInProcess.push_back(task->id());
+				_queue->_finishOrder.push_back(task->id());
 			}
 		}
 
@@ -351,12 +396,17 @@ void TaskQueueWorker::onTaskAdded() {
 			bool emitTaskProcessed = false;
 			{
 				QMutexLocker lockToProcess(&_queue->_tasksToProcessMutex);
-				if (_queue->_taskInProcessId == task->id()) {
-					_queue->_taskInProcessId = TaskId();
-					someTasksLeft = !_queue->_tasksToProcess.empty();
+				someTasksLeft = !_queue->_tasksToProcess.empty();
 
+				auto &inProcess = _queue->_tasksInProcess;
+				const auto i = ranges::find(inProcess, task->id());
+				if (i != inProcess.end()) {
+					inProcess.erase(i);
+
+					// Others wait until the earliest task is processed.
 					QMutexLocker lockToFinish(&_queue->_tasksToFinishMutex);
-					emitTaskProcessed = _queue->_tasksToFinish.empty();
+					emitTaskProcessed
+						= (_queue->_finishOrder.front() == task->id());
 					_queue->_tasksToFinish.push_back(std::move(task));
 				}
 			}
@@ -496,6 +546,7 @@ FileLoadTask::FileLoadTask(
 		|| IsServerMsgId(to.replaceMediaOf));
 
 	SendLargePhotosAtomic = SendLargePhotos.value();
+	_transcodeVideos = Storage::TranscodeLargeVideos();
 }
 
 FileLoadTask::FileLoadTask(
@@ -517,7 +568,39 @@ FileLoadTask::FileLoadTask(
 , _caption(caption) {
 }
 
-FileLoadTask::~FileLoadTask() = default;
+FileLoadTask::~FileLoadTask() {
+	if (_uploadingEarly) {
+		// Nothing to cancel if upload() has already taken the parts.
+		crl::on_main(_session, [session = _session, id = _id] {
+			session->uploader().cancelEarly(id);
+		});
+	}
+}
+
+void FileLoadTask::startEarlyUpload() {
+	const auto session = _session.get();
+	if (!session
+		|| _uploadingEarly
+		|| _type != SendMediaType::File
+		|| _filepath.isEmpty()
+		|| !_content.isEmpty()) {
+		return;
+	}
+	const auto info = QFileInfo(_filepath);
+	const auto size = info.size();
+	const auto limit = session->user()->isPremium()
+		? kFileSizePremiumLimit
+		: kFileSizeLimit;
+	if (size <= Storage::kUseBigFilesFrom || size > limit) {
+		return;
+	} else if (_transcodeVideos
+		&& Core::MimeTypeForFile(info).name().startsWith(u"video/"_q)) {
+		// The file may be replaced by the transcoded one.
+		return;
+	}
+	session->uploader().uploadEarly(_id, _filepath, size);
+	_uploadingEarly = true;
+}
 
 auto FileLoadTask::ReadMediaInformation(
 	const QString &filepath,
@@ -734,6 +817,10 @@ void FileLoadTask::process(Args &&args) {
 		if (!_information) {
 			_information = readMediaInformation(Core::MimeTypeForFile(info).name());
 		}
+		if (_transcodeVideos && transcodeVideo(filesize)) {
+			filesize = QFileInfo(_filepath).size();
+			filename = info.completeBaseName() + u".mp4"_q;
+		}
 		filemime = _information->filemime;
 		if (auto image = std::get_if<Ui::PreparedFileInformation::Image>(
 				&_information->media)) {
@@ -1091,6 +1178,25 @@ const std::shared_ptr<FilePrepareResult> &FileLoadTask::peekResult() const {
 	return _result;
 }
 
+bool FileLoadTask::transcodeVideo(int64 size) {
+	const auto video = std::get_if<Ui::PreparedFileInformation::Video>(
+		&_information->media);
+	if (!video
+		|| video->isGifv
+		|| video->isWebmSticker
+		|| _type == SendMediaType::Photo
+		|| !Storage::ShouldTranscodeVideo(_filepath, size)) {
+		return false;
+	}
+	const auto result = Storage::TranscodeVideo(_filepath);
+	if (!result) {
+		return false;
+	}
+	_filepath = result->path;
+	_information = readMediaInformation(u"video/mp4"_q);
+	return true;
+}
+
 std::unique_ptr<Ui::PreparedFileInformation> FileLoadTask::readMediaInformation(
 		const QString &filemime) const {
 	return ReadMediaInformation(_filepath, _content, filemime);
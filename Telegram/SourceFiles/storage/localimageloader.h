@@ -57,7 +57,10 @@ class TaskQueue : public QObject {
 	Q_OBJECT
 
 public:
-	explicit TaskQueue(crl::time stopTimeoutMs = 0); // <= 0 - never stop worker
+	// stopTimeoutMs <= 0 - never stop workers.
+	// Tasks are processed by up to maxThreads workers at once, but they
+	// are always finished in the order they were added.
+	explicit TaskQueue(crl::time stopTimeoutMs = 0, int maxThreads = 1);
 
 	TaskId addTask(std::unique_ptr<Task> &&task);
 	void addTasks(std::vector<std::unique_ptr<Task>> &&tasks);
@@ -75,14 +78,21 @@ public Q_SLOTS:
 private:
 	friend class TaskQueueWorker;
 
+	struct Thread {
+		QThread *thread = nullptr;
+		TaskQueueWorker *worker = nullptr;
+	};
+
 	void wakeThread();
+	[[nodiscard]] bool finishReady() const;
 
 	std::deque<std::unique_ptr<Task>> _tasksToProcess;
 	std::deque<std::unique_ptr<Task>> _tasksToFinish;
-	TaskId _taskInProcessId = TaskId();
-	QMutex _tasksToProcessMutex, _tasksToFinishMutex;
-	QThread *_thread = nullptr;
-	TaskQueueWorker *_worker = nullptr;
+	std::vector<TaskId> _tasksInProcess;
+	std::deque<TaskId> _finishOrder; // Taken for processing, not finished.
+	mutable QMutex _tasksToProcessMutex, _tasksToFinishMutex;
+	std::vector<Thread> _threads;
+	int _maxThreads = 1;
 	QTimer *_stopTimer = nullptr;
 
 };
@@ -245,6 +255,9 @@ public:
 		return _id;
 	}
 
+	// Large documents from disk are uploaded while being prepared.
+	void startEarlyUpload();
+
 	struct Args {
 		bool generateGoodThumbnail = true;
 	};
@@ -276,6 +289,7 @@ private:
 	static bool CheckMimeOrExtensions(const QString &filepath, const QString &filemime, Mimes &mimes, Extensions &extensions);
 
 	std::unique_ptr<Ui::PreparedFileInformation> readMediaInformation(const QString &filemime) const;
+	[[nodiscard]] bool transcodeVideo(int64 size);
 	void removeFromAlbum();
 
 	uint64 _id = 0;
@@ -292,6 +306,8 @@ private:
 	SendMediaType _type;
 	TextWithTags _caption;
 	bool _spoiler = false;
+	bool _uploadingEarly = false;
+	bool _transcodeVideos = false;
 
 	std::shared_ptr<FilePrepareResult> _result;
 
@@ -27,6 +27,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "history/history.h"
 #include "core/application.h"
 #include "core/core_settings.h"
+#include "core/core_tracing.h"
 #include "core/file_location.h"
 #include "data/components/recent_peers.h"
 #include "data/components/top_peers.h"
@@ -38,6 +39,9 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "export/export_settings.h"
 #include "webview/webview_interface.h"
 #include "window/themes/window_theme.h"
+#include "base/random.h"
+
+#include <xxhash.h>
 
 namespace Storage {
 namespace {
@@ -48,10 +52,20 @@ using Database = Cache::Database;
 constexpr auto kDelayedWriteTimeout = crl::time(1000);
 constexpr auto kWriteSearchSuggestionsDelay = 5 * crl::time(1000);
 constexpr auto kMaxSavedPlaybackPositions = 256;
+constexpr auto kMaxPartialDownloads = 32;
 
 constexpr auto kStickersVersionTag = quint32(-1);
 constexpr auto kStickersSerializeVersion = 4;
+constexpr auto kStickersJournalVersion = 5;
 constexpr auto kMaxSavedStickerSetsCount = 1000;
+constexpr auto kMinStickersJournalSize = 64 * 1024;
+constexpr auto kMinLocationsJournalSize = 64 * 1024;
+
+// Keep the cache maintenance in small steps, so that neither pruning of
+// the stale entries nor the binlog compaction hold the disk for long.
+constexpr auto kCacheStaleRemoveChunk = 64;
+constexpr auto kCacheCompactChunkSize = 4 * 1024;
+constexpr auto kCachePruneTimeout = 15 * crl::time(1000);
 constexpr auto kDefaultStickerInstallDate = TimeId(1);
 
 constexpr auto kSinglePeerTypeUserOld = qint32(1);
@@ -101,6 +115,7 @@ enum { // Local Storage Keys
 	lskMediaLastPlaybackPositions = 0x1c, // no data
 	lskBotStorages = 0x1d, // data: PeerId botId
 	lskPrefs = 0x1e, // no data
+	lskPartialDownloads = 0x1f, // no data
 };
 
 auto EmptyMessageDraftSources()
@@ -164,8 +179,120 @@ auto EmptyMessageDraftSources()
 	};
 }
 
+void ApplyCacheMaintenance(Cache::Database::Settings &settings) {
+	settings.staleRemoveChunk = kCacheStaleRemoveChunk;
+	settings.compactChunkSize = kCacheCompactChunkSize;
+	settings.pruneTimeout = kCachePruneTimeout;
+}
+
+[[nodiscard]] QString JournalPath(const QString &basePath, FileKey key) {
+	return basePath + ToFilePart(key) + 'j';
+}
+
+[[nodiscard]] bool AppendJournal(
+		const QString &path,
+		const QByteArray &encrypted) {
+	QFile file(path);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+		return false;
+	}
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_1);
+	stream << encrypted;
+	return (stream.status() == QDataStream::Ok);
+}
+
+[[nodiscard]] int JournalRecordSize(const QByteArray &encrypted) {
+	return sizeof(quint32) + encrypted.size();
+}
+
+// Calls method(EncryptedDescriptor&) for each record while it returns
+// true and adds up the sizes of the applied records. False if the journal
+// ended with a bad record: the file was cut by a crash while appending or
+// was left from another base file, so it should be written anew.
+template <typename Method>
+[[nodiscard]] bool ReadJournal(
+		const QString &path,
+		const MTP::AuthKeyPtr &key,
+		int &size,
+		Method &&method) {
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return true;
+	}
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_1);
+	while (!stream.atEnd()) {
+		QByteArray encrypted;
+		stream >> encrypted;
+		EncryptedDescriptor record;
+		if (stream.status() != QDataStream::Ok
+			|| !DecryptLocal(record, encrypted, key)
+			|| !method(record)) {
+			return false;
+		}
+		size += JournalRecordSize(encrypted);
+	}
+	return true;
+}
+
+[[nodiscard]] uint64 StickersChunkHash(const QByteArray &chunk) {
+	return XXH64(chunk.constData(), chunk.size(), 0);
+}
+
+void OpenPrefetched(
+		FileReadDescriptor &result,
+		int32 version,
+		QByteArray &&data,
+		qint64 position) {
+	result.version = version;
+	result.data = std::move(data);
+	result.buffer.setBuffer(&result.data);
+	result.buffer.open(QIODevice::ReadOnly);
+	result.buffer.seek(position);
+	result.stream.setDevice(&result.buffer);
+	result.stream.setVersion(QDataStream::Qt_5_1);
+}
+
 } // namespace
 
+struct Account::ReadMap {
+	int32 version = 0;
+	MTP::AuthKeyPtr localKey;
+	QByteArray selfSerialized;
+	base::flat_map<PeerId, FileKey> draftsMap;
+	base::flat_map<PeerId, FileKey> draftCursorsMap;
+	base::flat_map<PeerId, bool> draftsNotReadMap;
+	base::flat_map<PeerId, FileKey> botStoragesMap;
+	base::flat_map<PeerId, bool> botStoragesNotReadMap;
+	quint64 prefsKey = 0, locationsKey = 0, reportSpamStatusesKey = 0, trustedPeersKey = 0;
+	quint64 recentStickersKeyOld = 0;
+	quint64 installedStickersKey = 0, featuredStickersKey = 0, recentStickersKey = 0, favedStickersKey = 0, archivedStickersKey = 0;
+	quint64 installedMasksKey = 0, recentMasksKey = 0, archivedMasksKey = 0;
+	quint64 installedCustomEmojiKey = 0, featuredCustomEmojiKey = 0, archivedCustomEmojiKey = 0;
+	quint64 savedGifsKey = 0;
+	quint64 legacyBackgroundKeyDay = 0, legacyBackgroundKeyNight = 0;
+	quint64 legacyBackgroundKeyOldOld = 0; // Day or night, by the theme.
+	quint64 userSettingsKey = 0, recentHashtagsAndBotsKey = 0, exportSettingsKey = 0;
+	quint64 searchSuggestionsKey = 0;
+	quint64 roundPlaceholderKey = 0;
+	quint64 inlineBotsDownloadsKey = 0;
+	quint64 mediaLastPlaybackPositionsKey = 0;
+	quint64 partialDownloadsKey = 0;
+	QByteArray webviewStorageTokenBots, webviewStorageTokenOther;
+};
+
+struct Account::StartPrefetch {
+	ReadMapResult result = ReadMapResult::Failed;
+	ReadMap map;
+
+	// By base path + file name.
+	base::flat_map<QString, PrefetchedFile> files;
+
+	// Released by the worker when everything above is filled.
+	crl::semaphore ready;
+};
+
 Account::Account(not_null<Main::Account*> owner, const QString &dataName)
 : _owner(owner)
 , _dataName(dataName)
@@ -215,13 +342,70 @@ StartResult Account::legacyStart(const QByteArray &passcode) {
 	return StartResult::Success;
 }
 
+void Account::prefetchStart(MTP::AuthKeyPtr localKey) {
+	Expects(localKey != nullptr);
+	Expects(_startPrefetch == nullptr);
+
+	const auto result = std::make_shared<StartPrefetch>();
+	crl::async([
+			=,
+			basePath = _basePath,
+			globalPath = BaseGlobalPath(),
+			mtpName = ToFilePart(_dataNameKey)] {
+		const auto trace = Core::Tracing::Scope("async", "prefetchStart");
+		const auto prefetch = [&](const QString &name, const QString &path) {
+			auto file = FileReadDescriptor();
+			if (ReadEncryptedFile(file, name, path, localKey)) {
+				result->files.emplace(path + name, PrefetchedFile{
+					.version = file.version,
+					.data = file.data,
+					.position = file.buffer.pos(),
+				});
+			}
+		};
+		auto &map = result->map;
+		result->result = ReadMapFile(map, basePath, localKey, QByteArray());
+		if (result->result == ReadMapResult::Success) {
+			const auto keys = {
+				map.prefsKey,
+				map.locationsKey,
+				map.userSettingsKey,
+			};
+			for (const auto key : keys) {
+				if (key) {
+					prefetch(ToFilePart(key), basePath);
+				}
+			}
+		}
+		prefetch(mtpName, globalPath);
+		prefetch(u"config"_q, basePath);
+		result->ready.release();
+	});
+	_startPrefetch = result;
+}
+
 std::unique_ptr<MTP::Config> Account::start(MTP::AuthKeyPtr localKey) {
 	Expects(localKey != nullptr);
 
 	_localKey = std::move(localKey);
-	readMapWith(_localKey);
+	if (const auto prefetch = base::take(_startPrefetch)) {
+		auto ms = crl::now();
+		prefetch->ready.acquire();
+		LOG(("Map prefetch wait time: %1").arg(crl::now() - ms));
+
+		_startFiles = std::move(prefetch->files);
+		if (prefetch->result == ReadMapResult::Success) {
+			ms = crl::now();
+			applyMap(std::move(prefetch->map));
+			LOG(("Map read time: %1").arg(crl::now() - ms));
+		}
+	} else {
+		readMapWith(_localKey);
+	}
 	clearLegacyFiles();
-	return readMtpConfig();
+	auto result = readMtpConfig();
+	_startFiles.clear();
+	return result;
 }
 
 void Account::startAdded(MTP::AuthKeyPtr localKey) {
@@ -268,6 +452,7 @@ base::flat_set<QString> Account::collectGoodNames() const {
 		_roundPlaceholderKey,
 		_inlineBotsDownloadsKey,
 		_mediaLastPlaybackPositionsKey,
+		_partialDownloadsKey,
 	};
 	auto result = base::flat_set<QString>{
 		"map0",
@@ -285,6 +470,8 @@ base::flat_set<QString> Account::collectGoodNames() const {
 		result.emplace(name);
 		name[name.size() - 1] = 's';
 		result.emplace(name);
+		name[name.size() - 1] = 'j';
+		result.emplace(name);
 	};
 	for (const auto &[key, value] : _draftsMap) {
 		push(value);
@@ -301,13 +488,13 @@ base::flat_set<QString> Account::collectGoodNames() const {
 	return result;
 }
 
-Account::ReadMapResult Account::readMapWith(
+auto Account::ReadMapFile(
+		ReadMap &result,
+		const QString &basePath,
 		MTP::AuthKeyPtr localKey,
-		const QByteArray &legacyPasscode) {
-	auto ms = crl::now();
-
+		const QByteArray &legacyPasscode) -> ReadMapResult {
 	FileReadDescriptor mapData;
-	if (!ReadFile(mapData, u"map"_q, _basePath)) {
+	if (!ReadFile(mapData, u"map"_q, basePath)) {
 		return ReadMapResult::Failed;
 	}
 	LOG(("App Info: reading map..."));
@@ -344,25 +531,7 @@ Account::ReadMapResult Account::readMapWith(
 	}
 	LOG(("App Info: reading encrypted map..."));
 
-	QByteArray selfSerialized;
-	base::flat_map<PeerId, FileKey> draftsMap;
-	base::flat_map<PeerId, FileKey> draftCursorsMap;
-	base::flat_map<PeerId, bool> draftsNotReadMap;
-	base::flat_map<PeerId, FileKey> botStoragesMap;
-	base::flat_map<PeerId, bool> botStoragesNotReadMap;
-	quint64 prefsKey = 0, locationsKey = 0, reportSpamStatusesKey = 0, trustedPeersKey = 0;
-	quint64 recentStickersKeyOld = 0;
-	quint64 installedStickersKey = 0, featuredStickersKey = 0, recentStickersKey = 0, favedStickersKey = 0, archivedStickersKey = 0;
-	quint64 installedMasksKey = 0, recentMasksKey = 0, archivedMasksKey = 0;
-	quint64 installedCustomEmojiKey = 0, featuredCustomEmojiKey = 0, archivedCustomEmojiKey = 0;
-	quint64 savedGifsKey = 0;
-	quint64 legacyBackgroundKeyDay = 0, legacyBackgroundKeyNight = 0;
-	quint64 userSettingsKey = 0, recentHashtagsAndBotsKey = 0, exportSettingsKey = 0;
-	quint64 searchSuggestionsKey = 0;
-	quint64 roundPlaceholderKey = 0;
-	quint64 inlineBotsDownloadsKey = 0;
-	quint64 mediaLastPlaybackPositionsKey = 0;
-	QByteArray webviewStorageTokenBots, webviewStorageTokenOther;
+	result.version = mapData.version;
 	while (!map.stream.atEnd()) {
 		quint32 keyType;
 		map.stream >> keyType;
@@ -375,12 +544,12 @@ Account::ReadMapResult Account::readMapWith(
 				quint64 peerIdSerialized;
 				map.stream >> key >> peerIdSerialized;
 				const auto peerId = DeserializePeerId(peerIdSerialized);
-				draftsMap.emplace(peerId, key);
-				draftsNotReadMap.emplace(peerId, true);
+				result.draftsMap.emplace(peerId, key);
+				result.draftsNotReadMap.emplace(peerId, true);
 			}
 		} break;
 		case lskSelfSerialized: {
-			map.stream >> selfSerialized;
+			map.stream >> result.selfSerialized;
 		} break;
 		case lskDraftPosition: {
 			quint32 count = 0;
@@ -390,7 +559,7 @@ Account::ReadMapResult Account::readMapWith(
 				quint64 peerIdSerialized;
 				map.stream >> key >> peerIdSerialized;
 				const auto peerId = DeserializePeerId(peerIdSerialized);
-				draftCursorsMap.emplace(peerId, key);
+				result.draftCursorsMap.emplace(peerId, key);
 			}
 		} break;
 		case lskLegacyImages:
@@ -407,86 +576,86 @@ Account::ReadMapResult Account::readMapWith(
 			}
 		} break;
 		case lskPrefs: {
-			map.stream >> prefsKey;
+			map.stream >> result.prefsKey;
 		} break;
 		case lskLocations: {
-			map.stream >> locationsKey;
+			map.stream >> result.locationsKey;
 		} break;
 		case lskReportSpamStatusesOld: {
-			map.stream >> reportSpamStatusesKey;
-			ClearKey(reportSpamStatusesKey, _basePath);
+			map.stream >> result.reportSpamStatusesKey;
 		} break;
 		case lskTrustedPeers: {
-			map.stream >> trustedPeersKey;
+			map.stream >> result.trustedPeersKey;
 		} break;
 		case lskRecentStickersOld: {
-			map.stream >> recentStickersKeyOld;
+			map.stream >> result.recentStickersKeyOld;
 		} break;
 		case lskBackgroundOldOld: {
-			map.stream >> (Window::Theme::IsNightMode()
-				? legacyBackgroundKeyNight
-				: legacyBackgroundKeyDay);
+			map.stream >> result.legacyBackgroundKeyOldOld;
 		} break;
 		case lskBackgroundOld: {
-			map.stream >> legacyBackgroundKeyDay >> legacyBackgroundKeyNight;
+			map.stream >> result.legacyBackgroundKeyDay >> result.legacyBackgroundKeyNight;
 		} break;
 		case lskUserSettings: {
-			map.stream >> userSettingsKey;
+			map.stream >> result.userSettingsKey;
 		} break;
 		case lskRecentHashtagsAndBots: {
-			map.stream >> recentHashtagsAndBotsKey;
+			map.stream >> result.recentHashtagsAndBotsKey;
 		} break;
 		case lskStickersOld: {
-			map.stream >> installedStickersKey;
+			map.stream >> result.installedStickersKey;
 		} break;
 		case lskStickersKeys: {
-			map.stream >> installedStickersKey >> featuredStickersKey >> recentStickersKey >> archivedStickersKey;
+			map.stream >> result.installedStickersKey >> result.featuredStickersKey >> result.recentStickersKey >> result.archivedStickersKey;
 		} break;
 		case lskFavedStickers: {
-			map.stream >> favedStickersKey;
+			map.stream >> result.favedStickersKey;
 		} break;
 		case lskSavedGifsOld: {
 			quint64 key;
 			map.stream >> key;
 		} break;
 		case lskSavedGifs: {
-			map.stream >> savedGifsKey;
+			map.stream >> result.savedGifsKey;
 		} break;
 		case lskSavedPeersOld: {
 			quint64 key;
 			map.stream >> key;
 		} break;
 		case lskExportSettings: {
-			map.stream >> exportSettingsKey;
+			map.stream >> result.exportSettingsKey;
 		} break;
 		case lskMasksKeys: {
 			map.stream
-				>> installedMasksKey
-				>> recentMasksKey
-				>> archivedMasksKey;
+				>> result.installedMasksKey
+				>> result.recentMasksKey
+				>> result.archivedMasksKey;
 		} break;
 		case lskCustomEmojiKeys: {
 			map.stream
-				>> installedCustomEmojiKey
-				>> featuredCustomEmojiKey
-				>> archivedCustomEmojiKey;
+				>> result.installedCustomEmojiKey
+				>> result.featuredCustomEmojiKey
+				>> result.archivedCustomEmojiKey;
 		} break;
 		case lskSearchSuggestions: {
-			map.stream >> searchSuggestionsKey;
+			map.stream >> result.searchSuggestionsKey;
 		} break;
 		case lskRoundPlaceholder: {
-			map.stream >> roundPlaceholderKey;
+			map.stream >> result.roundPlaceholderKey;
 		} break;
 		case lskInlineBotsDownloads: {
-			map.stream >> inlineBotsDownloadsKey;
+			map.stream >> result.inlineBotsDownloadsKey;
 		} break;
 		case lskMediaLastPlaybackPositions: {
-			map.stream >> mediaLastPlaybackPositionsKey;
+			map.stream >> result.mediaLastPlaybackPositionsKey;
+		} break;
+		case lskPartialDownloads: {
+			map.stream >> result.partialDownloadsKey;
 		} break;
 		case lskWebviewTokens: {
 			map.stream
-				>> webviewStorageTokenBots
-				>> webviewStorageTokenOther;
+				>> result.webviewStorageTokenBots
+				>> result.webviewStorageTokenOther;
 		} break;
 		case lskBotStorages: {
 			quint32 count = 0;
@@ -496,8 +665,8 @@ Account::ReadMapResult Account::readMapWith(
 				quint64 peerIdSerialized;
 				map.stream >> key >> peerIdSerialized;
 				const auto peerId = DeserializePeerId(peerIdSerialized);
-				botStoragesMap.emplace(peerId, key);
-				botStoragesNotReadMap.emplace(peerId, true);
+				result.botStoragesMap.emplace(peerId, key);
+				result.botStoragesNotReadMap.emplace(peerId, true);
 			}
 		} break;
 		default:
@@ -509,42 +678,78 @@ Account::ReadMapResult Account::readMapWith(
 		}
 	}
 
-	_localKey = std::move(localKey);
+	result.localKey = std::move(localKey);
+	return ReadMapResult::Success;
+}
+
+Account::ReadMapResult Account::readMapWith(
+		MTP::AuthKeyPtr localKey,
+		const QByteArray &legacyPasscode) {
+	auto ms = crl::now();
+
+	auto map = ReadMap();
+	const auto result = ReadMapFile(
+		map,
+		_basePath,
+		std::move(localKey),
+		legacyPasscode);
+	if (result != ReadMapResult::Success) {
+		return result;
+	}
+	applyMap(std::move(map));
+
+	LOG(("Map read time: %1").arg(crl::now() - ms));
+
+	return ReadMapResult::Success;
+}
 
-	_draftsMap = draftsMap;
-	_draftCursorsMap = draftCursorsMap;
-	_draftsNotReadMap = draftsNotReadMap;
-	_botStoragesMap = botStoragesMap;
-	_botStoragesNotReadMap = botStoragesNotReadMap;
-
-	_prefsKey = prefsKey;
-	_locationsKey = locationsKey;
-	_trustedPeersKey = trustedPeersKey;
-	_recentStickersKeyOld = recentStickersKeyOld;
-	_installedStickersKey = installedStickersKey;
-	_featuredStickersKey = featuredStickersKey;
-	_recentStickersKey = recentStickersKey;
-	_favedStickersKey = favedStickersKey;
-	_archivedStickersKey = archivedStickersKey;
-	_savedGifsKey = savedGifsKey;
-	_installedMasksKey = installedMasksKey;
-	_recentMasksKey = recentMasksKey;
-	_archivedMasksKey = archivedMasksKey;
-	_installedCustomEmojiKey = installedCustomEmojiKey;
-	_featuredCustomEmojiKey = featuredCustomEmojiKey;
-	_archivedCustomEmojiKey = archivedCustomEmojiKey;
-	_legacyBackgroundKeyDay = legacyBackgroundKeyDay;
-	_legacyBackgroundKeyNight = legacyBackgroundKeyNight;
-	_settingsKey = userSettingsKey;
-	_recentHashtagsAndBotsKey = recentHashtagsAndBotsKey;
-	_exportSettingsKey = exportSettingsKey;
-	_searchSuggestionsKey = searchSuggestionsKey;
-	_roundPlaceholderKey = roundPlaceholderKey;
-	_inlineBotsDownloadsKey = inlineBotsDownloadsKey;
-	_mediaLastPlaybackPositionsKey = mediaLastPlaybackPositionsKey;
-	_oldMapVersion = mapData.version;
-	_webviewStorageIdBots.token = webviewStorageTokenBots;
-	_webviewStorageIdOther.token = webviewStorageTokenOther;
+void Account::applyMap(ReadMap &&map) {
+	if (map.reportSpamStatusesKey) {
+		ClearKey(map.reportSpamStatusesKey, _basePath);
+	}
+	if (map.legacyBackgroundKeyOldOld) {
+		(Window::Theme::IsNightMode()
+			? map.legacyBackgroundKeyNight
+			: map.legacyBackgroundKeyDay) = map.legacyBackgroundKeyOldOld;
+	}
+
+	_localKey = std::move(map.localKey);
+
+	_draftsMap = std::move(map.draftsMap);
+	_draftCursorsMap = std::move(map.draftCursorsMap);
+	_draftsNotReadMap = std::move(map.draftsNotReadMap);
+	_botStoragesMap = std::move(map.botStoragesMap);
+	_botStoragesNotReadMap = std::move(map.botStoragesNotReadMap);
+
+	_prefsKey = map.prefsKey;
+	_locationsKey = map.locationsKey;
+	_trustedPeersKey = map.trustedPeersKey;
+	_recentStickersKeyOld = map.recentStickersKeyOld;
+	_installedStickersKey = map.installedStickersKey;
+	_featuredStickersKey = map.featuredStickersKey;
+	_recentStickersKey = map.recentStickersKey;
+	_favedStickersKey = map.favedStickersKey;
+	_archivedStickersKey = map.archivedStickersKey;
+	_savedGifsKey = map.savedGifsKey;
+	_installedMasksKey = map.installedMasksKey;
+	_recentMasksKey = map.recentMasksKey;
+	_archivedMasksKey = map.archivedMasksKey;
+	_installedCustomEmojiKey = map.installedCustomEmojiKey;
+	_featuredCustomEmojiKey = map.featuredCustomEmojiKey;
+	_archivedCustomEmojiKey = map.archivedCustomEmojiKey;
+	_legacyBackgroundKeyDay = map.legacyBackgroundKeyDay;
+	_legacyBackgroundKeyNight = map.legacyBackgroundKeyNight;
+	_settingsKey = map.userSettingsKey;
+	_recentHashtagsAndBotsKey = map.recentHashtagsAndBotsKey;
+	_exportSettingsKey = map.exportSettingsKey;
+	_searchSuggestionsKey = map.searchSuggestionsKey;
+	_roundPlaceholderKey = map.roundPlaceholderKey;
+	_inlineBotsDownloadsKey = map.inlineBotsDownloadsKey;
+	_mediaLastPlaybackPositionsKey = map.mediaLastPlaybackPositionsKey;
+	_partialDownloadsKey = map.partialDownloadsKey;
+	_oldMapVersion = map.version;
+	_webviewStorageIdBots.token = map.webviewStorageTokenBots;
+	_webviewStorageIdOther.token = map.webviewStorageTokenOther;
 
 	if (_oldMapVersion < AppVersion) {
 		writeMapDelayed();
@@ -569,15 +774,11 @@ Account::ReadMapResult Account::readMapWith(
 	auto stored = readSessionSettings();
 	readMtpData();
 
-	DEBUG_LOG(("selfSerialized set: %1").arg(selfSerialized.size()));
+	DEBUG_LOG(("selfSerialized set: %1").arg(map.selfSerialized.size()));
 	_owner->setSessionFromStorage(
 		std::move(stored),
-		std::move(selfSerialized),
+		std::move(map.selfSerialized),
 		_oldMapVersion);
-
-	LOG(("Map read time: %1").arg(crl::now() - ms));
-
-	return ReadMapResult::Success;
 }
 
 void Account::writeMapDelayed() {
@@ -601,6 +802,7 @@ void Account::writeMap() {
 	}
 	_mapChanged = false;
 
+	const auto trace = Core::Tracing::Scope("storage", "writeMap");
 	if (!QDir().exists(_basePath)) {
 		QDir().mkpath(_basePath);
 	}
@@ -663,6 +865,7 @@ void Account::writeMap() {
 	if (_roundPlaceholderKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (_inlineBotsDownloadsKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (_mediaLastPlaybackPositionsKey) mapSize += sizeof(quint32) + sizeof(quint64);
+	if (_partialDownloadsKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (!_botStoragesMap.empty()) mapSize += sizeof(quint32) * 2 + _botStoragesMap.size() * sizeof(quint64) * 2;
 
 	EncryptedDescriptor mapData(mapSize);
@@ -749,6 +952,10 @@ void Account::writeMap() {
 		mapData.stream << quint32(lskMediaLastPlaybackPositions);
 		mapData.stream << quint64(_mediaLastPlaybackPositionsKey);
 	}
+	if (_partialDownloadsKey) {
+		mapData.stream << quint32(lskPartialDownloads);
+		mapData.stream << quint64(_partialDownloadsKey);
+	}
 	if (!_botStoragesMap.empty()) {
 		mapData.stream << quint32(lskBotStorages) << quint32(_botStoragesMap.size());
 		for (const auto &[key, value] : _botStoragesMap) {
@@ -789,10 +996,14 @@ void Account::reset() {
 	_roundPlaceholderKey = 0;
 	_inlineBotsDownloadsKey = 0;
 	_mediaLastPlaybackPositionsKey = 0;
+	_partialDownloadsKey = 0;
 	_oldMapVersion = 0;
 	_fileLocations.clear();
 	_fileLocationPairs.clear();
 	_fileLocationAliases.clear();
+	_locationsChangedKeys.clear();
+	_aliasesChangedKeys.clear();
+	_locationsBaseId = 0;
 	_downloadsSerialize = nullptr;
 	_downloadsSerialized = QByteArray();
 	_cacheTotalSizeLimit = Database::Settings().totalSizeLimit;
@@ -800,6 +1011,7 @@ void Account::reset() {
 	_cacheBigFileTotalSizeLimit = Database::Settings().totalSizeLimit;
 	_cacheBigFileTotalTimeLimit = Database::Settings().totalTimeLimit;
 	_mediaLastPlaybackPosition.clear();
+	_partialDownloads.clear();
 
 	const auto wvbots = _webviewStorageIdBots.path;
 	const auto wvother = _webviewStorageIdOther.path;
@@ -857,7 +1069,9 @@ void Account::writeLocations() {
 	if (_fileLocations.isEmpty() && _downloadsSerialized.isEmpty()) {
 		if (_locationsKey) {
 			ClearKey(_locationsKey, _basePath);
+			QFile::remove(JournalPath(_basePath, _locationsKey));
 			_locationsKey = 0;
+			_locationsBaseId = 0;
 			writeMapDelayed();
 		}
 	} else {
@@ -865,59 +1079,267 @@ void Account::writeLocations() {
 			_locationsKey = GenerateKey(_basePath);
 			writeMapQueued();
 		}
-		quint32 size = 0;
-		for (auto i = _fileLocations.cbegin(), e = _fileLocations.cend(); i != e; ++i) {
-			// location + type + namelen + name
-			size += sizeof(quint64) * 2 + sizeof(quint32) + Serialize::stringSize(i.value().name());
-			if (AppVersion > 9013) {
-				// bookmark
-				size += Serialize::bytearraySize(i.value().bookmark());
-			}
-			// date + size
-			size += Serialize::dateTimeSize() + sizeof(quint32);
+		if (!appendLocationsJournal()) {
+			writeLocationsBase();
 		}
+	}
+	_locationsChangedKeys.clear();
+	_aliasesChangedKeys.clear();
+}
+
+void Account::writeLocationsBase() {
+	_locationsBaseId = base::RandomValue<uint64>();
+	_locationsJournalSize = 0;
+	_downloadsHash = XXH64(
+		_downloadsSerialized.constData(),
+		_downloadsSerialized.size(),
+		0);
 
-		//end mark
-		size += sizeof(quint64) * 2 + sizeof(quint32) + Serialize::stringSize(QString());
+	quint32 size = 0;
+	for (auto i = _fileLocations.cbegin(), e = _fileLocations.cend(); i != e; ++i) {
+		// location + type + namelen + name
+		size += sizeof(quint64) * 2 + sizeof(quint32) + Serialize::stringSize(i.value().name());
 		if (AppVersion > 9013) {
-			size += Serialize::bytearraySize(QByteArray());
+			// bookmark
+			size += Serialize::bytearraySize(i.value().bookmark());
 		}
+		// date + size
 		size += Serialize::dateTimeSize() + sizeof(quint32);
+	}
 
-		size += sizeof(quint32); // aliases count
-		for (auto i = _fileLocationAliases.cbegin(), e = _fileLocationAliases.cend(); i != e; ++i) {
-			// alias + location
-			size += sizeof(quint64) * 2 + sizeof(quint64) * 2;
-		}
+	//end mark
+	size += sizeof(quint64) * 2 + sizeof(quint32) + Serialize::stringSize(QString());
+	if (AppVersion > 9013) {
+		size += Serialize::bytearraySize(QByteArray());
+	}
+	size += Serialize::dateTimeSize() + sizeof(quint32);
 
-		size += sizeof(quint32); // legacy webLocationsCount
-		size += Serialize::bytearraySize(_downloadsSerialized);
+	size += sizeof(quint32); // aliases count
+	for (auto i = _fileLocationAliases.cbegin(), e = _fileLocationAliases.cend(); i != e; ++i) {
+		// alias + location
+		size += sizeof(quint64) * 2 + sizeof(quint64) * 2;
+	}
 
-		EncryptedDescriptor data(size);
-		auto legacyTypeField = 0;
-		for (auto i = _fileLocations.cbegin(); i != _fileLocations.cend(); ++i) {
-			data.stream << quint64(i.key().first) << quint64(i.key().second) << quint32(legacyTypeField) << i.value().name();
-			if (AppVersion > 9013) {
-				data.stream << i.value().bookmark();
-			}
-			data.stream << i.value().modified << quint32(i.value().size);
-		}
+	size += sizeof(quint32); // legacy webLocationsCount
+	size += Serialize::bytearraySize(_downloadsSerialized);
+	size += sizeof(quint64); // base id
 
-		data.stream << quint64(0) << quint64(0) << quint32(0) << QString();
+	EncryptedDescriptor data(size);
+	auto legacyTypeField = 0;
+	for (auto i = _fileLocations.cbegin(); i != _fileLocations.cend(); ++i) {
+		data.stream << quint64(i.key().first) << quint64(i.key().second) << quint32(legacyTypeField) << i.value().name();
 		if (AppVersion > 9013) {
-			data.stream << QByteArray();
+			data.stream << i.value().bookmark();
 		}
-		data.stream << QDateTime::currentDateTime() << quint32(0);
+		data.stream << i.value().modified << quint32(i.value().size);
+	}
 
-		data.stream << quint32(_fileLocationAliases.size());
-		for (auto i = _fileLocationAliases.cbegin(), e = _fileLocationAliases.cend(); i != e; ++i) {
-			data.stream << quint64(i.key().first) << quint64(i.key().second) << quint64(i.value().first) << quint64(i.value().second);
-		}
+	data.stream << quint64(0) << quint64(0) << quint32(0) << QString();
+	if (AppVersion > 9013) {
+		data.stream << QByteArray();
+	}
+	data.stream << QDateTime::currentDateTime() << quint32(0);
 
-		data.stream << quint32(0) << _downloadsSerialized;
+	data.stream << quint32(_fileLocationAliases.size());
+	for (auto i = _fileLocationAliases.cbegin(), e = _fileLocationAliases.cend(); i != e; ++i) {
+		data.stream << quint64(i.key().first) << quint64(i.key().second) << quint64(i.value().first) << quint64(i.value().second);
+	}
 
-		FileWriteDescriptor file(_locationsKey, _basePath);
-		file.writeEncrypted(data, _localKey);
+	data.stream << quint32(0) << _downloadsSerialized;
+	data.stream << quint64(_locationsBaseId);
+
+	_locationsBaseSize = size;
+
+	FileWriteDescriptor file(_locationsKey, _basePath);
+	file.writeEncrypted(data, _localKey);
+
+	QFile::remove(JournalPath(_basePath, _locationsKey));
+}
+
+// The locations file has a random id at the end and is followed by
+// a journal file of records, each encrypted separately: all locations
+// of the keys changed since the file or the previous record were written,
+// the changed aliases and the downloads, if they changed.
+bool Account::appendLocationsJournal() {
+	if (!_locationsBaseId) {
+		return false;
+	}
+	const auto downloadsHash = XXH64(
+		_downloadsSerialized.constData(),
+		_downloadsSerialized.size(),
+		0);
+	const auto downloadsChanged = (downloadsHash != _downloadsHash);
+	if (_locationsChangedKeys.empty()
+		&& _aliasesChangedKeys.empty()
+		&& !downloadsChanged) {
+		return true;
+	}
+
+	// baseId + version + keysCount + aliasesCount + hasDownloads
+	quint32 size = sizeof(quint64) + sizeof(qint32) * 4;
+	for (const auto &key : _locationsChangedKeys) {
+		// location + count
+		size += sizeof(quint64) * 2 + sizeof(quint32);
+		for (auto i = _fileLocations.find(key)
+			; (i != _fileLocations.end()) && (i.key() == key)
+			; ++i) {
+			// name + bookmark + date + size
+			size += Serialize::stringSize(i.value().name())
+				+ Serialize::bytearraySize(i.value().bookmark())
+				+ Serialize::dateTimeSize()
+				+ sizeof(quint32);
+		}
+	}
+	// alias + exists + location
+	size += (sizeof(quint64) * 4 + sizeof(qint32))
+		* _aliasesChangedKeys.size();
+	if (downloadsChanged) {
+		size += Serialize::bytearraySize(_downloadsSerialized);
+	}
+
+	EncryptedDescriptor data(size);
+	data.stream
+		<< quint64(_locationsBaseId)
+		<< qint32(AppVersion)
+		<< qint32(_locationsChangedKeys.size());
+	for (const auto &key : _locationsChangedKeys) {
+		const auto count = _fileLocations.count(key);
+		data.stream
+			<< quint64(key.first)
+			<< quint64(key.second)
+			<< quint32(count);
+		for (auto i = _fileLocations.find(key)
+			; (i != _fileLocations.end()) && (i.key() == key)
+			; ++i) {
+			data.stream
+				<< i.value().name()
+				<< i.value().bookmark()
+				<< i.value().modified
+				<< quint32(i.value().size);
+		}
+	}
+	data.stream << qint32(_aliasesChangedKeys.size());
+	for (const auto &key : _aliasesChangedKeys) {
+		const auto i = _fileLocationAliases.constFind(key);
+		const auto exists = (i != _fileLocationAliases.cend());
+		const auto value = exists ? i.value() : MediaKey();
+		data.stream
+			<< quint64(key.first)
+			<< quint64(key.second)
+			<< qint32(exists ? 1 : 0)
+			<< quint64(value.first)
+			<< quint64(value.second);
+	}
+	data.stream << qint32(downloadsChanged ? 1 : 0);
+	if (downloadsChanged) {
+		data.stream << _downloadsSerialized;
+	}
+	const auto encrypted = PrepareEncrypted(data, _localKey);
+	const auto limit = std::max(
+		kMinLocationsJournalSize,
+		_locationsBaseSize / 2);
+	if (_locationsJournalSize + encrypted.size() > limit
+		|| !AppendJournal(JournalPath(_basePath, _locationsKey), encrypted)) {
+		return false;
+	}
+	_locationsJournalSize += JournalRecordSize(encrypted);
+	_downloadsHash = downloadsHash;
+	return true;
+}
+
+void Account::readLocationsJournal(int32 version) {
+	const auto apply = [&](EncryptedDescriptor &record) {
+		quint64 baseId = 0;
+		qint32 recordVersion = 0, keysCount = 0;
+		record.stream >> baseId >> recordVersion >> keysCount;
+		if (baseId != _locationsBaseId
+			|| recordVersion != version
+			|| keysCount < 0) {
+			return false;
+		}
+		auto locations = std::vector<std::pair<MediaKey, Core::FileLocation>>();
+		auto keys = std::vector<MediaKey>();
+		keys.reserve(keysCount);
+		for (auto i = 0; i != keysCount; ++i) {
+			quint64 first = 0, second = 0;
+			quint32 count = 0;
+			record.stream >> first >> second >> count;
+			if (!CheckStreamStatus(record.stream)) {
+				return false;
+			}
+			const auto key = MediaKey(first, second);
+			keys.push_back(key);
+			for (auto j = quint32(); j != count; ++j) {
+				QByteArray bookmark;
+				Core::FileLocation loc;
+				quint32 size = 0;
+				record.stream >> loc.fname >> bookmark >> loc.modified >> size;
+				if (!CheckStreamStatus(record.stream)) {
+					return false;
+				}
+				loc.setBookmark(bookmark);
+				loc.size = int64(size);
+				locations.emplace_back(key, std::move(loc));
+			}
+		}
+		qint32 aliasesCount = 0;
+		record.stream >> aliasesCount;
+		if (!CheckStreamStatus(record.stream) || aliasesCount < 0) {
+			return false;
+		}
+		auto aliases = std::vector<std::pair<MediaKey, std::optional<MediaKey>>>();
+		aliases.reserve(aliasesCount);
+		for (auto i = 0; i != aliasesCount; ++i) {
+			quint64 kfirst = 0, ksecond = 0, vfirst = 0, vsecond = 0;
+			qint32 exists = 0;
+			record.stream >> kfirst >> ksecond >> exists >> vfirst >> vsecond;
+			aliases.emplace_back(
+				MediaKey(kfirst, ksecond),
+				(exists
+					? std::make_optional(MediaKey(vfirst, vsecond))
+					: std::nullopt));
+		}
+		qint32 hasDownloads = 0;
+		record.stream >> hasDownloads;
+		auto downloads = QByteArray();
+		if (hasDownloads) {
+			record.stream >> downloads;
+		}
+		if (!CheckStreamStatus(record.stream)) {
+			return false;
+		}
+
+		for (const auto &key : keys) {
+			_fileLocations.remove(key);
+		}
+		for (auto &[key, loc] : locations) {
+			_fileLocations.insert(key, std::move(loc));
+		}
+		for (const auto &[key, value] : aliases) {
+			if (value) {
+				_fileLocationAliases.insert(key, *value);
+			} else {
+				_fileLocationAliases.remove(key);
+			}
+		}
+		if (hasDownloads) {
+			_downloadsSerialized = std::move(downloads);
+		}
+		return true;
+	};
+	const auto path = JournalPath(_basePath, _locationsKey);
+	const auto good = ReadJournal(path, _localKey, _locationsJournalSize, apply);
+	if (!good || version != AppVersion) {
+		// Records of different versions can't be mixed in one journal.
+		_locationsBaseId = 0;
+	}
+	if (_locationsJournalSize > 0) {
+		_fileLocationPairs.clear();
+		for (auto i = _fileLocations.cbegin(); i != _fileLocations.cend(); ++i) {
+			if (!i.value().inMediaCache()) {
+				_fileLocationPairs.insert(i.value().fname, { i.key(), i.value() });
+			}
+		}
 	}
 }
 
@@ -935,8 +1357,9 @@ void Account::writeLocationsDelayed() {
 
 void Account::readLocations() {
 	FileReadDescriptor locations;
-	if (!ReadEncryptedFile(locations, _locationsKey, _basePath, _localKey)) {
+	if (!readStartFile(locations, ToFilePart(_locationsKey), _basePath)) {
 		ClearKey(_locationsKey, _basePath);
+		QFile::remove(JournalPath(_basePath, _locationsKey));
 		_locationsKey = 0;
 		writeMapDelayed();
 		return;
@@ -993,8 +1416,24 @@ void Account::readLocations() {
 			if (!locations.stream.atEnd()) {
 				locations.stream >> _downloadsSerialized;
 			}
+			if (!locations.stream.atEnd()) {
+				quint64 baseId = 0;
+				locations.stream >> baseId;
+				if (CheckStreamStatus(locations.stream)) {
+					_locationsBaseId = baseId;
+				}
+			}
 		}
 	}
+	_locationsJournalSize = 0;
+	_locationsBaseSize = int(locations.data.size());
+	_downloadsHash = XXH64(
+		_downloadsSerialized.constData(),
+		_downloadsSerialized.size(),
+		0);
+	if (_locationsBaseId) {
+		readLocationsJournal(locations.version);
+	}
 }
 
 void Account::updateDownloads(
@@ -1069,7 +1508,7 @@ ReadSettingsContext Account::prepareReadSettingsContext() const {
 std::unique_ptr<Main::SessionSettings> Account::readSessionSettings() {
 	ReadSettingsContext context;
 	FileReadDescriptor userSettings;
-	if (!ReadEncryptedFile(userSettings, _settingsKey, _basePath, _localKey)) {
+	if (!readStartFile(userSettings, ToFilePart(_settingsKey), _basePath)) {
 		LOG(("App Info: could not read encrypted user settings..."));
 
 		Local::readOldUserSettings(true, context);
@@ -1158,7 +1597,7 @@ void Account::readMtpData() {
 	auto context = prepareReadSettingsContext();
 
 	FileReadDescriptor mtp;
-	if (!ReadEncryptedFile(mtp, ToFilePart(_dataNameKey), BaseGlobalPath(), _localKey)) {
+	if (!readStartFile(mtp, ToFilePart(_dataNameKey), BaseGlobalPath())) {
 		if (_localKey) {
 			Local::readOldMtpData(true, context);
 			applyReadContext(std::move(context));
@@ -1198,7 +1637,7 @@ std::unique_ptr<MTP::Config> Account::readMtpConfig() {
 	Expects(_localKey != nullptr);
 
 	FileReadDescriptor file;
-	if (!ReadEncryptedFile(file, "config", _basePath, _localKey)) {
+	if (!readStartFile(file, u"config"_q, _basePath)) {
 		return nullptr;
 	}
 
@@ -1764,6 +2203,7 @@ void Account::writeFileLocation(MediaKey location, const Core::FileLocation &loc
 			if (i.value().second == local) {
 				if (i.value().first != location) {
 					_fileLocationAliases.insert(location, i.value().first);
+					_aliasesChangedKeys.emplace(location);
 					writeLocationsQueued();
 				}
 				return;
@@ -1775,6 +2215,7 @@ void Account::writeFileLocation(MediaKey location, const Core::FileLocation &loc
 						break;
 					}
 				}
+				_locationsChangedKeys.emplace(i.value().first);
 				_fileLocationPairs.erase(i);
 			}
 		}
@@ -1788,6 +2229,7 @@ void Account::writeFileLocation(MediaKey location, const Core::FileLocation &loc
 		}
 	}
 	_fileLocations.insert(location, local);
+	_locationsChangedKeys.emplace(location);
 	writeLocationsQueued();
 }
 
@@ -1799,6 +2241,7 @@ void Account::removeFileLocation(MediaKey location) {
 	while (i != _fileLocations.end() && (i.key() == location)) {
 		i = _fileLocations.erase(i);
 	}
+	_locationsChangedKeys.emplace(location);
 	writeLocationsQueued();
 }
 
@@ -1812,6 +2255,7 @@ Core::FileLocation Account::readFileLocation(MediaKey location) {
 		if (!i.value().inMediaCache() && !i.value().check()) {
 			_fileLocationPairs.remove(i.value().fname);
 			i = _fileLocations.erase(i);
+			_locationsChangedKeys.emplace(location);
 			writeLocationsDelayed();
 			continue;
 		}
@@ -1842,6 +2286,7 @@ Cache::Database::Settings Account::cacheSettings() const {
 	result.totalSizeLimit = _cacheTotalSizeLimit;
 	result.totalTimeLimit = _cacheTotalTimeLimit;
 	result.maxDataSize = kMaxFileInMemory;
+	ApplyCacheMaintenance(result);
 	return result;
 }
 
@@ -1878,6 +2323,7 @@ Cache::Database::Settings Account::cacheBigFileSettings() const {
 	result.totalSizeLimit = _cacheBigFileTotalSizeLimit;
 	result.totalTimeLimit = _cacheBigFileTotalTimeLimit;
 	result.maxDataSize = kMaxFileInMemory;
+	ApplyCacheMaintenance(result);
 	return result;
 }
 
@@ -1940,22 +2386,19 @@ void Account::writeStickerSets(
 		FileKey &stickersKey,
 		CheckSet checkSet,
 		const Data::StickersSetsOrder &order) {
-	using SetFlag = Data::StickersSetFlag;
-
+	_prefetched.remove(stickersKey);
 	const auto &sets = _owner->session().data().stickers().sets();
 	if (sets.empty()) {
 		if (stickersKey) {
 			ClearKey(stickersKey, _basePath);
+			clearStickersJournal(stickersKey);
 			stickersKey = 0;
 			writeMapDelayed();
 		}
 		return;
 	}
 
-	// versionTag + version + count
-	quint32 size = sizeof(quint32) + sizeof(qint32) + sizeof(qint32);
-
-	int32 setsCount = 0;
+	auto chunks = base::flat_map<uint64, QByteArray>();
 	for (const auto &[id, set] : sets) {
 		const auto raw = set.get();
 		auto result = checkSet(*raw);
@@ -1964,78 +2407,298 @@ void Account::writeStickerSets(
 		} else if (result == StickerSetCheckResult::Skip) {
 			continue;
 		}
-
-		// id
-		// + accessHash
-		// + hash
-		// + title
-		// + shortName
-		// + stickersCount
-		// + flags
-		// + installDate
-		// + thumbnailDocumentId
-		// + thumbnailType
-		// + thumbnailLocation
-		size += sizeof(quint64) * 3
-			+ Serialize::stringSize(raw->title)
-			+ Serialize::stringSize(raw->shortName)
-			+ sizeof(qint32) * 3
-			+ sizeof(quint64)
-			+ sizeof(qint32)
-			+ Serialize::imageLocationSize(raw->thumbnailLocation());
-		if (raw->flags & SetFlag::NotLoaded) {
-			continue;
-		}
-
-		for (const auto sticker : std::as_const(raw->stickers)) {
-			size += Serialize::Document::sizeInStream(sticker);
+		auto chunk = QByteArray();
+		{
+			QDataStream stream(&chunk, QIODevice::WriteOnly);
+			stream.setVersion(QDataStream::Qt_5_1);
+			writeStickerSet(stream, *raw);
 		}
-
-		size += sizeof(qint32); // datesCount
-		if (!raw->dates.empty()) {
-			Assert(raw->stickers.size() == raw->dates.size());
-			size += raw->dates.size() * sizeof(qint32);
+		if (!chunk.isEmpty()) {
+			chunks.emplace(id, std::move(chunk));
 		}
-
-		size += sizeof(qint32); // emojiCount
-		for (auto j = raw->emoji.cbegin(), e = raw->emoji.cend(); j != e; ++j) {
-			size += Serialize::stringSize(j->first->id()) + sizeof(qint32) + (j->second.size() * sizeof(quint64));
-		}
-
-		++setsCount;
 	}
-	if (!setsCount && order.isEmpty()) {
+	if (chunks.empty() && order.isEmpty()) {
 		if (stickersKey) {
 			ClearKey(stickersKey, _basePath);
+			clearStickersJournal(stickersKey);
 			stickersKey = 0;
 			writeMapDelayed();
 		}
 		return;
 	}
-	size += sizeof(qint32) + (order.size() * sizeof(quint64));
 
 	if (!stickersKey) {
 		stickersKey = GenerateKey(_basePath);
 		writeMapQueued();
 	}
+	if (!appendStickersJournal(stickersKey, chunks, order)) {
+		writeStickersBase(stickersKey, chunks, order);
+	}
+}
+
+// A sticker sets file of kStickersJournalVersion keeps each set as a byte
+// array and has a random id, followed by a journal file of records, each
+// encrypted separately: the sets changed and removed since the file or
+// the previous record were written and the new order, if it changed.
+// The journal is dropped by a full rewrite once it grows too large.
+void Account::writeStickersBase(
+		FileKey stickersKey,
+		const base::flat_map<uint64, QByteArray> &chunks,
+		const Data::StickersSetsOrder &order) {
+	auto &journal = _stickersJournals[stickersKey];
+	journal = StickersJournal{ .baseId = base::RandomValue<uint64>() };
+
+	// versionTag + version + baseId + count
+	quint32 size = sizeof(quint32)
+		+ sizeof(qint32)
+		+ sizeof(quint64)
+		+ sizeof(qint32);
+	for (const auto &[id, chunk] : chunks) {
+		size += sizeof(quint64) + Serialize::bytearraySize(chunk);
+		journal.hashes.emplace(id, StickersChunkHash(chunk));
+	}
+	size += sizeof(qint32) + (order.size() * sizeof(quint64));
+	journal.order = order;
+	journal.baseSize = size;
+
 	EncryptedDescriptor data(size);
 	data.stream
 		<< quint32(kStickersVersionTag)
-		<< qint32(kStickersSerializeVersion)
-		<< qint32(setsCount);
-	for (const auto &[id, set] : sets) {
-		auto result = checkSet(*set);
-		if (result == StickerSetCheckResult::Abort) {
-			return;
-		} else if (result == StickerSetCheckResult::Skip) {
-			continue;
-		}
-		writeStickerSet(data.stream, *set);
+		<< qint32(kStickersJournalVersion)
+		<< quint64(journal.baseId)
+		<< qint32(chunks.size());
+	for (const auto &[id, chunk] : chunks) {
+		data.stream << quint64(id) << chunk;
 	}
 	data.stream << order;
 
 	FileWriteDescriptor file(stickersKey, _basePath);
 	file.writeEncrypted(data, _localKey);
+
+	QFile::remove(JournalPath(_basePath, stickersKey));
+}
+
+bool Account::appendStickersJournal(
+		FileKey stickersKey,
+		const base::flat_map<uint64, QByteArray> &chunks,
+		const Data::StickersSetsOrder &order) {
+	const auto i = _stickersJournals.find(stickersKey);
+	if (i == end(_stickersJournals)) {
+		return false;
+	}
+	auto &journal = i->second;
+
+	auto changed = std::vector<std::pair<uint64, uint64>>();
+	for (const auto &[id, chunk] : chunks) {
+		const auto hash = StickersChunkHash(chunk);
+		const auto j = journal.hashes.find(id);
+		if (j == end(journal.hashes) || j->second != hash) {
+			changed.emplace_back(id, hash);
+		}
+	}
+	auto removed = std::vector<uint64>();
+	for (const auto &[id, hash] : journal.hashes) {
+		if (!chunks.contains(id)) {
+			removed.push_back(id);
+		}
+	}
+	const auto orderChanged = (order != journal.order);
+	if (changed.empty() && removed.empty() && !orderChanged) {
+		return true;
+	}
+
+	// baseId + version + changedCount + removedCount + hasOrder
+	quint32 size = sizeof(quint64) + sizeof(qint32) * 4;
+	for (const auto &[id, hash] : changed) {
+		size += sizeof(quint64) + Serialize::bytearraySize(chunks.at(id));
+	}
+	size += removed.size() * sizeof(quint64);
+	if (orderChanged) {
+		size += sizeof(qint32) + (order.size() * sizeof(quint64));
+	}
+	EncryptedDescriptor data(size);
+	data.stream
+		<< quint64(journal.baseId)
+		<< qint32(AppVersion)
+		<< qint32(changed.size());
+	for (const auto &[id, hash] : changed) {
+		data.stream << quint64(id) << chunks.at(id);
+	}
+	data.stream << qint32(removed.size());
+	for (const auto id : removed) {
+		data.stream << quint64(id);
+	}
+	data.stream << qint32(orderChanged ? 1 : 0);
+	if (orderChanged) {
+		data.stream << order;
+	}
+	const auto encrypted = PrepareEncrypted(data, _localKey);
+	const auto limit = std::max(kMinStickersJournalSize, journal.baseSize / 2);
+	if (journal.journalSize + encrypted.size() > limit) {
+		return false;
+	}
+
+	if (!AppendJournal(JournalPath(_basePath, stickersKey), encrypted)) {
+		return false;
+	}
+
+	for (const auto &[id, hash] : changed) {
+		journal.hashes[id] = hash;
+	}
+	for (const auto id : removed) {
+		journal.hashes.remove(id);
+	}
+	journal.order = order;
+	journal.journalSize += JournalRecordSize(encrypted);
+	return true;
+}
+
+void Account::clearStickersJournal(FileKey stickersKey) {
+	_stickersJournals.remove(stickersKey);
+	QFile::remove(JournalPath(_basePath, stickersKey));
+}
+
+bool Account::unpackStickerSets(
+		FileReadDescriptor &stickers,
+		FileKey stickersKey) {
+	const auto start = stickers.buffer.pos();
+	quint32 versionTag = 0;
+	qint32 version = 0;
+	stickers.stream >> versionTag >> version;
+	if (versionTag != kStickersVersionTag
+		|| version != kStickersJournalVersion) {
+		// Whole file of an older format, read as it is.
+		_stickersJournals.remove(stickersKey);
+		stickers.buffer.seek(start);
+		return true;
+	}
+	quint64 baseId = 0;
+	qint32 count = 0;
+	stickers.stream >> baseId >> count;
+	if (!CheckStreamStatus(stickers.stream)
+		|| (count < 0)
+		|| (count > kMaxSavedStickerSetsCount)) {
+		return false;
+	}
+	auto chunks = base::flat_map<uint64, QByteArray>();
+	for (auto i = 0; i != count; ++i) {
+		quint64 id = 0;
+		QByteArray chunk;
+		stickers.stream >> id >> chunk;
+		chunks.emplace(id, std::move(chunk));
+	}
+	auto order = Data::StickersSetsOrder();
+	stickers.stream >> order;
+	if (!CheckStreamStatus(stickers.stream)) {
+		return false;
+	}
+
+	auto &journal = _stickersJournals[stickersKey];
+	journal = StickersJournal{
+		.baseId = baseId,
+		.baseSize = int(stickers.data.size()),
+	};
+	readStickersJournal(
+		stickersKey,
+		stickers.version,
+		journal,
+		chunks,
+		order);
+	for (const auto &[id, chunk] : chunks) {
+		journal.hashes.emplace(id, StickersChunkHash(chunk));
+	}
+	journal.order = order;
+	if (stickers.version != AppVersion) {
+		// Chunks of different versions can't be mixed in one file.
+		_stickersJournals.remove(stickersKey);
+	}
+
+	// Put the result together in kStickersSerializeVersion for parsing.
+	auto data = QByteArray();
+	{
+		QDataStream stream(&data, QIODevice::WriteOnly);
+		stream.setVersion(QDataStream::Qt_5_1);
+		stream
+			<< quint32(kStickersVersionTag)
+			<< qint32(kStickersSerializeVersion)
+			<< qint32(chunks.size());
+		for (const auto &[id, chunk] : chunks) {
+			stream.writeRawData(chunk.constData(), chunk.size());
+		}
+		stream << order;
+	}
+	stickers.stream.setDevice(nullptr);
+	stickers.buffer.close();
+	stickers.data = std::move(data);
+	stickers.buffer.setBuffer(&stickers.data);
+	stickers.buffer.open(QIODevice::ReadOnly);
+	stickers.stream.setDevice(&stickers.buffer);
+	stickers.stream.setVersion(QDataStream::Qt_5_1);
+	return true;
+}
+
+void Account::readStickersJournal(
+		FileKey stickersKey,
+		int32 version,
+		StickersJournal &journal,
+		base::flat_map<uint64, QByteArray> &chunks,
+		Data::StickersSetsOrder &order) {
+	const auto apply = [&](EncryptedDescriptor &record) {
+		quint64 baseId = 0;
+		qint32 recordVersion = 0, changedCount = 0;
+		record.stream >> baseId >> recordVersion >> changedCount;
+		if (baseId != journal.baseId
+			|| recordVersion != version
+			|| changedCount < 0
+			|| changedCount > kMaxSavedStickerSetsCount) {
+			return false;
+		}
+		auto changed = base::flat_map<uint64, QByteArray>();
+		for (auto i = 0; i != changedCount; ++i) {
+			quint64 id = 0;
+			QByteArray chunk;
+			record.stream >> id >> chunk;
+			changed[id] = std::move(chunk);
+		}
+		qint32 removedCount = 0;
+		record.stream >> removedCount;
+		if (!CheckStreamStatus(record.stream)
+			|| removedCount < 0
+			|| removedCount > kMaxSavedStickerSetsCount) {
+			return false;
+		}
+		auto removed = std::vector<uint64>(removedCount);
+		for (auto &id : removed) {
+			quint64 value = 0;
+			record.stream >> value;
+			id = value;
+		}
+		qint32 hasOrder = 0;
+		record.stream >> hasOrder;
+		auto newOrder = Data::StickersSetsOrder();
+		if (hasOrder) {
+			record.stream >> newOrder;
+		}
+		if (!CheckStreamStatus(record.stream)) {
+			return false;
+		}
+
+		for (auto &[id, chunk] : changed) {
+			chunks[id] = std::move(chunk);
+		}
+		for (const auto id : removed) {
+			chunks.remove(id);
+		}
+		if (hasOrder) {
+			order = std::move(newOrder);
+		}
+		return true;
+	};
+	const auto path = JournalPath(_basePath, stickersKey);
+	if (!ReadJournal(path, _localKey, journal.journalSize, apply)) {
+		// The records after the bad one would be lost, so rewrite it all.
+		journal.journalSize = std::numeric_limits<int>::max() / 2;
+	}
 }
 
 void Account::readStickerSets(
@@ -2049,8 +2712,9 @@ void Account::readStickerSets(
 	}
 
 	FileReadDescriptor stickers;
-	if (!ReadEncryptedFile(stickers, stickersKey, _basePath, _localKey)) {
+	if (!readPrefetchedOrEncryptedFile(stickers, stickersKey)) {
 		ClearKey(stickersKey, _basePath);
+		clearStickersJournal(stickersKey);
 		stickersKey = 0;
 		writeMapDelayed();
 		return;
@@ -2058,8 +2722,12 @@ void Account::readStickerSets(
 
 	const auto failed = [&] {
 		ClearKey(stickersKey, _basePath);
+		clearStickersJournal(stickersKey);
 		stickersKey = 0;
 	};
+	if (!unpackStickerSets(stickers, stickersKey)) {
+		return failed();
+	}
 
 	auto &sets = _owner->session().data().stickers().setsRef();
 	if (outOrder) outOrder->clear();
@@ -2690,7 +3358,99 @@ void Account::readInstalledCustomEmoji() {
 		Data::StickersSetFlag::Installed);
 }
 
+void Account::prefetchStickersAndGifs(Fn<void()> done) {
+	const auto keys = {
+		_installedStickersKey,
+		_installedMasksKey,
+		_installedCustomEmojiKey,
+		_featuredStickersKey,
+		_featuredCustomEmojiKey,
+		_recentStickersKey,
+		_recentMasksKey,
+		_favedStickersKey,
+		_savedGifsKey,
+	};
+	const auto left = std::make_shared<int>(1);
+	const auto finish = [=] {
+		if (!--*left) {
+			done();
+		}
+	};
+	const auto weak = base::make_weak(_owner);
+	for (const auto key : keys) {
+		if (!key || _prefetched.contains(key)) {
+			continue;
+		}
+		_prefetched.emplace(key, std::nullopt);
+		++*left;
+		crl::async([=, basePath = _basePath, localKey = _localKey] {
+			const auto trace = Core::Tracing::Scope("async", "prefetch", key);
+			auto file = FileReadDescriptor();
+			auto result = std::optional<PrefetchedFile>();
+			if (ReadEncryptedFile(file, key, basePath, localKey)) {
+				result = PrefetchedFile{
+					.version = file.version,
+					.data = file.data,
+					.position = file.buffer.pos(),
+				};
+			}
+			crl::on_main(weak, [=, result = std::move(result)]() mutable {
+				const auto i = _prefetched.find(key);
+				if (i != end(_prefetched) && !i->second) {
+					if (result) {
+						i->second = std::move(result);
+					} else {
+						// Let the reading fail and clear the key as usual.
+						_prefetched.erase(i);
+					}
+				}
+				finish();
+			});
+		});
+	}
+	finish();
+}
+
+bool Account::readPrefetchedOrEncryptedFile(
+		FileReadDescriptor &result,
+		const FileKey &fkey) {
+	const auto i = _prefetched.find(fkey);
+	if (i == end(_prefetched) || !i->second) {
+		return ReadEncryptedFile(result, fkey, _basePath, _localKey);
+	}
+	auto prefetched = std::move(*i->second);
+	_prefetched.erase(i);
+
+	OpenPrefetched(
+		result,
+		prefetched.version,
+		std::move(prefetched.data),
+		prefetched.position);
+	return true;
+}
+
+bool Account::readStartFile(
+		FileReadDescriptor &result,
+		const QString &name,
+		const QString &basePath) {
+	const auto i = _startFiles.find(basePath + name);
+	if (i == end(_startFiles)) {
+		return ReadEncryptedFile(result, name, basePath, _localKey);
+	}
+	auto prefetched = std::move(i->second);
+	_startFiles.erase(i);
+
+	OpenPrefetched(
+		result,
+		prefetched.version,
+		std::move(prefetched.data),
+		prefetched.position);
+	return true;
+}
+
 void Account::writeSavedGifs() {
+	_prefetched.remove(_savedGifsKey);
+
 	const auto &saved = _owner->session().data().stickers().savedGifs();
 	if (saved.isEmpty()) {
 		if (_savedGifsKey) {
@@ -2726,7 +3486,7 @@ void Account::readSavedGifs() {
 	}
 
 	FileReadDescriptor gifs;
-	if (!ReadEncryptedFile(gifs, _savedGifsKey, _basePath, _localKey)) {
+	if (!readPrefetchedOrEncryptedFile(gifs, _savedGifsKey)) {
 		ClearKey(_savedGifsKey, _basePath);
 		_savedGifsKey = 0;
 		writeMapDelayed();
@@ -2942,6 +3702,8 @@ void Account::writeExportSettings(const Export::Settings &settings) {
 		&& settings.path == check.path
 		&& settings.format == check.format
 		&& settings.availableAt == check.availableAt
+		&& settings.onlyNewMessages == check.onlyNewMessages
+		&& settings.lastMessageIds.empty()
 		&& !settings.onlySinglePeer()) {
 		if (_exportSettingsKey) {
 			ClearKey(_exportSettingsKey, _basePath);
@@ -2956,7 +3718,9 @@ void Account::writeExportSettings(const Export::Settings &settings) {
 	}
 	quint32 size = sizeof(quint32) * 6
 		+ Serialize::stringSize(settings.path)
-		+ sizeof(qint32) * 2 + sizeof(quint64);
+		+ sizeof(qint32) * 2 + sizeof(quint64)
+		+ sizeof(qint32) * 2
+		+ settings.lastMessageIds.size() * (sizeof(quint64) + sizeof(qint32));
 	EncryptedDescriptor data(size);
 	data.stream
 		<< quint32(settings.types)
@@ -2989,6 +3753,12 @@ void Account::writeExportSettings(const Export::Settings &settings) {
 	});
 	data.stream << qint32(settings.singlePeerFrom);
 	data.stream << qint32(settings.singlePeerTill);
+	data.stream
+		<< qint32(settings.onlyNewMessages ? 1 : 0)
+		<< qint32(settings.lastMessageIds.size());
+	for (const auto &[peerId, messageId] : settings.lastMessageIds) {
+		data.stream << SerializePeerId(peerId) << qint32(messageId);
+	}
 
 	FileWriteDescriptor file(_exportSettingsKey, _basePath);
 	file.writeEncrypted(data, _localKey);
@@ -3015,6 +3785,8 @@ Export::Settings Account::readExportSettings() {
 	quint64 singlePeerBareId = 0;
 	quint64 singlePeerAccessHash = 0;
 	qint32 singlePeerFrom = 0, singlePeerTill = 0;
+	qint32 onlyNewMessages = 0, lastMessageIdsCount = 0;
+	auto lastMessageIds = base::flat_map<PeerId, int32>();
 	file.stream
 		>> types
 		>> fullChats
@@ -3045,6 +3817,18 @@ Export::Settings Account::readExportSettings() {
 	if (!file.stream.atEnd()) {
 		file.stream >> singlePeerFrom >> singlePeerTill;
 	}
+	if (!file.stream.atEnd()) {
+		file.stream >> onlyNewMessages >> lastMessageIdsCount;
+		for (auto i = 0; i != lastMessageIdsCount; ++i) {
+			auto peerId = quint64();
+			auto messageId = qint32();
+			file.stream >> peerId >> messageId;
+			if (file.stream.status() != QDataStream::Ok) {
+				return Export::Settings();
+			}
+			lastMessageIds.emplace(DeserializePeerId(peerId), messageId);
+		}
+	}
 	auto result = Export::Settings();
 	result.types = Export::Settings::Types::from_raw(types);
 	result.fullChats = Export::Settings::Types::from_raw(fullChats);
@@ -3085,6 +3869,8 @@ Export::Settings Account::readExportSettings() {
 	}();
 	result.singlePeerFrom = singlePeerFrom;
 	result.singlePeerTill = singlePeerTill;
+	result.onlyNewMessages = (onlyNewMessages == 1);
+	result.lastMessageIds = std::move(lastMessageIds);
 	return (file.stream.status() == QDataStream::Ok && result.validate())
 		? result
 		: Export::Settings();
@@ -3180,6 +3966,113 @@ void Account::readMediaLastPlaybackPositions() {
 	}
 }
 
+void Account::setPartialDownload(DocumentId id, PartialDownload download) {
+	readPartialDownloads();
+	auto &list = _partialDownloads;
+	const auto i = ranges::find(
+		list,
+		id,
+		&std::pair<DocumentId, PartialDownload>::first);
+	if (i != list.end()) {
+		if (download.path.isEmpty()) {
+			list.erase(i);
+		} else {
+			i->second = std::move(download);
+			std::rotate(i, i + 1, list.end());
+		}
+	} else if (!download.path.isEmpty()) {
+		if (list.size() >= kMaxPartialDownloads) {
+			// Nobody is going to resume it, don't leave the garbage.
+			QFile::remove(list.front().second.path);
+			list.erase(list.begin());
+		}
+		list.emplace_back(id, std::move(download));
+	} else {
+		return;
+	}
+	writePartialDownloads();
+}
+
+PartialDownload Account::partialDownload(DocumentId id) const {
+	const_cast<Account*>(this)->readPartialDownloads();
+	const auto i = ranges::find(
+		_partialDownloads,
+		id,
+		&std::pair<DocumentId, PartialDownload>::first);
+	return (i != _partialDownloads.end()) ? i->second : PartialDownload();
+}
+
+void Account::writePartialDownloads() {
+	if (_partialDownloads.empty()) {
+		if (_partialDownloadsKey) {
+			ClearKey(_partialDownloadsKey, _basePath);
+			_partialDownloadsKey = 0;
+			writeMapDelayed();
+		}
+		return;
+	}
+	if (!_partialDownloadsKey) {
+		_partialDownloadsKey = GenerateKey(_basePath);
+		writeMapQueued();
+	}
+	quint32 size = sizeof(quint32);
+	for (const auto &[id, download] : _partialDownloads) {
+		size += sizeof(quint64)
+			+ Serialize::stringSize(download.path)
+			+ sizeof(qint64)
+			+ Serialize::bytearraySize(download.parts);
+	}
+	EncryptedDescriptor data(size);
+	data.stream << quint32(_partialDownloads.size());
+	for (const auto &[id, download] : _partialDownloads) {
+		data.stream
+			<< quint64(id)
+			<< download.path
+			<< qint64(download.size)
+			<< download.parts;
+	}
+
+	FileWriteDescriptor file(_partialDownloadsKey, _basePath);
+	file.writeEncrypted(data, _localKey);
+}
+
+void Account::readPartialDownloads() {
+	if (_partialDownloadsRead) {
+		return;
+	}
+	_partialDownloadsRead = true;
+	if (!_partialDownloadsKey) {
+		return;
+	}
+
+	FileReadDescriptor file;
+	if (!ReadEncryptedFile(
+			file,
+			_partialDownloadsKey,
+			_basePath,
+			_localKey)) {
+		ClearKey(_partialDownloadsKey, _basePath);
+		_partialDownloadsKey = 0;
+		writeMapDelayed();
+		return;
+	}
+
+	quint32 count = 0;
+	file.stream >> count;
+	for (auto i = 0; i < count; ++i) {
+		quint64 id = 0;
+		auto download = PartialDownload();
+		qint64 size = 0;
+		file.stream >> id >> download.path >> size >> download.parts;
+		if (!CheckStreamStatus(file.stream)) {
+			_partialDownloads.clear();
+			return;
+		}
+		download.size = size;
+		_partialDownloads.emplace_back(DocumentId(id), std::move(download));
+	}
+}
+
 void Account::writeSearchSuggestionsDelayed() {
 	Expects(_owner->sessionExists());
 
@@ -3772,7 +4665,7 @@ void Account::writePrefs() {
 
 void Account::readPrefs() {
 	FileReadDescriptor prefs;
-	if (!ReadEncryptedFile(prefs, _prefsKey, _basePath, _localKey)) {
+	if (!readStartFile(prefs, ToFilePart(_prefsKey), _basePath)) {
 		ClearKey(_prefsKey, _basePath);
 		_prefsKey = 0;
 		writeMapDelayed();
@@ -63,12 +63,22 @@ struct MessageDraftSource {
 	Fn<MessageCursor()> cursor;
 };
 
+// A file download interrupted by a quit, kept on disk to be resumed.
+struct PartialDownload {
+	QString path;
+	int64 size = 0;
+	QByteArray parts; // A bit for each kDownloadPartSize part loaded.
+};
+
 class Account final {
 public:
 	Account(not_null<Main::Account*> owner, const QString &dataName);
 	~Account();
 
 	[[nodiscard]] StartResult legacyStart(const QByteArray &passcode);
+	// Reads and decrypts the map and the files start() needs on a worker
+	// thread, start() waits for it and only applies the results.
+	void prefetchStart(MTP::AuthKeyPtr localKey);
 	[[nodiscard]] std::unique_ptr<MTP::Config> start(
 		MTP::AuthKeyPtr localKey);
 	void startAdded(MTP::AuthKeyPtr localKey);
@@ -143,6 +153,10 @@ public:
 	void readInstalledCustomEmoji();
 	void readFeaturedCustomEmoji();
 
+	// Reads and decrypts the files of the sticker sets and saved GIFs
+	// in the background, so that the read*() methods above only parse.
+	void prefetchStickersAndGifs(Fn<void()> done);
+
 	void writeRecentHashtagsAndBots();
 	void readRecentHashtagsAndBots();
 	void saveRecentSentHashtags(const QString &text);
@@ -154,6 +168,10 @@ public:
 	void setMediaLastPlaybackPosition(DocumentId id, crl::time time);
 	[[nodiscard]] crl::time mediaLastPlaybackPosition(DocumentId id) const;
 
+	// An empty path forgets the download.
+	void setPartialDownload(DocumentId id, PartialDownload download);
+	[[nodiscard]] PartialDownload partialDownload(DocumentId id) const;
+
 	void writeSearchSuggestionsDelayed();
 	void writeSearchSuggestionsIfNeeded();
 	void writeSearchSuggestions();
@@ -238,16 +256,27 @@ private:
 	[[nodiscard]] auto prepareReadSettingsContext() const
 		-> details::ReadSettingsContext;
 
+	struct ReadMap;
+	struct StartPrefetch;
+	[[nodiscard]] static ReadMapResult ReadMapFile(
+		ReadMap &result,
+		const QString &basePath,
+		MTP::AuthKeyPtr localKey,
+		const QByteArray &legacyPasscode);
 	ReadMapResult readMapWith(
 		MTP::AuthKeyPtr localKey,
 		const QByteArray &legacyPasscode = QByteArray());
+	void applyMap(ReadMap &&map);
 	void clearLegacyFiles();
 	void writeMapDelayed();
 	void writeMapQueued();
 	void writeMap();
 
 	void readLocations();
+	void readLocationsJournal(int32 version);
 	void writeLocations();
+	void writeLocationsBase();
+	[[nodiscard]] bool appendLocationsJournal();
 	void writeLocationsQueued();
 	void writeLocationsDelayed();
 
@@ -287,6 +316,39 @@ private:
 		FileKey &stickersKey,
 		Data::StickersSetsOrder *outOrder = nullptr,
 		Data::StickersSetFlags readingFlags = 0);
+	bool readPrefetchedOrEncryptedFile(
+		FileReadDescriptor &result,
+		const FileKey &fkey);
+	bool readStartFile(
+		FileReadDescriptor &result,
+		const QString &name,
+		const QString &basePath);
+
+	struct StickersJournal {
+		uint64 baseId = 0;
+		base::flat_map<uint64, uint64> hashes; // Of the sets as written.
+		Data::StickersSetsOrder order;
+		int baseSize = 0;
+		int journalSize = 0;
+	};
+	void writeStickersBase(
+		FileKey stickersKey,
+		const base::flat_map<uint64, QByteArray> &chunks,
+		const Data::StickersSetsOrder &order);
+	bool appendStickersJournal(
+		FileKey stickersKey,
+		const base::flat_map<uint64, QByteArray> &chunks,
+		const Data::StickersSetsOrder &order);
+	void clearStickersJournal(FileKey stickersKey);
+	bool unpackStickerSets(
+		FileReadDescriptor &stickers,
+		FileKey stickersKey);
+	void readStickersJournal(
+		FileKey stickersKey,
+		int32 version,
+		StickersJournal &journal,
+		base::flat_map<uint64, QByteArray> &chunks,
+		Data::StickersSetsOrder &order);
 	void importOldRecentStickers();
 
 	void readTrustedPeers();
@@ -295,6 +357,9 @@ private:
 	void readMediaLastPlaybackPositions();
 	void writeMediaLastPlaybackPositions();
 
+	void readPartialDownloads();
+	void writePartialDownloads();
+
 	std::optional<RecentHashtagPack> saveRecentHashtags(
 		Fn<RecentHashtagPack()> getPack,
 		const QString &text);
@@ -330,6 +395,12 @@ private:
 	QMultiMap<MediaKey, Core::FileLocation> _fileLocations;
 	QMap<QString, QPair<MediaKey, Core::FileLocation>> _fileLocationPairs;
 	QMap<MediaKey, MediaKey> _fileLocationAliases;
+	base::flat_set<MediaKey> _locationsChangedKeys;
+	base::flat_set<MediaKey> _aliasesChangedKeys;
+	uint64 _locationsBaseId = 0;
+	int _locationsBaseSize = 0;
+	int _locationsJournalSize = 0;
+	uint64 _downloadsHash = 0;
 
 	QByteArray _downloadsSerialized;
 	Fn<std::optional<QByteArray>()> _downloadsSerialize;
@@ -359,6 +430,7 @@ private:
 	FileKey _roundPlaceholderKey = 0;
 	FileKey _inlineBotsDownloadsKey = 0;
 	FileKey _mediaLastPlaybackPositionsKey = 0;
+	FileKey _partialDownloadsKey = 0;
 
 	qint64 _cacheTotalSizeLimit = 0;
 	qint64 _cacheBigFileTotalSizeLimit = 0;
@@ -373,8 +445,24 @@ private:
 	bool _searchSuggestionsRead = false;
 	bool _inlineBotsDownloadsRead = false;
 	bool _mediaLastPlaybackPositionsRead = false;
+	bool _partialDownloadsRead = false;
+
+	struct PrefetchedFile {
+		int32 version = 0;
+		QByteArray data;
+		qint64 position = 0;
+	};
+	// Empty while still being read, dropped when the file is written.
+	base::flat_map<FileKey, std::optional<PrefetchedFile>> _prefetched;
+	// Read by prefetchStart(), by base path + file name, only during start().
+	base::flat_map<QString, PrefetchedFile> _startFiles;
+	std::shared_ptr<StartPrefetch> _startPrefetch;
+
+	// For the sticker sets files of kStickersJournalVersion.
+	base::flat_map<FileKey, StickersJournal> _stickersJournals;
 
 	std::vector<std::pair<DocumentId, crl::time>> _mediaLastPlaybackPosition;
+	std::vector<std::pair<DocumentId, PartialDownload>> _partialDownloads;
 
 	Webview::StorageId _webviewStorageIdBots;
 	Webview::StorageId _webviewStorageIdOther;
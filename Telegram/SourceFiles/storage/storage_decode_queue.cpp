@@ -0,0 +1,82 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "storage/storage_decode_queue.h"
+
+#include "core/core_tracing.h"
+
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+
+namespace Storage {
+namespace {
+
+constexpr auto kPriorities = 3;
+
+struct Queue {
+	QMutex mutex;
+	std::array<std::deque<FnMut<void()>>, kPriorities> tasks;
+	int running = 0;
+};
+
+[[nodiscard]] Queue &Instance() {
+	static auto result = Queue();
+	return result;
+}
+
+[[nodiscard]] int MaxRunning() {
+	static const auto result = std::clamp(
+		QThread::idealThreadCount() / 2,
+		1,
+		4);
+	return result;
+}
+
+void Drain() {
+	auto &queue = Instance();
+	while (true) {
+		auto task = FnMut<void()>();
+		{
+			QMutexLocker lock(&queue.mutex);
+			for (auto &list : queue.tasks) {
+				if (!list.empty()) {
+					task = std::move(list.front());
+					list.pop_front();
+					break;
+				}
+			}
+			if (!task) {
+				--queue.running;
+				return;
+			}
+		}
+		const auto trace = Core::Tracing::Scope("async", "decode");
+		task();
+	}
+}
+
+} // namespace
+
+void DecodeAsync(DecodePriority priority, FnMut<void()> task) {
+	Expects(task != nullptr);
+
+	auto &queue = Instance();
+	auto launch = false;
+	{
+		QMutexLocker lock(&queue.mutex);
+		queue.tasks[int(priority)].push_back(std::move(task));
+		if (queue.running < MaxRunning()) {
+			++queue.running;
+			launch = true;
+		}
+	}
+	if (launch) {
+		crl::async(Drain);
+	}
+}
+
+} // namespace Storage
@@ -0,0 +1,22 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Storage {
+
+enum class DecodePriority : uchar {
+	Visible, // Requested by something painted right now.
+	Near, // Will probably be painted soon.
+	Prefetch, // Automatic loading.
+};
+
+// Runs image decoding on a few background threads, the most urgent first.
+// Tasks should check their own guards, a cancelled one is just skipped.
+void DecodeAsync(DecodePriority priority, FnMut<void()> task);
+
+} // namespace Storage
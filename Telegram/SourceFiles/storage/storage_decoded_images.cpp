@@ -0,0 +1,112 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "storage/storage_decoded_images.h"
+
+#include "storage/cache/storage_cache_types.h"
+
+namespace Storage {
+namespace {
+
+// Entries are evicted in bunches, down to this part of the limit.
+constexpr auto kEvictTill = 0.75;
+
+[[nodiscard]] int64 ComputeSize(const DecodedImages::Image &image) {
+	return image.image.sizeInBytes() + image.bytes.size();
+}
+
+} // namespace
+
+DecodedImages::DecodedImages(int64 limit)
+: _limit(limit) {
+	Expects(limit > 0);
+}
+
+auto DecodedImages::get(const Cache::Key &key) -> std::optional<Image> {
+	const auto i = _entries.find(Id(key.high, key.low));
+	if (i == end(_entries)) {
+		++_stats.misses;
+		return std::nullopt;
+	}
+	++_stats.hits;
+	i->second.used = ++_uses;
+	return i->second.image;
+}
+
+void DecodedImages::put(const Cache::Key &key, Image image) {
+	const auto size = ComputeSize(image);
+	if (size > _limit / 4) {
+		remove(key);
+		return;
+	}
+	auto &entry = _entries[Id(key.high, key.low)];
+	_size += size - entry.size;
+	entry = Entry{
+		.image = std::move(image),
+		.size = size,
+		.used = ++_uses,
+	};
+	if (_size > _limit) {
+		evict(int64(_limit * kEvictTill));
+	}
+}
+
+void DecodedImages::remove(const Cache::Key &key) {
+	const auto i = _entries.find(Id(key.high, key.low));
+	if (i != end(_entries)) {
+		_size -= i->second.size;
+		_entries.erase(i);
+	}
+}
+
+void DecodedImages::clear() {
+	_entries.clear();
+	_size = 0;
+}
+
+void DecodedImages::shrink(float64 part) {
+	const auto till = int64(_limit * std::clamp(part, 0., 1.));
+	if (_size > till) {
+		evict(till);
+	}
+}
+
+void DecodedImages::evict(int64 till) {
+	auto uses = std::vector<std::pair<uint64, int64>>();
+	uses.reserve(_entries.size());
+	for (const auto &[id, entry] : _entries) {
+		uses.emplace_back(entry.used, entry.size);
+	}
+	ranges::sort(uses);
+
+	// Drop the least recently used ones till the rest fits.
+	auto border = uint64(0);
+	for (const auto &[used, size] : uses) {
+		if (_size <= till) {
+			break;
+		}
+		_size -= size;
+		border = used;
+	}
+	for (auto i = begin(_entries); i != end(_entries);) {
+		if (i->second.used <= border) {
+			i = _entries.erase(i);
+			++_stats.evicted;
+		} else {
+			++i;
+		}
+	}
+}
+
+auto DecodedImages::stats() const -> Stats {
+	auto result = _stats;
+	result.size = _size;
+	result.count = int(_entries.size());
+	return result;
+}
+
+} // namespace Storage
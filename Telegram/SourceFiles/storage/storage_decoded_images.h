@@ -0,0 +1,65 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/flat_map.h"
+
+namespace Storage {
+namespace Cache {
+struct Key;
+} // namespace Cache
+
+// Images read from the local cache together with their bytes, so that
+// an image shown again after its media view was destroyed is not read
+// from the encrypted database and decoded once more.
+class DecodedImages final {
+public:
+	struct Image {
+		QByteArray bytes;
+		QImage image;
+		QByteArray format;
+	};
+	struct Stats {
+		int64 hits = 0;
+		int64 misses = 0;
+		int64 evicted = 0;
+		int64 size = 0;
+		int count = 0;
+	};
+
+	explicit DecodedImages(int64 limit);
+
+	[[nodiscard]] std::optional<Image> get(const Cache::Key &key);
+	void put(const Cache::Key &key, Image image);
+	void remove(const Cache::Key &key);
+	void clear();
+
+	// Keeps at most the given part of the limit, for low memory cases.
+	void shrink(float64 part);
+
+	[[nodiscard]] Stats stats() const;
+
+private:
+	struct Entry {
+		Image image;
+		int64 size = 0;
+		uint64 used = 0;
+	};
+	using Id = std::pair<uint64, uint64>;
+
+	void evict(int64 till);
+
+	const int64 _limit = 0;
+	base::flat_map<Id, Entry> _entries;
+	int64 _size = 0;
+	uint64 _uses = 0;
+	Stats _stats;
+
+};
+
+} // namespace Storage
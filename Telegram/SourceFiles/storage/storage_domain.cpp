@@ -169,12 +169,22 @@ Domain::StartModernResult Domain::startModern(
 
 	_oldVersion = keyData.version;
 
+	auto indices = std::vector<int>();
 	auto tried = base::flat_set<int>();
-	auto sessions = base::flat_set<uint64>();
-	auto active = 0;
 	for (auto i = 0; i != count; ++i) {
 		auto index = qint32();
 		info.stream >> index;
+		indices.push_back(index);
+	}
+	auto active = std::optional<int>();
+	if (!info.stream.atEnd()) {
+		info.stream >> active.emplace();
+	}
+
+	// Read the accounts files on worker threads, the active account first,
+	// while the main thread applies them one by one in the stored order.
+	auto accounts = base::flat_map<int, std::unique_ptr<Main::Account>>();
+	const auto prefetch = [&](int index) {
 		if (index >= 0
 			&& index < Main::Domain::kPremiumMaxAccounts
 			&& tried.emplace(index).second) {
@@ -182,21 +192,40 @@ Domain::StartModernResult Domain::startModern(
 				_owner,
 				_dataName,
 				index);
-			auto config = account->prepareToStart(_localKey);
-			const auto sessionId = account->willHaveSessionUniqueId(
-				config.get());
-			if (!sessions.contains(sessionId)
-				&& (sessionId != 0 || (sessions.empty() && i + 1 == count))) {
-				if (sessions.empty()) {
-					active = index;
-				}
-				account->start(std::move(config));
-				_owner->accountAddedInStorage({
-					.index = index,
-					.account = std::move(account)
-				});
-				sessions.emplace(sessionId);
+			account->local().prefetchStart(_localKey);
+			accounts.emplace(index, std::move(account));
+		}
+	};
+	if (active) {
+		prefetch(*active);
+	}
+	for (const auto index : indices) {
+		prefetch(index);
+	}
+
+	auto sessions = base::flat_set<uint64>();
+	auto first = 0;
+	for (auto i = 0; i != count; ++i) {
+		const auto index = indices[i];
+		const auto j = accounts.find(index);
+		if (j == end(accounts) || !j->second) {
+			continue;
+		}
+		auto account = std::move(j->second);
+		auto config = account->prepareToStart(_localKey);
+		const auto sessionId = account->willHaveSessionUniqueId(
+			config.get());
+		if (!sessions.contains(sessionId)
+			&& (sessionId != 0 || (sessions.empty() && i + 1 == count))) {
+			if (sessions.empty()) {
+				first = index;
 			}
+			account->start(std::move(config));
+			_owner->accountAddedInStorage({
+				.index = index,
+				.account = std::move(account)
+			});
+			sessions.emplace(sessionId);
 		}
 	}
 	if (sessions.empty()) {
@@ -204,10 +233,7 @@ Domain::StartModernResult Domain::startModern(
 		return StartModernResult::Failed;
 	}
 
-	if (!info.stream.atEnd()) {
-		info.stream >> active;
-	}
-	_owner->activateFromStorage(active);
+	_owner->activateFromStorage(active.value_or(first));
 
 	Ensures(!sessions.empty());
 	return StartModernResult::Success;
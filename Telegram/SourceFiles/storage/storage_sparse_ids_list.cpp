@@ -23,7 +23,20 @@ void SparseIdsList::Slice::merge(
 	Expects(moreNoSkipRange.from <= range.till);
 	Expects(range.from <= moreNoSkipRange.till);
 
-	messages.merge(std::begin(moreMessages), std::end(moreMessages));
+	const auto from = std::begin(moreMessages);
+	const auto till = std::end(moreMessages);
+	const auto appended = !messages.empty()
+		&& std::all_of(from, till, [&](MsgId id) {
+			return id > messages.back();
+		});
+	if (appended) {
+		// Newer messages are inserted at the end without sorting it all.
+		for (auto i = from; i != till; ++i) {
+			messages.emplace(*i);
+		}
+	} else {
+		messages.merge(from, till);
+	}
 	range = {
 		qMin(range.from, moreNoSkipRange.from),
 		qMax(range.till, moreNoSkipRange.till)
@@ -39,18 +52,26 @@ SparseIdsList::AddResult SparseIdsList::uniteAndAdd(
 		MsgRange noSkipRange) {
 	const auto uniteFromIndex = uniteFrom - _slices.begin();
 	const auto was = int(uniteFrom->messages.size());
-	_slices.modify(uniteFrom, [&](Slice &slice) {
-		slice.merge(messages, noSkipRange);
-	});
 	const auto firstToErase = uniteFrom + 1;
 	if (firstToErase != uniteTill) {
+		// Merge all the united slices at once instead of one by one.
+		auto all = std::vector<MsgId>(
+			std::begin(messages),
+			std::end(messages));
+		auto allRange = noSkipRange;
 		for (auto it = firstToErase; it != uniteTill; ++it) {
-			_slices.modify(uniteFrom, [&](Slice &slice) {
-				slice.merge(it->messages, it->range);
-			});
+			all.insert(end(all), begin(it->messages), end(it->messages));
+			allRange.till = std::max(allRange.till, it->range.till);
 		}
+		_slices.modify(uniteFrom, [&](Slice &slice) {
+			slice.merge(all, allRange);
+		});
 		_slices.erase(firstToErase, uniteTill);
 		uniteFrom = _slices.begin() + uniteFromIndex;
+	} else {
+		_slices.modify(uniteFrom, [&](Slice &slice) {
+			slice.merge(messages, noSkipRange);
+		});
 	}
 	update.messages = &uniteFrom->messages;
 	update.range = uniteFrom->range;
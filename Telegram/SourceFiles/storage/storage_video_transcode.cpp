@@ -0,0 +1,657 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "storage/storage_video_transcode.h"
+
+#include "base/options.h"
+#include "base/random.h"
+#include "ffmpeg/ffmpeg_utility.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QThread>
+
+extern "C" {
+#include <libavutil/hwcontext.h>
+} // extern "C"
+
+namespace Storage {
+namespace {
+
+using namespace FFmpeg;
+
+constexpr auto kMinTranscodeSize = int64(20 * 1024 * 1024);
+constexpr auto kBitRateSlack = 1.5; // Leave alone what is close enough.
+constexpr auto kRequiredGain = 0.9; // Keep only if 10% smaller.
+constexpr auto kKeepLeftovers = 24 * 60 * 60;
+constexpr auto kKeyFrameInterval = crl::time(2000);
+constexpr auto kHwFramesPool = 20;
+const auto kFilePrefix = u"tdesktop_transcode_"_q;
+
+base::options::toggle TranscodeLargeVideosOption({
+	.id = kOptionTranscodeLargeVideos,
+	.name = "Transcode large videos",
+	.description = "Re-encode large videos to 720p H.264 before sending,"
+		" using a hardware encoder when available.",
+});
+
+struct Encoder {
+	const char *name = nullptr; // nullptr for the default H.264 one.
+	AVPixelFormat format = AV_PIX_FMT_YUV420P;
+	AVHWDeviceType device = AV_HWDEVICE_TYPE_NONE;
+};
+
+[[nodiscard]] const std::vector<Encoder> &Encoders() {
+	static const auto result = std::vector<Encoder>{
+#ifdef Q_OS_MAC
+		{ "h264_videotoolbox", AV_PIX_FMT_NV12 },
+#elif defined Q_OS_WIN // Q_OS_MAC
+		{ "h264_nvenc", AV_PIX_FMT_NV12 },
+		{ "h264_qsv", AV_PIX_FMT_NV12 },
+		{ "h264_amf", AV_PIX_FMT_NV12 },
+		{ "h264_mf", AV_PIX_FMT_NV12 },
+#else // Q_OS_MAC || Q_OS_WIN
+		{ "h264_nvenc", AV_PIX_FMT_NV12 },
+		{ "h264_vaapi", AV_PIX_FMT_NV12, AV_HWDEVICE_TYPE_VAAPI },
+#endif // Q_OS_MAC || Q_OS_WIN
+		{ "libopenh264" },
+		{ nullptr },
+	};
+	return result;
+}
+
+struct InputDeleter {
+	void operator()(AVFormatContext *value) {
+		if (value) {
+			avformat_close_input(&value);
+		}
+	}
+};
+using InputPointer = std::unique_ptr<AVFormatContext, InputDeleter>;
+
+struct OutputDeleter {
+	void operator()(AVFormatContext *value) {
+		if (value) {
+			avio_closep(&value->pb);
+			avformat_free_context(value);
+		}
+	}
+};
+using OutputPointer = std::unique_ptr<AVFormatContext, OutputDeleter>;
+
+struct BufferDeleter {
+	void operator()(AVBufferRef *value) {
+		av_buffer_unref(&value);
+	}
+};
+using BufferPointer = std::unique_ptr<AVBufferRef, BufferDeleter>;
+
+struct Input {
+	InputPointer format;
+	int video = -1;
+	int audio = -1;
+};
+
+[[nodiscard]] Input OpenInput(const QString &path) {
+	auto error = AvErrorWrap();
+	auto raw = (AVFormatContext*)nullptr;
+	const auto utf8 = path.toUtf8();
+	error = avformat_open_input(&raw, utf8.constData(), nullptr, nullptr);
+	if (error) {
+		LogError(u"avformat_open_input"_q, error);
+		return {};
+	}
+	auto result = Input{ .format = InputPointer(raw) };
+	if ((error = avformat_find_stream_info(raw, nullptr))) {
+		LogError(u"avformat_find_stream_info"_q, error);
+		return {};
+	}
+	result.video = av_find_best_stream(
+		raw,
+		AVMEDIA_TYPE_VIDEO,
+		-1,
+		-1,
+		nullptr,
+		0);
+	result.audio = av_find_best_stream(
+		raw,
+		AVMEDIA_TYPE_AUDIO,
+		-1,
+		result.video,
+		nullptr,
+		0);
+	return result;
+}
+
+[[nodiscard]] QSize TargetSize(QSize size, int maxSide) {
+	const auto side = std::max(size.width(), size.height());
+	if (side > maxSide) {
+		size = size.scaled(maxSide, maxSide, Qt::KeepAspectRatio);
+	}
+	// Most of the encoders want even dimensions for yuv420.
+	return QSize(
+		std::max(size.width() & ~1, 2),
+		std::max(size.height() & ~1, 2));
+}
+
+void RemoveLeftovers() {
+	const auto now = QDateTime::currentDateTime();
+	const auto list = QDir::temp().entryInfoList(
+		{ kFilePrefix + '*' },
+		QDir::Files);
+	for (const auto &info : list) {
+		if (info.lastModified().secsTo(now) > kKeepLeftovers) {
+			QFile::remove(info.absoluteFilePath());
+		}
+	}
+}
+
+class Transcoder final {
+public:
+	Transcoder(const QString &path, const VideoTranscodeOptions &options);
+
+	[[nodiscard]] std::optional<VideoTranscodeResult> run();
+
+private:
+	[[nodiscard]] bool openInput();
+	[[nodiscard]] bool openEncoder();
+	[[nodiscard]] bool openEncoder(const Encoder &encoder);
+	[[nodiscard]] bool openOutput();
+	[[nodiscard]] bool process();
+	[[nodiscard]] bool decode(const Packet *packet);
+	[[nodiscard]] bool encode(AVFrame *frame);
+	[[nodiscard]] bool writeEncoded();
+	[[nodiscard]] bool copyAudio(Packet &packet);
+	[[nodiscard]] bool interrupted() const;
+
+	const QString _inputPath;
+	const QString _outputPath;
+	const VideoTranscodeOptions _options;
+
+	Input _input;
+	CodecPointer _decoder;
+	CodecPointer _encoder;
+	QString _encoderName;
+	AVPixelFormat _encoderFormat = AV_PIX_FMT_NONE;
+	BufferPointer _hwDevice;
+	BufferPointer _hwFrames;
+	OutputPointer _output;
+	AVStream *_outputVideo = nullptr;
+	AVStream *_outputAudio = nullptr;
+	QSize _size;
+
+	FramePointer _decoded;
+	FramePointer _transferred;
+	FramePointer _scaled;
+	FramePointer _uploaded;
+	SwscalePointer _swscale;
+	Packet _encoded;
+	int64_t _lastPts = AV_NOPTS_VALUE;
+
+};
+
+Transcoder::Transcoder(
+	const QString &path,
+	const VideoTranscodeOptions &options)
+: _inputPath(path)
+, _outputPath(QDir::temp().filePath(kFilePrefix
+	+ QString::number(base::RandomValue<uint64>(), 16)
+	+ u".mp4"_q))
+, _options(options)
+, _decoded(MakeFramePointer())
+, _transferred(MakeFramePointer())
+, _scaled(MakeFramePointer())
+, _uploaded(MakeFramePointer()) {
+}
+
+std::optional<VideoTranscodeResult> Transcoder::run() {
+	const auto started = crl::now();
+	const auto done = openInput()
+		&& openEncoder()
+		&& openOutput()
+		&& process();
+	_output = nullptr;
+
+	const auto original = QFileInfo(_inputPath).size();
+	const auto size = QFileInfo(_outputPath).size();
+	if (!done || !size || size > original * kRequiredGain) {
+		if (done) {
+			LOG(("Transcode Info: Result of %1 bytes for %2 bytes is skipped."
+				).arg(size
+				).arg(original));
+		}
+		QFile::remove(_outputPath);
+		return std::nullopt;
+	}
+	auto result = VideoTranscodeResult{
+		.path = _outputPath,
+		.encoder = _encoderName,
+		.size = size,
+		.duration = crl::now() - started,
+	};
+	LOG(("Transcode Info: %1 bytes to %2 bytes with \"%3\" in %4 ms."
+		).arg(original
+		).arg(size
+		).arg(result.encoder
+		).arg(result.duration));
+	return result;
+}
+
+bool Transcoder::openInput() {
+	_input = OpenInput(_inputPath);
+	if (!_input.format || _input.video < 0) {
+		return false;
+	}
+	const auto stream = _input.format->streams[_input.video];
+	_decoder = MakeCodecPointer({ .stream = stream, .hwAllowed = true });
+	if (!_decoder) {
+		return false;
+	}
+	_size = TargetSize(
+		QSize(_decoder->width, _decoder->height),
+		_options.maxSide);
+	return true;
+}
+
+bool Transcoder::openEncoder() {
+	for (const auto &encoder : Encoders()) {
+		if (openEncoder(encoder)) {
+			return true;
+		}
+		_encoder = nullptr;
+		_hwFrames = nullptr;
+		_hwDevice = nullptr;
+	}
+	LogError(u"avcodec_open2"_q, u"No H.264 encoder."_q);
+	return false;
+}
+
+bool Transcoder::openEncoder(const Encoder &encoder) {
+	auto error = AvErrorWrap();
+
+	const auto codec = encoder.name
+		? avcodec_find_encoder_by_name(encoder.name)
+		: avcodec_find_encoder(AV_CODEC_ID_H264);
+	if (!codec) {
+		return false;
+	}
+	_encoder = CodecPointer(avcodec_alloc_context3(codec));
+	const auto context = _encoder.get();
+	if (!context) {
+		LogError(u"avcodec_alloc_context3"_q);
+		return false;
+	}
+	const auto stream = _input.format->streams[_input.video];
+	const auto rate = av_guess_frame_rate(_input.format.get(), stream, nullptr);
+	context->width = _size.width();
+	context->height = _size.height();
+	context->time_base = stream->time_base;
+	context->framerate = rate;
+	context->sample_aspect_ratio = _decoder->sample_aspect_ratio;
+	context->pix_fmt = encoder.format;
+	context->bit_rate = _options.videoBitRate;
+	context->rc_max_rate = _options.videoBitRate * 2;
+	context->rc_buffer_size = int(_options.videoBitRate * 2);
+	context->max_b_frames = 0; // Frames are sent in presentation order.
+	context->gop_size = (rate.num > 0 && rate.den > 0)
+		? int(kKeyFrameInterval * rate.num / (rate.den * 1000))
+		: 60;
+	const auto format = av_guess_format("mp4", nullptr, nullptr);
+	if (format && (format->flags & AVFMT_GLOBALHEADER)) {
+		context->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+	}
+	_encoderFormat = encoder.format;
+
+	if (encoder.device != AV_HWDEVICE_TYPE_NONE) {
+		auto device = (AVBufferRef*)nullptr;
+		error = av_hwdevice_ctx_create(
+			&device,
+			encoder.device,
+			nullptr,
+			nullptr,
+			0);
+		if (error) {
+			return false;
+		}
+		_hwDevice = BufferPointer(device);
+		_hwFrames = BufferPointer(av_hwframe_ctx_alloc(device));
+		if (!_hwFrames) {
+			return false;
+		}
+		const auto frames = (AVHWFramesContext*)_hwFrames->data;
+		frames->format = AV_PIX_FMT_VAAPI;
+		frames->sw_format = encoder.format;
+		frames->width = context->width;
+		frames->height = context->height;
+		frames->initial_pool_size = kHwFramesPool;
+		if ((error = av_hwframe_ctx_init(_hwFrames.get()))) {
+			return false;
+		}
+		context->pix_fmt = AV_PIX_FMT_VAAPI;
+		context->hw_frames_ctx = av_buffer_ref(_hwFrames.get());
+	}
+
+	if ((error = avcodec_open2(context, codec, nullptr))) {
+		DEBUG_LOG(("Transcode Info: Could not open \"%1\" encoder, "
+			"error %2.").arg(codec->name).arg(error.text()));
+		return false;
+	}
+	_encoderName = QString::fromLatin1(codec->name);
+	return true;
+}
+
+bool Transcoder::openOutput() {
+	auto error = AvErrorWrap();
+
+	const auto utf8 = _outputPath.toUtf8();
+	auto raw = (AVFormatContext*)nullptr;
+	error = avformat_alloc_output_context2(
+		&raw,
+		nullptr,
+		"mp4",
+		utf8.constData());
+	if (!raw) {
+		LogError(u"avformat_alloc_output_context2"_q, error);
+		return false;
+	}
+	_output = OutputPointer(raw);
+
+	const auto input = _input.format->streams[_input.video];
+	_outputVideo = avformat_new_stream(raw, nullptr);
+	if (!_outputVideo) {
+		LogError(u"avformat_new_stream"_q);
+		return false;
+	}
+	error = avcodec_parameters_from_context(
+		_outputVideo->codecpar,
+		_encoder.get());
+	if (error) {
+		LogError(u"avcodec_parameters_from_context"_q, error);
+		return false;
+	}
+	_outputVideo->time_base = _encoder->time_base;
+	if (const auto matrix = av_packet_side_data_get(
+			input->codecpar->coded_side_data,
+			input->codecpar->nb_coded_side_data,
+			AV_PKT_DATA_DISPLAYMATRIX)) {
+		// Keep the rotation, the frames are encoded as they are stored.
+		const auto copy = av_packet_side_data_new(
+			&_outputVideo->codecpar->coded_side_data,
+			&_outputVideo->codecpar->nb_coded_side_data,
+			AV_PKT_DATA_DISPLAYMATRIX,
+			matrix->size,
+			0);
+		if (copy) {
+			memcpy(copy->data, matrix->data, matrix->size);
+		}
+	}
+
+	if (_input.audio >= 0) {
+		const auto audio = _input.format->streams[_input.audio];
+		const auto id = audio->codecpar->codec_id;
+		if (avformat_query_codec(raw->oformat, id, FF_COMPLIANCE_NORMAL) != 1) {
+			// Better send the original than lose the sound.
+			LOG(("Transcode Info: Audio codec \"%1\" doesn't fit mp4."
+				).arg(avcodec_get_name(id)));
+			return false;
+		}
+		_outputAudio = avformat_new_stream(raw, nullptr);
+		if (!_outputAudio) {
+			LogError(u"avformat_new_stream"_q);
+			return false;
+		}
+		error = avcodec_parameters_copy(
+			_outputAudio->codecpar,
+			audio->codecpar);
+		if (error) {
+			LogError(u"avcodec_parameters_copy"_q, error);
+			return false;
+		}
+		_outputAudio->codecpar->codec_tag = 0;
+		_outputAudio->time_base = audio->time_base;
+	}
+
+	if ((error = avio_open(&raw->pb, utf8.constData(), AVIO_FLAG_WRITE))) {
+		LogError(u"avio_open"_q, error);
+		return false;
+	}
+	auto options = (AVDictionary*)nullptr;
+	av_dict_set(&options, "movflags", "+faststart", 0);
+	error = avformat_write_header(raw, &options);
+	av_dict_free(&options);
+	if (error) {
+		LogError(u"avformat_write_header"_q, error);
+		return false;
+	}
+	return true;
+}
+
+bool Transcoder::process() {
+	auto error = AvErrorWrap();
+	auto packet = Packet();
+	while (true) {
+		if (interrupted()) {
+			return false;
+		}
+		error = av_read_frame(_input.format.get(), &packet.fields());
+		if (error.code() == AVERROR_EOF) {
+			break;
+		} else if (error) {
+			LogError(u"av_read_frame"_q, error);
+			return false;
+		}
+		const auto index = packet.fields().stream_index;
+		const auto good = (index == _input.video)
+			? decode(&packet)
+			: (index == _input.audio)
+			? copyAudio(packet)
+			: true;
+		av_packet_unref(&packet.fields());
+		if (!good) {
+			return false;
+		}
+	}
+	if (!decode(nullptr) || !encode(nullptr)) {
+		return false;
+	}
+	if ((error = av_write_trailer(_output.get()))) {
+		LogError(u"av_write_trailer"_q, error);
+		return false;
+	}
+	return true;
+}
+
+bool Transcoder::decode(const Packet *packet) {
+	auto error = AvErrorWrap(avcodec_send_packet(
+		_decoder.get(),
+		packet ? &packet->fields() : nullptr));
+	if (error && error.code() != AVERROR(EAGAIN)) {
+		LogError(u"avcodec_send_packet"_q, error);
+		return false;
+	}
+	while (true) {
+		error = avcodec_receive_frame(_decoder.get(), _decoded.get());
+		if (error.code() == AVERROR(EAGAIN) || error.code() == AVERROR_EOF) {
+			return true;
+		} else if (error) {
+			LogError(u"avcodec_receive_frame"_q, error);
+			return false;
+		}
+		const auto good = encode(_decoded.get());
+		av_frame_unref(_decoded.get());
+		if (!good) {
+			return false;
+		}
+	}
+}
+
+bool Transcoder::encode(AVFrame *frame) {
+	auto error = AvErrorWrap();
+	auto send = (AVFrame*)nullptr;
+	if (frame) {
+		auto source = frame;
+		if (frame->hw_frames_ctx) {
+			av_frame_unref(_transferred.get());
+			error = av_hwframe_transfer_data(_transferred.get(), frame, 0);
+			if (error) {
+				LogError(u"av_hwframe_transfer_data"_q, error);
+				return false;
+			}
+			source = _transferred.get();
+		}
+		_swscale = MakeSwscalePointer(
+			QSize(source->width, source->height),
+			source->format,
+			_size,
+			_encoderFormat,
+			&_swscale);
+		if (!_swscale) {
+			return false;
+		}
+		if (!_scaled->data[0]) {
+			_scaled->format = _encoderFormat;
+			_scaled->width = _size.width();
+			_scaled->height = _size.height();
+			if ((error = av_frame_get_buffer(_scaled.get(), 0))) {
+				LogError(u"av_frame_get_buffer"_q, error);
+				return false;
+			}
+		}
+		// The encoder may still reference the previous frame buffers.
+		if ((error = av_frame_make_writable(_scaled.get()))) {
+			LogError(u"av_frame_make_writable"_q, error);
+			return false;
+		}
+		sws_scale(
+			_swscale.get(),
+			source->data,
+			source->linesize,
+			0,
+			source->height,
+			_scaled->data,
+			_scaled->linesize);
+
+		auto pts = frame->best_effort_timestamp;
+		if (pts == AV_NOPTS_VALUE || (_lastPts != AV_NOPTS_VALUE
+			&& pts <= _lastPts)) {
+			pts = (_lastPts == AV_NOPTS_VALUE) ? 0 : (_lastPts + 1);
+		}
+		_lastPts = _scaled->pts = pts;
+		send = _scaled.get();
+
+		if (_hwFrames) {
+			av_frame_unref(_uploaded.get());
+			error = av_hwframe_get_buffer(
+				_hwFrames.get(),
+				_uploaded.get(),
+				0);
+			if (error) {
+				LogError(u"av_hwframe_get_buffer"_q, error);
+				return false;
+			}
+			error = av_hwframe_transfer_data(_uploaded.get(), send, 0);
+			if (error) {
+				LogError(u"av_hwframe_transfer_data"_q, error);
+				return false;
+			}
+			_uploaded->pts = pts;
+			send = _uploaded.get();
+		}
+	}
+	error = avcodec_send_frame(_encoder.get(), send);
+	if (error && error.code() != AVERROR_EOF) {
+		LogError(u"avcodec_send_frame"_q, error);
+		return false;
+	}
+	return writeEncoded();
+}
+
+bool Transcoder::writeEncoded() {
+	auto error = AvErrorWrap();
+	while (true) {
+		auto &packet = _encoded.fields();
+		error = avcodec_receive_packet(_encoder.get(), &packet);
+		if (error.code() == AVERROR(EAGAIN) || error.code() == AVERROR_EOF) {
+			return true;
+		} else if (error) {
+			LogError(u"avcodec_receive_packet"_q, error);
+			return false;
+		}
+		av_packet_rescale_ts(
+			&packet,
+			_encoder->time_base,
+			_outputVideo->time_base);
+		packet.stream_index = _outputVideo->index;
+		error = av_interleaved_write_frame(_output.get(), &packet);
+		if (error) {
+			LogError(u"av_interleaved_write_frame"_q, error);
+			return false;
+		}
+	}
+}
+
+bool Transcoder::copyAudio(Packet &packet) {
+	auto &fields = packet.fields();
+	av_packet_rescale_ts(
+		&fields,
+		_input.format->streams[_input.audio]->time_base,
+		_outputAudio->time_base);
+	fields.stream_index = _outputAudio->index;
+	fields.pos = -1;
+	const auto error = AvErrorWrap(
+		av_interleaved_write_frame(_output.get(), &fields));
+	if (error) {
+		LogError(u"av_interleaved_write_frame"_q, error);
+		return false;
+	}
+	return true;
+}
+
+bool Transcoder::interrupted() const {
+	return QThread::currentThread()->isInterruptionRequested();
+}
+
+} // namespace
+
+const char kOptionTranscodeLargeVideos[] = "transcode-large-videos";
+
+bool TranscodeLargeVideos() {
+	return TranscodeLargeVideosOption.value();
+}
+
+bool ShouldTranscodeVideo(
+		const QString &path,
+		int64 size,
+		const VideoTranscodeOptions &options) {
+	if (size < kMinTranscodeSize) {
+		return false;
+	}
+	const auto input = OpenInput(path);
+	if (!input.format || input.video < 0) {
+		return false;
+	}
+	const auto duration = input.format->duration;
+	if (duration <= 0) {
+		return false;
+	}
+	const auto parameters = input.format->streams[input.video]->codecpar;
+	const auto side = std::max(parameters->width, parameters->height);
+	const auto bitRate = size * 8 * AV_TIME_BASE / duration;
+	return (side > options.maxSide)
+		|| (bitRate > options.videoBitRate * kBitRateSlack);
+}
+
+std::optional<VideoTranscodeResult> TranscodeVideo(
+		const QString &path,
+		const VideoTranscodeOptions &options) {
+	RemoveLeftovers();
+	return Transcoder(path, options).run();
+}
+
+} // namespace Storage
@@ -0,0 +1,44 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Storage {
+
+extern const char kOptionTranscodeLargeVideos[];
+
+// Reads the option, main thread only.
+[[nodiscard]] bool TranscodeLargeVideos();
+
+struct VideoTranscodeOptions {
+	int maxSide = 1280;
+	int64 videoBitRate = 2'500'000;
+};
+
+struct VideoTranscodeResult {
+	QString path;
+	QString encoder;
+	int64 size = 0;
+	crl::time duration = 0;
+};
+
+// Large files with either a bigger resolution or a much higher bitrate
+// than the options allow.
+[[nodiscard]] bool ShouldTranscodeVideo(
+	const QString &path,
+	int64 size,
+	const VideoTranscodeOptions &options = {});
+
+// Blocking, prefers a hardware H.264 encoder and copies the audio track.
+// Gives up when the current thread is interrupted or when the result is
+// not noticeably smaller than the original. The result is written to
+// the temp folder, it is removed by one of the later calls.
+[[nodiscard]] std::optional<VideoTranscodeResult> TranscodeVideo(
+	const QString &path,
+	const VideoTranscodeOptions &options = {});
+
+} // namespace Storage
@@ -11,7 +11,88 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "ui/painter.h"
 #include "ui/image/image_prepare.h"
 
+#include <list>
+#include <map>
+
 namespace Ui {
+namespace {
+
+// Dialogs, history, members lists and mentions paint the same userpics,
+// one masked image per source, size and shape is kept for all of them.
+constexpr auto kMaskedLimit = int64(16 * 1024 * 1024);
+
+struct MaskedKey {
+	qint64 source = 0;
+	int size = 0;
+	PeerUserpicShape shape = PeerUserpicShape::Auto;
+
+	friend inline auto operator<=>(MaskedKey, MaskedKey) = default;
+	friend inline bool operator==(MaskedKey, MaskedKey) = default;
+};
+
+struct MaskedCache {
+	struct Entry {
+		QImage image;
+		std::list<MaskedKey>::iterator used;
+	};
+	std::map<MaskedKey, Entry> images;
+	std::list<MaskedKey> used; // Least recently used first.
+	int64 bytes = 0;
+};
+
+[[nodiscard]] MaskedCache &Masked() {
+	static auto result = MaskedCache();
+	return result;
+}
+
+[[nodiscard]] QImage PrepareMasked(
+		const QImage &cloud,
+		int size,
+		PeerUserpicShape shape) {
+	auto result = cloud.scaled(
+		QSize(size, size),
+		Qt::IgnoreAspectRatio,
+		Qt::SmoothTransformation);
+	if (shape == PeerUserpicShape::Monoforum) {
+		return Ui::ApplyMonoforumShape(std::move(result));
+	} else if (shape == PeerUserpicShape::Forum) {
+		return Images::Round(
+			std::move(result),
+			Images::CornersMask(size
+				* Ui::ForumUserpicRadiusMultiplier()
+				/ style::DevicePixelRatio()));
+	}
+	return Images::Circle(std::move(result));
+}
+
+[[nodiscard]] QImage LookupMasked(
+		const QImage &cloud,
+		int size,
+		PeerUserpicShape shape) {
+	auto &cache = Masked();
+	const auto key = MaskedKey{ cloud.cacheKey(), size, shape };
+	const auto i = cache.images.find(key);
+	if (i != end(cache.images)) {
+		cache.used.splice(end(cache.used), cache.used, i->second.used);
+		return i->second.image;
+	}
+	auto image = PrepareMasked(cloud, size, shape);
+	cache.bytes += image.sizeInBytes();
+	cache.used.push_back(key);
+	cache.images.emplace(key, MaskedCache::Entry{
+		.image = image,
+		.used = std::prev(end(cache.used)),
+	});
+	while (cache.bytes > kMaskedLimit && cache.used.size() > 1) {
+		const auto j = cache.images.find(cache.used.front());
+		cache.bytes -= j->second.image.sizeInBytes();
+		cache.images.erase(j);
+		cache.used.pop_front();
+	}
+	return image;
+}
+
+} // namespace
 
 float64 ForumUserpicRadiusMultiplier() {
 	return 0.3;
@@ -45,21 +126,7 @@ void ValidateUserpicCache(
 	view.paletteVersion = version;
 
 	if (cloud) {
-		view.cached = cloud->scaled(
-			full,
-			Qt::IgnoreAspectRatio,
-			Qt::SmoothTransformation);
-		if (shape == PeerUserpicShape::Monoforum) {
-			view.cached = Ui::ApplyMonoforumShape(std::move(view.cached));
-		} else if (shape == PeerUserpicShape::Forum) {
-			view.cached = Images::Round(
-				std::move(view.cached),
-				Images::CornersMask(size
-					* Ui::ForumUserpicRadiusMultiplier()
-					/ style::DevicePixelRatio()));
-		} else {
-			view.cached = Images::Circle(std::move(view.cached));
-		}
+		view.cached = LookupMasked(*cloud, size, shape);
 	} else {
 		if (view.cached.size() != full) {
 			view.cached = QImage(full, QImage::Format_ARGB32_Premultiplied);
@@ -60,6 +60,9 @@ constexpr auto kMinimalForwardDelay = crl::time(500);
 constexpr auto kMinimalAlertDelay = crl::time(500);
 constexpr auto kWaitingForAllGroupedDelay = crl::time(1000);
 constexpr auto kReactionNotificationEach = 60 * 60 * crl::time(1000);
+constexpr auto kNativeBurstWindow = crl::time(1500);
+constexpr auto kNativeRateLimit = 4;
+constexpr auto kNativeRatePeriod = crl::time(1000);
 
 #ifdef Q_OS_MAC
 constexpr auto kSystemAlertDuration = crl::time(1000);
@@ -290,7 +293,8 @@ System::SkipState System::skipNotification(
 	const auto item = notification.item;
 	const auto type = notification.type;
 	const auto messageType = (type == Data::ItemNotificationType::Message);
-	if (!item->notificationThread()->currentNotification()
+	if (cHeadless()
+		|| !item->notificationThread()->currentNotification()
 		|| (messageType && item->skipNotification())
 		|| (type == Data::ItemNotificationType::Reaction
 			&& skipReactionNotification(item))) {
@@ -1042,6 +1046,51 @@ void System::playSound(
 	lookupSound(&session->data(), id)->playOnce(volumeOverride);
 }
 
+void Manager::clearFromTopic(not_null<Data::ForumTopic*> topic) {
+	const auto context = ContextId{
+		.sessionId = topic->session().uniqueId(),
+		.peerId = topic->history()->peer->id,
+		.topicRootId = topic->rootId(),
+	};
+	doClearHeld([&](const ContextId &id) {
+		return (id.sessionId == context.sessionId)
+			&& (id.peerId == context.peerId)
+			&& (id.topicRootId == context.topicRootId);
+	});
+	doClearFromTopic(topic);
+}
+
+void Manager::clearFromSublist(not_null<Data::SavedSublist*> sublist) {
+	const auto context = ContextId{
+		.sessionId = sublist->session().uniqueId(),
+		.peerId = sublist->owningHistory()->peer->id,
+		.monoforumPeerId = sublist->sublistPeer()->id,
+	};
+	doClearHeld([&](const ContextId &id) {
+		return (id.sessionId == context.sessionId)
+			&& (id.peerId == context.peerId)
+			&& (id.monoforumPeerId == context.monoforumPeerId);
+	});
+	doClearFromSublist(sublist);
+}
+
+void Manager::clearFromHistory(not_null<History*> history) {
+	const auto sessionId = history->session().uniqueId();
+	const auto peerId = history->peer->id;
+	doClearHeld([&](const ContextId &id) {
+		return (id.sessionId == sessionId) && (id.peerId == peerId);
+	});
+	doClearFromHistory(history);
+}
+
+void Manager::clearFromSession(not_null<Main::Session*> session) {
+	const auto sessionId = session->uniqueId();
+	doClearHeld([&](const ContextId &id) {
+		return (id.sessionId == sessionId);
+	});
+	doClearFromSession(session);
+}
+
 Manager::DisplayOptions Manager::getNotificationOptions(
 		HistoryItem *item,
 		Data::ItemNotificationType type) const {
@@ -1408,7 +1457,119 @@ void Manager::maybePlaySound(Fn<void()> playSound) {
 	}
 }
 
+NativeManager::NativeManager(not_null<System*> system)
+: Manager(system)
+, _burstsTimer([=] { showBursts(); }) {
+}
+
 void NativeManager::doShowNotification(NotificationFields &&fields) {
+	if (fields.reactionFrom) {
+		showNativeNow(std::move(fields));
+		return;
+	}
+	const auto item = fields.item;
+	const auto history = item->history();
+	const auto now = crl::now();
+	auto &burst = _bursts[ContextId{
+		.sessionId = history->session().uniqueId(),
+		.peerId = history->peer->id,
+		.topicRootId = item->topicRootId(),
+		.monoforumPeerId = (history->amMonoforumAdmin()
+			? item->sublistPeerId()
+			: PeerId()),
+	}];
+	if (!burst.count
+		&& (!burst.shownAt || burst.shownAt + kNativeBurstWindow <= now)
+		&& takeNativeSlot(now)) {
+		burst.shownAt = now;
+		showNativeNow(std::move(fields));
+		return;
+	}
+	burst.session = base::make_weak(&history->session());
+	burst.itemId = item->fullId();
+	burst.count += std::max(fields.forwardedCount, 1);
+	burst.forwardedCount = fields.forwardedCount;
+	if (fields.soundId) {
+		burst.soundId = fields.soundId;
+	}
+	showBursts();
+}
+
+void NativeManager::doClearHeld(Fn<bool(const ContextId&)> matches) {
+	for (auto i = begin(_bursts); i != end(_bursts);) {
+		if (matches(i->first)) {
+			i = _bursts.erase(i);
+		} else {
+			++i;
+		}
+	}
+}
+
+bool NativeManager::takeNativeSlot(crl::time now) {
+	while (!_nativeShownAt.empty()
+		&& _nativeShownAt.front() + kNativeRatePeriod <= now) {
+		_nativeShownAt.pop_front();
+	}
+	if (int(_nativeShownAt.size()) >= kNativeRateLimit) {
+		return false;
+	}
+	_nativeShownAt.push_back(now);
+	return true;
+}
+
+void NativeManager::showBursts() {
+	const auto now = crl::now();
+	auto next = crl::time(0);
+	const auto wait = [&](crl::time when) {
+		if (!next || next > when) {
+			next = when;
+		}
+	};
+	for (auto i = begin(_bursts); i != end(_bursts);) {
+		auto &burst = i->second;
+		const auto till = burst.shownAt + kNativeBurstWindow;
+		if (!burst.count) {
+			if (till <= now) {
+				i = _bursts.erase(i);
+				continue;
+			}
+		} else if (till > now) {
+			wait(till);
+		} else if (takeNativeSlot(now)) {
+			showBurst(burst);
+			burst = Burst{ .shownAt = now };
+			wait(now + kNativeBurstWindow);
+		} else {
+			wait(_nativeShownAt.front() + kNativeRatePeriod);
+		}
+		++i;
+	}
+	if (next) {
+		_burstsTimer.callOnce(std::max(next - now, crl::time(1)));
+	}
+}
+
+void NativeManager::showBurst(const Burst &burst) {
+	const auto session = burst.session.get();
+	const auto item = session
+		? session->data().message(burst.itemId)
+		: nullptr;
+	if (!item) {
+		return;
+	} else if (!item->out() && !item->unread(item->notificationThread())) {
+		// Read while it was held.
+		return;
+	}
+	showNativeNow({
+		.item = item,
+		.forwardedCount = burst.forwardedCount,
+		.soundId = burst.soundId,
+	}, burst.count);
+}
+
+void NativeManager::showNativeNow(
+		NotificationFields &&fields,
+		int burstCount) {
 	const auto options = getNotificationOptions(
 		fields.item,
 		(fields.reactionFrom
@@ -1452,6 +1613,8 @@ void NativeManager::doShowNotification(NotificationFields &&fields) {
 			options.hideMessageText))
 		: options.hideMessageText
 		? tr::lng_notification_preview(tr::now)
+		: (burstCount > 1)
+		? tr::lng_notification_messages(tr::now, lt_count, burstCount)
 		: (fields.forwardedCount > 1)
 		? tr::lng_forward_messages(tr::now, lt_count, fields.forwardedCount)
 		: item->groupId()
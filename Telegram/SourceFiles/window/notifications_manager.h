@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "data/data_message_reaction_id.h"
 #include "base/timer.h"
+#include "base/weak_ptr.h"
 #include "base/type_traits.h"
 #include "media/audio/media_audio_local_cache.h"
 
@@ -297,18 +298,10 @@ public:
 	void clearFromItem(not_null<HistoryItem*> item) {
 		doClearFromItem(item);
 	}
-	void clearFromTopic(not_null<Data::ForumTopic*> topic) {
-		doClearFromTopic(topic);
-	}
-	void clearFromSublist(not_null<Data::SavedSublist*> sublist) {
-		doClearFromSublist(sublist);
-	}
-	void clearFromHistory(not_null<History*> history) {
-		doClearFromHistory(history);
-	}
-	void clearFromSession(not_null<Main::Session*> session) {
-		doClearFromSession(session);
-	}
+	void clearFromTopic(not_null<Data::ForumTopic*> topic);
+	void clearFromSublist(not_null<Data::SavedSublist*> sublist);
+	void clearFromHistory(not_null<History*> history);
+	void clearFromSession(not_null<Main::Session*> session);
 
 	void notificationActivated(
 		NotificationId id,
@@ -367,6 +360,9 @@ protected:
 		not_null<Data::SavedSublist*> sublist) = 0;
 	virtual void doClearFromHistory(not_null<History*> history) = 0;
 	virtual void doClearFromSession(not_null<Main::Session*> session) = 0;
+	// Drops the notifications held back and not shown yet.
+	virtual void doClearHeld(Fn<bool(const ContextId&)> matches) {
+	}
 	[[nodiscard]] virtual bool doSkipToast() const = 0;
 	virtual void doMaybePlaySound(Fn<void()> playSound) = 0;
 	virtual void doMaybeFlashBounce(Fn<void()> flashBounce) = 0;
@@ -393,6 +389,8 @@ private:
 
 class NativeManager : public Manager {
 public:
+	explicit NativeManager(not_null<System*> system);
+
 	[[nodiscard]] ManagerType type() const override {
 		return ManagerType::Native;
 	}
@@ -411,15 +409,16 @@ public:
 	};
 
 protected:
-	using Manager::Manager;
-
 	void doUpdateAll() override {
+		_bursts.clear();
 		doClearAllFast();
 	}
 	void doClearAll() override {
+		_bursts.clear();
 		doClearAllFast();
 	}
 	void doShowNotification(NotificationFields &&fields) override;
+	void doClearHeld(Fn<bool(const ContextId&)> matches) override;
 
 	bool forceHideDetails() const override;
 
@@ -428,8 +427,28 @@ protected:
 		Ui::PeerUserpicView &userpicView) = 0;
 
 private:
+	// Messages of a chat that arrive soon after its last notification
+	// are held and shown as one, the native calls are rate limited.
+	struct Burst {
+		base::weak_ptr<Main::Session> session;
+		FullMsgId itemId;
+		int count = 0;
+		int forwardedCount = 0;
+		std::optional<DocumentId> soundId;
+		crl::time shownAt = 0;
+	};
+
+	void showNativeNow(NotificationFields &&fields, int burstCount = 0);
+	void showBursts();
+	void showBurst(const Burst &burst);
+	[[nodiscard]] bool takeNativeSlot(crl::time now);
+
 	Media::Audio::LocalCache _localSoundCache;
 
+	base::flat_map<ContextId, Burst> _bursts;
+	std::deque<crl::time> _nativeShownAt;
+	base::Timer _burstsTimer;
+
 };
 
 class DummyManager : public NativeManager {
@@ -381,7 +381,8 @@ bool LoadTheme(
 
 bool InitializeFromCache(
 		const QByteArray &content,
-		const Cached &cache) {
+		const Cached &cache,
+		Instance *out = nullptr) {
 	if (cache.paletteChecksum != style::palette::Checksum()) {
 		return false;
 	}
@@ -399,12 +400,17 @@ bool InitializeFromCache(
 		}
 	}
 
-	if (!style::main_palette::load(cache.colors)) {
+	if (out) {
+		if (!out->palette.load(cache.colors)) {
+			return false;
+		}
+	} else if (!style::main_palette::load(cache.colors)) {
 		return false;
+	} else {
+		Background()->saveAdjustableColors();
 	}
-	Background()->saveAdjustableColors();
 	if (!background.isNull()) {
-		applyBackground(std::move(background), cache.tiled, nullptr);
+		applyBackground(std::move(background), cache.tiled, out);
 	}
 
 	return true;
@@ -1183,14 +1189,21 @@ void ChatBackground::reapplyWithNightMode(
 		}
 		auto preview = std::make_unique<Preview>();
 		preview->object = std::move(read.object);
-		preview->instance.cached = std::move(read.cache);
-		const auto loaded = LoadTheme(
+
+		// The saved palette and background were prepared when this theme
+		// was applied last time, use them instead of parsing the theme.
+		const auto cached = InitializeFromCache(
 			preview->object.content,
-			ColorizerForTheme(path),
-			std::nullopt,
-			&preview->instance.cached,
+			read.cache,
 			&preview->instance);
-		if (!loaded) {
+		if (cached) {
+			preview->instance.cached = std::move(read.cache);
+		} else if (!LoadTheme(
+				preview->object.content,
+				ColorizerForTheme(path),
+				std::nullopt,
+				&preview->instance.cached,
+				&preview->instance)) {
 			return false;
 		}
 		Apply(std::move(preview));
@@ -201,7 +201,12 @@ void MarkAsReadChatList(not_null<Dialogs::MainList*> list) {
 			mark.push_back(history);
 		}
 	}
-	ranges::for_each(mark, MarkAsReadThread);
+	if (mark.empty()) {
+		return;
+	}
+	mark.front()->owner().histories().readInboxBatch([&] {
+		ranges::for_each(mark, MarkAsReadThread);
+	});
 }
 
 void PeerMenuAddMuteSubmenuAction(
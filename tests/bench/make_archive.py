@@ -0,0 +1,198 @@
+#!/usr/bin/env python3
+"""
+Synthetic MCP archive database for benchmarks
+
+Writes a telegram_mcp.db with the messages and chats tables of
+ChatArchiver filled with generated chats, senders and texts, and a
+<db>.json sidecar listing the chat ids, user ids and vocabulary the
+benchmark scenarios draw their arguments from.
+
+Usage:
+    python3 tests/bench/make_archive.py --messages 1000000 out/bench/1m.db
+    python3 tests/bench/make_archive.py --messages 10000000 out/bench/10m.db
+"""
+import argparse
+import itertools
+import json
+import os
+import random
+import sqlite3
+import sys
+import time
+
+# Same layout as ChatArchiver::initializeSchema(), the app adds its other
+# tables and the full-text index itself when it opens the file.
+SCHEMA = [
+    """CREATE TABLE IF NOT EXISTS messages (
+        id INTEGER PRIMARY KEY AUTOINCREMENT,
+        message_id INTEGER NOT NULL,
+        chat_id INTEGER NOT NULL,
+        user_id INTEGER,
+        username TEXT,
+        first_name TEXT,
+        last_name TEXT,
+        content TEXT,
+        timestamp INTEGER NOT NULL,
+        date TEXT,
+        message_type TEXT DEFAULT 'text',
+        reply_to_message_id INTEGER,
+        forward_from_chat_id INTEGER,
+        forward_from_message_id INTEGER,
+        edit_date INTEGER,
+        media_path TEXT,
+        media_url TEXT,
+        media_size INTEGER,
+        media_mime_type TEXT,
+        has_media BOOLEAN DEFAULT 0,
+        is_forwarded BOOLEAN DEFAULT 0,
+        is_reply BOOLEAN DEFAULT 0,
+        metadata TEXT,
+        created_at INTEGER DEFAULT (strftime('%s', 'now')),
+        cold_segment INTEGER,
+        UNIQUE(chat_id, message_id)
+    )""",
+    """CREATE TABLE IF NOT EXISTS chats (
+        chat_id INTEGER PRIMARY KEY,
+        chat_type TEXT NOT NULL,
+        title TEXT,
+        username TEXT,
+        description TEXT,
+        member_count INTEGER,
+        photo_path TEXT,
+        is_archived BOOLEAN DEFAULT 0,
+        first_seen INTEGER,
+        last_updated INTEGER,
+        metadata TEXT
+    )""",
+]
+
+INDICES = [
+    "CREATE INDEX IF NOT EXISTS idx_messages_chat_timestamp "
+    "ON messages(chat_id, timestamp DESC, message_id DESC)",
+    "CREATE INDEX IF NOT EXISTS idx_messages_user "
+    "ON messages(user_id, timestamp DESC)",
+]
+
+SYLLABLES = [
+    "ka", "lo", "mi", "ne", "ra", "to", "su", "vi", "de", "po",
+    "an", "el", "or", "un", "is", "ba", "ce", "fu", "go", "hi",
+]
+
+BATCH = 50000
+
+
+def make_vocabulary(rng, size):
+    words = set()
+    while len(words) < size:
+        words.add("".join(rng.choice(SYLLABLES) for _ in range(rng.randint(2, 4))))
+    return sorted(words)
+
+
+def zipf_weights(count, exponent=1.1):
+    # Few chats and words take most of the traffic, like real archives.
+    return [1.0 / ((rank + 1) ** exponent) for rank in range(count)]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    parser.add_argument("output", help="Database file to create")
+    parser.add_argument("--messages", type=int, default=1000000)
+    parser.add_argument("--chats", type=int, default=500)
+    parser.add_argument("--users", type=int, default=20000)
+    parser.add_argument("--words", type=int, default=20000)
+    parser.add_argument("--days", type=int, default=730)
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    if os.path.exists(args.output):
+        print(f"{args.output} exists, remove it first", file=sys.stderr)
+        return 1
+    os.makedirs(os.path.dirname(os.path.abspath(args.output)), exist_ok=True)
+
+    rng = random.Random(args.seed)
+    vocabulary = make_vocabulary(rng, args.words)
+    # Cumulative once, choices() would sum up the weights on every call.
+    word_weights = list(itertools.accumulate(zipf_weights(len(vocabulary))))
+    chat_ids = [-(1000000000000 + i) if i % 3 else 100000 + i for i in range(args.chats)]
+    chat_weights = zipf_weights(len(chat_ids), 0.9)
+    user_ids = [500000 + i for i in range(args.users)]
+    now = int(time.time())
+    first = now - args.days * 86400
+
+    db = sqlite3.connect(args.output)
+    db.execute("PRAGMA journal_mode=OFF")
+    db.execute("PRAGMA synchronous=OFF")
+    for statement in SCHEMA:
+        db.execute(statement)
+
+    for index, chat_id in enumerate(chat_ids):
+        db.execute(
+            "INSERT INTO chats (chat_id, chat_type, title, member_count, first_seen, last_updated) "
+            "VALUES (?, ?, ?, ?, ?, ?)",
+            (chat_id, "user" if chat_id > 0 else "supergroup",
+             f"Bench chat {index}", rng.randint(2, 5000), first, now))
+
+    # Messages are spread over the chats by weight, ids and timestamps
+    # grow within each chat.
+    per_chat = [0] * len(chat_ids)
+    for chat in rng.choices(range(len(chat_ids)), chat_weights, k=args.messages):
+        per_chat[chat] += 1
+    started = time.time()
+    written = 0
+    rows = []
+    for chat, count in enumerate(per_chat):
+        if not count:
+            continue
+        step = max((now - first) // count, 1)
+        timestamp = first
+        for message_id in range(1, count + 1):
+            timestamp += rng.randint(0, 2 * step)
+            user_id = rng.choice(user_ids)
+            text = " ".join(rng.choices(vocabulary, cum_weights=word_weights, k=rng.randint(3, 25)))
+            reply = message_id - rng.randint(1, 50) if message_id > 50 and rng.random() < 0.15 else None
+            rows.append((
+                message_id, chat_ids[chat], user_id, f"user{user_id}",
+                f"User {user_id}", None, text, timestamp,
+                time.strftime("%Y-%m-%d %H:%M:%S", time.gmtime(timestamp)),
+                reply, 1 if reply else 0))
+            if len(rows) >= BATCH:
+                db.executemany(
+                    "INSERT INTO messages (message_id, chat_id, user_id, username, first_name, "
+                    "last_name, content, timestamp, date, reply_to_message_id, is_reply) "
+                    "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)", rows)
+                written += len(rows)
+                rows = []
+                rate = written / max(time.time() - started, 0.001)
+                print(f"\r{written}/{args.messages} messages, {rate:.0f}/s", end="", file=sys.stderr)
+    if rows:
+        db.executemany(
+            "INSERT INTO messages (message_id, chat_id, user_id, username, first_name, "
+            "last_name, content, timestamp, date, reply_to_message_id, is_reply) "
+            "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)", rows)
+        written += len(rows)
+    print(f"\r{written}/{args.messages} messages, building indices", file=sys.stderr)
+    for statement in INDICES:
+        db.execute(statement)
+    db.commit()
+    db.close()
+
+    # Scenario arguments, the busiest chats first.
+    ranked = sorted(range(len(chat_ids)), key=lambda chat: -per_chat[chat])
+    sidecar = {
+        "messages": written,
+        "seed": args.seed,
+        "chat_ids": [chat_ids[chat] for chat in ranked if per_chat[chat]],
+        "message_counts": [per_chat[chat] for chat in ranked if per_chat[chat]],
+        "user_ids": user_ids[:1000],
+        "words": vocabulary[:2000],
+        "first_timestamp": first,
+        "last_timestamp": now,
+    }
+    with open(args.output + ".json", "w") as file:
+        json.dump(sidecar, file)
+    print(f"Wrote {args.output} in {time.time() - started:.0f}s", file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
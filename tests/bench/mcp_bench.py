@@ -0,0 +1,572 @@
+#!/usr/bin/env python3
+"""
+MCP Benchmark Driver
+
+Runs a weighted mix of tool calls from a scenario file against the stdio,
+Bridge or HTTP transport and reports per-tool qps and p50/p90/p99 latency
+as JSON, so that results of two builds can be compared.
+
+Usage:
+    # Spawn the app on stdio with a synthetic archive
+    python3 tests/bench/mcp_bench.py --transport stdio \\
+        --fixture out/bench/1m.db tests/bench/scenarios/read_heavy.json
+
+    # Running app, IPC bridge or HTTP transport
+    python3 tests/bench/mcp_bench.py --transport bridge scenarios/search_heavy.json
+    python3 tests/bench/mcp_bench.py --transport http --url http://127.0.0.1:8000/mcp \\
+        scenarios/analytics.json
+
+    # Compare with a stored run, exits with 2 on a regression
+    python3 tests/bench/mcp_bench.py --transport bridge --output new.json \\
+        --compare old.json --threshold 10 scenarios/read_heavy.json
+"""
+import argparse
+import http.client
+import json
+import os
+import platform
+import queue
+import random
+import socket
+import subprocess
+import sys
+import threading
+import time
+import urllib.parse
+
+REPO_ROOT = os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+DEFAULT_APP = os.path.join(REPO_ROOT, "out/Release/Tlgrm.app/Contents/MacOS/Tlgrm")
+IPC_SOCKET_PATH = "/tmp/tdesktop_mcp.sock"
+DEFAULT_URL = "http://127.0.0.1:8000/mcp"
+STARTUP_TIMEOUT = 60  # seconds, the archive is opened and checked first
+
+BUSY_ERROR_CODE = -32005  # Shed by admission control, see BusyResponse()
+
+
+class CallError(Exception):
+    pass
+
+
+# ===== TRANSPORTS =====
+
+class StdioTransport:
+    """One spawned app, requests are pipelined on its stdin"""
+
+    def __init__(self, app, env):
+        self.process = subprocess.Popen(
+            [app, "--mcp"],
+            stdin=subprocess.PIPE,
+            stdout=subprocess.PIPE,
+            stderr=subprocess.DEVNULL,
+            env=env)
+        self._lock = threading.Lock()
+        self._pending = {}
+        self._next_id = 0
+        self._reader = threading.Thread(target=self._read, daemon=True)
+        self._reader.start()
+
+    def _read(self):
+        for line in self.process.stdout:
+            try:
+                message = json.loads(line)
+            except ValueError:
+                continue
+            if "id" not in message:
+                continue  # Notifications
+            with self._lock:
+                waiter = self._pending.pop(message["id"], None)
+            if waiter:
+                waiter.put(message)
+        with self._lock:
+            for waiter in self._pending.values():
+                waiter.put(None)
+            self._pending.clear()
+
+    def connect(self):
+        return self
+
+    def call(self, method, params, timeout):
+        waiter = queue.Queue(maxsize=1)
+        with self._lock:
+            self._next_id += 1
+            request_id = self._next_id
+            self._pending[request_id] = waiter
+        request = {"jsonrpc": "2.0", "id": request_id, "method": method, "params": params}
+        data = json.dumps(request).encode() + b"\n"
+        with self._lock:
+            self.process.stdin.write(data)
+            self.process.stdin.flush()
+        try:
+            response = waiter.get(timeout=timeout)
+        except queue.Empty:
+            with self._lock:
+                self._pending.pop(request_id, None)
+            raise CallError("timeout")
+        if response is None:
+            raise CallError("app exited")
+        return response
+
+    def close(self):
+        if self.process.poll() is None:
+            self.process.terminate()
+            try:
+                self.process.wait(timeout=10)
+            except subprocess.TimeoutExpired:
+                self.process.kill()
+
+
+class BridgeConnection:
+    """Persistent newline delimited JSON connection to the IPC bridge"""
+
+    def __init__(self, path):
+        self._socket = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self._socket.connect(path)
+        self._file = self._socket.makefile("rb")
+        self._next_id = 0
+
+    def call(self, method, params, timeout):
+        self._next_id += 1
+        request_id = self._next_id
+        request = {"jsonrpc": "2.0", "id": request_id, "method": method, "params": params}
+        self._socket.settimeout(timeout)
+        self._socket.sendall(json.dumps(request).encode() + b"\n")
+        try:
+            while True:
+                line = self._file.readline()
+                if not line:
+                    raise CallError("connection closed")
+                response = json.loads(line)
+                if response.get("id") == request_id:
+                    return response
+        except socket.timeout:
+            raise CallError("timeout")
+
+    def close(self):
+        self._socket.close()
+
+
+class BridgeTransport:
+    def __init__(self, path):
+        self.path = path
+
+    def connect(self):
+        return BridgeConnection(self.path)
+
+    def close(self):
+        pass
+
+
+class HttpConnection:
+    """Keep-alive connection with its own MCP session"""
+
+    def __init__(self, url, token):
+        self._url = urllib.parse.urlparse(url)
+        self._headers = {
+            "Content-Type": "application/json",
+            "Accept": "application/json, text/event-stream",
+        }
+        if token:
+            self._headers["Authorization"] = "Bearer " + token
+        self._connection = http.client.HTTPConnection(
+            self._url.hostname, self._url.port or 80)
+        self._next_id = 0
+        self.call("initialize", {}, 30)
+
+    def call(self, method, params, timeout):
+        self._next_id += 1
+        request_id = self._next_id
+        body = json.dumps({"jsonrpc": "2.0", "id": request_id, "method": method, "params": params})
+        self._connection.timeout = timeout
+        try:
+            self._connection.request("POST", self._url.path or "/mcp", body, self._headers)
+            response = self._connection.getresponse()
+            data = response.read()
+        except (OSError, http.client.HTTPException) as error:
+            self._connection.close()
+            raise CallError(str(error))
+        session = response.getheader("Mcp-Session-Id")
+        if session:
+            self._headers["Mcp-Session-Id"] = session
+        if response.getheader("Content-Type", "").startswith("text/event-stream"):
+            for line in data.splitlines():
+                if line.startswith(b"data:"):
+                    message = json.loads(line[5:])
+                    if message.get("id") == request_id:
+                        return message
+            raise CallError("no response in event stream")
+        if not data:
+            raise CallError(f"HTTP {response.status}")
+        return json.loads(data)
+
+    def close(self):
+        self._connection.close()
+
+
+class HttpTransport:
+    def __init__(self, url, token):
+        self.url = url
+        self.token = token
+
+    def connect(self):
+        return HttpConnection(self.url, self.token)
+
+    def close(self):
+        pass
+
+
+# ===== SCENARIOS =====
+
+class Arguments:
+    """Fills $placeholders of scenario arguments from the fixture pools"""
+
+    def __init__(self, fixture, rng, send_chat_id):
+        self.rng = rng
+        self.chat_ids = fixture.get("chat_ids") or []
+        self.user_ids = fixture.get("user_ids") or []
+        self.words = fixture.get("words") or ["hello", "meeting", "photo", "thanks"]
+        self.counts = fixture.get("message_counts") or []
+        self.first = fixture.get("first_timestamp", int(time.time()) - 365 * 86400)
+        self.last = fixture.get("last_timestamp", int(time.time()))
+        self.send_chat_id = send_chat_id
+        # Busy chats are read more often, like in the fixture itself.
+        self.chat_weights = [1.0 / (rank + 1) for rank in range(len(self.chat_ids))]
+
+    def chat(self):
+        if not self.chat_ids:
+            raise CallError("no chat ids, pass --fixture or run list_chats first")
+        return self.rng.choices(range(len(self.chat_ids)), self.chat_weights)[0]
+
+    def value(self, name):
+        if name == "chat_id":
+            return self.chat_ids[self.chat()]
+        elif name == "user_id":
+            return self.rng.choice(self.user_ids) if self.user_ids else 0
+        elif name == "word":
+            return self.rng.choice(self.words[:200])
+        elif name == "rare_word":
+            return self.rng.choice(self.words)
+        elif name == "phrase":
+            return " ".join(self.rng.sample(self.words[:200], 2))
+        elif name == "timestamp":
+            return self.rng.randint(self.first, self.last)
+        elif name == "chat_ids":
+            return self.rng.sample(self.chat_ids, min(5, len(self.chat_ids)))
+        elif name == "message_pairs":
+            pairs = []
+            for _ in range(20):
+                chat = self.chat()
+                count = self.counts[chat] if chat < len(self.counts) else 1
+                pairs.append({
+                    "chat_id": self.chat_ids[chat],
+                    "message_id": self.rng.randint(1, max(count, 1)),
+                })
+            return pairs
+        elif name == "send_chat_id":
+            if self.send_chat_id is None:
+                raise CallError("scenario sends messages, pass --send-chat-id")
+            return self.send_chat_id
+        elif name == "send_chat_ids":
+            if self.send_chat_id is None:
+                raise CallError("scenario sends messages, pass --send-chat-id")
+            return [self.send_chat_id]
+        elif name == "text":
+            return "bench " + " ".join(self.rng.sample(self.words[:200], 3))
+        raise CallError(f"unknown placeholder ${name}")
+
+    def fill(self, template):
+        if isinstance(template, str) and template.startswith("$"):
+            return self.value(template[1:])
+        elif isinstance(template, dict):
+            return {key: self.fill(value) for key, value in template.items()}
+        elif isinstance(template, list):
+            return [self.fill(value) for value in template]
+        return template
+
+
+def load_fixture(path):
+    if not path:
+        return {}
+    sidecar = path + ".json"
+    if not os.path.exists(sidecar):
+        print(f"warning: {sidecar} not found, arguments come from list_chats", file=sys.stderr)
+        return {}
+    with open(sidecar) as file:
+        return json.load(file)
+
+
+def discover_chats(connection, timeout):
+    # Without a fixture sidecar the running app's own chat list is used.
+    response = connection.call("tools/call", {"name": "list_chats", "arguments": {}}, timeout)
+    result = tool_result(response)
+    return [int(chat["id"]) for chat in result.get("chats", []) if "id" in chat]
+
+
+def tool_result(response):
+    if "error" in response:
+        error = response["error"]
+        if error.get("code") == BUSY_ERROR_CODE:
+            raise CallError("shed")
+        raise CallError(error.get("message", "error"))
+    result = response.get("result", {})
+    content = result.get("content")
+    if isinstance(content, list) and content:
+        try:
+            result = json.loads(content[0].get("text", "{}"))
+        except ValueError:
+            return {}
+    if isinstance(result, dict) and (result.get("success") is False or "error" in result):
+        raise CallError(str(result.get("error", "success false")))
+    return result
+
+
+# ===== DRIVER =====
+
+class Recorder:
+    def __init__(self):
+        self._lock = threading.Lock()
+        self.latencies = {}  # tool -> [ms]
+        self.errors = {}  # tool -> {reason: count}
+        self.shed = {}
+
+    def record(self, tool, milliseconds, error=None):
+        with self._lock:
+            if error == "shed":
+                self.shed[tool] = self.shed.get(tool, 0) + 1
+            elif error:
+                reasons = self.errors.setdefault(tool, {})
+                reasons[error] = reasons.get(error, 0) + 1
+            else:
+                self.latencies.setdefault(tool, []).append(milliseconds)
+
+
+def percentile(sorted_values, fraction):
+    if not sorted_values:
+        return None
+    index = min(int(fraction * len(sorted_values)), len(sorted_values) - 1)
+    return round(sorted_values[index], 3)
+
+
+def summarize(latencies, errors, shed, seconds):
+    ordered = sorted(latencies)
+    return {
+        "calls": len(ordered),
+        "errors": errors,
+        "shed": shed,
+        "qps": round(len(ordered) / seconds, 2) if seconds > 0 else 0,
+        "mean_ms": round(sum(ordered) / len(ordered), 3) if ordered else None,
+        "p50_ms": percentile(ordered, 0.50),
+        "p90_ms": percentile(ordered, 0.90),
+        "p99_ms": percentile(ordered, 0.99),
+        "max_ms": round(ordered[-1], 3) if ordered else None,
+    }
+
+
+def worker(transport, scenario, arguments, recorder, warmup_until, stop_at, timeout, errors):
+    try:
+        connection = transport.connect()
+    except (OSError, CallError) as error:
+        errors.append(f"connect: {error}")
+        return
+    calls = scenario["calls"]
+    weights = [call.get("weight", 1) for call in calls]
+    rng = arguments.rng
+    try:
+        while time.monotonic() < stop_at:
+            call = rng.choices(calls, weights)[0]
+            tool = call["tool"]
+            try:
+                params = {"name": tool, "arguments": arguments.fill(call.get("arguments", {}))}
+            except CallError as error:
+                errors.append(str(error))
+                return
+            started = time.monotonic()
+            error = None
+            try:
+                tool_result(connection.call("tools/call", params, timeout))
+            except CallError as failure:
+                error = str(failure)
+            except (OSError, ValueError) as failure:
+                error = type(failure).__name__
+            if started >= warmup_until:
+                recorder.record(tool, (time.monotonic() - started) * 1000.0, error)
+    finally:
+        if connection is not transport:
+            connection.close()
+
+
+def git_revision():
+    try:
+        return subprocess.check_output(
+            ["git", "-C", REPO_ROOT, "rev-parse", "--short", "HEAD"],
+            stderr=subprocess.DEVNULL).decode().strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def wait_ready(connection, timeout):
+    deadline = time.monotonic() + timeout
+    while True:
+        try:
+            connection.call("initialize", {}, 5)
+            return
+        except CallError:
+            if time.monotonic() > deadline:
+                raise
+
+
+def compare(report, baseline, threshold):
+    """Prints changes against baseline, returns names of regressed tools"""
+    regressed = []
+    print(f"{'tool':32} {'qps':>18} {'p50 ms':>18} {'p99 ms':>18}")
+    for tool, now in sorted(report["tools"].items()):
+        then = baseline.get("tools", {}).get(tool)
+        if not then or not now["calls"] or not then["calls"]:
+            continue
+
+        def change(key):
+            before, after = then.get(key), now.get(key)
+            if not before or after is None:
+                return 0.0, "n/a"
+            delta = (after - before) / before * 100.0
+            return delta, f"{before:.1f}->{after:.1f} {delta:+.0f}%"
+
+        qps, qps_text = change("qps")
+        _, p50_text = change("p50_ms")
+        p99, p99_text = change("p99_ms")
+        if qps < -threshold or p99 > threshold:
+            regressed.append(tool)
+        print(f"{tool:32} {qps_text:>18} {p50_text:>18} {p99_text:>18}")
+    return regressed
+
+
+def main():
+    parser = argparse.ArgumentParser(description="MCP tool throughput and latency benchmark")
+    parser.add_argument("scenario", help="Scenario JSON file, see tests/bench/scenarios")
+    parser.add_argument("--transport", choices=["stdio", "bridge", "http"], default="stdio")
+    parser.add_argument("--app", default=DEFAULT_APP, help="App binary, stdio only")
+    parser.add_argument("--fixture", help="Archive made by make_archive.py, its sidecar gives the arguments")
+    parser.add_argument("--socket", default=IPC_SOCKET_PATH, help="Bridge socket path")
+    parser.add_argument("--url", default=DEFAULT_URL, help="HTTP transport endpoint")
+    parser.add_argument("--token", help="HTTP bearer token")
+    parser.add_argument("--duration", type=float, help="Seconds measured, overrides the scenario")
+    parser.add_argument("--warmup", type=float, help="Seconds not measured at the start")
+    parser.add_argument("--concurrency", type=int, help="Parallel clients, overrides the scenario")
+    parser.add_argument("--timeout", type=float, default=30.0, help="Seconds per call")
+    parser.add_argument("--send-chat-id", type=int, help="Chat that sending scenarios write to")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--output", help="Write the JSON report here instead of stdout")
+    parser.add_argument("--compare", help="Earlier JSON report to compare with")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="Percent of qps drop or p99 growth that counts as a regression")
+    args = parser.parse_args()
+
+    with open(args.scenario) as file:
+        scenario = json.load(file)
+    duration = args.duration or scenario.get("duration", 30)
+    warmup = args.warmup if args.warmup is not None else scenario.get("warmup", 3)
+    concurrency = args.concurrency or scenario.get("concurrency", 1)
+
+    fixture = load_fixture(args.fixture)
+    if args.transport == "stdio":
+        env = dict(os.environ)
+        if args.fixture:
+            env["MCP_DATABASE_PATH"] = os.path.abspath(args.fixture)
+        transport = StdioTransport(args.app, env)
+        wait_ready(transport, STARTUP_TIMEOUT)
+    elif args.transport == "bridge":
+        transport = BridgeTransport(args.socket)
+    else:
+        transport = HttpTransport(args.url, args.token)
+
+    try:
+        if not fixture.get("chat_ids"):
+            connection = transport.connect()
+            fixture["chat_ids"] = discover_chats(connection, args.timeout)
+            if connection is not transport:
+                connection.close()
+
+        recorder = Recorder()
+        errors = []
+        started = time.monotonic()
+        warmup_until = started + warmup
+        stop_at = warmup_until + duration
+        threads = []
+        for index in range(concurrency):
+            arguments = Arguments(fixture, random.Random(args.seed + index), args.send_chat_id)
+            thread = threading.Thread(
+                target=worker,
+                args=(transport, scenario, arguments, recorder,
+                      warmup_until, stop_at, args.timeout, errors),
+                daemon=True)
+            thread.start()
+            threads.append(thread)
+        for thread in threads:
+            thread.join()
+        measured = max(min(time.monotonic(), stop_at) - warmup_until, 0.001)
+    finally:
+        transport.close()
+
+    if errors:
+        for error in sorted(set(errors)):
+            print(f"error: {error}", file=sys.stderr)
+        if not recorder.latencies:
+            return 1
+
+    tools = {}
+    everything = []
+    for tool in sorted(set(recorder.latencies) | set(recorder.errors) | set(recorder.shed)):
+        latencies = recorder.latencies.get(tool, [])
+        everything.extend(latencies)
+        tools[tool] = summarize(
+            latencies,
+            sum(recorder.errors.get(tool, {}).values()),
+            recorder.shed.get(tool, 0),
+            measured)
+        if tool in recorder.errors:
+            tools[tool]["error_reasons"] = recorder.errors[tool]
+    report = {
+        "meta": {
+            "scenario": scenario.get("name", os.path.basename(args.scenario)),
+            "transport": args.transport,
+            "fixture": os.path.basename(args.fixture) if args.fixture else None,
+            "fixture_messages": fixture.get("messages"),
+            "revision": git_revision(),
+            "host": platform.node(),
+            "platform": platform.platform(),
+            "concurrency": concurrency,
+            "warmup_s": warmup,
+            "duration_s": round(measured, 3),
+            "started_at": time.strftime("%Y-%m-%dT%H:%M:%SZ", time.gmtime()),
+        },
+        "total": summarize(
+            everything,
+            sum(tool["errors"] for tool in tools.values()),
+            sum(tool["shed"] for tool in tools.values()),
+            measured),
+        "tools": tools,
+    }
+
+    text = json.dumps(report, indent=2)
+    if args.output:
+        with open(args.output, "w") as file:
+            file.write(text + "\n")
+    else:
+        print(text)
+
+    if args.compare:
+        with open(args.compare) as file:
+            baseline = json.load(file)
+        out = sys.stderr if not args.output else sys.stdout
+        saved, sys.stdout = sys.stdout, out
+        try:
+            regressed = compare(report, baseline, args.threshold)
+        finally:
+            sys.stdout = saved
+        if regressed:
+            print(f"regressed: {', '.join(regressed)}", file=sys.stderr)
+            return 2
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
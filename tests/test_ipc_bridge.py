@@ -152,6 +152,108 @@ class TestIPCBridgeProtocol:
             # Server may not respond to malformed params - this is acceptable
             pass
 
+    def test_pipelined_requests_on_one_connection(self, ensure_telegram_running):
+        """Test several outstanding requests on a persistent connection"""
+        import socket
+
+        sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        sock.settimeout(5.0)
+
+        try:
+            sock.connect("/tmp/tdesktop_mcp.sock")
+
+            ids = set(range(1, 51))
+            payload = b"".join(
+                json.dumps({"jsonrpc": "2.0", "id": i, "method": "ping", "params": {}}).encode() + b"\n"
+                for i in ids)
+            sock.sendall(payload)
+
+            # Responses are newline-delimited and matched by id
+            buffer = b""
+            received = set()
+            while received != ids:
+                chunk = sock.recv(65536)
+                assert chunk, "Connection closed before all responses arrived"
+                buffer += chunk
+                *lines, buffer = buffer.split(b"\n")
+                for line in lines:
+                    if line.strip():
+                        received.add(json.loads(line)["id"])
+
+            assert received == ids, "Every request should get its own response"
+        finally:
+            sock.close()
+
+    def test_cbor_request_gets_cbor_response(self, ensure_telegram_running):
+        """Test that CBOR encoded requests are answered in CBOR"""
+        import socket
+        cbor2 = pytest.importorskip("cbor2")
+
+        sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        sock.settimeout(5.0)
+
+        try:
+            sock.connect("/tmp/tdesktop_mcp.sock")
+            sock.sendall(cbor2.dumps({"jsonrpc": "2.0", "id": 7, "method": "ping", "params": {}}))
+
+            buffer = b""
+            while True:
+                chunk = sock.recv(65536)
+                assert chunk, "Connection closed before the response arrived"
+                buffer += chunk
+                try:
+                    response = cbor2.loads(buffer)
+                    break
+                except cbor2.CBORDecodeEOF:
+                    continue
+
+            assert response["id"] == 7
+            assert "result" in response
+        finally:
+            sock.close()
+
+    def test_shared_memory_responses(self, ensure_telegram_running):
+        """Test responses over the threshold arrive through a mapped segment"""
+        import mmap
+        import os
+        import socket
+        import stat
+
+        sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        sock.settimeout(5.0)
+
+        def request(id, method, params):
+            sock.sendall(json.dumps({"jsonrpc": "2.0", "id": id, "method": method, "params": params}).encode() + b"\n")
+            buffer = b""
+            while not buffer.endswith(b"\n"):
+                chunk = sock.recv(65536)
+                assert chunk, "Connection closed before the response arrived"
+                buffer += chunk
+            return json.loads(buffer)
+
+        try:
+            sock.connect("/tmp/tdesktop_mcp.sock")
+            opened = request(1, "bridge/open_shm", {"threshold": 1, "segments": 2})
+            assert opened["result"]["segments"] == 2
+
+            response = request(2, "ping", {})
+            assert response["id"] == 2
+            shm = response["shm"]
+            assert shm["encoding"] == "json"
+            assert stat.S_IMODE(os.stat(shm["path"]).st_mode) == 0o600
+            directory = os.path.dirname(shm["path"])
+            assert stat.S_IMODE(os.lstat(directory).st_mode) == 0o700
+            with open(shm["path"], "rb") as f:
+                with mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as view:
+                    body = json.loads(view[shm["offset"]:shm["offset"] + shm["length"]])
+            assert body["id"] == 2
+            assert body["result"]["status"] == "pong"
+
+            released = request(3, "bridge/release_shm", {"segment": shm["segment"]})
+            assert released["result"]["released"]
+        finally:
+            sock.close()
+
 
 class TestIPCBridgeErrorHandling:
     """Test error handling in IPC bridge"""
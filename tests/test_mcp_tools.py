@@ -46,6 +46,21 @@ class TestCoreMessagingTools:
                 # The exact fields depend on implementation
                 assert isinstance(msg, dict), "Message should be dict"
 
+    def test_compact_messages(self, ensure_telegram_running, mcp_client):
+        """Test read_messages fields projection and compact format"""
+        response = mcp_client.send_request("read_messages", {
+            "chat_id": 777000,
+            "limit": 5,
+            "fields": ["text"],
+            "format": "compact",
+        })
+
+        result = response["result"]
+        assert result["format"] == "compact"
+        columns = result["messages"]
+        assert set(columns) == {"ids", "texts"}
+        assert len(columns["ids"]) == len(columns["texts"]) == result["count"]
+
 
 class TestSearchTools:
     """Test search functionality"""
@@ -171,6 +186,19 @@ class TestEdgeCases:
             # Server may timeout on very long queries - acceptable
             pass
 
+    def test_chat_members_from_cache(self, ensure_telegram_running, mcp_client):
+        """Test member lists answer from the cache without waiting for the server"""
+        response = mcp_client.send_request("search_chat_members", {"chat_id": 777000, "query": " "})
+        assert "error" in response.get("result", response)
+
+        start = time.time()
+        response = mcp_client.send_request("get_chat_members", {"chat_id": 777000, "limit": 5})
+        assert time.time() - start < 1.0
+        result = response.get("result", {})
+        if "members" in result:
+            assert result["count"] == len(result["members"]) <= 5
+            assert result["total"] >= result["count"]
+
     def test_empty_params(self, ensure_telegram_running, mcp_client):
         """Test methods with empty params"""
         try:
@@ -205,6 +233,86 @@ class TestServerInfo:
             # Connection may be lost - skip
             pytest.skip("Connection lost")
 
+    def test_metrics_track_tool_calls(self, ensure_telegram_running, mcp_client):
+        """Test get_metrics reports latency percentiles per tool"""
+        mcp_client.send_request("health_check")
+        response = mcp_client.send_request("get_metrics", {"tool": "health_check"})
+
+        assert "result" in response, "get_metrics should succeed"
+        tools = response["result"].get("tools", [])
+        assert len(tools) == 1, "Should report the requested tool only"
+        entry = tools[0]
+        assert entry["tool"] == "health_check"
+        assert entry["calls"] >= 1
+        assert entry["p50_ms"] <= entry["p95_ms"] <= entry["p99_ms"] <= entry["max_ms"]
+
+    def test_network_stats_per_session(self, ensure_telegram_running, mcp_client):
+        """Test get_network_stats reports the MTProto sessions"""
+        response = mcp_client.send_request("get_network_stats")
+
+        assert "result" in response, "get_network_stats should succeed"
+        sessions = response["result"].get("sessions", [])
+        assert len(sessions) >= 1, "Should report at least the main session"
+        for entry in sessions:
+            assert entry["bytes_sent"] >= 0
+            assert entry["to_send"] >= 0 and entry["have_sent"] >= 0
+            # The counters are read one by one while the session keeps
+            # receiving, so responses arriving after the total was read
+            # may already be in the buckets.
+            counts = sum(bucket["count"] for bucket in entry["response_histogram"])
+            assert counts >= entry["responses"]
+
+    def test_health_check_reports_stalls(self, ensure_telegram_running, mcp_client):
+        """Test health_check reports main thread stalls by component"""
+        response = mcp_client.send_request("health_check")
+
+        assert "result" in response, "health_check should succeed"
+        stalls = response["result"]["main_thread_stalls"]
+        assert stalls["running"]
+        assert stalls["threshold_ms"] > 0
+        assert sum(entry["count"] for entry in stalls["components"]) == stalls["count"]
+        assert all(entry["duration_ms"] >= stalls["threshold_ms"] for entry in stalls["recent"])
+
+    def test_trace_capture(self, ensure_telegram_running, mcp_client, tmp_path):
+        """Test start_trace and stop_trace write a Chrome trace"""
+        path = str(tmp_path / "trace.json")
+        response = mcp_client.send_request("start_trace", {"path": path})
+        assert "result" in response, "start_trace should succeed"
+
+        mcp_client.send_request("health_check")
+        response = mcp_client.send_request("stop_trace")
+        assert "result" in response, "stop_trace should succeed"
+        assert response["result"]["path"] == path
+        assert response["result"]["events"] >= 1
+
+        with open(path) as f:
+            events = json.load(f)["traceEvents"]
+        assert any(
+            event.get("cat") == "mcp" and event["args"]["detail"] == "health_check"
+            for event in events)
+
+    def test_background_job(self, ensure_telegram_running, mcp_client):
+        """Test start_job answers at once and get_job returns the result"""
+        response = mcp_client.send_request(
+            "start_job", {"tool": "list_archived_chats", "arguments": {}})
+        assert "result" in response, "start_job should succeed"
+        job_id = response["result"]["job_id"]
+
+        job = {}
+        for _ in range(50):
+            job = mcp_client.send_request("get_job", {"job_id": job_id, "limit": 1})["result"]
+            if job["state"] not in ("queued", "running"):
+                break
+            time.sleep(0.1)
+        assert job["state"] == "completed"
+        assert "chats" in job["result"]
+        assert len(job["result"]["chats"]) <= 1
+        if "page" in job:
+            assert job["page"]["key"] == "chats"
+
+        response = mcp_client.send_request("cancel_job", {"job_id": job_id})
+        assert "error" in response["result"], "finished jobs can't be cancelled"
+
 
 class TestDataTypes:
     """Test data type handling"""